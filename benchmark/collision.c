@@ -0,0 +1,334 @@
+// SPDX-FileCopyrightText: 2025 Erin Catto
+// SPDX-License-Identifier: MIT
+
+// Microbenchmarks of the collision functions. Whole scenes hide small changes to these kernels
+// in the noise of the solver and the task system.
+
+#if defined( _MSC_VER ) && !defined( _CRT_SECURE_NO_WARNINGS )
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "utils.h"
+
+#include "box2d/base.h"
+#include "box2d/collision.h"
+#include "box2d/math_functions.h"
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARRAY_COUNT( A ) (int)( sizeof( A ) / sizeof( A[0] ) )
+
+// Large enough to defeat the branch predictor, small enough to stay in cache
+#define CASE_COUNT 1024
+#define HULL_POINT_COUNT 12
+
+// Inputs of one call. Shape A is near the origin and shape B is placed so that about half
+// of the pairs overlap.
+typedef struct CollisionCase
+{
+	b2Polygon polygonA;
+	b2Polygon polygonB;
+	b2Capsule capsuleA;
+	b2Capsule capsuleB;
+	b2ChainSegment chainSegment;
+	b2Transform transformA;
+	b2Transform transformB;
+	b2ShapeProxy proxyA;
+	b2ShapeProxy proxyB;
+	b2Vec2 translationB;
+	b2Sweep sweepA;
+	b2Sweep sweepB;
+	b2Vec2 points[HULL_POINT_COUNT];
+	int pointCount;
+} CollisionCase;
+
+static CollisionCase s_cases[CASE_COUNT];
+
+// Results are accumulated here so the calls cannot be removed by the optimizer
+static volatile float s_sink;
+
+static b2Capsule RandomCapsule( void )
+{
+	b2Capsule capsule;
+	capsule.center1 = RandomVec2( -0.5f, 0.5f );
+	capsule.center2 = RandomVec2( -0.5f, 0.5f );
+	capsule.radius = RandomFloatRange( 0.05f, 0.25f );
+	return capsule;
+}
+
+static void CreateCases( void )
+{
+	g_randomSeed = RAND_SEED;
+
+	for ( int i = 0; i < CASE_COUNT; ++i )
+	{
+		CollisionCase* c = s_cases + i;
+
+		c->polygonA = RandomPolygon( 0.5f );
+		c->polygonB = RandomPolygon( 0.5f );
+
+		// Rounded polygons take a different path in the manifold functions
+		if ( ( i & 3 ) == 0 )
+		{
+			c->polygonB.radius = 0.1f;
+		}
+
+		c->capsuleA = RandomCapsule();
+		c->capsuleB = RandomCapsule();
+
+		b2Vec2 p1 = { -1.0f, RandomFloatRange( -0.2f, 0.2f ) };
+		b2Vec2 p2 = { 1.0f, RandomFloatRange( -0.2f, 0.2f ) };
+		c->chainSegment.ghost1 = b2Add( p1, RandomVec2( -1.5f, -0.5f ) );
+		c->chainSegment.segment = ( b2Segment ){ p1, p2 };
+		c->chainSegment.ghost2 = b2Add( p2, RandomVec2( 0.5f, 1.5f ) );
+		c->chainSegment.chainId = 0;
+
+		c->transformA = ( b2Transform ){ RandomVec2( -0.1f, 0.1f ), RandomRot() };
+		c->transformB = ( b2Transform ){ RandomVec2( -1.0f, 1.0f ), RandomRot() };
+
+		c->proxyA = b2MakeProxy( c->polygonA.vertices, c->polygonA.count, c->polygonA.radius );
+		c->proxyB = b2MakeProxy( c->polygonB.vertices, c->polygonB.count, c->polygonB.radius );
+
+		// Cast toward shape A from outside
+		b2Vec2 start = b2MulSV( 3.0f, b2Normalize( RandomVec2( -1.0f, 1.0f ) ) );
+		c->translationB = b2MulSV( -RandomFloatRange( 2.0f, 4.0f ), b2Normalize( b2Add( start, RandomVec2( -0.5f, 0.5f ) ) ) );
+
+		c->sweepA = ( b2Sweep ){ b2Vec2_zero, c->transformA.p, c->transformA.p, c->transformA.q, c->transformA.q };
+		c->sweepB = ( b2Sweep ){ b2Vec2_zero, start, b2Add( start, c->translationB ), c->transformB.q,
+								 b2IntegrateRotation( c->transformB.q, RandomFloatRange( -2.0f, 2.0f ) ) };
+
+		c->pointCount = RandomIntRange( 3, HULL_POINT_COUNT );
+		for ( int j = 0; j < c->pointCount; ++j )
+		{
+			c->points[j] = RandomVec2( -1.0f, 1.0f );
+		}
+	}
+}
+
+static float CollidePolygons( void )
+{
+	float sum = 0.0f;
+	for ( int i = 0; i < CASE_COUNT; ++i )
+	{
+		CollisionCase* c = s_cases + i;
+		b2Manifold m = b2CollidePolygons( &c->polygonA, c->transformA, &c->polygonB, c->transformB );
+		sum += (float)m.pointCount;
+	}
+	return sum;
+}
+
+static float CollideCapsules( void )
+{
+	float sum = 0.0f;
+	for ( int i = 0; i < CASE_COUNT; ++i )
+	{
+		CollisionCase* c = s_cases + i;
+		b2Manifold m = b2CollideCapsules( &c->capsuleA, c->transformA, &c->capsuleB, c->transformB );
+		sum += (float)m.pointCount;
+	}
+	return sum;
+}
+
+static float CollideChainSegmentAndPolygon( void )
+{
+	float sum = 0.0f;
+	for ( int i = 0; i < CASE_COUNT; ++i )
+	{
+		CollisionCase* c = s_cases + i;
+		b2SimplexCache cache = { 0 };
+		b2Manifold m = b2CollideChainSegmentAndPolygon( &c->chainSegment, b2Transform_identity, &c->polygonB, c->transformB,
+														 &cache );
+		sum += (float)m.pointCount;
+	}
+	return sum;
+}
+
+static float CollideChainSegmentAndCapsule( void )
+{
+	float sum = 0.0f;
+	for ( int i = 0; i < CASE_COUNT; ++i )
+	{
+		CollisionCase* c = s_cases + i;
+		b2SimplexCache cache = { 0 };
+		b2Manifold m = b2CollideChainSegmentAndCapsule( &c->chainSegment, b2Transform_identity, &c->capsuleB, c->transformB,
+														 &cache );
+		sum += (float)m.pointCount;
+	}
+	return sum;
+}
+
+static float ShapeDistance( void )
+{
+	float sum = 0.0f;
+	for ( int i = 0; i < CASE_COUNT; ++i )
+	{
+		CollisionCase* c = s_cases + i;
+		b2DistanceInput input = { c->proxyA, c->proxyB, c->transformA, c->transformB, true };
+		b2SimplexCache cache = { 0 };
+		b2DistanceOutput output = b2ShapeDistance( &input, &cache, NULL, 0 );
+		sum += output.distance;
+	}
+	return sum;
+}
+
+static float ShapeCast( void )
+{
+	float sum = 0.0f;
+	for ( int i = 0; i < CASE_COUNT; ++i )
+	{
+		CollisionCase* c = s_cases + i;
+		b2Transform transformB = { c->sweepB.c1, c->transformB.q };
+		b2ShapeCastPairInput input = { c->proxyA, c->proxyB, c->transformA, transformB, c->translationB, 1.0f, false };
+		b2CastOutput output = b2ShapeCast( &input );
+		sum += output.fraction;
+	}
+	return sum;
+}
+
+static float TimeOfImpact( void )
+{
+	float sum = 0.0f;
+	for ( int i = 0; i < CASE_COUNT; ++i )
+	{
+		CollisionCase* c = s_cases + i;
+		b2TOIInput input = { c->proxyA, c->proxyB, c->sweepA, c->sweepB, 1.0f };
+		b2TOIOutput output = b2TimeOfImpact( &input );
+		sum += output.fraction;
+	}
+	return sum;
+}
+
+static float ComputeHull( void )
+{
+	float sum = 0.0f;
+	for ( int i = 0; i < CASE_COUNT; ++i )
+	{
+		CollisionCase* c = s_cases + i;
+		b2Hull hull = b2ComputeHull( c->points, c->pointCount );
+		sum += (float)hull.count;
+	}
+	return sum;
+}
+
+static float MakeProxy( void )
+{
+	float sum = 0.0f;
+	for ( int i = 0; i < CASE_COUNT; ++i )
+	{
+		CollisionCase* c = s_cases + i;
+		int count = b2MinInt( c->pointCount, B2_MAX_POLYGON_VERTICES );
+		b2ShapeProxy proxy = b2MakeProxy( c->points, count, 0.0f );
+		sum += proxy.points[count - 1].x;
+	}
+	return sum;
+}
+
+typedef float KernelFcn( void );
+
+typedef struct Kernel
+{
+	const char* name;
+	KernelFcn* fcn;
+} Kernel;
+
+int main( int argc, char** argv )
+{
+	Kernel kernels[] = {
+		{ "collide_polygons", CollidePolygons },
+		{ "collide_capsules", CollideCapsules },
+		{ "collide_chain_polygon", CollideChainSegmentAndPolygon },
+		{ "collide_chain_capsule", CollideChainSegmentAndCapsule },
+		{ "shape_distance", ShapeDistance },
+		{ "shape_cast", ShapeCast },
+		{ "time_of_impact", TimeOfImpact },
+		{ "compute_hull", ComputeHull },
+		{ "make_proxy", MakeProxy },
+	};
+
+	int kernelCount = ARRAY_COUNT( kernels );
+	int runCount = 5;
+	int iterationCount = 200;
+	int singleKernel = -1;
+
+	for ( int i = 1; i < argc; ++i )
+	{
+		const char* arg = argv[i];
+		if ( strncmp( arg, "-k=", 3 ) == 0 )
+		{
+			singleKernel = b2ClampInt( atoi( arg + 3 ), 0, kernelCount - 1 );
+		}
+		else if ( strncmp( arg, "-r=", 3 ) == 0 )
+		{
+			runCount = b2ClampInt( atoi( arg + 3 ), 1, 1000 );
+		}
+		else if ( strncmp( arg, "-i=", 3 ) == 0 )
+		{
+			iterationCount = b2ClampInt( atoi( arg + 3 ), 1, 1000000 );
+		}
+		else if ( strcmp( arg, "-h" ) == 0 )
+		{
+			printf( "Usage\n"
+					"-k=<integer>: run a single kernel\n"
+					"-r=<integer>: number of repeats (default is 5)\n"
+					"-i=<integer>: passes over the %d inputs per repeat (default is 200)\n",
+					CASE_COUNT );
+			exit( 0 );
+		}
+	}
+
+	CreateCases();
+
+	printf( "Starting Box2D collision benchmarks\n" );
+	printf( "======================================\n" );
+
+	FILE* file = fopen( "collision.csv", "w" );
+	if ( file != NULL )
+	{
+		fprintf( file, "kernel,ns\n" );
+	}
+
+	for ( int kernelIndex = 0; kernelIndex < kernelCount; ++kernelIndex )
+	{
+		if ( singleKernel != -1 && kernelIndex != singleKernel )
+		{
+			continue;
+		}
+
+		Kernel* kernel = kernels + kernelIndex;
+
+		// Warm up the caches and the branch predictor
+		s_sink += kernel->fcn();
+
+		float minMilliseconds = FLT_MAX;
+		for ( int runIndex = 0; runIndex < runCount; ++runIndex )
+		{
+			uint64_t ticks = b2GetTicks();
+			for ( int iteration = 0; iteration < iterationCount; ++iteration )
+			{
+				s_sink += kernel->fcn();
+			}
+			minMilliseconds = b2MinFloat( minMilliseconds, b2GetMilliseconds( ticks ) );
+		}
+
+		float nanoseconds = 1000000.0f * minMilliseconds / ( (float)CASE_COUNT * (float)iterationCount );
+		printf( "%-24s %8.1f ns/call\n", kernel->name, nanoseconds );
+
+		if ( file != NULL )
+		{
+			fprintf( file, "%s,%g\n", kernel->name, nanoseconds );
+		}
+	}
+
+	if ( file != NULL )
+	{
+		fclose( file );
+	}
+
+	printf( "======================================\n" );
+	printf( "All Box2D collision benchmarks complete!\n" );
+
+	return 0;
+}
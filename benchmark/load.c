@@ -0,0 +1,372 @@
+// SPDX-FileCopyrightText: 2025 Erin Catto
+// SPDX-License-Identifier: MIT
+
+// Level load and teardown benchmark. Times world creation, bulk body and shape creation, chain creation,
+// the static tree rebuild, the first step and world destruction. Heap use is counted with b2SetAllocator.
+
+#if defined( _MSC_VER ) && !defined( _CRT_SECURE_NO_WARNINGS )
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "utils.h"
+
+#include "box2d/box2d.h"
+#include "box2d/math_functions.h"
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined( _MSC_VER )
+#include <malloc.h>
+#endif
+
+typedef enum LoadPhase
+{
+	phaseCreateWorld,
+	phaseCreateStatic,
+	phaseCreateDynamic,
+	phaseCreateChains,
+	phaseRebuildStaticTree,
+	phaseFirstStep,
+	phaseDestroyWorld,
+	phaseCount
+} LoadPhase;
+
+static const char* s_phaseNames[phaseCount] = {
+	"create_world", "static_shapes", "dynamic_bodies", "chains", "rebuild_static_tree", "first_step", "destroy_world",
+};
+
+typedef enum CapacityPreset
+{
+	presetDefault,
+	presetExact,
+	presetDouble,
+	presetCount
+} CapacityPreset;
+
+static const char* s_presetNames[presetCount] = { "default", "exact", "double" };
+
+typedef struct LoadConfig
+{
+	int staticShapeCount;
+	int dynamicBodyCount;
+	int chainCount;
+	int chainPointCount;
+} LoadConfig;
+
+typedef struct AllocationCounters
+{
+	int allocCount;
+	int freeCount;
+	int64_t byteCount;
+	int64_t maxByteCount;
+} AllocationCounters;
+
+static AllocationCounters s_allocations;
+
+static void* CountingAlloc( unsigned int size, int alignment )
+{
+	s_allocations.allocCount += 1;
+	s_allocations.byteCount += size;
+	s_allocations.maxByteCount = s_allocations.byteCount > s_allocations.maxByteCount ? s_allocations.byteCount
+																					  : s_allocations.maxByteCount;
+
+#if defined( _MSC_VER )
+	return _aligned_malloc( size, alignment );
+#else
+	// aligned_alloc needs a multiple of the alignment
+	size_t roundedSize = ( (size_t)size + alignment - 1 ) & ~( (size_t)alignment - 1 );
+	return aligned_alloc( alignment, roundedSize );
+#endif
+}
+
+static void CountingFree( void* mem, unsigned int size )
+{
+	s_allocations.freeCount += 1;
+	s_allocations.byteCount -= size;
+
+#if defined( _MSC_VER )
+	_aligned_free( mem );
+#else
+	free( mem );
+#endif
+}
+
+static b2Capacity GetCapacity( const LoadConfig* config, CapacityPreset preset )
+{
+	b2Capacity capacity = b2DefaultWorldDef().capacity;
+	if ( preset == presetDefault )
+	{
+		return capacity;
+	}
+
+	int scale = preset == presetDouble ? 2 : 1;
+	capacity.staticShapeCount = scale * ( config->staticShapeCount + config->chainCount * config->chainPointCount );
+	capacity.staticBodyCount = scale * ( 1 + config->chainCount );
+	capacity.dynamicShapeCount = scale * config->dynamicBodyCount;
+	capacity.dynamicBodyCount = scale * config->dynamicBodyCount;
+	capacity.chainCount = scale * config->chainCount;
+
+	// Bodies are stacked in columns so there are about two contacts per body
+	capacity.contactCount = scale * 2 * config->dynamicBodyCount;
+	return capacity;
+}
+
+// Runs one load and teardown. The times are in milliseconds and the allocation counts are per phase.
+static void RunLoad( const LoadConfig* config, CapacityPreset preset, float times[phaseCount], int allocCounts[phaseCount] )
+{
+	g_randomSeed = RAND_SEED;
+
+	int previousCount = s_allocations.allocCount;
+	uint64_t ticks = b2GetTicks();
+
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.capacity = GetCapacity( config, preset );
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	times[phaseCreateWorld] = b2GetMillisecondsAndReset( &ticks );
+	allocCounts[phaseCreateWorld] = s_allocations.allocCount - previousCount;
+	previousCount = s_allocations.allocCount;
+
+	// A grid of static boxes on one body, like a tile map
+	int columnCount = 200;
+	float spacing = 2.0f;
+	{
+		b2BodyDef bodyDef = b2DefaultBodyDef();
+		b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+		b2ShapeDef shapeDef = b2DefaultShapeDef();
+
+		for ( int i = 0; i < config->staticShapeCount; ++i )
+		{
+			b2Vec2 center = { spacing * ( i % columnCount ), -spacing * ( i / columnCount ) };
+			b2Polygon box = b2MakeOffsetBox( 0.5f * spacing, 0.5f * spacing, center, b2Rot_identity );
+			b2CreatePolygonShape( groundId, &shapeDef, &box );
+		}
+	}
+
+	times[phaseCreateStatic] = b2GetMillisecondsAndReset( &ticks );
+	allocCounts[phaseCreateStatic] = s_allocations.allocCount - previousCount;
+	previousCount = s_allocations.allocCount;
+
+	// Columns of mixed shapes standing on the static grid
+	{
+		b2BodyDef bodyDef = b2DefaultBodyDef();
+		bodyDef.type = b2_dynamicBody;
+		b2ShapeDef shapeDef = b2DefaultShapeDef();
+
+		b2Polygon box = b2MakeSquare( 0.4f );
+		b2Circle circle = { b2Vec2_zero, 0.4f };
+		b2Capsule capsule = { { -0.2f, 0.0f }, { 0.2f, 0.0f }, 0.2f };
+
+		for ( int i = 0; i < config->dynamicBodyCount; ++i )
+		{
+			bodyDef.position = (b2Vec2){ spacing * ( i % columnCount ), 1.0f + 0.85f * ( i / columnCount ) };
+			b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+
+			int kind = i % 3;
+			if ( kind == 0 )
+			{
+				b2CreatePolygonShape( bodyId, &shapeDef, &box );
+			}
+			else if ( kind == 1 )
+			{
+				b2CreateCircleShape( bodyId, &shapeDef, &circle );
+			}
+			else
+			{
+				b2CreateCapsuleShape( bodyId, &shapeDef, &capsule );
+			}
+		}
+	}
+
+	times[phaseCreateDynamic] = b2GetMillisecondsAndReset( &ticks );
+	allocCounts[phaseCreateDynamic] = s_allocations.allocCount - previousCount;
+	previousCount = s_allocations.allocCount;
+
+	// Terrain chains below the grid, one static body each
+	if ( config->chainCount > 0 )
+	{
+		b2Vec2* points = malloc( config->chainPointCount * sizeof( b2Vec2 ) );
+		float baseY = -spacing * ( config->staticShapeCount / columnCount + 2 );
+
+		for ( int i = 0; i < config->chainCount; ++i )
+		{
+			b2BodyDef bodyDef = b2DefaultBodyDef();
+			bodyDef.position = (b2Vec2){ 0.0f, baseY - 10.0f * i };
+			b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+
+			for ( int j = 0; j < config->chainPointCount; ++j )
+			{
+				float x = (float)( config->chainPointCount - j );
+				points[j] = (b2Vec2){ x, RandomFloatRange( -1.0f, 1.0f ) };
+			}
+
+			b2ChainDef chainDef = b2DefaultChainDef();
+			chainDef.points = points;
+			chainDef.count = config->chainPointCount;
+			b2CreateChain( bodyId, &chainDef );
+		}
+
+		free( points );
+	}
+
+	times[phaseCreateChains] = b2GetMillisecondsAndReset( &ticks );
+	allocCounts[phaseCreateChains] = s_allocations.allocCount - previousCount;
+	previousCount = s_allocations.allocCount;
+
+	b2World_RebuildStaticTree( worldId );
+
+	times[phaseRebuildStaticTree] = b2GetMillisecondsAndReset( &ticks );
+	allocCounts[phaseRebuildStaticTree] = s_allocations.allocCount - previousCount;
+	previousCount = s_allocations.allocCount;
+
+	// The first step creates every contact
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+	times[phaseFirstStep] = b2GetMillisecondsAndReset( &ticks );
+	allocCounts[phaseFirstStep] = s_allocations.allocCount - previousCount;
+	previousCount = s_allocations.allocCount;
+
+	b2DestroyWorld( worldId );
+
+	times[phaseDestroyWorld] = b2GetMilliseconds( ticks );
+	allocCounts[phaseDestroyWorld] = s_allocations.freeCount;
+}
+
+// Load the default level with every capacity preset and repeat 10 times.
+// ./build/bin/load_benchmark -r=10
+// Load a larger level with exact capacity.
+// ./build/bin/load_benchmark -n=200000 -s=50000 -c=500 -p=1
+int main( int argc, char** argv )
+{
+	LoadConfig config = {
+		.staticShapeCount = 20000,
+		.dynamicBodyCount = 50000,
+		.chainCount = 100,
+		.chainPointCount = 200,
+	};
+
+	int runCount = 5;
+	int singlePreset = -1;
+
+	for ( int i = 1; i < argc; ++i )
+	{
+		const char* arg = argv[i];
+		if ( strncmp( arg, "-n=", 3 ) == 0 )
+		{
+			config.dynamicBodyCount = b2ClampInt( atoi( arg + 3 ), 0, 10000000 );
+		}
+		else if ( strncmp( arg, "-s=", 3 ) == 0 )
+		{
+			config.staticShapeCount = b2ClampInt( atoi( arg + 3 ), 0, 10000000 );
+		}
+		else if ( strncmp( arg, "-c=", 3 ) == 0 )
+		{
+			config.chainCount = b2ClampInt( atoi( arg + 3 ), 0, 100000 );
+		}
+		else if ( strncmp( arg, "-cp=", 4 ) == 0 )
+		{
+			config.chainPointCount = b2ClampInt( atoi( arg + 4 ), 4, 100000 );
+		}
+		else if ( strncmp( arg, "-p=", 3 ) == 0 )
+		{
+			singlePreset = b2ClampInt( atoi( arg + 3 ), 0, presetCount - 1 );
+		}
+		else if ( strncmp( arg, "-r=", 3 ) == 0 )
+		{
+			runCount = b2ClampInt( atoi( arg + 3 ), 1, 1000 );
+		}
+		else if ( strcmp( arg, "-h" ) == 0 )
+		{
+			printf( "Usage\n"
+					"-n=<integer>: number of dynamic bodies (default is 50000)\n"
+					"-s=<integer>: number of static shapes (default is 20000)\n"
+					"-c=<integer>: number of chains (default is 100)\n"
+					"-cp=<integer>: points per chain (default is 200)\n"
+					"-p=<integer>: run a single capacity preset (0 default, 1 exact, 2 double)\n"
+					"-r=<integer>: number of repeats (default is 5)\n" );
+			exit( 0 );
+		}
+	}
+
+	b2SetAllocator( CountingAlloc, CountingFree );
+
+	printf( "Starting Box2D load benchmark\n" );
+	printf( "static shapes %d / dynamic bodies %d / chains %d x %d points\n", config.staticShapeCount,
+			config.dynamicBodyCount, config.chainCount, config.chainPointCount );
+	printf( "======================================\n" );
+
+	FILE* file = fopen( "load.csv", "w" );
+	if ( file != NULL )
+	{
+		fprintf( file, "preset,phase,ms,allocations\n" );
+	}
+
+	for ( int preset = 0; preset < presetCount; ++preset )
+	{
+		if ( singlePreset != -1 && preset != singlePreset )
+		{
+			continue;
+		}
+
+		float minTimes[phaseCount];
+		int allocCounts[phaseCount] = { 0 };
+		for ( int i = 0; i < phaseCount; ++i )
+		{
+			minTimes[i] = FLT_MAX;
+		}
+
+		int64_t maxByteCount = 0;
+
+		for ( int runIndex = 0; runIndex < runCount; ++runIndex )
+		{
+			memset( &s_allocations, 0, sizeof( s_allocations ) );
+
+			float times[phaseCount];
+			RunLoad( &config, preset, times, allocCounts );
+
+			for ( int i = 0; i < phaseCount; ++i )
+			{
+				minTimes[i] = b2MinFloat( minTimes[i], times[i] );
+			}
+
+			maxByteCount = s_allocations.maxByteCount;
+
+			if ( s_allocations.allocCount != s_allocations.freeCount || s_allocations.byteCount != 0 )
+			{
+				printf( "leak: %d allocations, %d frees, %lld bytes\n", s_allocations.allocCount, s_allocations.freeCount,
+						(long long)s_allocations.byteCount );
+			}
+		}
+
+		printf( "capacity: %s, peak heap %.1f MB\n", s_presetNames[preset], maxByteCount / ( 1024.0 * 1024.0 ) );
+
+		float total = 0.0f;
+		for ( int i = 0; i < phaseCount; ++i )
+		{
+			// Destruction reports frees
+			const char* label = i == phaseDestroyWorld ? "frees" : "allocations";
+			printf( "  %-20s %9.3f ms %8d %s\n", s_phaseNames[i], minTimes[i], allocCounts[i], label );
+			total += minTimes[i];
+
+			if ( file != NULL )
+			{
+				fprintf( file, "%s,%s,%g,%d\n", s_presetNames[preset], s_phaseNames[i], minTimes[i], allocCounts[i] );
+			}
+		}
+
+		printf( "  %-20s %9.3f ms\n\n", "total", total );
+	}
+
+	if ( file != NULL )
+	{
+		fclose( file );
+	}
+
+	printf( "======================================\n" );
+	printf( "All Box2D load benchmarks complete!\n" );
+
+	return 0;
+}
@@ -6,6 +6,7 @@
 #endif
 
 #include "benchmarks.h"
+#include "perf_counters.h"
 #include "utils.h"
 
 #include "box2d/box2d.h"
@@ -13,6 +14,7 @@
 #include "box2d/math_functions.h"
 
 #include <assert.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -47,11 +49,479 @@ static void MinProfile( b2Profile* p1, const b2Profile* p2 )
 	p1->sleepIslands = b2MinFloat( p1->sleepIslands, p2->sleepIslands );
 }
 
-// Box2D benchmark application. On Windows it is important to use affinity avoid cross CCD
-// usage or efficiency cores. Also on Windows create a power plan with Processor power management
+// Run times of one worker count. The confidence interval of the median uses order statistics so it
+// makes no assumption about the distribution of the run times.
+typedef struct RunStats
+{
+	float min;
+	float median;
+	float low;
+	float high;
+} RunStats;
+
+static int CompareFloats( const void* a, const void* b )
+{
+	float fa = *(const float*)a;
+	float fb = *(const float*)b;
+	return ( fa > fb ) - ( fa < fb );
+}
+
+static RunStats ComputeRunStats( float* times, int count )
+{
+	qsort( times, count, sizeof( float ), CompareFloats );
+
+	// 95% interval from the ranks n/2 -/+ 1.96 * sqrt(n) / 2, one based
+	float spread = 1.96f * sqrtf( (float)count );
+	int lowRank = b2MaxInt( (int)floorf( 0.5f * ( count - spread ) ), 1 );
+	int highRank = b2MinInt( (int)ceilf( 0.5f * ( count + spread ) ) + 1, count );
+
+	RunStats stats;
+	stats.min = times[0];
+	stats.median = ( count & 1 ) ? times[count / 2] : 0.5f * ( times[count / 2 - 1] + times[count / 2] );
+	stats.low = times[lowRank - 1];
+	stats.high = times[highRank - 1];
+	return stats;
+}
+
+typedef struct Baseline
+{
+	RunStats stats[B2_MAX_WORKERS];
+	bool valid[B2_MAX_WORKERS];
+
+	// Older results only have the fastest run
+	bool hasMedian[B2_MAX_WORKERS];
+} Baseline;
+
+// Reads a CSV written by this app. Returns false if the file is missing.
+static bool LoadBaseline( Baseline* baseline, const char* folder, const char* name )
+{
+	memset( baseline, 0, sizeof( Baseline ) );
+
+	char fileName[256] = { 0 };
+	snprintf( fileName, 256, "%s/%s.csv", folder, name );
+	FILE* file = fopen( fileName, "r" );
+	if ( file == NULL )
+	{
+		return false;
+	}
+
+	char line[256];
+	while ( fgets( line, sizeof( line ), file ) != NULL )
+	{
+		int threadCount = 0;
+		RunStats stats = { 0 };
+		int count = sscanf( line, "%d,%f,%f,%f,%f", &threadCount, &stats.min, &stats.median, &stats.low, &stats.high );
+		if ( count < 2 || threadCount < 1 || threadCount > B2_MAX_WORKERS )
+		{
+			// header
+			continue;
+		}
+
+		baseline->stats[threadCount - 1] = stats;
+		baseline->valid[threadCount - 1] = true;
+		baseline->hasMedian[threadCount - 1] = count == 5;
+	}
+
+	fclose( file );
+	return true;
+}
+
+// A slowdown is significant if the confidence intervals do not overlap and the median is slower by more
+// than the tolerance. Older baselines only have the fastest run, so the new interval must be slower than it.
+static bool IsRegression( const RunStats* current, const RunStats* base, bool hasMedian, float tolerance )
+{
+	if ( hasMedian )
+	{
+		return current->low > base->high && current->median > ( 1.0f + tolerance ) * base->median;
+	}
+
+	return current->low > ( 1.0f + tolerance ) * base->min;
+}
+
+// Stages of b2Profile shown by the scaling report
+typedef enum ScalingStage
+{
+	scalePairs,
+	scaleCollide,
+	scaleSolve,
+	scaleRefit,
+	scaleSensors,
+	scaleStageCount
+} ScalingStage;
+
+static const char* s_scalingStageNames[scaleStageCount] = { "pairs", "collide", "solve", "refit", "sensors" };
+
+static const char* s_solverStageNames[b2_profileStageCount] = {
+	"prepare_joints", "prepare_contacts", "integrate_velocities", "warm_start", "solve", "integrate_positions",
+	"relax", "restitution", "store_joints", "store_impulses", "overflow_contacts", "overflow_bodies",
+};
+
+// Step totals of one worker count, summed over the timed steps of all runs
+typedef struct ScalingSample
+{
+	float stageTimes[scaleStageCount];
+
+	// Time of the slowest worker and the average worker in each solver stage
+	float maxWorkTimes[b2_profileStageCount];
+	float meanWorkTimes[b2_profileStageCount];
+	bool valid;
+} ScalingSample;
+
+static void AccumulateScaling( ScalingSample* sample, b2WorldId worldId, int workerCount )
+{
+	b2Profile profile = b2World_GetProfile( worldId );
+	sample->stageTimes[scalePairs] += profile.pairs;
+	sample->stageTimes[scaleCollide] += profile.collide;
+	sample->stageTimes[scaleSolve] += profile.solve;
+	sample->stageTimes[scaleRefit] += profile.refit;
+	sample->stageTimes[scaleSensors] += profile.sensors;
+	sample->valid = true;
+
+	float maxTimes[b2_profileStageCount] = { 0 };
+	float sumTimes[b2_profileStageCount] = { 0 };
+	for ( int workerIndex = 0; workerIndex < workerCount; ++workerIndex )
+	{
+		b2WorkerProfile workerProfile = b2World_GetWorkerProfile( worldId, workerIndex );
+		for ( int stage = 0; stage < b2_profileStageCount; ++stage )
+		{
+			float workTime = workerProfile.stages[stage].workTime;
+			maxTimes[stage] = b2MaxFloat( maxTimes[stage], workTime );
+			sumTimes[stage] += workTime;
+		}
+	}
+
+	for ( int stage = 0; stage < b2_profileStageCount; ++stage )
+	{
+		sample->maxWorkTimes[stage] += maxTimes[stage];
+		sample->meanWorkTimes[stage] += sumTimes[stage] / workerCount;
+	}
+}
+
+// The slowest worker relative to the average worker. One is perfect balance.
+static float GetImbalance( const ScalingSample* sample, int stage )
+{
+	float mean = sample->meanWorkTimes[stage];
+	return mean > 0.0f ? sample->maxWorkTimes[stage] / mean : 1.0f;
+}
+
+// Speedup and efficiency of the median time relative to one worker. The serial fraction is the least squares
+// fit of Amdahl's law T(n) / T(1) = f + (1 - f) / n. The Karp-Flatt metric is the serial fraction measured
+// at each worker count, so growth shows overhead that increases with the worker count.
+static void WriteScalingReport( const char* name, const RunStats* runStats, const ScalingSample* samples, int maxThreadCount )
+{
+	if ( samples[0].valid == false )
+	{
+		printf( "scaling %s: needs a run with one worker\n", name );
+		return;
+	}
+
+	float baseTime = runStats[0].median;
+	float numerator = 0.0f;
+	float denominator = 0.0f;
+	for ( int threadIndex = 2; threadIndex <= maxThreadCount; ++threadIndex )
+	{
+		if ( samples[threadIndex - 1].valid == false )
+		{
+			continue;
+		}
+
+		float x = 1.0f / threadIndex;
+		float y = runStats[threadIndex - 1].median / baseTime;
+		numerator += ( y - x ) * ( 1.0f - x );
+		denominator += ( 1.0f - x ) * ( 1.0f - x );
+	}
+
+	float serialFraction = denominator > 0.0f ? b2ClampFloat( numerator / denominator, 0.0f, 1.0f ) : 0.0f;
+
+	char fileName[64] = { 0 };
+	snprintf( fileName, 64, "%s_scaling.csv", name );
+	FILE* file = fopen( fileName, "w" );
+	if ( file != NULL )
+	{
+		fprintf( file, "threads,ms,speedup,efficiency,karp_flatt" );
+		for ( int stage = 0; stage < scaleStageCount; ++stage )
+		{
+			fprintf( file, ",%s_ms,%s_speedup", s_scalingStageNames[stage], s_scalingStageNames[stage] );
+		}
+		for ( int stage = 0; stage < b2_profileStageCount; ++stage )
+		{
+			fprintf( file, ",%s_imbalance", s_solverStageNames[stage] );
+		}
+		fprintf( file, "\n" );
+	}
+
+	printf( "scaling %s: serial fraction %.3f\n", name, serialFraction );
+	printf( "threads       ms  speedup  effic  karp-f" );
+	for ( int stage = 0; stage < scaleStageCount; ++stage )
+	{
+		printf( " %8s", s_scalingStageNames[stage] );
+	}
+	printf( "  imbalance\n" );
+
+	const ScalingSample* base = samples + 0;
+	for ( int threadIndex = 1; threadIndex <= maxThreadCount; ++threadIndex )
+	{
+		const ScalingSample* sample = samples + threadIndex - 1;
+		if ( sample->valid == false )
+		{
+			continue;
+		}
+
+		float ms = runStats[threadIndex - 1].median;
+		float speedup = baseTime / ms;
+		float efficiency = speedup / threadIndex;
+		float inverseCount = 1.0f / threadIndex;
+		float karpFlatt = threadIndex > 1 ? ( 1.0f / speedup - inverseCount ) / ( 1.0f - inverseCount ) : 0.0f;
+
+		// The worst solver stage, weighted stages would hide a stage that stops scaling
+		float imbalance = 1.0f;
+		for ( int stage = 0; stage < b2_profileStageCount; ++stage )
+		{
+			imbalance = b2MaxFloat( imbalance, GetImbalance( sample, stage ) );
+		}
+
+		printf( "%7d %8.2f %8.2f %6.2f %7.3f", threadIndex, ms, speedup, efficiency, karpFlatt );
+		for ( int stage = 0; stage < scaleStageCount; ++stage )
+		{
+			float stageTime = sample->stageTimes[stage];
+			printf( " %8.2f", stageTime > 0.0f ? base->stageTimes[stage] / stageTime : 0.0f );
+		}
+		printf( " %10.2f\n", imbalance );
+
+		if ( file == NULL )
+		{
+			continue;
+		}
+
+		fprintf( file, "%d,%g,%g,%g,%g", threadIndex, ms, speedup, efficiency, karpFlatt );
+		for ( int stage = 0; stage < scaleStageCount; ++stage )
+		{
+			float stageTime = sample->stageTimes[stage];
+			fprintf( file, ",%g,%g", stageTime, stageTime > 0.0f ? base->stageTimes[stage] / stageTime : 0.0f );
+		}
+		for ( int stage = 0; stage < b2_profileStageCount; ++stage )
+		{
+			fprintf( file, ",%g", GetImbalance( sample, stage ) );
+		}
+		fprintf( file, "\n" );
+	}
+
+	printf( "\n" );
+
+	if ( file != NULL )
+	{
+		fclose( file );
+	}
+}
+
+// Stages of b2Profile shown by the jitter report
+typedef enum JitterStage
+{
+	jitterStep,
+	jitterPairs,
+	jitterCollide,
+	jitterSolve,
+	jitterSplitIslands,
+	jitterTransforms,
+	jitterRefit,
+	jitterSleepIslands,
+	jitterSensors,
+	jitterStageCount
+} JitterStage;
+
+static const char* s_jitterStageNames[jitterStageCount] = {
+	"step", "pairs", "collide", "solve", "split_islands", "transforms", "refit", "sleep_islands", "sensors",
+};
+
+// Events that can make a step slow
+typedef enum JitterCause
+{
+	causeSplit = 0x1,
+	causeWake = 0x2,
+	causeStack = 0x4,
+	causeTree = 0x8,
+} JitterCause;
+
+#define JITTER_CAUSE_COUNT 4
+
+static const char* s_jitterCauseNames[JITTER_CAUSE_COUNT] = { "split", "wake", "stack", "tree" };
+
+typedef struct JitterSample
+{
+	float stageTimes[jitterStageCount];
+	int runIndex;
+	int stepIndex;
+	int causes;
+	int splitIslandCount;
+	int wokenSetCount;
+	int stackGrowth;
+	int rebuiltLeafCount;
+} JitterSample;
+
+static JitterSample GetJitterSample( b2WorldId worldId, int runIndex, int stepIndex )
+{
+	b2Profile profile = b2World_GetProfile( worldId );
+	b2Counters counters = b2World_GetCounters( worldId );
+
+	JitterSample sample;
+	sample.stageTimes[jitterStep] = profile.step;
+	sample.stageTimes[jitterPairs] = profile.pairs;
+	sample.stageTimes[jitterCollide] = profile.collide;
+	sample.stageTimes[jitterSolve] = profile.solve;
+	sample.stageTimes[jitterSplitIslands] = profile.splitIslands;
+	sample.stageTimes[jitterTransforms] = profile.transforms;
+	sample.stageTimes[jitterRefit] = profile.refit;
+	sample.stageTimes[jitterSleepIslands] = profile.sleepIslands;
+	sample.stageTimes[jitterSensors] = profile.sensors;
+	sample.runIndex = runIndex;
+	sample.stepIndex = stepIndex;
+	sample.splitIslandCount = counters.splitIslandCount;
+	sample.wokenSetCount = counters.wokenSetCount;
+	sample.stackGrowth = counters.stackGrowth;
+	sample.rebuiltLeafCount = counters.rebuiltLeafCount;
+
+	// Tree rebuilds are marked by the report because the partial rebuild sorts some leaves every step
+	sample.causes = 0;
+	sample.causes |= counters.splitIslandCount > 0 ? causeSplit : 0;
+	sample.causes |= counters.wokenSetCount > 0 ? causeWake : 0;
+	sample.causes |= counters.stackGrowth > 0 ? causeStack : 0;
+	return sample;
+}
+
+// Nearest rank percentile of sorted values
+static float GetPercentile( const float* sortedValues, int count, float percent )
+{
+	int rank = (int)ceilf( 0.01f * percent * count );
+	return sortedValues[b2ClampInt( rank - 1, 0, count - 1 )];
+}
+
+// Percentiles of every stage over all steps of all runs, then how often each cause shows up in the steps
+// at or above the p99 step time compared to all steps. A tree rebuild counts when it sorts more than twice
+// the median number of leaves. Writes every step to <benchmark>_t<threads>_jitter.csv.
+static void WriteJitterReport( const char* name, int threadCount, JitterSample* samples, int sampleCount )
+{
+	if ( sampleCount == 0 )
+	{
+		return;
+	}
+
+	float* values = malloc( sampleCount * sizeof( float ) );
+	float p99Step = 0.0f;
+
+	// Median leaves sorted by the tree rebuild
+	for ( int i = 0; i < sampleCount; ++i )
+	{
+		values[i] = (float)samples[i].rebuiltLeafCount;
+	}
+
+	qsort( values, sampleCount, sizeof( float ), CompareFloats );
+	float medianLeafCount = GetPercentile( values, sampleCount, 50.0f );
+
+	for ( int i = 0; i < sampleCount; ++i )
+	{
+		samples[i].causes |= samples[i].rebuiltLeafCount > 2.0f * medianLeafCount ? causeTree : 0;
+	}
+
+	printf( "jitter t%d: %d steps\n", threadCount, sampleCount );
+	printf( "  %-14s %9s %9s %9s %9s (ms)\n", "stage", "p50", "p90", "p99", "max" );
+	for ( int stage = 0; stage < jitterStageCount; ++stage )
+	{
+		for ( int i = 0; i < sampleCount; ++i )
+		{
+			values[i] = samples[i].stageTimes[stage];
+		}
+
+		qsort( values, sampleCount, sizeof( float ), CompareFloats );
+
+		float p99 = GetPercentile( values, sampleCount, 99.0f );
+		printf( "  %-14s %9.3f %9.3f %9.3f %9.3f\n", s_jitterStageNames[stage], GetPercentile( values, sampleCount, 50.0f ),
+				GetPercentile( values, sampleCount, 90.0f ), p99, values[sampleCount - 1] );
+
+		if ( stage == jitterStep )
+		{
+			p99Step = p99;
+		}
+	}
+
+	free( values );
+
+	int tailCount = 0;
+	int tailCauses[JITTER_CAUSE_COUNT] = { 0 };
+	int allCauses[JITTER_CAUSE_COUNT] = { 0 };
+	for ( int i = 0; i < sampleCount; ++i )
+	{
+		bool tail = samples[i].stageTimes[jitterStep] >= p99Step;
+		tailCount += tail ? 1 : 0;
+
+		for ( int cause = 0; cause < JITTER_CAUSE_COUNT; ++cause )
+		{
+			bool hasCause = ( samples[i].causes & ( 1 << cause ) ) != 0;
+			allCauses[cause] += hasCause ? 1 : 0;
+			tailCauses[cause] += hasCause && tail ? 1 : 0;
+		}
+	}
+
+	printf( "  causes of the %d steps at or above p99 (share of all steps):", tailCount );
+	for ( int cause = 0; cause < JITTER_CAUSE_COUNT; ++cause )
+	{
+		printf( " %s %.0f%% (%.0f%%)", s_jitterCauseNames[cause], 100.0f * tailCauses[cause] / tailCount,
+				100.0f * allCauses[cause] / sampleCount );
+	}
+	printf( "\n" );
+
+	char fileName[64] = { 0 };
+	snprintf( fileName, 64, "%s_t%d_jitter.csv", name, threadCount );
+	FILE* file = fopen( fileName, "w" );
+	if ( file == NULL )
+	{
+		return;
+	}
+
+	fprintf( file, "run,step_index" );
+	for ( int stage = 0; stage < jitterStageCount; ++stage )
+	{
+		fprintf( file, ",%s", s_jitterStageNames[stage] );
+	}
+	fprintf( file, ",islands_split,woken_sets,stack_growth,rebuilt_leaves,causes\n" );
+
+	for ( int i = 0; i < sampleCount; ++i )
+	{
+		const JitterSample* sample = samples + i;
+		fprintf( file, "%d,%d", sample->runIndex, sample->stepIndex );
+		for ( int stage = 0; stage < jitterStageCount; ++stage )
+		{
+			fprintf( file, ",%g", sample->stageTimes[stage] );
+		}
+
+		fprintf( file, ",%d,%d,%d,%d,", sample->splitIslandCount, sample->wokenSetCount, sample->stackGrowth,
+				 sample->rebuiltLeafCount );
+
+		// Causes as a list such as split+wake
+		bool first = true;
+		for ( int cause = 0; cause < JITTER_CAUSE_COUNT; ++cause )
+		{
+			if ( sample->causes & ( 1 << cause ) )
+			{
+				fprintf( file, "%s%s", first ? "" : "+", s_jitterCauseNames[cause] );
+				first = false;
+			}
+		}
+		fprintf( file, "\n" );
+	}
+
+	fclose( file );
+}
+
+// Box2D benchmark application. It is important to use affinity avoid cross CCD
+// usage or efficiency cores. Use -l3 to let Box2D pin the workers to the cache domain of the main
+// thread or -a=<hex mask> to pin them explicitly. Alternatively use start /affinity on Windows.
+// Also on Windows create a power plan with Processor power management
 // Min/Max of 99%. This prevents boosting and makes the benchmarks more repeatable.
 // Affinity [0x01 0x02 0x04 0x08 0x10 0x20 0x40 0x80]
 
+// Run all benchmarks with 1 to 8 threads pinned to one L3 cache domain.
+// .\build\bin\Release\benchmark.exe -t=8 -l3
+
 // Run all benchmarks with 1 to 8 threads.
 // start /affinity 0x5555 .\build\bin\Release\benchmark.exe -t=8
 
@@ -65,6 +535,138 @@ static void MinProfile( b2Profile* p1, const b2Profile* p2 )
 // Run benchmark 3 with 4 workers and run once. Disable continuous collision. Record the step times.
 // start /affinity 0x5555 .\build\bin\Release\benchmark.exe -t=4 -w=4 -b=3 -r=1 -nc -s
 
+// Compare to stored results with 10 repeats. Exits with 1 if any benchmark is significantly slower than the
+// baseline. The tolerance is the relative slowdown allowed, 5% by default.
+// taskset 0x5555 ./build/bin/benchmark -t=8 -r=10 -c=benchmark/amd7950x_avx2 -tol=0.05
+
+// Run all benchmarks with 1 to 8 threads and record hardware counters (Linux only). Writes <benchmark>_pmu.csv
+// to show whether a regression is compute bound or memory bound. May need kernel.perf_event_paranoid <= 2.
+// taskset 0x5555 ./build/bin/benchmark -t=8 -p
+
+// Run benchmark 3 with 1 to 32 threads and report the scaling of each stage. Writes <benchmark>_scaling.csv.
+// The per worker profile reads the timer in each solver stage, so the times are slightly higher.
+// ./build/bin/benchmark -t=32 -b=3 -r=5 -scale
+
+// Run benchmark 5 once with 1 worker and save the recorded input to rain.b2rec. Then replay the recording
+// with 1 to 8 threads. The replay prints the state hash of each run, which must not change.
+// ./build/bin/benchmark -t=1 -b=5 -r=1 -record
+// ./build/bin/benchmark -t=8 -replay=rain.b2rec
+
+// Run benchmark 2 with 4 workers and report the p50/p90/p99/max of each stage over all steps of 20 repeats.
+// Steps with island splits, wakes, stack growth or large tree rebuilds are marked in <benchmark>_t4_jitter.csv.
+// ./build/bin/benchmark -t=4 -w=4 -b=2 -r=20 -j
+
+// Writes the recording of a world to <name>.b2rec
+static void WriteRecording( b2WorldId worldId, const char* name )
+{
+	int size = b2World_GetRecordingSize( worldId );
+	void* data = malloc( size );
+	if ( b2World_GetRecording( worldId, data, size ) == 0 )
+	{
+		free( data );
+		return;
+	}
+
+	char fileName[64] = { 0 };
+	snprintf( fileName, 64, "%s.b2rec", name );
+	FILE* file = fopen( fileName, "wb" );
+	if ( file != NULL )
+	{
+		fwrite( data, 1, size, file );
+		fclose( file );
+		printf( "recording: %s, %d bytes\n", fileName, size );
+	}
+
+	free( data );
+}
+
+// Replays a recording with each thread count. The user step functions and scene setup are part of the
+// recording, so the timing only covers Box2D. Returns false if a replay fails or the final state differs.
+static bool ReplayRecording( const char* path, int maxThreadCount, int singleWorkerCount, int runCount,
+							 uint64_t affinityMask, bool enableCacheAffinity )
+{
+	FILE* file = fopen( path, "rb" );
+	if ( file == NULL )
+	{
+		printf( "replay: cannot open %s\n", path );
+		return false;
+	}
+
+	fseek( file, 0, SEEK_END );
+	long size = ftell( file );
+	fseek( file, 0, SEEK_SET );
+
+	void* data = malloc( size > 0 ? size : 1 );
+	size_t readCount = size > 0 ? fread( data, 1, size, file ) : 0;
+	fclose( file );
+
+	if ( size <= 0 || readCount != (size_t)size )
+	{
+		printf( "replay: cannot read %s\n", path );
+		free( data );
+		return false;
+	}
+
+	printf( "replay: %s, %ld bytes\n", path, size );
+
+	bool success = true;
+	bool hashValid = false;
+	uint32_t firstHash = 0;
+
+	for ( int threadCount = 1; threadCount <= maxThreadCount && success; ++threadCount )
+	{
+		if ( singleWorkerCount != -1 && singleWorkerCount != threadCount )
+		{
+			continue;
+		}
+
+		printf( "thread count: %d\n", threadCount );
+
+		for ( int runIndex = 0; runIndex < runCount; ++runIndex )
+		{
+			b2WorldDef worldDef = b2DefaultWorldDef();
+			worldDef.workerCount = threadCount;
+			worldDef.workerAffinityMask = affinityMask;
+			worldDef.enableCacheAffinity = enableCacheAffinity;
+			b2WorldId worldId = b2CreateReplayWorld( data, (int)size, &worldDef );
+			if ( B2_IS_NULL( worldId ) )
+			{
+				printf( "replay: %s was not recorded by this build\n", path );
+				success = false;
+				break;
+			}
+
+			// The first step builds the contacts and can skew the benchmark
+			int stepCount = b2World_ReplayStep( worldId ) ? 1 : 0;
+
+			uint64_t ticks = b2GetTicks();
+
+			while ( b2World_ReplayStep( worldId ) )
+			{
+				stepCount += 1;
+			}
+
+			float ms = b2GetMilliseconds( ticks );
+			uint32_t hash = b2World_ComputeStateHash( worldId, false );
+			printf( "run %d : %g (ms), steps = %d, hash = 0x%08x\n", runIndex, ms, stepCount, hash );
+
+			if ( hashValid && hash != firstHash )
+			{
+				printf( "replay: state differs from the first run\n" );
+				success = false;
+			}
+
+			firstHash = hash;
+			hashValid = true;
+
+			b2DestroyWorld( worldId );
+		}
+	}
+
+	free( data );
+	return success;
+}
+
 int main( int argc, char** argv )
 {
 #ifdef TRACY_ENABLE
@@ -82,6 +684,11 @@ int main( int argc, char** argv )
 		{ "spinner", CreateSpinner, StepSpinner, 500 },
 		{ "tumbler", CreateTumbler, NULL, 750 },
 		{ "washer", CreateWasher, NULL, 500 },
+		{ "sleepy_world", CreateSleepyWorld, StepSleepyWorld, 200 },
+		{ "trigger_field", CreateTriggerField, StepTriggerField, 500 },
+		{ "ragdolls", CreateRagdolls, StepRagdolls, 500 },
+		{ "open_world", CreateOpenWorld, NULL, 500 },
+		{ "churn", CreateChurn, StepChurn, 500 },
 	};
 
 	int benchmarkCount = ARRAY_COUNT( benchmarks );
@@ -111,6 +718,7 @@ int main( int argc, char** argv )
 		.transforms = FLT_MAX,
 		.hitEvents = FLT_MAX,
 		.refit = FLT_MAX,
+		.optimizeTrees = FLT_MAX,
 		.bullets = FLT_MAX,
 		.sleepIslands = FLT_MAX,
 	};
@@ -131,6 +739,18 @@ int main( int argc, char** argv )
 	b2Counters counters = { 0 };
 	bool enableContinuous = true;
 	bool recordStepTimes = false;
+	bool enableCacheAffinity = false;
+	bool enablePerfCounters = false;
+	bool perfWarned = false;
+	bool enableScaling = false;
+	bool enableJitter = false;
+	bool enableRecording = false;
+	const char* replayPath = NULL;
+	const char* baselineFolder = NULL;
+	float tolerance = 0.05f;
+	int regressionCount = 0;
+	uint64_t affinityMask = 0;
+	int prefetchDistance = b2DefaultWorldDef().contactPrefetchDistance;
 
 	for ( int i = 1; i < argc; ++i )
 	{
@@ -158,10 +778,50 @@ int main( int argc, char** argv )
 			enableContinuous = false;
 			printf( "Continuous disabled\n" );
 		}
+		else if ( strncmp( arg, "-a=", 3 ) == 0 )
+		{
+			affinityMask = strtoull( arg + 3, NULL, 16 );
+		}
+		else if ( strcmp( arg, "-l3" ) == 0 )
+		{
+			enableCacheAffinity = true;
+		}
+		else if ( strncmp( arg, "-pf=", 4 ) == 0 )
+		{
+			prefetchDistance = b2MaxInt( atoi( arg + 4 ), 0 );
+		}
 		else if ( strncmp( arg, "-s", 3 ) == 0 )
 		{
 			recordStepTimes = true;
 		}
+		else if ( strcmp( arg, "-p" ) == 0 )
+		{
+			enablePerfCounters = true;
+		}
+		else if ( strcmp( arg, "-scale" ) == 0 )
+		{
+			enableScaling = true;
+		}
+		else if ( strcmp( arg, "-j" ) == 0 )
+		{
+			enableJitter = true;
+		}
+		else if ( strcmp( arg, "-record" ) == 0 )
+		{
+			enableRecording = true;
+		}
+		else if ( strncmp( arg, "-replay=", 8 ) == 0 )
+		{
+			replayPath = arg + 8;
+		}
+		else if ( strncmp( arg, "-c=", 3 ) == 0 )
+		{
+			baselineFolder = arg + 3;
+		}
+		else if ( strncmp( arg, "-tol=", 5 ) == 0 )
+		{
+			tolerance = b2MaxFloat( (float)atof( arg + 5 ), 0.0f );
+		}
 		else if ( strcmp( arg, "-h" ) == 0 )
 		{
 			printf( "Usage\n"
@@ -169,7 +829,17 @@ int main( int argc, char** argv )
 					"-b=<integer>: run a single benchmark\n"
 					"-w=<integer>: run a single worker count\n"
 					"-r=<integer>: number of repeats (default is 4)\n"
-					"-s: record step times\n" );
+					"-s: record step times\n"
+					"-p: record hardware performance counters\n"
+					"-scale: report speedup, efficiency and load imbalance of each stage\n"
+					"-j: report step time percentiles and the causes of slow steps\n"
+					"-record: save the input of the first run of each benchmark to <benchmark>.b2rec\n"
+					"-replay=<file>: time the replay of a recording instead of running the benchmarks\n"
+					"-c=<folder>: compare to the results in a folder and fail on significant slowdowns\n"
+					"-tol=<float>: relative slowdown allowed by the comparison (default is 0.05)\n"
+					"-a=<hex>: worker affinity mask\n"
+					"-l3: pin workers to the L3 cache domain of the main thread\n"
+					"-pf=<integer>: contact solver prefetch distance, zero disables prefetching\n" );
 			exit( 0 );
 		}
 	}
@@ -179,6 +849,19 @@ int main( int argc, char** argv )
 		singleWorkerCount = b2ClampInt( singleWorkerCount, 1, maxThreadCount );
 	}
 
+	if ( replayPath != NULL )
+	{
+		bool success = ReplayRecording( replayPath, maxThreadCount, singleWorkerCount, runCount, affinityMask,
+										enableCacheAffinity );
+		free( profiles );
+		free( stepResults );
+
+#ifdef TRACY_ENABLE
+		___tracy_shutdown_profiler();
+#endif
+		return success ? 0 : 1;
+	}
+
 	printf( "Starting Box2D benchmarks\n" );
 	printf( "======================================\n" );
 
@@ -198,10 +881,19 @@ int main( int argc, char** argv )
 		Benchmark* benchmark = benchmarks + benchmarkIndex;
 
 		bool countersAcquired = false;
+		bool recorded = false;
 
 		printf( "benchmark: %s, steps = %d\n", benchmarks[benchmarkIndex].name, stepCount );
 
 		float minTime[B2_MAX_WORKERS] = { 0 };
+		RunStats runStats[B2_MAX_WORKERS] = { 0 };
+		float* runTimes = malloc( runCount * sizeof( float ) );
+		ScalingSample scalingSamples[B2_MAX_WORKERS] = { 0 };
+		JitterSample* jitterSamples = enableJitter ? malloc( runCount * stepCount * sizeof( JitterSample ) ) : NULL;
+
+		// Hardware counters of the fastest run
+		uint64_t perfValues[B2_MAX_WORKERS][perfCounterCount] = { 0 };
+		bool perfValid = false;
 
 		for ( int threadCount = 1; threadCount <= maxThreadCount; ++threadCount )
 		{
@@ -211,15 +903,33 @@ int main( int argc, char** argv )
 			}
 
 			printf( "thread count: %d\n", threadCount );
+			int jitterSampleCount = 0;
 
 			for ( int runIndex = 0; runIndex < runCount; ++runIndex )
 			{
+				// Opened before the world so the worker threads are counted
+				PerfCounters perfCounters = { 0 };
+				if ( enablePerfCounters )
+				{
+					perfValid = OpenPerfCounters( &perfCounters );
+					if ( perfValid == false && perfWarned == false )
+					{
+						printf( "Hardware counters are not available\n" );
+						perfWarned = true;
+					}
+				}
+
 				b2WorldDef worldDef = b2DefaultWorldDef();
 				worldDef.enableContinuous = enableContinuous;
 				worldDef.workerCount = threadCount;
+				worldDef.workerAffinityMask = affinityMask;
+				worldDef.enableCacheAffinity = enableCacheAffinity;
+				worldDef.contactPrefetchDistance = prefetchDistance;
+				worldDef.enableRecording = enableRecording && recorded == false;
 				b2WorldId worldId = b2CreateWorld( &worldDef );
 
 				benchmark->createFcn( worldId );
+				b2World_EnableWorkerProfile( worldId, enableScaling );
 
 				float timeStep = 1.0f / 60.0f;
 				int subStepCount = 4;
@@ -237,6 +947,7 @@ int main( int argc, char** argv )
 				b2Profile profile = b2World_GetProfile( worldId );
 				MinProfile( profiles + 0, &profile );
 
+				StartPerfCounters( &perfCounters );
 				uint64_t ticks = b2GetTicks();
 
 				for ( int stepIndex = 1; stepIndex < stepCount; ++stepIndex )
@@ -249,18 +960,29 @@ int main( int argc, char** argv )
 					b2World_Step( worldId, timeStep, subStepCount );
 					profile = b2World_GetProfile( worldId );
 					MinProfile( profiles + stepIndex, &profile );
+
+					if ( enableScaling )
+					{
+						AccumulateScaling( scalingSamples + threadCount - 1, worldId, threadCount );
+					}
+
+					if ( enableJitter )
+					{
+						jitterSamples[jitterSampleCount++] = GetJitterSample( worldId, runIndex, stepIndex );
+					}
 				}
 
 				float ms = b2GetMilliseconds( ticks );
 				printf( "run %d : %g (ms)\n", runIndex, ms );
+				runTimes[runIndex] = ms;
+
+				uint64_t values[perfCounterCount];
+				StopPerfCounters( &perfCounters, values );
 
-				if ( runIndex == 0 )
+				if ( runIndex == 0 || ms < minTime[threadCount - 1] )
 				{
 					minTime[threadCount - 1] = ms;
-				}
-				else
-				{
-					minTime[threadCount - 1] = b2MinFloat( minTime[threadCount - 1], ms );
+					memcpy( perfValues[threadCount - 1], values, sizeof( values ) );
 				}
 
 				if ( countersAcquired == false )
@@ -269,7 +991,22 @@ int main( int argc, char** argv )
 					countersAcquired = true;
 				}
 
+				if ( worldDef.enableRecording )
+				{
+					WriteRecording( worldId, benchmark->name );
+					recorded = true;
+				}
+
 				b2DestroyWorld( worldId );
+
+				ClosePerfCounters( &perfCounters );
+			}
+
+			runStats[threadCount - 1] = ComputeRunStats( runTimes, runCount );
+
+			if ( enableJitter )
+			{
+				WriteJitterReport( benchmark->name, threadCount, jitterSamples, jitterSampleCount );
 			}
 
 			if ( recordStepTimes )
@@ -293,6 +1030,9 @@ int main( int argc, char** argv )
 			}
 		}
 
+		free( runTimes );
+		free( jitterSamples );
+
 		printf( "body %d / shape %d / contact %d / joint %d / stack %d\n", counters.bodyCount, counters.shapeCount,
 				counters.contactCount, counters.jointCount, counters.stackUsed );
 		printf( "color counts:" );
@@ -302,6 +1042,39 @@ int main( int argc, char** argv )
 		}
 		printf( "\n\n" );
 
+		if ( enableScaling )
+		{
+			WriteScalingReport( benchmark->name, runStats, scalingSamples, maxThreadCount );
+		}
+
+		Baseline baseline;
+		if ( baselineFolder != NULL && LoadBaseline( &baseline, baselineFolder, benchmark->name ) )
+		{
+			for ( int threadIndex = 1; threadIndex <= maxThreadCount; ++threadIndex )
+			{
+				int index = threadIndex - 1;
+				bool measured = singleWorkerCount == -1 || singleWorkerCount == threadIndex;
+				if ( measured == false || baseline.valid[index] == false )
+				{
+					continue;
+				}
+
+				RunStats* current = runStats + index;
+				RunStats* base = baseline.stats + index;
+				float baseTime = baseline.hasMedian[index] ? base->median : base->min;
+				bool regression = IsRegression( current, base, baseline.hasMedian[index], tolerance );
+				regressionCount += regression ? 1 : 0;
+
+				printf( "compare %s t%d: median %g [%g, %g] vs %g (%+.1f%%)%s\n", benchmark->name, threadIndex,
+						current->median, current->low, current->high, baseTime,
+						100.0f * ( current->median / baseTime - 1.0f ), regression ? " REGRESSION" : "" );
+			}
+		}
+		else if ( baselineFolder != NULL )
+		{
+			printf( "compare %s: no baseline\n", benchmark->name );
+		}
+
 		char fileName[64] = { 0 };
 		snprintf( fileName, 64, "%s.csv", benchmarks[benchmarkIndex].name );
 		FILE* file = fopen( fileName, "w" );
@@ -310,10 +1083,47 @@ int main( int argc, char** argv )
 			continue;
 		}
 
-		fprintf( file, "threads,ms\n" );
+		// The run statistics follow the fastest run so older readers still work
+		fprintf( file, "threads,ms,median,low,high\n" );
 		for ( int threadIndex = 1; threadIndex <= maxThreadCount; ++threadIndex )
 		{
-			fprintf( file, "%d,%g\n", threadIndex, minTime[threadIndex - 1] );
+			RunStats* stats = runStats + threadIndex - 1;
+			fprintf( file, "%d,%g,%g,%g,%g\n", threadIndex, minTime[threadIndex - 1], stats->median, stats->low,
+					 stats->high );
+		}
+
+		fclose( file );
+
+		if ( perfValid == false )
+		{
+			continue;
+		}
+
+		snprintf( fileName, 64, "%s_pmu.csv", benchmarks[benchmarkIndex].name );
+		file = fopen( fileName, "w" );
+		if ( file == NULL )
+		{
+			continue;
+		}
+
+		fprintf( file, "threads,ms" );
+		for ( int i = 0; i < perfCounterCount; ++i )
+		{
+			fprintf( file, ",%s", g_perfCounterNames[i] );
+		}
+		fprintf( file, ",ipc\n" );
+
+		for ( int threadIndex = 1; threadIndex <= maxThreadCount; ++threadIndex )
+		{
+			uint64_t* values = perfValues[threadIndex - 1];
+			fprintf( file, "%d,%g", threadIndex, minTime[threadIndex - 1] );
+			for ( int i = 0; i < perfCounterCount; ++i )
+			{
+				fprintf( file, ",%llu", (unsigned long long)values[i] );
+			}
+
+			double cycles = (double)values[perfCycles];
+			fprintf( file, ",%g\n", cycles > 0.0 ? (double)values[perfInstructions] / cycles : 0.0 );
 		}
 
 		fclose( file );
@@ -322,11 +1132,16 @@ int main( int argc, char** argv )
 	printf( "======================================\n" );
 	printf( "All Box2D benchmarks complete!\n" );
 
+	if ( regressionCount > 0 )
+	{
+		printf( "%d significant slowdowns compared to %s\n", regressionCount, baselineFolder );
+	}
+
 	free( profiles );
 	free( stepResults );
 
 #ifdef TRACY_ENABLE
 	___tracy_shutdown_profiler();
 #endif
-	return 0;
+	return regressionCount > 0 ? 1 : 0;
 }
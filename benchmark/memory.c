@@ -0,0 +1,323 @@
+// SPDX-FileCopyrightText: 2025 Erin Catto
+// SPDX-License-Identifier: MIT
+
+// Memory footprint benchmark. Builds scenes at several sizes and reports the heap held by the world and
+// the marginal bytes per body, shape, contact and joint. The marginal cost is the slope between the
+// smallest and the largest size, so it includes container growth but not fixed costs.
+
+#if defined( _MSC_VER ) && !defined( _CRT_SECURE_NO_WARNINGS )
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "box2d/box2d.h"
+#include "box2d/math_functions.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined( _MSC_VER )
+#include <malloc.h>
+#endif
+
+#define ARRAY_COUNT( A ) (int)( sizeof( A ) / sizeof( A[0] ) )
+#define MAX_SIZE_COUNT 8
+
+typedef void CreateFcn( b2WorldId worldId, int bodyCount );
+
+typedef struct Scene
+{
+	const char* name;
+	CreateFcn* createFcn;
+} Scene;
+
+// Measured after the scene has run for a few steps
+typedef struct Footprint
+{
+	b2Counters counters;
+	b2MemoryStats stats;
+	int64_t heapBytes;
+	int64_t peakBytes;
+} Footprint;
+
+static int64_t s_byteCount;
+static int64_t s_peakByteCount;
+
+static void* CountingAlloc( unsigned int size, int alignment )
+{
+	s_byteCount += size;
+	s_peakByteCount = s_byteCount > s_peakByteCount ? s_byteCount : s_peakByteCount;
+
+#if defined( _MSC_VER )
+	return _aligned_malloc( size, alignment );
+#else
+	size_t roundedSize = ( (size_t)size + alignment - 1 ) & ~( (size_t)alignment - 1 );
+	return aligned_alloc( alignment, roundedSize );
+#endif
+}
+
+static void CountingFree( void* mem, unsigned int size )
+{
+	s_byteCount -= size;
+
+#if defined( _MSC_VER )
+	_aligned_free( mem );
+#else
+	free( mem );
+#endif
+}
+
+// Columns of boxes resting on the ground. About two contacts per body.
+static void CreateBoxes( b2WorldId worldId, int bodyCount )
+{
+	int columnCount = 100;
+	float width = 1.0f * columnCount;
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Segment segment = { { -1.0f, 0.0f }, { width + 1.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeSquare( 0.45f );
+
+	for ( int i = 0; i < bodyCount; ++i )
+	{
+		bodyDef.position = (b2Vec2){ 1.0f * ( i % columnCount ) + 0.5f, 0.5f + 0.95f * ( i / columnCount ) };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyId, &shapeDef, &box );
+	}
+}
+
+// Hanging chains of capsules linked with revolute joints. About one joint per body and few contacts.
+static void CreateJointChains( b2WorldId worldId, int bodyCount )
+{
+	int linkCount = 50;
+	int chainCount = ( bodyCount + linkCount - 1 ) / linkCount;
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Capsule capsule = { { -0.25f, 0.0f }, { 0.25f, 0.0f }, 0.125f };
+
+	int index = 0;
+	for ( int i = 0; i < chainCount && index < bodyCount; ++i )
+	{
+		float x = 2.0f * i;
+		b2BodyId prevId = groundId;
+
+		for ( int j = 0; j < linkCount && index < bodyCount; ++j, ++index )
+		{
+			bodyDef.type = b2_dynamicBody;
+			bodyDef.position = (b2Vec2){ x + 0.5f + j, 100.0f };
+			b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+			b2CreateCapsuleShape( bodyId, &shapeDef, &capsule );
+
+			b2Vec2 pivot = { x + j, 100.0f };
+			b2RevoluteJointDef jointDef = b2DefaultRevoluteJointDef();
+			jointDef.base.bodyIdA = prevId;
+			jointDef.base.bodyIdB = bodyId;
+			jointDef.base.localFrameA.p = b2Body_GetLocalPoint( prevId, pivot );
+			jointDef.base.localFrameB.p = b2Body_GetLocalPoint( bodyId, pivot );
+			b2CreateRevoluteJoint( worldId, &jointDef );
+
+			prevId = bodyId;
+		}
+	}
+}
+
+static Footprint Measure( const Scene* scene, int bodyCount, int stepCount )
+{
+	s_byteCount = 0;
+	s_peakByteCount = 0;
+
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+	scene->createFcn( worldId, bodyCount );
+
+	for ( int i = 0; i < stepCount; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	Footprint footprint;
+	footprint.counters = b2World_GetCounters( worldId );
+	footprint.stats = b2World_GetMemoryStats( worldId );
+	footprint.heapBytes = s_byteCount;
+	footprint.peakBytes = s_peakByteCount;
+
+	b2DestroyWorld( worldId );
+	return footprint;
+}
+
+static int SumColors( const b2MemoryStats* stats )
+{
+	int sum = 0;
+	for ( int i = 0; i < ARRAY_COUNT( stats->colors ); ++i )
+	{
+		sum += stats->colors[i];
+	}
+	return sum;
+}
+
+static int SumTrees( const b2MemoryStats* stats )
+{
+	int sum = 0;
+	for ( int i = 0; i < ARRAY_COUNT( stats->trees ); ++i )
+	{
+		sum += stats->trees[i];
+	}
+	return sum;
+}
+
+static float Slope( int64_t bytes1, int64_t bytes2, int count1, int count2 )
+{
+	return count2 > count1 ? (float)( bytes2 - bytes1 ) / (float)( count2 - count1 ) : 0.0f;
+}
+
+// Measure the default sizes.
+// ./build/bin/memory_benchmark
+// Measure up to 256k bodies.
+// ./build/bin/memory_benchmark -n=262144
+int main( int argc, char** argv )
+{
+	Scene scenes[] = {
+		{ "boxes", CreateBoxes },
+		{ "joint_chains", CreateJointChains },
+	};
+
+	int sceneCount = ARRAY_COUNT( scenes );
+	int maxBodyCount = 65536;
+	int stepCount = 30;
+	int singleScene = -1;
+
+	for ( int i = 1; i < argc; ++i )
+	{
+		const char* arg = argv[i];
+		if ( strncmp( arg, "-n=", 3 ) == 0 )
+		{
+			maxBodyCount = b2ClampInt( atoi( arg + 3 ), 1024, 16 * 1024 * 1024 );
+		}
+		else if ( strncmp( arg, "-b=", 3 ) == 0 )
+		{
+			singleScene = b2ClampInt( atoi( arg + 3 ), 0, sceneCount - 1 );
+		}
+		else if ( strncmp( arg, "-steps=", 7 ) == 0 )
+		{
+			stepCount = b2ClampInt( atoi( arg + 7 ), 1, 10000 );
+		}
+		else if ( strcmp( arg, "-h" ) == 0 )
+		{
+			printf( "Usage\n"
+					"-n=<integer>: largest body count, sizes go up by 4x from 1024 (default is 65536)\n"
+					"-b=<integer>: run a single scene (0 boxes, 1 joint chains)\n"
+					"-steps=<integer>: steps before measuring (default is 30)\n" );
+			exit( 0 );
+		}
+	}
+
+	int sizes[MAX_SIZE_COUNT];
+	int sizeCount = 0;
+	for ( int size = 1024; size <= maxBodyCount && sizeCount < MAX_SIZE_COUNT; size *= 4 )
+	{
+		sizes[sizeCount++] = size;
+	}
+
+	b2SetAllocator( CountingAlloc, CountingFree );
+
+	printf( "Starting Box2D memory benchmark\n" );
+	printf( "======================================\n" );
+
+	b2ObjectSizes objectSizes = b2GetObjectSizes();
+	printf( "object sizes in bytes\n" );
+	printf( "  body %d, body sim %d, body state %d, shape %d, chain %d\n", objectSizes.body, objectSizes.bodySim,
+			objectSizes.bodyState, objectSizes.shape, objectSizes.chain );
+	printf( "  contact %d, contact sim %d, compact contact sim %d, joint %d, joint sim %d\n", objectSizes.contact,
+			objectSizes.contactSim, objectSizes.compactContactSim, objectSizes.joint, objectSizes.jointSim );
+	printf( "  island %d, island sim %d, sensor %d, tree node %d\n\n", objectSizes.island, objectSizes.islandSim,
+			objectSizes.sensor, objectSizes.treeNode );
+
+	FILE* file = fopen( "memory.csv", "w" );
+	if ( file != NULL )
+	{
+		fprintf( file, "scene,bodies,shapes,contacts,joints,heap,peak,world,object_arrays,islands,trees,pair_set,body_sims,"
+					   "body_states,contact_sims,joint_sims,colors,stack_max,arena_max\n" );
+	}
+
+	for ( int sceneIndex = 0; sceneIndex < sceneCount; ++sceneIndex )
+	{
+		if ( singleScene != -1 && sceneIndex != singleScene )
+		{
+			continue;
+		}
+
+		const Scene* scene = scenes + sceneIndex;
+		printf( "scene: %s\n", scene->name );
+		printf( "   bodies   shapes contacts   joints    heap MB    peak MB  stack max KB\n" );
+
+		Footprint footprints[MAX_SIZE_COUNT];
+		for ( int sizeIndex = 0; sizeIndex < sizeCount; ++sizeIndex )
+		{
+			Footprint* f = footprints + sizeIndex;
+			*f = Measure( scene, sizes[sizeIndex], stepCount );
+
+			const b2Counters* c = &f->counters;
+			const b2MemoryStats* s = &f->stats;
+			printf( "%9d %8d %8d %8d %10.2f %10.2f %13.1f\n", c->bodyCount, c->shapeCount, c->contactCount, c->jointCount,
+					f->heapBytes / ( 1024.0 * 1024.0 ), f->peakBytes / ( 1024.0 * 1024.0 ), s->stackMaxAllocation / 1024.0 );
+
+			if ( file != NULL )
+			{
+				fprintf( file, "%s,%d,%d,%d,%d,%lld,%lld,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d\n", scene->name, c->bodyCount,
+						 c->shapeCount, c->contactCount, c->jointCount, (long long)f->heapBytes, (long long)f->peakBytes,
+						 s->totalBytes, s->objectArrays, s->islands, SumTrees( s ), s->pairSet, s->bodySims, s->bodyStates,
+						 s->contactSims, s->jointSims, SumColors( s ), s->stackMaxAllocation, s->arenaMaxAllocation );
+			}
+		}
+
+		if ( sizeCount < 2 )
+		{
+			printf( "\n" );
+			continue;
+		}
+
+		const Footprint* a = footprints + 0;
+		const Footprint* b = footprints + sizeCount - 1;
+		int bodies1 = a->counters.bodyCount, bodies2 = b->counters.bodyCount;
+		int shapes1 = a->counters.shapeCount, shapes2 = b->counters.shapeCount;
+		int contacts1 = a->counters.contactCount, contacts2 = b->counters.contactCount;
+		int joints1 = a->counters.jointCount, joints2 = b->counters.jointCount;
+
+		printf( "marginal bytes\n" );
+		printf( "  heap per body           %8.1f\n", Slope( a->heapBytes, b->heapBytes, bodies1, bodies2 ) );
+		printf( "  peak heap per body      %8.1f\n", Slope( a->peakBytes, b->peakBytes, bodies1, bodies2 ) );
+		printf( "  body sims per body      %8.1f\n", Slope( a->stats.bodySims, b->stats.bodySims, bodies1, bodies2 ) );
+		printf( "  body states per body    %8.1f\n", Slope( a->stats.bodyStates, b->stats.bodyStates, bodies1, bodies2 ) );
+		printf( "  islands per body        %8.1f\n", Slope( a->stats.islands + a->stats.islandSims,
+															b->stats.islands + b->stats.islandSims, bodies1, bodies2 ) );
+		printf( "  trees per shape         %8.1f\n", Slope( SumTrees( &a->stats ), SumTrees( &b->stats ), shapes1, shapes2 ) );
+		printf( "  pair set per contact    %8.1f\n", Slope( a->stats.pairSet, b->stats.pairSet, contacts1, contacts2 ) );
+
+		// Awake contact and joint sims are stored in the graph colors, the others in the solver sets.
+		// Arrays keep the capacity of the busiest step, so transient contacts show up here.
+
+		int64_t sims1 = a->stats.contactSims + a->stats.jointSims + SumColors( &a->stats );
+		int64_t sims2 = b->stats.contactSims + b->stats.jointSims + SumColors( &b->stats );
+		printf( "  sims per constraint     %8.1f\n", Slope( sims1, sims2, contacts1 + joints1, contacts2 + joints2 ) );
+		printf( "  object arrays per body  %8.1f\n", Slope( a->stats.objectArrays, b->stats.objectArrays, bodies1, bodies2 ) );
+		printf( "  stack max per body      %8.1f\n\n",
+				Slope( a->stats.stackMaxAllocation, b->stats.stackMaxAllocation, bodies1, bodies2 ) );
+	}
+
+	if ( file != NULL )
+	{
+		fclose( file );
+	}
+
+	printf( "======================================\n" );
+	printf( "All Box2D memory benchmarks complete!\n" );
+
+	return 0;
+}
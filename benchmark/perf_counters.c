@@ -0,0 +1,143 @@
+// SPDX-FileCopyrightText: 2025 Erin Catto
+// SPDX-License-Identifier: MIT
+
+// Required on Linux to expose syscall. Must be defined before any system header is included.
+#if defined( __linux__ ) && !defined( _GNU_SOURCE )
+#define _GNU_SOURCE
+#endif
+
+#include "perf_counters.h"
+
+#include <string.h>
+
+const char* g_perfCounterNames[perfCounterCount] = {
+	"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses",
+};
+
+#if defined( __linux__ )
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int OpenEvent( uint32_t type, uint64_t config )
+{
+	struct perf_event_attr attr;
+	memset( &attr, 0, sizeof( attr ) );
+	attr.size = sizeof( attr );
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+
+	// Count the worker threads created later
+	attr.inherit = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	return (int)syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 );
+}
+
+bool OpenPerfCounters( PerfCounters* counters )
+{
+	uint64_t l1DataMiss = PERF_COUNT_HW_CACHE_L1D | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) |
+						  ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 );
+
+	counters->fds[perfCycles] = OpenEvent( PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES );
+	counters->fds[perfInstructions] = OpenEvent( PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS );
+	counters->fds[perfL1DataMisses] = OpenEvent( PERF_TYPE_HW_CACHE, l1DataMiss );
+	counters->fds[perfLastLevelMisses] = OpenEvent( PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES );
+	counters->fds[perfBranchMisses] = OpenEvent( PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES );
+
+	// Some events are missing on virtual machines, keep the ones that opened
+	counters->valid = false;
+	for ( int i = 0; i < perfCounterCount; ++i )
+	{
+		counters->valid = counters->valid || counters->fds[i] >= 0;
+	}
+
+	return counters->valid;
+}
+
+void ClosePerfCounters( PerfCounters* counters )
+{
+	for ( int i = 0; i < perfCounterCount && counters->valid; ++i )
+	{
+		if ( counters->fds[i] >= 0 )
+		{
+			close( counters->fds[i] );
+			counters->fds[i] = -1;
+		}
+	}
+
+	counters->valid = false;
+}
+
+void StartPerfCounters( PerfCounters* counters )
+{
+	if ( counters->valid == false )
+	{
+		return;
+	}
+
+	for ( int i = 0; i < perfCounterCount; ++i )
+	{
+		if ( counters->fds[i] >= 0 )
+		{
+			ioctl( counters->fds[i], PERF_EVENT_IOC_RESET, 0 );
+			ioctl( counters->fds[i], PERF_EVENT_IOC_ENABLE, 0 );
+		}
+	}
+}
+
+void StopPerfCounters( PerfCounters* counters, uint64_t values[perfCounterCount] )
+{
+	for ( int i = 0; i < perfCounterCount; ++i )
+	{
+		values[i] = 0;
+		if ( counters->valid && counters->fds[i] >= 0 )
+		{
+			ioctl( counters->fds[i], PERF_EVENT_IOC_DISABLE, 0 );
+
+			// Includes the inherited worker thread counts
+			uint64_t value = 0;
+			if ( read( counters->fds[i], &value, sizeof( value ) ) == sizeof( value ) )
+			{
+				values[i] = value;
+			}
+		}
+	}
+}
+
+#else
+
+// Windows exposes the PMU only through a kernel driver or an ETW session with administrator rights
+
+bool OpenPerfCounters( PerfCounters* counters )
+{
+	for ( int i = 0; i < perfCounterCount; ++i )
+	{
+		counters->fds[i] = -1;
+	}
+
+	counters->valid = false;
+	return false;
+}
+
+void ClosePerfCounters( PerfCounters* counters )
+{
+	counters->valid = false;
+}
+
+void StartPerfCounters( PerfCounters* counters )
+{
+	(void)counters;
+}
+
+void StopPerfCounters( PerfCounters* counters, uint64_t values[perfCounterCount] )
+{
+	(void)counters;
+	memset( values, 0, perfCounterCount * sizeof( uint64_t ) );
+}
+
+#endif
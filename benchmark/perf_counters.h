@@ -0,0 +1,39 @@
+// SPDX-FileCopyrightText: 2025 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum PerfCounterType
+{
+	perfCycles,
+	perfInstructions,
+	perfL1DataMisses,
+	perfLastLevelMisses,
+	perfBranchMisses,
+	perfCounterCount
+} PerfCounterType;
+
+// Hardware performance counters of the calling process. Worker threads created after the counters
+// are opened are included, so open them before creating the world.
+typedef struct PerfCounters
+{
+	int fds[perfCounterCount];
+	bool valid;
+} PerfCounters;
+
+// Returns false if the counters are not available on this platform or are not permitted.
+// Linux uses perf_event_open. Other platforms are not supported yet.
+bool OpenPerfCounters( PerfCounters* counters );
+void ClosePerfCounters( PerfCounters* counters );
+
+// Reset and start counting
+void StartPerfCounters( PerfCounters* counters );
+
+// Stop counting and read the totals. Counters that are not open read as zero.
+void StopPerfCounters( PerfCounters* counters, uint64_t values[perfCounterCount] );
+
+// Column names for CSV output
+extern const char* g_perfCounterNames[perfCounterCount];
@@ -0,0 +1,515 @@
+// SPDX-FileCopyrightText: 2025 Erin Catto
+// SPDX-License-Identifier: MIT
+
+// Benchmarks of b2DynamicTree on a few proxy distributions. Timings are reported next to the tree
+// quality so layout changes can be judged on both.
+
+#if defined( _MSC_VER ) && !defined( _CRT_SECURE_NO_WARNINGS )
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "utils.h"
+
+#include "box2d/base.h"
+#include "box2d/collision.h"
+#include "box2d/math_functions.h"
+#include "box2d/types.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARRAY_COUNT( A ) (int)( sizeof( A ) / sizeof( A[0] ) )
+
+#define QUERY_COUNT 4096
+#define MOVE_STEP_COUNT 60
+#define TREE_MARGIN 0.1f
+#define NULL_PROXY ( -1 )
+
+typedef enum Distribution
+{
+	e_uniform,
+	e_clustered,
+	e_level,
+	e_distributionCount
+} Distribution;
+
+static const char* s_distributionNames[e_distributionCount] = { "uniform", "clustered", "level" };
+
+typedef struct Proxy
+{
+	b2Vec2 center;
+	b2Vec2 extent;
+	b2Vec2 velocity;
+	b2AABB fatBox;
+	int proxyId;
+} Proxy;
+
+typedef struct Scene
+{
+	Proxy* proxies;
+	int proxyCount;
+	b2AABB bounds;
+	b2AABB queryBoxes[QUERY_COUNT];
+	b2RayCastInput rays[QUERY_COUNT];
+	b2ShapeCastInput casts[QUERY_COUNT];
+} Scene;
+
+// Quality of the tree after a phase
+typedef struct TreeQuality
+{
+	float areaRatio;
+	float sahCost;
+	int height;
+} TreeQuality;
+
+static int s_hitCount;
+
+static float Perimeter( b2AABB a )
+{
+	return 2.0f * ( a.upperBound.x - a.lowerBound.x + a.upperBound.y - a.lowerBound.y );
+}
+
+static b2AABB MakeBox( b2Vec2 center, b2Vec2 extent, float margin )
+{
+	b2Vec2 r = { extent.x + margin, extent.y + margin };
+	return ( b2AABB ){ b2Sub( center, r ), b2Add( center, r ) };
+}
+
+static void CreateScene( Scene* scene, Distribution distribution, int proxyCount )
+{
+	g_randomSeed = RAND_SEED;
+
+	scene->proxyCount = proxyCount;
+	scene->proxies = malloc( proxyCount * sizeof( Proxy ) );
+
+	// Same density in all distributions
+	float side = 2.0f * sqrtf( (float)proxyCount );
+	b2Vec2 size = { side, side };
+	if ( distribution == e_level )
+	{
+		size = ( b2Vec2 ){ 32.0f * side, side / 32.0f };
+	}
+
+	b2Vec2 clusterCenters[64];
+	int clusterCount = ARRAY_COUNT( clusterCenters );
+	for ( int i = 0; i < clusterCount; ++i )
+	{
+		clusterCenters[i] = ( b2Vec2 ){ RandomFloatRange( 0.0f, size.x ), RandomFloatRange( 0.0f, size.y ) };
+	}
+
+	float clusterRadius = 0.05f * side;
+
+	for ( int i = 0; i < proxyCount; ++i )
+	{
+		Proxy* proxy = scene->proxies + i;
+		if ( distribution == e_clustered )
+		{
+			b2Vec2 clusterCenter = clusterCenters[RandomIntRange( 0, clusterCount - 1 )];
+			proxy->center = b2Add( clusterCenter, RandomVec2( -clusterRadius, clusterRadius ) );
+		}
+		else
+		{
+			proxy->center = ( b2Vec2 ){ RandomFloatRange( 0.0f, size.x ), RandomFloatRange( 0.0f, size.y ) };
+		}
+
+		proxy->extent = ( b2Vec2 ){ RandomFloatRange( 0.1f, 0.5f ), RandomFloatRange( 0.1f, 0.5f ) };
+		proxy->velocity = RandomVec2( -0.05f, 0.05f );
+		proxy->fatBox = MakeBox( proxy->center, proxy->extent, TREE_MARGIN );
+		proxy->proxyId = NULL_PROXY;
+	}
+
+	scene->bounds = ( b2AABB ){ b2Vec2_zero, size };
+
+	for ( int i = 0; i < QUERY_COUNT; ++i )
+	{
+		// Queries sample the proxies so clustered scenes are not dominated by empty space
+		b2Vec2 p = scene->proxies[RandomIntRange( 0, proxyCount - 1 )].center;
+		scene->queryBoxes[i] = MakeBox( p, RandomVec2( 1.0f, 4.0f ), 0.0f );
+
+		b2Rot direction = RandomRot();
+		b2Vec2 translation = b2MulSV( RandomFloatRange( 5.0f, 20.0f ), ( b2Vec2 ){ direction.c, direction.s } );
+		scene->rays[i] = ( b2RayCastInput ){ p, translation, 1.0f };
+
+		b2Vec2 points[4] = { { -0.5f, -0.5f }, { 0.5f, -0.5f }, { 0.5f, 0.5f }, { -0.5f, 0.5f } };
+		for ( int j = 0; j < 4; ++j )
+		{
+			points[j] = b2Add( p, points[j] );
+		}
+
+		scene->casts[i] = ( b2ShapeCastInput ){ b2MakeProxy( points, 4, 0.1f ), translation, 1.0f, false };
+	}
+}
+
+static void DestroyScene( Scene* scene )
+{
+	free( scene->proxies );
+	scene->proxies = NULL;
+}
+
+// Surface area heuristic with unit traversal and leaf test costs
+static TreeQuality GetTreeQuality( const b2DynamicTree* tree, const Scene* scene )
+{
+	TreeQuality quality = { 0 };
+	if ( b2DynamicTree_GetProxyCount( tree ) == 0 )
+	{
+		return quality;
+	}
+
+	float leafPerimeter = 0.0f;
+	for ( int i = 0; i < scene->proxyCount; ++i )
+	{
+		int proxyId = scene->proxies[i].proxyId;
+		if ( proxyId != NULL_PROXY )
+		{
+			leafPerimeter += Perimeter( b2DynamicTree_GetAABB( tree, proxyId ) );
+		}
+	}
+
+	quality.areaRatio = b2DynamicTree_GetAreaRatio( tree );
+	quality.sahCost = quality.areaRatio + leafPerimeter / Perimeter( b2DynamicTree_GetRootBounds( tree ) );
+	quality.height = b2DynamicTree_GetHeight( tree );
+	return quality;
+}
+
+static void CreateProxies( b2DynamicTree* tree, Scene* scene )
+{
+	for ( int i = 0; i < scene->proxyCount; ++i )
+	{
+		Proxy* proxy = scene->proxies + i;
+		proxy->proxyId = b2DynamicTree_CreateProxy( tree, proxy->fatBox, B2_DEFAULT_CATEGORY_BITS, (uint64_t)i );
+	}
+}
+
+// Remove and insert a quarter of the proxies several times
+static void Churn( b2DynamicTree* tree, Scene* scene )
+{
+	for ( int pass = 0; pass < 4; ++pass )
+	{
+		for ( int i = pass; i < scene->proxyCount; i += 4 )
+		{
+			Proxy* proxy = scene->proxies + i;
+			b2DynamicTree_DestroyProxy( tree, proxy->proxyId );
+			proxy->proxyId = NULL_PROXY;
+		}
+
+		for ( int i = pass; i < scene->proxyCount; i += 4 )
+		{
+			Proxy* proxy = scene->proxies + i;
+			proxy->proxyId = b2DynamicTree_CreateProxy( tree, proxy->fatBox, B2_DEFAULT_CATEGORY_BITS, (uint64_t)i );
+		}
+	}
+}
+
+// Advance the proxies and return the number that left their fat box
+static int AdvanceProxies( Scene* scene )
+{
+	int escapeCount = 0;
+	for ( int i = 0; i < scene->proxyCount; ++i )
+	{
+		Proxy* proxy = scene->proxies + i;
+		proxy->center = b2Add( proxy->center, proxy->velocity );
+
+		// Bounce inside the bounds
+		if ( proxy->center.x < scene->bounds.lowerBound.x || proxy->center.x > scene->bounds.upperBound.x )
+		{
+			proxy->velocity.x = -proxy->velocity.x;
+		}
+
+		if ( proxy->center.y < scene->bounds.lowerBound.y || proxy->center.y > scene->bounds.upperBound.y )
+		{
+			proxy->velocity.y = -proxy->velocity.y;
+		}
+
+		b2AABB box = MakeBox( proxy->center, proxy->extent, 0.0f );
+		if ( b2AABB_Contains( proxy->fatBox, box ) == false )
+		{
+			proxy->fatBox = MakeBox( proxy->center, proxy->extent, TREE_MARGIN );
+			proxy->proxyId = -proxy->proxyId - 1;
+			escapeCount += 1;
+		}
+	}
+
+	return escapeCount;
+}
+
+// Proxies that escaped are flagged with a negative id by AdvanceProxies
+static float MoveProxies( b2DynamicTree* tree, Scene* scene, bool enlarge )
+{
+	uint64_t ticks = b2GetTicks();
+
+	for ( int i = 0; i < scene->proxyCount; ++i )
+	{
+		Proxy* proxy = scene->proxies + i;
+		if ( proxy->proxyId >= 0 )
+		{
+			continue;
+		}
+
+		proxy->proxyId = -proxy->proxyId - 1;
+		if ( enlarge )
+		{
+			b2DynamicTree_EnlargeProxy( tree, proxy->proxyId, proxy->fatBox );
+		}
+		else
+		{
+			b2DynamicTree_MoveProxy( tree, proxy->proxyId, proxy->fatBox );
+		}
+	}
+
+	return b2GetMilliseconds( ticks );
+}
+
+static bool QueryCallback( int proxyId, uint64_t userData, void* context )
+{
+	(void)proxyId;
+	(void)userData;
+	(void)context;
+	s_hitCount += 1;
+	return true;
+}
+
+static float RayCastCallback( const b2RayCastInput* input, int proxyId, uint64_t userData, void* context )
+{
+	(void)proxyId;
+	(void)userData;
+	(void)context;
+	s_hitCount += 1;
+	return input->maxFraction;
+}
+
+static float ShapeCastCallback( const b2ShapeCastInput* input, int proxyId, uint64_t userData, void* context )
+{
+	(void)proxyId;
+	(void)userData;
+	(void)context;
+	s_hitCount += 1;
+	return input->maxFraction;
+}
+
+typedef struct QueryTimes
+{
+	float query;
+	float rayCast;
+	float shapeCast;
+	float nodeVisits;
+} QueryTimes;
+
+// Nanoseconds per query and internal node visits per AABB query
+static QueryTimes RunQueries( const b2DynamicTree* tree, const Scene* scene )
+{
+	QueryTimes times = { 0 };
+	int nodeVisits = 0;
+
+	uint64_t ticks = b2GetTicks();
+	for ( int i = 0; i < QUERY_COUNT; ++i )
+	{
+		b2TreeStats stats = b2DynamicTree_Query( tree, scene->queryBoxes[i], B2_DEFAULT_MASK_BITS, QueryCallback, NULL );
+		nodeVisits += stats.nodeVisits;
+	}
+	times.query = b2GetMilliseconds( ticks );
+
+	ticks = b2GetTicks();
+	for ( int i = 0; i < QUERY_COUNT; ++i )
+	{
+		b2DynamicTree_RayCast( tree, scene->rays + i, B2_DEFAULT_MASK_BITS, RayCastCallback, NULL );
+	}
+	times.rayCast = b2GetMilliseconds( ticks );
+
+	ticks = b2GetTicks();
+	for ( int i = 0; i < QUERY_COUNT; ++i )
+	{
+		b2DynamicTree_ShapeCast( tree, scene->casts + i, B2_DEFAULT_MASK_BITS, ShapeCastCallback, NULL );
+	}
+	times.shapeCast = b2GetMilliseconds( ticks );
+
+	float scale = 1000000.0f / QUERY_COUNT;
+	times.query *= scale;
+	times.rayCast *= scale;
+	times.shapeCast *= scale;
+	times.nodeVisits = (float)nodeVisits / QUERY_COUNT;
+	return times;
+}
+
+static void PrintQuality( const char* label, TreeQuality quality )
+{
+	printf( "  %-24s area ratio %7.2f, sah %7.2f, height %3d\n", label, quality.areaRatio, quality.sahCost, quality.height );
+}
+
+static void PrintQueries( const char* label, QueryTimes times )
+{
+	printf( "  %-24s query %7.1f ns, ray %7.1f ns, shape %7.1f ns, visits %6.1f\n", label, times.query, times.rayCast,
+			times.shapeCast, times.nodeVisits );
+}
+
+int main( int argc, char** argv )
+{
+	int proxyCount = 10000;
+	int singleDistribution = -1;
+
+	for ( int i = 1; i < argc; ++i )
+	{
+		const char* arg = argv[i];
+		if ( strncmp( arg, "-n=", 3 ) == 0 )
+		{
+			proxyCount = b2ClampInt( atoi( arg + 3 ), 16, 10000000 );
+		}
+		else if ( strncmp( arg, "-d=", 3 ) == 0 )
+		{
+			singleDistribution = b2ClampInt( atoi( arg + 3 ), 0, e_distributionCount - 1 );
+		}
+		else if ( strcmp( arg, "-h" ) == 0 )
+		{
+			printf( "Usage\n"
+					"-n=<integer>: number of proxies (default is 10000)\n"
+					"-d=<integer>: run a single distribution (0 uniform, 1 clustered, 2 level)\n" );
+			exit( 0 );
+		}
+	}
+
+	printf( "Starting Box2D dynamic tree benchmarks\n" );
+	printf( "======================================\n" );
+
+	FILE* file = fopen( "tree.csv", "w" );
+	if ( file != NULL )
+	{
+		fprintf( file, "distribution,phase,ms,area_ratio,sah,query_ns,ray_ns,shape_ns\n" );
+	}
+
+	for ( int distribution = 0; distribution < e_distributionCount; ++distribution )
+	{
+		if ( singleDistribution != -1 && distribution != singleDistribution )
+		{
+			continue;
+		}
+
+		const char* name = s_distributionNames[distribution];
+		printf( "%s, %d proxies\n", name, proxyCount );
+
+		Scene scene = { 0 };
+		CreateScene( &scene, distribution, proxyCount );
+
+		// Incremental insertion
+		b2DynamicTree tree = b2DynamicTree_Create( proxyCount );
+		uint64_t ticks = b2GetTicks();
+		CreateProxies( &tree, &scene );
+		float insertTime = b2GetMilliseconds( ticks );
+		TreeQuality quality = GetTreeQuality( &tree, &scene );
+		QueryTimes queries = RunQueries( &tree, &scene );
+		printf( "  insert %.2f ms\n", insertTime );
+		PrintQuality( "incremental", quality );
+		PrintQueries( "incremental", queries );
+
+		if ( file != NULL )
+		{
+			fprintf( file, "%s,insert,%g,%g,%g,%g,%g,%g\n", name, insertTime, quality.areaRatio, quality.sahCost,
+					 queries.query, queries.rayCast, queries.shapeCast );
+		}
+
+		ticks = b2GetTicks();
+		Churn( &tree, &scene );
+		float churnTime = b2GetMilliseconds( ticks );
+		quality = GetTreeQuality( &tree, &scene );
+		printf( "  churn %.2f ms\n", churnTime );
+		PrintQuality( "after churn", quality );
+
+		if ( file != NULL )
+		{
+			fprintf( file, "%s,churn,%g,%g,%g,,,\n", name, churnTime, quality.areaRatio, quality.sahCost );
+		}
+
+		// Full rebuild of the static tree
+		ticks = b2GetTicks();
+		b2DynamicTree_Rebuild( &tree, true );
+		float fullTime = b2GetMilliseconds( ticks );
+		quality = GetTreeQuality( &tree, &scene );
+		queries = RunQueries( &tree, &scene );
+		printf( "  full rebuild %.2f ms\n", fullTime );
+		PrintQuality( "static", quality );
+		PrintQueries( "static", queries );
+
+		if ( file != NULL )
+		{
+			fprintf( file, "%s,full_rebuild,%g,%g,%g,%g,%g,%g\n", name, fullTime, quality.areaRatio, quality.sahCost,
+					 queries.query, queries.rayCast, queries.shapeCast );
+		}
+
+		b2DynamicTree_Destroy( &tree );
+
+		// Motion with remove and reinsert. The proxies are restored afterward so both motion modes see the same paths.
+		Proxy* initialProxies = malloc( proxyCount * sizeof( Proxy ) );
+		memcpy( initialProxies, scene.proxies, proxyCount * sizeof( Proxy ) );
+
+		tree = b2DynamicTree_Create( proxyCount );
+		CreateProxies( &tree, &scene );
+		b2DynamicTree_Rebuild( &tree, true );
+
+		float moveTime = 0.0f;
+		int escapeCount = 0;
+		for ( int step = 0; step < MOVE_STEP_COUNT; ++step )
+		{
+			escapeCount += AdvanceProxies( &scene );
+			moveTime += MoveProxies( &tree, &scene, false );
+		}
+
+		quality = GetTreeQuality( &tree, &scene );
+		queries = RunQueries( &tree, &scene );
+		printf( "  move %.2f ms, %d moved\n", moveTime, escapeCount );
+		PrintQuality( "dynamic move", quality );
+		PrintQueries( "dynamic move", queries );
+
+		if ( file != NULL )
+		{
+			fprintf( file, "%s,move,%g,%g,%g,%g,%g,%g\n", name, moveTime, quality.areaRatio, quality.sahCost, queries.query,
+					 queries.rayCast, queries.shapeCast );
+		}
+
+		b2DynamicTree_Destroy( &tree );
+
+		// Motion with enlarge and partial rebuild, the way the broad-phase updates the dynamic tree
+		memcpy( scene.proxies, initialProxies, proxyCount * sizeof( Proxy ) );
+		free( initialProxies );
+
+		tree = b2DynamicTree_Create( proxyCount );
+		CreateProxies( &tree, &scene );
+		b2DynamicTree_Rebuild( &tree, true );
+
+		float enlargeTime = 0.0f;
+		float partialTime = 0.0f;
+		for ( int step = 0; step < MOVE_STEP_COUNT; ++step )
+		{
+			AdvanceProxies( &scene );
+			enlargeTime += MoveProxies( &tree, &scene, true );
+
+			ticks = b2GetTicks();
+			b2DynamicTree_Rebuild( &tree, false );
+			partialTime += b2GetMilliseconds( ticks );
+		}
+
+		quality = GetTreeQuality( &tree, &scene );
+		queries = RunQueries( &tree, &scene );
+		printf( "  enlarge %.2f ms, partial rebuild %.2f ms\n", enlargeTime, partialTime );
+		PrintQuality( "dynamic enlarge", quality );
+		PrintQueries( "dynamic enlarge", queries );
+
+		if ( file != NULL )
+		{
+			fprintf( file, "%s,enlarge,%g,%g,%g,%g,%g,%g\n", name, enlargeTime + partialTime, quality.areaRatio,
+					 quality.sahCost, queries.query, queries.rayCast, queries.shapeCast );
+		}
+
+		b2DynamicTree_Destroy( &tree );
+		DestroyScene( &scene );
+	}
+
+	if ( file != NULL )
+	{
+		fclose( file );
+	}
+
+	printf( "======================================\n" );
+	printf( "All Box2D dynamic tree benchmarks complete! %d hits\n", s_hitCount );
+
+	return 0;
+}
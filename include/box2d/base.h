@@ -59,6 +59,57 @@ typedef void* b2AllocFcn( unsigned int size, int alignment );
 /// @param size the allocation size in bytes
 typedef void b2FreeFcn( void* mem, unsigned int size );
 
+/// Subsystem that owns a heap allocation, see b2SetTaggedAllocator
+typedef enum b2AllocTag
+{
+	/// Allocations made outside of a world, or by a world but not listed below
+	b2_allocTagDefault,
+
+	/// Body, shape, joint, contact, island and constraint graph storage of a world
+	b2_allocTagWorld,
+
+	/// Dynamic tree nodes and the buffers of tree rebuilds
+	b2_allocTagTree,
+
+	/// The broad-phase move buffer and pair set
+	b2_allocTagBroadPhase,
+
+	/// Buffers of the per step stack and arena allocators and their heap fallbacks
+	b2_allocTagStack,
+
+	/// Event arrays filled by the step
+	b2_allocTagEvents,
+
+	b2_allocTagCount,
+} b2AllocTag;
+
+/// Expected lifetime of a heap allocation, see b2SetTaggedAllocator
+typedef enum b2AllocLifetime
+{
+	/// Kept until its owner is destroyed or the memory is regrown
+	b2_allocLifetimeLong,
+
+	/// Freed before the call that made it returns, typically within a step
+	b2_allocLifetimeTemporary,
+} b2AllocLifetime;
+
+/// Describes a heap allocation to a tagged allocator
+typedef struct b2AllocInfo
+{
+	b2AllocTag tag;
+	b2AllocLifetime lifetime;
+
+	/// Index of the world that made the allocation while creating or stepping, otherwise -1. Matches
+	/// b2WorldId::index1 - 1.
+	int worldIndex;
+} b2AllocInfo;
+
+/// Prototype for a user allocation function that is told what the memory is for
+/// @param size the allocation size in bytes
+/// @param alignment the required alignment, guaranteed to be a power of 2
+/// @param info the owner and expected lifetime of the allocation
+typedef void* b2AllocTaggedFcn( unsigned int size, int alignment, b2AllocInfo info );
+
 /// Prototype for the user assert callback. Return 0 to skip the debugger break.
 typedef int b2AssertFcn( const char* condition, const char* fileName, int lineNumber );
 
@@ -69,6 +120,13 @@ typedef void b2LogFcn( const char* message );
 /// set during application startup.
 B2_API void b2SetAllocator( b2AllocFcn* allocFcn, b2FreeFcn* freeFcn );
 
+/// Like b2SetAllocator but each allocation comes with its subsystem, world and expected lifetime. For
+/// example large long lived tree and world arrays can go on huge pages or the memory node of the thread
+/// stepping the world while temporary memory comes from a separate pool. The free function is only given
+/// the pointer and size, so a pooled allocator has to find the pool from the address. Allocations made
+/// on worker threads are not attributed to a world. Replaces any allocator set by b2SetAllocator. These should be set during application startup.
+B2_API void b2SetTaggedAllocator( b2AllocTaggedFcn* allocFcn, b2FreeFcn* freeFcn );
+
 /// @return the total bytes allocated by Box2D
 B2_API int b2GetByteCount( void );
 
@@ -137,6 +195,18 @@ B2_API float b2GetMilliseconds( uint64_t ticks );
 /// value to the current tick value.
 B2_API float b2GetMillisecondsAndReset( uint64_t* ticks );
 
+/// Enable the built-in trace recorder. This records the profiler zones of all threads without
+/// building against Tracy, for example to capture step timelines on machines where Tracy cannot
+/// attach. Each thread keeps its most recent zones in a ring buffer of eventCapacity entries.
+/// Zero disables the recorder and frees the buffers. Must not be called while a world is stepping.
+B2_API void b2EnableTrace( int eventCapacity );
+
+/// Write the zones recorded over the last stepCount world steps as Chrome trace JSON, which loads in
+/// chrome://tracing and Perfetto. Steps of all worlds are counted. A step count of zero writes all
+/// recorded zones. The JSON is null terminated. Returns the number of bytes needed if the buffer is
+/// NULL, the number of bytes written, or zero if the capacity is too small.
+B2_API int b2WriteTrace( char* buffer, int capacity, int stepCount );
+
 /// Yield to be used in a busy loop.
 B2_API void b2Yield( void );
 
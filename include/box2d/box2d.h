@@ -29,6 +29,14 @@ B2_API b2WorldId b2CreateWorld( const b2WorldDef* def );
 /// Destroy a world
 B2_API void b2DestroyWorld( b2WorldId worldId );
 
+/// Create a copy of a world, for example to simulate ahead for planning or trajectory previews and then
+/// destroy the copy. The copy has the same simulation state, settings, callbacks and task system, and
+/// stepping both gives the same results. Pending events are not copied. Ids of bodies, shapes, joints
+/// and contacts are the same in the copy except for the world index, which is that of the returned id.
+/// @return the id of the new world, or a null id if no world slot is free
+/// @warning This must not be called during a step.
+B2_API b2WorldId b2World_Clone( b2WorldId worldId );
+
 /// World id validation. Provides validation for up to 64K allocations.
 B2_API bool b2World_IsValid( b2WorldId id );
 
@@ -38,12 +46,92 @@ B2_API bool b2World_IsValid( b2WorldId id );
 /// @param subStepCount The number of sub-steps, increasing the sub-step count can increase accuracy. Usually 4.
 B2_API void b2World_Step( b2WorldId worldId, float timeStep, int subStepCount );
 
+/// Simulate a world for one time step within a time budget. The step is checked against the budget
+/// between stages and skips work in the order of b2StepDegradation when it runs over. The skipped work
+/// is reported in b2Profile::degradations. The budget bounds the optional work only, a step may still
+/// take longer.
+/// @param worldId The world to simulate
+/// @param timeStep The amount of time to simulate, this should be a fixed number. Usually 1/60.
+/// @param subStepCount The number of sub-steps. Usually 4.
+/// @param budgetMilliseconds The wall clock time allowed for the step, zero for no budget
+/// @see b2World_Step
+B2_API void b2World_StepWithBudget( b2WorldId worldId, float timeStep, int subStepCount, float budgetMilliseconds );
+
+/// Start simulating a world for one time step on the worker pool and return immediately. The step must be
+/// completed with b2World_WaitStep before the next step. While the step is in flight:
+/// - the world is locked and every function that modifies or reads bodies, shapes, joints, contacts or events is
+///   not allowed
+/// - the world query functions (b2World_OverlapAABB, b2World_OverlapShape, the b2World_CastRay family,
+///   b2World_CastShape, b2World_CastMover and b2World_CollideMover) are allowed from the calling thread and
+///   only report static shapes
+/// - callbacks such as the custom filter and pre-solve run on worker threads
+/// The step task enqueues and finishes other tasks, so a user task system must allow that from its worker
+/// threads. Without a task system the step completes before this returns.
+/// @see b2World_Step
+B2_API void b2World_StepAsync( b2WorldId worldId, float timeStep, int subStepCount );
+
+/// Wait for the step started by b2World_StepAsync to complete and unlock the world. The calling thread helps
+/// with the remaining work. Does nothing if no step is in flight.
+B2_API void b2World_WaitStep( b2WorldId worldId );
+
+/// Is an asynchronous step in flight? This stays true until b2World_WaitStep is called.
+B2_API bool b2World_IsStepping( b2WorldId worldId );
+
+/// Simulate many independent worlds for one time step. Each step is started with b2World_StepAsync before
+/// any of them is waited on, so when the worlds share one task system the collision of one world overlaps
+/// with the solver of another and small worlds no longer leave workers idle at their barriers. Worlds that
+/// have no task system are stepped one after the other. Each world may appear only once.
+/// @see b2World_StepAsync
+B2_API void b2StepWorlds( const b2WorldId* worldIds, int worldCount, float timeStep, int subStepCount );
+
 /// Call this to draw shapes and other debug draw data
 B2_API void b2World_Draw( b2WorldId worldId, b2DebugDraw* draw );
 
 /// Get the body events for the current time step. The event data is transient. Do not store a reference to this data.
 B2_API b2BodyEvents b2World_GetBodyEvents( b2WorldId worldId );
 
+/// Set the body move event thresholds and the quantum of the compact deltas. Bodies keep the reference
+/// transform of their previous move event across calls. All zero reports every move without deltas.
+/// @see b2WorldDef::moveEventLinearThreshold, b2WorldDef::moveEventAngularThreshold, b2WorldDef::moveEventQuantum
+B2_API void b2World_SetMoveEventFilter( b2WorldId worldId, float linearThreshold, float angularThreshold, float quantum );
+
+/// Queue forces, impulses and velocities that are applied at the start of the next time step. Each
+/// buffer index in [0, workerCount) is an independent queue, so calls using different buffer indices
+/// may run concurrently from user jobs, for example wind, buoyancy or explosions. Queues are applied
+/// in buffer order and sleeping islands are woken once before any command is applied. Must not be
+/// called while the world is stepping.
+B2_API void b2World_QueueBodyCommands( b2WorldId worldId, int bufferIndex, const b2BodyCommand* commands, int count );
+
+/// Copy the transforms and velocities of many bodies into caller owned arrays. This is faster than
+/// calling b2Body_GetTransform and friends for each body and runs in parallel on the world workers.
+/// @param worldId the world
+/// @param bodyIds the bodies to read
+/// @param count the number of bodies
+/// @param arrays the destination arrays, each with room for count entries
+B2_API void b2World_GetBodyStates( b2WorldId worldId, const b2BodyId* bodyIds, int count, const b2BodyStateArrays* arrays );
+
+/// Copy the ids, transforms and velocities of the awake bodies into caller owned arrays. Up to capacity
+/// bodies are written. Runs in parallel on the world workers.
+/// @param worldId the world
+/// @param bodyIds optionally receives the id of each awake body. May be NULL.
+/// @param capacity the number of entries in each destination array
+/// @param arrays the destination arrays
+/// @return the number of awake bodies, which may exceed capacity
+B2_API int b2World_GetAwakeBodyStates( b2WorldId worldId, b2BodyId* bodyIds, int capacity, const b2BodyStateArrays* arrays );
+
+/// Blend the transforms of many bodies between the start and the end of the last step. Use this to
+/// render at a higher rate than a fixed simulation rate, with alpha being the fraction of a time step
+/// left in the accumulator. Bodies that are not awake, and all bodies while interpolation is disabled,
+/// get their current transform. Runs in parallel on the world workers.
+/// @param worldId the world
+/// @param alpha zero for the transform at the start of the last step, one for the current transform
+/// @param bodyIds the bodies to read
+/// @param count the number of bodies
+/// @param transforms receives count transforms
+/// @see b2WorldDef::enableInterpolation
+B2_API void b2World_GetInterpolatedTransforms( b2WorldId worldId, float alpha, const b2BodyId* bodyIds, int count,
+											   b2Transform* transforms );
+
 /// Get sensor events for the current time step. The event data is transient. Do not store a reference to this data.
 B2_API b2SensorEvents b2World_GetSensorEvents( b2WorldId worldId );
 
@@ -53,6 +141,11 @@ B2_API b2ContactEvents b2World_GetContactEvents( b2WorldId worldId );
 /// Get the joint events for the current time step. The event data is transient. Do not store a reference to this data.
 B2_API b2JointEvents b2World_GetJointEvents( b2WorldId worldId );
 
+/// The single query functions below (b2World_OverlapAABB, b2World_OverlapShape, the b2World_CastRay family,
+/// b2World_CastShape, b2World_CastMover and b2World_CollideMover) only read the world and keep no shared scratch
+/// state or statistics. Between steps they may be called from several threads at once as long as no thread
+/// modifies the world. The batched queries use the world task system and are excluded.
+
 /// Overlap test for all shapes that *potentially* overlap the provided AABB
 B2_API b2TreeStats b2World_OverlapAABB( b2WorldId worldId, b2AABB aabb, b2QueryFilter filter, b2OverlapResultFcn* fcn,
 										void* context );
@@ -61,6 +154,24 @@ B2_API b2TreeStats b2World_OverlapAABB( b2WorldId worldId, b2AABB aabb, b2QueryF
 B2_API b2TreeStats b2World_OverlapShape( b2WorldId worldId, const b2ShapeProxy* proxy, b2QueryFilter filter,
 										 b2OverlapResultFcn* fcn, void* context );
 
+/// Batched version of b2World_OverlapAABB. The queries are split across the workers of the world and
+/// the results are written as a flat array sorted by query index. The shapes of each query are in the
+/// same order as b2World_OverlapAABB reports them. This must not be called while the world is stepping
+/// or concurrently with other world functions that use the task system.
+/// @param worldId the world to query
+/// @param aabbs the query boxes
+/// @param filters the query filter of each query
+/// @param queryCount the number of queries
+/// @param results the results array
+/// @param resultCapacity the capacity of the results array
+/// @return the total number of results. Only the first resultCapacity results are written.
+B2_API int b2World_OverlapAABBs( b2WorldId worldId, const b2AABB* aabbs, const b2QueryFilter* filters, int queryCount,
+								 b2OverlapHit* results, int resultCapacity );
+
+/// Batched version of b2World_OverlapShape. See b2World_OverlapAABBs.
+B2_API int b2World_OverlapShapes( b2WorldId worldId, const b2ShapeProxy* proxies, const b2QueryFilter* filters,
+								  int queryCount, b2OverlapHit* results, int resultCapacity );
+
 /// Cast a ray into the world to collect shapes in the path of the ray.
 /// Your callback function controls whether you get the closest point, any point, or n-points.
 /// @note The callback function may receive shapes in any order
@@ -76,13 +187,42 @@ B2_API b2TreeStats b2World_CastRay( b2WorldId worldId, b2Vec2 origin, b2Vec2 tra
 
 /// Cast a ray into the world to collect the closest hit. This is a convenience function. Ignores initial overlap.
 /// This is less general than b2World_CastRay() and does not allow for custom filtering.
+/// Repeated rays can reuse static hits, see b2WorldDef::rayCacheCapacity.
 B2_API b2RayResult b2World_CastRayClosest( b2WorldId worldId, b2Vec2 origin, b2Vec2 translation, b2QueryFilter filter );
 
+/// Cast a batch of rays into the world and collect the closest hit of each, like b2World_CastRayClosest().
+/// Consecutive rays are cast together in packets of four that share one tree traversal, so rays that
+/// start near each other and point in similar directions should be adjacent. The batch is split across
+/// the workers of the world. This must not be called while the world is stepping or concurrently
+/// with other world functions that use the task system.
+/// @param worldId the world to cast into
+/// @param origins the ray origins
+/// @param translations the ray translations
+/// @param count the number of rays
+/// @param filter the query filter applied to all rays
+/// @param results the closest hit of each ray. Must hold count results.
+B2_API void b2World_CastRaysClosest( b2WorldId worldId, const b2Vec2* origins, const b2Vec2* translations, int count,
+									 b2QueryFilter filter, b2RayResult* results );
+
 /// Cast a shape through the world. Similar to a cast ray except that a shape is cast instead of a point.
 ///	@see b2World_CastRay
 B2_API b2TreeStats b2World_CastShape( b2WorldId worldId, const b2ShapeProxy* proxy, b2Vec2 translation, b2QueryFilter filter,
 									  b2CastResultFcn* fcn, void* context );
 
+/// Cast a batch of shapes through the world and collect the closest hit of each, like b2World_CastShape()
+/// with a callback that keeps the closest hit. Ignores initial overlap. The sweeps are sorted spatially so
+/// each worker traverses the tree coherently and the batch is split across the workers of the world. The
+/// results are in the order of the input. This must not be called while the world is stepping or
+/// concurrently with other world functions that use the task system.
+/// @param worldId the world to cast into
+/// @param proxies the shape proxies in world space
+/// @param translations the translation of each proxy
+/// @param count the number of sweeps
+/// @param filter the query filter applied to all sweeps
+/// @param results the closest hit of each sweep. Must hold count results.
+B2_API void b2World_CastShapesClosest( b2WorldId worldId, const b2ShapeProxy* proxies, const b2Vec2* translations, int count,
+									   b2QueryFilter filter, b2RayResult* results );
+
 /// Cast a capsule mover through the world. This is a special shape cast that handles sliding along other shapes while reducing
 /// clipping.
 B2_API float b2World_CastMover( b2WorldId worldId, const b2Capsule* mover, b2Vec2 translation, b2QueryFilter filter );
@@ -92,6 +232,20 @@ B2_API float b2World_CastMover( b2WorldId worldId, const b2Capsule* mover, b2Vec
 B2_API void b2World_CollideMover( b2WorldId worldId, const b2Capsule* mover, b2QueryFilter filter, b2PlaneResultFcn* fcn,
 								  void* context );
 
+/// Move many capsule movers at once. Each mover collides, solves its collision planes and sweeps up to five
+/// times, the same as a loop of b2World_CollideMover, b2SolvePlanes and b2World_CastMover. All planes are rigid
+/// and clip velocity. Movers are processed in parallel with the world workers and the plane solver runs
+/// several movers at once with SIMD. Movers do not see each other move within a call.
+/// @param worldId the world to query
+/// @param movers the capsules in world space. These are moved in place.
+/// @param translations the desired translation of each mover
+/// @param velocities optional velocities clipped against the final collision planes of each mover. May be NULL.
+/// @param count the number of movers
+/// @param collideFilter the filter used to gather collision planes
+/// @param castFilter the filter used to sweep the movers
+B2_API void b2World_SolveMovers( b2WorldId worldId, b2Capsule* movers, const b2Vec2* translations, b2Vec2* velocities,
+								 int count, b2QueryFilter collideFilter, b2QueryFilter castFilter );
+
 /// Enable/disable sleep. If your application does not need sleeping, you can gain some performance
 /// by disabling sleep completely at the world level.
 /// @see b2WorldDef
@@ -100,6 +254,13 @@ B2_API void b2World_EnableSleeping( b2WorldId worldId, bool flag );
 /// Is body sleeping enabled?
 B2_API bool b2World_IsSleepingEnabled( b2WorldId worldId );
 
+/// Set the regions of interest, usually the areas around the players. Awake islands with all bodies outside
+/// of these regions are frozen at the end of each step, regardless of their speed. A frozen island keeps its
+/// velocity and is thawed at the start of the first step where its bounds overlap a region. Frozen bodies
+/// report as sleeping. The regions are copied. A count of zero disables active regions and thaws all
+/// frozen islands in the next step.
+B2_API void b2World_SetActiveRegions( b2WorldId worldId, const b2AABB* regions, int count );
+
 /// Enable/disable continuous collision between dynamic and static bodies. Generally you should keep continuous
 /// collision enabled to prevent fast moving objects from going through static objects. The performance gain from
 /// disabling continuous collision is minor.
@@ -109,6 +270,91 @@ B2_API void b2World_EnableContinuous( b2WorldId worldId, bool flag );
 /// Is continuous collision enabled?
 B2_API bool b2World_IsContinuousEnabled( b2WorldId worldId );
 
+/// Enable/disable the persistent time of impact cache. See b2WorldDef::enableContinuousCache.
+/// @see b2WorldDef
+B2_API void b2World_EnableContinuousCache( b2WorldId worldId, bool flag );
+
+/// Is the persistent time of impact cache enabled?
+B2_API bool b2World_IsContinuousCacheEnabled( b2WorldId worldId );
+
+/// Enable/disable the parallel overflow solver. See b2WorldDef::enableParallelOverflow and
+/// b2Counters::overflowContactCount.
+/// @see b2WorldDef
+B2_API void b2World_EnableParallelOverflow( b2WorldId worldId, bool flag );
+
+/// Is the parallel overflow solver enabled?
+B2_API bool b2World_IsParallelOverflowEnabled( b2WorldId worldId );
+
+/// Enable/disable adaptive relax iterations. See b2WorldDef::enableAdaptiveRelax.
+/// @see b2WorldDef
+B2_API void b2World_EnableAdaptiveRelax( b2WorldId worldId, bool flag );
+
+/// Are adaptive relax iterations enabled?
+B2_API bool b2World_IsAdaptiveRelaxEnabled( b2WorldId worldId );
+
+/// Enable/disable velocity based fat AABB margins. See b2WorldDef::enableVelocityMargins.
+/// @see b2WorldDef
+B2_API void b2World_EnableVelocityMargins( b2WorldId worldId, bool flag );
+
+/// Are velocity based fat AABB margins enabled?
+B2_API bool b2World_IsVelocityMarginsEnabled( b2WorldId worldId );
+
+/// Enable/disable the allocation check. See b2WorldDef::enableAllocationCheck.
+/// @see b2WorldDef
+B2_API void b2World_EnableAllocationCheck( b2WorldId worldId, bool flag );
+
+/// Is the allocation check enabled?
+B2_API bool b2World_IsAllocationCheckEnabled( b2WorldId worldId );
+
+/// Enable/disable parallel contact creation. See b2WorldDef::enableParallelContacts.
+/// @see b2WorldDef
+B2_API void b2World_EnableParallelContacts( b2WorldId worldId, bool flag );
+
+/// Is parallel contact creation enabled?
+B2_API bool b2World_IsParallelContactsEnabled( b2WorldId worldId );
+
+/// Enable/disable relaxed determinism. See b2WorldDef::enableRelaxedDeterminism.
+B2_API void b2World_EnableRelaxedDeterminism( b2WorldId worldId, bool flag );
+
+/// Is relaxed determinism enabled?
+B2_API bool b2World_IsRelaxedDeterminismEnabled( b2WorldId worldId );
+
+/// Enable/disable narrow phase bucketing by shape pair type. See b2WorldDef::enableSortedCollide.
+B2_API void b2World_EnableSortedCollide( b2WorldId worldId, bool flag );
+
+/// Is narrow phase bucketing enabled?
+B2_API bool b2World_IsSortedCollideEnabled( b2WorldId worldId );
+
+/// Enable/disable overlapping the pair finding with the narrow phase. See b2WorldDef::enablePipelinedCollide.
+B2_API void b2World_EnablePipelinedCollide( b2WorldId worldId, bool flag );
+
+/// Is the pipelined narrow phase enabled?
+B2_API bool b2World_IsPipelinedCollideEnabled( b2WorldId worldId );
+
+/// Enable/disable contact preparation in the narrow phase. See b2WorldDef::enableFusedPrepare.
+B2_API void b2World_EnableFusedPrepare( b2WorldId worldId, bool flag );
+
+/// Is contact preparation in the narrow phase enabled?
+B2_API bool b2World_IsFusedPrepareEnabled( b2WorldId worldId );
+
+/// Enable/disable incremental island splitting. See b2WorldDef::enableIncrementalIslands.
+B2_API void b2World_EnableIncrementalIslands( b2WorldId worldId, bool flag );
+
+/// Is incremental island splitting enabled?
+B2_API bool b2World_IsIncrementalIslandsEnabled( b2WorldId worldId );
+
+/// Enable/disable incremental sensor updates. See b2WorldDef::enableIncrementalSensors.
+B2_API void b2World_EnableIncrementalSensors( b2WorldId worldId, bool flag );
+
+/// Are incremental sensor updates enabled?
+B2_API bool b2World_IsIncrementalSensorsEnabled( b2WorldId worldId );
+
+/// Enable/disable incremental pair queries. See b2WorldDef::enableIncrementalPairs.
+B2_API void b2World_EnableIncrementalPairs( b2WorldId worldId, bool flag );
+
+/// Are incremental pair queries enabled?
+B2_API bool b2World_IsIncrementalPairsEnabled( b2WorldId worldId );
+
 /// Adjust the restitution threshold. It is recommended not to make this value very small
 /// because it will prevent bodies from sleeping. Usually in meters per second.
 /// @see b2WorldDef
@@ -125,12 +371,25 @@ B2_API void b2World_SetHitEventThreshold( b2WorldId worldId, float value );
 /// Get the the hit event speed threshold. Usually in meters per second.
 B2_API float b2World_GetHitEventThreshold( b2WorldId worldId );
 
+/// Set the contact event filter. This applies to existing contacts.
+/// @see b2WorldDef::contactEventFilter
+B2_API void b2World_SetContactEventFilter( b2WorldId worldId, b2ContactEventFilter filter );
+
+/// Get the contact event filter.
+B2_API b2ContactEventFilter b2World_GetContactEventFilter( b2WorldId worldId );
+
 /// Register the custom filter callback. This is optional.
 B2_API void b2World_SetCustomFilterCallback( b2WorldId worldId, b2CustomFilterFcn* fcn, void* context );
 
 /// Register the pre-solve callback. This is optional.
 B2_API void b2World_SetPreSolveCallback( b2WorldId worldId, b2PreSolveFcn* fcn, void* context );
 
+/// Register the batch custom filter callback. This is optional. Use NULL to go back to b2CustomFilterFcn.
+B2_API void b2World_SetCustomFilterBatchCallback( b2WorldId worldId, b2CustomFilterBatchFcn* fcn, void* context );
+
+/// Register the batch pre-solve callback. This is optional. Use NULL to go back to b2PreSolveFcn.
+B2_API void b2World_SetPreSolveBatchCallback( b2WorldId worldId, b2PreSolveBatchFcn* fcn, void* context );
+
 /// Set the gravity vector for the entire world. Box2D has no concept of an up direction and this
 /// is left as a decision for the application. Usually in m/s^2.
 /// @see b2WorldDef
@@ -144,6 +403,38 @@ B2_API b2Vec2 b2World_GetGravity( b2WorldId worldId );
 /// @param explosionDef The explosion definition
 B2_API void b2World_Explode( b2WorldId worldId, const b2ExplosionDef* explosionDef );
 
+/// Apply explosions, wind volumes and buoyancy regions. The shapes are gathered and the forces are
+/// computed in parallel on the world workers. The results are queued as body commands in buffer 0 and
+/// applied at the start of the next step, where sleeping bodies are woken together.
+/// See b2World_QueueBodyCommands.
+/// @param worldId The world id
+/// @param defs The area force definitions
+/// @param count The number of definitions
+B2_API void b2World_ApplyAreaForces( b2WorldId worldId, const b2AreaForceDef* defs, int count );
+
+/// Create particles that share a definition. Particles are simulated after the bodies in each step.
+/// @param worldId The world id
+/// @param def The shared particle settings
+/// @param positions The initial particle positions
+/// @param velocities The initial particle velocities, may be NULL for particles at rest
+/// @param count The number of particles
+B2_API void b2World_CreateParticles( b2WorldId worldId, const b2ParticleDef* def, const b2Vec2* positions,
+									 const b2Vec2* velocities, int count );
+
+/// Destroy all particles
+B2_API void b2World_DestroyParticles( b2WorldId worldId );
+
+/// Get the number of particles
+B2_API int b2World_GetParticleCount( b2WorldId worldId );
+
+/// Get the particle positions. The particles are reordered by every step and by particles expiring,
+/// so the index of a particle is only valid until the next step. Valid until the next step or
+/// particle creation.
+B2_API const b2Vec2* b2World_GetParticlePositions( b2WorldId worldId );
+
+/// Get the particle velocities, in the same order as b2World_GetParticlePositions
+B2_API const b2Vec2* b2World_GetParticleVelocities( b2WorldId worldId );
+
 /// Adjust contact tuning parameters
 /// @param worldId The world id
 /// @param hertz The contact stiffness (cycles per second)
@@ -165,6 +456,24 @@ B2_API void b2World_SetMaximumLinearSpeed( b2WorldId worldId, float maximumLinea
 /// Get the maximum linear speed. Usually in m/s.
 B2_API float b2World_GetMaximumLinearSpeed( b2WorldId worldId );
 
+/// Set the incremental tree optimization budget. See b2WorldDef::treeOptimizationBudget.
+B2_API void b2World_SetTreeOptimizationBudget( b2WorldId worldId, int budget );
+
+/// Get the incremental tree optimization budget
+B2_API int b2World_GetTreeOptimizationBudget( b2WorldId worldId );
+
+/// Set the maximum number of islands split per step. See b2WorldDef::maxIslandSplits.
+B2_API void b2World_SetMaxIslandSplits( b2WorldId worldId, int count );
+
+/// Get the maximum number of islands split per step
+B2_API int b2World_GetMaxIslandSplits( b2WorldId worldId );
+
+/// Set how far ahead the contact solver prefetches body states. See b2WorldDef::contactPrefetchDistance.
+B2_API void b2World_SetContactPrefetchDistance( b2WorldId worldId, int distance );
+
+/// Get how far ahead the contact solver prefetches body states
+B2_API int b2World_GetContactPrefetchDistance( b2WorldId worldId );
+
 /// Enable/disable constraint warm starting. Advanced feature for testing. Disabling
 /// warm starting greatly reduces stability and provides no performance gain.
 B2_API void b2World_EnableWarmStarting( b2WorldId worldId, bool flag );
@@ -178,10 +487,96 @@ B2_API int b2World_GetAwakeBodyCount( b2WorldId worldId );
 /// Get the current world performance profile
 B2_API b2Profile b2World_GetProfile( b2WorldId worldId );
 
+/// Enable the per worker solver profile, see b2World_GetWorkerProfile. This reads the timer for each
+/// stage on each worker, so it is disabled by default.
+B2_API void b2World_EnableWorkerProfile( b2WorldId worldId, bool flag );
+
+/// Get the solver profile of a worker for the last step. This shows load imbalance across workers,
+/// straggling workers and time spent waiting between stages. Worker zero runs the stages and the
+/// other workers help. Returns zeros if the worker profile is disabled or the index is out of range.
+B2_API b2WorkerProfile b2World_GetWorkerProfile( b2WorldId worldId, int workerIndex );
+
+/// Get the profile of the parallel loops since the start of the last step, one entry per call site. Only
+/// recorded with b2WorldDef::enableAdaptiveBlocks. Writes up to capacity entries and returns the number of
+/// call sites.
+B2_API int b2World_GetParallelForProfile( b2WorldId worldId, b2ParallelForProfile* profiles, int capacity );
+
+/// Enable/disable adaptive block sizing of parallel loops. See b2WorldDef::enableAdaptiveBlocks.
+B2_API void b2World_EnableAdaptiveBlocks( b2WorldId worldId, bool flag );
+
+/// Is adaptive block sizing enabled?
+B2_API bool b2World_IsAdaptiveBlocksEnabled( b2WorldId worldId );
+
+/// Enable/disable sorting the graph color contacts by body. See b2WorldDef::enableContactOrdering.
+B2_API void b2World_EnableContactOrdering( b2WorldId worldId, bool flag );
+
+/// Is contact ordering enabled?
+B2_API bool b2World_IsContactOrderingEnabled( b2WorldId worldId );
+
+/// Enable/disable balancing the contact counts of the graph colors. See b2WorldDef::enableColorBalancing.
+B2_API void b2World_EnableColorBalancing( b2WorldId worldId, bool flag );
+
+/// Is color balancing enabled?
+B2_API bool b2World_IsColorBalancingEnabled( b2WorldId worldId );
+
+/// Balance the contact counts of the graph colors now, whether or not periodic balancing is enabled.
+B2_API void b2World_BalanceColors( b2WorldId worldId );
+
+/// Enable/disable keeping the transforms of the last step for interpolation. Enabling starts from the
+/// current transforms. See b2WorldDef::enableInterpolation.
+B2_API void b2World_EnableInterpolation( b2WorldId worldId, bool flag );
+
+/// Is interpolation enabled?
+B2_API bool b2World_IsInterpolationEnabled( b2WorldId worldId );
+
+/// Get the byte size of a state export buffer with this many slots, see b2World_SetExportBuffer
+B2_API int b2GetExportBufferSize( int slotCapacity );
+
+/// Set a caller owned buffer, such as a shared memory region, that receives the state of the bodies that have
+/// an export slot. The world writes the body transforms and velocities into the buffer as part of the step,
+/// from the tasks that finalize the bodies, so there is no extra pass. The buffer starts with a b2ExportHeader
+/// and holds as many slots as fit in byteCount. The buffer must be 8 byte aligned and outlive the world
+/// or be replaced. Pass NULL to stop exporting. Sleeping bodies keep the state of their last awake step.
+/// Bodies moved between steps, except by b2Body_SetExportSlot, show up after the next step.
+/// @see b2Body_SetExportSlot, b2ReadExportBuffer
+B2_API void b2World_SetExportBuffer( b2WorldId worldId, void* buffer, int byteCount );
+
+/// Get the number of slots in the state export buffer, zero if there is none
+B2_API int b2World_GetExportCapacity( b2WorldId worldId );
+
+/// Copy the state of some export slots from an export buffer. This does not need the world and may run
+/// on another thread or in another process while the world steps. Leave an array NULL to skip it.
+/// @param buffer the export buffer, see b2World_SetExportBuffer
+/// @param slots the slots to read
+/// @param count the number of slots
+/// @param arrays receives count entries per array
+/// @param stepIndex optionally receives the number of completed steps of the state
+/// @return false if the world was writing the buffer, in which case the copy is incomplete and should be retried
+B2_API bool b2ReadExportBuffer( const void* buffer, const int* slots, int count, const b2BodyStateArrays* arrays,
+								uint64_t* stepIndex );
+
+/// Set the joint prepare tolerance. See b2WorldDef::jointPrepareTolerance.
+B2_API void b2World_SetJointPrepareTolerance( b2WorldId worldId, float tolerance );
+
+/// Get the joint prepare tolerance
+B2_API float b2World_GetJointPrepareTolerance( b2WorldId worldId );
+
+/// Set the largest island solved by its own task. See b2WorldDef::islandSolveBodyCount.
+B2_API void b2World_SetIslandSolveBodyCount( b2WorldId worldId, int bodyCount );
+
+/// Get the largest island solved by its own task
+B2_API int b2World_GetIslandSolveBodyCount( b2WorldId worldId );
+
 /// Get world counters and sizes
 B2_API b2Counters b2World_GetCounters( b2WorldId worldId );
 
-/// Get max capacity. This can be used with b2WorldDef to avoid run-time allocations and copies
+/// Enable the detailed counters in b2Counters, which show why the broad-phase, narrow phase and
+/// continuous collision are expensive. These are gathered per worker and have a small cost, so they are
+/// disabled by default.
+B2_API void b2World_EnableDetailedCounters( b2WorldId worldId, bool flag );
+
+/// Get the peak capacity used so far, covering every container sized by b2Capacity. This can be used with
+/// b2WorldDef::capacity to avoid run-time allocations and copies.
 B2_API b2Capacity b2World_GetMaxCapacity( b2WorldId worldId );
 
 /// Set the user data pointer.
@@ -202,12 +597,136 @@ B2_API void b2World_SetWorkerCount( b2WorldId worldId, int count );
 /// Get the worker count.
 B2_API int b2World_GetWorkerCount( b2WorldId worldId );
 
+/// Enable/disable automatic worker counts. See b2WorldDef::enableAutoWorkers.
+B2_API void b2World_EnableAutoWorkers( b2WorldId worldId, bool flag );
+
+/// Are automatic worker counts enabled?
+B2_API bool b2World_IsAutoWorkersEnabled( b2WorldId worldId );
+
+/// Set how solver threads wait for each other. See b2WorldDef::waitPolicy and b2WorldDef::waitSpinCount.
+B2_API void b2World_SetWaitPolicy( b2WorldId worldId, b2WaitPolicy policy, int spinCount );
+
+/// Get the solver wait policy
+B2_API b2WaitPolicy b2World_GetWaitPolicy( b2WorldId worldId );
+
 /// Dump memory stats to box2d_memory.txt
 B2_API void b2World_DumpMemoryStats( b2WorldId worldId );
 
-/// This is for internal testing
+/// Get the heap memory held by the world, by subsystem. Use this to track memory growth and to tune
+/// b2WorldDef::capacity.
+B2_API b2MemoryStats b2World_GetMemoryStats( b2WorldId worldId );
+
+/// Get the byte sizes of the structures stored for each body, shape, contact and joint
+B2_API b2ObjectSizes b2GetObjectSizes( void );
+
+/// Fully rebuild the static tree and store it as compact quantized nodes. Call this after loading
+/// static geometry. Adding or removing static shapes afterwards drops the compact nodes.
 B2_API void b2World_RebuildStaticTree( b2WorldId worldId );
 
+/// Rebuild the static tree on a background thread from a copy of it. The current static tree keeps serving
+/// pair finding and queries meanwhile. The first step after the rebuild is done swaps in the new tree,
+/// applying the static shapes added, removed or moved since the copy. Does nothing if a rebuild is pending.
+/// b2World_RebuildStaticTree waits for a pending rebuild.
+B2_API void b2World_RebuildStaticTreeAsync( b2WorldId worldId );
+
+/// Is an asynchronous static tree rebuild pending? @see b2World_RebuildStaticTreeAsync
+B2_API bool b2World_IsStaticTreeRebuilding( b2WorldId worldId );
+
+/// Bake the static geometry of a world into a caller buffer, for example offline when building a level.
+/// The world must only hold enabled static bodies and no joints. The static tree is rebuilt first.
+/// Compound shapes cannot be baked because they reference a b2Compound owned by the application.
+/// The baked data has no pointers, so it can be saved to a file and memory mapped for loading.
+/// Body and shape user data is not baked.
+/// Pass a null buffer to get the number of bytes needed.
+/// @return the number of bytes written, or zero if the buffer is too small or the world cannot be baked
+B2_API int b2World_BakeStatic( b2WorldId worldId, void* buffer, int capacity );
+
+/// Load static geometry baked by b2World_BakeStatic into a world that has not created any bodies.
+/// The bodies, shapes and static tree are copied in bulk without creating shapes or rebuilding the
+/// tree, and keep the ids they had in the baked world. The data must come from the same build.
+/// @return false if the data is not a bake from this build or the world already has bodies
+/// @warning This must not be called during a step.
+B2_API bool b2World_LoadStatic( b2WorldId worldId, const void* data, int size );
+
+/// Release memory held by a long-running world after many objects have been destroyed. This trims
+/// free slots at the end of the id ranges, releases unused array capacity, rehashes the broad-phase
+/// sets, and rebuilds the broad-phase trees into compact node pools. Capacity reserved using
+/// b2WorldDef::capacity is released as well.
+/// Ids are stable: ids of live bodies, shapes, chains, joints, and contacts are never renumbered
+/// and ids of destroyed objects remain invalid. Freed ids may be reused by objects created later,
+/// as they are without compaction.
+/// This is expensive and must not be called during a step.
+B2_API void b2World_Compact( b2WorldId worldId );
+
+/// Get the number of bytes needed by b2World_Snapshot for the current world state.
+/// This walks the same data as the snapshot, so it costs about as much as taking one.
+B2_API int b2World_GetSnapshotSize( b2WorldId worldId );
+
+/// Copy the simulation state into a caller buffer, for example to roll back and re-simulate for
+/// networking. This includes bodies, shapes, joints, contacts, islands, sensors and the broad-phase.
+/// World settings, callbacks and events are not included.
+/// @return the number of bytes written, or zero if the buffer is too small
+/// @warning This must not be called during a step.
+B2_API int b2World_Snapshot( b2WorldId worldId, void* buffer, int capacity );
+
+/// Restore the simulation state written by b2World_Snapshot for this world. The state is copied back
+/// into the existing storage without re-creating contacts or proxies, and stepping after a restore
+/// gives the same result as stepping after the snapshot was taken. Objects created after the snapshot
+/// are gone and destroyed objects come back, including their ids and user data. Pending events
+/// are cleared. The snapshot must come from the same world, build and worker count.
+/// @return false if the buffer does not hold a snapshot of this world
+/// @warning This must not be called during a step.
+B2_API bool b2World_Restore( b2WorldId worldId, const void* buffer, int size );
+
+/// Get the number of bytes needed by b2World_SnapshotDelta for the current world state.
+/// @return zero if no key frame exists yet
+B2_API int b2World_GetSnapshotDeltaSize( b2WorldId worldId );
+
+/// Copy the simulation state changed since the key frame into a caller buffer. The key frame is the
+/// last snapshot taken by b2World_Snapshot or restored by b2World_Restore. Sleeping solver sets and
+/// broad-phase trees that did not change are left out, so a delta taken every frame mostly holds the
+/// awake bodies.
+/// @return the number of bytes written, or zero if the buffer is too small or there is no key frame
+/// @warning This must not be called during a step.
+B2_API int b2World_SnapshotDelta( b2WorldId worldId, void* buffer, int capacity );
+
+/// Restore the simulation state of a delta written by b2World_SnapshotDelta. The base is the key frame
+/// snapshot the delta was written against and must still be the key frame of the world, so only the
+/// objects changed since then are copied. The key frame does not change.
+/// @return false if the buffers do not hold a key frame of this world and a delta written against it
+/// @warning This must not be called during a step.
+B2_API bool b2World_RestoreDelta( b2WorldId worldId, const void* base, int baseSize, const void* delta, int deltaSize );
+
+/// Get the number of bytes of the recording of a world created with b2WorldDef::enableRecording.
+B2_API int b2World_GetRecordingSize( b2WorldId worldId );
+
+/// Copy the recording into a caller buffer, for example to save a capture of a game for a performance
+/// report. The recording holds the world definition and the creation and destruction of bodies, tiles,
+/// shapes, chains and joints, transforms, velocities, forces, impulses, queued body commands, gravity and time
+/// steps. User data, names and callbacks are not recorded, and neither are other setters such as materials
+/// or joint motors. Recordings are only valid for the build that wrote them.
+/// @return the number of bytes written, or zero if the buffer is too small or the world is not recording
+B2_API int b2World_GetRecording( b2WorldId worldId, void* buffer, int capacity );
+
+/// Create a world that replays a recording. The world uses the recorded definition except for the worker
+/// count, task system, affinity and user data, which come from def. The recording must stay alive until
+/// the world is destroyed. Recorded compound shapes use compounds owned by the replay world.
+/// @return a null id if the buffer does not hold a recording written by this build
+B2_API b2WorldId b2CreateReplayWorld( const void* recording, int size, const b2WorldDef* def );
+
+/// Apply the recorded calls up to the next time step and take that step.
+/// @return false once the recording has no more steps or when a recorded id does not match the replay
+B2_API bool b2World_ReplayStep( b2WorldId worldId );
+
+/// Hash the body transforms and velocities, for example to detect desyncs in lockstep networking.
+/// The bodies are hashed in fixed chunks on the worker threads, so the hash does not depend on the worker
+/// count. Two worlds that were stepped identically give the same hash. Static and disabled bodies are
+/// not included.
+/// @param worldId the world to hash
+/// @param includeContacts also hash the impulses of the touching awake contacts
+/// @warning This must not be called during a step.
+B2_API uint32_t b2World_ComputeStateHash( b2WorldId worldId, bool includeContacts );
+
 /// This is for internal testing
 B2_API void b2World_EnableSpeculative( b2WorldId worldId, bool flag );
 
@@ -228,10 +747,48 @@ B2_API void b2World_EnableSpeculative( b2WorldId worldId, bool flag );
 /// @warning This function is locked during callbacks.
 B2_API b2BodyId b2CreateBody( b2WorldId worldId, const b2BodyDef* def );
 
+/// Create many bodies with one polygon each. This is much faster than calling b2CreateBody and
+/// b2CreatePolygonShape in a loop because storage is reserved once and the broad-phase proxies
+/// are built in bulk. Useful for spawning debris.
+/// @param worldId the world
+/// @param bodyDefs the definition of each body
+/// @param shapeDefs the definition of each body's shape
+/// @param polygons the polygon of each body in local space
+/// @param count the number of bodies to create
+/// @param bodyIds optionally receives the id of each new body. May be NULL.
+/// @warning This function is locked during callbacks.
+B2_API void b2CreateBodies( b2WorldId worldId, const b2BodyDef* bodyDefs, const b2ShapeDef* shapeDefs,
+							const b2Polygon* polygons, int count, b2BodyId* bodyIds );
+
+/// Prepare a static tile. This copies the polygons and builds the tile's broad-phase subtree. It does
+/// not access any world, so it is safe to call on a loader thread.
+/// @param bodyDef the static body definition of the tile
+/// @param shapeDef the definition used for every shape
+/// @param polygons the polygons in body local space
+/// @param count the number of polygons, at least one
+B2_API b2StaticTile b2MakeStaticTile( const b2BodyDef* bodyDef, const b2ShapeDef* shapeDef, const b2Polygon* polygons,
+									  int count );
+
+/// Free the memory of a static tile. Bodies created from the tile are not affected.
+B2_API void b2DestroyStaticTile( b2StaticTile* tile );
+
+/// Create the static body of a tile and graft the tile's prebuilt subtree into the broad-phase.
+/// Destroy the body with b2DestroyBody to unload the tile.
+/// @warning This function is locked during callbacks.
+B2_API b2BodyId b2CreateTileBody( b2WorldId worldId, const b2StaticTile* tile );
+
 /// Destroy a rigid body given an id. This destroys all shapes and joints attached to the body.
 /// Do not keep references to the associated shapes and joints.
 B2_API void b2DestroyBody( b2BodyId bodyId );
 
+/// Destroy many bodies at once. This is much faster than calling b2DestroyBody in a loop when clearing
+/// a whole area. Contacts and joints between destroyed bodies don't wake anything, islands that are
+/// fully destroyed are dropped whole and the broad-phase proxies are removed in bulk.
+/// @param bodyIds the bodies to destroy. These must be unique and belong to the same world.
+/// @param count the number of bodies
+/// @warning This function is locked during callbacks.
+B2_API void b2DestroyBodies( const b2BodyId* bodyIds, int count );
+
 /// Body identifier validation. A valid body exists in a world and is non-null.
 /// This can be used to detect orphaned ids. Provides validation for up to 64K allocations.
 B2_API bool b2Body_IsValid( b2BodyId id );
@@ -438,6 +995,21 @@ B2_API void b2Body_SetSleepThreshold( b2BodyId bodyId, float sleepThreshold );
 /// Get the sleep threshold, usually in meters per second.
 B2_API float b2Body_GetSleepThreshold( b2BodyId bodyId );
 
+/// Set the number of steps between simulation updates of this body's island. Zero or one simulates every step.
+/// @see b2BodyDef::simulationInterval
+B2_API void b2Body_SetSimulationInterval( b2BodyId bodyId, int interval );
+
+/// Get the number of steps between simulation updates of this body's island.
+B2_API int b2Body_GetSimulationInterval( b2BodyId bodyId );
+
+/// Set the slot that receives the state of this body in the export buffer and write the current state.
+/// Use -1 to stop exporting the body. Slots are owned by the caller and must be unique.
+/// @see b2World_SetExportBuffer
+B2_API void b2Body_SetExportSlot( b2BodyId bodyId, int slot );
+
+/// Get the export slot of this body, -1 if it has none
+B2_API int b2Body_GetExportSlot( b2BodyId bodyId );
+
 /// Returns true if this body is enabled
 B2_API bool b2Body_IsEnabled( b2BodyId bodyId );
 
@@ -499,6 +1071,35 @@ B2_API int b2Body_GetContactData( b2BodyId bodyId, b2ContactData* contactData, i
 /// If there are no shapes attached then the returned AABB is empty and centered on the body origin.
 B2_API b2AABB b2Body_ComputeAABB( b2BodyId bodyId );
 
+/// Get a direct reference to the body simulation data. Reads through the reference skip the id lookup and
+/// the solver set indirection. See b2BodyRef for when it expires.
+B2_API b2BodyRef b2Body_GetRef( b2BodyId bodyId );
+
+/// Get the references of many bodies
+B2_API void b2World_GetBodyRefs( b2WorldId worldId, const b2BodyId* bodyIds, int count, b2BodyRef* refs );
+
+/// Check that a body reference has not expired
+B2_API bool b2BodyRef_IsValid( b2BodyRef ref );
+
+/// Get the world transform of a body. The reference must be valid, which is only checked by asserts.
+B2_API b2Transform b2BodyRef_GetTransform( b2BodyRef ref );
+
+/// Get the world position of the body origin. The reference must be valid.
+B2_API b2Vec2 b2BodyRef_GetPosition( b2BodyRef ref );
+
+/// Get the center of mass position of the body in world space. The reference must be valid.
+B2_API b2Vec2 b2BodyRef_GetWorldCenterOfMass( b2BodyRef ref );
+
+/// Get the linear velocity of the center of mass. Zero for sleeping bodies. The reference must be valid.
+B2_API b2Vec2 b2BodyRef_GetLinearVelocity( b2BodyRef ref );
+
+/// Get the angular velocity in radians per second. Zero for sleeping bodies. The reference must be valid.
+B2_API float b2BodyRef_GetAngularVelocity( b2BodyRef ref );
+
+/// Copy the transforms and velocities of many bodies into caller owned arrays without validating the
+/// references, except by asserts
+B2_API void b2BodyRef_GetStates( const b2BodyRef* refs, int count, const b2BodyStateArrays* arrays );
+
 /** @} */
 
 /**
@@ -528,6 +1129,11 @@ B2_API b2ShapeId b2CreateCapsuleShape( b2BodyId bodyId, const b2ShapeDef* def, c
 /// @return the shape id for accessing the shape
 B2_API b2ShapeId b2CreatePolygonShape( b2BodyId bodyId, const b2ShapeDef* def, const b2Polygon* polygon );
 
+/// Create a compound shape and attach it to a body. The shape definition is cloned but the compound is
+/// referenced, so it must outlive the shape. Contacts are not created until the next time step.
+/// @return the shape id for accessing the shape
+B2_API b2ShapeId b2CreateCompoundShape( b2BodyId bodyId, const b2ShapeDef* def, const b2Compound* compound );
+
 /// Destroy a shape. You may defer the body mass update which can improve performance if several shapes on a
 ///	body are destroyed at once.
 ///	@see b2Body_ApplyMassFromShapes
@@ -650,6 +1256,9 @@ B2_API b2Capsule b2Shape_GetCapsule( b2ShapeId shapeId );
 /// Get a copy of the shape's convex polygon. Asserts the type is correct.
 B2_API b2Polygon b2Shape_GetPolygon( b2ShapeId shapeId );
 
+/// Get the compound used by a compound shape. Asserts the type is correct.
+B2_API const b2Compound* b2Shape_GetCompound( b2ShapeId shapeId );
+
 /// Allows you to change a shape to be a circle or update the current circle.
 /// This does not modify the mass properties.
 /// @see b2Body_ApplyMassFromShapes
@@ -687,6 +1296,13 @@ B2_API int b2Shape_GetContactData( b2ShapeId shapeId, b2ContactData* contactData
 /// @returns the required capacity to get all the overlaps in b2Shape_GetSensorData
 B2_API int b2Shape_GetSensorCapacity( b2ShapeId shapeId );
 
+/// Set the number of steps between overlap updates of a sensor shape. Zero or one updates every step.
+/// @see b2ShapeDef::sensorUpdateInterval
+B2_API void b2Shape_SetSensorUpdateInterval( b2ShapeId shapeId, int interval );
+
+/// Get the number of steps between overlap updates of a sensor shape. This returns 0 if the provided shape is not a sensor.
+B2_API int b2Shape_GetSensorUpdateInterval( b2ShapeId shapeId );
+
 /// Get the overlap data for a sensor shape computed the previous world step.
 /// @param shapeId the id of a sensor shape
 /// @param visitorIds a user allocated array that is filled with the overlapping shapes (visitors)
@@ -708,7 +1324,8 @@ B2_API b2Vec2 b2Shape_GetClosestPoint( b2ShapeId shapeId, b2Vec2 target );
 
 /// Apply a wind force to the body for this shape using the density of air. This considers
 /// the projected area of the shape in the wind direction. This also considers
-/// the relative velocity of the shape.
+/// the relative velocity of the shape. Applies to circles, capsules, polygons and compounds of a
+/// single polygon.
 /// @param shapeId the shape id
 /// @param wind the wind velocity in world space
 /// @param drag the drag coefficient, the force that opposes the relative velocity
@@ -1300,3 +1917,69 @@ B2_API bool b2Contact_IsValid( b2ContactId id );
 B2_API b2ContactData b2Contact_GetData( b2ContactId contactId );
 
 /**@}*/
+
+/**
+ * @defgroup shard Shards
+ * Spatial sharding for worlds that outgrow one step. Space is split into a grid of shards, each simulated
+ * by its own world. A body added to the grid is owned by one shard. Near a border it is mirrored in the
+ * neighboring shard as a kinematic ghost body and once it crosses the border it is handed off to the
+ * neighbor. Ghosts push the bodies of the neighbor, but are only moved by their owner.
+ *
+ * Shards exchange border state messages, so shards may live on other processes or nodes. Messages are
+ * only valid for the build that wrote them and user data pointers are only meaningful within one process.
+ * Joints, chain segments and compound shapes are not carried across borders. Static geometry is created
+ * by the user in each shard that needs it.
+ * @{
+ */
+
+/// Create a shard grid and the worlds of its shards
+B2_API b2ShardGrid* b2CreateShardGrid( const b2ShardGridDef* def );
+
+/// Destroy a shard grid and the worlds of its shards
+B2_API void b2DestroyShardGrid( b2ShardGrid* grid );
+
+/// Get the number of shards
+B2_API int b2ShardGrid_GetShardCount( const b2ShardGrid* grid );
+
+/// Get the world of a shard. Use this to create static geometry and the bodies added with b2ShardGrid_AddBody.
+B2_API b2WorldId b2ShardGrid_GetWorld( const b2ShardGrid* grid, int shardIndex );
+
+/// Get the shard that covers a point
+B2_API int b2ShardGrid_FindShard( const b2ShardGrid* grid, b2Vec2 point );
+
+/// Let the grid move a body between shards. The body must belong to the world of a shard.
+/// @return a key that identifies the body across shards, never zero
+B2_API uint64_t b2ShardGrid_AddBody( b2ShardGrid* grid, b2BodyId bodyId );
+
+/// Destroy a body added with b2ShardGrid_AddBody and its ghosts
+B2_API void b2ShardGrid_RemoveBody( b2ShardGrid* grid, uint64_t key );
+
+/// Get the body for a key. The body id changes when a body is handed off to another shard.
+/// @return a null id if no local shard owns the body
+B2_API b2BodyId b2ShardGrid_GetBody( const b2ShardGrid* grid, uint64_t key );
+
+/// Get the number of bodies owned by a shard
+B2_API int b2ShardGrid_GetOwnedCount( const b2ShardGrid* grid, int shardIndex );
+
+/// Get the number of ghost bodies in a shard
+B2_API int b2ShardGrid_GetGhostCount( const b2ShardGrid* grid, int shardIndex );
+
+/// Step the worlds of all shards with b2StepWorlds and then exchange the border state of each pair of
+/// neighboring shards in shard order. A body should not move across more than one shard per step.
+B2_API void b2ShardGrid_Step( b2ShardGrid* grid, float timeStep, int subStepCount );
+
+/// Get the number of bytes needed by b2ShardGrid_WriteBorderState
+B2_API int b2ShardGrid_GetBorderStateSize( b2ShardGrid* grid, int shardIndex, int targetIndex );
+
+/// Write the border state a shard sends to a neighbor after its step: the bodies handed off to the neighbor
+/// and the full list of ghosts the neighbor should have. The bodies handed off are destroyed in the shard, so
+/// the message must be delivered. Use this with b2ShardGrid_ReadBorderState when shards run on other processes.
+/// @return the number of bytes written, or zero if the buffer is too small
+B2_API int b2ShardGrid_WriteBorderState( b2ShardGrid* grid, int shardIndex, int targetIndex, void* buffer, int capacity );
+
+/// Apply a border state message to its target shard. Handed off bodies are created, ghosts are created or
+/// moved and the ghosts of the source that are no longer listed are destroyed.
+/// @return false if the buffer does not hold a border state message for this grid
+B2_API bool b2ShardGrid_ReadBorderState( b2ShardGrid* grid, const void* buffer, int size );
+
+/**@}*/
@@ -0,0 +1,205 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "box2d.h"
+
+#include <concepts>
+#include <memory>
+#include <span>
+#include <type_traits>
+
+/**
+ * @defgroup cpp C++ Layer
+ * Optional header-only C++20 layer over the bulk functions of box2d.h. Spans are passed straight through
+ * as a pointer and a count, so nothing is copied or allocated. The query visitors take any callable. The
+ * callable is inlined into a small trampoline that is handed to the C query, so a lambda costs the same
+ * single indirect call per shape as a hand written b2OverlapResultFcn.
+ * @{
+ */
+
+namespace b2
+{
+
+/// Destination spans for b2World_GetBodyStates and friends. Empty spans are skipped, the others must hold
+/// an entry for every body.
+struct BodyStateSpans
+{
+	std::span<b2Vec2> positions = {};
+	std::span<b2Rot> rotations = {};
+	std::span<b2Vec2> linearVelocities = {};
+	std::span<float> angularVelocities = {};
+
+	b2BodyStateArrays ToArrays( size_t count ) const
+	{
+		B2_ASSERT( positions.empty() || positions.size() >= count );
+		B2_ASSERT( rotations.empty() || rotations.size() >= count );
+		B2_ASSERT( linearVelocities.empty() || linearVelocities.size() >= count );
+		B2_ASSERT( angularVelocities.empty() || angularVelocities.size() >= count );
+		( void )count;
+
+		b2BodyStateArrays arrays;
+		arrays.positions = positions.empty() ? nullptr : positions.data();
+		arrays.rotations = rotations.empty() ? nullptr : rotations.data();
+		arrays.linearVelocities = linearVelocities.empty() ? nullptr : linearVelocities.data();
+		arrays.angularVelocities = angularVelocities.empty() ? nullptr : angularVelocities.data();
+		return arrays;
+	}
+};
+
+/// @see b2CreateBodies
+inline void CreateBodies( b2WorldId worldId, std::span<const b2BodyDef> bodyDefs, std::span<const b2ShapeDef> shapeDefs,
+						  std::span<const b2Polygon> polygons, std::span<b2BodyId> bodyIds = {} )
+{
+	B2_ASSERT( shapeDefs.size() == bodyDefs.size() && polygons.size() == bodyDefs.size() );
+	B2_ASSERT( bodyIds.empty() || bodyIds.size() == bodyDefs.size() );
+	b2CreateBodies( worldId, bodyDefs.data(), shapeDefs.data(), polygons.data(), static_cast<int>( bodyDefs.size() ),
+					bodyIds.empty() ? nullptr : bodyIds.data() );
+}
+
+/// @see b2DestroyBodies
+inline void DestroyBodies( std::span<const b2BodyId> bodyIds )
+{
+	b2DestroyBodies( bodyIds.data(), static_cast<int>( bodyIds.size() ) );
+}
+
+/// @see b2World_GetBodyStates
+inline void GetBodyStates( b2WorldId worldId, std::span<const b2BodyId> bodyIds, const BodyStateSpans& states )
+{
+	b2BodyStateArrays arrays = states.ToArrays( bodyIds.size() );
+	b2World_GetBodyStates( worldId, bodyIds.data(), static_cast<int>( bodyIds.size() ), &arrays );
+}
+
+/// @see b2World_GetAwakeBodyStates
+/// @return the number of awake bodies, which may exceed the size of bodyIds
+inline int GetAwakeBodyStates( b2WorldId worldId, std::span<b2BodyId> bodyIds, const BodyStateSpans& states )
+{
+	b2BodyStateArrays arrays = states.ToArrays( bodyIds.size() );
+	return b2World_GetAwakeBodyStates( worldId, bodyIds.data(), static_cast<int>( bodyIds.size() ), &arrays );
+}
+
+/// @see b2BodyRef_GetStates
+inline void GetBodyStates( std::span<const b2BodyRef> refs, const BodyStateSpans& states )
+{
+	b2BodyStateArrays arrays = states.ToArrays( refs.size() );
+	b2BodyRef_GetStates( refs.data(), static_cast<int>( refs.size() ), &arrays );
+}
+
+/// @see b2World_GetInterpolatedTransforms
+inline void GetInterpolatedTransforms( b2WorldId worldId, float alpha, std::span<const b2BodyId> bodyIds,
+									   std::span<b2Transform> transforms )
+{
+	B2_ASSERT( transforms.size() >= bodyIds.size() );
+	b2World_GetInterpolatedTransforms( worldId, alpha, bodyIds.data(), static_cast<int>( bodyIds.size() ), transforms.data() );
+}
+
+/// @see b2World_QueueBodyCommands
+inline void QueueBodyCommands( b2WorldId worldId, int bufferIndex, std::span<const b2BodyCommand> commands )
+{
+	b2World_QueueBodyCommands( worldId, bufferIndex, commands.data(), static_cast<int>( commands.size() ) );
+}
+
+/// @see b2World_OverlapAABBs
+/// @return the total number of results, which may exceed the size of results
+inline int OverlapAABBs( b2WorldId worldId, std::span<const b2AABB> aabbs, std::span<const b2QueryFilter> filters,
+						 std::span<b2OverlapHit> results )
+{
+	B2_ASSERT( filters.size() == aabbs.size() );
+	return b2World_OverlapAABBs( worldId, aabbs.data(), filters.data(), static_cast<int>( aabbs.size() ), results.data(),
+								 static_cast<int>( results.size() ) );
+}
+
+/// @see b2World_OverlapShapes
+/// @return the total number of results, which may exceed the size of results
+inline int OverlapShapes( b2WorldId worldId, std::span<const b2ShapeProxy> proxies, std::span<const b2QueryFilter> filters,
+						  std::span<b2OverlapHit> results )
+{
+	B2_ASSERT( filters.size() == proxies.size() );
+	return b2World_OverlapShapes( worldId, proxies.data(), filters.data(), static_cast<int>( proxies.size() ),
+								  results.data(), static_cast<int>( results.size() ) );
+}
+
+/// @see b2World_CastRaysClosest
+inline void CastRaysClosest( b2WorldId worldId, std::span<const b2Vec2> origins, std::span<const b2Vec2> translations,
+							 b2QueryFilter filter, std::span<b2RayResult> results )
+{
+	B2_ASSERT( translations.size() == origins.size() && results.size() >= origins.size() );
+	b2World_CastRaysClosest( worldId, origins.data(), translations.data(), static_cast<int>( origins.size() ), filter,
+							 results.data() );
+}
+
+/// @see b2World_CastShapesClosest
+inline void CastShapesClosest( b2WorldId worldId, std::span<const b2ShapeProxy> proxies, std::span<const b2Vec2> translations,
+							   b2QueryFilter filter, std::span<b2RayResult> results )
+{
+	B2_ASSERT( translations.size() == proxies.size() && results.size() >= proxies.size() );
+	b2World_CastShapesClosest( worldId, proxies.data(), translations.data(), static_cast<int>( proxies.size() ), filter,
+							   results.data() );
+}
+
+/// Overlap visitor, return false to stop the query
+template <typename F>
+concept OverlapVisitor = std::predicate<F&, b2ShapeId>;
+
+/// Cast visitor, returns the clip fraction like b2CastResultFcn
+template <typename F>
+concept CastVisitor = std::invocable<F&, b2ShapeId, b2Vec2, b2Vec2, float> &&
+					  std::convertible_to<std::invoke_result_t<F&, b2ShapeId, b2Vec2, b2Vec2, float>, float>;
+
+namespace detail
+{
+template <typename F>
+void* ToContext( F& visitor )
+{
+	return const_cast<void*>( static_cast<const void*>( std::addressof( visitor ) ) );
+}
+
+template <typename F>
+bool OverlapTrampoline( b2ShapeId shapeId, void* context )
+{
+	return ( *static_cast<F*>( context ) )( shapeId );
+}
+
+template <typename F>
+float CastTrampoline( b2ShapeId shapeId, b2Vec2 point, b2Vec2 normal, float fraction, void* context )
+{
+	return ( *static_cast<F*>( context ) )( shapeId, point, normal, fraction );
+}
+} // namespace detail
+
+/// @see b2World_OverlapAABB
+template <OverlapVisitor F>
+b2TreeStats OverlapAABB( b2WorldId worldId, b2AABB aabb, b2QueryFilter filter, F&& visitor )
+{
+	using V = std::remove_reference_t<F>;
+	return b2World_OverlapAABB( worldId, aabb, filter, &detail::OverlapTrampoline<V>, detail::ToContext( visitor ) );
+}
+
+/// @see b2World_OverlapShape
+template <OverlapVisitor F>
+b2TreeStats OverlapShape( b2WorldId worldId, const b2ShapeProxy& proxy, b2QueryFilter filter, F&& visitor )
+{
+	using V = std::remove_reference_t<F>;
+	return b2World_OverlapShape( worldId, &proxy, filter, &detail::OverlapTrampoline<V>, detail::ToContext( visitor ) );
+}
+
+/// @see b2World_CastRay
+template <CastVisitor F>
+b2TreeStats CastRay( b2WorldId worldId, b2Vec2 origin, b2Vec2 translation, b2QueryFilter filter, F&& visitor )
+{
+	using V = std::remove_reference_t<F>;
+	return b2World_CastRay( worldId, origin, translation, filter, &detail::CastTrampoline<V>, detail::ToContext( visitor ) );
+}
+
+/// @see b2World_CastShape
+template <CastVisitor F>
+b2TreeStats CastShape( b2WorldId worldId, const b2ShapeProxy& proxy, b2Vec2 translation, b2QueryFilter filter, F&& visitor )
+{
+	using V = std::remove_reference_t<F>;
+	return b2World_CastShape( worldId, &proxy, translation, filter, &detail::CastTrampoline<V>, detail::ToContext( visitor ) );
+}
+
+} // namespace b2
+
+/** @} */
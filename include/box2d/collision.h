@@ -307,6 +307,56 @@ B2_API b2Hull b2ComputeHull( const b2Vec2* points, int count );
 /// This is expensive and should not be called at runtime.
 B2_API bool b2ValidateHull( const b2Hull* hull );
 
+/// A compound is a set of convex polygons in one frame, such as the convex decomposition of a concave
+/// outline. A compound shape puts all of them under one broad-phase proxy with one contact per shape
+/// pair, instead of one shape, proxy and contact per polygon. The polygons are kept in a small 4-wide
+/// bounding volume hierarchy so collision only visits the polygons near the other shape.
+/// A compound is immutable and may be shared by many shapes. It must outlive the shapes that use it,
+/// including those of world clones and snapshots.
+/// A compound of a single polygon is shared polygon geometry for instanced content, such as thousands
+/// of identical crates. Its mass is computed once and collision goes straight to the polygon.
+typedef struct b2Compound b2Compound;
+
+/// Create a compound from convex polygons given in the shape frame. The polygons are copied.
+/// Returns NULL if there are no polygons.
+B2_API b2Compound* b2CreateCompound( const b2Polygon* polygons, int count );
+
+/// Destroy a compound. Destroy the shapes using it first.
+B2_API void b2DestroyCompound( b2Compound* compound );
+
+/// Get the number of polygons in a compound
+B2_API int b2Compound_GetPolygonCount( const b2Compound* compound );
+
+/// Get the polygons of a compound. These are in the order given to b2CreateCompound.
+B2_API const b2Polygon* b2Compound_GetPolygons( const b2Compound* compound );
+
+/// Decompose a simple polygon into convex polygons with at most B2_MAX_POLYGON_VERTICES vertices. The
+/// outline may be clockwise or counter-clockwise but must not have holes or self intersections. This ear
+/// clips the outline into triangles and then merges neighbors while the result stays convex. Meant for
+/// processing art assets offline or at load time.
+/// @param points the outline
+/// @param count the number of points, at least 3
+/// @param radius the radius of the resulting polygons
+/// @param polygons the output polygons, may be NULL to count them
+/// @param capacity the capacity of polygons
+/// @returns the number of convex polygons. Only the first capacity polygons are written.
+B2_API int b2DecomposePolygon( const b2Vec2* points, int count, float radius, b2Polygon* polygons, int capacity );
+
+/// Compute mass properties of a compound
+B2_API b2MassData b2ComputeCompoundMass( const b2Compound* shape, float density );
+
+/// Compute the bounding box of a transformed compound
+B2_API b2AABB b2ComputeCompoundAABB( const b2Compound* shape, b2Transform transform );
+
+/// Test a point for overlap with a compound in local space
+B2_API bool b2PointInCompound( const b2Compound* shape, b2Vec2 point );
+
+/// Ray cast versus compound shape in local space. Reports the closest polygon hit.
+B2_API b2CastOutput b2RayCastCompound( const b2Compound* shape, const b2RayCastInput* input );
+
+/// Shape cast versus a compound. Reports the closest polygon hit.
+B2_API b2CastOutput b2ShapeCastCompound( const b2Compound* shape, const b2ShapeCastInput* input );
+
 /**@}*/
 
 /**
@@ -413,6 +463,11 @@ typedef struct b2Simplex
 B2_API b2DistanceOutput b2ShapeDistance( const b2DistanceInput* input, b2SimplexCache* cache, b2Simplex* simplexes,
 										 int simplexCapacity );
 
+/// Compute the closest points for a batch of independent shape pairs using SIMD. Each output and cache matches
+/// b2ShapeDistance for the same input and cache, except that no debug simplexes are recorded.
+/// The caches are input/output, one per input.
+B2_API void b2ShapeDistanceBatch( const b2DistanceInput* inputs, b2SimplexCache* caches, b2DistanceOutput* outputs, int count );
+
 /// Input parameters for b2ShapeCast
 typedef struct b2ShapeCastPairInput
 {
@@ -484,6 +539,12 @@ typedef struct b2TOIOutput
 
 	/// The sweep time of the collision 
 	float fraction;
+
+	/// Number of separating axis iterations. Each runs one distance query.
+	int distanceIterations;
+
+	/// Number of GJK iterations summed over the distance queries
+	int gjkIterations;
 } b2TOIOutput;
 
 /// Compute the upper bound on time before two shapes penetrate. Time is represented as
@@ -492,6 +553,12 @@ typedef struct b2TOIOutput
 /// again.
 B2_API b2TOIOutput b2TimeOfImpact( const b2TOIInput* input );
 
+/// Time of impact with a persistent simplex cache. The cache warm starts the distance queries and
+/// receives the simplex of the final separating axis, so calling this again for the same pair of shapes
+/// on the next sweep starts from the features that were closest. Zero initialize the cache on the first call.
+/// A cache that refers to other shapes is ignored.
+B2_API b2TOIOutput b2TimeOfImpactCached( const b2TOIInput* input, b2SimplexCache* cache );
+
 /**@}*/
 
 /**
@@ -616,6 +683,31 @@ B2_API b2Manifold b2CollideChainSegmentAndCapsule( const b2ChainSegment* segment
 B2_API b2Manifold b2CollideChainSegmentAndPolygon( const b2ChainSegment* segmentA, b2Transform xfA, const b2Polygon* polygonB,
 												   b2Transform xfB, b2SimplexCache* cache );
 
+/// Compute the contact manifold between a compound and a circle. The manifolds of the polygons near the
+/// other shape are merged into the two deepest points that share a normal, for all compound functions.
+B2_API b2Manifold b2CollideCompoundAndCircle( const b2Compound* compoundA, b2Transform xfA, const b2Circle* circleB,
+											  b2Transform xfB );
+
+/// Compute the contact manifold between a compound and a capsule
+B2_API b2Manifold b2CollideCompoundAndCapsule( const b2Compound* compoundA, b2Transform xfA, const b2Capsule* capsuleB,
+											   b2Transform xfB );
+
+/// Compute the contact manifold between a compound and a polygon
+B2_API b2Manifold b2CollideCompoundAndPolygon( const b2Compound* compoundA, b2Transform xfA, const b2Polygon* polygonB,
+											   b2Transform xfB );
+
+/// Compute the contact manifold between two compounds
+B2_API b2Manifold b2CollideCompounds( const b2Compound* compoundA, b2Transform xfA, const b2Compound* compoundB,
+									  b2Transform xfB );
+
+/// Compute the contact manifold between a segment and a compound
+B2_API b2Manifold b2CollideSegmentAndCompound( const b2Segment* segmentA, b2Transform xfA, const b2Compound* compoundB,
+											   b2Transform xfB );
+
+/// Compute the contact manifold between a chain segment and a compound
+B2_API b2Manifold b2CollideChainSegmentAndCompound( const b2ChainSegment* segmentA, b2Transform xfA,
+													const b2Compound* compoundB, b2Transform xfB );
+
 /**@}*/
 
 /**
@@ -672,6 +764,30 @@ typedef struct b2DynamicTree
 
 	/// Allocated space for rebuilding
 	int32_t rebuildCapacity;
+
+	/// 4-wide nodes used by queries while the tree is unchanged. The root is the first node.
+	struct b2WideNode* wideNodes;
+
+	/// The number of wide nodes. Zero when the wide layout is stale.
+	int32_t wideNodeCount;
+
+	/// The allocated wide node space
+	int32_t wideNodeCapacity;
+
+	/// Compact nodes with quantized bounds used by queries while the tree is unchanged
+	struct b2QuantizedNode* quantizedNodes;
+
+	/// The bounds the quantized root is relative to
+	b2AABB quantizedRootBox;
+
+	/// The number of quantized nodes. Zero when there are no valid quantized nodes.
+	int32_t quantizedNodeCount;
+
+	/// The allocated quantized node space
+	int32_t quantizedNodeCapacity;
+
+	/// The candidate subtree where the next incremental optimization resumes
+	int32_t optimizeCursor;
 } b2DynamicTree;
 
 /// These are performance results returned by dynamic tree queries.
@@ -693,9 +809,36 @@ B2_API void b2DynamicTree_Destroy( b2DynamicTree* tree );
 /// Create a proxy. Provide an AABB and a userData value.
 B2_API int b2DynamicTree_CreateProxy( b2DynamicTree* tree, b2AABB aabb, uint64_t categoryBits, uint64_t userData );
 
+/// Create many proxies at once with a bulk build instead of one insertion per proxy. The new
+/// proxies are built into a subtree that is inserted as a whole, or the whole tree is rebuilt when
+/// the batch is at least as large as the existing tree.
+/// @param tree the tree
+/// @param aabbs the proxy bounds
+/// @param categoryBits the category bits of each proxy
+/// @param userData the user data of each proxy
+/// @param count the number of proxies to create
+/// @param proxyIds receives the id of each new proxy
+B2_API void b2DynamicTree_CreateProxies( b2DynamicTree* tree, const b2AABB* aabbs, const uint64_t* categoryBits,
+										 const uint64_t* userData, int count, int* proxyIds );
+
+/// Copy all proxies of another tree into this tree as one subtree, keeping the structure of the
+/// source tree. This is linear in the source size, so the source can be built ahead of time, for
+/// example on another thread. The user data of each source proxy must be its index in
+/// [0, source proxy count).
+/// @param tree the tree
+/// @param source the tree to copy
+/// @param userData the user data of each copied proxy, indexed by the source user data
+/// @param proxyIds receives the id of each copied proxy, indexed by the source user data
+B2_API void b2DynamicTree_Graft( b2DynamicTree* tree, const b2DynamicTree* source, const uint64_t* userData, int* proxyIds );
+
 /// Destroy a proxy. This asserts if the id is invalid.
 B2_API void b2DynamicTree_DestroyProxy( b2DynamicTree* tree, int proxyId );
 
+/// Destroy many proxies at once. When the batch is a large part of the tree the tree is rebuilt
+/// from the remaining proxies. Otherwise the largest subtrees holding only these proxies are
+/// detached, so proxies that were inserted or grafted together come out in a few operations.
+B2_API void b2DynamicTree_DestroyProxies( b2DynamicTree* tree, const int* proxyIds, int count );
+
 /// Move a proxy to a new AABB by removing and reinserting into the tree.
 B2_API void b2DynamicTree_MoveProxy( b2DynamicTree* tree, int proxyId, b2AABB aabb );
 
@@ -780,8 +923,25 @@ B2_API b2AABB b2DynamicTree_GetRootBounds( const b2DynamicTree* tree );
 B2_API int b2DynamicTree_GetProxyCount( const b2DynamicTree* tree );
 
 /// Rebuild the tree while retaining subtrees that haven't changed. Returns the number of boxes sorted.
+/// A full build also builds the wide node layout.
 B2_API int b2DynamicTree_Rebuild( b2DynamicTree* tree, bool fullBuild );
 
+/// Incrementally improve the tree by fully rebuilding one subtree of at most leafBudget leaves. Each
+/// call evaluates the surface area heuristic cost of a few subtrees, resuming where the previous call
+/// stopped, and rebuilds the worst one. Call this once per step to keep the tree quality steady
+/// without the cost spike of a full rebuild. Returns the number of leaves rebuilt.
+B2_API int b2DynamicTree_Optimize( b2DynamicTree* tree, int leafBudget );
+
+/// Collapse the binary tree into 4-wide nodes with the child bounds stored as SoA so queries
+/// test four children with one SIMD compare. Queries use the wide nodes until the tree is next
+/// modified. This is intended for trees that rarely change, such as the static tree.
+B2_API void b2DynamicTree_BuildWideNodes( b2DynamicTree* tree );
+
+/// Build 32-byte nodes with 16-bit bounds quantized relative to the parent bounds. Queries use these
+/// instead of the wide nodes until the tree is next modified. This halves the memory touched by a
+/// traversal of a large tree that rarely changes, such as the static tree.
+B2_API void b2DynamicTree_BuildQuantizedNodes( b2DynamicTree* tree );
+
 /// Get the number of bytes used by this tree
 B2_API int b2DynamicTree_GetByteCount( const b2DynamicTree* tree );
 
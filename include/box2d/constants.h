@@ -18,6 +18,9 @@
 /// size array for Box2D task, which may help with creating stable user task pointers.
 #define B2_MAX_TASKS 256
 
+/// Maximum number of islands that can be split in parallel per world step. Used for some fixed size arrays.
+#define B2_MAX_ISLAND_SPLITS 16
+
 /// Maximum number of colors in the constraint graph. Constraints that cannot
 /// find a color are added to the overflow set which are solved single-threaded.
 /// The compound barrel benchmark has minor overflow with 24 colors 
@@ -56,5 +59,13 @@
 /// For small objects the margin is limited to this fraction times the maximum extent
 #define B2_AABB_MARGIN_FRACTION 0.125f
 
+/// With velocity margins the fat AABB of a moving shape covers the displacement predicted for this
+/// many time steps. See b2WorldDef::enableVelocityMargins.
+#define B2_MARGIN_LOOKAHEAD_STEPS 4.0f
+
+/// Limit of the predicted displacement covered by velocity margins. This keeps very fast bodies from
+/// creating long boxes with many pairs. Normally this is 1m.
+#define B2_MAX_MARGIN_SWEEP ( 1.0f * b2GetLengthUnitsPerMeter() )
+
 /// The time that a body must be still before it will go to sleep. In seconds.
 #define B2_TIME_TO_SLEEP 0.5f
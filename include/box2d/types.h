@@ -30,6 +30,47 @@ typedef void* b2EnqueueTaskCallback( b2TaskCallback* task, void* taskContext, vo
 /// @ingroup world
 typedef void b2FinishTaskCallback( void* userTask, void* userContext );
 
+/// Scheduling priority of a Box2D task
+/// @ingroup world
+typedef enum b2TaskPriority
+{
+	/// The step is waiting on this task. Solver workers use this priority.
+	b2_taskPriorityHigh,
+
+	/// Parallel loops that the calling thread also works on
+	b2_taskPriorityNormal,
+
+	/// Work that overlaps other stages of the step, such as rebuilding the broad-phase trees and splitting
+	/// islands. The step only waits for these near its end.
+	b2_taskPriorityBackground,
+} b2TaskPriority;
+
+/// Scheduling hints for a Box2D task. These are hints only, any schedule gives the same results.
+/// @ingroup world
+typedef struct b2TaskInfo
+{
+	/// Task name for profilers
+	const char* name;
+
+	/// Scheduling priority
+	b2TaskPriority priority;
+
+	/// Number of tasks that spin on each other and should run at the same time, one per thread. Zero
+	/// for a task that runs on its own. Running part of a gang behind unrelated long jobs stalls the rest
+	/// of the gang.
+	int gangSize;
+
+	/// Index of this task in its gang
+	int gangIndex;
+
+	/// Expected cost in bodies, constraints or proxies. Only meaningful relative to other Box2D tasks.
+	int expectedCost;
+} b2TaskInfo;
+
+/// Version of b2EnqueueTaskCallback that receives scheduling hints. The info is only valid during the call.
+/// @ingroup world
+typedef void* b2EnqueueTaskExCallback( b2TaskCallback* task, void* taskContext, const b2TaskInfo* info, void* userContext );
+
 /// Optional friction mixing callback. This intentionally provides no context objects because this is called
 /// from a worker thread.
 /// @warning This function should not attempt to modify Box2D state or user application state.
@@ -56,6 +97,17 @@ typedef struct b2RayResult
 	bool hit;
 } b2RayResult;
 
+/// Result from the batched overlap queries b2World_OverlapAABBs and b2World_OverlapShapes
+/// @ingroup world
+typedef struct b2OverlapHit
+{
+	/// Index of the query in the batch
+	int queryIndex;
+
+	/// The overlapping shape
+	b2ShapeId shapeId;
+} b2OverlapHit;
+
 /// Optional world capacities that can be used to avoid run-time allocations.
 /// @see b2World_GetMaxCapacity
 /// @ingroup world
@@ -75,8 +127,80 @@ typedef struct b2Capacity
 
 	/// Number of expected contacts.
 	int contactCount;
+
+	/// Number of expected joints.
+	int jointCount;
+
+	/// Number of expected islands. Zero uses the dynamic body count.
+	int islandCount;
+
+	/// Number of expected sensor shapes.
+	int sensorCount;
+
+	/// Number of expected chain shapes.
+	int chainCount;
+
+	/// Expected number of contact begin, end, and hit events per step.
+	int contactEventCount;
+
+	/// Expected number of sensor begin and end events per step.
+	int sensorEventCount;
+
+	/// Expected number of joint events per step.
+	int jointEventCount;
+
+	/// Size of the step stack allocator in bytes.
+	int stackByteCount;
+
+	/// Size of each worker's scratch arena in bytes.
+	int arenaByteCount;
 } b2Capacity;
 
+/// Broad-phase method used to find new pairs against dynamic proxies. Static and kinematic
+/// proxies always use a dynamic tree, as do ray casts and overlap queries.
+/// @ingroup world
+typedef enum b2BroadPhaseType
+{
+	/// Query the dynamic tree for every moved proxy. Works well for any scene.
+	b2_treeBroadPhase = 0,
+
+	/// Hash the dynamic proxies into a uniform grid each step and query the grid cells. This is
+	/// faster for dense crowds of many similar size bodies in a bounded area. Bodies much larger than
+	/// the cell size fall back to the tree.
+	b2_gridBroadPhase = 1,
+} b2BroadPhaseType;
+
+/// How solver threads wait for each other between solver stages.
+/// @ingroup world
+typedef enum b2WaitPolicy
+{
+	/// Spin for the spin budget, then yield the processor between checks. This is the default.
+	b2_waitYield = 0,
+
+	/// Always spin. Lowest latency, but a waiting thread keeps its processor busy.
+	b2_waitSpin = 1,
+
+	/// Spin for the spin budget, then sleep until woken (futex on Linux, WaitOnAddress on Windows).
+	/// This frees the processor for other processes at the cost of a few microseconds of wake up
+	/// latency. Other platforms yield instead.
+	b2_waitPark = 2,
+} b2WaitPolicy;
+
+/// Contact event filter. Contact begin, end and hit events are only reported for contacts where one of
+/// the shapes matches the filter. Only the shapes that enable contact or hit events are considered.
+/// Contacts that don't match are skipped when the events are built, so the event arrays only hold the
+/// events of interest and need no filtering by the user.
+/// @ingroup world
+typedef struct b2ContactEventFilter
+{
+	/// Report events if either shape has one of these category bits. The default is all bits.
+	uint64_t categoryBits;
+
+	/// Also report events if either shape has this user material id. Zero matches no material.
+	/// Set categoryBits to zero to filter by material only.
+	uint64_t userMaterialId;
+} b2ContactEventFilter;
+
 /// World definition used to create a simulation world.
 /// Must be initialized using b2DefaultWorldDef().
 /// @ingroup world
@@ -107,6 +231,21 @@ typedef struct b2WorldDef
 	/// Maximum linear speed. Usually meters per second.
 	float maximumLinearSpeed;
 
+	/// Filter for contact begin, end and hit events. The default reports the events of all shapes.
+	b2ContactEventFilter contactEventFilter;
+
+	/// Only report a body move event once the body moved further than this from the transform of its
+	/// previous move event. Bodies that fall asleep are always reported. Usually meters. Zero reports
+	/// every move.
+	float moveEventLinearThreshold;
+
+	/// Same as moveEventLinearThreshold for the body rotation. Radians.
+	float moveEventAngularThreshold;
+
+	/// Position quantum of the compact move deltas, see b2BodyMoveDelta. Moves that quantize to zero are
+	/// not reported unless the body fell asleep. Usually meters. Zero disables the deltas.
+	float moveEventQuantum;
+
 	/// Optional mixing callback for friction. The default uses sqrt(frictionA * frictionB).
 	b2FrictionCallback* frictionCallback;
 
@@ -119,9 +258,183 @@ typedef struct b2WorldDef
 	/// Enable continuous collision
 	bool enableContinuous;
 
+	/// Keep the time of impact simplex of the last continuous hit of each fast body and use it to warm start
+	/// the next sweep against the same shape. Fast bodies that keep hitting the same geometry step after step
+	/// converge in fewer distance iterations. Results differ slightly from uncached sweeps but are still
+	/// deterministic for any worker count.
+	bool enableContinuousCache;
+
 	/// Contact softening when mass ratios are large. Experimental.
 	bool enableContactSoftening;
 
+	/// Solve the overflow constraint color in parallel. Overflow happens when a few bodies have more
+	/// constraints than there are graph colors. These contacts are normally solved on a single thread.
+	/// In parallel mode they are solved with a Jacobi iteration and mass splitting, which
+	/// converges a bit slower but scales with the worker count. Deterministic for any worker count.
+	bool enableParallelOverflow;
+
+	/// Adaptive graph coloring. Bodies with a high constraint degree, such as a large dynamic body
+	/// carrying a pile, only take a limited number of graph colors. Their remaining contacts are moved
+	/// to the overflow color and solved against virtual sub-bodies that split the body mass, with the
+	/// results averaged. This keeps the colors balanced and the SIMD lanes full.
+	/// This implies enableParallelOverflow.
+	bool enableAdaptiveColoring;
+
+	/// Adaptive relax iterations. Contacts between bodies that moved slower than their sleep threshold
+	/// in the previous step skip the relax iterations, so nearly resting piles that are not yet asleep
+	/// cost less. Moving bodies keep the full schedule. Rolling resistance contacts are never skipped.
+	bool enableAdaptiveRelax;
+
+	/// Assert in b2World_Step if the step allocated from the heap. Steps that allocate are always counted in
+	/// b2Counters::stepAllocationCount. Enable this after the first step, once b2World_GetMaxCapacity has
+	/// been used to size b2WorldDef::capacity. Sleeping islands still allocate solver sets the first time.
+	bool enableAllocationCheck;
+
+	/// Create new contacts in parallel. The contact ids and the order of the contacts in the solver are
+	/// the same as with serial creation, so results are identical. The friction and restitution callbacks
+	/// are invoked from worker threads in this mode and must be thread-safe.
+	bool enableParallelContacts;
+
+	/// Relaxed determinism. Gives up the guarantee that results are independent of the thread count in
+	/// exchange for more parallel work. New contacts are always created in parallel and contact and sensor
+	/// events are gathered on the workers, so the order of the events may change from run to run. The
+	/// simulation itself is not affected. Meant for cosmetic or single player worlds. Implies the
+	/// thread-safety requirements of enableParallelContacts.
+	bool enableRelaxedDeterminism;
+
+	/// Run the narrow phase in batches of contacts with the same pair of shape types, so each worker
+	/// runs long stretches of the same manifold function. Results are identical.
+	bool enableSortedCollide;
+
+	/// Run the narrow phase of the existing contacts in the same parallel pass as the pair finding and only
+	/// collide the new contacts after the pairs are found. This removes a barrier from the step. Results are
+	/// identical. The pair profile then includes the narrow phase of the existing contacts.
+	bool enablePipelinedCollide;
+
+	/// Prepare the contact constraints of the graph colors in the narrow phase, right after each contact is
+	/// updated, instead of in a separate pass of the solver. Colors that a contact joins or leaves before the
+	/// solve are prepared again by the solver. Results are identical.
+	bool enableFusedPrepare;
+
+	/// Remember the bodies of removed contacts and joints, so an island split only searches the island
+	/// graph near the removed constraints instead of running union-find over the whole island. The search
+	/// grows from both bodies of a removed constraint and stops when the two sides meet or the smaller side
+	/// runs out, so the cost is proportional to the part of the island that breaks off. Helps large
+	/// persistent structures such as bridges and towers that lose a few contacts at a time.
+	bool enableIncrementalIslands;
+
+	/// Only recompute the overlaps of a sensor when something may have changed them: the sensor moved, a
+	/// moving shape swept through its bounds, or shapes were created, destroyed or modified outside the
+	/// time step. Idle sensors such as static trigger volumes are then free, so the sensor update scales
+	/// with movement instead of the sensor count. Overlaps and events are the same as the full update as
+	/// long as the custom filter callback gives the same answer for shapes that have not changed.
+	bool enableIncrementalSensors;
+
+	/// Only query the part of a moved proxy's fat AABB that it did not cover at its last pair query, as up
+	/// to four boxes around the old fat AABB. The shapes inside the old fat AABB already have a contact, so
+	/// the full query mostly finds existing pairs. Helps large shapes that drift slowly. Pairs are the same
+	/// as the full query as long as the custom filter callback gives the same answer for shapes that have
+	/// not changed, but contacts may be created in a different order.
+	bool enableIncrementalPairs;
+
+	/// Record the world definition and the calls that change the world, so a capture of a game can be
+	/// replayed and timed without the game. See b2World_GetRecording and b2CreateReplayWorld.
+	bool enableRecording;
+
+	/// Store the contacts of sleeping islands in a compact form, about a quarter of the size. The
+	/// warm starting impulses are kept as half floats and the manifold is recomputed when the island
+	/// wakes. Helps large worlds where most contacts are asleep. Results differ slightly from the
+	/// default storage.
+	bool enableCompactContacts;
+
+	/// Steps an island sleeps before its contacts are made compact, see enableCompactContacts. Islands
+	/// that wake sooner skip recomputing their manifolds, so only long sleepers pay for it. Compact sets
+	/// also release their unused capacity. Zero compacts the contacts when the island falls asleep.
+	int compactSleepSteps;
+
+	/// Size the fat AABB margins of moving shapes by velocity. A shape that leaves its fat AABB gets a box
+	/// swept along the displacement predicted for the next few steps, so fast bodies move their broad-phase
+	/// proxies less often. Slow and resting bodies get a margin smaller than the size based default, so
+	/// they create fewer pairs. See b2Counters::enlargedProxyCount and b2Counters::marginPairCount.
+	bool enableVelocityMargins;
+
+	/// Tune the block size of each parallel loop from the timing of its previous calls. Loops whose blocks
+	/// are short compared to the cost of claiming them get larger blocks and loops where workers sit idle
+	/// while others finish get smaller blocks, within limits. Results are identical. This reads the timer
+	/// for each block. See b2World_GetParallelForProfile.
+	bool enableAdaptiveBlocks;
+
+	/// Sort the contacts of each graph color by the awake indices of their bodies before the solver
+	/// prepares them. The lanes of a wide constraint and the blocks of a worker then gather from nearby
+	/// bodies. Colors that are already in order are not touched. Results are identical.
+	bool enableContactOrdering;
+
+	/// Every few steps move graph color contacts from colors above the mean count into colors below it.
+	/// First fit coloring leaves the first colors heavy and a tail of colors with a few contacts each,
+	/// so workers finish a small color stage long before the heavy ones. Empty colors stay empty.
+	/// Contacts within a color are independent, but the solve order changes so results differ from the default.
+	bool enableColorBalancing;
+
+	/// Keep the transform each awake body had at the start of the last step so the application can
+	/// render between steps with b2World_GetInterpolatedTransforms. This lets the simulation run at a
+	/// lower fixed rate than the display. Costs one transform per body.
+	bool enableInterpolation;
+
+	/// Reuse the prepared frames and effective masses of revolute, weld, prismatic and motor joints from
+	/// an earlier step while neither body rotated further than this from the rotation of the last full
+	/// prepare. Saves prepare work on large joint networks that barely move. The constraints are solved
+	/// with slightly stale anchors so results differ from the default. Radians. Zero disables the reuse.
+	float jointPrepareTolerance;
+
+	/// Awake islands with at most this many bodies are solved as a whole by one worker, all sub-steps at
+	/// once, instead of by the graph coloring stages. Helps worlds made of many small islands such as
+	/// vehicles, ragdolls and crates. Islands touching kinematic bodies or overflow constraints still use
+	/// the graph coloring. The solver order differs so results differ from the default. Zero disables.
+	int islandSolveBodyCount;
+
+	/// Put the awake bodies in the order of a Morton curve through their positions when more than this
+	/// fraction of the touching contacts connect bodies that are far apart in the awake body arrays. The
+	/// solver then gathers the bodies of a contact from nearby memory. Checked every 32 steps. Body move
+	/// events come in the new order. Zero disables.
+	float bodyOrderThreshold;
+
+	/// Broad-phase method used to find new pairs against dynamic bodies
+	b2BroadPhaseType broadPhaseType;
+
+	/// Cell size of the grid broad-phase. This should be about the size of the typical dynamic body
+	/// including the AABB margin. Usually meters.
+	float gridCellSize;
+
+	/// Incremental optimization budget for the dynamic and kinematic trees. Each step rebuilds the
+	/// subtree of at most this many proxies with the worst surface area heuristic cost in each tree.
+	/// This keeps query performance steady as bodies move around, without the spike of a full rebuild.
+	/// Zero disables the optimization.
+	int treeOptimizationBudget;
+
+	/// Number of entries in the static ray cache of b2World_CastRayClosest. Rays cast again and again with
+	/// end points that barely move, such as line of sight checks between slow agents, reuse the static hit
+	/// of the previous ray. An identical ray skips the static tree and a nearby ray only traverses the static
+	/// tree up to the previous hit. Results are exact. Static shape edits invalidate the cache. With the
+	/// cache b2World_CastRayClosest writes to the world, so it must not be called from several threads at
+	/// once. Rounded up to a power of two. Zero disables the cache.
+	int rayCacheCapacity;
+
+	/// Number of constraint graph colors, including the overflow color. Fewer colors means fuller colors
+	/// and more overflow. This is clamped to the range [6, B2_GRAPH_COLOR_COUNT].
+	/// Zero uses B2_GRAPH_COLOR_COUNT.
+	int graphColorCount;
+
+	/// Maximum number of islands split per step. An island that lost constraints must be split before its
+	/// bodies can sleep. The splits run in parallel with each other and with the solver. More splits let
+	/// bodies fall asleep sooner after a large pile collapses. This is clamped to the range
+	/// [1, B2_MAX_ISLAND_SPLITS]. Zero uses one. The default is four.
+	int maxIslandSplits;
+
+	/// Number of wide contact constraints ahead of the current one whose body states are prefetched
+	/// during warm starting and contact solving. This hides memory latency when the bodies of a
+	/// large pile are scattered in memory. Zero disables prefetching. The default is two.
+	int contactPrefetchDistance;
+
 	/// Number of workers for multithreading. Box2D performs best when using performance cores and
 	/// accessing a single L3 cache (uniform memory). Efficiency cores and SMT provide
 	/// little benefit and may even harm performance.
@@ -131,9 +444,36 @@ typedef struct b2WorldDef
 	/// an internal scheduler.
 	int workerCount;
 
+	/// Optional processor affinity for the threads of the internal scheduler. Bit i is logical processor i.
+	/// Only the first 64 processors can be used, and on Windows only those in the processor group of the
+	/// thread creating the world. Worker thread i is pinned to the i-th set bit, wrapping around. The first
+	/// set bit is left for the thread calling b2World_Step, which Box2D does not pin. This is only a
+	/// scheduling hint on macOS. Zero means no affinity.
+	uint64_t workerAffinityMask;
+
+	/// Pin the threads of the internal scheduler to the processors that share the L3 cache with the thread
+	/// creating the world, using one processor per physical core and preferring performance cores. This
+	/// keeps the solver blocks of each worker in a single cache domain. Ignored if workerAffinityMask is
+	/// set or if the processor topology is unknown.
+	bool enableCacheAffinity;
+
+	/// Pick the number of workers used by each parallel stage from the amount of work in the stage, up to
+	/// workerCount. Small steps then run on one or two workers instead of paying the fork and join cost of
+	/// the full pool. Results are identical. See b2Counters::solverWorkerCount.
+	bool enableAutoWorkers;
+
+	/// How solver threads wait for each other when the world uses more than one worker
+	b2WaitPolicy waitPolicy;
+
+	/// Number of spin iterations before a waiting solver thread yields or parks. Zero uses the default of 6.
+	int waitSpinCount;
+
 	/// Function to spawn tasks
 	b2EnqueueTaskCallback* enqueueTask;
 
+	/// Optional function to spawn tasks with scheduling hints. Used instead of enqueueTask when set.
+	b2EnqueueTaskExCallback* enqueueTaskEx;
+
 	/// Function to finish a task
 	b2FinishTaskCallback* finishTask;
 
@@ -228,6 +568,13 @@ typedef struct b2BodyDef
 	/// Sleep speed threshold, default is 0.05 meters per second
 	float sleepThreshold;
 
+	/// Number of steps between simulation updates of the island holding this body. Zero or one simulates
+	/// every step. An island uses the smallest interval of its bodies. Between updates the island is parked
+	/// outside of the awake solver arrays and on its update step it is simulated with the accumulated time.
+	/// Islands with the same interval are staggered by island so the updates are spread across steps.
+	/// Meant for distant piles of loose bodies. Joint springs and motors do not account for the accumulated time.
+	int simulationInterval;
+
 	/// Optional body name for debugging. Up to 31 characters (excluding null termination)
 	const char* name;
 
@@ -353,6 +700,9 @@ typedef enum b2ShapeType
 	/// A line segment owned by a chain shape
 	b2_chainSegmentShape,
 
+	/// A set of convex polygons under one proxy, see b2Compound
+	b2_compoundShape,
+
 	/// The number of shape types
 	b2_shapeTypeCount
 } b2ShapeType;
@@ -407,6 +757,15 @@ typedef struct b2ShapeDef
 	/// Collision filtering data.
 	b2Filter filter;
 
+	/// Speculative contact distance of this shape, clamped to [B2_LINEAR_SLOP, B2_SPECULATIVE_DISTANCE].
+	/// Contacts keep points up to the smaller distance of their two shapes, so small fast debris may use
+	/// less to create fewer contacts that never touch. Zero uses B2_SPECULATIVE_DISTANCE.
+	float speculativeDistance;
+
+	/// Broad-phase margin of this shape in meters. A larger margin moves the proxy less often but creates
+	/// more pairs. Zero uses a margin based on the shape size.
+	float aabbMargin;
+
 	/// Enable custom filtering. Only one of the two shapes needs to enable custom filtering. See b2WorldDef.
 	bool enableCustomFiltering;
 
@@ -421,6 +780,11 @@ typedef struct b2ShapeDef
 	/// False by default, even for sensors.
 	bool enableSensorEvents;
 
+	/// Number of steps between overlap updates of this sensor. Zero or one updates every step. Sensors with
+	/// the same interval are staggered by shape so the updates are spread across steps. Begin and end events
+	/// of a slower sensor are reported on its update steps. Ignored for non-sensors.
+	int sensorUpdateInterval;
+
 	/// Enable contact events for this shape. Only applies to kinematic and dynamic bodies. Only one shape involved needs this flag set to true.
 	/// Ignored for sensors. False by default.
 	bool enableContactEvents;
@@ -501,6 +865,48 @@ typedef struct b2ChainDef
 /// @ingroup shape
 B2_API b2ChainDef b2DefaultChainDef( void );
 
+/// A tile of static geometry for streaming levels: one static body with polygon shapes that is
+/// added to a world and later destroyed as a unit. The broad-phase subtree of the tile is built by
+/// b2MakeStaticTile, which does not use a world and may run on any thread. Adding the tile with
+/// b2CreateTileBody grafts the prebuilt subtree into the static tree in linear time without a tree build,
+/// and b2DestroyBody detaches the subtree again. A tile can be added many times and is freed with
+/// b2DestroyStaticTile.
+/// @ingroup body
+typedef struct b2StaticTile
+{
+	/// The static body definition of the tile
+	b2BodyDef bodyDef;
+
+	/// The definition used for every shape of the tile
+	b2ShapeDef shapeDef;
+
+	/// The polygons in body local space, owned by the tile
+	b2Polygon* polygons;
+
+	/// The number of polygons
+	int count;
+
+	/// The prebuilt broad-phase subtree. The proxy user data is the polygon index.
+	b2DynamicTree tree;
+} b2StaticTile;
+
+/// Work skipped by b2World_StepWithBudget to stay within the budget. The levels are applied in this
+/// order as the overrun grows. Reported in b2Profile::degradations.
+typedef enum b2StepDegradation
+{
+	/// Contacts and joints are relaxed in every other sub-step, ending with the last one
+	b2_degradeRelax = 0x0001,
+
+	/// Sensor overlaps are updated in the next step, delaying sensor events
+	b2_degradeSensors = 0x0002,
+
+	/// Islands that lost constraints are split in a later step, so they cannot sleep yet
+	b2_degradeIslandSplit = 0x0004,
+
+	/// Fast bodies that are not bullets skip continuous collision and may tunnel through thin static shapes
+	b2_degradeContinuous = 0x0008,
+} b2StepDegradation;
+
 //! @cond
 /// Profiling data. Times are in milliseconds.
 typedef struct b2Profile
@@ -525,11 +931,85 @@ typedef struct b2Profile
 	float jointEvents;
 	float hitEvents;
 	float refit;
+	float optimizeTrees;
 	float bullets;
 	float sleepIslands;
 	float sensors;
+	float particles;
+
+	// b2StepDegradation flags
+	uint32_t degradations;
 } b2Profile;
 
+/// Solver stages reported by b2World_GetWorkerProfile, in the order they run in a step.
+/// The overflow stages are only used by parallel overflow solving.
+typedef enum b2ProfileStage
+{
+	b2_profilePrepareJoints,
+	b2_profilePrepareContacts,
+	b2_profileIntegrateVelocities,
+	b2_profileWarmStart,
+	b2_profileSolve,
+	b2_profileIntegratePositions,
+	b2_profileRelax,
+	b2_profileRestitution,
+	b2_profileStoreJoints,
+	b2_profileStoreImpulses,
+	b2_profileOverflowContacts,
+	b2_profileOverflowBodies,
+	b2_profileStageCount
+} b2ProfileStage;
+
+/// Solver work done by one worker in one stage during a step. Times are in milliseconds.
+typedef struct b2WorkerStageProfile
+{
+	/// Time spent claiming and running blocks
+	float workTime;
+
+	/// Time spent waiting. Worker zero waits for the other workers to finish the stage and the
+	/// other workers wait for the stage to start.
+	float waitTime;
+
+	/// Number of blocks run by this worker
+	int blockCount;
+
+	/// Number of blocks this worker tried to claim after another worker claimed them
+	int stolenCount;
+} b2WorkerStageProfile;
+
+/// Solver profile of one worker, see b2World_GetWorkerProfile
+typedef struct b2WorkerProfile
+{
+	b2WorkerStageProfile stages[b2_profileStageCount];
+} b2WorkerProfile;
+
+/// Parallel loop calls of one call site since the start of the last step, see b2World_GetParallelForProfile.
+/// Times are in milliseconds.
+typedef struct b2ParallelForProfile
+{
+	/// Name of the task run by the loop
+	const char* name;
+
+	int callCount;
+	int itemCount;
+	int blockCount;
+
+	/// Block size picked for the most recent call
+	int blockSize;
+
+	/// Time from the start to the end of the calls
+	float wallTime;
+
+	/// Time spent in the task, summed over workers
+	float workTime;
+
+	/// Time workers spent claiming blocks between tasks
+	float claimTime;
+
+	/// Time workers spent out of blocks while another worker was still running one
+	float waitTime;
+} b2ParallelForProfile;
+
 /// Counters that give details of the simulation size.
 typedef struct b2Counters
 {
@@ -545,12 +1025,207 @@ typedef struct b2Counters
 	int taskCount;
 	int colorCounts[24];
 
+	// Workers used by the constraint solver in the most recent step. Less than the worker count with
+	// b2WorldDef::enableAutoWorkers when the step is small.
+	int solverWorkerCount;
+
+	// Graph colors with too little work to share that the main thread solved without waking the
+	// solver workers in the most recent step.
+	int inlineColorCount;
+
+	// Number of contacts and joints that did not fit in the graph coloring.
+	int overflowContactCount;
+	int overflowJointCount;
+
 	// Number of contacts touched by the collide pass (graph contacts + awake-set non-touching).
 	int awakeContactCount;
 
 	// Number of contacts recycled in the most recent step.
 	int recycledContactCount;
+
+	// Number of contacts in the most recent step that were not recycled but were found separated using
+	// the separating axis from the previous step, skipping the full polygon SAT.
+	int cachedAxisContactCount;
+
+	// Number of non-touching contacts in the most recent step that skipped the narrow phase because
+	// their bodies moved less than the gap between the shapes found by the last update.
+	int separatedContactCount;
+
+	// Number of sensors whose overlaps were recomputed in the most recent step.
+	int updatedSensorCount;
+
+	// Number of heap allocations made during the most recent step. This is process wide, so steps
+	// of other worlds running at the same time are included.
+	int stepAllocationCount;
+
+	// Islands split during the most recent step.
+	int splitIslandCount;
+
+	// Sleeping solver sets woken by the most recent step, including wakes requested since the previous step.
+	int wokenSetCount;
+
+	// Awake kinematic bodies moved outside of the constraint solver because they have no joints and touch nothing.
+	int detachedKinematicCount;
+
+	// Bytes added to the step stack after the most recent step. Non-zero means the step ran past the stack
+	// capacity and allocated from the heap.
+	int stackGrowth;
+
+	// Leaves sorted by the dynamic and kinematic tree rebuild in the most recent step.
+	int rebuiltLeafCount;
+
+	// Awake bodies put in spatial order at the start of the most recent step, see b2WorldDef::bodyOrderThreshold.
+	int reorderedBodyCount;
+
+	// Graph color contacts moved by the solver to keep the colors in body order, see
+	// b2WorldDef::enableContactOrdering.
+	int sortedContactCount;
+
+	// Graph color contacts moved to a lighter color in the most recent step, see
+	// b2WorldDef::enableColorBalancing.
+	int balancedContactCount;
+
+	// Particles simulated by the most recent step, see b2World_CreateParticles.
+	int particleCount;
+
+	// The counters below are for the most recent step and are zero unless enabled with
+	// b2World_EnableDetailedCounters.
+
+	// Internal and leaf tree nodes visited by the broad-phase pair queries.
+	int pairNodeVisits;
+	int pairLeafVisits;
+
+	// Number of heap blocks allocated for move pairs that did not fit in the worker arenas.
+	int pairHeapBlockCount;
+
+	// Manifold function calls indexed by the shape types of the contact. Recycled contacts are not counted.
+	int manifoldCalls[b2_shapeTypeCount][b2_shapeTypeCount];
+
+	// Continuous collision histograms. Bucket i counts the time of impact calls that took [2^i, 2^(i+1))
+	// separating axis iterations or GJK iterations. The last bucket is open ended.
+	int toiIterations[8];
+	int gjkIterations[8];
+
+	// Contacts destroyed because their bounding boxes stopped overlapping without the shapes ever
+	// touching. These cost narrow phase time but never affected the simulation.
+	int untouchedContactCount;
+
+	// Broad-phase proxies moved in the tree because their shape left the fat AABB.
+	int enlargedProxyCount;
+
+	// New pairs whose shape bounds did not overlap, so the pair only exists because of the fat AABB margins.
+	int marginPairCount;
 } b2Counters;
+
+/// Heap memory held by a world, by subsystem. Sizes are in bytes and count capacity rather than use.
+/// See b2World_GetMemoryStats.
+typedef struct b2MemoryStats
+{
+	/// Id pools of all object types
+	int idPools;
+
+	/// Sparse arrays of bodies, shapes, joints and contacts, and the solver set array
+	int objectArrays;
+
+	/// Islands and their body and constraint arrays
+	int islands;
+
+	/// Chain shapes and their segment and material arrays
+	int chains;
+
+	/// Broad-phase trees, indexed by b2BodyType
+	int trees[b2_bodyTypeCount];
+
+	/// Broad-phase move set, move array and enlarged shape array
+	int moveSet;
+
+	/// Broad-phase pair set
+	int pairSet;
+
+	/// Solver set arrays, summed over all solver sets
+	int bodySims;
+	int bodyStates;
+	int jointSims;
+	int contactSims;
+	int islandSims;
+
+	/// Constraint graph colors. Each holds a body bit set and contact and joint arrays.
+	int colors[24];
+
+	/// Sensors, their visitor arrays, the sensor tree and the sensor worker storage
+	int sensors;
+
+	/// Particle arrays, see b2World_CreateParticles
+	int particles;
+
+	/// Body, contact, sensor and joint event arrays
+	int events;
+
+	/// Per worker bit sets and arrays, not including the arenas
+	int workers;
+
+	/// Debug draw bit sets and batches, and snapshot bit sets
+	int bitSets;
+
+	/// Step stack capacity, high water mark and the number of allocations that fell back to the heap
+	int stackCapacity;
+	int stackMaxAllocation;
+	int stackHeapCount;
+
+	/// Worker arena capacity, high water mark and the number of heap blocks, summed over workers
+	int arenaCapacity;
+	int arenaMaxAllocation;
+	int arenaHeapCount;
+
+	/// Sum of the byte sizes above, using capacities for the stack and arenas
+	int totalBytes;
+} b2MemoryStats;
+
+/// Byte sizes of the structures stored for each object, without container growth. See b2GetObjectSizes.
+typedef struct b2ObjectSizes
+{
+	/// One per body
+	int body;
+
+	/// One per body, in the solver set of the body
+	int bodySim;
+
+	/// One per awake body
+	int bodyState;
+
+	/// One per shape
+	int shape;
+
+	/// One per chain, plus one shape per chain segment
+	int chain;
+
+	/// One per contact
+	int contact;
+
+	/// One per contact, in a solver set or a graph color
+	int contactSim;
+
+	/// Replaces the contact sim of a sleeping contact, see b2WorldDef::enableCompactContacts
+	int compactContactSim;
+
+	/// One per joint
+	int joint;
+
+	/// One per joint, in a solver set or a graph color
+	int jointSim;
+
+	/// One per island
+	int island;
+
+	/// One per island, in the solver set of the island
+	int islandSim;
+
+	/// One per sensor shape
+	int sensor;
+
+	/// Dynamic tree node. A tree holds a leaf per proxy and one fewer internal nodes.
+	int treeNode;
+} b2ObjectSizes;
 //! @endcond
 
 /// Joint type enumeration
@@ -922,6 +1597,140 @@ typedef struct b2ExplosionDef
 /// @ingroup world
 B2_API b2ExplosionDef b2DefaultExplosionDef( void );
 
+/// The kind of area force. See b2AreaForceDef.
+/// @ingroup world
+typedef enum b2AreaForceType
+{
+	/// A radial impulse, see b2ExplosionDef
+	b2_explosionArea,
+
+	/// Wind on the shapes that overlap the region, see b2Shape_ApplyWind
+	b2_windArea,
+
+	/// Buoyancy and drag on the part of the shapes inside the region. The region is filled with fluid.
+	b2_buoyancyArea,
+} b2AreaForceType;
+
+/// An explosion, wind volume or buoyancy region applied with b2World_ApplyAreaForces.
+/// Area forces apply to circles, capsules, polygons and compounds of a single polygon on dynamic bodies.
+/// @ingroup world
+typedef struct b2AreaForceDef
+{
+	/// The kind of area force
+	b2AreaForceType type;
+
+	/// Mask bits to filter shapes
+	uint64_t maskBits;
+
+	/// The explosion for b2_explosionArea. The explosion mask bits are not used.
+	b2ExplosionDef explosion;
+
+	/// The region for b2_windArea and b2_buoyancyArea
+	b2AABB region;
+
+	/// The wind velocity, drag and lift coefficients for b2_windArea
+	b2Vec2 wind;
+	float drag;
+	float lift;
+
+	/// The fluid density for b2_buoyancyArea. In 2D this is mass per area. The buoyancy opposes gravity.
+	float fluidDensity;
+
+	/// Drag coefficients per submerged area for b2_buoyancyArea
+	float linearDrag;
+	float angularDrag;
+
+	/// The fluid velocity for b2_buoyancyArea
+	b2Vec2 flowVelocity;
+
+	/// Wake sleeping bodies. Otherwise sleeping bodies are skipped.
+	bool wake;
+
+	/// Used internally to detect a valid definition. DO NOT SET.
+	int internalValue;
+} b2AreaForceDef;
+
+/// Use this to initialize your area force definition
+/// @ingroup world
+B2_API b2AreaForceDef b2DefaultAreaForceDef( void );
+
+/// Settings shared by particles created with b2World_CreateParticles. Particles are small circles for
+/// large amounts of debris. They have no body, id, island or events. They collide one-way with static
+/// shapes, exchange momentum with awake dynamic bodies and push each other apart.
+/// @ingroup world
+typedef struct b2ParticleDef
+{
+	/// The particle radius, usually in meters
+	float radius;
+
+	/// The density, usually in kg/m^2. Sets the momentum given to dynamic bodies.
+	float density;
+
+	/// Coulomb friction against shapes
+	float friction;
+
+	/// Linear damping of the particle velocity
+	float linearDamping;
+
+	/// Scale the gravity applied to the particles
+	float gravityScale;
+
+	/// Seconds until the particles are removed. Zero keeps them until b2World_DestroyParticles.
+	float lifetime;
+
+	/// Collision filter against shapes. Particles collide with each other regardless of the filter.
+	b2Filter filter;
+
+	/// Push apart particles that overlap. Disable for sparse debris to save the neighbor search.
+	bool enableParticleCollision;
+
+	/// Used internally to detect a valid definition. DO NOT SET.
+	int internalValue;
+} b2ParticleDef;
+
+/// Use this to initialize your particle definition
+/// @ingroup world
+B2_API b2ParticleDef b2DefaultParticleDef( void );
+
+/// A grid of shards, each simulated by its own world. See b2CreateShardGrid.
+/// @ingroup shard
+typedef struct b2ShardGrid b2ShardGrid;
+
+/// Splits space into a grid of shards. Shard i covers column i % columnCount and row i / columnCount.
+/// Shards on the edge of the grid extend to infinity.
+/// @ingroup shard
+typedef struct b2ShardGridDef
+{
+	/// Used to create the world of every shard
+	b2WorldDef worldDef;
+
+	/// The lower corner of the first shard
+	b2Vec2 origin;
+
+	/// The size of one shard, usually in meters
+	b2Vec2 shardSize;
+
+	/// The number of shards along x
+	int columnCount;
+
+	/// The number of shards along y
+	int rowCount;
+
+	/// Bodies with bounds closer than this to a neighboring shard are mirrored there as kinematic ghost bodies
+	float ghostMargin;
+
+	/// A body is handed off to a neighboring shard once its origin is this far past the shard border. This keeps
+	/// bodies resting on a border from moving back and forth.
+	float handoffMargin;
+
+	/// Used internally to detect a valid definition. DO NOT SET.
+	int internalValue;
+} b2ShardGridDef;
+
+/// Use this to initialize your shard grid definition
+/// @ingroup shard
+B2_API b2ShardGridDef b2DefaultShardGridDef( void );
+
 /**
  * @defgroup events Events
  * World event types.
@@ -1090,6 +1899,23 @@ typedef struct b2BodyMoveEvent
 	bool fellAsleep;
 } b2BodyMoveEvent;
 
+/// Compact form of a body move event for replication. The change is relative to the previous move event
+/// of the body, or to the transform the body was created or teleported with. Applying the deltas in order
+/// reproduces the transform of the sender up to the quantization error, which does not accumulate.
+/// @see b2WorldDef::moveEventQuantum
+typedef struct b2BodyMoveDelta
+{
+	b2BodyId bodyId;
+
+	/// Change of the body origin in multiples of b2WorldDef::moveEventQuantum
+	int32_t dx, dy;
+
+	/// Change of the body angle in multiples of pi / 32768 radians
+	int16_t dAngle;
+
+	bool fellAsleep;
+} b2BodyMoveDelta;
+
 /// Body events are buffered in the Box2D world and are available
 /// as event arrays after the time step is complete.
 /// Note: this data becomes invalid if bodies are destroyed
@@ -1100,8 +1926,118 @@ typedef struct b2BodyEvents
 
 	/// Number of move events
 	int moveCount;
+
+	/// Compact deltas of the move events, in the same order. NULL unless b2WorldDef::moveEventQuantum is positive.
+	b2BodyMoveDelta* moveDeltas;
 } b2BodyEvents;
 
+/// Caller owned structure of arrays filled by b2World_GetBodyStates and b2World_GetAwakeBodyStates.
+/// Each array must hold one entry per body. Leave an array NULL to skip it.
+typedef struct b2BodyStateArrays
+{
+	/// Body origins in world space
+	b2Vec2* positions;
+
+	/// Body rotations
+	b2Rot* rotations;
+
+	/// Linear velocities of the center of mass. Zero for sleeping bodies.
+	b2Vec2* linearVelocities;
+
+	/// Angular velocities in radians per second. Zero for sleeping bodies.
+	float* angularVelocities;
+} b2BodyStateArrays;
+
+/// Layout version of the state export buffer, see b2ExportHeader
+#define B2_EXPORT_VERSION 1
+
+/// Header at the start of a state export buffer, see b2World_SetExportBuffer. The body state follows as
+/// structure of arrays with one entry per export slot, at the byte offsets given here. The buffer may live
+/// in shared memory so another process can read it in place.
+///
+/// The sequence is a seqlock. The world makes it odd before the step writes body state and even again
+/// after the last write. A consumer reads the sequence, copies what it needs, and reads the sequence
+/// again. The copy is consistent if both reads are the same even value. See b2ReadExportBuffer.
+typedef struct b2ExportHeader
+{
+	/// Seqlock counter, odd while the world writes
+	uint32_t sequence;
+
+	/// B2_EXPORT_VERSION of the writer
+	uint32_t version;
+
+	/// Number of slots in each array
+	int slotCapacity;
+
+	/// Byte size of the whole buffer
+	int byteCount;
+
+	/// Number of completed world steps when the state was written
+	uint64_t stepIndex;
+
+	/// Byte offset of the b2Vec2 body origins
+	uint32_t positionOffset;
+
+	/// Byte offset of the b2Rot body rotations
+	uint32_t rotationOffset;
+
+	/// Byte offset of the b2Vec2 linear velocities of the center of mass
+	uint32_t linearVelocityOffset;
+
+	/// Byte offset of the float angular velocities
+	uint32_t angularVelocityOffset;
+} b2ExportHeader;
+
+/// Direct reference to the simulation data of a body for fast reads, see b2Body_GetRef. The fields are
+/// internal. A reference expires with the next step and with any change that moves body data: creating,
+/// destroying, waking, sleeping, enabling or disabling bodies, changing a body type, compacting or
+/// restoring the world.
+typedef struct b2BodyRef
+{
+	const void* sim;
+	const void* state;
+	uint32_t epoch;
+	uint16_t world0;
+	uint16_t worldGeneration;
+} b2BodyRef;
+
+/// The kind of deferred body command. See b2BodyCommand.
+typedef enum b2BodyCommandType
+{
+	/// Apply a force at a world point. Forces are cleared at the end of each step.
+	b2_bodyForce,
+
+	/// Apply an impulse at a world point
+	b2_bodyLinearImpulse,
+
+	/// Set the linear velocity of the center of mass. The point is ignored.
+	b2_bodyLinearVelocity,
+
+	/// Apply a torque stored in value.x. The point is ignored. Torques are cleared at the end of each step.
+	b2_bodyTorque,
+} b2BodyCommandType;
+
+/// A force, impulse or velocity queued with b2World_QueueBodyCommands and applied at the start of
+/// the next time step. Only dynamic bodies respond to forces and impulses. Commands on bodies that
+/// are asleep and not woken are dropped because sleeping bodies have no velocity state.
+typedef struct b2BodyCommand
+{
+	/// The target body. Bodies destroyed before the next step are skipped.
+	b2BodyId bodyId;
+
+	/// Force (N), impulse (N*s) or velocity (m/s) depending on the type
+	b2Vec2 value;
+
+	/// World point where the force or impulse is applied
+	b2Vec2 point;
+
+	/// The command type
+	b2BodyCommandType type;
+
+	/// Wake the body if it is sleeping
+	bool wake;
+} b2BodyCommand;
+
 /// Joint events report joints that are awake and have a force and/or torque exceeding the threshold
 /// The observed forces and torques are not returned for efficiency reasons.
 typedef struct b2JointEvent
@@ -1167,6 +2103,44 @@ typedef bool b2CustomFilterFcn( b2ShapeId shapeIdA, b2ShapeId shapeIdB, void* co
 /// @ingroup world
 typedef bool b2PreSolveFcn( b2ShapeId shapeIdA, b2ShapeId shapeIdB, b2Vec2 point, b2Vec2 normal, void* context );
 
+/// A shape pair handed to the batch callbacks. The shape data is gathered so the callback does not
+/// need to go through the shape functions.
+/// @ingroup world
+typedef struct b2ShapePair
+{
+	b2ShapeId shapeIdA;
+	b2ShapeId shapeIdB;
+	void* userDataA;
+	void* userDataB;
+	b2Filter filterA;
+	b2Filter filterB;
+	uint64_t userMaterialIdA;
+	uint64_t userMaterialIdB;
+} b2ShapePair;
+
+/// A contact handed to b2PreSolveBatchFcn
+/// @ingroup world
+typedef struct b2PreSolveContact
+{
+	b2ShapePair pair;
+
+	/// The deepest manifold point
+	b2Vec2 point;
+	b2Vec2 normal;
+} b2PreSolveContact;
+
+/// Batch version of b2CustomFilterFcn. Called with the candidate pairs found by one block of
+/// work on one worker. Write false to results[i] to disable the collision of pairs[i].
+/// This takes precedence over b2CustomFilterFcn and has the same thread-safety requirements.
+/// @ingroup world
+typedef void b2CustomFilterBatchFcn( const b2ShapePair* pairs, bool* results, int count, void* context );
+
+/// Batch version of b2PreSolveFcn. Called with the touching contacts updated by one block of
+/// work on one worker. Write false to results[i] to disable contacts[i] this step.
+/// This takes precedence over b2PreSolveFcn and has the same thread-safety requirements.
+/// @ingroup world
+typedef void b2PreSolveBatchFcn( const b2PreSolveContact* contacts, bool* results, int count, void* context );
+
 /// Prototype callback for overlap queries.
 /// Called for each shape found in the query.
 /// @see b2World_OverlapABB
@@ -1354,6 +2328,51 @@ typedef enum b2HexColor
 /// (B2_GRAPH_COLOR_COUNT - 1) is the overflow color.
 B2_API b2HexColor b2GetGraphColor( int index );
 
+/// Primitive types of a batched debug draw, see b2DebugDraw::DrawBatchFcn
+/// @ingroup world
+typedef enum b2DrawPrimitiveType
+{
+	/// Solid polygon with a rounding radius. The vertices are in CCW order.
+	b2_drawSolidPolygon,
+
+	/// Solid circle. The first vertex is the center and the second is on the circle along the shape x-axis.
+	b2_drawSolidCircle,
+
+	/// Solid capsule between two vertices
+	b2_drawSolidCapsule,
+
+	/// Line segment between two vertices
+	b2_drawLine,
+
+	/// Point at one vertex. The radius holds the point size.
+	b2_drawPoint,
+
+	/// Closed polygon outline
+	b2_drawPolygon,
+} b2DrawPrimitiveType;
+
+/// One primitive of a batched debug draw. It uses vertexCount vertices of the batch starting at vertexIndex.
+/// @ingroup world
+typedef struct b2DrawPrimitive
+{
+	b2DrawPrimitiveType type;
+	b2HexColor color;
+	int vertexIndex;
+	int vertexCount;
+	float radius;
+} b2DrawPrimitive;
+
+/// The shapes and shape bounds of one b2World_Draw call. Vertices are in world space.
+/// The primitives are in the order the shapes are found in the broad-phase trees.
+/// @ingroup world
+typedef struct b2DrawBatch
+{
+	const b2DrawPrimitive* primitives;
+	int primitiveCount;
+	const b2Vec2* vertices;
+	int vertexCount;
+} b2DrawBatch;
+
 /// This struct holds callbacks you can implement to draw a Box2D world.
 /// This structure should be zero initialized.
 /// @ingroup world
@@ -1387,6 +2406,11 @@ typedef struct b2DebugDraw
 	/// Draw a string in world space
 	void ( *DrawStringFcn )( b2Vec2 p, const char* s, b2HexColor color, void* context );
 
+	/// Optional. Receives the shapes and shape bounds in one batch that the world task system builds in
+	/// parallel, instead of one call per primitive. Everything else still uses the functions above.
+	/// The batch is owned by the world and is only valid during the call.
+	void ( *DrawBatchFcn )( const b2DrawBatch* batch, void* context );
+
 	/// World bounds to use for debug draw
 	b2AABB drawingBounds;
 
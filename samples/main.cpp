@@ -32,6 +32,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #ifdef TRACY_ENABLE
 #include <tracy/Tracy.hpp>
@@ -397,7 +398,7 @@ static void ScrollCallback( GLFWwindow* window, double dx, double dy )
 	s_context.camera.center -= pw2 - pw1;
 }
 
-int main( int, char** )
+int main( int argc, char** argv )
 {
 #if defined( _MSC_VER )
 	// Enable memory-leak reports
@@ -420,6 +421,20 @@ int main( int, char** )
 	s_context.Load();
 	s_context.workerCount = b2MinInt( 8, GetNumberOfCores() / 2 );
 
+	for ( int i = 1; i < argc; ++i )
+	{
+		if ( strcmp( argv[i], "--no-draw" ) == 0 )
+		{
+			// Headless benchmarking: skip the world drawing and show the step time graphs instead
+			s_context.enableDraw = false;
+			s_context.frameTime = true;
+		}
+		else
+		{
+			fprintf( stderr, "Unknown argument %s\n", argv[i] );
+		}
+	}
+
 	SortSamples();
 
 	glfwSetErrorCallback( glfwErrorCallback );
@@ -486,13 +486,20 @@ void Sample::Step()
 	b2World_EnableSleeping( m_worldId, m_context->enableSleep );
 	b2World_EnableWarmStarting( m_worldId, m_context->enableWarmStarting );
 	b2World_EnableContinuous( m_worldId, m_context->enableContinuous );
+	b2World_EnableContinuousCache( m_worldId, m_context->enableContinuousCache );
+	b2World_EnableIncrementalIslands( m_worldId, m_context->enableIncrementalIslands );
+	b2World_EnableIncrementalSensors( m_worldId, m_context->enableIncrementalSensors );
+	b2World_EnableIncrementalPairs( m_worldId, m_context->enableIncrementalPairs );
 
 	for ( int i = 0; i < 1; ++i )
 	{
 		b2World_Step( m_worldId, timeStep, m_context->subStepCount );
 	}
 
-	b2World_Draw( m_worldId, &m_context->debugDraw );
+	if ( m_context->enableDraw )
+	{
+		b2World_Draw( m_worldId, &m_context->debugDraw );
+	}
 
 	if ( timeStep > 0.0f )
 	{
@@ -523,7 +530,7 @@ void Sample::UpdateGui()
 		const int count = static_cast<int>( m_profileWriteIndex - m_profileReadIndex );
 
 		// Unroll ring buffer into per-field histories.
-		constexpr int kRowCount = 22;
+		constexpr int kRowCount = 23;
 		float histories[kRowCount][m_profileCapacity];
 		float totals[kRowCount] = {};
 		for ( int i = 0; i < count; ++i )
@@ -552,6 +559,7 @@ void Sample::UpdateGui()
 			histories[19][i] = p.sleepIslands;
 			histories[20][i] = p.bullets;
 			histories[21][i] = p.sensors;
+			histories[22][i] = p.optimizeTrees;
 
 			totals[0] += p.step;
 			totals[1] += p.pairs;
@@ -575,6 +583,7 @@ void Sample::UpdateGui()
 			totals[19] += p.sleepIslands;
 			totals[20] += p.bullets;
 			totals[21] += p.sensors;
+			totals[22] += p.optimizeTrees;
 		}
 
 		const b2Profile& cur = m_profiles[m_currentProfileIndex];
@@ -601,6 +610,7 @@ void Sample::UpdateGui()
 			cur.sleepIslands,
 			cur.bullets,
 			cur.sensors,
+			cur.optimizeTrees,
 		};
 
 		// Rolling average
@@ -634,7 +644,7 @@ void Sample::UpdateGui()
 			{ "restitution", 2, colorDefault }, { "store", 2, colorDefault },		 { "split islands", 2, colorDefault },
 			{ "transforms", 1, colorDefault },	{ "joint events", 1, colorDefault }, { "hit events", 1, colorDefault },
 			{ "refit BVH", 1, colorDefault },	{ "sleep", 1, colorDefault },		 { "bullets", 1, colorDefault },
-			{ "sensors", 0, colorDefault },
+			{ "sensors", 0, colorDefault },		{ "optimize BVH", 0, colorDefault },
 		};
 
 		// Derive parent/child links from the indent levels so we can collapse subtrees.
@@ -812,7 +822,10 @@ void Sample::UpdateGui()
 			ImGui::SameLine();
 			ImGui::ProgressBar( frac, ImVec2( -FLT_MIN, 0.0f ), overlay );
 		}
+		ImGui::Text( "cached axis contacts = %d", s.cachedAxisContactCount );
+		ImGui::Text( "separated contacts = %d", s.separatedContactCount );
 		ImGui::Text( "islands/tasks = %d/%d", s.islandCount, s.taskCount );
+		ImGui::Text( "detached kinematic bodies = %d", s.detachedKinematicCount );
 		ImGui::Text( "tree height static/movable = %d/%d", s.staticTreeHeight, s.treeHeight );
 		ImGui::Text( "stack allocator size = %d K", s.stackUsed / 1024 );
 		ImGui::Text( "total allocation = %d K", s.byteCount / 1024 );
@@ -1159,6 +1172,10 @@ void UpdateSampleUI( SampleContext* context )
 				ImGui::Checkbox( "Sleep", &context->enableSleep );
 				ImGui::Checkbox( "Warm Starting", &context->enableWarmStarting );
 				ImGui::Checkbox( "Continuous", &context->enableContinuous );
+				ImGui::Checkbox( "Continuous Cache", &context->enableContinuousCache );
+				ImGui::Checkbox( "Incremental Islands", &context->enableIncrementalIslands );
+				ImGui::Checkbox( "Incremental Sensors", &context->enableIncrementalSensors );
+				ImGui::Checkbox( "Incremental Pairs", &context->enableIncrementalPairs );
 
 				ImGui::PushItemWidth( 100.0f );
 				float recyclingCentimeters = 100.0f * context->recycleDistance;
@@ -1171,6 +1188,7 @@ void UpdateSampleUI( SampleContext* context )
 
 				ImGui::Separator();
 
+				ImGui::Checkbox( "Draw World", &context->enableDraw );
 				ImGui::Checkbox( "Shapes", &context->debugDraw.drawShapes );
 				ImGui::Checkbox( "Joints", &context->debugDraw.drawJoints );
 				ImGui::Checkbox( "Joint Extras", &context->debugDraw.drawJointExtras );
@@ -38,10 +38,17 @@ struct SampleContext
 	bool drawProfile = false;
 	bool enableWarmStarting = true;
 	bool enableContinuous = true;
+	bool enableContinuousCache = false;
+	bool enableIncrementalIslands = false;
+	bool enableIncrementalSensors = false;
+	bool enableIncrementalPairs = false;
 	bool enableSleep = true;
 	bool showUI = true;
 	bool frameTime = false;
 
+	// Draws the world each frame. Cleared by --no-draw so large benchmarks only pay for the physics.
+	bool enableDraw = true;
+
 	// These are persisted
 	int sampleIndex = 0;
 };
@@ -2166,3 +2166,158 @@ public:
 };
 
 static int benchmarkJunkyard = RegisterSample( "Benchmark", "Junkyard", BenchmarkJunkyard::Create );
+
+class BenchmarkSleepyWorld : public Sample
+{
+public:
+	explicit BenchmarkSleepyWorld( SampleContext* context )
+		: Sample( context )
+	{
+		if ( m_context->restart == false )
+		{
+			m_context->camera.center = { 0.0f, 150.0f };
+			m_context->camera.zoom = 250.0f;
+		}
+
+		CreateSleepyWorld( m_worldId );
+	}
+
+	void Step() override
+	{
+		if ( m_context->pause == false || m_context->singleStep == true )
+		{
+			StepSleepyWorld( m_worldId, m_stepCount );
+		}
+
+		Sample::Step();
+	}
+
+	static Sample* Create( SampleContext* context )
+	{
+		return new BenchmarkSleepyWorld( context );
+	}
+};
+
+static int benchmarkSleepyWorld = RegisterSample( "Benchmark", "Sleepy World", BenchmarkSleepyWorld::Create );
+
+class BenchmarkTriggerField : public Sample
+{
+public:
+	explicit BenchmarkTriggerField( SampleContext* context )
+		: Sample( context )
+	{
+		if ( m_context->restart == false )
+		{
+			m_context->camera.center = { 200.0f, 100.0f };
+			m_context->camera.zoom = 120.0f;
+		}
+
+		CreateTriggerField( m_worldId );
+	}
+
+	void Step() override
+	{
+		if ( m_context->pause == false || m_context->singleStep == true )
+		{
+			StepTriggerField( m_worldId, m_stepCount );
+		}
+
+		Sample::Step();
+	}
+
+	static Sample* Create( SampleContext* context )
+	{
+		return new BenchmarkTriggerField( context );
+	}
+};
+
+static int benchmarkTriggerField = RegisterSample( "Benchmark", "Trigger Field", BenchmarkTriggerField::Create );
+
+class BenchmarkRagdolls : public Sample
+{
+public:
+	explicit BenchmarkRagdolls( SampleContext* context )
+		: Sample( context )
+	{
+		if ( m_context->restart == false )
+		{
+			m_context->camera.center = { 0.0f, 30.0f };
+			m_context->camera.zoom = 40.0f;
+		}
+
+		CreateRagdolls( m_worldId );
+	}
+
+	void Step() override
+	{
+		if ( m_context->pause == false || m_context->singleStep == true )
+		{
+			StepRagdolls( m_worldId, m_stepCount );
+		}
+
+		Sample::Step();
+	}
+
+	static Sample* Create( SampleContext* context )
+	{
+		return new BenchmarkRagdolls( context );
+	}
+};
+
+static int benchmarkRagdolls = RegisterSample( "Benchmark", "Ragdolls", BenchmarkRagdolls::Create );
+
+class BenchmarkOpenWorld : public Sample
+{
+public:
+	explicit BenchmarkOpenWorld( SampleContext* context )
+		: Sample( context )
+	{
+		if ( m_context->restart == false )
+		{
+			m_context->camera.center = { 100.0f, 0.0f };
+			m_context->camera.zoom = 30.0f;
+		}
+
+		CreateOpenWorld( m_worldId );
+	}
+
+	static Sample* Create( SampleContext* context )
+	{
+		return new BenchmarkOpenWorld( context );
+	}
+};
+
+static int benchmarkOpenWorld = RegisterSample( "Benchmark", "Open World", BenchmarkOpenWorld::Create );
+
+class BenchmarkChurn : public Sample
+{
+public:
+	explicit BenchmarkChurn( SampleContext* context )
+		: Sample( context )
+	{
+		if ( m_context->restart == false )
+		{
+			m_context->camera.center = { 0.0f, 30.0f };
+			m_context->camera.zoom = 45.0f;
+		}
+
+		CreateChurn( m_worldId );
+	}
+
+	void Step() override
+	{
+		if ( m_context->pause == false || m_context->singleStep == true )
+		{
+			StepChurn( m_worldId, m_stepCount );
+		}
+
+		Sample::Step();
+	}
+
+	static Sample* Create( SampleContext* context )
+	{
+		return new BenchmarkChurn( context );
+	}
+};
+
+static int benchmarkChurn = RegisterSample( "Benchmark", "Churn", BenchmarkChurn::Create );
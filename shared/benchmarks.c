@@ -4,10 +4,13 @@
 #include "benchmarks.h"
 
 #include "human.h"
+#include "utils.h"
 
 #include "box2d/box2d.h"
+#include "box2d/math_functions.h"
 
 #include <assert.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -891,3 +894,486 @@ void CreateCompounds( b2WorldId worldId )
 		}
 	}
 }
+
+// Production sized worlds follow. These are much larger than the scenes above and reduced in debug builds.
+
+typedef struct
+{
+	b2BodyId sleeperIds[1024];
+	int sleeperCount;
+} SleepyWorldData;
+
+static SleepyWorldData g_sleepyWorldData;
+
+static b2BodyId CreateSleepyPyramid( b2WorldId worldId, int baseCount, float extent, float centerX, float baseY,
+									 bool enableSleep )
+{
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.enableSleep = enableSleep;
+
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+
+	b2Polygon box = b2MakeSquare( extent );
+	b2BodyId firstId = b2_nullBodyId;
+
+	for ( int i = 0; i < baseCount; ++i )
+	{
+		float y = ( 2.0f * i + 1.0f ) * extent + baseY;
+
+		for ( int j = i; j < baseCount; ++j )
+		{
+			float x = ( i + 1.0f ) * extent + 2.0f * ( j - i ) * extent + centerX;
+			bodyDef.position = (b2Vec2){ x, y };
+
+			b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+			b2CreatePolygonShape( bodyId, &shapeDef, &box );
+
+			if ( B2_IS_NULL( firstId ) )
+			{
+				firstId = bodyId;
+			}
+		}
+	}
+
+	return firstId;
+}
+
+// About 200k boxes in pyramids where 90% of the pyramids are put to sleep after the first step.
+// The awake pyramids never sleep. The cost of the sleeping bodies should be close to zero.
+void CreateSleepyWorld( b2WorldId worldId )
+{
+	memset( &g_sleepyWorldData, 0, sizeof( g_sleepyWorldData ) );
+
+	int baseCount = BENCHMARK_DEBUG ? 10 : 20;
+	int rowCount = BENCHMARK_DEBUG ? 4 : 24;
+	int columnCount = BENCHMARK_DEBUG ? 5 : 40;
+	float extent = 0.5f;
+
+	float pyramidWidth = 2.0f * extent * ( baseCount + 1.0f );
+	float rowHeight = 2.0f * extent * ( baseCount + 2.0f );
+	float groundWidth = pyramidWidth * columnCount;
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+
+	for ( int i = 0; i < rowCount; ++i )
+	{
+		float y = i * rowHeight;
+		b2Segment segment = { { -0.5f * groundWidth - 1.0f, y }, { 0.5f * groundWidth + 1.0f, y } };
+		b2CreateSegmentShape( groundId, &shapeDef, &segment );
+	}
+
+	int pyramidIndex = 0;
+	for ( int i = 0; i < rowCount; ++i )
+	{
+		for ( int j = 0; j < columnCount; ++j )
+		{
+			float centerX = -0.5f * groundWidth + j * pyramidWidth;
+			bool awake = pyramidIndex % 10 == 0;
+			b2BodyId bodyId = CreateSleepyPyramid( worldId, baseCount, extent, centerX, i * rowHeight, awake == false );
+
+			if ( awake == false )
+			{
+				assert( g_sleepyWorldData.sleeperCount < 1024 );
+				g_sleepyWorldData.sleeperIds[g_sleepyWorldData.sleeperCount++] = bodyId;
+			}
+
+			pyramidIndex += 1;
+		}
+	}
+}
+
+float StepSleepyWorld( b2WorldId worldId, int stepCount )
+{
+	(void)worldId;
+
+	// Each pyramid forms an island once its contacts begin touching in the first step
+	if ( stepCount == 1 )
+	{
+		for ( int i = 0; i < g_sleepyWorldData.sleeperCount; ++i )
+		{
+			b2Body_SetAwake( g_sleepyWorldData.sleeperIds[i], false );
+		}
+	}
+
+	return 0.0f;
+}
+
+typedef struct
+{
+	int beginCount;
+	int endCount;
+} TriggerFieldData;
+
+static TriggerFieldData g_triggerFieldData;
+
+// A field of 5000 static sensors with 2000 balls bouncing through it without gravity
+void CreateTriggerField( b2WorldId worldId )
+{
+	memset( &g_triggerFieldData, 0, sizeof( g_triggerFieldData ) );
+	g_randomSeed = RAND_SEED;
+
+	int sensorColumnCount = BENCHMARK_DEBUG ? 20 : 100;
+	int sensorRowCount = BENCHMARK_DEBUG ? 10 : 50;
+	int ballCount = BENCHMARK_DEBUG ? 200 : 2000;
+	float spacing = 4.0f;
+	float width = spacing * sensorColumnCount;
+	float height = spacing * sensorRowCount;
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+
+	{
+		b2ShapeDef shapeDef = b2DefaultShapeDef();
+		b2Vec2 points[4] = { { 0.0f, 0.0f }, { width, 0.0f }, { width, height }, { 0.0f, height } };
+		for ( int i = 0; i < 4; ++i )
+		{
+			b2Segment segment = { points[i], points[( i + 1 ) & 3] };
+			b2CreateSegmentShape( groundId, &shapeDef, &segment );
+		}
+	}
+
+	{
+		b2ShapeDef shapeDef = b2DefaultShapeDef();
+		shapeDef.isSensor = true;
+		shapeDef.enableSensorEvents = true;
+
+		for ( int i = 0; i < sensorRowCount; ++i )
+		{
+			for ( int j = 0; j < sensorColumnCount; ++j )
+			{
+				b2Vec2 center = { ( j + 0.5f ) * spacing, ( i + 0.5f ) * spacing };
+				b2Polygon box = b2MakeOffsetBox( 1.2f, 1.2f, center, b2Rot_identity );
+				b2CreatePolygonShape( groundId, &shapeDef, &box );
+			}
+		}
+	}
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.gravityScale = 0.0f;
+	bodyDef.enableSleep = false;
+
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	shapeDef.enableSensorEvents = true;
+	shapeDef.material.friction = 0.0f;
+	shapeDef.material.restitution = 1.0f;
+
+	b2Circle circle = { b2Vec2_zero, 0.25f };
+
+	for ( int i = 0; i < ballCount; ++i )
+	{
+		bodyDef.position = (b2Vec2){ RandomFloatRange( 1.0f, width - 1.0f ), RandomFloatRange( 1.0f, height - 1.0f ) };
+		bodyDef.linearVelocity = RandomVec2( -8.0f, 8.0f );
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2CreateCircleShape( bodyId, &shapeDef, &circle );
+	}
+}
+
+float StepTriggerField( b2WorldId worldId, int stepCount )
+{
+	(void)stepCount;
+
+	// Read the events of the previous step like a game would
+	b2SensorEvents events = b2World_GetSensorEvents( worldId );
+	g_triggerFieldData.beginCount += events.beginCount;
+	g_triggerFieldData.endCount += events.endCount;
+
+	return 0.0f;
+}
+
+#define RAGDOLL_COUNT 500
+
+typedef struct
+{
+	Human humans[RAGDOLL_COUNT];
+	int humanCount;
+} RagdollData;
+
+static RagdollData g_ragdollData;
+
+// 500 ragdolls dropped into a pit and kicked from time to time so they keep moving
+void CreateRagdolls( b2WorldId worldId )
+{
+	memset( &g_ragdollData, 0, sizeof( g_ragdollData ) );
+	g_randomSeed = RAND_SEED;
+
+	int columnCount = 25;
+	int rowCount = BENCHMARK_DEBUG ? 2 : RAGDOLL_COUNT / columnCount;
+	float spacingX = 2.0f;
+	float spacingY = 3.0f;
+	float halfWidth = 0.5f * spacingX * columnCount + 5.0f;
+
+	{
+		b2BodyDef bodyDef = b2DefaultBodyDef();
+		b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+		b2ShapeDef shapeDef = b2DefaultShapeDef();
+
+		b2Segment floor = { { -halfWidth, 0.0f }, { halfWidth, 0.0f } };
+		b2CreateSegmentShape( groundId, &shapeDef, &floor );
+
+		float wallHeight = spacingY * rowCount + 20.0f;
+		b2Segment leftWall = { { -halfWidth, 0.0f }, { -halfWidth - 10.0f, wallHeight } };
+		b2CreateSegmentShape( groundId, &shapeDef, &leftWall );
+
+		b2Segment rightWall = { { halfWidth, 0.0f }, { halfWidth + 10.0f, wallHeight } };
+		b2CreateSegmentShape( groundId, &shapeDef, &rightWall );
+	}
+
+	float scale = 1.0f;
+	float jointFriction = 0.05f;
+	float jointHertz = 5.0f;
+	float jointDamping = 0.5f;
+
+	for ( int i = 0; i < rowCount; ++i )
+	{
+		for ( int j = 0; j < columnCount; ++j )
+		{
+			b2Vec2 position = { ( j - 0.5f * ( columnCount - 1 ) ) * spacingX, 2.0f + i * spacingY };
+			Human* human = g_ragdollData.humans + g_ragdollData.humanCount;
+			CreateHuman( human, worldId, position, scale, jointFriction, jointHertz, jointDamping,
+						 g_ragdollData.humanCount + 1, NULL, false );
+			g_ragdollData.humanCount += 1;
+		}
+	}
+}
+
+float StepRagdolls( b2WorldId worldId, int stepCount )
+{
+	(void)worldId;
+
+	// Kick an eighth of the ragdolls every half second
+	if ( stepCount > 0 && stepCount % 30 == 0 )
+	{
+		for ( int i = ( stepCount / 30 ) & 7; i < g_ragdollData.humanCount; i += 8 )
+		{
+			Human_ApplyRandomAngularImpulse( g_ragdollData.humans + i, 20.0f );
+		}
+	}
+
+	return 0.0f;
+}
+
+// Rolling chain terrain with cars driving on it and props scattered around.
+// The cars follow samples/car.cpp.
+static void CreateCar( b2WorldId worldId, b2Vec2 position, float speed )
+{
+	float scale = 1.0f;
+	float hertz = 5.0f;
+	float dampingRatio = 0.7f;
+	float torque = 2.5f * scale;
+
+	b2Vec2 vertices[6] = {
+		{ -1.5f, -0.5f }, { 1.5f, -0.5f }, { 1.5f, 0.0f }, { 0.0f, 0.9f }, { -1.15f, 0.9f }, { -1.5f, 0.2f },
+	};
+
+	for ( int i = 0; i < 6; ++i )
+	{
+		vertices[i].x *= 0.85f * scale;
+		vertices[i].y *= 0.85f * scale;
+	}
+
+	b2Hull hull = b2ComputeHull( vertices, 6 );
+	b2Polygon chassis = b2MakePolygon( &hull, 0.15f * scale );
+
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	shapeDef.density = 1.0f / scale;
+	shapeDef.material.friction = 0.2f;
+
+	b2Circle circle = { { 0.0f, 0.0f }, 0.4f * scale };
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position = b2Add( (b2Vec2){ 0.0f, 1.0f * scale }, position );
+	b2BodyId chassisId = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( chassisId, &shapeDef, &chassis );
+
+	shapeDef.density = 2.0f / scale;
+	shapeDef.material.friction = 1.5f;
+	shapeDef.material.rollingResistance = 0.1f;
+
+	bodyDef.position = b2Add( (b2Vec2){ -1.0f * scale, 0.35f * scale }, position );
+	bodyDef.allowFastRotation = true;
+	b2BodyId rearWheelId = b2CreateBody( worldId, &bodyDef );
+	b2CreateCircleShape( rearWheelId, &shapeDef, &circle );
+
+	bodyDef.position = b2Add( (b2Vec2){ 1.0f * scale, 0.4f * scale }, position );
+	b2BodyId frontWheelId = b2CreateBody( worldId, &bodyDef );
+	b2CreateCircleShape( frontWheelId, &shapeDef, &circle );
+
+	b2BodyId wheelIds[2] = { rearWheelId, frontWheelId };
+	for ( int i = 0; i < 2; ++i )
+	{
+		b2Vec2 pivot = b2Body_GetPosition( wheelIds[i] );
+
+		b2WheelJointDef jointDef = b2DefaultWheelJointDef();
+		jointDef.base.bodyIdA = chassisId;
+		jointDef.base.bodyIdB = wheelIds[i];
+		jointDef.base.localFrameA.q = b2MakeRot( 0.5f * B2_PI );
+		jointDef.base.localFrameA.p = b2Body_GetLocalPoint( chassisId, pivot );
+		jointDef.base.localFrameB.p = b2Body_GetLocalPoint( wheelIds[i], pivot );
+		jointDef.motorSpeed = speed;
+		jointDef.maxMotorTorque = torque;
+		jointDef.enableMotor = true;
+		jointDef.hertz = hertz;
+		jointDef.dampingRatio = dampingRatio;
+		jointDef.lowerTranslation = -0.25f * scale;
+		jointDef.upperTranslation = 0.25f * scale;
+		jointDef.enableLimit = true;
+		b2CreateWheelJoint( worldId, &jointDef );
+	}
+}
+
+static float GetTerrainHeight( float x )
+{
+	return 6.0f * sinf( 0.011f * x ) + 2.0f * sinf( 0.057f * x ) + 0.4f * sinf( 0.31f * x );
+}
+
+void CreateOpenWorld( b2WorldId worldId )
+{
+	g_randomSeed = RAND_SEED;
+
+	int pointCount = BENCHMARK_DEBUG ? 500 : 4000;
+	int carCount = BENCHMARK_DEBUG ? 20 : 200;
+	int propCount = BENCHMARK_DEBUG ? 100 : 2000;
+	float pointSpacing = 1.0f;
+	float length = pointSpacing * ( pointCount - 1 );
+
+	{
+		b2BodyDef bodyDef = b2DefaultBodyDef();
+		b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+
+		// The solid side is to the right of the chain direction, so the points go from right to left
+		b2Vec2* points = malloc( pointCount * sizeof( b2Vec2 ) );
+		for ( int i = 0; i < pointCount; ++i )
+		{
+			float x = length - i * pointSpacing;
+			points[i] = (b2Vec2){ x, GetTerrainHeight( x ) };
+		}
+
+		b2SurfaceMaterial material = b2DefaultSurfaceMaterial();
+		material.friction = 0.8f;
+
+		b2ChainDef chainDef = b2DefaultChainDef();
+		chainDef.points = points;
+		chainDef.count = pointCount;
+		chainDef.materials = &material;
+		chainDef.materialCount = 1;
+		b2CreateChain( groundId, &chainDef );
+
+		free( points );
+	}
+
+	for ( int i = 0; i < carCount; ++i )
+	{
+		float x = ( i + 0.5f ) * length / carCount;
+		float speed = ( i & 1 ) ? 20.0f : -20.0f;
+		CreateCar( worldId, (b2Vec2){ x, GetTerrainHeight( x ) + 1.5f }, speed );
+	}
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	shapeDef.density = 0.5f;
+
+	for ( int i = 0; i < propCount; ++i )
+	{
+		float x = RandomFloatRange( 5.0f, length - 5.0f );
+		bodyDef.position = (b2Vec2){ x, GetTerrainHeight( x ) + 2.0f };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+
+		float size = RandomFloatRange( 0.2f, 0.6f );
+		if ( i & 1 )
+		{
+			b2Polygon box = b2MakeSquare( size );
+			b2CreatePolygonShape( bodyId, &shapeDef, &box );
+		}
+		else
+		{
+			b2Circle circle = { b2Vec2_zero, size };
+			b2CreateCircleShape( bodyId, &shapeDef, &circle );
+		}
+	}
+}
+
+#define CHURN_CAPACITY 8192
+
+typedef struct
+{
+	b2BodyId bodyIds[CHURN_CAPACITY];
+	int head;
+	int count;
+	int liveCount;
+} ChurnData;
+
+static ChurnData g_churnData;
+
+// Bodies rain into a bin. Each step spawns new bodies and despawns the oldest once the live count is reached.
+void CreateChurn( b2WorldId worldId )
+{
+	memset( &g_churnData, 0, sizeof( g_churnData ) );
+	g_randomSeed = RAND_SEED;
+
+	g_churnData.liveCount = BENCHMARK_DEBUG ? 500 : 6000;
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+
+	b2Vec2 points[4] = { { -60.0f, 60.0f }, { -40.0f, 0.0f }, { 40.0f, 0.0f }, { 60.0f, 60.0f } };
+	for ( int i = 0; i < 3; ++i )
+	{
+		b2Segment segment = { points[i], points[i + 1] };
+		b2CreateSegmentShape( groundId, &shapeDef, &segment );
+	}
+}
+
+float StepChurn( b2WorldId worldId, int stepCount )
+{
+	(void)stepCount;
+
+	int spawnCount = BENCHMARK_DEBUG ? 10 : 40;
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+
+	for ( int i = 0; i < spawnCount; ++i )
+	{
+		if ( g_churnData.count == g_churnData.liveCount )
+		{
+			int oldest = ( g_churnData.head - g_churnData.count + CHURN_CAPACITY ) % CHURN_CAPACITY;
+			b2DestroyBody( g_churnData.bodyIds[oldest] );
+			g_churnData.count -= 1;
+		}
+
+		bodyDef.position = (b2Vec2){ RandomFloatRange( -35.0f, 35.0f ), RandomFloatRange( 60.0f, 80.0f ) };
+		bodyDef.rotation = RandomRot();
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+
+		float size = RandomFloatRange( 0.2f, 0.5f );
+		int kind = RandomIntRange( 0, 2 );
+		if ( kind == 0 )
+		{
+			b2Circle circle = { b2Vec2_zero, size };
+			b2CreateCircleShape( bodyId, &shapeDef, &circle );
+		}
+		else if ( kind == 1 )
+		{
+			b2Capsule capsule = { { -size, 0.0f }, { size, 0.0f }, 0.5f * size };
+			b2CreateCapsuleShape( bodyId, &shapeDef, &capsule );
+		}
+		else
+		{
+			b2Polygon polygon = RandomPolygon( size );
+			b2CreatePolygonShape( bodyId, &shapeDef, &polygon );
+		}
+
+		g_churnData.bodyIds[g_churnData.head] = bodyId;
+		g_churnData.head = ( g_churnData.head + 1 ) % CHURN_CAPACITY;
+		g_churnData.count += 1;
+	}
+
+	return 0.0f;
+}
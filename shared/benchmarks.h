@@ -28,6 +28,15 @@ void CreateWasher( b2WorldId worldId );
 void CreateJunkyard( b2WorldId worldId );
 float StepJunkyard( b2WorldId worldId, int stepCount );
 void CreateCompounds( b2WorldId worldId );
+void CreateSleepyWorld( b2WorldId worldId );
+float StepSleepyWorld( b2WorldId worldId, int stepCount );
+void CreateTriggerField( b2WorldId worldId );
+float StepTriggerField( b2WorldId worldId, int stepCount );
+void CreateRagdolls( b2WorldId worldId );
+float StepRagdolls( b2WorldId worldId, int stepCount );
+void CreateOpenWorld( b2WorldId worldId );
+void CreateChurn( b2WorldId worldId );
+float StepChurn( b2WorldId worldId, int stepCount );
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,52 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+// Overlap test of four bounding boxes stored as SoA. Only include this from source files that
+// already use the intrinsics headers.
+
+#pragma once
+
+#include "box2d/math_functions.h"
+
+#if defined( B2_SIMD_AVX512 ) || defined( B2_SIMD_AVX2 ) || defined( B2_SIMD_SSE2 )
+#include <emmintrin.h>
+#elif defined( B2_SIMD_NEON )
+#include <arm_neon.h>
+#elif defined( B2_SIMD_WASM )
+#include <wasm_simd128.h>
+#endif
+
+// Bit mask of the four boxes that overlap the box a
+static inline int b2OverlapMask4( const float* lowerX, const float* lowerY, const float* upperX, const float* upperY, b2AABB a )
+{
+#if defined( B2_SIMD_AVX512 ) || defined( B2_SIMD_AVX2 ) || defined( B2_SIMD_SSE2 )
+	__m128 lx = _mm_cmple_ps( _mm_loadu_ps( lowerX ), _mm_set1_ps( a.upperBound.x ) );
+	__m128 ly = _mm_cmple_ps( _mm_loadu_ps( lowerY ), _mm_set1_ps( a.upperBound.y ) );
+	__m128 ux = _mm_cmple_ps( _mm_set1_ps( a.lowerBound.x ), _mm_loadu_ps( upperX ) );
+	__m128 uy = _mm_cmple_ps( _mm_set1_ps( a.lowerBound.y ), _mm_loadu_ps( upperY ) );
+	return _mm_movemask_ps( _mm_and_ps( _mm_and_ps( lx, ly ), _mm_and_ps( ux, uy ) ) );
+#elif defined( B2_SIMD_NEON )
+	uint32x4_t lx = vcleq_f32( vld1q_f32( lowerX ), vdupq_n_f32( a.upperBound.x ) );
+	uint32x4_t ly = vcleq_f32( vld1q_f32( lowerY ), vdupq_n_f32( a.upperBound.y ) );
+	uint32x4_t ux = vcleq_f32( vdupq_n_f32( a.lowerBound.x ), vld1q_f32( upperX ) );
+	uint32x4_t uy = vcleq_f32( vdupq_n_f32( a.lowerBound.y ), vld1q_f32( upperY ) );
+	uint32x4_t m = vandq_u32( vandq_u32( lx, ly ), vandq_u32( ux, uy ) );
+	return (int)( ( vgetq_lane_u32( m, 0 ) & 1 ) | ( vgetq_lane_u32( m, 1 ) & 2 ) | ( vgetq_lane_u32( m, 2 ) & 4 ) |
+				  ( vgetq_lane_u32( m, 3 ) & 8 ) );
+#elif defined( B2_SIMD_WASM )
+	v128_t lx = wasm_f32x4_le( wasm_v128_load( lowerX ), wasm_f32x4_splat( a.upperBound.x ) );
+	v128_t ly = wasm_f32x4_le( wasm_v128_load( lowerY ), wasm_f32x4_splat( a.upperBound.y ) );
+	v128_t ux = wasm_f32x4_le( wasm_f32x4_splat( a.lowerBound.x ), wasm_v128_load( upperX ) );
+	v128_t uy = wasm_f32x4_le( wasm_f32x4_splat( a.lowerBound.y ), wasm_v128_load( upperY ) );
+	return (int)wasm_i32x4_bitmask( wasm_v128_and( wasm_v128_and( lx, ly ), wasm_v128_and( ux, uy ) ) );
+#else
+	int mask = 0;
+	for ( int i = 0; i < 4; ++i )
+	{
+		bool overlap =
+			lowerX[i] <= a.upperBound.x && lowerY[i] <= a.upperBound.y && a.lowerBound.x <= upperX[i] && a.lowerBound.y <= upperY[i];
+		mask |= (int)overlap << i;
+	}
+	return mask;
+#endif
+}
@@ -5,12 +5,15 @@
 
 #include "core.h"
 
+#include "box2d/math_functions.h"
+
 #include <stdbool.h>
 #include <stddef.h>
 
 b2Stack b2CreateStack( int capacity )
 {
 	B2_ASSERT( capacity >= 0 );
+	b2AllocInfo previous = b2PushAllocTag( b2_allocTagStack, b2_allocLifetimeLong );
 	b2Stack allocator = { 0 };
 	allocator.capacity = capacity;
 	allocator.data = b2Alloc( capacity );
@@ -18,6 +21,7 @@ b2Stack b2CreateStack( int capacity )
 	allocator.maxAllocation = 0;
 	allocator.index = 0;
 	b2Array_CreateN( allocator.entries, 32 );
+	b2PopAllocInfo( previous );
 	return allocator;
 }
 
@@ -29,8 +33,8 @@ void b2DestroyStack( b2Stack* allocator )
 
 void* b2StackAlloc( b2Stack* alloc, int size, const char* name )
 {
-	// ensure allocation is 32 byte aligned to support 256-bit SIMD
-	int size32 = ( ( size - 1 ) | 0x1F ) + 1;
+	// ensure allocation is aligned to support 256-bit SIMD (512-bit with AVX-512)
+	int size32 = ( ( size - 1 ) | ( B2_ALIGNMENT - 1 ) ) + 1;
 
 	b2StackEntry entry;
 	entry.size = size32;
@@ -38,10 +42,11 @@ void* b2StackAlloc( b2Stack* alloc, int size, const char* name )
 	if ( alloc->index + size32 > alloc->capacity )
 	{
 		// fall back to the heap (undesirable)
-		entry.data = b2Alloc( size32 );
+		entry.data = b2AllocTagged( size32, b2_allocTagStack, b2_allocLifetimeTemporary );
 		entry.usedMalloc = true;
+		alloc->heapCount += 1;
 
-		B2_ASSERT( ( (uintptr_t)entry.data & 0x1F ) == 0 );
+		B2_ASSERT( ( (uintptr_t)entry.data & ( B2_ALIGNMENT - 1 ) ) == 0 );
 	}
 	else
 	{
@@ -49,7 +54,10 @@ void* b2StackAlloc( b2Stack* alloc, int size, const char* name )
 		entry.usedMalloc = false;
 		alloc->index += size32;
 
-		B2_ASSERT( ( (uintptr_t)entry.data & 0x1F ) == 0 );
+		B2_ASSERT( ( (uintptr_t)entry.data & ( B2_ALIGNMENT - 1 ) ) == 0 );
+
+		// Heap fallbacks are tracked by b2Alloc
+		b2TracyCAllocN( entry.data, size32, "Stack" );
 	}
 
 	alloc->allocation += size32;
@@ -75,22 +83,26 @@ void b2StackFree( b2Stack* alloc, void* mem )
 	else
 	{
 		alloc->index -= entry->size;
+		b2TracyCFreeN( mem, "Stack" );
 	}
 	alloc->allocation -= entry->size;
 	b2Array_Pop( alloc->entries );
 }
 
-void b2GrowStack( b2Stack* alloc )
+int b2GrowStack( b2Stack* alloc )
 {
 	// Stack must not be in use
 	B2_ASSERT( alloc->allocation == 0 );
 
+	int oldCapacity = alloc->capacity;
 	if ( alloc->maxAllocation > alloc->capacity )
 	{
 		b2Free( alloc->data, alloc->capacity );
 		alloc->capacity = alloc->maxAllocation + alloc->maxAllocation / 2;
-		alloc->data = b2Alloc( alloc->capacity );
+		alloc->data = b2AllocTagged( alloc->capacity, b2_allocTagStack, b2_allocLifetimeLong );
 	}
+
+	return alloc->capacity - oldCapacity;
 }
 
 int b2GetStackCapacity( b2Stack* alloc )
@@ -107,3 +119,120 @@ int b2GetMaxStackAllocation( b2Stack* alloc )
 {
 	return alloc->maxAllocation;
 }
+
+int b2GetStackHeapCount( b2Stack* alloc )
+{
+	return alloc->heapCount;
+}
+
+#define B2_ARENA_ALIGNMENT 16
+
+b2Arena b2CreateArena( int capacity )
+{
+	B2_ASSERT( capacity >= 0 );
+	b2Arena arena = { 0 };
+	arena.capacity = capacity;
+	arena.data = b2AllocTagged( capacity, b2_allocTagStack, b2_allocLifetimeLong );
+	arena.index = 0;
+	b2Array_Create( arena.blocks );
+	arena.blockIndex = 0;
+	arena.allocation = 0;
+	arena.maxAllocation = 0;
+	return arena;
+}
+
+static void b2FreeArenaBlocks( b2Arena* arena )
+{
+	for ( int i = 0; i < arena->blocks.count; ++i )
+	{
+		b2ArenaBlock* block = arena->blocks.data + i;
+		b2Free( block->data, block->capacity );
+	}
+
+	b2Array_Clear( arena->blocks );
+	arena->blockIndex = 0;
+}
+
+void b2DestroyArena( b2Arena* arena )
+{
+	b2FreeArenaBlocks( arena );
+	b2Array_Destroy( arena->blocks );
+	b2Free( arena->data, arena->capacity );
+	*arena = (b2Arena){ 0 };
+}
+
+void* b2ArenaAlloc( b2Arena* arena, int size )
+{
+	B2_ASSERT( size > 0 );
+
+	// Arena allocations are small and numerous so they are only aligned for 128-bit loads.
+	// Use the stack for wide SIMD data.
+	int size16 = ( ( size - 1 ) | ( B2_ARENA_ALIGNMENT - 1 ) ) + 1;
+
+	arena->allocation += size16;
+	if ( arena->allocation > arena->maxAllocation )
+	{
+		arena->maxAllocation = arena->allocation;
+	}
+
+	if ( arena->index + size16 <= arena->capacity )
+	{
+		char* data = arena->data + arena->index;
+		arena->index += size16;
+		return data;
+	}
+
+	// fall back to the heap (undesirable)
+	b2ArenaBlock* block = arena->blocks.count > 0 ? arena->blocks.data + ( arena->blocks.count - 1 ) : NULL;
+	if ( block == NULL || arena->blockIndex + size16 > block->capacity )
+	{
+		b2ArenaBlock newBlock;
+		newBlock.capacity = b2MaxInt( size16, b2MaxInt( arena->capacity, 4096 ) );
+		newBlock.data = b2AllocTagged( newBlock.capacity, b2_allocTagStack, b2_allocLifetimeTemporary );
+		b2Array_Push( arena->blocks, newBlock );
+		block = arena->blocks.data + ( arena->blocks.count - 1 );
+		arena->blockIndex = 0;
+		arena->heapCount += 1;
+	}
+
+	char* data = block->data + arena->blockIndex;
+	arena->blockIndex += size16;
+
+	B2_ASSERT( ( (uintptr_t)data & ( B2_ARENA_ALIGNMENT - 1 ) ) == 0 );
+	return data;
+}
+
+void b2ResetArena( b2Arena* arena )
+{
+	b2FreeArenaBlocks( arena );
+
+	if ( arena->maxAllocation > arena->capacity )
+	{
+		b2Free( arena->data, arena->capacity );
+		arena->capacity = arena->maxAllocation + arena->maxAllocation / 2;
+		arena->data = b2AllocTagged( arena->capacity, b2_allocTagStack, b2_allocLifetimeLong );
+	}
+
+	arena->index = 0;
+	arena->allocation = 0;
+}
+
+int b2GetArenaCapacity( b2Arena* arena )
+{
+	return arena->capacity;
+}
+
+int b2GetArenaAllocation( b2Arena* arena )
+{
+	return arena->allocation;
+}
+
+int b2GetMaxArenaAllocation( b2Arena* arena )
+{
+	return arena->maxAllocation;
+}
+
+int b2GetArenaHeapCount( b2Arena* arena )
+{
+	return arena->heapCount;
+}
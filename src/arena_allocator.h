@@ -8,6 +8,7 @@
 #include <stdbool.h>
 
 b2DeclareArray( b2StackEntry );
+b2DeclareArray( b2ArenaBlock );
 
 typedef struct b2StackEntry
 {
@@ -31,6 +32,9 @@ typedef struct b2Stack
 	int allocation;
 	int maxAllocation;
 
+	// Number of allocations that fell back to the heap since creation
+	int heapCount;
+
 	b2Array( b2StackEntry ) entries;
 } b2Stack;
 
@@ -40,10 +44,50 @@ void b2DestroyStack( b2Stack* allocator );
 void* b2StackAlloc( b2Stack* alloc, int size, const char* name );
 void b2StackFree( b2Stack* alloc, void* mem );
 
-// Grow the stack based on usage
-void b2GrowStack( b2Stack* alloc );
+// Grow the stack based on usage. Returns the number of bytes added.
+int b2GrowStack( b2Stack* alloc );
 
 int b2GetStackCapacity( b2Stack* alloc );
 int b2GetStackAllocation( b2Stack* alloc );
 int b2GetMaxStackAllocation( b2Stack* alloc );
+int b2GetStackHeapCount( b2Stack* alloc );
+
+typedef struct b2ArenaBlock
+{
+	char* data;
+	int capacity;
+} b2ArenaBlock;
+
+// This is a linear arena allocator owned by a single worker. Tasks may allocate from the arena of
+// their worker in any order and never free. All allocations are released together when the arena
+// is reset at the end of the step. This allocator uses heap blocks if space is insufficient and
+// grows on the next reset.
+typedef struct b2Arena
+{
+	char* data;
+	int capacity;
+	int index;
+
+	// Heap fallback, the last block is the current one
+	b2Array( b2ArenaBlock ) blocks;
+	int blockIndex;
+
+	int allocation;
+	int maxAllocation;
+
+	// Number of heap blocks allocated since creation
+	int heapCount;
+} b2Arena;
+
+b2Arena b2CreateArena( int capacity );
+void b2DestroyArena( b2Arena* arena );
+
+void* b2ArenaAlloc( b2Arena* arena, int size );
+
+// Release all allocations and grow the arena based on usage
+void b2ResetArena( b2Arena* arena );
 
+int b2GetArenaCapacity( b2Arena* arena );
+int b2GetArenaAllocation( b2Arena* arena );
+int b2GetMaxArenaAllocation( b2Arena* arena );
+int b2GetArenaHeapCount( b2Arena* arena );
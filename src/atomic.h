@@ -45,6 +45,17 @@ static inline int b2AtomicFetchAddInt( b2AtomicInt* a, int increment )
 #endif
 }
 
+static inline int b2AtomicFetchOrInt( b2AtomicInt* a, int bits )
+{
+#if defined( _MSC_VER )
+	return _InterlockedOr( (long*)&a->value, (long)bits );
+#elif defined( __GNUC__ ) || defined( __clang__ )
+	return __atomic_fetch_or( &a->value, bits, __ATOMIC_SEQ_CST );
+#else
+#error "Unsupported platform"
+#endif
+}
+
 static inline bool b2AtomicCompareExchangeInt( b2AtomicInt* a, int expected, int desired )
 {
 #if defined( _MSC_VER )
@@ -78,3 +89,67 @@ static inline uint32_t b2AtomicLoadU32( b2AtomicU32* a )
 #error "Unsupported platform"
 #endif
 }
+
+// Full memory barrier, keeps plain loads and stores on their side of a seqlock counter
+static inline void b2AtomicFence( void )
+{
+#if defined( _MSC_VER )
+	long fence = 0;
+	(void)_InterlockedOr( &fence, 0 );
+#elif defined( __GNUC__ ) || defined( __clang__ )
+	__atomic_thread_fence( __ATOMIC_SEQ_CST );
+#else
+#error "Unsupported platform"
+#endif
+}
+
+// Atomic access to a plain 64-bit value that is only shared for a phase, such as a hash set slot
+static inline uint64_t b2AtomicLoadU64( uint64_t* a )
+{
+#if defined( _MSC_VER )
+	return (uint64_t)_InterlockedCompareExchange64( (__int64*)a, 0, 0 );
+#elif defined( __GNUC__ ) || defined( __clang__ )
+	return __atomic_load_n( a, __ATOMIC_ACQUIRE );
+#else
+#error "Unsupported platform"
+#endif
+}
+
+static inline bool b2AtomicCompareExchangeU64( uint64_t* a, uint64_t expected, uint64_t desired )
+{
+#if defined( _MSC_VER )
+	return (uint64_t)_InterlockedCompareExchange64( (__int64*)a, (__int64)desired, (__int64)expected ) == expected;
+#elif defined( __GNUC__ ) || defined( __clang__ )
+	// The value written to expected is ignored
+	return __atomic_compare_exchange_n( a, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE );
+#else
+#error "Unsupported platform"
+#endif
+}
+
+// CPU hint for spin loops
+#if ( defined( __GNUC__ ) || defined( __clang__ ) ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+static inline void b2Pause( void )
+{
+	__asm__ __volatile__( "pause\n" );
+}
+#elif ( defined( __arm__ ) && defined( __ARM_ARCH ) && __ARM_ARCH >= 7 ) || defined( __aarch64__ )
+static inline void b2Pause( void )
+{
+	__asm__ __volatile__( "yield" ::: "memory" );
+}
+#elif defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+static inline void b2Pause( void )
+{
+	_mm_pause();
+}
+#elif defined( _MSC_VER ) && ( defined( _M_ARM ) || defined( _M_ARM64 ) )
+static inline void b2Pause( void )
+{
+	__yield();
+}
+#else
+static inline void b2Pause( void )
+{
+}
+#endif
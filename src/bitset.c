@@ -56,12 +56,44 @@ void b2GrowBitSet( b2BitSet* bitSet, uint32_t blockCount )
 	bitSet->blockCount = blockCount;
 }
 
+// The restrict pointers and the plain loop let the compiler vectorize the union with the enabled SIMD width.
+void b2InPlaceUnionRange( uint64_t* B2_RESTRICT bitsA, const uint64_t* B2_RESTRICT bitsB, uint32_t beginBlock,
+						  uint32_t endBlock )
+{
+	for ( uint32_t i = beginBlock; i < endBlock; ++i )
+	{
+		bitsA[i] |= bitsB[i];
+	}
+}
+
 void b2InPlaceUnion( b2BitSet* B2_RESTRICT setA, const b2BitSet* B2_RESTRICT setB )
 {
 	B2_ASSERT( setA->blockCount == setB->blockCount );
-	uint32_t blockCount = setA->blockCount;
-	for ( uint32_t i = 0; i < blockCount; ++i )
+	b2InPlaceUnionRange( setA->bits, setB->bits, 0, setA->blockCount );
+}
+
+// Four independent sums keep the popcounts from serializing on one accumulator
+int b2CountSetBitsRange( const uint64_t* bits, uint32_t beginBlock, uint32_t endBlock )
+{
+	int count0 = 0, count1 = 0, count2 = 0, count3 = 0;
+	uint32_t i = beginBlock;
+	for ( ; i + 4 <= endBlock; i += 4 )
 	{
-		setA->bits[i] |= setB->bits[i];
+		count0 += b2PopCount64( bits[i] );
+		count1 += b2PopCount64( bits[i + 1] );
+		count2 += b2PopCount64( bits[i + 2] );
+		count3 += b2PopCount64( bits[i + 3] );
 	}
+
+	for ( ; i < endBlock; ++i )
+	{
+		count0 += b2PopCount64( bits[i] );
+	}
+
+	return count0 + count1 + count2 + count3;
+}
+
+int b2CountSetBits( const b2BitSet* bitSet )
+{
+	return b2CountSetBitsRange( bitSet->bits, 0, bitSet->blockCount );
 }
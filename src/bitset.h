@@ -4,6 +4,7 @@
 #pragma once
 
 #include "core.h"
+#include "ctz.h"
 
 #include <stdbool.h>
 #include <stdint.h>
@@ -21,7 +22,12 @@ void b2DestroyBitSet( b2BitSet* bitSet );
 void b2SetBitCountAndClear( b2BitSet* bitSet, uint32_t bitCount );
 void b2InPlaceUnion( b2BitSet* setA, const b2BitSet* setB );
 void b2GrowBitSet( b2BitSet* bitSet, uint32_t blockCount );
-int b2CountSetBits( b2BitSet* bitSet );
+int b2CountSetBits( const b2BitSet* bitSet );
+
+// Word range versions used by parallel tasks. The range is [beginBlock, endBlock).
+void b2InPlaceUnionRange( uint64_t* B2_RESTRICT bitsA, const uint64_t* B2_RESTRICT bitsB, uint32_t beginBlock,
+						  uint32_t endBlock );
+int b2CountSetBitsRange( const uint64_t* bits, uint32_t beginBlock, uint32_t endBlock );
 
 static inline void b2SetBit( b2BitSet* bitSet, uint32_t bitIndex )
 {
@@ -64,3 +70,83 @@ static inline int b2GetBitSetBytes( b2BitSet* bitSet )
 {
 	return bitSet->blockCapacity * sizeof( uint64_t );
 }
+
+// Iterates the set bits in [beginBit, endBit) in increasing order. Runs of empty blocks are skipped
+// four at a time, which matters for sparse sets with millions of bits.
+//	b2BitIterator it = b2IterateBits( bitSet, 0, bitCount );
+//	uint32_t bitIndex;
+//	while ( b2NextSetBit( &it, &bitIndex ) ) { ... }
+// Bits may be cleared during iteration but bits set in blocks not yet reached will be visited.
+typedef struct b2BitIterator
+{
+	const uint64_t* bits;
+	uint64_t block;
+	uint64_t endMask;
+	uint32_t blockIndex;
+	uint32_t endBlock;
+} b2BitIterator;
+
+static inline b2BitIterator b2IterateBits( const b2BitSet* bitSet, uint32_t beginBit, uint32_t endBit )
+{
+	B2_ASSERT( endBit <= 64 * bitSet->blockCount );
+
+	b2BitIterator it = { 0 };
+	it.bits = bitSet->bits;
+	it.endBlock = ( endBit + 63 ) / 64;
+	it.endMask = endBit % 64 == 0 ? ~(uint64_t)0 : ( (uint64_t)1 << endBit % 64 ) - 1;
+
+	if ( beginBit >= endBit )
+	{
+		it.blockIndex = it.endBlock;
+		return it;
+	}
+
+	it.blockIndex = beginBit / 64;
+	it.block = it.bits[it.blockIndex] & ( ~(uint64_t)0 << beginBit % 64 );
+	if ( it.blockIndex + 1 == it.endBlock )
+	{
+		it.block &= it.endMask;
+	}
+
+	return it;
+}
+
+static inline bool b2NextSetBit( b2BitIterator* it, uint32_t* bitIndex )
+{
+	while ( it->block == 0 )
+	{
+		uint32_t blockIndex = it->blockIndex + 1;
+		uint32_t endBlock = it->endBlock;
+		if ( blockIndex >= endBlock )
+		{
+			it->blockIndex = endBlock;
+			return false;
+		}
+
+		const uint64_t* bits = it->bits;
+		while ( blockIndex + 4 <= endBlock &&
+				( bits[blockIndex] | bits[blockIndex + 1] | bits[blockIndex + 2] | bits[blockIndex + 3] ) == 0 )
+		{
+			blockIndex += 4;
+		}
+
+		if ( blockIndex == endBlock )
+		{
+			it->blockIndex = endBlock;
+			return false;
+		}
+
+		it->blockIndex = blockIndex;
+		it->block = bits[blockIndex];
+		if ( blockIndex + 1 == endBlock )
+		{
+			it->block &= it->endMask;
+		}
+	}
+
+	*bitIndex = 64 * it->blockIndex + b2CTZ64( it->block );
+
+	// Clear the smallest set bit
+	it->block = it->block & ( it->block - 1 );
+	return true;
+}
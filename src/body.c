@@ -4,12 +4,15 @@
 #include "body.h"
 
 #include "aabb.h"
+#include "arena_allocator.h"
+#include "bitset.h"
 #include "contact.h"
 #include "core.h"
 #include "id_pool.h"
 #include "island.h"
 #include "joint.h"
 #include "physics_world.h"
+#include "recorder.h"
 #include "sensor.h"
 #include "shape.h"
 #include "solver_set.h"
@@ -77,9 +80,9 @@ b2BodySim* b2GetBodySim( b2World* world, b2Body* body )
 
 b2BodyState* b2GetBodyState( b2World* world, b2Body* body )
 {
-	if ( body->setIndex == b2_awakeSet )
+	if ( b2IsMovingSet( body->setIndex ) )
 	{
-		b2SolverSet* set = b2Array_Get( world->solverSets, b2_awakeSet );
+		b2SolverSet* set = b2Array_Get( world->solverSets, body->setIndex );
 		return b2Array_Get( set->bodyStates, body->localIndex );
 	}
 
@@ -109,9 +112,11 @@ static void b2RemoveBodyFromIsland( b2World* world, b2Body* body )
 
 	int islandId = body->islandId;
 	b2Island* island = b2Array_Get( world->islands, islandId );
+	b2MarkDirty( world, b2_dirtyIsland, islandId );
 	{
 		int localIndex = body->islandIndex;
 		int movedBodyId = island->bodies.data[island->bodies.count - 1];
+		b2MarkDirty( world, b2_dirtyBody, movedBodyId );
 		island->bodies.data[localIndex] = movedBodyId;
 		B2_VALIDATE( world->bodies.data[movedBodyId].islandIndex == island->bodies.count - 1 );
 		world->bodies.data[movedBodyId].islandIndex = localIndex;
@@ -129,6 +134,9 @@ static void b2RemoveBodyFromIsland( b2World* world, b2Body* body )
 	}
 	else
 	{
+		// The removed body may have held the island together through constraints that were already
+		// unlinked. The recorded removed constraints cannot describe that, see b2Island::removedLinks.
+		island->untrackedRemovals = true;
 		b2ValidateIsland( world, islandId );
 	}
 
@@ -153,7 +161,7 @@ static void b2DestroyBodyContacts( b2World* world, b2Body* body, bool wakeBodies
 	b2ValidateSolverSets( world );
 }
 
-b2BodyId b2CreateBody( b2WorldId worldId, const b2BodyDef* def )
+static b2Body* b2CreateBodyInternal( b2World* world, const b2BodyDef* def )
 {
 	B2_CHECK_DEF( def );
 	B2_ASSERT( b2IsValidVec2( def->position ) );
@@ -165,14 +173,6 @@ b2BodyId b2CreateBody( b2WorldId worldId, const b2BodyDef* def )
 	B2_ASSERT( b2IsValidFloat( def->sleepThreshold ) && def->sleepThreshold >= 0.0f );
 	B2_ASSERT( b2IsValidFloat( def->gravityScale ) );
 
-	b2World* world = b2GetWorldFromId( worldId );
-	B2_ASSERT( world->locked == false );
-
-	if ( world->locked )
-	{
-		return b2_nullBodyId;
-	}
-
 	bool isAwake = ( def->isAwake || def->enableSleep == false ) && def->isEnabled;
 
 	// determine the solver set
@@ -216,6 +216,8 @@ b2BodyId b2CreateBody( b2WorldId worldId, const b2BodyDef* def )
 	lockFlags |= def->motionLocks.linearY ? b2_lockLinearY : 0;
 	lockFlags |= def->motionLocks.angularZ ? b2_lockAngularZ : 0;
 
+	world->bodyRefEpoch += 1;
+
 	b2SolverSet* set = b2Array_Get( world->solverSets, setId );
 	b2BodySim* bodySim = b2Array_Emplace( set->bodySims );
 	*bodySim = (b2BodySim){ 0 };
@@ -249,13 +251,23 @@ b2BodyId b2CreateBody( b2WorldId worldId, const b2BodyDef* def )
 
 	if ( bodyId == world->bodies.count )
 	{
-		b2Array_Push( world->bodies, (b2Body){ 0 } );
+		b2Array_Push( world->bodies, (b2Body){ .generation = world->bodyGenerationFloor } );
 	}
 	else
 	{
 		B2_ASSERT( world->bodies.data[bodyId].id == B2_NULL_INDEX );
 	}
 
+	if ( world->enableInterpolation )
+	{
+		if ( world->previousTransforms.count < world->bodies.count )
+		{
+			b2Array_Resize( world->previousTransforms, world->bodies.count );
+		}
+
+		world->previousTransforms.data[bodyId] = bodySim->transform;
+	}
+
 	b2Body* body = b2Array_Get( world->bodies, bodyId );
 
 	if ( def->name )
@@ -291,15 +303,27 @@ b2BodyId b2CreateBody( b2WorldId worldId, const b2BodyDef* def )
 	body->jointCount = 0;
 	body->islandId = B2_NULL_INDEX;
 	body->islandIndex = B2_NULL_INDEX;
+	body->islandStamp = 0;
 	body->bodyMoveIndex = B2_NULL_INDEX;
+	body->exportSlot = B2_NULL_INDEX;
+	body->reportedPosition = def->position;
+	body->reportedAngle = b2Rot_GetAngle( def->rotation );
+	body->toiShapeId = B2_NULL_INDEX;
+	body->toiFastShapeId = B2_NULL_INDEX;
+	body->toiCache = b2_emptySimplexCache;
 	body->id = bodyId;
 	body->mass = 0.0f;
 	body->inertia = 0.0f;
 	body->sleepThreshold = def->sleepThreshold;
 	body->sleepTime = 0.0f;
+	body->simulationInterval = b2MaxInt( 1, def->simulationInterval );
+	world->lodBodyCount += body->simulationInterval > 1 ? 1 : 0;
+	body->parkedLinearVelocity = b2Vec2_zero;
+	body->parkedAngularVelocity = 0.0f;
 	body->type = def->type;
 	body->flags = bodySim->flags;
 	body->enableSleep = def->enableSleep;
+	b2MarkBodyDirty( world, body );
 
 	// dynamic and kinematic bodies that are enabled need a island
 	if ( setId >= b2_awakeSet )
@@ -307,9 +331,235 @@ b2BodyId b2CreateBody( b2WorldId worldId, const b2BodyDef* def )
 		b2CreateIslandForBody( world, setId, body );
 	}
 
+	return body;
+}
+
+b2BodyId b2CreateBody( b2WorldId worldId, const b2BodyDef* def )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+
+	if ( world->locked )
+	{
+		return b2_nullBodyId;
+	}
+
+	b2Body* body = b2CreateBodyInternal( world, def );
+
 	b2ValidateSolverSets( world );
 
-	b2BodyId id = { bodyId + 1, world->worldId, body->generation };
+	b2BodyId id = { body->id + 1, world->worldId, body->generation };
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCreateBody( world->recorder, def, id );
+	}
+
+	return id;
+}
+
+void b2CreateBodies( b2WorldId worldId, const b2BodyDef* bodyDefs, const b2ShapeDef* shapeDefs, const b2Polygon* polygons,
+					 int count, b2BodyId* bodyIds )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+
+	if ( world->locked || count <= 0 )
+	{
+		return;
+	}
+
+	b2TracyCZoneNC( create_bodies, "Create Bodies", b2_colorDarkOrange, true );
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCreateBodies( world->recorder, bodyDefs, shapeDefs, polygons, count );
+	}
+
+	// Reserve storage once for the whole batch
+	int awakeCount = 0;
+	int staticCount = 0;
+	for ( int i = 0; i < count; ++i )
+	{
+		const b2BodyDef* def = bodyDefs + i;
+		if ( def->isEnabled && def->type == b2_staticBody )
+		{
+			staticCount += 1;
+		}
+		else if ( def->isEnabled && ( def->isAwake || def->enableSleep == false ) )
+		{
+			awakeCount += 1;
+		}
+	}
+
+	b2Array_Reserve( world->bodies, world->bodies.count + count );
+	b2Array_Reserve( world->shapes, world->shapes.count + count );
+	b2Array_Reserve( world->islands, world->islands.count + awakeCount );
+
+	b2SolverSet* staticSet = b2Array_Get( world->solverSets, b2_staticSet );
+	b2Array_Reserve( staticSet->bodySims, staticSet->bodySims.count + staticCount );
+
+	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
+	b2Array_Reserve( awakeSet->bodySims, awakeSet->bodySims.count + awakeCount );
+	b2Array_Reserve( awakeSet->bodyStates, awakeSet->bodyStates.count + awakeCount );
+	b2Array_Reserve( awakeSet->islandSims, awakeSet->islandSims.count + awakeCount );
+
+	b2Stack* alloc = &world->stack;
+	int* shapeIds = b2StackAlloc( alloc, count * sizeof( int ), "shape ids" );
+	bool* forcePairCreation = b2StackAlloc( alloc, count * sizeof( bool ), "force pairs" );
+	int proxyCount = 0;
+
+	for ( int i = 0; i < count; ++i )
+	{
+		const b2ShapeDef* shapeDef = shapeDefs + i;
+		B2_CHECK_DEF( shapeDef );
+		B2_ASSERT( b2IsValidFloat( shapeDef->density ) && shapeDef->density >= 0.0f );
+		B2_ASSERT( b2IsValidFloat( polygons[i].radius ) && polygons[i].radius >= 0.0f );
+
+		b2Body* body = b2CreateBodyInternal( world, bodyDefs + i );
+		b2Shape* shape = b2CreateShapeWithoutProxy( world, body, shapeDef, polygons + i, b2_polygonShape );
+
+		if ( body->setIndex != b2_disabledSet )
+		{
+			shapeIds[proxyCount] = shape->id;
+			forcePairCreation[proxyCount] = shapeDef->invokeContactCreation || shapeDef->isSensor;
+			proxyCount += 1;
+		}
+
+		if ( shapeDef->updateBodyMass == true )
+		{
+			b2UpdateBodyMassData( world, body );
+		}
+		else
+		{
+			body->flags |= b2_dirtyMass;
+		}
+
+		if ( bodyIds != NULL )
+		{
+			bodyIds[i] = (b2BodyId){ body->id + 1, world->worldId, body->generation };
+		}
+	}
+
+	if ( proxyCount > 0 )
+	{
+		b2CreateShapeProxies( world, shapeIds, forcePairCreation, proxyCount );
+	}
+
+	b2StackFree( alloc, forcePairCreation );
+	b2StackFree( alloc, shapeIds );
+
+	b2ValidateSolverSets( world );
+
+	b2TracyCZoneEnd( create_bodies );
+}
+
+b2StaticTile b2MakeStaticTile( const b2BodyDef* bodyDef, const b2ShapeDef* shapeDef, const b2Polygon* polygons, int count )
+{
+	B2_CHECK_DEF( bodyDef );
+	B2_CHECK_DEF( shapeDef );
+	B2_ASSERT( bodyDef->type == b2_staticBody );
+	B2_ASSERT( count > 0 );
+
+	b2StaticTile tile = { 0 };
+	tile.bodyDef = *bodyDef;
+	tile.shapeDef = *shapeDef;
+	tile.polygons = b2Alloc( count * sizeof( b2Polygon ) );
+	memcpy( tile.polygons, polygons, count * sizeof( b2Polygon ) );
+	tile.count = count;
+
+	b2AABB* aabbs = b2Alloc( count * sizeof( b2AABB ) );
+	uint64_t* categoryBits = b2Alloc( count * sizeof( uint64_t ) );
+	uint64_t* userData = b2Alloc( count * sizeof( uint64_t ) );
+	int* proxyIds = b2Alloc( count * sizeof( int ) );
+
+	// These must match the static shape bounds computed by b2UpdateShapeAABBs
+	b2Transform transform = { bodyDef->position, bodyDef->rotation };
+	float speculativeDistance = b2GetShapeDefSpeculativeDistance( shapeDef );
+	for ( int i = 0; i < count; ++i )
+	{
+		b2AABB aabb = b2ComputePolygonAABB( polygons + i, transform );
+		aabb.lowerBound.x -= speculativeDistance;
+		aabb.lowerBound.y -= speculativeDistance;
+		aabb.upperBound.x += speculativeDistance;
+		aabb.upperBound.y += speculativeDistance;
+
+		aabbs[i].lowerBound.x = aabb.lowerBound.x - speculativeDistance;
+		aabbs[i].lowerBound.y = aabb.lowerBound.y - speculativeDistance;
+		aabbs[i].upperBound.x = aabb.upperBound.x + speculativeDistance;
+		aabbs[i].upperBound.y = aabb.upperBound.y + speculativeDistance;
+		categoryBits[i] = shapeDef->filter.categoryBits;
+		userData[i] = (uint64_t)i;
+	}
+
+	tile.tree = b2DynamicTree_Create( count );
+	b2DynamicTree_CreateProxies( &tile.tree, aabbs, categoryBits, userData, count, proxyIds );
+
+	b2Free( proxyIds, count * sizeof( int ) );
+	b2Free( userData, count * sizeof( uint64_t ) );
+	b2Free( categoryBits, count * sizeof( uint64_t ) );
+	b2Free( aabbs, count * sizeof( b2AABB ) );
+
+	return tile;
+}
+
+void b2DestroyStaticTile( b2StaticTile* tile )
+{
+	b2DynamicTree_Destroy( &tile->tree );
+	b2Free( tile->polygons, tile->count * sizeof( b2Polygon ) );
+	tile->polygons = NULL;
+	tile->count = 0;
+}
+
+b2BodyId b2CreateTileBody( b2WorldId worldId, const b2StaticTile* tile )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	B2_ASSERT( tile->count > 0 && b2DynamicTree_GetProxyCount( &tile->tree ) == tile->count );
+
+	if ( world->locked )
+	{
+		return b2_nullBodyId;
+	}
+
+	b2TracyCZoneNC( create_tile, "Create Tile", b2_colorDarkOrange, true );
+
+	int count = tile->count;
+	b2Array_Reserve( world->shapes, world->shapes.count + count );
+
+	b2Body* body = b2CreateBodyInternal( world, &tile->bodyDef );
+
+	b2Stack* alloc = &world->stack;
+	int* shapeIds = b2StackAlloc( alloc, count * sizeof( int ), "shape ids" );
+	bool* forcePairCreation = b2StackAlloc( alloc, count * sizeof( bool ), "force pairs" );
+
+	const b2ShapeDef* shapeDef = &tile->shapeDef;
+	for ( int i = 0; i < count; ++i )
+	{
+		b2Shape* shape = b2CreateShapeWithoutProxy( world, body, shapeDef, tile->polygons + i, b2_polygonShape );
+		shapeIds[i] = shape->id;
+		forcePairCreation[i] = shapeDef->invokeContactCreation || shapeDef->isSensor;
+	}
+
+	if ( body->setIndex != b2_disabledSet )
+	{
+		b2GraftShapeProxies( world, shapeIds, forcePairCreation, count, &tile->tree );
+	}
+
+	b2StackFree( alloc, forcePairCreation );
+	b2StackFree( alloc, shapeIds );
+
+	b2ValidateSolverSets( world );
+
+	b2TracyCZoneEnd( create_tile );
+
+	b2BodyId id = { body->id + 1, world->worldId, body->generation };
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCreateTileBody( world->recorder, tile, id );
+	}
+
 	return id;
 }
 
@@ -325,6 +575,57 @@ bool b2WakeBody( b2World* world, b2Body* body )
 	return false;
 }
 
+// Free the chains, island link, sim and id of a body whose joints, contacts and shapes are gone
+static void b2FreeBody( b2World* world, b2Body* body )
+{
+	// Destroy the attached chains. The associated shapes have already been destroyed.
+	int chainId = body->headChainId;
+	while ( chainId != B2_NULL_INDEX )
+	{
+		b2ChainShape* chain = b2Array_Get( world->chainShapes, chainId );
+
+		b2FreeChainData( chain );
+
+		// Return chain to free list.
+		b2FreeId( &world->chainIdPool, chainId );
+		b2MarkDirty( world, b2_dirtyChain, chainId );
+		chain->id = B2_NULL_INDEX;
+
+		chainId = chain->nextChainId;
+	}
+
+	b2RemoveBodyFromIsland( world, body );
+	b2MarkBodyDirty( world, body );
+
+	if ( body->simulationInterval > 1 )
+	{
+		world->lodBodyCount -= 1;
+	}
+
+	// Remove body sim from solver set that owns it
+	world->bodyRefEpoch += 1;
+	b2SolverSet* set = b2Array_Get( world->solverSets, body->setIndex );
+	b2RemoveBodySim( &set->bodySims, &world->bodies, body->localIndex );
+
+	// Remove body state from awake or kinematic set
+	if ( b2IsMovingSet( body->setIndex ) )
+	{
+		(void)b2Array_RemoveSwap( set->bodyStates, body->localIndex );
+	}
+	else if ( set->setIndex >= b2_firstSleepingSet && set->bodySims.count == 0 )
+	{
+		// Remove solver set if it is empty
+		b2DestroySolverSet( world, set->setIndex );
+	}
+
+	// Free body and id (preserve body generation)
+	b2FreeId( &world->bodyIdPool, body->id );
+
+	body->setIndex = B2_NULL_INDEX;
+	body->localIndex = B2_NULL_INDEX;
+	body->id = B2_NULL_INDEX;
+}
+
 void b2DestroyBody( b2BodyId bodyId )
 {
 	b2World* world = b2GetWorldLocked( bodyId.world0 );
@@ -335,6 +636,12 @@ void b2DestroyBody( b2BodyId bodyId )
 
 	b2Body* body = b2GetBodyFullId( world, bodyId );
 
+	if ( world->recorder != NULL )
+	{
+		b2RecordCall( world->recorder, b2_recordDestroyBody );
+		b2RecordValue( world->recorder, bodyId );
+	}
+
 	// Wake bodies attached to this body, even if this body is static.
 	bool wakeBodies = true;
 
@@ -355,7 +662,12 @@ void b2DestroyBody( b2BodyId bodyId )
 	// Destroy all contacts attached to this body.
 	b2DestroyBodyContacts( world, body, wakeBodies );
 
-	// Destroy the attached shapes and their broad-phase proxies.
+	// Destroy the attached shapes and their broad-phase proxies. The proxies are removed in bulk so
+	// the shapes of a large static body, such as a tile, come out of the tree together.
+	b2Stack* alloc = &world->stack;
+	int* shapeIds = b2StackAlloc( alloc, body->shapeCount * sizeof( int ), "shape ids" );
+	int shapeCount = 0;
+
 	int shapeId = body->headShapeId;
 	while ( shapeId != B2_NULL_INDEX )
 	{
@@ -366,55 +678,220 @@ void b2DestroyBody( b2BodyId bodyId )
 			b2DestroySensor( world, shape );
 		}
 
-		b2DestroyShapeProxy( shape, &world->broadPhase );
+		shapeIds[shapeCount] = shapeId;
+		shapeCount += 1;
+		shapeId = shape->nextShapeId;
+	}
+
+	B2_ASSERT( shapeCount == body->shapeCount );
+	b2DestroyShapeProxies( world, shapeIds, shapeCount );
+
+	for ( int i = 0; i < shapeCount; ++i )
+	{
+		b2Shape* shape = b2Array_Get( world->shapes, shapeIds[i] );
 
 		// Return shape to free list.
-		b2FreeId( &world->shapeIdPool, shapeId );
+		b2FreeId( &world->shapeIdPool, shapeIds[i] );
+		b2MarkDirty( world, b2_dirtyShape, shapeIds[i] );
 		shape->id = B2_NULL_INDEX;
+	}
 
-		shapeId = shape->nextShapeId;
+	b2StackFree( alloc, shapeIds );
+
+	b2FreeBody( world, body );
+
+	b2ValidateSolverSets( world );
+}
+
+void b2DestroyBodies( const b2BodyId* bodyIds, int count )
+{
+	if ( count <= 0 )
+	{
+		return;
 	}
 
-	// Destroy the attached chains. The associated shapes have already been destroyed above.
-	int chainId = body->headChainId;
-	while ( chainId != B2_NULL_INDEX )
+	b2World* world = b2GetWorldLocked( bodyIds[0].world0 );
+	if ( world == NULL )
 	{
-		b2ChainShape* chain = b2Array_Get( world->chainShapes, chainId );
+		return;
+	}
 
-		b2FreeChainData( chain );
+	b2TracyCZoneNC( destroy_bodies, "Destroy Bodies", b2_colorDarkOrange, true );
 
-		// Return chain to free list.
-		b2FreeId( &world->chainIdPool, chainId );
-		chain->id = B2_NULL_INDEX;
+	if ( world->recorder != NULL )
+	{
+		b2RecordCall( world->recorder, b2_recordDestroyBodies );
+		b2RecordValue( world->recorder, count );
+		b2RecordBytes( world->recorder, bodyIds, count * (int)sizeof( b2BodyId ) );
+	}
 
-		chainId = chain->nextChainId;
+	// Mark everything first so links between doomed bodies can be dropped without waking anything
+	int shapeCount = 0;
+	for ( int i = 0; i < count; ++i )
+	{
+		B2_ASSERT( bodyIds[i].world0 == bodyIds[0].world0 );
+		b2Body* body = b2GetBodyFullId( world, bodyIds[i] );
+		B2_ASSERT( ( body->flags & b2_isDoomed ) == 0 );
+		body->flags |= b2_isDoomed;
+		shapeCount += body->shapeCount;
 	}
 
-	b2RemoveBodyFromIsland( world, body );
+	// Islands that are fully destroyed are dropped whole. Their contacts are detached so they are not
+	// unlinked one by one and the island is never queued for splitting.
+	b2BitSet checkedIslands = b2CreateBitSet( world->islands.count );
+	b2SetBitCountAndClear( &checkedIslands, world->islands.count );
+	for ( int i = 0; i < count; ++i )
+	{
+		b2Body* body = b2Array_Get( world->bodies, bodyIds[i].index1 - 1 );
+		int islandId = body->islandId;
+		if ( islandId == B2_NULL_INDEX || b2GetBit( &checkedIslands, islandId ) )
+		{
+			continue;
+		}
 
-	// Remove body sim from solver set that owns it
-	b2SolverSet* set = b2Array_Get( world->solverSets, body->setIndex );
-	b2RemoveBodySim( &set->bodySims, &world->bodies, body->localIndex );
+		b2SetBit( &checkedIslands, islandId );
 
-	// Remove body state from awake set
-	if ( body->setIndex == b2_awakeSet )
+		b2Island* island = b2Array_Get( world->islands, islandId );
+		bool doomed = true;
+		for ( int j = 0; j < island->bodies.count; ++j )
+		{
+			if ( ( world->bodies.data[island->bodies.data[j]].flags & b2_isDoomed ) == 0 )
+			{
+				doomed = false;
+				break;
+			}
+		}
+
+		if ( doomed == false )
+		{
+			continue;
+		}
+
+		// Joints only connect to the island bodies or to static bodies, so nothing needs waking
+		while ( island->joints.count > 0 )
+		{
+			b2Joint* joint = b2Array_Get( world->joints, island->joints.data[island->joints.count - 1].jointId );
+			b2DestroyJointInternal( world, joint, false );
+		}
+
+		for ( int j = 0; j < island->contacts.count; ++j )
+		{
+			b2Contact* contact = b2Array_Get( world->contacts, island->contacts.data[j].contactId );
+			contact->islandId = B2_NULL_INDEX;
+			contact->islandIndex = B2_NULL_INDEX;
+		}
+
+		for ( int j = 0; j < island->bodies.count; ++j )
+		{
+			b2Body* islandBody = world->bodies.data + island->bodies.data[j];
+			islandBody->islandId = B2_NULL_INDEX;
+			islandBody->islandIndex = B2_NULL_INDEX;
+		}
+
+		island->bodies.count = 0;
+		island->contacts.count = 0;
+		b2DestroyIsland( world, islandId );
+	}
+
+	b2DestroyBitSet( &checkedIslands );
+
+	// Surviving bodies are woken after everything is destroyed, so the solver sets don't move mid-way
+	b2Array( int ) wakeIds;
+	b2Array_Create( wakeIds );
+
+	b2Stack* alloc = &world->stack;
+	int* shapeIds = b2StackAlloc( alloc, b2MaxInt( 1, shapeCount ) * sizeof( int ), "shape ids" );
+	shapeCount = 0;
+
+	for ( int i = 0; i < count; ++i )
 	{
-		(void)b2Array_RemoveSwap( set->bodyStates, body->localIndex );
+		b2Body* body = b2Array_Get( world->bodies, bodyIds[i].index1 - 1 );
+
+		int edgeKey = body->headJointKey;
+		while ( edgeKey != B2_NULL_INDEX )
+		{
+			int jointId = edgeKey >> 1;
+			int edgeIndex = edgeKey & 1;
+
+			b2Joint* joint = b2Array_Get( world->joints, jointId );
+			edgeKey = joint->edges[edgeIndex].nextKey;
+
+			int otherId = joint->edges[edgeIndex ^ 1].bodyId;
+			b2DestroyJointInternal( world, joint, false );
+
+			if ( ( world->bodies.data[otherId].flags & b2_isDoomed ) == 0 )
+			{
+				b2Array_Push( wakeIds, otherId );
+			}
+		}
+
+		edgeKey = body->headContactKey;
+		while ( edgeKey != B2_NULL_INDEX )
+		{
+			int contactId = edgeKey >> 1;
+			int edgeIndex = edgeKey & 1;
+
+			b2Contact* contact = b2Array_Get( world->contacts, contactId );
+			edgeKey = contact->edges[edgeIndex].nextKey;
+
+			int otherId = contact->edges[edgeIndex ^ 1].bodyId;
+			bool touching = ( contact->flags & b2_contactTouchingFlag ) != 0;
+			b2DestroyContact( world, contact, false );
+
+			if ( touching && ( world->bodies.data[otherId].flags & b2_isDoomed ) == 0 )
+			{
+				b2Array_Push( wakeIds, otherId );
+			}
+		}
+
+		int shapeId = body->headShapeId;
+		while ( shapeId != B2_NULL_INDEX )
+		{
+			b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+
+			if ( shape->sensorIndex != B2_NULL_INDEX )
+			{
+				b2DestroySensor( world, shape );
+			}
+
+			shapeIds[shapeCount] = shapeId;
+			shapeCount += 1;
+			shapeId = shape->nextShapeId;
+		}
 	}
-	else if ( set->setIndex >= b2_firstSleepingSet && set->bodySims.count == 0 )
+
+	// One broad-phase pass for all shapes
+	b2DestroyShapeProxies( world, shapeIds, shapeCount );
+
+	for ( int i = 0; i < shapeCount; ++i )
 	{
-		// Remove solver set if it is empty
-		b2DestroySolverSet( world, set->setIndex );
+		b2Shape* shape = b2Array_Get( world->shapes, shapeIds[i] );
+
+		// Return shape to free list.
+		b2FreeId( &world->shapeIdPool, shapeIds[i] );
+		b2MarkDirty( world, b2_dirtyShape, shapeIds[i] );
+		shape->id = B2_NULL_INDEX;
 	}
 
-	// Free body and id (preserve body generation)
-	b2FreeId( &world->bodyIdPool, body->id );
+	b2StackFree( alloc, shapeIds );
 
-	body->setIndex = B2_NULL_INDEX;
-	body->localIndex = B2_NULL_INDEX;
-	body->id = B2_NULL_INDEX;
+	for ( int i = 0; i < count; ++i )
+	{
+		b2Body* body = b2Array_Get( world->bodies, bodyIds[i].index1 - 1 );
+		body->flags &= ~b2_isDoomed;
+		b2FreeBody( world, body );
+	}
+
+	for ( int i = 0; i < wakeIds.count; ++i )
+	{
+		b2WakeBody( world, world->bodies.data + wakeIds.data[i] );
+	}
+
+	b2Array_Destroy( wakeIds );
 
 	b2ValidateSolverSets( world );
+
+	b2TracyCZoneEnd( destroy_bodies );
 }
 
 int b2Body_GetContactCapacity( b2BodyId bodyId )
@@ -460,8 +937,7 @@ int b2Body_GetContactData( b2BodyId bodyId, b2ContactData* contactData, int capa
 			contactData[index].shapeIdA = (b2ShapeId){ shapeA->id + 1, bodyId.world0, shapeA->generation };
 			contactData[index].shapeIdB = (b2ShapeId){ shapeB->id + 1, bodyId.world0, shapeB->generation };
 
-			b2ContactSim* contactSim = b2GetContactSim( world, contact );
-			contactData[index].manifold = contactSim->manifold;
+			contactData[index].manifold = b2GetContactManifold( world, contact );
 
 			index += 1;
 		}
@@ -500,8 +976,19 @@ b2AABB b2Body_ComputeAABB( b2BodyId bodyId )
 	return aabb;
 }
 
+void b2MarkBodyDirty( b2World* world, b2Body* body )
+{
+	b2MarkDirty( world, b2_dirtyBody, body->id );
+	b2MarkDirty( world, b2_dirtySolverSet, body->setIndex );
+}
+
 void b2UpdateBodyMassData( b2World* world, b2Body* body )
 {
+	b2MarkBodyDirty( world, body );
+
+	// The joint anchors are relative to the center of mass
+	b2InvalidateJointPrepare( world, body );
+
 	b2BodySim* bodySim = b2GetBodySim( world, body );
 
 	// Mass is no longer dirty
@@ -698,6 +1185,16 @@ void b2Body_SetTransform( b2BodyId bodyId, b2Vec2 position, b2Rot rotation )
 	B2_ASSERT( world->locked == false );
 
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCall( world->recorder, b2_recordSetTransform );
+		b2RecordValue( world->recorder, bodyId );
+		b2RecordValue( world->recorder, position );
+		b2RecordValue( world->recorder, rotation );
+	}
+
 	b2BodySim* bodySim = b2GetBodySim( world, body );
 
 	bodySim->transform.p = position;
@@ -707,21 +1204,38 @@ void b2Body_SetTransform( b2BodyId bodyId, b2Vec2 position, b2Rot rotation )
 	bodySim->rotation0 = bodySim->transform.q;
 	bodySim->center0 = bodySim->center;
 
+	// Teleports are not reported, so move deltas restart from here
+	body->reportedPosition = position;
+	body->reportedAngle = b2Rot_GetAngle( rotation );
+
+	// Teleports are not interpolated either
+	if ( world->enableInterpolation )
+	{
+		world->previousTransforms.data[body->id] = bodySim->transform;
+	}
+
+	// Awake bodies are picked up by the next incremental sensor update because they move in the step
+	if ( b2IsMovingSet( body->setIndex ) == false )
+	{
+		world->sensorFullUpdate = true;
+	}
+
 	b2BroadPhase* broadPhase = &world->broadPhase;
 
 	b2Transform transform = bodySim->transform;
-	const float speculativeDistance = B2_SPECULATIVE_DISTANCE;
 
 	int shapeId = body->headShapeId;
 	while ( shapeId != B2_NULL_INDEX )
 	{
 		b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+		const float speculativeDistance = shape->speculativeDistance;
 		b2AABB aabb = b2ComputeShapeAABB( shape, transform );
 		aabb.lowerBound.x -= speculativeDistance;
 		aabb.lowerBound.y -= speculativeDistance;
 		aabb.upperBound.x += speculativeDistance;
 		aabb.upperBound.y += speculativeDistance;
 		shape->aabb = aabb;
+		shape->sensorAABB = b2AABB_Union( shape->sensorAABB, aabb );
 
 		if ( b2AABB_Contains( shape->fatAABB, aabb ) == false )
 		{
@@ -753,6 +1267,10 @@ b2Vec2 b2Body_GetLinearVelocity( b2BodyId bodyId )
 	{
 		return state->linearVelocity;
 	}
+	if ( b2KeepsVelocity( world, body->setIndex ) )
+	{
+		return body->parkedLinearVelocity;
+	}
 	return b2Vec2_zero;
 }
 
@@ -765,6 +1283,10 @@ float b2Body_GetAngularVelocity( b2BodyId bodyId )
 	{
 		return state->angularVelocity;
 	}
+	if ( b2KeepsVelocity( world, body->setIndex ) )
+	{
+		return body->parkedAngularVelocity;
+	}
 	return 0.0;
 }
 
@@ -772,6 +1294,14 @@ void b2Body_SetLinearVelocity( b2BodyId bodyId, b2Vec2 linearVelocity )
 {
 	b2World* world = b2GetWorld( bodyId.world0 );
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCall( world->recorder, b2_recordSetLinearVelocity );
+		b2RecordValue( world->recorder, bodyId );
+		b2RecordValue( world->recorder, linearVelocity );
+	}
 
 	if ( body->type == b2_staticBody )
 	{
@@ -790,12 +1320,21 @@ void b2Body_SetLinearVelocity( b2BodyId bodyId, b2Vec2 linearVelocity )
 	}
 
 	state->linearVelocity = linearVelocity;
+	state->flags &= ~b2_isResting;
 }
 
 void b2Body_SetAngularVelocity( b2BodyId bodyId, float angularVelocity )
 {
 	b2World* world = b2GetWorld( bodyId.world0 );
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCall( world->recorder, b2_recordSetAngularVelocity );
+		b2RecordValue( world->recorder, bodyId );
+		b2RecordValue( world->recorder, angularVelocity );
+	}
 
 	if ( body->type == b2_staticBody || ( body->flags & b2_lockAngularZ ) )
 	{
@@ -814,12 +1353,23 @@ void b2Body_SetAngularVelocity( b2BodyId bodyId, float angularVelocity )
 	}
 
 	state->angularVelocity = angularVelocity;
+	state->flags &= ~b2_isResting;
 }
 
 void b2Body_SetTargetTransform( b2BodyId bodyId, b2Transform target, float timeStep, bool wake )
 {
 	b2World* world = b2GetWorld( bodyId.world0 );
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCall( world->recorder, b2_recordSetTargetTransform );
+		b2RecordValue( world->recorder, bodyId );
+		b2RecordValue( world->recorder, target );
+		b2RecordValue( world->recorder, timeStep );
+		b2RecordValue( world->recorder, wake );
+	}
 
 	if ( body->setIndex == b2_disabledSet )
 	{
@@ -831,7 +1381,7 @@ void b2Body_SetTargetTransform( b2BodyId bodyId, b2Transform target, float timeS
 		return;
 	}
 
-	if ( body->setIndex != b2_awakeSet && wake == false )
+	if ( b2IsMovingSet( body->setIndex ) == false && wake == false )
 	{
 		return;
 	}
@@ -851,7 +1401,7 @@ void b2Body_SetTargetTransform( b2BodyId bodyId, b2Transform target, float timeS
 	float angularVelocity = invTimeStep * deltaAngle;
 
 	// Early out if the body is asleep already and the desired movement is small
-	if ( body->setIndex != b2_awakeSet )
+	if ( b2IsMovingSet( body->setIndex ) == false )
 	{
 		float maxVelocity = b2Length( linearVelocity ) + b2AbsFloat( angularVelocity ) * sim->maxExtent;
 
@@ -865,11 +1415,12 @@ void b2Body_SetTargetTransform( b2BodyId bodyId, b2Transform target, float timeS
 		b2WakeBody( world, body );
 	}
 
-	B2_ASSERT( body->setIndex == b2_awakeSet );
+	B2_ASSERT( b2IsMovingSet( body->setIndex ) );
 
 	b2BodyState* state = b2GetBodyState( world, body );
 	state->linearVelocity = linearVelocity;
 	state->angularVelocity = angularVelocity;
+	state->flags &= ~b2_isResting;
 }
 
 b2Vec2 b2Body_GetLocalPointVelocity( b2BodyId bodyId, b2Vec2 localPoint )
@@ -912,6 +1463,16 @@ void b2Body_ApplyForce( b2BodyId bodyId, b2Vec2 force, b2Vec2 point, bool wake )
 {
 	b2World* world = b2GetWorld( bodyId.world0 );
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCall( world->recorder, b2_recordApplyForce );
+		b2RecordValue( world->recorder, bodyId );
+		b2RecordValue( world->recorder, force );
+		b2RecordValue( world->recorder, point );
+		b2RecordValue( world->recorder, wake );
+	}
 
 	if ( body->type != b2_dynamicBody || body->setIndex == b2_disabledSet )
 	{
@@ -935,6 +1496,15 @@ void b2Body_ApplyForceToCenter( b2BodyId bodyId, b2Vec2 force, bool wake )
 {
 	b2World* world = b2GetWorld( bodyId.world0 );
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCall( world->recorder, b2_recordApplyForceToCenter );
+		b2RecordValue( world->recorder, bodyId );
+		b2RecordValue( world->recorder, force );
+		b2RecordValue( world->recorder, wake );
+	}
 
 	if ( body->type != b2_dynamicBody || body->setIndex == b2_disabledSet )
 	{
@@ -957,6 +1527,15 @@ void b2Body_ApplyTorque( b2BodyId bodyId, float torque, bool wake )
 {
 	b2World* world = b2GetWorld( bodyId.world0 );
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCall( world->recorder, b2_recordApplyTorque );
+		b2RecordValue( world->recorder, bodyId );
+		b2RecordValue( world->recorder, torque );
+		b2RecordValue( world->recorder, wake );
+	}
 
 	if ( body->type != b2_dynamicBody || body->setIndex == b2_disabledSet )
 	{
@@ -979,6 +1558,7 @@ void b2Body_ClearForces( b2BodyId bodyId )
 {
 	b2World* world = b2GetWorld( bodyId.world0 );
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
 	b2BodySim* bodySim = b2GetBodySim( world, body );
 	bodySim->force = b2Vec2_zero;
 	bodySim->torque = 0.0f;
@@ -988,6 +1568,16 @@ void b2Body_ApplyLinearImpulse( b2BodyId bodyId, b2Vec2 impulse, b2Vec2 point, b
 {
 	b2World* world = b2GetWorld( bodyId.world0 );
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCall( world->recorder, b2_recordApplyLinearImpulse );
+		b2RecordValue( world->recorder, bodyId );
+		b2RecordValue( world->recorder, impulse );
+		b2RecordValue( world->recorder, point );
+		b2RecordValue( world->recorder, wake );
+	}
 
 	if ( body->type != b2_dynamicBody || body->setIndex == b2_disabledSet )
 	{
@@ -1009,6 +1599,7 @@ void b2Body_ApplyLinearImpulse( b2BodyId bodyId, b2Vec2 impulse, b2Vec2 point, b
 		state->angularVelocity += bodySim->invInertia * b2Cross( b2Sub( point, bodySim->center ), impulse );
 
 		b2LimitVelocity( state, world->maxLinearSpeed );
+		state->flags &= ~b2_isResting;
 	}
 }
 
@@ -1016,6 +1607,15 @@ void b2Body_ApplyLinearImpulseToCenter( b2BodyId bodyId, b2Vec2 impulse, bool wa
 {
 	b2World* world = b2GetWorld( bodyId.world0 );
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCall( world->recorder, b2_recordApplyLinearImpulseToCenter );
+		b2RecordValue( world->recorder, bodyId );
+		b2RecordValue( world->recorder, impulse );
+		b2RecordValue( world->recorder, wake );
+	}
 
 	if ( body->type != b2_dynamicBody || body->setIndex == b2_disabledSet )
 	{
@@ -1036,6 +1636,7 @@ void b2Body_ApplyLinearImpulseToCenter( b2BodyId bodyId, b2Vec2 impulse, bool wa
 		state->linearVelocity = b2MulAdd( state->linearVelocity, bodySim->invMass, impulse );
 
 		b2LimitVelocity( state, world->maxLinearSpeed );
+		state->flags &= ~b2_isResting;
 	}
 }
 
@@ -1044,6 +1645,15 @@ void b2Body_ApplyAngularImpulse( b2BodyId bodyId, float impulse, bool wake )
 	B2_ASSERT( b2Body_IsValid( bodyId ) );
 	b2World* world = b2GetWorld( bodyId.world0 );
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCall( world->recorder, b2_recordApplyAngularImpulse );
+		b2RecordValue( world->recorder, bodyId );
+		b2RecordValue( world->recorder, impulse );
+		b2RecordValue( world->recorder, wake );
+	}
 
 	if ( body->type != b2_dynamicBody || body->setIndex == b2_disabledSet )
 	{
@@ -1063,7 +1673,126 @@ void b2Body_ApplyAngularImpulse( b2BodyId bodyId, float impulse, bool wake )
 		b2BodyState* state = b2Array_Get( set->bodyStates, localIndex );
 		b2BodySim* bodySim = b2Array_Get( set->bodySims, localIndex );
 		state->angularVelocity += bodySim->invInertia * impulse;
+		state->flags &= ~b2_isResting;
+	}
+}
+
+// Resolve a queued body id. The body may have been destroyed since the command was queued.
+static b2Body* b2GetCommandBody( b2World* world, b2BodyId bodyId )
+{
+	if ( bodyId.world0 != world->worldId || bodyId.index1 < 1 || world->bodies.count < bodyId.index1 )
+	{
+		return NULL;
+	}
+
+	b2Body* body = world->bodies.data + ( bodyId.index1 - 1 );
+	if ( body->setIndex == B2_NULL_INDEX || body->generation != bodyId.generation )
+	{
+		return NULL;
+	}
+
+	return body;
+}
+
+void b2ApplyBodyCommands( b2World* world )
+{
+	int workerCount = world->taskContexts.count;
+	int commandCount = 0;
+	for ( int i = 0; i < workerCount; ++i )
+	{
+		commandCount += world->taskContexts.data[i].bodyCommands.count;
+	}
+
+	if ( commandCount == 0 )
+	{
+		return;
+	}
+
+	b2TracyCZoneNC( body_commands, "Body Commands", b2_colorLightSlateGray, true );
+
+	// Wake first so each sleeping set is moved once and no command sees a stale local index
+	for ( int i = 0; i < workerCount; ++i )
+	{
+		b2Array( b2BodyCommand )* commands = &world->taskContexts.data[i].bodyCommands;
+		for ( int j = 0; j < commands->count; ++j )
+		{
+			b2BodyCommand* command = commands->data + j;
+			if ( command->wake == false )
+			{
+				continue;
+			}
+
+			// Only dynamic bodies respond to forces and impulses
+			b2Body* body = b2GetCommandBody( world, command->bodyId );
+			b2BodyType minType = command->type == b2_bodyLinearVelocity ? b2_kinematicBody : b2_dynamicBody;
+			if ( body != NULL && body->type >= minType )
+			{
+				b2WakeBody( world, body );
+			}
+		}
+	}
+
+	float maxLinearSpeed = world->maxLinearSpeed;
+
+	for ( int i = 0; i < workerCount; ++i )
+	{
+		b2Array( b2BodyCommand )* commands = &world->taskContexts.data[i].bodyCommands;
+		for ( int j = 0; j < commands->count; ++j )
+		{
+			b2BodyCommand* command = commands->data + j;
+			b2Body* body = b2GetCommandBody( world, command->bodyId );
+			if ( body == NULL || b2IsMovingSet( body->setIndex ) == false || body->type == b2_staticBody )
+			{
+				continue;
+			}
+
+			b2SolverSet* set = world->solverSets.data + body->setIndex;
+			b2BodyState* state = set->bodyStates.data + body->localIndex;
+			b2BodySim* bodySim = set->bodySims.data + body->localIndex;
+
+			switch ( command->type )
+			{
+				case b2_bodyForce:
+					if ( body->type == b2_dynamicBody )
+					{
+						bodySim->force = b2Add( bodySim->force, command->value );
+						bodySim->torque += b2Cross( b2Sub( command->point, bodySim->center ), command->value );
+					}
+					break;
+
+				case b2_bodyLinearImpulse:
+					if ( body->type == b2_dynamicBody )
+					{
+						b2Vec2 impulse = command->value;
+						state->linearVelocity = b2MulAdd( state->linearVelocity, bodySim->invMass, impulse );
+						state->angularVelocity += bodySim->invInertia * b2Cross( b2Sub( command->point, bodySim->center ), impulse );
+						b2LimitVelocity( state, maxLinearSpeed );
+						state->flags &= ~b2_isResting;
+					}
+					break;
+
+				case b2_bodyLinearVelocity:
+					state->linearVelocity = command->value;
+					state->flags &= ~b2_isResting;
+					break;
+
+				case b2_bodyTorque:
+					if ( body->type == b2_dynamicBody )
+					{
+						bodySim->torque += command->value.x;
+					}
+					break;
+
+				default:
+					B2_ASSERT( false );
+					break;
+			}
+		}
+
+		b2Array_Clear( *commands );
 	}
+
+	b2TracyCZoneEnd( body_commands );
 }
 
 b2BodyType b2Body_GetType( b2BodyId bodyId )
@@ -1104,6 +1833,14 @@ void b2Body_SetType( b2BodyId bodyId, b2BodyType type )
 {
 	b2World* world = b2GetWorld( bodyId.world0 );
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCall( world->recorder, b2_recordSetBodyType );
+		b2RecordValue( world->recorder, bodyId );
+		b2RecordValue( world->recorder, type );
+	}
 
 	b2BodyType originalType = body->type;
 	if ( originalType == type )
@@ -1131,7 +1868,9 @@ void b2Body_SetType( b2BodyId bodyId, b2BodyType type )
 		return;
 	}
 
-	// Stage 2: destroy all contacts but don't wake bodies (because we don't need to)
+	// Stage 2: move a kinematic set body back to the awake set, then destroy all contacts but don't
+	// wake bodies (because we don't need to)
+	b2AttachKinematicBody( world, body );
 	bool wakeBodies = false;
 	b2DestroyBodyContacts( world, body, wakeBodies );
 
@@ -1293,6 +2032,7 @@ void b2Body_SetName( b2BodyId bodyId, const char* name )
 {
 	b2World* world = b2GetWorld( bodyId.world0 );
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
 
 	if ( name )
 	{
@@ -1326,6 +2066,7 @@ void b2Body_SetUserData( b2BodyId bodyId, void* userData )
 {
 	b2World* world = b2GetWorld( bodyId.world0 );
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
 	body->userData = userData;
 }
 
@@ -1379,6 +2120,7 @@ void b2Body_SetMassData( b2BodyId bodyId, b2MassData massData )
 	}
 
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
 	b2BodySim* bodySim = b2GetBodySim( world, body );
 
 	body->mass = massData.mass;
@@ -1411,6 +2153,7 @@ void b2Body_ApplyMassFromShapes( b2BodyId bodyId )
 	}
 
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
 	b2UpdateBodyMassData( world, body );
 }
 
@@ -1425,6 +2168,7 @@ void b2Body_SetLinearDamping( b2BodyId bodyId, float linearDamping )
 	}
 
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
 	b2BodySim* bodySim = b2GetBodySim( world, body );
 	bodySim->linearDamping = linearDamping;
 }
@@ -1448,6 +2192,7 @@ void b2Body_SetAngularDamping( b2BodyId bodyId, float angularDamping )
 	}
 
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
 	b2BodySim* bodySim = b2GetBodySim( world, body );
 	bodySim->angularDamping = angularDamping;
 }
@@ -1472,6 +2217,7 @@ void b2Body_SetGravityScale( b2BodyId bodyId, float gravityScale )
 	}
 
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
 	b2BodySim* bodySim = b2GetBodySim( world, body );
 	bodySim->gravityScale = gravityScale;
 }
@@ -1489,7 +2235,9 @@ bool b2Body_IsAwake( b2BodyId bodyId )
 {
 	b2World* world = b2GetWorld( bodyId.world0 );
 	b2Body* body = b2GetBodyFullId( world, bodyId );
-	return body->setIndex == b2_awakeSet;
+
+	// Parked bodies are awake, their island is only simulated on its update steps
+	return b2IsMovingSet( body->setIndex ) || b2IsParkedSet( world, body->setIndex );
 }
 
 void b2Body_SetAwake( b2BodyId bodyId, bool awake )
@@ -1501,13 +2249,24 @@ void b2Body_SetAwake( b2BodyId bodyId, bool awake )
 	}
 
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCall( world->recorder, b2_recordSetAwake );
+		b2RecordValue( world->recorder, bodyId );
+		b2RecordValue( world->recorder, awake );
+	}
 
 	if ( awake && body->setIndex >= b2_firstSleepingSet )
 	{
 		b2WakeBody( world, body );
 	}
-	else if ( awake == false && body->setIndex == b2_awakeSet )
+	else if ( awake == false && b2IsMovingSet( body->setIndex ) )
 	{
+		// Only islands in the awake set go to sleep
+		b2AttachKinematicBody( world, body );
+
 		b2Island* island = b2Array_Get( world->islands, body->islandId );
 		if ( island->constraintRemoveCount > 0 )
 		{
@@ -1523,6 +2282,7 @@ void b2Body_WakeTouching( b2BodyId bodyId )
 {
 	b2World* world = b2GetWorld( bodyId.world0 );
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
 
 	int contactKey = body->headContactKey;
 	while ( contactKey != B2_NULL_INDEX )
@@ -1567,6 +2327,7 @@ void b2Body_SetSleepThreshold( b2BodyId bodyId, float sleepThreshold )
 {
 	b2World* world = b2GetWorld( bodyId.world0 );
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
 	body->sleepThreshold = sleepThreshold;
 }
 
@@ -1577,6 +2338,63 @@ float b2Body_GetSleepThreshold( b2BodyId bodyId )
 	return body->sleepThreshold;
 }
 
+void b2Body_SetSimulationInterval( b2BodyId bodyId, int interval )
+{
+	b2World* world = b2GetWorldLocked( bodyId.world0 );
+	if ( world == NULL )
+	{
+		return;
+	}
+
+	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
+
+	interval = b2MaxInt( 1, interval );
+	world->lodBodyCount += ( interval > 1 ? 1 : 0 ) - ( body->simulationInterval > 1 ? 1 : 0 );
+	body->simulationInterval = interval;
+
+	// A parked island must catch up right away when it no longer has an interval
+	if ( interval == 1 && b2IsParkedSet( world, body->setIndex ) )
+	{
+		b2WakeSolverSet( world, body->setIndex );
+	}
+}
+
+int b2Body_GetSimulationInterval( b2BodyId bodyId )
+{
+	b2World* world = b2GetWorld( bodyId.world0 );
+	b2Body* body = b2GetBodyFullId( world, bodyId );
+	return body->simulationInterval;
+}
+
+void b2Body_SetExportSlot( b2BodyId bodyId, int slot )
+{
+	b2World* world = b2GetWorldLocked( bodyId.world0 );
+	if ( world == NULL )
+	{
+		return;
+	}
+
+	B2_ASSERT( slot == B2_NULL_INDEX || ( 0 <= slot && slot < world->exportCapacity ) );
+
+	b2Body* body = b2GetBodyFullId( world, bodyId );
+	body->exportSlot = slot < 0 ? B2_NULL_INDEX : slot;
+
+	if ( body->exportSlot != B2_NULL_INDEX )
+	{
+		b2BeginExport( world );
+		b2ExportBody( world, body );
+		b2EndExport( world );
+	}
+}
+
+int b2Body_GetExportSlot( b2BodyId bodyId )
+{
+	b2World* world = b2GetWorld( bodyId.world0 );
+	b2Body* body = b2GetBodyFullId( world, bodyId );
+	return body->exportSlot;
+}
+
 void b2Body_EnableSleep( b2BodyId bodyId, bool enableSleep )
 {
 	b2World* world = b2GetWorldLocked( bodyId.world0 );
@@ -1586,6 +2404,7 @@ void b2Body_EnableSleep( b2BodyId bodyId, bool enableSleep )
 	}
 
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
 	body->enableSleep = enableSleep;
 
 	if ( enableSleep == false )
@@ -1605,6 +2424,14 @@ void b2Body_Disable( b2BodyId bodyId )
 	}
 
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCall( world->recorder, b2_recordDisableBody );
+		b2RecordValue( world->recorder, bodyId );
+	}
+
 	if ( body->setIndex == b2_disabledSet )
 	{
 		return;
@@ -1675,6 +2502,14 @@ void b2Body_Enable( b2BodyId bodyId )
 	}
 
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCall( world->recorder, b2_recordEnableBody );
+		b2RecordValue( world->recorder, bodyId );
+	}
+
 	if ( body->setIndex != b2_disabledSet )
 	{
 		return;
@@ -1770,6 +2605,7 @@ void b2Body_SetMotionLocks( b2BodyId bodyId, b2MotionLocks locks )
 	newFlags |= locks.angularZ ? b2_lockAngularZ : 0;
 
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
 	if ( ( body->flags & b2_allLocks ) != newFlags )
 	{
 		body->flags &= ~b2_allLocks;
@@ -1824,6 +2660,7 @@ void b2Body_SetBullet( b2BodyId bodyId, bool flag )
 	}
 
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
 	b2BodySim* bodySim = b2GetBodySim( world, body );
 
 	if ( flag )
@@ -1848,6 +2685,7 @@ void b2Body_EnableContactEvents( b2BodyId bodyId, bool flag )
 {
 	b2World* world = b2GetWorld( bodyId.world0 );
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
 	int shapeId = body->headShapeId;
 	while ( shapeId != B2_NULL_INDEX )
 	{
@@ -1861,6 +2699,7 @@ void b2Body_EnableHitEvents( b2BodyId bodyId, bool flag )
 {
 	b2World* world = b2GetWorld( bodyId.world0 );
 	b2Body* body = b2GetBodyFullId( world, bodyId );
+	b2MarkBodyDirty( world, body );
 	int shapeId = body->headShapeId;
 	while ( shapeId != B2_NULL_INDEX )
 	{
@@ -1970,3 +2809,105 @@ bool b2ShouldBodiesCollide( b2World* world, b2Body* bodyA, b2Body* bodyB )
 
 	return true;
 }
+
+static b2BodyRef b2MakeBodyRef( b2World* world, b2Body* body )
+{
+	b2SolverSet* set = b2Array_Get( world->solverSets, body->setIndex );
+	b2BodyRef ref;
+	ref.sim = b2Array_Get( set->bodySims, body->localIndex );
+	ref.state = b2IsMovingSet( body->setIndex ) ? set->bodyStates.data + body->localIndex : NULL;
+	ref.epoch = world->bodyRefEpoch;
+	ref.world0 = (uint16_t)world->worldId;
+	ref.worldGeneration = world->generation;
+	return ref;
+}
+
+b2BodyRef b2Body_GetRef( b2BodyId bodyId )
+{
+	b2World* world = b2GetWorld( bodyId.world0 );
+	B2_ASSERT( world->locked == false );
+	b2Body* body = b2GetBodyFullId( world, bodyId );
+	return b2MakeBodyRef( world, body );
+}
+
+void b2World_GetBodyRefs( b2WorldId worldId, const b2BodyId* bodyIds, int count, b2BodyRef* refs )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	for ( int i = 0; i < count; ++i )
+	{
+		B2_ASSERT( bodyIds[i].world0 == world->worldId );
+		b2Body* body = b2GetBodyFullId( world, bodyIds[i] );
+		refs[i] = b2MakeBodyRef( world, body );
+	}
+}
+
+b2Transform b2BodyRef_GetTransform( b2BodyRef ref )
+{
+	B2_ASSERT( b2BodyRef_IsValid( ref ) );
+	const b2BodySim* bodySim = ref.sim;
+	return bodySim->transform;
+}
+
+b2Vec2 b2BodyRef_GetPosition( b2BodyRef ref )
+{
+	B2_ASSERT( b2BodyRef_IsValid( ref ) );
+	const b2BodySim* bodySim = ref.sim;
+	return bodySim->transform.p;
+}
+
+b2Vec2 b2BodyRef_GetWorldCenterOfMass( b2BodyRef ref )
+{
+	B2_ASSERT( b2BodyRef_IsValid( ref ) );
+	const b2BodySim* bodySim = ref.sim;
+	return bodySim->center;
+}
+
+b2Vec2 b2BodyRef_GetLinearVelocity( b2BodyRef ref )
+{
+	B2_ASSERT( b2BodyRef_IsValid( ref ) );
+	const b2BodyState* state = ref.state;
+	return state != NULL ? state->linearVelocity : b2Vec2_zero;
+}
+
+float b2BodyRef_GetAngularVelocity( b2BodyRef ref )
+{
+	B2_ASSERT( b2BodyRef_IsValid( ref ) );
+	const b2BodyState* state = ref.state;
+	return state != NULL ? state->angularVelocity : 0.0f;
+}
+
+void b2BodyRef_GetStates( const b2BodyRef* refs, int count, const b2BodyStateArrays* arrays )
+{
+	for ( int i = 0; i < count; ++i )
+	{
+		B2_ASSERT( b2BodyRef_IsValid( refs[i] ) );
+		const b2BodySim* bodySim = refs[i].sim;
+		const b2BodyState* state = refs[i].state;
+
+		if ( arrays->positions != NULL )
+		{
+			arrays->positions[i] = bodySim->transform.p;
+		}
+
+		if ( arrays->rotations != NULL )
+		{
+			arrays->rotations[i] = bodySim->transform.q;
+		}
+
+		if ( arrays->linearVelocities != NULL )
+		{
+			arrays->linearVelocities[i] = state != NULL ? state->linearVelocity : b2Vec2_zero;
+		}
+
+		if ( arrays->angularVelocities != NULL )
+		{
+			arrays->angularVelocities[i] = state != NULL ? state->angularVelocity : 0.0f;
+		}
+	}
+}
@@ -52,6 +52,19 @@ enum b2BodyFlags
 	// computation but b2Body_ApplyMassFromShapes was not called before the world step.
 	b2_dirtyMass = 0x00000400,
 
+	// This body moved slower than its sleep threshold in the previous time step.
+	// Contacts between resting bodies skip relax iterations in adaptive relax mode.
+	// Used for b2BodyState flags.
+	b2_isResting = 0x00000800,
+
+	// This body is being destroyed by b2DestroyBodies
+	b2_isDoomed = 0x00001000,
+
+	// The island of this body is solved by its own task in the current time step, so the graph
+	// coloring stages skip the body. See b2WorldDef::islandSolveBodyCount.
+	// Used for b2BodyState flags.
+	b2_isIslandSolved = 0x00002000,
+
 	// All lock flags
 	b2_allLocks = b2_lockAngularZ | b2_lockLinearX | b2_lockLinearY,
 };
@@ -91,6 +104,9 @@ typedef struct b2Body
 	// Need this island index for faster union-find
 	int islandIndex;
 
+	// Marks the body during an incremental island split search
+	uint64_t islandStamp;
+
 	float mass;
 
 	// Rotational inertia about the center of mass.
@@ -99,9 +115,29 @@ typedef struct b2Body
 	float sleepThreshold;
 	float sleepTime;
 
+	// See b2BodyDef::simulationInterval
+	int simulationInterval;
+
+	// Velocity kept while the island of this body is parked or frozen, see b2KeepsVelocity
+	b2Vec2 parkedLinearVelocity;
+	float parkedAngularVelocity;
+
 	// this is used to adjust the fellAsleep flag in the body move array
 	int bodyMoveIndex;
 
+	// Slot in the state export buffer, see b2Body_SetExportSlot. May be B2_NULL_INDEX.
+	int exportSlot;
+
+	// Transform of the last reported move event, used by the move event thresholds and deltas
+	b2Vec2 reportedPosition;
+	float reportedAngle;
+
+	// Persistent time of impact cache for the last continuous hit of this body.
+	// See b2WorldDef::enableContinuousCache.
+	int toiShapeId;
+	int toiFastShapeId;
+	b2SimplexCache toiCache;
+
 	int id;
 
 	// b2BodyFlags
@@ -223,8 +259,14 @@ void b2RemoveBodySim( b2Array( b2BodySim )* bodySims, b2Array( b2Body )* bodies,
 // careful calling this because it can invalidate body, state, joint, and contact pointers
 bool b2WakeBody( b2World* world, b2Body* body );
 
+// Apply and clear the body commands queued with b2World_QueueBodyCommands
+void b2ApplyBodyCommands( b2World* world );
+
 void b2UpdateBodyMassData( b2World* world, b2Body* body );
 
+// Record a change to the body and its solver set for delta snapshots
+void b2MarkBodyDirty( b2World* world, b2Body* body );
+
 static inline b2Sweep b2MakeSweep( const b2BodySim* bodySim )
 {
 	b2Sweep s;
@@ -13,6 +13,8 @@
 #include "body.h"
 #include "contact.h"
 #include "core.h"
+#include "ctz.h"
+#include "dynamic_tree.h"
 #include "parallel_for.h"
 #include "physics_world.h"
 #include "shape.h"
@@ -24,9 +26,10 @@
 
 // static FILE* s_file = NULL;
 
-void b2CreateBroadPhase( b2BroadPhase* bp, const b2Capacity* capacity )
+void b2CreateBroadPhase( b2BroadPhase* bp, const b2Capacity* capacity, b2BroadPhaseType type, float gridCellSize )
 {
 	_Static_assert( b2_bodyTypeCount == 3, "must be three body types" );
+	B2_ASSERT( type == b2_treeBroadPhase || ( b2IsValidFloat( gridCellSize ) && gridCellSize > 0.0f ) );
 
 	// if (s_file == NULL)
 	//{
@@ -34,13 +37,13 @@ void b2CreateBroadPhase( b2BroadPhase* bp, const b2Capacity* capacity )
 	//	fprintf(s_file, "============\n\n");
 	// }
 
-	bp->moveSet = b2CreateSet( b2MaxInt( 16, 2 * capacity->dynamicShapeCount ) );
+	b2AllocInfo previous = b2PushAllocTag( b2_allocTagBroadPhase, b2_allocLifetimeLong );
+	bp->moveSet = b2CreateSet32( b2MaxInt( 16, capacity->dynamicShapeCount ) );
 	b2Array_CreateN( bp->moveArray, b2MaxInt( 16, capacity->dynamicShapeCount ) );
 	bp->moveResults = NULL;
-	bp->movePairs = NULL;
-	bp->movePairCapacity = 0;
-	b2AtomicStoreInt( &bp->movePairIndex, 0 );
 	bp->pairSet = b2CreateSet( b2MaxInt( 32, 2 * capacity->contactCount ) );
+	b2Array_Create( bp->enlargedShapes );
+	b2PopAllocInfo( previous );
 
 	int staticCapacity = b2MaxInt( 16, capacity->staticShapeCount );
 	bp->trees[b2_staticBody] = b2DynamicTree_Create( staticCapacity );
@@ -50,6 +53,13 @@ void b2CreateBroadPhase( b2BroadPhase* bp, const b2Capacity* capacity )
 
 	int dynamicCapacity = b2MaxInt( 16, capacity->dynamicShapeCount );
 	bp->trees[b2_dynamicBody] = b2DynamicTree_Create( dynamicCapacity );
+
+	bp->type = type;
+	bp->gridCellSize = gridCellSize;
+	bp->grid = NULL;
+	bp->revision = 0;
+	bp->staticRevision = 0;
+	bp->dirtyTrees = 0;
 }
 
 void b2DestroyBroadPhase( b2BroadPhase* bp )
@@ -59,9 +69,10 @@ void b2DestroyBroadPhase( b2BroadPhase* bp )
 		b2DynamicTree_Destroy( bp->trees + i );
 	}
 
-	b2DestroySet( &bp->moveSet );
+	b2DestroySet32( &bp->moveSet );
 	b2Array_Destroy( bp->moveArray );
 	b2DestroySet( &bp->pairSet );
+	b2Array_Destroy( bp->enlargedShapes );
 
 	memset( bp, 0, sizeof( b2BroadPhase ) );
 
@@ -74,7 +85,7 @@ void b2DestroyBroadPhase( b2BroadPhase* bp )
 
 static inline void b2UnBufferMove( b2BroadPhase* bp, int proxyKey )
 {
-	bool found = b2RemoveKey( &bp->moveSet, proxyKey + 1 );
+	bool found = b2RemoveKey32( &bp->moveSet, proxyKey );
 
 	if ( found )
 	{
@@ -102,9 +113,55 @@ int b2BroadPhase_CreateProxy( b2BroadPhase* bp, b2BodyType proxyType, b2AABB aab
 	{
 		b2BufferMove( bp, proxyKey );
 	}
+	bp->revision += 1;
+	bp->staticRevision += proxyType == b2_staticBody ? 1 : 0;
+	bp->dirtyTrees |= 1u << proxyType;
 	return proxyKey;
 }
 
+// Bulk version of b2BroadPhase_CreateProxy. The proxy keys are written over the proxy ids.
+void b2BroadPhase_CreateProxies( b2BroadPhase* bp, b2BodyType proxyType, const b2AABB* aabbs, const uint64_t* categoryBits,
+								 const uint64_t* shapeIndices, const bool* forcePairCreation, int count, int* proxyKeys )
+{
+	B2_ASSERT( 0 <= proxyType && proxyType < b2_bodyTypeCount );
+	b2DynamicTree_CreateProxies( bp->trees + proxyType, aabbs, categoryBits, shapeIndices, count, proxyKeys );
+	bp->revision += 1;
+	bp->staticRevision += proxyType == b2_staticBody ? 1 : 0;
+	bp->dirtyTrees |= 1u << proxyType;
+
+	for ( int i = 0; i < count; ++i )
+	{
+		int proxyKey = B2_PROXY_KEY( proxyKeys[i], proxyType );
+		proxyKeys[i] = proxyKey;
+		if ( proxyType != b2_staticBody || forcePairCreation[i] )
+		{
+			b2BufferMove( bp, proxyKey );
+		}
+	}
+}
+
+// Graft a prebuilt tree. The arrays are indexed by the source proxy user data.
+void b2BroadPhase_GraftProxies( b2BroadPhase* bp, b2BodyType proxyType, const b2DynamicTree* source, const uint64_t* shapeIndices,
+								const bool* forcePairCreation, int* proxyKeys )
+{
+	B2_ASSERT( 0 <= proxyType && proxyType < b2_bodyTypeCount );
+	b2DynamicTree_Graft( bp->trees + proxyType, source, shapeIndices, proxyKeys );
+	bp->revision += 1;
+	bp->staticRevision += proxyType == b2_staticBody ? 1 : 0;
+	bp->dirtyTrees |= 1u << proxyType;
+
+	int count = b2DynamicTree_GetProxyCount( source );
+	for ( int i = 0; i < count; ++i )
+	{
+		int proxyKey = B2_PROXY_KEY( proxyKeys[i], proxyType );
+		proxyKeys[i] = proxyKey;
+		if ( proxyType != b2_staticBody || forcePairCreation[i] )
+		{
+			b2BufferMove( bp, proxyKey );
+		}
+	}
+}
+
 void b2BroadPhase_DestroyProxy( b2BroadPhase* bp, int proxyKey )
 {
 	B2_ASSERT( bp->moveArray.count == (int)bp->moveSet.count );
@@ -115,6 +172,53 @@ void b2BroadPhase_DestroyProxy( b2BroadPhase* bp, int proxyKey )
 
 	B2_ASSERT( 0 <= proxyType && proxyType <= b2_bodyTypeCount );
 	b2DynamicTree_DestroyProxy( bp->trees + proxyType, proxyId );
+	bp->revision += 1;
+	bp->staticRevision += proxyType == b2_staticBody ? 1 : 0;
+	bp->dirtyTrees |= 1u << proxyType;
+}
+
+// Bulk version of b2BroadPhase_DestroyProxy for proxies of one type. The proxy ids are written over
+// the proxy keys.
+void b2BroadPhase_DestroyProxies( b2BroadPhase* bp, b2BodyType proxyType, int* proxyKeys, int count )
+{
+	B2_ASSERT( bp->moveArray.count == (int)bp->moveSet.count );
+	B2_ASSERT( 0 <= proxyType && proxyType < b2_bodyTypeCount );
+
+	// Purge the move buffer in one pass instead of a linear search per proxy
+	int removeCount = 0;
+	for ( int i = 0; i < count; ++i )
+	{
+		B2_ASSERT( B2_PROXY_TYPE( proxyKeys[i] ) == proxyType );
+		removeCount += b2RemoveKey32( &bp->moveSet, proxyKeys[i] ) ? 1 : 0;
+	}
+
+	if ( removeCount > 0 )
+	{
+		int moveCount = bp->moveArray.count;
+		int keepCount = 0;
+		for ( int i = 0; i < moveCount; ++i )
+		{
+			int moveKey = bp->moveArray.data[i];
+			if ( b2ContainsKey32( &bp->moveSet, moveKey ) )
+			{
+				bp->moveArray.data[keepCount] = moveKey;
+				keepCount += 1;
+			}
+		}
+
+		B2_ASSERT( keepCount == moveCount - removeCount );
+		bp->moveArray.count = keepCount;
+	}
+
+	for ( int i = 0; i < count; ++i )
+	{
+		proxyKeys[i] = B2_PROXY_ID( proxyKeys[i] );
+	}
+
+	b2DynamicTree_DestroyProxies( bp->trees + proxyType, proxyKeys, count );
+	bp->revision += 1;
+	bp->staticRevision += proxyType == b2_staticBody ? 1 : 0;
+	bp->dirtyTrees |= 1u << proxyType;
 }
 
 void b2BroadPhase_MoveProxy( b2BroadPhase* bp, int proxyKey, b2AABB aabb )
@@ -124,6 +228,9 @@ void b2BroadPhase_MoveProxy( b2BroadPhase* bp, int proxyKey, b2AABB aabb )
 
 	b2DynamicTree_MoveProxy( bp->trees + proxyType, proxyId, aabb );
 	b2BufferMove( bp, proxyKey );
+	bp->revision += 1;
+	bp->staticRevision += proxyType == b2_staticBody ? 1 : 0;
+	bp->dirtyTrees |= 1u << proxyType;
 }
 
 void b2BroadPhase_EnlargeProxy( b2BroadPhase* bp, int proxyKey, b2AABB aabb )
@@ -136,6 +243,53 @@ void b2BroadPhase_EnlargeProxy( b2BroadPhase* bp, int proxyKey, b2AABB aabb )
 
 	b2DynamicTree_EnlargeProxy( bp->trees + typeIndex, proxyId, aabb );
 	b2BufferMove( bp, proxyKey );
+	bp->dirtyTrees |= 1u << typeIndex;
+}
+
+void b2EnlargeBroadPhaseProxies( b2World* world )
+{
+	b2BroadPhase* bp = &world->broadPhase;
+	int count = bp->enlargedShapes.count;
+	if ( count == 0 )
+	{
+		return;
+	}
+
+	if ( world->enableDetailedCounters )
+	{
+		world->taskContexts.data[0].detailedCounters.enlargedProxyCount += count;
+	}
+
+	b2Stack* alloc = &world->stack;
+	int* proxyIds = b2StackAlloc( alloc, count * sizeof( int ), "enlarged proxies" );
+	b2AABB* aabbs = b2StackAlloc( alloc, count * sizeof( b2AABB ), "enlarged aabbs" );
+
+	const int* shapeIds = bp->enlargedShapes.data;
+	b2Shape* shapes = world->shapes.data;
+
+	for ( int typeIndex = b2_kinematicBody; typeIndex < b2_bodyTypeCount; ++typeIndex )
+	{
+		int proxyCount = 0;
+		for ( int i = 0; i < count; ++i )
+		{
+			b2Shape* shape = shapes + shapeIds[i];
+			B2_ASSERT( B2_PROXY_TYPE( shape->proxyKey ) != b2_staticBody );
+			if ( (int)B2_PROXY_TYPE( shape->proxyKey ) == typeIndex )
+			{
+				proxyIds[proxyCount] = B2_PROXY_ID( shape->proxyKey );
+				aabbs[proxyCount] = shape->fatAABB;
+				proxyCount += 1;
+			}
+		}
+
+		b2EnlargeProxiesParallel( world, bp->trees + typeIndex, proxyIds, aabbs, proxyCount );
+		bp->dirtyTrees |= proxyCount > 0 ? 1u << typeIndex : 0u;
+	}
+
+	b2StackFree( alloc, aabbs );
+	b2StackFree( alloc, proxyIds );
+
+	b2Array_Clear( bp->enlargedShapes );
 }
 
 typedef struct b2MovePair
@@ -143,23 +297,187 @@ typedef struct b2MovePair
 	int shapeIndexA;
 	int shapeIndexB;
 	b2MovePair* next;
-	bool heap;
 } b2MovePair;
 
 typedef struct b2MoveResult
 {
 	b2MovePair* pairList;
+	int pairCount;
+
+	// Index of the first pair of this move in the deterministic pair order
+	int pairIndex;
 } b2MoveResult;
 
+// Candidate pairs waiting for b2CustomFilterBatchFcn. Rejected pairs are removed from their move results
+// at the end of the pair task.
+#define B2_FILTER_BATCH_SIZE 64
+
+typedef struct b2FilterBatch
+{
+	int count;
+	int rejectCount;
+	b2MovePair* movePairs[B2_FILTER_BATCH_SIZE];
+	b2ShapePair pairs[B2_FILTER_BATCH_SIZE];
+} b2FilterBatch;
+
+static void b2FlushFilterBatch( b2World* world, b2FilterBatch* batch, b2DetailedCounters* counters )
+{
+	bool results[B2_FILTER_BATCH_SIZE];
+	for ( int i = 0; i < batch->count; ++i )
+	{
+		results[i] = true;
+	}
+
+	// this call assumes thread safety
+	world->customFilterBatchFcn( batch->pairs, results, batch->count, world->customFilterBatchContext );
+
+	for ( int i = 0; i < batch->count; ++i )
+	{
+		if ( results[i] )
+		{
+			continue;
+		}
+
+		b2MovePair* pair = batch->movePairs[i];
+		if ( counters != NULL )
+		{
+			const b2Shape* shapeA = world->shapes.data + pair->shapeIndexA;
+			const b2Shape* shapeB = world->shapes.data + pair->shapeIndexB;
+			if ( b2AABB_Overlaps( shapeA->aabb, shapeB->aabb ) == false )
+			{
+				counters->marginPairCount -= 1;
+			}
+		}
+
+		pair->shapeIndexA = B2_NULL_INDEX;
+		batch->rejectCount += 1;
+	}
+
+	batch->count = 0;
+}
+
+// Unlinks the pairs rejected by the filter batch
+static void b2RemoveRejectedPairs( b2MoveResult* result )
+{
+	b2MovePair** link = &result->pairList;
+	while ( *link != NULL )
+	{
+		b2MovePair* pair = *link;
+		if ( pair->shapeIndexA == B2_NULL_INDEX )
+		{
+			*link = pair->next;
+			result->pairCount -= 1;
+		}
+		else
+		{
+			link = &pair->next;
+		}
+	}
+}
+
+// An incremental pair query covers the part of the new fat AABB outside the fat AABB of the last query,
+// as up to four boxes: below, above, left and right. The pairs inside the old fat AABB already have a
+// contact unless something removed it, which resets b2Shape::pairAABB. Returns the number of boxes.
+// Leaves near a corner overlap two boxes, so a proxy that moved far relative to its size uses a single box.
+static int b2GetPairQueryRegions( b2AABB fatAABB, b2AABB pairAABB, bool incremental, b2AABB* regions )
+{
+	if ( incremental == false || b2AABB_Overlaps( fatAABB, pairAABB ) == false )
+	{
+		regions[0] = fatAABB;
+		return 1;
+	}
+
+	int count = 0;
+	float lowerY = fatAABB.lowerBound.y;
+	float upperY = fatAABB.upperBound.y;
+
+	if ( fatAABB.lowerBound.y < pairAABB.lowerBound.y )
+	{
+		regions[count++] = (b2AABB){ fatAABB.lowerBound, { fatAABB.upperBound.x, pairAABB.lowerBound.y } };
+		lowerY = pairAABB.lowerBound.y;
+	}
+
+	if ( fatAABB.upperBound.y > pairAABB.upperBound.y )
+	{
+		regions[count++] = (b2AABB){ { fatAABB.lowerBound.x, pairAABB.upperBound.y }, fatAABB.upperBound };
+		upperY = pairAABB.upperBound.y;
+	}
+
+	if ( fatAABB.lowerBound.x < pairAABB.lowerBound.x )
+	{
+		regions[count++] = (b2AABB){ { fatAABB.lowerBound.x, lowerY }, { pairAABB.lowerBound.x, upperY } };
+	}
+
+	if ( fatAABB.upperBound.x > pairAABB.upperBound.x )
+	{
+		regions[count++] = (b2AABB){ { pairAABB.upperBound.x, lowerY }, { fatAABB.upperBound.x, upperY } };
+	}
+
+	float regionArea = 0.0f;
+	for ( int i = 0; i < count; ++i )
+	{
+		regionArea += ( regions[i].upperBound.x - regions[i].lowerBound.x ) * ( regions[i].upperBound.y - regions[i].lowerBound.y );
+	}
+
+	float fatArea = ( fatAABB.upperBound.x - fatAABB.lowerBound.x ) * ( fatAABB.upperBound.y - fatAABB.lowerBound.y );
+	if ( regionArea > 0.25f * fatArea )
+	{
+		regions[0] = fatAABB;
+		return 1;
+	}
+
+	return count;
+}
+
+static bool b2RegionsOverlap( const b2AABB* regions, int count, b2AABB aabb )
+{
+	for ( int i = 0; i < count; ++i )
+	{
+		if ( b2AABB_Overlaps( regions[i], aabb ) )
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
 typedef struct b2QueryPairContext
 {
 	b2World* world;
+	b2Arena* arena;
+	b2DetailedCounters* counters;
+	b2FilterBatch* filterBatch;
 	b2MoveResult* moveResult;
 	b2BodyType queryTreeType;
 	int queryProxyKey;
 	int queryShapeIndex;
+
+	// The fat AABB of the query proxy and the regions of the incremental query, see b2GetPairQueryRegions
+	b2AABB queryAABB;
+	const b2AABB* regions;
+	int regionIndex;
+	bool incremental;
 } b2QueryPairContext;
 
+// Does the query of another moved proxy find the query proxy? The duplicate pair of two moved proxies
+// may only be dropped if the other query reports it.
+static bool b2OtherQueryFinds( const b2QueryPairContext* queryContext, int otherProxyKey, uint64_t otherShapeId )
+{
+	if ( queryContext->incremental == false )
+	{
+		return true;
+	}
+
+	const b2BroadPhase* bp = &queryContext->world->broadPhase;
+	b2AABB otherAABB = b2DynamicTree_GetAABB( bp->trees + B2_PROXY_TYPE( otherProxyKey ), B2_PROXY_ID( otherProxyKey ) );
+	b2AABB pairAABB = queryContext->world->shapes.data[otherShapeId].pairAABB;
+
+	b2AABB regions[4];
+	int regionCount = b2GetPairQueryRegions( otherAABB, pairAABB, true, regions );
+	return b2RegionsOverlap( regions, regionCount, queryContext->queryAABB );
+}
+
 // This is called from b2DynamicTree::Query when we are gathering pairs.
 static bool b2PairQueryCallback( int proxyId, uint64_t userData, void* context )
 {
@@ -180,6 +498,16 @@ static bool b2PairQueryCallback( int proxyId, uint64_t userData, void* context )
 	b2BodyType treeType = queryContext->queryTreeType;
 	b2BodyType queryProxyType = B2_PROXY_TYPE( queryProxyKey );
 
+	// A proxy that overlaps several regions of an incremental query is reported by the first one
+	if ( queryContext->regionIndex > 0 )
+	{
+		b2AABB aabb = b2DynamicTree_GetAABB( broadPhase->trees + treeType, proxyId );
+		if ( b2RegionsOverlap( queryContext->regions, queryContext->regionIndex, aabb ) )
+		{
+			return true;
+		}
+	}
+
 	// De-duplication
 	// It is important to prevent duplicate contacts from being created. Ideally I can prevent duplicates
 	// early and in the worker. Most of the time the moveSet contains dynamic and kinematic proxies, but
@@ -197,8 +525,8 @@ static bool b2PairQueryCallback( int proxyId, uint64_t userData, void* context )
 	{
 		if ( treeType == b2_dynamicBody && proxyKey < queryProxyKey )
 		{
-			bool moved = b2ContainsKey( &broadPhase->moveSet, proxyKey + 1 );
-			if ( moved )
+			bool moved = b2ContainsKey32( &broadPhase->moveSet, proxyKey );
+			if ( moved && b2OtherQueryFinds( queryContext, proxyKey, userData ) )
 			{
 				// Both proxies are moving. Avoid duplicate pairs.
 				return true;
@@ -208,8 +536,8 @@ static bool b2PairQueryCallback( int proxyId, uint64_t userData, void* context )
 	else
 	{
 		B2_ASSERT( treeType == b2_dynamicBody );
-		bool moved = b2ContainsKey( &broadPhase->moveSet, proxyKey + 1 );
-		if ( moved )
+		bool moved = b2ContainsKey32( &broadPhase->moveSet, proxyKey );
+		if ( moved && b2OtherQueryFinds( queryContext, proxyKey, userData ) )
 		{
 			// Both proxies are moving. Avoid duplicate pairs.
 			return true;
@@ -275,49 +603,285 @@ static bool b2PairQueryCallback( int proxyId, uint64_t userData, void* context )
 		return true;
 	}
 
-	// Custom user filter
+	// Custom user filter. With the batch callback the pair is added now and removed later if rejected.
+	bool filterPending = false;
 	if ( shapeA->enableCustomFiltering || shapeB->enableCustomFiltering )
 	{
-		b2CustomFilterFcn* customFilterFcn = queryContext->world->customFilterFcn;
-		if ( customFilterFcn != NULL )
+		if ( queryContext->filterBatch != NULL )
+		{
+			filterPending = true;
+		}
+		else if ( b2CustomFilterShapes( world, shapeA, shapeB ) == false )
+		{
+			return true;
+		}
+	}
+
+	if ( queryContext->counters != NULL && b2AABB_Overlaps( shapeA->aabb, shapeB->aabb ) == false )
+	{
+		queryContext->counters->marginPairCount += 1;
+	}
+
+	b2MovePair* pair = b2ArenaAlloc( queryContext->arena, sizeof( b2MovePair ) );
+	pair->shapeIndexA = shapeIdA;
+	pair->shapeIndexB = shapeIdB;
+	pair->next = queryContext->moveResult->pairList;
+	queryContext->moveResult->pairList = pair;
+	queryContext->moveResult->pairCount += 1;
+
+	if ( filterPending )
+	{
+		b2FilterBatch* filterBatch = queryContext->filterBatch;
+		int index = filterBatch->count;
+		filterBatch->movePairs[index] = pair;
+		filterBatch->pairs[index] = b2MakeShapePair( world, shapeA, shapeB );
+		filterBatch->count += 1;
+
+		if ( filterBatch->count == B2_FILTER_BATCH_SIZE )
+		{
+			b2FlushFilterBatch( world, filterBatch, queryContext->counters );
+		}
+	}
+
+	// continue the query
+	return true;
+}
+
+// A proxy that covers more grid cells than this is kept in a separate list that every query tests.
+// A query that covers more cells than this uses the dynamic tree.
+#define B2_GRID_MAX_CELLS 16
+
+typedef struct b2GridEntry
+{
+	b2AABB aabb;
+	int cellX;
+	int cellY;
+	int proxyId;
+	int shapeId;
+} b2GridEntry;
+
+// Spatial hash of the dynamic proxies. Each proxy has one entry per cell it covers and the entries
+// are bucketed by cell hash. Buckets may hold entries of several cells, so entries carry their cell.
+typedef struct b2ProxyGrid
+{
+	float inverseCellSize;
+	int bucketMask;
+
+	// Entries of bucket i are [bucketStarts[i], bucketStarts[i + 1])
+	int* bucketStarts;
+	b2GridEntry* entries;
+	int entryCount;
+
+	b2GridEntry* oversizeEntries;
+	int oversizeCount;
+} b2ProxyGrid;
+
+static inline int b2GridCoordinate( float x, float inverseCellSize )
+{
+	// clamp to keep the conversion defined for far away proxies
+	float cell = b2ClampFloat( floorf( x * inverseCellSize ), -1.0e9f, 1.0e9f );
+	return (int)cell;
+}
+
+static inline int b2GridBucket( int x, int y, int bucketMask )
+{
+	uint32_t hash = ( (uint32_t)x * 73856093u ) ^ ( (uint32_t)y * 19349663u );
+	return (int)( hash & (uint32_t)bucketMask );
+}
+
+typedef struct b2GridRange
+{
+	int lowerX, lowerY;
+	int upperX, upperY;
+	int cellCount;
+} b2GridRange;
+
+static b2GridRange b2GetGridRange( b2AABB aabb, float inverseCellSize )
+{
+	b2GridRange range;
+	range.lowerX = b2GridCoordinate( aabb.lowerBound.x, inverseCellSize );
+	range.lowerY = b2GridCoordinate( aabb.lowerBound.y, inverseCellSize );
+	range.upperX = b2GridCoordinate( aabb.upperBound.x, inverseCellSize );
+	range.upperY = b2GridCoordinate( aabb.upperBound.y, inverseCellSize );
+
+	// guard against overflow for huge proxies
+	int64_t countX = (int64_t)range.upperX - range.lowerX + 1;
+	int64_t countY = (int64_t)range.upperY - range.lowerY + 1;
+	range.cellCount = countX * countY > B2_GRID_MAX_CELLS ? B2_GRID_MAX_CELLS + 1 : (int)( countX * countY );
+	return range;
+}
+
+// Dynamic proxies that the tree query would visit
+static inline bool b2IsGridProxy( const b2Shape* shape )
+{
+	return shape->id != B2_NULL_INDEX && shape->proxyKey != B2_NULL_INDEX && B2_PROXY_TYPE( shape->proxyKey ) == b2_dynamicBody &&
+		   ( shape->filter.categoryBits & B2_DEFAULT_MASK_BITS ) != 0;
+}
+
+// Build the grid from the fat AABBs in the dynamic tree. The entries follow shape id order
+// within each bucket, which makes the queries deterministic.
+static void b2CreateProxyGrid( b2World* world, b2ProxyGrid* grid )
+{
+	b2TracyCZoneNC( build_grid, "Build Grid", b2_colorMediumSlateBlue, true );
+
+	b2BroadPhase* bp = &world->broadPhase;
+	const b2DynamicTree* tree = bp->trees + b2_dynamicBody;
+	b2Stack* alloc = &world->stack;
+	float inverseCellSize = 1.0f / bp->gridCellSize;
+	b2Shape* shapes = world->shapes.data;
+	int shapeCount = world->shapes.count;
+
+	// Count the entries
+	int entryCount = 0;
+	int oversizeCount = 0;
+	for ( int shapeId = 0; shapeId < shapeCount; ++shapeId )
+	{
+		if ( b2IsGridProxy( shapes + shapeId ) == false )
+		{
+			continue;
+		}
+
+		int proxyId = B2_PROXY_ID( shapes[shapeId].proxyKey );
+		b2GridRange range = b2GetGridRange( b2DynamicTree_GetAABB( tree, proxyId ), inverseCellSize );
+		if ( range.cellCount > B2_GRID_MAX_CELLS )
+		{
+			oversizeCount += 1;
+		}
+		else
 		{
-			b2ShapeId idA = { shapeIdA + 1, world->worldId, shapeA->generation };
-			b2ShapeId idB = { shapeIdB + 1, world->worldId, shapeB->generation };
-			bool shouldCollide = customFilterFcn( idA, idB, queryContext->world->customFilterContext );
-			if ( shouldCollide == false )
+			entryCount += range.cellCount;
+		}
+	}
+
+	int bucketCount = b2RoundUpPowerOf2( b2MaxInt( 64, entryCount ) );
+	grid->inverseCellSize = inverseCellSize;
+	grid->bucketMask = bucketCount - 1;
+	grid->bucketStarts = b2StackAlloc( alloc, ( bucketCount + 1 ) * sizeof( int ), "grid buckets" );
+	grid->entries = b2StackAlloc( alloc, b2MaxInt( 1, entryCount ) * sizeof( b2GridEntry ), "grid entries" );
+	grid->entryCount = entryCount;
+	grid->oversizeEntries = b2StackAlloc( alloc, b2MaxInt( 1, oversizeCount ) * sizeof( b2GridEntry ), "grid oversize" );
+	grid->oversizeCount = oversizeCount;
+
+	// Counting sort into the buckets. The counts are accumulated into the bucket ends and the entries
+	// are filled in reverse so they follow shape id order within a bucket.
+	int* bucketStarts = grid->bucketStarts;
+	memset( bucketStarts, 0, ( bucketCount + 1 ) * sizeof( int ) );
+
+	for ( int pass = 0; pass < 2; ++pass )
+	{
+		int oversizeIndex = oversizeCount;
+		for ( int shapeId = shapeCount - 1; shapeId >= 0; --shapeId )
+		{
+			if ( b2IsGridProxy( shapes + shapeId ) == false )
 			{
-				return true;
+				continue;
+			}
+
+			int proxyId = B2_PROXY_ID( shapes[shapeId].proxyKey );
+			b2AABB aabb = b2DynamicTree_GetAABB( tree, proxyId );
+			b2GridRange range = b2GetGridRange( aabb, inverseCellSize );
+
+			if ( range.cellCount > B2_GRID_MAX_CELLS )
+			{
+				if ( pass == 1 )
+				{
+					oversizeIndex -= 1;
+					grid->oversizeEntries[oversizeIndex] = ( b2GridEntry ){ aabb, 0, 0, proxyId, shapeId };
+				}
+				continue;
+			}
+
+			for ( int y = range.upperY; y >= range.lowerY; --y )
+			{
+				for ( int x = range.upperX; x >= range.lowerX; --x )
+				{
+					int bucket = b2GridBucket( x, y, grid->bucketMask );
+					if ( pass == 0 )
+					{
+						bucketStarts[bucket + 1] += 1;
+					}
+					else
+					{
+						bucketStarts[bucket + 1] -= 1;
+						grid->entries[bucketStarts[bucket + 1]] = ( b2GridEntry ){ aabb, x, y, proxyId, shapeId };
+					}
+				}
+			}
+		}
+
+		if ( pass == 0 )
+		{
+			for ( int i = 0; i < bucketCount; ++i )
+			{
+				bucketStarts[i + 1] += bucketStarts[i];
 			}
 		}
 	}
 
-	int pairIndex = b2AtomicFetchAddInt( &broadPhase->movePairIndex, 1 );
+	// The end of bucket i was decremented down to its start, so bucketStarts[i + 1] is the start of bucket i
+	for ( int i = 0; i < bucketCount; ++i )
+	{
+		bucketStarts[i] = bucketStarts[i + 1];
+	}
+	bucketStarts[bucketCount] = entryCount;
+
+	b2TracyCZoneEnd( build_grid );
+}
 
-	b2MovePair* pair;
-	if ( pairIndex < broadPhase->movePairCapacity )
+static void b2DestroyProxyGrid( b2World* world, b2ProxyGrid* grid )
+{
+	b2Stack* alloc = &world->stack;
+	b2StackFree( alloc, grid->oversizeEntries );
+	b2StackFree( alloc, grid->entries );
+	b2StackFree( alloc, grid->bucketStarts );
+}
+
+// Report each overlapping proxy once, in the cell that holds the lower corner of the overlap.
+// Returns false if the query is too large for the grid.
+static bool b2QueryProxyGrid( const b2ProxyGrid* grid, b2AABB aabb, b2QueryPairContext* queryContext )
+{
+	float inverseCellSize = grid->inverseCellSize;
+	b2GridRange range = b2GetGridRange( aabb, inverseCellSize );
+	if ( range.cellCount > B2_GRID_MAX_CELLS )
 	{
-		pair = broadPhase->movePairs + pairIndex;
-		pair->heap = false;
+		return false;
 	}
-	else
+
+	for ( int y = range.lowerY; y <= range.upperY; ++y )
 	{
-		static b2AtomicInt once = { 0 };
-		if ( b2AtomicCompareExchangeInt( &once, 0, 1 ) == 0 )
+		for ( int x = range.lowerX; x <= range.upperX; ++x )
 		{
-			// This means you have too many overlapping objects.
-			b2Log( "Pair buffer capacity of %d exceeded, too many overlaps", broadPhase->movePairCapacity );
+			int bucket = b2GridBucket( x, y, grid->bucketMask );
+			int endIndex = grid->bucketStarts[bucket + 1];
+			for ( int i = grid->bucketStarts[bucket]; i < endIndex; ++i )
+			{
+				const b2GridEntry* entry = grid->entries + i;
+				if ( entry->cellX != x || entry->cellY != y || b2AABB_Overlaps( aabb, entry->aabb ) == false )
+				{
+					continue;
+				}
+
+				float cornerX = b2MaxFloat( aabb.lowerBound.x, entry->aabb.lowerBound.x );
+				float cornerY = b2MaxFloat( aabb.lowerBound.y, entry->aabb.lowerBound.y );
+				if ( b2GridCoordinate( cornerX, inverseCellSize ) != x || b2GridCoordinate( cornerY, inverseCellSize ) != y )
+				{
+					continue;
+				}
+
+				b2PairQueryCallback( entry->proxyId, (uint64_t)entry->shapeId, queryContext );
+			}
 		}
-
-		pair = b2Alloc( sizeof( b2MovePair ) );
-		pair->heap = true;
 	}
 
-	pair->shapeIndexA = shapeIdA;
-	pair->shapeIndexB = shapeIdB;
-	pair->next = queryContext->moveResult->pairList;
-	queryContext->moveResult->pairList = pair;
+	for ( int i = 0; i < grid->oversizeCount; ++i )
+	{
+		const b2GridEntry* entry = grid->oversizeEntries + i;
+		if ( b2AABB_Overlaps( aabb, entry->aabb ) )
+		{
+			b2PairQueryCallback( entry->proxyId, (uint64_t)entry->shapeId, queryContext );
+		}
+	}
 
-	// continue the query
 	return true;
 }
 
@@ -330,21 +894,34 @@ b2TreeStats b2_staticStats;
 
 static void b2FindPairsTask( int startIndex, int endIndex, int workerIndex, void* context )
 {
-	B2_UNUSED( workerIndex );
-
 	b2TracyCZoneNC( pair_task, "Pair", b2_colorMediumSlateBlue, true );
 
 	b2World* world = context;
 	b2BroadPhase* bp = &world->broadPhase;
 
+	b2TaskContext* taskContext = world->taskContexts.data + workerIndex;
+	int heapCount = b2GetArenaHeapCount( &taskContext->arena );
+
 	b2QueryPairContext queryContext;
 	queryContext.world = world;
+	queryContext.arena = &taskContext->arena;
+	queryContext.counters = world->enableDetailedCounters ? &taskContext->detailedCounters : NULL;
+
+	b2FilterBatch filterBatch;
+	filterBatch.count = 0;
+	filterBatch.rejectCount = 0;
+	queryContext.filterBatch = world->customFilterBatchFcn != NULL ? &filterBatch : NULL;
+	queryContext.incremental = world->enableIncrementalPairs;
+
+	b2AABB regions[4];
+	queryContext.regions = regions;
 
 	for ( int i = startIndex; i < endIndex; ++i )
 	{
 		// Initialize move result for this moved proxy
 		queryContext.moveResult = bp->moveResults + i;
 		queryContext.moveResult->pairList = NULL;
+		queryContext.moveResult->pairCount = 0;
 
 		int proxyKey = bp->moveArray.data[i];
 		if ( proxyKey == B2_NULL_INDEX )
@@ -364,58 +941,205 @@ static void b2FindPairsTask( int startIndex, int endIndex, int workerIndex, void
 		// we don't fail to create a contact that may touch later.
 		b2AABB fatAABB = b2DynamicTree_GetAABB( baseTree, proxyId );
 		queryContext.queryShapeIndex = (int)b2DynamicTree_GetUserData( baseTree, proxyId );
+		queryContext.queryAABB = fatAABB;
+
+		const b2Shape* queryShape = world->shapes.data + queryContext.queryShapeIndex;
+		int regionCount = b2GetPairQueryRegions( fatAABB, queryShape->pairAABB, queryContext.incremental, regions );
+
+		// Subtrees without a category in the mask cannot hold a pair that passes b2ShouldShapesCollide
+		uint64_t maskBits = b2GetFilterQueryMask( queryShape->filter );
 
 		// Query trees. Only dynamic proxies collide with kinematic and static proxies.
-		// Using B2_DEFAULT_MASK_BITS so that b2Filter::groupIndex works.
 		b2TreeStats stats = { 0 };
-		if ( proxyType == b2_dynamicBody )
+		for ( int regionIndex = 0; regionIndex < regionCount; ++regionIndex )
 		{
-			// consider using bits = groupIndex > 0 ? B2_DEFAULT_MASK_BITS : maskBits
-			queryContext.queryTreeType = b2_kinematicBody;
-			b2TreeStats statsKinematic = b2DynamicTree_Query( bp->trees + b2_kinematicBody, fatAABB, B2_DEFAULT_MASK_BITS,
-															  b2PairQueryCallback, &queryContext );
-			stats.nodeVisits += statsKinematic.nodeVisits;
-			stats.leafVisits += statsKinematic.leafVisits;
+			b2AABB region = regions[regionIndex];
+			queryContext.regionIndex = regionIndex;
+
+			if ( proxyType == b2_dynamicBody )
+			{
+				queryContext.queryTreeType = b2_kinematicBody;
+				b2TreeStats statsKinematic =
+					b2DynamicTree_Query( bp->trees + b2_kinematicBody, region, maskBits, b2PairQueryCallback, &queryContext );
+				stats.nodeVisits += statsKinematic.nodeVisits;
+				stats.leafVisits += statsKinematic.leafVisits;
+
+				queryContext.queryTreeType = b2_staticBody;
+				b2TreeStats statsStatic =
+					b2DynamicTree_Query( bp->trees + b2_staticBody, region, maskBits, b2PairQueryCallback, &queryContext );
+				stats.nodeVisits += statsStatic.nodeVisits;
+				stats.leafVisits += statsStatic.leafVisits;
+			}
 
-			queryContext.queryTreeType = b2_staticBody;
-			b2TreeStats statsStatic = b2DynamicTree_Query( bp->trees + b2_staticBody, fatAABB, B2_DEFAULT_MASK_BITS,
-														   b2PairQueryCallback, &queryContext );
-			stats.nodeVisits += statsStatic.nodeVisits;
-			stats.leafVisits += statsStatic.leafVisits;
+			// All proxies collide with dynamic proxies
+			queryContext.queryTreeType = b2_dynamicBody;
+			if ( bp->grid == NULL || b2QueryProxyGrid( bp->grid, region, &queryContext ) == false )
+			{
+				b2TreeStats statsDynamic =
+					b2DynamicTree_Query( bp->trees + b2_dynamicBody, region, maskBits, b2PairQueryCallback, &queryContext );
+				stats.nodeVisits += statsDynamic.nodeVisits;
+				stats.leafVisits += statsDynamic.leafVisits;
+			}
 		}
 
-		// All proxies collide with dynamic proxies
-		// Using B2_DEFAULT_MASK_BITS so that b2Filter::groupIndex works.
-		queryContext.queryTreeType = b2_dynamicBody;
-		b2TreeStats statsDynamic =
-			b2DynamicTree_Query( bp->trees + b2_dynamicBody, fatAABB, B2_DEFAULT_MASK_BITS, b2PairQueryCallback, &queryContext );
-		stats.nodeVisits += statsDynamic.nodeVisits;
-		stats.leafVisits += statsDynamic.leafVisits;
+		if ( world->enableDetailedCounters )
+		{
+			taskContext->detailedCounters.pairNodeVisits += stats.nodeVisits;
+			taskContext->detailedCounters.pairLeafVisits += stats.leafVisits;
+		}
+	}
+
+	if ( filterBatch.count > 0 )
+	{
+		b2FlushFilterBatch( world, &filterBatch, queryContext.counters );
+	}
+
+	if ( filterBatch.rejectCount > 0 )
+	{
+		for ( int i = startIndex; i < endIndex; ++i )
+		{
+			b2RemoveRejectedPairs( bp->moveResults + i );
+		}
+	}
+
+	if ( world->enableDetailedCounters )
+	{
+		taskContext->detailedCounters.pairHeapBlockCount += b2GetArenaHeapCount( &taskContext->arena ) - heapCount;
 	}
 
 	b2TracyCZoneEnd( pair_task );
 }
 
+typedef struct b2CreateContactsContext
+{
+	b2World* world;
+	const int* contactIds;
+	b2ContactSim* contactSims;
+} b2CreateContactsContext;
+
+static void b2CreateContactsTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	b2TracyCZoneNC( contact_task, "Create Contacts Task", b2_colorCoral, true );
+	B2_UNUSED( workerIndex );
+
+	b2CreateContactsContext* createContext = context;
+	b2World* world = createContext->world;
+	b2BroadPhase* bp = &world->broadPhase;
+
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		b2MoveResult* result = bp->moveResults + i;
+		int pairIndex = result->pairIndex;
+		b2MovePair* pair = result->pairList;
+		while ( pair != NULL )
+		{
+			b2Shape* shapeA = world->shapes.data + pair->shapeIndexA;
+			b2Shape* shapeB = world->shapes.data + pair->shapeIndexB;
+			b2CreateContactConcurrent( world, shapeA, shapeB, createContext->contactIds[pairIndex],
+									   createContext->contactSims + pairIndex );
+
+			pairIndex += 1;
+			pair = pair->next;
+		}
+
+		B2_ASSERT( pairIndex == result->pairIndex + result->pairCount );
+	}
+
+	b2TracyCZoneEnd( contact_task );
+}
+
 static void b2UpdateTreesTask( void* context )
 {
 	b2TracyCZoneNC( tree_task, "Rebuild BVH", b2_colorFireBrick, true );
 
 	b2World* world = context;
-	b2DynamicTree_Rebuild( world->broadPhase.trees + b2_dynamicBody, false );
-	b2DynamicTree_Rebuild( world->broadPhase.trees + b2_kinematicBody, false );
+	world->rebuiltLeafCount = b2DynamicTree_Rebuild( world->broadPhase.trees + b2_dynamicBody, false );
+	world->rebuiltLeafCount += b2DynamicTree_Rebuild( world->broadPhase.trees + b2_kinematicBody, false );
+
+	int budget = world->treeOptimizationBudget;
+	if ( budget > 0 )
+	{
+		uint64_t optimizeTicks = b2GetTicks();
+		b2DynamicTree_Optimize( world->broadPhase.trees + b2_dynamicBody, budget );
+		b2DynamicTree_Optimize( world->broadPhase.trees + b2_kinematicBody, budget );
+		world->profile.optimizeTrees = b2GetMilliseconds( optimizeTicks );
+	}
 
 	b2TracyCZoneEnd( tree_task );
 }
 
-void b2UpdateBroadPhasePairs( b2World* world )
+static void b2CreateContactsSerial( b2World* world, int moveCount )
+{
+	b2BroadPhase* bp = &world->broadPhase;
+	for ( int i = 0; i < moveCount; ++i )
+	{
+		b2MoveResult* result = bp->moveResults + i;
+		b2MovePair* pair = result->pairList;
+		while ( pair != NULL )
+		{
+			int shapeIdA = pair->shapeIndexA;
+			int shapeIdB = pair->shapeIndexB;
+
+			// if (s_file != NULL)
+			//{
+			//	fprintf(s_file, "%d %d\n", shapeIdA, shapeIdB);
+			// }
+
+			b2Shape* shapeA = b2Array_Get( world->shapes, shapeIdA );
+			b2Shape* shapeB = b2Array_Get( world->shapes, shapeIdB );
+
+			b2CreateContact( world, shapeA, shapeB );
+
+			pair = pair->next;
+		}
+
+		// if (s_file != NULL)
+		//{
+		//	fprintf(s_file, "\n");
+		// }
+	}
+}
+
+typedef struct b2FindPairsFusedContext
+{
+	b2World* world;
+	int moveCount;
+	const b2PairCompanion* companion;
+} b2FindPairsFusedContext;
+
+static void b2FindPairsFusedTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	b2FindPairsFusedContext* fusedContext = context;
+	int moveCount = fusedContext->moveCount;
+	if ( startIndex < moveCount )
+	{
+		b2FindPairsTask( startIndex, b2MinInt( endIndex, moveCount ), workerIndex, fusedContext->world );
+	}
+
+	if ( endIndex > moveCount )
+	{
+		const b2PairCompanion* companion = fusedContext->companion;
+		companion->callback( b2MaxInt( startIndex, moveCount ) - moveCount, endIndex - moveCount, workerIndex,
+							 companion->context );
+	}
+}
+
+void b2UpdateBroadPhasePairs( b2World* world, const b2PairCompanion* companion )
 {
 	b2BroadPhase* bp = &world->broadPhase;
 
 	int moveCount = bp->moveArray.count;
 	B2_ASSERT( moveCount == (int)bp->moveSet.count );
 
+	int companionCount = companion != NULL ? companion->itemCount : 0;
+
 	if ( moveCount == 0 )
 	{
+		if ( companionCount > 0 )
+		{
+			b2RunParallelFor( world, companion->callback, companion->name, companionCount, 64, companion->context );
+		}
+
 		return;
 	}
 
@@ -426,26 +1150,66 @@ void b2UpdateBroadPhasePairs( b2World* world )
 	// todo these could be in the step context
 	bp->moveResults = b2StackAlloc( alloc, moveCount * sizeof( b2MoveResult ), "move results" );
 
-	// This capacity can be exceeded if there are many overlapping pairs (e.g. all shapes at the origin)
-	bp->movePairCapacity = 32 * moveCount;
-	bp->movePairs = b2StackAlloc( alloc, bp->movePairCapacity * sizeof( b2MovePair ), "move pairs" );
-	b2AtomicStoreInt( &bp->movePairIndex, 0 );
-
 #if B2_SNOOP_TABLE_COUNTERS
 	extern b2AtomicInt b2_probeCount;
 	b2AtomicStoreInt( &b2_probeCount, 0 );
 #endif
 
+	b2ProxyGrid grid;
+	if ( bp->type == b2_gridBroadPhase )
+	{
+		b2CreateProxyGrid( world, &grid );
+		bp->grid = &grid;
+	}
+
 	int minRange = 64;
-	b2ParallelFor( world, &b2FindPairsTask, moveCount, minRange, world );
+	if ( companionCount > 0 )
+	{
+		b2FindPairsFusedContext fusedContext = { world, moveCount, companion };
+		b2ParallelFor( world, &b2FindPairsFusedTask, moveCount + companionCount, minRange, &fusedContext );
+	}
+	else
+	{
+		b2ParallelFor( world, &b2FindPairsTask, moveCount, minRange, world );
+	}
+
+	if ( bp->grid != NULL )
+	{
+		b2DestroyProxyGrid( world, &grid );
+		bp->grid = NULL;
+	}
+
+	// The pair queries read the last query bounds of the other moved proxies, so these are only updated
+	// once all queries are done. This is kept up to date while incremental pairs are off so the mode can
+	// be switched at any time.
+	for ( int i = 0; i < moveCount; ++i )
+	{
+		int proxyKey = bp->moveArray.data[i];
+		if ( proxyKey == B2_NULL_INDEX )
+		{
+			continue;
+		}
+
+		const b2DynamicTree* tree = bp->trees + B2_PROXY_TYPE( proxyKey );
+		int proxyId = B2_PROXY_ID( proxyKey );
+		b2Shape* shape = world->shapes.data + b2DynamicTree_GetUserData( tree, proxyId );
+		shape->pairAABB = b2DynamicTree_GetAABB( tree, proxyId );
+	}
 
 	b2TracyCZoneNC( create_contacts, "Create Contacts", b2_colorCoral, true );
 
 	// Task that can be done in parallel with the narrow-phase
 	// - rebuild the collision tree for dynamic and kinematic bodies to keep their query performance good
+	bp->dirtyTrees |= ( 1u << b2_dynamicBody ) | ( 1u << b2_kinematicBody );
 	if (world->taskCount < B2_MAX_TASKS)
 	{
-		world->userTreeTask = world->enqueueTaskFcn( &b2UpdateTreesTask, world, world->userTaskContext );
+		b2TaskInfo info = {
+			.name = "Rebuild BVH",
+			.priority = b2_taskPriorityBackground,
+			.expectedCost = b2DynamicTree_GetProxyCount( bp->trees + b2_dynamicBody ) +
+							b2DynamicTree_GetProxyCount( bp->trees + b2_kinematicBody ),
+		};
+		world->userTreeTask = b2EnqueueTask( world, &b2UpdateTreesTask, world, &info );
 		world->taskCount += 1;
 		world->activeTaskCount += world->userTreeTask == NULL ? 0 : 1;
 	}
@@ -455,49 +1219,41 @@ void b2UpdateBroadPhasePairs( b2World* world )
 		b2UpdateTreesTask( world );
 	}
 
-	// Single-threaded work
-	// - Clear move flags
-	// - Create contacts in deterministic order
-	// This is deterministic because the results follow the order of b2BroadPhase::moveArray.
+	// The pair order follows b2BroadPhase::moveArray and then each move result list
+	int pairCount = 0;
 	for ( int i = 0; i < moveCount; ++i )
 	{
-		b2MoveResult* result = bp->moveResults + i;
-		b2MovePair* pair = result->pairList;
-		while ( pair != NULL )
-		{
-			int shapeIdA = pair->shapeIndexA;
-			int shapeIdB = pair->shapeIndexB;
+		bp->moveResults[i].pairIndex = pairCount;
+		pairCount += bp->moveResults[i].pairCount;
+	}
 
-			// if (s_file != NULL)
-			//{
-			//	fprintf(s_file, "%d %d\n", shapeIdA, shapeIdB);
-			// }
+	b2TracyCPlot( "Move Proxies", moveCount );
+	b2TracyCPlot( "Move Pairs", pairCount );
 
-			b2Shape* shapeA = b2Array_Get( world->shapes, shapeIdA );
-			b2Shape* shapeB = b2Array_Get( world->shapes, shapeIdB );
+	// Parallel creation only pays off for larger batches. It gives the same result as serial creation.
+	bool parallelContacts = world->enableParallelContacts || world->enableRelaxedDeterminism;
+	if ( parallelContacts && world->workerCount > 1 && pairCount >= 64 )
+	{
+		int* contactIds = b2StackAlloc( alloc, pairCount * sizeof( int ), "contact ids" );
 
-			b2CreateContact( world, shapeA, shapeB );
+		// The contact ids are handed out in pair order, so each range of move results owns a
+		// contiguous slice of ids and sims
+		b2ContactSim* contactSims = b2ReserveContacts( world, contactIds, pairCount );
 
-			if ( pair->heap )
-			{
-				// Note: I tried adding to the pair set in parallel with contact creation
-				// but that didn't work with with pair heap allocation. I could make it
-				// work with a task context bump allocator with heap fallback. The perf
-				// gain was small or zero.
-				b2MovePair* temp = pair;
-				pair = pair->next;
-				b2Free( temp, sizeof( b2MovePair ) );
-			}
-			else
-			{
-				pair = pair->next;
-			}
-		}
+		b2CreateContactsContext createContext = { world, contactIds, contactSims };
+		b2ParallelFor( world, &b2CreateContactsTask, moveCount, minRange, &createContext );
 
-		// if (s_file != NULL)
-		//{
-		//	fprintf(s_file, "\n");
-		// }
+		// Linking the body contact lists is the only part in pair order on one thread
+		b2CommitContacts( world, contactIds, pairCount );
+
+		b2StackFree( alloc, contactIds );
+	}
+	else
+	{
+		// Single-threaded work
+		// - Create contacts in deterministic order
+		// This is deterministic because the results follow the order of b2BroadPhase::moveArray.
+		b2CreateContactsSerial( world, moveCount );
 	}
 
 	// if (s_file != NULL)
@@ -507,10 +1263,8 @@ void b2UpdateBroadPhasePairs( b2World* world )
 
 	// Reset move buffer
 	b2Array_Clear( bp->moveArray );
-	b2ClearSet( &bp->moveSet );
+	b2ClearSet32( &bp->moveSet );
 
-	b2StackFree( alloc, bp->movePairs );
-	bp->movePairs = NULL;
 	b2StackFree( alloc, bp->moveResults );
 	bp->moveResults = NULL;
 
@@ -520,6 +1274,155 @@ void b2UpdateBroadPhasePairs( b2World* world )
 	b2TracyCZoneEnd( update_pairs );
 }
 
+void b2CompactBroadPhase( b2World* world )
+{
+	b2BroadPhase* bp = &world->broadPhase;
+	B2_ASSERT( bp->moveResults == NULL );
+
+	// Rebuild each tree into a fresh node pool sized for the current proxy count. Proxies are
+	// re-inserted in shape id order so the result is deterministic. The old proxy keys held by
+	// shapes and the move buffer are remapped.
+	for ( int typeIndex = 0; typeIndex < b2_bodyTypeCount; ++typeIndex )
+	{
+		b2DynamicTree* oldTree = bp->trees + typeIndex;
+		int oldNodeCapacity = oldTree->nodeCapacity;
+		b2DynamicTree newTree = b2DynamicTree_Create( oldTree->proxyCount );
+
+		int* remap = b2Alloc( oldNodeCapacity * sizeof( int ) );
+		for ( int i = 0; i < oldNodeCapacity; ++i )
+		{
+			remap[i] = B2_NULL_INDEX;
+		}
+
+		int shapeCount = world->shapes.count;
+		for ( int shapeId = 0; shapeId < shapeCount; ++shapeId )
+		{
+			b2Shape* shape = world->shapes.data + shapeId;
+			if ( shape->id == B2_NULL_INDEX || shape->proxyKey == B2_NULL_INDEX ||
+				 (int)B2_PROXY_TYPE( shape->proxyKey ) != typeIndex )
+			{
+				continue;
+			}
+
+			int oldProxyId = B2_PROXY_ID( shape->proxyKey );
+			B2_ASSERT( (int)b2DynamicTree_GetUserData( oldTree, oldProxyId ) == shapeId );
+
+			b2AABB aabb = b2DynamicTree_GetAABB( oldTree, oldProxyId );
+			uint64_t categoryBits = b2DynamicTree_GetCategoryBits( oldTree, oldProxyId );
+			int newProxyId = b2DynamicTree_CreateProxy( &newTree, aabb, categoryBits, (uint64_t)shapeId );
+
+			remap[oldProxyId] = newProxyId;
+			shape->proxyKey = B2_PROXY_KEY( newProxyId, typeIndex );
+		}
+
+		B2_ASSERT( newTree.proxyCount == oldTree->proxyCount );
+
+		int moveCount = bp->moveArray.count;
+		for ( int i = 0; i < moveCount; ++i )
+		{
+			int proxyKey = bp->moveArray.data[i];
+			if ( proxyKey != B2_NULL_INDEX && (int)B2_PROXY_TYPE( proxyKey ) == typeIndex )
+			{
+				int newProxyId = remap[B2_PROXY_ID( proxyKey )];
+				B2_ASSERT( newProxyId != B2_NULL_INDEX );
+				bp->moveArray.data[i] = B2_PROXY_KEY( newProxyId, typeIndex );
+			}
+		}
+
+		bool quantized = oldTree->quantizedNodeCount > 0;
+
+		b2Free( remap, oldNodeCapacity * sizeof( int ) );
+		b2DynamicTree_Destroy( oldTree );
+
+		// Incremental insertion leaves a tree of lower quality than a full build
+		b2DynamicTree_Rebuild( &newTree, true );
+		if ( quantized )
+		{
+			b2DynamicTree_BuildQuantizedNodes( &newTree );
+		}
+
+		bp->trees[typeIndex] = newTree;
+	}
+
+	bp->dirtyTrees = ( 1u << b2_bodyTypeCount ) - 1;
+
+	// The move set is keyed on proxy keys, so it is rebuilt rather than rehashed
+	int moveCount = bp->moveArray.count;
+	b2DestroySet32( &bp->moveSet );
+	bp->moveSet = b2CreateSet32( moveCount );
+	for ( int i = 0; i < moveCount; ++i )
+	{
+		b2AddKey32( &bp->moveSet, bp->moveArray.data[i] );
+	}
+
+	b2Array_ShrinkToFit( bp->moveArray, 16 );
+	b2Array_ShrinkToFit( bp->enlargedShapes, 0 );
+	b2ShrinkSet( &bp->pairSet );
+
+	b2ValidateBroadphase( bp );
+}
+
+static void b2SwapStaticProxyFcn( uint64_t userData, int proxyId, void* context )
+{
+	b2Shape* shapes = context;
+	shapes[userData].proxyKey = B2_PROXY_KEY( proxyId, b2_staticBody );
+}
+
+void b2BroadPhase_SwapStaticTree( b2BroadPhase* bp, b2DynamicTree* tree, b2Shape* shapes )
+{
+	b2DynamicTree* oldTree = bp->trees + b2_staticBody;
+
+	// Kept proxies have the same id in both trees so only added proxies change their keys
+	b2ApplyTreeEdits( tree, oldTree, b2SwapStaticProxyFcn, shapes );
+
+	bool remapped = false;
+	int moveCount = bp->moveArray.count;
+	for ( int i = 0; i < moveCount; ++i )
+	{
+		int proxyKey = bp->moveArray.data[i];
+		if ( proxyKey == B2_NULL_INDEX || B2_PROXY_TYPE( proxyKey ) != b2_staticBody )
+		{
+			continue;
+		}
+
+		int shapeId = (int)b2DynamicTree_GetUserData( oldTree, B2_PROXY_ID( proxyKey ) );
+		int newProxyKey = shapes[shapeId].proxyKey;
+		if ( newProxyKey != proxyKey )
+		{
+			bp->moveArray.data[i] = newProxyKey;
+			remapped = true;
+		}
+	}
+
+	b2DynamicTree_Destroy( oldTree );
+	*oldTree = *tree;
+	memset( tree, 0, sizeof( b2DynamicTree ) );
+
+	bp->revision += 1;
+	bp->dirtyTrees |= 1u << b2_staticBody;
+
+	if ( remapped )
+	{
+		b2ClearSet32( &bp->moveSet );
+		for ( int i = 0; i < moveCount; ++i )
+		{
+			b2AddKey32( &bp->moveSet, bp->moveArray.data[i] );
+		}
+	}
+
+	b2ValidateBroadphase( bp );
+}
+
+void b2BroadPhase_BuildStaticWideNodes( b2BroadPhase* bp )
+{
+	b2DynamicTree* staticTree = bp->trees + b2_staticBody;
+	if ( staticTree->wideNodeCount == 0 && staticTree->quantizedNodeCount == 0 && staticTree->proxyCount > 0 )
+	{
+		b2DynamicTree_BuildWideNodes( staticTree );
+		bp->dirtyTrees |= 1u << b2_staticBody;
+	}
+}
+
 bool b2BroadPhase_TestOverlap( const b2BroadPhase* bp, int proxyKeyA, int proxyKeyB )
 {
 	int typeIndexA = B2_PROXY_TYPE( proxyKeyA );
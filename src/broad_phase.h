@@ -4,6 +4,7 @@
 #pragma once
 
 #include "container.h"
+#include "parallel_for.h"
 #include "table.h"
 
 #include "box2d/collision.h"
@@ -12,6 +13,7 @@
 typedef struct b2Shape b2Shape;
 typedef struct b2MovePair b2MovePair;
 typedef struct b2MoveResult b2MoveResult;
+typedef struct b2ProxyGrid b2ProxyGrid;
 typedef struct b2Stack b2Stack;
 typedef struct b2World b2World;
 
@@ -30,37 +32,86 @@ typedef struct b2BroadPhase
 	// The move set and array are used to track shapes that have moved significantly
 	// and need a pair query for new contacts. The array has a deterministic order.
 	// todo perhaps just a move set?
-	// todo implement a 32bit hash set for faster lookup
 	// todo moveSet can grow quite large on the first time step and remain large
-	b2HashSet moveSet;
+	b2HashSet32 moveSet;
 	b2Array( int ) moveArray;
 
 	// These are the results from the pair query and are used to create new contacts
 	// in deterministic order. There is a move result linked list for each moving shape and
-	// these follow the dynamic tree query order for determinism.
+	// these follow the dynamic tree query order for determinism. The pairs live in the
+	// worker arenas.
 	b2MoveResult* moveResults;
-	b2MovePair* movePairs;
-	int movePairCapacity;
-	b2AtomicInt movePairIndex;
 
 	// Tracks shape pairs that have a b2Contact
 	b2HashSet pairSet;
 
+	// Shapes with enlarged AABBs at the end of the step in deterministic order. Their proxies are
+	// enlarged in a batch so large batches can be refit in parallel.
+	b2Array( int ) enlargedShapes;
+
+	// Incremented when proxies are created, destroyed or moved by the user. The step only enlarges
+	// proxies and leaves this alone.
+	uint32_t revision;
+
+	// Incremented when static proxies are created, destroyed or moved, see the static ray cache
+	uint32_t staticRevision;
+
+	// Bit per tree for trees changed since the snapshot key frame, see b2World_SnapshotDelta
+	uint32_t dirtyTrees;
+
+	// Pair finding method for dynamic proxies. The grid is rebuilt during each pair update
+	// and lives on the stack.
+	b2BroadPhaseType type;
+	float gridCellSize;
+	b2ProxyGrid* grid;
+
 } b2BroadPhase;
 
-void b2CreateBroadPhase( b2BroadPhase* bp, const b2Capacity* capacity );
+void b2CreateBroadPhase( b2BroadPhase* bp, const b2Capacity* capacity, b2BroadPhaseType type, float gridCellSize );
 void b2DestroyBroadPhase( b2BroadPhase* bp );
 
 int b2BroadPhase_CreateProxy( b2BroadPhase* bp, b2BodyType proxyType, b2AABB aabb, uint64_t categoryBits, int shapeIndex,
 							  bool forcePairCreation );
+void b2BroadPhase_CreateProxies( b2BroadPhase* bp, b2BodyType proxyType, const b2AABB* aabbs, const uint64_t* categoryBits,
+								 const uint64_t* shapeIndices, const bool* forcePairCreation, int count, int* proxyKeys );
+void b2BroadPhase_GraftProxies( b2BroadPhase* bp, b2BodyType proxyType, const b2DynamicTree* source, const uint64_t* shapeIndices,
+								const bool* forcePairCreation, int* proxyKeys );
 void b2BroadPhase_DestroyProxy( b2BroadPhase* bp, int proxyKey );
+void b2BroadPhase_DestroyProxies( b2BroadPhase* bp, b2BodyType proxyType, int* proxyKeys, int count );
 
 void b2BroadPhase_MoveProxy( b2BroadPhase* bp, int proxyKey, b2AABB aabb );
 void b2BroadPhase_EnlargeProxy( b2BroadPhase* bp, int proxyKey, b2AABB aabb );
 
+// Enlarge the proxies of bp->enlargedShapes to the shape fat AABBs and clear the array. This does not
+// buffer moves.
+void b2EnlargeBroadPhaseProxies( b2World* world );
+
 int b2BroadPhase_GetShapeIndex( b2BroadPhase* bp, int proxyKey );
 
-void b2UpdateBroadPhasePairs( b2World* world );
+// Work that runs in the same parallel-for as the pair finding, after it in the item range
+typedef struct b2PairCompanion
+{
+	b2ParallelForCallback* callback;
+	const char* name;
+	int itemCount;
+	void* context;
+} b2PairCompanion;
+
+// Find the new pairs of the moved proxies and create their contacts. The optional companion work is done
+// before the contacts are created.
+void b2UpdateBroadPhasePairs( b2World* world, const b2PairCompanion* companion );
+
+// Rebuild the trees and rehash the sets to release memory. Proxy keys held by shapes are updated.
+void b2CompactBroadPhase( b2World* world );
+// Replace the static tree with a tree rebuilt from an earlier copy of it. Edits made to the static tree
+// since the copy are applied first. Proxy keys held by shapes and the move buffer are updated.
+void b2BroadPhase_SwapStaticTree( b2BroadPhase* bp, b2DynamicTree* tree, b2Shape* shapes );
+
+// Build the wide layout of the static tree if it was modified. Static proxies cannot change during the step,
+// so the layout serves the pair finding, continuous collision, sensors, and user queries until the next
+// modification. Must run on the calling thread because queries are allowed during an asynchronous step.
+void b2BroadPhase_BuildStaticWideNodes( b2BroadPhase* bp );
+
 bool b2BroadPhase_TestOverlap( const b2BroadPhase* bp, int proxyKeyA, int proxyKeyB );
 
 void b2ValidateBroadphase( const b2BroadPhase* bp );
@@ -70,8 +121,7 @@ void b2ValidateNoEnlarged( const b2BroadPhase* bp );
 // Warning: this must be called in deterministic order
 static inline void b2BufferMove( b2BroadPhase* bp, int queryProxy )
 {
-	// Adding 1 because 0 is the sentinel
-	bool alreadyAdded = b2AddKey( &bp->moveSet, queryProxy + 1 );
+	bool alreadyAdded = b2AddKey32( &bp->moveSet, queryProxy );
 	if ( alreadyAdded == false )
 	{
 		b2Array_Push( bp->moveArray, queryProxy );
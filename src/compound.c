@@ -0,0 +1,856 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#include "compound.h"
+
+#include "aabb_wide.h"
+#include "core.h"
+
+#include "box2d/constants.h"
+#include "box2d/math_functions.h"
+#include "box2d/types.h"
+
+#include <float.h>
+#include <string.h>
+
+#define B2_COMPOUND_STACK_SIZE 64
+
+// Inputs for building the hierarchy
+typedef struct b2CompoundBuilder
+{
+	b2Compound* compound;
+	const b2AABB* boxes;
+	const b2Vec2* centers;
+} b2CompoundBuilder;
+
+// Sorts the items along the longest axis of their centers and returns the split index
+static int b2SplitCompoundItems( const b2CompoundBuilder* builder, int* indices, int count )
+{
+	B2_ASSERT( count > 1 );
+
+	b2Vec2 lower = builder->centers[indices[0]];
+	b2Vec2 upper = lower;
+	for ( int i = 1; i < count; ++i )
+	{
+		lower = b2Min( lower, builder->centers[indices[i]] );
+		upper = b2Max( upper, builder->centers[indices[i]] );
+	}
+
+	int axis = upper.x - lower.x >= upper.y - lower.y ? 0 : 1;
+
+	// Compounds are small so insertion sort is fine
+	for ( int i = 1; i < count; ++i )
+	{
+		int index = indices[i];
+		float value = axis == 0 ? builder->centers[index].x : builder->centers[index].y;
+		int j = i - 1;
+		while ( j >= 0 )
+		{
+			b2Vec2 c = builder->centers[indices[j]];
+			if ( ( axis == 0 ? c.x : c.y ) <= value )
+			{
+				break;
+			}
+			indices[j + 1] = indices[j];
+			j -= 1;
+		}
+		indices[j + 1] = index;
+	}
+
+	return count / 2;
+}
+
+static int b2BuildCompoundNode( b2CompoundBuilder* builder, int* indices, int count );
+
+static int b2BuildCompoundChild( b2CompoundBuilder* builder, int* indices, int count, b2AABB* box )
+{
+	*box = builder->boxes[indices[0]];
+	for ( int i = 1; i < count; ++i )
+	{
+		*box = b2AABB_Union( *box, builder->boxes[indices[i]] );
+	}
+
+	if ( count == 1 )
+	{
+		return B2_COMPOUND_LEAF( indices[0] );
+	}
+
+	return b2BuildCompoundNode( builder, indices, count );
+}
+
+// Top down median split into up to four groups per node
+static int b2BuildCompoundNode( b2CompoundBuilder* builder, int* indices, int count )
+{
+	b2Compound* compound = builder->compound;
+	int nodeIndex = compound->nodeCount++;
+	B2_ASSERT( nodeIndex < b2MaxInt( 1, compound->count ) );
+
+	int groupStarts[4] = { 0 };
+	int groupCounts[4] = { 0 };
+	int groupCount;
+
+	if ( count <= 4 )
+	{
+		for ( int i = 0; i < count; ++i )
+		{
+			groupStarts[i] = i;
+			groupCounts[i] = 1;
+		}
+		groupCount = count;
+	}
+	else
+	{
+		int half = b2SplitCompoundItems( builder, indices, count );
+		int quarter1 = b2SplitCompoundItems( builder, indices, half );
+		int quarter2 = b2SplitCompoundItems( builder, indices + half, count - half );
+		groupStarts[0] = 0;
+		groupCounts[0] = quarter1;
+		groupStarts[1] = quarter1;
+		groupCounts[1] = half - quarter1;
+		groupStarts[2] = half;
+		groupCounts[2] = quarter2;
+		groupStarts[3] = half + quarter2;
+		groupCounts[3] = count - half - quarter2;
+		groupCount = 4;
+	}
+
+	b2CompoundNode node;
+	for ( int i = 0; i < 4; ++i )
+	{
+		node.lowerX[i] = FLT_MAX;
+		node.lowerY[i] = FLT_MAX;
+		node.upperX[i] = -FLT_MAX;
+		node.upperY[i] = -FLT_MAX;
+		node.children[i] = B2_NULL_INDEX;
+	}
+
+	for ( int i = 0; i < groupCount; ++i )
+	{
+		b2AABB box;
+		node.children[i] = b2BuildCompoundChild( builder, indices + groupStarts[i], groupCounts[i], &box );
+		node.lowerX[i] = box.lowerBound.x;
+		node.lowerY[i] = box.lowerBound.y;
+		node.upperX[i] = box.upperBound.x;
+		node.upperY[i] = box.upperBound.y;
+	}
+
+	compound->nodes[nodeIndex] = node;
+	return nodeIndex;
+}
+
+static b2MassData b2ComputeCompoundUnitMass( const b2Polygon* polygons, int count )
+{
+	float mass = 0.0f;
+	b2Vec2 center = b2Vec2_zero;
+	for ( int i = 0; i < count; ++i )
+	{
+		b2MassData massData = b2ComputePolygonMass( polygons + i, 1.0f );
+		mass += massData.mass;
+		center = b2MulAdd( center, massData.mass, massData.center );
+	}
+
+	b2MassData result = { 0 };
+	if ( mass > 0.0f )
+	{
+		center = b2MulSV( 1.0f / mass, center );
+	}
+
+	// Shift each polygon inertia to the compound center
+	float rotationalInertia = 0.0f;
+	for ( int i = 0; i < count; ++i )
+	{
+		b2MassData massData = b2ComputePolygonMass( polygons + i, 1.0f );
+		rotationalInertia += massData.rotationalInertia + massData.mass * b2DistanceSquared( massData.center, center );
+	}
+
+	result.mass = mass;
+	result.center = center;
+	result.rotationalInertia = rotationalInertia;
+	return result;
+}
+
+b2Compound* b2CreateCompound( const b2Polygon* polygons, int count )
+{
+	if ( polygons == NULL || count <= 0 )
+	{
+		return NULL;
+	}
+
+	b2Compound* compound = B2_ALLOC_STRUCT( b2Compound );
+	compound->count = count;
+	compound->polygons = B2_ALLOC_ARRAY( count, b2Polygon );
+	memcpy( compound->polygons, polygons, count * sizeof( b2Polygon ) );
+
+	// A node has at least two children except for a root with a single polygon
+	compound->nodes = B2_ALLOC_ARRAY( count, b2CompoundNode );
+	compound->nodeCount = 0;
+
+	b2AABB* boxes = B2_ALLOC_ARRAY( count, b2AABB );
+	b2Vec2* centers = B2_ALLOC_ARRAY( count, b2Vec2 );
+	int* indices = B2_ALLOC_ARRAY( count, int );
+
+	b2AABB bounds = { { FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX } };
+	for ( int i = 0; i < count; ++i )
+	{
+		boxes[i] = b2ComputePolygonAABB( polygons + i, b2Transform_identity );
+		centers[i] = b2AABB_Center( boxes[i] );
+		indices[i] = i;
+		bounds = b2AABB_Union( bounds, boxes[i] );
+	}
+
+	b2CompoundBuilder builder = { compound, boxes, centers };
+	b2BuildCompoundNode( &builder, indices, count );
+
+	compound->bounds = bounds;
+	compound->unitMass = b2ComputeCompoundUnitMass( polygons, count );
+
+	b2Free( indices, count * sizeof( int ) );
+	b2Free( centers, count * sizeof( b2Vec2 ) );
+	b2Free( boxes, count * sizeof( b2AABB ) );
+
+	return compound;
+}
+
+void b2DestroyCompound( b2Compound* compound )
+{
+	if ( compound == NULL )
+	{
+		return;
+	}
+
+	b2Free( compound->nodes, compound->count * sizeof( b2CompoundNode ) );
+	b2Free( compound->polygons, compound->count * sizeof( b2Polygon ) );
+	b2Free( compound, sizeof( b2Compound ) );
+}
+
+int b2Compound_GetPolygonCount( const b2Compound* compound )
+{
+	return compound->count;
+}
+
+const b2Polygon* b2Compound_GetPolygons( const b2Compound* compound )
+{
+	return compound->polygons;
+}
+
+void b2QueryCompound( const b2Compound* compound, b2AABB box, b2CompoundQueryFcn* fcn, void* context )
+{
+	int stack[B2_COMPOUND_STACK_SIZE];
+	int stackCount = 0;
+	stack[stackCount++] = 0;
+
+	while ( stackCount > 0 )
+	{
+		const b2CompoundNode* node = compound->nodes + stack[--stackCount];
+		int mask = b2OverlapMask4( node->lowerX, node->lowerY, node->upperX, node->upperY, box );
+
+		for ( int i = 0; i < 4; ++i )
+		{
+			if ( ( mask & ( 1 << i ) ) == 0 )
+			{
+				continue;
+			}
+
+			int child = node->children[i];
+			B2_ASSERT( child != B2_NULL_INDEX );
+
+			if ( child < B2_NULL_INDEX )
+			{
+				if ( fcn( B2_COMPOUND_LEAF( child ), context ) == false )
+				{
+					return;
+				}
+			}
+			else
+			{
+				B2_ASSERT( stackCount < B2_COMPOUND_STACK_SIZE );
+				stack[stackCount++] = child;
+			}
+		}
+	}
+}
+
+b2MassData b2ComputeCompoundMass( const b2Compound* shape, float density )
+{
+	b2MassData massData = shape->unitMass;
+	massData.mass *= density;
+	massData.rotationalInertia *= density;
+	return massData;
+}
+
+b2AABB b2ComputeCompoundAABB( const b2Compound* shape, b2Transform transform )
+{
+	b2AABB aabb = b2ComputePolygonAABB( shape->polygons + 0, transform );
+	for ( int i = 1; i < shape->count; ++i )
+	{
+		aabb = b2AABB_Union( aabb, b2ComputePolygonAABB( shape->polygons + i, transform ) );
+	}
+	return aabb;
+}
+
+typedef struct b2CompoundPointContext
+{
+	const b2Compound* compound;
+	b2Vec2 point;
+	bool hit;
+} b2CompoundPointContext;
+
+static bool b2CompoundPointCallback( int polygonIndex, void* context )
+{
+	b2CompoundPointContext* pointContext = context;
+	if ( b2PointInPolygon( pointContext->compound->polygons + polygonIndex, pointContext->point ) )
+	{
+		pointContext->hit = true;
+		return false;
+	}
+	return true;
+}
+
+bool b2PointInCompound( const b2Compound* shape, b2Vec2 point )
+{
+	b2CompoundPointContext context = { shape, point, false };
+	b2AABB box = { point, point };
+	b2QueryCompound( shape, box, b2CompoundPointCallback, &context );
+	return context.hit;
+}
+
+typedef struct b2CompoundCastContext
+{
+	const b2Compound* compound;
+	const b2RayCastInput* rayInput;
+	const b2ShapeCastInput* shapeInput;
+	b2CastOutput output;
+} b2CompoundCastContext;
+
+static bool b2CompoundCastCallback( int polygonIndex, void* context )
+{
+	b2CompoundCastContext* castContext = context;
+	const b2Polygon* polygon = castContext->compound->polygons + polygonIndex;
+
+	b2CastOutput output;
+	if ( castContext->rayInput != NULL )
+	{
+		b2RayCastInput input = *castContext->rayInput;
+		input.maxFraction = castContext->output.hit ? castContext->output.fraction : input.maxFraction;
+		output = b2RayCastPolygon( polygon, &input );
+	}
+	else
+	{
+		b2ShapeCastInput input = *castContext->shapeInput;
+		input.maxFraction = castContext->output.hit ? castContext->output.fraction : input.maxFraction;
+		output = b2ShapeCastPolygon( polygon, &input );
+	}
+
+	if ( output.hit && ( castContext->output.hit == false || output.fraction < castContext->output.fraction ) )
+	{
+		castContext->output = output;
+	}
+
+	return true;
+}
+
+b2CastOutput b2RayCastCompound( const b2Compound* shape, const b2RayCastInput* input )
+{
+	b2Vec2 p1 = input->origin;
+	b2Vec2 p2 = b2MulAdd( p1, input->maxFraction, input->translation );
+	b2AABB box = { b2Min( p1, p2 ), b2Max( p1, p2 ) };
+
+	b2CompoundCastContext context = { 0 };
+	context.compound = shape;
+	context.rayInput = input;
+	b2QueryCompound( shape, box, b2CompoundCastCallback, &context );
+	return context.output;
+}
+
+b2CastOutput b2ShapeCastCompound( const b2Compound* shape, const b2ShapeCastInput* input )
+{
+	b2AABB box = b2MakeAABB( input->proxy.points, input->proxy.count, input->proxy.radius );
+	b2Vec2 delta = b2MulSV( input->maxFraction, input->translation );
+	box.lowerBound = b2Add( box.lowerBound, b2Min( delta, b2Vec2_zero ) );
+	box.upperBound = b2Add( box.upperBound, b2Max( delta, b2Vec2_zero ) );
+
+	b2CompoundCastContext context = { 0 };
+	context.compound = shape;
+	context.shapeInput = input;
+	b2QueryCompound( shape, box, b2CompoundCastCallback, &context );
+	return context.output;
+}
+
+// A piece of the decomposition as indices into the outline
+typedef struct b2DecompositionPiece
+{
+	int indices[B2_MAX_POLYGON_VERTICES];
+	int count;
+} b2DecompositionPiece;
+
+static bool b2PointInTriangle( b2Vec2 p, b2Vec2 a, b2Vec2 b, b2Vec2 c )
+{
+	return b2Cross( b2Sub( b, a ), b2Sub( p, a ) ) >= 0.0f && b2Cross( b2Sub( c, b ), b2Sub( p, b ) ) >= 0.0f &&
+		   b2Cross( b2Sub( a, c ), b2Sub( p, c ) ) >= 0.0f;
+}
+
+// Merges piece b into piece a across a shared edge if the result is convex and small enough
+static bool b2MergePieces( const b2Vec2* points, b2DecompositionPiece* a, const b2DecompositionPiece* b )
+{
+	if ( a->count + b->count - 2 > B2_MAX_POLYGON_VERTICES )
+	{
+		return false;
+	}
+
+	for ( int i = 0; i < a->count; ++i )
+	{
+		int a1 = a->indices[i];
+		int a2 = a->indices[i + 1 < a->count ? i + 1 : 0];
+
+		for ( int j = 0; j < b->count; ++j )
+		{
+			int b1 = b->indices[j];
+			int b2 = b->indices[j + 1 < b->count ? j + 1 : 0];
+			if ( a1 != b2 || a2 != b1 )
+			{
+				continue;
+			}
+
+			// Walk a starting after the shared edge, then b excluding the shared vertices
+			b2DecompositionPiece merged;
+			merged.count = 0;
+			for ( int k = 0; k < a->count; ++k )
+			{
+				merged.indices[merged.count++] = a->indices[( i + 1 + k ) % a->count];
+			}
+			for ( int k = 2; k < b->count; ++k )
+			{
+				merged.indices[merged.count++] = b->indices[( j + k ) % b->count];
+			}
+
+			for ( int k = 0; k < merged.count; ++k )
+			{
+				b2Vec2 p1 = points[merged.indices[k]];
+				b2Vec2 p2 = points[merged.indices[( k + 1 ) % merged.count]];
+				b2Vec2 p3 = points[merged.indices[( k + 2 ) % merged.count]];
+				b2Vec2 e1 = b2Sub( p2, p1 );
+				b2Vec2 e2 = b2Sub( p3, p2 );
+				if ( b2Cross( e1, e2 ) < -B2_LINEAR_SLOP * b2Length( e1 ) )
+				{
+					return false;
+				}
+			}
+
+			*a = merged;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int b2DecomposePolygon( const b2Vec2* points, int count, float radius, b2Polygon* polygons, int capacity )
+{
+	if ( count < 3 )
+	{
+		return 0;
+	}
+
+	// Counter-clockwise copy of the outline
+	b2Vec2* ps = B2_ALLOC_ARRAY( count, b2Vec2 );
+	float area = 0.0f;
+	for ( int i = 0; i < count; ++i )
+	{
+		area += b2Cross( points[i], points[i + 1 < count ? i + 1 : 0] );
+	}
+	for ( int i = 0; i < count; ++i )
+	{
+		ps[i] = area >= 0.0f ? points[i] : points[count - 1 - i];
+	}
+
+	int pieceCapacity = count - 2;
+	b2DecompositionPiece* pieces = B2_ALLOC_ARRAY( pieceCapacity, b2DecompositionPiece );
+	int pieceCount = 0;
+
+	// Ear clipping
+	int* remaining = B2_ALLOC_ARRAY( count, int );
+	for ( int i = 0; i < count; ++i )
+	{
+		remaining[i] = i;
+	}
+
+	int remainingCount = count;
+	while ( remainingCount > 3 )
+	{
+		int earIndex = B2_NULL_INDEX;
+		int flattestIndex = 0;
+		float flattest = FLT_MAX;
+
+		for ( int i = 0; i < remainingCount; ++i )
+		{
+			int i0 = remaining[i > 0 ? i - 1 : remainingCount - 1];
+			int i1 = remaining[i];
+			int i2 = remaining[i + 1 < remainingCount ? i + 1 : 0];
+			b2Vec2 a = ps[i0], b = ps[i1], c = ps[i2];
+
+			float cross = b2Cross( b2Sub( b, a ), b2Sub( c, b ) );
+			if ( b2AbsFloat( cross ) < flattest )
+			{
+				flattest = b2AbsFloat( cross );
+				flattestIndex = i;
+			}
+
+			if ( cross <= FLT_EPSILON )
+			{
+				continue;
+			}
+
+			bool isEar = true;
+			for ( int j = 0; j < remainingCount; ++j )
+			{
+				int k = remaining[j];
+				if ( k == i0 || k == i1 || k == i2 )
+				{
+					continue;
+				}
+
+				if ( b2PointInTriangle( ps[k], a, b, c ) )
+				{
+					isEar = false;
+					break;
+				}
+			}
+
+			if ( isEar )
+			{
+				earIndex = i;
+				break;
+			}
+		}
+
+		if ( earIndex != B2_NULL_INDEX )
+		{
+			b2DecompositionPiece* piece = pieces + pieceCount++;
+			piece->indices[0] = remaining[earIndex > 0 ? earIndex - 1 : remainingCount - 1];
+			piece->indices[1] = remaining[earIndex];
+			piece->indices[2] = remaining[earIndex + 1 < remainingCount ? earIndex + 1 : 0];
+			piece->count = 3;
+		}
+		else
+		{
+			// Degenerate outline, drop the most collinear vertex
+			earIndex = flattestIndex;
+		}
+
+		for ( int i = earIndex; i < remainingCount - 1; ++i )
+		{
+			remaining[i] = remaining[i + 1];
+		}
+		remainingCount -= 1;
+	}
+
+	if ( b2Cross( b2Sub( ps[remaining[1]], ps[remaining[0]] ), b2Sub( ps[remaining[2]], ps[remaining[1]] ) ) > FLT_EPSILON )
+	{
+		b2DecompositionPiece* piece = pieces + pieceCount++;
+		piece->indices[0] = remaining[0];
+		piece->indices[1] = remaining[1];
+		piece->indices[2] = remaining[2];
+		piece->count = 3;
+	}
+
+	B2_ASSERT( pieceCount <= pieceCapacity );
+
+	// Merge neighbors across shared diagonals while the result stays convex
+	bool merged = true;
+	while ( merged )
+	{
+		merged = false;
+		for ( int i = 0; i < pieceCount; ++i )
+		{
+			for ( int j = i + 1; j < pieceCount; ++j )
+			{
+				if ( b2MergePieces( ps, pieces + i, pieces + j ) )
+				{
+					pieces[j] = pieces[pieceCount - 1];
+					pieceCount -= 1;
+					merged = true;
+					j -= 1;
+				}
+			}
+		}
+	}
+
+	int polygonCount = 0;
+	for ( int i = 0; i < pieceCount; ++i )
+	{
+		b2Vec2 piecePoints[B2_MAX_POLYGON_VERTICES];
+		for ( int j = 0; j < pieces[i].count; ++j )
+		{
+			piecePoints[j] = ps[pieces[i].indices[j]];
+		}
+
+		// Slivers smaller than the linear slop are dropped
+		b2Hull hull = b2ComputeHull( piecePoints, pieces[i].count );
+		if ( hull.count == 0 )
+		{
+			continue;
+		}
+
+		if ( polygons != NULL && polygonCount < capacity )
+		{
+			polygons[polygonCount] = b2MakePolygon( &hull, radius );
+		}
+		polygonCount += 1;
+	}
+
+	b2Free( remaining, count * sizeof( int ) );
+	b2Free( pieces, pieceCapacity * sizeof( b2DecompositionPiece ) );
+	b2Free( ps, count * sizeof( b2Vec2 ) );
+
+	return polygonCount;
+}
+
+// Merges the manifolds of the polygons near the other shape into one manifold. Manifolds with similar
+// normals pool their points and keep the deepest point and the point furthest from it. Otherwise the
+// deeper manifold wins. The feature ids are tagged with the polygon key so they stay unique for warm starting.
+static void b2MergeCompoundManifold( b2Manifold* result, b2Manifold* child, int key )
+{
+	if ( child->pointCount == 0 )
+	{
+		return;
+	}
+
+	uint16_t tag = (uint16_t)( ( ( key & 0x1F ) << 3 ) | ( ( ( key >> 5 ) & 0x1F ) << 11 ) );
+	float childDepth = FLT_MAX;
+	for ( int i = 0; i < child->pointCount; ++i )
+	{
+		child->points[i].id ^= tag;
+		childDepth = b2MinFloat( childDepth, child->points[i].separation );
+	}
+
+	if ( result->pointCount == 0 )
+	{
+		*result = *child;
+		return;
+	}
+
+	float resultDepth = FLT_MAX;
+	for ( int i = 0; i < result->pointCount; ++i )
+	{
+		resultDepth = b2MinFloat( resultDepth, result->points[i].separation );
+	}
+
+	if ( b2Dot( result->normal, child->normal ) < 0.9f )
+	{
+		if ( childDepth < resultDepth )
+		{
+			*result = *child;
+		}
+		return;
+	}
+
+	b2ManifoldPoint pool[4] = { 0 };
+	int poolCount = 0;
+	for ( int i = 0; i < result->pointCount; ++i )
+	{
+		pool[poolCount++] = result->points[i];
+	}
+	for ( int i = 0; i < child->pointCount; ++i )
+	{
+		pool[poolCount++] = child->points[i];
+	}
+
+	int deepest = 0;
+	for ( int i = 1; i < poolCount; ++i )
+	{
+		if ( pool[i].separation < pool[deepest].separation )
+		{
+			deepest = i;
+		}
+	}
+
+	int furthest = B2_NULL_INDEX;
+	float maxDistanceSquared = B2_LINEAR_SLOP * B2_LINEAR_SLOP;
+	for ( int i = 0; i < poolCount; ++i )
+	{
+		float distanceSquared = b2DistanceSquared( pool[i].anchorA, pool[deepest].anchorA );
+		if ( distanceSquared > maxDistanceSquared )
+		{
+			maxDistanceSquared = distanceSquared;
+			furthest = i;
+		}
+	}
+
+	result->normal = childDepth < resultDepth ? child->normal : result->normal;
+	result->points[0] = pool[deepest];
+	result->pointCount = 1;
+	if ( furthest != B2_NULL_INDEX )
+	{
+		result->points[1] = pool[furthest];
+		result->pointCount = 2;
+	}
+}
+
+typedef struct b2CompoundManifoldContext
+{
+	const b2Compound* compound;
+	b2Transform xfCompound;
+	const void* other;
+	b2Transform xfOther;
+	b2ShapeType otherType;
+	bool otherIsA;
+	int keyOffset;
+	b2Manifold manifold;
+} b2CompoundManifoldContext;
+
+static bool b2CompoundManifoldCallback( int polygonIndex, void* context )
+{
+	b2CompoundManifoldContext* manifoldContext = context;
+	const b2Polygon* polygon = manifoldContext->compound->polygons + polygonIndex;
+	b2Transform xfA = manifoldContext->xfCompound;
+	b2Transform xfB = manifoldContext->xfOther;
+
+	b2Manifold child = { 0 };
+	switch ( manifoldContext->otherType )
+	{
+		case b2_circleShape:
+			child = b2CollidePolygonAndCircle( polygon, xfA, manifoldContext->other, xfB );
+			break;
+
+		case b2_capsuleShape:
+			child = b2CollidePolygonAndCapsule( polygon, xfA, manifoldContext->other, xfB );
+			break;
+
+		case b2_polygonShape:
+			if ( manifoldContext->otherIsA )
+			{
+				child = b2CollidePolygons( manifoldContext->other, xfB, polygon, xfA );
+			}
+			else
+			{
+				child = b2CollidePolygons( polygon, xfA, manifoldContext->other, xfB );
+			}
+			break;
+
+		case b2_segmentShape:
+			child = b2CollideSegmentAndPolygon( manifoldContext->other, xfB, polygon, xfA );
+			break;
+
+		case b2_chainSegmentShape:
+		{
+			b2SimplexCache cache = { 0 };
+			child = b2CollideChainSegmentAndPolygon( manifoldContext->other, xfB, polygon, xfA, &cache );
+		}
+		break;
+
+		default:
+			B2_ASSERT( false );
+			break;
+	}
+
+	b2MergeCompoundManifold( &manifoldContext->manifold, &child, manifoldContext->keyOffset + polygonIndex );
+	return true;
+}
+
+static b2Manifold b2CollideCompoundAndShape( const b2Compound* compound, b2Transform xfCompound, const void* other,
+											 b2Transform xfOther, b2ShapeType otherType, bool otherIsA, b2AABB otherBox,
+											 int keyOffset )
+{
+	b2CompoundManifoldContext context = {
+		.compound = compound,
+		.xfCompound = xfCompound,
+		.other = other,
+		.xfOther = xfOther,
+		.otherType = otherType,
+		.otherIsA = otherIsA,
+		.keyOffset = keyOffset,
+	};
+
+	// A compound of one polygon is shared polygon geometry. The polygon manifold already rejects
+	// distant shapes, so the hierarchy is skipped.
+	if ( compound->count == 1 )
+	{
+		b2CompoundManifoldCallback( 0, &context );
+		return context.manifold;
+	}
+
+	otherBox.lowerBound = b2Sub( otherBox.lowerBound, (b2Vec2){ B2_SPECULATIVE_DISTANCE, B2_SPECULATIVE_DISTANCE } );
+	otherBox.upperBound = b2Add( otherBox.upperBound, (b2Vec2){ B2_SPECULATIVE_DISTANCE, B2_SPECULATIVE_DISTANCE } );
+	b2QueryCompound( compound, otherBox, b2CompoundManifoldCallback, &context );
+	return context.manifold;
+}
+
+b2Manifold b2CollideCompoundAndCircle( const b2Compound* compoundA, b2Transform xfA, const b2Circle* circleB, b2Transform xfB )
+{
+	b2AABB box = b2ComputeCircleAABB( circleB, b2InvMulTransforms( xfA, xfB ) );
+	return b2CollideCompoundAndShape( compoundA, xfA, circleB, xfB, b2_circleShape, false, box, 0 );
+}
+
+b2Manifold b2CollideCompoundAndCapsule( const b2Compound* compoundA, b2Transform xfA, const b2Capsule* capsuleB,
+										b2Transform xfB )
+{
+	b2AABB box = b2ComputeCapsuleAABB( capsuleB, b2InvMulTransforms( xfA, xfB ) );
+	return b2CollideCompoundAndShape( compoundA, xfA, capsuleB, xfB, b2_capsuleShape, false, box, 0 );
+}
+
+b2Manifold b2CollideCompoundAndPolygon( const b2Compound* compoundA, b2Transform xfA, const b2Polygon* polygonB,
+										b2Transform xfB )
+{
+	b2AABB box = b2ComputePolygonAABB( polygonB, b2InvMulTransforms( xfA, xfB ) );
+	return b2CollideCompoundAndShape( compoundA, xfA, polygonB, xfB, b2_polygonShape, false, box, 0 );
+}
+
+b2Manifold b2CollideSegmentAndCompound( const b2Segment* segmentA, b2Transform xfA, const b2Compound* compoundB,
+										b2Transform xfB )
+{
+	b2AABB box = b2ComputeSegmentAABB( segmentA, b2InvMulTransforms( xfB, xfA ) );
+	return b2CollideCompoundAndShape( compoundB, xfB, segmentA, xfA, b2_segmentShape, true, box, 0 );
+}
+
+b2Manifold b2CollideChainSegmentAndCompound( const b2ChainSegment* segmentA, b2Transform xfA, const b2Compound* compoundB,
+											 b2Transform xfB )
+{
+	b2AABB box = b2ComputeSegmentAABB( &segmentA->segment, b2InvMulTransforms( xfB, xfA ) );
+	return b2CollideCompoundAndShape( compoundB, xfB, segmentA, xfA, b2_chainSegmentShape, true, box, 0 );
+}
+
+typedef struct b2CompoundPairContext
+{
+	const b2Compound* compoundA;
+	b2Transform xfA;
+	const b2Compound* compoundB;
+	b2Transform xfB;
+	b2Transform xfAinB;
+	b2Manifold manifold;
+} b2CompoundPairContext;
+
+static bool b2CompoundPairCallback( int polygonIndex, void* context )
+{
+	b2CompoundPairContext* pairContext = context;
+	const b2Polygon* polygonA = pairContext->compoundA->polygons + polygonIndex;
+	b2AABB box = b2ComputePolygonAABB( polygonA, pairContext->xfAinB );
+
+	// Polygon A is shape A of the pair
+	b2Manifold child = b2CollideCompoundAndShape( pairContext->compoundB, pairContext->xfB, polygonA, pairContext->xfA,
+												  b2_polygonShape, true, box, 37 * polygonIndex );
+	b2MergeCompoundManifold( &pairContext->manifold, &child, 0 );
+	return true;
+}
+
+b2Manifold b2CollideCompounds( const b2Compound* compoundA, b2Transform xfA, const b2Compound* compoundB, b2Transform xfB )
+{
+	b2CompoundPairContext context = {
+		.compoundA = compoundA,
+		.xfA = xfA,
+		.compoundB = compoundB,
+		.xfB = xfB,
+		.xfAinB = b2InvMulTransforms( xfB, xfA ),
+	};
+
+	if ( compoundA->count == 1 )
+	{
+		b2CompoundPairCallback( 0, &context );
+		return context.manifold;
+	}
+
+	b2AABB box = b2ComputeCompoundAABB( compoundB, b2InvMulTransforms( xfA, xfB ) );
+	box.lowerBound = b2Sub( box.lowerBound, (b2Vec2){ B2_SPECULATIVE_DISTANCE, B2_SPECULATIVE_DISTANCE } );
+	box.upperBound = b2Add( box.upperBound, (b2Vec2){ B2_SPECULATIVE_DISTANCE, B2_SPECULATIVE_DISTANCE } );
+	b2QueryCompound( compoundA, box, b2CompoundPairCallback, &context );
+	return context.manifold;
+}
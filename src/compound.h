@@ -0,0 +1,42 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "box2d/collision.h"
+
+// Node of the 4-wide bounding volume hierarchy of a compound. The child boxes are stored as SoA so
+// all four are tested at once. A child is a node index, a polygon index encoded with
+// B2_COMPOUND_LEAF, or B2_NULL_INDEX for an empty lane. Empty lanes have an inverted box.
+typedef struct b2CompoundNode
+{
+	float lowerX[4];
+	float lowerY[4];
+	float upperX[4];
+	float upperY[4];
+	int children[4];
+} b2CompoundNode;
+
+// Encodes a polygon index as a child and back. The encoding is its own inverse.
+#define B2_COMPOUND_LEAF( index ) ( -2 - ( index ) )
+
+struct b2Compound
+{
+	b2Polygon* polygons;
+	b2CompoundNode* nodes;
+
+	// Mass at unit density
+	b2MassData unitMass;
+
+	// Local bounds of all polygons
+	b2AABB bounds;
+
+	int count;
+	int nodeCount;
+};
+
+// Returns false to stop the query
+typedef bool b2CompoundQueryFcn( int polygonIndex, void* context );
+
+// Reports the polygons whose local bounding box overlaps the local box
+void b2QueryCompound( const b2Compound* compound, b2AABB box, b2CompoundQueryFcn* fcn, void* context );
@@ -3,36 +3,76 @@
 
 #include "constraint_graph.h"
 
+#include "arena_allocator.h"
 #include "bitset.h"
 #include "body.h"
 #include "contact.h"
 #include "joint.h"
+#include "parallel_for.h"
 #include "physics_world.h"
 #include "solver_set.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 // Solver using graph coloring. Islands are only used for sleep.
 // High-Performance Physical Simulations on Next-Generation Architecture with Many Cores
 // http://web.eecs.umich.edu/~msmelyan/papers/physsim_onmanycore_itj.pdf
 
-// Kinematic bodies have to be treated like dynamic bodies in graph coloring. Unlike static bodies, we cannot use a dummy solver
-// body for kinematic bodies. We cannot access a kinematic body from multiple threads efficiently because the SIMD solver body
-// scatter would write to the same kinematic body from multiple threads. Even if these writes don't modify the body, they will
-// cause horrible cache stalls. To make this feasible I would need a way to block these writes.
-// todo should be possible to branch on the scatters to avoid writing to kinematic bodies
+// Kinematic bodies are treated like static bodies in graph coloring. Only the dynamic body of a constraint takes a color
+// slot, so a moving platform does not use up a color for every contact touching it. Unlike static bodies, kinematic bodies
+// keep a real solver body so the solver can read their velocity. Many threads may read the same kinematic body, but
+// every velocity write (SIMD scatter, scalar joints, overflow) is skipped unless the body has b2_dynamicFlag. Writing
+// to a shared kinematic body from multiple threads, even with unchanged values, would cause horrible cache stalls.
 
 // This is used for debugging by making all constraints be assigned to overflow.
 #define B2_FORCE_OVERFLOW 0
 
-void b2CreateGraph( b2ConstraintGraph* graph, const b2Capacity* capacity )
+// Adaptive coloring: a body with a high constraint degree is treated as a hub once it occupies
+// hubColorLimit colors. Its remaining constraints go to the overflow color instead of spreading a
+// single constraint across many colors. With the mass splitting overflow solver each of these
+// constraints acts on a virtual sub-body with a share of the hub mass and the sub-body velocity
+// changes are averaged back into the hub.
+static bool b2IsHubBody( const b2ConstraintGraph* graph, int bodyId )
+{
+	if ( graph->hubColorLimit == 0 )
+	{
+		return false;
+	}
+
+	int count = 0;
+	for ( int i = 0; i < graph->colorCount - 1; ++i )
+	{
+		if ( b2GetBit( &graph->colors[i].bodySet, bodyId ) )
+		{
+			count += 1;
+			if ( count >= graph->hubColorLimit )
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+void b2CreateGraph( b2ConstraintGraph* graph, const b2Capacity* capacity, int colorCount, bool enableAdaptiveColoring )
 {
 	_Static_assert( B2_GRAPH_COLOR_COUNT >= 2, "must have at least two constraint graph colors" );
 	_Static_assert( B2_OVERFLOW_INDEX == B2_GRAPH_COLOR_COUNT - 1, "bad over flow index" );
 	_Static_assert( B2_DYNAMIC_COLOR_COUNT >= 2, "need more dynamic colors" );
+	_Static_assert( B2_MIN_GRAPH_COLOR_COUNT <= B2_GRAPH_COLOR_COUNT, "bad minimum color count" );
 
 	*graph = (b2ConstraintGraph){ 0 };
 
+	// Zero selects the compiled color count
+	graph->colorCount = colorCount == 0 ? B2_GRAPH_COLOR_COUNT
+										: b2ClampInt( colorCount, B2_MIN_GRAPH_COLOR_COUNT, B2_GRAPH_COLOR_COUNT );
+	graph->dynamicColorCount = graph->colorCount - 4;
+
+	// A hub that fills half the colors leaves mostly single constraint lanes in the remaining colors
+	graph->hubColorLimit = enableAdaptiveColoring ? ( graph->colorCount - 1 ) / 2 : 0;
+
 	int bodyCapacity = b2MaxInt( capacity->staticBodyCount + capacity->dynamicBodyCount, 16 );
 
 	// Initialize graph color bit set.
@@ -42,7 +82,7 @@ void b2CreateGraph( b2ConstraintGraph* graph, const b2Capacity* capacity )
 		b2GraphColor* color = graph->colors + i;
 		color->bodySet = b2CreateBitSet( bodyCapacity );
 		b2SetBitCountAndClear( &color->bodySet, bodyCapacity );
-		b2Array_Reserve( color->contactSims, 16 );
+		b2Array_ReserveGrow( color->contactSims, 16 );
 	}
 }
 
@@ -61,31 +101,22 @@ void b2DestroyGraph( b2ConstraintGraph* graph )
 	}
 }
 
-// Contacts are always created as non-touching. They get moved into the constraint
-// graph once they are found to be touching.
-void b2AddContactToGraph( b2World* world, b2ContactSim* contactSim, b2Contact* contact )
+static int b2AssignContactColor( b2ConstraintGraph* graph, int bodyIdA, int bodyIdB, b2BodyType typeA, b2BodyType typeB )
 {
-	B2_ASSERT( contactSim->manifold.pointCount > 0 );
-	B2_ASSERT( contactSim->simFlags & b2_simTouchingFlag );
-	B2_ASSERT( contact->flags & b2_contactTouchingFlag );
-
-	b2ConstraintGraph* graph = &world->constraintGraph;
-	int colorIndex = B2_OVERFLOW_INDEX;
-
-	int bodyIdA = contact->edges[0].bodyId;
-	int bodyIdB = contact->edges[1].bodyId;
-	b2Body* bodyA = b2Array_Get( world->bodies, bodyIdA );
-	b2Body* bodyB = b2Array_Get( world->bodies, bodyIdB );
-
-	b2BodyType typeA = bodyA->type;
-	b2BodyType typeB = bodyB->type;
 	B2_ASSERT( typeA == b2_dynamicBody || typeB == b2_dynamicBody );
 
 #if B2_FORCE_OVERFLOW == 0
-	if ( typeA == b2_dynamicBody && typeB == b2_dynamicBody )
+	bool isHub = ( typeA == b2_dynamicBody && b2IsHubBody( graph, bodyIdA ) ) ||
+				 ( typeB == b2_dynamicBody && b2IsHubBody( graph, bodyIdB ) );
+
+	if ( isHub )
+	{
+		// leave the contact in overflow
+	}
+	else if ( typeA == b2_dynamicBody && typeB == b2_dynamicBody )
 	{
 		// Dynamic constraint colors cannot encroach on colors reserved for static constraints
-		for ( int i = 0; i < B2_DYNAMIC_COLOR_COUNT; ++i )
+		for ( int i = 0; i < graph->dynamicColorCount; ++i )
 		{
 			b2GraphColor* color = graph->colors + i;
 			if ( b2GetBit( &color->bodySet, bodyIdA ) || b2GetBit( &color->bodySet, bodyIdB ) )
@@ -95,14 +126,13 @@ void b2AddContactToGraph( b2World* world, b2ContactSim* contactSim, b2Contact* c
 
 			b2SetBitGrow( &color->bodySet, bodyIdA );
 			b2SetBitGrow( &color->bodySet, bodyIdB );
-			colorIndex = i;
-			break;
+			return i;
 		}
 	}
 	else if ( typeA == b2_dynamicBody )
 	{
 		// Static constraint colors build from the end to get higher priority than dyn-dyn constraints
-		for ( int i = B2_OVERFLOW_INDEX - 1; i >= 1; --i )
+		for ( int i = graph->colorCount - 2; i >= 1; --i )
 		{
 			b2GraphColor* color = graph->colors + i;
 			if ( b2GetBit( &color->bodySet, bodyIdA ) )
@@ -111,14 +141,13 @@ void b2AddContactToGraph( b2World* world, b2ContactSim* contactSim, b2Contact* c
 			}
 
 			b2SetBitGrow( &color->bodySet, bodyIdA );
-			colorIndex = i;
-			break;
+			return i;
 		}
 	}
 	else if ( typeB == b2_dynamicBody )
 	{
 		// Static constraint colors build from the end to get higher priority than dyn-dyn constraints
-		for ( int i = B2_OVERFLOW_INDEX - 1; i >= 1; --i )
+		for ( int i = graph->colorCount - 2; i >= 1; --i )
 		{
 			b2GraphColor* color = graph->colors + i;
 			if ( b2GetBit( &color->bodySet, bodyIdB ) )
@@ -127,22 +156,28 @@ void b2AddContactToGraph( b2World* world, b2ContactSim* contactSim, b2Contact* c
 			}
 
 			b2SetBitGrow( &color->bodySet, bodyIdB );
-			colorIndex = i;
-			break;
+			return i;
 		}
 	}
+#else
+	B2_UNUSED( graph, bodyIdA, bodyIdB );
 #endif
 
-	b2GraphColor* color = graph->colors + colorIndex;
-	contact->colorIndex = colorIndex;
-	contact->localIndex = color->contactSims.count;
+	return B2_OVERFLOW_INDEX;
+}
 
-	b2ContactSim* newContact = b2Array_Emplace( color->contactSims );
+// Copy a contact into its slot in a color and resolve the awake body sim indices
+static void b2WriteColorContact( b2World* world, b2SolverSet* awakeSet, b2ContactSim* newContact,
+								 const b2ContactSim* contactSim, const b2Contact* contact )
+{
 	memcpy( newContact, contactSim, sizeof( b2ContactSim ) );
 
 	// todo perhaps skip this if the contact is already awake
 
-	if ( typeA == b2_staticBody )
+	b2Body* bodyA = b2Array_Get( world->bodies, contact->edges[0].bodyId );
+	b2Body* bodyB = b2Array_Get( world->bodies, contact->edges[1].bodyId );
+
+	if ( bodyA->type == b2_staticBody )
 	{
 		newContact->bodySimIndexA = B2_NULL_INDEX;
 		newContact->invMassA = 0.0f;
@@ -151,7 +186,6 @@ void b2AddContactToGraph( b2World* world, b2ContactSim* contactSim, b2Contact* c
 	else
 	{
 		B2_ASSERT( bodyA->setIndex == b2_awakeSet );
-		b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
 
 		int localIndex = bodyA->localIndex;
 		newContact->bodySimIndexA = localIndex;
@@ -161,7 +195,7 @@ void b2AddContactToGraph( b2World* world, b2ContactSim* contactSim, b2Contact* c
 		newContact->invIA = bodySimA->invInertia;
 	}
 
-	if ( typeB == b2_staticBody )
+	if ( bodyB->type == b2_staticBody )
 	{
 		newContact->bodySimIndexB = B2_NULL_INDEX;
 		newContact->invMassB = 0.0f;
@@ -170,7 +204,6 @@ void b2AddContactToGraph( b2World* world, b2ContactSim* contactSim, b2Contact* c
 	else
 	{
 		B2_ASSERT( bodyB->setIndex == b2_awakeSet );
-		b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
 
 		int localIndex = bodyB->localIndex;
 		newContact->bodySimIndexB = localIndex;
@@ -181,6 +214,144 @@ void b2AddContactToGraph( b2World* world, b2ContactSim* contactSim, b2Contact* c
 	}
 }
 
+// Append a contact to the color already stored in contact->colorIndex
+static void b2AppendContactToColor( b2World* world, b2SolverSet* awakeSet, b2ContactSim* contactSim, b2Contact* contact )
+{
+	b2GraphColor* color = world->constraintGraph.colors + contact->colorIndex;
+	contact->localIndex = color->contactSims.count;
+	world->constraintGraph.changedContactColors |= 1ull << contact->colorIndex;
+
+	b2ContactSim* newContact = b2Array_Emplace( color->contactSims );
+	b2WriteColorContact( world, awakeSet, newContact, contactSim, contact );
+}
+
+// Contacts are always created as non-touching. They get moved into the constraint
+// graph once they are found to be touching.
+void b2AddContactToGraph( b2World* world, b2ContactSim* contactSim, b2Contact* contact )
+{
+	B2_ASSERT( contactSim->manifold.pointCount > 0 );
+	B2_ASSERT( contactSim->simFlags & b2_simTouchingFlag );
+	B2_ASSERT( contact->flags & b2_contactTouchingFlag );
+
+	int bodyIdA = contact->edges[0].bodyId;
+	int bodyIdB = contact->edges[1].bodyId;
+	b2Body* bodyA = b2Array_Get( world->bodies, bodyIdA );
+	b2Body* bodyB = b2Array_Get( world->bodies, bodyIdB );
+
+	contact->colorIndex = b2AssignContactColor( &world->constraintGraph, bodyIdA, bodyIdB, bodyA->type, bodyB->type );
+
+	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
+	b2AppendContactToColor( world, awakeSet, contactSim, contact );
+}
+
+// Bulk version of b2AddContactToGraph used when a sleeping set wakes. Colors are assigned in
+// array order first so the result matches adding the contacts one at a time. Then every color
+// grows at most once before the contacts are copied.
+void b2AddContactsToGraph( b2World* world, b2ContactSim* contactSims, int count )
+{
+	b2ConstraintGraph* graph = &world->constraintGraph;
+	int colorCounts[B2_GRAPH_COLOR_COUNT] = { 0 };
+
+	for ( int i = 0; i < count; ++i )
+	{
+		b2ContactSim* contactSim = contactSims + i;
+		b2Contact* contact = b2Array_Get( world->contacts, contactSim->contactId );
+		B2_ASSERT( contactSim->manifold.pointCount > 0 );
+		B2_ASSERT( contactSim->simFlags & b2_simTouchingFlag );
+		B2_ASSERT( contact->flags & b2_contactTouchingFlag );
+
+		int bodyIdA = contact->edges[0].bodyId;
+		int bodyIdB = contact->edges[1].bodyId;
+		b2Body* bodyA = b2Array_Get( world->bodies, bodyIdA );
+		b2Body* bodyB = b2Array_Get( world->bodies, bodyIdB );
+
+		int colorIndex = b2AssignContactColor( graph, bodyIdA, bodyIdB, bodyA->type, bodyB->type );
+		contact->colorIndex = colorIndex;
+		colorCounts[colorIndex] += 1;
+	}
+
+	for ( int i = 0; i < B2_GRAPH_COLOR_COUNT; ++i )
+	{
+		if ( colorCounts[i] > 0 )
+		{
+			b2GraphColor* color = graph->colors + i;
+			b2Array_ReserveGrow( color->contactSims, color->contactSims.count + colorCounts[i] );
+		}
+	}
+
+	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
+	for ( int i = 0; i < count; ++i )
+	{
+		b2ContactSim* contactSim = contactSims + i;
+		b2Contact* contact = world->contacts.data + contactSim->contactId;
+		b2AppendContactToColor( world, awakeSet, contactSim, contact );
+	}
+}
+
+typedef struct b2TouchingContactContext
+{
+	b2World* world;
+	const int* contactIds;
+	const int* sourceIndices;
+} b2TouchingContactContext;
+
+static void b2CopyTouchingContactsTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	B2_UNUSED( workerIndex );
+
+	b2TouchingContactContext* copyContext = context;
+	b2World* world = copyContext->world;
+	b2SolverSet* awakeSet = world->solverSets.data + b2_awakeSet;
+	b2GraphColor* colors = world->constraintGraph.colors;
+
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		const b2Contact* contact = world->contacts.data + copyContext->contactIds[i];
+		b2ContactSim* newContact = colors[contact->colorIndex].contactSims.data + contact->localIndex;
+		const b2ContactSim* contactSim = awakeSet->contactSims.data + copyContext->sourceIndices[i];
+		b2WriteColorContact( world, awakeSet, newContact, contactSim, contact );
+	}
+}
+
+// Colors are assigned in order so the result matches adding the contacts one at a time. Each
+// contact then knows its slot, so the copies into the colors run in parallel.
+void b2AddTouchingContactsToGraph( b2World* world, const int* contactIds, const int* sourceIndices, int count )
+{
+	b2ConstraintGraph* graph = &world->constraintGraph;
+	int colorCounts[B2_GRAPH_COLOR_COUNT] = { 0 };
+
+	for ( int i = 0; i < count; ++i )
+	{
+		b2Contact* contact = b2Array_Get( world->contacts, contactIds[i] );
+		B2_ASSERT( contact->flags & b2_contactTouchingFlag );
+		B2_ASSERT( contact->colorIndex == B2_NULL_INDEX );
+
+		int bodyIdA = contact->edges[0].bodyId;
+		int bodyIdB = contact->edges[1].bodyId;
+		b2Body* bodyA = b2Array_Get( world->bodies, bodyIdA );
+		b2Body* bodyB = b2Array_Get( world->bodies, bodyIdB );
+
+		int colorIndex = b2AssignContactColor( graph, bodyIdA, bodyIdB, bodyA->type, bodyB->type );
+		contact->colorIndex = colorIndex;
+		contact->localIndex = graph->colors[colorIndex].contactSims.count + colorCounts[colorIndex];
+		colorCounts[colorIndex] += 1;
+	}
+
+	for ( int i = 0; i < B2_GRAPH_COLOR_COUNT; ++i )
+	{
+		if ( colorCounts[i] > 0 )
+		{
+			b2GraphColor* color = graph->colors + i;
+			b2Array_ReserveGrow( color->contactSims, color->contactSims.count + colorCounts[i] );
+			color->contactSims.count += colorCounts[i];
+			graph->changedContactColors |= 1ull << i;
+		}
+	}
+
+	b2TouchingContactContext context = { world, contactIds, sourceIndices };
+	b2ParallelFor( world, b2CopyTouchingContactsTask, count, 64, &context );
+}
+
 void b2RemoveContactFromGraph( b2World* world, int bodyIdA, int bodyIdB, int colorIndex, int localIndex )
 {
 	b2ConstraintGraph* graph = &world->constraintGraph;
@@ -195,6 +366,8 @@ void b2RemoveContactFromGraph( b2World* world, int bodyIdA, int bodyIdB, int col
 		b2ClearBit( &color->bodySet, bodyIdB );
 	}
 
+	graph->changedContactColors |= 1ull << colorIndex;
+
 	int movedIndex = b2Array_RemoveSwap( color->contactSims, localIndex );
 	if ( movedIndex != B2_NULL_INDEX )
 	{
@@ -211,6 +384,197 @@ void b2RemoveContactFromGraph( b2World* world, int bodyIdA, int bodyIdB, int col
 	}
 }
 
+typedef struct b2ContactOrderKey
+{
+	uint64_t key;
+	int contactId;
+	int index;
+} b2ContactOrderKey;
+
+static int b2CompareContactOrderKeys( const void* a, const void* b )
+{
+	const b2ContactOrderKey* keyA = a;
+	const b2ContactOrderKey* keyB = b;
+	if ( keyA->key != keyB->key )
+	{
+		return keyA->key < keyB->key ? -1 : 1;
+	}
+
+	return keyA->contactId - keyB->contactId;
+}
+
+static bool b2IsContactOrderLess( const b2ContactOrderKey* keyA, const b2ContactOrderKey* keyB )
+{
+	return keyA->key < keyB->key || ( keyA->key == keyB->key && keyA->contactId < keyB->contactId );
+}
+
+// Contacts are appended to the colors as they begin touching and removed by swapping, so the SIMD lanes
+// of a wide constraint refer to unrelated bodies. This sorts each color by the smaller and then the larger
+// awake body index. A static body has a null index which sorts last. The contacts within a color share no
+// dynamic body, so the order does not change the solution. The overflow color is solved in order and
+// is left alone. Called before the solver prepares the constraints, once the narrow phase has updated
+// the body indices.
+void b2SortGraphContacts( b2World* world )
+{
+	b2ConstraintGraph* graph = &world->constraintGraph;
+	b2Contact* contacts = world->contacts.data;
+
+	for ( int i = 0; i < B2_OVERFLOW_INDEX; ++i )
+	{
+		b2GraphColor* color = graph->colors + i;
+		int count = color->contactSims.count;
+		if ( count < 2 )
+		{
+			continue;
+		}
+
+		b2ContactSim* contactSims = color->contactSims.data;
+		b2ContactOrderKey* keys = b2StackAlloc( &world->stack, count * sizeof( b2ContactOrderKey ), "contact order keys" );
+
+		bool sorted = true;
+		for ( int j = 0; j < count; ++j )
+		{
+			uint32_t indexA = (uint32_t)contactSims[j].bodySimIndexA;
+			uint32_t indexB = (uint32_t)contactSims[j].bodySimIndexB;
+			uint64_t lower = indexA < indexB ? indexA : indexB;
+			uint64_t upper = indexA < indexB ? indexB : indexA;
+			keys[j] = (b2ContactOrderKey){ ( lower << 32 ) | upper, contactSims[j].contactId, j };
+			sorted = sorted && ( j == 0 || b2IsContactOrderLess( keys + j - 1, keys + j ) );
+		}
+
+		if ( sorted == false )
+		{
+			qsort( keys, count, sizeof( b2ContactOrderKey ), b2CompareContactOrderKeys );
+
+			b2ContactSim* oldSims = b2StackAlloc( &world->stack, count * sizeof( b2ContactSim ), "old contact sims" );
+			memcpy( oldSims, contactSims, count * sizeof( b2ContactSim ) );
+
+			for ( int j = 0; j < count; ++j )
+			{
+				contactSims[j] = oldSims[keys[j].index];
+
+				b2Contact* contact = contacts + keys[j].contactId;
+				B2_ASSERT( contact->colorIndex == i && contact->localIndex == keys[j].index );
+				contact->localIndex = j;
+			}
+
+			b2StackFree( &world->stack, oldSims );
+
+			// The narrow phase prepared this color in the old order
+			graph->changedContactColors |= 1ull << i;
+			world->sortedContactCount += count;
+		}
+
+		b2StackFree( &world->stack, keys );
+	}
+}
+
+// First fit coloring fills the low colors and leaves a tail of colors holding a few contacts. Each color
+// is a solver stage, so the workers finish a small color long before they finish a large one. This
+// moves contacts from colors above the mean count into colors below it that hold neither dynamic body.
+// The mean is rounded up to whole SIMD blocks. Empty colors stay empty so no stage is added. A contact
+// keeps to the range it was assigned from: dynamic colors for two dynamic bodies and the static colors
+// otherwise. A move takes a body out of one color and into another, so hubs keep their color count.
+// Joints are left in place. Serial and in array order, so the result is deterministic.
+void b2BalanceGraphColors( b2World* world )
+{
+	b2ConstraintGraph* graph = &world->constraintGraph;
+	b2Contact* contacts = world->contacts.data;
+	b2Body* bodies = world->bodies.data;
+
+	int totalCount = 0;
+	int activeCount = 0;
+	for ( int i = 0; i < graph->colorCount - 1; ++i )
+	{
+		int count = graph->colors[i].contactSims.count;
+		totalCount += count;
+		activeCount += count > 0 ? 1 : 0;
+	}
+
+	if ( activeCount < 2 )
+	{
+		return;
+	}
+
+	int targetCount = ( totalCount + activeCount - 1 ) / activeCount;
+	targetCount = B2_SIMD_WIDTH * ( ( targetCount + B2_SIMD_WIDTH - 1 ) / B2_SIMD_WIDTH );
+
+	for ( int i = 0; i < graph->colorCount - 1; ++i )
+	{
+		b2GraphColor* source = graph->colors + i;
+
+		// Walking backwards, a contact swapped into a removed slot has already been tried
+		for ( int j = source->contactSims.count - 1; j >= 0 && source->contactSims.count > targetCount; --j )
+		{
+			b2ContactSim* contactSim = source->contactSims.data + j;
+			b2Contact* contact = contacts + contactSim->contactId;
+			B2_ASSERT( contact->colorIndex == i && contact->localIndex == j );
+
+			int bodyIdA = contact->edges[0].bodyId;
+			int bodyIdB = contact->edges[1].bodyId;
+			bool dynamicA = bodies[bodyIdA].type == b2_dynamicBody;
+			bool dynamicB = bodies[bodyIdB].type == b2_dynamicBody;
+
+			int lower = dynamicA && dynamicB ? 0 : 1;
+			int upper = dynamicA && dynamicB ? graph->dynamicColorCount : graph->colorCount - 1;
+
+			int bestIndex = B2_NULL_INDEX;
+			int bestCount = targetCount;
+			for ( int k = lower; k < upper; ++k )
+			{
+				b2GraphColor* color = graph->colors + k;
+				int count = color->contactSims.count;
+				if ( count == 0 || count >= bestCount )
+				{
+					continue;
+				}
+
+				if ( ( dynamicA && b2GetBit( &color->bodySet, bodyIdA ) ) || ( dynamicB && b2GetBit( &color->bodySet, bodyIdB ) ) )
+				{
+					continue;
+				}
+
+				bestIndex = k;
+				bestCount = count;
+			}
+
+			if ( bestIndex == B2_NULL_INDEX )
+			{
+				continue;
+			}
+
+			b2GraphColor* target = graph->colors + bestIndex;
+			if ( dynamicA )
+			{
+				b2ClearBit( &source->bodySet, bodyIdA );
+				b2SetBitGrow( &target->bodySet, bodyIdA );
+			}
+
+			if ( dynamicB )
+			{
+				b2ClearBit( &source->bodySet, bodyIdB );
+				b2SetBitGrow( &target->bodySet, bodyIdB );
+			}
+
+			contact->colorIndex = bestIndex;
+			contact->localIndex = target->contactSims.count;
+			b2Array_Push( target->contactSims, *contactSim );
+
+			int movedIndex = b2Array_RemoveSwap( source->contactSims, j );
+			if ( movedIndex != B2_NULL_INDEX )
+			{
+				b2Contact* movedContact = contacts + source->contactSims.data[j].contactId;
+				B2_ASSERT( movedContact->colorIndex == i && movedContact->localIndex == movedIndex );
+				movedContact->localIndex = j;
+			}
+
+			// The narrow phase prepared both colors with their old contacts
+			graph->changedContactColors |= ( 1ull << i ) | ( 1ull << bestIndex );
+			world->balancedContactCount += 1;
+		}
+	}
+}
+
 // Notice that a joint cannot share the same color as a contact between the same two bodies. This means I can solve contacts and
 // joints in parallel with each other within each color.
 static int b2AssignJointColor( b2ConstraintGraph* graph, int bodyIdA, int bodyIdB, b2BodyType typeA, b2BodyType typeB )
@@ -221,7 +585,7 @@ static int b2AssignJointColor( b2ConstraintGraph* graph, int bodyIdA, int bodyId
 	if ( typeA == b2_dynamicBody && typeB == b2_dynamicBody )
 	{
 		// Dynamic constraint colors cannot encroach on colors reserved for static constraints
-		for ( int i = 0; i < B2_DYNAMIC_COLOR_COUNT; ++i )
+		for ( int i = 0; i < graph->dynamicColorCount; ++i )
 		{
 			b2GraphColor* color = graph->colors + i;
 			if ( b2GetBit( &color->bodySet, bodyIdA ) || b2GetBit( &color->bodySet, bodyIdB ) )
@@ -237,7 +601,7 @@ static int b2AssignJointColor( b2ConstraintGraph* graph, int bodyIdA, int bodyId
 	else if ( typeA == b2_dynamicBody )
 	{
 		// Static constraint colors build from the end to get higher priority than dyn-dyn constraints
-		for ( int i = B2_OVERFLOW_INDEX - 1; i >= 1; --i )
+		for ( int i = graph->colorCount - 2; i >= 1; --i )
 		{
 			b2GraphColor* color = graph->colors + i;
 			if ( b2GetBit( &color->bodySet, bodyIdA ) )
@@ -252,7 +616,7 @@ static int b2AssignJointColor( b2ConstraintGraph* graph, int bodyIdA, int bodyId
 	else if ( typeB == b2_dynamicBody )
 	{
 		// Static constraint colors build from the end to get higher priority than dyn-dyn constraints
-		for ( int i = B2_OVERFLOW_INDEX - 1; i >= 1; --i )
+		for ( int i = graph->colorCount - 2; i >= 1; --i )
 		{
 			b2GraphColor* color = graph->colors + i;
 			if ( b2GetBit( &color->bodySet, bodyIdB ) )
@@ -296,6 +660,44 @@ void b2AddJointToGraph( b2World* world, b2JointSim* jointSim, b2Joint* joint )
 	memcpy( jointDst, jointSim, sizeof( b2JointSim ) );
 }
 
+// Bulk version of b2AddJointToGraph, see b2AddContactsToGraph
+void b2AddJointsToGraph( b2World* world, b2JointSim* jointSims, int count )
+{
+	b2ConstraintGraph* graph = &world->constraintGraph;
+	int colorCounts[B2_GRAPH_COLOR_COUNT] = { 0 };
+
+	for ( int i = 0; i < count; ++i )
+	{
+		b2Joint* joint = b2Array_Get( world->joints, jointSims[i].jointId );
+		int bodyIdA = joint->edges[0].bodyId;
+		int bodyIdB = joint->edges[1].bodyId;
+		b2Body* bodyA = b2Array_Get( world->bodies, bodyIdA );
+		b2Body* bodyB = b2Array_Get( world->bodies, bodyIdB );
+
+		int colorIndex = b2AssignJointColor( graph, bodyIdA, bodyIdB, bodyA->type, bodyB->type );
+		joint->colorIndex = colorIndex;
+		colorCounts[colorIndex] += 1;
+	}
+
+	for ( int i = 0; i < B2_GRAPH_COLOR_COUNT; ++i )
+	{
+		if ( colorCounts[i] > 0 )
+		{
+			b2GraphColor* color = graph->colors + i;
+			b2Array_ReserveGrow( color->jointSims, color->jointSims.count + colorCounts[i] );
+		}
+	}
+
+	for ( int i = 0; i < count; ++i )
+	{
+		b2Joint* joint = world->joints.data + jointSims[i].jointId;
+		b2GraphColor* color = graph->colors + joint->colorIndex;
+		joint->localIndex = color->jointSims.count;
+		b2JointSim* jointDst = b2Array_Emplace( color->jointSims );
+		memcpy( jointDst, jointSims + i, sizeof( b2JointSim ) );
+	}
+}
+
 void b2RemoveJointFromGraph( b2World* world, int bodyIdA, int bodyIdB, int colorIndex, int localIndex )
 {
 	b2ConstraintGraph* graph = &world->constraintGraph;
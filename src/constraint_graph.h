@@ -23,6 +23,12 @@ typedef struct b2World b2World;
 // involving a dynamic and static bodies. This reduces tunneling due to push through.
 #define B2_DYNAMIC_COLOR_COUNT ( B2_GRAPH_COLOR_COUNT - 4 )
 
+// Steps between color balancing passes, see b2WorldDef::enableColorBalancing
+#define B2_COLOR_BALANCE_INTERVAL 8
+
+// The smallest color count a world can use, including the overflow color. This leaves two dynamic colors.
+#define B2_MIN_GRAPH_COLOR_COUNT 6
+
 typedef struct b2GraphColor
 {
 	// This bitset is indexed by bodyId so this is over-sized to encompass static bodies
@@ -48,20 +54,47 @@ typedef struct b2GraphColor
 
 	int wideConstraintCount;
 
+	// transient joint partition, see joint_solver.h
+	b2JointSim** scalarJoints;
+	int scalarJointCount;
+	struct b2JointConstraintWide* wideJoints;
+	int wideJointCount;
+
 } b2GraphColor;
 
 typedef struct b2ConstraintGraph
 {
 	// including overflow at the end
 	b2GraphColor colors[B2_GRAPH_COLOR_COUNT];
+
+	// Number of colors in use, including overflow. The overflow color always lives at B2_OVERFLOW_INDEX
+	// so colors in the range [colorCount - 1, B2_OVERFLOW_INDEX) stay empty.
+	int colorCount;
+	int dynamicColorCount;
+
+	// Adaptive coloring sends the constraints of hub bodies that already occupy this many colors
+	// to the overflow color, where they are solved with mass splitting. Zero when disabled.
+	int hubColorLimit;
+
+	// One bit per color whose contact array changed since the narrow phase gathered the contacts. The
+	// solver prepares these colors again, see b2FusedPrepare.
+	uint64_t changedContactColors;
 } b2ConstraintGraph;
 
-void b2CreateGraph( b2ConstraintGraph* graph, const b2Capacity* capacity );
+void b2CreateGraph( b2ConstraintGraph* graph, const b2Capacity* capacity, int colorCount, bool enableAdaptiveColoring );
 void b2DestroyGraph( b2ConstraintGraph* graph );
 
 void b2AddContactToGraph( b2World* world, b2ContactSim* contactSim, b2Contact* contact );
+void b2AddContactsToGraph( b2World* world, b2ContactSim* contactSims, int count );
+
+// Bulk version of b2AddContactToGraph for contacts that started touching in the same step. The
+// contact sims are copied from the awake set at the source indices and left there.
+void b2AddTouchingContactsToGraph( b2World* world, const int* contactIds, const int* sourceIndices, int count );
 void b2RemoveContactFromGraph( b2World* world, int bodyIdA, int bodyIdB, int colorIndex, int localIndex );
+void b2SortGraphContacts( b2World* world );
+void b2BalanceGraphColors( b2World* world );
 
 b2JointSim* b2CreateJointInGraph( b2World* world, b2Joint* joint );
 void b2AddJointToGraph( b2World* world, b2JointSim* jointSim, b2Joint* joint );
+void b2AddJointsToGraph( b2World* world, b2JointSim* jointSims, int count );
 void b2RemoveJointFromGraph( b2World* world, int bodyIdA, int bodyIdB, int colorIndex, int localIndex );
@@ -6,6 +6,8 @@
 #include "body.h"
 #include "core.h"
 #include "island.h"
+#include "manifold.h"
+#include "manifold_wide.h"
 #include "physics_world.h"
 #include "shape.h"
 #include "solver_set.h"
@@ -62,7 +64,6 @@ b2ContactData b2Contact_GetData( b2ContactId contactId )
 {
 	b2World* world = b2GetWorld( contactId.world0 );
 	b2Contact* contact = b2GetContactFullId( world, contactId );
-	b2ContactSim* contactSim = b2GetContactSim( world, contact );
 	const b2Shape* shapeA = b2Array_Get( world->shapes,contact->shapeIdA );
 	const b2Shape* shapeB = b2Array_Get( world->shapes,contact->shapeIdB );
 
@@ -80,7 +81,7 @@ b2ContactData b2Contact_GetData( b2ContactId contactId )
 				.world0 = (uint16_t)contactId.world0,
 				.generation = shapeB->generation,
 			},
-		.manifold = contactSim->manifold,
+		.manifold = b2GetContactManifold( world, contact ),
 	};
 
 	return data;
@@ -136,8 +137,7 @@ static b2Manifold b2PolygonAndCapsuleManifold( const b2Shape* shapeA, b2Transfor
 static b2Manifold b2PolygonManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB, b2Transform xfB,
 									 b2SimplexCache* cache )
 {
-	B2_UNUSED( cache );
-	return b2CollidePolygons( &shapeA->polygon, xfA, &shapeB->polygon, xfB );
+	return b2CollidePolygonsCached( &shapeA->polygon, xfA, &shapeB->polygon, xfB, cache );
 }
 
 static b2Manifold b2SegmentAndCircleManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB, b2Transform xfB,
@@ -157,8 +157,7 @@ static b2Manifold b2SegmentAndCapsuleManifold( const b2Shape* shapeA, b2Transfor
 static b2Manifold b2SegmentAndPolygonManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB, b2Transform xfB,
 											   b2SimplexCache* cache )
 {
-	B2_UNUSED( cache );
-	return b2CollideSegmentAndPolygon( &shapeA->segment, xfA, &shapeB->polygon, xfB );
+	return b2CollideSegmentAndPolygonCached( &shapeA->segment, xfA, &shapeB->polygon, xfB, cache );
 }
 
 static b2Manifold b2ChainSegmentAndCircleManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB, b2Transform xfB,
@@ -180,6 +179,134 @@ static b2Manifold b2ChainSegmentAndPolygonManifold( const b2Shape* shapeA, b2Tra
 	return b2CollideChainSegmentAndPolygon( &shapeA->chainSegment, xfA, &shapeB->polygon, xfB, cache );
 }
 
+static b2Manifold b2CompoundAndCircleManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB, b2Transform xfB,
+											   b2SimplexCache* cache )
+{
+	B2_UNUSED( cache );
+	return b2CollideCompoundAndCircle( shapeA->compound, xfA, &shapeB->circle, xfB );
+}
+
+static b2Manifold b2CompoundAndCapsuleManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB, b2Transform xfB,
+												b2SimplexCache* cache )
+{
+	B2_UNUSED( cache );
+	return b2CollideCompoundAndCapsule( shapeA->compound, xfA, &shapeB->capsule, xfB );
+}
+
+static b2Manifold b2CompoundAndPolygonManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB, b2Transform xfB,
+												b2SimplexCache* cache )
+{
+	B2_UNUSED( cache );
+	return b2CollideCompoundAndPolygon( shapeA->compound, xfA, &shapeB->polygon, xfB );
+}
+
+static b2Manifold b2CompoundManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB, b2Transform xfB,
+									  b2SimplexCache* cache )
+{
+	B2_UNUSED( cache );
+	return b2CollideCompounds( shapeA->compound, xfA, shapeB->compound, xfB );
+}
+
+static b2Manifold b2SegmentAndCompoundManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB, b2Transform xfB,
+												b2SimplexCache* cache )
+{
+	B2_UNUSED( cache );
+	return b2CollideSegmentAndCompound( &shapeA->segment, xfA, shapeB->compound, xfB );
+}
+
+static b2Manifold b2ChainSegmentAndCompoundManifold( const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB,
+													 b2Transform xfB, b2SimplexCache* cache )
+{
+	B2_UNUSED( cache );
+	return b2CollideChainSegmentAndCompound( &shapeA->chainSegment, xfA, shapeB->compound, xfB );
+}
+
+// Every shape pair that has a manifold function, in primary order. This generates both the register
+// table and the manifold dispatch switch.
+#define B2_MANIFOLD_PAIRS( X )                                                                                                   \
+	X( b2CircleManifold, b2_circleShape, b2_circleShape )                                                                        \
+	X( b2CapsuleAndCircleManifold, b2_capsuleShape, b2_circleShape )                                                             \
+	X( b2CapsuleManifold, b2_capsuleShape, b2_capsuleShape )                                                                     \
+	X( b2PolygonAndCircleManifold, b2_polygonShape, b2_circleShape )                                                             \
+	X( b2PolygonAndCapsuleManifold, b2_polygonShape, b2_capsuleShape )                                                           \
+	X( b2PolygonManifold, b2_polygonShape, b2_polygonShape )                                                                     \
+	X( b2SegmentAndCircleManifold, b2_segmentShape, b2_circleShape )                                                             \
+	X( b2SegmentAndCapsuleManifold, b2_segmentShape, b2_capsuleShape )                                                           \
+	X( b2SegmentAndPolygonManifold, b2_segmentShape, b2_polygonShape )                                                           \
+	X( b2ChainSegmentAndCircleManifold, b2_chainSegmentShape, b2_circleShape )                                                   \
+	X( b2ChainSegmentAndCapsuleManifold, b2_chainSegmentShape, b2_capsuleShape )                                                 \
+	X( b2ChainSegmentAndPolygonManifold, b2_chainSegmentShape, b2_polygonShape )                                                 \
+	X( b2CompoundAndCircleManifold, b2_compoundShape, b2_circleShape )                                                           \
+	X( b2CompoundAndCapsuleManifold, b2_compoundShape, b2_capsuleShape )                                                         \
+	X( b2CompoundAndPolygonManifold, b2_compoundShape, b2_polygonShape )                                                         \
+	X( b2CompoundManifold, b2_compoundShape, b2_compoundShape )                                                                  \
+	X( b2SegmentAndCompoundManifold, b2_segmentShape, b2_compoundShape )                                                         \
+	X( b2ChainSegmentAndCompoundManifold, b2_chainSegmentShape, b2_compoundShape )
+
+// Switch dispatch on the shape pair type. The manifold wrappers are static so the compiler can inline
+// them here, which avoids an indirect call per contact in the collide loop.
+static b2Manifold b2ComputeManifold( int pairType, const b2Shape* shapeA, b2Transform xfA, const b2Shape* shapeB,
+									 b2Transform xfB, b2SimplexCache* cache )
+{
+	switch ( pairType )
+	{
+#define B2_MANIFOLD_CASE( fcn, type1, type2 )                                                                                    \
+	case B2_SHAPE_PAIR_TYPE( type1, type2 ):                                                                                     \
+		return fcn( shapeA, xfA, shapeB, xfB, cache );
+		B2_MANIFOLD_PAIRS( B2_MANIFOLD_CASE )
+#undef B2_MANIFOLD_CASE
+
+		default:
+			B2_ASSERT( false );
+			return (b2Manifold){ 0 };
+	}
+}
+
+static void b2CircleManifoldWide( b2Shape* const* shapesA, const b2Transform* xfsA, b2Shape* const* shapesB,
+								  const b2Transform* xfsB, int count, b2Manifold* manifolds )
+{
+	const b2Circle* circlesA[B2_SIMD_WIDTH];
+	const b2Circle* circlesB[B2_SIMD_WIDTH];
+	for ( int i = 0; i < count; ++i )
+	{
+		circlesA[i] = &shapesA[i]->circle;
+		circlesB[i] = &shapesB[i]->circle;
+	}
+
+	b2CollideCirclesWide( circlesA, xfsA, circlesB, xfsB, count, manifolds );
+}
+
+static void b2CapsuleAndCircleManifoldWide( b2Shape* const* shapesA, const b2Transform* xfsA, b2Shape* const* shapesB,
+											const b2Transform* xfsB, int count, b2Manifold* manifolds )
+{
+	const b2Capsule* capsulesA[B2_SIMD_WIDTH];
+	const b2Circle* circlesB[B2_SIMD_WIDTH];
+	for ( int i = 0; i < count; ++i )
+	{
+		capsulesA[i] = &shapesA[i]->capsule;
+		circlesB[i] = &shapesB[i]->circle;
+	}
+
+	b2CollideCapsuleAndCircleWide( capsulesA, xfsA, circlesB, xfsB, count, manifolds );
+}
+
+static void b2CapsuleManifoldWide( b2Shape* const* shapesA, const b2Transform* xfsA, b2Shape* const* shapesB,
+								   const b2Transform* xfsB, int count, b2Manifold* manifolds )
+{
+	const b2Capsule* capsulesA[B2_SIMD_WIDTH];
+	const b2Capsule* capsulesB[B2_SIMD_WIDTH];
+	for ( int i = 0; i < count; ++i )
+	{
+		capsulesA[i] = &shapesA[i]->capsule;
+		capsulesB[i] = &shapesB[i]->capsule;
+	}
+
+	b2CollideCapsulesWide( capsulesA, xfsA, capsulesB, xfsB, count, manifolds );
+}
+
+// Batched manifold functions indexed by B2_SHAPE_PAIR_TYPE. Contacts are always in primary order.
+static b2ManifoldWideFcn* s_wideRegisters[B2_SHAPE_PAIR_TYPE_COUNT];
+
 static void b2AddType( b2ManifoldFcn* fcn, b2ShapeType type1, b2ShapeType type2 )
 {
 	B2_ASSERT( 0 <= type1 && type1 < b2_shapeTypeCount );
@@ -199,18 +326,13 @@ void b2InitializeContactRegisters( void )
 {
 	if ( s_initialized == false )
 	{
-		b2AddType( b2CircleManifold, b2_circleShape, b2_circleShape );
-		b2AddType( b2CapsuleAndCircleManifold, b2_capsuleShape, b2_circleShape );
-		b2AddType( b2CapsuleManifold, b2_capsuleShape, b2_capsuleShape );
-		b2AddType( b2PolygonAndCircleManifold, b2_polygonShape, b2_circleShape );
-		b2AddType( b2PolygonAndCapsuleManifold, b2_polygonShape, b2_capsuleShape );
-		b2AddType( b2PolygonManifold, b2_polygonShape, b2_polygonShape );
-		b2AddType( b2SegmentAndCircleManifold, b2_segmentShape, b2_circleShape );
-		b2AddType( b2SegmentAndCapsuleManifold, b2_segmentShape, b2_capsuleShape );
-		b2AddType( b2SegmentAndPolygonManifold, b2_segmentShape, b2_polygonShape );
-		b2AddType( b2ChainSegmentAndCircleManifold, b2_chainSegmentShape, b2_circleShape );
-		b2AddType( b2ChainSegmentAndCapsuleManifold, b2_chainSegmentShape, b2_capsuleShape );
-		b2AddType( b2ChainSegmentAndPolygonManifold, b2_chainSegmentShape, b2_polygonShape );
+#define B2_ADD_TYPE( fcn, type1, type2 ) b2AddType( fcn, type1, type2 );
+		B2_MANIFOLD_PAIRS( B2_ADD_TYPE )
+#undef B2_ADD_TYPE
+
+		s_wideRegisters[B2_SHAPE_PAIR_TYPE( b2_circleShape, b2_circleShape )] = b2CircleManifoldWide;
+		s_wideRegisters[B2_SHAPE_PAIR_TYPE( b2_capsuleShape, b2_circleShape )] = b2CapsuleAndCircleManifoldWide;
+		s_wideRegisters[B2_SHAPE_PAIR_TYPE( b2_capsuleShape, b2_capsuleShape )] = b2CapsuleManifoldWide;
 		s_initialized = true;
 	}
 }
@@ -220,65 +342,55 @@ bool b2CanCollide( b2ShapeType typeA, b2ShapeType typeB )
 	return s_registers[typeA][typeB].fcn != NULL;
 }
 
-// WARNING: this should never fail to create a contact because the pair already exists in the pairSet.
-void b2CreateContact( b2World* world, b2Shape* shapeA, b2Shape* shapeB )
+b2ManifoldWideFcn* b2GetManifoldWideFcn( int pairType )
 {
-	b2ShapeType type1 = shapeA->type;
-	b2ShapeType type2 = shapeB->type;
-
-	B2_ASSERT( 0 <= type1 && type1 < b2_shapeTypeCount );
-	B2_ASSERT( 0 <= type2 && type2 < b2_shapeTypeCount );
-
-	if ( s_registers[type1][type2].fcn == NULL )
-	{
-		// For example, no segment vs segment collision
-		return;
-	}
+	B2_ASSERT( 0 <= pairType && pairType < B2_SHAPE_PAIR_TYPE_COUNT );
+	return s_wideRegisters[pairType];
+}
 
-	if ( s_registers[type1][type2].primary == false )
+bool b2ShouldReportContactEvents( const b2World* world, const b2Shape* shapeA, const b2Shape* shapeB )
+{
+	const b2ContactEventFilter* filter = &world->contactEventFilter;
+	if ( ( ( shapeA->filter.categoryBits | shapeB->filter.categoryBits ) & filter->categoryBits ) != 0 )
 	{
-		// flip order
-		b2CreateContact( world, shapeB, shapeA );
-		return;
+		return true;
 	}
 
-	b2Body* bodyA = b2Array_Get( world->bodies,shapeA->bodyId );
-	b2Body* bodyB = b2Array_Get( world->bodies,shapeB->bodyId );
+	uint64_t materialId = filter->userMaterialId;
+	return materialId != 0 && ( shapeA->material.userMaterialId == materialId || shapeB->material.userMaterialId == materialId );
+}
 
+// Solver set for a new contact between two bodies
+static int b2GetContactSetIndex( b2Body* bodyA, b2Body* bodyB )
+{
 	B2_ASSERT( bodyA->setIndex != b2_disabledSet && bodyB->setIndex != b2_disabledSet );
 	B2_ASSERT( bodyA->setIndex != b2_staticSet || bodyB->setIndex != b2_staticSet );
 
-	int setIndex;
-	if ( bodyA->setIndex == b2_awakeSet || bodyB->setIndex == b2_awakeSet )
+	// Contacts of kinematic set bodies are collided with the awake contacts
+	if ( b2IsMovingSet( bodyA->setIndex ) || b2IsMovingSet( bodyB->setIndex ) )
 	{
-		setIndex = b2_awakeSet;
+		return b2_awakeSet;
 	}
-	else
-	{
-		// sleeping and non-touching contacts live in the disabled set
-		// later if this set is found to be touching then the sleeping
-		// islands will be linked and the contact moved to the merged island
-		setIndex = b2_disabledSet;
-	}
-
-	b2SolverSet* set = b2Array_Get( world->solverSets,setIndex );
 
-	// Create contact key and contact
-	int contactId = b2AllocId( &world->contactIdPool );
-	if ( contactId == world->contacts.count )
-	{
-		b2Array_Push( world->contacts,(b2Contact){ 0 } );
-	}
+	// sleeping and non-touching contacts live in the disabled set
+	// later if this set is found to be touching then the sleeping
+	// islands will be linked and the contact moved to the merged island
+	return b2_disabledSet;
+}
 
+// Initialize a contact and its sim. This does not touch any shared state besides the contact slot,
+// so it can run in parallel for different contacts. The shapes must be in primary order.
+static void b2InitializeContact( b2World* world, b2Contact* contact, b2ContactSim* contactSim, b2Shape* shapeA,
+								 b2Shape* shapeB, int contactId, int setIndex )
+{
 	int shapeIdA = shapeA->id;
 	int shapeIdB = shapeB->id;
 
-	b2Contact* contact = b2Array_Get( world->contacts,contactId );
 	contact->contactId = contactId;
 	contact->generation += 1;
 	contact->setIndex = setIndex;
 	contact->colorIndex = B2_NULL_INDEX;
-	contact->localIndex = set->contactSims.count;
+	contact->localIndex = B2_NULL_INDEX;
 	contact->islandId = B2_NULL_INDEX;
 	contact->islandIndex = B2_NULL_INDEX;
 	contact->shapeIdA = shapeIdA;
@@ -288,14 +400,57 @@ void b2CreateContact( b2World* world, b2Shape* shapeA, b2Shape* shapeB )
 
 	B2_ASSERT( shapeA->sensorIndex == B2_NULL_INDEX && shapeB->sensorIndex == B2_NULL_INDEX );
 
-	if ( shapeA->enableContactEvents || shapeB->enableContactEvents )
+	if ( ( shapeA->enableContactEvents || shapeB->enableContactEvents ) && b2ShouldReportContactEvents( world, shapeA, shapeB ) )
 	{
 		contact->flags |= b2_contactEnableContactEvents;
 	}
 
+	contact->edges[0].bodyId = shapeA->bodyId;
+	contact->edges[1].bodyId = shapeB->bodyId;
+
+	contactSim->contactId = contactId;
+
+#if B2_ENABLE_VALIDATION
+	contactSim->bodyIdA = shapeA->bodyId;
+	contactSim->bodyIdB = shapeB->bodyId;
+#endif
+
+	contactSim->bodySimIndexA = B2_NULL_INDEX;
+	contactSim->bodySimIndexB = B2_NULL_INDEX;
+	contactSim->invMassA = 0.0f;
+	contactSim->invIA = 0.0f;
+	contactSim->invMassB = 0.0f;
+	contactSim->invIB = 0.0f;
+	contactSim->shapeIdA = shapeIdA;
+	contactSim->shapeIdB = shapeIdB;
+	contactSim->separationBound = 0.0f;
+	contactSim->cache = b2_emptySimplexCache;
+	contactSim->manifold = (b2Manifold){ 0 };
+
+	// These get updated in the narrow phase, but these are needed for first touch
+	contactSim->friction = world->frictionCallback( shapeA->material.friction, shapeA->material.userMaterialId,
+													shapeB->material.friction, shapeB->material.userMaterialId );
+	contactSim->restitution = world->restitutionCallback( shapeA->material.restitution, shapeA->material.userMaterialId,
+														  shapeB->material.restitution, shapeB->material.userMaterialId );
+
+	contactSim->tangentSpeed = 0.0f;
+	contactSim->simFlags = 0;
+	contactSim->pairType = (uint8_t)B2_SHAPE_PAIR_TYPE( shapeA->type, shapeB->type );
+
+	if ( shapeA->enablePreSolveEvents || shapeB->enablePreSolveEvents )
+	{
+		contactSim->simFlags |= b2_simEnablePreSolveEvents;
+	}
+}
+
+// Connect an initialized contact to the contact lists of its bodies
+static void b2AddContactToBodies( b2World* world, b2Contact* contact )
+{
+	int contactId = contact->contactId;
+
 	// Connect to body A
 	{
-		contact->edges[0].bodyId = shapeA->bodyId;
+		b2Body* bodyA = b2Array_Get( world->bodies, contact->edges[0].bodyId );
 		contact->edges[0].prevKey = B2_NULL_INDEX;
 		contact->edges[0].nextKey = bodyA->headContactKey;
 
@@ -305,14 +460,16 @@ void b2CreateContact( b2World* world, b2Shape* shapeA, b2Shape* shapeB )
 		{
 			b2Contact* headContact = b2Array_Get( world->contacts,headContactKey >> 1 );
 			headContact->edges[headContactKey & 1].prevKey = keyA;
+			b2MarkDirty( world, b2_dirtyContact, headContactKey >> 1 );
 		}
 		bodyA->headContactKey = keyA;
 		bodyA->contactCount += 1;
+		b2MarkDirty( world, b2_dirtyBody, bodyA->id );
 	}
 
 	// Connect to body B
 	{
-		contact->edges[1].bodyId = shapeB->bodyId;
+		b2Body* bodyB = b2Array_Get( world->bodies, contact->edges[1].bodyId );
 		contact->edges[1].prevKey = B2_NULL_INDEX;
 		contact->edges[1].nextKey = bodyB->headContactKey;
 
@@ -322,49 +479,160 @@ void b2CreateContact( b2World* world, b2Shape* shapeA, b2Shape* shapeB )
 		{
 			b2Contact* headContact = b2Array_Get( world->contacts,headContactKey >> 1 );
 			headContact->edges[headContactKey & 1].prevKey = keyB;
+			b2MarkDirty( world, b2_dirtyContact, headContactKey >> 1 );
 		}
 		bodyB->headContactKey = keyB;
 		bodyB->contactCount += 1;
+		b2MarkDirty( world, b2_dirtyBody, bodyB->id );
 	}
+}
 
-	// Add to pair set for fast lookup.
-	uint64_t pairKey = B2_SHAPE_PAIR_KEY( shapeIdA, shapeIdB );
-	b2AddKey( &world->broadPhase.pairSet, pairKey );
+// WARNING: this should never fail to create a contact because the pair already exists in the pairSet.
+void b2CreateContact( b2World* world, b2Shape* shapeA, b2Shape* shapeB )
+{
+	b2ShapeType type1 = shapeA->type;
+	b2ShapeType type2 = shapeB->type;
+
+	B2_ASSERT( 0 <= type1 && type1 < b2_shapeTypeCount );
+	B2_ASSERT( 0 <= type2 && type2 < b2_shapeTypeCount );
+
+	if ( s_registers[type1][type2].fcn == NULL )
+	{
+		// For example, no segment vs segment collision
+		return;
+	}
+
+	if ( s_registers[type1][type2].primary == false )
+	{
+		// flip order
+		b2CreateContact( world, shapeB, shapeA );
+		return;
+	}
+
+	b2Body* bodyA = b2Array_Get( world->bodies,shapeA->bodyId );
+	b2Body* bodyB = b2Array_Get( world->bodies,shapeB->bodyId );
+
+	int setIndex = b2GetContactSetIndex( bodyA, bodyB );
+	b2SolverSet* set = b2Array_Get( world->solverSets,setIndex );
+
+	// Create contact key and contact
+	int contactId = b2AllocId( &world->contactIdPool );
+	if ( contactId == world->contacts.count )
+	{
+		b2Array_Push( world->contacts, (b2Contact){ .generation = world->contactGenerationFloor } );
+	}
+
+	b2Contact* contact = b2Array_Get( world->contacts,contactId );
 
 	// Contacts are created as non-touching. Later if they are found to be touching
 	// they will link islands and be moved into the constraint graph.
+	int localIndex = set->contactSims.count;
 	b2ContactSim* contactSim = b2Array_Emplace( set->contactSims );
-	contactSim->contactId = contactId;
+	b2InitializeContact( world, contact, contactSim, shapeA, shapeB, contactId, setIndex );
+	contact->localIndex = localIndex;
+	b2MarkDirty( world, b2_dirtyContact, contactId );
+	b2MarkDirty( world, b2_dirtySolverSet, setIndex );
 
-#if B2_ENABLE_VALIDATION
-	contactSim->bodyIdA = shapeA->bodyId;
-	contactSim->bodyIdB = shapeB->bodyId;
-#endif
+	b2AddContactToBodies( world, contact );
 
-	contactSim->bodySimIndexA = B2_NULL_INDEX;
-	contactSim->bodySimIndexB = B2_NULL_INDEX;
-	contactSim->invMassA = 0.0f;
-	contactSim->invIA = 0.0f;
-	contactSim->invMassB = 0.0f;
-	contactSim->invIB = 0.0f;
-	contactSim->shapeIdA = shapeIdA;
-	contactSim->shapeIdB = shapeIdB;
-	contactSim->cache = b2_emptySimplexCache;
-	contactSim->manifold = (b2Manifold){ 0 };
+	// Add to pair set for fast lookup.
+	uint64_t pairKey = B2_SHAPE_PAIR_KEY( shapeA->id, shapeB->id );
+	b2AllocInfo previous = b2PushAllocTag( b2_allocTagBroadPhase, b2_allocLifetimeLong );
+	b2AddKey( &world->broadPhase.pairSet, pairKey );
+	b2PopAllocInfo( previous );
+}
 
-	// These get updated in the narrow phase, but these are needed for first touch
-	contactSim->friction = world->frictionCallback( shapeA->material.friction, shapeA->material.userMaterialId,
-													shapeB->material.friction, shapeB->material.userMaterialId );
-	contactSim->restitution = world->restitutionCallback( shapeA->material.restitution, shapeA->material.userMaterialId,
-														  shapeB->material.restitution, shapeB->material.userMaterialId );
+b2ContactSim* b2ReserveContacts( b2World* world, int* contactIds, int count )
+{
+	// Same id order as calling b2CreateContact count times
+	b2AllocIds( &world->contactIdPool, contactIds, count );
 
-	contactSim->tangentSpeed = 0.0f;
-	contactSim->simFlags = 0;
+	// Grow once instead of once per doubling
+	int idCapacity = b2GetIdCapacity( &world->contactIdPool );
+	int contactCount = world->contacts.count;
+	if ( contactCount < idCapacity )
+	{
+		b2Array_ReserveGrow( world->contacts, idCapacity );
+		b2Contact emptyContact = { .generation = world->contactGenerationFloor };
+		for ( int i = contactCount; i < idCapacity; ++i )
+		{
+			world->contacts.data[i] = emptyContact;
+		}
+		world->contacts.count = idCapacity;
+	}
 
-	if ( shapeA->enablePreSolveEvents || shapeB->enablePreSolveEvents )
+	b2AllocInfo previous = b2PushAllocTag( b2_allocTagBroadPhase, b2_allocLifetimeLong );
+	b2ReserveSet( &world->broadPhase.pairSet, count );
+	b2PopAllocInfo( previous );
+
+	// New contacts almost always go to the awake set, so their sims are written in place at its end
+	b2SolverSet* awakeSet = world->solverSets.data + b2_awakeSet;
+	int simCount = awakeSet->contactSims.count;
+	b2Array_ReserveGrow( awakeSet->contactSims, simCount + count );
+	awakeSet->contactSims.count = simCount + count;
+	return awakeSet->contactSims.data + simCount;
+}
+
+void b2CreateContactConcurrent( b2World* world, b2Shape* shapeA, b2Shape* shapeB, int contactId, b2ContactSim* contactSim )
+{
+	B2_ASSERT( b2CanCollide( shapeA->type, shapeB->type ) );
+
+	if ( s_registers[shapeA->type][shapeB->type].primary == false )
 	{
-		contactSim->simFlags |= b2_simEnablePreSolveEvents;
+		b2Shape* tmp = shapeA;
+		shapeA = shapeB;
+		shapeB = tmp;
 	}
+
+	b2Body* bodyA = world->bodies.data + shapeA->bodyId;
+	b2Body* bodyB = world->bodies.data + shapeB->bodyId;
+	int setIndex = b2GetContactSetIndex( bodyA, bodyB );
+
+	b2Contact* contact = world->contacts.data + contactId;
+	b2InitializeContact( world, contact, contactSim, shapeA, shapeB, contactId, setIndex );
+
+	uint64_t pairKey = B2_SHAPE_PAIR_KEY( shapeA->id, shapeB->id );
+	bool alreadyAdded = b2AddKeyConcurrent( &world->broadPhase.pairSet, pairKey );
+	B2_ASSERT( alreadyAdded == false );
+	B2_UNUSED( alreadyAdded );
+}
+
+void b2CommitContacts( b2World* world, const int* contactIds, int count )
+{
+	b2SolverSet* awakeSet = world->solverSets.data + b2_awakeSet;
+	int baseIndex = awakeSet->contactSims.count - count;
+	b2ContactSim* contactSims = awakeSet->contactSims.data + baseIndex;
+
+	// Sims of the disabled set are moved out of the awake slab and the rest close the gaps
+	int awakeIndex = baseIndex;
+	for ( int i = 0; i < count; ++i )
+	{
+		b2Contact* contact = world->contacts.data + contactIds[i];
+		if ( contact->setIndex == b2_awakeSet )
+		{
+			if ( awakeIndex != baseIndex + i )
+			{
+				awakeSet->contactSims.data[awakeIndex] = contactSims[i];
+			}
+
+			contact->localIndex = awakeIndex;
+			awakeIndex += 1;
+		}
+		else
+		{
+			b2SolverSet* set = world->solverSets.data + contact->setIndex;
+			contact->localIndex = set->contactSims.count;
+			b2Array_Push( set->contactSims, contactSims[i] );
+		}
+
+		b2MarkDirty( world, b2_dirtyContact, contactIds[i] );
+		b2MarkDirty( world, b2_dirtySolverSet, contact->setIndex );
+
+		b2AddContactToBodies( world, contact );
+	}
+
+	awakeSet->contactSims.count = awakeIndex;
+	world->broadPhase.pairSet.count += count;
 }
 
 // A contact is destroyed when:
@@ -388,6 +656,24 @@ void b2DestroyContact( b2World* world, b2Contact* contact, bool wakeBodies )
 	b2Body* bodyA = b2Array_Get( world->bodies,bodyIdA );
 	b2Body* bodyB = b2Array_Get( world->bodies,bodyIdB );
 
+	b2MarkDirty( world, b2_dirtyContact, contact->contactId );
+	b2MarkDirty( world, b2_dirtySolverSet, contact->setIndex );
+	b2MarkDirty( world, b2_dirtyBody, bodyIdA );
+	b2MarkDirty( world, b2_dirtyBody, bodyIdB );
+	for ( int i = 0; i < 2; ++i )
+	{
+		b2ContactEdge* edge = contact->edges + i;
+		if ( edge->prevKey != B2_NULL_INDEX )
+		{
+			b2MarkDirty( world, b2_dirtyContact, edge->prevKey >> 1 );
+		}
+
+		if ( edge->nextKey != B2_NULL_INDEX )
+		{
+			b2MarkDirty( world, b2_dirtyContact, edge->nextKey >> 1 );
+		}
+	}
+
 	uint32_t flags = contact->flags;
 	bool touching = ( flags & b2_contactTouchingFlag ) != 0;
 
@@ -413,7 +699,9 @@ void b2DestroyContact( b2World* world, b2Contact* contact, bool wakeBodies )
 			.contactId = contactId,
 		};
 
-		b2Array_Push( world->contactEndEvents[world->endEventArrayIndex],event );
+		b2AllocInfo previous = b2PushAllocTag( b2_allocTagEvents, b2_allocLifetimeLong );
+		b2Array_Push( world->contactEndEvents[world->endEventArrayIndex], event );
+		b2PopAllocInfo( previous );
 	}
 
 	// Remove from body A
@@ -482,12 +770,25 @@ void b2DestroyContact( b2World* world, b2Contact* contact, bool wakeBodies )
 		B2_ASSERT( contact->setIndex != b2_awakeSet || ( contact->flags & b2_contactTouchingFlag ) == 0 );
 		b2SolverSet* set = b2Array_Get( world->solverSets,contact->setIndex );
 
-		int movedIndex = b2Array_RemoveSwap( set->contactSims,contact->localIndex );
-		if ( movedIndex != B2_NULL_INDEX )
+		if ( b2IsCompactContactSet( world, contact->setIndex ) )
+		{
+			int movedIndex = b2Array_RemoveSwap( set->compactContactSims, contact->localIndex );
+			if ( movedIndex != B2_NULL_INDEX )
+			{
+				b2CompactContactSim* movedContactSim = set->compactContactSims.data + contact->localIndex;
+				b2Contact* movedContact = b2Array_Get( world->contacts, movedContactSim->contactId );
+				movedContact->localIndex = contact->localIndex;
+			}
+		}
+		else
 		{
-			b2ContactSim* movedContactSim = set->contactSims.data + contact->localIndex;
-			b2Contact* movedContact = b2Array_Get( world->contacts,movedContactSim->contactId );
-			movedContact->localIndex = contact->localIndex;
+			int movedIndex = b2Array_RemoveSwap( set->contactSims,contact->localIndex );
+			if ( movedIndex != B2_NULL_INDEX )
+			{
+				b2ContactSim* movedContactSim = set->contactSims.data + contact->localIndex;
+				b2Contact* movedContact = b2Array_Get( world->contacts,movedContactSim->contactId );
+				movedContact->localIndex = contact->localIndex;
+			}
 		}
 	}
 
@@ -507,6 +808,8 @@ void b2DestroyContact( b2World* world, b2Contact* contact, bool wakeBodies )
 
 b2ContactSim* b2GetContactSim( b2World* world, b2Contact* contact )
 {
+	B2_ASSERT( b2IsCompactContactSet( world, contact->setIndex ) == false );
+
 	if ( contact->setIndex == b2_awakeSet && contact->colorIndex != B2_NULL_INDEX )
 	{
 		// contact lives in constraint graph
@@ -519,6 +822,189 @@ b2ContactSim* b2GetContactSim( b2World* world, b2Contact* contact )
 	return b2Array_Get( set->contactSims,contact->localIndex );
 }
 
+b2Manifold b2GetContactManifold( b2World* world, b2Contact* contact )
+{
+	if ( b2IsCompactContactSet( world, contact->setIndex ) )
+	{
+		b2SolverSet* set = b2Array_Get( world->solverSets, contact->setIndex );
+		b2ContactSim contactSim;
+		b2ExpandContactSim( world, &contactSim, b2Array_Get( set->compactContactSims, contact->localIndex ) );
+		return contactSim.manifold;
+	}
+
+	return b2GetContactSim( world, contact )->manifold;
+}
+
+bool b2IsCompactContactSet( const b2World* world, int setIndex )
+{
+	return world->solverSets.data[setIndex].isCompact;
+}
+
+// IEEE half float rounded to nearest. Values beyond the half range are clamped.
+static uint16_t b2FloatToHalf( float value )
+{
+	union
+	{
+		float f;
+		uint32_t u;
+	} bits = { value };
+
+	uint16_t sign = (uint16_t)( ( bits.u >> 16 ) & 0x8000 );
+	float magnitude = b2AbsFloat( value );
+	if ( magnitude >= 65504.0f )
+	{
+		return sign | 0x7BFF;
+	}
+
+	if ( magnitude < 6.103515625e-05f )
+	{
+		// Subnormal, in units of 2^-24
+		return sign | (uint16_t)( magnitude * 16777216.0f + 0.5f );
+	}
+
+	// Rebias the exponent and round the mantissa to 10 bits, ties to even
+	uint32_t u = bits.u & 0x7FFFFFFF;
+	u = u - ( ( 127 - 15 ) << 23 ) + 0xFFF + ( ( u >> 13 ) & 1 );
+	return sign | (uint16_t)( u >> 13 );
+}
+
+static float b2HalfToFloat( uint16_t value )
+{
+	uint32_t exponent = ( value >> 10 ) & 0x1F;
+	uint32_t mantissa = value & 0x3FF;
+
+	union
+	{
+		uint32_t u;
+		float f;
+	} bits;
+
+	if ( exponent == 0 )
+	{
+		bits.f = (float)mantissa * 5.9604644775390625e-08f;
+	}
+	else
+	{
+		bits.u = ( ( exponent + 127 - 15 ) << 23 ) | ( mantissa << 13 );
+	}
+
+	return ( value & 0x8000 ) != 0 ? -bits.f : bits.f;
+}
+
+void b2CompressContactSim( b2CompactContactSim* dst, const b2ContactSim* src )
+{
+	const b2Manifold* manifold = &src->manifold;
+	B2_ASSERT( 0 < manifold->pointCount && manifold->pointCount <= 2 );
+
+	*dst = ( b2CompactContactSim ){
+		.contactId = src->contactId,
+#if B2_ENABLE_VALIDATION
+		.bodyIdA = src->bodyIdA,
+		.bodyIdB = src->bodyIdB,
+#endif
+		.shapeIdA = src->shapeIdA,
+		.shapeIdB = src->shapeIdB,
+		.friction = src->friction,
+		.restitution = src->restitution,
+		.rollingResistance = src->rollingResistance,
+		.tangentSpeed = src->tangentSpeed,
+		.simFlags = src->simFlags,
+		.cache = src->cache,
+		.normal = { b2FloatToHalf( manifold->normal.x ), b2FloatToHalf( manifold->normal.y ) },
+		.rollingImpulse = b2FloatToHalf( manifold->rollingImpulse ),
+		.pointCount = (uint8_t)manifold->pointCount,
+		.pairType = src->pairType,
+	};
+
+	for ( int i = 0; i < manifold->pointCount; ++i )
+	{
+		const b2ManifoldPoint* mp = manifold->points + i;
+		dst->normalImpulses[i] = b2FloatToHalf( mp->normalImpulse );
+		dst->tangentImpulses[i] = b2FloatToHalf( mp->tangentImpulse );
+		dst->ids[i] = mp->id;
+	}
+}
+
+void b2ExpandContactSim( b2World* world, b2ContactSim* dst, const b2CompactContactSim* src )
+{
+	b2Shape* shapeA = b2Array_Get( world->shapes, src->shapeIdA );
+	b2Shape* shapeB = b2Array_Get( world->shapes, src->shapeIdB );
+	b2BodySim* bodySimA = b2GetBodySim( world, b2Array_Get( world->bodies, shapeA->bodyId ) );
+	b2BodySim* bodySimB = b2GetBodySim( world, b2Array_Get( world->bodies, shapeB->bodyId ) );
+	b2Transform transformA = bodySimA->transform;
+	b2Transform transformB = bodySimB->transform;
+
+	*dst = ( b2ContactSim ){
+		.contactId = src->contactId,
+		.cachedTransformA = transformA,
+		.cachedTransformB = transformB,
+#if B2_ENABLE_VALIDATION
+		.bodyIdA = src->bodyIdA,
+		.bodyIdB = src->bodyIdB,
+#endif
+		.bodySimIndexA = B2_NULL_INDEX,
+		.bodySimIndexB = B2_NULL_INDEX,
+		.shapeIdA = src->shapeIdA,
+		.shapeIdB = src->shapeIdB,
+		.invMassA = bodySimA->invMass,
+		.invIA = bodySimA->invInertia,
+		.invMassB = bodySimB->invMass,
+		.invIB = bodySimB->invInertia,
+		.friction = src->friction,
+		.restitution = src->restitution,
+		.rollingResistance = src->rollingResistance,
+		.tangentSpeed = src->tangentSpeed,
+		.simFlags = src->simFlags | b2_simRelativeTransformValid,
+		.pairType = src->pairType,
+		.cache = src->cache,
+	};
+
+	b2Manifold* manifold = &dst->manifold;
+	*manifold = b2ComputeManifold( src->pairType, shapeA, transformA, shapeB, transformB, &dst->cache );
+
+	if ( manifold->pointCount == 0 )
+	{
+		// The shapes moved apart while asleep, for example because a static body was moved. The
+		// contact is still touching until the next collide, so keep points that are too far apart
+		// for the solver to apply an impulse.
+		manifold->normal = b2Normalize( ( b2Vec2 ){ b2HalfToFloat( src->normal[0] ), b2HalfToFloat( src->normal[1] ) } );
+		manifold->pointCount = src->pointCount;
+		for ( int i = 0; i < src->pointCount; ++i )
+		{
+			b2ManifoldPoint* mp = manifold->points + i;
+			mp->clipPoint = bodySimA->center;
+			mp->separation = B2_HUGE;
+			mp->baseSeparation = B2_HUGE;
+			mp->id = src->ids[i];
+		}
+
+		return;
+	}
+
+	b2Vec2 centerOffsetA = b2RotateVector( transformA.q, bodySimA->localCenter );
+	b2Vec2 centerOffsetB = b2RotateVector( transformB.q, bodySimB->localCenter );
+	manifold->rollingImpulse = b2HalfToFloat( src->rollingImpulse );
+
+	for ( int i = 0; i < manifold->pointCount; ++i )
+	{
+		b2ManifoldPoint* mp = manifold->points + i;
+		mp->anchorA = b2Sub( mp->anchorA, centerOffsetA );
+		mp->anchorB = b2Sub( mp->anchorB, centerOffsetB );
+		mp->baseSeparation = mp->separation;
+
+		for ( int j = 0; j < src->pointCount; ++j )
+		{
+			if ( src->ids[j] == mp->id )
+			{
+				mp->normalImpulse = b2HalfToFloat( src->normalImpulses[j] );
+				mp->tangentImpulse = b2HalfToFloat( src->tangentImpulses[j] );
+				mp->persisted = true;
+				break;
+			}
+		}
+	}
+}
+
 // Update the contact manifold and touching status.
 // Note: do not assume the shape AABBs are overlapping or are valid.
 bool b2UpdateContact( b2World* world, b2ContactSim* contactSim, b2Shape* shapeA, b2Transform transformA, b2Vec2 centerOffsetA,
@@ -528,9 +1014,73 @@ bool b2UpdateContact( b2World* world, b2ContactSim* contactSim, b2Shape* shapeA,
 	b2Manifold oldManifold = contactSim->manifold;
 
 	// Compute new manifold
-	b2ManifoldFcn* fcn = s_registers[shapeA->type][shapeB->type].fcn;
-	contactSim->manifold = fcn( shapeA, transformA, shapeB, transformB, &contactSim->cache );
+	B2_ASSERT( contactSim->pairType == B2_SHAPE_PAIR_TYPE( shapeA->type, shapeB->type ) );
+	contactSim->manifold =
+		b2ComputeManifold( contactSim->pairType, shapeA, transformA, shapeB, transformB, &contactSim->cache );
+
+	return b2FinishContactUpdate( world, contactSim, &oldManifold, shapeA, centerOffsetA, shapeB, centerOffsetB );
+}
+
+bool b2IsCachedAxisSeparated( const b2ContactSim* contactSim )
+{
+	int pairType = contactSim->pairType;
+	bool usesCachedAxis = pairType == B2_SHAPE_PAIR_TYPE( b2_polygonShape, b2_polygonShape ) ||
+						  pairType == B2_SHAPE_PAIR_TYPE( b2_segmentShape, b2_polygonShape );
+	return usesCachedAxis && contactSim->cache.count == 2;
+}
+
+static b2Vec2 b2GetDeepestPoint( const b2Manifold* manifold )
+{
+	float bestSeparation = manifold->points[0].separation;
+	b2Vec2 bestPoint = manifold->points[0].clipPoint;
+
+	for ( int i = 1; i < manifold->pointCount; ++i )
+	{
+		float separation = manifold->points[i].separation;
+		if ( separation < bestSeparation )
+		{
+			bestSeparation = separation;
+			bestPoint = manifold->points[i].clipPoint;
+		}
+	}
+
+	return bestPoint;
+}
 
+b2PreSolveContact b2MakePreSolveContact( const b2World* world, const b2ContactSim* contactSim, const b2Shape* shapeA,
+										 const b2Shape* shapeB )
+{
+	B2_ASSERT( contactSim->manifold.pointCount > 0 );
+	return (b2PreSolveContact){
+		.pair = b2MakeShapePair( world, shapeA, shapeB ),
+		.point = b2GetDeepestPoint( &contactSim->manifold ),
+		.normal = contactSim->manifold.normal,
+	};
+}
+
+bool b2PreSolveShapes( b2World* world, const b2Shape* shapeA, const b2Shape* shapeB, b2Vec2 point, b2Vec2 normal )
+{
+	if ( world->preSolveBatchFcn != NULL )
+	{
+		b2PreSolveContact contact = { b2MakeShapePair( world, shapeA, shapeB ), point, normal };
+		bool result = true;
+		world->preSolveBatchFcn( &contact, &result, 1, world->preSolveBatchContext );
+		return result;
+	}
+
+	if ( world->preSolveFcn != NULL )
+	{
+		b2ShapeId shapeIdA = { shapeA->id + 1, world->worldId, shapeA->generation };
+		b2ShapeId shapeIdB = { shapeB->id + 1, world->worldId, shapeB->generation };
+		return world->preSolveFcn( shapeIdA, shapeIdB, point, normal, world->preSolveContext );
+	}
+
+	return true;
+}
+
+bool b2FinishContactUpdate( b2World* world, b2ContactSim* contactSim, b2Manifold* oldManifold, b2Shape* shapeA,
+							b2Vec2 centerOffsetA, b2Shape* shapeB, b2Vec2 centerOffsetB )
+{
 	// Keep these updated in case the values on the shapes are modified
 	contactSim->friction = world->frictionCallback( shapeA->material.friction, shapeA->material.userMaterialId,
 													shapeB->material.friction, shapeB->material.userMaterialId );
@@ -552,28 +1102,40 @@ bool b2UpdateContact( b2World* world, b2ContactSim* contactSim, b2Shape* shapeA,
 
 	contactSim->tangentSpeed = shapeA->material.tangentSpeed + shapeB->material.tangentSpeed;
 
+	// The manifold functions keep points up to B2_SPECULATIVE_DISTANCE. Shapes with a smaller speculative
+	// distance drop the farther points so their contacts only touch when the shapes are close.
+	float speculativeDistance = b2MinFloat( shapeA->speculativeDistance, shapeB->speculativeDistance );
+	if ( speculativeDistance < B2_SPECULATIVE_DISTANCE )
+	{
+		b2Manifold* manifold = &contactSim->manifold;
+		int keptCount = 0;
+		for ( int i = 0; i < manifold->pointCount; ++i )
+		{
+			if ( manifold->points[i].separation <= speculativeDistance )
+			{
+				manifold->points[keptCount] = manifold->points[i];
+				keptCount += 1;
+			}
+		}
+
+		manifold->pointCount = keptCount;
+	}
+
 	int pointCount = contactSim->manifold.pointCount;
 	bool touching = pointCount > 0;
 
-	if ( touching && world->preSolveFcn != NULL && ( contactSim->simFlags & b2_simEnablePreSolveEvents ) != 0 )
+	if ( touching && world->preSolveBatchFcn != NULL && ( contactSim->simFlags & b2_simEnablePreSolveEvents ) != 0 )
+	{
+		// The caller hands the contact to the pre-solve batch and disables it afterwards if needed
+		contactSim->simFlags |= b2_simPreSolvePending;
+	}
+	else if ( touching && world->preSolveFcn != NULL && ( contactSim->simFlags & b2_simEnablePreSolveEvents ) != 0 )
 	{
 		b2ShapeId shapeIdA = { shapeA->id + 1, world->worldId, shapeA->generation };
 		b2ShapeId shapeIdB = { shapeB->id + 1, world->worldId, shapeB->generation };
 
 		b2Manifold* manifold = &contactSim->manifold;
-		float bestSeparation = manifold->points[0].separation;
-		b2Vec2 bestPoint = manifold->points[0].clipPoint;
-
-		// Get deepest point
-		for ( int i = 1; i < manifold->pointCount; ++i )
-		{
-			float separation = manifold->points[i].separation;
-			if ( separation < bestSeparation )
-			{
-				bestSeparation = separation;
-				bestPoint = manifold->points[i].clipPoint;
-			}
-		}
+		b2Vec2 bestPoint = b2GetDeepestPoint( manifold );
 
 		// this call assumes thread safety
 		touching = world->preSolveFcn( shapeIdA, shapeIdB, bestPoint, manifold->normal, world->preSolveContext );
@@ -601,7 +1163,7 @@ bool b2UpdateContact( b2World* world, b2ContactSim* contactSim, b2Shape* shapeA,
 		pointCount = contactSim->manifold.pointCount;
 	}
 
-	if ( touching && ( shapeA->enableHitEvents || shapeB->enableHitEvents ) )
+	if ( touching && ( shapeA->enableHitEvents || shapeB->enableHitEvents ) && b2ShouldReportContactEvents( world, shapeA, shapeB ) )
 	{
 		contactSim->simFlags |= b2_simEnableHitEvent;
 	}
@@ -612,7 +1174,7 @@ bool b2UpdateContact( b2World* world, b2ContactSim* contactSim, b2Shape* shapeA,
 
 	if ( pointCount > 0 )
 	{
-		contactSim->manifold.rollingImpulse = oldManifold.rollingImpulse;
+		contactSim->manifold.rollingImpulse = oldManifold->rollingImpulse;
 	}
 
 	// Match old contact ids to new contact ids and copy the
@@ -634,9 +1196,9 @@ bool b2UpdateContact( b2World* world, b2ContactSim* contactSim, b2Shape* shapeA,
 
 		uint16_t id2 = mp2->id;
 
-		for ( int j = 0; j < oldManifold.pointCount; ++j )
+		for ( int j = 0; j < oldManifold->pointCount; ++j )
 		{
-			b2ManifoldPoint* mp1 = oldManifold.points + j;
+			b2ManifoldPoint* mp1 = oldManifold->points + j;
 
 			if ( mp1->id == id2 )
 			{
@@ -663,9 +1225,9 @@ bool b2UpdateContact( b2World* world, b2ContactSim* contactSim, b2Shape* shapeA,
 		{
 			float unmatchedNormalImpulse = 0.0f;
 			float unmatchedTangentImpulse = 0.0f;
-			for (int i = 0; i < oldManifold.pointCount; ++i)
+			for (int i = 0; i < oldManifold->pointCount; ++i)
 			{
-				b2ManifoldPoint* mp = oldManifold.points + i;
+				b2ManifoldPoint* mp = oldManifold->points + i;
 				unmatchedNormalImpulse += mp->normalImpulse;
 				unmatchedTangentImpulse += mp->tangentImpulse;
 			}
@@ -22,6 +22,9 @@ enum b2ContactFlags
 
 	// This contact wants contact events
 	b2_contactEnableContactEvents = 0x00000004,
+
+	// Set when the solid shapes first touch and never cleared
+	b2_contactHasTouchedFlag = 0x00000008,
 };
 
 // A contact edge is used to connect bodies and contacts together
@@ -97,11 +100,18 @@ enum b2ContactSimFlags
 
 	// This contact has a cached relative transform
 	b2_simRelativeTransformValid = 0x00400000,
+
+	// This contact waits for the batch pre-solve callback, see b2PreSolveBatchFcn
+	b2_simPreSolvePending = 0x00800000,
 };
 
 /// The class manages contact between two shapes. A contact exists for each overlapping
 /// AABB in the broad-phase (except if filtered). Therefore a contact object may exist
 /// that has no contact points.
+// Shape type pair used to bucket contacts by manifold function
+#define B2_SHAPE_PAIR_TYPE( TYPE_A, TYPE_B ) ( ( TYPE_A ) * b2_shapeTypeCount + ( TYPE_B ) )
+#define B2_SHAPE_PAIR_TYPE_COUNT ( b2_shapeTypeCount * b2_shapeTypeCount )
+
 typedef struct b2ContactSim
 {
 	int contactId;
@@ -109,6 +119,10 @@ typedef struct b2ContactSim
 	b2Transform cachedTransformA;
 	b2Transform cachedTransformB;
 
+	// Lower bound on the shape distance beyond the speculative distance at the cached transforms.
+	// A non-touching contact may skip the narrow phase while the bodies move less than this.
+	float separationBound;
+
 #if B2_ENABLE_VALIDATION
 	int bodyIdA;
 	int bodyIdB;
@@ -138,19 +152,103 @@ typedef struct b2ContactSim
 	// b2ContactSimFlags
 	uint32_t simFlags;
 
+	// Index of the shape type pair, see B2_SHAPE_PAIR_TYPE. Shape types never change while a contact exists.
+	uint8_t pairType;
+
 	b2SimplexCache cache;
 } b2ContactSim;
 
+// Sleeping contact stored by a world created with b2WorldDef::enableCompactContacts. The manifold
+// geometry is recomputed from the shapes when the contact is expanded, so only the point ids and the
+// warm starting impulses are kept. The impulses are half floats.
+typedef struct b2CompactContactSim
+{
+	int contactId;
+
+#if B2_ENABLE_VALIDATION
+	int bodyIdA;
+	int bodyIdB;
+#endif
+
+	int shapeIdA;
+	int shapeIdB;
+
+	float friction;
+	float restitution;
+	float rollingResistance;
+	float tangentSpeed;
+
+	uint32_t simFlags;
+	b2SimplexCache cache;
+
+	// Used if the shapes moved apart while the contact was asleep
+	uint16_t normal[2];
+
+	uint16_t rollingImpulse;
+	uint16_t normalImpulses[2];
+	uint16_t tangentImpulses[2];
+	uint16_t ids[2];
+	uint8_t pointCount;
+	uint8_t pairType;
+} b2CompactContactSim;
+
 void b2InitializeContactRegisters( void );
 bool b2CanCollide( b2ShapeType typeA, b2ShapeType typeB );
 
+// Does this pair of shapes pass the world contact event filter
+bool b2ShouldReportContactEvents( const b2World* world, const b2Shape* shapeA, const b2Shape* shapeB );
+
 void b2CreateContact( b2World* world, b2Shape* shapeA, b2Shape* shapeB );
+
+// Parallel contact creation in three phases. Reserve allocates the contact ids in the same order as
+// count calls to b2CreateContact and returns a slab of count sims at the end of the awake set. The
+// concurrent phase initializes a contact and its sim in the slab and may be called from multiple
+// threads for different contacts. Commit moves the sims of the disabled set out of the slab and links
+// the body contact lists in reservation order. Results are identical to serial creation.
+b2ContactSim* b2ReserveContacts( b2World* world, int* contactIds, int count );
+void b2CreateContactConcurrent( b2World* world, b2Shape* shapeA, b2Shape* shapeB, int contactId, b2ContactSim* contactSim );
+void b2CommitContacts( b2World* world, const int* contactIds, int count );
 void b2DestroyContact( b2World* world, b2Contact* contact, bool wakeBodies );
 
+// Not valid for the contacts of compact sleeping sets, see b2IsCompactContactSet
 b2ContactSim* b2GetContactSim( b2World* world, b2Contact* contact );
 
+// Works for all contacts. The manifold of a compact sleeping contact is expanded.
+b2Manifold b2GetContactManifold( b2World* world, b2Contact* contact );
+
+// Compact contacts are used for the sleeping sets of a world with b2WorldDef::enableCompactContacts
+bool b2IsCompactContactSet( const b2World* world, int setIndex );
+void b2CompressContactSim( b2CompactContactSim* dst, const b2ContactSim* src );
+
+// Rebuilds the manifold at the current body transforms and carries the stored impulses over by id
+void b2ExpandContactSim( b2World* world, b2ContactSim* dst, const b2CompactContactSim* src );
+
 bool b2UpdateContact( b2World* world, b2ContactSim* contactSim, b2Shape* shapeA, b2Transform transformA, b2Vec2 centerOffsetA,
 					  b2Shape* shapeB, b2Transform transformB, b2Vec2 centerOffsetB );
 
+// The pre-solve data of a touching contact for b2PreSolveBatchFcn
+b2PreSolveContact b2MakePreSolveContact( const b2World* world, const b2ContactSim* contactSim, const b2Shape* shapeA,
+										 const b2Shape* shapeB );
+
+// Runs the user pre-solve on one contact. Used where contacts are not batched.
+bool b2PreSolveShapes( b2World* world, const b2Shape* shapeA, const b2Shape* shapeB, b2Vec2 point, b2Vec2 normal );
+
+// The second half of b2UpdateContact, called after contactSim->manifold holds the new manifold.
+bool b2FinishContactUpdate( b2World* world, b2ContactSim* contactSim, b2Manifold* oldManifold, b2Shape* shapeA,
+							b2Vec2 centerOffsetA, b2Shape* shapeB, b2Vec2 centerOffsetB );
+
+// True if the last manifold update of this contact was an early out on the separating axis kept in the
+// contact cache by the polygon manifold functions. See manifold.h.
+bool b2IsCachedAxisSeparated( const b2ContactSim* contactSim );
+
+// Computes the manifolds of up to B2_SIMD_WIDTH contacts with the same shape pair type at once. The
+// results are identical to the scalar manifold function.
+typedef void b2ManifoldWideFcn( b2Shape* const* shapesA, const b2Transform* xfsA, b2Shape* const* shapesB,
+								const b2Transform* xfsB, int count, b2Manifold* manifolds );
+
+// Returns NULL if the shape pair type has no batched manifold function
+b2ManifoldWideFcn* b2GetManifoldWideFcn( int pairType );
+
 b2DeclareArray( b2Contact );
 b2DeclareArray( b2ContactSim );
+b2DeclareArray( b2CompactContactSim );
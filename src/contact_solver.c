@@ -3,14 +3,18 @@
 
 #include "contact_solver.h"
 
+#include "atomic.h"
 #include "body.h"
 #include "constraint_graph.h"
 #include "contact.h"
 #include "core.h"
 #include "physics_world.h"
+#include "shape.h"
+#include "simd.h"
 #include "solver_set.h"
 
 #include <stddef.h>
+#include <string.h>
 
 // contact separation for sub-stepping
 // s = s0 + dot(cB + rB - cA - rA, normal)
@@ -21,1045 +25,781 @@
 // s(t) = s0 + dot(cB0 - cA0, normal) + dot(dpB - dpA + rot(dqB, rB0) - rot(dqA, rA0), normal)
 // s_base = s0 + dot(cB0 - cA0, normal)
 
-void b2PrepareContacts_Overflow( b2StepContext* context )
+// The split values divide the body masses for the parallel overflow solver and are one otherwise
+static void b2PrepareContactConstraint( b2StepContext* context, const b2ContactSim* contactSim, b2ContactConstraint* constraint,
+										float splitA, float splitB )
 {
-	b2TracyCZoneNC( prepare_overflow_contact, "Prepare Overflow Contact", b2_colorYellow, true );
-
-	b2World* world = context->world;
-	b2ConstraintGraph* graph = context->graph;
-	b2GraphColor* color = graph->colors + B2_OVERFLOW_INDEX;
-	b2ContactConstraint* constraints = color->overflowConstraints;
-	int contactCount = color->contactSims.count;
-	b2ContactSim* contacts = color->contactSims.data;
 	b2BodyState* awakeStates = context->states;
 
-#if B2_ENABLE_VALIDATION
-	b2Body* bodies = world->bodies.data;
-#endif
-
-	// Stiffer for static contacts to avoid bodies getting pushed through the ground
-	b2Softness contactSoftness = context->contactSoftness;
-	b2Softness staticSoftness = context->staticSoftness;
+	const b2Manifold* manifold = &contactSim->manifold;
+	int pointCount = manifold->pointCount;
 
-	float warmStartScale = world->enableWarmStarting ? 1.0f : 0.0f;
+	B2_ASSERT( 0 < pointCount && pointCount <= 2 );
 
-	for ( int i = 0; i < contactCount; ++i )
-	{
-		b2ContactSim* contactSim = contacts + i;
-
-		const b2Manifold* manifold = &contactSim->manifold;
-		int pointCount = manifold->pointCount;
-
-		B2_ASSERT( 0 < pointCount && pointCount <= 2 );
-
-		int indexA = contactSim->bodySimIndexA;
-		int indexB = contactSim->bodySimIndexB;
+	int indexA = contactSim->bodySimIndexA;
+	int indexB = contactSim->bodySimIndexB;
 
 #if B2_ENABLE_VALIDATION
-		b2Body* bodyA = bodies + contactSim->bodyIdA;
-		int validIndexA = bodyA->setIndex == b2_awakeSet ? bodyA->localIndex : B2_NULL_INDEX;
-		B2_ASSERT( indexA == validIndexA );
+	b2Body* bodies = context->world->bodies.data;
 
-		b2Body* bodyB = bodies + contactSim->bodyIdB;
-		int validIndexB = bodyB->setIndex == b2_awakeSet ? bodyB->localIndex : B2_NULL_INDEX;
-		B2_ASSERT( indexB == validIndexB );
-#endif
-
-		b2ContactConstraint* constraint = constraints + i;
+	b2Body* bodyA = bodies + contactSim->bodyIdA;
+	int validIndexA = bodyA->setIndex == b2_awakeSet ? bodyA->localIndex : B2_NULL_INDEX;
+	B2_ASSERT( indexA == validIndexA );
 
-		// 0 is null
-		constraint->indexA = indexA + 1;
-		constraint->indexB = indexB + 1;
-		constraint->normal = manifold->normal;
-		constraint->friction = contactSim->friction;
-		constraint->restitution = contactSim->restitution;
-		constraint->rollingResistance = contactSim->rollingResistance;
-		constraint->rollingImpulse = warmStartScale * manifold->rollingImpulse;
-		constraint->tangentSpeed = contactSim->tangentSpeed;
-		constraint->pointCount = pointCount;
-
-		b2Vec2 vA = b2Vec2_zero;
-		float wA = 0.0f;
-		float mA = contactSim->invMassA;
-		float iA = contactSim->invIA;
-		if ( indexA != B2_NULL_INDEX )
-		{
-			b2BodyState* stateA = awakeStates + indexA;
-			vA = stateA->linearVelocity;
-			wA = stateA->angularVelocity;
-		}
-
-		b2Vec2 vB = b2Vec2_zero;
-		float wB = 0.0f;
-		float mB = contactSim->invMassB;
-		float iB = contactSim->invIB;
-		if ( indexB != B2_NULL_INDEX )
-		{
-			b2BodyState* stateB = awakeStates + indexB;
-			vB = stateB->linearVelocity;
-			wB = stateB->angularVelocity;
-		}
-
-		if ( indexA == B2_NULL_INDEX || indexB == B2_NULL_INDEX )
-		{
-			constraint->softness = staticSoftness;
-		}
-		else
-		{
-			constraint->softness = contactSoftness;
-		}
-
-		// copy mass into constraint to avoid cache misses during sub-stepping
-		constraint->invMassA = mA;
-		constraint->invIA = iA;
-		constraint->invMassB = mB;
-		constraint->invIB = iB;
-
-		{
-			float k = iA + iB;
-			constraint->rollingMass = k > 0.0f ? 1.0f / k : 0.0f;
-		}
+	b2Body* bodyB = bodies + contactSim->bodyIdB;
+	int validIndexB = bodyB->setIndex == b2_awakeSet ? bodyB->localIndex : B2_NULL_INDEX;
+	B2_ASSERT( indexB == validIndexB );
+#endif
 
-		b2Vec2 normal = constraint->normal;
-		b2Vec2 tangent = b2RightPerp( constraint->normal );
+	float warmStartScale = context->world->enableWarmStarting ? 1.0f : 0.0f;
+
+	// 0 is null
+	constraint->indexA = indexA + 1;
+	constraint->indexB = indexB + 1;
+	constraint->normal = manifold->normal;
+	constraint->friction = contactSim->friction;
+	constraint->restitution = contactSim->restitution;
+	constraint->rollingResistance = contactSim->rollingResistance;
+	constraint->rollingImpulse = warmStartScale * manifold->rollingImpulse;
+	constraint->tangentSpeed = contactSim->tangentSpeed;
+	constraint->pointCount = pointCount;
+
+	b2Vec2 vA = b2Vec2_zero;
+	float wA = 0.0f;
+	float mA = contactSim->invMassA;
+	float iA = contactSim->invIA;
+	if ( indexA != B2_NULL_INDEX )
+	{
+		b2BodyState* stateA = awakeStates + indexA;
+		vA = stateA->linearVelocity;
+		wA = stateA->angularVelocity;
+	}
 
-		for ( int j = 0; j < pointCount; ++j )
-		{
-			const b2ManifoldPoint* mp = manifold->points + j;
-			b2ContactConstraintPoint* cp = constraint->points + j;
+	b2Vec2 vB = b2Vec2_zero;
+	float wB = 0.0f;
+	float mB = contactSim->invMassB;
+	float iB = contactSim->invIB;
+	if ( indexB != B2_NULL_INDEX )
+	{
+		b2BodyState* stateB = awakeStates + indexB;
+		vB = stateB->linearVelocity;
+		wB = stateB->angularVelocity;
+	}
 
-			cp->normalImpulse = warmStartScale * mp->normalImpulse;
-			cp->tangentImpulse = warmStartScale * mp->tangentImpulse;
-			cp->totalNormalImpulse = 0.0f;
+	// Stiffer for static contacts to avoid bodies getting pushed through the ground
+	if ( indexA == B2_NULL_INDEX || indexB == B2_NULL_INDEX )
+	{
+		constraint->softness = context->staticSoftness;
+	}
+	else
+	{
+		constraint->softness = context->contactSoftness;
+	}
 
-			b2Vec2 rA = mp->anchorA;
-			b2Vec2 rB = mp->anchorB;
+	// copy mass into constraint to avoid cache misses during sub-stepping
+	constraint->invMassA = mA;
+	constraint->invIA = iA;
+	constraint->invMassB = mB;
+	constraint->invIB = iB;
 
-			cp->anchorA = rA;
-			cp->anchorB = rB;
-			cp->baseSeparation = mp->separation - b2Dot( b2Sub( rB, rA ), normal );
+	// Mass splitting for the parallel overflow solver. The effective masses use the body
+	// mass divided by the number of overflow contacts on the body.
+	mA *= splitA;
+	iA *= splitA;
+	mB *= splitB;
+	iB *= splitB;
 
-			float rnA = b2Cross( rA, normal );
-			float rnB = b2Cross( rB, normal );
-			float kNormal = mA + mB + iA * rnA * rnA + iB * rnB * rnB;
-			cp->normalMass = kNormal > 0.0f ? 1.0f / kNormal : 0.0f;
+	{
+		float k = iA + iB;
+		constraint->rollingMass = k > 0.0f ? 1.0f / k : 0.0f;
+	}
 
-			float rtA = b2Cross( rA, tangent );
-			float rtB = b2Cross( rB, tangent );
-			float kTangent = mA + mB + iA * rtA * rtA + iB * rtB * rtB;
-			cp->tangentMass = kTangent > 0.0f ? 1.0f / kTangent : 0.0f;
+	b2Vec2 normal = constraint->normal;
+	b2Vec2 tangent = b2RightPerp( constraint->normal );
 
-			// Save relative velocity for restitution
-			b2Vec2 vrA = b2Add( vA, b2CrossSV( wA, rA ) );
-			b2Vec2 vrB = b2Add( vB, b2CrossSV( wB, rB ) );
-			cp->relativeVelocity = b2Dot( normal, b2Sub( vrB, vrA ) );
-		}
+	for ( int j = 0; j < pointCount; ++j )
+	{
+		const b2ManifoldPoint* mp = manifold->points + j;
+		b2ContactConstraintPoint* cp = constraint->points + j;
+
+		cp->normalImpulse = warmStartScale * mp->normalImpulse;
+		cp->tangentImpulse = warmStartScale * mp->tangentImpulse;
+		cp->totalNormalImpulse = 0.0f;
+
+		b2Vec2 rA = mp->anchorA;
+		b2Vec2 rB = mp->anchorB;
+
+		cp->anchorA = rA;
+		cp->anchorB = rB;
+		cp->baseSeparation = mp->separation - b2Dot( b2Sub( rB, rA ), normal );
+
+		float rnA = b2Cross( rA, normal );
+		float rnB = b2Cross( rB, normal );
+		float kNormal = mA + mB + iA * rnA * rnA + iB * rnB * rnB;
+		cp->normalMass = kNormal > 0.0f ? 1.0f / kNormal : 0.0f;
+
+		float rtA = b2Cross( rA, tangent );
+		float rtB = b2Cross( rB, tangent );
+		float kTangent = mA + mB + iA * rtA * rtA + iB * rtB * rtB;
+		cp->tangentMass = kTangent > 0.0f ? 1.0f / kTangent : 0.0f;
+
+		// Save relative velocity for restitution
+		b2Vec2 vrA = b2Add( vA, b2CrossSV( wA, rA ) );
+		b2Vec2 vrB = b2Add( vB, b2CrossSV( wB, rB ) );
+		cp->relativeVelocity = b2Dot( normal, b2Sub( vrB, vrA ) );
 	}
-
-	b2TracyCZoneEnd( prepare_overflow_contact );
 }
 
-void b2WarmStartContacts_Overflow( b2StepContext* context )
+void b2PrepareContacts_Overflow( b2StepContext* context )
 {
-	b2TracyCZoneNC( warmstart_overflow_contact, "WarmStart Overflow Contact", b2_colorDarkOrange, true );
+	b2TracyCZoneNC( prepare_overflow_contact, "Prepare Overflow Contact", b2_colorYellow, true );
 
 	b2ConstraintGraph* graph = context->graph;
 	b2GraphColor* color = graph->colors + B2_OVERFLOW_INDEX;
 	b2ContactConstraint* constraints = color->overflowConstraints;
 	int contactCount = color->contactSims.count;
-	b2World* world = context->world;
-	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
-	b2BodyState* states = awakeSet->bodyStates.data;
+	b2ContactSim* contacts = color->contactSims.data;
 
-	// This is a dummy state to represent a static body because static bodies don't have a solver body.
-	b2BodyState dummyState = b2_identityBodyState;
+	const int* splitCounts = context->enableParallelOverflow ? context->overflowSplitCounts : NULL;
 
 	for ( int i = 0; i < contactCount; ++i )
 	{
-		b2ContactConstraint* constraint = constraints + i;
-
-		int indexA = constraint->indexA - 1;
-		int indexB = constraint->indexB - 1;
-
-		b2BodyState* stateA = indexA == B2_NULL_INDEX ? &dummyState : states + indexA;
-		b2BodyState* stateB = indexB == B2_NULL_INDEX ? &dummyState : states + indexB;
-
-		b2Vec2 vA = stateA->linearVelocity;
-		float wA = stateA->angularVelocity;
-		b2Vec2 vB = stateB->linearVelocity;
-		float wB = stateB->angularVelocity;
-
-		float mA = constraint->invMassA;
-		float iA = constraint->invIA;
-		float mB = constraint->invMassB;
-		float iB = constraint->invIB;
-
-		// Stiffer for static contacts to avoid bodies getting pushed through the ground
-		b2Vec2 normal = constraint->normal;
-		b2Vec2 tangent = b2RightPerp( constraint->normal );
-		int pointCount = constraint->pointCount;
-
-		for ( int j = 0; j < pointCount; ++j )
-		{
-			b2ContactConstraintPoint* cp = constraint->points + j;
-
-			// fixed anchors
-			b2Vec2 rA = cp->anchorA;
-			b2Vec2 rB = cp->anchorB;
-
-			b2Vec2 P = b2Add( b2MulSV( cp->normalImpulse, normal ), b2MulSV( cp->tangentImpulse, tangent ) );
-
-			cp->totalNormalImpulse += cp->normalImpulse;
-
-			wA -= iA * b2Cross( rA, P );
-			vA = b2MulAdd( vA, -mA, P );
-			wB += iB * b2Cross( rB, P );
-			vB = b2MulAdd( vB, mB, P );
-		}
-
-		wA -= iA * constraint->rollingImpulse;
-		wB += iB * constraint->rollingImpulse;
-
-		if ( stateA->flags & b2_dynamicFlag )
+		float splitA = 1.0f, splitB = 1.0f;
+		if ( splitCounts != NULL )
 		{
-			stateA->linearVelocity = vA;
-			stateA->angularVelocity = wA;
+			splitA = (float)splitCounts[2 * i + 0];
+			splitB = (float)splitCounts[2 * i + 1];
 		}
 
-		if ( stateB->flags & b2_dynamicFlag )
-		{
-			stateB->linearVelocity = vB;
-			stateB->angularVelocity = wB;
-		}
+		b2PrepareContactConstraint( context, contacts + i, constraints + i, splitA, splitB );
 	}
 
-	b2TracyCZoneEnd( warmstart_overflow_contact );
+	b2TracyCZoneEnd( prepare_overflow_contact );
 }
 
-void b2SolveContacts_Overflow( b2StepContext* context, bool useBias )
+static void b2WarmStartOverflowContact( b2ContactConstraint* constraint, b2ContactVelocities* v )
 {
-	b2TracyCZoneNC( solve_contact, "Solve Overflow Contact", b2_colorAliceBlue, true );
+	b2Vec2 vA = v->linearVelocityA;
+	float wA = v->angularVelocityA;
+	b2Vec2 vB = v->linearVelocityB;
+	float wB = v->angularVelocityB;
 
-	b2ConstraintGraph* graph = context->graph;
-	b2GraphColor* color = graph->colors + B2_OVERFLOW_INDEX;
-	b2ContactConstraint* constraints = color->overflowConstraints;
-	int contactCount = color->contactSims.count;
-	b2World* world = context->world;
-	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
-	b2BodyState* states = awakeSet->bodyStates.data;
+	float mA = constraint->invMassA;
+	float iA = constraint->invIA;
+	float mB = constraint->invMassB;
+	float iB = constraint->invIB;
 
-	float inv_h = context->inv_h;
-	const float contactSpeed = context->world->contactSpeed;
-
-	// This is a dummy body to represent a static body since static bodies don't have a solver body.
-	b2BodyState dummyState = b2_identityBodyState;
+	// Stiffer for static contacts to avoid bodies getting pushed through the ground
+	b2Vec2 normal = constraint->normal;
+	b2Vec2 tangent = b2RightPerp( constraint->normal );
+	int pointCount = constraint->pointCount;
 
-	for ( int i = 0; i < contactCount; ++i )
+	for ( int j = 0; j < pointCount; ++j )
 	{
-		b2ContactConstraint* constraint = constraints + i;
-		float mA = constraint->invMassA;
-		float iA = constraint->invIA;
-		float mB = constraint->invMassB;
-		float iB = constraint->invIB;
+		b2ContactConstraintPoint* cp = constraint->points + j;
 
-		int indexA = constraint->indexA - 1;
-		int indexB = constraint->indexB - 1;
+		// fixed anchors
+		b2Vec2 rA = cp->anchorA;
+		b2Vec2 rB = cp->anchorB;
 
-		b2BodyState* stateA = indexA == B2_NULL_INDEX ? &dummyState : states + indexA;
-		b2Vec2 vA = stateA->linearVelocity;
-		float wA = stateA->angularVelocity;
-		b2Rot dqA = stateA->deltaRotation;
+		b2Vec2 P = b2Add( b2MulSV( cp->normalImpulse, normal ), b2MulSV( cp->tangentImpulse, tangent ) );
 
-		b2BodyState* stateB = indexB == B2_NULL_INDEX ? &dummyState : states + indexB;
-		b2Vec2 vB = stateB->linearVelocity;
-		float wB = stateB->angularVelocity;
-		b2Rot dqB = stateB->deltaRotation;
+		cp->totalNormalImpulse += cp->normalImpulse;
 
-		b2Vec2 dp = b2Sub( stateB->deltaPosition, stateA->deltaPosition );
+		wA -= iA * b2Cross( rA, P );
+		vA = b2MulAdd( vA, -mA, P );
+		wB += iB * b2Cross( rB, P );
+		vB = b2MulAdd( vB, mB, P );
+	}
 
-		b2Vec2 normal = constraint->normal;
-		b2Vec2 tangent = b2RightPerp( normal );
-		float friction = constraint->friction;
-		b2Softness softness = constraint->softness;
+	wA -= iA * constraint->rollingImpulse;
+	wB += iB * constraint->rollingImpulse;
 
-		int pointCount = constraint->pointCount;
-		float totalNormalImpulse = 0.0f;
+	v->linearVelocityA = vA;
+	v->angularVelocityA = wA;
+	v->linearVelocityB = vB;
+	v->angularVelocityB = wB;
+}
 
-		// Non-penetration
-		for ( int j = 0; j < pointCount; ++j )
-		{
-			b2ContactConstraintPoint* cp = constraint->points + j;
+static void b2SolveOverflowContact( b2ContactConstraint* constraint, const b2BodyState* stateA, const b2BodyState* stateB,
+									b2ContactVelocities* v, float inv_h, float contactSpeed, bool useBias )
+{
+	float mA = constraint->invMassA;
+	float iA = constraint->invIA;
+	float mB = constraint->invMassB;
+	float iB = constraint->invIB;
 
-			// fixed anchor points
-			b2Vec2 rA = cp->anchorA;
-			b2Vec2 rB = cp->anchorB;
+	b2Vec2 vA = v->linearVelocityA;
+	float wA = v->angularVelocityA;
+	b2Rot dqA = stateA->deltaRotation;
 
-			// compute current separation
-			// this is subject to round-off error if the anchor is far from the body center of mass
-			b2Vec2 ds = b2Add( dp, b2Sub( b2RotateVector( dqB, rB ), b2RotateVector( dqA, rA ) ) );
-			float s = cp->baseSeparation + b2Dot( ds, normal );
+	b2Vec2 vB = v->linearVelocityB;
+	float wB = v->angularVelocityB;
+	b2Rot dqB = stateB->deltaRotation;
 
-			float velocityBias = 0.0f;
-			float massScale = 1.0f;
-			float impulseScale = 0.0f;
-			if ( s > 0.0f )
-			{
-				// speculative bias
-				velocityBias = s * inv_h;
-			}
-			else if ( useBias )
-			{
-				velocityBias = b2MaxFloat( softness.massScale * softness.biasRate * s, -contactSpeed );
-				massScale = softness.massScale;
-				impulseScale = softness.impulseScale;
-			}
+	b2Vec2 dp = b2Sub( stateB->deltaPosition, stateA->deltaPosition );
 
-			// relative normal velocity at contact
-			b2Vec2 vrA = b2Add( vA, b2CrossSV( wA, rA ) );
-			b2Vec2 vrB = b2Add( vB, b2CrossSV( wB, rB ) );
-			float vn = b2Dot( b2Sub( vrB, vrA ), normal );
+	b2Vec2 normal = constraint->normal;
+	b2Vec2 tangent = b2RightPerp( normal );
+	float friction = constraint->friction;
+	b2Softness softness = constraint->softness;
 
-			// incremental normal impulse
-			float impulse = -cp->normalMass * ( massScale * vn + velocityBias ) - impulseScale * cp->normalImpulse;
+	int pointCount = constraint->pointCount;
+	float totalNormalImpulse = 0.0f;
 
-			// clamp the accumulated impulse
-			float newImpulse = b2MaxFloat( cp->normalImpulse + impulse, 0.0f );
-			impulse = newImpulse - cp->normalImpulse;
-			cp->normalImpulse = newImpulse;
-			cp->totalNormalImpulse += impulse;
-
-			// b2Log( "vn %g impulse %g bias %g", vn, newImpulse, velocityBias );
-
-			totalNormalImpulse += newImpulse;
+	// Non-penetration
+	for ( int j = 0; j < pointCount; ++j )
+	{
+		b2ContactConstraintPoint* cp = constraint->points + j;
 
-			// apply normal impulse
-			b2Vec2 P = b2MulSV( impulse, normal );
-			vA = b2MulSub( vA, mA, P );
-			wA -= iA * b2Cross( rA, P );
+		// fixed anchor points
+		b2Vec2 rA = cp->anchorA;
+		b2Vec2 rB = cp->anchorB;
 
-			vB = b2MulAdd( vB, mB, P );
-			wB += iB * b2Cross( rB, P );
-		}
+		// compute current separation
+		// this is subject to round-off error if the anchor is far from the body center of mass
+		b2Vec2 ds = b2Add( dp, b2Sub( b2RotateVector( dqB, rB ), b2RotateVector( dqA, rA ) ) );
+		float s = cp->baseSeparation + b2Dot( ds, normal );
 
-		if (useBias == false)
+		float velocityBias = 0.0f;
+		float massScale = 1.0f;
+		float impulseScale = 0.0f;
+		if ( s > 0.0f )
 		{
-			// Friction
-			for ( int j = 0; j < pointCount; ++j )
-			{
-				b2ContactConstraintPoint* cp = constraint->points + j;
-
-				// fixed anchor points
-				b2Vec2 rA = cp->anchorA;
-				b2Vec2 rB = cp->anchorB;
-
-				// relative tangent velocity at contact
-				b2Vec2 vrB = b2Add( vB, b2CrossSV( wB, rB ) );
-				b2Vec2 vrA = b2Add( vA, b2CrossSV( wA, rA ) );
-
-				// vt = dot(vrB - sB * tangent - (vrA + sA * tangent), tangent)
-				//    = dot(vrB - vrA, tangent) - (sA + sB)
-
-				float vt = b2Dot( b2Sub( vrB, vrA ), tangent ) - constraint->tangentSpeed;
-
-				// incremental tangent impulse
-				float impulse = cp->tangentMass * ( -vt );
-
-				// clamp the accumulated force
-				float maxFriction = friction * cp->normalImpulse;
-				float newImpulse = b2ClampFloat( cp->tangentImpulse + impulse, -maxFriction, maxFriction );
-				impulse = newImpulse - cp->tangentImpulse;
-				cp->tangentImpulse = newImpulse;
-
-				// apply tangent impulse
-				b2Vec2 P = b2MulSV( impulse, tangent );
-				vA = b2MulSub( vA, mA, P );
-				wA -= iA * b2Cross( rA, P );
-				vB = b2MulAdd( vB, mB, P );
-				wB += iB * b2Cross( rB, P );
-			}
-
-			// Rolling resistance
-			{
-				float deltaLambda = -constraint->rollingMass * ( wB - wA );
-				float lambda = constraint->rollingImpulse;
-				float maxLambda = constraint->rollingResistance * totalNormalImpulse;
-				constraint->rollingImpulse = b2ClampFloat( lambda + deltaLambda, -maxLambda, maxLambda );
-				deltaLambda = constraint->rollingImpulse - lambda;
-
-				wA -= iA * deltaLambda;
-				wB += iB * deltaLambda;
-			}
+			// speculative bias
+			velocityBias = s * inv_h;
 		}
-
-		if ( stateA->flags & b2_dynamicFlag )
+		else if ( useBias )
 		{
-			stateA->linearVelocity = vA;
-			stateA->angularVelocity = wA;
+			velocityBias = b2MaxFloat( softness.massScale * softness.biasRate * s, -contactSpeed );
+			massScale = softness.massScale;
+			impulseScale = softness.impulseScale;
 		}
 
-		if ( stateB->flags & b2_dynamicFlag )
-		{
-			stateB->linearVelocity = vB;
-			stateB->angularVelocity = wB;
-		}
-	}
+		// relative normal velocity at contact
+		b2Vec2 vrA = b2Add( vA, b2CrossSV( wA, rA ) );
+		b2Vec2 vrB = b2Add( vB, b2CrossSV( wB, rB ) );
+		float vn = b2Dot( b2Sub( vrB, vrA ), normal );
 
-	b2TracyCZoneEnd( solve_contact );
-}
+		// incremental normal impulse
+		float impulse = -cp->normalMass * ( massScale * vn + velocityBias ) - impulseScale * cp->normalImpulse;
 
-void b2ApplyRestitution_Overflow( b2StepContext* context )
-{
-	b2TracyCZoneNC( overflow_resitution, "Overflow Restitution", b2_colorViolet, true );
+		// clamp the accumulated impulse
+		float newImpulse = b2MaxFloat( cp->normalImpulse + impulse, 0.0f );
+		impulse = newImpulse - cp->normalImpulse;
+		cp->normalImpulse = newImpulse;
+		cp->totalNormalImpulse += impulse;
 
-	b2ConstraintGraph* graph = context->graph;
-	b2GraphColor* color = graph->colors + B2_OVERFLOW_INDEX;
-	b2ContactConstraint* constraints = color->overflowConstraints;
-	int contactCount = color->contactSims.count;
-	b2World* world = context->world;
-	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
-	b2BodyState* states = awakeSet->bodyStates.data;
+		// b2Log( "vn %g impulse %g bias %g", vn, newImpulse, velocityBias );
 
-	float threshold = context->world->restitutionThreshold;
+		totalNormalImpulse += newImpulse;
 
-	// dummy state to represent a static body
-	b2BodyState dummyState = b2_identityBodyState;
+		// apply normal impulse
+		b2Vec2 P = b2MulSV( impulse, normal );
+		vA = b2MulSub( vA, mA, P );
+		wA -= iA * b2Cross( rA, P );
 
-	for ( int i = 0; i < contactCount; ++i )
-	{
-		b2ContactConstraint* constraint = constraints + i;
+		vB = b2MulAdd( vB, mB, P );
+		wB += iB * b2Cross( rB, P );
+	}
 
-		float restitution = constraint->restitution;
-		if ( restitution == 0.0f )
+	if (useBias == false)
+	{
+		// Friction
+		for ( int j = 0; j < pointCount; ++j )
 		{
-			continue;
-		}
-
-		float mA = constraint->invMassA;
-		float iA = constraint->invIA;
-		float mB = constraint->invMassB;
-		float iB = constraint->invIB;
-
-		int indexA = constraint->indexA - 1;
-		int indexB = constraint->indexB - 1;
+			b2ContactConstraintPoint* cp = constraint->points + j;
 
-		b2BodyState* stateA = indexA == B2_NULL_INDEX ? &dummyState : states + indexA;
-		b2Vec2 vA = stateA->linearVelocity;
-		float wA = stateA->angularVelocity;
+			// fixed anchor points
+			b2Vec2 rA = cp->anchorA;
+			b2Vec2 rB = cp->anchorB;
 
-		b2BodyState* stateB = indexB == B2_NULL_INDEX ? &dummyState : states + indexB;
-		b2Vec2 vB = stateB->linearVelocity;
-		float wB = stateB->angularVelocity;
+			// relative tangent velocity at contact
+			b2Vec2 vrB = b2Add( vB, b2CrossSV( wB, rB ) );
+			b2Vec2 vrA = b2Add( vA, b2CrossSV( wA, rA ) );
 
-		b2Vec2 normal = constraint->normal;
-		int pointCount = constraint->pointCount;
+			// vt = dot(vrB - sB * tangent - (vrA + sA * tangent), tangent)
+			//    = dot(vrB - vrA, tangent) - (sA + sB)
 
-		// it is possible to get more accurate restitution by iterating
-		// this only makes a difference if there are two contact points
-		// for (int iter = 0; iter < 10; ++iter)
-		{
-			for ( int j = 0; j < pointCount; ++j )
-			{
-				b2ContactConstraintPoint* cp = constraint->points + j;
+			float vt = b2Dot( b2Sub( vrB, vrA ), tangent ) - constraint->tangentSpeed;
 
-				// if the normal impulse is zero then there was no collision
-				// this skips speculative contact points that didn't generate an impulse
-				// The max normal impulse is used in case there was a collision that moved away within the sub-step process
-				if ( cp->relativeVelocity > -threshold || cp->totalNormalImpulse == 0.0f )
-				{
-					continue;
-				}
+			// incremental tangent impulse
+			float impulse = cp->tangentMass * ( -vt );
 
-				// fixed anchor points
-				b2Vec2 rA = cp->anchorA;
-				b2Vec2 rB = cp->anchorB;
-
-				// relative normal velocity at contact
-				b2Vec2 vrB = b2Add( vB, b2CrossSV( wB, rB ) );
-				b2Vec2 vrA = b2Add( vA, b2CrossSV( wA, rA ) );
-				float vn = b2Dot( b2Sub( vrB, vrA ), normal );
-
-				// compute normal impulse
-				float impulse = -cp->normalMass * ( vn + restitution * cp->relativeVelocity );
-
-				// clamp the accumulated impulse
-				// todo should this be stored?
-				float newImpulse = b2MaxFloat( cp->normalImpulse + impulse, 0.0f );
-				impulse = newImpulse - cp->normalImpulse;
-				cp->normalImpulse = newImpulse;
-				cp->totalNormalImpulse += impulse;
-
-				// apply contact impulse
-				b2Vec2 P = b2MulSV( impulse, normal );
-				vA = b2MulSub( vA, mA, P );
-				wA -= iA * b2Cross( rA, P );
-				vB = b2MulAdd( vB, mB, P );
-				wB += iB * b2Cross( rB, P );
-			}
-		}
+			// clamp the accumulated force
+			float maxFriction = friction * cp->normalImpulse;
+			float newImpulse = b2ClampFloat( cp->tangentImpulse + impulse, -maxFriction, maxFriction );
+			impulse = newImpulse - cp->tangentImpulse;
+			cp->tangentImpulse = newImpulse;
 
-		if ( stateA->flags & b2_dynamicFlag )
-		{
-			stateA->linearVelocity = vA;
-			stateA->angularVelocity = wA;
+			// apply tangent impulse
+			b2Vec2 P = b2MulSV( impulse, tangent );
+			vA = b2MulSub( vA, mA, P );
+			wA -= iA * b2Cross( rA, P );
+			vB = b2MulAdd( vB, mB, P );
+			wB += iB * b2Cross( rB, P );
 		}
 
-		if ( stateB->flags & b2_dynamicFlag )
+		// Rolling resistance
 		{
-			stateB->linearVelocity = vB;
-			stateB->angularVelocity = wB;
+			float deltaLambda = -constraint->rollingMass * ( wB - wA );
+			float lambda = constraint->rollingImpulse;
+			float maxLambda = constraint->rollingResistance * totalNormalImpulse;
+			constraint->rollingImpulse = b2ClampFloat( lambda + deltaLambda, -maxLambda, maxLambda );
+			deltaLambda = constraint->rollingImpulse - lambda;
+
+			wA -= iA * deltaLambda;
+			wB += iB * deltaLambda;
 		}
 	}
 
-	b2TracyCZoneEnd( overflow_resitution );
+	v->linearVelocityA = vA;
+	v->angularVelocityA = wA;
+	v->linearVelocityB = vB;
+	v->angularVelocityB = wB;
 }
 
-void b2StoreImpulses_Overflow( b2StepContext* context )
+static void b2ApplyOverflowRestitution( b2ContactConstraint* constraint, b2ContactVelocities* v, float threshold )
 {
-	b2TracyCZoneNC( store_impulses, "Store", b2_colorFireBrick, true );
-
-	b2ConstraintGraph* graph = context->graph;
-	b2GraphColor* color = graph->colors + B2_OVERFLOW_INDEX;
-	b2ContactConstraint* constraints = color->overflowConstraints;
-	b2ContactSim* contacts = color->contactSims.data;
-	int contactCount = color->contactSims.count;
-
-	for ( int i = 0; i < contactCount; ++i )
+	float restitution = constraint->restitution;
+	if ( restitution == 0.0f )
 	{
-		const b2ContactConstraint* constraint = constraints + i;
-		b2ContactSim* contact = contacts + i;
-		b2Manifold* manifold = &contact->manifold;
-		int pointCount = manifold->pointCount;
-
-		for ( int j = 0; j < pointCount; ++j )
-		{
-			manifold->points[j].normalImpulse = constraint->points[j].normalImpulse;
-			manifold->points[j].tangentImpulse = constraint->points[j].tangentImpulse;
-			manifold->points[j].totalNormalImpulse = constraint->points[j].totalNormalImpulse;
-			manifold->points[j].normalVelocity = constraint->points[j].relativeVelocity;
-		}
-
-		manifold->rollingImpulse = constraint->rollingImpulse;
+		return;
 	}
 
-	b2TracyCZoneEnd( store_impulses );
-}
-
-#if defined( B2_SIMD_AVX2 )
-
-#include <immintrin.h>
-
-// wide float holds 8 numbers
-typedef __m256 b2FloatW;
-
-#elif defined( B2_SIMD_NEON )
-
-#include <arm_neon.h>
-
-// wide float holds 4 numbers
-typedef float32x4_t b2FloatW;
-
-#elif defined( B2_SIMD_SSE2 )
-
-#include <emmintrin.h>
-
-// wide float holds 4 numbers
-typedef __m128 b2FloatW;
-
-#else
-
-// scalar math
-typedef struct b2FloatW
-{
-	float x, y, z, w;
-} b2FloatW;
-
-#endif
-
-// Wide vec2
-typedef struct b2Vec2W
-{
-	b2FloatW X, Y;
-} b2Vec2W;
-
-// Wide rotation
-typedef struct b2RotW
-{
-	b2FloatW C, S;
-} b2RotW;
-
-#if defined( B2_SIMD_AVX2 )
+	float mA = constraint->invMassA;
+	float iA = constraint->invIA;
+	float mB = constraint->invMassB;
+	float iB = constraint->invIB;
 
-static inline b2FloatW b2ZeroW( void )
-{
-	return _mm256_setzero_ps();
-}
+	b2Vec2 vA = v->linearVelocityA;
+	float wA = v->angularVelocityA;
+	b2Vec2 vB = v->linearVelocityB;
+	float wB = v->angularVelocityB;
 
-static inline b2FloatW b2SplatW( float scalar )
-{
-	return _mm256_set1_ps( scalar );
-}
+	b2Vec2 normal = constraint->normal;
+	int pointCount = constraint->pointCount;
 
-static inline b2FloatW b2AddW( b2FloatW a, b2FloatW b )
-{
-	return _mm256_add_ps( a, b );
-}
+	// it is possible to get more accurate restitution by iterating
+	// this only makes a difference if there are two contact points
+	// for (int iter = 0; iter < 10; ++iter)
+	{
+		for ( int j = 0; j < pointCount; ++j )
+		{
+			b2ContactConstraintPoint* cp = constraint->points + j;
 
-static inline b2FloatW b2SubW( b2FloatW a, b2FloatW b )
-{
-	return _mm256_sub_ps( a, b );
-}
+			// if the normal impulse is zero then there was no collision
+			// this skips speculative contact points that didn't generate an impulse
+			// The max normal impulse is used in case there was a collision that moved away within the sub-step process
+			if ( cp->relativeVelocity > -threshold || cp->totalNormalImpulse == 0.0f )
+			{
+				continue;
+			}
 
-static inline b2FloatW b2MulW( b2FloatW a, b2FloatW b )
-{
-	return _mm256_mul_ps( a, b );
-}
+			// fixed anchor points
+			b2Vec2 rA = cp->anchorA;
+			b2Vec2 rB = cp->anchorB;
 
-static inline b2FloatW b2MulAddW( b2FloatW a, b2FloatW b, b2FloatW c )
-{
-	// FMA can be emulated: https://github.com/lattera/glibc/blob/master/sysdeps/ieee754/dbl-64/s_fmaf.c#L34
-	// return _mm256_fmadd_ps( b, c, a );
-	return _mm256_add_ps( _mm256_mul_ps( b, c ), a );
-}
+			// relative normal velocity at contact
+			b2Vec2 vrB = b2Add( vB, b2CrossSV( wB, rB ) );
+			b2Vec2 vrA = b2Add( vA, b2CrossSV( wA, rA ) );
+			float vn = b2Dot( b2Sub( vrB, vrA ), normal );
 
-static inline b2FloatW b2MulSubW( b2FloatW a, b2FloatW b, b2FloatW c )
-{
-	// return _mm256_fnmadd_ps(b, c, a);
-	return _mm256_sub_ps( a, _mm256_mul_ps( b, c ) );
-}
+			// compute normal impulse
+			float impulse = -cp->normalMass * ( vn + restitution * cp->relativeVelocity );
 
-static inline b2FloatW b2MinW( b2FloatW a, b2FloatW b )
-{
-	return _mm256_min_ps( a, b );
-}
+			// clamp the accumulated impulse
+			// todo should this be stored?
+			float newImpulse = b2MaxFloat( cp->normalImpulse + impulse, 0.0f );
+			impulse = newImpulse - cp->normalImpulse;
+			cp->normalImpulse = newImpulse;
+			cp->totalNormalImpulse += impulse;
 
-static inline b2FloatW b2MaxW( b2FloatW a, b2FloatW b )
-{
-	return _mm256_max_ps( a, b );
-}
+			// apply contact impulse
+			b2Vec2 P = b2MulSV( impulse, normal );
+			vA = b2MulSub( vA, mA, P );
+			wA -= iA * b2Cross( rA, P );
+			vB = b2MulAdd( vB, mB, P );
+			wB += iB * b2Cross( rB, P );
+		}
+	}
 
-// a = clamp(a, -b, b)
-static inline b2FloatW b2SymClampW( b2FloatW a, b2FloatW b )
-{
-	b2FloatW nb = _mm256_sub_ps( _mm256_setzero_ps(), b );
-	return _mm256_max_ps( nb, _mm256_min_ps( a, b ) );
+	v->linearVelocityA = vA;
+	v->angularVelocityA = wA;
+	v->linearVelocityB = vB;
+	v->angularVelocityB = wB;
 }
 
-static inline b2FloatW b2OrW( b2FloatW a, b2FloatW b )
+static inline b2ContactVelocities b2LoadContactVelocities( const b2BodyState* stateA, const b2BodyState* stateB )
 {
-	return _mm256_or_ps( a, b );
+	return (b2ContactVelocities){
+		stateA->linearVelocity,
+		stateA->angularVelocity,
+		stateB->linearVelocity,
+		stateB->angularVelocity,
+	};
 }
 
-static inline b2FloatW b2GreaterThanW( b2FloatW a, b2FloatW b )
+static inline void b2StoreContactVelocities( b2BodyState* stateA, b2BodyState* stateB, const b2ContactVelocities* v )
 {
-	return _mm256_cmp_ps( a, b, _CMP_GT_OQ );
-}
+	if ( stateA->flags & b2_dynamicFlag )
+	{
+		stateA->linearVelocity = v->linearVelocityA;
+		stateA->angularVelocity = v->angularVelocityA;
+	}
 
-static inline b2FloatW b2EqualsW( b2FloatW a, b2FloatW b )
-{
-	return _mm256_cmp_ps( a, b, _CMP_EQ_OQ );
+	if ( stateB->flags & b2_dynamicFlag )
+	{
+		stateB->linearVelocity = v->linearVelocityB;
+		stateB->angularVelocity = v->angularVelocityB;
+	}
 }
 
-static inline bool b2AllZeroW( b2FloatW a )
+void b2WarmStartContactConstraints( b2StepContext* context, b2ContactConstraint* constraints, int count )
 {
-	// Compare each element with zero
-	b2FloatW zero = _mm256_setzero_ps();
-	b2FloatW cmp = _mm256_cmp_ps( a, zero, _CMP_EQ_OQ );
+	b2BodyState* states = context->states;
 
-	// Create a mask from the comparison results
-	int mask = _mm256_movemask_ps( cmp );
+	// This is a dummy state to represent a static body because static bodies don't have a solver body.
+	b2BodyState dummyState = b2_identityBodyState;
 
-	// If all elements are zero, the mask will be 0xFF (11111111 in binary)
-	return mask == 0xFF;
-}
+	for ( int i = 0; i < count; ++i )
+	{
+		b2ContactConstraint* constraint = constraints + i;
 
-// component-wise returns mask ? b : a
-static inline b2FloatW b2BlendW( b2FloatW a, b2FloatW b, b2FloatW mask )
-{
-	return _mm256_blendv_ps( a, b, mask );
-}
+		int indexA = constraint->indexA - 1;
+		int indexB = constraint->indexB - 1;
 
-#elif defined( B2_SIMD_NEON )
+		b2BodyState* stateA = indexA == B2_NULL_INDEX ? &dummyState : states + indexA;
+		b2BodyState* stateB = indexB == B2_NULL_INDEX ? &dummyState : states + indexB;
 
-static inline b2FloatW b2ZeroW( void )
-{
-	return vdupq_n_f32( 0.0f );
+		b2ContactVelocities v = b2LoadContactVelocities( stateA, stateB );
+		b2WarmStartOverflowContact( constraint, &v );
+		b2StoreContactVelocities( stateA, stateB, &v );
+	}
 }
 
-static inline b2FloatW b2SplatW( float scalar )
+void b2SolveContactConstraints( b2StepContext* context, b2ContactConstraint* constraints, int count, bool useBias )
 {
-	return vdupq_n_f32( scalar );
-}
+	b2BodyState* states = context->states;
 
-static inline b2FloatW b2SetW( float a, float b, float c, float d )
-{
-	float32_t array[4] = { a, b, c, d };
-	return vld1q_f32( array );
-}
+	float inv_h = context->inv_h;
+	const float contactSpeed = context->world->contactSpeed;
 
-static inline b2FloatW b2AddW( b2FloatW a, b2FloatW b )
-{
-	return vaddq_f32( a, b );
-}
+	// This is a dummy body to represent a static body since static bodies don't have a solver body.
+	b2BodyState dummyState = b2_identityBodyState;
 
-static inline b2FloatW b2SubW( b2FloatW a, b2FloatW b )
-{
-	return vsubq_f32( a, b );
-}
+	for ( int i = 0; i < count; ++i )
+	{
+		b2ContactConstraint* constraint = constraints + i;
 
-static inline b2FloatW b2MulW( b2FloatW a, b2FloatW b )
-{
-	return vmulq_f32( a, b );
-}
+		int indexA = constraint->indexA - 1;
+		int indexB = constraint->indexB - 1;
 
-static inline b2FloatW b2MulAddW( b2FloatW a, b2FloatW b, b2FloatW c )
-{
-	return vaddq_f32( a, vmulq_f32( b, c ) );
-}
+		b2BodyState* stateA = indexA == B2_NULL_INDEX ? &dummyState : states + indexA;
+		b2BodyState* stateB = indexB == B2_NULL_INDEX ? &dummyState : states + indexB;
 
-static inline b2FloatW b2MulSubW( b2FloatW a, b2FloatW b, b2FloatW c )
-{
-	return vsubq_f32( a, vmulq_f32( b, c ) );
+		b2ContactVelocities v = b2LoadContactVelocities( stateA, stateB );
+		b2SolveOverflowContact( constraint, stateA, stateB, &v, inv_h, contactSpeed, useBias );
+		b2StoreContactVelocities( stateA, stateB, &v );
+	}
 }
 
-static inline b2FloatW b2MinW( b2FloatW a, b2FloatW b )
+void b2ApplyContactRestitution( b2StepContext* context, b2ContactConstraint* constraints, int count )
 {
-	return vminq_f32( a, b );
-}
+	b2BodyState* states = context->states;
 
-static inline b2FloatW b2MaxW( b2FloatW a, b2FloatW b )
-{
-	return vmaxq_f32( a, b );
-}
+	float threshold = context->world->restitutionThreshold;
 
-// a = clamp(a, -b, b)
-static inline b2FloatW b2SymClampW( b2FloatW a, b2FloatW b )
-{
-	b2FloatW nb = vnegq_f32( b );
-	return vmaxq_f32( nb, vminq_f32( a, b ) );
-}
+	// dummy state to represent a static body
+	b2BodyState dummyState = b2_identityBodyState;
 
-static inline b2FloatW b2OrW( b2FloatW a, b2FloatW b )
-{
-	return vreinterpretq_f32_u32( vorrq_u32( vreinterpretq_u32_f32( a ), vreinterpretq_u32_f32( b ) ) );
-}
+	for ( int i = 0; i < count; ++i )
+	{
+		b2ContactConstraint* constraint = constraints + i;
+		if ( constraint->restitution == 0.0f )
+		{
+			continue;
+		}
 
-static inline b2FloatW b2GreaterThanW( b2FloatW a, b2FloatW b )
-{
-	return vreinterpretq_f32_u32( vcgtq_f32( a, b ) );
-}
+		int indexA = constraint->indexA - 1;
+		int indexB = constraint->indexB - 1;
 
-static inline b2FloatW b2EqualsW( b2FloatW a, b2FloatW b )
-{
-	return vreinterpretq_f32_u32( vceqq_f32( a, b ) );
-}
+		b2BodyState* stateA = indexA == B2_NULL_INDEX ? &dummyState : states + indexA;
+		b2BodyState* stateB = indexB == B2_NULL_INDEX ? &dummyState : states + indexB;
 
-static inline bool b2AllZeroW( b2FloatW a )
-{
-	// Create a zero vector for comparison
-	b2FloatW zero = vdupq_n_f32( 0.0f );
-
-	// Compare the input vector with zero
-	uint32x4_t cmp_result = vceqq_f32( a, zero );
-
-// Check if all comparison results are non-zero using vminvq
-#ifdef __ARM_FEATURE_SVE
-	// ARM v8.2+ has horizontal minimum instruction
-	return vminvq_u32( cmp_result ) != 0;
-#else
-	// For older ARM architectures, we need to manually check all lanes
-	return vgetq_lane_u32( cmp_result, 0 ) != 0 && vgetq_lane_u32( cmp_result, 1 ) != 0 && vgetq_lane_u32( cmp_result, 2 ) != 0 &&
-		   vgetq_lane_u32( cmp_result, 3 ) != 0;
-#endif
+		b2ContactVelocities v = b2LoadContactVelocities( stateA, stateB );
+		b2ApplyOverflowRestitution( constraint, &v, threshold );
+		b2StoreContactVelocities( stateA, stateB, &v );
+	}
 }
 
-// component-wise returns mask ? b : a
-static inline b2FloatW b2BlendW( b2FloatW a, b2FloatW b, b2FloatW mask )
+void b2WarmStartContacts_Overflow( b2StepContext* context )
 {
-	uint32x4_t mask32 = vreinterpretq_u32_f32( mask );
-	return vbslq_f32( mask32, b, a );
-}
+	b2TracyCZoneNC( warmstart_overflow_contact, "WarmStart Overflow Contact", b2_colorDarkOrange, true );
 
-static inline b2FloatW b2LoadW( const float32_t* data )
-{
-	return vld1q_f32( data );
-}
+	b2GraphColor* color = context->graph->colors + B2_OVERFLOW_INDEX;
+	b2WarmStartContactConstraints( context, color->overflowConstraints, color->contactSims.count );
 
-static inline void b2StoreW( float32_t* data, b2FloatW a )
-{
-	vst1q_f32( data, a );
+	b2TracyCZoneEnd( warmstart_overflow_contact );
 }
 
-static inline b2FloatW b2UnpackLoW( b2FloatW a, b2FloatW b )
+void b2SolveContacts_Overflow( b2StepContext* context, bool useBias )
 {
-#if defined( _M_ARM64 ) || defined( __aarch64__ )
-	return vzip1q_f32( a, b );
-#else
-	float32x2_t a1 = vget_low_f32( a );
-	float32x2_t b1 = vget_low_f32( b );
-	float32x2x2_t result = vzip_f32( a1, b1 );
-	return vcombine_f32( result.val[0], result.val[1] );
-#endif
+	b2TracyCZoneNC( solve_contact, "Solve Overflow Contact", b2_colorAliceBlue, true );
+
+	b2GraphColor* color = context->graph->colors + B2_OVERFLOW_INDEX;
+	b2SolveContactConstraints( context, color->overflowConstraints, color->contactSims.count, useBias );
+
+	b2TracyCZoneEnd( solve_contact );
 }
 
-static inline b2FloatW b2UnpackHiW( b2FloatW a, b2FloatW b )
+void b2ApplyRestitution_Overflow( b2StepContext* context )
 {
-#if defined( _M_ARM64 ) || defined( __aarch64__ )
-	return vzip2q_f32( a, b );
-#else
-	float32x2_t a1 = vget_high_f32( a );
-	float32x2_t b1 = vget_high_f32( b );
-	float32x2x2_t result = vzip_f32( a1, b1 );
-	return vcombine_f32( result.val[0], result.val[1] );
-#endif
-}
+	b2TracyCZoneNC( overflow_resitution, "Overflow Restitution", b2_colorViolet, true );
 
-#elif defined( B2_SIMD_SSE2 )
+	b2GraphColor* color = context->graph->colors + B2_OVERFLOW_INDEX;
+	b2ApplyContactRestitution( context, color->overflowConstraints, color->contactSims.count );
 
-static inline b2FloatW b2ZeroW( void )
-{
-	return _mm_setzero_ps();
+	b2TracyCZoneEnd( overflow_resitution );
 }
 
-static inline b2FloatW b2SplatW( float scalar )
+// The overflow contacts share a few hub bodies so they cannot be solved in parallel with Gauss-Seidel.
+// Instead every contact reads the body velocities from the start of the pass and writes its velocity
+// change to its own slot. The effective masses were computed in prepare with the body mass divided
+// by the number of overflow contacts on the body (mass splitting), which keeps the summed response of
+// a hub body from overshooting.
+void b2SolveOverflowContactsTask( b2SolverBlock block, b2StepContext* context )
 {
-	return _mm_set1_ps( scalar );
-}
+	b2TracyCZoneNC( solve_overflow, "Parallel Overflow Contact", b2_colorAliceBlue, true );
 
-static inline b2FloatW b2SetW( float a, float b, float c, float d )
-{
-	return _mm_setr_ps( a, b, c, d );
-}
+	b2GraphColor* color = context->graph->colors + B2_OVERFLOW_INDEX;
+	b2ContactConstraint* constraints = color->overflowConstraints;
+	b2ContactVelocities* deltas = context->overflowDeltas;
+	b2BodyState* states = context->states;
+	b2SolverStageType stageType = context->overflowStage;
 
-static inline b2FloatW b2AddW( b2FloatW a, b2FloatW b )
-{
-	return _mm_add_ps( a, b );
-}
+	float inv_h = context->inv_h;
+	float contactSpeed = context->world->contactSpeed;
+	float threshold = context->world->restitutionThreshold;
 
-static inline b2FloatW b2SubW( b2FloatW a, b2FloatW b )
-{
-	return _mm_sub_ps( a, b );
-}
+	B2_ASSERT( 0 <= block.startIndex && block.startIndex + block.count <= color->contactSims.count );
 
-static inline b2FloatW b2MulW( b2FloatW a, b2FloatW b )
-{
-	return _mm_mul_ps( a, b );
-}
+	b2BodyState dummyState = b2_identityBodyState;
 
-static inline b2FloatW b2MulAddW( b2FloatW a, b2FloatW b, b2FloatW c )
-{
-	return _mm_add_ps( a, _mm_mul_ps( b, c ) );
-}
+	for ( int i = block.startIndex; i < block.startIndex + block.count; ++i )
+	{
+		b2ContactConstraint* constraint = constraints + i;
 
-static inline b2FloatW b2MulSubW( b2FloatW a, b2FloatW b, b2FloatW c )
-{
-	return _mm_sub_ps( a, _mm_mul_ps( b, c ) );
-}
+		int indexA = constraint->indexA - 1;
+		int indexB = constraint->indexB - 1;
 
-static inline b2FloatW b2MinW( b2FloatW a, b2FloatW b )
-{
-	return _mm_min_ps( a, b );
-}
+		const b2BodyState* stateA = indexA == B2_NULL_INDEX ? &dummyState : states + indexA;
+		const b2BodyState* stateB = indexB == B2_NULL_INDEX ? &dummyState : states + indexB;
 
-static inline b2FloatW b2MaxW( b2FloatW a, b2FloatW b )
-{
-	return _mm_max_ps( a, b );
-}
+		b2ContactVelocities v = b2LoadContactVelocities( stateA, stateB );
 
-// a = clamp(a, -b, b)
-static inline b2FloatW b2SymClampW( b2FloatW a, b2FloatW b )
-{
-	// Create a mask with the sign bit set for each element
-	__m128 mask = _mm_set1_ps( -0.0f );
+		switch ( stageType )
+		{
+			case b2_stageWarmStart:
+				b2WarmStartOverflowContact( constraint, &v );
+				break;
 
-	// XOR the input with the mask to negate each element
-	__m128 nb = _mm_xor_ps( b, mask );
+			case b2_stageSolve:
+				b2SolveOverflowContact( constraint, stateA, stateB, &v, inv_h, contactSpeed, true );
+				break;
 
-	return _mm_max_ps( nb, _mm_min_ps( a, b ) );
-}
+			case b2_stageRelax:
+				b2SolveOverflowContact( constraint, stateA, stateB, &v, inv_h, contactSpeed, false );
+				break;
 
-static inline b2FloatW b2OrW( b2FloatW a, b2FloatW b )
-{
-	return _mm_or_ps( a, b );
-}
+			case b2_stageRestitution:
+				b2ApplyOverflowRestitution( constraint, &v, threshold );
+				break;
 
-static inline b2FloatW b2GreaterThanW( b2FloatW a, b2FloatW b )
-{
-	return _mm_cmpgt_ps( a, b );
-}
+			default:
+				B2_ASSERT( false );
+				break;
+		}
 
-static inline b2FloatW b2EqualsW( b2FloatW a, b2FloatW b )
-{
-	return _mm_cmpeq_ps( a, b );
+		b2ContactVelocities* delta = deltas + i;
+		delta->linearVelocityA = b2Sub( v.linearVelocityA, stateA->linearVelocity );
+		delta->angularVelocityA = v.angularVelocityA - stateA->angularVelocity;
+		delta->linearVelocityB = b2Sub( v.linearVelocityB, stateB->linearVelocity );
+		delta->angularVelocityB = v.angularVelocityB - stateB->angularVelocity;
+	}
+
+	b2TracyCZoneEnd( solve_overflow );
 }
 
-static inline bool b2AllZeroW( b2FloatW a )
+// Sum the overflow velocity changes of each body in contact order.
+void b2ApplyOverflowDeltasTask( b2SolverBlock block, b2StepContext* context )
 {
-	// Compare each element with zero
-	b2FloatW zero = _mm_setzero_ps();
-	b2FloatW cmp = _mm_cmpeq_ps( a, zero );
+	b2TracyCZoneNC( apply_overflow, "Apply Overflow Deltas", b2_colorDarkOrange, true );
 
-	// Create a mask from the comparison results
-	int mask = _mm_movemask_ps( cmp );
+	const b2OverflowBody* bodies = context->overflowBodies;
+	const int* entries = context->overflowEntries;
+	const b2ContactVelocities* deltas = context->overflowDeltas;
+	b2BodyState* states = context->states;
 
-	// If all elements are zero, the mask will be 0xF (1111 in binary)
-	return mask == 0xF;
-}
+	B2_ASSERT( 0 <= block.startIndex && block.startIndex + block.count <= context->overflowBodyCount );
 
-// component-wise returns mask ? b : a
-static inline b2FloatW b2BlendW( b2FloatW a, b2FloatW b, b2FloatW mask )
-{
-	return _mm_or_ps( _mm_and_ps( mask, b ), _mm_andnot_ps( mask, a ) );
-}
+	for ( int i = block.startIndex; i < block.startIndex + block.count; ++i )
+	{
+		const b2OverflowBody* body = bodies + i;
+		b2BodyState* state = states + body->stateIndex;
+		if ( ( state->flags & b2_dynamicFlag ) == 0 )
+		{
+			continue;
+		}
 
-static inline b2FloatW b2LoadW( const float* data )
-{
-	return _mm_load_ps( data );
-}
+		b2Vec2 dv = b2Vec2_zero;
+		float dw = 0.0f;
+		for ( int j = 0; j < body->entryCount; ++j )
+		{
+			int entry = entries[body->entryStart + j];
+			const b2ContactVelocities* delta = deltas + ( entry >> 1 );
+			if ( ( entry & 1 ) == 0 )
+			{
+				dv = b2Add( dv, delta->linearVelocityA );
+				dw += delta->angularVelocityA;
+			}
+			else
+			{
+				dv = b2Add( dv, delta->linearVelocityB );
+				dw += delta->angularVelocityB;
+			}
+		}
 
-static inline void b2StoreW( float* data, b2FloatW a )
-{
-	_mm_store_ps( data, a );
-}
+		state->linearVelocity = b2Add( state->linearVelocity, dv );
+		state->angularVelocity += dw;
+	}
 
-static inline b2FloatW b2UnpackLoW( b2FloatW a, b2FloatW b )
-{
-	return _mm_unpacklo_ps( a, b );
+	b2TracyCZoneEnd( apply_overflow );
 }
 
-static inline b2FloatW b2UnpackHiW( b2FloatW a, b2FloatW b )
+// Builds the hit event of a contact from its fastest approaching point. Skipped if no point with a
+// confirmed impulse exceeds the threshold.
+static void b2AddHitEvent( b2World* world, b2TaskContext* taskContext, const b2ContactSim* contactSim )
 {
-	return _mm_unpackhi_ps( a, b );
-}
+	b2ContactHitEvent event = { 0 };
+	event.approachSpeed = world->hitEventThreshold;
 
-#else
+	bool found = false;
+	int pointCount = contactSim->manifold.pointCount;
+	for ( int p = 0; p < pointCount; ++p )
+	{
+		const b2ManifoldPoint* mp = contactSim->manifold.points + p;
+		float approachSpeed = -mp->normalVelocity;
 
-static inline b2FloatW b2ZeroW( void )
-{
-	return (b2FloatW){ 0.0f, 0.0f, 0.0f, 0.0f };
-}
+		// Need to check total impulse because the point may be speculative and not colliding
+		if ( approachSpeed > event.approachSpeed && mp->totalNormalImpulse > 0.0f )
+		{
+			event.approachSpeed = approachSpeed;
+			// Using the clip point here is somewhat questionable
+			event.point = mp->clipPoint;
+			found = true;
+		}
+	}
 
-static inline b2FloatW b2SplatW( float scalar )
-{
-	return (b2FloatW){ scalar, scalar, scalar, scalar };
-}
+	if ( found == false )
+	{
+		return;
+	}
 
-static inline b2FloatW b2AddW( b2FloatW a, b2FloatW b )
-{
-	return (b2FloatW){ a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w };
-}
+	uint16_t worldId = world->worldId;
+	event.normal = contactSim->manifold.normal;
 
-static inline b2FloatW b2SubW( b2FloatW a, b2FloatW b )
-{
-	return (b2FloatW){ a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w };
-}
+	const b2Shape* shapeA = world->shapes.data + contactSim->shapeIdA;
+	const b2Shape* shapeB = world->shapes.data + contactSim->shapeIdB;
+	event.shapeIdA = (b2ShapeId){ shapeA->id + 1, worldId, shapeA->generation };
+	event.shapeIdB = (b2ShapeId){ shapeB->id + 1, worldId, shapeB->generation };
 
-static inline b2FloatW b2MulW( b2FloatW a, b2FloatW b )
-{
-	return (b2FloatW){ a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w };
-}
+	const b2Contact* contact = world->contacts.data + contactSim->contactId;
+	event.contactId = (b2ContactId){
+		.index1 = contact->contactId + 1,
+		.world0 = worldId,
+		.padding = 0,
+		.generation = contact->generation,
+	};
 
-static inline b2FloatW b2MulAddW( b2FloatW a, b2FloatW b, b2FloatW c )
-{
-	return (b2FloatW){ a.x + b.x * c.x, a.y + b.y * c.y, a.z + b.z * c.z, a.w + b.w * c.w };
+	b2Array_Push( taskContext->hitEvents, event );
 }
 
-static inline b2FloatW b2MulSubW( b2FloatW a, b2FloatW b, b2FloatW c )
+void b2StoreImpulses_Overflow( b2StepContext* context, int workerIndex )
 {
-	return (b2FloatW){ a.x - b.x * c.x, a.y - b.y * c.y, a.z - b.z * c.z, a.w - b.w * c.w };
-}
+	b2TracyCZoneNC( store_impulses, "Store", b2_colorFireBrick, true );
 
-static inline b2FloatW b2MinW( b2FloatW a, b2FloatW b )
-{
-	b2FloatW r;
-	r.x = a.x <= b.x ? a.x : b.x;
-	r.y = a.y <= b.y ? a.y : b.y;
-	r.z = a.z <= b.z ? a.z : b.z;
-	r.w = a.w <= b.w ? a.w : b.w;
-	return r;
-}
+	b2World* world = context->world;
+	b2TaskContext* taskContext = world->taskContexts.data + workerIndex;
+	b2ConstraintGraph* graph = context->graph;
+	b2GraphColor* color = graph->colors + B2_OVERFLOW_INDEX;
+	b2ContactConstraint* constraints = color->overflowConstraints;
+	b2ContactSim* contacts = color->contactSims.data;
+	int contactCount = color->contactSims.count;
 
-static inline b2FloatW b2MaxW( b2FloatW a, b2FloatW b )
-{
-	b2FloatW r;
-	r.x = a.x >= b.x ? a.x : b.x;
-	r.y = a.y >= b.y ? a.y : b.y;
-	r.z = a.z >= b.z ? a.z : b.z;
-	r.w = a.w >= b.w ? a.w : b.w;
-	return r;
-}
+	for ( int i = 0; i < contactCount; ++i )
+	{
+		const b2ContactConstraint* constraint = constraints + i;
+		b2ContactSim* contact = contacts + i;
+		b2Manifold* manifold = &contact->manifold;
+		int pointCount = manifold->pointCount;
 
-// a = clamp(a, -b, b)
-static inline b2FloatW b2SymClampW( b2FloatW a, b2FloatW b )
-{
-	b2FloatW r;
-	r.x = b2ClampFloat( a.x, -b.x, b.x );
-	r.y = b2ClampFloat( a.y, -b.y, b.y );
-	r.z = b2ClampFloat( a.z, -b.z, b.z );
-	r.w = b2ClampFloat( a.w, -b.w, b.w );
-	return r;
-}
+		for ( int j = 0; j < pointCount; ++j )
+		{
+			manifold->points[j].normalImpulse = constraint->points[j].normalImpulse;
+			manifold->points[j].tangentImpulse = constraint->points[j].tangentImpulse;
+			manifold->points[j].totalNormalImpulse = constraint->points[j].totalNormalImpulse;
+			manifold->points[j].normalVelocity = constraint->points[j].relativeVelocity;
+		}
 
-static inline b2FloatW b2OrW( b2FloatW a, b2FloatW b )
-{
-	b2FloatW r;
-	r.x = a.x != 0.0f || b.x != 0.0f ? 1.0f : 0.0f;
-	r.y = a.y != 0.0f || b.y != 0.0f ? 1.0f : 0.0f;
-	r.z = a.z != 0.0f || b.z != 0.0f ? 1.0f : 0.0f;
-	r.w = a.w != 0.0f || b.w != 0.0f ? 1.0f : 0.0f;
-	return r;
-}
+		manifold->rollingImpulse = constraint->rollingImpulse;
 
-static inline b2FloatW b2GreaterThanW( b2FloatW a, b2FloatW b )
-{
-	b2FloatW r;
-	r.x = a.x > b.x ? 1.0f : 0.0f;
-	r.y = a.y > b.y ? 1.0f : 0.0f;
-	r.z = a.z > b.z ? 1.0f : 0.0f;
-	r.w = a.w > b.w ? 1.0f : 0.0f;
-	return r;
-}
+		if ( contact->simFlags & b2_simEnableHitEvent )
+		{
+			b2AddHitEvent( world, taskContext, contact );
+		}
+	}
 
-static inline b2FloatW b2EqualsW( b2FloatW a, b2FloatW b )
-{
-	b2FloatW r;
-	r.x = a.x == b.x ? 1.0f : 0.0f;
-	r.y = a.y == b.y ? 1.0f : 0.0f;
-	r.z = a.z == b.z ? 1.0f : 0.0f;
-	r.w = a.w == b.w ? 1.0f : 0.0f;
-	return r;
+	b2TracyCZoneEnd( store_impulses );
 }
 
-static inline bool b2AllZeroW( b2FloatW a )
+void b2PrepareIslandContacts( b2StepContext* context, b2ContactSim** contactSims, b2ContactConstraint* constraints, int count )
 {
-	return a.x == 0.0f && a.y == 0.0f && a.z == 0.0f && a.w == 0.0f;
+	for ( int i = 0; i < count; ++i )
+	{
+		b2PrepareContactConstraint( context, contactSims[i], constraints + i, 1.0f, 1.0f );
+	}
 }
 
-// component-wise returns mask ? b : a
-static inline b2FloatW b2BlendW( b2FloatW a, b2FloatW b, b2FloatW mask )
+void b2StoreIslandImpulses( b2StepContext* context, b2ContactSim** contactSims, const b2ContactConstraint* constraints,
+							int count, int workerIndex )
 {
-	b2FloatW r;
-	r.x = mask.x != 0.0f ? b.x : a.x;
-	r.y = mask.y != 0.0f ? b.y : a.y;
-	r.z = mask.z != 0.0f ? b.z : a.z;
-	r.w = mask.w != 0.0f ? b.w : a.w;
-	return r;
-}
+	b2World* world = context->world;
+	b2TaskContext* taskContext = world->taskContexts.data + workerIndex;
 
-#endif
+	for ( int i = 0; i < count; ++i )
+	{
+		const b2ContactConstraint* constraint = constraints + i;
+		b2ContactSim* contactSim = contactSims[i];
+		b2Manifold* manifold = &contactSim->manifold;
+		int pointCount = manifold->pointCount;
 
-static inline b2FloatW b2DotW( b2Vec2W a, b2Vec2W b )
-{
-	return b2AddW( b2MulW( a.X, b.X ), b2MulW( a.Y, b.Y ) );
-}
+		for ( int j = 0; j < pointCount; ++j )
+		{
+			b2ManifoldPoint* mp = manifold->points + j;
+			mp->normalImpulse = constraint->points[j].normalImpulse;
+			mp->tangentImpulse = constraint->points[j].tangentImpulse;
+			mp->totalNormalImpulse = constraint->points[j].totalNormalImpulse;
+			mp->normalVelocity = constraint->points[j].relativeVelocity;
+		}
 
-static inline b2FloatW b2CrossW( b2Vec2W a, b2Vec2W b )
-{
-	return b2SubW( b2MulW( a.X, b.Y ), b2MulW( a.Y, b.X ) );
-}
+		manifold->rollingImpulse = constraint->rollingImpulse;
 
-static inline b2Vec2W b2RotateVectorW( b2RotW q, b2Vec2W v )
-{
-	return (b2Vec2W){ b2SubW( b2MulW( q.C, v.X ), b2MulW( q.S, v.Y ) ), b2AddW( b2MulW( q.S, v.X ), b2MulW( q.C, v.Y ) ) };
+		if ( contactSim->simFlags & b2_simEnableHitEvent )
+		{
+			b2AddHitEvent( world, taskContext, contactSim );
+		}
+	}
 }
 
 // Soft contact constraints with sub-stepping support
@@ -1067,19 +807,24 @@ static inline b2Vec2W b2RotateVectorW( b2RotW q, b2Vec2W v )
 // http://mmacklin.com/smallsteps.pdf
 // https://box2d.org/files/ErinCatto_SoftConstraints_GDC2011.pdf
 
+// Read by every warm start, solve and relax iteration
 typedef struct b2ContactConstraintWide
 {
 	int indexA[B2_SIMD_WIDTH];
 	int indexB[B2_SIMD_WIDTH];
 
+	// All lanes connect resting bodies so relax iterations can be skipped (adaptive relax)
+	bool resting;
+
+	// Some lane has rolling resistance or restitution, so the cold data must be read
+	bool rolling;
+	bool restitution;
+
 	b2FloatW invMassA, invMassB;
 	b2FloatW invIA, invIB;
 	b2Vec2W normal;
 	b2FloatW friction;
 	b2FloatW tangentSpeed;
-	b2FloatW rollingResistance;
-	b2FloatW rollingMass;
-	b2FloatW rollingImpulse;
 	b2FloatW biasRate;
 	b2FloatW massScale;
 	b2FloatW impulseScale;
@@ -1095,498 +840,303 @@ typedef struct b2ContactConstraintWide
 	b2FloatW totalNormalImpulse2;
 	b2FloatW tangentImpulse2;
 	b2FloatW normalMass2, tangentMass2;
+} b2ContactConstraintWide;
+
+// Rarely used data kept in a parallel array so the iterations stream less memory. Most scenes
+// have no rolling resistance or restitution.
+typedef struct b2ContactConstraintWideCold
+{
+	b2FloatW rollingResistance;
+	b2FloatW rollingMass;
+	b2FloatW rollingImpulse;
 	b2FloatW restitution;
 	b2FloatW relativeVelocity1, relativeVelocity2;
-} b2ContactConstraintWide;
+} b2ContactConstraintWideCold;
 
 int b2GetWideContactConstraintByteCount( void )
 {
 	return sizeof( b2ContactConstraintWide );
 }
 
-// wide version of b2BodyState
-typedef struct b2BodyStateW
+int b2GetWideContactColdByteCount( void )
 {
-	b2Vec2W v;
-	b2FloatW w;
-	b2FloatW flags;
-	b2Vec2W dp;
-	b2RotW dq;
-} b2BodyStateW;
-
-// Custom gather/scatter for each SIMD type
-#if defined( B2_SIMD_AVX2 )
-
-// This is a load and 8x8 transpose
-static b2BodyStateW b2GatherBodies( const b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices )
-{
-	_Static_assert( sizeof( b2BodyState ) == 32, "b2BodyState not 32 bytes" );
-	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
-
-	// zero means null
-	int i1 = indices[0] - 1;
-	int i2 = indices[1] - 1;
-	int i3 = indices[2] - 1;
-	int i4 = indices[3] - 1;
-	int i5 = indices[4] - 1;
-	int i6 = indices[5] - 1;
-	int i7 = indices[6] - 1;
-	int i8 = indices[7] - 1;
-
-	// b2BodyState b2_identityBodyState = {{0.0f, 0.0f}, 0.0f, 0, {0.0f, 0.0f}, {1.0f, 0.0f}};
-	b2FloatW identity = _mm256_setr_ps( 0.0f, 0.0f, 0.0f, 0, 0.0f, 0.0f, 1.0f, 0.0f );
-	b2FloatW b0 = i1 == B2_NULL_INDEX ? identity : _mm256_load_ps( (float*)( states + i1 ) );
-	b2FloatW b1 = i2 == B2_NULL_INDEX ? identity : _mm256_load_ps( (float*)( states + i2 ) );
-	b2FloatW b2 = i3 == B2_NULL_INDEX ? identity : _mm256_load_ps( (float*)( states + i3 ) );
-	b2FloatW b3 = i4 == B2_NULL_INDEX ? identity : _mm256_load_ps( (float*)( states + i4 ) );
-	b2FloatW b4 = i5 == B2_NULL_INDEX ? identity : _mm256_load_ps( (float*)( states + i5 ) );
-	b2FloatW b5 = i6 == B2_NULL_INDEX ? identity : _mm256_load_ps( (float*)( states + i6 ) );
-	b2FloatW b6 = i7 == B2_NULL_INDEX ? identity : _mm256_load_ps( (float*)( states + i7 ) );
-	b2FloatW b7 = i8 == B2_NULL_INDEX ? identity : _mm256_load_ps( (float*)( states + i8 ) );
-
-	b2FloatW t0 = _mm256_unpacklo_ps( b0, b1 );
-	b2FloatW t1 = _mm256_unpackhi_ps( b0, b1 );
-	b2FloatW t2 = _mm256_unpacklo_ps( b2, b3 );
-	b2FloatW t3 = _mm256_unpackhi_ps( b2, b3 );
-	b2FloatW t4 = _mm256_unpacklo_ps( b4, b5 );
-	b2FloatW t5 = _mm256_unpackhi_ps( b4, b5 );
-	b2FloatW t6 = _mm256_unpacklo_ps( b6, b7 );
-	b2FloatW t7 = _mm256_unpackhi_ps( b6, b7 );
-	b2FloatW tt0 = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 1, 0, 1, 0 ) );
-	b2FloatW tt1 = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 3, 2, 3, 2 ) );
-	b2FloatW tt2 = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) );
-	b2FloatW tt3 = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 3, 2, 3, 2 ) );
-	b2FloatW tt4 = _mm256_shuffle_ps( t4, t6, _MM_SHUFFLE( 1, 0, 1, 0 ) );
-	b2FloatW tt5 = _mm256_shuffle_ps( t4, t6, _MM_SHUFFLE( 3, 2, 3, 2 ) );
-	b2FloatW tt6 = _mm256_shuffle_ps( t5, t7, _MM_SHUFFLE( 1, 0, 1, 0 ) );
-	b2FloatW tt7 = _mm256_shuffle_ps( t5, t7, _MM_SHUFFLE( 3, 2, 3, 2 ) );
-
-	b2BodyStateW simdBody;
-	simdBody.v.X = _mm256_permute2f128_ps( tt0, tt4, 0x20 );
-	simdBody.v.Y = _mm256_permute2f128_ps( tt1, tt5, 0x20 );
-	simdBody.w = _mm256_permute2f128_ps( tt2, tt6, 0x20 );
-	simdBody.flags = _mm256_permute2f128_ps( tt3, tt7, 0x20 );
-	simdBody.dp.X = _mm256_permute2f128_ps( tt0, tt4, 0x31 );
-	simdBody.dp.Y = _mm256_permute2f128_ps( tt1, tt5, 0x31 );
-	simdBody.dq.C = _mm256_permute2f128_ps( tt2, tt6, 0x31 );
-	simdBody.dq.S = _mm256_permute2f128_ps( tt3, tt7, 0x31 );
-	return simdBody;
+	return sizeof( b2ContactConstraintWideCold );
 }
 
-// This writes everything back to the solver bodies but only the velocities change
-static void b2ScatterBodies( b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices, const b2BodyStateW* B2_RESTRICT simdBody )
+// The cold data of a color slice of the wide constraints
+static b2ContactConstraintWideCold* b2GetWideContactCold( b2StepContext* context, b2ContactConstraintWide* constraints )
 {
-	_Static_assert( sizeof( b2BodyState ) == 32, "b2BodyState not 32 bytes" );
-	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
-	b2FloatW t0 = _mm256_unpacklo_ps( simdBody->v.X, simdBody->v.Y );
-	b2FloatW t1 = _mm256_unpackhi_ps( simdBody->v.X, simdBody->v.Y );
-	b2FloatW t2 = _mm256_unpacklo_ps( simdBody->w, simdBody->flags );
-	b2FloatW t3 = _mm256_unpackhi_ps( simdBody->w, simdBody->flags );
-	b2FloatW t4 = _mm256_unpacklo_ps( simdBody->dp.X, simdBody->dp.Y );
-	b2FloatW t5 = _mm256_unpackhi_ps( simdBody->dp.X, simdBody->dp.Y );
-	b2FloatW t6 = _mm256_unpacklo_ps( simdBody->dq.C, simdBody->dq.S );
-	b2FloatW t7 = _mm256_unpackhi_ps( simdBody->dq.C, simdBody->dq.S );
-	b2FloatW tt0 = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 1, 0, 1, 0 ) );
-	b2FloatW tt1 = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 3, 2, 3, 2 ) );
-	b2FloatW tt2 = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) );
-	b2FloatW tt3 = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 3, 2, 3, 2 ) );
-	b2FloatW tt4 = _mm256_shuffle_ps( t4, t6, _MM_SHUFFLE( 1, 0, 1, 0 ) );
-	b2FloatW tt5 = _mm256_shuffle_ps( t4, t6, _MM_SHUFFLE( 3, 2, 3, 2 ) );
-	b2FloatW tt6 = _mm256_shuffle_ps( t5, t7, _MM_SHUFFLE( 1, 0, 1, 0 ) );
-	b2FloatW tt7 = _mm256_shuffle_ps( t5, t7, _MM_SHUFFLE( 3, 2, 3, 2 ) );
-
-	// I don't use any dummy body in the body array because this will lead to multithreaded sharing and the
-	// associated cache flushing.
-
-	// zero means null
-	int i1 = indices[0] - 1;
-	int i2 = indices[1] - 1;
-	int i3 = indices[2] - 1;
-	int i4 = indices[3] - 1;
-	int i5 = indices[4] - 1;
-	int i6 = indices[5] - 1;
-	int i7 = indices[6] - 1;
-	int i8 = indices[7] - 1;
-
-	if ( i1 != B2_NULL_INDEX && ( states[i1].flags & b2_dynamicFlag ) != 0 )
-		_mm256_store_ps( (float*)( states + i1 ), _mm256_permute2f128_ps( tt0, tt4, 0x20 ) );
-	if ( i2 != B2_NULL_INDEX && ( states[i2].flags & b2_dynamicFlag ) != 0 )
-		_mm256_store_ps( (float*)( states + i2 ), _mm256_permute2f128_ps( tt1, tt5, 0x20 ) );
-	if ( i3 != B2_NULL_INDEX && ( states[i3].flags & b2_dynamicFlag ) != 0 )
-		_mm256_store_ps( (float*)( states + i3 ), _mm256_permute2f128_ps( tt2, tt6, 0x20 ) );
-	if ( i4 != B2_NULL_INDEX && ( states[i4].flags & b2_dynamicFlag ) != 0 )
-		_mm256_store_ps( (float*)( states + i4 ), _mm256_permute2f128_ps( tt3, tt7, 0x20 ) );
-	if ( i5 != B2_NULL_INDEX && ( states[i5].flags & b2_dynamicFlag ) != 0 )
-		_mm256_store_ps( (float*)( states + i5 ), _mm256_permute2f128_ps( tt0, tt4, 0x31 ) );
-	if ( i6 != B2_NULL_INDEX && ( states[i6].flags & b2_dynamicFlag ) != 0 )
-		_mm256_store_ps( (float*)( states + i6 ), _mm256_permute2f128_ps( tt1, tt5, 0x31 ) );
-	if ( i7 != B2_NULL_INDEX && ( states[i7].flags & b2_dynamicFlag ) != 0 )
-		_mm256_store_ps( (float*)( states + i7 ), _mm256_permute2f128_ps( tt2, tt6, 0x31 ) );
-	if ( i8 != B2_NULL_INDEX && ( states[i8].flags & b2_dynamicFlag ) != 0 )
-		_mm256_store_ps( (float*)( states + i8 ), _mm256_permute2f128_ps( tt3, tt7, 0x31 ) );
+	return context->wideContactColdConstraints + ( constraints - context->wideContactConstraints );
 }
 
-#elif defined( B2_SIMD_NEON )
+// Leaves a lane with null bodies and zero mass, like the remainder lanes. Its impulses stay zero.
+static void b2ClearContactLane( b2ContactConstraintWide* constraint, b2ContactConstraintWideCold* cold, int lane )
+{
+	constraint->indexA[lane] = 0;
+	constraint->indexB[lane] = 0;
+
+	// Past the indices and flags both wide types are made of b2FloatW only
+	float* values = (float*)&constraint->invMassA;
+	int valueCount = (int)( ( sizeof( b2ContactConstraintWide ) - offsetof( b2ContactConstraintWide, invMassA ) ) /
+							sizeof( b2FloatW ) );
+	for ( int i = 0; i < valueCount; ++i )
+	{
+		values[B2_SIMD_WIDTH * i + lane] = 0.0f;
+	}
+
+	float* coldValues = (float*)cold;
+	int coldCount = (int)( sizeof( b2ContactConstraintWideCold ) / sizeof( b2FloatW ) );
+	for ( int i = 0; i < coldCount; ++i )
+	{
+		coldValues[B2_SIMD_WIDTH * i + lane] = 0.0f;
+	}
+}
 
-// This is a load and transpose
-static b2BodyStateW b2GatherBodies( const b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices )
+// Prepare the first laneCount lanes of a wide contact constraint. The other lanes are left as they are.
+static void b2PrepareContactWide( b2StepContext* context, const b2BodyState* states, b2ContactConstraintWide* constraint,
+								  b2ContactConstraintWideCold* cold, const b2ContactSim* contactSims, int laneCount )
 {
-	_Static_assert( sizeof( b2BodyState ) == 32, "b2BodyState not 32 bytes" );
-	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
+	b2World* world = context->world;
+#if B2_ENABLE_VALIDATION
+	b2Body* bodies = world->bodies.data;
+#endif
 
-	// [vx vy w flags]
-	b2FloatW identityA = b2ZeroW();
+	// Stiffer for static contacts to avoid bodies getting pushed through the ground
+	b2Softness contactSoftness = context->contactSoftness;
+	b2Softness staticSoftness = context->staticSoftness;
+	bool enableSoftening = world->enableContactSoftening;
 
-	// [dpx dpy dqc dqs]
+	float warmStartScale = world->enableWarmStarting ? 1.0f : 0.0f;
+	bool enableAdaptiveRelax = world->enableAdaptiveRelax;
 
-	b2FloatW identityB = b2SetW( 0.0f, 0.0f, 1.0f, 0.0f );
+	// Rolling resistance is only applied in the relax iterations
+	bool resting = enableAdaptiveRelax;
+	bool rolling = false;
+	bool restitution = false;
+	bool tangentSpeed = false;
 
-	// zero means null
-	int i1 = indices[0] - 1;
-	int i2 = indices[1] - 1;
-	int i3 = indices[2] - 1;
-	int i4 = indices[3] - 1;
+	for ( int lane = 0; lane < laneCount; ++lane )
+	{
+		const b2ContactSim* contactSim = contactSims + lane;
+		const b2Manifold* manifold = &contactSim->manifold;
 
-	b2FloatW b1a = i1 == B2_NULL_INDEX ? identityA : b2LoadW( (float*)( states + i1 ) + 0 );
-	b2FloatW b1b = i1 == B2_NULL_INDEX ? identityB : b2LoadW( (float*)( states + i1 ) + 4 );
-	b2FloatW b2a = i2 == B2_NULL_INDEX ? identityA : b2LoadW( (float*)( states + i2 ) + 0 );
-	b2FloatW b2b = i2 == B2_NULL_INDEX ? identityB : b2LoadW( (float*)( states + i2 ) + 4 );
-	b2FloatW b3a = i3 == B2_NULL_INDEX ? identityA : b2LoadW( (float*)( states + i3 ) + 0 );
-	b2FloatW b3b = i3 == B2_NULL_INDEX ? identityB : b2LoadW( (float*)( states + i3 ) + 4 );
-	b2FloatW b4a = i4 == B2_NULL_INDEX ? identityA : b2LoadW( (float*)( states + i4 ) + 0 );
-	b2FloatW b4b = i4 == B2_NULL_INDEX ? identityB : b2LoadW( (float*)( states + i4 ) + 4 );
+		int indexA = contactSim->bodySimIndexA;
+		int indexB = contactSim->bodySimIndexB;
 
-	// [vx1 vx3 vy1 vy3]
-	b2FloatW t1a = b2UnpackLoW( b1a, b3a );
+#if B2_ENABLE_VALIDATION
+		b2Body* bodyA = bodies + contactSim->bodyIdA;
+		int validIndexA = bodyA->setIndex == b2_awakeSet ? bodyA->localIndex : B2_NULL_INDEX;
+		b2Body* bodyB = bodies + contactSim->bodyIdB;
+		int validIndexB = bodyB->setIndex == b2_awakeSet ? bodyB->localIndex : B2_NULL_INDEX;
+		B2_ASSERT( indexA == validIndexA );
+		B2_ASSERT( indexB == validIndexB );
+#endif
 
-	// [vx2 vx4 vy2 vy4]
-	b2FloatW t2a = b2UnpackLoW( b2a, b4a );
+		// The island of this contact is solved by its own task
+		uint32_t islandFlags = ( indexA != B2_NULL_INDEX ? states[indexA].flags : 0 ) |
+							   ( indexB != B2_NULL_INDEX ? states[indexB].flags : 0 );
+		if ( islandFlags & b2_isIslandSolved )
+		{
+			b2ClearContactLane( constraint, cold, lane );
+			continue;
+		}
 
-	// [w1 w3 f1 f3]
-	b2FloatW t3a = b2UnpackHiW( b1a, b3a );
+		// 0 for null
+		constraint->indexA[lane] = indexA + 1;
+		constraint->indexB[lane] = indexB + 1;
 
-	// [w2 w4 f2 f4]
-	b2FloatW t4a = b2UnpackHiW( b2a, b4a );
+		b2Vec2 vA = b2Vec2_zero;
+		float wA = 0.0f;
+		float mA = contactSim->invMassA;
+		float iA = contactSim->invIA;
+		if ( indexA != B2_NULL_INDEX )
+		{
+			const b2BodyState* stateA = states + indexA;
+			vA = stateA->linearVelocity;
+			wA = stateA->angularVelocity;
+			resting = resting && ( stateA->flags & b2_isResting );
+		}
 
-	b2BodyStateW simdBody;
-	simdBody.v.X = b2UnpackLoW( t1a, t2a );
-	simdBody.v.Y = b2UnpackHiW( t1a, t2a );
-	simdBody.w = b2UnpackLoW( t3a, t4a );
-	simdBody.flags = b2UnpackHiW( t3a, t4a );
+		b2Vec2 vB = b2Vec2_zero;
+		float wB = 0.0f;
+		float mB = contactSim->invMassB;
+		float iB = contactSim->invIB;
+		if ( indexB != B2_NULL_INDEX )
+		{
+			const b2BodyState* stateB = states + indexB;
+			vB = stateB->linearVelocity;
+			wB = stateB->angularVelocity;
+			resting = resting && ( stateB->flags & b2_isResting );
+		}
 
-	b2FloatW t1b = b2UnpackLoW( b1b, b3b );
-	b2FloatW t2b = b2UnpackLoW( b2b, b4b );
-	b2FloatW t3b = b2UnpackHiW( b1b, b3b );
-	b2FloatW t4b = b2UnpackHiW( b2b, b4b );
+		resting = resting && contactSim->rollingResistance == 0.0f;
+		rolling = rolling || contactSim->rollingResistance > 0.0f;
+		restitution = restitution || contactSim->restitution != 0.0f;
+		tangentSpeed = tangentSpeed || contactSim->tangentSpeed != 0.0f;
 
-	simdBody.dp.X = b2UnpackLoW( t1b, t2b );
-	simdBody.dp.Y = b2UnpackHiW( t1b, t2b );
-	simdBody.dq.C = b2UnpackLoW( t3b, t4b );
-	simdBody.dq.S = b2UnpackHiW( t3b, t4b );
+		( (float*)&constraint->invMassA )[lane] = mA;
+		( (float*)&constraint->invMassB )[lane] = mB;
+		( (float*)&constraint->invIA )[lane] = iA;
+		( (float*)&constraint->invIB )[lane] = iB;
 
-	return simdBody;
-}
+		{
+			float k = iA + iB;
+			( (float*)&cold->rollingMass )[lane] = k > 0.0f ? 1.0f / k : 0.0f;
+		}
 
-// This writes only the velocities back to the solver bodies
-// https://developer.arm.com/documentation/102107a/0100/Floating-point-4x4-matrix-transposition
-static void b2ScatterBodies( b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices, const b2BodyStateW* B2_RESTRICT simdBody )
-{
-	_Static_assert( sizeof( b2BodyState ) == 32, "b2BodyState not 32 bytes" );
-	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
-
-	//	b2FloatW x = b2SetW(0.0f, 1.0f, 2.0f, 3.0f);
-	//	b2FloatW y = b2SetW(4.0f, 5.0f, 6.0f, 7.0f);
-	//	b2FloatW z = b2SetW(8.0f, 9.0f, 10.0f, 11.0f);
-	//	b2FloatW w = b2SetW(12.0f, 13.0f, 14.0f, 15.0f);
-	//
-	//	float32x4x2_t rr1 = vtrnq_f32( x, y );
-	//	float32x4x2_t rr2 = vtrnq_f32( z, w );
-	//
-	//	float32x4_t b1 = vcombine_f32(vget_low_f32(rr1.val[0]), vget_low_f32(rr2.val[0]));
-	//	float32x4_t b2 = vcombine_f32(vget_low_f32(rr1.val[1]), vget_low_f32(rr2.val[1]));
-	//	float32x4_t b3 = vcombine_f32(vget_high_f32(rr1.val[0]), vget_high_f32(rr2.val[0]));
-	//	float32x4_t b4 = vcombine_f32(vget_high_f32(rr1.val[1]), vget_high_f32(rr2.val[1]));
-
-	// transpose
-	float32x4x2_t r1 = vtrnq_f32( simdBody->v.X, simdBody->v.Y );
-	float32x4x2_t r2 = vtrnq_f32( simdBody->w, simdBody->flags );
-
-	// zero means null
-	int i1 = indices[0] - 1;
-	int i2 = indices[1] - 1;
-	int i3 = indices[2] - 1;
-	int i4 = indices[3] - 1;
-
-	// I don't use any dummy body in the body array because this will lead to multithreaded sharing and the
-	// associated cache flushing.
-	if ( i1 != B2_NULL_INDEX && ( states[i1].flags & b2_dynamicFlag ) != 0 )
-	{
-		float32x4_t body1 = vcombine_f32( vget_low_f32( r1.val[0] ), vget_low_f32( r2.val[0] ) );
-		b2StoreW( (float*)( states + i1 ), body1 );
-	}
+		b2Softness soft = contactSoftness;
+		if ( indexA == B2_NULL_INDEX || indexB == B2_NULL_INDEX )
+		{
+			soft = staticSoftness;
+		}
+		else if ( enableSoftening )
+		{
+			// todo experimental feature
+			float contactHertz = b2MinFloat( world->contactHertz, 0.125f * context->inv_h );
+			float ratio = 1.0f;
+			if ( mA < mB )
+			{
+				ratio = b2MaxFloat( 0.5f, mA / mB );
+			}
+			else if ( mB < mA )
+			{
+				ratio = b2MaxFloat( 0.5f, mB / mA );
+			}
+			soft = b2MakeSoft( ratio * contactHertz, ratio * world->contactDampingRatio, context->h );
+		}
 
-	if ( i2 != B2_NULL_INDEX && ( states[i2].flags & b2_dynamicFlag ) != 0 )
-	{
-		float32x4_t body2 = vcombine_f32( vget_low_f32( r1.val[1] ), vget_low_f32( r2.val[1] ) );
-		b2StoreW( (float*)( states + i2 ), body2 );
-	}
+		b2Vec2 normal = manifold->normal;
+		( (float*)&constraint->normal.X )[lane] = normal.x;
+		( (float*)&constraint->normal.Y )[lane] = normal.y;
 
-	if ( i3 != B2_NULL_INDEX && ( states[i3].flags & b2_dynamicFlag ) != 0 )
-	{
-		float32x4_t body3 = vcombine_f32( vget_high_f32( r1.val[0] ), vget_high_f32( r2.val[0] ) );
-		b2StoreW( (float*)( states + i3 ), body3 );
-	}
+		( (float*)&constraint->friction )[lane] = contactSim->friction;
+		( (float*)&constraint->tangentSpeed )[lane] = contactSim->tangentSpeed;
+		( (float*)&cold->restitution )[lane] = contactSim->restitution;
+		( (float*)&cold->rollingResistance )[lane] = contactSim->rollingResistance;
+		( (float*)&cold->rollingImpulse )[lane] = warmStartScale * manifold->rollingImpulse;
 
-	if ( i4 != B2_NULL_INDEX && ( states[i4].flags & b2_dynamicFlag ) != 0 )
-	{
-		float32x4_t body4 = vcombine_f32( vget_high_f32( r1.val[1] ), vget_high_f32( r2.val[1] ) );
-		b2StoreW( (float*)( states + i4 ), body4 );
-	}
-}
+		( (float*)&constraint->biasRate )[lane] = soft.biasRate;
+		( (float*)&constraint->massScale )[lane] = soft.massScale;
+		( (float*)&constraint->impulseScale )[lane] = soft.impulseScale;
 
-#elif defined( B2_SIMD_SSE2 )
+		b2Vec2 tangent = b2RightPerp( normal );
 
-// This is a load and transpose
-static b2BodyStateW b2GatherBodies( const b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices )
-{
-	_Static_assert( sizeof( b2BodyState ) == 32, "b2BodyState not 32 bytes" );
-	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
-	B2_VALIDATE( indices[0] >= 0 && indices[1] >= 0 && indices[2] >= 0 && indices[3] >= 0 );
-
-	// [vx vy w flags]
-	b2FloatW identityA = b2ZeroW();
-
-	// [dpx dpy dqc dqs]
-	b2FloatW identityB = b2SetW( 0.0f, 0.0f, 1.0f, 0.0f );
-
-	// zero means null
-	int i1 = indices[0] - 1;
-	int i2 = indices[1] - 1;
-	int i3 = indices[2] - 1;
-	int i4 = indices[3] - 1;
-
-	b2FloatW b1a = i1 == B2_NULL_INDEX ? identityA : b2LoadW( (float*)( states + i1 ) + 0 );
-	b2FloatW b1b = i1 == B2_NULL_INDEX ? identityB : b2LoadW( (float*)( states + i1 ) + 4 );
-	b2FloatW b2a = i2 == B2_NULL_INDEX ? identityA : b2LoadW( (float*)( states + i2 ) + 0 );
-	b2FloatW b2b = i2 == B2_NULL_INDEX ? identityB : b2LoadW( (float*)( states + i2 ) + 4 );
-	b2FloatW b3a = i3 == B2_NULL_INDEX ? identityA : b2LoadW( (float*)( states + i3 ) + 0 );
-	b2FloatW b3b = i3 == B2_NULL_INDEX ? identityB : b2LoadW( (float*)( states + i3 ) + 4 );
-	b2FloatW b4a = i4 == B2_NULL_INDEX ? identityA : b2LoadW( (float*)( states + i4 ) + 0 );
-	b2FloatW b4b = i4 == B2_NULL_INDEX ? identityB : b2LoadW( (float*)( states + i4 ) + 4 );
-
-	// [vx1 vx3 vy1 vy3]
-	b2FloatW t1a = b2UnpackLoW( b1a, b3a );
-
-	// [vx2 vx4 vy2 vy4]
-	b2FloatW t2a = b2UnpackLoW( b2a, b4a );
-
-	// [w1 w3 f1 f3]
-	b2FloatW t3a = b2UnpackHiW( b1a, b3a );
-
-	// [w2 w4 f2 f4]
-	b2FloatW t4a = b2UnpackHiW( b2a, b4a );
-
-	b2BodyStateW simdBody;
-	simdBody.v.X = b2UnpackLoW( t1a, t2a );
-	simdBody.v.Y = b2UnpackHiW( t1a, t2a );
-	simdBody.w = b2UnpackLoW( t3a, t4a );
-	simdBody.flags = b2UnpackHiW( t3a, t4a );
-
-	b2FloatW t1b = b2UnpackLoW( b1b, b3b );
-	b2FloatW t2b = b2UnpackLoW( b2b, b4b );
-	b2FloatW t3b = b2UnpackHiW( b1b, b3b );
-	b2FloatW t4b = b2UnpackHiW( b2b, b4b );
-
-	simdBody.dp.X = b2UnpackLoW( t1b, t2b );
-	simdBody.dp.Y = b2UnpackHiW( t1b, t2b );
-	simdBody.dq.C = b2UnpackLoW( t3b, t4b );
-	simdBody.dq.S = b2UnpackHiW( t3b, t4b );
-
-	return simdBody;
-}
+		{
+			const b2ManifoldPoint* mp = manifold->points + 0;
 
-// This writes only the velocities back to the solver bodies
-static void b2ScatterBodies( b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices, const b2BodyStateW* B2_RESTRICT simdBody )
-{
-	_Static_assert( sizeof( b2BodyState ) == 32, "b2BodyState not 32 bytes" );
-	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
-	B2_VALIDATE( indices[0] >= 0 && indices[1] >= 0 && indices[2] >= 0 && indices[3] >= 0 );
-
-	// [vx1 vy1 vx2 vy2]
-	b2FloatW t1 = b2UnpackLoW( simdBody->v.X, simdBody->v.Y );
-	// [vx3 vy3 vx4 vy4]
-	b2FloatW t2 = b2UnpackHiW( simdBody->v.X, simdBody->v.Y );
-	// [w1 f1 w2 f2]
-	b2FloatW t3 = b2UnpackLoW( simdBody->w, simdBody->flags );
-	// [w3 f3 w4 f4]
-	b2FloatW t4 = b2UnpackHiW( simdBody->w, simdBody->flags );
-
-	// zero means null
-	int i1 = indices[0] - 1;
-	int i2 = indices[1] - 1;
-	int i3 = indices[2] - 1;
-	int i4 = indices[3] - 1;
-
-#if 1
-	// I don't use any dummy body in the body array because this will lead to multithreaded cache coherence problems.
-	if ( i1 != B2_NULL_INDEX && ( states[i1].flags & b2_dynamicFlag ) != 0 )
-	{
-		// [t1.x t1.y t3.x t3.y]
-		b2StoreW( (float*)( states + i1 ), _mm_shuffle_ps( t1, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) ) );
-	}
+			b2Vec2 rA = mp->anchorA;
+			b2Vec2 rB = mp->anchorB;
 
-	if ( i2 != B2_NULL_INDEX && ( states[i2].flags & b2_dynamicFlag ) != 0 )
-	{
-		// [t1.z t1.w t3.z t3.w]
-		b2StoreW( (float*)( states + i2 ), _mm_shuffle_ps( t1, t3, _MM_SHUFFLE( 3, 2, 3, 2 ) ) );
-	}
+			( (float*)&constraint->anchorA1.X )[lane] = rA.x;
+			( (float*)&constraint->anchorA1.Y )[lane] = rA.y;
+			( (float*)&constraint->anchorB1.X )[lane] = rB.x;
+			( (float*)&constraint->anchorB1.Y )[lane] = rB.y;
 
-	if ( i3 != B2_NULL_INDEX && ( states[i3].flags & b2_dynamicFlag ) != 0 )
-	{
-		// [t2.x t2.y t4.x t4.y]
-		b2StoreW( (float*)( states + i3 ), _mm_shuffle_ps( t2, t4, _MM_SHUFFLE( 1, 0, 1, 0 ) ) );
-	}
+			( (float*)&constraint->baseSeparation1 )[lane] = mp->separation - b2Dot( b2Sub( rB, rA ), normal );
 
-	if ( i4 != B2_NULL_INDEX && ( states[i4].flags & b2_dynamicFlag ) != 0 )
-	{
-		// [t2.z t2.w t4.z t4.w]
-		b2StoreW( (float*)( states + i4 ), _mm_shuffle_ps( t2, t4, _MM_SHUFFLE( 3, 2, 3, 2 ) ) );
-	}
+			( (float*)&constraint->normalImpulse1 )[lane] = warmStartScale * mp->normalImpulse;
+			( (float*)&constraint->tangentImpulse1 )[lane] = warmStartScale * mp->tangentImpulse;
+			( (float*)&constraint->totalNormalImpulse1 )[lane] = 0.0f;
 
-#else
+			float rnA = b2Cross( rA, normal );
+			float rnB = b2Cross( rB, normal );
+			float kNormal = mA + mB + iA * rnA * rnA + iB * rnB * rnB;
+			( (float*)&constraint->normalMass1 )[lane] = kNormal > 0.0f ? 1.0f / kNormal : 0.0f;
 
-	// todo_testing this is here to test the impact of unsafe writes
+			float rtA = b2Cross( rA, tangent );
+			float rtB = b2Cross( rB, tangent );
+			float kTangent = mA + mB + iA * rtA * rtA + iB * rtB * rtB;
+			( (float*)&constraint->tangentMass1 )[lane] = kTangent > 0.0f ? 1.0f / kTangent : 0.0f;
 
-	if ( i1 != B2_NULL_INDEX )
-	{
-		// [t1.x t1.y t3.x t3.y]
-		b2StoreW( (float*)( states + i1 ), _mm_shuffle_ps( t1, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) ) );
-	}
+			// relative velocity for restitution
+			b2Vec2 vrA = b2Add( vA, b2CrossSV( wA, rA ) );
+			b2Vec2 vrB = b2Add( vB, b2CrossSV( wB, rB ) );
+			( (float*)&cold->relativeVelocity1 )[lane] = b2Dot( normal, b2Sub( vrB, vrA ) );
+		}
 
-	if ( i2 != B2_NULL_INDEX )
-	{
-		// [t1.z t1.w t3.z t3.w]
-		b2StoreW( (float*)( states + i2 ), _mm_shuffle_ps( t1, t3, _MM_SHUFFLE( 3, 2, 3, 2 ) ) );
-	}
+		int pointCount = manifold->pointCount;
+		B2_ASSERT( 0 < pointCount && pointCount <= 2 );
 
-	if ( i3 != B2_NULL_INDEX )
-	{
-		// [t2.x t2.y t4.x t4.y]
-		b2StoreW( (float*)( states + i3 ), _mm_shuffle_ps( t2, t4, _MM_SHUFFLE( 1, 0, 1, 0 ) ) );
-	}
+		if ( pointCount == 2 )
+		{
+			const b2ManifoldPoint* mp = manifold->points + 1;
 
-	if ( i4 != B2_NULL_INDEX )
-	{
-		// [t2.z t2.w t4.z t4.w]
-		b2StoreW( (float*)( states + i4 ), _mm_shuffle_ps( t2, t4, _MM_SHUFFLE( 3, 2, 3, 2 ) ) );
-	}
+			b2Vec2 rA = mp->anchorA;
+			b2Vec2 rB = mp->anchorB;
 
-#endif
-}
+			( (float*)&constraint->anchorA2.X )[lane] = rA.x;
+			( (float*)&constraint->anchorA2.Y )[lane] = rA.y;
+			( (float*)&constraint->anchorB2.X )[lane] = rB.x;
+			( (float*)&constraint->anchorB2.Y )[lane] = rB.y;
 
-#else
+			( (float*)&constraint->baseSeparation2 )[lane] = mp->separation - b2Dot( b2Sub( rB, rA ), normal );
 
-// This is a load and transpose
-static b2BodyStateW b2GatherBodies( const b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices )
-{
-	B2_VALIDATE( indices[0] >= 0 && indices[1] >= 0 && indices[2] >= 0 && indices[3] >= 0 );
-
-	b2BodyState identity = b2_identityBodyState;
-
-	// zero means null
-	int i1 = indices[0] - 1;
-	int i2 = indices[1] - 1;
-	int i3 = indices[2] - 1;
-	int i4 = indices[3] - 1;
-
-	b2BodyState s1 = i1 == B2_NULL_INDEX ? identity : states[i1];
-	b2BodyState s2 = i2 == B2_NULL_INDEX ? identity : states[i2];
-	b2BodyState s3 = i3 == B2_NULL_INDEX ? identity : states[i3];
-	b2BodyState s4 = i4 == B2_NULL_INDEX ? identity : states[i4];
-
-	b2BodyStateW simdBody;
-	simdBody.v.X = (b2FloatW){ s1.linearVelocity.x, s2.linearVelocity.x, s3.linearVelocity.x, s4.linearVelocity.x };
-	simdBody.v.Y = (b2FloatW){ s1.linearVelocity.y, s2.linearVelocity.y, s3.linearVelocity.y, s4.linearVelocity.y };
-	simdBody.w = (b2FloatW){ s1.angularVelocity, s2.angularVelocity, s3.angularVelocity, s4.angularVelocity };
-	simdBody.flags = (b2FloatW){ (float)s1.flags, (float)s2.flags, (float)s3.flags, (float)s4.flags };
-	simdBody.dp.X = (b2FloatW){ s1.deltaPosition.x, s2.deltaPosition.x, s3.deltaPosition.x, s4.deltaPosition.x };
-	simdBody.dp.Y = (b2FloatW){ s1.deltaPosition.y, s2.deltaPosition.y, s3.deltaPosition.y, s4.deltaPosition.y };
-	simdBody.dq.C = (b2FloatW){ s1.deltaRotation.c, s2.deltaRotation.c, s3.deltaRotation.c, s4.deltaRotation.c };
-	simdBody.dq.S = (b2FloatW){ s1.deltaRotation.s, s2.deltaRotation.s, s3.deltaRotation.s, s4.deltaRotation.s };
-
-	return simdBody;
-}
+			( (float*)&constraint->normalImpulse2 )[lane] = warmStartScale * mp->normalImpulse;
+			( (float*)&constraint->tangentImpulse2 )[lane] = warmStartScale * mp->tangentImpulse;
+			( (float*)&constraint->totalNormalImpulse2 )[lane] = 0.0f;
 
-// This writes only the velocities back to the solver bodies
-static void b2ScatterBodies( b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices, const b2BodyStateW* B2_RESTRICT simdBody )
-{
-	B2_VALIDATE( indices[0] >= 0 && indices[1] >= 0 && indices[2] >= 0 && indices[3] >= 0 );
+			float rnA = b2Cross( rA, normal );
+			float rnB = b2Cross( rB, normal );
+			float kNormal = mA + mB + iA * rnA * rnA + iB * rnB * rnB;
+			( (float*)&constraint->normalMass2 )[lane] = kNormal > 0.0f ? 1.0f / kNormal : 0.0f;
 
-	// zero means null
-	int i1 = indices[0] - 1;
-	int i2 = indices[1] - 1;
-	int i3 = indices[2] - 1;
-	int i4 = indices[3] - 1;
+			float rtA = b2Cross( rA, tangent );
+			float rtB = b2Cross( rB, tangent );
+			float kTangent = mA + mB + iA * rtA * rtA + iB * rtB * rtB;
+			( (float*)&constraint->tangentMass2 )[lane] = kTangent > 0.0f ? 1.0f / kTangent : 0.0f;
 
-	if ( i1 != B2_NULL_INDEX && ( states[i1].flags & b2_dynamicFlag ) != 0 )
-	{
-		b2BodyState* state = states + i1;
-		state->linearVelocity.x = simdBody->v.X.x;
-		state->linearVelocity.y = simdBody->v.Y.x;
-		state->angularVelocity = simdBody->w.x;
+			// relative velocity for restitution
+			b2Vec2 vrA = b2Add( vA, b2CrossSV( wA, rA ) );
+			b2Vec2 vrB = b2Add( vB, b2CrossSV( wB, rB ) );
+			( (float*)&cold->relativeVelocity2 )[lane] = b2Dot( normal, b2Sub( vrB, vrA ) );
+		}
+		else
+		{
+			// dummy data that has no effect
+			( (float*)&constraint->baseSeparation2 )[lane] = 0.0f;
+			( (float*)&constraint->normalImpulse2 )[lane] = 0.0f;
+			( (float*)&constraint->tangentImpulse2 )[lane] = 0.0f;
+			( (float*)&constraint->totalNormalImpulse2 )[lane] = 0.0f;
+			( (float*)&constraint->anchorA2.X )[lane] = 0.0f;
+			( (float*)&constraint->anchorA2.Y )[lane] = 0.0f;
+			( (float*)&constraint->anchorB2.X )[lane] = 0.0f;
+			( (float*)&constraint->anchorB2.Y )[lane] = 0.0f;
+			( (float*)&constraint->normalMass2 )[lane] = 0.0f;
+			( (float*)&constraint->tangentMass2 )[lane] = 0.0f;
+			( (float*)&cold->relativeVelocity2 )[lane] = 0.0f;
+		}
 	}
 
-	if ( i2 != B2_NULL_INDEX && ( states[i2].flags & b2_dynamicFlag ) != 0 )
-	{
-		b2BodyState* state = states + i2;
-		state->linearVelocity.x = simdBody->v.X.y;
-		state->linearVelocity.y = simdBody->v.Y.y;
-		state->angularVelocity = simdBody->w.y;
-	}
+	constraint->resting = resting;
+	constraint->rolling = rolling;
+	constraint->restitution = restitution;
 
-	if ( i3 != B2_NULL_INDEX && ( states[i3].flags & b2_dynamicFlag ) != 0 )
-	{
-		b2BodyState* state = states + i3;
-		state->linearVelocity.x = simdBody->v.X.z;
-		state->linearVelocity.y = simdBody->v.Y.z;
-		state->angularVelocity = simdBody->w.z;
-	}
+	int features = ( rolling ? b2_contactRolling : 0 ) | ( tangentSpeed ? b2_contactTangentSpeed : 0 ) |
+				   ( restitution ? b2_contactRestitution : 0 );
 
-	if ( i4 != B2_NULL_INDEX && ( states[i4].flags & b2_dynamicFlag ) != 0 )
+	// Read first so the shared value is only written by the first constraint using a feature
+	if ( ( b2AtomicLoadInt( &context->contactFeatures ) & features ) != features )
 	{
-		b2BodyState* state = states + i4;
-		state->linearVelocity.x = simdBody->v.X.w;
-		state->linearVelocity.y = simdBody->v.Y.w;
-		state->angularVelocity = simdBody->w.w;
+		b2AtomicFetchOrInt( &context->contactFeatures, features );
 	}
 }
 
-#endif
-
 // Note: Dirk suggested preparing contacts in the narrow phase. I tried this but it made Box2D slower.
 // The contact preparation is extremely fast in Box2D due to the data layout (b2ContactSim).
+// It is available as an option for large piles, see b2WorldDef::enableFusedPrepare.
 //
 // Runs as a flat parallel-for over the whole wide constraint range. Per-color contact sims
 // are looked up through the prepareSpans cursor rather than the block's colorIndex, so
 // blocks can be uniformly sized without honoring color boundaries. Dead lanes in each
-// color's tail wide slot were all zeroed in solver setup.
+// color's tail wide slot were all zeroed in solver setup. Colors prepared by the narrow
+// phase are skipped.
 void b2PrepareContactsTask( b2SolverBlock block, b2StepContext* context )
 {
 	b2TracyCZoneNC( prepare_contact, "Prepare Contact", b2_colorYellow, true );
-	b2World* world = context->world;
 	b2BodyState* states = context->states;
-#if B2_ENABLE_VALIDATION
-	b2Body* bodies = world->bodies.data;
-#endif
 	b2ContactPrepareSpan* spans = context->contactPrepareSpans;
 	b2ContactConstraintWide* wideBase = context->wideContactConstraints;
-
-	// Stiffer for static contacts to avoid bodies getting pushed through the ground
-	b2Softness contactSoftness = context->contactSoftness;
-	b2Softness staticSoftness = context->staticSoftness;
-	bool enableSoftening = world->enableContactSoftening;
-
-	float warmStartScale = world->enableWarmStarting ? 1.0f : 0.0f;
+	b2ContactConstraintWideCold* coldBase = context->wideContactColdConstraints;
 
 	int wideIndex = block.startIndex;
 	int endWideIndex = block.startIndex + block.count;
@@ -1611,194 +1161,21 @@ void b2PrepareContactsTask( b2SolverBlock block, b2StepContext* context )
 		B2_ASSERT( spans[colorIndex + 1].start - spans[colorIndex].start == expectedWide );
 #endif
 
+		if ( spans[colorIndex].prepared )
+		{
+			wideIndex = colorWideEndIndex;
+			colorIndex += 1;
+			continue;
+		}
+
 		// Loop over color
 		for ( ; wideIndex < colorWideEndIndex; ++wideIndex )
 		{
-			b2ContactConstraintWide* constraint = wideBase + wideIndex;
-			int localWideIndex = wideIndex - colorWideStart;
-
-			for ( int lane = 0; lane < B2_SIMD_WIDTH; ++lane )
-			{
-				int contactIndex = B2_SIMD_WIDTH * localWideIndex + lane;
-				if ( contactIndex >= colorContactCount )
-				{
-					// Remainder lanes were zeroed in solver setup.
-					break;
-				}
-
-				b2ContactSim* contactSim = contactSims + contactIndex;
-				const b2Manifold* manifold = &contactSim->manifold;
-
-				int indexA = contactSim->bodySimIndexA;
-				int indexB = contactSim->bodySimIndexB;
-
-#if B2_ENABLE_VALIDATION
-				b2Body* bodyA = bodies + contactSim->bodyIdA;
-				int validIndexA = bodyA->setIndex == b2_awakeSet ? bodyA->localIndex : B2_NULL_INDEX;
-				b2Body* bodyB = bodies + contactSim->bodyIdB;
-				int validIndexB = bodyB->setIndex == b2_awakeSet ? bodyB->localIndex : B2_NULL_INDEX;
-				B2_ASSERT( indexA == validIndexA );
-				B2_ASSERT( indexB == validIndexB );
-#endif
-
-				// 0 for null
-				constraint->indexA[lane] = indexA + 1;
-				constraint->indexB[lane] = indexB + 1;
-
-				b2Vec2 vA = b2Vec2_zero;
-				float wA = 0.0f;
-				float mA = contactSim->invMassA;
-				float iA = contactSim->invIA;
-				if ( indexA != B2_NULL_INDEX )
-				{
-					b2BodyState* stateA = states + indexA;
-					vA = stateA->linearVelocity;
-					wA = stateA->angularVelocity;
-				}
-
-				b2Vec2 vB = b2Vec2_zero;
-				float wB = 0.0f;
-				float mB = contactSim->invMassB;
-				float iB = contactSim->invIB;
-				if ( indexB != B2_NULL_INDEX )
-				{
-					b2BodyState* stateB = states + indexB;
-					vB = stateB->linearVelocity;
-					wB = stateB->angularVelocity;
-				}
-
-				( (float*)&constraint->invMassA )[lane] = mA;
-				( (float*)&constraint->invMassB )[lane] = mB;
-				( (float*)&constraint->invIA )[lane] = iA;
-				( (float*)&constraint->invIB )[lane] = iB;
-
-				{
-					float k = iA + iB;
-					( (float*)&constraint->rollingMass )[lane] = k > 0.0f ? 1.0f / k : 0.0f;
-				}
-
-				b2Softness soft = contactSoftness;
-				if ( indexA == B2_NULL_INDEX || indexB == B2_NULL_INDEX )
-				{
-					soft = staticSoftness;
-				}
-				else if ( enableSoftening )
-				{
-					// todo experimental feature
-					float contactHertz = b2MinFloat( world->contactHertz, 0.125f * context->inv_h );
-					float ratio = 1.0f;
-					if ( mA < mB )
-					{
-						ratio = b2MaxFloat( 0.5f, mA / mB );
-					}
-					else if ( mB < mA )
-					{
-						ratio = b2MaxFloat( 0.5f, mB / mA );
-					}
-					soft = b2MakeSoft( ratio * contactHertz, ratio * world->contactDampingRatio, context->h );
-				}
-
-				b2Vec2 normal = manifold->normal;
-				( (float*)&constraint->normal.X )[lane] = normal.x;
-				( (float*)&constraint->normal.Y )[lane] = normal.y;
-
-				( (float*)&constraint->friction )[lane] = contactSim->friction;
-				( (float*)&constraint->tangentSpeed )[lane] = contactSim->tangentSpeed;
-				( (float*)&constraint->restitution )[lane] = contactSim->restitution;
-				( (float*)&constraint->rollingResistance )[lane] = contactSim->rollingResistance;
-				( (float*)&constraint->rollingImpulse )[lane] = warmStartScale * manifold->rollingImpulse;
-
-				( (float*)&constraint->biasRate )[lane] = soft.biasRate;
-				( (float*)&constraint->massScale )[lane] = soft.massScale;
-				( (float*)&constraint->impulseScale )[lane] = soft.impulseScale;
-
-				b2Vec2 tangent = b2RightPerp( normal );
-
-				{
-					const b2ManifoldPoint* mp = manifold->points + 0;
-
-					b2Vec2 rA = mp->anchorA;
-					b2Vec2 rB = mp->anchorB;
-
-					( (float*)&constraint->anchorA1.X )[lane] = rA.x;
-					( (float*)&constraint->anchorA1.Y )[lane] = rA.y;
-					( (float*)&constraint->anchorB1.X )[lane] = rB.x;
-					( (float*)&constraint->anchorB1.Y )[lane] = rB.y;
-
-					( (float*)&constraint->baseSeparation1 )[lane] = mp->separation - b2Dot( b2Sub( rB, rA ), normal );
-
-					( (float*)&constraint->normalImpulse1 )[lane] = warmStartScale * mp->normalImpulse;
-					( (float*)&constraint->tangentImpulse1 )[lane] = warmStartScale * mp->tangentImpulse;
-					( (float*)&constraint->totalNormalImpulse1 )[lane] = 0.0f;
-
-					float rnA = b2Cross( rA, normal );
-					float rnB = b2Cross( rB, normal );
-					float kNormal = mA + mB + iA * rnA * rnA + iB * rnB * rnB;
-					( (float*)&constraint->normalMass1 )[lane] = kNormal > 0.0f ? 1.0f / kNormal : 0.0f;
-
-					float rtA = b2Cross( rA, tangent );
-					float rtB = b2Cross( rB, tangent );
-					float kTangent = mA + mB + iA * rtA * rtA + iB * rtB * rtB;
-					( (float*)&constraint->tangentMass1 )[lane] = kTangent > 0.0f ? 1.0f / kTangent : 0.0f;
-
-					// relative velocity for restitution
-					b2Vec2 vrA = b2Add( vA, b2CrossSV( wA, rA ) );
-					b2Vec2 vrB = b2Add( vB, b2CrossSV( wB, rB ) );
-					( (float*)&constraint->relativeVelocity1 )[lane] = b2Dot( normal, b2Sub( vrB, vrA ) );
-				}
-
-				int pointCount = manifold->pointCount;
-				B2_ASSERT( 0 < pointCount && pointCount <= 2 );
-
-				if ( pointCount == 2 )
-				{
-					const b2ManifoldPoint* mp = manifold->points + 1;
-
-					b2Vec2 rA = mp->anchorA;
-					b2Vec2 rB = mp->anchorB;
-
-					( (float*)&constraint->anchorA2.X )[lane] = rA.x;
-					( (float*)&constraint->anchorA2.Y )[lane] = rA.y;
-					( (float*)&constraint->anchorB2.X )[lane] = rB.x;
-					( (float*)&constraint->anchorB2.Y )[lane] = rB.y;
-
-					( (float*)&constraint->baseSeparation2 )[lane] = mp->separation - b2Dot( b2Sub( rB, rA ), normal );
-
-					( (float*)&constraint->normalImpulse2 )[lane] = warmStartScale * mp->normalImpulse;
-					( (float*)&constraint->tangentImpulse2 )[lane] = warmStartScale * mp->tangentImpulse;
-					( (float*)&constraint->totalNormalImpulse2 )[lane] = 0.0f;
-
-					float rnA = b2Cross( rA, normal );
-					float rnB = b2Cross( rB, normal );
-					float kNormal = mA + mB + iA * rnA * rnA + iB * rnB * rnB;
-					( (float*)&constraint->normalMass2 )[lane] = kNormal > 0.0f ? 1.0f / kNormal : 0.0f;
-
-					float rtA = b2Cross( rA, tangent );
-					float rtB = b2Cross( rB, tangent );
-					float kTangent = mA + mB + iA * rtA * rtA + iB * rtB * rtB;
-					( (float*)&constraint->tangentMass2 )[lane] = kTangent > 0.0f ? 1.0f / kTangent : 0.0f;
-
-					// relative velocity for restitution
-					b2Vec2 vrA = b2Add( vA, b2CrossSV( wA, rA ) );
-					b2Vec2 vrB = b2Add( vB, b2CrossSV( wB, rB ) );
-					( (float*)&constraint->relativeVelocity2 )[lane] = b2Dot( normal, b2Sub( vrB, vrA ) );
-				}
-				else
-				{
-					// dummy data that has no effect
-					( (float*)&constraint->baseSeparation2 )[lane] = 0.0f;
-					( (float*)&constraint->normalImpulse2 )[lane] = 0.0f;
-					( (float*)&constraint->tangentImpulse2 )[lane] = 0.0f;
-					( (float*)&constraint->totalNormalImpulse2 )[lane] = 0.0f;
-					( (float*)&constraint->anchorA2.X )[lane] = 0.0f;
-					( (float*)&constraint->anchorA2.Y )[lane] = 0.0f;
-					( (float*)&constraint->anchorB2.X )[lane] = 0.0f;
-					( (float*)&constraint->anchorB2.Y )[lane] = 0.0f;
-					( (float*)&constraint->normalMass2 )[lane] = 0.0f;
-					( (float*)&constraint->tangentMass2 )[lane] = 0.0f;
-					( (float*)&constraint->relativeVelocity2 )[lane] = 0.0f;
-				}
-			}
+			// Remainder lanes were zeroed in solver setup.
+			int contactIndex = B2_SIMD_WIDTH * ( wideIndex - colorWideStart );
+			int laneCount = b2MinInt( B2_SIMD_WIDTH, colorContactCount - contactIndex );
+			b2PrepareContactWide( context, states, wideBase + wideIndex, coldBase + wideIndex, contactSims + contactIndex,
+								  laneCount );
 		}
 
 		// Advance to next color
@@ -1808,18 +1185,51 @@ void b2PrepareContactsTask( b2SolverBlock block, b2StepContext* context )
 	b2TracyCZoneEnd( prepare_contact );
 }
 
-void b2WarmStartContactsTask( b2SolverBlock block, b2StepContext* context )
+void b2PrepareFusedContacts( b2StepContext* context, int wideIndex, const b2ContactSim* contactSims, int laneCount )
+{
+	b2FusedPrepare* fused = &context->fusedPrepare;
+	B2_ASSERT( 0 <= wideIndex && wideIndex < fused->wideCount );
+
+	b2ContactConstraintWide* constraint = fused->constraints + wideIndex;
+	b2ContactConstraintWideCold* cold = fused->colds + wideIndex;
+
+	// The tail of a color has unused lanes
+	if ( laneCount < B2_SIMD_WIDTH )
+	{
+		memset( constraint, 0, sizeof( b2ContactConstraintWide ) );
+		memset( cold, 0, sizeof( b2ContactConstraintWideCold ) );
+	}
+
+	// The awake body states are the ones the solver sees. Waking sets later only appends states.
+	b2BodyState* states = context->world->solverSets.data[b2_awakeSet].bodyStates.data;
+	b2PrepareContactWide( context, states, constraint, cold, contactSims, laneCount );
+}
+
+// The warm start and solve kernels are inlined into a variant for each combination of constant feature
+// arguments, so the features a step does not use cost no branches or loads. The variant is picked from
+// the features of the prepared contacts.
+static B2_FORCE_INLINE void b2WarmStartContactsKernel( b2SolverBlock block, b2StepContext* context, bool enableRolling )
 {
 	b2TracyCZoneNC( warm_start_contact, "Warm Start", b2_colorGreen, true );
 
 	b2BodyState* states = context->states;
 	b2ContactConstraintWide* constraints = context->graph->colors[block.colorIndex].wideConstraints;
+	b2ContactConstraintWideCold* colds = b2GetWideContactCold( context, constraints );
+	int prefetchDistance = context->world->contactPrefetchDistance;
+	int endIndex = block.startIndex + block.count;
 
-	for ( int i = block.startIndex; i < block.startIndex + block.count; ++i )
+	for ( int i = block.startIndex; i < endIndex; ++i )
 	{
+		if ( prefetchDistance > 0 && i + prefetchDistance < endIndex )
+		{
+			b2ContactConstraintWide* ahead = constraints + i + prefetchDistance;
+			b2PrefetchBodies( states, ahead->indexA );
+			b2PrefetchBodies( states, ahead->indexB );
+		}
+
 		b2ContactConstraintWide* c = constraints + i;
-		b2BodyStateW bA = b2GatherBodies( states, c->indexA );
-		b2BodyStateW bB = b2GatherBodies( states, c->indexB );
+		b2BodyStateW bA = b2GatherVelocities( states, c->indexA );
+		b2BodyStateW bB = b2GatherVelocities( states, c->indexB );
 
 		b2FloatW tangentX = c->normal.Y;
 		b2FloatW tangentY = b2SubW( b2ZeroW(), c->normal.X );
@@ -1860,8 +1270,13 @@ void b2WarmStartContactsTask( b2SolverBlock block, b2StepContext* context )
 			c->totalNormalImpulse2 = b2AddW( c->totalNormalImpulse2, c->normalImpulse2 );
 		}
 
-		bA.w = b2MulSubW( bA.w, c->invIA, c->rollingImpulse );
-		bB.w = b2MulAddW( bB.w, c->invIB, c->rollingImpulse );
+		B2_ASSERT( enableRolling || c->rolling == false );
+		if ( enableRolling && c->rolling )
+		{
+			b2FloatW rollingImpulse = colds[i].rollingImpulse;
+			bA.w = b2MulSubW( bA.w, c->invIA, rollingImpulse );
+			bB.w = b2MulAddW( bB.w, c->invIB, rollingImpulse );
+		}
 
 		b2ScatterBodies( states, c->indexA, &bA );
 		b2ScatterBodies( states, c->indexB, &bB );
@@ -1870,21 +1285,60 @@ void b2WarmStartContactsTask( b2SolverBlock block, b2StepContext* context )
 	b2TracyCZoneEnd( warm_start_contact );
 }
 
-void b2SolveContactsTask( b2SolverBlock block, b2StepContext* context, bool useBias )
+static void b2WarmStartContactsPlain( b2SolverBlock block, b2StepContext* context )
+{
+	b2WarmStartContactsKernel( block, context, false );
+}
+
+static void b2WarmStartContactsRolling( b2SolverBlock block, b2StepContext* context )
+{
+	b2WarmStartContactsKernel( block, context, true );
+}
+
+void b2WarmStartContactsTask( b2SolverBlock block, b2StepContext* context )
+{
+	if ( b2AtomicLoadInt( &context->contactFeatures ) & b2_contactRolling )
+	{
+		b2WarmStartContactsRolling( block, context );
+	}
+	else
+	{
+		b2WarmStartContactsPlain( block, context );
+	}
+}
+
+static B2_FORCE_INLINE void b2SolveContactsKernel( b2SolverBlock block, b2StepContext* context, bool useBias, bool enableRolling,
+												   bool enableTangentSpeed )
 {
 	b2TracyCZoneNC( solve_contact, "Solve Contact", b2_colorAliceBlue, true );
 
 	b2BodyState* states = context->states;
 	b2GraphColor* color = context->graph->colors + block.colorIndex;
 	b2ContactConstraintWide* constraints = color->wideConstraints;
+	b2ContactConstraintWideCold* colds = b2GetWideContactCold( context, constraints );
 	b2FloatW inv_h = b2SplatW( context->inv_h );
 	b2FloatW contactSpeed = b2SplatW( -context->world->contactSpeed );
 	b2FloatW oneW = b2SplatW( 1.0f );
+	int prefetchDistance = context->world->contactPrefetchDistance;
+	int endIndex = block.startIndex + block.count;
 
-	for ( int wideIndex = block.startIndex; wideIndex < block.startIndex + block.count; ++wideIndex )
+	for ( int wideIndex = block.startIndex; wideIndex < endIndex; ++wideIndex )
 	{
+		if ( prefetchDistance > 0 && wideIndex + prefetchDistance < endIndex )
+		{
+			b2ContactConstraintWide* ahead = constraints + wideIndex + prefetchDistance;
+			b2PrefetchBodies( states, ahead->indexA );
+			b2PrefetchBodies( states, ahead->indexB );
+		}
+
 		b2ContactConstraintWide* c = constraints + wideIndex;
 
+		if ( useBias == false && c->resting )
+		{
+			// Resting bodies have almost no bias velocity to remove
+			continue;
+		}
+
 		b2BodyStateW bA = b2GatherBodies( states, c->indexA );
 		b2BodyStateW bB = b2GatherBodies( states, c->indexB );
 
@@ -2018,13 +1472,15 @@ void b2SolveContactsTask( b2SolverBlock block, b2StepContext* context, bool useB
 		if (useBias == false)
 		{
 			// Rolling resistance
-			if ( b2AllZeroW( c->rollingResistance ) == false )
+			B2_ASSERT( enableRolling || c->rolling == false );
+			if ( enableRolling && c->rolling )
 			{
-				b2FloatW deltaLambda = b2MulW( c->rollingMass, b2SubW( bA.w, bB.w ) );
-				b2FloatW lambda = c->rollingImpulse;
-				b2FloatW maxLambda = b2MulW( c->rollingResistance, totalNormalImpulse );
-				c->rollingImpulse = b2SymClampW( b2AddW( lambda, deltaLambda ), maxLambda );
-				deltaLambda = b2SubW( c->rollingImpulse, lambda );
+				b2ContactConstraintWideCold* cold = colds + wideIndex;
+				b2FloatW deltaLambda = b2MulW( cold->rollingMass, b2SubW( bA.w, bB.w ) );
+				b2FloatW lambda = cold->rollingImpulse;
+				b2FloatW maxLambda = b2MulW( cold->rollingResistance, totalNormalImpulse );
+				cold->rollingImpulse = b2SymClampW( b2AddW( lambda, deltaLambda ), maxLambda );
+				deltaLambda = b2SubW( cold->rollingImpulse, lambda );
 
 				bA.w = b2MulSubW( bA.w, c->invIA, deltaLambda );
 				bB.w = b2MulAddW( bB.w, c->invIB, deltaLambda );
@@ -2045,7 +1501,10 @@ void b2SolveContactsTask( b2SolverBlock block, b2StepContext* context, bool useB
 				b2FloatW vt = b2AddW( b2MulW( dvx, tangentX ), b2MulW( dvy, tangentY ) );
 
 				// Tangent speed (conveyor belt)
-				vt = b2SubW( vt, c->tangentSpeed );
+				if ( enableTangentSpeed )
+				{
+					vt = b2SubW( vt, c->tangentSpeed );
+				}
 
 				// Compute tangent force
 				b2FloatW negImpulse = b2MulW( c->tangentMass1, vt );
@@ -2082,7 +1541,10 @@ void b2SolveContactsTask( b2SolverBlock block, b2StepContext* context, bool useB
 				b2FloatW vt = b2AddW( b2MulW( dvx, tangentX ), b2MulW( dvy, tangentY ) );
 
 				// Tangent speed (conveyor belt)
-				vt = b2SubW( vt, c->tangentSpeed );
+				if ( enableTangentSpeed )
+				{
+					vt = b2SubW( vt, c->tangentSpeed );
+				}
 
 				// Compute tangent force
 				b2FloatW negImpulse = b2MulW( c->tangentMass2, vt );
@@ -2115,36 +1577,83 @@ void b2SolveContactsTask( b2SolverBlock block, b2StepContext* context, bool useB
 	b2TracyCZoneEnd( solve_contact );
 }
 
+typedef void b2ContactKernelFcn( b2SolverBlock block, b2StepContext* context );
+
+#define B2_SOLVE_CONTACTS_VARIANT( name, useBias, enableRolling, enableTangentSpeed )                                            \
+	static void name( b2SolverBlock block, b2StepContext* context )                                                              \
+	{                                                                                                                            \
+		b2SolveContactsKernel( block, context, useBias, enableRolling, enableTangentSpeed );                                     \
+	}
+
+B2_SOLVE_CONTACTS_VARIANT( b2SolveContactsPlain, true, false, false )
+B2_SOLVE_CONTACTS_VARIANT( b2SolveContactsRolling, true, true, false )
+B2_SOLVE_CONTACTS_VARIANT( b2SolveContactsTangent, true, false, true )
+B2_SOLVE_CONTACTS_VARIANT( b2SolveContactsFull, true, true, true )
+B2_SOLVE_CONTACTS_VARIANT( b2RelaxContactsPlain, false, false, false )
+B2_SOLVE_CONTACTS_VARIANT( b2RelaxContactsRolling, false, true, false )
+B2_SOLVE_CONTACTS_VARIANT( b2RelaxContactsTangent, false, false, true )
+B2_SOLVE_CONTACTS_VARIANT( b2RelaxContactsFull, false, true, true )
+
+#undef B2_SOLVE_CONTACTS_VARIANT
+
+// Indexed by the rolling and tangent speed bits of b2ContactFeatures
+static b2ContactKernelFcn* const b2_solveContactKernels[4] = {
+	b2SolveContactsPlain,
+	b2SolveContactsRolling,
+	b2SolveContactsTangent,
+	b2SolveContactsFull,
+};
+
+static b2ContactKernelFcn* const b2_relaxContactKernels[4] = {
+	b2RelaxContactsPlain,
+	b2RelaxContactsRolling,
+	b2RelaxContactsTangent,
+	b2RelaxContactsFull,
+};
+
+void b2SolveContactsTask( b2SolverBlock block, b2StepContext* context, bool useBias )
+{
+	int features = b2AtomicLoadInt( &context->contactFeatures ) & ( b2_contactRolling | b2_contactTangentSpeed );
+	b2ContactKernelFcn* kernel = useBias ? b2_solveContactKernels[features] : b2_relaxContactKernels[features];
+	kernel( block, context );
+}
+
 void b2ApplyRestitutionTask( b2SolverBlock block, b2StepContext* context )
 {
 	b2TracyCZoneNC( restitution, "Restitution", b2_colorDodgerBlue, true );
 
 	b2BodyState* states = context->states;
 	b2ContactConstraintWide* constraints = context->graph->colors[block.colorIndex].wideConstraints;
+	b2ContactConstraintWideCold* colds = b2GetWideContactCold( context, constraints );
 	b2FloatW threshold = b2SplatW( context->world->restitutionThreshold );
 	b2FloatW zero = b2ZeroW();
 
-	for ( int i = block.startIndex; i < block.startIndex + block.count; ++i )
+	// Skip the scan over the constraints if no contact has restitution
+	int blockCount = ( b2AtomicLoadInt( &context->contactFeatures ) & b2_contactRestitution ) ? block.count : 0;
+
+	for ( int i = block.startIndex; i < block.startIndex + blockCount; ++i )
 	{
 		b2ContactConstraintWide* c = constraints + i;
 
-		if ( b2AllZeroW( c->restitution ) )
+		if ( c->restitution == false )
 		{
 			// No lanes have restitution. Common case.
 			continue;
 		}
 
+		b2ContactConstraintWideCold* cold = colds + i;
+
 		// Create a mask based on restitution so that lanes with no restitution are not affected
 		// by the calculations below.
-		b2FloatW restitutionMask = b2EqualsW( c->restitution, zero );
+		b2FloatW restitutionMask = b2EqualsW( cold->restitution, zero );
 
-		b2BodyStateW bA = b2GatherBodies( states, c->indexA );
-		b2BodyStateW bB = b2GatherBodies( states, c->indexB );
+		b2BodyStateW bA = b2GatherVelocities( states, c->indexA );
+		b2BodyStateW bB = b2GatherVelocities( states, c->indexB );
 
 		// first point non-penetration constraint
 		{
 			// Set effective mass to zero if restitution should not be applied
-			b2FloatW mask1 = b2GreaterThanW( b2AddW( c->relativeVelocity1, threshold ), zero );
+			b2FloatW mask1 = b2GreaterThanW( b2AddW( cold->relativeVelocity1, threshold ), zero );
 			b2FloatW mask2 = b2EqualsW( c->totalNormalImpulse1, zero );
 			b2FloatW mask = b2OrW( b2OrW( mask1, mask2 ), restitutionMask );
 			b2FloatW mass = b2BlendW( c->normalMass1, zero, mask );
@@ -2159,7 +1668,7 @@ void b2ApplyRestitutionTask( b2SolverBlock block, b2StepContext* context )
 			b2FloatW vn = b2AddW( b2MulW( dvx, c->normal.X ), b2MulW( dvy, c->normal.Y ) );
 
 			// Compute normal impulse
-			b2FloatW negImpulse = b2MulW( mass, b2AddW( vn, b2MulW( c->restitution, c->relativeVelocity1 ) ) );
+			b2FloatW negImpulse = b2MulW( mass, b2AddW( vn, b2MulW( cold->restitution, cold->relativeVelocity1 ) ) );
 
 			// Clamp the accumulated impulse
 			b2FloatW newImpulse = b2MaxW( b2SubW( c->normalImpulse1, negImpulse ), b2ZeroW() );
@@ -2183,7 +1692,7 @@ void b2ApplyRestitutionTask( b2SolverBlock block, b2StepContext* context )
 		// second point non-penetration constraint
 		{
 			// Set effective mass to zero if restitution should not be applied
-			b2FloatW mask1 = b2GreaterThanW( b2AddW( c->relativeVelocity2, threshold ), zero );
+			b2FloatW mask1 = b2GreaterThanW( b2AddW( cold->relativeVelocity2, threshold ), zero );
 			b2FloatW mask2 = b2EqualsW( c->totalNormalImpulse2, zero );
 			b2FloatW mask = b2OrW( b2OrW( mask1, mask2 ), restitutionMask );
 			b2FloatW mass = b2BlendW( c->normalMass2, zero, mask );
@@ -2198,7 +1707,7 @@ void b2ApplyRestitutionTask( b2SolverBlock block, b2StepContext* context )
 			b2FloatW vn = b2AddW( b2MulW( dvx, c->normal.X ), b2MulW( dvy, c->normal.Y ) );
 
 			// Compute normal impulse
-			b2FloatW negImpulse = b2MulW( mass, b2AddW( vn, b2MulW( c->restitution, c->relativeVelocity2 ) ) );
+			b2FloatW negImpulse = b2MulW( mass, b2AddW( vn, b2MulW( cold->restitution, cold->relativeVelocity2 ) ) );
 
 			// Clamp the accumulated impulse
 			b2FloatW newImpulse = b2MaxW( b2SubW( c->normalImpulse2, negImpulse ), b2ZeroW() );
@@ -2242,10 +1751,10 @@ void b2StoreImpulsesTask( b2SolverBlock block, b2StepContext* context, int worke
 	b2World* world = context->world;
 	const b2ContactPrepareSpan* spans = context->contactPrepareSpans;
 	const b2ContactConstraintWide* wideBase = context->wideContactConstraints;
+	const b2ContactConstraintWideCold* coldBase = context->wideContactColdConstraints;
 	b2TaskContext* taskContext = world->taskContexts.data + workerIndex;
-	b2BitSet* hitEventBitSet = &taskContext->hitEventBitSet;
-	bool hasHitEvents = taskContext->hasHitEvents;
-	float negHitThreshold = -world->hitEventThreshold;
+	b2FloatW negHitThreshold = b2SplatW( -world->hitEventThreshold );
+	b2FloatW zero = b2ZeroW();
 
 	int wideIndex = block.startIndex;
 	int endWideIndex = block.startIndex + block.count;
@@ -2267,19 +1776,28 @@ void b2StoreImpulsesTask( b2SolverBlock block, b2StepContext* context, int worke
 		for ( ; wideIndex < colorWideEndIndex; ++wideIndex )
 		{
 			const b2ContactConstraintWide* c = wideBase + wideIndex;
-			const float* rollingImpulse = (float*)&c->rollingImpulse;
+			const b2ContactConstraintWideCold* cold = coldBase + wideIndex;
+			const float* rollingImpulse = (float*)&cold->rollingImpulse;
 			const float* normalImpulse1 = (float*)&c->normalImpulse1;
 			const float* normalImpulse2 = (float*)&c->normalImpulse2;
 			const float* tangentImpulse1 = (float*)&c->tangentImpulse1;
 			const float* tangentImpulse2 = (float*)&c->tangentImpulse2;
 			const float* totalNormalImpulse1 = (float*)&c->totalNormalImpulse1;
 			const float* totalNormalImpulse2 = (float*)&c->totalNormalImpulse2;
-			const float* normalVelocity1 = (float*)&c->relativeVelocity1;
-			const float* normalVelocity2 = (float*)&c->relativeVelocity2;
+			const float* normalVelocity1 = (float*)&cold->relativeVelocity1;
+			const float* normalVelocity2 = (float*)&cold->relativeVelocity2;
 
 			int localWideIndex = wideIndex - colorWideStart;
 			int baseIndex = B2_SIMD_WIDTH * localWideIndex;
 
+			// Lanes with a point approaching faster than the hit threshold. Need to check total impulse because
+			// the point may be speculative and not colliding. Unused second points have no impulse.
+			b2FloatW hit1 = b2BlendW( zero, b2GreaterThanW( c->totalNormalImpulse1, zero ),
+									  b2GreaterThanW( negHitThreshold, cold->relativeVelocity1 ) );
+			b2FloatW hit2 = b2BlendW( zero, b2GreaterThanW( c->totalNormalImpulse2, zero ),
+									  b2GreaterThanW( negHitThreshold, cold->relativeVelocity2 ) );
+			bool anyHit = b2AllZeroW( b2OrW( hit1, hit2 ) ) == false;
+
 			for ( int laneIndex = 0; laneIndex < B2_SIMD_WIDTH; ++laneIndex )
 			{
 				int contactIndex = baseIndex + laneIndex;
@@ -2288,6 +1806,12 @@ void b2StoreImpulsesTask( b2SolverBlock block, b2StepContext* context, int worke
 					break;
 				}
 
+				// Cleared lane of a contact solved with its island
+				if ( c->indexA[laneIndex] == 0 && c->indexB[laneIndex] == 0 )
+				{
+					continue;
+				}
+
 				b2ContactSim* contactSim = contactSims + contactIndex;
 				b2Manifold* m = &contactSim->manifold;
 				m->rollingImpulse = rollingImpulse[laneIndex];
@@ -2302,21 +1826,9 @@ void b2StoreImpulsesTask( b2SolverBlock block, b2StepContext* context, int worke
 				m->points[1].totalNormalImpulse = totalNormalImpulse2[laneIndex];
 				m->points[1].normalVelocity = normalVelocity2[laneIndex];
 
-				// Check for hit events to speed up serial processing later in the step
-				if ( ( contactSim->simFlags & b2_simEnableHitEvent ) != 0 )
+				if ( anyHit && ( contactSim->simFlags & b2_simEnableHitEvent ) != 0 )
 				{
-					for (int k = 0; k < contactSim->manifold.pointCount; ++k)
-					{
-						b2ManifoldPoint* mp = m->points + k;
-
-						// Need to check total impulse because the point may be speculative and not colliding
-						if ( mp->normalVelocity < negHitThreshold && mp->totalNormalImpulse > 0.0f )
-						{
-							b2SetBit( hitEventBitSet, contactSim->contactId );
-							hasHitEvents = true;
-							break;
-						}
-					}
+					b2AddHitEvent( world, taskContext, contactSim );
 				}
 			}
 		}
@@ -2325,7 +1837,5 @@ void b2StoreImpulsesTask( b2SolverBlock block, b2StepContext* context, int worke
 		colorIndex += 1;
 	}
 
-	taskContext->hasHitEvents = hasHitEvents;
-
 	b2TracyCZoneEnd( store_impulses );
 }
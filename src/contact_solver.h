@@ -38,18 +38,65 @@ typedef struct b2ContactConstraint
 	int pointCount;
 } b2ContactConstraint;
 
+// Velocities of the two bodies of an overflow contact. The parallel overflow solver stores the velocity
+// change of each contact in this form and sums them per body afterwards.
+typedef struct b2ContactVelocities
+{
+	b2Vec2 linearVelocityA;
+	float angularVelocityA;
+	b2Vec2 linearVelocityB;
+	float angularVelocityB;
+} b2ContactVelocities;
+
+// A body touched by overflow contacts. The entries are indices into the overflow velocity
+// deltas, 2 * contact + side, in contact order so the sum does not depend on the worker count.
+typedef struct b2OverflowBody
+{
+	int stateIndex;
+	int entryStart;
+	int entryCount;
+} b2OverflowBody;
+
 // This function allows hiding SIMD intrinsics in the source file to improve compilation performance.
 int b2GetWideContactConstraintByteCount( void );
+int b2GetWideContactColdByteCount( void );
 
 // Overflow contacts don't fit into the constraint graph coloring
 void b2PrepareContacts_Overflow( b2StepContext* context );
 void b2WarmStartContacts_Overflow( b2StepContext* context );
 void b2SolveContacts_Overflow( b2StepContext* context, bool useBias );
 void b2ApplyRestitution_Overflow( b2StepContext* context );
-void b2StoreImpulses_Overflow( b2StepContext* context );
+void b2StoreImpulses_Overflow( b2StepContext* context, int workerIndex );
+
+// Scalar solver over a list of contact constraints
+void b2WarmStartContactConstraints( b2StepContext* context, b2ContactConstraint* constraints, int count );
+void b2SolveContactConstraints( b2StepContext* context, b2ContactConstraint* constraints, int count, bool useBias );
+void b2ApplyContactRestitution( b2StepContext* context, b2ContactConstraint* constraints, int count );
+
+// Contacts of a small island solved by one worker, see b2WorldDef::islandSolveBodyCount
+void b2PrepareIslandContacts( b2StepContext* context, b2ContactSim** contactSims, b2ContactConstraint* constraints, int count );
+void b2StoreIslandImpulses( b2StepContext* context, b2ContactSim** contactSims, const b2ContactConstraint* constraints,
+							int count, int workerIndex );
+
+// Parallel overflow mode. Each overflow contact is solved against the body velocities from the
+// start of the pass (Jacobi) with masses split by the number of overflow contacts on the body.
+// The velocity changes are then summed per body. The pass type is context->overflowStage.
+void b2SolveOverflowContactsTask( b2SolverBlock block, b2StepContext* context );
+void b2ApplyOverflowDeltasTask( b2SolverBlock block, b2StepContext* context );
 
 // Contacts that live within the constraint graph coloring
 void b2PrepareContactsTask( b2SolverBlock block, b2StepContext* context );
+
+// Prepare a wide constraint of context->fusedPrepare from laneCount contacts of its color during the narrow phase
+void b2PrepareFusedContacts( b2StepContext* context, int wideIndex, const b2ContactSim* contactSims, int laneCount );
+// Optional contact solver features. The wide kernels are specialized for the features used in a step.
+typedef enum b2ContactFeatures
+{
+	b2_contactRolling = 0x1,
+	b2_contactTangentSpeed = 0x2,
+	b2_contactRestitution = 0x4,
+} b2ContactFeatures;
+
 void b2WarmStartContactsTask( b2SolverBlock block, b2StepContext* context );
 void b2SolveContactsTask( b2SolverBlock block, b2StepContext* context, bool useBias );
 void b2ApplyRestitutionTask( b2SolverBlock block, b2StepContext* context );
@@ -71,6 +71,33 @@
 	}                                                                                                                            \
 	while ( 0 )
 
+// Reserve room for n elements, at least doubling the capacity so repeated bulk appends stay amortized
+#define b2Array_ReserveGrow( a, n )                                                                                              \
+	do                                                                                                                           \
+	{                                                                                                                            \
+		if ( ( a ).capacity < ( n ) )                                                                                            \
+		{                                                                                                                        \
+			int newCapacity = 2 * ( a ).capacity > ( n ) ? 2 * ( a ).capacity : ( n );                                           \
+			b2Array_Reserve( a, newCapacity );                                                                                   \
+		}                                                                                                                        \
+	}                                                                                                                            \
+	while ( 0 )
+
+// Release unused capacity, keeping at least n elements of storage
+#define b2Array_ShrinkToFit( a, n )                                                                                              \
+	do                                                                                                                           \
+	{                                                                                                                            \
+		int newCapacity = ( a ).count > ( n ) ? ( a ).count : ( n );                                                             \
+		if ( newCapacity < ( a ).capacity )                                                                                      \
+		{                                                                                                                        \
+			int oldSize = ( a ).capacity * sizeof( *( a ).data );                                                                \
+			int newSize = newCapacity * sizeof( *( a ).data );                                                                   \
+			( a ).data = b2ShrinkAlloc( ( a ).data, oldSize, newSize );                                                          \
+			( a ).capacity = newCapacity;                                                                                        \
+		}                                                                                                                        \
+	}                                                                                                                            \
+	while ( 0 )
+
 #define b2Array_Resize( a, n )                                                                                                   \
 	do                                                                                                                           \
 	{                                                                                                                            \
@@ -106,6 +133,20 @@
 	}                                                                                                                            \
 	while ( 0 )
 
+// Append all elements of b to a
+#define b2Array_Append( a, b )                                                                                                   \
+	do                                                                                                                           \
+	{                                                                                                                            \
+		if ( ( b ).count > 0 )                                                                                                   \
+		{                                                                                                                        \
+			int baseCount = ( a ).count;                                                                                         \
+			b2Array_ReserveGrow( a, baseCount + ( b ).count );                                                                   \
+			memcpy( ( a ).data + baseCount, ( b ).data, ( b ).count * sizeof( *( a ).data ) );                                   \
+			( a ).count = baseCount + ( b ).count;                                                                               \
+		}                                                                                                                        \
+	}                                                                                                                            \
+	while ( 0 )
+
 // Get a pointer to an element
 #define b2Array_Get( a, index ) ( B2_ASSERT( 0 <= (index) && (index) < ( a ).count ), ( a ).data + (index) )
 
@@ -156,4 +197,6 @@ B2_INLINE int b2RemoveHelper( void* data, int* count, int index, int elementSize
 
 #define b2Array_ByteCount( a ) ( ( a ).capacity * (int)sizeof( *( a ).data ) )
 
+b2DeclareArray( b2Vec2 );
+b2DeclareArrayNative( float );
 b2DeclareArrayNative( int );
@@ -17,19 +17,6 @@
 #include <stdio.h>
 #include <string.h>
 
-#ifdef BOX2D_PROFILE
-
-#include <tracy/TracyC.h>
-#define b2TracyCAlloc( ptr, size ) TracyCAlloc( ptr, size )
-#define b2TracyCFree( ptr ) TracyCFree( ptr )
-
-#else
-
-#define b2TracyCAlloc( ptr, size )
-#define b2TracyCFree( ptr )
-
-#endif
-
 #include "atomic.h"
 
 // This allows the user to change the length units at runtime
@@ -108,18 +95,57 @@ b2Version b2GetVersion( void )
 }
 
 static b2AllocFcn* b2_allocFcn = NULL;
+static b2AllocTaggedFcn* b2_allocTaggedFcn = NULL;
 static b2FreeFcn* b2_freeFcn = NULL;
 
+static B2_THREAD_LOCAL b2AllocInfo b2_allocInfo = { b2_allocTagDefault, b2_allocLifetimeLong, B2_NULL_INDEX };
+
 static b2AtomicInt b2_byteCount;
+static b2AtomicInt b2_allocationCount;
 
 void b2SetAllocator( b2AllocFcn* allocFcn, b2FreeFcn* freeFcn )
 {
 	b2_allocFcn = allocFcn;
+	b2_allocTaggedFcn = NULL;
+	b2_freeFcn = freeFcn;
+}
+
+void b2SetTaggedAllocator( b2AllocTaggedFcn* allocFcn, b2FreeFcn* freeFcn )
+{
+	b2_allocFcn = NULL;
+	b2_allocTaggedFcn = allocFcn;
 	b2_freeFcn = freeFcn;
 }
 
-// Use 32 byte alignment for everything. Works with 256bit SIMD.
-#define B2_ALIGNMENT 32
+b2AllocInfo b2PushAllocTag( b2AllocTag tag, b2AllocLifetime lifetime )
+{
+	b2AllocInfo previous = b2_allocInfo;
+	b2_allocInfo.tag = tag;
+	b2_allocInfo.lifetime = lifetime;
+	return previous;
+}
+
+b2AllocInfo b2PushAllocWorld( int worldIndex )
+{
+	b2AllocInfo previous = b2_allocInfo;
+	b2_allocInfo = (b2AllocInfo){ b2_allocTagWorld, b2_allocLifetimeLong, worldIndex };
+	return previous;
+}
+
+void b2PopAllocInfo( b2AllocInfo info )
+{
+	b2_allocInfo = info;
+}
+
+void* b2AllocTagged( int size, b2AllocTag tag, b2AllocLifetime lifetime )
+{
+	b2AllocInfo previous = b2PushAllocTag( tag, lifetime );
+	void* ptr = b2Alloc( size );
+	b2PopAllocInfo( previous );
+	return ptr;
+}
+
+// B2_ALIGNMENT is 32 bytes for everything except AVX-512, which needs 64 bytes.
 
 void* b2Alloc( int size )
 {
@@ -130,10 +156,22 @@ void* b2Alloc( int size )
 
 	// This could cause some sharing issues, however Box2D rarely calls b2Alloc.
 	b2AtomicFetchAddInt( &b2_byteCount, size );
+	b2AtomicFetchAddInt( &b2_allocationCount, 1 );
 
-	// Allocation must be a multiple of 32 or risk a seg fault
+	// Allocation must be a multiple of the alignment or risk a seg fault
 	// https://en.cppreference.com/w/c/memory/aligned_alloc
-	int size32 = ( ( size - 1 ) | 0x1F ) + 1;
+	int size32 = ( ( size - 1 ) | ( B2_ALIGNMENT - 1 ) ) + 1;
+
+	if ( b2_allocTaggedFcn != NULL )
+	{
+		void* ptr = b2_allocTaggedFcn( size32, B2_ALIGNMENT, b2_allocInfo );
+		b2TracyCAlloc( ptr, size );
+
+		B2_ASSERT( ptr != NULL );
+		B2_ASSERT( ( (uintptr_t)ptr & ( B2_ALIGNMENT - 1 ) ) == 0 );
+
+		return ptr;
+	}
 
 	if ( b2_allocFcn != NULL )
 	{
@@ -141,7 +179,7 @@ void* b2Alloc( int size )
 		b2TracyCAlloc( ptr, size );
 
 		B2_ASSERT( ptr != NULL );
-		B2_ASSERT( ( (uintptr_t)ptr & 0x1F ) == 0 );
+		B2_ASSERT( ( (uintptr_t)ptr & ( B2_ALIGNMENT - 1 ) ) == 0 );
 
 		return ptr;
 	}
@@ -162,7 +200,7 @@ void* b2Alloc( int size )
 	b2TracyCAlloc( ptr, size );
 
 	B2_ASSERT( ptr != NULL );
-	B2_ASSERT( ( (uintptr_t)ptr & 0x1F ) == 0 );
+	B2_ASSERT( ( (uintptr_t)ptr & ( B2_ALIGNMENT - 1 ) ) == 0 );
 
 	return ptr;
 }
@@ -185,7 +223,9 @@ void b2Free( void* mem, int size )
 
 	if ( b2_freeFcn != NULL )
 	{
-		b2_freeFcn( mem, size );
+		// Report the size given to b2_allocFcn
+		int size32 = ( ( size - 1 ) | ( B2_ALIGNMENT - 1 ) ) + 1;
+		b2_freeFcn( mem, size32 );
 	}
 	else
 	{
@@ -225,7 +265,26 @@ void* b2GrowAllocZeroInit( void* oldMem, int oldSize, int newSize )
 	return newMem;
 }
 
+void* b2ShrinkAlloc( void* oldMem, int oldSize, int newSize )
+{
+	B2_ASSERT( newSize < oldSize );
+	void* newMem = NULL;
+	if ( newSize > 0 )
+	{
+		newMem = b2Alloc( newSize );
+		memcpy( newMem, oldMem, newSize );
+	}
+
+	b2Free( oldMem, oldSize );
+	return newMem;
+}
+
 int b2GetByteCount( void )
 {
 	return b2AtomicLoadInt( &b2_byteCount );
 }
+
+int b2GetAllocationCount( void )
+{
+	return b2AtomicLoadInt( &b2_allocationCount );
+}
@@ -5,6 +5,8 @@
 
 #include "box2d/base.h"
 
+#include <stdbool.h>
+
 // clang-format off
 
 #define B2_NULL_INDEX ( -1 )
@@ -56,7 +58,10 @@
 	#define B2_SIMD_WIDTH 4
 #else
 	#if defined( B2_CPU_X86_X64 )
-		#if defined( BOX2D_AVX2 )
+		#if defined( BOX2D_AVX512 )
+			#define B2_SIMD_AVX512
+			#define B2_SIMD_WIDTH 16
+		#elif defined( BOX2D_AVX2 )
 			#define B2_SIMD_AVX2
 			#define B2_SIMD_WIDTH 8
 		#else
@@ -66,9 +71,9 @@
 	#elif defined( B2_CPU_ARM )
 		#define B2_SIMD_NEON
 		#define B2_SIMD_WIDTH 4
-	#elif defined( B2_CPU_WASM )
-		#define B2_CPU_WASM
-		#define B2_SIMD_SSE2
+	#elif defined( B2_CPU_WASM ) && defined( __wasm_simd128__ )
+		// native wasm_simd128 intrinsics rather than the Emscripten SSE2 emulation
+		#define B2_SIMD_WASM
 		#define B2_SIMD_WIDTH 4
 	#else
 		#define B2_SIMD_NONE
@@ -76,6 +81,13 @@
 	#endif
 #endif
 
+// Heap and arena alignment. Must cover the widest SIMD register.
+#if B2_SIMD_WIDTH == 16
+	#define B2_ALIGNMENT 64
+#else
+	#define B2_ALIGNMENT 32
+#endif
+
 // Define compiler
 #if defined( __clang__ )
 	#define B2_COMPILER_CLANG
@@ -85,21 +97,62 @@
 	#define B2_COMPILER_MSVC
 #endif
 
+// Hint that the cache line holding an address will be read soon
+#if defined( B2_COMPILER_CLANG ) || defined( B2_COMPILER_GCC )
+	#define B2_PREFETCH( ptr ) __builtin_prefetch( ptr )
+#elif defined( B2_COMPILER_MSVC ) && ( defined( _M_X64 ) || defined( _M_IX86 ) )
+	#include <xmmintrin.h>
+	#define B2_PREFETCH( ptr ) _mm_prefetch( (const char*)( ptr ), _MM_HINT_T0 )
+#else
+	#define B2_PREFETCH( ptr ) ( (void)( ptr ) )
+#endif
+
+/// Inline even when the optimizer would not, used to specialize a function body for constant arguments
+#if defined( B2_COMPILER_CLANG ) || defined( B2_COMPILER_GCC )
+	#define B2_FORCE_INLINE inline __attribute__( ( always_inline ) )
+#elif defined( B2_COMPILER_MSVC )
+	#define B2_FORCE_INLINE __forceinline
+#else
+	#define B2_FORCE_INLINE inline
+#endif
+
 /// Tracy profiler instrumentation
 /// https://github.com/wolfpld/tracy
+/// Named zones and frames also go to the built-in trace recorder, see b2EnableTrace.
+/// Waits are shown as lock contention. A lock context is only declared when profiling, so wrap its
+/// storage in BOX2D_PROFILE.
 #ifdef BOX2D_PROFILE
 	#include <tracy/TracyC.h>
 	#define b2TracyCZoneC( ctx, color, active ) TracyCZoneC( ctx, color, active )
-	#define b2TracyCZoneNC( ctx, name, color, active ) TracyCZoneNC( ctx, name, color, active )
-	#define b2TracyCZoneEnd( ctx ) TracyCZoneEnd( ctx )
-	#define b2TracyCFrame TracyCFrameMark
-	#define b2TracyCSetThreadName( name ) TracyCSetThreadName( name )
+	#define b2TracyCZoneNC( ctx, name, color, active ) TracyCZoneNC( ctx, name, color, active ); b2TraceZone ctx##_trace = b2BeginTraceZone( name )
+	#define b2TracyCZoneEnd( ctx ) TracyCZoneEnd( ctx ); b2EndTraceZone( ctx##_trace )
+	#define b2TracyCFrame do { TracyCFrameMark; b2TraceFrame(); } while ( 0 )
+	#define b2TracyCSetThreadName( name ) TracyCSetThreadName( name ); b2SetTraceThreadName( name )
+	#define b2TracyCAlloc( ptr, size ) TracyCAlloc( ptr, size )
+	#define b2TracyCFree( ptr ) TracyCFree( ptr )
+	#define b2TracyCAllocN( ptr, size, name ) TracyCAllocN( ptr, size, name )
+	#define b2TracyCFreeN( ptr, name ) TracyCFreeN( ptr, name )
+	#define b2TracyCPlot( name, value ) TracyCPlotI( name, (int64_t)( value ) )
+	#define b2TracyCLockCtx( lock ) TracyCLockCtx( lock )
+	#define b2TracyCLockAnnounce( lock, name ) do { TracyCLockAnnounce( lock ); TracyCLockCustomName( lock, name, sizeof( name ) - 1 ); } while ( 0 )
+	#define b2TracyCLockTerminate( lock ) TracyCLockTerminate( lock )
+	#define b2TracyCWaitBegin( lock ) TracyCLockBeforeLock( lock )
+	#define b2TracyCWaitEnd( lock ) do { TracyCLockAfterLock( lock ); TracyCLockAfterUnlock( lock ); } while ( 0 )
 #else
 	#define b2TracyCZoneC( ctx, color, active )
-	#define b2TracyCZoneNC( ctx, name, color, active )
-	#define b2TracyCZoneEnd( ctx )
-	#define b2TracyCFrame
-	#define b2TracyCSetThreadName( name )
+	#define b2TracyCZoneNC( ctx, name, color, active ) b2TraceZone ctx##_trace = b2BeginTraceZone( name )
+	#define b2TracyCZoneEnd( ctx ) b2EndTraceZone( ctx##_trace )
+	#define b2TracyCFrame b2TraceFrame()
+	#define b2TracyCSetThreadName( name ) b2SetTraceThreadName( name )
+	#define b2TracyCAlloc( ptr, size )
+	#define b2TracyCFree( ptr )
+	#define b2TracyCAllocN( ptr, size, name )
+	#define b2TracyCFreeN( ptr, name )
+	#define b2TracyCPlot( name, value )
+	#define b2TracyCLockAnnounce( lock, name )
+	#define b2TracyCLockTerminate( lock )
+	#define b2TracyCWaitBegin( lock )
+	#define b2TracyCWaitEnd( lock )
 #endif
 
 // clang-format on
@@ -151,8 +204,24 @@ typedef struct b2AtomicU32
 	uint32_t value;
 } b2AtomicU32;
 
+#if defined( _MSC_VER )
+#define B2_THREAD_LOCAL __declspec( thread )
+#else
+#define B2_THREAD_LOCAL _Thread_local
+#endif
+
+// Heap allocations are reported to the tagged allocator with the attribution of the calling thread,
+// see b2SetTaggedAllocator. These set the tag or world for a region and return the previous
+// attribution to restore with b2PopAllocInfo.
+b2AllocInfo b2PushAllocTag( b2AllocTag tag, b2AllocLifetime lifetime );
+b2AllocInfo b2PushAllocWorld( int worldIndex );
+void b2PopAllocInfo( b2AllocInfo info );
+
 void* b2Alloc( int size );
 void* b2AllocZeroInit( int size );
+
+// b2Alloc with the tag and lifetime of a single allocation, keeping the world of the thread
+void* b2AllocTagged( int size, b2AllocTag tag, b2AllocLifetime lifetime );
 #define B2_ALLOC_STRUCT( type ) b2Alloc(sizeof(type))
 #define B2_ALLOC_ARRAY( count, type ) b2Alloc(count * sizeof(type))
 
@@ -162,9 +231,20 @@ void b2Free( void* mem, int size );
 
 void* b2GrowAlloc( void* oldMem, int oldSize, int newSize );
 void* b2GrowAllocZeroInit( void* oldMem, int oldSize, int newSize );
+void* b2ShrinkAlloc( void* oldMem, int oldSize, int newSize );
+
+// Number of heap allocations made since startup
+int b2GetAllocationCount( void );
 
 void b2Log( const char* format, ... );
 
+// Blocks the thread while the 32-bit value at the address equals the expected value, until another thread
+// calls b2WakeAddress. May return early. Platforms without an address wait yield instead.
+void b2WaitAddress( void* address, uint32_t expected );
+
+// Wakes all threads waiting on the address
+void b2WakeAddress( void* address );
+
 typedef struct b2Mutex b2Mutex;
 b2Mutex* b2CreateMutex( void );
 void b2DestroyMutex( b2Mutex* m );
@@ -177,8 +257,51 @@ void b2DestroySemaphore( b2Semaphore* s );
 void b2WaitSemaphore( b2Semaphore* s );
 void b2SignalSemaphore( b2Semaphore* s );
 
+// Milliseconds per tick of b2GetTicks
+double b2GetMillisecondsPerTick( void );
+
+// A zone of the built-in trace recorder. The ticks are zero if the recorder was off when the zone began.
+typedef struct b2TraceZone
+{
+	const char* name;
+	uint64_t ticks;
+} b2TraceZone;
+
+extern bool b2_traceEnabled;
+
+// Name must be a string literal
+void b2RecordTraceZone( const char* name, uint64_t beginTicks );
+void b2TraceFrame( void );
+void b2SetTraceThreadName( const char* name );
+
+static inline b2TraceZone b2BeginTraceZone( const char* name )
+{
+	b2TraceZone zone = { name, 0 };
+	if ( b2_traceEnabled )
+	{
+		zone.ticks = b2GetTicks();
+	}
+	return zone;
+}
+
+static inline void b2EndTraceZone( b2TraceZone zone )
+{
+	if ( zone.ticks != 0 )
+	{
+		b2RecordTraceZone( zone.name, zone.ticks );
+	}
+}
+
 typedef void b2ThreadFunction( void* context );
 typedef struct b2Thread b2Thread;
 // Name may be NULL, otherwise it is copied.
 b2Thread* b2CreateThread( b2ThreadFunction* function, void* context, const char* name );
 void b2JoinThread( b2Thread* t );
+
+// Mask of logical processors that share the L3 cache with the calling thread, holding one processor
+// per physical core and preferring performance cores. Only the first 64 processors are represented.
+// Returns zero if the topology is unknown.
+uint64_t b2GetCacheDomainAffinityMask( void );
+
+// Pins the calling thread to a logical processor. This is only a hint on macOS.
+void b2SetCurrentThreadAffinity( int processorIndex );
@@ -91,7 +91,15 @@ static inline uint32_t b2CTZ64( uint64_t block )
 
 static inline int b2PopCount64( uint64_t block )
 {
+	#if ( defined( __x86_64__ ) || defined( __i386__ ) ) && !defined( __POPCNT__ )
+	// Without POPCNT the builtin becomes a library call. This is the same bit twiddling inlined.
+	block = block - ( ( block >> 1 ) & 0x5555555555555555ull );
+	block = ( block & 0x3333333333333333ull ) + ( ( block >> 2 ) & 0x3333333333333333ull );
+	block = ( block + ( block >> 4 ) ) & 0x0F0F0F0F0F0F0F0Full;
+	return (int)( ( block * 0x0101010101010101ull ) >> 56 );
+	#else
 	return __builtin_popcountll( block );
+	#endif
 }
 #endif
 
@@ -119,3 +127,14 @@ static inline int b2RoundUpPowerOf2( int x )
 
 	return 1 << ( 32 - (int)b2CLZ32( (uint32_t)x - 1 ) );
 }
+
+// Spreads the low 16 bits so another coordinate can be interleaved (Morton code)
+static inline uint32_t b2SpreadBits( uint32_t x )
+{
+	x &= 0x0000FFFF;
+	x = ( x | ( x << 8 ) ) & 0x00FF00FF;
+	x = ( x | ( x << 4 ) ) & 0x0F0F0F0F;
+	x = ( x | ( x << 2 ) ) & 0x33333333;
+	x = ( x | ( x << 1 ) ) & 0x55555555;
+	return x;
+}
@@ -1135,9 +1135,29 @@ static float b2EvaluateSeparation( const b2SeparationFunction* f, int indexA, in
 	}
 }
 
+// Upper bound on the distance any point of the proxy travels over the sweep. The center moves on a line
+// and the rotation stays on the short arc, so the chord between the end rotations bounds the rotation.
+static float b2ComputeSweepMotionBound( const b2Sweep* sweep, const b2ShapeProxy* proxy )
+{
+	float maxRadius = 0.0f;
+	for ( int i = 0; i < proxy->count; ++i )
+	{
+		maxRadius = b2MaxFloat( maxRadius, b2Distance( proxy->points[i], sweep->localCenter ) );
+	}
+
+	b2Vec2 dq = { sweep->q2.c - sweep->q1.c, sweep->q2.s - sweep->q1.s };
+	return b2Distance( sweep->c1, sweep->c2 ) + maxRadius * b2Length( dq );
+}
+
+b2TOIOutput b2TimeOfImpact( const b2TOIInput* input )
+{
+	b2SimplexCache cache = { 0 };
+	return b2TimeOfImpactCached( input, &cache );
+}
+
 // CCD via the local separating axis method. This seeks progression
 // by computing the largest time at which separation is maintained.
-b2TOIOutput b2TimeOfImpact( const b2TOIInput* input )
+b2TOIOutput b2TimeOfImpactCached( const b2TOIInput* input, b2SimplexCache* simplexCache )
 {
 #if B2_SNOOP_TOI_COUNTERS
 	uint64_t ticks = b2GetTicks();
@@ -1172,8 +1192,24 @@ b2TOIOutput b2TimeOfImpact( const b2TOIInput* input )
 	const int k_maxIterations = 20;
 	int distanceIterations = 0;
 
+	// Conservative advancement early out. If the shapes cannot close the gap to the target over the
+	// whole sweep then they stay separated and there is no need for the separating axis root finder.
+	float motionBound = b2ComputeSweepMotionBound( &sweepA, proxyA ) + b2ComputeSweepMotionBound( &sweepB, proxyB );
+
+	// Warm start from the caller's simplex. The cache may refer to different proxies, so validate it.
+	b2SimplexCache cache = *simplexCache;
+	int cacheCount = cache.count <= 3 ? cache.count : 0;
+	for ( int i = 0; i < cacheCount; ++i )
+	{
+		if ( cache.indexA[i] >= proxyA->count || cache.indexB[i] >= proxyB->count )
+		{
+			cacheCount = 0;
+			break;
+		}
+	}
+	cache.count = (uint16_t)cacheCount;
+
 	// Prepare input for distance query.
-	b2SimplexCache cache = { 0 };
 	b2DistanceInput distanceInput = { 0 };
 	distanceInput.proxyA = input->proxyA;
 	distanceInput.proxyB = input->proxyB;
@@ -1187,6 +1223,7 @@ b2TOIOutput b2TimeOfImpact( const b2TOIInput* input )
 		distanceInput.transformA = b2GetSweepTransform( &sweepA, t1 );
 		distanceInput.transformB = b2GetSweepTransform( &sweepB, t1 );
 		b2DistanceOutput distanceOutput = b2ShapeDistance( &distanceInput, &cache, NULL, 0 );
+		output.gjkIterations += distanceOutput.iterations;
 
 		// Progressive time of impact. This handles slender geometry well but introduces
 		// significant time loss.
@@ -1236,6 +1273,17 @@ b2TOIOutput b2TimeOfImpact( const b2TOIInput* input )
 			break;
 		}
 
+		if ( distanceOutput.distance - motionBound > target + tolerance )
+		{
+			// Victory!
+			output.state = b2_toiStateSeparated;
+#if B2_SNOOP_TOI_COUNTERS
+			b2_toiSeparatedCount += 1;
+#endif
+			output.fraction = tMax;
+			break;
+		}
+
 		// Initialize the separating axis.
 		b2SeparationFunction fcn = b2MakeSeparationFunction( cache, proxyA, &sweepA, proxyB, &sweepB, t1 );
 #if 0
@@ -1423,5 +1471,7 @@ b2TOIOutput b2TimeOfImpact( const b2TOIInput* input )
 	b2_toiTime += time;
 #endif
 
+	output.distanceIterations = distanceIterations;
+	*simplexCache = cache;
 	return output;
 }
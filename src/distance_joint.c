@@ -17,7 +17,7 @@
 
 void b2DistanceJoint_SetLength( b2JointId jointId, float length )
 {
-	b2JointSim* base = b2GetJointSimCheckType( jointId, b2_distanceJoint );
+	b2JointSim* base = b2GetMutableJointSim( jointId, b2_distanceJoint );
 	b2DistanceJoint* joint = &base->distanceJoint;
 
 	joint->length = b2ClampFloat( length, B2_LINEAR_SLOP, B2_HUGE );
@@ -35,7 +35,7 @@ float b2DistanceJoint_GetLength( b2JointId jointId )
 
 void b2DistanceJoint_EnableLimit( b2JointId jointId, bool enableLimit )
 {
-	b2JointSim* base = b2GetJointSimCheckType( jointId, b2_distanceJoint );
+	b2JointSim* base = b2GetMutableJointSim( jointId, b2_distanceJoint );
 	b2DistanceJoint* joint = &base->distanceJoint;
 	joint->enableLimit = enableLimit;
 }
@@ -48,7 +48,7 @@ bool b2DistanceJoint_IsLimitEnabled( b2JointId jointId )
 
 void b2DistanceJoint_SetLengthRange( b2JointId jointId, float minLength, float maxLength )
 {
-	b2JointSim* base = b2GetJointSimCheckType( jointId, b2_distanceJoint );
+	b2JointSim* base = b2GetMutableJointSim( jointId, b2_distanceJoint );
 	b2DistanceJoint* joint = &base->distanceJoint;
 
 	minLength = b2ClampFloat( minLength, B2_LINEAR_SLOP, B2_HUGE );
@@ -97,7 +97,7 @@ float b2DistanceJoint_GetCurrentLength( b2JointId jointId )
 
 void b2DistanceJoint_EnableSpring( b2JointId jointId, bool enableSpring )
 {
-	b2JointSim* base = b2GetJointSimCheckType( jointId, b2_distanceJoint );
+	b2JointSim* base = b2GetMutableJointSim( jointId, b2_distanceJoint );
 	base->distanceJoint.enableSpring = enableSpring;
 }
 
@@ -110,7 +110,7 @@ bool b2DistanceJoint_IsSpringEnabled( b2JointId jointId )
 void b2DistanceJoint_SetSpringForceRange( b2JointId jointId, float lowerForce, float upperForce )
 {
 	B2_ASSERT( lowerForce <= upperForce );
-	b2JointSim* base = b2GetJointSimCheckType( jointId, b2_distanceJoint );
+	b2JointSim* base = b2GetMutableJointSim( jointId, b2_distanceJoint );
 	base->distanceJoint.lowerSpringForce = lowerForce;
 	base->distanceJoint.upperSpringForce = upperForce;
 }
@@ -124,13 +124,13 @@ void b2DistanceJoint_GetSpringForceRange( b2JointId jointId, float* lowerForce,
 
 void b2DistanceJoint_SetSpringHertz( b2JointId jointId, float hertz )
 {
-	b2JointSim* base = b2GetJointSimCheckType( jointId, b2_distanceJoint );
+	b2JointSim* base = b2GetMutableJointSim( jointId, b2_distanceJoint );
 	base->distanceJoint.hertz = hertz;
 }
 
 void b2DistanceJoint_SetSpringDampingRatio( b2JointId jointId, float dampingRatio )
 {
-	b2JointSim* base = b2GetJointSimCheckType( jointId, b2_distanceJoint );
+	b2JointSim* base = b2GetMutableJointSim( jointId, b2_distanceJoint );
 	base->distanceJoint.dampingRatio = dampingRatio;
 }
 
@@ -150,7 +150,7 @@ float b2DistanceJoint_GetSpringDampingRatio( b2JointId jointId )
 
 void b2DistanceJoint_EnableMotor( b2JointId jointId, bool enableMotor )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_distanceJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_distanceJoint );
 	if ( enableMotor != joint->distanceJoint.enableMotor )
 	{
 		joint->distanceJoint.enableMotor = enableMotor;
@@ -166,7 +166,7 @@ bool b2DistanceJoint_IsMotorEnabled( b2JointId jointId )
 
 void b2DistanceJoint_SetMotorSpeed( b2JointId jointId, float motorSpeed )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_distanceJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_distanceJoint );
 	joint->distanceJoint.motorSpeed = motorSpeed;
 }
 
@@ -185,7 +185,7 @@ float b2DistanceJoint_GetMotorForce( b2JointId jointId )
 
 void b2DistanceJoint_SetMaxMotorForce( b2JointId jointId, float force )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_distanceJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_distanceJoint );
 	joint->distanceJoint.maxMotorForce = force;
 }
 
@@ -0,0 +1,659 @@
+// SPDX-FileCopyrightText: 2025 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#include "core.h"
+#include "simd.h"
+
+#include "box2d/collision.h"
+#include "box2d/math_functions.h"
+
+#include <float.h>
+
+// Batched GJK. Each lane runs b2ShapeDistance for one input. Every operation mirrors the scalar code in
+// distance.c one to one, including the operand order and the handling of branches, so each lane produces
+// the same bits as the scalar function. Branches are evaluated for all lanes and selected with masks.
+// Lanes that are done keep their state while the remaining lanes iterate.
+
+// Access to the lanes of a wide float
+typedef union b2FloatLanes
+{
+	b2FloatW w;
+	float f[B2_SIMD_WIDTH];
+} b2FloatLanes;
+
+// Wide transform
+typedef struct b2TransformW
+{
+	b2Vec2W p;
+	b2RotW q;
+} b2TransformW;
+
+// Wide simplex. The vertex indices and the count are stored as floats, which is exact for these values.
+typedef struct b2SimplexW
+{
+	b2Vec2W wA[3];
+	b2Vec2W wB[3];
+	b2Vec2W w[3];
+	b2FloatW a[3];
+	b2FloatW indexA[3];
+	b2FloatW indexB[3];
+	b2FloatW count;
+} b2SimplexW;
+
+static inline b2FloatW b2LessThanW( b2FloatW a, b2FloatW b )
+{
+	return b2GreaterThanW( b, a );
+}
+
+static inline b2FloatW b2LessEqualW( b2FloatW a, b2FloatW b )
+{
+	return b2OrW( b2GreaterThanW( b, a ), b2EqualsW( a, b ) );
+}
+
+static inline b2FloatW b2AndW( b2FloatW a, b2FloatW b )
+{
+	return b2BlendW( b2ZeroW(), b, a );
+}
+
+static inline b2FloatW b2NotW( b2FloatW a )
+{
+	return b2EqualsW( a, b2ZeroW() );
+}
+
+static inline b2Vec2W b2AddVW( b2Vec2W a, b2Vec2W b )
+{
+	return (b2Vec2W){ b2AddW( a.X, b.X ), b2AddW( a.Y, b.Y ) };
+}
+
+static inline b2Vec2W b2SubVW( b2Vec2W a, b2Vec2W b )
+{
+	return (b2Vec2W){ b2SubW( a.X, b.X ), b2SubW( a.Y, b.Y ) };
+}
+
+static inline b2Vec2W b2NegVW( b2Vec2W a )
+{
+	return (b2Vec2W){ b2NegW( a.X ), b2NegW( a.Y ) };
+}
+
+static inline b2Vec2W b2BlendVW( b2Vec2W a, b2Vec2W b, b2FloatW mask )
+{
+	return (b2Vec2W){ b2BlendW( a.X, b.X, mask ), b2BlendW( a.Y, b.Y, mask ) };
+}
+
+// b2CrossSV
+static inline b2Vec2W b2CrossSVW( b2FloatW s, b2Vec2W v )
+{
+	return (b2Vec2W){ b2MulW( b2NegW( s ), v.Y ), b2MulW( s, v.X ) };
+}
+
+// a + s * b
+static inline b2Vec2W b2MulAddVW( b2Vec2W a, b2FloatW s, b2Vec2W b )
+{
+	return (b2Vec2W){ b2AddW( a.X, b2MulW( s, b.X ) ), b2AddW( a.Y, b2MulW( s, b.Y ) ) };
+}
+
+// a - s * b
+static inline b2Vec2W b2MulSubVW( b2Vec2W a, b2FloatW s, b2Vec2W b )
+{
+	return (b2Vec2W){ b2SubW( a.X, b2MulW( s, b.X ) ), b2SubW( a.Y, b2MulW( s, b.Y ) ) };
+}
+
+static inline b2Vec2W b2TransformPointW( b2TransformW t, b2Vec2W p )
+{
+	b2FloatW x = b2AddW( b2SubW( b2MulW( t.q.C, p.X ), b2MulW( t.q.S, p.Y ) ), t.p.X );
+	b2FloatW y = b2AddW( b2AddW( b2MulW( t.q.S, p.X ), b2MulW( t.q.C, p.Y ) ), t.p.Y );
+	return (b2Vec2W){ x, y };
+}
+
+static inline b2TransformW b2InvMulTransformsW( b2TransformW a, b2TransformW b )
+{
+	b2TransformW c;
+	c.q.S = b2SubW( b2MulW( a.q.C, b.q.S ), b2MulW( a.q.S, b.q.C ) );
+	c.q.C = b2AddW( b2MulW( a.q.C, b.q.C ), b2MulW( a.q.S, b.q.S ) );
+	b2Vec2W d = b2SubVW( b.p, a.p );
+	c.p.X = b2AddW( b2MulW( a.q.C, d.X ), b2MulW( a.q.S, d.Y ) );
+	c.p.Y = b2AddW( b2MulW( b2NegW( a.q.S ), d.X ), b2MulW( a.q.C, d.Y ) );
+	return c;
+}
+
+static inline b2FloatW b2DistanceW( b2Vec2W a, b2Vec2W b )
+{
+	b2FloatW dx = b2SubW( b.X, a.X );
+	b2FloatW dy = b2SubW( b.Y, a.Y );
+	return b2SqrtW( b2AddW( b2MulW( dx, dx ), b2MulW( dy, dy ) ) );
+}
+
+static inline b2Vec2W b2NormalizeW( b2Vec2W v )
+{
+	b2FloatW length = b2SqrtW( b2AddW( b2MulW( v.X, v.X ), b2MulW( v.Y, v.Y ) ) );
+	b2FloatW invLength = b2DivW( b2SplatW( 1.0f ), length );
+	b2Vec2W n = { b2MulW( invLength, v.X ), b2MulW( invLength, v.Y ) };
+	b2FloatW small = b2LessThanW( length, b2SplatW( FLT_EPSILON ) );
+	return b2BlendVW( n, (b2Vec2W){ b2ZeroW(), b2ZeroW() }, small );
+}
+
+// Goes through a union value because a float store into a vector through a pointer cast may be reordered
+// with vector stores to the same object
+static inline void b2SetLane( b2FloatW* w, int lane, float f )
+{
+	b2FloatLanes lanes = { *w };
+	lanes.f[lane] = f;
+	*w = lanes.w;
+}
+
+static inline void b2SetLaneV( b2Vec2W* w, int lane, b2Vec2 v )
+{
+	b2SetLane( &w->X, lane, v.x );
+	b2SetLane( &w->Y, lane, v.y );
+}
+
+static inline float b2GetLane( b2FloatW w, int lane )
+{
+	b2FloatLanes lanes = { w };
+	return lanes.f[lane];
+}
+
+static inline bool b2GetLaneMask( b2FloatW w, int lane )
+{
+	b2FloatLanes lanes = { w };
+
+	// Full lane masks are NaNs and the scalar fallback uses 1.0f
+	return lanes.f[lane] != 0.0f;
+}
+
+static inline b2Vec2 b2GetLaneV( b2Vec2W w, int lane )
+{
+	return (b2Vec2){ b2GetLane( w.X, lane ), b2GetLane( w.Y, lane ) };
+}
+
+// Copy vertex src to vertex dst in the masked lanes
+static inline void b2CopyVertexW( b2SimplexW* s, int dst, int src, b2FloatW mask )
+{
+	s->wA[dst] = b2BlendVW( s->wA[dst], s->wA[src], mask );
+	s->wB[dst] = b2BlendVW( s->wB[dst], s->wB[src], mask );
+	s->w[dst] = b2BlendVW( s->w[dst], s->w[src], mask );
+	s->a[dst] = b2BlendW( s->a[dst], s->a[src], mask );
+	s->indexA[dst] = b2BlendW( s->indexA[dst], s->indexA[src], mask );
+	s->indexB[dst] = b2BlendW( s->indexB[dst], s->indexB[src], mask );
+}
+
+static inline void b2BlendSimplexW( b2SimplexW* s, const b2SimplexW* other, b2FloatW mask )
+{
+	for ( int i = 0; i < 3; ++i )
+	{
+		s->wA[i] = b2BlendVW( s->wA[i], other->wA[i], mask );
+		s->wB[i] = b2BlendVW( s->wB[i], other->wB[i], mask );
+		s->w[i] = b2BlendVW( s->w[i], other->w[i], mask );
+		s->a[i] = b2BlendW( s->a[i], other->a[i], mask );
+		s->indexA[i] = b2BlendW( s->indexA[i], other->indexA[i], mask );
+		s->indexB[i] = b2BlendW( s->indexB[i], other->indexB[i], mask );
+	}
+
+	s->count = b2BlendW( s->count, other->count, mask );
+}
+
+// Points past the proxy count repeat the last point. The strict comparison keeps the first best index,
+// so the repeated points never win.
+static inline void b2FindSupportW( const b2Vec2W* points, int pointCount, b2Vec2W direction, b2FloatW* index, b2Vec2W* point )
+{
+	b2FloatW bestIndex = b2ZeroW();
+	b2Vec2W bestPoint = points[0];
+	b2FloatW bestValue = b2DotW( points[0], direction );
+	for ( int i = 1; i < pointCount; ++i )
+	{
+		b2FloatW value = b2DotW( points[i], direction );
+		b2FloatW better = b2GreaterThanW( value, bestValue );
+		bestIndex = b2BlendW( bestIndex, b2SplatW( (float)i ), better );
+		bestPoint = b2BlendVW( bestPoint, points[i], better );
+		bestValue = b2BlendW( bestValue, value, better );
+	}
+
+	*index = bestIndex;
+	*point = bestPoint;
+}
+
+static inline b2Vec2W b2GatherPointW( const b2Vec2W* points, int pointCount, b2FloatW index )
+{
+	b2Vec2W point = points[0];
+	for ( int i = 1; i < pointCount; ++i )
+	{
+		point = b2BlendVW( point, points[i], b2EqualsW( index, b2SplatW( (float)i ) ) );
+	}
+	return point;
+}
+
+static void b2ComputeWitnessPointsW( const b2SimplexW* s, b2Vec2W* a, b2Vec2W* b )
+{
+	// case 1
+	b2Vec2W a1 = s->wA[0];
+	b2Vec2W b1 = s->wB[0];
+
+	// case 2
+	b2Vec2W a2 = {
+		b2AddW( b2MulW( s->a[0], s->wA[0].X ), b2MulW( s->a[1], s->wA[1].X ) ),
+		b2AddW( b2MulW( s->a[0], s->wA[0].Y ), b2MulW( s->a[1], s->wA[1].Y ) ),
+	};
+	b2Vec2W b2 = {
+		b2AddW( b2MulW( s->a[0], s->wB[0].X ), b2MulW( s->a[1], s->wB[1].X ) ),
+		b2AddW( b2MulW( s->a[0], s->wB[0].Y ), b2MulW( s->a[1], s->wB[1].Y ) ),
+	};
+
+	// case 3
+	b2Vec2W a3 = {
+		b2AddW( b2AddW( b2MulW( s->a[0], s->wA[0].X ), b2MulW( s->a[1], s->wA[1].X ) ), b2MulW( s->a[2], s->wA[2].X ) ),
+		b2AddW( b2AddW( b2MulW( s->a[0], s->wA[0].Y ), b2MulW( s->a[1], s->wA[1].Y ) ), b2MulW( s->a[2], s->wA[2].Y ) ),
+	};
+
+	b2FloatW isCount2 = b2EqualsW( s->count, b2SplatW( 2.0f ) );
+	b2FloatW isCount3 = b2EqualsW( s->count, b2SplatW( 3.0f ) );
+
+	*a = b2BlendVW( b2BlendVW( a1, a2, isCount2 ), a3, isCount3 );
+	*b = b2BlendVW( b2BlendVW( b1, b2, isCount2 ), a3, isCount3 );
+}
+
+// See b2SolveSimplex2
+static b2Vec2W b2SolveSimplex2W( b2SimplexW* s )
+{
+	b2Vec2W w1 = s->w[0];
+	b2Vec2W w2 = s->w[1];
+	b2Vec2W e12 = b2SubVW( w2, w1 );
+
+	b2FloatW zero = b2ZeroW();
+	b2FloatW one = b2SplatW( 1.0f );
+
+	// w1 region
+	b2FloatW d12_2 = b2NegW( b2DotW( w1, e12 ) );
+	b2FloatW inW1 = b2LessEqualW( d12_2, zero );
+
+	// w2 region
+	b2FloatW d12_1 = b2DotW( w2, e12 );
+	b2FloatW inW2 = b2AndW( b2NotW( inW1 ), b2LessEqualW( d12_1, zero ) );
+
+	// e12 region
+	b2FloatW inE12 = b2NotW( b2OrW( inW1, inW2 ) );
+	b2FloatW inv_d12 = b2DivW( one, b2AddW( d12_1, d12_2 ) );
+
+	s->a[0] = b2BlendW( s->a[0], one, inW1 );
+	s->a[1] = b2BlendW( s->a[1], one, inW2 );
+	b2CopyVertexW( s, 0, 1, inW2 );
+	s->a[0] = b2BlendW( s->a[0], b2MulW( d12_1, inv_d12 ), inE12 );
+	s->a[1] = b2BlendW( s->a[1], b2MulW( d12_2, inv_d12 ), inE12 );
+	s->count = b2BlendW( one, b2SplatW( 2.0f ), inE12 );
+
+	b2Vec2W d = b2CrossSVW( b2CrossW( b2AddVW( w1, w2 ), e12 ), e12 );
+	d = b2BlendVW( d, b2NegVW( w1 ), inW1 );
+	d = b2BlendVW( d, b2NegVW( w2 ), inW2 );
+	return d;
+}
+
+// See b2SolveSimplex3
+static b2Vec2W b2SolveSimplex3W( b2SimplexW* s )
+{
+	b2Vec2W w1 = s->w[0];
+	b2Vec2W w2 = s->w[1];
+	b2Vec2W w3 = s->w[2];
+
+	b2FloatW zero = b2ZeroW();
+	b2FloatW one = b2SplatW( 1.0f );
+
+	// Edge12
+	b2Vec2W e12 = b2SubVW( w2, w1 );
+	b2FloatW w1e12 = b2DotW( w1, e12 );
+	b2FloatW w2e12 = b2DotW( w2, e12 );
+	b2FloatW d12_1 = w2e12;
+	b2FloatW d12_2 = b2NegW( w1e12 );
+
+	// Edge13
+	b2Vec2W e13 = b2SubVW( w3, w1 );
+	b2FloatW w1e13 = b2DotW( w1, e13 );
+	b2FloatW w3e13 = b2DotW( w3, e13 );
+	b2FloatW d13_1 = w3e13;
+	b2FloatW d13_2 = b2NegW( w1e13 );
+
+	// Edge23
+	b2Vec2W e23 = b2SubVW( w3, w2 );
+	b2FloatW w2e23 = b2DotW( w2, e23 );
+	b2FloatW w3e23 = b2DotW( w3, e23 );
+	b2FloatW d23_1 = w3e23;
+	b2FloatW d23_2 = b2NegW( w2e23 );
+
+	// Triangle123
+	b2FloatW n123 = b2CrossW( e12, e13 );
+
+	b2FloatW d123_1 = b2MulW( n123, b2CrossW( w2, w3 ) );
+	b2FloatW d123_2 = b2MulW( n123, b2CrossW( w3, w1 ) );
+	b2FloatW d123_3 = b2MulW( n123, b2CrossW( w1, w2 ) );
+
+	// The regions are tested in the order of the scalar branches
+	b2FloatW inW1 = b2AndW( b2LessEqualW( d12_2, zero ), b2LessEqualW( d13_2, zero ) );
+	b2FloatW taken = inW1;
+
+	b2FloatW inE12 = b2AndW( b2AndW( b2GreaterThanW( d12_1, zero ), b2GreaterThanW( d12_2, zero ) ),
+							 b2LessEqualW( d123_3, zero ) );
+	inE12 = b2AndW( b2NotW( taken ), inE12 );
+	taken = b2OrW( taken, inE12 );
+
+	b2FloatW inE13 = b2AndW( b2AndW( b2GreaterThanW( d13_1, zero ), b2GreaterThanW( d13_2, zero ) ),
+							 b2LessEqualW( d123_2, zero ) );
+	inE13 = b2AndW( b2NotW( taken ), inE13 );
+	taken = b2OrW( taken, inE13 );
+
+	b2FloatW inW2 = b2AndW( b2LessEqualW( d12_1, zero ), b2LessEqualW( d23_2, zero ) );
+	inW2 = b2AndW( b2NotW( taken ), inW2 );
+	taken = b2OrW( taken, inW2 );
+
+	b2FloatW inW3 = b2AndW( b2LessEqualW( d13_1, zero ), b2LessEqualW( d23_1, zero ) );
+	inW3 = b2AndW( b2NotW( taken ), inW3 );
+	taken = b2OrW( taken, inW3 );
+
+	b2FloatW inE23 = b2AndW( b2AndW( b2GreaterThanW( d23_1, zero ), b2GreaterThanW( d23_2, zero ) ),
+							 b2LessEqualW( d123_1, zero ) );
+	inE23 = b2AndW( b2NotW( taken ), inE23 );
+	taken = b2OrW( taken, inE23 );
+
+	b2FloatW inTriangle = b2NotW( taken );
+
+	b2FloatW inv_d12 = b2DivW( one, b2AddW( d12_1, d12_2 ) );
+	b2FloatW inv_d13 = b2DivW( one, b2AddW( d13_1, d13_2 ) );
+	b2FloatW inv_d23 = b2DivW( one, b2AddW( d23_1, d23_2 ) );
+	b2FloatW inv_d123 = b2DivW( one, b2AddW( b2AddW( d123_1, d123_2 ), d123_3 ) );
+
+	// Barycentric coordinates before the vertex copies
+	b2FloatW a1 = s->a[0];
+	a1 = b2BlendW( a1, one, inW1 );
+	a1 = b2BlendW( a1, b2MulW( d12_1, inv_d12 ), inE12 );
+	a1 = b2BlendW( a1, b2MulW( d13_1, inv_d13 ), inE13 );
+	a1 = b2BlendW( a1, b2MulW( d123_1, inv_d123 ), inTriangle );
+
+	b2FloatW a2 = s->a[1];
+	a2 = b2BlendW( a2, b2MulW( d12_2, inv_d12 ), inE12 );
+	a2 = b2BlendW( a2, one, inW2 );
+	a2 = b2BlendW( a2, b2MulW( d23_1, inv_d23 ), inE23 );
+	a2 = b2BlendW( a2, b2MulW( d123_2, inv_d123 ), inTriangle );
+
+	b2FloatW a3 = s->a[2];
+	a3 = b2BlendW( a3, b2MulW( d13_2, inv_d13 ), inE13 );
+	a3 = b2BlendW( a3, one, inW3 );
+	a3 = b2BlendW( a3, b2MulW( d23_2, inv_d23 ), inE23 );
+	a3 = b2BlendW( a3, b2MulW( d123_3, inv_d123 ), inTriangle );
+
+	s->a[0] = a1;
+	s->a[1] = a2;
+	s->a[2] = a3;
+
+	// Vertex copies. Vertex 1 reads vertex 2 before vertex 2 is overwritten by vertex 3.
+	b2CopyVertexW( s, 0, 1, inW2 );
+	b2CopyVertexW( s, 0, 2, b2OrW( inW3, inE23 ) );
+	b2CopyVertexW( s, 1, 2, inE13 );
+
+	b2FloatW two = b2SplatW( 2.0f );
+	b2FloatW count = one;
+	count = b2BlendW( count, two, b2OrW( b2OrW( inE12, inE13 ), inE23 ) );
+	count = b2BlendW( count, b2SplatW( 3.0f ), inTriangle );
+	s->count = count;
+
+	b2Vec2W d = b2NegVW( w1 );
+	d = b2BlendVW( d, b2CrossSVW( b2CrossW( b2AddVW( w1, w2 ), e12 ), e12 ), inE12 );
+	d = b2BlendVW( d, b2CrossSVW( b2CrossW( b2AddVW( w1, w3 ), e13 ), e13 ), inE13 );
+	d = b2BlendVW( d, b2NegVW( w2 ), inW2 );
+	d = b2BlendVW( d, b2NegVW( w3 ), inW3 );
+	d = b2BlendVW( d, b2CrossSVW( b2CrossW( b2AddVW( w2, w3 ), e23 ), e23 ), inE23 );
+	d = b2BlendVW( d, (b2Vec2W){ zero, zero }, inTriangle );
+	return d;
+}
+
+// Runs b2ShapeDistance on up to B2_SIMD_WIDTH inputs. Unused lanes repeat the last input.
+static void b2ShapeDistanceWide( const b2DistanceInput* inputs, b2SimplexCache* caches, b2DistanceOutput* outputs, int count )
+{
+	B2_ASSERT( 0 < count && count <= B2_SIMD_WIDTH );
+
+	// The lanes are filled one at a time
+	b2FloatW zero = b2ZeroW();
+	b2Vec2W zeroV = { zero, zero };
+	b2Vec2W pointsA[B2_MAX_POLYGON_VERTICES];
+	b2Vec2W pointsB[B2_MAX_POLYGON_VERTICES];
+	for ( int i = 0; i < B2_MAX_POLYGON_VERTICES; ++i )
+	{
+		pointsA[i] = zeroV;
+		pointsB[i] = zeroV;
+	}
+
+	b2TransformW xfA = { zeroV, { zero, zero } };
+	b2TransformW xfB = xfA;
+	b2FloatW cacheCount = zero;
+	b2FloatW cacheIndexA[3] = { zero, zero, zero };
+	b2FloatW cacheIndexB[3] = { zero, zero, zero };
+
+	int maxCountA = 1, maxCountB = 1;
+	for ( int lane = 0; lane < B2_SIMD_WIDTH; ++lane )
+	{
+		const b2DistanceInput* input = inputs + b2MinInt( lane, count - 1 );
+		const b2SimplexCache* cache = caches + b2MinInt( lane, count - 1 );
+		B2_ASSERT( input->proxyA.count > 0 && input->proxyB.count > 0 );
+		B2_ASSERT( input->proxyA.radius >= 0.0f );
+		B2_ASSERT( input->proxyB.radius >= 0.0f );
+		B2_ASSERT( cache->count <= 3 );
+
+		maxCountA = b2MaxInt( maxCountA, input->proxyA.count );
+		maxCountB = b2MaxInt( maxCountB, input->proxyB.count );
+
+		for ( int i = 0; i < B2_MAX_POLYGON_VERTICES; ++i )
+		{
+			b2SetLaneV( pointsA + i, lane, input->proxyA.points[b2MinInt( i, input->proxyA.count - 1 )] );
+			b2SetLaneV( pointsB + i, lane, input->proxyB.points[b2MinInt( i, input->proxyB.count - 1 )] );
+		}
+
+		b2SetLaneV( &xfA.p, lane, input->transformA.p );
+		b2SetLane( &xfA.q.C, lane, input->transformA.q.c );
+		b2SetLane( &xfA.q.S, lane, input->transformA.q.s );
+		b2SetLaneV( &xfB.p, lane, input->transformB.p );
+		b2SetLane( &xfB.q.C, lane, input->transformB.q.c );
+		b2SetLane( &xfB.q.S, lane, input->transformB.q.s );
+
+		b2SetLane( &cacheCount, lane, cache->count );
+		for ( int i = 0; i < 3; ++i )
+		{
+			b2SetLane( cacheIndexA + i, lane, i < cache->count ? cache->indexA[i] : 0.0f );
+			b2SetLane( cacheIndexB + i, lane, i < cache->count ? cache->indexB[i] : 0.0f );
+		}
+	}
+
+	// Get proxyB in frame A to avoid further transforms in the main loop.
+	{
+		b2TransformW transform = b2InvMulTransformsW( xfA, xfB );
+		for ( int i = 0; i < maxCountB; ++i )
+		{
+			pointsB[i] = b2TransformPointW( transform, pointsB[i] );
+		}
+	}
+
+	b2FloatW one = b2SplatW( 1.0f );
+
+	// Initialize the simplex from the cache. See b2MakeSimplexFromCache.
+	b2SimplexW simplex;
+	b2FloatW emptyCache = b2EqualsW( cacheCount, zero );
+	for ( int i = 0; i < 3; ++i )
+	{
+		simplex.indexA[i] = cacheIndexA[i];
+		simplex.indexB[i] = cacheIndexB[i];
+		simplex.wA[i] = b2GatherPointW( pointsA, maxCountA, cacheIndexA[i] );
+		simplex.wB[i] = b2GatherPointW( pointsB, maxCountB, cacheIndexB[i] );
+		simplex.w[i] = b2SubVW( simplex.wA[i], simplex.wB[i] );
+		simplex.a[i] = b2SplatW( -1.0f );
+	}
+	simplex.a[0] = b2BlendW( simplex.a[0], one, emptyCache );
+	simplex.count = b2BlendW( cacheCount, one, emptyCache );
+
+	b2Vec2W nonUnitNormal = { zero, zero };
+
+	// Lanes still iterating and lanes that stopped on overlap
+	b2FloatW active = b2EqualsW( zero, zero );
+	b2FloatW overlapped = zero;
+	b2Vec2W overlapPointA = { zero, zero };
+	b2Vec2W overlapPointB = { zero, zero };
+	b2FloatW iterations = zero;
+
+	const int maxIterations = 20;
+	for ( int iteration = 0; iteration < maxIterations; ++iteration )
+	{
+		// Copy simplex so we can identify duplicates.
+		b2FloatW saveCount = simplex.count;
+		b2FloatW saveA[3], saveB[3];
+		for ( int i = 0; i < 3; ++i )
+		{
+			saveA[i] = simplex.indexA[i];
+			saveB[i] = simplex.indexB[i];
+		}
+
+		b2SimplexW simplex2 = simplex;
+		b2Vec2W d2 = b2SolveSimplex2W( &simplex2 );
+		b2SimplexW simplex3 = simplex;
+		b2Vec2W d3 = b2SolveSimplex3W( &simplex3 );
+
+		b2FloatW isCount2 = b2AndW( active, b2EqualsW( simplex.count, b2SplatW( 2.0f ) ) );
+		b2FloatW isCount3 = b2AndW( active, b2EqualsW( simplex.count, b2SplatW( 3.0f ) ) );
+		b2BlendSimplexW( &simplex, &simplex2, isCount2 );
+		b2BlendSimplexW( &simplex, &simplex3, isCount3 );
+
+		b2Vec2W d = b2NegVW( simplex.w[0] );
+		d = b2BlendVW( d, d2, isCount2 );
+		d = b2BlendVW( d, d3, isCount3 );
+
+		// If we have 3 points, then the origin is in the corresponding triangle.
+		// Also stop on a search direction that is not numerically fit.
+		b2FloatW inTriangle = b2EqualsW( simplex.count, b2SplatW( 3.0f ) );
+		b2FloatW smallDirection = b2LessThanW( b2DotW( d, d ), b2SplatW( FLT_EPSILON * FLT_EPSILON ) );
+		b2FloatW overlap = b2AndW( active, b2OrW( inTriangle, smallDirection ) );
+		if ( b2AllZeroW( overlap ) == false )
+		{
+			b2Vec2W localPointA, localPointB;
+			b2ComputeWitnessPointsW( &simplex, &localPointA, &localPointB );
+			overlapPointA = b2BlendVW( overlapPointA, b2TransformPointW( xfA, localPointA ), overlap );
+			overlapPointB = b2BlendVW( overlapPointB, b2TransformPointW( xfA, localPointB ), overlap );
+			overlapped = b2OrW( overlapped, overlap );
+			active = b2AndW( active, b2NotW( overlap ) );
+		}
+
+		if ( b2AllZeroW( active ) )
+		{
+			break;
+		}
+
+		// Save the normal
+		nonUnitNormal = b2BlendVW( nonUnitNormal, d, active );
+
+		// Compute a tentative new simplex vertex using support points.
+		b2FloatW indexA, indexB;
+		b2Vec2W wA, wB;
+		b2FindSupportW( pointsA, maxCountA, d, &indexA, &wA );
+		b2FindSupportW( pointsB, maxCountB, b2NegVW( d ), &indexB, &wB );
+		b2Vec2W w = b2SubVW( wA, wB );
+
+		// The new vertex goes in the slot after the last vertex. The count is 1 or 2 here.
+		for ( int i = 1; i < 3; ++i )
+		{
+			b2FloatW slot = b2AndW( active, b2EqualsW( simplex.count, b2SplatW( (float)i ) ) );
+			simplex.indexA[i] = b2BlendW( simplex.indexA[i], indexA, slot );
+			simplex.indexB[i] = b2BlendW( simplex.indexB[i], indexB, slot );
+			simplex.wA[i] = b2BlendVW( simplex.wA[i], wA, slot );
+			simplex.wB[i] = b2BlendVW( simplex.wB[i], wB, slot );
+			simplex.w[i] = b2BlendVW( simplex.w[i], w, slot );
+		}
+
+		// Iteration count is equated to the number of support point calls.
+		iterations = b2BlendW( iterations, b2AddW( iterations, one ), active );
+
+		// Check for duplicate support points. This is the main termination criteria.
+		b2FloatW duplicate = zero;
+		for ( int i = 0; i < 3; ++i )
+		{
+			b2FloatW saved = b2GreaterThanW( saveCount, b2SplatW( (float)i ) );
+			b2FloatW same = b2AndW( b2EqualsW( indexA, saveA[i] ), b2EqualsW( indexB, saveB[i] ) );
+			duplicate = b2OrW( duplicate, b2AndW( saved, same ) );
+		}
+
+		// Lanes that found a duplicate support point stop to avoid cycling.
+		active = b2AndW( active, b2NotW( duplicate ) );
+
+		// New vertex is valid and needed.
+		simplex.count = b2BlendW( simplex.count, b2AddW( simplex.count, one ), active );
+
+		if ( b2AllZeroW( active ) )
+		{
+			break;
+		}
+	}
+
+	// Prepare output
+	b2Vec2W normal = b2NormalizeW( nonUnitNormal );
+	normal = (b2Vec2W){
+		b2SubW( b2MulW( xfA.q.C, normal.X ), b2MulW( xfA.q.S, normal.Y ) ),
+		b2AddW( b2MulW( xfA.q.S, normal.X ), b2MulW( xfA.q.C, normal.Y ) ),
+	};
+
+	b2Vec2W localPointA, localPointB;
+	b2ComputeWitnessPointsW( &simplex, &localPointA, &localPointB );
+	b2FloatW distance = b2DistanceW( localPointA, localPointB );
+	b2Vec2W pointA = b2TransformPointW( xfA, localPointA );
+	b2Vec2W pointB = b2TransformPointW( xfA, localPointB );
+
+	// The radii are applied per lane below
+	b2FloatW radiusA = zero, radiusB = zero, useRadii = zero;
+	for ( int lane = 0; lane < B2_SIMD_WIDTH; ++lane )
+	{
+		const b2DistanceInput* input = inputs + b2MinInt( lane, count - 1 );
+		b2SetLane( &radiusA, lane, input->proxyA.radius );
+		b2SetLane( &radiusB, lane, input->proxyB.radius );
+		b2SetLane( &useRadii, lane, input->useRadii ? 1.0f : 0.0f );
+	}
+
+	useRadii = b2GreaterThanW( useRadii, zero );
+	b2FloatW radiusDistance = b2SubW( b2SubW( distance, radiusA ), radiusB );
+	radiusDistance = b2BlendW( radiusDistance, zero, b2GreaterThanW( zero, radiusDistance ) );
+	distance = b2BlendW( distance, radiusDistance, useRadii );
+
+	// Keep closest points on perimeter even if overlapped, this way the points move smoothly.
+	pointA = b2BlendVW( pointA, b2MulAddVW( pointA, radiusA, normal ), useRadii );
+	pointB = b2BlendVW( pointB, b2MulSubVW( pointB, radiusB, normal ), useRadii );
+
+	for ( int lane = 0; lane < count; ++lane )
+	{
+		b2DistanceOutput output = { 0 };
+
+		if ( b2GetLaneMask( overlapped, lane ) )
+		{
+			// Overlap leaves the cache untouched
+			output.pointA = b2GetLaneV( overlapPointA, lane );
+			output.pointB = b2GetLaneV( overlapPointB, lane );
+			outputs[lane] = output;
+			continue;
+		}
+
+		output.normal = b2GetLaneV( normal, lane );
+		output.distance = b2GetLane( distance, lane );
+		output.pointA = b2GetLaneV( pointA, lane );
+		output.pointB = b2GetLaneV( pointB, lane );
+		output.iterations = (int)b2GetLane( iterations, lane );
+		output.simplexCount = 0;
+		outputs[lane] = output;
+
+		// Cache the simplex
+		b2SimplexCache cache = { 0 };
+		cache.count = (uint16_t)b2GetLane( simplex.count, lane );
+		for ( int i = 0; i < cache.count; ++i )
+		{
+			cache.indexA[i] = (uint8_t)b2GetLane( simplex.indexA[i], lane );
+			cache.indexB[i] = (uint8_t)b2GetLane( simplex.indexB[i], lane );
+		}
+		caches[lane] = cache;
+	}
+}
+
+void b2ShapeDistanceBatch( const b2DistanceInput* inputs, b2SimplexCache* caches, b2DistanceOutput* outputs, int count )
+{
+	for ( int base = 0; base < count; base += B2_SIMD_WIDTH )
+	{
+		int laneCount = b2MinInt( B2_SIMD_WIDTH, count - base );
+		b2ShapeDistanceWide( inputs + base, caches + base, outputs + base, laneCount );
+	}
+}
@@ -1,16 +1,31 @@
 // SPDX-FileCopyrightText: 2023 Erin Catto
 // SPDX-License-Identifier: MIT
 
+#include "dynamic_tree.h"
+
 #include "aabb.h"
+#include "aabb_wide.h"
 #include "core.h"
+#include "parallel_for.h"
+#include "physics_world.h"
+#include "snapshot.h"
 
 #include "box2d/collision.h"
 #include "box2d/constants.h"
 #include "box2d/math_functions.h"
 
 #include <float.h>
+#include <math.h>
 #include <string.h>
 
+#if defined( B2_SIMD_AVX512 ) || defined( B2_SIMD_AVX2 ) || defined( B2_SIMD_SSE2 )
+#include <emmintrin.h>
+#elif defined( B2_SIMD_NEON )
+#include <arm_neon.h>
+#elif defined( B2_SIMD_WASM )
+#include <wasm_simd128.h>
+#endif
+
 #define B2_TREE_STACK_SIZE 1024
 
 enum b2TreeNodeFlags
@@ -18,6 +33,9 @@ enum b2TreeNodeFlags
 	b2_allocatedNode = 0x0001,
 	b2_enlargedNode = 0x0002,
 	b2_leafNode = 0x0004,
+
+	// Scratch flag for subtrees that only hold proxies being destroyed
+	b2_prunedNode = 0x0008,
 };
 
 // A node in the dynamic tree.
@@ -55,6 +73,72 @@ typedef struct b2TreeNode
 	uint16_t flags;	 // 2
 } b2TreeNode;
 
+// A 4-wide node built by collapsing the binary tree. The child bounds are stored as SoA so a query
+// can test all four children at once. The lanes keep the left to right order of the binary tree
+// so traversal reports leaves in the same order as the binary tree.
+// 4 lanes are used for every SIMD width because 2D bounds fill a 128-bit register per component.
+typedef struct b2WideNode
+{
+	float lowerX[4];
+	float lowerY[4];
+	float upperX[4];
+	float upperY[4];
+	uint64_t categoryBits[4];
+	uint64_t userData[4];
+
+	// Wide node index for internal children, b2WideLeaf( proxyId ) for leaves,
+	// B2_NULL_INDEX for empty lanes
+	int32_t children[4];
+} b2WideNode;
+
+// Encode a proxy id as a wide child. This is its own inverse.
+static inline int b2WideLeaf( int code )
+{
+	return -2 - code;
+}
+
+// A compact node for trees that rarely change. The bounds are quantized relative to the decoded
+// parent bounds. Lower bounds are measured up from the parent lower bound and upper bounds are
+// measured down from the parent upper bound, so the decoded bounds always contain the node.
+// The node order follows the query traversal so the next node popped is usually adjacent.
+typedef struct b2QuantizedNode
+{
+	uint16_t lowerX, lowerY, upperX, upperY; // 8
+
+	// Category bits for collision filtering
+	uint64_t categoryBits; // 8
+
+	union
+	{
+		// Children (internal node)
+		struct
+		{
+			int32_t child1, child2;
+		} children;
+
+		// User data (leaf node)
+		uint64_t userData;
+	}; // 8
+
+	// Proxy id for leaf nodes, B2_NULL_INDEX for internal nodes
+	int32_t proxyId; // 4
+} b2QuantizedNode;
+
+// Query nodes are only valid while the binary tree is unchanged. The quantized nodes are freed
+// because they are meant for large trees that are rebuilt explicitly.
+static void b2InvalidateQueryNodes( b2DynamicTree* tree )
+{
+	tree->wideNodeCount = 0;
+
+	if ( tree->quantizedNodes != NULL )
+	{
+		b2Free( tree->quantizedNodes, tree->quantizedNodeCapacity * sizeof( b2QuantizedNode ) );
+		tree->quantizedNodes = NULL;
+		tree->quantizedNodeCount = 0;
+		tree->quantizedNodeCapacity = 0;
+	}
+}
+
 static b2TreeNode b2_defaultTreeNode = {
 	.aabb = { { 0.0f, 0.0f }, { 0.0f, 0.0f } },
 	.categoryBits = B2_DEFAULT_CATEGORY_BITS,
@@ -97,7 +181,7 @@ b2DynamicTree b2DynamicTree_Create( int proxyCapacity )
 	// maximum node count for a full binary tree is 2 * leafCount - 1
 	tree.nodeCapacity = 2 * capacity - 1;
 	tree.nodeCount = 0;
-	tree.nodes = (b2TreeNode*)b2Alloc( tree.nodeCapacity * sizeof( b2TreeNode ) );
+	tree.nodes = (b2TreeNode*)b2AllocTagged( tree.nodeCapacity * sizeof( b2TreeNode ), b2_allocTagTree, b2_allocLifetimeLong );
 
 	// todo eliminate this memset
 	memset( tree.nodes, 0, tree.nodeCapacity * sizeof( b2TreeNode ) );
@@ -130,6 +214,8 @@ void b2DynamicTree_Destroy( b2DynamicTree* tree )
 	b2Free( tree->leafBoxes, tree->rebuildCapacity * sizeof( b2AABB ) );
 	b2Free( tree->leafCenters, tree->rebuildCapacity * sizeof( b2Vec2 ) );
 	b2Free( tree->binIndices, tree->rebuildCapacity * sizeof( int32_t ) );
+	b2Free( tree->wideNodes, tree->wideNodeCapacity * sizeof( b2WideNode ) );
+	b2Free( tree->quantizedNodes, tree->quantizedNodeCapacity * sizeof( b2QuantizedNode ) );
 
 	memset( tree, 0, sizeof( b2DynamicTree ) );
 }
@@ -146,7 +232,8 @@ static int b2AllocateNode( b2DynamicTree* tree )
 		b2TreeNode* oldNodes = tree->nodes;
 		int oldCapacity = tree->nodeCapacity;
 		tree->nodeCapacity += oldCapacity >> 1;
-		tree->nodes = (b2TreeNode*)b2Alloc( tree->nodeCapacity * sizeof( b2TreeNode ) );
+		tree->nodes = (b2TreeNode*)b2AllocTagged( tree->nodeCapacity * sizeof( b2TreeNode ),
+												  b2_allocTagTree, b2_allocLifetimeLong );
 		B2_ASSERT( oldNodes != NULL );
 		memcpy( tree->nodes, oldNodes, tree->nodeCount * sizeof( b2TreeNode ) );
 
@@ -175,6 +262,34 @@ static int b2AllocateNode( b2DynamicTree* tree )
 	return nodeIndex;
 }
 
+// Grow the node pool so that the next additionalCount allocations don't move the nodes.
+static void b2ReserveNodes( b2DynamicTree* tree, int additionalCount )
+{
+	if ( tree->nodeCapacity - tree->nodeCount >= additionalCount )
+	{
+		return;
+	}
+
+	b2TreeNode* oldNodes = tree->nodes;
+	int oldCapacity = tree->nodeCapacity;
+	int newCapacity = b2MaxInt( oldCapacity + ( oldCapacity >> 1 ), tree->nodeCount + additionalCount );
+	tree->nodes = (b2TreeNode*)b2AllocTagged( newCapacity * sizeof( b2TreeNode ), b2_allocTagTree, b2_allocLifetimeLong );
+	B2_ASSERT( oldNodes != NULL );
+	memcpy( tree->nodes, oldNodes, oldCapacity * sizeof( b2TreeNode ) );
+	memset( tree->nodes + oldCapacity, 0, ( newCapacity - oldCapacity ) * sizeof( b2TreeNode ) );
+	b2Free( oldNodes, oldCapacity * sizeof( b2TreeNode ) );
+
+	// Put the new nodes at the front of the free list
+	for ( int i = oldCapacity; i < newCapacity - 1; ++i )
+	{
+		tree->nodes[i].next = i + 1;
+	}
+
+	tree->nodes[newCapacity - 1].next = tree->freeList;
+	tree->freeList = oldCapacity;
+	tree->nodeCapacity = newCapacity;
+}
+
 // Return a node to the pool.
 static void b2FreeNode( b2DynamicTree* tree, int nodeId )
 {
@@ -803,6 +918,7 @@ int b2DynamicTree_CreateProxy( b2DynamicTree* tree, b2AABB aabb, uint64_t catego
 	b2InsertLeaf( tree, proxyId, shouldRotate );
 
 	tree->proxyCount += 1;
+	b2InvalidateQueryNodes( tree );
 
 	return proxyId;
 }
@@ -817,6 +933,7 @@ void b2DynamicTree_DestroyProxy( b2DynamicTree* tree, int proxyId )
 
 	B2_ASSERT( tree->proxyCount > 0 );
 	tree->proxyCount -= 1;
+	b2InvalidateQueryNodes( tree );
 }
 
 int b2DynamicTree_GetProxyCount( const b2DynamicTree* tree )
@@ -838,6 +955,37 @@ void b2DynamicTree_MoveProxy( b2DynamicTree* tree, int proxyId, b2AABB aabb )
 
 	bool shouldRotate = false;
 	b2InsertLeaf( tree, proxyId, shouldRotate );
+
+	b2InvalidateQueryNodes( tree );
+}
+
+// Enlarge the ancestors of an enlarged node and mark them as enlarged for the next rebuild. This
+// stops before stopIndex.
+static void b2EnlargeAncestors( b2TreeNode* nodes, int parentIndex, b2AABB aabb, int stopIndex )
+{
+	while ( parentIndex != stopIndex )
+	{
+		bool changed = b2EnlargeAABB( &nodes[parentIndex].aabb, aabb );
+		nodes[parentIndex].flags |= b2_enlargedNode;
+		parentIndex = nodes[parentIndex].parent;
+
+		if ( changed == false )
+		{
+			break;
+		}
+	}
+
+	while ( parentIndex != stopIndex )
+	{
+		if ( nodes[parentIndex].flags & b2_enlargedNode )
+		{
+			// early out because this ancestor was previously ascended and marked as enlarged
+			break;
+		}
+
+		nodes[parentIndex].flags |= b2_enlargedNode;
+		parentIndex = nodes[parentIndex].parent;
+	}
 }
 
 void b2DynamicTree_EnlargeProxy( b2DynamicTree* tree, int proxyId, b2AABB aabb )
@@ -854,31 +1002,230 @@ void b2DynamicTree_EnlargeProxy( b2DynamicTree* tree, int proxyId, b2AABB aabb )
 	B2_VALIDATE( b2AABB_Contains( nodes[proxyId].aabb, aabb ) == false );
 
 	nodes[proxyId].aabb = aabb;
+	b2InvalidateQueryNodes( tree );
 
-	int parentIndex = nodes[proxyId].parent;
-	while ( parentIndex != B2_NULL_INDEX )
+	b2EnlargeAncestors( nodes, nodes[proxyId].parent, aabb, B2_NULL_INDEX );
+}
+
+// Enlarged proxies below this count are refit serially
+#define B2_PARALLEL_REFIT_MIN_COUNT 256
+
+// Refit in parallel splits the tree into the subtrees rooted at this depth
+#define B2_PARALLEL_REFIT_MAX_DEPTH 8
+
+typedef struct b2ParallelRefitContext
+{
+	b2TreeNode* nodes;
+	const int* proxyIds;
+	const b2AABB* aabbs;
+	int cutDepth;
+
+	// Subtree and subtree root of each proxy. The subtree is B2_NULL_INDEX for proxies above the
+	// cut depth.
+	int* subtrees;
+	int* proxyCutNodes;
+
+	// Proxy order grouped by subtree
+	int* sortedProxies;
+	int* subtreeStarts;
+	int* cutNodes;
+} b2ParallelRefitContext;
+
+// Find the subtree of each proxy by walking to the root. The subtree index follows the child
+// choices from the root down to the cut depth.
+static void b2FindRefitSubtreesTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	b2TracyCZoneNC( subtree_task, "Refit Subtrees", b2_colorFireBrick, true );
+
+	B2_UNUSED( workerIndex );
+	b2ParallelRefitContext* refitContext = context;
+	const b2TreeNode* nodes = refitContext->nodes;
+	int cutDepth = refitContext->cutDepth;
+
+	int path[B2_TREE_STACK_SIZE];
+	for ( int i = startIndex; i < endIndex; ++i )
 	{
-		bool changed = b2EnlargeAABB( &nodes[parentIndex].aabb, aabb );
-		nodes[parentIndex].flags |= b2_enlargedNode;
-		parentIndex = nodes[parentIndex].parent;
+		int pathCount = 0;
+		int nodeIndex = refitContext->proxyIds[i];
+		while ( nodeIndex != B2_NULL_INDEX && pathCount < B2_TREE_STACK_SIZE )
+		{
+			path[pathCount++] = nodeIndex;
+			nodeIndex = nodes[nodeIndex].parent;
+		}
 
-		if ( changed == false )
+		// path[pathCount - 1] is the root and path[0] is the proxy at depth pathCount - 1. A path
+		// deeper than the stack is left to the serial refit.
+		if ( nodeIndex != B2_NULL_INDEX || pathCount - 1 <= cutDepth )
 		{
-			break;
+			refitContext->subtrees[i] = B2_NULL_INDEX;
+			continue;
+		}
+
+		int subtree = 0;
+		for ( int depth = 1; depth <= cutDepth; ++depth )
+		{
+			int child = path[pathCount - 1 - depth];
+			int parent = path[pathCount - depth];
+			subtree = 2 * subtree + ( nodes[parent].children.child2 == child ? 1 : 0 );
 		}
+
+		refitContext->subtrees[i] = subtree;
+		refitContext->proxyCutNodes[i] = path[pathCount - 1 - cutDepth];
 	}
 
-	while ( parentIndex != B2_NULL_INDEX )
+	b2TracyCZoneEnd( subtree_task );
+}
+
+// Enlarge the proxies of each subtree and their ancestors up to the subtree root. Subtrees are
+// disjoint so each is owned by one task.
+static void b2RefitSubtreesTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	b2TracyCZoneNC( refit_task, "Refit", b2_colorFireBrick, true );
+
+	B2_UNUSED( workerIndex );
+	b2ParallelRefitContext* refitContext = context;
+	b2TreeNode* nodes = refitContext->nodes;
+
+	for ( int subtree = startIndex; subtree < endIndex; ++subtree )
 	{
-		if ( nodes[parentIndex].flags & b2_enlargedNode )
+		int start = refitContext->subtreeStarts[subtree];
+		int end = refitContext->subtreeStarts[subtree + 1];
+		if ( start == end )
 		{
-			// early out because this ancestor was previously ascended and marked as enlarged
-			break;
+			continue;
 		}
 
-		nodes[parentIndex].flags |= b2_enlargedNode;
-		parentIndex = nodes[parentIndex].parent;
+		int stopIndex = nodes[refitContext->cutNodes[subtree]].parent;
+		for ( int i = start; i < end; ++i )
+		{
+			int index = refitContext->sortedProxies[i];
+			int proxyId = refitContext->proxyIds[index];
+			b2AABB aabb = refitContext->aabbs[index];
+
+			B2_VALIDATE( b2IsLeaf( nodes + proxyId ) );
+			B2_VALIDATE( b2AABB_Contains( nodes[proxyId].aabb, aabb ) == false );
+
+			nodes[proxyId].aabb = aabb;
+			b2EnlargeAncestors( nodes, nodes[proxyId].parent, aabb, stopIndex );
+		}
+	}
+
+	b2TracyCZoneEnd( refit_task );
+}
+
+void b2EnlargeProxiesParallel( b2World* world, b2DynamicTree* tree, const int* proxyIds, const b2AABB* aabbs, int count )
+{
+	if ( count == 0 )
+	{
+		return;
+	}
+
+	int workerCount = world->workerCount;
+	if ( workerCount == 1 || count < B2_PARALLEL_REFIT_MIN_COUNT )
+	{
+		for ( int i = 0; i < count; ++i )
+		{
+			b2DynamicTree_EnlargeProxy( tree, proxyIds[i], aabbs[i] );
+		}
+		return;
+	}
+
+	b2TracyCZoneNC( parallel_refit, "Parallel Refit", b2_colorFireBrick, true );
+
+	b2InvalidateQueryNodes( tree );
+
+	// Aim for a few subtrees per worker
+	int cutDepth = 1;
+	while ( ( 1 << cutDepth ) < 4 * workerCount && cutDepth < B2_PARALLEL_REFIT_MAX_DEPTH )
+	{
+		cutDepth += 1;
+	}
+
+	int subtreeCount = 1 << cutDepth;
+
+	b2Stack* alloc = &world->stack;
+	b2ParallelRefitContext context;
+	context.nodes = tree->nodes;
+	context.proxyIds = proxyIds;
+	context.aabbs = aabbs;
+	context.cutDepth = cutDepth;
+	context.subtrees = b2StackAlloc( alloc, count * sizeof( int ), "refit subtrees" );
+	context.proxyCutNodes = b2StackAlloc( alloc, count * sizeof( int ), "refit proxy cut nodes" );
+	context.sortedProxies = b2StackAlloc( alloc, count * sizeof( int ), "refit proxies" );
+	context.subtreeStarts = b2StackAlloc( alloc, ( subtreeCount + 1 ) * sizeof( int ), "refit starts" );
+	context.cutNodes = b2StackAlloc( alloc, subtreeCount * sizeof( int ), "refit cut nodes" );
+
+	b2ParallelFor( world, b2FindRefitSubtreesTask, count, 64, &context );
+
+	// Counting sort by subtree keeps the proxy order within each subtree. Proxies above the cut
+	// depth go last.
+	int* subtreeStarts = context.subtreeStarts;
+	memset( subtreeStarts, 0, ( subtreeCount + 1 ) * sizeof( int ) );
+	for ( int i = 0; i < count; ++i )
+	{
+		int subtree = context.subtrees[i];
+		if ( subtree == B2_NULL_INDEX )
+		{
+			subtreeStarts[subtreeCount] += 1;
+			continue;
+		}
+
+		subtreeStarts[subtree] += 1;
+		context.cutNodes[subtree] = context.proxyCutNodes[i];
+	}
+
+	int sum = 0;
+	for ( int i = 0; i <= subtreeCount; ++i )
+	{
+		int bucketSize = subtreeStarts[i];
+		subtreeStarts[i] = sum;
+		sum += bucketSize;
+	}
+
+	for ( int i = 0; i < count; ++i )
+	{
+		int subtree = context.subtrees[i];
+		int bucket = subtree == B2_NULL_INDEX ? subtreeCount : subtree;
+		context.sortedProxies[subtreeStarts[bucket]++] = i;
+	}
+
+	// Shift the starts back
+	for ( int i = subtreeCount; i > 0; --i )
+	{
+		subtreeStarts[i] = subtreeStarts[i - 1];
+	}
+	subtreeStarts[0] = 0;
+
+	b2ParallelFor( world, b2RefitSubtreesTask, subtreeCount, 1, &context );
+
+	// Finish the ancestors of the subtree roots. A subtree root contains its enlarged proxies and
+	// its parent contains the old subtree bounds, so this matches enlarging by each proxy.
+	b2TreeNode* nodes = tree->nodes;
+	for ( int subtree = 0; subtree < subtreeCount; ++subtree )
+	{
+		if ( subtreeStarts[subtree] == subtreeStarts[subtree + 1] )
+		{
+			continue;
+		}
+
+		int cutNode = context.cutNodes[subtree];
+		b2EnlargeAncestors( nodes, nodes[cutNode].parent, nodes[cutNode].aabb, B2_NULL_INDEX );
 	}
+
+	// Proxies above the cut depth
+	for ( int i = subtreeStarts[subtreeCount]; i < count; ++i )
+	{
+		int index = context.sortedProxies[i];
+		b2DynamicTree_EnlargeProxy( tree, proxyIds[index], aabbs[index] );
+	}
+
+	b2StackFree( alloc, context.cutNodes );
+	b2StackFree( alloc, context.subtreeStarts );
+	b2StackFree( alloc, context.sortedProxies );
+	b2StackFree( alloc, context.proxyCutNodes );
+	b2StackFree( alloc, context.subtrees );
+
+	b2TracyCZoneEnd( parallel_refit );
 }
 
 void b2DynamicTree_SetCategoryBits( b2DynamicTree* tree, int proxyId, uint64_t categoryBits )
@@ -890,6 +1237,7 @@ void b2DynamicTree_SetCategoryBits( b2DynamicTree* tree, int proxyId, uint64_t c
 	B2_ASSERT( ( nodes[proxyId].flags & b2_leafNode ) == b2_leafNode );
 
 	nodes[proxyId].categoryBits = categoryBits;
+	b2InvalidateQueryNodes( tree );
 
 	// Fix up category bits in ancestor internal nodes
 	int nodeIndex = nodes[proxyId].parent;
@@ -1107,10 +1455,16 @@ void b2DynamicTree_ValidateNoEnlarged( const b2DynamicTree* tree )
 #endif
 }
 
+int b2GetTreeNodeSize( void )
+{
+	return (int)sizeof( b2TreeNode );
+}
+
 int b2DynamicTree_GetByteCount( const b2DynamicTree* tree )
 {
 	size_t size = sizeof( b2DynamicTree ) + sizeof( b2TreeNode ) * tree->nodeCapacity +
-				  tree->rebuildCapacity * ( sizeof( int ) + sizeof( b2AABB ) + sizeof( b2Vec2 ) + sizeof( int ) );
+				  tree->rebuildCapacity * ( sizeof( int ) + sizeof( b2AABB ) + sizeof( b2Vec2 ) + sizeof( int ) ) +
+				  tree->wideNodeCapacity * sizeof( b2WideNode ) + tree->quantizedNodeCapacity * sizeof( b2QuantizedNode );
 
 	return (int)size;
 }
@@ -1127,102 +1481,301 @@ b2AABB b2DynamicTree_GetAABB( const b2DynamicTree* tree, int proxyId )
 	return tree->nodes[proxyId].aabb;
 }
 
-b2TreeStats b2DynamicTree_Query( const b2DynamicTree* tree, b2AABB aabb, uint64_t maskBits, b2TreeQueryCallbackFcn* callback,
-								 void* context )
+static void b2SetWideLane( b2WideNode* wideNode, int lane, const b2TreeNode* node )
 {
-	b2TreeStats result = { 0 };
+	wideNode->lowerX[lane] = node->aabb.lowerBound.x;
+	wideNode->lowerY[lane] = node->aabb.lowerBound.y;
+	wideNode->upperX[lane] = node->aabb.upperBound.x;
+	wideNode->upperY[lane] = node->aabb.upperBound.y;
+	wideNode->categoryBits[lane] = node->categoryBits;
+	wideNode->userData[lane] = b2IsLeaf( node ) ? node->userData : 0;
+}
 
-	if ( tree->nodeCount == 0 )
+typedef struct b2WideBuildItem
+{
+	int nodeIndex;
+	int parentIndex;
+	int lane;
+} b2WideBuildItem;
+
+void b2DynamicTree_BuildWideNodes( b2DynamicTree* tree )
+{
+	tree->wideNodeCount = 0;
+
+	if ( tree->root == B2_NULL_INDEX )
 	{
-		return result;
+		return;
 	}
 
-	int stack[B2_TREE_STACK_SIZE];
+	// Every wide node absorbs at least one internal binary node
+	int capacity = b2MaxInt( tree->proxyCount, 1 );
+	if ( capacity > tree->wideNodeCapacity )
+	{
+		b2Free( tree->wideNodes, tree->wideNodeCapacity * sizeof( b2WideNode ) );
+		tree->wideNodeCapacity = capacity + capacity / 2;
+		tree->wideNodes = b2AllocTagged( tree->wideNodeCapacity * sizeof( b2WideNode ), b2_allocTagTree, b2_allocLifetimeLong );
+	}
+
+	const b2TreeNode* nodes = tree->nodes;
+	b2WideNode* wideNodes = tree->wideNodes;
+	int wideNodeCount = 0;
+
+	b2WideBuildItem stack[B2_TREE_STACK_SIZE];
 	int stackCount = 0;
-	stack[stackCount++] = tree->root;
+	stack[stackCount++] = (b2WideBuildItem){ tree->root, B2_NULL_INDEX, 0 };
 
 	while ( stackCount > 0 )
 	{
-		int nodeId = stack[--stackCount];
+		b2WideBuildItem item = stack[--stackCount];
 
-		const b2TreeNode* node = tree->nodes + nodeId;
-		result.nodeVisits += 1;
+		B2_ASSERT( wideNodeCount < tree->wideNodeCapacity );
+		int wideIndex = wideNodeCount++;
+		b2WideNode* wideNode = wideNodes + wideIndex;
 
-		if ( b2AABB_Overlaps( node->aabb, aabb ) && ( node->categoryBits & maskBits ) != 0 )
+		if ( item.parentIndex != B2_NULL_INDEX )
 		{
-			if ( b2IsLeaf( node ) )
-			{
-				// callback to user code with proxy id
-				bool proceed = callback( nodeId, node->userData, context );
-				result.leafVisits += 1;
+			wideNodes[item.parentIndex].children[item.lane] = wideIndex;
+		}
 
-				if ( proceed == false )
+		// Collapse binary nodes into up to 4 lanes by repeatedly opening the internal lane with the
+		// largest perimeter. Opening a lane puts its children in place so the leaf order is kept.
+		int lanes[4];
+		int laneCount = 1;
+		lanes[0] = item.nodeIndex;
+
+		while ( laneCount < 4 )
+		{
+			int bestLane = B2_NULL_INDEX;
+			float bestPerimeter = -1.0f;
+			for ( int i = 0; i < laneCount; ++i )
+			{
+				const b2TreeNode* node = nodes + lanes[i];
+				if ( b2IsLeaf( node ) == false )
 				{
-					return result;
+					float perimeter = b2Perimeter( node->aabb );
+					if ( perimeter > bestPerimeter )
+					{
+						bestPerimeter = perimeter;
+						bestLane = i;
+					}
 				}
 			}
+
+			if ( bestLane == B2_NULL_INDEX )
+			{
+				break;
+			}
+
+			const b2TreeNode* node = nodes + lanes[bestLane];
+			for ( int i = laneCount; i > bestLane + 1; --i )
+			{
+				lanes[i] = lanes[i - 1];
+			}
+
+			lanes[bestLane] = node->children.child1;
+			lanes[bestLane + 1] = node->children.child2;
+			laneCount += 1;
+		}
+
+		for ( int i = 0; i < laneCount; ++i )
+		{
+			const b2TreeNode* node = nodes + lanes[i];
+			b2SetWideLane( wideNode, i, node );
+
+			if ( b2IsLeaf( node ) )
+			{
+				wideNode->children[i] = b2WideLeaf( lanes[i] );
+			}
+			else if ( stackCount < B2_TREE_STACK_SIZE )
+			{
+				wideNode->children[i] = B2_NULL_INDEX;
+				stack[stackCount++] = (b2WideBuildItem){ lanes[i], wideIndex, i };
+			}
 			else
 			{
-				if ( stackCount < B2_TREE_STACK_SIZE - 1 )
-				{
-					stack[stackCount++] = node->children.child1;
-					stack[stackCount++] = node->children.child2;
-				}
-				else
-				{
-					B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
-				}
+				B2_ASSERT( stackCount < B2_TREE_STACK_SIZE );
 			}
 		}
+
+		// Empty lanes have inverted infinite bounds so they never overlap, even a query box of +/-FLT_MAX
+		for ( int i = laneCount; i < 4; ++i )
+		{
+			wideNode->lowerX[i] = INFINITY;
+			wideNode->lowerY[i] = INFINITY;
+			wideNode->upperX[i] = -INFINITY;
+			wideNode->upperY[i] = -INFINITY;
+			wideNode->categoryBits[i] = 0;
+			wideNode->userData[i] = 0;
+			wideNode->children[i] = B2_NULL_INDEX;
+		}
 	}
 
-	return result;
+	tree->wideNodeCount = wideNodeCount;
 }
 
-b2TreeStats b2DynamicTree_QueryAll( const b2DynamicTree* tree, b2AABB aabb, b2TreeQueryCallbackFcn* callback, void* context )
+// Bit mask of the lanes whose bounds overlap the box
+static inline int b2WideOverlapMask( const b2WideNode* node, b2AABB a )
 {
-	b2TreeStats result = { 0 };
+	return b2OverlapMask4( node->lowerX, node->lowerY, node->upperX, node->upperY, a );
+}
 
-	if ( tree->nodeCount == 0 )
+// Bit mask of the lanes that pass the segment separating axis test. The lane bounds are
+// extended by the extension.
+// |dot(v, p1 - c)| > dot(|v|, h)
+static inline int b2WideSegmentMask( const b2WideNode* node, b2Vec2 p1, b2Vec2 v, b2Vec2 absV, b2Vec2 extension )
+{
+#if defined( B2_SIMD_AVX512 ) || defined( B2_SIMD_AVX2 ) || defined( B2_SIMD_SSE2 )
+	__m128 half = _mm_set1_ps( 0.5f );
+	__m128 lowerX = _mm_loadu_ps( node->lowerX );
+	__m128 lowerY = _mm_loadu_ps( node->lowerY );
+	__m128 upperX = _mm_loadu_ps( node->upperX );
+	__m128 upperY = _mm_loadu_ps( node->upperY );
+	__m128 cx = _mm_mul_ps( half, _mm_add_ps( lowerX, upperX ) );
+	__m128 cy = _mm_mul_ps( half, _mm_add_ps( lowerY, upperY ) );
+	__m128 hx = _mm_add_ps( _mm_mul_ps( half, _mm_sub_ps( upperX, lowerX ) ), _mm_set1_ps( extension.x ) );
+	__m128 hy = _mm_add_ps( _mm_mul_ps( half, _mm_sub_ps( upperY, lowerY ) ), _mm_set1_ps( extension.y ) );
+	__m128 dx = _mm_sub_ps( _mm_set1_ps( p1.x ), cx );
+	__m128 dy = _mm_sub_ps( _mm_set1_ps( p1.y ), cy );
+	__m128 term1 = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( v.x ), dx ), _mm_mul_ps( _mm_set1_ps( v.y ), dy ) );
+	term1 = _mm_andnot_ps( _mm_set1_ps( -0.0f ), term1 );
+	__m128 term2 = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( absV.x ), hx ), _mm_mul_ps( _mm_set1_ps( absV.y ), hy ) );
+	return _mm_movemask_ps( _mm_cmple_ps( term1, term2 ) );
+#elif defined( B2_SIMD_NEON )
+	float32x4_t half = vdupq_n_f32( 0.5f );
+	float32x4_t lowerX = vld1q_f32( node->lowerX );
+	float32x4_t lowerY = vld1q_f32( node->lowerY );
+	float32x4_t upperX = vld1q_f32( node->upperX );
+	float32x4_t upperY = vld1q_f32( node->upperY );
+	float32x4_t cx = vmulq_f32( half, vaddq_f32( lowerX, upperX ) );
+	float32x4_t cy = vmulq_f32( half, vaddq_f32( lowerY, upperY ) );
+	float32x4_t hx = vaddq_f32( vmulq_f32( half, vsubq_f32( upperX, lowerX ) ), vdupq_n_f32( extension.x ) );
+	float32x4_t hy = vaddq_f32( vmulq_f32( half, vsubq_f32( upperY, lowerY ) ), vdupq_n_f32( extension.y ) );
+	float32x4_t dx = vsubq_f32( vdupq_n_f32( p1.x ), cx );
+	float32x4_t dy = vsubq_f32( vdupq_n_f32( p1.y ), cy );
+	float32x4_t term1 = vabsq_f32( vaddq_f32( vmulq_n_f32( dx, v.x ), vmulq_n_f32( dy, v.y ) ) );
+	float32x4_t term2 = vaddq_f32( vmulq_n_f32( hx, absV.x ), vmulq_n_f32( hy, absV.y ) );
+	uint32x4_t m = vcleq_f32( term1, term2 );
+	return (int)( ( vgetq_lane_u32( m, 0 ) & 1 ) | ( vgetq_lane_u32( m, 1 ) & 2 ) | ( vgetq_lane_u32( m, 2 ) & 4 ) |
+				  ( vgetq_lane_u32( m, 3 ) & 8 ) );
+#elif defined( B2_SIMD_WASM )
+	v128_t half = wasm_f32x4_splat( 0.5f );
+	v128_t lowerX = wasm_v128_load( node->lowerX );
+	v128_t lowerY = wasm_v128_load( node->lowerY );
+	v128_t upperX = wasm_v128_load( node->upperX );
+	v128_t upperY = wasm_v128_load( node->upperY );
+	v128_t cx = wasm_f32x4_mul( half, wasm_f32x4_add( lowerX, upperX ) );
+	v128_t cy = wasm_f32x4_mul( half, wasm_f32x4_add( lowerY, upperY ) );
+	v128_t hx = wasm_f32x4_add( wasm_f32x4_mul( half, wasm_f32x4_sub( upperX, lowerX ) ), wasm_f32x4_splat( extension.x ) );
+	v128_t hy = wasm_f32x4_add( wasm_f32x4_mul( half, wasm_f32x4_sub( upperY, lowerY ) ), wasm_f32x4_splat( extension.y ) );
+	v128_t dx = wasm_f32x4_sub( wasm_f32x4_splat( p1.x ), cx );
+	v128_t dy = wasm_f32x4_sub( wasm_f32x4_splat( p1.y ), cy );
+	v128_t term1 = wasm_f32x4_abs(
+		wasm_f32x4_add( wasm_f32x4_mul( wasm_f32x4_splat( v.x ), dx ), wasm_f32x4_mul( wasm_f32x4_splat( v.y ), dy ) ) );
+	v128_t term2 =
+		wasm_f32x4_add( wasm_f32x4_mul( wasm_f32x4_splat( absV.x ), hx ), wasm_f32x4_mul( wasm_f32x4_splat( absV.y ), hy ) );
+	return (int)wasm_i32x4_bitmask( wasm_f32x4_le( term1, term2 ) );
+#else
+	int mask = 0;
+	for ( int i = 0; i < 4; ++i )
 	{
-		return result;
+		b2Vec2 c = { 0.5f * ( node->lowerX[i] + node->upperX[i] ), 0.5f * ( node->lowerY[i] + node->upperY[i] ) };
+		b2Vec2 h = { 0.5f * ( node->upperX[i] - node->lowerX[i] ) + extension.x,
+					 0.5f * ( node->upperY[i] - node->lowerY[i] ) + extension.y };
+		float term1 = b2AbsFloat( b2Dot( v, b2Sub( p1, c ) ) );
+		float term2 = b2Dot( absV, h );
+		mask |= (int)( term1 <= term2 ) << i;
+	}
+	return mask;
+#endif
+}
+
+static inline int b2WideCategoryMask( const b2WideNode* node, uint64_t maskBits )
+{
+	int mask = 0;
+	for ( int i = 0; i < 4; ++i )
+	{
+		mask |= (int)( ( node->categoryBits[i] & maskBits ) != 0 ) << i;
 	}
+	return mask;
+}
+
+// Wide query shared by b2DynamicTree_Query and b2DynamicTree_QueryAll.
+// Lanes are pushed in order so the last lane is processed first, matching the binary traversal.
+static b2TreeStats b2QueryWide( const b2DynamicTree* tree, b2AABB aabb, uint64_t maskBits, bool filter,
+								b2TreeQueryCallbackFcn* callback, void* context )
+{
+	b2TreeStats result = { 0 };
+
+	const b2WideNode* wideNodes = tree->wideNodes;
+	const b2TreeNode* nodes = tree->nodes;
 
 	int stack[B2_TREE_STACK_SIZE];
 	int stackCount = 0;
-	stack[stackCount++] = tree->root;
+	stack[stackCount++] = 0;
 
 	while ( stackCount > 0 )
 	{
-		int nodeId = stack[--stackCount];
+		int code = stack[--stackCount];
 
-		const b2TreeNode* node = tree->nodes + nodeId;
-		result.nodeVisits += 1;
-
-		if ( b2AABB_Overlaps( node->aabb, aabb ) )
+		if ( code < 0 )
 		{
-			if ( b2IsLeaf( node ) )
+			// leaf deferred behind an internal lane
+			int proxyId = b2WideLeaf( code );
+			bool proceed = callback( proxyId, nodes[proxyId].userData, context );
+			result.leafVisits += 1;
+
+			if ( proceed == false )
 			{
-				// callback to user code with proxy id
-				bool proceed = callback( nodeId, node->userData, context );
-				result.leafVisits += 1;
+				return result;
+			}
 
-				if ( proceed == false )
-				{
-					return result;
-				}
+			continue;
+		}
+
+		const b2WideNode* node = wideNodes + code;
+		result.nodeVisits += 1;
+
+		int mask = b2WideOverlapMask( node, aabb );
+		if ( filter )
+		{
+			mask &= b2WideCategoryMask( node, maskBits );
+		}
+
+		// Trailing leaf lanes are next in traversal order so they are reported immediately
+		int lane = 3;
+		for ( ; lane >= 0; --lane )
+		{
+			if ( ( mask & ( 1 << lane ) ) == 0 )
+			{
+				continue;
 			}
-			else
+
+			int child = node->children[lane];
+			if ( child >= 0 )
 			{
-				if ( stackCount < B2_TREE_STACK_SIZE - 1 )
-				{
-					stack[stackCount++] = node->children.child1;
-					stack[stackCount++] = node->children.child2;
-				}
-				else
-				{
-					B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
-				}
+				break;
+			}
+
+			bool proceed = callback( b2WideLeaf( child ), node->userData[lane], context );
+			result.leafVisits += 1;
+
+			if ( proceed == false )
+			{
+				return result;
+			}
+		}
+
+		if ( stackCount + lane + 1 > B2_TREE_STACK_SIZE )
+		{
+			B2_ASSERT( stackCount + lane + 1 <= B2_TREE_STACK_SIZE );
+			continue;
+		}
+
+		for ( int i = 0; i <= lane; ++i )
+		{
+			if ( mask & ( 1 << i ) )
+			{
+				stack[stackCount++] = node->children[i];
 			}
 		}
 	}
@@ -1230,243 +1783,394 @@ b2TreeStats b2DynamicTree_QueryAll( const b2DynamicTree* tree, b2AABB aabb, b2Tr
 	return result;
 }
 
-b2TreeStats b2DynamicTree_RayCast( const b2DynamicTree* tree, const b2RayCastInput* input, uint64_t maskBits,
-								   b2TreeRayCastCallbackFcn* callback, void* context )
+typedef struct b2TreeCast
 {
-	b2TreeStats result = { 0 };
-
-	if ( tree->nodeCount == 0 )
-	{
-		return result;
-	}
+	b2Vec2 p1;
+	b2Vec2 v;
+	b2Vec2 absV;
 
-	b2Vec2 p1 = input->origin;
-	b2Vec2 d = input->translation;
+	// Added to the lane extents for the separating axis test
+	b2Vec2 extension;
 
-	b2Vec2 r = b2Normalize( d );
+	// Bounds of the cast, clipped by the leaf function
+	b2AABB aabb;
 
-	// v is perpendicular to the segment.
-	b2Vec2 v = b2CrossSV( 1.0f, r );
-	b2Vec2 abs_v = b2Abs( v );
+	uint64_t maskBits;
+} b2TreeCast;
 
-	// Separating axis for segment (Gino, p80).
-	// |dot(v, p1 - c)| > dot(|v|, h)
+// Returns the cast fraction reported by the user. Zero terminates the cast.
+typedef float b2TreeCastLeafFcn( b2TreeCast* cast, int proxyId, uint64_t userData, void* context );
 
-	float maxFraction = input->maxFraction;
+typedef struct b2WideCastItem
+{
+	int code;
+	float distanceSquared;
+} b2WideCastItem;
 
-	b2Vec2 p2 = b2MulAdd( p1, maxFraction, d );
+// Wide traversal shared by ray casts and shape casts. Hit lanes are pushed far to near, like the
+// binary traversal pushes the nearer child last.
+static b2TreeStats b2CastWide( const b2DynamicTree* tree, b2TreeCast* cast, b2TreeCastLeafFcn* leafFcn, void* context )
+{
+	b2TreeStats stats = { 0 };
 
-	// Build a bounding box for the segment.
-	b2AABB segmentAABB = { b2Min( p1, p2 ), b2Max( p1, p2 ) };
+	const b2WideNode* wideNodes = tree->wideNodes;
+	const b2TreeNode* nodes = tree->nodes;
 
 	int stack[B2_TREE_STACK_SIZE];
 	int stackCount = 0;
-	stack[stackCount++] = tree->root;
-
-	const b2TreeNode* nodes = tree->nodes;
-
-	b2RayCastInput subInput = *input;
+	stack[stackCount++] = 0;
 
 	while ( stackCount > 0 )
 	{
-		int nodeId = stack[--stackCount];
-		if ( nodeId == B2_NULL_INDEX )
+		int code = stack[--stackCount];
+
+		if ( code < 0 )
 		{
-			// todo is this possible?
-			B2_ASSERT( false );
-			continue;
-		}
+			int proxyId = b2WideLeaf( code );
+			const b2TreeNode* leaf = nodes + proxyId;
 
-		const b2TreeNode* node = nodes + nodeId;
-		result.nodeVisits += 1;
+			// The cast may have been clipped since this leaf was pushed
+			if ( b2AABB_Overlaps( leaf->aabb, cast->aabb ) == false )
+			{
+				continue;
+			}
 
-		b2AABB nodeAABB = node->aabb;
+			float value = leafFcn( cast, proxyId, leaf->userData, context );
+			stats.leafVisits += 1;
+
+			if ( value == 0.0f )
+			{
+				// The client has terminated the cast.
+				return stats;
+			}
 
-		if ( ( node->categoryBits & maskBits ) == 0 || b2AABB_Overlaps( nodeAABB, segmentAABB ) == false )
-		{
 			continue;
 		}
 
-		// Separating axis for segment (Gino, p80).
-		// |dot(v, p1 - c)| > dot(|v|, h)
-		// radius extension is added to the node in this case
-		b2Vec2 c = b2AABB_Center( nodeAABB );
-		b2Vec2 h = b2AABB_Extents( nodeAABB );
-		float term1 = b2AbsFloat( b2Dot( v, b2Sub( p1, c ) ) );
-		float term2 = b2Dot( abs_v, h );
-		if ( term2 < term1 )
+		const b2WideNode* node = wideNodes + code;
+		stats.nodeVisits += 1;
+
+		int mask = b2WideOverlapMask( node, cast->aabb ) & b2WideCategoryMask( node, cast->maskBits );
+		if ( mask == 0 )
 		{
 			continue;
 		}
 
-		if ( b2IsLeaf( node ) )
-		{
-			subInput.maxFraction = maxFraction;
-
-			float value = callback( &subInput, nodeId, node->userData, context );
-			result.leafVisits += 1;
-
-			// The user may return -1 to indicate this shape should be skipped
+		mask &= b2WideSegmentMask( node, cast->p1, cast->v, cast->absV, cast->extension );
 
-			if ( value == 0.0f )
+		// Sort the hit lanes far to near so the nearest is popped first
+		b2WideCastItem items[4];
+		int itemCount = 0;
+		for ( int i = 0; i < 4; ++i )
+		{
+			if ( ( mask & ( 1 << i ) ) == 0 )
 			{
-				// The client has terminated the ray cast.
-				return result;
+				continue;
 			}
 
-			if ( 0.0f < value && value <= maxFraction )
+			b2Vec2 c = { 0.5f * ( node->lowerX[i] + node->upperX[i] ), 0.5f * ( node->lowerY[i] + node->upperY[i] ) };
+			b2WideCastItem item = { node->children[i], b2DistanceSquared( c, cast->p1 ) };
+
+			int j = itemCount;
+			while ( j > 0 && items[j - 1].distanceSquared < item.distanceSquared )
 			{
-				// Update segment bounding box.
-				maxFraction = value;
-				p2 = b2MulAdd( p1, maxFraction, d );
-				segmentAABB.lowerBound = b2Min( p1, p2 );
-				segmentAABB.upperBound = b2Max( p1, p2 );
+				items[j] = items[j - 1];
+				j -= 1;
 			}
+
+			items[j] = item;
+			itemCount += 1;
 		}
-		else
+
+		if ( stackCount + itemCount > B2_TREE_STACK_SIZE )
 		{
-			if ( stackCount < B2_TREE_STACK_SIZE - 1 )
-			{
-				b2Vec2 c1 = b2AABB_Center( nodes[node->children.child1].aabb );
-				b2Vec2 c2 = b2AABB_Center( nodes[node->children.child2].aabb );
-				if ( b2DistanceSquared( c1, p1 ) < b2DistanceSquared( c2, p1 ) )
-				{
-					stack[stackCount++] = node->children.child2;
-					stack[stackCount++] = node->children.child1;
-				}
-				else
-				{
-					stack[stackCount++] = node->children.child1;
-					stack[stackCount++] = node->children.child2;
-				}
-			}
-			else
-			{
-				B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
-			}
+			B2_ASSERT( stackCount + itemCount <= B2_TREE_STACK_SIZE );
+			continue;
+		}
+
+		for ( int i = 0; i < itemCount; ++i )
+		{
+			stack[stackCount++] = items[i].code;
 		}
 	}
 
-	return result;
+	return stats;
 }
 
-b2TreeStats b2DynamicTree_ShapeCast( const b2DynamicTree* tree, const b2ShapeCastInput* input, uint64_t maskBits,
-									 b2TreeShapeCastCallbackFcn* callback, void* context )
+typedef struct b2RayCastLeafContext
 {
-	b2TreeStats stats = { 0 };
+	b2RayCastInput subInput;
+	float maxFraction;
+	b2TreeRayCastCallbackFcn* callback;
+	void* context;
+} b2RayCastLeafContext;
 
-	if ( tree->nodeCount == 0 || input->proxy.count == 0 )
+static float b2RayCastLeaf( b2TreeCast* cast, int proxyId, uint64_t userData, void* context )
+{
+	b2RayCastLeafContext* rayContext = context;
+	rayContext->subInput.maxFraction = rayContext->maxFraction;
+
+	float value = rayContext->callback( &rayContext->subInput, proxyId, userData, rayContext->context );
+
+	// The user may return -1 to indicate this shape should be skipped
+	if ( 0.0f < value && value <= rayContext->maxFraction )
 	{
-		return stats;
+		// Update segment bounding box.
+		rayContext->maxFraction = value;
+		b2Vec2 p1 = rayContext->subInput.origin;
+		b2Vec2 p2 = b2MulAdd( p1, value, rayContext->subInput.translation );
+		cast->aabb.lowerBound = b2Min( p1, p2 );
+		cast->aabb.upperBound = b2Max( p1, p2 );
 	}
 
-	b2AABB originAABB = { input->proxy.points[0], input->proxy.points[0] };
-	for ( int i = 1; i < input->proxy.count; ++i )
+	return value;
+}
+
+typedef struct b2ShapeCastLeafContext
+{
+	b2ShapeCastInput subInput;
+	b2AABB originAABB;
+	float maxFraction;
+	b2TreeShapeCastCallbackFcn* callback;
+	void* context;
+} b2ShapeCastLeafContext;
+
+static float b2ShapeCastLeaf( b2TreeCast* cast, int proxyId, uint64_t userData, void* context )
+{
+	b2ShapeCastLeafContext* shapeContext = context;
+	shapeContext->subInput.maxFraction = shapeContext->maxFraction;
+
+	float value = shapeContext->callback( &shapeContext->subInput, proxyId, userData, shapeContext->context );
+
+	if ( 0.0f < value && value < shapeContext->maxFraction )
 	{
-		originAABB.lowerBound = b2Min( originAABB.lowerBound, input->proxy.points[i] );
-		originAABB.upperBound = b2Max( originAABB.upperBound, input->proxy.points[i] );
+		// Update the total bounding box.
+		shapeContext->maxFraction = value;
+		b2AABB originAABB = shapeContext->originAABB;
+		b2Vec2 t = b2MulSV( value, shapeContext->subInput.translation );
+		cast->aabb.lowerBound = b2Min( originAABB.lowerBound, b2Add( originAABB.lowerBound, t ) );
+		cast->aabb.upperBound = b2Max( originAABB.upperBound, b2Add( originAABB.upperBound, t ) );
 	}
 
-	b2Vec2 radius = { input->proxy.radius, input->proxy.radius };
+	return value;
+}
 
-	originAABB.lowerBound = b2Sub( originAABB.lowerBound, radius );
-	originAABB.upperBound = b2Add( originAABB.upperBound, radius );
+#define B2_QUANTIZED_MAX 65535
 
-	b2Vec2 p1 = b2AABB_Center( originAABB );
-	b2Vec2 extension = b2AABB_Extents( originAABB );
+typedef struct b2QuantizedItem
+{
+	int nodeIndex;
+	b2AABB parentBox;
+} b2QuantizedItem;
 
-	// v is perpendicular to the segment.
-	b2Vec2 r = input->translation;
-	b2Vec2 v = b2CrossSV( 1.0f, r );
-	b2Vec2 abs_v = b2Abs( v );
+static inline float b2QuantizedScale( float lower, float upper )
+{
+	return ( upper - lower ) * ( 1.0f / B2_QUANTIZED_MAX );
+}
 
-	// Separating axis for segment (Gino, p80).
-	// |dot(v, p1 - c)| > dot(|v|, h)
+static inline b2AABB b2DecodeQuantized( const b2QuantizedNode* node, b2AABB parentBox )
+{
+	float scaleX = b2QuantizedScale( parentBox.lowerBound.x, parentBox.upperBound.x );
+	float scaleY = b2QuantizedScale( parentBox.lowerBound.y, parentBox.upperBound.y );
+
+	b2AABB box;
+	box.lowerBound.x = parentBox.lowerBound.x + scaleX * (float)node->lowerX;
+	box.lowerBound.y = parentBox.lowerBound.y + scaleY * (float)node->lowerY;
+	box.upperBound.x = parentBox.upperBound.x - scaleX * (float)node->upperX;
+	box.upperBound.y = parentBox.upperBound.y - scaleY * (float)node->upperY;
+	return box;
+}
 
-	float maxFraction = input->maxFraction;
+// Quantize the distance up from a parent lower bound so the decoded bound is at or below the value.
+// Rounding in the decode can move the bound past the value, so the decode is checked.
+static uint16_t b2QuantizeLower( float bound, float scale, float value )
+{
+	if ( scale <= 0.0f || value <= bound )
+	{
+		return 0;
+	}
 
-	// Build total box for the shape cast
-	b2Vec2 t = b2MulSV( maxFraction, input->translation );
-	b2AABB totalAABB = {
-		b2Min( originAABB.lowerBound, b2Add( originAABB.lowerBound, t ) ),
-		b2Max( originAABB.upperBound, b2Add( originAABB.upperBound, t ) ),
-	};
+	int q = (int)b2MinFloat( ( value - bound ) / scale, (float)B2_QUANTIZED_MAX );
+	while ( q > 0 && bound + scale * (float)q > value )
+	{
+		q -= 1;
+	}
+
+	return (uint16_t)q;
+}
+
+// Quantize the distance down from a parent upper bound so the decoded bound is at or above the value
+static uint16_t b2QuantizeUpper( float bound, float scale, float value )
+{
+	if ( scale <= 0.0f || value >= bound )
+	{
+		return 0;
+	}
+
+	int q = (int)b2MinFloat( ( bound - value ) / scale, (float)B2_QUANTIZED_MAX );
+	while ( q > 0 && bound - scale * (float)q < value )
+	{
+		q -= 1;
+	}
+
+	return (uint16_t)q;
+}
+
+typedef struct b2QuantizedBuildItem
+{
+	int nodeIndex;
+	int parentIndex;
+	b2AABB parentBox;
+} b2QuantizedBuildItem;
+
+void b2DynamicTree_BuildQuantizedNodes( b2DynamicTree* tree )
+{
+	b2Free( tree->quantizedNodes, tree->quantizedNodeCapacity * sizeof( b2QuantizedNode ) );
+	tree->quantizedNodes = NULL;
+	tree->quantizedNodeCount = 0;
+	tree->quantizedNodeCapacity = 0;
+
+	// The quantized nodes replace the wide nodes
+	b2Free( tree->wideNodes, tree->wideNodeCapacity * sizeof( b2WideNode ) );
+	tree->wideNodes = NULL;
+	tree->wideNodeCount = 0;
+	tree->wideNodeCapacity = 0;
+
+	if ( tree->root == B2_NULL_INDEX )
+	{
+		return;
+	}
+
+	int capacity = 2 * tree->proxyCount - 1;
+	tree->quantizedNodes = b2AllocTagged( capacity * sizeof( b2QuantizedNode ), b2_allocTagTree, b2_allocLifetimeLong );
+	tree->quantizedNodeCapacity = capacity;
 
-	b2ShapeCastInput subInput = *input;
 	const b2TreeNode* nodes = tree->nodes;
+	b2QuantizedNode* quantizedNodes = tree->quantizedNodes;
+	int nodeCount = 0;
 
-	int stack[B2_TREE_STACK_SIZE];
+	// The root is quantized relative to its own bounds so it decodes exactly
+	tree->quantizedRootBox = nodes[tree->root].aabb;
+
+	b2QuantizedBuildItem stack[B2_TREE_STACK_SIZE];
 	int stackCount = 0;
-	stack[stackCount++] = tree->root;
+	stack[stackCount++] = (b2QuantizedBuildItem){ tree->root, B2_NULL_INDEX, tree->quantizedRootBox };
 
 	while ( stackCount > 0 )
 	{
-		int nodeId = stack[--stackCount];
-		if ( nodeId == B2_NULL_INDEX )
+		b2QuantizedBuildItem item = stack[--stackCount];
+		const b2TreeNode* node = nodes + item.nodeIndex;
+
+		B2_ASSERT( nodeCount < capacity );
+		int quantizedIndex = nodeCount++;
+		b2QuantizedNode* quantizedNode = quantizedNodes + quantizedIndex;
+
+		if ( item.parentIndex != B2_NULL_INDEX )
 		{
-			// todo is this possible?
-			B2_ASSERT( false );
-			continue;
+			// child2 is pushed last and so it is built first
+			b2QuantizedNode* parent = quantizedNodes + item.parentIndex;
+			if ( parent->children.child2 == B2_NULL_INDEX )
+			{
+				parent->children.child2 = quantizedIndex;
+			}
+			else
+			{
+				parent->children.child1 = quantizedIndex;
+			}
 		}
 
-		const b2TreeNode* node = nodes + nodeId;
-		stats.nodeVisits += 1;
+		b2AABB parentBox = item.parentBox;
+		float scaleX = b2QuantizedScale( parentBox.lowerBound.x, parentBox.upperBound.x );
+		float scaleY = b2QuantizedScale( parentBox.lowerBound.y, parentBox.upperBound.y );
+		quantizedNode->lowerX = b2QuantizeLower( parentBox.lowerBound.x, scaleX, node->aabb.lowerBound.x );
+		quantizedNode->lowerY = b2QuantizeLower( parentBox.lowerBound.y, scaleY, node->aabb.lowerBound.y );
+		quantizedNode->upperX = b2QuantizeUpper( parentBox.upperBound.x, scaleX, node->aabb.upperBound.x );
+		quantizedNode->upperY = b2QuantizeUpper( parentBox.upperBound.y, scaleY, node->aabb.upperBound.y );
+		quantizedNode->categoryBits = node->categoryBits;
 
-		if ( ( node->categoryBits & maskBits ) == 0 || b2AABB_Overlaps( node->aabb, totalAABB ) == false )
+		b2AABB box = b2DecodeQuantized( quantizedNode, parentBox );
+		B2_ASSERT( b2AABB_Contains( box, node->aabb ) );
+
+		if ( b2IsLeaf( node ) )
 		{
+			quantizedNode->userData = node->userData;
+			quantizedNode->proxyId = item.nodeIndex;
 			continue;
 		}
 
-		// Separating axis for segment (Gino, p80).
-		// |dot(v, p1 - c)| > dot(|v|, h)
-		// radius extension is added to the node in this case
-		b2Vec2 c = b2AABB_Center( node->aabb );
-		b2Vec2 h = b2Add( b2AABB_Extents( node->aabb ), extension );
-		float term1 = b2AbsFloat( b2Dot( v, b2Sub( p1, c ) ) );
-		float term2 = b2Dot( abs_v, h );
-		if ( term2 < term1 )
+		quantizedNode->children.child1 = B2_NULL_INDEX;
+		quantizedNode->children.child2 = B2_NULL_INDEX;
+		quantizedNode->proxyId = B2_NULL_INDEX;
+
+		if ( stackCount < B2_TREE_STACK_SIZE - 1 )
 		{
-			continue;
+			stack[stackCount++] = (b2QuantizedBuildItem){ node->children.child1, quantizedIndex, box };
+			stack[stackCount++] = (b2QuantizedBuildItem){ node->children.child2, quantizedIndex, box };
 		}
-
-		if ( b2IsLeaf( node ) )
+		else
 		{
-			subInput.maxFraction = maxFraction;
+			B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
+		}
+	}
 
-			float value = callback( &subInput, nodeId, node->userData, context );
-			stats.leafVisits += 1;
+	B2_ASSERT( nodeCount == capacity );
+	tree->quantizedNodeCount = nodeCount;
+}
 
-			if ( value == 0.0f )
+// Quantized query shared by b2DynamicTree_Query and b2DynamicTree_QueryAll. The decoded bounds are
+// conservative, so leaves are confirmed with the exact bounds.
+static b2TreeStats b2QueryQuantized( const b2DynamicTree* tree, b2AABB aabb, uint64_t maskBits, bool filter,
+									 b2TreeQueryCallbackFcn* callback, void* context )
+{
+	b2TreeStats result = { 0 };
+
+	const b2QuantizedNode* quantizedNodes = tree->quantizedNodes;
+	const b2TreeNode* nodes = tree->nodes;
+
+	b2QuantizedItem stack[B2_TREE_STACK_SIZE];
+	int stackCount = 0;
+	stack[stackCount++] = (b2QuantizedItem){ 0, tree->quantizedRootBox };
+
+	while ( stackCount > 0 )
+	{
+		b2QuantizedItem item = stack[--stackCount];
+
+		const b2QuantizedNode* node = quantizedNodes + item.nodeIndex;
+		result.nodeVisits += 1;
+
+		if ( filter && ( node->categoryBits & maskBits ) == 0 )
+		{
+			continue;
+		}
+
+		b2AABB box = b2DecodeQuantized( node, item.parentBox );
+		if ( b2AABB_Overlaps( box, aabb ) == false )
+		{
+			continue;
+		}
+
+		if ( node->proxyId != B2_NULL_INDEX )
+		{
+			if ( b2AABB_Overlaps( nodes[node->proxyId].aabb, aabb ) == false )
 			{
-				// The client has terminated the ray cast.
-				return stats;
+				continue;
 			}
 
-			if ( 0.0f < value && value < maxFraction )
+			// callback to user code with proxy id
+			bool proceed = callback( node->proxyId, node->userData, context );
+			result.leafVisits += 1;
+
+			if ( proceed == false )
 			{
-				// Update segment bounding box.
-				maxFraction = value;
-				t = b2MulSV( maxFraction, input->translation );
-				totalAABB.lowerBound = b2Min( originAABB.lowerBound, b2Add( originAABB.lowerBound, t ) );
-				totalAABB.upperBound = b2Max( originAABB.upperBound, b2Add( originAABB.upperBound, t ) );
+				return result;
 			}
 		}
 		else
 		{
 			if ( stackCount < B2_TREE_STACK_SIZE - 1 )
 			{
-				b2Vec2 c1 = b2AABB_Center( nodes[node->children.child1].aabb );
-				b2Vec2 c2 = b2AABB_Center( nodes[node->children.child2].aabb );
-				if ( b2DistanceSquared( c1, p1 ) < b2DistanceSquared( c2, p1 ) )
-				{
-					stack[stackCount++] = node->children.child2;
-					stack[stackCount++] = node->children.child1;
-				}
-				else
-				{
-					stack[stackCount++] = node->children.child1;
-					stack[stackCount++] = node->children.child2;
-				}
+				stack[stackCount++] = (b2QuantizedItem){ node->children.child1, box };
+				stack[stackCount++] = (b2QuantizedItem){ node->children.child2, box };
 			}
 			else
 			{
@@ -1475,576 +2179,2235 @@ b2TreeStats b2DynamicTree_ShapeCast( const b2DynamicTree* tree, const b2ShapeCas
 		}
 	}
 
-	return stats;
+	return result;
 }
 
-// Median split == 0, Surface area heuristic == 1
-#define B2_TREE_HEURISTIC 0
-
-#if B2_TREE_HEURISTIC == 0
-
-// Median split heuristic
-static int b2PartitionMid( int* indices, b2Vec2* centers, int count )
+// Segment overlap and separating axis test of a box against a cast
+static bool b2TreeCastOverlaps( const b2TreeCast* cast, b2AABB box )
 {
-	// Handle trivial case
-	if ( count <= 2 )
+	if ( b2AABB_Overlaps( box, cast->aabb ) == false )
 	{
-		return count / 2;
+		return false;
 	}
 
-	b2Vec2 lowerBound = centers[0];
-	b2Vec2 upperBound = centers[0];
+	// |dot(v, p1 - c)| > dot(|v|, h)
+	b2Vec2 c = b2AABB_Center( box );
+	b2Vec2 h = b2Add( b2AABB_Extents( box ), cast->extension );
+	float term1 = b2AbsFloat( b2Dot( cast->v, b2Sub( cast->p1, c ) ) );
+	float term2 = b2Dot( cast->absV, h );
+	return term1 <= term2;
+}
 
-	for ( int i = 1; i < count; ++i )
-	{
-		lowerBound = b2Min( lowerBound, centers[i] );
-		upperBound = b2Max( upperBound, centers[i] );
-	}
+// Quantized traversal shared by ray casts and shape casts
+static b2TreeStats b2CastQuantized( const b2DynamicTree* tree, b2TreeCast* cast, b2TreeCastLeafFcn* leafFcn, void* context )
+{
+	b2TreeStats stats = { 0 };
 
-	b2Vec2 d = b2Sub( upperBound, lowerBound );
-	b2Vec2 c = { 0.5f * ( lowerBound.x + upperBound.x ), 0.5f * ( lowerBound.y + upperBound.y ) };
+	const b2QuantizedNode* quantizedNodes = tree->quantizedNodes;
+	const b2TreeNode* nodes = tree->nodes;
 
-	// Partition longest axis using the Hoare partition scheme
-	// https://en.wikipedia.org/wiki/Quicksort
-	// https://nicholasvadivelu.com/2021/01/11/array-partition/
-	int i1 = 0, i2 = count;
-	if ( d.x > d.y )
+	b2QuantizedItem stack[B2_TREE_STACK_SIZE];
+	int stackCount = 0;
+	stack[stackCount++] = (b2QuantizedItem){ 0, tree->quantizedRootBox };
+
+	while ( stackCount > 0 )
 	{
-		float pivot = c.x;
+		b2QuantizedItem item = stack[--stackCount];
 
-		while ( i1 < i2 )
+		const b2QuantizedNode* node = quantizedNodes + item.nodeIndex;
+		stats.nodeVisits += 1;
+
+		if ( ( node->categoryBits & cast->maskBits ) == 0 )
 		{
-			while ( i1 < i2 && centers[i1].x < pivot )
-			{
-				i1 += 1;
-			};
+			continue;
+		}
 
-			while ( i1 < i2 && centers[i2 - 1].x >= pivot )
+		b2AABB box = b2DecodeQuantized( node, item.parentBox );
+		if ( b2TreeCastOverlaps( cast, box ) == false )
+		{
+			continue;
+		}
+
+		if ( node->proxyId != B2_NULL_INDEX )
+		{
+			if ( b2TreeCastOverlaps( cast, nodes[node->proxyId].aabb ) == false )
 			{
-				i2 -= 1;
-			};
+				continue;
+			}
 
-			if ( i1 < i2 )
+			float value = leafFcn( cast, node->proxyId, node->userData, context );
+			stats.leafVisits += 1;
+
+			if ( value == 0.0f )
 			{
-				// Swap indices
+				// The client has terminated the cast.
+				return stats;
+			}
+		}
+		else
+		{
+			if ( stackCount < B2_TREE_STACK_SIZE - 1 )
+			{
+				const b2QuantizedNode* child1 = quantizedNodes + node->children.child1;
+				const b2QuantizedNode* child2 = quantizedNodes + node->children.child2;
+				b2Vec2 c1 = b2AABB_Center( b2DecodeQuantized( child1, box ) );
+				b2Vec2 c2 = b2AABB_Center( b2DecodeQuantized( child2, box ) );
+				if ( b2DistanceSquared( c1, cast->p1 ) < b2DistanceSquared( c2, cast->p1 ) )
 				{
-					int temp = indices[i1];
-					indices[i1] = indices[i2 - 1];
-					indices[i2 - 1] = temp;
+					stack[stackCount++] = (b2QuantizedItem){ node->children.child2, box };
+					stack[stackCount++] = (b2QuantizedItem){ node->children.child1, box };
 				}
-
-				// Swap centers
+				else
 				{
-					b2Vec2 temp = centers[i1];
-					centers[i1] = centers[i2 - 1];
-					centers[i2 - 1] = temp;
+					stack[stackCount++] = (b2QuantizedItem){ node->children.child1, box };
+					stack[stackCount++] = (b2QuantizedItem){ node->children.child2, box };
 				}
-
-				i1 += 1;
-				i2 -= 1;
+			}
+			else
+			{
+				B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
 			}
 		}
 	}
-	else
+
+	return stats;
+}
+
+b2TreeStats b2DynamicTree_Query( const b2DynamicTree* tree, b2AABB aabb, uint64_t maskBits, b2TreeQueryCallbackFcn* callback,
+								 void* context )
+{
+	b2TreeStats result = { 0 };
+
+	if ( tree->nodeCount == 0 )
 	{
-		float pivot = c.y;
+		return result;
+	}
 
-		while ( i1 < i2 )
-		{
-			while ( i1 < i2 && centers[i1].y < pivot )
-			{
-				i1 += 1;
-			};
+	if ( tree->quantizedNodeCount > 0 )
+	{
+		return b2QueryQuantized( tree, aabb, maskBits, true, callback, context );
+	}
 
-			while ( i1 < i2 && centers[i2 - 1].y >= pivot )
+	if ( tree->wideNodeCount > 0 )
+	{
+		return b2QueryWide( tree, aabb, maskBits, true, callback, context );
+	}
+
+	int stack[B2_TREE_STACK_SIZE];
+	int stackCount = 0;
+	stack[stackCount++] = tree->root;
+
+	while ( stackCount > 0 )
+	{
+		int nodeId = stack[--stackCount];
+
+		const b2TreeNode* node = tree->nodes + nodeId;
+		result.nodeVisits += 1;
+
+		if ( b2AABB_Overlaps( node->aabb, aabb ) && ( node->categoryBits & maskBits ) != 0 )
+		{
+			if ( b2IsLeaf( node ) )
 			{
-				i2 -= 1;
-			};
+				// callback to user code with proxy id
+				bool proceed = callback( nodeId, node->userData, context );
+				result.leafVisits += 1;
 
-			if ( i1 < i2 )
+				if ( proceed == false )
+				{
+					return result;
+				}
+			}
+			else
 			{
-				// Swap indices
+				if ( stackCount < B2_TREE_STACK_SIZE - 1 )
 				{
-					int temp = indices[i1];
-					indices[i1] = indices[i2 - 1];
-					indices[i2 - 1] = temp;
+					stack[stackCount++] = node->children.child1;
+					stack[stackCount++] = node->children.child2;
 				}
-
-				// Swap centers
+				else
 				{
-					b2Vec2 temp = centers[i1];
-					centers[i1] = centers[i2 - 1];
-					centers[i2 - 1] = temp;
+					B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
 				}
-
-				i1 += 1;
-				i2 -= 1;
 			}
 		}
 	}
-	B2_ASSERT( i1 == i2 );
-
-	if ( i1 > 0 && i1 < count )
-	{
-		return i1;
-	}
 
-	return count / 2;
+	return result;
 }
 
-#else
-
-#define B2_BIN_COUNT 8
-
-typedef struct b2TreeBin
-{
-	b2AABB aabb;
-	int count;
-} b2TreeBin;
-
-typedef struct b2TreePlane
-{
-	b2AABB leftAABB;
-	b2AABB rightAABB;
-	int leftCount;
-	int rightCount;
-} b2TreePlane;
-
-// "On Fast Construction of SAH-based Bounding Volume Hierarchies" by Ingo Wald
-// Returns the left child count
-static int b2PartitionSAH( int* indices, int* binIndices, b2AABB* boxes, int count )
+b2TreeStats b2DynamicTree_QueryAll( const b2DynamicTree* tree, b2AABB aabb, b2TreeQueryCallbackFcn* callback, void* context )
 {
-	B2_ASSERT( count > 0 );
-
-	b2TreeBin bins[B2_BIN_COUNT];
-	b2TreePlane planes[B2_BIN_COUNT - 1];
-
-	b2Vec2 center = b2AABB_Center( boxes[0] );
-	b2AABB centroidAABB;
-	centroidAABB.lowerBound = center;
-	centroidAABB.upperBound = center;
+	b2TreeStats result = { 0 };
 
-	for ( int i = 1; i < count; ++i )
+	if ( tree->nodeCount == 0 )
 	{
-		center = b2AABB_Center( boxes[i] );
-		centroidAABB.lowerBound = b2Min( centroidAABB.lowerBound, center );
-		centroidAABB.upperBound = b2Max( centroidAABB.upperBound, center );
+		return result;
 	}
 
-	b2Vec2 d = b2Sub( centroidAABB.upperBound, centroidAABB.lowerBound );
-
-	// Find longest axis
-	int axisIndex;
-	float invD;
-	if ( d.x > d.y )
+	if ( tree->quantizedNodeCount > 0 )
 	{
-		axisIndex = 0;
-		invD = d.x;
+		return b2QueryQuantized( tree, aabb, 0, false, callback, context );
 	}
-	else
+
+	if ( tree->wideNodeCount > 0 )
+	{
+		return b2QueryWide( tree, aabb, 0, false, callback, context );
+	}
+
+	int stack[B2_TREE_STACK_SIZE];
+	int stackCount = 0;
+	stack[stackCount++] = tree->root;
+
+	while ( stackCount > 0 )
+	{
+		int nodeId = stack[--stackCount];
+
+		const b2TreeNode* node = tree->nodes + nodeId;
+		result.nodeVisits += 1;
+
+		if ( b2AABB_Overlaps( node->aabb, aabb ) )
+		{
+			if ( b2IsLeaf( node ) )
+			{
+				// callback to user code with proxy id
+				bool proceed = callback( nodeId, node->userData, context );
+				result.leafVisits += 1;
+
+				if ( proceed == false )
+				{
+					return result;
+				}
+			}
+			else
+			{
+				if ( stackCount < B2_TREE_STACK_SIZE - 1 )
+				{
+					stack[stackCount++] = node->children.child1;
+					stack[stackCount++] = node->children.child2;
+				}
+				else
+				{
+					B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
+				}
+			}
+		}
+	}
+
+	return result;
+}
+
+b2TreeStats b2DynamicTree_RayCast( const b2DynamicTree* tree, const b2RayCastInput* input, uint64_t maskBits,
+								   b2TreeRayCastCallbackFcn* callback, void* context )
+{
+	b2TreeStats result = { 0 };
+
+	if ( tree->nodeCount == 0 )
+	{
+		return result;
+	}
+
+	b2Vec2 p1 = input->origin;
+	b2Vec2 d = input->translation;
+
+	b2Vec2 r = b2Normalize( d );
+
+	// v is perpendicular to the segment.
+	b2Vec2 v = b2CrossSV( 1.0f, r );
+	b2Vec2 abs_v = b2Abs( v );
+
+	// Separating axis for segment (Gino, p80).
+	// |dot(v, p1 - c)| > dot(|v|, h)
+
+	float maxFraction = input->maxFraction;
+
+	b2Vec2 p2 = b2MulAdd( p1, maxFraction, d );
+
+	// Build a bounding box for the segment.
+	b2AABB segmentAABB = { b2Min( p1, p2 ), b2Max( p1, p2 ) };
+
+	if ( tree->quantizedNodeCount > 0 || tree->wideNodeCount > 0 )
+	{
+		b2TreeCast cast = { p1, v, abs_v, b2Vec2_zero, segmentAABB, maskBits };
+		b2RayCastLeafContext rayContext = { *input, maxFraction, callback, context };
+		if ( tree->quantizedNodeCount > 0 )
+		{
+			return b2CastQuantized( tree, &cast, b2RayCastLeaf, &rayContext );
+		}
+
+		return b2CastWide( tree, &cast, b2RayCastLeaf, &rayContext );
+	}
+
+	int stack[B2_TREE_STACK_SIZE];
+	int stackCount = 0;
+	stack[stackCount++] = tree->root;
+
+	const b2TreeNode* nodes = tree->nodes;
+
+	b2RayCastInput subInput = *input;
+
+	while ( stackCount > 0 )
+	{
+		int nodeId = stack[--stackCount];
+		if ( nodeId == B2_NULL_INDEX )
+		{
+			// todo is this possible?
+			B2_ASSERT( false );
+			continue;
+		}
+
+		const b2TreeNode* node = nodes + nodeId;
+		result.nodeVisits += 1;
+
+		b2AABB nodeAABB = node->aabb;
+
+		if ( ( node->categoryBits & maskBits ) == 0 || b2AABB_Overlaps( nodeAABB, segmentAABB ) == false )
+		{
+			continue;
+		}
+
+		// Separating axis for segment (Gino, p80).
+		// |dot(v, p1 - c)| > dot(|v|, h)
+		// radius extension is added to the node in this case
+		b2Vec2 c = b2AABB_Center( nodeAABB );
+		b2Vec2 h = b2AABB_Extents( nodeAABB );
+		float term1 = b2AbsFloat( b2Dot( v, b2Sub( p1, c ) ) );
+		float term2 = b2Dot( abs_v, h );
+		if ( term2 < term1 )
+		{
+			continue;
+		}
+
+		if ( b2IsLeaf( node ) )
+		{
+			subInput.maxFraction = maxFraction;
+
+			float value = callback( &subInput, nodeId, node->userData, context );
+			result.leafVisits += 1;
+
+			// The user may return -1 to indicate this shape should be skipped
+
+			if ( value == 0.0f )
+			{
+				// The client has terminated the ray cast.
+				return result;
+			}
+
+			if ( 0.0f < value && value <= maxFraction )
+			{
+				// Update segment bounding box.
+				maxFraction = value;
+				p2 = b2MulAdd( p1, maxFraction, d );
+				segmentAABB.lowerBound = b2Min( p1, p2 );
+				segmentAABB.upperBound = b2Max( p1, p2 );
+			}
+		}
+		else
+		{
+			if ( stackCount < B2_TREE_STACK_SIZE - 1 )
+			{
+				b2Vec2 c1 = b2AABB_Center( nodes[node->children.child1].aabb );
+				b2Vec2 c2 = b2AABB_Center( nodes[node->children.child2].aabb );
+				if ( b2DistanceSquared( c1, p1 ) < b2DistanceSquared( c2, p1 ) )
+				{
+					stack[stackCount++] = node->children.child2;
+					stack[stackCount++] = node->children.child1;
+				}
+				else
+				{
+					stack[stackCount++] = node->children.child1;
+					stack[stackCount++] = node->children.child2;
+				}
+			}
+			else
+			{
+				B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
+			}
+		}
+	}
+
+	return result;
+}
+
+// Rays of a packet stored as SoA so a node is tested against all rays at once. Each lane has the
+// same separating axis test as b2DynamicTree_RayCast. Inactive lanes have an empty segment box.
+typedef struct b2RayPacket
+{
+	float p1X[B2_RAY_PACKET_SIZE];
+	float p1Y[B2_RAY_PACKET_SIZE];
+	float vX[B2_RAY_PACKET_SIZE];
+	float vY[B2_RAY_PACKET_SIZE];
+	float absVX[B2_RAY_PACKET_SIZE];
+	float absVY[B2_RAY_PACKET_SIZE];
+	float lowerX[B2_RAY_PACKET_SIZE];
+	float lowerY[B2_RAY_PACKET_SIZE];
+	float upperX[B2_RAY_PACKET_SIZE];
+	float upperY[B2_RAY_PACKET_SIZE];
+} b2RayPacket;
+
+static void b2SetPacketSegment( b2RayPacket* packet, int lane, b2Vec2 p1, b2Vec2 d, float maxFraction )
+{
+	b2Vec2 p2 = b2MulAdd( p1, maxFraction, d );
+	b2Vec2 lower = b2Min( p1, p2 );
+	b2Vec2 upper = b2Max( p1, p2 );
+	packet->lowerX[lane] = lower.x;
+	packet->lowerY[lane] = lower.y;
+	packet->upperX[lane] = upper.x;
+	packet->upperY[lane] = upper.y;
+}
+
+static void b2ClearPacketSegment( b2RayPacket* packet, int lane )
+{
+	packet->lowerX[lane] = FLT_MAX;
+	packet->lowerY[lane] = FLT_MAX;
+	packet->upperX[lane] = -FLT_MAX;
+	packet->upperY[lane] = -FLT_MAX;
+}
+
+// Returns the mask of rays that may hit the node box
+static inline int b2RayPacketMask( const b2RayPacket* packet, b2AABB a )
+{
+	b2Vec2 c = b2AABB_Center( a );
+	b2Vec2 h = b2AABB_Extents( a );
+
+#if defined( B2_SIMD_AVX512 ) || defined( B2_SIMD_AVX2 ) || defined( B2_SIMD_SSE2 )
+	__m128 lowerX = _mm_loadu_ps( packet->lowerX );
+	__m128 lowerY = _mm_loadu_ps( packet->lowerY );
+	__m128 upperX = _mm_loadu_ps( packet->upperX );
+	__m128 upperY = _mm_loadu_ps( packet->upperY );
+	__m128 overlapX = _mm_and_ps( _mm_cmple_ps( lowerX, _mm_set1_ps( a.upperBound.x ) ),
+								  _mm_cmple_ps( _mm_set1_ps( a.lowerBound.x ), upperX ) );
+	__m128 overlapY = _mm_and_ps( _mm_cmple_ps( lowerY, _mm_set1_ps( a.upperBound.y ) ),
+								  _mm_cmple_ps( _mm_set1_ps( a.lowerBound.y ), upperY ) );
+	__m128 dx = _mm_sub_ps( _mm_loadu_ps( packet->p1X ), _mm_set1_ps( c.x ) );
+	__m128 dy = _mm_sub_ps( _mm_loadu_ps( packet->p1Y ), _mm_set1_ps( c.y ) );
+	__m128 term1 = _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( packet->vX ), dx ), _mm_mul_ps( _mm_loadu_ps( packet->vY ), dy ) );
+	term1 = _mm_andnot_ps( _mm_set1_ps( -0.0f ), term1 );
+	__m128 term2 = _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( packet->absVX ), _mm_set1_ps( h.x ) ),
+							   _mm_mul_ps( _mm_loadu_ps( packet->absVY ), _mm_set1_ps( h.y ) ) );
+	__m128 m = _mm_and_ps( _mm_and_ps( overlapX, overlapY ), _mm_cmple_ps( term1, term2 ) );
+	return _mm_movemask_ps( m );
+#elif defined( B2_SIMD_NEON )
+	float32x4_t lowerX = vld1q_f32( packet->lowerX );
+	float32x4_t lowerY = vld1q_f32( packet->lowerY );
+	float32x4_t upperX = vld1q_f32( packet->upperX );
+	float32x4_t upperY = vld1q_f32( packet->upperY );
+	uint32x4_t overlapX = vandq_u32( vcleq_f32( lowerX, vdupq_n_f32( a.upperBound.x ) ),
+									 vcleq_f32( vdupq_n_f32( a.lowerBound.x ), upperX ) );
+	uint32x4_t overlapY = vandq_u32( vcleq_f32( lowerY, vdupq_n_f32( a.upperBound.y ) ),
+									 vcleq_f32( vdupq_n_f32( a.lowerBound.y ), upperY ) );
+	float32x4_t dx = vsubq_f32( vld1q_f32( packet->p1X ), vdupq_n_f32( c.x ) );
+	float32x4_t dy = vsubq_f32( vld1q_f32( packet->p1Y ), vdupq_n_f32( c.y ) );
+	float32x4_t term1 = vabsq_f32( vaddq_f32( vmulq_f32( vld1q_f32( packet->vX ), dx ), vmulq_f32( vld1q_f32( packet->vY ), dy ) ) );
+	float32x4_t term2 = vaddq_f32( vmulq_n_f32( vld1q_f32( packet->absVX ), h.x ), vmulq_n_f32( vld1q_f32( packet->absVY ), h.y ) );
+	uint32x4_t m = vandq_u32( vandq_u32( overlapX, overlapY ), vcleq_f32( term1, term2 ) );
+	return (int)( ( vgetq_lane_u32( m, 0 ) & 1 ) | ( vgetq_lane_u32( m, 1 ) & 2 ) | ( vgetq_lane_u32( m, 2 ) & 4 ) |
+				  ( vgetq_lane_u32( m, 3 ) & 8 ) );
+#elif defined( B2_SIMD_WASM )
+	v128_t lowerX = wasm_v128_load( packet->lowerX );
+	v128_t lowerY = wasm_v128_load( packet->lowerY );
+	v128_t upperX = wasm_v128_load( packet->upperX );
+	v128_t upperY = wasm_v128_load( packet->upperY );
+	v128_t overlapX = wasm_v128_and( wasm_f32x4_le( lowerX, wasm_f32x4_splat( a.upperBound.x ) ),
+									 wasm_f32x4_le( wasm_f32x4_splat( a.lowerBound.x ), upperX ) );
+	v128_t overlapY = wasm_v128_and( wasm_f32x4_le( lowerY, wasm_f32x4_splat( a.upperBound.y ) ),
+									 wasm_f32x4_le( wasm_f32x4_splat( a.lowerBound.y ), upperY ) );
+	v128_t dx = wasm_f32x4_sub( wasm_v128_load( packet->p1X ), wasm_f32x4_splat( c.x ) );
+	v128_t dy = wasm_f32x4_sub( wasm_v128_load( packet->p1Y ), wasm_f32x4_splat( c.y ) );
+	v128_t term1 = wasm_f32x4_abs(
+		wasm_f32x4_add( wasm_f32x4_mul( wasm_v128_load( packet->vX ), dx ), wasm_f32x4_mul( wasm_v128_load( packet->vY ), dy ) ) );
+	v128_t term2 = wasm_f32x4_add( wasm_f32x4_mul( wasm_v128_load( packet->absVX ), wasm_f32x4_splat( h.x ) ),
+								   wasm_f32x4_mul( wasm_v128_load( packet->absVY ), wasm_f32x4_splat( h.y ) ) );
+	v128_t m = wasm_v128_and( wasm_v128_and( overlapX, overlapY ), wasm_f32x4_le( term1, term2 ) );
+	return (int)wasm_i32x4_bitmask( m );
+#else
+	int mask = 0;
+	for ( int i = 0; i < B2_RAY_PACKET_SIZE; ++i )
+	{
+		bool overlap = packet->lowerX[i] <= a.upperBound.x && a.lowerBound.x <= packet->upperX[i] &&
+					   packet->lowerY[i] <= a.upperBound.y && a.lowerBound.y <= packet->upperY[i];
+		float term1 = b2AbsFloat( packet->vX[i] * ( packet->p1X[i] - c.x ) + packet->vY[i] * ( packet->p1Y[i] - c.y ) );
+		float term2 = packet->absVX[i] * h.x + packet->absVY[i] * h.y;
+		mask |= (int)( overlap && term1 <= term2 ) << i;
+	}
+	return mask;
+#endif
+}
+
+b2TreeStats b2DynamicTree_RayCastPacket( const b2DynamicTree* tree, const b2RayCastInput* inputs, int rayCount,
+										 uint64_t maskBits, b2TreeRayPacketCallbackFcn* callback, void* context )
+{
+	b2TreeStats result = { 0 };
+
+	B2_ASSERT( 0 < rayCount && rayCount <= B2_RAY_PACKET_SIZE );
+	if ( tree->nodeCount == 0 )
+	{
+		return result;
+	}
+
+	b2RayPacket packet;
+	float maxFractions[B2_RAY_PACKET_SIZE];
+	for ( int i = 0; i < B2_RAY_PACKET_SIZE; ++i )
+	{
+		if ( i >= rayCount )
+		{
+			packet.p1X[i] = 0.0f;
+			packet.p1Y[i] = 0.0f;
+			packet.vX[i] = 0.0f;
+			packet.vY[i] = 0.0f;
+			packet.absVX[i] = 0.0f;
+			packet.absVY[i] = 0.0f;
+			b2ClearPacketSegment( &packet, i );
+			maxFractions[i] = 0.0f;
+			continue;
+		}
+
+		b2Vec2 p1 = inputs[i].origin;
+		b2Vec2 r = b2Normalize( inputs[i].translation );
+
+		// v is perpendicular to the segment.
+		b2Vec2 v = b2CrossSV( 1.0f, r );
+		packet.p1X[i] = p1.x;
+		packet.p1Y[i] = p1.y;
+		packet.vX[i] = v.x;
+		packet.vY[i] = v.y;
+		packet.absVX[i] = b2AbsFloat( v.x );
+		packet.absVY[i] = b2AbsFloat( v.y );
+
+		maxFractions[i] = inputs[i].maxFraction;
+		b2SetPacketSegment( &packet, i, p1, inputs[i].translation, maxFractions[i] );
+	}
+
+	int activeMask = ( 1 << rayCount ) - 1;
+
+	// Children are ordered near to far from the first ray origin. The packet rays should be coherent.
+	b2Vec2 p1 = inputs[0].origin;
+
+	int stack[B2_TREE_STACK_SIZE];
+	int stackCount = 0;
+	stack[stackCount++] = tree->root;
+
+	const b2TreeNode* nodes = tree->nodes;
+
+	while ( stackCount > 0 )
+	{
+		int nodeId = stack[--stackCount];
+		const b2TreeNode* node = nodes + nodeId;
+		result.nodeVisits += 1;
+
+		if ( ( node->categoryBits & maskBits ) == 0 )
+		{
+			continue;
+		}
+
+		int mask = b2RayPacketMask( &packet, node->aabb );
+		if ( mask == 0 )
+		{
+			continue;
+		}
+
+		if ( b2IsLeaf( node ) )
+		{
+			for ( int i = 0; i < rayCount; ++i )
+			{
+				if ( ( mask & ( 1 << i ) ) == 0 )
+				{
+					continue;
+				}
+
+				b2RayCastInput subInput = inputs[i];
+				subInput.maxFraction = maxFractions[i];
+
+				float value = callback( &subInput, i, nodeId, node->userData, context );
+				result.leafVisits += 1;
+
+				// The user may return -1 to indicate this shape should be skipped
+
+				if ( value == 0.0f )
+				{
+					// The client has terminated this ray
+					b2ClearPacketSegment( &packet, i );
+					activeMask &= ~( 1 << i );
+				}
+				else if ( 0.0f < value && value <= maxFractions[i] )
+				{
+					maxFractions[i] = value;
+					b2SetPacketSegment( &packet, i, inputs[i].origin, inputs[i].translation, value );
+				}
+			}
+
+			if ( activeMask == 0 )
+			{
+				return result;
+			}
+		}
+		else
+		{
+			if ( stackCount < B2_TREE_STACK_SIZE - 1 )
+			{
+				b2Vec2 c1 = b2AABB_Center( nodes[node->children.child1].aabb );
+				b2Vec2 c2 = b2AABB_Center( nodes[node->children.child2].aabb );
+				if ( b2DistanceSquared( c1, p1 ) < b2DistanceSquared( c2, p1 ) )
+				{
+					stack[stackCount++] = node->children.child2;
+					stack[stackCount++] = node->children.child1;
+				}
+				else
+				{
+					stack[stackCount++] = node->children.child1;
+					stack[stackCount++] = node->children.child2;
+				}
+			}
+			else
+			{
+				B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
+			}
+		}
+	}
+
+	return result;
+}
+
+b2TreeStats b2DynamicTree_ShapeCast( const b2DynamicTree* tree, const b2ShapeCastInput* input, uint64_t maskBits,
+									 b2TreeShapeCastCallbackFcn* callback, void* context )
+{
+	b2TreeStats stats = { 0 };
+
+	if ( tree->nodeCount == 0 || input->proxy.count == 0 )
+	{
+		return stats;
+	}
+
+	b2AABB originAABB = { input->proxy.points[0], input->proxy.points[0] };
+	for ( int i = 1; i < input->proxy.count; ++i )
+	{
+		originAABB.lowerBound = b2Min( originAABB.lowerBound, input->proxy.points[i] );
+		originAABB.upperBound = b2Max( originAABB.upperBound, input->proxy.points[i] );
+	}
+
+	b2Vec2 radius = { input->proxy.radius, input->proxy.radius };
+
+	originAABB.lowerBound = b2Sub( originAABB.lowerBound, radius );
+	originAABB.upperBound = b2Add( originAABB.upperBound, radius );
+
+	b2Vec2 p1 = b2AABB_Center( originAABB );
+	b2Vec2 extension = b2AABB_Extents( originAABB );
+
+	// v is perpendicular to the segment.
+	b2Vec2 r = input->translation;
+	b2Vec2 v = b2CrossSV( 1.0f, r );
+	b2Vec2 abs_v = b2Abs( v );
+
+	// Separating axis for segment (Gino, p80).
+	// |dot(v, p1 - c)| > dot(|v|, h)
+
+	float maxFraction = input->maxFraction;
+
+	// Build total box for the shape cast
+	b2Vec2 t = b2MulSV( maxFraction, input->translation );
+	b2AABB totalAABB = {
+		b2Min( originAABB.lowerBound, b2Add( originAABB.lowerBound, t ) ),
+		b2Max( originAABB.upperBound, b2Add( originAABB.upperBound, t ) ),
+	};
+
+	if ( tree->quantizedNodeCount > 0 || tree->wideNodeCount > 0 )
+	{
+		b2TreeCast cast = { p1, v, abs_v, extension, totalAABB, maskBits };
+		b2ShapeCastLeafContext shapeContext = { *input, originAABB, maxFraction, callback, context };
+		if ( tree->quantizedNodeCount > 0 )
+		{
+			return b2CastQuantized( tree, &cast, b2ShapeCastLeaf, &shapeContext );
+		}
+
+		return b2CastWide( tree, &cast, b2ShapeCastLeaf, &shapeContext );
+	}
+
+	b2ShapeCastInput subInput = *input;
+	const b2TreeNode* nodes = tree->nodes;
+
+	int stack[B2_TREE_STACK_SIZE];
+	int stackCount = 0;
+	stack[stackCount++] = tree->root;
+
+	while ( stackCount > 0 )
+	{
+		int nodeId = stack[--stackCount];
+		if ( nodeId == B2_NULL_INDEX )
+		{
+			// todo is this possible?
+			B2_ASSERT( false );
+			continue;
+		}
+
+		const b2TreeNode* node = nodes + nodeId;
+		stats.nodeVisits += 1;
+
+		if ( ( node->categoryBits & maskBits ) == 0 || b2AABB_Overlaps( node->aabb, totalAABB ) == false )
+		{
+			continue;
+		}
+
+		// Separating axis for segment (Gino, p80).
+		// |dot(v, p1 - c)| > dot(|v|, h)
+		// radius extension is added to the node in this case
+		b2Vec2 c = b2AABB_Center( node->aabb );
+		b2Vec2 h = b2Add( b2AABB_Extents( node->aabb ), extension );
+		float term1 = b2AbsFloat( b2Dot( v, b2Sub( p1, c ) ) );
+		float term2 = b2Dot( abs_v, h );
+		if ( term2 < term1 )
+		{
+			continue;
+		}
+
+		if ( b2IsLeaf( node ) )
+		{
+			subInput.maxFraction = maxFraction;
+
+			float value = callback( &subInput, nodeId, node->userData, context );
+			stats.leafVisits += 1;
+
+			if ( value == 0.0f )
+			{
+				// The client has terminated the ray cast.
+				return stats;
+			}
+
+			if ( 0.0f < value && value < maxFraction )
+			{
+				// Update segment bounding box.
+				maxFraction = value;
+				t = b2MulSV( maxFraction, input->translation );
+				totalAABB.lowerBound = b2Min( originAABB.lowerBound, b2Add( originAABB.lowerBound, t ) );
+				totalAABB.upperBound = b2Max( originAABB.upperBound, b2Add( originAABB.upperBound, t ) );
+			}
+		}
+		else
+		{
+			if ( stackCount < B2_TREE_STACK_SIZE - 1 )
+			{
+				b2Vec2 c1 = b2AABB_Center( nodes[node->children.child1].aabb );
+				b2Vec2 c2 = b2AABB_Center( nodes[node->children.child2].aabb );
+				if ( b2DistanceSquared( c1, p1 ) < b2DistanceSquared( c2, p1 ) )
+				{
+					stack[stackCount++] = node->children.child2;
+					stack[stackCount++] = node->children.child1;
+				}
+				else
+				{
+					stack[stackCount++] = node->children.child1;
+					stack[stackCount++] = node->children.child2;
+				}
+			}
+			else
+			{
+				B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
+			}
+		}
+	}
+
+	return stats;
+}
+
+// Median split == 0, Surface area heuristic == 1
+#define B2_TREE_HEURISTIC 0
+
+#if B2_TREE_HEURISTIC == 0
+
+// Median split heuristic
+static int b2PartitionMid( int* indices, b2Vec2* centers, int count )
+{
+	// Handle trivial case
+	if ( count <= 2 )
+	{
+		return count / 2;
+	}
+
+	b2Vec2 lowerBound = centers[0];
+	b2Vec2 upperBound = centers[0];
+
+	for ( int i = 1; i < count; ++i )
+	{
+		lowerBound = b2Min( lowerBound, centers[i] );
+		upperBound = b2Max( upperBound, centers[i] );
+	}
+
+	b2Vec2 d = b2Sub( upperBound, lowerBound );
+	b2Vec2 c = { 0.5f * ( lowerBound.x + upperBound.x ), 0.5f * ( lowerBound.y + upperBound.y ) };
+
+	// Partition longest axis using the Hoare partition scheme
+	// https://en.wikipedia.org/wiki/Quicksort
+	// https://nicholasvadivelu.com/2021/01/11/array-partition/
+	int i1 = 0, i2 = count;
+	if ( d.x > d.y )
+	{
+		float pivot = c.x;
+
+		while ( i1 < i2 )
+		{
+			while ( i1 < i2 && centers[i1].x < pivot )
+			{
+				i1 += 1;
+			};
+
+			while ( i1 < i2 && centers[i2 - 1].x >= pivot )
+			{
+				i2 -= 1;
+			};
+
+			if ( i1 < i2 )
+			{
+				// Swap indices
+				{
+					int temp = indices[i1];
+					indices[i1] = indices[i2 - 1];
+					indices[i2 - 1] = temp;
+				}
+
+				// Swap centers
+				{
+					b2Vec2 temp = centers[i1];
+					centers[i1] = centers[i2 - 1];
+					centers[i2 - 1] = temp;
+				}
+
+				i1 += 1;
+				i2 -= 1;
+			}
+		}
+	}
+	else
+	{
+		float pivot = c.y;
+
+		while ( i1 < i2 )
+		{
+			while ( i1 < i2 && centers[i1].y < pivot )
+			{
+				i1 += 1;
+			};
+
+			while ( i1 < i2 && centers[i2 - 1].y >= pivot )
+			{
+				i2 -= 1;
+			};
+
+			if ( i1 < i2 )
+			{
+				// Swap indices
+				{
+					int temp = indices[i1];
+					indices[i1] = indices[i2 - 1];
+					indices[i2 - 1] = temp;
+				}
+
+				// Swap centers
+				{
+					b2Vec2 temp = centers[i1];
+					centers[i1] = centers[i2 - 1];
+					centers[i2 - 1] = temp;
+				}
+
+				i1 += 1;
+				i2 -= 1;
+			}
+		}
+	}
+	B2_ASSERT( i1 == i2 );
+
+	if ( i1 > 0 && i1 < count )
+	{
+		return i1;
+	}
+
+	return count / 2;
+}
+
+#else
+
+#define B2_BIN_COUNT 8
+
+typedef struct b2TreeBin
+{
+	b2AABB aabb;
+	int count;
+} b2TreeBin;
+
+typedef struct b2TreePlane
+{
+	b2AABB leftAABB;
+	b2AABB rightAABB;
+	int leftCount;
+	int rightCount;
+} b2TreePlane;
+
+// "On Fast Construction of SAH-based Bounding Volume Hierarchies" by Ingo Wald
+// Returns the left child count
+static int b2PartitionSAH( int* indices, int* binIndices, b2AABB* boxes, int count )
+{
+	B2_ASSERT( count > 0 );
+
+	b2TreeBin bins[B2_BIN_COUNT];
+	b2TreePlane planes[B2_BIN_COUNT - 1];
+
+	b2Vec2 center = b2AABB_Center( boxes[0] );
+	b2AABB centroidAABB;
+	centroidAABB.lowerBound = center;
+	centroidAABB.upperBound = center;
+
+	for ( int i = 1; i < count; ++i )
+	{
+		center = b2AABB_Center( boxes[i] );
+		centroidAABB.lowerBound = b2Min( centroidAABB.lowerBound, center );
+		centroidAABB.upperBound = b2Max( centroidAABB.upperBound, center );
+	}
+
+	b2Vec2 d = b2Sub( centroidAABB.upperBound, centroidAABB.lowerBound );
+
+	// Find longest axis
+	int axisIndex;
+	float invD;
+	if ( d.x > d.y )
+	{
+		axisIndex = 0;
+		invD = d.x;
+	}
+	else
 	{
 		axisIndex = 1;
 		invD = d.y;
 	}
 
-	invD = invD > 0.0f ? 1.0f / invD : 0.0f;
+	invD = invD > 0.0f ? 1.0f / invD : 0.0f;
+
+	// Initialize bin bounds and count
+	for ( int i = 0; i < B2_BIN_COUNT; ++i )
+	{
+		bins[i].aabb.lowerBound = (b2Vec2){ FLT_MAX, FLT_MAX };
+		bins[i].aabb.upperBound = (b2Vec2){ -FLT_MAX, -FLT_MAX };
+		bins[i].count = 0;
+	}
+
+	// Assign boxes to bins and compute bin boxes
+	// TODO_ERIN optimize
+	float binCount = B2_BIN_COUNT;
+	float lowerBoundArray[2] = { centroidAABB.lowerBound.x, centroidAABB.lowerBound.y };
+	float minC = lowerBoundArray[axisIndex];
+	for ( int i = 0; i < count; ++i )
+	{
+		b2Vec2 c = b2AABB_Center( boxes[i] );
+		float cArray[2] = { c.x, c.y };
+		int binIndex = (int)( binCount * ( cArray[axisIndex] - minC ) * invD );
+		binIndex = b2ClampInt( binIndex, 0, B2_BIN_COUNT - 1 );
+		binIndices[i] = binIndex;
+		bins[binIndex].count += 1;
+		bins[binIndex].aabb = b2AABB_Union( bins[binIndex].aabb, boxes[i] );
+	}
+
+	int planeCount = B2_BIN_COUNT - 1;
+
+	// Prepare all the left planes, candidates for left child
+	planes[0].leftCount = bins[0].count;
+	planes[0].leftAABB = bins[0].aabb;
+	for ( int i = 1; i < planeCount; ++i )
+	{
+		planes[i].leftCount = planes[i - 1].leftCount + bins[i].count;
+		planes[i].leftAABB = b2AABB_Union( planes[i - 1].leftAABB, bins[i].aabb );
+	}
+
+	// Prepare all the right planes, candidates for right child
+	planes[planeCount - 1].rightCount = bins[planeCount].count;
+	planes[planeCount - 1].rightAABB = bins[planeCount].aabb;
+	for ( int i = planeCount - 2; i >= 0; --i )
+	{
+		planes[i].rightCount = planes[i + 1].rightCount + bins[i + 1].count;
+		planes[i].rightAABB = b2AABB_Union( planes[i + 1].rightAABB, bins[i + 1].aabb );
+	}
+
+	// Find best split to minimize SAH
+	float minCost = FLT_MAX;
+	int bestPlane = 0;
+	for ( int i = 0; i < planeCount; ++i )
+	{
+		float leftArea = b2Perimeter( planes[i].leftAABB );
+		float rightArea = b2Perimeter( planes[i].rightAABB );
+		int leftCount = planes[i].leftCount;
+		int rightCount = planes[i].rightCount;
+
+		float cost = leftCount * leftArea + rightCount * rightArea;
+		if ( cost < minCost )
+		{
+			bestPlane = i;
+			minCost = cost;
+		}
+	}
+
+	// Partition node indices and boxes using the Hoare partition scheme
+	// https://en.wikipedia.org/wiki/Quicksort
+	// https://nicholasvadivelu.com/2021/01/11/array-partition/
+	int i1 = 0, i2 = count;
+	while ( i1 < i2 )
+	{
+		while ( i1 < i2 && binIndices[i1] < bestPlane )
+		{
+			i1 += 1;
+		};
+
+		while ( i1 < i2 && binIndices[i2 - 1] >= bestPlane )
+		{
+			i2 -= 1;
+		};
+
+		if ( i1 < i2 )
+		{
+			// Swap indices
+			{
+				int temp = indices[i1];
+				indices[i1] = indices[i2 - 1];
+				indices[i2 - 1] = temp;
+			}
+
+			// Swap boxes
+			{
+				b2AABB temp = boxes[i1];
+				boxes[i1] = boxes[i2 - 1];
+				boxes[i2 - 1] = temp;
+			}
+
+			i1 += 1;
+			i2 -= 1;
+		}
+	}
+	B2_ASSERT( i1 == i2 );
+
+	if ( i1 > 0 && i1 < count )
+	{
+		return i1;
+	}
+	else
+	{
+		return count / 2;
+	}
+}
+
+#endif
+
+// Temporary data used to track the rebuild of a tree node
+struct b2RebuildItem
+{
+	int nodeIndex;
+	int childCount;
+
+	// Leaf indices
+	int startIndex;
+	int splitIndex;
+	int endIndex;
+};
+
+// Returns root node index
+// Build the subtree over the leaf range [startIndex, endIndex). Internal nodes are allocated in
+// pre-order. If nodeSlots is not NULL the nodes are taken from nodeSlots beginning at slotIndex,
+// which is the pre-order position of the subtree root. This lets disjoint subtrees be built
+// concurrently with the same node indices as a serial build.
+static int b2BuildSubtree( b2DynamicTree* tree, const int* nodeSlots, int startIndex, int endIndex, int slotIndex )
+{
+	b2TreeNode* nodes = tree->nodes;
+	int* leafIndices = tree->leafIndices;
+	int leafCount = endIndex - startIndex;
+	B2_ASSERT( leafCount >= 2 );
+
+#if B2_TREE_HEURISTIC == 0
+	b2Vec2* leafCenters = tree->leafCenters;
+#else
+	b2AABB* leafBoxes = tree->leafBoxes;
+	int* binIndices = tree->binIndices;
+#endif
+
+	// todo large stack item
+	struct b2RebuildItem stack[B2_TREE_STACK_SIZE];
+	int top = 0;
+
+	stack[0].nodeIndex = nodeSlots != NULL ? nodeSlots[slotIndex++] : b2AllocateNode( tree );
+	stack[0].childCount = -1;
+	stack[0].startIndex = startIndex;
+	stack[0].endIndex = endIndex;
+#if B2_TREE_HEURISTIC == 0
+	stack[0].splitIndex = b2PartitionMid( leafIndices + startIndex, leafCenters + startIndex, leafCount );
+#else
+	stack[0].splitIndex =
+		b2PartitionSAH( leafIndices + startIndex, binIndices + startIndex, leafBoxes + startIndex, leafCount );
+#endif
+	stack[0].splitIndex += startIndex;
+
+	while ( true )
+	{
+		struct b2RebuildItem* item = stack + top;
+
+		item->childCount += 1;
+
+		if ( item->childCount == 2 )
+		{
+			// This internal node has both children established
+
+			if ( top == 0 )
+			{
+				// all done
+				break;
+			}
+
+			struct b2RebuildItem* parentItem = stack + ( top - 1 );
+			b2TreeNode* parentNode = nodes + parentItem->nodeIndex;
+
+			if ( parentItem->childCount == 0 )
+			{
+				B2_ASSERT( parentNode->children.child1 == B2_NULL_INDEX );
+				parentNode->children.child1 = item->nodeIndex;
+			}
+			else
+			{
+				B2_ASSERT( parentItem->childCount == 1 );
+				B2_ASSERT( parentNode->children.child2 == B2_NULL_INDEX );
+				parentNode->children.child2 = item->nodeIndex;
+			}
+
+			b2TreeNode* node = nodes + item->nodeIndex;
+
+			B2_ASSERT( node->parent == B2_NULL_INDEX );
+			node->parent = parentItem->nodeIndex;
+
+			B2_ASSERT( node->children.child1 != B2_NULL_INDEX );
+			B2_ASSERT( node->children.child2 != B2_NULL_INDEX );
+			b2TreeNode* child1 = nodes + node->children.child1;
+			b2TreeNode* child2 = nodes + node->children.child2;
+
+			node->aabb = b2AABB_Union( child1->aabb, child2->aabb );
+			node->height = 1 + b2MaxUInt16( child1->height, child2->height );
+			node->categoryBits = child1->categoryBits | child2->categoryBits;
+
+			// Pop stack
+			top -= 1;
+		}
+		else
+		{
+			int startIndex, endIndex;
+			if ( item->childCount == 0 )
+			{
+				startIndex = item->startIndex;
+				endIndex = item->splitIndex;
+			}
+			else
+			{
+				B2_ASSERT( item->childCount == 1 );
+				startIndex = item->splitIndex;
+				endIndex = item->endIndex;
+			}
+
+			int count = endIndex - startIndex;
+
+			if ( count == 1 )
+			{
+				int childIndex = leafIndices[startIndex];
+				b2TreeNode* node = nodes + item->nodeIndex;
+
+				if ( item->childCount == 0 )
+				{
+					B2_ASSERT( node->children.child1 == B2_NULL_INDEX );
+					node->children.child1 = childIndex;
+				}
+				else
+				{
+					B2_ASSERT( item->childCount == 1 );
+					B2_ASSERT( node->children.child2 == B2_NULL_INDEX );
+					node->children.child2 = childIndex;
+				}
+
+				b2TreeNode* childNode = nodes + childIndex;
+				B2_ASSERT( childNode->parent == B2_NULL_INDEX );
+				childNode->parent = item->nodeIndex;
+			}
+			else
+			{
+				B2_ASSERT( count > 0 );
+				B2_ASSERT( top < B2_TREE_STACK_SIZE );
+
+				top += 1;
+				struct b2RebuildItem* newItem = stack + top;
+				newItem->nodeIndex = nodeSlots != NULL ? nodeSlots[slotIndex++] : b2AllocateNode( tree );
+				newItem->childCount = -1;
+				newItem->startIndex = startIndex;
+				newItem->endIndex = endIndex;
+#if B2_TREE_HEURISTIC == 0
+				newItem->splitIndex = b2PartitionMid( leafIndices + startIndex, leafCenters + startIndex, count );
+#else
+				newItem->splitIndex =
+					b2PartitionSAH( leafIndices + startIndex, binIndices + startIndex, leafBoxes + startIndex, count );
+#endif
+				newItem->splitIndex += startIndex;
+			}
+		}
+	}
+
+	b2TreeNode* rootNode = nodes + stack[0].nodeIndex;
+	B2_ASSERT( rootNode->parent == B2_NULL_INDEX );
+	B2_ASSERT( rootNode->children.child1 != B2_NULL_INDEX );
+	B2_ASSERT( rootNode->children.child2 != B2_NULL_INDEX );
+
+	b2TreeNode* child1 = nodes + rootNode->children.child1;
+	b2TreeNode* child2 = nodes + rootNode->children.child2;
+
+	rootNode->aabb = b2AABB_Union( child1->aabb, child2->aabb );
+	rootNode->height = 1 + b2MaxUInt16( child1->height, child2->height );
+	rootNode->categoryBits = child1->categoryBits | child2->categoryBits;
+
+	return stack[0].nodeIndex;
+}
+
+static int b2BuildTree( b2DynamicTree* tree, int leafCount )
+{
+	if ( leafCount == 1 )
+	{
+		int* leafIndices = tree->leafIndices;
+		tree->nodes[leafIndices[0]].parent = B2_NULL_INDEX;
+		return leafIndices[0];
+	}
+
+	return b2BuildSubtree( tree, NULL, 0, leafCount, 0 );
+}
+
+// Ensure capacity for rebuild space
+static void b2EnsureRebuildCapacity( b2DynamicTree* tree )
+{
+	int proxyCount = tree->proxyCount;
+	if ( proxyCount > tree->rebuildCapacity )
+	{
+		int newCapacity = proxyCount + proxyCount / 2;
+
+		b2Free( tree->leafIndices, tree->rebuildCapacity * sizeof( int ) );
+		tree->leafIndices = b2AllocTagged( newCapacity * sizeof( int ), b2_allocTagTree, b2_allocLifetimeLong );
+
+#if B2_TREE_HEURISTIC == 0
+		b2Free( tree->leafCenters, tree->rebuildCapacity * sizeof( b2Vec2 ) );
+		tree->leafCenters = b2AllocTagged( newCapacity * sizeof( b2Vec2 ), b2_allocTagTree, b2_allocLifetimeLong );
+#else
+		b2Free( tree->leafBoxes, tree->rebuildCapacity * sizeof( b2AABB ) );
+		tree->leafBoxes = b2AllocTagged( newCapacity * sizeof( b2AABB ), b2_allocTagTree, b2_allocLifetimeLong );
+		b2Free( tree->binIndices, tree->rebuildCapacity * sizeof( int ) );
+		tree->binIndices = b2AllocTagged( newCapacity * sizeof( int ), b2_allocTagTree, b2_allocLifetimeLong );
+#endif
+		tree->rebuildCapacity = newCapacity;
+	}
+}
+
+// Collect the leaves of the rebuild into tree->leafIndices and free the internal nodes that will be
+// rebuilt. Returns the leaf count.
+static int b2GatherRebuildLeaves( b2DynamicTree* tree, bool fullBuild )
+{
+	int proxyCount = tree->proxyCount;
+	if ( proxyCount == 0 )
+	{
+		return 0;
+	}
+
+	b2EnsureRebuildCapacity( tree );
+
+	int leafCount = 0;
+	int stack[B2_TREE_STACK_SIZE];
+	int stackCount = 0;
+
+	int nodeIndex = tree->root;
+	b2TreeNode* nodes = tree->nodes;
+	b2TreeNode* node = nodes + nodeIndex;
+
+	// These are the nodes that get sorted to rebuild the tree.
+	// I'm using indices because the node pool may grow during the build.
+	int* leafIndices = tree->leafIndices;
+
+#if B2_TREE_HEURISTIC == 0
+	b2Vec2* leafCenters = tree->leafCenters;
+#else
+	b2AABB* leafBoxes = tree->leafBoxes;
+#endif
+
+	// Gather all proxy nodes that have grown and all internal nodes that haven't grown. Both are
+	// considered leaves in the tree rebuild.
+	// Free all internal nodes that have grown.
+	// todo use a node growth metric instead of simply enlarged to reduce rebuild size and frequency
+	// this should be weighed against B2_AABB_MARGIN
+	while ( true )
+	{
+		if ( node->height == 0 || ( ( node->flags & b2_enlargedNode ) == 0 && fullBuild == false ) )
+		{
+			leafIndices[leafCount] = nodeIndex;
+#if B2_TREE_HEURISTIC == 0
+			leafCenters[leafCount] = b2AABB_Center( node->aabb );
+#else
+			leafBoxes[leafCount] = node->aabb;
+#endif
+			leafCount += 1;
+
+			// Detach
+			node->parent = B2_NULL_INDEX;
+		}
+		else
+		{
+			int doomedNodeIndex = nodeIndex;
+
+			// Handle children
+			nodeIndex = node->children.child1;
+
+			if ( stackCount < B2_TREE_STACK_SIZE )
+			{
+				stack[stackCount++] = node->children.child2;
+			}
+			else
+			{
+				B2_ASSERT( stackCount < B2_TREE_STACK_SIZE );
+			}
+
+			node = nodes + nodeIndex;
+
+			// Remove doomed node
+			b2FreeNode( tree, doomedNodeIndex );
+
+			continue;
+		}
+
+		if ( stackCount == 0 )
+		{
+			break;
+		}
+
+		nodeIndex = stack[--stackCount];
+		node = nodes + nodeIndex;
+	}
+
+#if B2_ENABLE_VALIDATION == 1
+	int capacity = tree->nodeCapacity;
+	for ( int i = 0; i < capacity; ++i )
+	{
+		if ( nodes[i].flags & b2_allocatedNode )
+		{
+			B2_ASSERT( ( nodes[i].flags & b2_enlargedNode ) == 0 );
+		}
+	}
+#endif
+
+	B2_ASSERT( leafCount <= proxyCount );
+
+	return leafCount;
+}
+
+// Not safe to access tree during this operation because it may grow
+void b2DynamicTree_CreateProxies( b2DynamicTree* tree, const b2AABB* aabbs, const uint64_t* categoryBits,
+								  const uint64_t* userData, int count, int* proxyIds )
+{
+	if ( count <= 0 )
+	{
+		return;
+	}
+
+	int oldProxyCount = tree->proxyCount;
+
+	// The tree build needs the node pool to stay put. This covers the leaves and the internal nodes.
+	b2ReserveNodes( tree, 2 * count );
+
+	for ( int i = 0; i < count; ++i )
+	{
+		b2AABB aabb = aabbs[i];
+		B2_ASSERT( -B2_HUGE < aabb.lowerBound.x && aabb.lowerBound.x < B2_HUGE );
+		B2_ASSERT( -B2_HUGE < aabb.lowerBound.y && aabb.lowerBound.y < B2_HUGE );
+		B2_ASSERT( -B2_HUGE < aabb.upperBound.x && aabb.upperBound.x < B2_HUGE );
+		B2_ASSERT( -B2_HUGE < aabb.upperBound.y && aabb.upperBound.y < B2_HUGE );
+
+		int proxyId = b2AllocateNode( tree );
+		b2TreeNode* node = tree->nodes + proxyId;
+		node->aabb = aabb;
+		node->userData = userData[i];
+		node->categoryBits = categoryBits[i];
+		node->height = 0;
+		node->flags = b2_allocatedNode | b2_leafNode;
+		proxyIds[i] = proxyId;
+	}
+
+	tree->proxyCount += count;
+	b2InvalidateQueryNodes( tree );
+
+	// A large batch would be poorly placed as one subtree, so rebuild everything
+	int leafCount = 0;
+	bool fullBuild = oldProxyCount > 0 && count >= oldProxyCount;
+	if ( fullBuild )
+	{
+		leafCount = b2GatherRebuildLeaves( tree, true );
+	}
+	else
+	{
+		b2EnsureRebuildCapacity( tree );
+	}
+
+	int* leafIndices = tree->leafIndices;
+	for ( int i = 0; i < count; ++i )
+	{
+		leafIndices[leafCount] = proxyIds[i];
+#if B2_TREE_HEURISTIC == 0
+		tree->leafCenters[leafCount] = b2AABB_Center( aabbs[i] );
+#else
+		tree->leafBoxes[leafCount] = aabbs[i];
+#endif
+		leafCount += 1;
+	}
+
+	int subtreeRoot = b2BuildTree( tree, leafCount );
+
+	if ( fullBuild || oldProxyCount == 0 )
+	{
+		tree->root = subtreeRoot;
+	}
+	else
+	{
+		// Insert the new subtree like a single leaf
+		bool shouldRotate = false;
+		b2InsertLeaf( tree, subtreeRoot, shouldRotate );
+	}
+
+	b2DynamicTree_Validate( tree );
+}
+
+// Remove proxies by detaching the largest subtrees that only hold these proxies. A group of proxies
+// inserted together, such as a grafted tile, is usually one subtree and comes out with a single
+// detach instead of one removal per leaf.
+static void b2PruneProxies( b2DynamicTree* tree, const int* proxyIds, int count )
+{
+	b2EnsureRebuildCapacity( tree );
+
+	b2TreeNode* nodes = tree->nodes;
+	int* roots = tree->leafIndices;
+	int rootCount = 0;
+
+	// Mark the proxies and every ancestor whose children are all marked. Each walk up stops at
+	// the first node with an unmarked sibling, which is a candidate subtree root.
+	for ( int i = 0; i < count; ++i )
+	{
+		int nodeId = proxyIds[i];
+		B2_ASSERT( 0 <= nodeId && nodeId < tree->nodeCapacity );
+		B2_ASSERT( b2IsLeaf( nodes + nodeId ) );
+		nodes[nodeId].flags |= b2_prunedNode;
+
+		while ( nodeId != tree->root )
+		{
+			int parent = nodes[nodeId].parent;
+			int sibling = nodes[parent].children.child1 == nodeId ? nodes[parent].children.child2 : nodes[parent].children.child1;
+			if ( ( nodes[sibling].flags & b2_prunedNode ) == 0 )
+			{
+				break;
+			}
+
+			nodes[parent].flags |= b2_prunedNode;
+			nodeId = parent;
+		}
+
+		roots[rootCount] = nodeId;
+		rootCount += 1;
+	}
+
+	for ( int i = 0; i < rootCount; ++i )
+	{
+		// A later walk may have marked the parent, making this root part of a larger subtree
+		int rootId = roots[i];
+		int parent = nodes[rootId].parent;
+		if ( parent != B2_NULL_INDEX && ( nodes[parent].flags & b2_prunedNode ) )
+		{
+			continue;
+		}
+
+		b2RemoveLeaf( tree, rootId );
+
+		int stack[B2_TREE_STACK_SIZE];
+		int stackCount = 0;
+		stack[stackCount++] = rootId;
+
+		while ( stackCount > 0 )
+		{
+			int nodeId = stack[--stackCount];
+			b2TreeNode* node = nodes + nodeId;
+			B2_ASSERT( node->flags & b2_prunedNode );
+
+			if ( b2IsLeaf( node ) == false )
+			{
+				B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
+				stack[stackCount++] = node->children.child1;
+				stack[stackCount++] = node->children.child2;
+			}
+
+			b2FreeNode( tree, nodeId );
+		}
+	}
+
+	B2_ASSERT( tree->proxyCount >= count );
+	tree->proxyCount -= count;
+	b2InvalidateQueryNodes( tree );
+
+	b2DynamicTree_Validate( tree );
+}
+
+void b2DynamicTree_DestroyProxies( b2DynamicTree* tree, const int* proxyIds, int count )
+{
+	if ( count <= 0 )
+	{
+		return;
+	}
+
+	// Removing a few leaves is cheaper than a rebuild
+	if ( 4 * count < tree->proxyCount )
+	{
+		b2PruneProxies( tree, proxyIds, count );
+		return;
+	}
+
+	for ( int i = 0; i < count; ++i )
+	{
+		int proxyId = proxyIds[i];
+		B2_ASSERT( 0 <= proxyId && proxyId < tree->nodeCapacity );
+		B2_ASSERT( b2IsLeaf( tree->nodes + proxyId ) );
+		b2FreeNode( tree, proxyId );
+	}
+
+	B2_ASSERT( tree->proxyCount >= count );
+	tree->proxyCount -= count;
+	b2InvalidateQueryNodes( tree );
 
-	// Initialize bin bounds and count
-	for ( int i = 0; i < B2_BIN_COUNT; ++i )
+	if ( tree->proxyCount == 0 )
 	{
-		bins[i].aabb.lowerBound = (b2Vec2){ FLT_MAX, FLT_MAX };
-		bins[i].aabb.upperBound = (b2Vec2){ -FLT_MAX, -FLT_MAX };
-		bins[i].count = 0;
+		// Only internal nodes remain
+		int capacity = tree->nodeCapacity;
+		for ( int i = 0; i < capacity; ++i )
+		{
+			if ( tree->nodes[i].flags & b2_allocatedNode )
+			{
+				b2FreeNode( tree, i );
+			}
+		}
+
+		tree->root = B2_NULL_INDEX;
+		return;
 	}
 
-	// Assign boxes to bins and compute bin boxes
-	// TODO_ERIN optimize
-	float binCount = B2_BIN_COUNT;
-	float lowerBoundArray[2] = { centroidAABB.lowerBound.x, centroidAABB.lowerBound.y };
-	float minC = lowerBoundArray[axisIndex];
-	for ( int i = 0; i < count; ++i )
+	b2EnsureRebuildCapacity( tree );
+
+	// Free the internal nodes and gather the remaining leaves in node order
+	b2TreeNode* nodes = tree->nodes;
+	int* leafIndices = tree->leafIndices;
+	int leafCount = 0;
+	int capacity = tree->nodeCapacity;
+	for ( int i = 0; i < capacity; ++i )
 	{
-		b2Vec2 c = b2AABB_Center( boxes[i] );
-		float cArray[2] = { c.x, c.y };
-		int binIndex = (int)( binCount * ( cArray[axisIndex] - minC ) * invD );
-		binIndex = b2ClampInt( binIndex, 0, B2_BIN_COUNT - 1 );
-		binIndices[i] = binIndex;
-		bins[binIndex].count += 1;
-		bins[binIndex].aabb = b2AABB_Union( bins[binIndex].aabb, boxes[i] );
+		b2TreeNode* node = nodes + i;
+		if ( ( node->flags & b2_allocatedNode ) == 0 )
+		{
+			continue;
+		}
+
+		if ( node->height > 0 )
+		{
+			b2FreeNode( tree, i );
+			continue;
+		}
+
+		leafIndices[leafCount] = i;
+#if B2_TREE_HEURISTIC == 0
+		tree->leafCenters[leafCount] = b2AABB_Center( node->aabb );
+#else
+		tree->leafBoxes[leafCount] = node->aabb;
+#endif
+		leafCount += 1;
+
+		// Detach
+		node->parent = B2_NULL_INDEX;
 	}
 
-	int planeCount = B2_BIN_COUNT - 1;
+	B2_ASSERT( leafCount == tree->proxyCount );
+	tree->root = b2BuildTree( tree, leafCount );
 
-	// Prepare all the left planes, candidates for left child
-	planes[0].leftCount = bins[0].count;
-	planes[0].leftAABB = bins[0].aabb;
-	for ( int i = 1; i < planeCount; ++i )
+	b2DynamicTree_Validate( tree );
+}
+
+void b2DynamicTree_Graft( b2DynamicTree* tree, const b2DynamicTree* source, const uint64_t* userData, int* proxyIds )
+{
+	if ( source->root == B2_NULL_INDEX )
 	{
-		planes[i].leftCount = planes[i - 1].leftCount + bins[i].count;
-		planes[i].leftAABB = b2AABB_Union( planes[i - 1].leftAABB, bins[i].aabb );
+		return;
 	}
 
-	// Prepare all the right planes, candidates for right child
-	planes[planeCount - 1].rightCount = bins[planeCount].count;
-	planes[planeCount - 1].rightAABB = bins[planeCount].aabb;
-	for ( int i = planeCount - 2; i >= 0; --i )
+	int sourceCount = source->nodeCount;
+	b2ReserveNodes( tree, sourceCount + 1 );
+
+	// Map the source nodes to new nodes. The node pool does not grow below because of the reserve.
+	int* nodeMap = b2AllocTagged( source->nodeCapacity * sizeof( int ), b2_allocTagTree, b2_allocLifetimeTemporary );
+	const b2TreeNode* sourceNodes = source->nodes;
+	for ( int i = 0; i < source->nodeCapacity; ++i )
 	{
-		planes[i].rightCount = planes[i + 1].rightCount + bins[i + 1].count;
-		planes[i].rightAABB = b2AABB_Union( planes[i + 1].rightAABB, bins[i + 1].aabb );
+		nodeMap[i] = b2IsAllocated( sourceNodes + i ) ? b2AllocateNode( tree ) : B2_NULL_INDEX;
 	}
 
-	// Find best split to minimize SAH
-	float minCost = FLT_MAX;
-	int bestPlane = 0;
-	for ( int i = 0; i < planeCount; ++i )
+	b2TreeNode* nodes = tree->nodes;
+	for ( int i = 0; i < source->nodeCapacity; ++i )
 	{
-		float leftArea = b2Perimeter( planes[i].leftAABB );
-		float rightArea = b2Perimeter( planes[i].rightAABB );
-		int leftCount = planes[i].leftCount;
-		int rightCount = planes[i].rightCount;
+		const b2TreeNode* sourceNode = sourceNodes + i;
+		if ( b2IsAllocated( sourceNode ) == false )
+		{
+			continue;
+		}
 
-		float cost = leftCount * leftArea + rightCount * rightArea;
-		if ( cost < minCost )
+		int nodeId = nodeMap[i];
+		b2TreeNode* node = nodes + nodeId;
+		*node = *sourceNode;
+		node->parent = sourceNode->parent == B2_NULL_INDEX ? B2_NULL_INDEX : nodeMap[sourceNode->parent];
+
+		if ( b2IsLeaf( sourceNode ) )
 		{
-			bestPlane = i;
-			minCost = cost;
+			int index = (int)sourceNode->userData;
+			B2_ASSERT( 0 <= index && index < source->proxyCount );
+			node->userData = userData[index];
+			proxyIds[index] = nodeId;
+		}
+		else
+		{
+			node->children.child1 = nodeMap[sourceNode->children.child1];
+			node->children.child2 = nodeMap[sourceNode->children.child2];
 		}
 	}
 
-	// Partition node indices and boxes using the Hoare partition scheme
-	// https://en.wikipedia.org/wiki/Quicksort
-	// https://nicholasvadivelu.com/2021/01/11/array-partition/
-	int i1 = 0, i2 = count;
-	while ( i1 < i2 )
+	int subtreeRoot = nodeMap[source->root];
+	b2Free( nodeMap, source->nodeCapacity * sizeof( int ) );
+
+	tree->proxyCount += source->proxyCount;
+	b2InvalidateQueryNodes( tree );
+
+	// Insert the subtree like a single leaf
+	bool shouldRotate = false;
+	b2InsertLeaf( tree, subtreeRoot, shouldRotate );
+
+	b2DynamicTree_Validate( tree );
+}
+
+int b2DynamicTree_Rebuild( b2DynamicTree* tree, bool fullBuild )
+{
+	b2InvalidateQueryNodes( tree );
+
+	int leafCount = b2GatherRebuildLeaves( tree, fullBuild );
+	if ( leafCount == 0 )
 	{
-		while ( i1 < i2 && binIndices[i1] < bestPlane )
+		return 0;
+	}
+
+	tree->root = b2BuildTree( tree, leafCount );
+
+	b2DynamicTree_Validate( tree );
+
+	if ( fullBuild )
+	{
+		b2DynamicTree_BuildWideNodes( tree );
+	}
+
+	return leafCount;
+}
+
+b2DynamicTree b2CloneTreeNodes( const b2DynamicTree* tree )
+{
+	b2DynamicTree clone;
+	memset( &clone, 0, sizeof( b2DynamicTree ) );
+
+	clone.root = tree->root;
+	clone.nodeCount = tree->nodeCount;
+	clone.nodeCapacity = tree->nodeCapacity;
+	clone.freeList = tree->freeList;
+	clone.proxyCount = tree->proxyCount;
+	clone.nodes = b2AllocTagged( tree->nodeCapacity * sizeof( b2TreeNode ), b2_allocTagTree, b2_allocLifetimeLong );
+	memcpy( clone.nodes, tree->nodes, tree->nodeCapacity * sizeof( b2TreeNode ) );
+	return clone;
+}
+
+static bool b2SameLeaf( const b2DynamicTree* tree, int nodeId, uint64_t userData )
+{
+	if ( nodeId >= tree->nodeCapacity )
+	{
+		return false;
+	}
+
+	const b2TreeNode* node = tree->nodes + nodeId;
+	return b2IsLeaf( node ) && node->userData == userData;
+}
+
+int b2ApplyTreeEdits( b2DynamicTree* tree, const b2DynamicTree* current, b2TreeProxyFcn* fcn, void* context )
+{
+	int editCount = 0;
+
+	// Update or remove the leaves of the tree. Removal frees nodes which the additions below may reuse.
+	for ( int nodeId = 0; nodeId < tree->nodeCapacity; ++nodeId )
+	{
+		b2TreeNode* node = tree->nodes + nodeId;
+		if ( b2IsLeaf( node ) == false )
 		{
-			i1 += 1;
-		};
+			continue;
+		}
 
-		while ( i1 < i2 && binIndices[i2 - 1] >= bestPlane )
+		if ( b2SameLeaf( current, nodeId, node->userData ) == false )
 		{
-			i2 -= 1;
-		};
+			b2DynamicTree_DestroyProxy( tree, nodeId );
+			editCount += 1;
+			continue;
+		}
 
-		if ( i1 < i2 )
+		const b2TreeNode* currentNode = current->nodes + nodeId;
+		if ( currentNode->categoryBits != node->categoryBits )
 		{
-			// Swap indices
-			{
-				int temp = indices[i1];
-				indices[i1] = indices[i2 - 1];
-				indices[i2 - 1] = temp;
-			}
+			node->categoryBits = currentNode->categoryBits;
+			b2InvalidateQueryNodes( tree );
 
-			// Swap boxes
+			int parent = node->parent;
+			while ( parent != B2_NULL_INDEX )
 			{
-				b2AABB temp = boxes[i1];
-				boxes[i1] = boxes[i2 - 1];
-				boxes[i2 - 1] = temp;
+				b2TreeNode* parentNode = tree->nodes + parent;
+				parentNode->categoryBits =
+					tree->nodes[parentNode->children.child1].categoryBits | tree->nodes[parentNode->children.child2].categoryBits;
+				parent = parentNode->parent;
 			}
 
-			i1 += 1;
-			i2 -= 1;
+			editCount += 1;
 		}
-	}
-	B2_ASSERT( i1 == i2 );
 
-	if ( i1 > 0 && i1 < count )
-	{
-		return i1;
+		b2AABB a = node->aabb;
+		b2AABB b = currentNode->aabb;
+		if ( a.lowerBound.x != b.lowerBound.x || a.lowerBound.y != b.lowerBound.y || a.upperBound.x != b.upperBound.x ||
+			 a.upperBound.y != b.upperBound.y )
+		{
+			b2DynamicTree_MoveProxy( tree, nodeId, b );
+			editCount += 1;
+		}
 	}
-	else
+
+	// Add the leaves of current that were not kept. A leaf added here cannot match a later leaf of
+	// current because the user data of each leaf is unique.
+	for ( int nodeId = 0; nodeId < current->nodeCapacity; ++nodeId )
 	{
-		return count / 2;
+		const b2TreeNode* currentNode = current->nodes + nodeId;
+		if ( b2IsLeaf( currentNode ) == false || b2SameLeaf( tree, nodeId, currentNode->userData ) )
+		{
+			continue;
+		}
+
+		int proxyId = b2DynamicTree_CreateProxy( tree, currentNode->aabb, currentNode->categoryBits, currentNode->userData );
+		fcn( currentNode->userData, proxyId, context );
+		editCount += 1;
 	}
-}
 
-#endif
+	return editCount;
+}
 
-// Temporary data used to track the rebuild of a tree node
-struct b2RebuildItem
+// Surface area heuristic cost of a subtree relative to its root: the sum of the internal node
+// perimeters below the root divided by the root perimeter. This is the expected number of internal
+// nodes visited by a query that overlaps the root.
+static float b2ComputeSubtreeCost( const b2TreeNode* nodes, int rootIndex, int* nodeCount )
 {
-	int nodeIndex;
-	int childCount;
+	int stack[B2_TREE_STACK_SIZE];
+	int stackCount = 0;
+	stack[stackCount++] = nodes[rootIndex].children.child1;
+	stack[stackCount++] = nodes[rootIndex].children.child2;
 
-	// Leaf indices
-	int startIndex;
-	int splitIndex;
-	int endIndex;
-};
+	float perimeterSum = 0.0f;
+	int count = 1;
+	while ( stackCount > 0 )
+	{
+		const b2TreeNode* node = nodes + stack[--stackCount];
+		count += 1;
 
-// Returns root node index
-static int b2BuildTree( b2DynamicTree* tree, int leafCount )
-{
-	b2TreeNode* nodes = tree->nodes;
-	int* leafIndices = tree->leafIndices;
+		if ( node->height == 0 )
+		{
+			continue;
+		}
 
-	if ( leafCount == 1 )
-	{
-		nodes[leafIndices[0]].parent = B2_NULL_INDEX;
-		return leafIndices[0];
+		perimeterSum += b2Perimeter( node->aabb );
+
+		if ( stackCount < B2_TREE_STACK_SIZE - 1 )
+		{
+			stack[stackCount++] = node->children.child1;
+			stack[stackCount++] = node->children.child2;
+		}
+		else
+		{
+			B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
+		}
 	}
 
+	*nodeCount = count;
+
+	float rootPerimeter = b2Perimeter( nodes[rootIndex].aabb );
+	return rootPerimeter > 0.0f ? perimeterSum / rootPerimeter : 0.0f;
+}
+
+// Fully rebuild a subtree in place. The subtree bounds and category bits don't change, so only the
+// heights of the ancestors need updating. Returns the leaf count.
+static int b2RebuildSubtree( b2DynamicTree* tree, int rootIndex )
+{
+	b2EnsureRebuildCapacity( tree );
+
+	b2TreeNode* nodes = tree->nodes;
+	int parentIndex = nodes[rootIndex].parent;
+	b2AABB rootBox = nodes[rootIndex].aabb;
+	B2_UNUSED( rootBox );
+
+	int* leafIndices = tree->leafIndices;
 #if B2_TREE_HEURISTIC == 0
 	b2Vec2* leafCenters = tree->leafCenters;
 #else
 	b2AABB* leafBoxes = tree->leafBoxes;
-	int* binIndices = tree->binIndices;
 #endif
 
-	// todo large stack item
-	struct b2RebuildItem stack[B2_TREE_STACK_SIZE];
-	int top = 0;
+	int leafCount = 0;
+	int stack[B2_TREE_STACK_SIZE];
+	int stackCount = 0;
+	stack[stackCount++] = rootIndex;
 
-	stack[0].nodeIndex = b2AllocateNode( tree );
-	stack[0].childCount = -1;
-	stack[0].startIndex = 0;
-	stack[0].endIndex = leafCount;
+	while ( stackCount > 0 )
+	{
+		int nodeIndex = stack[--stackCount];
+		b2TreeNode* node = nodes + nodeIndex;
+
+		if ( node->height == 0 )
+		{
+			leafIndices[leafCount] = nodeIndex;
 #if B2_TREE_HEURISTIC == 0
-	stack[0].splitIndex = b2PartitionMid( leafIndices, leafCenters, leafCount );
+			leafCenters[leafCount] = b2AABB_Center( node->aabb );
 #else
-	stack[0].splitIndex = b2PartitionSAH( leafIndices, binIndices, leafBoxes, leafCount );
+			leafBoxes[leafCount] = node->aabb;
 #endif
+			leafCount += 1;
 
-	while ( true )
+			// Detach
+			node->parent = B2_NULL_INDEX;
+			continue;
+		}
+
+		if ( stackCount < B2_TREE_STACK_SIZE - 1 )
+		{
+			stack[stackCount++] = node->children.child2;
+			stack[stackCount++] = node->children.child1;
+		}
+		else
+		{
+			B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
+		}
+
+		b2FreeNode( tree, nodeIndex );
+	}
+
+	B2_ASSERT( leafCount >= 2 );
+	int newRootIndex = b2BuildTree( tree, leafCount );
+
+	// The node pool does not grow because as many nodes were freed as the build allocates
+	nodes = tree->nodes;
+	b2TreeNode* newRoot = nodes + newRootIndex;
+	B2_ASSERT( newRoot->aabb.lowerBound.x == rootBox.lowerBound.x && newRoot->aabb.upperBound.y == rootBox.upperBound.y );
+	newRoot->parent = parentIndex;
+
+	if ( parentIndex == B2_NULL_INDEX )
 	{
-		struct b2RebuildItem* item = stack + top;
+		tree->root = newRootIndex;
+		return leafCount;
+	}
 
-		item->childCount += 1;
+	b2TreeNode* parent = nodes + parentIndex;
+	if ( parent->children.child1 == rootIndex )
+	{
+		parent->children.child1 = newRootIndex;
+	}
+	else
+	{
+		B2_ASSERT( parent->children.child2 == rootIndex );
+		parent->children.child2 = newRootIndex;
+	}
 
-		if ( item->childCount == 2 )
+	while ( parentIndex != B2_NULL_INDEX )
+	{
+		b2TreeNode* node = nodes + parentIndex;
+		uint16_t height = 1 + b2MaxUInt16( nodes[node->children.child1].height, nodes[node->children.child2].height );
+		if ( height == node->height )
 		{
-			// This internal node has both children established
-
-			if ( top == 0 )
-			{
-				// all done
-				break;
-			}
+			break;
+		}
 
-			struct b2RebuildItem* parentItem = stack + ( top - 1 );
-			b2TreeNode* parentNode = nodes + parentItem->nodeIndex;
+		node->height = height;
+		parentIndex = node->parent;
+	}
 
-			if ( parentItem->childCount == 0 )
-			{
-				B2_ASSERT( parentNode->children.child1 == B2_NULL_INDEX );
-				parentNode->children.child1 = item->nodeIndex;
-			}
-			else
-			{
-				B2_ASSERT( parentItem->childCount == 1 );
-				B2_ASSERT( parentNode->children.child2 == B2_NULL_INDEX );
-				parentNode->children.child2 = item->nodeIndex;
-			}
+	return leafCount;
+}
 
-			b2TreeNode* node = nodes + item->nodeIndex;
+int b2DynamicTree_Optimize( b2DynamicTree* tree, int leafBudget )
+{
+	if ( tree->root == B2_NULL_INDEX || leafBudget < 2 )
+	{
+		return 0;
+	}
 
-			B2_ASSERT( node->parent == B2_NULL_INDEX );
-			node->parent = parentItem->nodeIndex;
+	b2TreeNode* nodes = tree->nodes;
+	if ( nodes[tree->root].height == 0 )
+	{
+		return 0;
+	}
 
-			B2_ASSERT( node->children.child1 != B2_NULL_INDEX );
-			B2_ASSERT( node->children.child2 != B2_NULL_INDEX );
-			b2TreeNode* child1 = nodes + node->children.child1;
-			b2TreeNode* child2 = nodes + node->children.child2;
+	// The candidates are the largest subtrees with at most 2^maxHeight <= leafBudget leaves
+	int maxHeight = 1;
+	while ( ( 2 << maxHeight ) <= leafBudget )
+	{
+		maxHeight += 1;
+	}
 
-			node->aabb = b2AABB_Union( child1->aabb, child2->aabb );
-			node->height = 1 + b2MaxUInt16( child1->height, child2->height );
-			node->categoryBits = child1->categoryBits | child2->categoryBits;
+	// Evaluate candidates in tree order, resuming where the previous call stopped, until the visited
+	// node count reaches the budget. The worst candidate is rebuilt.
+	int visitBudget = 4 * leafBudget;
+	int visitCount = 0;
+	int cursor = tree->optimizeCursor;
+	int nextCursor = cursor;
+	int candidateIndex = 0;
+	int bestIndex = B2_NULL_INDEX;
+	float bestCost = 0.0f;
 
-			// Pop stack
-			top -= 1;
+	int stack[B2_TREE_STACK_SIZE];
+	for ( int pass = 0; pass < 2 && visitCount < visitBudget; ++pass )
+	{
+		// The second pass wraps around to the candidates before the cursor
+		if ( pass == 1 && cursor == 0 )
+		{
+			break;
 		}
-		else
+
+		candidateIndex = 0;
+		int stackCount = 0;
+		stack[stackCount++] = tree->root;
+
+		while ( stackCount > 0 && visitCount < visitBudget )
 		{
-			int startIndex, endIndex;
-			if ( item->childCount == 0 )
+			int nodeIndex = stack[--stackCount];
+			const b2TreeNode* node = nodes + nodeIndex;
+			if ( node->height == 0 )
 			{
-				startIndex = item->startIndex;
-				endIndex = item->splitIndex;
-			}
-			else
-			{
-				B2_ASSERT( item->childCount == 1 );
-				startIndex = item->splitIndex;
-				endIndex = item->endIndex;
+				continue;
 			}
 
-			int count = endIndex - startIndex;
-
-			if ( count == 1 )
+			if ( node->height > maxHeight )
 			{
-				int childIndex = leafIndices[startIndex];
-				b2TreeNode* node = nodes + item->nodeIndex;
-
-				if ( item->childCount == 0 )
+				if ( stackCount < B2_TREE_STACK_SIZE - 1 )
 				{
-					B2_ASSERT( node->children.child1 == B2_NULL_INDEX );
-					node->children.child1 = childIndex;
+					stack[stackCount++] = node->children.child2;
+					stack[stackCount++] = node->children.child1;
 				}
 				else
 				{
-					B2_ASSERT( item->childCount == 1 );
-					B2_ASSERT( node->children.child2 == B2_NULL_INDEX );
-					node->children.child2 = childIndex;
+					B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
 				}
+				continue;
+			}
 
-				b2TreeNode* childNode = nodes + childIndex;
-				B2_ASSERT( childNode->parent == B2_NULL_INDEX );
-				childNode->parent = item->nodeIndex;
+			if ( pass == 1 && candidateIndex == cursor )
+			{
+				break;
 			}
-			else
+
+			if ( pass == 1 || candidateIndex >= cursor )
 			{
-				B2_ASSERT( count > 0 );
-				B2_ASSERT( top < B2_TREE_STACK_SIZE );
+				int nodeCount;
+				float cost = b2ComputeSubtreeCost( nodes, nodeIndex, &nodeCount );
+				visitCount += nodeCount;
+				nextCursor = candidateIndex + 1;
 
-				top += 1;
-				struct b2RebuildItem* newItem = stack + top;
-				newItem->nodeIndex = b2AllocateNode( tree );
-				newItem->childCount = -1;
-				newItem->startIndex = startIndex;
-				newItem->endIndex = endIndex;
-#if B2_TREE_HEURISTIC == 0
-				newItem->splitIndex = b2PartitionMid( leafIndices + startIndex, leafCenters + startIndex, count );
-#else
-				newItem->splitIndex =
-					b2PartitionSAH( leafIndices + startIndex, binIndices + startIndex, leafBoxes + startIndex, count );
-#endif
-				newItem->splitIndex += startIndex;
+				if ( cost > bestCost )
+				{
+					bestCost = cost;
+					bestIndex = nodeIndex;
+				}
 			}
+
+			candidateIndex += 1;
+		}
+
+		// Wrap the cursor if the first pass reached the last candidate
+		if ( pass == 0 && stackCount == 0 && nextCursor >= candidateIndex )
+		{
+			nextCursor = 0;
 		}
 	}
 
-	b2TreeNode* rootNode = nodes + stack[0].nodeIndex;
-	B2_ASSERT( rootNode->parent == B2_NULL_INDEX );
-	B2_ASSERT( rootNode->children.child1 != B2_NULL_INDEX );
-	B2_ASSERT( rootNode->children.child2 != B2_NULL_INDEX );
+	tree->optimizeCursor = nextCursor;
 
-	b2TreeNode* child1 = nodes + rootNode->children.child1;
-	b2TreeNode* child2 = nodes + rootNode->children.child2;
+	if ( bestIndex == B2_NULL_INDEX )
+	{
+		return 0;
+	}
 
-	rootNode->aabb = b2AABB_Union( child1->aabb, child2->aabb );
-	rootNode->height = 1 + b2MaxUInt16( child1->height, child2->height );
-	rootNode->categoryBits = child1->categoryBits | child2->categoryBits;
+	b2TracyCZoneNC( optimize_tree, "Optimize Tree", b2_colorFireBrick, true );
 
-	return stack[0].nodeIndex;
+	b2InvalidateQueryNodes( tree );
+	int leafCount = b2RebuildSubtree( tree, bestIndex );
+
+	b2DynamicTree_Validate( tree );
+
+	b2TracyCZoneEnd( optimize_tree );
+
+	return leafCount;
 }
 
-// Not safe to access tree during this operation because it may grow
-int b2DynamicTree_Rebuild( b2DynamicTree* tree, bool fullBuild )
+// A subtree below the top levels of a parallel build
+typedef struct b2SubtreeJob
 {
-	int proxyCount = tree->proxyCount;
-	if ( proxyCount == 0 )
+	int startIndex;
+	int endIndex;
+	int slotIndex;
+	int parentIndex;
+	int childIndex;
+	int nodeIndex;
+} b2SubtreeJob;
+
+typedef struct b2ParallelBuildContext
+{
+	b2DynamicTree* tree;
+	const int* nodeSlots;
+	b2SubtreeJob* jobs;
+} b2ParallelBuildContext;
+
+static void b2BuildSubtreesTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	b2TracyCZoneNC( subtree_task, "Build Subtrees", b2_colorFireBrick, true );
+
+	B2_UNUSED( workerIndex );
+	b2ParallelBuildContext* buildContext = context;
+	for ( int i = startIndex; i < endIndex; ++i )
 	{
-		return 0;
+		b2SubtreeJob* job = buildContext->jobs + i;
+		job->nodeIndex = b2BuildSubtree( buildContext->tree, buildContext->nodeSlots, job->startIndex, job->endIndex,
+										 job->slotIndex );
 	}
 
-	// Ensure capacity for rebuild space
-	if ( proxyCount > tree->rebuildCapacity )
+	b2TracyCZoneEnd( subtree_task );
+}
+
+static void b2LinkChild( b2TreeNode* nodes, int parentIndex, int childIndex, int nodeIndex )
+{
+	if ( childIndex == 0 )
 	{
-		int newCapacity = proxyCount + proxyCount / 2;
+		nodes[parentIndex].children.child1 = nodeIndex;
+	}
+	else
+	{
+		nodes[parentIndex].children.child2 = nodeIndex;
+	}
 
-		b2Free( tree->leafIndices, tree->rebuildCapacity * sizeof( int ) );
-		tree->leafIndices = b2Alloc( newCapacity * sizeof( int ) );
+	nodes[nodeIndex].parent = parentIndex;
+}
 
-#if B2_TREE_HEURISTIC == 0
-		b2Free( tree->leafCenters, tree->rebuildCapacity * sizeof( b2Vec2 ) );
-		tree->leafCenters = b2Alloc( newCapacity * sizeof( b2Vec2 ) );
-#else
-		b2Free( tree->leafBoxes, tree->rebuildCapacity * sizeof( b2AABB ) );
-		tree->leafBoxes = b2Alloc( newCapacity * sizeof( b2AABB ) );
-		b2Free( tree->binIndices, tree->rebuildCapacity * sizeof( int ) );
-		tree->binIndices = b2Alloc( newCapacity * sizeof( int ) );
-#endif
-		tree->rebuildCapacity = newCapacity;
+// Partition the top levels serially until each range is small enough, then build the remaining
+// subtrees in parallel. All internal nodes are allocated up front in the order the serial build
+// allocates them and every node takes the slot of its pre-order position, so the tree and the node
+// pool match b2BuildTree exactly regardless of the worker count.
+static int b2BuildTreeParallel( b2World* world, b2DynamicTree* tree, int leafCount, int workerCount )
+{
+	// Below this a subtree is built by one task
+	int minSubtreeLeafCount = 1024;
+	int subtreeLeafCount = b2MaxInt( leafCount / ( 4 * workerCount ), minSubtreeLeafCount );
+	if ( workerCount == 1 || leafCount <= subtreeLeafCount )
+	{
+		return b2BuildTree( tree, leafCount );
 	}
 
-	int leafCount = 0;
-	int stack[B2_TREE_STACK_SIZE];
-	int stackCount = 0;
+	int internalCount = leafCount - 1;
+	int* nodeSlots = b2AllocTagged( internalCount * sizeof( int ), b2_allocTagTree, b2_allocLifetimeTemporary );
+	for ( int i = 0; i < internalCount; ++i )
+	{
+		nodeSlots[i] = b2AllocateNode( tree );
+	}
 
-	int nodeIndex = tree->root;
+	// The node pool no longer grows
 	b2TreeNode* nodes = tree->nodes;
-	b2TreeNode* node = nodes + nodeIndex;
-
-	// These are the nodes that get sorted to rebuild the tree.
-	// I'm using indices because the node pool may grow during the build.
 	int* leafIndices = tree->leafIndices;
-
 #if B2_TREE_HEURISTIC == 0
 	b2Vec2* leafCenters = tree->leafCenters;
 #else
 	b2AABB* leafBoxes = tree->leafBoxes;
+	int* binIndices = tree->binIndices;
 #endif
 
-	// Gather all proxy nodes that have grown and all internal nodes that haven't grown. Both are
-	// considered leaves in the tree rebuild.
-	// Free all internal nodes that have grown.
-	// todo use a node growth metric instead of simply enlarged to reduce rebuild size and frequency
-	// this should be weighed against B2_AABB_MARGIN
-	while ( true )
+	// Each job and top node consumes at least one internal node
+	b2SubtreeJob* jobs = b2AllocTagged( internalCount * sizeof( b2SubtreeJob ), b2_allocTagTree, b2_allocLifetimeTemporary );
+	int* topNodes = b2AllocTagged( internalCount * sizeof( int ), b2_allocTagTree, b2_allocLifetimeTemporary );
+	int jobCount = 0;
+	int topCount = 0;
+
+	b2SubtreeJob stack[B2_TREE_STACK_SIZE];
+	int stackCount = 0;
+	stack[stackCount++] = (b2SubtreeJob){ 0, leafCount, 0, B2_NULL_INDEX, 0, B2_NULL_INDEX };
+
+	while ( stackCount > 0 )
 	{
-		if ( node->height == 0 || ( ( node->flags & b2_enlargedNode ) == 0 && fullBuild == false ) )
+		b2SubtreeJob item = stack[--stackCount];
+		int count = item.endIndex - item.startIndex;
+
+		if ( count == 1 )
 		{
-			leafIndices[leafCount] = nodeIndex;
+			b2LinkChild( nodes, item.parentIndex, item.childIndex, leafIndices[item.startIndex] );
+			continue;
+		}
+
+		if ( count <= subtreeLeafCount )
+		{
+			jobs[jobCount++] = item;
+			continue;
+		}
+
+		int nodeIndex = nodeSlots[item.slotIndex];
+		topNodes[topCount++] = nodeIndex;
+		if ( item.parentIndex != B2_NULL_INDEX )
+		{
+			b2LinkChild( nodes, item.parentIndex, item.childIndex, nodeIndex );
+		}
+
+		int startIndex = item.startIndex;
 #if B2_TREE_HEURISTIC == 0
-			leafCenters[leafCount] = b2AABB_Center( node->aabb );
+		int splitIndex = startIndex + b2PartitionMid( leafIndices + startIndex, leafCenters + startIndex, count );
 #else
-			leafBoxes[leafCount] = node->aabb;
+		int splitIndex = startIndex + b2PartitionSAH( leafIndices + startIndex, binIndices + startIndex,
+													  leafBoxes + startIndex, count );
 #endif
-			leafCount += 1;
 
-			// Detach
-			node->parent = B2_NULL_INDEX;
+		if ( stackCount < B2_TREE_STACK_SIZE - 1 )
+		{
+			// The internal nodes of child1 precede child2 in pre-order
+			int slotIndex2 = item.slotIndex + ( splitIndex - startIndex );
+			stack[stackCount++] = (b2SubtreeJob){ splitIndex, item.endIndex, slotIndex2, nodeIndex, 1, B2_NULL_INDEX };
+			stack[stackCount++] = (b2SubtreeJob){ startIndex, splitIndex, item.slotIndex + 1, nodeIndex, 0, B2_NULL_INDEX };
 		}
 		else
 		{
-			int doomedNodeIndex = nodeIndex;
+			B2_ASSERT( stackCount < B2_TREE_STACK_SIZE - 1 );
+		}
+	}
 
-			// Handle children
-			nodeIndex = node->children.child1;
+	b2ParallelBuildContext context = { tree, nodeSlots, jobs };
+	b2ParallelFor( world, b2BuildSubtreesTask, jobCount, 1, &context );
 
-			if ( stackCount < B2_TREE_STACK_SIZE )
-			{
-				stack[stackCount++] = node->children.child2;
-			}
-			else
-			{
-				B2_ASSERT( stackCount < B2_TREE_STACK_SIZE );
-			}
+	for ( int i = 0; i < jobCount; ++i )
+	{
+		b2LinkChild( nodes, jobs[i].parentIndex, jobs[i].childIndex, jobs[i].nodeIndex );
+	}
 
-			node = nodes + nodeIndex;
+	// Top nodes are in pre-order so children are finished before their parents in reverse
+	for ( int i = topCount - 1; i >= 0; --i )
+	{
+		b2TreeNode* node = nodes + topNodes[i];
+		b2TreeNode* child1 = nodes + node->children.child1;
+		b2TreeNode* child2 = nodes + node->children.child2;
+		node->aabb = b2AABB_Union( child1->aabb, child2->aabb );
+		node->height = 1 + b2MaxUInt16( child1->height, child2->height );
+		node->categoryBits = child1->categoryBits | child2->categoryBits;
+	}
 
-			// Remove doomed node
-			b2FreeNode( tree, doomedNodeIndex );
+	int root = nodeSlots[0];
+	B2_ASSERT( topCount > 0 && topNodes[0] == root );
+	B2_ASSERT( nodes[root].parent == B2_NULL_INDEX );
 
-			continue;
-		}
+	b2Free( topNodes, internalCount * sizeof( int ) );
+	b2Free( jobs, internalCount * sizeof( b2SubtreeJob ) );
+	b2Free( nodeSlots, internalCount * sizeof( int ) );
 
-		if ( stackCount == 0 )
-		{
-			break;
-		}
+	return root;
+}
 
-		nodeIndex = stack[--stackCount];
-		node = nodes + nodeIndex;
-	}
+int b2RebuildTreeParallel( b2World* world, b2DynamicTree* tree, bool fullBuild )
+{
+	b2TracyCZoneNC( rebuild_tree, "Rebuild Tree", b2_colorFireBrick, true );
 
-#if B2_ENABLE_VALIDATION == 1
-	int capacity = tree->nodeCapacity;
-	for ( int i = 0; i < capacity; ++i )
+	b2InvalidateQueryNodes( tree );
+
+	int leafCount = b2GatherRebuildLeaves( tree, fullBuild );
+	if ( leafCount == 0 )
 	{
-		if ( nodes[i].flags & b2_allocatedNode )
-		{
-			B2_ASSERT( ( nodes[i].flags & b2_enlargedNode ) == 0 );
-		}
+		b2TracyCZoneEnd( rebuild_tree );
+		return 0;
 	}
-#endif
-
-	B2_ASSERT( leafCount <= proxyCount );
 
-	tree->root = b2BuildTree( tree, leafCount );
+	tree->root = b2BuildTreeParallel( world, tree, leafCount, world->workerCount );
 
 	b2DynamicTree_Validate( tree );
 
+	if ( fullBuild )
+	{
+		b2DynamicTree_BuildWideNodes( tree );
+	}
+
+	b2TracyCZoneEnd( rebuild_tree );
 	return leafCount;
 }
+
+void b2WriteTreeSnapshot( b2SnapshotWriter* writer, const b2DynamicTree* tree )
+{
+	b2WriteValue( writer, tree->root );
+	b2WriteValue( writer, tree->nodeCount );
+	b2WriteValue( writer, tree->nodeCapacity );
+	b2WriteValue( writer, tree->freeList );
+	b2WriteValue( writer, tree->proxyCount );
+	b2WriteValue( writer, tree->optimizeCursor );
+
+	// The free list runs through the whole pool so all nodes are written
+	b2WriteBytes( writer, tree->nodes, tree->nodeCapacity * (int)sizeof( b2TreeNode ) );
+
+	// Queries traverse the wide and quantized nodes when they are valid, which determines the pair order
+	b2WriteValue( writer, tree->wideNodeCount );
+	b2WriteBytes( writer, tree->wideNodes, tree->wideNodeCount * (int)sizeof( b2WideNode ) );
+
+	b2WriteValue( writer, tree->quantizedRootBox );
+	b2WriteValue( writer, tree->quantizedNodeCount );
+	b2WriteBytes( writer, tree->quantizedNodes, tree->quantizedNodeCount * (int)sizeof( b2QuantizedNode ) );
+}
+
+void b2ReadTreeSnapshot( b2SnapshotReader* reader, b2DynamicTree* tree )
+{
+	int nodeCapacity;
+	b2ReadValue( reader, tree->root );
+	b2ReadValue( reader, tree->nodeCount );
+	b2ReadValue( reader, nodeCapacity );
+	b2ReadValue( reader, tree->freeList );
+	b2ReadValue( reader, tree->proxyCount );
+	b2ReadValue( reader, tree->optimizeCursor );
+
+	if ( nodeCapacity != tree->nodeCapacity )
+	{
+		b2Free( tree->nodes, tree->nodeCapacity * sizeof( b2TreeNode ) );
+		tree->nodes = b2AllocTagged( nodeCapacity * sizeof( b2TreeNode ), b2_allocTagTree, b2_allocLifetimeLong );
+		tree->nodeCapacity = nodeCapacity;
+	}
+
+	b2ReadBytes( reader, tree->nodes, nodeCapacity * (int)sizeof( b2TreeNode ) );
+
+	int wideNodeCount;
+	b2ReadValue( reader, wideNodeCount );
+	if ( wideNodeCount > tree->wideNodeCapacity )
+	{
+		b2Free( tree->wideNodes, tree->wideNodeCapacity * sizeof( b2WideNode ) );
+		tree->wideNodes = b2AllocTagged( wideNodeCount * sizeof( b2WideNode ), b2_allocTagTree, b2_allocLifetimeLong );
+		tree->wideNodeCapacity = wideNodeCount;
+	}
+
+	tree->wideNodeCount = wideNodeCount;
+	b2ReadBytes( reader, tree->wideNodes, wideNodeCount * (int)sizeof( b2WideNode ) );
+
+	int quantizedNodeCount;
+	b2ReadValue( reader, tree->quantizedRootBox );
+	b2ReadValue( reader, quantizedNodeCount );
+	if ( quantizedNodeCount != tree->quantizedNodeCount )
+	{
+		b2Free( tree->quantizedNodes, tree->quantizedNodeCapacity * sizeof( b2QuantizedNode ) );
+		// Null for a zero count
+		tree->quantizedNodes =
+			b2AllocTagged( quantizedNodeCount * sizeof( b2QuantizedNode ), b2_allocTagTree, b2_allocLifetimeLong );
+		tree->quantizedNodeCount = quantizedNodeCount;
+		tree->quantizedNodeCapacity = quantizedNodeCount;
+	}
+
+	b2ReadBytes( reader, tree->quantizedNodes, quantizedNodeCount * (int)sizeof( b2QuantizedNode ) );
+}
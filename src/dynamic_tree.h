@@ -0,0 +1,54 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "box2d/collision.h"
+
+typedef struct b2World b2World;
+
+// The number of rays cast together by b2DynamicTree_RayCastPacket
+#define B2_RAY_PACKET_SIZE 4
+
+// Ray packet callback. Same as b2TreeRayCastCallbackFcn with the index of the ray in the packet.
+typedef float b2TreeRayPacketCallbackFcn( const b2RayCastInput* input, int rayIndex, int proxyId, uint64_t userData,
+										  void* context );
+
+// Same as b2DynamicTree_Rebuild, with the subtrees below the top levels built in parallel using the
+// world task system. The result is identical to the serial rebuild. Must not be called while the
+// world is stepping.
+int b2RebuildTreeParallel( b2World* world, b2DynamicTree* tree, bool fullBuild );
+
+// Same as calling b2DynamicTree_EnlargeProxy for each proxy in order. Large batches are split into
+// the subtrees at a fixed depth, which are refit in parallel before their shared ancestors.
+void b2EnlargeProxiesParallel( b2World* world, b2DynamicTree* tree, const int* proxyIds, const b2AABB* aabbs, int count );
+
+// Cast up to B2_RAY_PACKET_SIZE rays against the tree in one traversal. Each node is tested against all
+// rays with SIMD and the leaves are reported for each ray that may hit them. Each ray has its own
+// max fraction, which is clipped as for b2DynamicTree_RayCast. This always uses the binary nodes.
+b2TreeStats b2DynamicTree_RayCastPacket( const b2DynamicTree* tree, const b2RayCastInput* inputs, int rayCount,
+										 uint64_t maskBits, b2TreeRayPacketCallbackFcn* callback, void* context );
+
+// Size of a tree node in bytes, see b2GetObjectSizes
+int b2GetTreeNodeSize( void );
+
+// Copy the nodes of a tree without the query nodes or the rebuild space. Proxy ids are preserved.
+b2DynamicTree b2CloneTreeNodes( const b2DynamicTree* tree );
+
+// Reports a leaf added by b2ApplyTreeEdits along with its new proxy id
+typedef void b2TreeProxyFcn( uint64_t userData, int proxyId, void* context );
+
+// Bring a tree cloned from current at some earlier time up to date with current. A leaf is kept if
+// current has a leaf with the same id and user data, which is then moved and refiltered as needed. The
+// other leaves are removed. The leaves of current not kept are added with new proxy ids. The user data
+// of the leaves must be unique. Returns the number of edits.
+int b2ApplyTreeEdits( b2DynamicTree* tree, const b2DynamicTree* current, b2TreeProxyFcn* fcn, void* context );
+
+typedef struct b2SnapshotWriter b2SnapshotWriter;
+typedef struct b2SnapshotReader b2SnapshotReader;
+
+// Write the tree nodes and the query nodes for b2World_Snapshot. The rebuild scratch space is not written.
+void b2WriteTreeSnapshot( b2SnapshotWriter* writer, const b2DynamicTree* tree );
+
+// Restore a tree written by b2WriteTreeSnapshot, reusing the node storage when it is large enough
+void b2ReadTreeSnapshot( b2SnapshotReader* reader, b2DynamicTree* tree );
@@ -3,6 +3,10 @@
 
 #include "id_pool.h"
 
+#include "box2d/math_functions.h"
+
+#include <stdlib.h>
+
 b2IdPool b2CreateIdPool( void )
 {
 	b2IdPool pool = { 0 };
@@ -30,6 +34,26 @@ int b2AllocId( b2IdPool* pool )
 	return id;
 }
 
+void b2AllocIds( b2IdPool* pool, int* ids, int count )
+{
+	int freeCount = b2MinInt( pool->freeArray.count, count );
+	const int* freeIds = pool->freeArray.data + pool->freeArray.count;
+	for ( int i = 0; i < freeCount; ++i )
+	{
+		ids[i] = freeIds[-1 - i];
+	}
+
+	pool->freeArray.count -= freeCount;
+
+	int nextIndex = pool->nextIndex;
+	for ( int i = freeCount; i < count; ++i )
+	{
+		ids[i] = nextIndex++;
+	}
+
+	pool->nextIndex = nextIndex;
+}
+
 void b2FreeId( b2IdPool* pool, int id )
 {
 	B2_ASSERT( pool->nextIndex > 0 );
@@ -37,6 +61,42 @@ void b2FreeId( b2IdPool* pool, int id )
 	b2Array_Push( pool->freeArray, id );
 }
 
+static int b2CompareIdsDescending( const void* a, const void* b )
+{
+	int idA = *(const int*)a;
+	int idB = *(const int*)b;
+	return ( idA < idB ) - ( idA > idB );
+}
+
+int b2TrimIdPool( b2IdPool* pool )
+{
+	int freeCount = pool->freeArray.count;
+	if ( freeCount == 0 )
+	{
+		return pool->nextIndex;
+	}
+
+	// Sorting in descending order makes the lowest ids pop first. This keeps live ids packed
+	// at the front of the range and exposes the free ids at the end.
+	qsort( pool->freeArray.data, freeCount, sizeof( int ), b2CompareIdsDescending );
+
+	int index = 0;
+	while ( index < freeCount && pool->freeArray.data[index] == pool->nextIndex - 1 )
+	{
+		pool->nextIndex -= 1;
+		index += 1;
+	}
+
+	if ( index > 0 )
+	{
+		memmove( pool->freeArray.data, pool->freeArray.data + index, ( freeCount - index ) * sizeof( int ) );
+		pool->freeArray.count = freeCount - index;
+	}
+
+	b2Array_ShrinkToFit( pool->freeArray, 32 );
+	return pool->nextIndex;
+}
+
 #if B2_ENABLE_VALIDATION
 
 void b2ValidateFreeId( b2IdPool* pool, int id )
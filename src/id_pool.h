@@ -15,7 +15,14 @@ b2IdPool b2CreateIdPool( void );
 void b2DestroyIdPool( b2IdPool* pool );
 
 int b2AllocId( b2IdPool* pool );
+
+// Same ids in the same order as count calls to b2AllocId
+void b2AllocIds( b2IdPool* pool, int* ids, int count );
 void b2FreeId( b2IdPool* pool, int id );
+
+// Release free ids at the end of the range and sort the free list so the lowest ids are
+// reused first. Returns the new id capacity.
+int b2TrimIdPool( b2IdPool* pool );
 void b2ValidateFreeId( b2IdPool* pool, int id );
 void b2ValidateUsedId( b2IdPool* pool, int id );
 
@@ -11,6 +11,7 @@
 #include "solver_set.h"
 
 #include <stddef.h>
+#include <string.h>
 
 b2Island* b2CreateIsland( b2World* world, int setIndex )
 {
@@ -37,20 +38,21 @@ b2Island* b2CreateIsland( b2World* world, int setIndex )
 	b2Array_Create( island->bodies );
 	b2Array_Create( island->contacts );
 	b2Array_Create( island->joints );
+	b2Array_Create( island->removedLinks );
+	island->untrackedRemovals = false;
 	island->constraintRemoveCount = 0;
 
 	b2IslandSim* islandSim = b2Array_Emplace( set->islandSims );
 	islandSim->islandId = islandId;
 
+	b2MarkDirty( world, b2_dirtyIsland, islandId );
+
 	return island;
 }
 
 void b2DestroyIsland( b2World* world, int islandId )
 {
-	if ( world->splitIslandId == islandId )
-	{
-		world->splitIslandId = B2_NULL_INDEX;
-	}
+	b2RemoveSplitIsland( world, islandId );
 
 	// assume island is empty
 	b2Island* island = b2Array_Get( world->islands, islandId );
@@ -69,6 +71,8 @@ void b2DestroyIsland( b2World* world, int islandId )
 	b2Array_Destroy( island->bodies );
 	b2Array_Destroy( island->contacts );
 	b2Array_Destroy( island->joints );
+	b2Array_Destroy( island->removedLinks );
+	island->untrackedRemovals = false;
 	island->constraintRemoveCount = 0;
 	island->localIndex = B2_NULL_INDEX;
 	island->islandId = B2_NULL_INDEX;
@@ -77,6 +81,7 @@ void b2DestroyIsland( b2World* world, int islandId )
 	B2_VALIDATE( island->localIndex == B2_NULL_INDEX );
 
 	b2FreeId( &world->islandIdPool, islandId );
+	b2MarkDirty( world, b2_dirtyIsland, islandId );
 }
 
 static int b2MergeIslands( b2World* world, int islandIdA, int islandIdB )
@@ -118,6 +123,7 @@ static int b2MergeIslands( b2World* world, int islandIdA, int islandIdB )
 	}
 
 	int bigIslandId = bigIsland->islandId;
+	b2MarkDirty( world, b2_dirtyIsland, bigIslandId );
 	b2Array_Reserve( bigIsland->bodies, bigIsland->bodies.count + smallIsland->bodies.count );
 
 	// Move bodies from smaller island to larger island
@@ -163,6 +169,11 @@ static int b2MergeIslands( b2World* world, int islandIdA, int islandIdB )
 
 	// Track removed constraints
 	bigIsland->constraintRemoveCount += smallIsland->constraintRemoveCount;
+	bigIsland->untrackedRemovals = bigIsland->untrackedRemovals || smallIsland->untrackedRemovals;
+	for ( int i = 0; i < smallIsland->removedLinks.count; ++i )
+	{
+		b2Array_Push( bigIsland->removedLinks, smallIsland->removedLinks.data[i] );
+	}
 
 	b2DestroyIsland( world, smallIsland->islandId );
 
@@ -180,6 +191,8 @@ static void b2AddContactToIsland( b2World* world, int islandId, b2Contact* conta
 
 	contact->islandId = islandId;
 	contact->islandIndex = island->contacts.count;
+	b2MarkDirty( world, b2_dirtyIsland, islandId );
+	b2MarkDirty( world, b2_dirtyContact, contact->contactId );
 
 	b2ContactLink link;
 	link.contactId = contact->contactId;
@@ -204,6 +217,10 @@ void b2LinkContact( b2World* world, b2Contact* contact )
 	B2_ASSERT( bodyA->setIndex != b2_disabledSet && bodyB->setIndex != b2_disabledSet );
 	B2_ASSERT( bodyA->setIndex != b2_staticSet || bodyB->setIndex != b2_staticSet );
 
+	// Touching kinematic bodies are solved with the awake bodies
+	b2AttachKinematicBody( world, bodyA );
+	b2AttachKinematicBody( world, bodyB );
+
 	// Wake bodyB if bodyA is awake and bodyB is sleeping
 	if ( bodyA->setIndex == b2_awakeSet && bodyB->setIndex >= b2_firstSleepingSet )
 	{
@@ -231,6 +248,176 @@ void b2LinkContact( b2World* world, b2Contact* contact )
 	b2AddContactToIsland( world, finalIslandId, contact );
 }
 
+static int b2FindIslandRoot( int* parents, int islandId )
+{
+	while ( parents[islandId] != islandId )
+	{
+		// path halving
+		parents[islandId] = parents[parents[islandId]];
+		islandId = parents[islandId];
+	}
+
+	return islandId;
+}
+
+static void b2TouchIsland( int* parents, int* touchedIds, int* touchedCount, int islandId )
+{
+	if ( islandId != B2_NULL_INDEX && parents[islandId] == B2_NULL_INDEX )
+	{
+		parents[islandId] = islandId;
+		touchedIds[*touchedCount] = islandId;
+		*touchedCount += 1;
+	}
+}
+
+// The islands joined by the contacts are grouped with union-find first. Then every island of a group
+// is merged once into the largest island of the group, instead of moving bodies along a chain of
+// pairwise merges.
+void b2LinkContacts( b2World* world, const int* contactIds, int count )
+{
+	// Wake first so the island ids below are final
+	for ( int i = 0; i < count; ++i )
+	{
+		b2Contact* contact = b2Array_Get( world->contacts, contactIds[i] );
+		B2_ASSERT( ( contact->flags & b2_contactTouchingFlag ) != 0 );
+
+		b2Body* bodyA = b2Array_Get( world->bodies, contact->edges[0].bodyId );
+		b2Body* bodyB = b2Array_Get( world->bodies, contact->edges[1].bodyId );
+
+		B2_ASSERT( bodyA->setIndex != b2_disabledSet && bodyB->setIndex != b2_disabledSet );
+		B2_ASSERT( bodyA->setIndex != b2_staticSet || bodyB->setIndex != b2_staticSet );
+
+		b2AttachKinematicBody( world, bodyA );
+		b2AttachKinematicBody( world, bodyB );
+
+		if ( bodyA->setIndex == b2_awakeSet && bodyB->setIndex >= b2_firstSleepingSet )
+		{
+			b2WakeSolverSet( world, bodyB->setIndex );
+		}
+
+		if ( bodyB->setIndex == b2_awakeSet && bodyA->setIndex >= b2_firstSleepingSet )
+		{
+			b2WakeSolverSet( world, bodyA->setIndex );
+		}
+	}
+
+	int islandCapacity = world->islands.count;
+	int* parents = b2StackAlloc( &world->stack, islandCapacity * sizeof( int ), "island parents" );
+	int* survivors = b2StackAlloc( &world->stack, islandCapacity * sizeof( int ), "island survivors" );
+	int* touchedIds = b2StackAlloc( &world->stack, 2 * count * sizeof( int ), "touched islands" );
+	int touchedCount = 0;
+
+	// Untouched islands have a null parent
+	memset( parents, 0xFF, islandCapacity * sizeof( int ) );
+
+	for ( int i = 0; i < count; ++i )
+	{
+		b2Contact* contact = world->contacts.data + contactIds[i];
+		int islandIdA = world->bodies.data[contact->edges[0].bodyId].islandId;
+		int islandIdB = world->bodies.data[contact->edges[1].bodyId].islandId;
+		B2_ASSERT( islandIdA != B2_NULL_INDEX || islandIdB != B2_NULL_INDEX );
+
+		b2TouchIsland( parents, touchedIds, &touchedCount, islandIdA );
+		b2TouchIsland( parents, touchedIds, &touchedCount, islandIdB );
+
+		if ( islandIdA == B2_NULL_INDEX || islandIdB == B2_NULL_INDEX )
+		{
+			continue;
+		}
+
+		int rootA = b2FindIslandRoot( parents, islandIdA );
+		int rootB = b2FindIslandRoot( parents, islandIdB );
+		if ( rootA != rootB )
+		{
+			// The lower id is the root so the grouping doesn't depend on the contact order
+			int minRoot = b2MinInt( rootA, rootB );
+			int maxRoot = b2MaxInt( rootA, rootB );
+			parents[maxRoot] = minRoot;
+		}
+	}
+
+	// The largest island of each group survives, ties go to the lower id
+	for ( int i = 0; i < touchedCount; ++i )
+	{
+		int islandId = touchedIds[i];
+		if ( parents[islandId] == islandId )
+		{
+			survivors[islandId] = islandId;
+		}
+	}
+
+	for ( int i = 0; i < touchedCount; ++i )
+	{
+		int islandId = touchedIds[i];
+		int root = b2FindIslandRoot( parents, islandId );
+		int survivorId = survivors[root];
+		int bodyCount = world->islands.data[islandId].bodies.count;
+		int survivorBodyCount = world->islands.data[survivorId].bodies.count;
+		if ( bodyCount > survivorBodyCount || ( bodyCount == survivorBodyCount && islandId < survivorId ) )
+		{
+			survivors[root] = islandId;
+		}
+	}
+
+	for ( int i = 0; i < touchedCount; ++i )
+	{
+		int islandId = touchedIds[i];
+		int survivorId = survivors[b2FindIslandRoot( parents, islandId )];
+		if ( islandId == survivorId )
+		{
+			continue;
+		}
+
+		// Grow geometrically because the survivor absorbs many islands
+		b2Island* survivor = world->islands.data + survivorId;
+		b2Island* island = world->islands.data + islandId;
+		b2Array_ReserveGrow( survivor->bodies, survivor->bodies.count + island->bodies.count );
+		b2Array_ReserveGrow( survivor->contacts, survivor->contacts.count + island->contacts.count );
+		b2Array_ReserveGrow( survivor->joints, survivor->joints.count + island->joints.count );
+
+		int finalIslandId = b2MergeIslands( world, survivorId, islandId );
+		B2_ASSERT( finalIslandId == survivorId );
+		B2_UNUSED( finalIslandId );
+	}
+
+	b2StackFree( &world->stack, touchedIds );
+	b2StackFree( &world->stack, survivors );
+	b2StackFree( &world->stack, parents );
+
+	for ( int i = 0; i < count; ++i )
+	{
+		b2Contact* contact = world->contacts.data + contactIds[i];
+		int islandId = world->bodies.data[contact->edges[0].bodyId].islandId;
+		if ( islandId == B2_NULL_INDEX )
+		{
+			islandId = world->bodies.data[contact->edges[1].bodyId].islandId;
+		}
+
+		b2AddContactToIsland( world, islandId, contact );
+	}
+}
+
+// Remember the bodies of a removed constraint for an incremental split
+static void b2RecordRemovedLink( b2World* world, b2Island* island, int bodyIdA, int bodyIdB )
+{
+	if ( world->enableIncrementalIslands == false || island->removedLinks.count >= island->bodies.count )
+	{
+		// Past this many removals, union-find over the whole island is cheaper
+		island->untrackedRemovals = true;
+		return;
+	}
+
+	// Constraints to static bodies don't affect island connectivity
+	b2Body* bodyA = b2Array_Get( world->bodies, bodyIdA );
+	b2Body* bodyB = b2Array_Get( world->bodies, bodyIdB );
+	if ( bodyA->islandId == B2_NULL_INDEX || bodyB->islandId == B2_NULL_INDEX )
+	{
+		return;
+	}
+
+	b2Array_Push( island->removedLinks, ( (b2RemovedLink){ bodyIdA, bodyIdB } ) );
+}
+
 // This is called when a contact no longer has contact points or when a contact is destroyed.
 void b2UnlinkContact( b2World* world, b2Contact* contact )
 {
@@ -242,6 +429,8 @@ void b2UnlinkContact( b2World* world, b2Contact* contact )
 
 	int removeIndex = contact->islandIndex;
 	B2_ASSERT( 0 <= removeIndex && removeIndex < island->contacts.count );
+	b2MarkDirty( world, b2_dirtyIsland, islandId );
+	b2MarkDirty( world, b2_dirtyContact, contact->contactId );
 	B2_ASSERT( island->contacts.data[removeIndex].contactId == contact->contactId );
 
 	int movedIndex = b2Array_RemoveSwap( island->contacts, removeIndex );
@@ -252,11 +441,13 @@ void b2UnlinkContact( b2World* world, b2Contact* contact )
 		b2Contact* movedContact = b2Array_Get( world->contacts, movedLink->contactId );
 		B2_ASSERT( movedContact->islandIndex == movedIndex );
 		movedContact->islandIndex = removeIndex;
+		b2MarkDirty( world, b2_dirtyContact, movedLink->contactId );
 	}
 
 	contact->islandId = B2_NULL_INDEX;
 	contact->islandIndex = B2_NULL_INDEX;
 	island->constraintRemoveCount += 1;
+	b2RecordRemovedLink( world, island, contact->edges[0].bodyId, contact->edges[1].bodyId );
 
 	b2ValidateIsland( world, islandId );
 }
@@ -270,6 +461,8 @@ static void b2AddJointToIsland( b2World* world, int islandId, b2Joint* joint )
 
 	joint->islandId = islandId;
 	joint->islandIndex = island->joints.count;
+	b2MarkDirty( world, b2_dirtyIsland, islandId );
+	b2MarkDirty( world, b2_dirtyJoint, joint->jointId );
 
 	b2JointLink link;
 	link.jointId = joint->jointId;
@@ -321,6 +514,8 @@ void b2UnlinkJoint( b2World* world, b2Joint* joint )
 
 	int removeIndex = joint->islandIndex;
 	B2_ASSERT( 0 <= removeIndex && removeIndex < island->joints.count );
+	b2MarkDirty( world, b2_dirtyIsland, islandId );
+	b2MarkDirty( world, b2_dirtyJoint, joint->jointId );
 	B2_ASSERT( island->joints.data[removeIndex].jointId == joint->jointId );
 
 	int movedIndex = b2Array_RemoveSwap( island->joints, removeIndex );
@@ -331,11 +526,13 @@ void b2UnlinkJoint( b2World* world, b2Joint* joint )
 		b2Joint* movedJoint = b2Array_Get( world->joints, movedLink->jointId );
 		B2_ASSERT( movedJoint->islandIndex == movedIndex );
 		movedJoint->islandIndex = removeIndex;
+		b2MarkDirty( world, b2_dirtyJoint, movedLink->jointId );
 	}
 
 	joint->islandId = B2_NULL_INDEX;
 	joint->islandIndex = B2_NULL_INDEX;
 	island->constraintRemoveCount += 1;
+	b2RecordRemovedLink( world, island, joint->edges[0].bodyId, joint->edges[1].bodyId );
 
 	b2ValidateIsland( world, islandId );
 }
@@ -384,9 +581,81 @@ static inline void b2IslandUnion( int* parents, int* ranks, int node1, int node2
 	}
 }
 
-// This uses union-find.
-// https://en.wikipedia.org/wiki/Disjoint-set_data_structure
-void b2SplitIsland( b2World* world, int baseId )
+static bool b2IsBetterSplitCandidate( int islandId, float sleepTime, const b2SplitCandidate* candidate )
+{
+	if ( sleepTime != candidate->sleepTime )
+	{
+		return sleepTime > candidate->sleepTime;
+	}
+
+	return islandId > candidate->islandId;
+}
+
+void b2AddSplitCandidate( b2SplitCandidate* candidates, int* count, int capacity, int islandId, float sleepTime )
+{
+	int candidateCount = *count;
+
+	// An island is listed once with the largest sleep time of its bodies
+	for ( int i = 0; i < candidateCount; ++i )
+	{
+		if ( candidates[i].islandId != islandId )
+		{
+			continue;
+		}
+
+		if ( sleepTime <= candidates[i].sleepTime )
+		{
+			return;
+		}
+
+		// Remove and insert again below at the improved rank
+		for ( int j = i + 1; j < candidateCount; ++j )
+		{
+			candidates[j - 1] = candidates[j];
+		}
+		candidateCount -= 1;
+		break;
+	}
+
+	int index = candidateCount;
+	while ( index > 0 && b2IsBetterSplitCandidate( islandId, sleepTime, candidates + index - 1 ) )
+	{
+		index -= 1;
+	}
+
+	if ( index >= capacity )
+	{
+		B2_ASSERT( candidateCount == *count );
+		return;
+	}
+
+	candidateCount = b2MinInt( candidateCount + 1, capacity );
+	for ( int j = candidateCount - 1; j > index; --j )
+	{
+		candidates[j] = candidates[j - 1];
+	}
+
+	candidates[index] = ( b2SplitCandidate ){ islandId, sleepTime };
+	*count = candidateCount;
+}
+
+void b2RemoveSplitIsland( b2World* world, int islandId )
+{
+	for ( int i = 0; i < world->splitIslandCount; ++i )
+	{
+		if ( world->splitIslandIds[i] == islandId )
+		{
+			for ( int j = i + 1; j < world->splitIslandCount; ++j )
+			{
+				world->splitIslandIds[j - 1] = world->splitIslandIds[j];
+			}
+			world->splitIslandCount -= 1;
+			return;
+		}
+	}
+}
+
+static void b2AllocateIslandSplit( b2World* world, b2IslandSplit* split, int baseId )
 {
 	b2Island* baseIsland = b2Array_Get( world->islands, baseId );
 	B2_ASSERT( baseIsland->constraintRemoveCount > 0 );
@@ -394,28 +663,70 @@ void b2SplitIsland( b2World* world, int baseId )
 
 	b2ValidateIsland( world, baseId );
 
-	// Cache base island fields before b2CreateIsland, which may reallocate
-	// world->islands and invalidate the baseIsland pointer.
 	int baseBodyCount = baseIsland->bodies.count;
-	int* baseBodyIds = baseIsland->bodies.data;
-	int baseBodyCapacity = baseIsland->bodies.capacity;
+	b2Stack* alloc = &world->stack;
+
+	split->world = world;
+	split->baseId = baseId;
+	split->bodyCount = baseBodyCount;
+	split->componentCount = 0;
+	split->parents = b2StackAlloc( alloc, baseBodyCount * sizeof( int ), "parents" );
+	split->contactCounts = b2StackAlloc( alloc, baseBodyCount * sizeof( int ), "contact counts" );
+	split->jointCounts = b2StackAlloc( alloc, baseBodyCount * sizeof( int ), "joint counts" );
+	split->ranks = b2StackAlloc( alloc, baseBodyCount * sizeof( int ), "ranks" );
+
+	split->incremental = world->enableIncrementalIslands && baseIsland->untrackedRemovals == false;
+	split->linkCount = split->incremental ? baseIsland->removedLinks.count : 0;
+	split->components = NULL;
+	if ( split->linkCount > 0 )
+	{
+		int linkCount = split->linkCount;
+		split->components = b2StackAlloc( alloc, linkCount * sizeof( b2PeeledComponent ), "peeled components" );
+	}
+
+	// Each removed link uses three stamps: one for each side of the search and one for a peeled component
+	split->stampBase = world->islandStamp;
+	world->islandStamp += 3 * (uint64_t)split->linkCount;
+
+	split->milliseconds = 0.0f;
+	split->finishInTask = false;
+}
+
+static void b2FreeIslandSplit( b2World* world, b2IslandSplit* split )
+{
+	// Free arena items in LIFO order
+	b2Stack* alloc = &world->stack;
+	if ( split->components != NULL )
+	{
+		b2StackFree( alloc, split->components );
+	}
+	b2StackFree( alloc, split->ranks );
+	b2StackFree( alloc, split->jointCounts );
+	b2StackFree( alloc, split->contactCounts );
+	b2StackFree( alloc, split->parents );
+}
+
+// This uses union-find.
+// https://en.wikipedia.org/wiki/Disjoint-set_data_structure
+// Only reads the world, so this may run in parallel with other splits.
+static void b2UnionIslandComponents( b2IslandSplit* split )
+{
+	b2World* world = split->world;
+	b2Island* baseIsland = b2Array_Get( world->islands, split->baseId );
+
+	int baseBodyCount = split->bodyCount;
+	B2_ASSERT( baseBodyCount == baseIsland->bodies.count );
 
 	int baseContactCount = baseIsland->contacts.count;
 	b2ContactLink* baseContacts = baseIsland->contacts.data;
-	int baseContactCapacity = baseIsland->contacts.capacity;
 
 	int baseJointCount = baseIsland->joints.count;
 	b2JointLink* baseJoints = baseIsland->joints.data;
-	int baseJointCapacity = baseIsland->joints.capacity;
 
-	b2Stack* alloc = &world->stack;
-
-	// No lock is needed because I ensure the allocator is not used while this task is active.
-	// Allocate contactCounts and jointCounts before ranks so ranks can be freed first (LIFO arena).
-	int* parents = b2StackAlloc( alloc, baseBodyCount * sizeof( int ), "parents" );
-	int* contactCounts = b2StackAlloc( alloc, baseBodyCount * sizeof( int ), "contact counts" );
-	int* jointCounts = b2StackAlloc( alloc, baseBodyCount * sizeof( int ), "joint counts" );
-	int* ranks = b2StackAlloc( alloc, baseBodyCount * sizeof( int ), "ranks" );
+	int* parents = split->parents;
+	int* contactCounts = split->contactCounts;
+	int* jointCounts = split->jointCounts;
+	int* ranks = split->ranks;
 	for ( int i = 0; i < baseBodyCount; ++i )
 	{
 		parents[i] = i;
@@ -484,10 +795,6 @@ void b2SplitIsland( b2World* world, int baseId )
 		}
 	}
 
-	// Done with ranks
-	b2StackFree( alloc, ranks );
-	ranks = NULL;
-
 	// Flatten all parent indices and count connected components.
 	int componentCount = 0;
 	for ( int i = 0; i < baseBodyCount; ++i )
@@ -499,16 +806,388 @@ void b2SplitIsland( b2World* world, int baseId )
 		}
 	}
 
+	split->componentCount = componentCount;
+}
+
+// Follow a removed link endpoint out of the components peeled so far. Returns B2_NULL_INDEX if the
+// body is no longer in the island.
+static int b2ResolveRemovedLinkBody( const b2IslandSplit* split, int bodyId )
+{
+	b2Body* bodies = split->world->bodies.data;
+	for ( ;; )
+	{
+		b2Body* body = bodies + bodyId;
+		if ( body->islandId != split->baseId )
+		{
+			return B2_NULL_INDEX;
+		}
+
+		uint64_t stamp = body->islandStamp;
+		if ( stamp < split->stampBase || ( stamp - split->stampBase ) % 3 != 2 )
+		{
+			return bodyId;
+		}
+
+		int linkIndex = (int)( ( stamp - split->stampBase ) / 3 );
+		bodyId = split->components[linkIndex].remainingBodyId;
+	}
+}
+
+// Visit the island neighbors of a body. Returns true if a body of the other side is reached.
+static bool b2ExpandIslandSearch( b2World* world, int baseId, int bodyId, uint64_t stamp, uint64_t otherStamp, int* queue,
+								  int* queueCount )
+{
+	b2Body* bodies = world->bodies.data;
+	b2Body* body = bodies + bodyId;
+
+	int contactKey = body->headContactKey;
+	while ( contactKey != B2_NULL_INDEX )
+	{
+		int contactId = contactKey >> 1;
+		int edgeIndex = contactKey & 1;
+		b2Contact* contact = world->contacts.data + contactId;
+		contactKey = contact->edges[edgeIndex].nextKey;
+
+		// Only contacts in the island connect bodies
+		if ( contact->islandId != baseId )
+		{
+			continue;
+		}
+
+		b2Body* other = bodies + contact->edges[edgeIndex ^ 1].bodyId;
+		if ( other->islandId != baseId || other->islandStamp == stamp )
+		{
+			continue;
+		}
+
+		if ( other->islandStamp == otherStamp )
+		{
+			return true;
+		}
+
+		other->islandStamp = stamp;
+		queue[( *queueCount )++] = contact->edges[edgeIndex ^ 1].bodyId;
+	}
+
+	int jointKey = body->headJointKey;
+	while ( jointKey != B2_NULL_INDEX )
+	{
+		int jointId = jointKey >> 1;
+		int edgeIndex = jointKey & 1;
+		b2Joint* joint = world->joints.data + jointId;
+		jointKey = joint->edges[edgeIndex].nextKey;
+
+		if ( joint->islandId != baseId )
+		{
+			continue;
+		}
+
+		b2Body* other = bodies + joint->edges[edgeIndex ^ 1].bodyId;
+		if ( other->islandId != baseId || other->islandStamp == stamp )
+		{
+			continue;
+		}
+
+		if ( other->islandStamp == otherStamp )
+		{
+			return true;
+		}
+
+		other->islandStamp = stamp;
+		queue[( *queueCount )++] = joint->edges[edgeIndex ^ 1].bodyId;
+	}
+
+	return false;
+}
+
+// Search the island graph around each removed link. Two searches grow from the bodies of the link,
+// always growing the side that has visited fewer bodies. If the sides meet the island is still connected
+// there. Otherwise the side that runs out first is a component that breaks off and is peeled.
+// The island is connected using its constraints plus the removed links. A removed link into a peeled
+// component is redirected to a body on the other side of the search that peeled it, which keeps
+// this true for what remains, so once all links are processed the remaining bodies are connected.
+// Only writes the stamps of the island bodies, so this may run in parallel with other splits.
+// Returns false if a removed link refers to a body that left the island.
+static bool b2SearchRemovedLinks( b2IslandSplit* split )
+{
+	b2World* world = split->world;
+	int baseId = split->baseId;
+	b2Island* baseIsland = b2Array_Get( world->islands, baseId );
+	b2Body* bodies = world->bodies.data;
+
+	// The union-find arrays are not needed, they hold the two search queues and the peeled bodies
+	int* queueA = split->parents;
+	int* queueB = split->ranks;
+	int* peeledBodies = split->contactCounts;
+	int peeledCount = 0;
+	int componentCount = 0;
+
+	for ( int linkIndex = 0; linkIndex < split->linkCount; ++linkIndex )
+	{
+		b2RemovedLink link = baseIsland->removedLinks.data[linkIndex];
+		b2PeeledComponent* component = split->components + linkIndex;
+		component->remainingBodyId = B2_NULL_INDEX;
+		component->bodyStart = peeledCount;
+		component->bodyCount = 0;
+
+		int bodyIdA = b2ResolveRemovedLinkBody( split, link.bodyIdA );
+		int bodyIdB = b2ResolveRemovedLinkBody( split, link.bodyIdB );
+		if ( bodyIdA == B2_NULL_INDEX || bodyIdB == B2_NULL_INDEX )
+		{
+			return false;
+		}
+
+		if ( bodyIdA == bodyIdB )
+		{
+			continue;
+		}
+
+		uint64_t stampA = split->stampBase + 3 * (uint64_t)linkIndex;
+		uint64_t stampB = stampA + 1;
+		uint64_t peelStamp = stampA + 2;
+
+		queueA[0] = bodyIdA;
+		queueB[0] = bodyIdB;
+		bodies[bodyIdA].islandStamp = stampA;
+		bodies[bodyIdB].islandStamp = stampB;
+		int countA = 1, countB = 1;
+		int headA = 0, headB = 0;
+
+		int* peeled = NULL;
+		int peelCount = 0;
+		int remainingBodyId = B2_NULL_INDEX;
+		for ( ;; )
+		{
+			if ( countA <= countB )
+			{
+				if ( headA == countA )
+				{
+					peeled = queueA;
+					peelCount = countA;
+					remainingBodyId = bodyIdB;
+					break;
+				}
+
+				if ( b2ExpandIslandSearch( world, baseId, queueA[headA], stampA, stampB, queueA, &countA ) )
+				{
+					break;
+				}
+				headA += 1;
+			}
+			else
+			{
+				if ( headB == countB )
+				{
+					peeled = queueB;
+					peelCount = countB;
+					remainingBodyId = bodyIdA;
+					break;
+				}
+
+				if ( b2ExpandIslandSearch( world, baseId, queueB[headB], stampB, stampA, queueB, &countB ) )
+				{
+					break;
+				}
+				headB += 1;
+			}
+		}
+
+		if ( peeled == NULL )
+		{
+			// Still connected
+			continue;
+		}
+
+		for ( int i = 0; i < peelCount; ++i )
+		{
+			int bodyId = peeled[i];
+			bodies[bodyId].islandStamp = peelStamp;
+			peeledBodies[peeledCount + i] = bodyId;
+		}
+
+		component->remainingBodyId = remainingBodyId;
+		component->bodyCount = peelCount;
+		peeledCount += peelCount;
+		componentCount += 1;
+	}
+
+	B2_ASSERT( peeledCount < split->bodyCount || split->linkCount == 0 );
+	split->componentCount = componentCount + 1;
+	return true;
+}
+
+static void b2FindIslandComponents( b2IslandSplit* split )
+{
+	if ( split->incremental )
+	{
+		if ( b2SearchRemovedLinks( split ) )
+		{
+			return;
+		}
+
+		// Should not happen because removing a body from an island marks the removals as untracked
+		B2_ASSERT( false );
+		split->incremental = false;
+	}
+
+	b2UnionIslandComponents( split );
+}
+
+// Move a peeled component from the base island to a new island. Only touches the bodies of the
+// component and their constraints.
+static void b2CreatePeeledIsland( b2IslandSplit* split, const b2PeeledComponent* component )
+{
+	b2World* world = split->world;
+	int baseId = split->baseId;
+
+	// WARNING: this invalidates island pointers
+	b2Island* newIsland = b2CreateIsland( world, b2_awakeSet );
+	int newIslandId = newIsland->islandId;
+	b2Island* baseIsland = b2Array_Get( world->islands, baseId );
+
+	b2Array_Reserve( newIsland->bodies, component->bodyCount );
+
+	const int* bodyIds = split->contactCounts + component->bodyStart;
+	for ( int i = 0; i < component->bodyCount; ++i )
+	{
+		int bodyId = bodyIds[i];
+		b2Body* body = b2Array_Get( world->bodies, bodyId );
+		B2_ASSERT( body->islandId == baseId );
+
+		int movedIndex = b2Array_RemoveSwap( baseIsland->bodies, body->islandIndex );
+		if ( movedIndex != B2_NULL_INDEX )
+		{
+			int movedBodyId = baseIsland->bodies.data[body->islandIndex];
+			world->bodies.data[movedBodyId].islandIndex = body->islandIndex;
+		}
+
+		body->islandId = newIslandId;
+		body->islandIndex = newIsland->bodies.count;
+		b2Array_Push( newIsland->bodies, bodyId );
+	}
+
+	// Move the constraints. Constraints between two bodies of the component are seen twice, the second
+	// time they are already in the new island.
+	for ( int i = 0; i < component->bodyCount; ++i )
+	{
+		b2Body* body = b2Array_Get( world->bodies, bodyIds[i] );
+
+		int contactKey = body->headContactKey;
+		while ( contactKey != B2_NULL_INDEX )
+		{
+			int contactId = contactKey >> 1;
+			int edgeIndex = contactKey & 1;
+			b2Contact* contact = b2Array_Get( world->contacts, contactId );
+			contactKey = contact->edges[edgeIndex].nextKey;
+
+			if ( contact->islandId != baseId )
+			{
+				continue;
+			}
+
+			int removeIndex = contact->islandIndex;
+			b2ContactLink link = baseIsland->contacts.data[removeIndex];
+			int movedIndex = b2Array_RemoveSwap( baseIsland->contacts, removeIndex );
+			if ( movedIndex != B2_NULL_INDEX )
+			{
+				b2ContactLink* movedLink = baseIsland->contacts.data + removeIndex;
+				b2Contact* movedContact = b2Array_Get( world->contacts, movedLink->contactId );
+				movedContact->islandIndex = removeIndex;
+			}
+
+			contact->islandId = newIslandId;
+			contact->islandIndex = newIsland->contacts.count;
+			b2Array_Push( newIsland->contacts, link );
+		}
+
+		int jointKey = body->headJointKey;
+		while ( jointKey != B2_NULL_INDEX )
+		{
+			int jointId = jointKey >> 1;
+			int edgeIndex = jointKey & 1;
+			b2Joint* joint = b2Array_Get( world->joints, jointId );
+			jointKey = joint->edges[edgeIndex].nextKey;
+
+			if ( joint->islandId != baseId )
+			{
+				continue;
+			}
+
+			int removeIndex = joint->islandIndex;
+			b2JointLink link = baseIsland->joints.data[removeIndex];
+			int movedIndex = b2Array_RemoveSwap( baseIsland->joints, removeIndex );
+			if ( movedIndex != B2_NULL_INDEX )
+			{
+				b2JointLink* movedLink = baseIsland->joints.data + removeIndex;
+				b2Joint* movedJoint = b2Array_Get( world->joints, movedLink->jointId );
+				movedJoint->islandIndex = removeIndex;
+			}
+
+			joint->islandId = newIslandId;
+			joint->islandIndex = newIsland->joints.count;
+			b2Array_Push( newIsland->joints, link );
+		}
+	}
+
+	b2ValidateIsland( world, newIslandId );
+}
+
+// Reset the removal tracking of an island that is known to be connected
+static void b2ClearIslandRemovals( b2Island* island )
+{
+	island->constraintRemoveCount = 0;
+	island->removedLinks.count = 0;
+	island->untrackedRemovals = false;
+}
+
+// Create an island for each component found by b2FindIslandComponents and destroy the base island.
+// This modifies the world island array, the awake solver set, and the island indices on bodies,
+// contacts, and joints.
+static void b2CreateSplitIslands( b2IslandSplit* split )
+{
+	b2World* world = split->world;
+	int baseId = split->baseId;
+	b2Island* baseIsland = b2Array_Get( world->islands, baseId );
+
+	if ( split->incremental )
+	{
+		// The remaining bodies stay in the base island
+		for ( int i = 0; i < split->linkCount; ++i )
+		{
+			if ( split->components[i].bodyCount > 0 )
+			{
+				b2CreatePeeledIsland( split, split->components + i );
+			}
+		}
+
+		baseIsland = b2Array_Get( world->islands, baseId );
+		b2ClearIslandRemovals( baseIsland );
+		b2ValidateIsland( world, baseId );
+		return;
+	}
+
 	// Early return — island is still fully connected, no split needed.
+	int componentCount = split->componentCount;
 	if ( componentCount == 1 )
 	{
-		baseIsland->constraintRemoveCount = 0;
-		b2StackFree( alloc, jointCounts );
-		b2StackFree( alloc, contactCounts );
-		b2StackFree( alloc, parents );
+		b2ClearIslandRemovals( baseIsland );
 		return;
 	}
 
+	// Cache base island fields before b2CreateIsland, which may reallocate
+	// world->islands and invalidate the baseIsland pointer.
+	int baseBodyCount = baseIsland->bodies.count;
+	int* baseBodyIds = baseIsland->bodies.data;
+	int baseBodyCapacity = baseIsland->bodies.capacity;
+
+	int baseContactCount = baseIsland->contacts.count;
+	b2ContactLink* baseContacts = baseIsland->contacts.data;
+	int baseContactCapacity = baseIsland->contacts.capacity;
+
+	int baseJointCount = baseIsland->joints.count;
+	b2JointLink* baseJoints = baseIsland->joints.data;
+	int baseJointCapacity = baseIsland->joints.capacity;
+
 	// Detach body/contact/joint arrays from base island so b2DestroyIsland won't free them
 	baseIsland->bodies.data = NULL;
 	baseIsland->bodies.count = 0;
@@ -525,6 +1204,11 @@ void b2SplitIsland( b2World* world, int baseId )
 	// Null so code below doesn't accidentally use this.
 	baseIsland = NULL;
 
+	b2Stack* alloc = &world->stack;
+	int* parents = split->parents;
+	int* contactCounts = split->contactCounts;
+	int* jointCounts = split->jointCounts;
+
 	// Map from body index to new island index. Only set for root bodies.
 	int* rootMap = b2StackAlloc( alloc, baseBodyCount * sizeof( int ), "root map" );
 	for ( int i = 0; i < baseBodyCount; ++i )
@@ -644,9 +1328,38 @@ void b2SplitIsland( b2World* world, int baseId )
 	b2StackFree( alloc, componentContactCounts );
 	b2StackFree( alloc, componentBodyCounts );
 	b2StackFree( alloc, rootMap );
-	b2StackFree( alloc, jointCounts );
-	b2StackFree( alloc, contactCounts );
-	b2StackFree( alloc, parents );
+}
+
+void b2SplitIsland( b2World* world, int baseId )
+{
+	b2IslandSplit split;
+	b2AllocateIslandSplit( world, &split, baseId );
+	b2FindIslandComponents( &split );
+	b2CreateSplitIslands( &split );
+	b2FreeIslandSplit( world, &split );
+}
+
+b2IslandSplit* b2BeginIslandSplits( b2World* world, int* splitCount )
+{
+	int count = world->splitIslandCount;
+	*splitCount = count;
+	world->stepSplitIslandCount = count;
+	if ( count == 0 )
+	{
+		return NULL;
+	}
+
+	b2IslandSplit* splits = b2StackAlloc( &world->stack, count * sizeof( b2IslandSplit ), "island splits" );
+	for ( int i = 0; i < count; ++i )
+	{
+		b2AllocateIslandSplit( world, splits + i, world->splitIslandIds[i] );
+	}
+
+	// A lone split also creates its islands in the task, overlapping with the solver. With several
+	// splits that work modifies shared world data and is done serially in b2FinishIslandSplits.
+	splits[0].finishInTask = count == 1;
+
+	return splits;
 }
 
 // Split an island because some contacts and/or joints have been removed.
@@ -654,24 +1367,62 @@ void b2SplitIsland( b2World* world, int baseId )
 // touches a lot of memory, so it can be slow.
 // Note: contacts/joints connected to static bodies must belong to an island but don't affect island connectivity
 // Note: static bodies are never in an island
-// Note: this task interacts with some allocators without locks under the assumption that no other tasks
-// are interacting with these data structures.
+// Note: a task that creates islands interacts with some allocators without locks under the assumption that no
+// other tasks are interacting with these data structures.
 void b2SplitIslandTask( void* context )
 {
 	b2TracyCZoneNC( split, "Split Island", b2_colorOlive, true );
 
 	uint64_t ticks = b2GetTicks();
-	b2World* world = context;
+	b2IslandSplit* split = context;
 
-	B2_ASSERT( world->splitIslandId != B2_NULL_INDEX );
+	b2FindIslandComponents( split );
 
-	b2SplitIsland( world, world->splitIslandId );
+	if ( split->finishInTask )
+	{
+		b2CreateSplitIslands( split );
+	}
 
-	world->splitIslandId = B2_NULL_INDEX;
-	world->profile.splitIslands += b2GetMilliseconds( ticks );
+	split->milliseconds = b2GetMilliseconds( ticks );
 	b2TracyCZoneEnd( split );
 }
 
+void b2FinishIslandSplits( b2World* world, b2IslandSplit* splits, int splitCount )
+{
+	if ( splitCount == 0 )
+	{
+		return;
+	}
+
+	b2TracyCZoneNC( finish_split, "Finish Split", b2_colorOlive, true );
+
+	uint64_t ticks = b2GetTicks();
+
+	// Serial in candidate order so island ids are allocated deterministically
+	float milliseconds = 0.0f;
+	for ( int i = 0; i < splitCount; ++i )
+	{
+		if ( splits[i].finishInTask == false )
+		{
+			b2CreateSplitIslands( splits + i );
+		}
+
+		milliseconds += splits[i].milliseconds;
+	}
+
+	for ( int i = splitCount - 1; i >= 0; --i )
+	{
+		b2FreeIslandSplit( world, splits + i );
+	}
+
+	b2StackFree( &world->stack, splits );
+
+	world->splitIslandCount = 0;
+	world->profile.splitIslands += milliseconds + b2GetMilliseconds( ticks );
+
+	b2TracyCZoneEnd( finish_split );
+}
+
 #if B2_ENABLE_VALIDATION
 void b2ValidateIsland( b2World* world, int islandId )
 {
@@ -5,6 +5,8 @@
 
 #include "container.h"
 
+#include "box2d/constants.h"
+
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -33,6 +35,15 @@ typedef struct b2JointLink
 
 b2DeclareArray( b2JointLink );
 
+// The bodies of a contact or joint removed from an island
+typedef struct b2RemovedLink
+{
+	int bodyIdA;
+	int bodyIdB;
+} b2RemovedLink;
+
+b2DeclareArray( b2RemovedLink );
+
 // Deterministic solver
 //
 // Collide all awake contacts
@@ -73,6 +84,14 @@ typedef struct b2Island
 	b2Array( b2ContactLink ) contacts;
 	b2Array( b2JointLink ) joints;
 
+	// Constraints removed between two island bodies since the island was last known to be connected.
+	// Only recorded when incremental islands are enabled. The island is connected using its
+	// constraints plus these removed links, so a split only needs to search around them.
+	b2Array( b2RemovedLink ) removedLinks;
+
+	// Set when a removal was not recorded, so a split must run union-find over the whole island
+	bool untrackedRemovals;
+
 } b2Island;
 
 b2DeclareArray( b2Island );
@@ -91,6 +110,9 @@ void b2DestroyIsland( b2World* world, int islandId );
 // Link contacts into the island graph when it starts having contact points
 void b2LinkContact( b2World* world, b2Contact* contact );
 
+// Bulk version of b2LinkContact for many contacts that started touching in the same step
+void b2LinkContacts( b2World* world, const int* contactIds, int count );
+
 // Unlink contact from the island graph when it stops having contact points
 void b2UnlinkContact( b2World* world, b2Contact* contact );
 
@@ -100,8 +122,63 @@ void b2LinkJoint( b2World* world, b2Joint* joint );
 // Unlink a joint from the island graph when it is destroyed
 void b2UnlinkJoint( b2World* world, b2Joint* joint );
 
+// An island that has bodies wanting to sleep but needs a split first
+typedef struct b2SplitCandidate
+{
+	int islandId;
+	float sleepTime;
+} b2SplitCandidate;
+
+// Bodies that break off from an island in an incremental split. These bodies are connected
+// to each other and disconnected from the rest of the island.
+typedef struct b2PeeledComponent
+{
+	// A body that stays on the other side, used to follow removed links into the
+	// peeled component back to the rest of the island
+	int remainingBodyId;
+	int bodyStart;
+	int bodyCount;
+} b2PeeledComponent;
+
+// Union-find scratch for splitting one island. Splits of different islands only read their base
+// island and write their own scratch, so the union-find passes can run in parallel. Creating the
+// new islands modifies the world and is done serially afterwards.
+typedef struct b2IslandSplit
+{
+	b2World* world;
+	int baseId;
+	int bodyCount;
+	int componentCount;
+	int* parents;
+	int* contactCounts;
+	int* jointCounts;
+	int* ranks;
+
+	// Incremental split around the removed links, see b2WorldDef::enableIncrementalIslands. This reuses
+	// the union-find arrays for the search queues and the bodies that break off.
+	b2PeeledComponent* components;
+	int linkCount;
+	uint64_t stampBase;
+	bool incremental;
+
+	float milliseconds;
+	bool finishInTask;
+} b2IslandSplit;
+
+// Add an island to a list of candidates sorted by decreasing sleep time. Ties go to the larger island
+// id for determinism. Keeps the best capacity candidates and the largest sleep time of each island.
+void b2AddSplitCandidate( b2SplitCandidate* candidates, int* count, int capacity, int islandId, float sleepTime );
+
+// Stop tracking an island as a pending split, for example because it was destroyed or fell asleep
+void b2RemoveSplitIsland( b2World* world, int islandId );
+
 void b2SplitIsland( b2World* world, int baseId );
+
+// Parallel splitting of the pending split islands. Begin allocates the scratch from the stack allocator,
+// the task runs union-find for one split, and finish creates the new islands and frees the scratch.
+b2IslandSplit* b2BeginIslandSplits( b2World* world, int* splitCount );
 void b2SplitIslandTask( void* context );
+void b2FinishIslandSplits( b2World* world, b2IslandSplit* splits, int splitCount );
 
 void b2ValidateIsland( b2World* world, int islandId );
 
@@ -8,6 +8,7 @@
 #include "core.h"
 #include "island.h"
 #include "physics_world.h"
+#include "recorder.h"
 #include "shape.h"
 #include "solver.h"
 #include "solver_set.h"
@@ -123,6 +124,30 @@ b2JointSim* b2GetJointSim( b2World* world, b2Joint* joint )
 	return b2Array_Get( set->jointSims,joint->localIndex );
 }
 
+static void b2MarkJointDirty( b2World* world, b2Joint* joint )
+{
+	b2MarkDirty( world, b2_dirtyJoint, joint->jointId );
+	b2MarkDirty( world, b2_dirtySolverSet, joint->setIndex );
+
+	// Every setter comes through here
+	b2GetJointSim( world, joint )->preparedTimeStep = 0.0f;
+}
+
+void b2InvalidateJointPrepare( b2World* world, b2Body* body )
+{
+	int jointKey = body->headJointKey;
+	while ( jointKey != B2_NULL_INDEX )
+	{
+		int jointId = jointKey >> 1;
+		int edgeIndex = jointKey & 1;
+
+		b2Joint* joint = b2Array_Get( world->joints, jointId );
+		jointKey = joint->edges[edgeIndex].nextKey;
+
+		b2GetJointSim( world, joint )->preparedTimeStep = 0.0f;
+	}
+}
+
 b2JointSim* b2GetJointSimCheckType( b2JointId jointId, b2JointType type )
 {
 	B2_UNUSED( type );
@@ -141,6 +166,18 @@ b2JointSim* b2GetJointSimCheckType( b2JointId jointId, b2JointType type )
 	return jointSim;
 }
 
+b2JointSim* b2GetMutableJointSim( b2JointId jointId, b2JointType type )
+{
+	b2JointSim* jointSim = b2GetJointSimCheckType( jointId, type );
+	if ( jointSim != NULL )
+	{
+		b2World* world = b2GetWorld( jointId.world0 );
+		b2MarkJointDirty( world, b2GetJointFullId( world, jointId ) );
+	}
+
+	return jointSim;
+}
+
 static void b2DestroyContactsBetweenBodies( b2World* world, b2Body* bodyA, b2Body* bodyB )
 {
 	int contactKey;
@@ -200,13 +237,29 @@ static b2JointPair b2CreateJoint( b2World* world, const b2JointDef* def, b2Joint
 
 	int bodyIdA = bodyA->id;
 	int bodyIdB = bodyB->id;
+
+	// Parked and frozen sets are woken instead of merged with other sets
+	if ( b2KeepsVelocity( world, bodyA->setIndex ) )
+	{
+		b2WakeSolverSet( world, bodyA->setIndex );
+	}
+
+	if ( b2KeepsVelocity( world, bodyB->setIndex ) )
+	{
+		b2WakeSolverSet( world, bodyB->setIndex );
+	}
+
+	// Kinematic set bodies return to the awake set to be solved with the joint
+	b2AttachKinematicBody( world, bodyA );
+	b2AttachKinematicBody( world, bodyB );
+
 	int maxSetIndex = b2MaxInt( bodyA->setIndex, bodyB->setIndex );
 
 	// Create joint id and joint
 	int jointId = b2AllocId( &world->jointIdPool );
 	if ( jointId == world->joints.count )
 	{
-		b2Array_Push( world->joints,(b2Joint){ 0 } );
+		b2Array_Push( world->joints, (b2Joint){ .generation = world->jointGenerationFloor } );
 	}
 
 	b2Joint* joint = b2Array_Get( world->joints,jointId );
@@ -234,9 +287,11 @@ static b2JointPair b2CreateJoint( b2World* world, const b2JointDef* def, b2Joint
 		b2Joint* jointA = b2Array_Get( world->joints,bodyA->headJointKey >> 1 );
 		b2JointEdge* edgeA = jointA->edges + ( bodyA->headJointKey & 1 );
 		edgeA->prevKey = keyA;
+		b2MarkDirty( world, b2_dirtyJoint, bodyA->headJointKey >> 1 );
 	}
 	bodyA->headJointKey = keyA;
 	bodyA->jointCount += 1;
+	b2MarkDirty( world, b2_dirtyBody, bodyIdA );
 
 	// Doubly linked list on bodyB
 	joint->edges[1].bodyId = bodyIdB;
@@ -249,9 +304,11 @@ static b2JointPair b2CreateJoint( b2World* world, const b2JointDef* def, b2Joint
 		b2Joint* jointB = b2Array_Get( world->joints,bodyB->headJointKey >> 1 );
 		b2JointEdge* edgeB = jointB->edges + ( bodyB->headJointKey & 1 );
 		edgeB->prevKey = keyB;
+		b2MarkDirty( world, b2_dirtyJoint, bodyB->headJointKey >> 1 );
 	}
 	bodyB->headJointKey = keyB;
 	bodyB->jointCount += 1;
+	b2MarkDirty( world, b2_dirtyBody, bodyIdB );
 
 	b2JointSim* jointSim;
 
@@ -338,6 +395,8 @@ static b2JointPair b2CreateJoint( b2World* world, const b2JointDef* def, b2Joint
 		B2_ASSERT( joint->setIndex == setIndex );
 	}
 
+	b2MarkJointDirty( world, joint );
+
 	jointSim->localFrameA = def->localFrameA;
 	jointSim->localFrameB = def->localFrameB;
 	jointSim->type = type;
@@ -354,6 +413,7 @@ static b2JointPair b2CreateJoint( b2World* world, const b2JointDef* def, b2Joint
 
 	jointSim->forceThreshold = def->forceThreshold;
 	jointSim->torqueThreshold = def->torqueThreshold;
+	jointSim->eventStepIndex = 0;
 
 	B2_ASSERT( jointSim->jointId == jointId );
 	B2_ASSERT( jointSim->bodyIdA == bodyIdA );
@@ -415,6 +475,12 @@ b2JointId b2CreateDistanceJoint( b2WorldId worldId, const b2DistanceJointDef* de
 	joint->distanceJoint.motorImpulse = 0.0f;
 
 	b2JointId jointId = { joint->jointId + 1, world->worldId, pair.joint->generation };
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCreateJoint( world->recorder, def, b2_distanceJoint, jointId );
+	}
+
 	return jointId;
 }
 
@@ -446,6 +512,12 @@ b2JointId b2CreateMotorJoint( b2WorldId worldId, const b2MotorJointDef* def )
 	joint->motorJoint.maxSpringTorque = def->maxSpringTorque;
 
 	b2JointId jointId = { joint->jointId + 1, world->worldId, pair.joint->generation };
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCreateJoint( world->recorder, def, b2_motorJoint, jointId );
+	}
+
 	return jointId;
 }
 
@@ -466,6 +538,12 @@ b2JointId b2CreateFilterJoint( b2WorldId worldId, const b2FilterJointDef* def )
 	b2JointSim* joint = pair.jointSim;
 
 	b2JointId jointId = { joint->jointId + 1, world->worldId, pair.joint->generation };
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCreateJoint( world->recorder, def, b2_filterJoint, jointId );
+	}
+
 	return jointId;
 }
 
@@ -500,6 +578,12 @@ b2JointId b2CreatePrismaticJoint( b2WorldId worldId, const b2PrismaticJointDef*
 	joint->prismaticJoint.enableMotor = def->enableMotor;
 
 	b2JointId jointId = { joint->jointId + 1, world->worldId, pair.joint->generation };
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCreateJoint( world->recorder, def, b2_prismaticJoint, jointId );
+	}
+
 	return jointId;
 }
 
@@ -538,6 +622,12 @@ b2JointId b2CreateRevoluteJoint( b2WorldId worldId, const b2RevoluteJointDef* de
 	joint->revoluteJoint.enableMotor = def->enableMotor;
 
 	b2JointId jointId = { joint->jointId + 1, world->worldId, pair.joint->generation };
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCreateJoint( world->recorder, def, b2_revoluteJoint, jointId );
+	}
+
 	return jointId;
 }
 
@@ -567,6 +657,12 @@ b2JointId b2CreateWeldJoint( b2WorldId worldId, const b2WeldJointDef* def )
 	joint->weldJoint.angularImpulse = 0.0f;
 
 	b2JointId jointId = { joint->jointId + 1, world->worldId, pair.joint->generation };
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCreateJoint( world->recorder, def, b2_weldJoint, jointId );
+	}
+
 	return jointId;
 }
 
@@ -605,9 +701,28 @@ b2JointId b2CreateWheelJoint( b2WorldId worldId, const b2WheelJointDef* def )
 	joint->wheelJoint.enableMotor = def->enableMotor;
 
 	b2JointId jointId = { joint->jointId + 1, world->worldId, pair.joint->generation };
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCreateJoint( world->recorder, def, b2_wheelJoint, jointId );
+	}
+
 	return jointId;
 }
 
+// The shapes of the body are overlapping shapes that were filtered by a joint. Their next pair query
+// has to cover the whole fat AABB to find them.
+static void b2ResetBodyPairAABBs( b2World* world, b2Body* body )
+{
+	int shapeId = body->headShapeId;
+	while ( shapeId != B2_NULL_INDEX )
+	{
+		b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+		b2ResetPairAABB( shape );
+		shapeId = shape->nextShapeId;
+	}
+}
+
 void b2DestroyJointInternal( b2World* world, b2Joint* joint, bool wakeBodies )
 {
 	int jointId = joint->jointId;
@@ -620,6 +735,29 @@ void b2DestroyJointInternal( b2World* world, b2Joint* joint, bool wakeBodies )
 	b2Body* bodyA = b2Array_Get( world->bodies,idA );
 	b2Body* bodyB = b2Array_Get( world->bodies,idB );
 
+	if ( joint->collideConnected == false )
+	{
+		b2ResetBodyPairAABBs( world, bodyA );
+		b2ResetBodyPairAABBs( world, bodyB );
+	}
+
+	b2MarkJointDirty( world, joint );
+	b2MarkDirty( world, b2_dirtyBody, idA );
+	b2MarkDirty( world, b2_dirtyBody, idB );
+	for ( int i = 0; i < 2; ++i )
+	{
+		b2JointEdge* edge = joint->edges + i;
+		if ( edge->prevKey != B2_NULL_INDEX )
+		{
+			b2MarkDirty( world, b2_dirtyJoint, edge->prevKey >> 1 );
+		}
+
+		if ( edge->nextKey != B2_NULL_INDEX )
+		{
+			b2MarkDirty( world, b2_dirtyJoint, edge->nextKey >> 1 );
+		}
+	}
+
 	// Remove from body A
 	if ( edgeA->prevKey != B2_NULL_INDEX )
 	{
@@ -727,6 +865,13 @@ void b2DestroyJoint( b2JointId jointId, bool wakeAttached )
 
 	b2Joint* joint = b2GetJointFullId( world, jointId );
 
+	if ( world->recorder != NULL )
+	{
+		b2RecordCall( world->recorder, b2_recordDestroyJoint );
+		b2RecordValue( world->recorder, jointId );
+		b2RecordValue( world->recorder, wakeAttached );
+	}
+
 	b2DestroyJointInternal( world, joint, wakeAttached );
 }
 
@@ -763,6 +908,7 @@ void b2Joint_SetLocalFrameA( b2JointId jointId, b2Transform localFrame )
 
 	b2World* world = b2GetWorld( jointId.world0 );
 	b2Joint* joint = b2GetJointFullId( world, jointId );
+	b2MarkJointDirty( world, joint );
 	b2JointSim* jointSim = b2GetJointSim( world, joint );
 	jointSim->localFrameA = localFrame;
 }
@@ -781,6 +927,7 @@ void b2Joint_SetLocalFrameB( b2JointId jointId, b2Transform localFrame )
 
 	b2World* world = b2GetWorld( jointId.world0 );
 	b2Joint* joint = b2GetJointFullId( world, jointId );
+	b2MarkJointDirty( world, joint );
 	b2JointSim* jointSim = b2GetJointSim( world, joint );
 	jointSim->localFrameB = localFrame;
 }
@@ -802,6 +949,7 @@ void b2Joint_SetCollideConnected( b2JointId jointId, bool shouldCollide )
 	}
 
 	b2Joint* joint = b2GetJointFullId( world, jointId );
+	b2MarkJointDirty( world, joint );
 	if ( joint->collideConnected == shouldCollide )
 	{
 		return;
@@ -826,6 +974,7 @@ void b2Joint_SetCollideConnected( b2JointId jointId, bool shouldCollide )
 
 			if ( shape->proxyKey != B2_NULL_INDEX )
 			{
+				b2ResetPairAABB( shape );
 				b2BufferMove( &world->broadPhase, shape->proxyKey );
 			}
 
@@ -849,6 +998,7 @@ void b2Joint_SetUserData( b2JointId jointId, void* userData )
 {
 	b2World* world = b2GetWorld( jointId.world0 );
 	b2Joint* joint = b2GetJointFullId( world, jointId );
+	b2MarkJointDirty( world, joint );
 	joint->userData = userData;
 }
 
@@ -1213,6 +1363,7 @@ void b2Joint_SetConstraintTuning( b2JointId jointId, float hertz, float dampingR
 
 	b2World* world = b2GetWorld( jointId.world0 );
 	b2Joint* joint = b2GetJointFullId( world, jointId );
+	b2MarkJointDirty( world, joint );
 	b2JointSim* base = b2GetJointSim( world, joint );
 	base->constraintHertz = hertz;
 	base->constraintDampingRatio = dampingRatio;
@@ -1233,6 +1384,7 @@ void b2Joint_SetForceThreshold( b2JointId jointId, float threshold )
 
 	b2World* world = b2GetWorld( jointId.world0 );
 	b2Joint* joint = b2GetJointFullId( world, jointId );
+	b2MarkJointDirty( world, joint );
 	b2JointSim* base = b2GetJointSim( world, joint );
 	base->forceThreshold = threshold;
 }
@@ -1251,6 +1403,7 @@ void b2Joint_SetTorqueThreshold( b2JointId jointId, float threshold )
 
 	b2World* world = b2GetWorld( jointId.world0 );
 	b2Joint* joint = b2GetJointFullId( world, jointId );
+	b2MarkJointDirty( world, joint );
 	b2JointSim* base = b2GetJointSim( world, joint );
 	base->torqueThreshold = threshold;
 }
@@ -1263,8 +1416,91 @@ float b2Joint_GetTorqueThreshold( b2JointId jointId )
 	return base->torqueThreshold;
 }
 
+// True if the rotation is within the tolerance of the prepared rotation
+static bool b2IsRotationNear( b2Rot prepared, b2Rot q, float tolerance )
+{
+	float c = prepared.c * q.c + prepared.s * q.s;
+	float s = prepared.c * q.s - prepared.s * q.c;
+	return c > 0.0f && b2AbsFloat( s ) <= tolerance;
+}
+
+// Updates the body indices and center delta of a joint prepared in an earlier step. The frames and
+// effective masses are kept. Returns false if the joint needs a full prepare.
+static bool b2ReuseJointPrepare( b2JointSim* joint, const b2BodySim* bodySimA, const b2BodySim* bodySimB, int indexA,
+								 int indexB, b2StepContext* context )
+{
+	if ( joint->preparedTimeStep != context->h || context->enableWarmStarting == false )
+	{
+		return false;
+	}
+
+	if ( joint->invMassA != bodySimA->invMass || joint->invMassB != bodySimB->invMass ||
+		 joint->invIA != bodySimA->invInertia || joint->invIB != bodySimB->invInertia )
+	{
+		return false;
+	}
+
+	float tolerance = context->world->jointPrepareTolerance;
+	if ( b2IsRotationNear( joint->preparedRotationA, bodySimA->transform.q, tolerance ) == false ||
+		 b2IsRotationNear( joint->preparedRotationB, bodySimB->transform.q, tolerance ) == false )
+	{
+		return false;
+	}
+
+	b2Vec2 deltaCenter = b2Sub( bodySimB->center, bodySimA->center );
+
+	switch ( joint->type )
+	{
+		case b2_motorJoint:
+			joint->motorJoint.indexA = indexA;
+			joint->motorJoint.indexB = indexB;
+			joint->motorJoint.deltaCenter = deltaCenter;
+			return true;
+
+		case b2_prismaticJoint:
+			joint->prismaticJoint.indexA = indexA;
+			joint->prismaticJoint.indexB = indexB;
+			joint->prismaticJoint.deltaCenter = deltaCenter;
+			return true;
+
+		case b2_revoluteJoint:
+			joint->revoluteJoint.indexA = indexA;
+			joint->revoluteJoint.indexB = indexB;
+			joint->revoluteJoint.deltaCenter = deltaCenter;
+			return true;
+
+		case b2_weldJoint:
+			joint->weldJoint.indexA = indexA;
+			joint->weldJoint.indexB = indexB;
+			joint->weldJoint.deltaCenter = deltaCenter;
+			return true;
+
+		default:
+			// The distance and wheel effective masses depend on the body positions
+			return false;
+	}
+}
+
 void b2PrepareJoint( b2JointSim* joint, b2StepContext* context )
 {
+	const b2BodySim* bodySimA = NULL;
+	const b2BodySim* bodySimB = NULL;
+	if ( context->world->jointPrepareTolerance > 0.0f )
+	{
+		b2World* world = context->world;
+		b2Body* bodyA = b2Array_Get( world->bodies, joint->bodyIdA );
+		b2Body* bodyB = b2Array_Get( world->bodies, joint->bodyIdB );
+		bodySimA = b2GetBodySim( world, bodyA );
+		bodySimB = b2GetBodySim( world, bodyB );
+
+		int indexA = bodyA->setIndex == b2_awakeSet ? bodyA->localIndex : B2_NULL_INDEX;
+		int indexB = bodyB->setIndex == b2_awakeSet ? bodyB->localIndex : B2_NULL_INDEX;
+		if ( b2ReuseJointPrepare( joint, bodySimA, bodySimB, indexA, indexB, context ) )
+		{
+			return;
+		}
+	}
+
 	// Clamp joint hertz based on the time step to reduce jitter.
 	float hertz = b2MinFloat( joint->constraintHertz, 0.25f * context->inv_h );
 	joint->constraintSoftness = b2MakeSoft( hertz, joint->constraintDampingRatio, context->h );
@@ -1301,6 +1537,13 @@ void b2PrepareJoint( b2JointSim* joint, b2StepContext* context )
 		default:
 			B2_ASSERT( false );
 	}
+
+	if ( bodySimA != NULL )
+	{
+		joint->preparedRotationA = bodySimA->transform.q;
+		joint->preparedRotationB = bodySimB->transform.q;
+		joint->preparedTimeStep = context->h;
+	}
 }
 
 void b2WarmStartJoint( b2JointSim* joint, b2StepContext* context )
@@ -1426,39 +1669,18 @@ void b2SolveJoints_Overflow( b2StepContext* context, bool useBias )
 	b2TracyCZoneEnd( solve_joints );
 }
 
+// Runs as a flat parallel-for over the scalar joints of all colors.
 void b2PrepareJointsTask( b2SolverBlock block, b2StepContext* context )
 {
 	b2TracyCZoneNC( prepare_joints, "PrepJoints", b2_colorOldLace, true );
 
-	b2JointPrepareSpan* spans = context->jointPrepareSpans;
-
-	int index = block.startIndex;
-	int endIndex = block.startIndex + block.count;
+	b2JointSim** joints = context->scalarJoints;
 
-	// Find color for start index. Linear search but fast.
-	int colorIndex = 0;
-	while ( spans[colorIndex + 1].start <= index )
-	{
-		colorIndex += 1;
-	}
+	B2_ASSERT( 0 <= block.startIndex && block.startIndex + block.count <= context->scalarJointCount );
 
-	// Loop over block
-	while ( index < endIndex )
+	for ( int i = block.startIndex; i < block.startIndex + block.count; ++i )
 	{
-		int colorStart = spans[colorIndex].start;
-		int colorEndIndex = b2MinInt( spans[colorIndex + 1].start, endIndex );
-		b2JointSim* joints = spans[colorIndex].joints;
-
-		// Loop over color
-		for ( ; index < colorEndIndex; ++index )
-		{
-			B2_ASSERT( 0 <= index - colorStart && index - colorStart < spans[colorIndex].count );
-			b2JointSim* joint = joints + ( index - colorStart );
-			b2PrepareJoint( joint, context );
-		}
-
-		// Advance to next color
-		colorIndex += 1;
+		b2PrepareJoint( joints[i], context );
 	}
 
 	b2TracyCZoneEnd( prepare_joints );
@@ -1469,35 +1691,31 @@ void b2WarmStartJointsTask( b2SolverBlock block, b2StepContext* context )
 	b2TracyCZoneNC( warm_joints, "WarmJoints", b2_colorGold, true );
 
 	b2GraphColor* color = context->graph->colors + block.colorIndex;
-	b2JointSim* joints = color->jointSims.data;
+	b2JointSim** joints = color->scalarJoints;
+
+	B2_ASSERT( 0 <= block.startIndex && block.startIndex + block.count <= color->scalarJointCount );
 
 	for ( int i = block.startIndex; i < block.startIndex + block.count; ++i )
 	{
-		b2JointSim* joint = joints + i;
-		b2WarmStartJoint( joint, context );
+		b2WarmStartJoint( joints[i], context );
 	}
 
 	b2TracyCZoneEnd( warm_joints );
 }
 
-void b2SolveJointsTask( b2SolverBlock block, b2StepContext* context, bool useBias, int workerIndex )
+void b2SolveJoints( b2StepContext* context, b2JointSim** joints, int count, bool useBias, int workerIndex )
 {
-	b2TracyCZoneNC( solve_joints, "SolveJoints", b2_colorLemonChiffon, true );
-
-	b2GraphColor* color = context->graph->colors + block.colorIndex;
-	b2JointSim* joints = color->jointSims.data;
-
-	B2_ASSERT( 0 <= block.startIndex && block.startIndex + block.count <= color->jointSims.count );
+	b2TaskContext* taskContext = context->world->taskContexts.data + workerIndex;
+	uint64_t stepIndex = context->world->stepIndex;
 
-	b2BitSet* jointStateBitSet = &context->world->taskContexts.data[workerIndex].jointStateBitSet;
-
-	for ( int i = block.startIndex; i < block.startIndex + block.count; ++i )
+	for ( int i = 0; i < count; ++i )
 	{
-		b2JointSim* joint = joints + i;
+		b2JointSim* joint = joints[i];
 		b2SolveJoint( joint, context, useBias );
 
+		// A joint sim is only touched by one worker per stage, so the step index needs no atomics
 		if ( useBias && ( joint->forceThreshold < FLT_MAX || joint->torqueThreshold < FLT_MAX ) &&
-			 b2GetBit( jointStateBitSet, joint->jointId ) == false )
+			 joint->eventStepIndex != stepIndex )
 		{
 			float force, torque;
 			b2GetJointReaction( joint, context->inv_h, &force, &torque );
@@ -1505,11 +1723,22 @@ void b2SolveJointsTask( b2SolverBlock block, b2StepContext* context, bool useBia
 			// Check thresholds. A zero threshold means all awake joints get reported.
 			if ( force >= joint->forceThreshold || torque >= joint->torqueThreshold )
 			{
-				// Flag this joint for processing.
-				b2SetBit( jointStateBitSet, joint->jointId );
+				joint->eventStepIndex = stepIndex;
+				b2Array_Push( taskContext->jointEventIds, joint->jointId );
 			}
 		}
 	}
+}
+
+void b2SolveJointsTask( b2SolverBlock block, b2StepContext* context, bool useBias, int workerIndex )
+{
+	b2TracyCZoneNC( solve_joints, "SolveJoints", b2_colorLemonChiffon, true );
+
+	b2GraphColor* color = context->graph->colors + block.colorIndex;
+
+	B2_ASSERT( 0 <= block.startIndex && block.startIndex + block.count <= color->scalarJointCount );
+
+	b2SolveJoints( context, color->scalarJoints + block.startIndex, block.count, useBias, workerIndex );
 
 	b2TracyCZoneEnd( solve_joints );
 }
@@ -7,6 +7,7 @@
 
 #include "box2d/types.h"
 
+typedef struct b2Body b2Body;
 typedef struct b2DebugDraw b2DebugDraw;
 typedef struct b2StepContext b2StepContext;
 typedef struct b2World b2World;
@@ -251,6 +252,14 @@ typedef struct b2JointSim
 	float forceThreshold;
 	float torqueThreshold;
 
+	// World step index of the last joint event, so a joint is reported once per step
+	uint64_t eventStepIndex;
+
+	// Body rotations and sub-step of the last full prepare, see b2WorldDef::jointPrepareTolerance.
+	// A zero sub-step means the prepared data must be recomputed.
+	b2Rot preparedRotationA, preparedRotationB;
+	float preparedTimeStep;
+
 	union
 	{
 		b2DistanceJoint distanceJoint;
@@ -268,7 +277,13 @@ b2Joint* b2GetJointFullId( b2World* world, b2JointId jointId );
 b2JointSim* b2GetJointSim( b2World* world, b2Joint* joint );
 b2JointSim* b2GetJointSimCheckType( b2JointId jointId, b2JointType type );
 
+// Same as b2GetJointSimCheckType for setters, records the change for delta snapshots
+b2JointSim* b2GetMutableJointSim( b2JointId jointId, b2JointType type );
+
 void b2PrepareJoint( b2JointSim* joint, b2StepContext* context );
+
+// Forces a full prepare of the joints of a body on the next step
+void b2InvalidateJointPrepare( b2World* world, b2Body* body );
 void b2WarmStartJoint( b2JointSim* joint, b2StepContext* context );
 void b2SolveJoint( b2JointSim* joint, b2StepContext* context, bool useBias );
 
@@ -280,6 +295,9 @@ void b2PrepareJointsTask( b2SolverBlock block, b2StepContext* context );
 void b2WarmStartJointsTask( b2SolverBlock block, b2StepContext* context );
 void b2SolveJointsTask( b2SolverBlock block, b2StepContext* context, bool useBias, int workerIndex );
 
+// Solves a list of joints and queues the joint events of the worker
+void b2SolveJoints( b2StepContext* context, b2JointSim** joints, int count, bool useBias, int workerIndex );
+
 void b2GetJointReaction( b2JointSim* sim, float invTimeStep, float* force, float* torque );
 
 void b2DrawJoint( b2DebugDraw* draw, b2World* world, b2Joint* joint );
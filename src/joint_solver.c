@@ -0,0 +1,1094 @@
+// SPDX-FileCopyrightText: 2023 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#include "joint_solver.h"
+
+#include "body.h"
+#include "constraint_graph.h"
+#include "core.h"
+#include "joint.h"
+#include "simd.h"
+
+#include <float.h>
+#include <stddef.h>
+
+// The wide joint solvers mirror the scalar solvers in revolute_joint.c, weld_joint.c, and
+// prismatic_joint.c operation for operation. This keeps results bit-identical to the scalar
+// path so determinism does not depend on how joints get batched. Optional features such as
+// motors and limits are solved for all lanes and blended with a per-lane enable mask, and
+// skipped when no lane uses them.
+
+typedef struct b2RevoluteJointW
+{
+	b2Vec2W anchorA, anchorB;
+	b2RotW frameA, frameB;
+	b2Vec2W deltaCenter;
+	b2FloatW axialMass;
+	b2FloatW motorSpeed;
+	b2FloatW maxMotorImpulse;
+	b2FloatW lowerAngle, upperAngle;
+
+	// 1 or 0, already false for fixed rotation
+	b2FloatW enableMotor;
+	b2FloatW enableLimit;
+
+	b2Vec2W linearImpulse;
+	b2FloatW springImpulse;
+	b2FloatW motorImpulse;
+	b2FloatW lowerImpulse;
+	b2FloatW upperImpulse;
+} b2RevoluteJointW;
+
+typedef struct b2WeldJointW
+{
+	b2Vec2W anchorA, anchorB;
+	b2RotW frameA, frameB;
+	b2Vec2W deltaCenter;
+	b2FloatW axialMass;
+	b2FloatW linearBiasRate, linearMassScale, linearImpulseScale;
+	b2FloatW angularBiasRate, angularMassScale, angularImpulseScale;
+
+	// 1 if the lane has a real spring that is applied during relax
+	b2FloatW linearSpring;
+	b2FloatW angularSpring;
+
+	b2Vec2W linearImpulse;
+	b2FloatW angularImpulse;
+} b2WeldJointW;
+
+typedef struct b2PrismaticJointW
+{
+	b2Vec2W anchorA, anchorB;
+	b2RotW frameA, frameB;
+
+	// joint axis in world space at the beginning of the step
+	b2Vec2W axisA;
+	b2Vec2W deltaCenter;
+	b2FloatW springBiasRate, springMassScale, springImpulseScale;
+	b2FloatW targetTranslation;
+	b2FloatW motorSpeed;
+	b2FloatW maxMotorImpulse;
+	b2FloatW lowerTranslation, upperTranslation;
+	b2FloatW speculativeDistance;
+
+	// 1 or 0
+	b2FloatW enableSpring;
+	b2FloatW enableMotor;
+	b2FloatW enableLimit;
+
+	b2Vec2W impulse;
+	b2FloatW springImpulse;
+	b2FloatW motorImpulse;
+	b2FloatW lowerImpulse;
+	b2FloatW upperImpulse;
+} b2PrismaticJointW;
+
+typedef struct b2JointConstraintWide
+{
+	// NULL for unused lanes
+	b2JointSim* joints[B2_SIMD_WIDTH];
+
+	// base-1, 0 for null
+	int indexA[B2_SIMD_WIDTH];
+	int indexB[B2_SIMD_WIDTH];
+
+	b2FloatW invMassA, invMassB;
+	b2FloatW invIA, invIB;
+
+	// constraint softness
+	b2FloatW biasRate;
+	b2FloatW massScale;
+	b2FloatW impulseScale;
+
+	b2JointType type;
+
+	union
+	{
+		b2RevoluteJointW revoluteJoint;
+		b2WeldJointW weldJoint;
+		b2PrismaticJointW prismaticJoint;
+	};
+} b2JointConstraintWide;
+
+int b2GetWideJointConstraintByteCount( void )
+{
+	return sizeof( b2JointConstraintWide );
+}
+
+bool b2IsWideJoint( const b2JointSim* joint )
+{
+	if ( joint->forceThreshold < FLT_MAX || joint->torqueThreshold < FLT_MAX )
+	{
+		return false;
+	}
+
+	switch ( joint->type )
+	{
+		case b2_prismaticJoint:
+		case b2_weldJoint:
+			return true;
+
+		case b2_revoluteJoint:
+			// The revolute spring unwinds the joint angle using remainderf
+			return joint->revoluteJoint.enableSpring == false;
+
+		default:
+			return false;
+	}
+}
+
+void b2SetWideJointLane( b2JointConstraintWide* constraints, int wideIndex, int lane, b2JointSim* joint )
+{
+	B2_ASSERT( 0 <= lane && lane < B2_SIMD_WIDTH );
+	B2_ASSERT( b2IsWideJoint( joint ) );
+
+	b2JointConstraintWide* constraint = constraints + wideIndex;
+	B2_ASSERT( lane == 0 || constraint->type == joint->type );
+
+	constraint->joints[lane] = joint;
+	constraint->type = joint->type;
+}
+
+static inline b2FloatW b2ClampW( b2FloatW a, b2FloatW lower, b2FloatW upper )
+{
+	// a < lower ? lower : ( a > upper ? upper : a )
+	b2FloatW r = b2BlendW( a, upper, b2GreaterThanW( a, upper ) );
+	return b2BlendW( r, lower, b2GreaterThanW( lower, a ) );
+}
+
+static inline b2FloatW b2AbsW( b2FloatW a )
+{
+	// a < 0 ? -a : a
+	return b2BlendW( a, b2NegW( a ), b2GreaterThanW( b2ZeroW(), a ) );
+}
+
+// Matches b2Atan2
+static b2FloatW b2Atan2W( b2FloatW y, b2FloatW x )
+{
+	b2FloatW zero = b2ZeroW();
+	b2FloatW ax = b2AbsW( x );
+	b2FloatW ay = b2AbsW( y );
+	b2FloatW mx = b2MaxW( ay, ax );
+	b2FloatW mn = b2MinW( ay, ax );
+	b2FloatW a = b2DivW( mn, mx );
+
+	// Minimax polynomial approximation to atan(a) on [0,1]
+	b2FloatW s = b2MulW( a, a );
+	b2FloatW c = b2MulW( s, a );
+	b2FloatW q = b2MulW( s, s );
+	b2FloatW r = b2AddW( b2MulW( b2SplatW( 0.024840285f ), q ), b2SplatW( 0.18681418f ) );
+	b2FloatW t = b2SubW( b2MulW( b2SplatW( -0.094097948f ), q ), b2SplatW( 0.33213072f ) );
+	r = b2AddW( b2MulW( r, s ), t );
+	r = b2AddW( b2MulW( r, c ), a );
+
+	// Map to full circle
+	r = b2BlendW( r, b2SubW( b2SplatW( 1.57079637f ), r ), b2GreaterThanW( ay, ax ) );
+	r = b2BlendW( r, b2SubW( b2SplatW( 3.14159274f ), r ), b2GreaterThanW( zero, x ) );
+	r = b2BlendW( r, b2NegW( r ), b2GreaterThanW( zero, y ) );
+
+	// (0,0) gives zero, the division above produced NaN for these lanes
+	b2FloatW zeroY = b2BlendW( r, zero, b2EqualsW( y, zero ) );
+	return b2BlendW( r, zeroY, b2EqualsW( x, zero ) );
+}
+
+static inline b2RotW b2MulRotW( b2RotW q, b2RotW r )
+{
+	b2RotW qr;
+	qr.S = b2AddW( b2MulW( q.S, r.C ), b2MulW( q.C, r.S ) );
+	qr.C = b2SubW( b2MulW( q.C, r.C ), b2MulW( q.S, r.S ) );
+	return qr;
+}
+
+static inline b2RotW b2InvMulRotW( b2RotW a, b2RotW b )
+{
+	b2RotW r;
+	r.S = b2SubW( b2MulW( a.C, b.S ), b2MulW( a.S, b.C ) );
+	r.C = b2AddW( b2MulW( a.C, b.C ), b2MulW( a.S, b.S ) );
+	return r;
+}
+
+// cross(w, r) for angular velocity w
+static inline b2Vec2W b2CrossSVW( b2FloatW s, b2Vec2W v )
+{
+	return (b2Vec2W){ b2MulW( b2NegW( s ), v.Y ), b2MulW( s, v.X ) };
+}
+
+static inline b2Vec2W b2AddVW( b2Vec2W a, b2Vec2W b )
+{
+	return (b2Vec2W){ b2AddW( a.X, b.X ), b2AddW( a.Y, b.Y ) };
+}
+
+static inline b2Vec2W b2SubVW( b2Vec2W a, b2Vec2W b )
+{
+	return (b2Vec2W){ b2SubW( a.X, b.X ), b2SubW( a.Y, b.Y ) };
+}
+
+static inline b2Vec2W b2MulSVW( b2FloatW s, b2Vec2W v )
+{
+	return (b2Vec2W){ b2MulW( s, v.X ), b2MulW( s, v.Y ) };
+}
+
+// a + s * b
+static inline b2Vec2W b2MulAddVW( b2Vec2W a, b2FloatW s, b2Vec2W b )
+{
+	return (b2Vec2W){ b2AddW( a.X, b2MulW( s, b.X ) ), b2AddW( a.Y, b2MulW( s, b.Y ) ) };
+}
+
+// a - s * b
+static inline b2Vec2W b2MulSubVW( b2Vec2W a, b2FloatW s, b2Vec2W b )
+{
+	return (b2Vec2W){ b2SubW( a.X, b2MulW( s, b.X ) ), b2SubW( a.Y, b2MulW( s, b.Y ) ) };
+}
+
+static inline b2Vec2W b2BlendVW( b2Vec2W a, b2Vec2W b, b2FloatW mask )
+{
+	return (b2Vec2W){ b2BlendW( a.X, b.X, mask ), b2BlendW( a.Y, b.Y, mask ) };
+}
+
+// Matches b2Solve22 for K = [a11 a12; a21 a22]
+static inline b2Vec2W b2Solve22W( b2FloatW a11, b2FloatW a12, b2FloatW a21, b2FloatW a22, b2Vec2W b )
+{
+	b2FloatW det = b2SubW( b2MulW( a11, a22 ), b2MulW( a12, a21 ) );
+	det = b2BlendW( b2DivW( b2SplatW( 1.0f ), det ), det, b2EqualsW( det, b2ZeroW() ) );
+	b2Vec2W x = {
+		b2MulW( det, b2SubW( b2MulW( a22, b.X ), b2MulW( a12, b.Y ) ) ),
+		b2MulW( det, b2SubW( b2MulW( a11, b.Y ), b2MulW( a21, b.X ) ) ),
+	};
+	return x;
+}
+
+// Point constraint effective mass shared by the revolute and weld joints
+static inline b2Vec2W b2SolvePointW( b2FloatW mA, b2FloatW mB, b2FloatW iA, b2FloatW iB, b2Vec2W rA, b2Vec2W rB, b2Vec2W b )
+{
+	b2FloatW m = b2AddW( mA, mB );
+	b2FloatW k11 = b2AddW( b2AddW( m, b2MulW( b2MulW( rA.Y, rA.Y ), iA ) ), b2MulW( b2MulW( rB.Y, rB.Y ), iB ) );
+	b2FloatW k12 = b2SubW( b2MulW( b2MulW( b2NegW( rA.Y ), rA.X ), iA ), b2MulW( b2MulW( rB.Y, rB.X ), iB ) );
+	b2FloatW k22 = b2AddW( b2AddW( m, b2MulW( b2MulW( rA.X, rA.X ), iA ) ), b2MulW( b2MulW( rB.X, rB.X ), iB ) );
+	return b2Solve22W( k11, k12, k12, k22, b );
+}
+
+static void b2PrepareRevoluteJointW( b2JointConstraintWide* c, int lane, b2JointSim* base, b2StepContext* context )
+{
+	b2RevoluteJoint* joint = &base->revoluteJoint;
+	b2RevoluteJointW* w = &c->revoluteJoint;
+
+	c->indexA[lane] = joint->indexA + 1;
+	c->indexB[lane] = joint->indexB + 1;
+
+	( (float*)&w->anchorA.X )[lane] = joint->frameA.p.x;
+	( (float*)&w->anchorA.Y )[lane] = joint->frameA.p.y;
+	( (float*)&w->anchorB.X )[lane] = joint->frameB.p.x;
+	( (float*)&w->anchorB.Y )[lane] = joint->frameB.p.y;
+	( (float*)&w->frameA.C )[lane] = joint->frameA.q.c;
+	( (float*)&w->frameA.S )[lane] = joint->frameA.q.s;
+	( (float*)&w->frameB.C )[lane] = joint->frameB.q.c;
+	( (float*)&w->frameB.S )[lane] = joint->frameB.q.s;
+	( (float*)&w->deltaCenter.X )[lane] = joint->deltaCenter.x;
+	( (float*)&w->deltaCenter.Y )[lane] = joint->deltaCenter.y;
+	( (float*)&w->axialMass )[lane] = joint->axialMass;
+	( (float*)&w->motorSpeed )[lane] = joint->motorSpeed;
+	( (float*)&w->maxMotorImpulse )[lane] = context->h * joint->maxMotorTorque;
+	( (float*)&w->lowerAngle )[lane] = joint->lowerAngle;
+	( (float*)&w->upperAngle )[lane] = joint->upperAngle;
+
+	bool fixedRotation = ( base->invIA + base->invIB == 0.0f );
+	( (float*)&w->enableMotor )[lane] = joint->enableMotor && fixedRotation == false ? 1.0f : 0.0f;
+	( (float*)&w->enableLimit )[lane] = joint->enableLimit && fixedRotation == false ? 1.0f : 0.0f;
+
+	( (float*)&w->linearImpulse.X )[lane] = joint->linearImpulse.x;
+	( (float*)&w->linearImpulse.Y )[lane] = joint->linearImpulse.y;
+	( (float*)&w->springImpulse )[lane] = joint->springImpulse;
+	( (float*)&w->motorImpulse )[lane] = joint->motorImpulse;
+	( (float*)&w->lowerImpulse )[lane] = joint->lowerImpulse;
+	( (float*)&w->upperImpulse )[lane] = joint->upperImpulse;
+}
+
+static void b2PrepareWeldJointW( b2JointConstraintWide* c, int lane, b2JointSim* base )
+{
+	b2WeldJoint* joint = &base->weldJoint;
+	b2WeldJointW* w = &c->weldJoint;
+
+	c->indexA[lane] = joint->indexA + 1;
+	c->indexB[lane] = joint->indexB + 1;
+
+	( (float*)&w->anchorA.X )[lane] = joint->frameA.p.x;
+	( (float*)&w->anchorA.Y )[lane] = joint->frameA.p.y;
+	( (float*)&w->anchorB.X )[lane] = joint->frameB.p.x;
+	( (float*)&w->anchorB.Y )[lane] = joint->frameB.p.y;
+	( (float*)&w->frameA.C )[lane] = joint->frameA.q.c;
+	( (float*)&w->frameA.S )[lane] = joint->frameA.q.s;
+	( (float*)&w->frameB.C )[lane] = joint->frameB.q.c;
+	( (float*)&w->frameB.S )[lane] = joint->frameB.q.s;
+	( (float*)&w->deltaCenter.X )[lane] = joint->deltaCenter.x;
+	( (float*)&w->deltaCenter.Y )[lane] = joint->deltaCenter.y;
+	( (float*)&w->axialMass )[lane] = joint->axialMass;
+	( (float*)&w->linearBiasRate )[lane] = joint->linearSpring.biasRate;
+	( (float*)&w->linearMassScale )[lane] = joint->linearSpring.massScale;
+	( (float*)&w->linearImpulseScale )[lane] = joint->linearSpring.impulseScale;
+	( (float*)&w->angularBiasRate )[lane] = joint->angularSpring.biasRate;
+	( (float*)&w->angularMassScale )[lane] = joint->angularSpring.massScale;
+	( (float*)&w->angularImpulseScale )[lane] = joint->angularSpring.impulseScale;
+	( (float*)&w->linearSpring )[lane] = joint->linearHertz > 0.0f ? 1.0f : 0.0f;
+	( (float*)&w->angularSpring )[lane] = joint->angularHertz > 0.0f ? 1.0f : 0.0f;
+	( (float*)&w->linearImpulse.X )[lane] = joint->linearImpulse.x;
+	( (float*)&w->linearImpulse.Y )[lane] = joint->linearImpulse.y;
+	( (float*)&w->angularImpulse )[lane] = joint->angularImpulse;
+}
+
+static void b2PreparePrismaticJointW( b2JointConstraintWide* c, int lane, b2JointSim* base, b2StepContext* context )
+{
+	b2PrismaticJoint* joint = &base->prismaticJoint;
+	b2PrismaticJointW* w = &c->prismaticJoint;
+
+	c->indexA[lane] = joint->indexA + 1;
+	c->indexB[lane] = joint->indexB + 1;
+
+	b2Vec2 axisA = b2RotateVector( joint->frameA.q, (b2Vec2){ 1.0f, 0.0f } );
+
+	( (float*)&w->anchorA.X )[lane] = joint->frameA.p.x;
+	( (float*)&w->anchorA.Y )[lane] = joint->frameA.p.y;
+	( (float*)&w->anchorB.X )[lane] = joint->frameB.p.x;
+	( (float*)&w->anchorB.Y )[lane] = joint->frameB.p.y;
+	( (float*)&w->frameA.C )[lane] = joint->frameA.q.c;
+	( (float*)&w->frameA.S )[lane] = joint->frameA.q.s;
+	( (float*)&w->frameB.C )[lane] = joint->frameB.q.c;
+	( (float*)&w->frameB.S )[lane] = joint->frameB.q.s;
+	( (float*)&w->axisA.X )[lane] = axisA.x;
+	( (float*)&w->axisA.Y )[lane] = axisA.y;
+	( (float*)&w->deltaCenter.X )[lane] = joint->deltaCenter.x;
+	( (float*)&w->deltaCenter.Y )[lane] = joint->deltaCenter.y;
+	( (float*)&w->springBiasRate )[lane] = joint->springSoftness.biasRate;
+	( (float*)&w->springMassScale )[lane] = joint->springSoftness.massScale;
+	( (float*)&w->springImpulseScale )[lane] = joint->springSoftness.impulseScale;
+	( (float*)&w->targetTranslation )[lane] = joint->targetTranslation;
+	( (float*)&w->motorSpeed )[lane] = joint->motorSpeed;
+	( (float*)&w->maxMotorImpulse )[lane] = context->h * joint->maxMotorForce;
+	( (float*)&w->lowerTranslation )[lane] = joint->lowerTranslation;
+	( (float*)&w->upperTranslation )[lane] = joint->upperTranslation;
+	( (float*)&w->speculativeDistance )[lane] = 0.25f * ( joint->upperTranslation - joint->lowerTranslation );
+	( (float*)&w->enableSpring )[lane] = joint->enableSpring ? 1.0f : 0.0f;
+	( (float*)&w->enableMotor )[lane] = joint->enableMotor ? 1.0f : 0.0f;
+	( (float*)&w->enableLimit )[lane] = joint->enableLimit ? 1.0f : 0.0f;
+	( (float*)&w->impulse.X )[lane] = joint->impulse.x;
+	( (float*)&w->impulse.Y )[lane] = joint->impulse.y;
+	( (float*)&w->springImpulse )[lane] = joint->springImpulse;
+	( (float*)&w->motorImpulse )[lane] = joint->motorImpulse;
+	( (float*)&w->lowerImpulse )[lane] = joint->lowerImpulse;
+	( (float*)&w->upperImpulse )[lane] = joint->upperImpulse;
+}
+
+// Runs as a flat parallel-for over the wide joint constraints of all colors. The scalar
+// prepare functions compute the joint frames, then the results are copied into the lanes.
+void b2PrepareWideJointsTask( b2SolverBlock block, b2StepContext* context )
+{
+	b2TracyCZoneNC( prepare_joints, "PrepJoints", b2_colorOldLace, true );
+
+	b2JointConstraintWide* constraints = context->wideJointConstraints;
+
+	B2_ASSERT( 0 <= block.startIndex && block.startIndex + block.count <= context->wideJointCount );
+
+	for ( int i = block.startIndex; i < block.startIndex + block.count; ++i )
+	{
+		b2JointConstraintWide* c = constraints + i;
+
+		for ( int lane = 0; lane < B2_SIMD_WIDTH; ++lane )
+		{
+			b2JointSim* base = c->joints[lane];
+			if ( base == NULL )
+			{
+				// Remainder lanes were zeroed in solver setup.
+				break;
+			}
+
+			B2_ASSERT( base->type == c->type );
+			b2PrepareJoint( base, context );
+
+			( (float*)&c->invMassA )[lane] = base->invMassA;
+			( (float*)&c->invMassB )[lane] = base->invMassB;
+			( (float*)&c->invIA )[lane] = base->invIA;
+			( (float*)&c->invIB )[lane] = base->invIB;
+			( (float*)&c->biasRate )[lane] = base->constraintSoftness.biasRate;
+			( (float*)&c->massScale )[lane] = base->constraintSoftness.massScale;
+			( (float*)&c->impulseScale )[lane] = base->constraintSoftness.impulseScale;
+
+			switch ( c->type )
+			{
+				case b2_revoluteJoint:
+					b2PrepareRevoluteJointW( c, lane, base, context );
+					break;
+
+				case b2_weldJoint:
+					b2PrepareWeldJointW( c, lane, base );
+					break;
+
+				case b2_prismaticJoint:
+					b2PreparePrismaticJointW( c, lane, base, context );
+					break;
+
+				default:
+					B2_ASSERT( false );
+			}
+		}
+	}
+
+	b2TracyCZoneEnd( prepare_joints );
+}
+
+static void b2WarmStartRevoluteJointW( const b2JointConstraintWide* c, b2BodyStateW* bA, b2BodyStateW* bB )
+{
+	const b2RevoluteJointW* joint = &c->revoluteJoint;
+
+	b2Vec2W rA = b2RotateVectorW( bA->dq, joint->anchorA );
+	b2Vec2W rB = b2RotateVectorW( bB->dq, joint->anchorB );
+
+	b2FloatW axialImpulse =
+		b2SubW( b2AddW( b2AddW( joint->springImpulse, joint->motorImpulse ), joint->lowerImpulse ), joint->upperImpulse );
+
+	bA->v = b2MulSubVW( bA->v, c->invMassA, joint->linearImpulse );
+	bA->w = b2SubW( bA->w, b2MulW( c->invIA, b2AddW( b2CrossW( rA, joint->linearImpulse ), axialImpulse ) ) );
+	bB->v = b2MulAddVW( bB->v, c->invMassB, joint->linearImpulse );
+	bB->w = b2AddW( bB->w, b2MulW( c->invIB, b2AddW( b2CrossW( rB, joint->linearImpulse ), axialImpulse ) ) );
+}
+
+static void b2WarmStartWeldJointW( const b2JointConstraintWide* c, b2BodyStateW* bA, b2BodyStateW* bB )
+{
+	const b2WeldJointW* joint = &c->weldJoint;
+
+	b2Vec2W rA = b2RotateVectorW( bA->dq, joint->anchorA );
+	b2Vec2W rB = b2RotateVectorW( bB->dq, joint->anchorB );
+
+	bA->v = b2MulSubVW( bA->v, c->invMassA, joint->linearImpulse );
+	bA->w = b2SubW( bA->w, b2MulW( c->invIA, b2AddW( b2CrossW( rA, joint->linearImpulse ), joint->angularImpulse ) ) );
+	bB->v = b2MulAddVW( bB->v, c->invMassB, joint->linearImpulse );
+	bB->w = b2AddW( bB->w, b2MulW( c->invIB, b2AddW( b2CrossW( rB, joint->linearImpulse ), joint->angularImpulse ) ) );
+}
+
+static void b2WarmStartPrismaticJointW( const b2JointConstraintWide* c, b2BodyStateW* bA, b2BodyStateW* bB )
+{
+	const b2PrismaticJointW* joint = &c->prismaticJoint;
+
+	b2Vec2W rA = b2RotateVectorW( bA->dq, joint->anchorA );
+	b2Vec2W rB = b2RotateVectorW( bB->dq, joint->anchorB );
+
+	b2Vec2W d = b2AddVW( b2AddVW( b2SubVW( bB->dp, bA->dp ), joint->deltaCenter ), b2SubVW( rB, rA ) );
+	b2Vec2W axisA = b2RotateVectorW( bA->dq, joint->axisA );
+
+	// impulse is applied at anchor point on body B
+	b2Vec2W rAd = b2AddVW( rA, d );
+	b2FloatW a1 = b2CrossW( rAd, axisA );
+	b2FloatW a2 = b2CrossW( rB, axisA );
+	b2FloatW axialImpulse =
+		b2SubW( b2AddW( b2AddW( joint->springImpulse, joint->motorImpulse ), joint->lowerImpulse ), joint->upperImpulse );
+
+	// perpendicular constraint
+	b2Vec2W perpA = { b2NegW( axisA.Y ), axisA.X };
+	b2FloatW s1 = b2CrossW( rAd, perpA );
+	b2FloatW s2 = b2CrossW( rB, perpA );
+	b2FloatW perpImpulse = joint->impulse.X;
+	b2FloatW angleImpulse = joint->impulse.Y;
+
+	b2Vec2W P = b2AddVW( b2MulSVW( axialImpulse, axisA ), b2MulSVW( perpImpulse, perpA ) );
+	b2FloatW LA = b2AddW( b2AddW( b2MulW( axialImpulse, a1 ), b2MulW( perpImpulse, s1 ) ), angleImpulse );
+	b2FloatW LB = b2AddW( b2AddW( b2MulW( axialImpulse, a2 ), b2MulW( perpImpulse, s2 ) ), angleImpulse );
+
+	bA->v = b2MulSubVW( bA->v, c->invMassA, P );
+	bA->w = b2SubW( bA->w, b2MulW( c->invIA, LA ) );
+	bB->v = b2MulAddVW( bB->v, c->invMassB, P );
+	bB->w = b2AddW( bB->w, b2MulW( c->invIB, LB ) );
+}
+
+void b2WarmStartWideJointsTask( b2SolverBlock block, b2StepContext* context )
+{
+	b2TracyCZoneNC( warm_joints, "WarmJoints", b2_colorGold, true );
+
+	b2GraphColor* color = context->graph->colors + block.colorIndex;
+	b2JointConstraintWide* constraints = color->wideJoints;
+	b2BodyState* states = context->states;
+
+	B2_ASSERT( 0 <= block.startIndex && block.startIndex + block.count <= color->wideJointCount );
+
+	for ( int i = block.startIndex; i < block.startIndex + block.count; ++i )
+	{
+		b2JointConstraintWide* c = constraints + i;
+		b2BodyStateW bA = b2GatherBodies( states, c->indexA );
+		b2BodyStateW bB = b2GatherBodies( states, c->indexB );
+
+		switch ( c->type )
+		{
+			case b2_revoluteJoint:
+				b2WarmStartRevoluteJointW( c, &bA, &bB );
+				break;
+
+			case b2_weldJoint:
+				b2WarmStartWeldJointW( c, &bA, &bB );
+				break;
+
+			case b2_prismaticJoint:
+				b2WarmStartPrismaticJointW( c, &bA, &bB );
+				break;
+
+			default:
+				B2_ASSERT( false );
+		}
+
+		b2ScatterBodies( states, c->indexA, &bA );
+		b2ScatterBodies( states, c->indexB, &bB );
+	}
+
+	b2TracyCZoneEnd( warm_joints );
+}
+
+static void b2SolveRevoluteJointW( b2JointConstraintWide* c, b2BodyStateW* bA, b2BodyStateW* bB, b2FloatW invH, bool useBias )
+{
+	b2RevoluteJointW* joint = &c->revoluteJoint;
+
+	b2FloatW mA = c->invMassA;
+	b2FloatW mB = c->invMassB;
+	b2FloatW iA = c->invIA;
+	b2FloatW iB = c->invIB;
+	b2FloatW zero = b2ZeroW();
+	b2FloatW one = b2SplatW( 1.0f );
+
+	b2Vec2W vA = bA->v;
+	b2FloatW wA = bA->w;
+	b2Vec2W vB = bB->v;
+	b2FloatW wB = bB->w;
+
+	b2RotW qA = b2MulRotW( bA->dq, joint->frameA );
+	b2RotW qB = b2MulRotW( bB->dq, joint->frameB );
+	b2RotW relQ = b2InvMulRotW( qA, qB );
+
+	// Solve motor constraint.
+	b2FloatW motorMask = b2GreaterThanW( joint->enableMotor, zero );
+	if ( b2AllZeroW( motorMask ) == false )
+	{
+		b2FloatW Cdot = b2SubW( b2SubW( wB, wA ), joint->motorSpeed );
+		b2FloatW impulse = b2MulW( b2NegW( joint->axialMass ), Cdot );
+		b2FloatW oldImpulse = joint->motorImpulse;
+		b2FloatW maxImpulse = joint->maxMotorImpulse;
+		b2FloatW newImpulse = b2ClampW( b2AddW( oldImpulse, impulse ), b2NegW( maxImpulse ), maxImpulse );
+		impulse = b2SubW( newImpulse, oldImpulse );
+
+		joint->motorImpulse = b2BlendW( oldImpulse, newImpulse, motorMask );
+		wA = b2BlendW( wA, b2SubW( wA, b2MulW( iA, impulse ) ), motorMask );
+		wB = b2BlendW( wB, b2AddW( wB, b2MulW( iB, impulse ) ), motorMask );
+	}
+
+	b2FloatW limitMask = b2GreaterThanW( joint->enableLimit, zero );
+	if ( b2AllZeroW( limitMask ) == false )
+	{
+		b2FloatW jointAngle = b2Atan2W( relQ.S, relQ.C );
+
+		// Lower limit
+		{
+			b2FloatW C = b2SubW( jointAngle, joint->lowerAngle );
+			b2FloatW speculative = b2GreaterThanW( C, zero );
+			b2FloatW bias = b2BlendW( zero, b2MulW( C, invH ), speculative );
+			b2FloatW massScale = one;
+			b2FloatW impulseScale = zero;
+			if ( useBias )
+			{
+				bias = b2BlendW( b2MulW( c->biasRate, C ), bias, speculative );
+				massScale = b2BlendW( c->massScale, one, speculative );
+				impulseScale = b2BlendW( c->impulseScale, zero, speculative );
+			}
+
+			b2FloatW Cdot = b2SubW( wB, wA );
+			b2FloatW oldImpulse = joint->lowerImpulse;
+			b2FloatW impulse = b2SubW( b2MulW( b2MulW( b2NegW( massScale ), joint->axialMass ), b2AddW( Cdot, bias ) ),
+									   b2MulW( impulseScale, oldImpulse ) );
+			b2FloatW newImpulse = b2MaxW( b2AddW( oldImpulse, impulse ), zero );
+			impulse = b2SubW( newImpulse, oldImpulse );
+
+			joint->lowerImpulse = b2BlendW( oldImpulse, newImpulse, limitMask );
+			wA = b2BlendW( wA, b2SubW( wA, b2MulW( iA, impulse ) ), limitMask );
+			wB = b2BlendW( wB, b2AddW( wB, b2MulW( iB, impulse ) ), limitMask );
+		}
+
+		// Upper limit
+		// Note: signs are flipped to keep C positive when the constraint is satisfied.
+		// This also keeps the impulse positive when the limit is active.
+		{
+			b2FloatW C = b2SubW( joint->upperAngle, jointAngle );
+			b2FloatW speculative = b2GreaterThanW( C, zero );
+			b2FloatW bias = b2BlendW( zero, b2MulW( C, invH ), speculative );
+			b2FloatW massScale = one;
+			b2FloatW impulseScale = zero;
+			if ( useBias )
+			{
+				bias = b2BlendW( b2MulW( c->biasRate, C ), bias, speculative );
+				massScale = b2BlendW( c->massScale, one, speculative );
+				impulseScale = b2BlendW( c->impulseScale, zero, speculative );
+			}
+
+			// sign flipped on Cdot
+			b2FloatW Cdot = b2SubW( wA, wB );
+			b2FloatW oldImpulse = joint->upperImpulse;
+			b2FloatW impulse = b2SubW( b2MulW( b2MulW( b2NegW( massScale ), joint->axialMass ), b2AddW( Cdot, bias ) ),
+									   b2MulW( impulseScale, oldImpulse ) );
+			b2FloatW newImpulse = b2MaxW( b2AddW( oldImpulse, impulse ), zero );
+			impulse = b2SubW( newImpulse, oldImpulse );
+
+			// sign flipped on applied impulse
+			joint->upperImpulse = b2BlendW( oldImpulse, newImpulse, limitMask );
+			wA = b2BlendW( wA, b2AddW( wA, b2MulW( iA, impulse ) ), limitMask );
+			wB = b2BlendW( wB, b2SubW( wB, b2MulW( iB, impulse ) ), limitMask );
+		}
+	}
+
+	// Solve point-to-point constraint
+	{
+		// current anchors
+		b2Vec2W rA = b2RotateVectorW( bA->dq, joint->anchorA );
+		b2Vec2W rB = b2RotateVectorW( bB->dq, joint->anchorB );
+
+		b2Vec2W Cdot = b2SubVW( b2AddVW( vB, b2CrossSVW( wB, rB ) ), b2AddVW( vA, b2CrossSVW( wA, rA ) ) );
+
+		b2Vec2W bias = { zero, zero };
+		b2FloatW massScale = one;
+		b2FloatW impulseScale = zero;
+		if ( useBias )
+		{
+			b2Vec2W separation = b2AddVW( b2AddVW( b2SubVW( bB->dp, bA->dp ), b2SubVW( rB, rA ) ), joint->deltaCenter );
+			bias = b2MulSVW( c->biasRate, separation );
+			massScale = c->massScale;
+			impulseScale = c->impulseScale;
+		}
+
+		b2Vec2W b = b2SolvePointW( mA, mB, iA, iB, rA, rB, b2AddVW( Cdot, bias ) );
+
+		b2FloatW negMassScale = b2NegW( massScale );
+		b2Vec2W impulse = {
+			b2SubW( b2MulW( negMassScale, b.X ), b2MulW( impulseScale, joint->linearImpulse.X ) ),
+			b2SubW( b2MulW( negMassScale, b.Y ), b2MulW( impulseScale, joint->linearImpulse.Y ) ),
+		};
+		joint->linearImpulse = b2AddVW( joint->linearImpulse, impulse );
+
+		vA = b2MulSubVW( vA, mA, impulse );
+		wA = b2SubW( wA, b2MulW( iA, b2CrossW( rA, impulse ) ) );
+		vB = b2MulAddVW( vB, mB, impulse );
+		wB = b2AddW( wB, b2MulW( iB, b2CrossW( rB, impulse ) ) );
+	}
+
+	bA->v = vA;
+	bA->w = wA;
+	bB->v = vB;
+	bB->w = wB;
+}
+
+static void b2SolveWeldJointW( b2JointConstraintWide* c, b2BodyStateW* bA, b2BodyStateW* bB, bool useBias )
+{
+	b2WeldJointW* joint = &c->weldJoint;
+
+	b2FloatW mA = c->invMassA;
+	b2FloatW mB = c->invMassB;
+	b2FloatW iA = c->invIA;
+	b2FloatW iB = c->invIB;
+	b2FloatW zero = b2ZeroW();
+	b2FloatW one = b2SplatW( 1.0f );
+
+	b2Vec2W vA = bA->v;
+	b2FloatW wA = bA->w;
+	b2Vec2W vB = bB->v;
+	b2FloatW wB = bB->w;
+
+	// angular constraint
+	{
+		b2RotW qA = b2MulRotW( bA->dq, joint->frameA );
+		b2RotW qB = b2MulRotW( bB->dq, joint->frameB );
+		b2RotW relQ = b2InvMulRotW( qA, qB );
+		b2FloatW jointAngle = b2Atan2W( relQ.S, relQ.C );
+
+		b2FloatW bias = b2MulW( joint->angularBiasRate, jointAngle );
+		b2FloatW massScale = joint->angularMassScale;
+		b2FloatW impulseScale = joint->angularImpulseScale;
+		if ( useBias == false )
+		{
+			b2FloatW springMask = b2GreaterThanW( joint->angularSpring, zero );
+			bias = b2BlendW( zero, bias, springMask );
+			massScale = b2BlendW( one, massScale, springMask );
+			impulseScale = b2BlendW( zero, impulseScale, springMask );
+		}
+
+		b2FloatW Cdot = b2SubW( wB, wA );
+		b2FloatW impulse = b2SubW( b2MulW( b2MulW( b2NegW( massScale ), joint->axialMass ), b2AddW( Cdot, bias ) ),
+								   b2MulW( impulseScale, joint->angularImpulse ) );
+		joint->angularImpulse = b2AddW( joint->angularImpulse, impulse );
+
+		wA = b2SubW( wA, b2MulW( iA, impulse ) );
+		wB = b2AddW( wB, b2MulW( iB, impulse ) );
+	}
+
+	// linear constraint
+	{
+		b2Vec2W rA = b2RotateVectorW( bA->dq, joint->anchorA );
+		b2Vec2W rB = b2RotateVectorW( bB->dq, joint->anchorB );
+
+		b2Vec2W C = b2AddVW( b2AddVW( b2SubVW( bB->dp, bA->dp ), b2SubVW( rB, rA ) ), joint->deltaCenter );
+		b2Vec2W bias = b2MulSVW( joint->linearBiasRate, C );
+		b2FloatW massScale = joint->linearMassScale;
+		b2FloatW impulseScale = joint->linearImpulseScale;
+		if ( useBias == false )
+		{
+			b2FloatW springMask = b2GreaterThanW( joint->linearSpring, zero );
+			bias = b2BlendVW( (b2Vec2W){ zero, zero }, bias, springMask );
+			massScale = b2BlendW( one, massScale, springMask );
+			impulseScale = b2BlendW( zero, impulseScale, springMask );
+		}
+
+		b2Vec2W Cdot = b2SubVW( b2AddVW( vB, b2CrossSVW( wB, rB ) ), b2AddVW( vA, b2CrossSVW( wA, rA ) ) );
+
+		b2Vec2W b = b2SolvePointW( mA, mB, iA, iB, rA, rB, b2AddVW( Cdot, bias ) );
+
+		b2FloatW negMassScale = b2NegW( massScale );
+		b2Vec2W impulse = {
+			b2SubW( b2MulW( negMassScale, b.X ), b2MulW( impulseScale, joint->linearImpulse.X ) ),
+			b2SubW( b2MulW( negMassScale, b.Y ), b2MulW( impulseScale, joint->linearImpulse.Y ) ),
+		};
+
+		joint->linearImpulse = b2AddVW( joint->linearImpulse, impulse );
+
+		vA = b2MulSubVW( vA, mA, impulse );
+		wA = b2SubW( wA, b2MulW( iA, b2CrossW( rA, impulse ) ) );
+		vB = b2MulAddVW( vB, mB, impulse );
+		wB = b2AddW( wB, b2MulW( iB, b2CrossW( rB, impulse ) ) );
+	}
+
+	bA->v = vA;
+	bA->w = wA;
+	bB->v = vB;
+	bB->w = wB;
+}
+
+static void b2SolvePrismaticJointW( b2JointConstraintWide* c, b2BodyStateW* bA, b2BodyStateW* bB, b2FloatW invH,
+									b2FloatW safeDistance, bool useBias )
+{
+	b2PrismaticJointW* joint = &c->prismaticJoint;
+
+	b2FloatW mA = c->invMassA;
+	b2FloatW mB = c->invMassB;
+	b2FloatW iA = c->invIA;
+	b2FloatW iB = c->invIB;
+	b2FloatW zero = b2ZeroW();
+	b2FloatW one = b2SplatW( 1.0f );
+
+	b2Vec2W vA = bA->v;
+	b2FloatW wA = bA->w;
+	b2Vec2W vB = bB->v;
+	b2FloatW wB = bB->w;
+
+	// current anchors
+	b2Vec2W rA = b2RotateVectorW( bA->dq, joint->anchorA );
+	b2Vec2W rB = b2RotateVectorW( bB->dq, joint->anchorB );
+
+	b2Vec2W d = b2AddVW( b2AddVW( b2SubVW( bB->dp, bA->dp ), joint->deltaCenter ), b2SubVW( rB, rA ) );
+	b2Vec2W axisA = b2RotateVectorW( bA->dq, joint->axisA );
+	b2FloatW translation = b2DotW( axisA, d );
+
+	// These scalars are for torques generated by axial forces
+	b2FloatW a1 = b2CrossW( b2AddVW( rA, d ), axisA );
+	b2FloatW a2 = b2CrossW( rB, axisA );
+
+	b2FloatW k = b2AddW( b2AddW( b2AddW( mA, mB ), b2MulW( b2MulW( iA, a1 ), a1 ) ), b2MulW( b2MulW( iB, a2 ), a2 ) );
+	b2FloatW axialMass = b2BlendW( zero, b2DivW( one, k ), b2GreaterThanW( k, zero ) );
+
+	// spring constraint
+	b2FloatW springMask = b2GreaterThanW( joint->enableSpring, zero );
+	if ( b2AllZeroW( springMask ) == false )
+	{
+		// This is a real spring and should be applied even during relax
+		b2FloatW C = b2SubW( translation, joint->targetTranslation );
+		b2FloatW bias = b2MulW( joint->springBiasRate, C );
+		b2FloatW massScale = joint->springMassScale;
+		b2FloatW impulseScale = joint->springImpulseScale;
+
+		b2FloatW Cdot = b2SubW( b2AddW( b2DotW( axisA, b2SubVW( vB, vA ) ), b2MulW( a2, wB ) ), b2MulW( a1, wA ) );
+		b2FloatW deltaImpulse = b2SubW( b2MulW( b2MulW( b2NegW( massScale ), axialMass ), b2AddW( Cdot, bias ) ),
+										b2MulW( impulseScale, joint->springImpulse ) );
+		joint->springImpulse = b2BlendW( joint->springImpulse, b2AddW( joint->springImpulse, deltaImpulse ), springMask );
+
+		b2Vec2W P = b2MulSVW( deltaImpulse, axisA );
+		b2FloatW LA = b2MulW( deltaImpulse, a1 );
+		b2FloatW LB = b2MulW( deltaImpulse, a2 );
+
+		vA = b2BlendVW( vA, b2MulSubVW( vA, mA, P ), springMask );
+		wA = b2BlendW( wA, b2SubW( wA, b2MulW( iA, LA ) ), springMask );
+		vB = b2BlendVW( vB, b2MulAddVW( vB, mB, P ), springMask );
+		wB = b2BlendW( wB, b2AddW( wB, b2MulW( iB, LB ) ), springMask );
+	}
+
+	// Solve motor constraint
+	b2FloatW motorMask = b2GreaterThanW( joint->enableMotor, zero );
+	if ( b2AllZeroW( motorMask ) == false )
+	{
+		b2FloatW Cdot = b2SubW( b2AddW( b2DotW( axisA, b2SubVW( vB, vA ) ), b2MulW( a2, wB ) ), b2MulW( a1, wA ) );
+		b2FloatW impulse = b2MulW( axialMass, b2SubW( joint->motorSpeed, Cdot ) );
+		b2FloatW oldImpulse = joint->motorImpulse;
+		b2FloatW maxImpulse = joint->maxMotorImpulse;
+		b2FloatW newImpulse = b2ClampW( b2AddW( oldImpulse, impulse ), b2NegW( maxImpulse ), maxImpulse );
+		impulse = b2SubW( newImpulse, oldImpulse );
+		joint->motorImpulse = b2BlendW( oldImpulse, newImpulse, motorMask );
+
+		b2Vec2W P = b2MulSVW( impulse, axisA );
+		b2FloatW LA = b2MulW( impulse, a1 );
+		b2FloatW LB = b2MulW( impulse, a2 );
+
+		vA = b2BlendVW( vA, b2MulSubVW( vA, mA, P ), motorMask );
+		wA = b2BlendW( wA, b2SubW( wA, b2MulW( iA, LA ) ), motorMask );
+		vB = b2BlendVW( vB, b2MulAddVW( vB, mB, P ), motorMask );
+		wB = b2BlendW( wB, b2AddW( wB, b2MulW( iB, LB ) ), motorMask );
+	}
+
+	b2FloatW limitMask = b2GreaterThanW( joint->enableLimit, zero );
+	if ( b2AllZeroW( limitMask ) == false )
+	{
+		// Lower limit
+		{
+			b2FloatW C = b2SubW( translation, joint->lowerTranslation );
+
+			// inactive lanes have the impulse reset to zero
+			b2FloatW active = b2GreaterThanW( joint->speculativeDistance, C );
+			b2FloatW speculative = b2GreaterThanW( C, zero );
+			b2FloatW bias = b2BlendW( zero, b2MulW( b2MinW( C, safeDistance ), invH ), speculative );
+			b2FloatW massScale = one;
+			b2FloatW impulseScale = zero;
+			if ( useBias )
+			{
+				bias = b2BlendW( b2MulW( c->biasRate, C ), bias, speculative );
+				massScale = b2BlendW( c->massScale, one, speculative );
+				impulseScale = b2BlendW( c->impulseScale, zero, speculative );
+			}
+
+			b2FloatW oldImpulse = joint->lowerImpulse;
+			b2FloatW Cdot = b2SubW( b2AddW( b2DotW( axisA, b2SubVW( vB, vA ) ), b2MulW( a2, wB ) ), b2MulW( a1, wA ) );
+			b2FloatW deltaImpulse = b2SubW( b2MulW( b2MulW( b2NegW( axialMass ), massScale ), b2AddW( Cdot, bias ) ),
+											b2MulW( impulseScale, oldImpulse ) );
+			b2FloatW newImpulse = b2MaxW( b2AddW( oldImpulse, deltaImpulse ), zero );
+			deltaImpulse = b2SubW( newImpulse, oldImpulse );
+
+			joint->lowerImpulse = b2BlendW( oldImpulse, b2BlendW( zero, newImpulse, active ), limitMask );
+
+			b2Vec2W P = b2MulSVW( deltaImpulse, axisA );
+			b2FloatW LA = b2MulW( deltaImpulse, a1 );
+			b2FloatW LB = b2MulW( deltaImpulse, a2 );
+
+			vA = b2BlendVW( vA, b2BlendVW( vA, b2MulSubVW( vA, mA, P ), active ), limitMask );
+			wA = b2BlendW( wA, b2BlendW( wA, b2SubW( wA, b2MulW( iA, LA ) ), active ), limitMask );
+			vB = b2BlendVW( vB, b2BlendVW( vB, b2MulAddVW( vB, mB, P ), active ), limitMask );
+			wB = b2BlendW( wB, b2BlendW( wB, b2AddW( wB, b2MulW( iB, LB ) ), active ), limitMask );
+		}
+
+		// Upper limit
+		// Note: signs are flipped to keep C positive when the constraint is satisfied.
+		// This also keeps the impulse positive when the limit is active.
+		{
+			// sign flipped
+			b2FloatW C = b2SubW( joint->upperTranslation, translation );
+
+			b2FloatW active = b2GreaterThanW( joint->speculativeDistance, C );
+			b2FloatW speculative = b2GreaterThanW( C, zero );
+			b2FloatW bias = b2BlendW( zero, b2MulW( b2MinW( C, safeDistance ), invH ), speculative );
+			b2FloatW massScale = one;
+			b2FloatW impulseScale = zero;
+			if ( useBias )
+			{
+				bias = b2BlendW( b2MulW( c->biasRate, C ), bias, speculative );
+				massScale = b2BlendW( c->massScale, one, speculative );
+				impulseScale = b2BlendW( c->impulseScale, zero, speculative );
+			}
+
+			b2FloatW oldImpulse = joint->upperImpulse;
+
+			// sign flipped
+			b2FloatW Cdot = b2SubW( b2AddW( b2DotW( axisA, b2SubVW( vA, vB ) ), b2MulW( a1, wA ) ), b2MulW( a2, wB ) );
+			b2FloatW deltaImpulse = b2SubW( b2MulW( b2MulW( b2NegW( axialMass ), massScale ), b2AddW( Cdot, bias ) ),
+											b2MulW( impulseScale, oldImpulse ) );
+			b2FloatW newImpulse = b2MaxW( b2AddW( oldImpulse, deltaImpulse ), zero );
+			deltaImpulse = b2SubW( newImpulse, oldImpulse );
+
+			joint->upperImpulse = b2BlendW( oldImpulse, b2BlendW( zero, newImpulse, active ), limitMask );
+
+			b2Vec2W P = b2MulSVW( deltaImpulse, axisA );
+			b2FloatW LA = b2MulW( deltaImpulse, a1 );
+			b2FloatW LB = b2MulW( deltaImpulse, a2 );
+
+			// sign flipped
+			vA = b2BlendVW( vA, b2BlendVW( vA, b2MulAddVW( vA, mA, P ), active ), limitMask );
+			wA = b2BlendW( wA, b2BlendW( wA, b2AddW( wA, b2MulW( iA, LA ) ), active ), limitMask );
+			vB = b2BlendVW( vB, b2BlendVW( vB, b2MulSubVW( vB, mB, P ), active ), limitMask );
+			wB = b2BlendW( wB, b2BlendW( wB, b2SubW( wB, b2MulW( iB, LB ) ), active ), limitMask );
+		}
+	}
+
+	// Solve the prismatic constraint in block form
+	{
+		b2Vec2W perpA = { b2NegW( axisA.Y ), axisA.X };
+
+		// These scalars are for torques generated by the perpendicular constraint force
+		b2FloatW s1 = b2CrossW( b2AddVW( d, rA ), perpA );
+		b2FloatW s2 = b2CrossW( rB, perpA );
+
+		b2Vec2W Cdot;
+		Cdot.X = b2SubW( b2AddW( b2DotW( perpA, b2SubVW( vB, vA ) ), b2MulW( s2, wB ) ), b2MulW( s1, wA ) );
+		Cdot.Y = b2SubW( wB, wA );
+
+		b2Vec2W bias = { zero, zero };
+		b2FloatW massScale = one;
+		b2FloatW impulseScale = zero;
+		if ( useBias )
+		{
+			b2RotW qA = b2MulRotW( bA->dq, joint->frameA );
+			b2RotW qB = b2MulRotW( bB->dq, joint->frameB );
+			b2RotW relQ = b2InvMulRotW( qA, qB );
+
+			b2Vec2W C;
+			C.X = b2DotW( perpA, d );
+			C.Y = b2Atan2W( relQ.S, relQ.C );
+
+			bias = b2MulSVW( c->biasRate, C );
+			massScale = c->massScale;
+			impulseScale = c->impulseScale;
+		}
+
+		b2FloatW k11 = b2AddW( b2AddW( b2AddW( mA, mB ), b2MulW( b2MulW( iA, s1 ), s1 ) ), b2MulW( b2MulW( iB, s2 ), s2 ) );
+		b2FloatW k12 = b2AddW( b2MulW( iA, s1 ), b2MulW( iB, s2 ) );
+		b2FloatW k22 = b2AddW( iA, iB );
+
+		// For bodies with fixed rotation.
+		k22 = b2BlendW( k22, one, b2EqualsW( k22, zero ) );
+
+		b2Vec2W b = b2Solve22W( k11, k12, k12, k22, b2AddVW( Cdot, bias ) );
+
+		b2FloatW negMassScale = b2NegW( massScale );
+		b2Vec2W deltaImpulse = {
+			b2SubW( b2MulW( negMassScale, b.X ), b2MulW( impulseScale, joint->impulse.X ) ),
+			b2SubW( b2MulW( negMassScale, b.Y ), b2MulW( impulseScale, joint->impulse.Y ) ),
+		};
+
+		joint->impulse = b2AddVW( joint->impulse, deltaImpulse );
+
+		b2Vec2W P = b2MulSVW( deltaImpulse.X, perpA );
+		b2FloatW LA = b2AddW( b2MulW( deltaImpulse.X, s1 ), deltaImpulse.Y );
+		b2FloatW LB = b2AddW( b2MulW( deltaImpulse.X, s2 ), deltaImpulse.Y );
+
+		vA = b2MulSubVW( vA, mA, P );
+		wA = b2SubW( wA, b2MulW( iA, LA ) );
+		vB = b2MulAddVW( vB, mB, P );
+		wB = b2AddW( wB, b2MulW( iB, LB ) );
+	}
+
+	bA->v = vA;
+	bA->w = wA;
+	bB->v = vB;
+	bB->w = wB;
+}
+
+void b2SolveWideJointsTask( b2SolverBlock block, b2StepContext* context, bool useBias )
+{
+	b2TracyCZoneNC( solve_joints, "SolveJoints", b2_colorLemonChiffon, true );
+
+	b2GraphColor* color = context->graph->colors + block.colorIndex;
+	b2JointConstraintWide* constraints = color->wideJoints;
+	b2BodyState* states = context->states;
+	b2FloatW invH = b2SplatW( context->inv_h );
+	b2FloatW safeDistance = b2SplatW( b2GetLengthUnitsPerMeter() );
+
+	B2_ASSERT( 0 <= block.startIndex && block.startIndex + block.count <= color->wideJointCount );
+
+	for ( int i = block.startIndex; i < block.startIndex + block.count; ++i )
+	{
+		b2JointConstraintWide* c = constraints + i;
+		b2BodyStateW bA = b2GatherBodies( states, c->indexA );
+		b2BodyStateW bB = b2GatherBodies( states, c->indexB );
+
+		switch ( c->type )
+		{
+			case b2_revoluteJoint:
+				b2SolveRevoluteJointW( c, &bA, &bB, invH, useBias );
+				break;
+
+			case b2_weldJoint:
+				b2SolveWeldJointW( c, &bA, &bB, useBias );
+				break;
+
+			case b2_prismaticJoint:
+				b2SolvePrismaticJointW( c, &bA, &bB, invH, safeDistance, useBias );
+				break;
+
+			default:
+				B2_ASSERT( false );
+		}
+
+		b2ScatterBodies( states, c->indexA, &bA );
+		b2ScatterBodies( states, c->indexB, &bB );
+	}
+
+	b2TracyCZoneEnd( solve_joints );
+}
+
+// Runs as a flat parallel-for over the wide joint constraints of all colors.
+void b2StoreWideJointsTask( b2SolverBlock block, b2StepContext* context )
+{
+	b2TracyCZoneNC( store_joints, "Store Joints", b2_colorFireBrick, true );
+
+	const b2JointConstraintWide* constraints = context->wideJointConstraints;
+
+	B2_ASSERT( 0 <= block.startIndex && block.startIndex + block.count <= context->wideJointCount );
+
+	for ( int i = block.startIndex; i < block.startIndex + block.count; ++i )
+	{
+		const b2JointConstraintWide* c = constraints + i;
+
+		for ( int lane = 0; lane < B2_SIMD_WIDTH; ++lane )
+		{
+			b2JointSim* base = c->joints[lane];
+			if ( base == NULL )
+			{
+				break;
+			}
+
+			switch ( c->type )
+			{
+				case b2_revoluteJoint:
+				{
+					const b2RevoluteJointW* w = &c->revoluteJoint;
+					b2RevoluteJoint* joint = &base->revoluteJoint;
+					joint->linearImpulse.x = ( (const float*)&w->linearImpulse.X )[lane];
+					joint->linearImpulse.y = ( (const float*)&w->linearImpulse.Y )[lane];
+					joint->motorImpulse = ( (const float*)&w->motorImpulse )[lane];
+					joint->lowerImpulse = ( (const float*)&w->lowerImpulse )[lane];
+					joint->upperImpulse = ( (const float*)&w->upperImpulse )[lane];
+				}
+				break;
+
+				case b2_weldJoint:
+				{
+					const b2WeldJointW* w = &c->weldJoint;
+					b2WeldJoint* joint = &base->weldJoint;
+					joint->linearImpulse.x = ( (const float*)&w->linearImpulse.X )[lane];
+					joint->linearImpulse.y = ( (const float*)&w->linearImpulse.Y )[lane];
+					joint->angularImpulse = ( (const float*)&w->angularImpulse )[lane];
+				}
+				break;
+
+				case b2_prismaticJoint:
+				{
+					const b2PrismaticJointW* w = &c->prismaticJoint;
+					b2PrismaticJoint* joint = &base->prismaticJoint;
+					joint->impulse.x = ( (const float*)&w->impulse.X )[lane];
+					joint->impulse.y = ( (const float*)&w->impulse.Y )[lane];
+					joint->springImpulse = ( (const float*)&w->springImpulse )[lane];
+					joint->motorImpulse = ( (const float*)&w->motorImpulse )[lane];
+					joint->lowerImpulse = ( (const float*)&w->lowerImpulse )[lane];
+					joint->upperImpulse = ( (const float*)&w->upperImpulse )[lane];
+				}
+				break;
+
+				default:
+					B2_ASSERT( false );
+			}
+		}
+	}
+
+	b2TracyCZoneEnd( store_joints );
+}
@@ -0,0 +1,29 @@
+// SPDX-FileCopyrightText: 2023 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "solver.h"
+
+typedef struct b2JointSim b2JointSim;
+
+// Revolute, weld, and prismatic joints in the graph coloring are batched into wide constraints,
+// one joint type per wide constraint. A wide constraint does not share a dynamic body across
+// lanes because all lanes come from the same graph color. The remaining joints are solved one
+// at a time by the scalar joint functions.
+
+// This function allows hiding SIMD intrinsics in the source file to improve compilation performance.
+int b2GetWideJointConstraintByteCount( void );
+
+// True if this joint can be solved in a wide constraint.
+// Joints that report force or torque events stay scalar because the events are checked per iteration.
+bool b2IsWideJoint( const b2JointSim* joint );
+
+// Assign a joint to a lane of a wide constraint during solver setup. A wide constraint
+// holds a single joint type and unused lanes must be zeroed beforehand.
+void b2SetWideJointLane( struct b2JointConstraintWide* constraints, int wideIndex, int lane, b2JointSim* joint );
+
+void b2PrepareWideJointsTask( b2SolverBlock block, b2StepContext* context );
+void b2WarmStartWideJointsTask( b2SolverBlock block, b2StepContext* context );
+void b2SolveWideJointsTask( b2SolverBlock block, b2StepContext* context, bool useBias );
+void b2StoreWideJointsTask( b2SolverBlock block, b2StepContext* context );
@@ -1,7 +1,10 @@
 // SPDX-FileCopyrightText: 2023 Erin Catto
 // SPDX-License-Identifier: MIT
 
+#include "manifold.h"
+
 #include "core.h"
+#include "simd.h"
 
 #include "box2d/collision.h"
 #include "box2d/constants.h"
@@ -676,6 +679,8 @@ static b2Manifold b2ClipPolygons( const b2Polygon* polyA, const b2Polygon* polyB
 	return manifold;
 }
 
+#if defined( B2_SIMD_NONE )
+
 // Find the max separation between poly1 and poly2 using edge normals from poly1.
 static float b2FindMaxSeparation( int* edgeIndex, const b2Polygon* poly1, const b2Polygon* poly2 )
 {
@@ -715,6 +720,89 @@ static float b2FindMaxSeparation( int* edgeIndex, const b2Polygon* poly1, const
 	return maxSeparation;
 }
 
+#else
+
+// Enough wide floats to hold every polygon edge in its own lane
+#define B2_SAT_BLOCK_COUNT ( ( B2_MAX_POLYGON_VERTICES + B2_SIMD_WIDTH - 1 ) / B2_SIMD_WIDTH )
+
+typedef union b2PolygonLane
+{
+	b2FloatW w[B2_SAT_BLOCK_COUNT];
+	float f[B2_SAT_BLOCK_COUNT * B2_SIMD_WIDTH];
+} b2PolygonLane;
+
+// Polygon edges in SoA form, one edge per lane. Unused lanes repeat the last edge.
+typedef struct b2PolygonLanes
+{
+	b2PolygonLane vx, vy;
+	b2PolygonLane nx, ny;
+	int count;
+} b2PolygonLanes;
+
+static void b2LoadPolygonLanes( b2PolygonLanes* lanes, const b2Polygon* polygon )
+{
+	int count = polygon->count;
+	lanes->count = count;
+
+	for ( int i = 0; i < B2_SAT_BLOCK_COUNT * B2_SIMD_WIDTH; ++i )
+	{
+		int k = i < count ? i : count - 1;
+		lanes->vx.f[i] = polygon->vertices[k].x;
+		lanes->vy.f[i] = polygon->vertices[k].y;
+		lanes->nx.f[i] = polygon->normals[k].x;
+		lanes->ny.f[i] = polygon->normals[k].y;
+	}
+}
+
+// Find the max separation between poly1 and poly2 using edge normals from poly1.
+// All edge normals of poly1 are tested against each vertex of poly2 at once. The arithmetic and the
+// tie breaking match the scalar version so the result is bitwise identical.
+static float b2FindMaxSeparation( int* edgeIndex, const b2PolygonLanes* poly1, const b2Polygon* poly2 )
+{
+	int count1 = poly1->count;
+	int count2 = poly2->count;
+	const b2Vec2* v2s = poly2->vertices;
+	int blockCount = ( count1 + B2_SIMD_WIDTH - 1 ) / B2_SIMD_WIDTH;
+
+	b2PolygonLane separations;
+	for ( int block = 0; block < blockCount; ++block )
+	{
+		b2FloatW nx = poly1->nx.w[block];
+		b2FloatW ny = poly1->ny.w[block];
+		b2FloatW v1x = poly1->vx.w[block];
+		b2FloatW v1y = poly1->vy.w[block];
+
+		// Find the deepest point for each normal.
+		b2FloatW si = b2SplatW( FLT_MAX );
+		for ( int j = 0; j < count2; ++j )
+		{
+			b2FloatW dx = b2SubW( b2SplatW( v2s[j].x ), v1x );
+			b2FloatW dy = b2SubW( b2SplatW( v2s[j].y ), v1y );
+			b2FloatW sij = b2AddW( b2MulW( nx, dx ), b2MulW( ny, dy ) );
+			si = b2BlendW( si, sij, b2GreaterThanW( si, sij ) );
+		}
+
+		separations.w[block] = si;
+	}
+
+	int bestIndex = 0;
+	float maxSeparation = -FLT_MAX;
+	for ( int i = 0; i < count1; ++i )
+	{
+		float si = separations.f[i];
+		if ( si > maxSeparation )
+		{
+			maxSeparation = si;
+			bestIndex = i;
+		}
+	}
+
+	*edgeIndex = bestIndex;
+	return maxSeparation;
+}
+
+#endif
+
 // Due to speculation, every polygon is rounded
 // Algorithm:
 //
@@ -733,7 +821,69 @@ static float b2FindMaxSeparation( int* edgeIndex, const b2Polygon* poly1, const
 //   clip edges
 // end
 
-b2Manifold b2CollidePolygons( const b2Polygon* polygonA, b2Transform xfA, const b2Polygon* polygonB, b2Transform xfB )
+// Separation of poly2 along edge i of poly1. Matches one iteration of b2FindMaxSeparation bit for bit.
+static float b2EdgeSeparation( b2Vec2 n, b2Vec2 v1, const b2Vec2* v2s, int count2 )
+{
+	float si = FLT_MAX;
+	for ( int j = 0; j < count2; ++j )
+	{
+		float sij = b2Dot( n, b2Sub( v2s[j], v1 ) );
+		if ( sij < si )
+		{
+			si = sij;
+		}
+	}
+
+	return si;
+}
+
+// Try the separating axis from the previous update. The separation along any single axis is a lower
+// bound of the SAT max separation, so if the cached axis still separates the polygons beyond the
+// speculative distance the full SAT would return an empty manifold as well.
+static bool b2TestSeparatingAxis( const b2Polygon* polygonA, const b2Polygon* polygonB, b2Vec2 origin, b2Transform xf,
+								  const b2SimplexCache* cache )
+{
+	int edge = cache->indexA[0];
+	float radius = polygonA->radius + polygonB->radius;
+	float limit = B2_SPECULATIVE_DISTANCE + radius;
+	b2Vec2 vertices[B2_MAX_POLYGON_VERTICES];
+
+	if ( cache->indexB[0] == 0 )
+	{
+		if ( edge >= polygonA->count )
+		{
+			return false;
+		}
+
+		int count = polygonB->count;
+		for ( int i = 0; i < count; ++i )
+		{
+			vertices[i] = b2TransformPoint( xf, polygonB->vertices[i] );
+		}
+
+		b2Vec2 v1 = edge == 0 ? b2Vec2_zero : b2Sub( polygonA->vertices[edge], origin );
+		return b2EdgeSeparation( polygonA->normals[edge], v1, vertices, count ) > limit;
+	}
+
+	if ( edge >= polygonB->count )
+	{
+		return false;
+	}
+
+	int count = polygonA->count;
+	vertices[0] = b2Vec2_zero;
+	for ( int i = 1; i < count; ++i )
+	{
+		vertices[i] = b2Sub( polygonA->vertices[i], origin );
+	}
+
+	b2Vec2 n = b2RotateVector( xf.q, polygonB->normals[edge] );
+	b2Vec2 v1 = b2TransformPoint( xf, polygonB->vertices[edge] );
+	return b2EdgeSeparation( n, v1, vertices, count ) > limit;
+}
+
+static b2Manifold b2CollidePolygonsInternal( const b2Polygon* polygonA, b2Transform xfA, const b2Polygon* polygonB,
+											 b2Transform xfB, b2SimplexCache* cache )
 {
 	b2Vec2 origin = polygonA->vertices[0];
 	float linearSlop = B2_LINEAR_SLOP;
@@ -746,6 +896,15 @@ b2Manifold b2CollidePolygons( const b2Polygon* polygonA, b2Transform xfA, const
 	b2Transform sfA = { b2Add( xfA.p, b2RotateVector( xfA.q, origin ) ), xfA.q };
 	b2Transform xf = b2InvMulTransforms( sfA, xfB );
 
+	if ( cache != NULL && cache->count > 0 )
+	{
+		if ( b2TestSeparatingAxis( polygonA, polygonB, origin, xf, cache ) )
+		{
+			cache->count = 2;
+			return (b2Manifold){ 0 };
+		}
+	}
+
 	b2Polygon localPolyA;
 	localPolyA.count = polygonA->count;
 	localPolyA.radius = polygonA->radius;
@@ -767,14 +926,34 @@ b2Manifold b2CollidePolygons( const b2Polygon* polygonA, b2Transform xfA, const
 		localPolyB.normals[i] = b2RotateVector( xf.q, polygonB->normals[i] );
 	}
 
+#if defined( B2_SIMD_NONE )
 	int edgeA = 0;
 	float separationA = b2FindMaxSeparation( &edgeA, &localPolyA, &localPolyB );
 
 	int edgeB = 0;
 	float separationB = b2FindMaxSeparation( &edgeB, &localPolyB, &localPolyA );
+#else
+	b2PolygonLanes lanesA, lanesB;
+	b2LoadPolygonLanes( &lanesA, &localPolyA );
+	b2LoadPolygonLanes( &lanesB, &localPolyB );
+
+	int edgeA = 0;
+	float separationA = b2FindMaxSeparation( &edgeA, &lanesA, &localPolyB );
+
+	int edgeB = 0;
+	float separationB = b2FindMaxSeparation( &edgeB, &lanesB, &localPolyA );
+#endif
 
 	float radius = localPolyA.radius + localPolyB.radius;
 
+	if ( cache != NULL )
+	{
+		// Keep the axis of max separation as the hint for the next update
+		cache->count = 1;
+		cache->indexA[0] = (uint8_t)( separationA >= separationB ? edgeA : edgeB );
+		cache->indexB[0] = separationA >= separationB ? 0 : 1;
+	}
+
 	if ( separationA > speculativeDistance + radius || separationB > speculativeDistance + radius )
 	{
 		return (b2Manifold){ 0 };
@@ -1074,6 +1253,17 @@ b2Manifold b2CollidePolygons( const b2Polygon* polygonA, b2Transform xfA, const
 	return manifold;
 }
 
+b2Manifold b2CollidePolygons( const b2Polygon* polygonA, b2Transform xfA, const b2Polygon* polygonB, b2Transform xfB )
+{
+	return b2CollidePolygonsInternal( polygonA, xfA, polygonB, xfB, NULL );
+}
+
+b2Manifold b2CollidePolygonsCached( const b2Polygon* polygonA, b2Transform xfA, const b2Polygon* polygonB, b2Transform xfB,
+									b2SimplexCache* cache )
+{
+	return b2CollidePolygonsInternal( polygonA, xfA, polygonB, xfB, cache );
+}
+
 b2Manifold b2CollideSegmentAndCircle( const b2Segment* segmentA, b2Transform xfA, const b2Circle* circleB, b2Transform xfB )
 {
 	b2Capsule capsuleA = { segmentA->point1, segmentA->point2, 0.0f };
@@ -1086,6 +1276,13 @@ b2Manifold b2CollideSegmentAndPolygon( const b2Segment* segmentA, b2Transform xf
 	return b2CollidePolygons( &polygonA, xfA, polygonB, xfB );
 }
 
+b2Manifold b2CollideSegmentAndPolygonCached( const b2Segment* segmentA, b2Transform xfA, const b2Polygon* polygonB,
+											 b2Transform xfB, b2SimplexCache* cache )
+{
+	b2Polygon polygonA = b2MakeCapsule( segmentA->point1, segmentA->point2, 0.0f );
+	return b2CollidePolygonsInternal( &polygonA, xfA, polygonB, xfB, cache );
+}
+
 b2Manifold b2CollideChainSegmentAndCircle( const b2ChainSegment* segmentA, b2Transform xfA, const b2Circle* circleB,
 										   b2Transform xfB )
 {
@@ -0,0 +1,20 @@
+// SPDX-FileCopyrightText: 2025 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "box2d/collision.h"
+
+// Polygon manifold functions that keep a separating axis between updates. The contact simplex cache is
+// otherwise unused by these shape pairs, so it holds the axis:
+// - count: 0 for no axis, 1 for an axis found by the full SAT, 2 if the cached axis still separated the pair
+// - indexA[0]: the edge index
+// - indexB[0]: 0 if the edge is on polygon A, 1 if the edge is on polygon B
+// The cached axis only provides an early out when it still separates the polygons, so the manifolds
+// are identical to those of b2CollidePolygons.
+
+b2Manifold b2CollidePolygonsCached( const b2Polygon* polygonA, b2Transform xfA, const b2Polygon* polygonB, b2Transform xfB,
+									b2SimplexCache* cache );
+
+b2Manifold b2CollideSegmentAndPolygonCached( const b2Segment* segmentA, b2Transform xfA, const b2Polygon* polygonB,
+											 b2Transform xfB, b2SimplexCache* cache );
@@ -0,0 +1,503 @@
+// SPDX-FileCopyrightText: 2025 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#include "manifold_wide.h"
+
+#include "core.h"
+#include "simd.h"
+
+#include "box2d/constants.h"
+
+#include <float.h>
+
+// Every operation here mirrors the scalar code in manifold.c one to one, including the operand order
+// and the handling of branches, so each lane produces the same bits as the scalar function. Branches
+// are evaluated for all lanes and selected with masks.
+
+#define B2_MAKE_ID( A, B ) ( (uint8_t)( A ) << 8 | (uint8_t)( B ) )
+
+// Access to the lanes of a wide float
+typedef union b2FloatLanes
+{
+	b2FloatW w;
+	float f[B2_SIMD_WIDTH];
+} b2FloatLanes;
+
+// Wide transform
+typedef struct b2TransformW
+{
+	b2Vec2W p;
+	b2RotW q;
+} b2TransformW;
+
+static inline b2FloatW b2LessThanW( b2FloatW a, b2FloatW b )
+{
+	return b2GreaterThanW( b, a );
+}
+
+static inline b2FloatW b2GreaterEqualW( b2FloatW a, b2FloatW b )
+{
+	return b2OrW( b2GreaterThanW( a, b ), b2EqualsW( a, b ) );
+}
+
+static inline b2FloatW b2LessEqualW( b2FloatW a, b2FloatW b )
+{
+	return b2GreaterEqualW( b, a );
+}
+
+static inline b2FloatW b2AndW( b2FloatW a, b2FloatW b )
+{
+	return b2BlendW( b2ZeroW(), b, a );
+}
+
+// a < lower ? lower : ( a > upper ? upper : a )
+static inline b2FloatW b2ClampW( b2FloatW a, b2FloatW lower, b2FloatW upper )
+{
+	b2FloatW r = b2BlendW( a, upper, b2GreaterThanW( a, upper ) );
+	return b2BlendW( r, lower, b2LessThanW( a, lower ) );
+}
+
+static inline b2Vec2W b2AddVW( b2Vec2W a, b2Vec2W b )
+{
+	return (b2Vec2W){ b2AddW( a.X, b.X ), b2AddW( a.Y, b.Y ) };
+}
+
+static inline b2Vec2W b2SubVW( b2Vec2W a, b2Vec2W b )
+{
+	return (b2Vec2W){ b2SubW( a.X, b.X ), b2SubW( a.Y, b.Y ) };
+}
+
+static inline b2Vec2W b2NegVW( b2Vec2W a )
+{
+	return (b2Vec2W){ b2NegW( a.X ), b2NegW( a.Y ) };
+}
+
+// a + s * b
+static inline b2Vec2W b2MulAddVW( b2Vec2W a, b2FloatW s, b2Vec2W b )
+{
+	return (b2Vec2W){ b2AddW( a.X, b2MulW( s, b.X ) ), b2AddW( a.Y, b2MulW( s, b.Y ) ) };
+}
+
+static inline b2Vec2W b2LerpVW( b2Vec2W a, b2Vec2W b, b2FloatW t )
+{
+	b2FloatW s = b2SubW( b2SplatW( 1.0f ), t );
+	return (b2Vec2W){ b2AddW( b2MulW( s, a.X ), b2MulW( t, b.X ) ), b2AddW( b2MulW( s, a.Y ), b2MulW( t, b.Y ) ) };
+}
+
+static inline b2Vec2W b2LeftPerpVW( b2Vec2W v )
+{
+	return (b2Vec2W){ b2NegW( v.Y ), v.X };
+}
+
+static inline b2Vec2W b2BlendVW( b2Vec2W a, b2Vec2W b, b2FloatW mask )
+{
+	return (b2Vec2W){ b2BlendW( a.X, b.X, mask ), b2BlendW( a.Y, b.Y, mask ) };
+}
+
+static inline b2Vec2W b2InvRotateVectorW( b2RotW q, b2Vec2W v )
+{
+	return (b2Vec2W){ b2AddW( b2MulW( q.C, v.X ), b2MulW( q.S, v.Y ) ),
+					  b2AddW( b2MulW( b2NegW( q.S ), v.X ), b2MulW( q.C, v.Y ) ) };
+}
+
+static inline b2Vec2W b2TransformPointW( b2TransformW t, b2Vec2W p )
+{
+	b2FloatW x = b2AddW( b2SubW( b2MulW( t.q.C, p.X ), b2MulW( t.q.S, p.Y ) ), t.p.X );
+	b2FloatW y = b2AddW( b2AddW( b2MulW( t.q.S, p.X ), b2MulW( t.q.C, p.Y ) ), t.p.Y );
+	return (b2Vec2W){ x, y };
+}
+
+static inline b2TransformW b2InvMulTransformsW( b2TransformW a, b2TransformW b )
+{
+	b2TransformW c;
+	c.q.S = b2SubW( b2MulW( a.q.C, b.q.S ), b2MulW( a.q.S, b.q.C ) );
+	c.q.C = b2AddW( b2MulW( a.q.C, b.q.C ), b2MulW( a.q.S, b.q.S ) );
+	c.p = b2InvRotateVectorW( a.q, b2SubVW( b.p, a.p ) );
+	return c;
+}
+
+static inline b2Vec2W b2GetLengthAndNormalizeW( b2FloatW* length, b2Vec2W v )
+{
+	*length = b2SqrtW( b2AddW( b2MulW( v.X, v.X ), b2MulW( v.Y, v.Y ) ) );
+	b2FloatW invLength = b2DivW( b2SplatW( 1.0f ), *length );
+	b2Vec2W n = { b2MulW( invLength, v.X ), b2MulW( invLength, v.Y ) };
+	b2FloatW small = b2LessThanW( *length, b2SplatW( FLT_EPSILON ) );
+	return b2BlendVW( n, (b2Vec2W){ b2ZeroW(), b2ZeroW() }, small );
+}
+
+// Lane loading. Unused lanes repeat the last pair so every lane holds valid geometry.
+
+static inline void b2SetLaneV( b2Vec2W* w, int lane, b2Vec2 v )
+{
+	( (b2FloatLanes*)&w->X )->f[lane] = v.x;
+	( (b2FloatLanes*)&w->Y )->f[lane] = v.y;
+}
+
+static inline void b2SetLane( b2FloatW* w, int lane, float f )
+{
+	( (b2FloatLanes*)w )->f[lane] = f;
+}
+
+static inline float b2GetLane( b2FloatW w, int lane )
+{
+	b2FloatLanes lanes = { w };
+	return lanes.f[lane];
+}
+
+static inline bool b2GetLaneMask( b2FloatW w, int lane )
+{
+	b2FloatLanes lanes = { w };
+
+	// Full lane masks are NaNs and the scalar fallback uses 1.0f
+	return lanes.f[lane] != 0.0f;
+}
+
+static inline b2Vec2 b2GetLaneV( b2Vec2W w, int lane )
+{
+	return (b2Vec2){ b2GetLane( w.X, lane ), b2GetLane( w.Y, lane ) };
+}
+
+static inline void b2SetLaneTransform( b2TransformW* w, int lane, b2Transform xf )
+{
+	b2SetLaneV( &w->p, lane, xf.p );
+	b2SetLane( &w->q.C, lane, xf.q.c );
+	b2SetLane( &w->q.S, lane, xf.q.s );
+}
+
+// Write the single point manifold shared by the circle functions
+static void b2StoreRoundManifolds( b2TransformW xfA, b2TransformW xfB, b2Vec2W pA, b2Vec2W pB, b2FloatW radiusA,
+								   b2FloatW radiusB, int count, b2Manifold* manifolds )
+{
+	b2FloatW distance;
+	b2Vec2W normal = b2GetLengthAndNormalizeW( &distance, b2SubVW( pB, pA ) );
+
+	b2FloatW separation = b2SubW( b2SubW( distance, radiusA ), radiusB );
+	b2FloatW miss = b2GreaterThanW( separation, b2SplatW( B2_SPECULATIVE_DISTANCE ) );
+
+	b2Vec2W cA = b2MulAddVW( pA, radiusA, normal );
+	b2Vec2W cB = b2MulAddVW( pB, b2NegW( radiusB ), normal );
+	b2Vec2W contactPointA = b2LerpVW( cA, cB, b2SplatW( 0.5f ) );
+
+	b2Vec2W worldNormal = b2RotateVectorW( xfA.q, normal );
+	b2Vec2W anchorA = b2RotateVectorW( xfA.q, contactPointA );
+	b2Vec2W anchorB = b2AddVW( anchorA, b2SubVW( xfA.p, xfB.p ) );
+	b2Vec2W clipPoint = b2AddVW( anchorA, xfA.p );
+
+	for ( int i = 0; i < count; ++i )
+	{
+		b2Manifold* manifold = manifolds + i;
+		*manifold = (b2Manifold){ 0 };
+
+		if ( b2GetLaneMask( miss, i ) )
+		{
+			continue;
+		}
+
+		manifold->normal = b2GetLaneV( worldNormal, i );
+		b2ManifoldPoint* mp = manifold->points + 0;
+		mp->anchorA = b2GetLaneV( anchorA, i );
+		mp->anchorB = b2GetLaneV( anchorB, i );
+		mp->clipPoint = b2GetLaneV( clipPoint, i );
+		mp->separation = b2GetLane( separation, i );
+		mp->id = 0;
+		manifold->pointCount = 1;
+	}
+}
+
+void b2CollideCirclesWide( const b2Circle* const* circlesA, const b2Transform* xfsA, const b2Circle* const* circlesB,
+						   const b2Transform* xfsB, int count, b2Manifold* manifolds )
+{
+	B2_ASSERT( 0 < count && count <= B2_SIMD_WIDTH );
+
+	b2TransformW xfA, xfB;
+	b2Vec2W centerA, centerB;
+	b2FloatW radiusA, radiusB;
+
+	for ( int i = 0; i < B2_SIMD_WIDTH; ++i )
+	{
+		int j = i < count ? i : count - 1;
+		b2SetLaneTransform( &xfA, i, xfsA[j] );
+		b2SetLaneTransform( &xfB, i, xfsB[j] );
+		b2SetLaneV( &centerA, i, circlesA[j]->center );
+		b2SetLaneV( &centerB, i, circlesB[j]->center );
+		b2SetLane( &radiusA, i, circlesA[j]->radius );
+		b2SetLane( &radiusB, i, circlesB[j]->radius );
+	}
+
+	b2TransformW xf = b2InvMulTransformsW( xfA, xfB );
+
+	b2Vec2W pointA = centerA;
+	b2Vec2W pointB = b2TransformPointW( xf, centerB );
+
+	b2StoreRoundManifolds( xfA, xfB, pointA, pointB, radiusA, radiusB, count, manifolds );
+}
+
+void b2CollideCapsuleAndCircleWide( const b2Capsule* const* capsulesA, const b2Transform* xfsA, const b2Circle* const* circlesB,
+									const b2Transform* xfsB, int count, b2Manifold* manifolds )
+{
+	B2_ASSERT( 0 < count && count <= B2_SIMD_WIDTH );
+
+	b2TransformW xfA, xfB;
+	b2Vec2W p1, p2, centerB;
+	b2FloatW radiusA, radiusB;
+
+	for ( int i = 0; i < B2_SIMD_WIDTH; ++i )
+	{
+		int j = i < count ? i : count - 1;
+		b2SetLaneTransform( &xfA, i, xfsA[j] );
+		b2SetLaneTransform( &xfB, i, xfsB[j] );
+		b2SetLaneV( &p1, i, capsulesA[j]->center1 );
+		b2SetLaneV( &p2, i, capsulesA[j]->center2 );
+		b2SetLaneV( &centerB, i, circlesB[j]->center );
+		b2SetLane( &radiusA, i, capsulesA[j]->radius );
+		b2SetLane( &radiusB, i, circlesB[j]->radius );
+	}
+
+	b2TransformW xf = b2InvMulTransformsW( xfA, xfB );
+
+	// Compute circle position in the frame of the capsule.
+	b2Vec2W pB = b2TransformPointW( xf, centerB );
+
+	b2Vec2W e = b2SubVW( p2, p1 );
+
+	b2FloatW s1 = b2DotW( b2SubVW( pB, p1 ), e );
+	b2FloatW s2 = b2DotW( b2SubVW( p2, pB ), e );
+
+	// Segment interior, then the p2 region and the p1 region in reverse order of the scalar branches
+	b2FloatW s = b2DivW( s1, b2DotW( e, e ) );
+	b2Vec2W pA = b2MulAddVW( p1, s, e );
+	pA = b2BlendVW( pA, p2, b2LessThanW( s2, b2ZeroW() ) );
+	pA = b2BlendVW( pA, p1, b2LessThanW( s1, b2ZeroW() ) );
+
+	b2StoreRoundManifolds( xfA, xfB, pA, pB, radiusA, radiusB, count, manifolds );
+}
+
+// Clip segment (p, q) with projections (fp, fq) to [0, length]. Returns the clipped end points.
+static void b2ClipSegmentW( b2Vec2W* cp, b2Vec2W* cq, b2Vec2W p, b2Vec2W q, b2FloatW fp, b2FloatW fq, b2FloatW length )
+{
+	b2FloatW zero = b2ZeroW();
+
+	// clip to the start
+	b2FloatW clipP = b2AndW( b2LessThanW( fp, zero ), b2GreaterThanW( fq, zero ) );
+	b2FloatW clipQ = b2AndW( b2LessThanW( fq, zero ), b2GreaterThanW( fp, zero ) );
+	*cp = b2BlendVW( p, b2LerpVW( p, q, b2DivW( b2SubW( zero, fp ), b2SubW( fq, fp ) ) ), clipP );
+	*cq = b2BlendVW( q, b2LerpVW( q, p, b2DivW( b2SubW( zero, fq ), b2SubW( fp, fq ) ) ), clipQ );
+
+	// clip to the end
+	clipP = b2AndW( b2GreaterThanW( fp, length ), b2LessThanW( fq, length ) );
+	clipQ = b2AndW( b2GreaterThanW( fq, length ), b2LessThanW( fp, length ) );
+	*cp = b2BlendVW( *cp, b2LerpVW( p, q, b2DivW( b2SubW( fp, length ), b2SubW( fp, fq ) ) ), clipP );
+	*cq = b2BlendVW( *cq, b2LerpVW( q, p, b2DivW( b2SubW( fq, length ), b2SubW( fq, fp ) ) ), clipQ );
+}
+
+// Reference edge separation of segment (p2, q2) against the edge with the given unit direction.
+static b2FloatW b2SegmentSeparationW( b2Vec2W* normal, b2Vec2W u, b2Vec2W p1, b2Vec2W p2, b2Vec2W q2 )
+{
+	*normal = b2LeftPerpVW( u );
+	b2FloatW ss1 = b2DotW( b2SubVW( p2, p1 ), *normal );
+	b2FloatW ss2 = b2DotW( b2SubVW( q2, p1 ), *normal );
+	b2FloatW s1p = b2BlendW( ss2, ss1, b2LessThanW( ss1, ss2 ) );
+	b2FloatW s1n = b2BlendW( b2NegW( ss2 ), b2NegW( ss1 ), b2LessThanW( b2NegW( ss1 ), b2NegW( ss2 ) ) );
+
+	b2FloatW positive = b2GreaterThanW( s1p, s1n );
+	*normal = b2BlendVW( b2NegVW( *normal ), *normal, positive );
+	return b2BlendW( s1n, s1p, positive );
+}
+
+void b2CollideCapsulesWide( const b2Capsule* const* capsulesA, const b2Transform* xfsA, const b2Capsule* const* capsulesB,
+							const b2Transform* xfsB, int count, b2Manifold* manifolds )
+{
+	B2_ASSERT( 0 < count && count <= B2_SIMD_WIDTH );
+
+	b2TransformW xfA, xfB;
+	b2Vec2W originA, centerA2, centerB1, centerB2;
+	b2FloatW radiusA, radiusB;
+
+	for ( int i = 0; i < B2_SIMD_WIDTH; ++i )
+	{
+		int j = i < count ? i : count - 1;
+		b2SetLaneTransform( &xfA, i, xfsA[j] );
+		b2SetLaneTransform( &xfB, i, xfsB[j] );
+		b2SetLaneV( &originA, i, capsulesA[j]->center1 );
+		b2SetLaneV( &centerA2, i, capsulesA[j]->center2 );
+		b2SetLaneV( &centerB1, i, capsulesB[j]->center1 );
+		b2SetLaneV( &centerB2, i, capsulesB[j]->center2 );
+		b2SetLane( &radiusA, i, capsulesA[j]->radius );
+		b2SetLane( &radiusB, i, capsulesB[j]->radius );
+	}
+
+	b2FloatW zero = b2ZeroW();
+	b2FloatW one = b2SplatW( 1.0f );
+	b2FloatW linearSlop = b2SplatW( B2_LINEAR_SLOP );
+	const float epsSqr = FLT_EPSILON * FLT_EPSILON;
+
+	// Shift polyA to origin
+	b2TransformW sfA = { b2AddVW( xfA.p, b2RotateVectorW( xfA.q, originA ) ), xfA.q };
+	b2TransformW xf = b2InvMulTransformsW( sfA, xfB );
+
+	b2Vec2W p1 = { zero, zero };
+	b2Vec2W q1 = b2SubVW( centerA2, originA );
+
+	b2Vec2W p2 = b2TransformPointW( xf, centerB1 );
+	b2Vec2W q2 = b2TransformPointW( xf, centerB2 );
+
+	b2Vec2W d1 = b2SubVW( q1, p1 );
+	b2Vec2W d2 = b2SubVW( q2, p2 );
+
+	b2FloatW dd1 = b2DotW( d1, d1 );
+	b2FloatW dd2 = b2DotW( d2, d2 );
+
+	b2Vec2W r = b2SubVW( p1, p2 );
+	b2FloatW rd1 = b2DotW( r, d1 );
+	b2FloatW rd2 = b2DotW( r, d2 );
+
+	b2FloatW d12 = b2DotW( d1, d2 );
+
+	b2FloatW denom = b2SubW( b2MulW( dd1, dd2 ), b2MulW( d12, d12 ) );
+
+	// Fraction on segment 1, zero if parallel
+	b2FloatW f1 = b2ClampW( b2DivW( b2SubW( b2MulW( d12, rd2 ), b2MulW( rd1, dd2 ) ), denom ), zero, one );
+	f1 = b2BlendW( f1, zero, b2EqualsW( denom, zero ) );
+
+	// Compute point on segment 2 closest to p1 + f1 * d1
+	b2FloatW f2 = b2DivW( b2AddW( b2MulW( d12, f1 ), rd2 ), dd2 );
+
+	// Clamping of segment 2 requires a do over on segment 1
+	b2FloatW below = b2LessThanW( f2, zero );
+	b2FloatW above = b2GreaterThanW( f2, one );
+	f1 = b2BlendW( f1, b2ClampW( b2DivW( b2SubW( d12, rd1 ), dd1 ), zero, one ), above );
+	f1 = b2BlendW( f1, b2ClampW( b2DivW( b2NegW( rd1 ), dd1 ), zero, one ), below );
+	f2 = b2BlendW( f2, one, above );
+	f2 = b2BlendW( f2, zero, below );
+
+	b2Vec2W closest1 = b2MulAddVW( p1, f1, d1 );
+	b2Vec2W closest2 = b2MulAddVW( p2, f2, d2 );
+	b2Vec2W c12 = b2SubVW( closest2, closest1 );
+	b2FloatW distanceSquared = b2DotW( c12, c12 );
+
+	b2FloatW radius = b2AddW( radiusA, radiusB );
+	b2FloatW maxDistance = b2AddW( radius, b2SplatW( B2_SPECULATIVE_DISTANCE ) );
+	b2FloatW miss = b2GreaterThanW( distanceSquared, b2MulW( maxDistance, maxDistance ) );
+
+	b2FloatW distance = b2SqrtW( distanceSquared );
+
+	b2FloatW length1, length2;
+	b2Vec2W u1 = b2GetLengthAndNormalizeW( &length1, d1 );
+	b2Vec2W u2 = b2GetLengthAndNormalizeW( &length2, d2 );
+
+	// Does segment B project outside segment A?
+	b2FloatW fp2 = b2DotW( b2SubVW( p2, p1 ), u1 );
+	b2FloatW fq2 = b2DotW( b2SubVW( q2, p1 ), u1 );
+	b2FloatW outsideA = b2OrW( b2AndW( b2LessEqualW( fp2, zero ), b2LessEqualW( fq2, zero ) ),
+							   b2AndW( b2GreaterEqualW( fp2, length1 ), b2GreaterEqualW( fq2, length1 ) ) );
+
+	// Does segment A project outside segment B?
+	b2FloatW fp1 = b2DotW( b2SubVW( p1, p2 ), u2 );
+	b2FloatW fq1 = b2DotW( b2SubVW( q1, p2 ), u2 );
+	b2FloatW outsideB = b2OrW( b2AndW( b2LessEqualW( fp1, zero ), b2LessEqualW( fq1, zero ) ),
+							   b2AndW( b2GreaterEqualW( fp1, length2 ), b2GreaterEqualW( fq1, length2 ) ) );
+
+	b2FloatW outside = b2OrW( outsideA, outsideB );
+
+	// find reference edge using SAT
+	b2Vec2W normalA, normalB;
+	b2FloatW separationA = b2SegmentSeparationW( &normalA, u1, p1, p2, q2 );
+	b2FloatW separationB = b2SegmentSeparationW( &normalB, u2, p2, p1, q1 );
+
+	// biased to avoid feature flip-flop
+	b2FloatW useA = b2GreaterEqualW( b2AddW( separationA, b2SplatW( 0.1f * B2_LINEAR_SLOP ) ), separationB );
+
+	// Reference edge on A
+	b2Vec2W cpA, cqA;
+	b2ClipSegmentW( &cpA, &cqA, p2, q2, fp2, fq2, length1 );
+	b2FloatW spA = b2DotW( b2SubVW( cpA, p1 ), normalA );
+	b2FloatW sqA = b2DotW( b2SubVW( cqA, p1 ), normalA );
+	b2FloatW radiusDeltaA = b2SubW( radiusA, radiusB );
+
+	// Reference edge on B
+	b2Vec2W cpB, cqB;
+	b2ClipSegmentW( &cpB, &cqB, p1, q1, fp1, fq1, length2 );
+	b2FloatW spB = b2DotW( b2SubVW( cpB, p2 ), normalB );
+	b2FloatW sqB = b2DotW( b2SubVW( cqB, p2 ), normalB );
+	b2FloatW radiusDeltaB = b2SubW( radiusB, radiusA );
+
+	b2FloatW sp = b2BlendW( spB, spA, useA );
+	b2FloatW sq = b2BlendW( sqB, sqA, useA );
+	b2Vec2W cp = b2BlendVW( cpB, cpA, useA );
+	b2Vec2W cq = b2BlendVW( cqB, cqA, useA );
+	b2Vec2W edgeNormal = b2BlendVW( normalB, normalA, useA );
+	b2FloatW radiusDelta = b2BlendW( radiusDeltaB, radiusDeltaA, useA );
+
+	b2FloatW maxSeparation = b2AddW( distance, linearSlop );
+	b2FloatW accept = b2OrW( b2LessEqualW( sp, maxSeparation ), b2LessEqualW( sq, maxSeparation ) );
+	b2FloatW twoPoints = b2BlendW( accept, zero, outside );
+
+	b2FloatW half = b2SplatW( 0.5f );
+	b2Vec2W clipAnchor0 = b2MulAddVW( cp, b2MulW( half, b2SubW( radiusDelta, sp ) ), edgeNormal );
+	b2Vec2W clipAnchor1 = b2MulAddVW( cq, b2MulW( half, b2SubW( radiusDelta, sq ) ), edgeNormal );
+	b2Vec2W clipNormal = b2BlendVW( b2NegVW( normalB ), normalA, useA );
+
+	// single point collision
+	b2FloatW normalLength;
+	b2Vec2W pointNormal = b2GetLengthAndNormalizeW( &normalLength, c12 );
+	pointNormal = b2BlendVW( b2LeftPerpVW( u1 ), pointNormal, b2GreaterThanW( b2DotW( c12, c12 ), b2SplatW( epsSqr ) ) );
+
+	b2Vec2W c1 = b2MulAddVW( closest1, radiusA, pointNormal );
+	b2Vec2W c2 = b2MulAddVW( closest2, b2NegW( radiusB ), pointNormal );
+	b2Vec2W pointAnchor = b2LerpVW( c1, c2, half );
+	b2FloatW pointSeparation = b2SubW( distance, radius );
+
+	// Convert manifold to world space
+	b2Vec2W normal = b2RotateVectorW( xfA.q, b2BlendVW( pointNormal, clipNormal, twoPoints ) );
+	b2Vec2W offset = b2SubVW( xfA.p, xfB.p );
+
+	b2Vec2W anchorA0 = b2RotateVectorW( xfA.q, b2AddVW( b2BlendVW( pointAnchor, clipAnchor0, twoPoints ), originA ) );
+	b2Vec2W anchorB0 = b2AddVW( anchorA0, offset );
+	b2Vec2W clipPoint0 = b2AddVW( xfA.p, anchorA0 );
+	b2FloatW separation0 = b2BlendW( pointSeparation, b2SubW( sp, radius ), twoPoints );
+
+	b2Vec2W anchorA1 = b2RotateVectorW( xfA.q, b2AddVW( clipAnchor1, originA ) );
+	b2Vec2W anchorB1 = b2AddVW( anchorA1, offset );
+	b2Vec2W clipPoint1 = b2AddVW( xfA.p, anchorA1 );
+	b2FloatW separation1 = b2SubW( sq, radius );
+
+	for ( int i = 0; i < count; ++i )
+	{
+		b2Manifold* manifold = manifolds + i;
+		*manifold = (b2Manifold){ 0 };
+
+		if ( b2GetLaneMask( miss, i ) )
+		{
+			continue;
+		}
+
+		manifold->normal = b2GetLaneV( normal, i );
+
+		b2ManifoldPoint* mp = manifold->points + 0;
+		mp->anchorA = b2GetLaneV( anchorA0, i );
+		mp->anchorB = b2GetLaneV( anchorB0, i );
+		mp->clipPoint = b2GetLaneV( clipPoint0, i );
+		mp->separation = b2GetLane( separation0, i );
+
+		if ( b2GetLaneMask( twoPoints, i ) )
+		{
+			bool referenceA = b2GetLaneMask( useA, i );
+			mp->id = B2_MAKE_ID( 0, 0 );
+
+			mp = manifold->points + 1;
+			mp->anchorA = b2GetLaneV( anchorA1, i );
+			mp->anchorB = b2GetLaneV( anchorB1, i );
+			mp->clipPoint = b2GetLaneV( clipPoint1, i );
+			mp->separation = b2GetLane( separation1, i );
+			mp->id = referenceA ? B2_MAKE_ID( 0, 1 ) : B2_MAKE_ID( 1, 0 );
+			manifold->pointCount = 2;
+		}
+		else
+		{
+			int i1 = b2GetLane( f1, i ) == 0.0f ? 0 : 1;
+			int i2 = b2GetLane( f2, i ) == 0.0f ? 0 : 1;
+			mp->id = B2_MAKE_ID( i1, i2 );
+			manifold->pointCount = 1;
+		}
+	}
+}
@@ -0,0 +1,18 @@
+// SPDX-FileCopyrightText: 2025 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "box2d/collision.h"
+
+// Batched manifold functions. Each computes the manifolds of up to B2_SIMD_WIDTH shape pairs at once,
+// one pair per lane. The results are bitwise identical to the scalar manifold functions in manifold.c.
+
+void b2CollideCirclesWide( const b2Circle* const* circlesA, const b2Transform* xfsA, const b2Circle* const* circlesB,
+						   const b2Transform* xfsB, int count, b2Manifold* manifolds );
+
+void b2CollideCapsuleAndCircleWide( const b2Capsule* const* capsulesA, const b2Transform* xfsA, const b2Circle* const* circlesB,
+									const b2Transform* xfsB, int count, b2Manifold* manifolds );
+
+void b2CollideCapsulesWide( const b2Capsule* const* capsulesA, const b2Transform* xfsA, const b2Capsule* const* capsulesB,
+							const b2Transform* xfsB, int count, b2Manifold* manifolds );
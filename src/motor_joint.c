@@ -13,7 +13,7 @@
 
 void b2MotorJoint_SetLinearVelocity( b2JointId jointId, b2Vec2 velocity )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_motorJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_motorJoint );
 	joint->motorJoint.linearVelocity = velocity;
 }
 
@@ -25,7 +25,7 @@ b2Vec2 b2MotorJoint_GetLinearVelocity( b2JointId jointId )
 
 void b2MotorJoint_SetAngularVelocity( b2JointId jointId, float velocity )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_motorJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_motorJoint );
 	joint->motorJoint.angularVelocity = velocity;
 }
 
@@ -37,7 +37,7 @@ float b2MotorJoint_GetAngularVelocity( b2JointId jointId )
 
 void b2MotorJoint_SetMaxVelocityTorque( b2JointId jointId, float maxTorque )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_motorJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_motorJoint );
 	joint->motorJoint.maxVelocityTorque = maxTorque;
 }
 
@@ -49,7 +49,7 @@ float b2MotorJoint_GetMaxVelocityTorque( b2JointId jointId )
 
 void b2MotorJoint_SetMaxVelocityForce( b2JointId jointId, float maxForce )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_motorJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_motorJoint );
 	joint->motorJoint.maxVelocityForce = maxForce;
 }
 
@@ -61,7 +61,7 @@ float b2MotorJoint_GetMaxVelocityForce( b2JointId jointId )
 
 void b2MotorJoint_SetLinearHertz( b2JointId jointId, float hertz )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_motorJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_motorJoint );
 	joint->motorJoint.linearHertz = hertz;
 }
 
@@ -73,7 +73,7 @@ float b2MotorJoint_GetLinearHertz( b2JointId jointId )
 
 void b2MotorJoint_SetLinearDampingRatio( b2JointId jointId, float damping )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_motorJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_motorJoint );
 	joint->motorJoint.linearDampingRatio = damping;
 }
 
@@ -85,7 +85,7 @@ float b2MotorJoint_GetLinearDampingRatio( b2JointId jointId )
 
 void b2MotorJoint_SetAngularHertz( b2JointId jointId, float hertz )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_motorJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_motorJoint );
 	joint->motorJoint.angularHertz = hertz;
 }
 
@@ -97,7 +97,7 @@ float b2MotorJoint_GetAngularHertz( b2JointId jointId )
 
 void b2MotorJoint_SetAngularDampingRatio( b2JointId jointId, float damping )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_motorJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_motorJoint );
 	joint->motorJoint.angularDampingRatio = damping;
 }
 
@@ -109,7 +109,7 @@ float b2MotorJoint_GetAngularDampingRatio( b2JointId jointId )
 
 void b2MotorJoint_SetMaxSpringForce( b2JointId jointId, float maxForce )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_motorJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_motorJoint );
 	joint->motorJoint.maxSpringForce = b2MaxFloat( 0.0f, maxForce );
 }
 
@@ -121,7 +121,7 @@ float b2MotorJoint_GetMaxSpringForce( b2JointId jointId )
 
 void b2MotorJoint_SetMaxSpringTorque( b2JointId jointId, float maxTorque )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_motorJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_motorJoint );
 	joint->motorJoint.maxSpringTorque = b2MaxFloat( 0.0f, maxTorque );
 }
 
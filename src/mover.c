@@ -1,9 +1,21 @@
 // SPDX-FileCopyrightText: 2025 Erin Catto
 // SPDX-License-Identifier: MIT
 
+#include "mover.h"
+
+#include "core.h"
+
 #include "box2d/collision.h"
 #include "box2d/constants.h"
 
+#if defined( B2_SIMD_AVX512 ) || defined( B2_SIMD_AVX2 ) || defined( B2_SIMD_SSE2 )
+#include <emmintrin.h>
+#elif defined( B2_SIMD_NEON )
+#include <arm_neon.h>
+#elif defined( B2_SIMD_WASM )
+#include <wasm_simd128.h>
+#endif
+
 b2PlaneSolverResult b2SolvePlanes( b2Vec2 targetDelta, b2CollisionPlane* planes, int count )
 {
 	for ( int i = 0; i < count; ++i )
@@ -53,6 +65,402 @@ b2PlaneSolverResult b2SolvePlanes( b2Vec2 targetDelta, b2CollisionPlane* planes,
 	};
 }
 
+// Collision planes of a mover packet stored as SoA. Missing planes have a zero normal and a zero
+// push limit so they never push.
+typedef struct b2PlanePacket
+{
+	float normalX[B2_MAX_MOVER_PLANES][B2_MOVER_PACKET_SIZE];
+	float normalY[B2_MAX_MOVER_PLANES][B2_MOVER_PACKET_SIZE];
+	float offset[B2_MAX_MOVER_PLANES][B2_MOVER_PACKET_SIZE];
+	float pushLimit[B2_MAX_MOVER_PLANES][B2_MOVER_PACKET_SIZE];
+	float push[B2_MAX_MOVER_PLANES][B2_MOVER_PACKET_SIZE];
+} b2PlanePacket;
+
+#if defined( B2_SIMD_AVX512 ) || defined( B2_SIMD_AVX2 ) || defined( B2_SIMD_SSE2 )
+
+typedef __m128 b2FloatP;
+
+static inline b2FloatP b2LoadP( const float* a )
+{
+	return _mm_loadu_ps( a );
+}
+
+static inline void b2StoreP( float* a, b2FloatP b )
+{
+	_mm_storeu_ps( a, b );
+}
+
+static inline b2FloatP b2SplatP( float a )
+{
+	return _mm_set1_ps( a );
+}
+
+static inline b2FloatP b2AddP( b2FloatP a, b2FloatP b )
+{
+	return _mm_add_ps( a, b );
+}
+
+static inline b2FloatP b2SubP( b2FloatP a, b2FloatP b )
+{
+	return _mm_sub_ps( a, b );
+}
+
+static inline b2FloatP b2MulP( b2FloatP a, b2FloatP b )
+{
+	return _mm_mul_ps( a, b );
+}
+
+static inline b2FloatP b2AbsP( b2FloatP a )
+{
+	return _mm_andnot_ps( _mm_set1_ps( -0.0f ), a );
+}
+
+// Same as b2ClampFloat for each lane, including the sign of zero
+static inline b2FloatP b2ClampP( b2FloatP a, b2FloatP lower, b2FloatP upper )
+{
+	__m128 belowMask = _mm_cmplt_ps( a, lower );
+	__m128 aboveMask = _mm_cmpgt_ps( a, upper );
+	__m128 r = _mm_or_ps( _mm_and_ps( aboveMask, upper ), _mm_andnot_ps( aboveMask, a ) );
+	return _mm_or_ps( _mm_and_ps( belowMask, lower ), _mm_andnot_ps( belowMask, r ) );
+}
+
+// Returns a in lanes where the mask is set and b elsewhere
+static inline b2FloatP b2SelectP( int mask, b2FloatP a, b2FloatP b )
+{
+	__m128i bits = _mm_and_si128( _mm_set1_epi32( mask ), _mm_setr_epi32( 1, 2, 4, 8 ) );
+	__m128 m = _mm_castsi128_ps( _mm_cmpeq_epi32( bits, _mm_setr_epi32( 1, 2, 4, 8 ) ) );
+	return _mm_or_ps( _mm_and_ps( m, a ), _mm_andnot_ps( m, b ) );
+}
+
+static inline int b2LessMaskP( b2FloatP a, b2FloatP b )
+{
+	return _mm_movemask_ps( _mm_cmplt_ps( a, b ) );
+}
+
+#elif defined( B2_SIMD_NEON )
+
+typedef float32x4_t b2FloatP;
+
+static inline b2FloatP b2LoadP( const float* a )
+{
+	return vld1q_f32( a );
+}
+
+static inline void b2StoreP( float* a, b2FloatP b )
+{
+	vst1q_f32( a, b );
+}
+
+static inline b2FloatP b2SplatP( float a )
+{
+	return vdupq_n_f32( a );
+}
+
+static inline b2FloatP b2AddP( b2FloatP a, b2FloatP b )
+{
+	return vaddq_f32( a, b );
+}
+
+static inline b2FloatP b2SubP( b2FloatP a, b2FloatP b )
+{
+	return vsubq_f32( a, b );
+}
+
+static inline b2FloatP b2MulP( b2FloatP a, b2FloatP b )
+{
+	return vmulq_f32( a, b );
+}
+
+static inline b2FloatP b2AbsP( b2FloatP a )
+{
+	return vabsq_f32( a );
+}
+
+// Same as b2ClampFloat for each lane, including the sign of zero
+static inline b2FloatP b2ClampP( b2FloatP a, b2FloatP lower, b2FloatP upper )
+{
+	b2FloatP r = vbslq_f32( vcgtq_f32( a, upper ), upper, a );
+	return vbslq_f32( vcltq_f32( a, lower ), lower, r );
+}
+
+// Returns a in lanes where the mask is set and b elsewhere
+static inline b2FloatP b2SelectP( int mask, b2FloatP a, b2FloatP b )
+{
+	static const uint32_t laneBits[4] = { 1, 2, 4, 8 };
+	uint32x4_t bits = vld1q_u32( laneBits );
+	uint32x4_t m = vceqq_u32( vandq_u32( vdupq_n_u32( (uint32_t)mask ), bits ), bits );
+	return vbslq_f32( m, a, b );
+}
+
+static inline int b2LessMaskP( b2FloatP a, b2FloatP b )
+{
+	uint32x4_t m = vcltq_f32( a, b );
+	return (int)( ( vgetq_lane_u32( m, 0 ) & 1 ) | ( vgetq_lane_u32( m, 1 ) & 2 ) | ( vgetq_lane_u32( m, 2 ) & 4 ) |
+				  ( vgetq_lane_u32( m, 3 ) & 8 ) );
+}
+
+#elif defined( B2_SIMD_WASM )
+
+typedef v128_t b2FloatP;
+
+static inline b2FloatP b2LoadP( const float* a )
+{
+	return wasm_v128_load( a );
+}
+
+static inline void b2StoreP( float* a, b2FloatP b )
+{
+	wasm_v128_store( a, b );
+}
+
+static inline b2FloatP b2SplatP( float a )
+{
+	return wasm_f32x4_splat( a );
+}
+
+static inline b2FloatP b2AddP( b2FloatP a, b2FloatP b )
+{
+	return wasm_f32x4_add( a, b );
+}
+
+static inline b2FloatP b2SubP( b2FloatP a, b2FloatP b )
+{
+	return wasm_f32x4_sub( a, b );
+}
+
+static inline b2FloatP b2MulP( b2FloatP a, b2FloatP b )
+{
+	return wasm_f32x4_mul( a, b );
+}
+
+static inline b2FloatP b2AbsP( b2FloatP a )
+{
+	return wasm_f32x4_abs( a );
+}
+
+// Same as b2ClampFloat for each lane, including the sign of zero
+static inline b2FloatP b2ClampP( b2FloatP a, b2FloatP lower, b2FloatP upper )
+{
+	v128_t r = wasm_v128_bitselect( upper, a, wasm_f32x4_gt( a, upper ) );
+	return wasm_v128_bitselect( lower, r, wasm_f32x4_lt( a, lower ) );
+}
+
+// Returns a in lanes where the mask is set and b elsewhere
+static inline b2FloatP b2SelectP( int mask, b2FloatP a, b2FloatP b )
+{
+	v128_t bits = wasm_i32x4_make( 1, 2, 4, 8 );
+	v128_t m = wasm_i32x4_eq( wasm_v128_and( wasm_i32x4_splat( mask ), bits ), bits );
+	return wasm_v128_bitselect( a, b, m );
+}
+
+static inline int b2LessMaskP( b2FloatP a, b2FloatP b )
+{
+	return (int)wasm_i32x4_bitmask( wasm_f32x4_lt( a, b ) );
+}
+
+#else
+
+typedef struct b2FloatP
+{
+	float x[4];
+} b2FloatP;
+
+static inline b2FloatP b2LoadP( const float* a )
+{
+	return (b2FloatP){ { a[0], a[1], a[2], a[3] } };
+}
+
+static inline void b2StoreP( float* a, b2FloatP b )
+{
+	for ( int i = 0; i < 4; ++i )
+	{
+		a[i] = b.x[i];
+	}
+}
+
+static inline b2FloatP b2SplatP( float a )
+{
+	return (b2FloatP){ { a, a, a, a } };
+}
+
+static inline b2FloatP b2AddP( b2FloatP a, b2FloatP b )
+{
+	return (b2FloatP){ { a.x[0] + b.x[0], a.x[1] + b.x[1], a.x[2] + b.x[2], a.x[3] + b.x[3] } };
+}
+
+static inline b2FloatP b2SubP( b2FloatP a, b2FloatP b )
+{
+	return (b2FloatP){ { a.x[0] - b.x[0], a.x[1] - b.x[1], a.x[2] - b.x[2], a.x[3] - b.x[3] } };
+}
+
+static inline b2FloatP b2MulP( b2FloatP a, b2FloatP b )
+{
+	return (b2FloatP){ { a.x[0] * b.x[0], a.x[1] * b.x[1], a.x[2] * b.x[2], a.x[3] * b.x[3] } };
+}
+
+static inline b2FloatP b2AbsP( b2FloatP a )
+{
+	return (b2FloatP){ { b2AbsFloat( a.x[0] ), b2AbsFloat( a.x[1] ), b2AbsFloat( a.x[2] ), b2AbsFloat( a.x[3] ) } };
+}
+
+static inline b2FloatP b2ClampP( b2FloatP a, b2FloatP lower, b2FloatP upper )
+{
+	b2FloatP r;
+	for ( int i = 0; i < 4; ++i )
+	{
+		r.x[i] = b2ClampFloat( a.x[i], lower.x[i], upper.x[i] );
+	}
+	return r;
+}
+
+static inline b2FloatP b2SelectP( int mask, b2FloatP a, b2FloatP b )
+{
+	b2FloatP r;
+	for ( int i = 0; i < 4; ++i )
+	{
+		r.x[i] = ( mask & ( 1 << i ) ) ? a.x[i] : b.x[i];
+	}
+	return r;
+}
+
+static inline int b2LessMaskP( b2FloatP a, b2FloatP b )
+{
+	int mask = 0;
+	for ( int i = 0; i < 4; ++i )
+	{
+		mask |= (int)( a.x[i] < b.x[i] ) << i;
+	}
+	return mask;
+}
+
+#endif
+
+void b2SolvePlanesWide( const b2Vec2* targetDeltas, b2CollisionPlane* const* planes, const int* counts, int moverCount,
+						b2PlaneSolverResult* results )
+{
+	B2_ASSERT( 0 < moverCount && moverCount <= B2_MOVER_PACKET_SIZE );
+
+	b2PlanePacket packet;
+	float deltaX[B2_MOVER_PACKET_SIZE] = { 0 };
+	float deltaY[B2_MOVER_PACKET_SIZE] = { 0 };
+	int planeMasks[B2_MAX_MOVER_PLANES] = { 0 };
+	int maxCount = 0;
+
+	for ( int lane = 0; lane < B2_MOVER_PACKET_SIZE; ++lane )
+	{
+		int count = lane < moverCount ? counts[lane] : 0;
+		B2_ASSERT( count <= B2_MAX_MOVER_PLANES );
+		maxCount = b2MaxInt( maxCount, count );
+
+		for ( int i = 0; i < count; ++i )
+		{
+			planeMasks[i] |= 1 << lane;
+		}
+
+		if ( lane < moverCount )
+		{
+			deltaX[lane] = targetDeltas[lane].x;
+			deltaY[lane] = targetDeltas[lane].y;
+		}
+
+		for ( int i = 0; i < B2_MAX_MOVER_PLANES; ++i )
+		{
+			if ( i < count )
+			{
+				const b2CollisionPlane* plane = planes[lane] + i;
+				packet.normalX[i][lane] = plane->plane.normal.x;
+				packet.normalY[i][lane] = plane->plane.normal.y;
+				packet.offset[i][lane] = plane->plane.offset;
+				packet.pushLimit[i][lane] = plane->pushLimit;
+			}
+			else
+			{
+				packet.normalX[i][lane] = 0.0f;
+				packet.normalY[i][lane] = 0.0f;
+				packet.offset[i][lane] = 0.0f;
+				packet.pushLimit[i][lane] = 0.0f;
+			}
+
+			packet.push[i][lane] = 0.0f;
+		}
+	}
+
+	b2FloatP dx = b2LoadP( deltaX );
+	b2FloatP dy = b2LoadP( deltaY );
+	b2FloatP zero = b2SplatP( 0.0f );
+	b2FloatP slop = b2SplatP( B2_LINEAR_SLOP );
+	b2FloatP tolerance = b2SplatP( B2_LINEAR_SLOP );
+
+	// Lanes stop iterating as they converge, like the early out in b2SolvePlanes
+	int iterationCounts[B2_MOVER_PACKET_SIZE] = { 0 };
+	int activeMask = ( 1 << moverCount ) - 1;
+
+	int iteration;
+	for ( iteration = 0; iteration < 20 && activeMask != 0; ++iteration )
+	{
+		b2FloatP totalPush = zero;
+		for ( int i = 0; i < maxCount; ++i )
+		{
+			// Only update lanes that have this plane so padding cannot flip the sign of a zero delta
+			int laneMask = activeMask & planeMasks[i];
+			b2FloatP nx = b2LoadP( packet.normalX[i] );
+			b2FloatP ny = b2LoadP( packet.normalY[i] );
+
+			// Add slop to prevent jitter
+			b2FloatP separation =
+				b2AddP( b2SubP( b2AddP( b2MulP( nx, dx ), b2MulP( ny, dy ) ), b2LoadP( packet.offset[i] ) ), slop );
+			b2FloatP push = b2SubP( zero, separation );
+
+			// Clamp accumulated push
+			b2FloatP accumulatedPush = b2LoadP( packet.push[i] );
+			b2FloatP newPush = b2ClampP( b2AddP( accumulatedPush, push ), zero, b2LoadP( packet.pushLimit[i] ) );
+			newPush = b2SelectP( laneMask, newPush, accumulatedPush );
+			b2StoreP( packet.push[i], newPush );
+			push = b2SubP( newPush, accumulatedPush );
+
+			dx = b2SelectP( laneMask, b2AddP( dx, b2MulP( push, nx ) ), dx );
+			dy = b2SelectP( laneMask, b2AddP( dy, b2MulP( push, ny ) ), dy );
+
+			totalPush = b2AddP( totalPush, b2AbsP( push ) );
+		}
+
+		int convergedMask = b2LessMaskP( totalPush, tolerance ) & activeMask;
+		for ( int lane = 0; lane < moverCount; ++lane )
+		{
+			if ( convergedMask & ( 1 << lane ) )
+			{
+				iterationCounts[lane] = iteration;
+			}
+		}
+
+		activeMask &= ~convergedMask;
+	}
+
+	for ( int lane = 0; lane < moverCount; ++lane )
+	{
+		if ( activeMask & ( 1 << lane ) )
+		{
+			iterationCounts[lane] = iteration;
+		}
+	}
+
+	b2StoreP( deltaX, dx );
+	b2StoreP( deltaY, dy );
+
+	for ( int lane = 0; lane < moverCount; ++lane )
+	{
+		for ( int i = 0; i < counts[lane]; ++i )
+		{
+			planes[lane][i].push = packet.push[i][lane];
+		}
+
+		results[lane] = (b2PlaneSolverResult){
+			.translation = { deltaX[lane], deltaY[lane] },
+			.iterationCount = iterationCounts[lane],
+		};
+	}
+}
+
 b2Vec2 b2ClipVector( b2Vec2 vector, const b2CollisionPlane* planes, int count )
 {
 	b2Vec2 v = vector;
@@ -0,0 +1,18 @@
+// SPDX-FileCopyrightText: 2025 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "box2d/collision.h"
+
+// The number of movers solved together by b2SolvePlanesWide
+#define B2_MOVER_PACKET_SIZE 4
+
+// The collision plane capacity of each mover in the batched mover solver
+#define B2_MAX_MOVER_PLANES 8
+
+// Solve the planes of up to B2_MOVER_PACKET_SIZE movers at once with SIMD, one mover per lane. Each
+// mover has at most B2_MAX_MOVER_PLANES planes. The result and the plane pushes are identical
+// to calling b2SolvePlanes for each mover.
+void b2SolvePlanesWide( const b2Vec2* targetDeltas, b2CollisionPlane* const* planes, const int* counts, int moverCount,
+						b2PlaneSolverResult* results );
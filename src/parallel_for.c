@@ -9,7 +9,9 @@
 
 #include "box2d/base.h"
 #include "box2d/constants.h"
+#include "box2d/math_functions.h"
 
+#include <stdbool.h>
 #include <stddef.h>
 
 // Shared state for one b2ParallelFor invocation. Workers race on nextBlock to
@@ -22,14 +24,34 @@ typedef struct b2ParallelForShared
 	int itemCount;
 	b2ParallelForCallback* callback;
 	void* context;
+	bool measure;
 } b2ParallelForShared;
 
 typedef struct b2ParallelForTask
 {
 	b2ParallelForShared* shared;
 	int workerIndex;
+
+	// Timing of this task, only measured with adaptive blocks
+	uint64_t workTicks;
+	uint64_t spanTicks;
+	uint64_t endTicks;
+	int blockCount;
 } b2ParallelForTask;
 
+// Adaptive block sizing only adjusts a call site after this many calls
+#define B2_ADAPTIVE_BLOCK_WINDOW 8
+
+// Blocks that run shorter than this on average are dominated by the claim overhead. In microseconds.
+#define B2_MIN_BLOCK_TIME 4.0
+
+// Minimum number of blocks per task with automatic worker counts
+#define B2_AUTO_BLOCKS_PER_TASK 2
+
+// Limits of the block size shift of a call site
+#define B2_MIN_BLOCK_SHIFT -2
+#define B2_MAX_BLOCK_SHIFT 4
+
 static void b2ParallelForTrampoline( void* taskContext )
 {
 	b2ParallelForTask* task = taskContext;
@@ -41,6 +63,9 @@ static void b2ParallelForTrampoline( void* taskContext )
 	int blockCount = shared->blockCount;
 	int blockSize = shared->blockSize;
 	int itemCount = shared->itemCount;
+	bool measure = shared->measure;
+
+	uint64_t spanStart = measure ? b2GetTicks() : 0;
 
 	for ( ;; )
 	{
@@ -57,11 +82,89 @@ static void b2ParallelForTrampoline( void* taskContext )
 			end = itemCount;
 		}
 
-		callback( start, end, workerIndex, context );
+		if ( measure )
+		{
+			uint64_t ticks = b2GetTicks();
+			callback( start, end, workerIndex, context );
+			task->workTicks += b2GetTicks() - ticks;
+			task->blockCount += 1;
+		}
+		else
+		{
+			callback( start, end, workerIndex, context );
+		}
+	}
+
+	if ( measure )
+	{
+		task->endTicks = b2GetTicks();
+		task->spanTicks = task->endTicks - spanStart;
+	}
+}
+
+static b2ParallelForSite* b2GetParallelForSite( b2World* world, b2ParallelForCallback* callback, const char* siteName )
+{
+	for ( int i = 0; i < world->parallelForSiteCount; ++i )
+	{
+		if ( world->parallelForSites[i].callback == callback )
+		{
+			return world->parallelForSites + i;
+		}
+	}
+
+	if ( world->parallelForSiteCount == B2_MAX_PARALLEL_FOR_SITES )
+	{
+		return NULL;
+	}
+
+	// Names come from the address-of expression in some calls
+	if ( siteName[0] == '&' )
+	{
+		siteName += 1;
+	}
+
+	b2ParallelForSite* site = world->parallelForSites + world->parallelForSiteCount;
+	world->parallelForSiteCount += 1;
+	*site = (b2ParallelForSite){ 0 };
+	site->callback = callback;
+	site->name = siteName;
+	return site;
+}
+
+// Looks at the last few calls of a site. Blocks that are short compared to the time workers spend
+// claiming them are merged. Workers that sit idle while others finish their blocks get smaller blocks.
+static void b2AdjustBlockShift( b2ParallelForSite* site, int workerCount )
+{
+	if ( site->windowCallCount < B2_ADAPTIVE_BLOCK_WINDOW )
+	{
+		return;
+	}
+
+	double microsecondsPerTick = 1000.0 * b2GetMillisecondsPerTick();
+	double blockTime = microsecondsPerTick * (double)site->windowWorkTicks / (double)b2MaxInt( 1, site->windowBlockCount );
+	double claimFraction = (double)site->windowClaimTicks / (double)( site->windowWorkTicks + 1 );
+	double waitFraction = (double)site->windowWaitTicks / (double)( site->windowSpanTicks + site->windowWaitTicks + 1 );
+	int blocksPerCall = site->windowBlockCount / site->windowCallCount;
+
+	if ( blockTime < B2_MIN_BLOCK_TIME || claimFraction > 0.1 )
+	{
+		site->blockShift = b2MinInt( site->blockShift + 1, B2_MAX_BLOCK_SHIFT );
 	}
+	else if ( waitFraction > 0.25 && blockTime > 4.0 * B2_MIN_BLOCK_TIME && blocksPerCall < 8 * workerCount )
+	{
+		site->blockShift = b2MaxInt( site->blockShift - 1, B2_MIN_BLOCK_SHIFT );
+	}
+
+	site->windowCallCount = 0;
+	site->windowBlockCount = 0;
+	site->windowWorkTicks = 0;
+	site->windowClaimTicks = 0;
+	site->windowWaitTicks = 0;
+	site->windowSpanTicks = 0;
 }
 
-void b2ParallelFor( b2World* world, b2ParallelForCallback* callback, int itemCount, int minRange, void* context )
+void b2RunParallelFor( b2World* world, b2ParallelForCallback* callback, const char* siteName, int itemCount, int minRange,
+					   void* context )
 {
 	if ( itemCount <= 0 )
 	{
@@ -77,6 +180,26 @@ void b2ParallelFor( b2World* world, b2ParallelForCallback* callback, int itemCou
 	// block size grows once items exceed maxBlockCount * minRange
 	// so the block count stays bounded and per-block sync overhead stays low.
 	int blocksPerWorker = 4;
+
+	b2ParallelForSite* site = NULL;
+	if ( world->enableAdaptiveBlocks )
+	{
+		site = b2GetParallelForSite( world, callback, siteName );
+	}
+
+	if ( site != NULL )
+	{
+		if ( site->blockShift > 0 )
+		{
+			minRange <<= site->blockShift;
+		}
+		else
+		{
+			blocksPerWorker <<= -site->blockShift;
+			minRange = b2MaxInt( 1, minRange >> -site->blockShift );
+		}
+	}
+
 	int maxBlockCount = blocksPerWorker * workerCount;
 
 	int blockSize;
@@ -97,24 +220,38 @@ void b2ParallelFor( b2World* world, b2ParallelForCallback* callback, int itemCou
 	// No point enqueueing more tasks than blocks.
 	int taskCount = workerCount < blockCount ? workerCount : blockCount;
 
+	// With automatic worker counts each task should get a few blocks, otherwise the fork and join
+	// costs more than the work that is spread out
+	if ( world->enableAutoWorkers )
+	{
+		taskCount = b2ClampInt( blockCount / B2_AUTO_BLOCKS_PER_TASK, 1, taskCount );
+	}
+
 	b2ParallelForShared shared;
 	shared.blockCount = blockCount;
 	shared.blockSize = blockSize;
 	shared.itemCount = itemCount;
 	shared.callback = callback;
 	shared.context = context;
+	shared.measure = site != NULL;
 	b2AtomicStoreInt( &shared.nextBlock, 0 );
 
+	uint64_t wallStart = site != NULL ? b2GetTicks() : 0;
+
 	b2ParallelForTask tasks[B2_MAX_WORKERS];
 	void* handles[B2_MAX_WORKERS];
 	for ( int i = 0; i < taskCount; ++i )
 	{
-		tasks[i].shared = &shared;
-		tasks[i].workerIndex = i;
+		tasks[i] = (b2ParallelForTask){ .shared = &shared, .workerIndex = i };
 
 		if (world->taskCount < B2_MAX_TASKS)
 		{
-			handles[i] = world->enqueueTaskFcn( &b2ParallelForTrampoline, tasks + i, world->userTaskContext );
+			b2TaskInfo info = {
+				.name = siteName[0] == '&' ? siteName + 1 : siteName,
+				.priority = b2_taskPriorityNormal,
+				.expectedCost = itemCount / taskCount,
+			};
+			handles[i] = b2EnqueueTask( world, &b2ParallelForTrampoline, tasks + i, &info );
 			world->taskCount += 1;
 		}
 		else
@@ -131,4 +268,62 @@ void b2ParallelFor( b2World* world, b2ParallelForCallback* callback, int itemCou
 			world->finishTaskFcn( handles[i], world->userTaskContext );
 		}
 	}
+
+	if ( site == NULL )
+	{
+		return;
+	}
+
+	uint64_t wallTicks = b2GetTicks() - wallStart;
+	uint64_t workTicks = 0;
+	uint64_t spanTicks = 0;
+	uint64_t lastEndTicks = 0;
+	for ( int i = 0; i < taskCount; ++i )
+	{
+		workTicks += tasks[i].workTicks;
+		spanTicks += tasks[i].spanTicks;
+		lastEndTicks = tasks[i].endTicks > lastEndTicks ? tasks[i].endTicks : lastEndTicks;
+	}
+
+	// Claim time is spent inside the tasks between blocks. Wait time is spent by tasks that ran out of
+	// blocks while another task was still running its last block, which smaller blocks would reduce.
+	uint64_t claimTicks = spanTicks > workTicks ? spanTicks - workTicks : 0;
+	uint64_t waitTicks = 0;
+	for ( int i = 0; i < taskCount; ++i )
+	{
+		waitTicks += lastEndTicks - tasks[i].endTicks;
+	}
+
+	site->windowCallCount += 1;
+	site->windowBlockCount += blockCount;
+	site->windowWorkTicks += workTicks;
+	site->windowClaimTicks += claimTicks;
+	site->windowWaitTicks += waitTicks;
+	site->windowSpanTicks += spanTicks;
+
+	site->callCount += 1;
+	site->itemCount += itemCount;
+	site->blockCount += blockCount;
+	site->blockSize = blockSize;
+	site->wallTicks += wallTicks;
+	site->workTicks += workTicks;
+	site->claimTicks += claimTicks;
+	site->waitTicks += waitTicks;
+
+	b2AdjustBlockShift( site, workerCount );
+}
+
+void b2ResetParallelForProfile( b2World* world )
+{
+	for ( int i = 0; i < world->parallelForSiteCount; ++i )
+	{
+		b2ParallelForSite* site = world->parallelForSites + i;
+		site->callCount = 0;
+		site->itemCount = 0;
+		site->blockCount = 0;
+		site->wallTicks = 0;
+		site->workTicks = 0;
+		site->claimTicks = 0;
+		site->waitTicks = 0;
+	}
 }
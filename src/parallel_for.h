@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <stdint.h>
+
 typedef struct b2World b2World;
 
 // Callback invoked by b2ParallelFor to process a range of items. May be called
@@ -13,10 +15,51 @@ typedef struct b2World b2World;
 // an index into per-worker state (e.g. world->taskContexts.data + workerIndex).
 typedef void b2ParallelForCallback( int startIndex, int endIndex, int workerIndex, void* context );
 
+// Maximum number of b2ParallelFor call sites tracked by adaptive block sizing
+#define B2_MAX_PARALLEL_FOR_SITES 32
+
+// Adaptive block sizing state and telemetry of one b2ParallelFor call site, identified by its callback.
+// See b2WorldDef::enableAdaptiveBlocks.
+typedef struct b2ParallelForSite
+{
+	b2ParallelForCallback* callback;
+	const char* name;
+
+	// The minimum block size is scaled by 2^blockShift. Negative shifts also allow more blocks per worker.
+	int blockShift;
+
+	// Sums over the calls since the last adjustment
+	int windowCallCount;
+	int windowBlockCount;
+	uint64_t windowWorkTicks;
+	uint64_t windowClaimTicks;
+	uint64_t windowWaitTicks;
+	uint64_t windowSpanTicks;
+
+	// Sums over the calls since the start of the last step, see b2ParallelForProfile
+	int callCount;
+	int itemCount;
+	int blockCount;
+	int blockSize;
+	uint64_t wallTicks;
+	uint64_t workTicks;
+	uint64_t claimTicks;
+	uint64_t waitTicks;
+} b2ParallelForSite;
+
 // Divide [0, itemCount) into blocks and process them with cooperative claiming:
 // up to world->workerCount tasks are enqueued, and each task loops, atomically
 // claiming the next unclaimed block until the range is drained. Blocks the
 // caller until all work is complete. minRange is the minimum block size; block
 // size grows once itemCount exceeds 4 * workerCount * minRange so block count
-// stays bounded.
-void b2ParallelFor( b2World* world, b2ParallelForCallback* callback, int itemCount, int minRange, void* context );
+// stays bounded. With adaptive blocks the minimum block size and the block count
+// limit of each call site are tuned from the timing of its previous calls.
+// siteName labels the call site in the profile, b2ParallelFor uses the callback name.
+void b2RunParallelFor( b2World* world, b2ParallelForCallback* callback, const char* siteName, int itemCount, int minRange,
+					   void* context );
+
+#define b2ParallelFor( world, callback, itemCount, minRange, context )                                                   \
+	b2RunParallelFor( world, callback, #callback, itemCount, minRange, context )
+
+// Clears the per step telemetry of the call sites
+void b2ResetParallelForProfile( b2World* world );
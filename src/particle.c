@@ -0,0 +1,703 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#include "particle.h"
+
+#include "body.h"
+#include "core.h"
+#include "ctz.h"
+#include "parallel_for.h"
+#include "physics_world.h"
+#include "shape.h"
+#include "solver.h"
+#include "solver_set.h"
+
+#include "box2d/box2d.h"
+#include "box2d/collision.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+// Particles are position based. Each step integrates gravity, pushes overlapping particles apart using
+// their predicted positions and then projects them out of the shapes. The velocity is the resulting
+// displacement over the time step. Particles never enter the contact solver. Instead the momentum
+// they lose against an awake dynamic body is handed to that body after the solver.
+
+// The body a particle pushed against the hardest in this step
+typedef struct b2ParticleHit
+{
+	// B2_NULL_INDEX if the particle didn't touch an awake dynamic body
+	int bodyId;
+	b2Vec2 point;
+
+	// Points from the body to the particle
+	b2Vec2 normal;
+
+	// Normal momentum the particle lost against the body
+	float impulse;
+} b2ParticleHit;
+
+typedef struct b2ParticleStepContext
+{
+	b2World* world;
+	const b2ParticleDef* groups;
+	const int* groupIndices;
+
+	// Positions at the start of the step and after integration, in cell order
+	const b2Vec2* origins;
+	const b2Vec2* predicted;
+
+	// In cell order. The velocities are integrated on input and final on output.
+	b2Vec2* positions;
+	b2Vec2* velocities;
+	b2ParticleHit* hits;
+
+	// Particles of bucket i are [cellStarts[i], cellStarts[i + 1])
+	const int* cellStarts;
+	int cellMask;
+	float inverseCellSize;
+
+	float inv_dt;
+	float maxSpeed;
+} b2ParticleStepContext;
+
+typedef struct b2ParticleQueryContext
+{
+	b2World* world;
+	b2Filter filter;
+	b2Vec2 origin;
+	b2Vec2 position;
+	float radius;
+
+	// Sum of all pushes, scales the friction
+	float pushSum;
+
+	// The deepest push sets the friction normal and surface velocity
+	float maxPush;
+	b2Vec2 normal;
+	b2Vec2 surfaceVelocity;
+
+	float maxBodyPush;
+	b2ParticleHit hit;
+} b2ParticleQueryContext;
+
+static inline int b2ParticleCoordinate( float x, float inverseCellSize )
+{
+	// clamp to keep the conversion defined for particles that escaped far away
+	float cell = b2ClampFloat( floorf( x * inverseCellSize ), -1.0e9f, 1.0e9f );
+	return (int)cell;
+}
+
+static inline int b2ParticleBucket( int x, int y, int bucketMask )
+{
+	uint32_t hash = ( (uint32_t)x * 73856093u ) ^ ( (uint32_t)y * 19349663u );
+	return (int)( hash & (uint32_t)bucketMask );
+}
+
+void b2CreateParticleSystem( b2ParticleSystem* system )
+{
+	b2Array_Create( system->positions );
+	b2Array_Create( system->velocities );
+	b2Array_Create( system->lifetimes );
+	b2Array_Create( system->groupIndices );
+	b2Array_Create( system->groups );
+	system->maxRadius = 0.0f;
+}
+
+void b2DestroyParticleSystem( b2ParticleSystem* system )
+{
+	b2Array_Destroy( system->positions );
+	b2Array_Destroy( system->velocities );
+	b2Array_Destroy( system->lifetimes );
+	b2Array_Destroy( system->groupIndices );
+	b2Array_Destroy( system->groups );
+	system->maxRadius = 0.0f;
+}
+
+int b2GetParticleSystemBytes( const b2ParticleSystem* system )
+{
+	return b2Array_ByteCount( system->positions ) + b2Array_ByteCount( system->velocities ) +
+		   b2Array_ByteCount( system->lifetimes ) + b2Array_ByteCount( system->groupIndices ) +
+		   b2Array_ByteCount( system->groups );
+}
+
+// Removes expired particles, keeping the order of the others
+static void b2ExpireParticles( b2ParticleSystem* system, float timeStep )
+{
+	int count = system->positions.count;
+	b2Vec2* positions = system->positions.data;
+	b2Vec2* velocities = system->velocities.data;
+	float* lifetimes = system->lifetimes.data;
+	int* groupIndices = system->groupIndices.data;
+
+	int writeIndex = 0;
+	for ( int i = 0; i < count; ++i )
+	{
+		if ( lifetimes[i] != FLT_MAX )
+		{
+			lifetimes[i] -= timeStep;
+			if ( lifetimes[i] <= 0.0f )
+			{
+				continue;
+			}
+		}
+
+		positions[writeIndex] = positions[i];
+		velocities[writeIndex] = velocities[i];
+		lifetimes[writeIndex] = lifetimes[i];
+		groupIndices[writeIndex] = groupIndices[i];
+		writeIndex += 1;
+	}
+
+	system->positions.count = writeIndex;
+	system->velocities.count = writeIndex;
+	system->lifetimes.count = writeIndex;
+	system->groupIndices.count = writeIndex;
+
+	if ( writeIndex == 0 )
+	{
+		b2Array_Clear( system->groups );
+		system->maxRadius = 0.0f;
+	}
+}
+
+// Jacobi pass: each particle moves half of the overlap with each neighbor using the predicted
+// positions of the neighbors, so the result doesn't depend on the processing order.
+static b2Vec2 b2SeparateParticle( const b2ParticleStepContext* context, int index )
+{
+	const b2Vec2* predicted = context->predicted;
+	const b2ParticleDef* groups = context->groups;
+	const int* groupIndices = context->groupIndices;
+	const int* cellStarts = context->cellStarts;
+
+	b2Vec2 p = predicted[index];
+	float radius = groups[groupIndices[index]].radius;
+	int cellX = b2ParticleCoordinate( p.x, context->inverseCellSize );
+	int cellY = b2ParticleCoordinate( p.y, context->inverseCellSize );
+
+	// Neighboring cells may share a bucket
+	int buckets[9];
+	int bucketCount = 0;
+
+	b2Vec2 delta = b2Vec2_zero;
+	int neighborCount = 0;
+	for ( int y = cellY - 1; y <= cellY + 1; ++y )
+	{
+		for ( int x = cellX - 1; x <= cellX + 1; ++x )
+		{
+			int bucket = b2ParticleBucket( x, y, context->cellMask );
+
+			bool visited = false;
+			for ( int k = 0; k < bucketCount; ++k )
+			{
+				visited = visited || buckets[k] == bucket;
+			}
+
+			if ( visited )
+			{
+				continue;
+			}
+
+			buckets[bucketCount++] = bucket;
+
+			int end = cellStarts[bucket + 1];
+			for ( int j = cellStarts[bucket]; j < end; ++j )
+			{
+				const b2ParticleDef* other = groups + groupIndices[j];
+				if ( j == index || other->enableParticleCollision == false )
+				{
+					continue;
+				}
+
+				b2Vec2 d = b2Sub( p, predicted[j] );
+				float target = radius + other->radius;
+				float distanceSquared = b2Dot( d, d );
+				if ( distanceSquared >= target * target )
+				{
+					continue;
+				}
+
+				float distance = sqrtf( distanceSquared );
+				b2Vec2 normal;
+				if ( distance > FLT_EPSILON )
+				{
+					normal = b2MulSV( 1.0f / distance, d );
+				}
+				else
+				{
+					// coincident particles split along the x-axis by index
+					normal = index < j ? (b2Vec2){ 1.0f, 0.0f } : (b2Vec2){ -1.0f, 0.0f };
+				}
+
+				delta = b2MulAdd( delta, 0.5f * ( target - distance ), normal );
+				neighborCount += 1;
+			}
+		}
+	}
+
+	if ( neighborCount == 0 )
+	{
+		return p;
+	}
+
+	// Averaging keeps a crowded particle from overshooting
+	return b2MulAdd( p, 1.0f / neighborCount, delta );
+}
+
+static bool b2ParticleQueryCallback( int proxyId, uint64_t userData, void* context )
+{
+	B2_UNUSED( proxyId );
+
+	b2ParticleQueryContext* queryContext = context;
+	b2World* world = queryContext->world;
+
+	int shapeId = (int)userData;
+	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+	if ( shape->sensorIndex != B2_NULL_INDEX || b2ShouldShapesCollide( shape->filter, queryContext->filter ) == false )
+	{
+		return true;
+	}
+
+	b2Transform transform = b2GetBodyTransform( world, shape->bodyId );
+	b2Vec2 p = queryContext->position;
+	float radius = queryContext->radius;
+
+	// Distance from the particle center to the core of the closest child, without the shape radius
+	b2DistanceInput input;
+	input.proxyB = b2MakeProxy( &p, 1, 0.0f );
+	input.transformA = transform;
+	input.transformB = b2Transform_identity;
+	input.useRadii = false;
+
+	float separation = FLT_MAX;
+	float coreDistance = FLT_MAX;
+	b2Vec2 normal = b2Vec2_zero;
+	b2Vec2 point = b2Vec2_zero;
+
+	int childCount = b2GetShapeChildCount( shape );
+	for ( int i = 0; i < childCount; ++i )
+	{
+		input.proxyA = b2MakeShapeChildProxy( shape, i );
+
+		b2SimplexCache cache = { 0 };
+		b2DistanceOutput output = b2ShapeDistance( &input, &cache, NULL, 0 );
+		float childSeparation = output.distance - input.proxyA.radius - radius;
+		if ( childSeparation < separation )
+		{
+			separation = childSeparation;
+			coreDistance = output.distance;
+			normal = output.normal;
+			point = b2MulAdd( output.pointA, input.proxyA.radius, output.normal );
+		}
+	}
+
+	// A particle that moved further than its radius may have passed through a thin shape
+	bool fastMove = b2DistanceSquared( p, queryContext->origin ) > radius * radius;
+	if ( separation >= 0.0f && fastMove == false )
+	{
+		return true;
+	}
+
+	// The closest point has no normal if the center is inside the shape and the wrong normal if the
+	// center went through a thin shape, such as a segment. Then go back to where the particle entered.
+	bool validNormal = coreDistance > 0.0f && separation < 0.0f;
+	b2Vec2 position;
+	if ( validNormal && b2Dot( b2Sub( queryContext->origin, point ), normal ) >= 0.0f )
+	{
+		position = b2MulAdd( p, -separation, normal );
+	}
+	else
+	{
+		b2RayCastInput rayInput;
+		rayInput.origin = queryContext->origin;
+		rayInput.translation = b2Sub( p, queryContext->origin );
+		rayInput.maxFraction = 1.0f;
+
+		b2CastOutput output = b2RayCastShape( &rayInput, shape, transform );
+		if ( output.hit )
+		{
+			normal = output.normal;
+			point = output.point;
+			position = b2MulAdd( point, radius, normal );
+		}
+		else if ( validNormal )
+		{
+			// the particle was already on the far side
+			position = b2MulAdd( p, -separation, normal );
+		}
+		else
+		{
+			return true;
+		}
+	}
+
+	float push = b2Distance( p, position );
+	queryContext->position = position;
+	queryContext->pushSum += push;
+
+	b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
+	b2BodyState* state = b2GetBodyState( world, body );
+	b2Vec2 surfaceVelocity = b2Vec2_zero;
+	if ( state != NULL )
+	{
+		b2BodySim* bodySim = b2GetBodySim( world, body );
+		b2Vec2 r = b2Sub( point, bodySim->center );
+		surfaceVelocity = b2Add( state->linearVelocity, b2CrossSV( state->angularVelocity, r ) );
+	}
+
+	if ( push > queryContext->maxPush )
+	{
+		queryContext->maxPush = push;
+		queryContext->normal = normal;
+		queryContext->surfaceVelocity = surfaceVelocity;
+	}
+
+	if ( state != NULL && body->type == b2_dynamicBody && push > queryContext->maxBodyPush )
+	{
+		queryContext->maxBodyPush = push;
+		queryContext->hit.bodyId = shape->bodyId;
+		queryContext->hit.point = point;
+		queryContext->hit.normal = normal;
+	}
+
+	return true;
+}
+
+static void b2SolveParticlesTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	B2_UNUSED( workerIndex );
+
+	b2TracyCZoneNC( particle_task, "Particles", b2_colorLightSeaGreen, true );
+
+	b2ParticleStepContext* stepContext = context;
+	b2World* world = stepContext->world;
+	float inv_dt = stepContext->inv_dt;
+	float maxSpeed = stepContext->maxSpeed;
+
+	for ( int index = startIndex; index < endIndex; ++index )
+	{
+		const b2ParticleDef* group = stepContext->groups + stepContext->groupIndices[index];
+		float radius = group->radius;
+		b2Vec2 predictedVelocity = stepContext->velocities[index];
+
+		b2ParticleQueryContext queryContext = { 0 };
+		queryContext.world = world;
+		queryContext.filter = group->filter;
+		queryContext.origin = stepContext->origins[index];
+		queryContext.radius = radius;
+		queryContext.hit.bodyId = B2_NULL_INDEX;
+
+		if ( group->enableParticleCollision )
+		{
+			queryContext.position = b2SeparateParticle( stepContext, index );
+		}
+		else
+		{
+			queryContext.position = stepContext->predicted[index];
+		}
+
+		b2AABB box;
+		box.lowerBound = b2Min( queryContext.origin, queryContext.position );
+		box.upperBound = b2Max( queryContext.origin, queryContext.position );
+		box.lowerBound = b2Sub( box.lowerBound, (b2Vec2){ radius, radius } );
+		box.upperBound = b2Add( box.upperBound, (b2Vec2){ radius, radius } );
+
+		uint64_t maskBits = b2GetFilterQueryMask( group->filter );
+		for ( int i = 0; i < b2_bodyTypeCount; ++i )
+		{
+			b2DynamicTree_Query( world->broadPhase.trees + i, box, maskBits, b2ParticleQueryCallback, &queryContext );
+		}
+
+		b2Vec2 v = b2MulSV( inv_dt, b2Sub( queryContext.position, queryContext.origin ) );
+
+		if ( queryContext.maxPush > 0.0f )
+		{
+			// Coulomb friction bounded by the normal push of this step
+			b2Vec2 normal = queryContext.normal;
+			b2Vec2 vr = b2Sub( v, queryContext.surfaceVelocity );
+			float vn = b2Dot( vr, normal );
+			b2Vec2 vt = b2MulSub( vr, vn, normal );
+			float tangentSpeed = b2Length( vt );
+			if ( tangentSpeed > 0.0f )
+			{
+				float maxFriction = group->friction * queryContext.pushSum * inv_dt;
+				float scale = b2MaxFloat( 0.0f, tangentSpeed - maxFriction ) / tangentSpeed;
+				vt = b2MulSV( scale, vt );
+			}
+
+			v = b2Add( queryContext.surfaceVelocity, b2MulAdd( vt, vn, normal ) );
+		}
+
+		float speedSquared = b2Dot( v, v );
+		if ( speedSquared > maxSpeed * maxSpeed )
+		{
+			v = b2MulSV( maxSpeed / sqrtf( speedSquared ), v );
+		}
+
+		if ( queryContext.hit.bodyId != B2_NULL_INDEX )
+		{
+			float mass = group->density * B2_PI * radius * radius;
+			float lostSpeed = b2Dot( b2Sub( v, predictedVelocity ), queryContext.hit.normal );
+			queryContext.hit.impulse = b2MaxFloat( 0.0f, mass * lostSpeed );
+		}
+
+		stepContext->positions[index] = queryContext.position;
+		stepContext->velocities[index] = v;
+		stepContext->hits[index] = queryContext.hit;
+	}
+
+	b2TracyCZoneEnd( particle_task );
+}
+
+// Gives the bodies the momentum the particles lost against them. Serial and in particle order so
+// the result is deterministic.
+static void b2ApplyParticleHits( b2World* world, const b2ParticleHit* hits, int count )
+{
+	for ( int i = 0; i < count; ++i )
+	{
+		const b2ParticleHit* hit = hits + i;
+		if ( hit->bodyId == B2_NULL_INDEX || hit->impulse == 0.0f )
+		{
+			continue;
+		}
+
+		b2Body* body = b2Array_Get( world->bodies, hit->bodyId );
+		b2BodyState* state = b2GetBodyState( world, body );
+		B2_ASSERT( state != NULL );
+		b2BodySim* bodySim = b2GetBodySim( world, body );
+
+		b2Vec2 r = b2Sub( hit->point, bodySim->center );
+		b2Vec2 impulse = b2MulSV( -hit->impulse, hit->normal );
+
+		b2Vec2 v = b2MulAdd( state->linearVelocity, bodySim->invMass, impulse );
+		float w = state->angularVelocity + bodySim->invInertia * b2Cross( r, impulse );
+		v.x = ( state->flags & b2_lockLinearX ) ? 0.0f : v.x;
+		v.y = ( state->flags & b2_lockLinearY ) ? 0.0f : v.y;
+		w = ( state->flags & b2_lockAngularZ ) ? 0.0f : w;
+		state->linearVelocity = v;
+		state->angularVelocity = w;
+	}
+}
+
+void b2StepParticles( b2World* world, b2StepContext* context )
+{
+	b2ParticleSystem* system = &world->particles;
+	float timeStep = context->dt;
+	B2_ASSERT( timeStep > 0.0f );
+
+	b2ExpireParticles( system, timeStep );
+
+	int count = system->positions.count;
+	if ( count == 0 )
+	{
+		return;
+	}
+
+	b2TracyCZoneNC( particles, "Particles", b2_colorLightSeaGreen, true );
+
+	b2Vec2* positions = system->positions.data;
+	b2Vec2* velocities = system->velocities.data;
+	float* lifetimes = system->lifetimes.data;
+	int* groupIndices = system->groupIndices.data;
+	const b2ParticleDef* groups = system->groups.data;
+
+	float inverseCellSize = 0.5f / system->maxRadius;
+	int bucketCount = b2RoundUpPowerOf2( 2 * count );
+	int bucketMask = bucketCount - 1;
+
+	b2Stack* stack = &world->stack;
+	int* buckets = b2StackAlloc( stack, count * sizeof( int ), "particle buckets" );
+	int* cellStarts = b2StackAlloc( stack, ( bucketCount + 1 ) * sizeof( int ), "particle cells" );
+	b2Vec2* origins = b2StackAlloc( stack, count * sizeof( b2Vec2 ), "particle origins" );
+	b2Vec2* predicted = b2StackAlloc( stack, count * sizeof( b2Vec2 ), "particle predicted" );
+	b2Vec2* sortedVelocities = b2StackAlloc( stack, count * sizeof( b2Vec2 ), "particle velocities" );
+	float* sortedLifetimes = b2StackAlloc( stack, count * sizeof( float ), "particle lifetimes" );
+	int* sortedGroupIndices = b2StackAlloc( stack, count * sizeof( int ), "particle groups" );
+	b2ParticleHit* hits = b2StackAlloc( stack, count * sizeof( b2ParticleHit ), "particle hits" );
+
+	// Integrate velocities and bucket the particles by predicted position
+	memset( cellStarts, 0, ( bucketCount + 1 ) * sizeof( int ) );
+	b2Vec2 gravity = world->gravity;
+	for ( int i = 0; i < count; ++i )
+	{
+		const b2ParticleDef* group = groups + groupIndices[i];
+		b2Vec2 v = b2MulSV( 1.0f / ( 1.0f + timeStep * group->linearDamping ), velocities[i] );
+		v = b2MulAdd( v, timeStep * group->gravityScale, gravity );
+		velocities[i] = v;
+
+		b2Vec2 p = b2MulAdd( positions[i], timeStep, v );
+		int x = b2ParticleCoordinate( p.x, inverseCellSize );
+		int y = b2ParticleCoordinate( p.y, inverseCellSize );
+		int bucket = b2ParticleBucket( x, y, bucketMask );
+		buckets[i] = bucket;
+		cellStarts[bucket] += 1;
+	}
+
+	int start = 0;
+	for ( int i = 0; i < bucketCount; ++i )
+	{
+		int bucketSize = cellStarts[i];
+		cellStarts[i] = start;
+		start += bucketSize;
+	}
+
+	// Stable counting sort so particles in the same cell are adjacent in memory
+	for ( int i = 0; i < count; ++i )
+	{
+		int index = cellStarts[buckets[i]]++;
+		origins[index] = positions[i];
+		predicted[index] = b2MulAdd( positions[i], timeStep, velocities[i] );
+		sortedVelocities[index] = velocities[i];
+		sortedLifetimes[index] = lifetimes[i];
+		sortedGroupIndices[index] = groupIndices[i];
+	}
+
+	// The scatter advanced each start to the next bucket
+	for ( int i = bucketCount; i > 0; --i )
+	{
+		cellStarts[i] = cellStarts[i - 1];
+	}
+	cellStarts[0] = 0;
+
+	memcpy( lifetimes, sortedLifetimes, count * sizeof( float ) );
+	memcpy( groupIndices, sortedGroupIndices, count * sizeof( int ) );
+	memcpy( velocities, sortedVelocities, count * sizeof( b2Vec2 ) );
+
+	b2ParticleStepContext stepContext = {
+		.world = world,
+		.groups = groups,
+		.groupIndices = groupIndices,
+		.origins = origins,
+		.predicted = predicted,
+		.positions = positions,
+		.velocities = velocities,
+		.hits = hits,
+		.cellStarts = cellStarts,
+		.cellMask = bucketMask,
+		.inverseCellSize = inverseCellSize,
+		.inv_dt = context->inv_dt,
+		.maxSpeed = world->maxLinearSpeed,
+	};
+
+	b2ParallelFor( world, b2SolveParticlesTask, count, 64, &stepContext );
+
+	b2ApplyParticleHits( world, hits, count );
+
+	b2StackFree( stack, hits );
+	b2StackFree( stack, sortedGroupIndices );
+	b2StackFree( stack, sortedLifetimes );
+	b2StackFree( stack, sortedVelocities );
+	b2StackFree( stack, predicted );
+	b2StackFree( stack, origins );
+	b2StackFree( stack, cellStarts );
+	b2StackFree( stack, buckets );
+
+	b2TracyCZoneEnd( particles );
+}
+
+// Compares fields rather than bytes because the padding of a user definition is undefined
+static bool b2IsSameParticleGroup( const b2ParticleDef* a, const b2ParticleDef* b )
+{
+	return a->radius == b->radius && a->density == b->density && a->friction == b->friction &&
+		   a->linearDamping == b->linearDamping && a->gravityScale == b->gravityScale && a->lifetime == b->lifetime &&
+		   a->filter.categoryBits == b->filter.categoryBits && a->filter.maskBits == b->filter.maskBits &&
+		   a->filter.groupIndex == b->filter.groupIndex && a->enableParticleCollision == b->enableParticleCollision;
+}
+
+void b2World_CreateParticles( b2WorldId worldId, const b2ParticleDef* def, const b2Vec2* positions, const b2Vec2* velocities,
+							  int count )
+{
+	B2_CHECK_DEF( def );
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked || count <= 0 )
+	{
+		return;
+	}
+
+	B2_ASSERT( positions != NULL );
+	B2_ASSERT( b2IsValidFloat( def->radius ) && def->radius > 0.0f );
+	B2_ASSERT( b2IsValidFloat( def->density ) && def->density >= 0.0f );
+	B2_ASSERT( b2IsValidFloat( def->friction ) && def->friction >= 0.0f );
+	B2_ASSERT( b2IsValidFloat( def->linearDamping ) && def->linearDamping >= 0.0f );
+	B2_ASSERT( b2IsValidFloat( def->gravityScale ) );
+	B2_ASSERT( b2IsValidFloat( def->lifetime ) && def->lifetime >= 0.0f );
+
+	b2ParticleSystem* system = &world->particles;
+
+	// Particles created with the same settings share a group
+	int groupIndex = B2_NULL_INDEX;
+	for ( int i = 0; i < system->groups.count; ++i )
+	{
+		if ( b2IsSameParticleGroup( system->groups.data + i, def ) )
+		{
+			groupIndex = i;
+			break;
+		}
+	}
+
+	if ( groupIndex == B2_NULL_INDEX )
+	{
+		groupIndex = system->groups.count;
+		b2Array_Push( system->groups, *def );
+		system->maxRadius = b2MaxFloat( system->maxRadius, def->radius );
+	}
+
+	int baseIndex = system->positions.count;
+	int newCount = baseIndex + count;
+	b2Array_ReserveGrow( system->positions, newCount );
+	b2Array_ReserveGrow( system->velocities, newCount );
+	b2Array_ReserveGrow( system->lifetimes, newCount );
+	b2Array_ReserveGrow( system->groupIndices, newCount );
+	system->positions.count = newCount;
+	system->velocities.count = newCount;
+	system->lifetimes.count = newCount;
+	system->groupIndices.count = newCount;
+
+	float lifetime = def->lifetime > 0.0f ? def->lifetime : FLT_MAX;
+	for ( int i = 0; i < count; ++i )
+	{
+		B2_ASSERT( b2IsValidVec2( positions[i] ) );
+		system->positions.data[baseIndex + i] = positions[i];
+		system->velocities.data[baseIndex + i] = velocities != NULL ? velocities[i] : b2Vec2_zero;
+		system->lifetimes.data[baseIndex + i] = lifetime;
+		system->groupIndices.data[baseIndex + i] = groupIndex;
+	}
+}
+
+void b2World_DestroyParticles( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	b2ParticleSystem* system = &world->particles;
+	b2Array_Clear( system->positions );
+	b2Array_Clear( system->velocities );
+	b2Array_Clear( system->lifetimes );
+	b2Array_Clear( system->groupIndices );
+	b2Array_Clear( system->groups );
+	system->maxRadius = 0.0f;
+}
+
+int b2World_GetParticleCount( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->particles.positions.count;
+}
+
+const b2Vec2* b2World_GetParticlePositions( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->particles.positions.data;
+}
+
+const b2Vec2* b2World_GetParticleVelocities( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->particles.velocities.data;
+}
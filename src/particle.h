@@ -0,0 +1,41 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "container.h"
+
+#include "box2d/types.h"
+
+typedef struct b2StepContext b2StepContext;
+typedef struct b2World b2World;
+
+b2DeclareArray( b2ParticleDef );
+
+// Particles are stored as parallel arrays. Each step sorts them by grid cell, so the index of a
+// particle changes from step to step.
+typedef struct b2ParticleSystem
+{
+	b2Array( b2Vec2 ) positions;
+	b2Array( b2Vec2 ) velocities;
+
+	// Remaining seconds, FLT_MAX for particles that never expire
+	b2Array( float ) lifetimes;
+
+	// Index into the group definitions
+	b2Array( int ) groupIndices;
+
+	// The distinct definitions used to create particles
+	b2Array( b2ParticleDef ) groups;
+
+	// Largest group radius, sets the grid cell size
+	float maxRadius;
+} b2ParticleSystem;
+
+void b2CreateParticleSystem( b2ParticleSystem* system );
+void b2DestroyParticleSystem( b2ParticleSystem* system );
+int b2GetParticleSystemBytes( const b2ParticleSystem* system );
+
+// Integrates the particles and resolves their collisions with shapes and each other. Runs after the
+// solver so the shapes are at their final positions.
+void b2StepParticles( b2World* world, b2StepContext* context );
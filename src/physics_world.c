@@ -8,15 +8,20 @@
 #include "physics_world.h"
 
 #include "arena_allocator.h"
+#include "atomic.h"
 #include "bitset.h"
 #include "body.h"
 #include "broad_phase.h"
+#include "compound.h"
 #include "constraint_graph.h"
 #include "contact.h"
+#include "contact_solver.h"
 #include "core.h"
 #include "ctz.h"
+#include "dynamic_tree.h"
 #include "island.h"
 #include "joint.h"
+#include "mover.h"
 #include "parallel_for.h"
 #include "scheduler.h"
 #include "sensor.h"
@@ -28,7 +33,9 @@
 #include "box2d/constants.h"
 
 #include <float.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 _Static_assert( B2_MAX_WORLDS > 0, "must be 1 or more" );
@@ -82,6 +89,63 @@ b2World* b2GetWorldLocked( int index )
 	return world;
 }
 
+typedef struct b2BitSetUnionContext
+{
+	b2World* world;
+	size_t bitSetOffset;
+} b2BitSetUnionContext;
+
+static b2BitSet* b2GetWorkerBitSet( b2World* world, int workerIndex, size_t bitSetOffset )
+{
+	return (b2BitSet*)( (char*)( world->taskContexts.data + workerIndex ) + bitSetOffset );
+}
+
+static void b2UnionBitSetsTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	B2_UNUSED( workerIndex );
+
+	b2BitSetUnionContext* unionContext = context;
+	b2World* world = unionContext->world;
+	uint64_t* targetBits = b2GetWorkerBitSet( world, 0, unionContext->bitSetOffset )->bits;
+
+	for ( int i = 1; i < world->workerCount; ++i )
+	{
+		const uint64_t* sourceBits = b2GetWorkerBitSet( world, i, unionContext->bitSetOffset )->bits;
+		b2InPlaceUnionRange( targetBits, sourceBits, (uint32_t)startIndex, (uint32_t)endIndex );
+	}
+}
+
+// Below this many words the union is faster on one thread
+#define B2_PARALLEL_UNION_WORD_COUNT 1024
+
+void b2UnionWorkerBitSets( b2World* world, size_t bitSetOffset )
+{
+	int workerCount = world->workerCount;
+	if ( workerCount == 1 )
+	{
+		return;
+	}
+
+	b2BitSet* target = b2GetWorkerBitSet( world, 0, bitSetOffset );
+	int wordCount = (int)target->blockCount;
+	if ( wordCount < B2_PARALLEL_UNION_WORD_COUNT )
+	{
+		for ( int i = 1; i < workerCount; ++i )
+		{
+			b2InPlaceUnion( target, b2GetWorkerBitSet( world, i, bitSetOffset ) );
+		}
+		return;
+	}
+
+	b2TracyCZoneNC( union_bits, "Union Bits", b2_colorGray, true );
+
+	b2BitSetUnionContext context = { world, bitSetOffset };
+	int minRange = B2_PARALLEL_UNION_WORD_COUNT / 4;
+	b2ParallelFor( world, b2UnionBitSetsTask, wordCount, minRange, &context );
+
+	b2TracyCZoneEnd( union_bits );
+}
+
 static void* b2DefaultAddTaskFcn( b2TaskCallback* task, void* taskContext, void* userContext )
 {
 	B2_UNUSED( userContext );
@@ -108,6 +172,8 @@ static float b2DefaultRestitutionCallback( float restitutionA, uint64_t material
 
 static void b2CreateWorkerContexts( b2World* world )
 {
+	const b2Capacity* c = &world->capacity;
+
 	b2Array_Create( world->taskContexts );
 	b2Array_ResizeAndSetZero( world->taskContexts, world->workerCount );
 
@@ -116,16 +182,32 @@ static void b2CreateWorkerContexts( b2World* world )
 
 	for ( int i = 0; i < world->workerCount; ++i )
 	{
+		world->taskContexts.data[i].arena = b2CreateArena( b2MaxInt( 16 * 1024, c->arenaByteCount ) );
 		b2Array_CreateN( world->taskContexts.data[i].sensorHits, 8 );
-		world->taskContexts.data[i].contactStateBitSet = b2CreateBitSet( 1024 );
-		world->taskContexts.data[i].hitEventBitSet = b2CreateBitSet( 1024 );
-		world->taskContexts.data[i].hasHitEvents = false;
-		world->taskContexts.data[i].jointStateBitSet = b2CreateBitSet( 1024 );
-		world->taskContexts.data[i].enlargedSimBitSet = b2CreateBitSet( 256 );
-		world->taskContexts.data[i].awakeIslandBitSet = b2CreateBitSet( 256 );
-		world->taskContexts.data[i].splitIslandId = B2_NULL_INDEX;
-
-		world->sensorTaskContexts.data[i].eventBits = b2CreateBitSet( 128 );
+		b2Array_Create( world->taskContexts.data[i].overlapHits );
+		b2Array_Create( world->taskContexts.data[i].continuousPairs );
+		b2Array_Create( world->taskContexts.data[i].bodyCommands );
+		world->taskContexts.data[i].contactStateBitSet = b2CreateBitSet( b2MaxInt( 1024, c->contactCount ) );
+		b2Array_Create( world->taskContexts.data[i].hitEvents );
+		b2Array_CreateN( world->taskContexts.data[i].jointEventIds, 4 );
+		world->taskContexts.data[i].enlargedSimBitSet = b2CreateBitSet( b2MaxInt( 256, c->dynamicBodyCount ) );
+		world->taskContexts.data[i].awakeIslandBitSet = b2CreateBitSet( b2MaxInt( 256, c->islandCount ) );
+		world->taskContexts.data[i].splitCandidateCount = 0;
+		for ( int j = 0; j < b2_shapeTypeCount; ++j )
+		{
+			b2Array_Create( world->taskContexts.data[i].aabbUpdates[j] );
+		}
+		b2Array_Create( world->taskContexts.data[i].kinematicBodyIds );
+		b2Array_Create( world->taskContexts.data[i].contactBeginEvents );
+		b2Array_Create( world->taskContexts.data[i].contactEndEvents );
+
+		world->sensorTaskContexts.data[i].eventBits = b2CreateBitSet( b2MaxInt( 128, c->sensorCount ) );
+		world->sensorTaskContexts.data[i].dirtyBits = b2CreateBitSet( b2MaxInt( 128, c->sensorCount ) );
+		b2Array_Create( world->sensorTaskContexts.data[i].hitSensorIds );
+		b2Array_CreateN( world->sensorTaskContexts.data[i].visitors, 16 );
+		b2Array_CreateN( world->sensorTaskContexts.data[i].sortBuffer, 16 );
+		b2Array_Create( world->sensorTaskContexts.data[i].beginEvents );
+		b2Array_Create( world->sensorTaskContexts.data[i].endEvents );
 	}
 }
 
@@ -133,14 +215,31 @@ static void b2DestroyWorkerContexts( b2World* world )
 {
 	for ( int i = 0; i < world->workerCount; ++i )
 	{
+		b2DestroyArena( &world->taskContexts.data[i].arena );
 		b2Array_Destroy( world->taskContexts.data[i].sensorHits );
+		b2Array_Destroy( world->taskContexts.data[i].overlapHits );
+		b2Array_Destroy( world->taskContexts.data[i].continuousPairs );
+		b2Array_Destroy( world->taskContexts.data[i].bodyCommands );
 		b2DestroyBitSet( &world->taskContexts.data[i].contactStateBitSet );
-		b2DestroyBitSet( &world->taskContexts.data[i].hitEventBitSet );
-		b2DestroyBitSet( &world->taskContexts.data[i].jointStateBitSet );
+		b2Array_Destroy( world->taskContexts.data[i].hitEvents );
+		b2Array_Destroy( world->taskContexts.data[i].jointEventIds );
 		b2DestroyBitSet( &world->taskContexts.data[i].enlargedSimBitSet );
 		b2DestroyBitSet( &world->taskContexts.data[i].awakeIslandBitSet );
+		for ( int j = 0; j < b2_shapeTypeCount; ++j )
+		{
+			b2Array_Destroy( world->taskContexts.data[i].aabbUpdates[j] );
+		}
+		b2Array_Destroy( world->taskContexts.data[i].kinematicBodyIds );
+		b2Array_Destroy( world->taskContexts.data[i].contactBeginEvents );
+		b2Array_Destroy( world->taskContexts.data[i].contactEndEvents );
 
 		b2DestroyBitSet( &world->sensorTaskContexts.data[i].eventBits );
+		b2DestroyBitSet( &world->sensorTaskContexts.data[i].dirtyBits );
+		b2Array_Destroy( world->sensorTaskContexts.data[i].hitSensorIds );
+		b2Array_Destroy( world->sensorTaskContexts.data[i].visitors );
+		b2Array_Destroy( world->sensorTaskContexts.data[i].sortBuffer );
+		b2Array_Destroy( world->sensorTaskContexts.data[i].beginEvents );
+		b2Array_Destroy( world->sensorTaskContexts.data[i].endEvents );
 	}
 
 	b2Array_Destroy( world->taskContexts );
@@ -169,6 +268,8 @@ b2WorldId b2CreateWorld( const b2WorldDef* def )
 
 	b2InitializeContactRegisters();
 
+	b2AllocInfo previousAllocInfo = b2PushAllocWorld( worldId );
+
 	b2World* world = b2_worlds + worldId;
 	uint16_t generation = world->generation;
 
@@ -178,9 +279,17 @@ b2WorldId b2CreateWorld( const b2WorldDef* def )
 	world->generation = generation;
 	world->inUse = true;
 
-	world->stack = b2CreateStack( 2048 );
-	b2CreateBroadPhase( &world->broadPhase, &def->capacity );
-	b2CreateGraph( &world->constraintGraph, &def->capacity );
+	world->capacity = def->capacity;
+	if ( world->capacity.islandCount == 0 )
+	{
+		world->capacity.islandCount = world->capacity.dynamicBodyCount;
+	}
+
+	const b2Capacity* capacity = &world->capacity;
+
+	world->stack = b2CreateStack( b2MaxInt( 2048, capacity->stackByteCount ) );
+	b2CreateBroadPhase( &world->broadPhase, &def->capacity, def->broadPhaseType, def->gridCellSize );
+	b2CreateGraph( &world->constraintGraph, &def->capacity, def->graphColorCount, def->enableAdaptiveColoring );
 
 	// pools
 	world->bodyIdPool = b2CreateIdPool();
@@ -189,7 +298,7 @@ b2WorldId b2CreateWorld( const b2WorldDef* def )
 	b2Array_CreateN( world->bodies, bodyCapacity );
 	b2Array_CreateN( world->solverSets, 8 );
 
-	// add empty static, active, and disabled body sets
+	// add empty static, active, disabled, and kinematic body sets
 	world->solverSetIdPool = b2CreateIdPool();
 	b2SolverSet set = { 0 };
 
@@ -210,46 +319,95 @@ b2WorldId b2CreateWorld( const b2WorldDef* def )
 	b2Array_Reserve( world->solverSets.data[b2_awakeSet].bodySims, b2MaxInt( 16, def->capacity.dynamicBodyCount ) );
 	b2Array_Reserve( world->solverSets.data[b2_awakeSet].bodyStates, b2MaxInt( 16, def->capacity.dynamicBodyCount ) );
 	b2Array_Reserve( world->solverSets.data[b2_awakeSet].contactSims, b2MaxInt( 16, def->capacity.contactCount ) );
+	b2Array_Reserve( world->solverSets.data[b2_awakeSet].jointSims, b2MaxInt( 16, capacity->jointCount ) );
+	b2Array_Reserve( world->solverSets.data[b2_awakeSet].islandSims, b2MaxInt( 16, capacity->islandCount ) );
 	B2_ASSERT( world->solverSets.data[b2_awakeSet].setIndex == b2_awakeSet );
 
+	// kinematic set
+	set.setIndex = b2AllocId( &world->solverSetIdPool );
+	b2Array_Push( world->solverSets, set );
+	B2_ASSERT( world->solverSets.data[b2_kinematicSet].setIndex == b2_kinematicSet );
+
 	world->shapeIdPool = b2CreateIdPool();
 
 	int shapeCapacity = b2MaxInt( 16, def->capacity.staticShapeCount + def->capacity.dynamicShapeCount );
 	b2Array_CreateN( world->shapes, shapeCapacity );
 
 	world->chainIdPool = b2CreateIdPool();
-	b2Array_CreateN( world->chainShapes, 4 );
+	b2Array_CreateN( world->chainShapes, b2MaxInt( 4, capacity->chainCount ) );
 
 	world->contactIdPool = b2CreateIdPool();
 	b2Array_CreateN( world->contacts, b2MaxInt( 16, def->capacity.contactCount ) );
 
 	world->jointIdPool = b2CreateIdPool();
-	b2Array_CreateN( world->joints, 16 );
+	b2Array_CreateN( world->joints, b2MaxInt( 16, capacity->jointCount ) );
 
 	world->islandIdPool = b2CreateIdPool();
-	b2Array_CreateN( world->islands, b2MaxInt( 16, def->capacity.dynamicBodyCount ) );
-
-	b2Array_CreateN( world->sensors, 4 );
-
-	b2Array_CreateN( world->bodyMoveEvents, 4 );
-	b2Array_CreateN( world->sensorBeginEvents, 4 );
-	b2Array_CreateN( world->sensorEndEvents[0], 4 );
-	b2Array_CreateN( world->sensorEndEvents[1], 4 );
-	b2Array_CreateN( world->contactBeginEvents, 4 );
-	b2Array_CreateN( world->contactEndEvents[0], 4 );
-	b2Array_CreateN( world->contactEndEvents[1], 4 );
-	b2Array_CreateN( world->contactHitEvents, 4 );
-	b2Array_CreateN( world->jointEvents, 4 );
+	b2Array_CreateN( world->islands, b2MaxInt( 16, capacity->islandCount ) );
+
+	b2Array_CreateN( world->sensors, b2MaxInt( 4, capacity->sensorCount ) );
+	world->sensorTree = b2DynamicTree_Create( 16 );
+	world->sensorRevision = 0;
+	world->sensorFullUpdate = true;
+	b2Array_CreateN( world->pendingSensorIds, 4 );
+
+	int sensorEventCapacity = b2MaxInt( 4, capacity->sensorEventCount );
+	int contactEventCapacity = b2MaxInt( 4, capacity->contactEventCount );
+	b2AllocInfo previousTag = b2PushAllocTag( b2_allocTagEvents, b2_allocLifetimeLong );
+	b2Array_CreateN( world->bodyMoveEvents, b2MaxInt( 4, capacity->dynamicBodyCount ) );
+	b2Array_Create( world->reportedMoveEvents );
+	b2Array_Create( world->moveDeltas );
+	b2Array_CreateN( world->sensorBeginEvents, sensorEventCapacity );
+	b2Array_CreateN( world->sensorEndEvents[0], sensorEventCapacity );
+	b2Array_CreateN( world->sensorEndEvents[1], sensorEventCapacity );
+	b2Array_CreateN( world->contactBeginEvents, contactEventCapacity );
+	b2Array_CreateN( world->contactEndEvents[0], contactEventCapacity );
+	b2Array_CreateN( world->contactEndEvents[1], contactEventCapacity );
+	b2Array_CreateN( world->contactHitEvents, contactEventCapacity );
+	b2Array_CreateN( world->jointEvents, b2MaxInt( 4, capacity->jointEventCount ) );
+	b2PopAllocInfo( previousTag );
 	world->endEventArrayIndex = 0;
 
 	world->stepIndex = 0;
-	world->splitIslandId = B2_NULL_INDEX;
+	world->lodBodyCount = 0;
+	world->parkedSetCount = 0;
+	b2Array_Create( world->lodBodies );
+	b2TracyCLockAnnounce( world->stageLock, "Solver Stage" );
+	b2TracyCLockAnnounce( world->syncLock, "Solver Sync" );
+	b2Array_Create( world->previousTransforms );
+	b2Array_Create( world->activeRegions );
+	b2Array_Create( world->debugDrawItems );
+	b2Array_Create( world->debugPrimitives );
+	b2Array_Create( world->debugVertices );
+	b2CreateParticleSystem( &world->particles );
+	world->frozenSetCount = 0;
+	world->splitIslandCount = 0;
+	world->islandStamp = 1;
+	world->maxIslandSplits = def->maxIslandSplits > 0 ? b2MinInt( def->maxIslandSplits, B2_MAX_ISLAND_SPLITS ) : 1;
+	world->contactPrefetchDistance = b2MaxInt( def->contactPrefetchDistance, 0 );
 	world->activeTaskCount = 0;
 	world->taskCount = 0;
 	world->gravity = def->gravity;
 	world->hitEventThreshold = def->hitEventThreshold;
+	world->contactEventFilter = def->contactEventFilter;
+	world->moveEventLinearThreshold = b2MaxFloat( 0.0f, def->moveEventLinearThreshold );
+	world->moveEventAngularThreshold = b2MaxFloat( 0.0f, def->moveEventAngularThreshold );
+	world->moveEventQuantum = b2MaxFloat( 0.0f, def->moveEventQuantum );
+	world->filterMoveEvents =
+		world->moveEventLinearThreshold > 0.0f || world->moveEventAngularThreshold > 0.0f || world->moveEventQuantum > 0.0f;
+	world->jointPrepareTolerance = b2MaxFloat( 0.0f, def->jointPrepareTolerance );
+	world->islandSolveBodyCount = b2MaxInt( 0, def->islandSolveBodyCount );
+	world->bodyOrderThreshold = b2MaxFloat( 0.0f, def->bodyOrderThreshold );
 	world->restitutionThreshold = def->restitutionThreshold;
 	world->maxLinearSpeed = def->maximumLinearSpeed;
+	world->treeOptimizationBudget = b2MaxInt( def->treeOptimizationBudget, 0 );
+
+	if ( def->rayCacheCapacity > 0 )
+	{
+		world->rayCacheCapacity = b2RoundUpPowerOf2( def->rayCacheCapacity );
+		world->rayCache = b2Alloc( world->rayCacheCapacity * sizeof( b2RayCacheEntry ) );
+		memset( world->rayCache, 0, world->rayCacheCapacity * sizeof( b2RayCacheEntry ) );
+	}
 	world->contactSpeed = def->contactSpeed;
 	world->contactHertz = def->contactHertz;
 	world->contactDampingRatio = def->contactDampingRatio;
@@ -278,15 +436,41 @@ b2WorldId b2CreateWorld( const b2WorldDef* def )
 	world->enableWarmStarting = true;
 	world->enableContactSoftening = def->enableContactSoftening;
 	world->enableContinuous = def->enableContinuous;
+	world->enableContinuousCache = def->enableContinuousCache;
+	world->enableParallelOverflow = def->enableParallelOverflow;
+	world->enableAdaptiveColoring = def->enableAdaptiveColoring;
+	world->enableAdaptiveRelax = def->enableAdaptiveRelax;
+	world->enableAllocationCheck = def->enableAllocationCheck;
+	world->enableParallelContacts = def->enableParallelContacts;
+	world->enableRelaxedDeterminism = def->enableRelaxedDeterminism;
+	world->enableSortedCollide = def->enableSortedCollide;
+	world->enablePipelinedCollide = def->enablePipelinedCollide;
+	world->enableFusedPrepare = def->enableFusedPrepare;
+	world->enableIncrementalIslands = def->enableIncrementalIslands;
+	world->enableIncrementalSensors = def->enableIncrementalSensors;
+	world->enableIncrementalPairs = def->enableIncrementalPairs;
+	world->enableCompactContacts = def->enableCompactContacts;
+	world->compactSleepSteps = b2MaxInt( 0, def->compactSleepSteps );
+	world->enableVelocityMargins = def->enableVelocityMargins;
+	world->enableAdaptiveBlocks = def->enableAdaptiveBlocks;
+	world->enableContactOrdering = def->enableContactOrdering;
+	world->enableColorBalancing = def->enableColorBalancing;
+	world->enableInterpolation = def->enableInterpolation;
+	world->enableAutoWorkers = def->enableAutoWorkers;
+	world->waitPolicy = def->waitPolicy;
+	world->waitSpinCount = def->waitSpinCount > 0 ? def->waitSpinCount : B2_DEFAULT_WAIT_SPIN_COUNT;
 	world->enableSpeculative = true;
 	world->userTreeTask = NULL;
 	world->userData = def->userData;
 
-	if ( def->workerCount > 0 && def->enqueueTask != NULL && def->finishTask != NULL )
+	world->enqueueTaskExFcn = NULL;
+
+	if ( def->workerCount > 0 && ( def->enqueueTask != NULL || def->enqueueTaskEx != NULL ) && def->finishTask != NULL )
 	{
 		// External task system
 		world->workerCount = b2MinInt( def->workerCount, B2_MAX_WORKERS );
 		world->enqueueTaskFcn = def->enqueueTask;
+		world->enqueueTaskExFcn = def->enqueueTaskEx;
 		world->finishTaskFcn = def->finishTask;
 		world->userTaskContext = def->userTaskContext;
 		world->scheduler = NULL;
@@ -295,7 +479,13 @@ b2WorldId b2CreateWorld( const b2WorldDef* def )
 	{
 		// Built-in scheduler
 		world->workerCount = b2MinInt( def->workerCount, B2_MAX_WORKERS );
-		world->scheduler = b2CreateScheduler( world->workerCount );
+		uint64_t affinityMask = def->workerAffinityMask;
+		if ( affinityMask == 0 && def->enableCacheAffinity )
+		{
+			affinityMask = b2GetCacheDomainAffinityMask();
+		}
+
+		world->scheduler = b2CreateScheduler( world->workerCount, affinityMask );
 		world->enqueueTaskFcn = b2SchedulerEnqueueTask;
 		world->finishTaskFcn = b2SchedulerFinishTask;
 		world->userTaskContext = world->scheduler;
@@ -317,14 +507,36 @@ b2WorldId b2CreateWorld( const b2WorldDef* def )
 	world->debugContactSet = b2CreateBitSet( 256 );
 	world->debugIslandSet = b2CreateBitSet( 256 );
 
+	for ( int i = 0; i < b2_dirtyTypeCount; ++i )
+	{
+		world->dirtyBitSets[i] = b2CreateBitSet( 256 );
+	}
+
+	if ( def->enableRecording )
+	{
+		world->recorder = b2CreateRecorder( def );
+	}
+
+	b2PopAllocInfo( previousAllocInfo );
+
 	// add one to worldId so that 0 represents a null b2WorldId
 	return (b2WorldId){ (uint16_t)( worldId + 1 ), world->generation };
 }
 
 void b2DestroyWorld( b2WorldId worldId )
 {
+	// An asynchronous step must complete before the world goes away
+	b2World_WaitStep( worldId );
+
 	b2World* world = b2GetWorldFromId( worldId );
 
+	if ( world->staticRebuildThread != NULL )
+	{
+		b2JoinThread( world->staticRebuildThread );
+		world->staticRebuildThread = NULL;
+		b2DynamicTree_Destroy( &world->staticRebuildTree );
+	}
+
 	if ( world->scheduler != NULL )
 	{
 		b2DestroyScheduler( world->scheduler );
@@ -336,9 +548,18 @@ void b2DestroyWorld( b2WorldId worldId )
 	b2DestroyBitSet( &world->debugContactSet );
 	b2DestroyBitSet( &world->debugIslandSet );
 
+	// Stop tracking changes since objects are freed below
+	world->snapshotKey = 0;
+	for ( int i = 0; i < b2_dirtyTypeCount; ++i )
+	{
+		b2DestroyBitSet( world->dirtyBitSets + i );
+	}
+
 	b2DestroyWorkerContexts( world );
 
 	b2Array_Destroy( world->bodyMoveEvents );
+	b2Array_Destroy( world->reportedMoveEvents );
+	b2Array_Destroy( world->moveDeltas );
 	b2Array_Destroy( world->sensorBeginEvents );
 	b2Array_Destroy( world->sensorEndEvents[0] );
 	b2Array_Destroy( world->sensorEndEvents[1] );
@@ -347,6 +568,15 @@ void b2DestroyWorld( b2WorldId worldId )
 	b2Array_Destroy( world->contactEndEvents[1] );
 	b2Array_Destroy( world->contactHitEvents );
 	b2Array_Destroy( world->jointEvents );
+	b2Array_Destroy( world->lodBodies );
+	b2TracyCLockTerminate( world->stageLock );
+	b2TracyCLockTerminate( world->syncLock );
+	b2Array_Destroy( world->previousTransforms );
+	b2Array_Destroy( world->activeRegions );
+	b2Array_Destroy( world->debugDrawItems );
+	b2Array_Destroy( world->debugPrimitives );
+	b2Array_Destroy( world->debugVertices );
+	b2DestroyParticleSystem( &world->particles );
 
 	int chainCapacity = world->chainShapes.count;
 	for ( int i = 0; i < chainCapacity; ++i )
@@ -372,6 +602,9 @@ void b2DestroyWorld( b2WorldId worldId )
 	}
 
 	b2Array_Destroy( world->sensors );
+	b2DynamicTree_Destroy( &world->sensorTree );
+	b2Free( world->rayCache, world->rayCacheCapacity * sizeof( b2RayCacheEntry ) );
+	b2Array_Destroy( world->pendingSensorIds );
 
 	b2Array_Destroy( world->bodies );
 	b2Array_Destroy( world->shapes );
@@ -384,6 +617,7 @@ void b2DestroyWorld( b2WorldId worldId )
 		b2Array_Destroy( world->islands.data[i].bodies );
 		b2Array_Destroy( world->islands.data[i].contacts );
 		b2Array_Destroy( world->islands.data[i].joints );
+		b2Array_Destroy( world->islands.data[i].removedLinks );
 	}
 	b2Array_Destroy( world->islands );
 
@@ -413,6 +647,18 @@ void b2DestroyWorld( b2WorldId worldId )
 
 	b2DestroyStack( &world->stack );
 
+	if ( world->recorder != NULL )
+	{
+		b2DestroyRecorder( world->recorder );
+	}
+
+	// The shapes using these are gone
+	for ( int i = 0; i < world->replayCompoundCount; ++i )
+	{
+		b2DestroyCompound( world->replayCompounds[i] );
+	}
+	b2Free( world->replayCompounds, world->replayCompoundCapacity * sizeof( b2Compound* ) );
+
 	// Wipe world but preserve generation
 	uint16_t generation = world->generation;
 	*world = (b2World){ 0 };
@@ -420,864 +666,2459 @@ void b2DestroyWorld( b2WorldId worldId )
 	world->generation = generation + 1;
 }
 
-static void b2CollideTask( int startIndex, int endIndex, int workerIndex, void* context )
+b2WorldId b2World_Clone( b2WorldId worldId )
 {
-	b2TracyCZoneNC( collide_task, "Collide", b2_colorDodgerBlue, true );
+	b2World* world = b3GetUnlockedWorldFromId( worldId );
+	if ( world == NULL || world->isStepAsync )
+	{
+		return b2_nullWorldId;
+	}
+
+	// Settings fixed at creation. The constraint graph settings are part of the copied state.
+	b2WorldDef def = b2DefaultWorldDef();
+	def.capacity = world->capacity;
+	def.broadPhaseType = world->broadPhase.type;
+	def.gridCellSize = world->broadPhase.gridCellSize;
+	def.enableAdaptiveColoring = world->enableAdaptiveColoring;
+	def.enableCompactContacts = world->enableCompactContacts;
+	def.compactSleepSteps = world->compactSleepSteps;
+	def.rayCacheCapacity = world->rayCacheCapacity;
+	def.workerCount = world->scheduler != NULL ? world->workerCount : 1;
+
+	b2WorldId cloneId = b2CreateWorld( &def );
+	if ( B2_IS_NULL( cloneId ) )
+	{
+		return b2_nullWorldId;
+	}
+
+	b2World* clone = b2GetWorldFromId( cloneId );
+
+	// A user task system is shared with the clone
+	if ( world->scheduler == NULL )
+	{
+		clone->enqueueTaskFcn = world->enqueueTaskFcn;
+		clone->enqueueTaskExFcn = world->enqueueTaskExFcn;
+		clone->finishTaskFcn = world->finishTaskFcn;
+		clone->userTaskContext = world->userTaskContext;
+		b2World_SetWorkerCount( cloneId, world->workerCount );
+	}
+
+	clone->maxIslandSplits = world->maxIslandSplits;
+	clone->contactPrefetchDistance = world->contactPrefetchDistance;
+	clone->gravity = world->gravity;
+	clone->hitEventThreshold = world->hitEventThreshold;
+	clone->contactEventFilter = world->contactEventFilter;
+	clone->moveEventLinearThreshold = world->moveEventLinearThreshold;
+	clone->moveEventAngularThreshold = world->moveEventAngularThreshold;
+	clone->moveEventQuantum = world->moveEventQuantum;
+	clone->filterMoveEvents = world->filterMoveEvents;
+	clone->jointPrepareTolerance = world->jointPrepareTolerance;
+	clone->islandSolveBodyCount = world->islandSolveBodyCount;
+	clone->bodyOrderThreshold = world->bodyOrderThreshold;
+	clone->restitutionThreshold = world->restitutionThreshold;
+	clone->maxLinearSpeed = world->maxLinearSpeed;
+	clone->treeOptimizationBudget = world->treeOptimizationBudget;
+	clone->contactSpeed = world->contactSpeed;
+	clone->contactHertz = world->contactHertz;
+	clone->contactDampingRatio = world->contactDampingRatio;
+	clone->contactRecycleDistance = world->contactRecycleDistance;
+	clone->frictionCallback = world->frictionCallback;
+	clone->restitutionCallback = world->restitutionCallback;
+	clone->preSolveFcn = world->preSolveFcn;
+	clone->preSolveContext = world->preSolveContext;
+	clone->customFilterFcn = world->customFilterFcn;
+	clone->customFilterContext = world->customFilterContext;
+	clone->preSolveBatchFcn = world->preSolveBatchFcn;
+	clone->preSolveBatchContext = world->preSolveBatchContext;
+	clone->customFilterBatchFcn = world->customFilterBatchFcn;
+	clone->customFilterBatchContext = world->customFilterBatchContext;
+	clone->userData = world->userData;
+
+	clone->enableSleep = world->enableSleep;
+	clone->enableWarmStarting = world->enableWarmStarting;
+	clone->enableContactSoftening = world->enableContactSoftening;
+	clone->enableContinuous = world->enableContinuous;
+	clone->enableContinuousCache = world->enableContinuousCache;
+	clone->enableParallelOverflow = world->enableParallelOverflow;
+	clone->enableAdaptiveRelax = world->enableAdaptiveRelax;
+	clone->enableAllocationCheck = world->enableAllocationCheck;
+	clone->enableParallelContacts = world->enableParallelContacts;
+	clone->enableRelaxedDeterminism = world->enableRelaxedDeterminism;
+	clone->enableSortedCollide = world->enableSortedCollide;
+	clone->enablePipelinedCollide = world->enablePipelinedCollide;
+	clone->enableFusedPrepare = world->enableFusedPrepare;
+	clone->enableIncrementalIslands = world->enableIncrementalIslands;
+	clone->enableIncrementalSensors = world->enableIncrementalSensors;
+	clone->enableIncrementalPairs = world->enableIncrementalPairs;
+	clone->enableVelocityMargins = world->enableVelocityMargins;
+	clone->enableAdaptiveBlocks = world->enableAdaptiveBlocks;
+	clone->enableContactOrdering = world->enableContactOrdering;
+	clone->enableColorBalancing = world->enableColorBalancing;
+	clone->enableAutoWorkers = world->enableAutoWorkers;
+	clone->waitPolicy = world->waitPolicy;
+	clone->waitSpinCount = world->waitSpinCount;
+	clone->enableSpeculative = world->enableSpeculative;
+	clone->enableWorkerProfile = world->enableWorkerProfile;
+	clone->enableDetailedCounters = world->enableDetailedCounters;
+
+	b2CopyWorldState( clone, world );
+
+	clone->enableInterpolation = world->enableInterpolation;
+	b2Array_Resize( clone->previousTransforms, world->previousTransforms.count );
+	if ( world->previousTransforms.count > 0 )
+	{
+		memcpy( clone->previousTransforms.data, world->previousTransforms.data,
+				world->previousTransforms.count * sizeof( b2Transform ) );
+	}
+
+	return cloneId;
+}
 
-	b2StepContext* stepContext = context;
-	b2World* world = stepContext->world;
-	b2TaskContext* taskContext = world->taskContexts.data + workerIndex;
-	b2ContactSim** contactSims = stepContext->contactSims;
-	b2Shape* shapes = world->shapes.data;
-	b2Body* bodies = world->bodies.data;
+// Update the contact state bits after computing a new manifold
+static void b2FinishCollide( b2TaskContext* taskContext, b2ContactSim* contactSim, bool touching, bool wasTouching )
+{
+	// State changes that affect island connectivity. Also affects contact events.
+	if ( touching == true && wasTouching == false )
+	{
+		contactSim->simFlags |= b2_simStartedTouching;
+		b2SetBit( &taskContext->contactStateBitSet, contactSim->contactId );
+	}
+	else if ( touching == false && wasTouching == true )
+	{
+		contactSim->simFlags |= b2_simStoppedTouching;
+		b2SetBit( &taskContext->contactStateBitSet, contactSim->contactId );
+	}
 
-	B2_ASSERT( startIndex < endIndex );
+	for ( int i = 0; i < contactSim->manifold.pointCount; ++i )
+	{
+		b2ManifoldPoint* mp = contactSim->manifold.points + i;
+		mp->baseSeparation = mp->separation;
+	}
 
-	float recycleDistance = world->contactRecycleDistance;
-	float speculativeDistance = B2_SPECULATIVE_DISTANCE;
-	float recycleDistanceNonTouching = b2MinFloat( recycleDistance, speculativeDistance );
+	// To make this work, the time of impact code needs to adjust the target
+	// distance based on the number of TOI events for a body.
+	// if (touching && bodySimB->isFast)
+	//{
+	//	b2Manifold* manifold = &contactSim->manifold;
+	//	int pointCount = manifold->pointCount;
+	//	for (int i = 0; i < pointCount; ++i)
+	//	{
+	//		// trick the solver into pushing the fast shapes apart
+	//		manifold->points[i].separation -= 0.25f * B2_SPECULATIVE_DISTANCE;
+	//	}
+	//}
+}
 
-	for ( int contactIndex = startIndex; contactIndex < endIndex; ++contactIndex )
+// Touching contacts waiting for b2PreSolveBatchFcn. Their state bits are set once the callback decides.
+#define B2_PRE_SOLVE_BATCH_SIZE 64
+
+typedef struct b2PreSolveBatch
+{
+	int count;
+	b2ContactSim* contactSims[B2_PRE_SOLVE_BATCH_SIZE];
+	bool wasTouching[B2_PRE_SOLVE_BATCH_SIZE];
+	b2PreSolveContact contacts[B2_PRE_SOLVE_BATCH_SIZE];
+} b2PreSolveBatch;
+
+static void b2FlushPreSolveBatch( b2World* world, b2TaskContext* taskContext, b2PreSolveBatch* batch )
+{
+	bool results[B2_PRE_SOLVE_BATCH_SIZE];
+	for ( int i = 0; i < batch->count; ++i )
 	{
-		b2ContactSim* contactSim = contactSims[contactIndex];
+		results[i] = true;
+	}
 
-		int contactId = contactSim->contactId;
+	// this call assumes thread safety
+	world->preSolveBatchFcn( batch->contacts, results, batch->count, world->preSolveBatchContext );
 
-		b2Shape* shapeA = shapes + contactSim->shapeIdA;
-		b2Shape* shapeB = shapes + contactSim->shapeIdB;
+	for ( int i = 0; i < batch->count; ++i )
+	{
+		b2ContactSim* contactSim = batch->contactSims[i];
+		contactSim->simFlags &= ~b2_simPreSolvePending;
 
-		// Do proxies still overlap?
-		bool overlap = b2AABB_Overlaps( shapeA->fatAABB, shapeB->fatAABB );
-		if ( overlap == false )
+		bool touching = results[i];
+		if ( touching == false )
 		{
-			contactSim->simFlags |= b2_simDisjoint;
-			contactSim->simFlags &= ~b2_simTouchingFlag;
-			b2SetBit( &taskContext->contactStateBitSet, contactId );
+			// disable contact, same as b2FinishContactUpdate does for b2PreSolveFcn
+			contactSim->manifold.pointCount = 0;
+			contactSim->manifold.rollingImpulse = 0.0f;
+			contactSim->simFlags &= ~( b2_simEnableHitEvent | b2_simTouchingFlag );
 		}
-		else
-		{
-			bool wasTouching = ( contactSim->simFlags & b2_simTouchingFlag );
-
-			// Update contact respecting shape/body order (A,B)
-			b2Body* bodyA = bodies + shapeA->bodyId;
-			b2Body* bodyB = bodies + shapeB->bodyId;
-			b2BodySim* bodySimA = b2GetBodySim( world, bodyA );
-			b2BodySim* bodySimB = b2GetBodySim( world, bodyB );
-			b2Transform transformA = bodySimA->transform;
-			b2Transform transformB = bodySimB->transform;
-
-			// These may not be skipped by relative transform check below
-			contactSim->bodySimIndexA = bodyA->setIndex == b2_awakeSet ? bodyA->localIndex : B2_NULL_INDEX;
-			contactSim->invMassA = bodySimA->invMass;
-			contactSim->invIA = bodySimA->invInertia;
-
-			contactSim->bodySimIndexB = bodyB->setIndex == b2_awakeSet ? bodyB->localIndex : B2_NULL_INDEX;
-			contactSim->invMassB = bodySimB->invMass;
-			contactSim->invIB = bodySimB->invInertia;
-
-			// Contact recycling optimization. Please cite this code if you use this optimization.
-			// This is inspired by persistent contact manifolds used in some physics engines, such as PhysX.
-			// However, this allows larger relative motion and has fewer tuning parameters (just one).
-			if ( recycleDistance > 0.0f && contactSim->simFlags & b2_simRelativeTransformValid )
-			{
-				b2Transform xf = b2InvMulTransforms( transformA, transformB );
-				b2Transform xfc = b2InvMulTransforms( contactSim->cachedTransformA, contactSim->cachedTransformB );
-				float maxExtentA = bodyA->type == b2_staticBody ? 0.0f : bodySimA->maxExtent;
-				float maxExtentB = bodyB->type == b2_staticBody ? 0.0f : bodySimB->maxExtent;
-				float maxExtent = b2MaxFloat( maxExtentA, maxExtentB );
-				float distance = b2Distance( xf.p, xfc.p );
-				b2Rot qr = b2InvMulRot( xf.q, xfc.q );
-
-				// This metric is used for fast bodies and sleeping. It comes from conservative advancement.
-				// Note that qr.s == sin(theta) ~= theta for small angles.
-				// Need a tighter tolerance for non-touching shapes so that contacts are not missed.
-				float tolerance = wasTouching ? recycleDistance : recycleDistanceNonTouching;
-				if ( distance + maxExtent * b2AbsFloat( qr.s ) < tolerance )
-				{
-					b2Rot dqA = b2MulRot( transformA.q, b2InvertRot( contactSim->cachedTransformA.q ) );
-					b2Rot dqB = b2MulRot( transformB.q, b2InvertRot( contactSim->cachedTransformB.q ) );
-					b2Vec2 normal = contactSim->manifold.normal;
 
-					// Minimize round-off
-					b2Vec2 dc = b2Sub( bodySimB->center, bodySimA->center );
+		b2FinishCollide( taskContext, contactSim, touching, batch->wasTouching[i] );
+	}
 
-					for ( int i = 0; i < contactSim->manifold.pointCount; ++i )
-					{
-						// Keep anchors but update separation, same as sub-stepping. This eliminates jitter.
-						b2ManifoldPoint* mp = contactSim->manifold.points + i;
-						b2Vec2 rA = b2RotateVector( dqA, mp->anchorA );
-						b2Vec2 rB = b2RotateVector( dqB, mp->anchorB );
-						b2Vec2 dp = b2Add( dc, b2Sub( rB, rA ) );
-						mp->separation = mp->baseSeparation + b2Dot( dp, normal );
-						mp->persisted = true;
-					}
+	batch->count = 0;
+}
 
-					taskContext->recycledContactCount += 1;
+// Contacts flagged by b2FinishContactUpdate go to the pre-solve batch before their state bits are set
+static void b2FinishOrDeferCollide( b2World* world, b2TaskContext* taskContext, b2PreSolveBatch* preSolveBatch,
+									b2ContactSim* contactSim, const b2Shape* shapeA, const b2Shape* shapeB, bool touching,
+									bool wasTouching )
+{
+	if ( ( contactSim->simFlags & b2_simPreSolvePending ) == 0 )
+	{
+		b2FinishCollide( taskContext, contactSim, touching, wasTouching );
+		return;
+	}
 
-					// Contact is recycled. This also skips updating other aspects of the contact
-					// such as material parameters.
-					continue;
-				}
-			}
+	int index = preSolveBatch->count;
+	preSolveBatch->contactSims[index] = contactSim;
+	preSolveBatch->wasTouching[index] = wasTouching;
+	preSolveBatch->contacts[index] = b2MakePreSolveContact( world, contactSim, shapeA, shapeB );
+	preSolveBatch->count += 1;
 
-			// Caching for contact recycling.
-			contactSim->cachedTransformA = transformA;
-			contactSim->cachedTransformB = transformB;
-			contactSim->simFlags |= b2_simRelativeTransformValid;
+	if ( preSolveBatch->count == B2_PRE_SOLVE_BATCH_SIZE )
+	{
+		b2FlushPreSolveBatch( world, taskContext, preSolveBatch );
+	}
+}
 
-			b2Vec2 centerOffsetA = b2RotateVector( transformA.q, bodySimA->localCenter );
-			b2Vec2 centerOffsetB = b2RotateVector( transformB.q, bodySimB->localCenter );
+// Contacts of one shape pair type waiting for a batched manifold function
+typedef struct b2CollideBatch
+{
+	b2ManifoldWideFcn* fcn;
+	int count;
+	b2ContactSim* contactSims[B2_SIMD_WIDTH];
+	b2Shape* shapesA[B2_SIMD_WIDTH];
+	b2Shape* shapesB[B2_SIMD_WIDTH];
+	b2Transform transformsA[B2_SIMD_WIDTH];
+	b2Transform transformsB[B2_SIMD_WIDTH];
+	b2Vec2 centerOffsetsA[B2_SIMD_WIDTH];
+	b2Vec2 centerOffsetsB[B2_SIMD_WIDTH];
+} b2CollideBatch;
+
+static void b2FlushCollideBatch( b2World* world, b2TaskContext* taskContext, b2CollideBatch* batch,
+								 b2PreSolveBatch* preSolveBatch )
+{
+	b2Manifold manifolds[B2_SIMD_WIDTH];
+	batch->fcn( batch->shapesA, batch->transformsA, batch->shapesB, batch->transformsB, batch->count, manifolds );
 
-			// This updates solid contacts
-			bool touching =
-				b2UpdateContact( world, contactSim, shapeA, transformA, centerOffsetA, shapeB, transformB, centerOffsetB );
+	if ( world->enableDetailedCounters )
+	{
+		taskContext->detailedCounters.manifoldCalls[batch->contactSims[0]->pairType] += batch->count;
+	}
 
-			// State changes that affect island connectivity. Also affects contact events.
-			if ( touching == true && wasTouching == false )
-			{
-				contactSim->simFlags |= b2_simStartedTouching;
-				b2SetBit( &taskContext->contactStateBitSet, contactId );
-			}
-			else if ( touching == false && wasTouching == true )
-			{
-				contactSim->simFlags |= b2_simStoppedTouching;
-				b2SetBit( &taskContext->contactStateBitSet, contactId );
-			}
+	for ( int i = 0; i < batch->count; ++i )
+	{
+		b2ContactSim* contactSim = batch->contactSims[i];
+		bool wasTouching = ( contactSim->simFlags & b2_simTouchingFlag );
 
-			for ( int i = 0; i < contactSim->manifold.pointCount; ++i )
-			{
-				b2ManifoldPoint* mp = contactSim->manifold.points + i;
-				mp->baseSeparation = mp->separation;
-			}
+		b2Manifold oldManifold = contactSim->manifold;
+		contactSim->manifold = manifolds[i];
 
-			// To make this work, the time of impact code needs to adjust the target
-			// distance based on the number of TOI events for a body.
-			// if (touching && bodySimB->isFast)
-			//{
-			//	b2Manifold* manifold = &contactSim->manifold;
-			//	int pointCount = manifold->pointCount;
-			//	for (int i = 0; i < pointCount; ++i)
-			//	{
-			//		// trick the solver into pushing the fast shapes apart
-			//		manifold->points[i].separation -= 0.25f * B2_SPECULATIVE_DISTANCE;
-			//	}
-			//}
-		}
+		bool touching = b2FinishContactUpdate( world, contactSim, &oldManifold, batch->shapesA[i], batch->centerOffsetsA[i],
+											   batch->shapesB[i], batch->centerOffsetsB[i] );
+
+		b2FinishOrDeferCollide( world, taskContext, preSolveBatch, contactSim, batch->shapesA[i], batch->shapesB[i],
+								touching, wasTouching );
 	}
 
-	b2TracyCZoneEnd( collide_task );
+	batch->count = 0;
 }
 
-static void b2AddNonTouchingContact( b2World* world, b2Contact* contact, b2ContactSim* contactSim )
+// Bound on how far any point of a body moved since the cached transform. Static bodies have no extent,
+// so any rotation of a static body gives an unbounded motion.
+static float b2GetBodyMotionBound( const b2Body* body, const b2BodySim* bodySim, b2Transform cachedTransform )
 {
-	B2_ASSERT( contact->setIndex == b2_awakeSet );
-	b2SolverSet* set = b2Array_Get( world->solverSets, b2_awakeSet );
-	contact->colorIndex = B2_NULL_INDEX;
-	contact->localIndex = set->contactSims.count;
+	b2Vec2 center0 = b2TransformPoint( cachedTransform, bodySim->localCenter );
+	b2Rot dq = b2InvMulRot( cachedTransform.q, bodySim->transform.q );
 
-	b2ContactSim* newContactSim = b2Array_Emplace( set->contactSims );
-	memcpy( newContactSim, contactSim, sizeof( b2ContactSim ) );
+	// The chord of the rotation angle, 2 * sin(theta / 2), is less than |sin(theta)| + 1 - cos(theta)
+	float chord = b2AbsFloat( dq.s ) + ( 1.0f - dq.c );
+	float maxExtent = body->type == b2_staticBody ? B2_HUGE : bodySim->maxExtent;
+	return b2Distance( center0, bodySim->center ) + chord * maxExtent;
 }
 
-static void b2RemoveNonTouchingContact( b2World* world, int setIndex, int localIndex )
+// Lower bound on the shape distance beyond the speculative distance. The manifold functions produce
+// no points while the shapes are farther apart than the speculative distance.
+static float b2GetSeparationBound( b2AABB aabbA, b2AABB aabbB )
 {
-	b2SolverSet* set = b2Array_Get( world->solverSets, setIndex );
-	int movedIndex = b2Array_RemoveSwap( set->contactSims, localIndex );
-	if ( movedIndex != B2_NULL_INDEX )
-	{
-		b2ContactSim* movedContactSim = set->contactSims.data + localIndex;
-		b2Contact* movedContact = b2Array_Get( world->contacts, movedContactSim->contactId );
-		B2_ASSERT( movedContact->setIndex == setIndex );
-		B2_ASSERT( movedContact->localIndex == movedIndex );
-		B2_ASSERT( movedContact->colorIndex == B2_NULL_INDEX );
-		movedContact->localIndex = localIndex;
-	}
+	float gapX = b2MaxFloat( aabbB.lowerBound.x - aabbA.upperBound.x, aabbA.lowerBound.x - aabbB.upperBound.x );
+	float gapY = b2MaxFloat( aabbB.lowerBound.y - aabbA.upperBound.y, aabbA.lowerBound.y - aabbB.upperBound.y );
+	return b2MaxFloat( 0.0f, b2MaxFloat( gapX, gapY ) - B2_SPECULATIVE_DISTANCE );
 }
 
-// Narrow-phase collision
-static void b2Collide( b2StepContext* context )
+// Update the manifold of one contact. Contacts with a wide manifold function go to the batch if there is one.
+static void b2CollideContact( b2World* world, b2TaskContext* taskContext, b2ContactSim* contactSim, b2CollideBatch* batch,
+							  b2PreSolveBatch* preSolveBatch )
 {
-	b2World* world = context->world;
+	b2Shape* shapes = world->shapes.data;
+	b2Body* bodies = world->bodies.data;
 
-	B2_ASSERT( world->workerCount > 0 );
+	float recycleDistance = world->contactRecycleDistance;
 
-	b2TracyCZoneNC( collide, "Narrow Phase", b2_colorDodgerBlue, true );
+	int contactId = contactSim->contactId;
 
-	// gather contacts into a single array for easier parallel-for
-	int contactCount = 0;
-	b2GraphColor* graphColors = world->constraintGraph.colors;
-	for ( int i = 0; i < B2_GRAPH_COLOR_COUNT; ++i )
-	{
-		contactCount += graphColors[i].contactSims.count;
-	}
+	b2Shape* shapeA = shapes + contactSim->shapeIdA;
+	b2Shape* shapeB = shapes + contactSim->shapeIdB;
 
-	int nonTouchingCount = world->solverSets.data[b2_awakeSet].contactSims.count;
-	contactCount += nonTouchingCount;
+	float speculativeDistance = b2MinFloat( shapeA->speculativeDistance, shapeB->speculativeDistance );
+	float recycleDistanceNonTouching = b2MinFloat( recycleDistance, speculativeDistance );
 
-	if ( contactCount == 0 )
+	// Do proxies still overlap?
+	bool overlap = b2AABB_Overlaps( shapeA->fatAABB, shapeB->fatAABB );
+	if ( overlap == false )
 	{
-		b2TracyCZoneEnd( collide );
-		return;
+		contactSim->simFlags |= b2_simDisjoint;
+		contactSim->simFlags &= ~b2_simTouchingFlag;
+		b2SetBit( &taskContext->contactStateBitSet, contactId );
 	}
-
-	b2ContactSim** contactSims = b2StackAlloc( &world->stack, contactCount * sizeof( b2ContactSim* ), "contacts" );
-
-	int contactIndex = 0;
-	for ( int i = 0; i < B2_GRAPH_COLOR_COUNT; ++i )
+	else
 	{
-		b2GraphColor* color = graphColors + i;
-		int count = color->contactSims.count;
-		b2ContactSim* base = color->contactSims.data;
-		for ( int j = 0; j < count; ++j )
+		bool wasTouching = ( contactSim->simFlags & b2_simTouchingFlag );
+
+		// Update contact respecting shape/body order (A,B)
+		b2Body* bodyA = bodies + shapeA->bodyId;
+		b2Body* bodyB = bodies + shapeB->bodyId;
+		b2BodySim* bodySimA = b2GetBodySim( world, bodyA );
+		b2BodySim* bodySimB = b2GetBodySim( world, bodyB );
+		b2Transform transformA = bodySimA->transform;
+		b2Transform transformB = bodySimB->transform;
+
+		// These may not be skipped by relative transform check below
+		contactSim->bodySimIndexA = bodyA->setIndex == b2_awakeSet ? bodyA->localIndex : B2_NULL_INDEX;
+		contactSim->invMassA = bodySimA->invMass;
+		contactSim->invIA = bodySimA->invInertia;
+
+		contactSim->bodySimIndexB = bodyB->setIndex == b2_awakeSet ? bodyB->localIndex : B2_NULL_INDEX;
+		contactSim->invMassB = bodySimB->invMass;
+		contactSim->invIB = bodySimB->invInertia;
+
+		// Separation hysteresis. Shapes inside overlapping fat AABBs may still be far apart. A non-touching
+		// contact skips the narrow phase until the bodies may have closed the gap found by the last update.
+		if ( wasTouching == false && contactSim->separationBound > 0.0f &&
+			 ( contactSim->simFlags & b2_simRelativeTransformValid ) )
 		{
-			contactSims[contactIndex] = base + j;
-			contactIndex += 1;
+			float motion = b2GetBodyMotionBound( bodyA, bodySimA, contactSim->cachedTransformA ) +
+						   b2GetBodyMotionBound( bodyB, bodySimB, contactSim->cachedTransformB );
+			if ( motion < contactSim->separationBound )
+			{
+				taskContext->separatedContactCount += 1;
+				return;
+			}
 		}
-	}
 
-	{
-		b2ContactSim* base = world->solverSets.data[b2_awakeSet].contactSims.data;
-		for ( int i = 0; i < nonTouchingCount; ++i )
+		// Contact recycling optimization. Please cite this code if you use this optimization.
+		// This is inspired by persistent contact manifolds used in some physics engines, such as PhysX.
+		// However, this allows larger relative motion and has fewer tuning parameters (just one).
+		if ( recycleDistance > 0.0f && contactSim->simFlags & b2_simRelativeTransformValid )
 		{
-			contactSims[contactIndex] = base + i;
-			contactIndex += 1;
-		}
-	}
-
-	B2_ASSERT( contactIndex == contactCount );
-
-	context->contactSims = contactSims;
-
-	// Contact bit set on ids because contact pointers are unstable as they move between touching and not touching.
-	int contactIdCapacity = b2GetIdCapacity( &world->contactIdPool );
-	for ( int i = 0; i < world->workerCount; ++i )
-	{
-		b2SetBitCountAndClear( &world->taskContexts.data[i].contactStateBitSet, contactIdCapacity );
-		world->taskContexts.data[i].recycledContactCount = 0;
-	}
-
-	// Task should take at least 40us on a 4GHz CPU (10K cycles)
-	int minRange = 64;
-	b2ParallelFor( world, &b2CollideTask, contactCount, minRange, context );
+			b2Transform xf = b2InvMulTransforms( transformA, transformB );
+			b2Transform xfc = b2InvMulTransforms( contactSim->cachedTransformA, contactSim->cachedTransformB );
+			float maxExtentA = bodyA->type == b2_staticBody ? 0.0f : bodySimA->maxExtent;
+			float maxExtentB = bodyB->type == b2_staticBody ? 0.0f : bodySimB->maxExtent;
+			float maxExtent = b2MaxFloat( maxExtentA, maxExtentB );
+			float distance = b2Distance( xf.p, xfc.p );
+			b2Rot qr = b2InvMulRot( xf.q, xfc.q );
+
+			// This metric is used for fast bodies and sleeping. It comes from conservative advancement.
+			// Note that qr.s == sin(theta) ~= theta for small angles.
+			// Need a tighter tolerance for non-touching shapes so that contacts are not missed.
+			float tolerance = wasTouching ? recycleDistance : recycleDistanceNonTouching;
+			if ( distance + maxExtent * b2AbsFloat( qr.s ) < tolerance )
+			{
+				b2Rot dqA = b2MulRot( transformA.q, b2InvertRot( contactSim->cachedTransformA.q ) );
+				b2Rot dqB = b2MulRot( transformB.q, b2InvertRot( contactSim->cachedTransformB.q ) );
+				b2Vec2 normal = contactSim->manifold.normal;
 
-	b2StackFree( &world->stack, contactSims );
-	context->contactSims = NULL;
-	contactSims = NULL;
+				// Minimize round-off
+				b2Vec2 dc = b2Sub( bodySimB->center, bodySimA->center );
 
-	// Serially update contact state
-	// todo_erin bring this zone together with island merge
-	b2TracyCZoneNC( contact_state, "Contact State", b2_colorLightSlateGray, true );
+				for ( int i = 0; i < contactSim->manifold.pointCount; ++i )
+				{
+					// Keep anchors but update separation, same as sub-stepping. This eliminates jitter.
+					b2ManifoldPoint* mp = contactSim->manifold.points + i;
+					b2Vec2 rA = b2RotateVector( dqA, mp->anchorA );
+					b2Vec2 rB = b2RotateVector( dqB, mp->anchorB );
+					b2Vec2 dp = b2Add( dc, b2Sub( rB, rA ) );
+					mp->separation = mp->baseSeparation + b2Dot( dp, normal );
+					mp->persisted = true;
+				}
 
-	// Bitwise OR all contact bits
-	b2BitSet* bitSet = &world->taskContexts.data[0].contactStateBitSet;
-	for ( int i = 1; i < world->workerCount; ++i )
-	{
-		b2InPlaceUnion( bitSet, &world->taskContexts.data[i].contactStateBitSet );
-	}
+				taskContext->recycledContactCount += 1;
 
-	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
+				// Contact is recycled. This also skips updating other aspects of the contact
+				// such as material parameters.
+				return;
+			}
+		}
 
-	int endEventArrayIndex = world->endEventArrayIndex;
+		// Caching for contact recycling.
+		contactSim->cachedTransformA = transformA;
+		contactSim->cachedTransformB = transformB;
+		contactSim->simFlags |= b2_simRelativeTransformValid;
+		contactSim->separationBound = b2GetSeparationBound( shapeA->aabb, shapeB->aabb );
 
-	const b2Shape* shapes = world->shapes.data;
-	uint16_t worldId = world->worldId;
+		b2Vec2 centerOffsetA = b2RotateVector( transformA.q, bodySimA->localCenter );
+		b2Vec2 centerOffsetB = b2RotateVector( transformB.q, bodySimB->localCenter );
 
-	// Process contact state changes. Iterate over set bits
-	for ( uint32_t k = 0; k < bitSet->blockCount; ++k )
-	{
-		uint64_t bits = bitSet->bits[k];
-		while ( bits != 0 )
+		// Sorted contacts arrive in runs of the same pair type, so batch those with a wide manifold function
+		b2ManifoldWideFcn* wideFcn = batch != NULL ? b2GetManifoldWideFcn( contactSim->pairType ) : NULL;
+		if ( wideFcn != NULL )
 		{
-			uint32_t ctz = b2CTZ64( bits );
-			int contactId = (int)( 64 * k + ctz );
-
-			b2Contact* contact = b2Array_Get( world->contacts, contactId );
-			B2_ASSERT( contact->setIndex == b2_awakeSet );
-
-			int colorIndex = contact->colorIndex;
-			int localIndex = contact->localIndex;
-
-			b2ContactSim* contactSim = NULL;
-			if ( colorIndex != B2_NULL_INDEX )
+			if ( batch->count > 0 && batch->fcn != wideFcn )
 			{
-				// contact lives in constraint graph
-				B2_ASSERT( 0 <= colorIndex && colorIndex < B2_GRAPH_COLOR_COUNT );
-				b2GraphColor* color = graphColors + colorIndex;
-				contactSim = b2Array_Get( color->contactSims, localIndex );
-			}
-			else
-			{
-				contactSim = b2Array_Get( awakeSet->contactSims, localIndex );
+				b2FlushCollideBatch( world, taskContext, batch, preSolveBatch );
 			}
 
-			const b2Shape* shapeA = shapes + contact->shapeIdA;
-			const b2Shape* shapeB = shapes + contact->shapeIdB;
-			b2ShapeId shapeIdA = { shapeA->id + 1, worldId, shapeA->generation };
-			b2ShapeId shapeIdB = { shapeB->id + 1, worldId, shapeB->generation };
-			b2ContactId contactFullId = {
-				.index1 = contactId + 1,
-				.world0 = worldId,
-				.padding = 0,
-				.generation = contact->generation,
-			};
-			uint32_t flags = contact->flags;
-			uint32_t simFlags = contactSim->simFlags;
-
-			if ( simFlags & b2_simDisjoint )
+			int index = batch->count;
+			batch->fcn = wideFcn;
+			batch->contactSims[index] = contactSim;
+			batch->shapesA[index] = shapeA;
+			batch->shapesB[index] = shapeB;
+			batch->transformsA[index] = transformA;
+			batch->transformsB[index] = transformB;
+			batch->centerOffsetsA[index] = centerOffsetA;
+			batch->centerOffsetsB[index] = centerOffsetB;
+			batch->count += 1;
+
+			if ( batch->count == B2_SIMD_WIDTH )
 			{
-				// Bounding boxes no longer overlap
-				b2DestroyContact( world, contact, false );
-				contact = NULL;
-				contactSim = NULL;
+				b2FlushCollideBatch( world, taskContext, batch, preSolveBatch );
 			}
-			else if ( simFlags & b2_simStartedTouching )
-			{
-				B2_ASSERT( contact->islandId == B2_NULL_INDEX );
-
-				if ( flags & b2_contactEnableContactEvents )
-				{
-					b2ContactBeginTouchEvent event = { shapeIdA, shapeIdB, contactFullId };
-					b2Array_Push( world->contactBeginEvents, event );
-				}
 
-				B2_ASSERT( contactSim->manifold.pointCount > 0 );
-				B2_ASSERT( contact->setIndex == b2_awakeSet );
+			return;
+		}
 
-				// Link first because this wakes colliding bodies and ensures the body sims
-				// are in the correct place.
-				contact->flags |= b2_contactTouchingFlag;
-				b2LinkContact( world, contact );
+		// This updates solid contacts
+		bool touching =
+			b2UpdateContact( world, contactSim, shapeA, transformA, centerOffsetA, shapeB, transformB, centerOffsetB );
 
-				// Make sure these didn't change
-				B2_ASSERT( contact->colorIndex == B2_NULL_INDEX );
-				B2_ASSERT( contact->localIndex == localIndex );
+		if ( world->enableDetailedCounters )
+		{
+			taskContext->detailedCounters.manifoldCalls[contactSim->pairType] += 1;
+		}
 
-				// Contact sim pointer may have become orphaned due to awake set growth,
-				// so I just need to refresh it.
-				contactSim = b2Array_Get( awakeSet->contactSims, localIndex );
+		if ( b2IsCachedAxisSeparated( contactSim ) )
+		{
+			taskContext->cachedAxisContactCount += 1;
+		}
 
-				contactSim->simFlags &= ~b2_simStartedTouching;
+		b2FinishOrDeferCollide( world, taskContext, preSolveBatch, contactSim, shapeA, shapeB, touching, wasTouching );
+	}
+}
 
-				// Add first for memcpy
-				b2AddContactToGraph( world, contactSim, contact );
+static void b2CollideTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	b2TracyCZoneNC( collide_task, "Collide", b2_colorDodgerBlue, true );
 
-				// This destroys the contact sim
-				b2RemoveNonTouchingContact( world, b2_awakeSet, localIndex );
+	b2StepContext* stepContext = context;
+	b2World* world = stepContext->world;
+	b2TaskContext* taskContext = world->taskContexts.data + workerIndex;
+	b2ContactSim** contactSims = stepContext->contactSims;
 
-				contactSim = NULL;
-			}
-			else if ( simFlags & b2_simStoppedTouching )
-			{
-				contactSim->simFlags &= ~b2_simStoppedTouching;
-				contact->flags &= ~b2_contactTouchingFlag;
+	B2_ASSERT( startIndex < endIndex );
 
-				if ( contact->flags & b2_contactEnableContactEvents )
-				{
-					b2ContactEndTouchEvent event = { shapeIdA, shapeIdB, contactFullId };
-					b2Array_Push( world->contactEndEvents[endEventArrayIndex], event );
-				}
+	b2CollideBatch batch;
+	batch.fcn = NULL;
+	batch.count = 0;
+	b2CollideBatch* sortedBatch = world->enableSortedCollide ? &batch : NULL;
 
-				B2_ASSERT( contactSim->manifold.pointCount == 0 );
+	b2PreSolveBatch preSolveBatch;
+	preSolveBatch.count = 0;
 
-				b2UnlinkContact( world, contact );
-				int bodyIdA = contact->edges[0].bodyId;
-				int bodyIdB = contact->edges[1].bodyId;
+	for ( int contactIndex = startIndex; contactIndex < endIndex; ++contactIndex )
+	{
+		b2CollideContact( world, taskContext, contactSims[contactIndex], sortedBatch, &preSolveBatch );
+	}
 
-				// Add first for memcpy
-				b2AddNonTouchingContact( world, contact, contactSim );
-				b2RemoveContactFromGraph( world, bodyIdA, bodyIdB, colorIndex, localIndex );
-				contact = NULL;
-				contactSim = NULL;
-			}
-
-			// Clear the smallest set bit
-			bits = bits & ( bits - 1 );
-		}
+	if ( batch.count > 0 )
+	{
+		b2FlushCollideBatch( world, taskContext, &batch, &preSolveBatch );
 	}
 
-	b2ValidateSolverSets( world );
-	b2ValidateContacts( world );
+	if ( preSolveBatch.count > 0 )
+	{
+		b2FlushPreSolveBatch( world, taskContext, &preSolveBatch );
+	}
 
-	b2TracyCZoneEnd( contact_state );
-	b2TracyCZoneEnd( collide );
+	b2TracyCZoneEnd( collide_task );
 }
 
-void b2World_Step( b2WorldId worldId, float timeStep, int subStepCount )
+// Collide the graph color contacts one wide constraint at a time and prepare the constraint right after, while
+// the contacts are in cache. The items past the wide constraints are the contacts in context->contactSims.
+// See b2WorldDef::enableFusedPrepare.
+static void b2CollidePrepareTask( int startIndex, int endIndex, int workerIndex, void* context )
 {
-	B2_ASSERT( b2IsValidFloat( timeStep ) );
-	B2_ASSERT( 0 < subStepCount );
-
-	b2World* world = b2GetWorldFromId( worldId );
-	B2_ASSERT( world->locked == false );
-	if ( world->locked )
-	{
-		b2TracyCFrame;
-		return;
-	}
-
-	// Prepare to capture events
-	// Ensure user does not access stale data if there is an early return
-	b2Array_Clear( world->bodyMoveEvents );
-	b2Array_Clear( world->sensorBeginEvents );
-	b2Array_Clear( world->contactBeginEvents );
-	b2Array_Clear( world->contactHitEvents );
-	b2Array_Clear( world->jointEvents );
+	b2TracyCZoneNC( collide_task, "Collide Prepare", b2_colorDodgerBlue, true );
 
-	world->profile = (b2Profile){ 0 };
+	b2StepContext* stepContext = context;
+	b2World* world = stepContext->world;
+	b2TaskContext* taskContext = world->taskContexts.data + workerIndex;
+	b2GraphColor* colors = world->constraintGraph.colors;
+	const b2FusedPrepare* fused = &stepContext->fusedPrepare;
+	int wideCount = fused->wideCount;
 
-	b2TracyCZoneNC( world_step, "Step", b2_colorBox2DGreen, true );
+	B2_ASSERT( startIndex < endIndex );
 
-	world->locked = true;
-	world->activeTaskCount = 0;
-	world->taskCount = 0;
+	b2PreSolveBatch preSolveBatch;
+	preSolveBatch.count = 0;
 
-	if ( world->scheduler != NULL )
+	int index = startIndex;
+	int colorIndex = 0;
+	int wideEndIndex = b2MinInt( endIndex, wideCount );
+	for ( ; index < wideEndIndex; ++index )
 	{
-		b2ResetScheduler( world->scheduler );
-	}
+		while ( fused->colorStarts[colorIndex + 1] <= index )
+		{
+			colorIndex += 1;
+		}
 
-	uint64_t stepTicks = b2GetTicks();
+		int contactIndex = B2_SIMD_WIDTH * ( index - fused->colorStarts[colorIndex] );
+		int laneCount = b2MinInt( B2_SIMD_WIDTH, fused->colorCounts[colorIndex] - contactIndex );
+		b2ContactSim* contactSims = colors[colorIndex].contactSims.data + contactIndex;
 
-	{
-		b2Capacity* c = &world->maxCapacity;
-		c->staticShapeCount = b2MaxInt( c->staticShapeCount, world->broadPhase.trees[b2_staticBody].proxyCount );
-		c->dynamicShapeCount = b2MaxInt( c->dynamicShapeCount, world->broadPhase.trees[b2_dynamicBody].proxyCount );
+		for ( int lane = 0; lane < laneCount; ++lane )
+		{
+			b2CollideContact( world, taskContext, contactSims + lane, NULL, &preSolveBatch );
+		}
 
-		int staticBodyCount = world->solverSets.data[b2_staticSet].bodySims.count;
-		c->staticBodyCount = b2MaxInt( c->staticBodyCount, staticBodyCount );
+		// The pre-solve callback may disable contacts, so it has to run before the prepare
+		if ( preSolveBatch.count > 0 )
+		{
+			b2FlushPreSolveBatch( world, taskContext, &preSolveBatch );
+		}
 
-		// this includes kinematic bodies
-		int totalBodyCount = b2GetIdCount( &world->bodyIdPool );
-		c->dynamicBodyCount = b2MaxInt( c->dynamicBodyCount, totalBodyCount - staticBodyCount );
+		bool touching = true;
+		for ( int lane = 0; lane < laneCount; ++lane )
+		{
+			b2ContactSim* contactSim = contactSims + lane;
+			touching = touching && contactSim->manifold.pointCount > 0 && ( contactSim->simFlags & b2_simDisjoint ) == 0;
+		}
 
-		int totalContactCount = b2GetIdCount( &world->contactIdPool );
-		c->contactCount = b2MaxInt( c->contactCount, totalContactCount );
+		// A contact that stops touching leaves the color, so the solver prepares the color again
+		if ( touching )
+		{
+			b2PrepareFusedContacts( stepContext, index, contactSims, laneCount );
+		}
 	}
 
-	// Update collision pairs and create contacts
+	b2CollideBatch batch;
+	batch.fcn = NULL;
+	batch.count = 0;
+	b2CollideBatch* sortedBatch = world->enableSortedCollide ? &batch : NULL;
+
+	for ( ; index < endIndex; ++index )
 	{
-		uint64_t pairTicks = b2GetTicks();
-		b2UpdateBroadPhasePairs( world );
-		world->profile.pairs = b2GetMilliseconds( pairTicks );
+		b2CollideContact( world, taskContext, stepContext->contactSims[index - wideCount], sortedBatch, &preSolveBatch );
 	}
 
-	b2StepContext context = { 0 };
-	context.world = world;
-	context.dt = timeStep;
-	context.subStepCount = b2MaxInt( 1, subStepCount );
-
-	if ( timeStep > 0.0f )
+	if ( batch.count > 0 )
 	{
-		context.inv_dt = 1.0f / timeStep;
-		context.h = timeStep / context.subStepCount;
-		context.inv_h = context.subStepCount * context.inv_dt;
+		b2FlushCollideBatch( world, taskContext, &batch, &preSolveBatch );
 	}
-	else
+
+	if ( preSolveBatch.count > 0 )
 	{
-		context.inv_dt = 0.0f;
-		context.h = 0.0f;
-		context.inv_h = 0.0f;
+		b2FlushPreSolveBatch( world, taskContext, &preSolveBatch );
 	}
 
-	world->inv_h = context.inv_h;
-	world->inv_dt = context.inv_dt;
+	b2TracyCZoneEnd( collide_task );
+}
 
-	// Hertz values get reduced for large time steps
-	float contactHertz = b2MinFloat( world->contactHertz, 0.125f * context.inv_h );
-	context.contactSoftness = b2MakeSoft( contactHertz, world->contactDampingRatio, context.h );
-	context.staticSoftness = b2MakeSoft( 2.0f * contactHertz, world->contactDampingRatio, context.h );
+static void b2AddNonTouchingContact( b2World* world, b2Contact* contact, b2ContactSim* contactSim )
+{
+	B2_ASSERT( contact->setIndex == b2_awakeSet );
+	b2SolverSet* set = b2Array_Get( world->solverSets, b2_awakeSet );
+	contact->colorIndex = B2_NULL_INDEX;
+	contact->localIndex = set->contactSims.count;
 
-	context.restitutionThreshold = world->restitutionThreshold;
-	context.maxLinearVelocity = world->maxLinearSpeed;
-	context.enableWarmStarting = world->enableWarmStarting;
+	b2ContactSim* newContactSim = b2Array_Emplace( set->contactSims );
+	memcpy( newContactSim, contactSim, sizeof( b2ContactSim ) );
+}
 
-	// Narrow phase : update contacts
+static void b2RemoveNonTouchingContact( b2World* world, int setIndex, int localIndex )
+{
+	b2SolverSet* set = b2Array_Get( world->solverSets, setIndex );
+	int movedIndex = b2Array_RemoveSwap( set->contactSims, localIndex );
+	if ( movedIndex != B2_NULL_INDEX )
 	{
-		uint64_t collideTicks = b2GetTicks();
-		b2Collide( &context );
-		world->profile.collide = b2GetMilliseconds( collideTicks );
+		b2ContactSim* movedContactSim = set->contactSims.data + localIndex;
+		b2Contact* movedContact = b2Array_Get( world->contacts, movedContactSim->contactId );
+		B2_ASSERT( movedContact->setIndex == setIndex );
+		B2_ASSERT( movedContact->localIndex == movedIndex );
+		B2_ASSERT( movedContact->colorIndex == B2_NULL_INDEX );
+		movedContact->localIndex = localIndex;
 	}
+}
 
-	// Integrate velocities, solve velocity constraints, and integrate positions.
-	if ( timeStep > 0.0f )
+// Gather the awake contacts bucketed by shape pair type with a counting sort. The narrow phase results
+// do not depend on the contact order, so this gives the same results as the storage order.
+static void b2GatherSortedContacts( b2World* world, b2ContactSim** contactSims, int contactCount )
+{
+	b2TracyCZoneNC( sort_contacts, "Sort Contacts", b2_colorDodgerBlue, true );
+
+	b2GraphColor* graphColors = world->constraintGraph.colors;
+	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
+
+	int offsets[B2_SHAPE_PAIR_TYPE_COUNT] = { 0 };
+	for ( int i = 0; i < B2_GRAPH_COLOR_COUNT; ++i )
 	{
-		uint64_t solveTicks = b2GetTicks();
-		b2Solve( world, &context );
-		world->profile.solve = b2GetMilliseconds( solveTicks );
+		b2GraphColor* color = graphColors + i;
+		int count = color->contactSims.count;
+		b2ContactSim* base = color->contactSims.data;
+		for ( int j = 0; j < count; ++j )
+		{
+			offsets[base[j].pairType] += 1;
+		}
 	}
 
-	// Finish the tree task in case b2Solve didn't finish it
-	if ( world->userTreeTask )
+	for ( int i = 0; i < awakeSet->contactSims.count; ++i )
 	{
-		world->finishTaskFcn( world->userTreeTask, world->userTaskContext );
-		world->userTreeTask = NULL;
-		world->activeTaskCount -= 1;
+		offsets[awakeSet->contactSims.data[i].pairType] += 1;
 	}
 
-	// Update sensors
+	int start = 0;
+	for ( int i = 0; i < B2_SHAPE_PAIR_TYPE_COUNT; ++i )
 	{
-		uint64_t sensorTicks = b2GetTicks();
-		b2OverlapSensors( world );
-		world->profile.sensors = b2GetMilliseconds( sensorTicks );
+		int count = offsets[i];
+		offsets[i] = start;
+		start += count;
 	}
 
-	world->profile.step = b2GetMilliseconds( stepTicks );
-
-	B2_ASSERT( b2GetStackAllocation( &world->stack ) == 0 );
-
-	// Ensure stack is large enough
-	b2GrowStack( &world->stack );
-
-	// Make sure all tasks that were started were also finished
-	B2_ASSERT( world->activeTaskCount == 0 );
+	B2_ASSERT( start == contactCount );
+	B2_UNUSED( contactCount );
 
-	b2TracyCZoneEnd( world_step );
+	for ( int i = 0; i < B2_GRAPH_COLOR_COUNT; ++i )
+	{
+		b2GraphColor* color = graphColors + i;
+		int count = color->contactSims.count;
+		b2ContactSim* base = color->contactSims.data;
+		for ( int j = 0; j < count; ++j )
+		{
+			contactSims[offsets[base[j].pairType]++] = base + j;
+		}
+	}
 
-	// Swap end event array buffers
-	world->endEventArrayIndex = 1 - world->endEventArrayIndex;
-	b2Array_Clear( world->sensorEndEvents[world->endEventArrayIndex] );
-	b2Array_Clear( world->contactEndEvents[world->endEventArrayIndex] );
-	world->locked = false;
+	for ( int i = 0; i < awakeSet->contactSims.count; ++i )
+	{
+		b2ContactSim* contactSim = awakeSet->contactSims.data + i;
+		contactSims[offsets[contactSim->pairType]++] = contactSim;
+	}
 
-	b2TracyCFrame;
+	b2TracyCZoneEnd( sort_contacts );
 }
 
-static void b2DrawShape( b2DebugDraw* draw, b2Shape* shape, b2Transform xf, b2HexColor color )
+// Lay out the wide constraints of the graph colors for b2CollidePrepareTask and gather the overflow and
+// non-touching contacts into context->contactSims. Returns the item count of b2CollidePrepareTask, one item
+// per wide constraint followed by one per gathered contact.
+static int b2GatherFusedContacts( b2StepContext* context )
 {
-	switch ( shape->type )
+	b2World* world = context->world;
+	b2GraphColor* graphColors = world->constraintGraph.colors;
+	b2FusedPrepare* fused = &context->fusedPrepare;
+
+	int wideCount = 0;
+	for ( int i = 0; i < B2_OVERFLOW_INDEX; ++i )
 	{
-		case b2_capsuleShape:
-		{
-			b2Capsule* capsule = &shape->capsule;
-			b2Vec2 p1 = b2TransformPoint( xf, capsule->center1 );
-			b2Vec2 p2 = b2TransformPoint( xf, capsule->center2 );
-			draw->DrawSolidCapsuleFcn( p1, p2, capsule->radius, color, draw->context );
-		}
-		break;
+		int count = graphColors[i].contactSims.count;
+		fused->colorStarts[i] = wideCount;
+		fused->colorCounts[i] = count;
+		wideCount += count > 0 ? ( ( count - 1 ) >> B2_SIMD_SHIFT ) + 1 : 0;
+	}
 
-		case b2_circleShape:
-		{
-			b2Circle* circle = &shape->circle;
-			xf.p = b2TransformPoint( xf, circle->center );
-			draw->DrawSolidCircleFcn( xf, circle->radius, color, draw->context );
-		}
-		break;
+	fused->colorStarts[B2_OVERFLOW_INDEX] = wideCount;
+	fused->colorCounts[B2_OVERFLOW_INDEX] = 0;
+	fused->wideCount = wideCount;
+	fused->constraints = NULL;
+	fused->colds = NULL;
+	world->constraintGraph.changedContactColors = 0;
 
-		case b2_polygonShape:
-		{
-			b2Polygon* poly = &shape->polygon;
-			draw->DrawSolidPolygonFcn( xf, poly->vertices, poly->count, poly->radius, color, draw->context );
-		}
-		break;
+	// Freed after the solve. These come before the contact pointers on the stack.
+	if ( wideCount > 0 )
+	{
+		fused->constraints =
+			b2StackAlloc( &world->stack, wideCount * b2GetWideContactConstraintByteCount(), "fused contact constraint" );
+		fused->colds = b2StackAlloc( &world->stack, wideCount * b2GetWideContactColdByteCount(), "fused contact cold" );
+	}
 
-		case b2_segmentShape:
+	b2GraphColor* overflow = graphColors + B2_OVERFLOW_INDEX;
+	int overflowCount = overflow->contactSims.count;
+	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
+	int nonTouchingCount = awakeSet->contactSims.count;
+	int otherCount = overflowCount + nonTouchingCount;
+
+	if ( otherCount > 0 )
+	{
+		b2ContactSim** contactSims = b2StackAlloc( &world->stack, otherCount * sizeof( b2ContactSim* ), "contacts" );
+		for ( int i = 0; i < overflowCount; ++i )
 		{
-			b2Segment* segment = &shape->segment;
-			b2Vec2 p1 = b2TransformPoint( xf, segment->point1 );
-			b2Vec2 p2 = b2TransformPoint( xf, segment->point2 );
-			draw->DrawLineFcn( p1, p2, color, draw->context );
+			contactSims[i] = overflow->contactSims.data + i;
 		}
-		break;
 
-		case b2_chainSegmentShape:
+		for ( int i = 0; i < nonTouchingCount; ++i )
 		{
-			b2Segment* segment = &shape->chainSegment.segment;
-			b2Vec2 p1 = b2TransformPoint( xf, segment->point1 );
-			b2Vec2 p2 = b2TransformPoint( xf, segment->point2 );
-			draw->DrawLineFcn( p1, p2, color, draw->context );
-			draw->DrawPointFcn( p2, 4.0f, color, draw->context );
-			draw->DrawLineFcn( p1, b2Lerp( p1, p2, 0.1f ), b2_colorPaleGreen, draw->context );
+			contactSims[overflowCount + i] = awakeSet->contactSims.data + i;
 		}
-		break;
 
-		default:
-			break;
+		context->contactSims = contactSims;
 	}
+
+	return wideCount + otherCount;
 }
 
-struct DrawContext
+// Gather the awake contacts into context->contactSims for easier parallel-for and reset the collide state
+// of the workers. Returns the contact count. The array is only allocated if there are contacts. With
+// b2WorldDef::enableFusedPrepare this returns the item count of b2CollidePrepareTask instead.
+static int b2GatherContacts( b2StepContext* context )
 {
-	b2World* world;
-	b2DebugDraw* draw;
-};
+	b2World* world = context->world;
 
-static bool DrawQueryCallback( int proxyId, uint64_t userData, void* context )
-{
-	B2_UNUSED( proxyId );
+	// Contact bit set on ids because contact pointers are unstable as they move between touching and not touching.
+	int contactIdCapacity = b2GetIdCapacity( &world->contactIdPool );
+	for ( int i = 0; i < world->workerCount; ++i )
+	{
+		b2SetBitCountAndClear( &world->taskContexts.data[i].contactStateBitSet, contactIdCapacity );
+		world->taskContexts.data[i].recycledContactCount = 0;
+		world->taskContexts.data[i].cachedAxisContactCount = 0;
+		world->taskContexts.data[i].separatedContactCount = 0;
+	}
 
-	int shapeId = (int)userData;
+	context->contactSims = NULL;
 
-	struct DrawContext* drawContext = context;
-	b2World* world = drawContext->world;
-	b2DebugDraw* draw = drawContext->draw;
+	if ( world->enableFusedPrepare )
+	{
+		return b2GatherFusedContacts( context );
+	}
 
-	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
-	B2_ASSERT( shape->id == shapeId );
+	int contactCount = 0;
+	b2GraphColor* graphColors = world->constraintGraph.colors;
+	for ( int i = 0; i < B2_GRAPH_COLOR_COUNT; ++i )
+	{
+		contactCount += graphColors[i].contactSims.count;
+	}
 
-	b2SetBit( &world->debugBodySet, shape->bodyId );
+	int nonTouchingCount = world->solverSets.data[b2_awakeSet].contactSims.count;
+	contactCount += nonTouchingCount;
 
-	if ( draw->drawShapes )
+	if ( contactCount == 0 )
 	{
-		b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
-		b2BodySim* bodySim = b2GetBodySim( world, body );
+		return 0;
+	}
 
-		b2HexColor color;
+	b2ContactSim** contactSims = b2StackAlloc( &world->stack, contactCount * sizeof( b2ContactSim* ), "contacts" );
 
-		if ( shape->material.customColor != 0 )
-		{
-			color = shape->material.customColor;
-		}
-		else if ( body->type == b2_dynamicBody && body->mass == 0.0f )
-		{
-			// Bad body
-			color = b2_colorRed;
-		}
-		else if ( body->setIndex == b2_disabledSet )
-		{
-			color = b2_colorSlateGray;
-		}
-		else if ( shape->sensorIndex != B2_NULL_INDEX )
-		{
-			color = b2_colorWheat;
-		}
-		else if ( body->flags & b2_hadTimeOfImpact )
+	if ( world->enableSortedCollide )
+	{
+		b2GatherSortedContacts( world, contactSims, contactCount );
+	}
+	else
+	{
+		int contactIndex = 0;
+		for ( int i = 0; i < B2_GRAPH_COLOR_COUNT; ++i )
 		{
-			color = b2_colorLime;
+			b2GraphColor* color = graphColors + i;
+			int count = color->contactSims.count;
+			b2ContactSim* base = color->contactSims.data;
+			for ( int j = 0; j < count; ++j )
+			{
+				contactSims[contactIndex] = base + j;
+				contactIndex += 1;
+			}
 		}
-		else if ( ( bodySim->flags & b2_isBullet ) && body->setIndex == b2_awakeSet )
+
 		{
-			color = b2_colorTurquoise;
+			b2ContactSim* base = world->solverSets.data[b2_awakeSet].contactSims.data;
+			for ( int i = 0; i < nonTouchingCount; ++i )
+			{
+				contactSims[contactIndex] = base + i;
+				contactIndex += 1;
+			}
 		}
-		else if ( body->flags & b2_isSpeedCapped )
+
+		B2_ASSERT( contactIndex == contactCount );
+	}
+
+	context->contactSims = contactSims;
+	return contactCount;
+}
+
+// Below this many contact state changes the contacts that started touching are linked one at a time
+#define B2_BULK_TOUCHING_CONTACTS 64
+
+static int b2CompareIndicesDescending( const void* a, const void* b )
+{
+	int indexA = *(const int*)a;
+	int indexB = *(const int*)b;
+	return ( indexA < indexB ) - ( indexA > indexB );
+}
+
+// Links the contacts that started touching into islands and moves them into the constraint graph
+// in bulk
+static void b2AddTouchingContacts( b2World* world, const int* contactIds, int count )
+{
+	b2TracyCZoneNC( touching_contacts, "Touching Contacts", b2_colorLightSlateGray, true );
+
+	b2LinkContacts( world, contactIds, count );
+
+	int* sourceIndices = b2StackAlloc( &world->stack, count * sizeof( int ), "touching contact sources" );
+	for ( int i = 0; i < count; ++i )
+	{
+		b2Contact* contact = world->contacts.data + contactIds[i];
+		B2_ASSERT( contact->setIndex == b2_awakeSet && contact->colorIndex == B2_NULL_INDEX );
+		sourceIndices[i] = contact->localIndex;
+	}
+
+	b2AddTouchingContactsToGraph( world, contactIds, sourceIndices, count );
+
+	// Remove from the back so a swap never moves a contact sim that is still to be removed
+	qsort( sourceIndices, count, sizeof( int ), b2CompareIndicesDescending );
+	for ( int i = 0; i < count; ++i )
+	{
+		b2RemoveNonTouchingContact( world, b2_awakeSet, sourceIndices[i] );
+	}
+
+	b2StackFree( &world->stack, sourceIndices );
+
+	b2TracyCZoneEnd( touching_contacts );
+}
+
+// Below this many contact state changes the events are gathered on one thread, even with relaxed determinism
+#define B2_PARALLEL_CONTACT_EVENTS 64
+
+typedef struct b2ContactEventsContext
+{
+	b2World* world;
+	const int* contactIds;
+} b2ContactEventsContext;
+
+// Gathers the begin and end touch events of the contacts that changed state into the worker arrays. Contacts
+// that are no longer overlapping report their end event when destroyed.
+static void b2ContactEventsTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	b2TracyCZoneNC( contact_events, "Contact Events", b2_colorLightSlateGray, true );
+
+	b2ContactEventsContext* eventsContext = context;
+	b2World* world = eventsContext->world;
+	b2TaskContext* taskContext = world->taskContexts.data + workerIndex;
+	b2SolverSet* awakeSet = world->solverSets.data + b2_awakeSet;
+	const b2Shape* shapes = world->shapes.data;
+	uint16_t worldId = world->worldId;
+
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		int contactId = eventsContext->contactIds[i];
+		const b2Contact* contact = world->contacts.data + contactId;
+		if ( ( contact->flags & b2_contactEnableContactEvents ) == 0 )
 		{
-			color = b2_colorYellow;
+			continue;
 		}
-		else if ( bodySim->flags & b2_isFast )
+
+		const b2ContactSim* contactSim;
+		if ( contact->colorIndex != B2_NULL_INDEX )
 		{
-			color = b2_colorSalmon;
+			contactSim = world->constraintGraph.colors[contact->colorIndex].contactSims.data + contact->localIndex;
 		}
-		else if ( body->type == b2_staticBody )
+		else
 		{
-			color = b2_colorPaleGreen;
+			contactSim = awakeSet->contactSims.data + contact->localIndex;
 		}
-		else if ( body->type == b2_kinematicBody )
+
+		uint32_t simFlags = contactSim->simFlags;
+		if ( simFlags & b2_simDisjoint )
 		{
-			color = b2_colorRoyalBlue;
+			continue;
 		}
-		else if ( body->setIndex == b2_awakeSet )
+
+		const b2Shape* shapeA = shapes + contact->shapeIdA;
+		const b2Shape* shapeB = shapes + contact->shapeIdB;
+		b2ShapeId shapeIdA = { shapeA->id + 1, worldId, shapeA->generation };
+		b2ShapeId shapeIdB = { shapeB->id + 1, worldId, shapeB->generation };
+		b2ContactId contactFullId = {
+			.index1 = contactId + 1,
+			.world0 = worldId,
+			.padding = 0,
+			.generation = contact->generation,
+		};
+
+		if ( simFlags & b2_simStartedTouching )
 		{
-			color = b2_colorPink;
+			b2ContactBeginTouchEvent event = { shapeIdA, shapeIdB, contactFullId };
+			b2Array_Push( taskContext->contactBeginEvents, event );
 		}
-		else
+		else if ( simFlags & b2_simStoppedTouching )
 		{
-			color = b2_colorGray;
+			b2ContactEndTouchEvent event = { shapeIdA, shapeIdB, contactFullId };
+			b2Array_Push( taskContext->contactEndEvents, event );
 		}
+	}
 
-		b2DrawShape( draw, shape, bodySim->transform, color );
+	b2TracyCZoneEnd( contact_events );
+}
+
+// With relaxed determinism, many contact state changes have their events gathered in parallel. The events
+// are appended in worker order, so their order depends on the task split. Returns true if the events
+// were gathered.
+static bool b2GatherContactEvents( b2World* world, b2BitSet* bitSet, int changeCount )
+{
+	if ( world->enableRelaxedDeterminism == false || world->workerCount == 1 || changeCount < B2_PARALLEL_CONTACT_EVENTS )
+	{
+		return false;
 	}
 
-	if ( draw->drawBounds )
+	int* contactIds = b2StackAlloc( &world->stack, changeCount * sizeof( int ), "event contacts" );
+	int count = 0;
+
+	b2BitIterator it = b2IterateBits( bitSet, 0, 64 * bitSet->blockCount );
+	uint32_t bitIndex;
+	while ( b2NextSetBit( &it, &bitIndex ) )
 	{
-		b2AABB aabb = shape->fatAABB;
+		contactIds[count++] = (int)bitIndex;
+	}
 
-		b2Vec2 vs[4] = { { aabb.lowerBound.x, aabb.lowerBound.y },
-						 { aabb.upperBound.x, aabb.lowerBound.y },
-						 { aabb.upperBound.x, aabb.upperBound.y },
-						 { aabb.lowerBound.x, aabb.upperBound.y } };
+	B2_ASSERT( count == changeCount );
 
-		draw->DrawPolygonFcn( vs, 4, b2_colorGold, draw->context );
+	for ( int i = 0; i < world->workerCount; ++i )
+	{
+		b2Array_Clear( world->taskContexts.data[i].contactBeginEvents );
+		b2Array_Clear( world->taskContexts.data[i].contactEndEvents );
 	}
 
-	return true;
-}
+	b2ContactEventsContext context = { world, contactIds };
+	b2ParallelFor( world, &b2ContactEventsTask, count, B2_PARALLEL_CONTACT_EVENTS, &context );
 
-// todo this has varying order for moving shapes, causing flicker when overlapping shapes are moving
-// solution: display order by shape id modulus 3, keep 3 buckets in GLSolid* and flush in 3 passes.
-void b2World_Draw( b2WorldId worldId, b2DebugDraw* draw )
-{
-	b2World* world = b2GetWorldFromId( worldId );
-	B2_ASSERT( world->locked == false );
-	if ( world->locked )
+	b2AllocInfo previous = b2PushAllocTag( b2_allocTagEvents, b2_allocLifetimeLong );
+	for ( int i = 0; i < world->workerCount; ++i )
 	{
-		return;
+		b2TaskContext* taskContext = world->taskContexts.data + i;
+		b2Array_Append( world->contactBeginEvents, taskContext->contactBeginEvents );
+		b2Array_Append( world->contactEndEvents[world->endEventArrayIndex], taskContext->contactEndEvents );
 	}
+	b2PopAllocInfo( previous );
 
-	B2_ASSERT( b2IsValidAABB( draw->drawingBounds ) );
+	b2StackFree( &world->stack, contactIds );
+	return true;
+}
 
-	const float k_axisScale = 0.3f;
-	b2HexColor speculativeColor = b2_colorGainsboro;
-	b2HexColor addColor = b2_colorGreen;
-	b2HexColor persistColor = b2_colorBlue;
-	b2HexColor normalColor = b2_colorDimGray;
-	b2HexColor impulseColor = b2_colorMagenta;
-	b2HexColor frictionColor = b2_colorYellow;
+// Serially update contact state from the bits set by b2CollideTask. When many contacts change in
+// one step, such as debris landing, the contacts that started touching are gathered and linked in
+// bulk after the others.
+static void b2UpdateContactStates( b2World* world )
+{
+	// todo_erin bring this zone together with island merge
+	b2TracyCZoneNC( contact_state, "Contact State", b2_colorLightSlateGray, true );
 
-	int bodyCapacity = b2GetIdCapacity( &world->bodyIdPool );
-	b2SetBitCountAndClear( &world->debugBodySet, bodyCapacity );
+	b2GraphColor* graphColors = world->constraintGraph.colors;
 
-	int jointCapacity = b2GetIdCapacity( &world->jointIdPool );
-	b2SetBitCountAndClear( &world->debugJointSet, jointCapacity );
+	// Bitwise OR all contact bits
+	b2UnionWorkerBitSets( world, offsetof( b2TaskContext, contactStateBitSet ) );
+	b2BitSet* bitSet = &world->taskContexts.data[0].contactStateBitSet;
 
-	int contactCapacity = b2GetIdCapacity( &world->contactIdPool );
-	b2SetBitCountAndClear( &world->debugContactSet, contactCapacity );
+	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
 
-	int islandCapacity = b2GetIdCapacity( &world->islandIdPool );
-	b2SetBitCountAndClear( &world->debugIslandSet, islandCapacity );
+	int endEventArrayIndex = world->endEventArrayIndex;
 
-	struct DrawContext drawContext = { world, draw };
+	const b2Shape* shapes = world->shapes.data;
+	uint16_t worldId = world->worldId;
 
-	for ( int i = 0; i < b2_bodyTypeCount; ++i )
+	int* touchingIds = NULL;
+	int touchingCount = 0;
+	int changeCount = b2CountSetBits( bitSet );
+	if ( changeCount >= B2_BULK_TOUCHING_CONTACTS )
 	{
-		b2DynamicTree_QueryAll( world->broadPhase.trees + i, draw->drawingBounds, DrawQueryCallback, &drawContext );
+		touchingIds = b2StackAlloc( &world->stack, changeCount * sizeof( int ), "touching contacts" );
 	}
 
-	uint32_t wordCount = world->debugBodySet.blockCount;
-	uint64_t* bits = world->debugBodySet.bits;
-	for ( uint32_t k = 0; k < wordCount; ++k )
+	bool eventsGathered = b2GatherContactEvents( world, bitSet, changeCount );
+
+	// Process contact state changes. Iterate over set bits
+	b2BitIterator it = b2IterateBits( bitSet, 0, 64 * bitSet->blockCount );
+	uint32_t bitIndex;
+	while ( b2NextSetBit( &it, &bitIndex ) )
 	{
-		uint64_t word = bits[k];
-		while ( word != 0 )
-		{
-			uint32_t ctz = b2CTZ64( word );
-			uint32_t bodyId = 64 * k + ctz;
+		int contactId = (int)bitIndex;
 
-			b2Body* body = b2Array_Get( world->bodies, (int)bodyId );
+		b2Contact* contact = b2Array_Get( world->contacts, contactId );
+		B2_ASSERT( contact->setIndex == b2_awakeSet );
 
-			if ( draw->drawBodyNames && body->name[0] != 0 )
-			{
-				b2Vec2 offset = { 0.1f, 0.1f };
-				b2BodySim* bodySim = b2GetBodySim( world, body );
+		int colorIndex = contact->colorIndex;
+		int localIndex = contact->localIndex;
 
-				b2Transform transform = { bodySim->center, bodySim->transform.q };
-				b2Vec2 p = b2TransformPoint( transform, offset );
-				draw->DrawStringFcn( p, body->name, b2_colorBlueViolet, draw->context );
-			}
+		b2ContactSim* contactSim = NULL;
+		if ( colorIndex != B2_NULL_INDEX )
+		{
+			// contact lives in constraint graph
+			B2_ASSERT( 0 <= colorIndex && colorIndex < B2_GRAPH_COLOR_COUNT );
+			b2GraphColor* color = graphColors + colorIndex;
+			contactSim = b2Array_Get( color->contactSims, localIndex );
+		}
+		else
+		{
+			contactSim = b2Array_Get( awakeSet->contactSims, localIndex );
+		}
 
-			if ( draw->drawMass && body->type == b2_dynamicBody )
+		const b2Shape* shapeA = shapes + contact->shapeIdA;
+		const b2Shape* shapeB = shapes + contact->shapeIdB;
+		b2ShapeId shapeIdA = { shapeA->id + 1, worldId, shapeA->generation };
+		b2ShapeId shapeIdB = { shapeB->id + 1, worldId, shapeB->generation };
+		b2ContactId contactFullId = {
+			.index1 = contactId + 1,
+			.world0 = worldId,
+			.padding = 0,
+			.generation = contact->generation,
+		};
+		uint32_t flags = contact->flags;
+		uint32_t simFlags = contactSim->simFlags;
+
+		if ( simFlags & b2_simDisjoint )
+		{
+			if ( world->enableDetailedCounters && ( flags & b2_contactHasTouchedFlag ) == 0 )
 			{
-				b2Vec2 offset = { 0.1f, 0.1f };
-				b2BodySim* bodySim = b2GetBodySim( world, body );
+				world->taskContexts.data[0].detailedCounters.untouchedContactCount += 1;
+			}
 
-				b2Transform transform = { bodySim->center, bodySim->transform.q };
-				draw->DrawLineFcn( bodySim->center0, bodySim->center, b2_colorWhiteSmoke, draw->context );
-				draw->DrawTransformFcn( transform, draw->context );
+			// Bounding boxes no longer overlap
+			b2DestroyContact( world, contact, false );
+			contact = NULL;
+			contactSim = NULL;
+		}
+		else if ( simFlags & b2_simStartedTouching )
+		{
+			B2_ASSERT( contact->islandId == B2_NULL_INDEX );
 
-				b2Vec2 p = b2TransformPoint( transform, offset );
-				char buffer[32];
-				snprintf( buffer, 32, "  %.2f", body->mass );
-				draw->DrawStringFcn( p, buffer, b2_colorWhite, draw->context );
+			if ( ( flags & b2_contactEnableContactEvents ) && eventsGathered == false )
+			{
+				b2ContactBeginTouchEvent event = { shapeIdA, shapeIdB, contactFullId };
+				b2AllocInfo previous = b2PushAllocTag( b2_allocTagEvents, b2_allocLifetimeLong );
+				b2Array_Push( world->contactBeginEvents, event );
+				b2PopAllocInfo( previous );
 			}
 
-			if ( draw->drawJoints )
-			{
-				int jointKey = body->headJointKey;
-				while ( jointKey != B2_NULL_INDEX )
-				{
-					int jointId = jointKey >> 1;
-					int edgeIndex = jointKey & 1;
-					b2Joint* joint = b2Array_Get( world->joints, jointId );
+			B2_ASSERT( contactSim->manifold.pointCount > 0 );
+			B2_ASSERT( contact->setIndex == b2_awakeSet );
 
-					// avoid double draw
-					if ( b2GetBit( &world->debugJointSet, jointId ) == false )
-					{
-						b2DrawJoint( draw, world, joint );
-						b2SetBit( &world->debugJointSet, jointId );
-					}
+			contact->flags |= b2_contactTouchingFlag | b2_contactHasTouchedFlag;
 
-					jointKey = joint->edges[edgeIndex].nextKey;
-				}
+			if ( touchingIds != NULL )
+			{
+				contactSim->simFlags &= ~b2_simStartedTouching;
+				touchingIds[touchingCount++] = contactId;
+				continue;
 			}
 
-			const float linearSlop = B2_LINEAR_SLOP;
-			if ( draw->drawContacts && body->type == b2_dynamicBody )
-			{
-				int contactKey = body->headContactKey;
-				while ( contactKey != B2_NULL_INDEX )
-				{
-					int contactId = contactKey >> 1;
-					int edgeIndex = contactKey & 1;
-					b2Contact* contact = b2Array_Get( world->contacts, contactId );
-					contactKey = contact->edges[edgeIndex].nextKey;
+			// Link first because this wakes colliding bodies and ensures the body sims
+			// are in the correct place.
+			b2LinkContact( world, contact );
 
-					// avoid double draw
-					if ( b2GetBit( &world->debugContactSet, contactId ) == false )
-					{
-						b2ContactSim* contactSim = b2GetContactSim( world, contact );
-						b2Body* bodyA = b2Array_Get( world->bodies, contact->edges[0].bodyId );
-						b2BodySim* bodySimA = b2GetBodySim( world, bodyA );
-						b2Body* bodyB = b2Array_Get( world->bodies, contact->edges[1].bodyId );
-						b2BodySim* bodySimB = b2GetBodySim( world, bodyB );
-						int pointCount = contactSim->manifold.pointCount;
-						b2Vec2 normal = contactSim->manifold.normal;
-						char buffer[32];
+			// Make sure these didn't change
+			B2_ASSERT( contact->colorIndex == B2_NULL_INDEX );
+			B2_ASSERT( contact->localIndex == localIndex );
 
-						for ( int j = 0; j < pointCount; ++j )
-						{
-							b2ManifoldPoint* mp = contactSim->manifold.points + j;
+			// Contact sim pointer may have become orphaned due to awake set growth,
+			// so I just need to refresh it.
+			contactSim = b2Array_Get( awakeSet->contactSims, localIndex );
 
-							b2Vec2 p;
-							if ( draw->drawAnchorA )
-							{
-								p = b2Add( bodySimA->center, mp->anchorA );
-							}
-							else
-							{
-								p = b2Add( bodySimB->center, mp->anchorB );
-							}
+			contactSim->simFlags &= ~b2_simStartedTouching;
 
-							if ( draw->drawGraphColors && contact->colorIndex != B2_NULL_INDEX )
-							{
-								// graph color
-								float pointSize = contact->colorIndex == B2_OVERFLOW_INDEX ? 7.5f : 5.0f;
-								draw->DrawPointFcn( p, pointSize, b2GetGraphColor( contact->colorIndex ), draw->context );
-								// m_context->draw.DrawString(point->position, "%d", point->color);
-							}
-							else if ( mp->separation > linearSlop )
-							{
-								// Speculative
-								draw->DrawPointFcn( p, 5.0f, speculativeColor, draw->context );
-							}
-							else if ( mp->persisted == false )
-							{
-								// Add
-								draw->DrawPointFcn( p, 10.0f, addColor, draw->context );
-							}
-							else if ( mp->persisted == true )
-							{
-								// Persist
-								draw->DrawPointFcn( p, 5.0f, persistColor, draw->context );
-							}
+			// Add first for memcpy
+			b2AddContactToGraph( world, contactSim, contact );
 
-							if ( draw->drawContactNormals )
-							{
-								b2Vec2 p1 = p;
-								b2Vec2 p2 = b2MulAdd( p1, k_axisScale, normal );
-								draw->DrawLineFcn( p1, p2, normalColor, draw->context );
+			// This destroys the contact sim
+			b2RemoveNonTouchingContact( world, b2_awakeSet, localIndex );
 
-								snprintf( buffer, B2_ARRAY_COUNT( buffer ), " %.2f", mp->separation );
-								draw->DrawStringFcn( p1, buffer, b2_colorWhite, draw->context );
-							}
-							else if ( draw->drawContactForces )
-							{
-								// todo validate
-								// multiply by one-half due to relax iteration
-								float force = 0.5f * mp->totalNormalImpulse * world->inv_dt;
-								b2Vec2 p1 = p;
-								b2Vec2 p2 = b2MulAdd( p1, draw->forceScale * force, normal );
-								draw->DrawLineFcn( p1, p2, impulseColor, draw->context );
-								snprintf( buffer, B2_ARRAY_COUNT( buffer ), "%.1f", force );
-								draw->DrawStringFcn( p1, buffer, b2_colorWhite, draw->context );
-							}
+			contactSim = NULL;
+		}
+		else if ( simFlags & b2_simStoppedTouching )
+		{
+			contactSim->simFlags &= ~b2_simStoppedTouching;
+			contact->flags &= ~b2_contactTouchingFlag;
 
-							if ( draw->drawContactFeatures )
-							{
-								snprintf( buffer, B2_ARRAY_COUNT( buffer ), "%d", mp->id );
-								draw->DrawStringFcn( p, buffer, b2_colorOrange, draw->context );
-							}
+			if ( ( contact->flags & b2_contactEnableContactEvents ) && eventsGathered == false )
+			{
+				b2ContactEndTouchEvent event = { shapeIdA, shapeIdB, contactFullId };
+				b2AllocInfo previous = b2PushAllocTag( b2_allocTagEvents, b2_allocLifetimeLong );
+				b2Array_Push( world->contactEndEvents[endEventArrayIndex], event );
+				b2PopAllocInfo( previous );
+			}
 
-							if ( draw->drawFrictionForces )
-							{
-								float force = 0.5f * mp->tangentImpulse * world->inv_h;
+			B2_ASSERT( contactSim->manifold.pointCount == 0 );
+
+			b2UnlinkContact( world, contact );
+			int bodyIdA = contact->edges[0].bodyId;
+			int bodyIdB = contact->edges[1].bodyId;
+
+			// Add first for memcpy
+			b2AddNonTouchingContact( world, contact, contactSim );
+			b2RemoveContactFromGraph( world, bodyIdA, bodyIdB, colorIndex, localIndex );
+			contact = NULL;
+			contactSim = NULL;
+		}
+	}
+
+	if ( touchingIds != NULL )
+	{
+		if ( touchingCount > 0 )
+		{
+			b2AddTouchingContacts( world, touchingIds, touchingCount );
+		}
+
+		b2StackFree( &world->stack, touchingIds );
+	}
+
+	b2ValidateSolverSets( world );
+	b2ValidateContacts( world );
+
+	b2TracyCZoneEnd( contact_state );
+}
+
+// Narrow-phase collision
+static void b2Collide( b2StepContext* context )
+{
+	b2World* world = context->world;
+
+	B2_ASSERT( world->workerCount > 0 );
+
+	b2TracyCZoneNC( collide, "Narrow Phase", b2_colorDodgerBlue, true );
+
+	int contactCount = b2GatherContacts( context );
+	if ( contactCount == 0 )
+	{
+		b2TracyCZoneEnd( collide );
+		return;
+	}
+
+	// Task should take at least 40us on a 4GHz CPU (10K cycles)
+	int minRange = 64;
+	if ( world->enableFusedPrepare )
+	{
+		// A wide constraint item holds several contacts
+		b2ParallelFor( world, &b2CollidePrepareTask, contactCount, minRange / B2_SIMD_WIDTH, context );
+	}
+	else
+	{
+		b2ParallelFor( world, &b2CollideTask, contactCount, minRange, context );
+	}
+
+	if ( context->contactSims != NULL )
+	{
+		b2StackFree( &world->stack, context->contactSims );
+		context->contactSims = NULL;
+	}
+
+	b2UpdateContactStates( world );
+
+	b2TracyCZoneEnd( collide );
+}
+
+// Pair finding and the narrow phase of the existing contacts share one parallel-for, so there is no barrier
+// between them. The contacts created from the new pairs are appended to the awake set and collided after.
+// This gives the same results as b2UpdateBroadPhasePairs followed by b2Collide because the narrow phase of a
+// contact does not depend on other contacts. See b2WorldDef::enablePipelinedCollide.
+static void b2PipelinedCollide( b2StepContext* context )
+{
+	b2World* world = context->world;
+
+	b2TracyCZoneNC( collide, "Narrow Phase", b2_colorDodgerBlue, true );
+
+	int contactCount = b2GatherContacts( context );
+	int oldNonTouchingCount = world->solverSets.data[b2_awakeSet].contactSims.count;
+
+	{
+		uint64_t pairTicks = b2GetTicks();
+		b2PairCompanion companion = { &b2CollideTask, "b2CollideTask", contactCount, context };
+		if ( world->enableFusedPrepare )
+		{
+			companion = (b2PairCompanion){ &b2CollidePrepareTask, "b2CollidePrepareTask", contactCount, context };
+		}
+
+		b2UpdateBroadPhasePairs( world, &companion );
+		world->profile.pairs = b2GetMilliseconds( pairTicks );
+	}
+
+	if ( context->contactSims != NULL )
+	{
+		b2StackFree( &world->stack, context->contactSims );
+		context->contactSims = NULL;
+	}
+
+	// The new contacts may use ids beyond the bits cleared above
+	uint32_t blockCount = ( b2GetIdCapacity( &world->contactIdPool ) + 63 ) / 64;
+	for ( int i = 0; i < world->workerCount; ++i )
+	{
+		b2BitSet* bitSet = &world->taskContexts.data[i].contactStateBitSet;
+		uint32_t oldBlockCount = bitSet->blockCount;
+		if ( blockCount > oldBlockCount )
+		{
+			b2GrowBitSet( bitSet, blockCount );
+			memset( bitSet->bits + oldBlockCount, 0, ( blockCount - oldBlockCount ) * sizeof( uint64_t ) );
+		}
+	}
+
+	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
+	int newContactCount = awakeSet->contactSims.count - oldNonTouchingCount;
+	B2_ASSERT( newContactCount >= 0 );
+
+	if ( newContactCount > 0 )
+	{
+		b2ContactSim** contactSims =
+			b2StackAlloc( &world->stack, newContactCount * sizeof( b2ContactSim* ), "new contacts" );
+		for ( int i = 0; i < newContactCount; ++i )
+		{
+			contactSims[i] = awakeSet->contactSims.data + oldNonTouchingCount + i;
+		}
+
+		context->contactSims = contactSims;
+		b2ParallelFor( world, &b2CollideTask, newContactCount, 64, context );
+
+		b2StackFree( &world->stack, contactSims );
+		context->contactSims = NULL;
+	}
+
+	if ( contactCount + newContactCount > 0 )
+	{
+		b2UpdateContactStates( world );
+	}
+
+	b2TracyCZoneEnd( collide );
+}
+
+// The move deltas quantize the angle change to an int16
+#define B2_MOVE_ANGLE_QUANTUM ( B2_PI / 32768.0f )
+
+typedef struct b2MoveFilterContext
+{
+	b2World* world;
+	b2BodyMoveDelta* deltas;
+	bool* reported;
+} b2MoveFilterContext;
+
+static void b2FilterMoveEventsTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	B2_UNUSED( workerIndex );
+
+	b2MoveFilterContext* filterContext = context;
+	b2World* world = filterContext->world;
+	const b2BodyMoveEvent* moveEvents = world->bodyMoveEvents.data;
+	float linearThreshold = world->moveEventLinearThreshold;
+	float angularThreshold = world->moveEventAngularThreshold;
+	float quantum = world->moveEventQuantum;
+
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		const b2BodyMoveEvent* event = moveEvents + i;
+		b2Body* body = world->bodies.data + ( event->bodyId.index1 - 1 );
+
+		b2Vec2 delta = b2Sub( event->transform.p, body->reportedPosition );
+		float angle = b2Rot_GetAngle( event->transform.q );
+		float deltaAngle = b2UnwindAngle( angle - body->reportedAngle );
+
+		bool report = event->fellAsleep || b2Length( delta ) > linearThreshold || b2AbsFloat( deltaAngle ) > angularThreshold;
+
+		if ( quantum > 0.0f )
+		{
+			// Clamp so huge moves saturate instead of overflowing. The remainder is sent by later events.
+			float limit = 2147483520.0f;
+			int32_t dx = (int32_t)b2ClampFloat( roundf( delta.x / quantum ), -limit, limit );
+			int32_t dy = (int32_t)b2ClampFloat( roundf( delta.y / quantum ), -limit, limit );
+			int dAngle = (int)roundf( deltaAngle / B2_MOVE_ANGLE_QUANTUM );
+			dAngle = b2ClampInt( dAngle, INT16_MIN, INT16_MAX );
+
+			report = report && ( event->fellAsleep || dx != 0 || dy != 0 || dAngle != 0 );
+
+			if ( report )
+			{
+				// Advance the reference by the quantized change so the error does not accumulate
+				body->reportedPosition.x += quantum * (float)dx;
+				body->reportedPosition.y += quantum * (float)dy;
+				body->reportedAngle = b2UnwindAngle( body->reportedAngle + B2_MOVE_ANGLE_QUANTUM * (float)dAngle );
+
+				filterContext->deltas[i] = (b2BodyMoveDelta){
+					.bodyId = event->bodyId,
+					.dx = dx,
+					.dy = dy,
+					.dAngle = (int16_t)dAngle,
+					.fellAsleep = event->fellAsleep,
+				};
+			}
+		}
+		else if ( report )
+		{
+			body->reportedPosition = event->transform.p;
+			body->reportedAngle = angle;
+		}
+
+		filterContext->reported[i] = report;
+	}
+}
+
+// Keep the move events that pass the thresholds, in the order of the full move event array
+static void b2FilterMoveEvents( b2World* world )
+{
+	int moveCount = world->bodyMoveEvents.count;
+	if ( moveCount == 0 )
+	{
+		return;
+	}
+
+	b2TracyCZoneNC( filter_moves, "Filter Moves", b2_colorGray, true );
+
+	bool useDeltas = world->moveEventQuantum > 0.0f;
+
+	b2AllocInfo previousAllocInfo = b2PushAllocTag( b2_allocTagEvents, b2_allocLifetimeLong );
+	b2Array_Reserve( world->reportedMoveEvents, moveCount );
+
+	b2BodyMoveDelta* deltas = NULL;
+	if ( useDeltas )
+	{
+		b2Array_Resize( world->moveDeltas, moveCount );
+		deltas = world->moveDeltas.data;
+	}
+
+	b2PopAllocInfo( previousAllocInfo );
+
+	bool* reported = b2StackAlloc( &world->stack, moveCount * sizeof( bool ), "reported moves" );
+
+	b2MoveFilterContext context = { world, deltas, reported };
+	b2ParallelFor( world, b2FilterMoveEventsTask, moveCount, 256, &context );
+
+	// Compact in place, the deltas never move ahead of their event
+	const b2BodyMoveEvent* moveEvents = world->bodyMoveEvents.data;
+	b2BodyMoveEvent* reportedEvents = world->reportedMoveEvents.data;
+	int reportCount = 0;
+	for ( int i = 0; i < moveCount; ++i )
+	{
+		if ( reported[i] )
+		{
+			reportedEvents[reportCount] = moveEvents[i];
+			if ( useDeltas )
+			{
+				deltas[reportCount] = deltas[i];
+			}
+			reportCount += 1;
+		}
+	}
+
+	world->reportedMoveEvents.count = reportCount;
+	if ( useDeltas )
+	{
+		world->moveDeltas.count = reportCount;
+	}
+
+	b2StackFree( &world->stack, reported );
+
+	b2TracyCZoneEnd( filter_moves );
+}
+
+// Performs the step. The caller unlocks the world.
+#ifdef BOX2D_PROFILE
+// Per step Tracy plots of the world state. Worlds stepped in the same frame share the series.
+static void b2PlotWorldState( b2World* world )
+{
+	static const char* colorNames[] = {
+		"Color 0",	"Color 1",	"Color 2",	"Color 3",	"Color 4",	"Color 5",	"Color 6",	"Color 7",
+		"Color 8",	"Color 9",	"Color 10", "Color 11", "Color 12", "Color 13", "Color 14", "Color 15",
+		"Color 16", "Color 17", "Color 18", "Color 19", "Color 20", "Color 21", "Color 22", "Overflow",
+	};
+	_Static_assert( B2_ARRAY_COUNT( colorNames ) == B2_GRAPH_COLOR_COUNT, "color name count" );
+
+	b2SolverSet* awakeSet = world->solverSets.data + b2_awakeSet;
+	b2SolverSet* kinematicSet = world->solverSets.data + b2_kinematicSet;
+	b2TracyCPlot( "Awake Bodies", awakeSet->bodySims.count + kinematicSet->bodySims.count );
+	b2TracyCPlot( "Contacts", b2GetIdCount( &world->contactIdPool ) );
+
+	int touchingCount = 0;
+	for ( int i = 0; i < B2_GRAPH_COLOR_COUNT; ++i )
+	{
+		b2GraphColor* color = world->constraintGraph.colors + i;
+		b2TracyCPlot( colorNames[i], color->contactSims.count + color->jointSims.count );
+		touchingCount += color->contactSims.count;
+	}
+
+	b2TracyCPlot( "Awake Touching Contacts", touchingCount );
+	b2TracyCPlot( "Stack Used", b2GetMaxStackAllocation( &world->stack ) );
+	b2TracyCPlot( "Stack Capacity", b2GetStackCapacity( &world->stack ) );
+	b2TracyCPlot( "Heap Bytes", b2GetByteCount() );
+}
+#endif
+
+// Picks the work to skip before the solve when the step is projected to run over its budget. The projection
+// is the time spent so far plus the solve time of the previous step. More work is skipped as the overrun grows.
+static void b2DegradeStep( b2World* world, b2StepContext* context, float projectedTime )
+{
+	float budget = world->stepBudget;
+	uint32_t degradations = 0;
+	if ( projectedTime > budget )
+	{
+		degradations |= b2_degradeRelax;
+	}
+
+	if ( projectedTime > 1.25f * budget )
+	{
+		degradations |= b2_degradeSensors;
+	}
+
+	if ( projectedTime > 1.5f * budget )
+	{
+		degradations |= b2_degradeIslandSplit;
+	}
+
+	if ( projectedTime > 2.0f * budget )
+	{
+		degradations |= b2_degradeContinuous;
+	}
+
+	context->reduceRelax = ( degradations & b2_degradeRelax ) != 0;
+	context->deferContinuous = ( degradations & b2_degradeContinuous ) != 0;
+
+	if ( degradations & b2_degradeIslandSplit )
+	{
+		// The islands keep their removed constraint count and become split candidates again
+		world->splitIslandCount = 0;
+	}
+
+	world->profile.degradations = degradations;
+}
+
+static void b2StaticRebuildTask( void* context )
+{
+	b2World* world = context;
+	b2DynamicTree_Rebuild( &world->staticRebuildTree, true );
+	b2DynamicTree_BuildQuantizedNodes( &world->staticRebuildTree );
+	b2AtomicStoreInt( &world->staticRebuildDone, 1 );
+}
+
+// Wait for the asynchronous static tree rebuild and swap in the new tree
+static void b2FinishStaticRebuild( b2World* world )
+{
+	if ( world->staticRebuildThread == NULL )
+	{
+		return;
+	}
+
+	b2TracyCZoneNC( static_swap, "Static Swap", b2_colorDarkSalmon, true );
+
+	b2JoinThread( world->staticRebuildThread );
+	world->staticRebuildThread = NULL;
+
+	b2BroadPhase_SwapStaticTree( &world->broadPhase, &world->staticRebuildTree, world->shapes.data );
+
+	b2TracyCZoneEnd( static_swap );
+}
+
+// Static tree work done on the calling thread before the step starts. The step only reads the static tree,
+// so it can be queried while an asynchronous step is in flight.
+static void b2PrepareStaticTree( b2World* world )
+{
+	// The old static tree served queries until now, see b2World_RebuildStaticTreeAsync
+	if ( world->staticRebuildThread != NULL && b2AtomicLoadInt( &world->staticRebuildDone ) == 1 )
+	{
+		b2FinishStaticRebuild( world );
+	}
+
+	b2BroadPhase_BuildStaticWideNodes( &world->broadPhase );
+}
+
+static void b2StepWorld( b2World* world, float timeStep, int subStepCount )
+{
+	// Prepare to capture events
+	// Ensure user does not access stale data if there is an early return
+	b2Array_Clear( world->bodyMoveEvents );
+	b2Array_Clear( world->reportedMoveEvents );
+	b2Array_Clear( world->moveDeltas );
+	b2Array_Clear( world->sensorBeginEvents );
+	b2Array_Clear( world->contactBeginEvents );
+	b2Array_Clear( world->contactHitEvents );
+	b2Array_Clear( world->jointEvents );
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordStep( world, timeStep, subStepCount );
+	}
+
+	float previousSolveTime = world->profile.solve;
+	world->profile = (b2Profile){ 0 };
+	world->solverWorkerCount = 0;
+	world->inlineColorCount = 0;
+	b2ResetParallelForProfile( world );
+	if ( world->enableWorkerProfile )
+	{
+		for ( int i = 0; i < world->workerCount; ++i )
+		{
+			world->taskContexts.data[i].workerProfile = (b2WorkerProfile){ 0 };
+		}
+	}
+
+	if ( world->enableDetailedCounters )
+	{
+		for ( int i = 0; i < world->workerCount; ++i )
+		{
+			world->taskContexts.data[i].detailedCounters = (b2DetailedCounters){ 0 };
+		}
+	}
+
+	b2TracyCZoneNC( world_step, "Step", b2_colorBox2DGreen, true );
+
+	world->locked = true;
+	world->activeTaskCount = 0;
+	world->bodyRefEpoch += 1;
+
+	if ( world->isStepAsync )
+	{
+		// The step task holds the first task slot
+		world->taskCount = 1;
+	}
+	else
+	{
+		world->taskCount = 0;
+
+		if ( world->scheduler != NULL )
+		{
+			b2ResetScheduler( world->scheduler );
+		}
+	}
+
+	uint64_t stepTicks = b2GetTicks();
+	int allocationCount = b2GetAllocationCount();
+
+	world->stepSplitIslandCount = 0;
+	world->rebuiltLeafCount = 0;
+	world->reorderedBodyCount = 0;
+	world->sortedContactCount = 0;
+	world->balancedContactCount = 0;
+
+	{
+		b2Capacity* c = &world->maxCapacity;
+		c->staticShapeCount = b2MaxInt( c->staticShapeCount, world->broadPhase.trees[b2_staticBody].proxyCount );
+		c->dynamicShapeCount = b2MaxInt( c->dynamicShapeCount, world->broadPhase.trees[b2_dynamicBody].proxyCount );
+
+		int staticBodyCount = world->solverSets.data[b2_staticSet].bodySims.count;
+		c->staticBodyCount = b2MaxInt( c->staticBodyCount, staticBodyCount );
+
+		// this includes kinematic bodies
+		int totalBodyCount = b2GetIdCount( &world->bodyIdPool );
+		c->dynamicBodyCount = b2MaxInt( c->dynamicBodyCount, totalBodyCount - staticBodyCount );
+
+		int totalContactCount = b2GetIdCount( &world->contactIdPool );
+		c->contactCount = b2MaxInt( c->contactCount, totalContactCount );
+	}
+
+	// Wake the parked islands that are simulated in this step
+	if ( world->parkedSetCount > 0 && timeStep > 0.0f )
+	{
+		b2WakeParkedSets( world );
+	}
+
+	// Thaw the frozen islands that are back in an active region
+	if ( world->frozenSetCount > 0 && timeStep > 0.0f )
+	{
+		b2ThawFrozenSets( world );
+	}
+
+	if ( world->enableCompactContacts && world->compactSleepSteps > 0 && world->stepIndex % B2_COMPACT_SET_INTERVAL == 0 )
+	{
+		b2CompactSleepingSets( world );
+	}
+
+	// Apply user forces and impulses before anything reads body state
+	b2ApplyBodyCommands( world );
+
+	if ( world->bodyOrderThreshold > 0.0f && timeStep > 0.0f && world->stepIndex % B2_BODY_ORDER_INTERVAL == 0 )
+	{
+		b2ReorderAwakeBodies( world );
+	}
+
+	b2StepContext context = { 0 };
+	context.world = world;
+	context.dt = timeStep;
+	context.subStepCount = b2MaxInt( 1, subStepCount );
+
+	if ( timeStep > 0.0f )
+	{
+		context.inv_dt = 1.0f / timeStep;
+		context.h = timeStep / context.subStepCount;
+		context.inv_h = context.subStepCount * context.inv_dt;
+	}
+	else
+	{
+		context.inv_dt = 0.0f;
+		context.h = 0.0f;
+		context.inv_h = 0.0f;
+	}
+
+	world->inv_h = context.inv_h;
+	world->inv_dt = context.inv_dt;
+
+	// Hertz values get reduced for large time steps
+	float contactHertz = b2MinFloat( world->contactHertz, 0.125f * context.inv_h );
+	context.contactSoftness = b2MakeSoft( contactHertz, world->contactDampingRatio, context.h );
+	context.staticSoftness = b2MakeSoft( 2.0f * contactHertz, world->contactDampingRatio, context.h );
+
+	context.restitutionThreshold = world->restitutionThreshold;
+	context.maxLinearVelocity = world->maxLinearSpeed;
+	context.enableWarmStarting = world->enableWarmStarting;
+	context.enableWorkerProfile = world->enableWorkerProfile;
+	context.waitPolicy = world->waitPolicy;
+	context.waitSpinCount = world->waitSpinCount;
+	context.enableParallelOverflow = world->enableParallelOverflow || world->enableAdaptiveColoring;
+
+	if ( world->enablePipelinedCollide )
+	{
+		// Update collision pairs, create contacts, and update contacts in one pass. The pair profile
+		// includes the narrow phase of the existing contacts.
+		uint64_t collideTicks = b2GetTicks();
+		b2PipelinedCollide( &context );
+		world->profile.collide = b2MaxFloat( 0.0f, b2GetMilliseconds( collideTicks ) - world->profile.pairs );
+	}
+	else
+	{
+		// Update collision pairs and create contacts
+		{
+			uint64_t pairTicks = b2GetTicks();
+			b2UpdateBroadPhasePairs( world, NULL );
+			world->profile.pairs = b2GetMilliseconds( pairTicks );
+		}
+
+		// Narrow phase : update contacts
+		{
+			uint64_t collideTicks = b2GetTicks();
+			b2Collide( &context );
+			world->profile.collide = b2GetMilliseconds( collideTicks );
+		}
+	}
+
+	if ( world->stepBudget > 0.0f && timeStep > 0.0f )
+	{
+		b2DegradeStep( world, &context, b2GetMilliseconds( stepTicks ) + previousSolveTime );
+	}
+
+	// Integrate velocities, solve velocity constraints, and integrate positions.
+	if ( timeStep > 0.0f )
+	{
+		uint64_t solveTicks = b2GetTicks();
+		b2BeginExport( world );
+		b2Solve( world, &context );
+		b2EndExport( world );
+		world->profile.solve = b2GetMilliseconds( solveTicks );
+
+		if ( world->filterMoveEvents )
+		{
+			b2FilterMoveEvents( world );
+		}
+	}
+
+	if ( context.fusedPrepare.constraints != NULL )
+	{
+		b2StackFree( &world->stack, context.fusedPrepare.colds );
+		b2StackFree( &world->stack, context.fusedPrepare.constraints );
+		context.fusedPrepare.constraints = NULL;
+		context.fusedPrepare.colds = NULL;
+	}
+
+	// Finish the tree task in case b2Solve didn't finish it
+	if ( world->userTreeTask )
+	{
+		world->finishTaskFcn( world->userTreeTask, world->userTaskContext );
+		world->userTreeTask = NULL;
+		world->activeTaskCount -= 1;
+	}
+
+	// Particles collide with the shapes at their final positions
+	if ( timeStep > 0.0f && world->particles.positions.count > 0 )
+	{
+		uint64_t particleTicks = b2GetTicks();
+		b2StepParticles( world, &context );
+		world->profile.particles = b2GetMilliseconds( particleTicks );
+	}
+
+	// Update sensors unless the step is over its budget
+	if ( world->stepBudget > 0.0f && timeStep > 0.0f && b2GetMilliseconds( stepTicks ) > world->stepBudget )
+	{
+		world->profile.degradations |= b2_degradeSensors;
+	}
+
+	if ( world->profile.degradations & b2_degradeSensors )
+	{
+		// The moves of this step are not tracked, so the next update visits every sensor
+		world->sensorFullUpdate = true;
+	}
+	else
+	{
+		uint64_t sensorTicks = b2GetTicks();
+		b2OverlapSensors( world );
+		world->profile.sensors = b2GetMilliseconds( sensorTicks );
+	}
+
+	world->profile.step = b2GetMilliseconds( stepTicks );
+
+	B2_ASSERT( b2GetStackAllocation( &world->stack ) == 0 );
+
+	// Ensure stack is large enough
+	world->stackGrowth = b2GrowStack( &world->stack );
+
+	// Release worker scratch memory
+	int arenaByteCount = 0;
+	for ( int i = 0; i < world->workerCount; ++i )
+	{
+		b2Arena* arena = &world->taskContexts.data[i].arena;
+		arenaByteCount = b2MaxInt( arenaByteCount, arena->maxAllocation );
+		b2ResetArena( arena );
+	}
+
+	{
+		b2Capacity* c = &world->maxCapacity;
+		c->jointCount = b2MaxInt( c->jointCount, b2GetIdCount( &world->jointIdPool ) );
+		c->islandCount = b2MaxInt( c->islandCount, b2GetIdCount( &world->islandIdPool ) );
+		c->sensorCount = b2MaxInt( c->sensorCount, world->sensors.count );
+		c->chainCount = b2MaxInt( c->chainCount, b2GetIdCount( &world->chainIdPool ) );
+
+		int contactEventCount = b2MaxInt( world->contactBeginEvents.count, world->contactHitEvents.count );
+		contactEventCount = b2MaxInt( contactEventCount, world->contactEndEvents[world->endEventArrayIndex].count );
+		c->contactEventCount = b2MaxInt( c->contactEventCount, contactEventCount );
+
+		int sensorEventCount =
+			b2MaxInt( world->sensorBeginEvents.count, world->sensorEndEvents[world->endEventArrayIndex].count );
+		c->sensorEventCount = b2MaxInt( c->sensorEventCount, sensorEventCount );
+		c->jointEventCount = b2MaxInt( c->jointEventCount, world->jointEvents.count );
+
+		c->stackByteCount = b2MaxInt( c->stackByteCount, b2GetMaxStackAllocation( &world->stack ) );
+		c->arenaByteCount = b2MaxInt( c->arenaByteCount, arenaByteCount );
+	}
+
+	world->stepAllocationCount = b2GetAllocationCount() - allocationCount;
+	B2_ASSERT( world->enableAllocationCheck == false || world->stepAllocationCount == 0 );
+
+	world->stepWokenSetCount = world->wokenSetCount;
+	world->wokenSetCount = 0;
+
+	// Make sure all tasks that were started were also finished
+	B2_ASSERT( world->activeTaskCount == 0 );
+
+#ifdef BOX2D_PROFILE
+	b2PlotWorldState( world );
+#endif
+
+	b2TracyCZoneEnd( world_step );
+
+	// Swap end event array buffers
+	world->endEventArrayIndex = 1 - world->endEventArrayIndex;
+	b2Array_Clear( world->sensorEndEvents[world->endEventArrayIndex] );
+	b2Array_Clear( world->contactEndEvents[world->endEventArrayIndex] );
+}
+
+void b2World_Step( b2WorldId worldId, float timeStep, int subStepCount )
+{
+	B2_ASSERT( b2IsValidFloat( timeStep ) );
+	B2_ASSERT( 0 < subStepCount );
+
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		b2TracyCFrame;
+		return;
+	}
+
+	b2AllocInfo previousAllocInfo = b2PushAllocWorld( world->worldId );
+	b2PrepareStaticTree( world );
+	b2StepWorld( world, timeStep, subStepCount );
+	b2PopAllocInfo( previousAllocInfo );
+	world->locked = false;
+
+	b2TracyCFrame;
+}
+
+void b2World_StepWithBudget( b2WorldId worldId, float timeStep, int subStepCount, float budgetMilliseconds )
+{
+	B2_ASSERT( b2IsValidFloat( budgetMilliseconds ) && budgetMilliseconds >= 0.0f );
+
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->stepBudget = budgetMilliseconds;
+	b2World_Step( worldId, timeStep, subStepCount );
+	world->stepBudget = 0.0f;
+}
+
+static void b2StepTask( void* context )
+{
+	b2World* world = context;
+	b2AllocInfo previousAllocInfo = b2PushAllocWorld( world->worldId );
+	b2StepWorld( world, world->asyncTimeStep, world->asyncSubStepCount );
+	b2PopAllocInfo( previousAllocInfo );
+}
+
+void b2World_StepAsync( b2WorldId worldId, float timeStep, int subStepCount )
+{
+	B2_ASSERT( b2IsValidFloat( timeStep ) );
+	B2_ASSERT( 0 < subStepCount );
+
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	b2AllocInfo previousAllocInfo = b2PushAllocWorld( world->worldId );
+	b2PrepareStaticTree( world );
+	b2PopAllocInfo( previousAllocInfo );
+
+	// Lock before the task starts so the world is never seen unlocked until b2World_WaitStep
+	world->locked = true;
+	world->isStepAsync = true;
+	world->asyncTimeStep = timeStep;
+	world->asyncSubStepCount = subStepCount;
+	world->asyncStaticSims = world->solverSets.data[b2_staticSet].bodySims.data;
+
+	if ( world->scheduler != NULL )
+	{
+		b2ResetScheduler( world->scheduler );
+	}
+
+	// Without a task system this runs the step immediately
+	b2TaskInfo info = { .name = "Step", .priority = b2_taskPriorityHigh };
+	world->userStepTask = b2EnqueueTask( world, b2StepTask, world, &info );
+}
+
+void b2World_WaitStep( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	if ( world->isStepAsync == false )
+	{
+		return;
+	}
+
+	if ( world->userStepTask != NULL )
+	{
+		world->finishTaskFcn( world->userStepTask, world->userTaskContext );
+		world->userStepTask = NULL;
+	}
+
+	world->isStepAsync = false;
+	world->asyncStaticSims = NULL;
+	world->locked = false;
+
+	b2TracyCFrame;
+}
+
+bool b2World_IsStepping( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->isStepAsync;
+}
+
+void b2StepWorlds( const b2WorldId* worldIds, int worldCount, float timeStep, int subStepCount )
+{
+	// Launch every step before waiting on any of them so the stages of different worlds overlap on
+	// the shared task system
+	for ( int i = 0; i < worldCount; ++i )
+	{
+		b2World_StepAsync( worldIds[i], timeStep, subStepCount );
+	}
+
+	for ( int i = 0; i < worldCount; ++i )
+	{
+		b2World_WaitStep( worldIds[i] );
+	}
+}
+
+static void b2DrawShape( b2DebugDraw* draw, b2Shape* shape, b2Transform xf, b2HexColor color )
+{
+	switch ( shape->type )
+	{
+		case b2_capsuleShape:
+		{
+			b2Capsule* capsule = &shape->capsule;
+			b2Vec2 p1 = b2TransformPoint( xf, capsule->center1 );
+			b2Vec2 p2 = b2TransformPoint( xf, capsule->center2 );
+			draw->DrawSolidCapsuleFcn( p1, p2, capsule->radius, color, draw->context );
+		}
+		break;
+
+		case b2_circleShape:
+		{
+			b2Circle* circle = &shape->circle;
+			xf.p = b2TransformPoint( xf, circle->center );
+			draw->DrawSolidCircleFcn( xf, circle->radius, color, draw->context );
+		}
+		break;
+
+		case b2_polygonShape:
+		{
+			b2Polygon* poly = &shape->polygon;
+			draw->DrawSolidPolygonFcn( xf, poly->vertices, poly->count, poly->radius, color, draw->context );
+		}
+		break;
+
+		case b2_segmentShape:
+		{
+			b2Segment* segment = &shape->segment;
+			b2Vec2 p1 = b2TransformPoint( xf, segment->point1 );
+			b2Vec2 p2 = b2TransformPoint( xf, segment->point2 );
+			draw->DrawLineFcn( p1, p2, color, draw->context );
+		}
+		break;
+
+		case b2_chainSegmentShape:
+		{
+			b2Segment* segment = &shape->chainSegment.segment;
+			b2Vec2 p1 = b2TransformPoint( xf, segment->point1 );
+			b2Vec2 p2 = b2TransformPoint( xf, segment->point2 );
+			draw->DrawLineFcn( p1, p2, color, draw->context );
+			draw->DrawPointFcn( p2, 4.0f, color, draw->context );
+			draw->DrawLineFcn( p1, b2Lerp( p1, p2, 0.1f ), b2_colorPaleGreen, draw->context );
+		}
+		break;
+
+		case b2_compoundShape:
+		{
+			const b2Compound* compound = shape->compound;
+			for ( int i = 0; i < compound->count; ++i )
+			{
+				const b2Polygon* poly = compound->polygons + i;
+				draw->DrawSolidPolygonFcn( xf, poly->vertices, poly->count, poly->radius, color, draw->context );
+			}
+		}
+		break;
+
+		default:
+			break;
+	}
+}
+
+struct DrawContext
+{
+	b2World* world;
+	b2DebugDraw* draw;
+};
+
+static b2HexColor b2GetShapeDrawColor( const b2Shape* shape, const b2Body* body, const b2BodySim* bodySim )
+{
+	b2HexColor color;
+
+	if ( shape->material.customColor != 0 )
+	{
+		color = shape->material.customColor;
+	}
+	else if ( body->type == b2_dynamicBody && body->mass == 0.0f )
+	{
+		// Bad body
+		color = b2_colorRed;
+	}
+	else if ( body->setIndex == b2_disabledSet )
+	{
+		color = b2_colorSlateGray;
+	}
+	else if ( shape->sensorIndex != B2_NULL_INDEX )
+	{
+		color = b2_colorWheat;
+	}
+	else if ( body->flags & b2_hadTimeOfImpact )
+	{
+		color = b2_colorLime;
+	}
+	else if ( ( bodySim->flags & b2_isBullet ) && body->setIndex == b2_awakeSet )
+	{
+		color = b2_colorTurquoise;
+	}
+	else if ( body->flags & b2_isSpeedCapped )
+	{
+		color = b2_colorYellow;
+	}
+	else if ( bodySim->flags & b2_isFast )
+	{
+		color = b2_colorSalmon;
+	}
+	else if ( body->type == b2_staticBody )
+	{
+		color = b2_colorPaleGreen;
+	}
+	else if ( body->type == b2_kinematicBody )
+	{
+		color = b2_colorRoyalBlue;
+	}
+	else if ( body->setIndex == b2_awakeSet )
+	{
+		color = b2_colorPink;
+	}
+	else
+	{
+		color = b2_colorGray;
+	}
+
+	return color;
+}
+
+static bool DrawQueryCallback( int proxyId, uint64_t userData, void* context )
+{
+	B2_UNUSED( proxyId );
+
+	int shapeId = (int)userData;
+
+	struct DrawContext* drawContext = context;
+	b2World* world = drawContext->world;
+	b2DebugDraw* draw = drawContext->draw;
+
+	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+	B2_ASSERT( shape->id == shapeId );
+
+	b2SetBit( &world->debugBodySet, shape->bodyId );
+
+	if ( draw->drawShapes )
+	{
+		b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
+		b2BodySim* bodySim = b2GetBodySim( world, body );
+		b2HexColor color = b2GetShapeDrawColor( shape, body, bodySim );
+		b2DrawShape( draw, shape, bodySim->transform, color );
+	}
+
+	if ( draw->drawBounds )
+	{
+		b2AABB aabb = shape->fatAABB;
+
+		b2Vec2 vs[4] = { { aabb.lowerBound.x, aabb.lowerBound.y },
+						 { aabb.upperBound.x, aabb.lowerBound.y },
+						 { aabb.upperBound.x, aabb.upperBound.y },
+						 { aabb.lowerBound.x, aabb.upperBound.y } };
+
+		draw->DrawPolygonFcn( vs, 4, b2_colorGold, draw->context );
+	}
+
+	return true;
+}
+
+struct DrawBatchContext
+{
+	b2World* world;
+	b2DebugDraw* draw;
+	int primitiveCount;
+	int vertexCount;
+};
+
+// Finds the shapes to draw and reserves their output, so the primitives can be built in parallel
+// and still come out in query order
+static bool DrawBatchQueryCallback( int proxyId, uint64_t userData, void* context )
+{
+	B2_UNUSED( proxyId );
+
+	int shapeId = (int)userData;
+
+	struct DrawBatchContext* batchContext = context;
+	b2World* world = batchContext->world;
+	b2DebugDraw* draw = batchContext->draw;
+
+	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+	B2_ASSERT( shape->id == shapeId );
+
+	b2SetBit( &world->debugBodySet, shape->bodyId );
+
+	int primitiveCount = 0;
+	int vertexCount = 0;
+
+	if ( draw->drawShapes )
+	{
+		switch ( shape->type )
+		{
+			case b2_capsuleShape:
+			case b2_circleShape:
+			case b2_segmentShape:
+				primitiveCount = 1;
+				vertexCount = 2;
+				break;
+
+			case b2_polygonShape:
+				primitiveCount = 1;
+				vertexCount = shape->polygon.count;
+				break;
+
+			case b2_chainSegmentShape:
+				// segment, end point and direction tick
+				primitiveCount = 3;
+				vertexCount = 5;
+				break;
+
+			case b2_compoundShape:
+				primitiveCount = shape->compound->count;
+				for ( int i = 0; i < shape->compound->count; ++i )
+				{
+					vertexCount += shape->compound->polygons[i].count;
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	if ( draw->drawBounds )
+	{
+		primitiveCount += 1;
+		vertexCount += 4;
+	}
+
+	if ( primitiveCount > 0 )
+	{
+		b2DrawItem item = { shapeId, batchContext->primitiveCount, batchContext->vertexCount };
+		b2Array_Push( world->debugDrawItems, item );
+		batchContext->primitiveCount += primitiveCount;
+		batchContext->vertexCount += vertexCount;
+	}
+
+	return true;
+}
+
+static void b2DrawBatchTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	B2_UNUSED( workerIndex );
+
+	b2TracyCZoneNC( draw_batch, "Draw Batch", b2_colorLightSteelBlue, true );
+
+	struct DrawBatchContext* batchContext = context;
+	b2World* world = batchContext->world;
+	b2DebugDraw* draw = batchContext->draw;
+	b2DrawPrimitive* primitives = world->debugPrimitives.data;
+	b2Vec2* vertices = world->debugVertices.data;
+
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		const b2DrawItem* item = world->debugDrawItems.data + i;
+		b2Shape* shape = world->shapes.data + item->shapeId;
+		b2DrawPrimitive* primitive = primitives + item->primitiveIndex;
+		int vertexIndex = item->vertexIndex;
+		b2Vec2* v = vertices + vertexIndex;
+
+		if ( draw->drawShapes )
+		{
+			b2Body* body = world->bodies.data + shape->bodyId;
+			b2BodySim* bodySim = b2GetBodySim( world, body );
+			b2HexColor color = b2GetShapeDrawColor( shape, body, bodySim );
+			b2Transform xf = bodySim->transform;
+
+			switch ( shape->type )
+			{
+				case b2_capsuleShape:
+					v[0] = b2TransformPoint( xf, shape->capsule.center1 );
+					v[1] = b2TransformPoint( xf, shape->capsule.center2 );
+					*primitive++ = (b2DrawPrimitive){ b2_drawSolidCapsule, color, vertexIndex, 2, shape->capsule.radius };
+					vertexIndex += 2;
+					v += 2;
+					break;
+
+				case b2_circleShape:
+					v[0] = b2TransformPoint( xf, shape->circle.center );
+					v[1] = b2MulAdd( v[0], shape->circle.radius, b2Rot_GetXAxis( xf.q ) );
+					*primitive++ = (b2DrawPrimitive){ b2_drawSolidCircle, color, vertexIndex, 2, shape->circle.radius };
+					vertexIndex += 2;
+					v += 2;
+					break;
+
+				case b2_polygonShape:
+				{
+					const b2Polygon* poly = &shape->polygon;
+					for ( int j = 0; j < poly->count; ++j )
+					{
+						v[j] = b2TransformPoint( xf, poly->vertices[j] );
+					}
+					*primitive++ = (b2DrawPrimitive){ b2_drawSolidPolygon, color, vertexIndex, poly->count, poly->radius };
+					vertexIndex += poly->count;
+					v += poly->count;
+				}
+				break;
+
+				case b2_segmentShape:
+					v[0] = b2TransformPoint( xf, shape->segment.point1 );
+					v[1] = b2TransformPoint( xf, shape->segment.point2 );
+					*primitive++ = (b2DrawPrimitive){ b2_drawLine, color, vertexIndex, 2, 0.0f };
+					vertexIndex += 2;
+					v += 2;
+					break;
+
+				case b2_chainSegmentShape:
+				{
+					const b2Segment* segment = &shape->chainSegment.segment;
+					b2Vec2 p1 = b2TransformPoint( xf, segment->point1 );
+					b2Vec2 p2 = b2TransformPoint( xf, segment->point2 );
+					v[0] = p1;
+					v[1] = p2;
+					v[2] = p2;
+					v[3] = p1;
+					v[4] = b2Lerp( p1, p2, 0.1f );
+					*primitive++ = (b2DrawPrimitive){ b2_drawLine, color, vertexIndex, 2, 0.0f };
+					*primitive++ = (b2DrawPrimitive){ b2_drawPoint, color, vertexIndex + 2, 1, 4.0f };
+					*primitive++ = (b2DrawPrimitive){ b2_drawLine, b2_colorPaleGreen, vertexIndex + 3, 2, 0.0f };
+					vertexIndex += 5;
+					v += 5;
+				}
+				break;
+
+				case b2_compoundShape:
+				{
+					const b2Compound* compound = shape->compound;
+					for ( int j = 0; j < compound->count; ++j )
+					{
+						const b2Polygon* poly = compound->polygons + j;
+						for ( int k = 0; k < poly->count; ++k )
+						{
+							v[k] = b2TransformPoint( xf, poly->vertices[k] );
+						}
+						*primitive++ =
+							(b2DrawPrimitive){ b2_drawSolidPolygon, color, vertexIndex, poly->count, poly->radius };
+						vertexIndex += poly->count;
+						v += poly->count;
+					}
+				}
+				break;
+
+				default:
+					break;
+			}
+		}
+
+		if ( draw->drawBounds )
+		{
+			b2AABB aabb = shape->fatAABB;
+			v[0] = (b2Vec2){ aabb.lowerBound.x, aabb.lowerBound.y };
+			v[1] = (b2Vec2){ aabb.upperBound.x, aabb.lowerBound.y };
+			v[2] = (b2Vec2){ aabb.upperBound.x, aabb.upperBound.y };
+			v[3] = (b2Vec2){ aabb.lowerBound.x, aabb.upperBound.y };
+			*primitive = (b2DrawPrimitive){ b2_drawPolygon, b2_colorGold, vertexIndex, 4, 0.0f };
+		}
+	}
+
+	b2TracyCZoneEnd( draw_batch );
+}
+
+#define B2_DRAW_BATCH_MIN_RANGE 256
+
+// The tree query only marks bodies and reserves output, the transforms and colors are done by the workers
+static void b2DrawShapesBatched( b2World* world, b2DebugDraw* draw )
+{
+	struct DrawBatchContext batchContext = { world, draw, 0, 0 };
+
+	b2Array_Clear( world->debugDrawItems );
+	for ( int i = 0; i < b2_bodyTypeCount; ++i )
+	{
+		b2DynamicTree_QueryAll( world->broadPhase.trees + i, draw->drawingBounds, DrawBatchQueryCallback, &batchContext );
+	}
+
+	b2Array_Resize( world->debugPrimitives, batchContext.primitiveCount );
+	b2Array_Resize( world->debugVertices, batchContext.vertexCount );
+
+	b2ParallelFor( world, b2DrawBatchTask, world->debugDrawItems.count, B2_DRAW_BATCH_MIN_RANGE, &batchContext );
+
+	b2DrawBatch batch = {
+		.primitives = world->debugPrimitives.data,
+		.primitiveCount = world->debugPrimitives.count,
+		.vertices = world->debugVertices.data,
+		.vertexCount = world->debugVertices.count,
+	};
+	draw->DrawBatchFcn( &batch, draw->context );
+}
+
+// todo this has varying order for moving shapes, causing flicker when overlapping shapes are moving
+// solution: display order by shape id modulus 3, keep 3 buckets in GLSolid* and flush in 3 passes.
+void b2World_Draw( b2WorldId worldId, b2DebugDraw* draw )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	B2_ASSERT( b2IsValidAABB( draw->drawingBounds ) );
+
+	const float k_axisScale = 0.3f;
+	b2HexColor speculativeColor = b2_colorGainsboro;
+	b2HexColor addColor = b2_colorGreen;
+	b2HexColor persistColor = b2_colorBlue;
+	b2HexColor normalColor = b2_colorDimGray;
+	b2HexColor impulseColor = b2_colorMagenta;
+	b2HexColor frictionColor = b2_colorYellow;
+
+	int bodyCapacity = b2GetIdCapacity( &world->bodyIdPool );
+	b2SetBitCountAndClear( &world->debugBodySet, bodyCapacity );
+
+	int jointCapacity = b2GetIdCapacity( &world->jointIdPool );
+	b2SetBitCountAndClear( &world->debugJointSet, jointCapacity );
+
+	int contactCapacity = b2GetIdCapacity( &world->contactIdPool );
+	b2SetBitCountAndClear( &world->debugContactSet, contactCapacity );
+
+	int islandCapacity = b2GetIdCapacity( &world->islandIdPool );
+	b2SetBitCountAndClear( &world->debugIslandSet, islandCapacity );
+
+	if ( draw->DrawBatchFcn != NULL )
+	{
+		b2DrawShapesBatched( world, draw );
+	}
+	else
+	{
+		struct DrawContext drawContext = { world, draw };
+
+		for ( int i = 0; i < b2_bodyTypeCount; ++i )
+		{
+			b2DynamicTree_QueryAll( world->broadPhase.trees + i, draw->drawingBounds, DrawQueryCallback, &drawContext );
+		}
+	}
+
+	if ( draw->drawShapes )
+	{
+		b2ParticleSystem* particles = &world->particles;
+		for ( int i = 0; i < particles->positions.count; ++i )
+		{
+			b2Vec2 p = particles->positions.data[i];
+			float radius = particles->groups.data[particles->groupIndices.data[i]].radius;
+			b2AABB box = { { p.x - radius, p.y - radius }, { p.x + radius, p.y + radius } };
+			if ( b2AABB_Overlaps( box, draw->drawingBounds ) )
+			{
+				draw->DrawSolidCircleFcn( (b2Transform){ p, b2Rot_identity }, radius, b2_colorSandyBrown, draw->context );
+			}
+		}
+	}
+
+	uint32_t wordCount = world->debugBodySet.blockCount;
+	uint64_t* bits = world->debugBodySet.bits;
+	for ( uint32_t k = 0; k < wordCount; ++k )
+	{
+		uint64_t word = bits[k];
+		while ( word != 0 )
+		{
+			uint32_t ctz = b2CTZ64( word );
+			uint32_t bodyId = 64 * k + ctz;
+
+			b2Body* body = b2Array_Get( world->bodies, (int)bodyId );
+
+			if ( draw->drawBodyNames && body->name[0] != 0 )
+			{
+				b2Vec2 offset = { 0.1f, 0.1f };
+				b2BodySim* bodySim = b2GetBodySim( world, body );
+
+				b2Transform transform = { bodySim->center, bodySim->transform.q };
+				b2Vec2 p = b2TransformPoint( transform, offset );
+				draw->DrawStringFcn( p, body->name, b2_colorBlueViolet, draw->context );
+			}
+
+			if ( draw->drawMass && body->type == b2_dynamicBody )
+			{
+				b2Vec2 offset = { 0.1f, 0.1f };
+				b2BodySim* bodySim = b2GetBodySim( world, body );
+
+				b2Transform transform = { bodySim->center, bodySim->transform.q };
+				draw->DrawLineFcn( bodySim->center0, bodySim->center, b2_colorWhiteSmoke, draw->context );
+				draw->DrawTransformFcn( transform, draw->context );
+
+				b2Vec2 p = b2TransformPoint( transform, offset );
+				char buffer[32];
+				snprintf( buffer, 32, "  %.2f", body->mass );
+				draw->DrawStringFcn( p, buffer, b2_colorWhite, draw->context );
+			}
+
+			if ( draw->drawJoints )
+			{
+				int jointKey = body->headJointKey;
+				while ( jointKey != B2_NULL_INDEX )
+				{
+					int jointId = jointKey >> 1;
+					int edgeIndex = jointKey & 1;
+					b2Joint* joint = b2Array_Get( world->joints, jointId );
+
+					// avoid double draw
+					if ( b2GetBit( &world->debugJointSet, jointId ) == false )
+					{
+						b2DrawJoint( draw, world, joint );
+						b2SetBit( &world->debugJointSet, jointId );
+					}
+
+					jointKey = joint->edges[edgeIndex].nextKey;
+				}
+			}
+
+			const float linearSlop = B2_LINEAR_SLOP;
+			if ( draw->drawContacts && body->type == b2_dynamicBody )
+			{
+				int contactKey = body->headContactKey;
+				while ( contactKey != B2_NULL_INDEX )
+				{
+					int contactId = contactKey >> 1;
+					int edgeIndex = contactKey & 1;
+					b2Contact* contact = b2Array_Get( world->contacts, contactId );
+					contactKey = contact->edges[edgeIndex].nextKey;
+
+					// avoid double draw
+					if ( b2GetBit( &world->debugContactSet, contactId ) == false )
+					{
+						b2Manifold manifold = b2GetContactManifold( world, contact );
+						b2Body* bodyA = b2Array_Get( world->bodies, contact->edges[0].bodyId );
+						b2BodySim* bodySimA = b2GetBodySim( world, bodyA );
+						b2Body* bodyB = b2Array_Get( world->bodies, contact->edges[1].bodyId );
+						b2BodySim* bodySimB = b2GetBodySim( world, bodyB );
+						int pointCount = manifold.pointCount;
+						b2Vec2 normal = manifold.normal;
+						char buffer[32];
+
+						for ( int j = 0; j < pointCount; ++j )
+						{
+							b2ManifoldPoint* mp = manifold.points + j;
+
+							b2Vec2 p;
+							if ( draw->drawAnchorA )
+							{
+								p = b2Add( bodySimA->center, mp->anchorA );
+							}
+							else
+							{
+								p = b2Add( bodySimB->center, mp->anchorB );
+							}
+
+							if ( draw->drawGraphColors && contact->colorIndex != B2_NULL_INDEX )
+							{
+								// graph color
+								float pointSize = contact->colorIndex == B2_OVERFLOW_INDEX ? 7.5f : 5.0f;
+								draw->DrawPointFcn( p, pointSize, b2GetGraphColor( contact->colorIndex ), draw->context );
+								// m_context->draw.DrawString(point->position, "%d", point->color);
+							}
+							else if ( mp->separation > linearSlop )
+							{
+								// Speculative
+								draw->DrawPointFcn( p, 5.0f, speculativeColor, draw->context );
+							}
+							else if ( mp->persisted == false )
+							{
+								// Add
+								draw->DrawPointFcn( p, 10.0f, addColor, draw->context );
+							}
+							else if ( mp->persisted == true )
+							{
+								// Persist
+								draw->DrawPointFcn( p, 5.0f, persistColor, draw->context );
+							}
+
+							if ( draw->drawContactNormals )
+							{
+								b2Vec2 p1 = p;
+								b2Vec2 p2 = b2MulAdd( p1, k_axisScale, normal );
+								draw->DrawLineFcn( p1, p2, normalColor, draw->context );
+
+								snprintf( buffer, B2_ARRAY_COUNT( buffer ), " %.2f", mp->separation );
+								draw->DrawStringFcn( p1, buffer, b2_colorWhite, draw->context );
+							}
+							else if ( draw->drawContactForces )
+							{
+								// todo validate
+								// multiply by one-half due to relax iteration
+								float force = 0.5f * mp->totalNormalImpulse * world->inv_dt;
+								b2Vec2 p1 = p;
+								b2Vec2 p2 = b2MulAdd( p1, draw->forceScale * force, normal );
+								draw->DrawLineFcn( p1, p2, impulseColor, draw->context );
+								snprintf( buffer, B2_ARRAY_COUNT( buffer ), "%.1f", force );
+								draw->DrawStringFcn( p1, buffer, b2_colorWhite, draw->context );
+							}
+
+							if ( draw->drawContactFeatures )
+							{
+								snprintf( buffer, B2_ARRAY_COUNT( buffer ), "%d", mp->id );
+								draw->DrawStringFcn( p, buffer, b2_colorOrange, draw->context );
+							}
+
+							if ( draw->drawFrictionForces )
+							{
+								float force = 0.5f * mp->tangentImpulse * world->inv_h;
 								b2Vec2 tangent = b2RightPerp( normal );
 								b2Vec2 p1 = p;
 								b2Vec2 p2 = b2MulAdd( p1, draw->forceScale * force, tangent );
@@ -1287,741 +3128,3093 @@ void b2World_Draw( b2WorldId worldId, b2DebugDraw* draw )
 							}
 						}
 
-						b2SetBit( &world->debugContactSet, contactId );
-					}
+						b2SetBit( &world->debugContactSet, contactId );
+					}
+
+					contactKey = contact->edges[edgeIndex].nextKey;
+				}
+			}
+
+			if ( draw->drawIslands )
+			{
+				int islandId = body->islandId;
+				if ( islandId != B2_NULL_INDEX && b2GetBit( &world->debugIslandSet, islandId ) == false )
+				{
+					b2Island* island = world->islands.data + islandId;
+					if ( island->setIndex == B2_NULL_INDEX )
+					{
+						continue;
+					}
+
+					int shapeCount = 0;
+					b2AABB aabb = {
+						.lowerBound = { FLT_MAX, FLT_MAX },
+						.upperBound = { -FLT_MAX, -FLT_MAX },
+					};
+
+					for ( int bodyIndex = 0; bodyIndex < island->bodies.count; ++bodyIndex )
+					{
+						int islandBodyId = island->bodies.data[bodyIndex];
+						b2Body* islandBody = b2Array_Get( world->bodies, islandBodyId );
+						int shapeId = islandBody->headShapeId;
+						while ( shapeId != B2_NULL_INDEX )
+						{
+							b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+							aabb = b2AABB_Union( aabb, shape->fatAABB );
+							shapeCount += 1;
+							shapeId = shape->nextShapeId;
+						}
+					}
+
+					if ( shapeCount > 0 )
+					{
+						b2Vec2 vs[4] = { { aabb.lowerBound.x, aabb.lowerBound.y },
+										 { aabb.upperBound.x, aabb.lowerBound.y },
+										 { aabb.upperBound.x, aabb.upperBound.y },
+										 { aabb.lowerBound.x, aabb.upperBound.y } };
+
+						draw->DrawPolygonFcn( vs, 4, b2_colorOrangeRed, draw->context );
+					}
+
+					b2SetBit( &world->debugIslandSet, islandId );
+				}
+			}
+
+			// Clear the smallest set bit
+			word = word & ( word - 1 );
+		}
+	}
+}
+
+b2BodyEvents b2World_GetBodyEvents( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return (b2BodyEvents){ 0 };
+	}
+
+	if ( world->filterMoveEvents )
+	{
+		b2BodyMoveDelta* deltas = world->moveEventQuantum > 0.0f ? world->moveDeltas.data : NULL;
+		return (b2BodyEvents){ world->reportedMoveEvents.data, world->reportedMoveEvents.count, deltas };
+	}
+
+	int count = world->bodyMoveEvents.count;
+	b2BodyEvents events = { world->bodyMoveEvents.data, count, NULL };
+	return events;
+}
+
+void b2World_SetMoveEventFilter( b2WorldId worldId, float linearThreshold, float angularThreshold, float quantum )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->moveEventLinearThreshold = b2MaxFloat( 0.0f, linearThreshold );
+	world->moveEventAngularThreshold = b2MaxFloat( 0.0f, angularThreshold );
+	world->moveEventQuantum = b2MaxFloat( 0.0f, quantum );
+
+	bool filter = world->moveEventLinearThreshold > 0.0f || world->moveEventAngularThreshold > 0.0f ||
+				  world->moveEventQuantum > 0.0f;
+
+	if ( filter && world->filterMoveEvents == false )
+	{
+		// Every move was reported while the filter was off, so the current transforms are the reference
+		b2MarkAllDirty( world );
+		int bodyCount = world->bodies.count;
+		for ( int i = 0; i < bodyCount; ++i )
+		{
+			b2Body* body = world->bodies.data + i;
+			if ( body->id == B2_NULL_INDEX )
+			{
+				continue;
+			}
+
+			b2Transform transform = b2GetBodyTransformQuick( world, body );
+			body->reportedPosition = transform.p;
+			body->reportedAngle = b2Rot_GetAngle( transform.q );
+		}
+	}
+
+	world->filterMoveEvents = filter;
+}
+
+typedef struct b2BodyStatesContext
+{
+	b2World* world;
+	const b2BodyId* inputIds;
+	b2BodyId* outputIds;
+	b2BodyStateArrays arrays;
+	b2Transform* transforms;
+	float alpha;
+} b2BodyStatesContext;
+
+static void b2GetBodyStatesTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	B2_UNUSED( workerIndex );
+
+	b2TracyCZoneNC( body_states, "Body States", b2_colorLightSteelBlue, true );
+
+	b2BodyStatesContext* stateContext = context;
+	b2World* world = stateContext->world;
+	b2BodyStateArrays arrays = stateContext->arrays;
+
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		b2Body* body = b2GetBodyFullId( world, stateContext->inputIds[i] );
+		b2SolverSet* set = b2Array_Get( world->solverSets, body->setIndex );
+		b2BodySim* bodySim = b2Array_Get( set->bodySims, body->localIndex );
+
+		if ( arrays.positions != NULL )
+		{
+			arrays.positions[i] = bodySim->transform.p;
+		}
+
+		if ( arrays.rotations != NULL )
+		{
+			arrays.rotations[i] = bodySim->transform.q;
+		}
+
+		const b2BodyState* state = b2IsMovingSet( body->setIndex ) ? set->bodyStates.data + body->localIndex : NULL;
+
+		if ( arrays.linearVelocities != NULL )
+		{
+			arrays.linearVelocities[i] = state != NULL ? state->linearVelocity : b2Vec2_zero;
+		}
+
+		if ( arrays.angularVelocities != NULL )
+		{
+			arrays.angularVelocities[i] = state != NULL ? state->angularVelocity : 0.0f;
+		}
+	}
+
+	b2TracyCZoneEnd( body_states );
+}
+
+// The awake and kinematic sets store sims and states with the same index. The kinematic set
+// bodies follow the awake set bodies.
+static void b2GetAwakeBodyStatesTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	B2_UNUSED( workerIndex );
+
+	b2TracyCZoneNC( awake_body_states, "Awake Body States", b2_colorLightSteelBlue, true );
+
+	b2BodyStatesContext* stateContext = context;
+	b2World* world = stateContext->world;
+	b2BodyStateArrays arrays = stateContext->arrays;
+	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
+	b2SolverSet* kinematicSet = b2Array_Get( world->solverSets, b2_kinematicSet );
+	int awakeCount = awakeSet->bodySims.count;
+
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		const b2SolverSet* set = i < awakeCount ? awakeSet : kinematicSet;
+		int localIndex = i < awakeCount ? i : i - awakeCount;
+		const b2BodySim* bodySim = set->bodySims.data + localIndex;
+		const b2BodyState* state = set->bodyStates.data + localIndex;
+
+		if ( stateContext->outputIds != NULL )
+		{
+			const b2Body* body = world->bodies.data + bodySim->bodyId;
+			stateContext->outputIds[i] = (b2BodyId){ bodySim->bodyId + 1, world->worldId, body->generation };
+		}
+
+		if ( arrays.positions != NULL )
+		{
+			arrays.positions[i] = bodySim->transform.p;
+		}
+
+		if ( arrays.rotations != NULL )
+		{
+			arrays.rotations[i] = bodySim->transform.q;
+		}
+
+		if ( arrays.linearVelocities != NULL )
+		{
+			arrays.linearVelocities[i] = state->linearVelocity;
+		}
+
+		if ( arrays.angularVelocities != NULL )
+		{
+			arrays.angularVelocities[i] = state->angularVelocity;
+		}
+	}
+
+	b2TracyCZoneEnd( awake_body_states );
+}
+
+// The center of mass is blended linearly and the rotation with a normalized lerp, so a spinning body
+// does not wobble about its origin. Both ends use the current local center.
+static void b2GetInterpolatedTransformsTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	B2_UNUSED( workerIndex );
+
+	b2TracyCZoneNC( interpolated_transforms, "Interpolated Transforms", b2_colorLightSteelBlue, true );
+
+	b2BodyStatesContext* stateContext = context;
+	b2World* world = stateContext->world;
+	const b2Transform* previousTransforms = world->previousTransforms.data;
+	bool enableInterpolation = world->enableInterpolation;
+	float alpha = stateContext->alpha;
+
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		b2Body* body = b2GetBodyFullId( world, stateContext->inputIds[i] );
+		b2SolverSet* set = b2Array_Get( world->solverSets, body->setIndex );
+		b2BodySim* bodySim = b2Array_Get( set->bodySims, body->localIndex );
+
+		if ( enableInterpolation == false || b2IsMovingSet( body->setIndex ) == false )
+		{
+			stateContext->transforms[i] = bodySim->transform;
+			continue;
+		}
+
+		B2_ASSERT( body->id < world->previousTransforms.count );
+		b2Transform previous = previousTransforms[body->id];
+		b2Vec2 center0 = b2TransformPoint( previous, bodySim->localCenter );
+
+		b2Rot q = b2NLerp( previous.q, bodySim->transform.q, alpha );
+		b2Vec2 center = b2Lerp( center0, bodySim->center, alpha );
+		stateContext->transforms[i] = (b2Transform){ b2Sub( center, b2RotateVector( q, bodySim->localCenter ) ), q };
+	}
+
+	b2TracyCZoneEnd( interpolated_transforms );
+}
+
+// Copy loops are cheap per item so only large batches are split across workers
+void b2World_QueueBodyCommands( b2WorldId worldId, int bufferIndex, const b2BodyCommand* commands, int count )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	B2_ASSERT( 0 <= bufferIndex && bufferIndex < world->taskContexts.count );
+	B2_ASSERT( count == 0 || commands != NULL );
+	if ( bufferIndex < 0 || world->taskContexts.count <= bufferIndex || count <= 0 )
+	{
+		return;
+	}
+
+	b2Array( b2BodyCommand )* queue = &world->taskContexts.data[bufferIndex].bodyCommands;
+	int base = queue->count;
+	b2Array_Resize( *queue, base + count );
+	memcpy( queue->data + base, commands, count * sizeof( b2BodyCommand ) );
+}
+
+#define B2_BODY_STATES_MIN_RANGE 1024
+
+static void b2RunBodyStatesTask( b2World* world, b2ParallelForCallback* task, const char* taskName, int count,
+								 b2BodyStatesContext* context )
+{
+	if ( world->locked )
+	{
+		// The worker tasks belong to the step
+		task( 0, count, 0, context );
+		return;
+	}
+
+	// All tasks from the last step are finished so the task slots can be reused
+	world->taskCount = 0;
+	if ( world->scheduler != NULL )
+	{
+		b2ResetScheduler( world->scheduler );
+	}
+
+	b2RunParallelFor( world, task, taskName, count, B2_BODY_STATES_MIN_RANGE, context );
+}
+
+void b2World_GetBodyStates( b2WorldId worldId, const b2BodyId* bodyIds, int count, const b2BodyStateArrays* arrays )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	if ( count <= 0 )
+	{
+		return;
+	}
+
+	b2BodyStatesContext context = { world, bodyIds, NULL, *arrays, NULL, 0.0f };
+	b2RunBodyStatesTask( world, b2GetBodyStatesTask, "b2GetBodyStatesTask", count, &context );
+}
+
+int b2World_GetAwakeBodyStates( b2WorldId worldId, b2BodyId* bodyIds, int capacity, const b2BodyStateArrays* arrays )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	int awakeCount = world->solverSets.data[b2_awakeSet].bodySims.count + world->solverSets.data[b2_kinematicSet].bodySims.count;
+	int count = b2MinInt( awakeCount, capacity );
+	if ( count <= 0 )
+	{
+		return awakeCount;
+	}
+
+	b2BodyStatesContext context = { world, NULL, bodyIds, *arrays, NULL, 0.0f };
+	b2RunBodyStatesTask( world, b2GetAwakeBodyStatesTask, "b2GetAwakeBodyStatesTask", count, &context );
+
+	return awakeCount;
+}
+
+void b2World_GetInterpolatedTransforms( b2WorldId worldId, float alpha, const b2BodyId* bodyIds, int count,
+										b2Transform* transforms )
+{
+	B2_ASSERT( b2IsValidFloat( alpha ) );
+	b2World* world = b2GetWorldFromId( worldId );
+	if ( count <= 0 )
+	{
+		return;
+	}
+
+	b2BodyStatesContext context = { world, bodyIds, NULL, { 0 }, transforms, alpha };
+	b2RunBodyStatesTask( world, b2GetInterpolatedTransformsTask, "b2GetInterpolatedTransformsTask", count, &context );
+}
+
+b2SensorEvents b2World_GetSensorEvents( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return (b2SensorEvents){ 0 };
+	}
+
+	// Careful to use previous buffer
+	int endEventArrayIndex = 1 - world->endEventArrayIndex;
+
+	int beginCount = world->sensorBeginEvents.count;
+	int endCount = world->sensorEndEvents[endEventArrayIndex].count;
+
+	b2SensorEvents events = {
+		.beginEvents = world->sensorBeginEvents.data,
+		.endEvents = world->sensorEndEvents[endEventArrayIndex].data,
+		.beginCount = beginCount,
+		.endCount = endCount,
+	};
+	return events;
+}
+
+b2ContactEvents b2World_GetContactEvents( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return (b2ContactEvents){ 0 };
+	}
+
+	// Careful to use previous buffer
+	int endEventArrayIndex = 1 - world->endEventArrayIndex;
+
+	int beginCount = world->contactBeginEvents.count;
+	int endCount = world->contactEndEvents[endEventArrayIndex].count;
+	int hitCount = world->contactHitEvents.count;
+
+	b2ContactEvents events = {
+		.beginEvents = world->contactBeginEvents.data,
+		.endEvents = world->contactEndEvents[endEventArrayIndex].data,
+		.hitEvents = world->contactHitEvents.data,
+		.beginCount = beginCount,
+		.endCount = endCount,
+		.hitCount = hitCount,
+	};
+
+	return events;
+}
+
+b2JointEvents b2World_GetJointEvents( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return (b2JointEvents){ 0 };
+	}
+
+	int count = world->jointEvents.count;
+	b2JointEvents events = { world->jointEvents.data, count };
+	return events;
+}
+
+bool b2World_IsValid( b2WorldId id )
+{
+	if ( id.index1 < 1 || B2_MAX_WORLDS < id.index1 )
+	{
+		return false;
+	}
+
+	b2World* world = b2_worlds + ( id.index1 - 1 );
+
+	if ( world->worldId != id.index1 - 1 )
+	{
+		// world is not allocated
+		return false;
+	}
+
+	return id.generation == world->generation;
+}
+
+bool b2Body_IsValid( b2BodyId id )
+{
+	if ( B2_MAX_WORLDS <= id.world0 )
+	{
+		// invalid world
+		return false;
+	}
+
+	b2World* world = b2_worlds + id.world0;
+	if ( world->worldId != id.world0 )
+	{
+		// world is free
+		return false;
+	}
+
+	if ( id.index1 < 1 || world->bodies.count < id.index1 )
+	{
+		// invalid index
+		return false;
+	}
+
+	b2Body* body = world->bodies.data + ( id.index1 - 1 );
+	if ( body->setIndex == B2_NULL_INDEX )
+	{
+		// this was freed
+		return false;
+	}
+
+	B2_ASSERT( body->localIndex != B2_NULL_INDEX );
+
+	if ( body->generation != id.generation )
+	{
+		// this id is orphaned
+		return false;
+	}
+
+	return true;
+}
+
+bool b2BodyRef_IsValid( b2BodyRef ref )
+{
+	if ( B2_MAX_WORLDS <= ref.world0 || ref.sim == NULL )
+	{
+		return false;
+	}
+
+	b2World* world = b2_worlds + ref.world0;
+	if ( world->worldId != ref.world0 || world->generation != ref.worldGeneration )
+	{
+		// the world was destroyed
+		return false;
+	}
+
+	// body data may have moved
+	return world->locked == false && world->bodyRefEpoch == ref.epoch;
+}
+
+bool b2Shape_IsValid( b2ShapeId id )
+{
+	if ( B2_MAX_WORLDS <= id.world0 )
+	{
+		return false;
+	}
+
+	b2World* world = b2_worlds + id.world0;
+	if ( world->worldId != id.world0 )
+	{
+		// world is free
+		return false;
+	}
+
+	int shapeId = id.index1 - 1;
+	if ( shapeId < 0 || world->shapes.count <= shapeId )
+	{
+		return false;
+	}
+
+	b2Shape* shape = world->shapes.data + shapeId;
+	if ( shape->id == B2_NULL_INDEX )
+	{
+		// shape is free
+		return false;
+	}
+
+	B2_ASSERT( shape->id == shapeId );
+
+	return id.generation == shape->generation;
+}
+
+bool b2Chain_IsValid( b2ChainId id )
+{
+	if ( B2_MAX_WORLDS <= id.world0 )
+	{
+		return false;
+	}
+
+	b2World* world = b2_worlds + id.world0;
+	if ( world->worldId != id.world0 )
+	{
+		// world is free
+		return false;
+	}
+
+	int chainId = id.index1 - 1;
+	if ( chainId < 0 || world->chainShapes.count <= chainId )
+	{
+		return false;
+	}
+
+	b2ChainShape* chain = world->chainShapes.data + chainId;
+	if ( chain->id == B2_NULL_INDEX )
+	{
+		// chain is free
+		return false;
+	}
+
+	B2_ASSERT( chain->id == chainId );
+
+	return id.generation == chain->generation;
+}
+
+bool b2Joint_IsValid( b2JointId id )
+{
+	if ( B2_MAX_WORLDS <= id.world0 )
+	{
+		return false;
+	}
+
+	b2World* world = b2_worlds + id.world0;
+	if ( world->worldId != id.world0 )
+	{
+		// world is free
+		return false;
+	}
+
+	int jointId = id.index1 - 1;
+	if ( jointId < 0 || world->joints.count <= jointId )
+	{
+		return false;
+	}
+
+	b2Joint* joint = world->joints.data + jointId;
+	if ( joint->jointId == B2_NULL_INDEX )
+	{
+		// joint is free
+		return false;
+	}
+
+	B2_ASSERT( joint->jointId == jointId );
+
+	return id.generation == joint->generation;
+}
+
+bool b2Contact_IsValid( b2ContactId id )
+{
+	if ( B2_MAX_WORLDS <= id.world0 )
+	{
+		return false;
+	}
+
+	b2World* world = b2_worlds + id.world0;
+	if ( world->worldId != id.world0 )
+	{
+		// world is free
+		return false;
+	}
+
+	int contactId = id.index1 - 1;
+	if ( contactId < 0 || world->contacts.count <= contactId )
+	{
+		return false;
+	}
+
+	b2Contact* contact = world->contacts.data + contactId;
+	if ( contact->contactId == B2_NULL_INDEX )
+	{
+		// contact is free
+		return false;
+	}
+
+	B2_ASSERT( contact->contactId == contactId );
+
+	return id.generation == contact->generation;
+}
+
+void b2World_EnableSleeping( b2WorldId worldId, bool flag )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	if ( flag == world->enableSleep )
+	{
+		return;
+	}
+
+	world->enableSleep = flag;
+
+	if ( flag == false )
+	{
+		int setCount = world->solverSets.count;
+		for ( int i = b2_firstSleepingSet; i < setCount; ++i )
+		{
+			b2SolverSet* set = b2Array_Get( world->solverSets, i );
+			if ( set->bodySims.count > 0 )
+			{
+				b2WakeSolverSet( world, i );
+			}
+		}
+	}
+}
+
+bool b2World_IsSleepingEnabled( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->enableSleep;
+}
+
+void b2World_SetActiveRegions( b2WorldId worldId, const b2AABB* regions, int count )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	B2_ASSERT( count >= 0 );
+	b2Array_Clear( world->activeRegions );
+	for ( int i = 0; i < count; ++i )
+	{
+		B2_ASSERT( b2IsValidAABB( regions[i] ) );
+		b2Array_Push( world->activeRegions, regions[i] );
+	}
+}
+
+void b2World_EnableWarmStarting( b2WorldId worldId, bool flag )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->enableWarmStarting = flag;
+}
+
+bool b2World_IsWarmStartingEnabled( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->enableWarmStarting;
+}
+
+int b2World_GetAwakeBodyCount( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->solverSets.data[b2_awakeSet].bodySims.count + world->solverSets.data[b2_kinematicSet].bodySims.count;
+}
+
+void b2World_EnableContinuous( b2WorldId worldId, bool flag )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->enableContinuous = flag;
+}
+
+bool b2World_IsContinuousEnabled( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->enableContinuous;
+}
+
+void b2World_EnableContinuousCache( b2WorldId worldId, bool flag )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->enableContinuousCache = flag;
+}
+
+bool b2World_IsContinuousCacheEnabled( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->enableContinuousCache;
+}
+
+void b2World_EnableParallelOverflow( b2WorldId worldId, bool flag )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->enableParallelOverflow = flag;
+}
+
+bool b2World_IsParallelOverflowEnabled( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->enableParallelOverflow;
+}
+
+void b2World_EnableAdaptiveRelax( b2WorldId worldId, bool flag )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->enableAdaptiveRelax = flag;
+}
+
+bool b2World_IsAdaptiveRelaxEnabled( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->enableAdaptiveRelax;
+}
+
+void b2World_EnableVelocityMargins( b2WorldId worldId, bool flag )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->enableVelocityMargins = flag;
+}
+
+bool b2World_IsVelocityMarginsEnabled( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->enableVelocityMargins;
+}
+
+void b2World_EnableAllocationCheck( b2WorldId worldId, bool flag )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->enableAllocationCheck = flag;
+}
+
+bool b2World_IsAllocationCheckEnabled( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->enableAllocationCheck;
+}
+
+void b2World_EnableParallelContacts( b2WorldId worldId, bool flag )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->enableParallelContacts = flag;
+}
+
+bool b2World_IsParallelContactsEnabled( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->enableParallelContacts;
+}
+
+void b2World_EnableRelaxedDeterminism( b2WorldId worldId, bool flag )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->enableRelaxedDeterminism = flag;
+}
+
+bool b2World_IsRelaxedDeterminismEnabled( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->enableRelaxedDeterminism;
+}
+
+void b2World_EnableSortedCollide( b2WorldId worldId, bool flag )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->enableSortedCollide = flag;
+}
+
+bool b2World_IsSortedCollideEnabled( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->enableSortedCollide;
+}
+
+void b2World_EnablePipelinedCollide( b2WorldId worldId, bool flag )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->enablePipelinedCollide = flag;
+}
+
+bool b2World_IsPipelinedCollideEnabled( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->enablePipelinedCollide;
+}
+
+void b2World_EnableFusedPrepare( b2WorldId worldId, bool flag )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->enableFusedPrepare = flag;
+}
+
+bool b2World_IsFusedPrepareEnabled( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->enableFusedPrepare;
+}
+
+void b2World_EnableIncrementalIslands( b2WorldId worldId, bool flag )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->enableIncrementalIslands = flag;
+}
+
+bool b2World_IsIncrementalIslandsEnabled( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->enableIncrementalIslands;
+}
+
+void b2World_EnableIncrementalSensors( b2WorldId worldId, bool flag )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	if ( flag && world->enableIncrementalSensors == false )
+	{
+		// Shapes were not tracked while this was off. Start from the current bounds and update all sensors.
+		b2MarkAllDirty( world );
+		int shapeCount = world->shapes.count;
+		for ( int i = 0; i < shapeCount; ++i )
+		{
+			b2Shape* shape = world->shapes.data + i;
+			shape->sensorAABB = shape->aabb;
+		}
+
+		world->sensorFullUpdate = true;
+	}
+
+	world->enableIncrementalSensors = flag;
+}
+
+bool b2World_IsIncrementalSensorsEnabled( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->enableIncrementalSensors;
+}
+
+void b2World_EnableIncrementalPairs( b2WorldId worldId, bool flag )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	// The last query bounds are kept up to date while this is off
+	world->enableIncrementalPairs = flag;
+}
+
+bool b2World_IsIncrementalPairsEnabled( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->enableIncrementalPairs;
+}
+
+void b2World_SetRestitutionThreshold( b2WorldId worldId, float value )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->restitutionThreshold = b2ClampFloat( value, 0.0f, FLT_MAX );
+}
+
+float b2World_GetRestitutionThreshold( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->restitutionThreshold;
+}
+
+void b2World_SetHitEventThreshold( b2WorldId worldId, float value )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->hitEventThreshold = b2ClampFloat( value, 0.0f, FLT_MAX );
+}
+
+float b2World_GetHitEventThreshold( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->hitEventThreshold;
+}
+
+void b2World_SetContactEventFilter( b2WorldId worldId, b2ContactEventFilter filter )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->contactEventFilter = filter;
+
+	// Existing contacts pick up the new filter. Hit events are refreshed by the next contact update.
+	b2MarkAllDirty( world );
+	int contactCount = world->contacts.count;
+	for ( int i = 0; i < contactCount; ++i )
+	{
+		b2Contact* contact = world->contacts.data + i;
+		if ( contact->contactId == B2_NULL_INDEX )
+		{
+			continue;
+		}
+
+		const b2Shape* shapeA = world->shapes.data + contact->shapeIdA;
+		const b2Shape* shapeB = world->shapes.data + contact->shapeIdB;
+		if ( ( shapeA->enableContactEvents || shapeB->enableContactEvents ) && b2ShouldReportContactEvents( world, shapeA, shapeB ) )
+		{
+			contact->flags |= b2_contactEnableContactEvents;
+		}
+		else
+		{
+			contact->flags &= ~b2_contactEnableContactEvents;
+		}
+	}
+}
+
+b2ContactEventFilter b2World_GetContactEventFilter( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->contactEventFilter;
+}
+
+void b2World_SetContactTuning( b2WorldId worldId, float hertz, float dampingRatio, float pushSpeed )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->contactHertz = b2ClampFloat( hertz, 0.0f, FLT_MAX );
+	world->contactDampingRatio = b2ClampFloat( dampingRatio, 0.0f, FLT_MAX );
+	world->contactSpeed = b2ClampFloat( pushSpeed, 0.0f, FLT_MAX );
+}
+
+void b2World_SetContactRecycleDistance( b2WorldId worldId, float recycleDistance )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->contactRecycleDistance = b2ClampFloat( recycleDistance, 0.0f, FLT_MAX );
+}
+
+float b2World_GetContactRecycleDistance( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->contactRecycleDistance;
+}
+
+void b2World_SetMaximumLinearSpeed( b2WorldId worldId, float maximumLinearSpeed )
+{
+	B2_ASSERT( b2IsValidFloat( maximumLinearSpeed ) && maximumLinearSpeed > 0.0f );
+
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->maxLinearSpeed = maximumLinearSpeed;
+}
+
+float b2World_GetMaximumLinearSpeed( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->maxLinearSpeed;
+}
+
+void b2World_SetTreeOptimizationBudget( b2WorldId worldId, int budget )
+{
+	B2_ASSERT( budget >= 0 );
+
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->treeOptimizationBudget = b2MaxInt( budget, 0 );
+}
+
+int b2World_GetTreeOptimizationBudget( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->treeOptimizationBudget;
+}
+
+void b2World_SetMaxIslandSplits( b2WorldId worldId, int count )
+{
+	B2_ASSERT( count >= 0 );
+
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->maxIslandSplits = count > 0 ? b2MinInt( count, B2_MAX_ISLAND_SPLITS ) : 1;
+
+	// Drop the lowest priority pending splits
+	world->splitIslandCount = b2MinInt( world->splitIslandCount, world->maxIslandSplits );
+}
+
+int b2World_GetMaxIslandSplits( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->maxIslandSplits;
+}
+
+void b2World_SetContactPrefetchDistance( b2WorldId worldId, int distance )
+{
+	B2_ASSERT( distance >= 0 );
+
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	world->contactPrefetchDistance = b2MaxInt( distance, 0 );
+}
+
+int b2World_GetContactPrefetchDistance( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->contactPrefetchDistance;
+}
+
+b2Profile b2World_GetProfile( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->profile;
+}
+
+void b2World_EnableWorkerProfile( b2WorldId worldId, bool flag )
+{
+	b2World* world = b3GetUnlockedWorldFromId( worldId );
+	if ( world == NULL )
+	{
+		return;
+	}
+
+	world->enableWorkerProfile = flag;
+	for ( int i = 0; i < world->workerCount; ++i )
+	{
+		world->taskContexts.data[i].workerProfile = (b2WorkerProfile){ 0 };
+	}
+}
+
+b2WorkerProfile b2World_GetWorkerProfile( b2WorldId worldId, int workerIndex )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	if ( world->enableWorkerProfile == false || workerIndex < 0 || workerIndex >= world->workerCount )
+	{
+		return (b2WorkerProfile){ 0 };
+	}
+
+	return world->taskContexts.data[workerIndex].workerProfile;
+}
+
+int b2World_GetParallelForProfile( b2WorldId worldId, b2ParallelForProfile* profiles, int capacity )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	float millisecondsPerTick = (float)b2GetMillisecondsPerTick();
+
+	int count = b2MinInt( world->parallelForSiteCount, capacity );
+	for ( int i = 0; i < count; ++i )
+	{
+		const b2ParallelForSite* site = world->parallelForSites + i;
+		profiles[i] = (b2ParallelForProfile){
+			.name = site->name,
+			.callCount = site->callCount,
+			.itemCount = site->itemCount,
+			.blockCount = site->blockCount,
+			.blockSize = site->blockSize,
+			.wallTime = millisecondsPerTick * site->wallTicks,
+			.workTime = millisecondsPerTick * site->workTicks,
+			.claimTime = millisecondsPerTick * site->claimTicks,
+			.waitTime = millisecondsPerTick * site->waitTicks,
+		};
+	}
+
+	return world->parallelForSiteCount;
+}
+
+void b2World_EnableAdaptiveBlocks( b2WorldId worldId, bool flag )
+{
+	b2World* world = b3GetUnlockedWorldFromId( worldId );
+	if ( world == NULL )
+	{
+		return;
+	}
+
+	// Sites start over from the default block sizes
+	world->enableAdaptiveBlocks = flag;
+	world->parallelForSiteCount = 0;
+}
+
+bool b2World_IsAdaptiveBlocksEnabled( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->enableAdaptiveBlocks;
+}
+
+void b2World_EnableContactOrdering( b2WorldId worldId, bool flag )
+{
+	b2World* world = b3GetUnlockedWorldFromId( worldId );
+	if ( world == NULL )
+	{
+		return;
+	}
+
+	world->enableContactOrdering = flag;
+}
+
+bool b2World_IsContactOrderingEnabled( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->enableContactOrdering;
+}
+
+void b2World_EnableColorBalancing( b2WorldId worldId, bool flag )
+{
+	b2World* world = b3GetUnlockedWorldFromId( worldId );
+	if ( world == NULL )
+	{
+		return;
+	}
+
+	world->enableColorBalancing = flag;
+}
+
+bool b2World_IsColorBalancingEnabled( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->enableColorBalancing;
+}
+
+void b2World_BalanceColors( b2WorldId worldId )
+{
+	b2World* world = b3GetUnlockedWorldFromId( worldId );
+	if ( world == NULL )
+	{
+		return;
+	}
+
+	b2BalanceGraphColors( world );
+}
+
+void b2ResetInterpolation( b2World* world )
+{
+	if ( world->enableInterpolation == false )
+	{
+		return;
+	}
+
+	b2Array_Resize( world->previousTransforms, world->bodies.count );
+	for ( int i = 0; i < world->bodies.count; ++i )
+	{
+		b2Body* body = world->bodies.data + i;
+		if ( body->id == B2_NULL_INDEX )
+		{
+			continue;
+		}
+
+		world->previousTransforms.data[i] = b2GetBodyTransformQuick( world, body );
+	}
+}
+
+void b2World_EnableInterpolation( b2WorldId worldId, bool flag )
+{
+	b2World* world = b3GetUnlockedWorldFromId( worldId );
+	if ( world == NULL || flag == world->enableInterpolation )
+	{
+		return;
+	}
+
+	world->enableInterpolation = flag;
+	b2ResetInterpolation( world );
+}
+
+bool b2World_IsInterpolationEnabled( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->enableInterpolation;
+}
+
+// Arrays start on their own cache line so a consumer on another core does not share lines across arrays
+#define B2_EXPORT_ALIGNMENT 64
+
+static int b2AlignExportOffset( int offset )
+{
+	return ( offset + B2_EXPORT_ALIGNMENT - 1 ) & ~( B2_EXPORT_ALIGNMENT - 1 );
+}
+
+static b2ExportHeader b2MakeExportHeader( int slotCapacity )
+{
+	b2ExportHeader header = { 0 };
+	header.version = B2_EXPORT_VERSION;
+	header.slotCapacity = slotCapacity;
+
+	int offset = b2AlignExportOffset( sizeof( b2ExportHeader ) );
+	header.positionOffset = (uint32_t)offset;
+	offset = b2AlignExportOffset( offset + slotCapacity * (int)sizeof( b2Vec2 ) );
+	header.rotationOffset = (uint32_t)offset;
+	offset = b2AlignExportOffset( offset + slotCapacity * (int)sizeof( b2Rot ) );
+	header.linearVelocityOffset = (uint32_t)offset;
+	offset = b2AlignExportOffset( offset + slotCapacity * (int)sizeof( b2Vec2 ) );
+	header.angularVelocityOffset = (uint32_t)offset;
+	header.byteCount = b2AlignExportOffset( offset + slotCapacity * (int)sizeof( float ) );
+	return header;
+}
+
+int b2GetExportBufferSize( int slotCapacity )
+{
+	B2_ASSERT( slotCapacity >= 0 );
+	return b2MakeExportHeader( b2MaxInt( 0, slotCapacity ) ).byteCount;
+}
+
+// The world is the only writer so it keeps its own copy of the counter
+void b2BeginExport( b2World* world )
+{
+	if ( world->exportHeader == NULL )
+	{
+		return;
+	}
+
+	world->exportSequence += 1;
+	B2_ASSERT( ( world->exportSequence & 1 ) == 1 );
+	b2AtomicStoreU32( (b2AtomicU32*)&world->exportHeader->sequence, world->exportSequence );
+	b2AtomicFence();
+}
+
+void b2EndExport( b2World* world )
+{
+	if ( world->exportHeader == NULL )
+	{
+		return;
+	}
+
+	world->exportHeader->stepIndex = world->stepIndex;
+	b2AtomicFence();
+
+	world->exportSequence += 1;
+	b2AtomicStoreU32( (b2AtomicU32*)&world->exportHeader->sequence, world->exportSequence );
+}
+
+void b2ExportBody( b2World* world, b2Body* body )
+{
+	b2Vec2 linearVelocity = b2Vec2_zero;
+	float angularVelocity = 0.0f;
+	b2BodyState* state = b2GetBodyState( world, body );
+	if ( state != NULL )
+	{
+		linearVelocity = state->linearVelocity;
+		angularVelocity = state->angularVelocity;
+	}
+	else if ( b2KeepsVelocity( world, body->setIndex ) )
+	{
+		linearVelocity = body->parkedLinearVelocity;
+		angularVelocity = body->parkedAngularVelocity;
+	}
+
+	b2WriteExportSlot( world, body->exportSlot, b2GetBodyTransformQuick( world, body ), linearVelocity, angularVelocity );
+}
+
+void b2World_SetExportBuffer( b2WorldId worldId, void* buffer, int byteCount )
+{
+	b2World* world = b3GetUnlockedWorldFromId( worldId );
+	if ( world == NULL )
+	{
+		return;
+	}
+
+	world->exportHeader = NULL;
+	world->exportPositions = NULL;
+	world->exportRotations = NULL;
+	world->exportLinearVelocities = NULL;
+	world->exportAngularVelocities = NULL;
+	world->exportCapacity = 0;
+	world->exportSequence = 0;
+
+	if ( buffer == NULL )
+	{
+		return;
+	}
+
+	B2_ASSERT( ( (uintptr_t)buffer & ( sizeof( uint64_t ) - 1 ) ) == 0 );
+
+	// The largest slot count that fits
+	int slotCapacity = byteCount / (int)( 2 * sizeof( b2Vec2 ) + sizeof( b2Rot ) + sizeof( float ) );
+	b2ExportHeader header = b2MakeExportHeader( slotCapacity );
+	while ( slotCapacity > 0 && header.byteCount > byteCount )
+	{
+		slotCapacity -= 1;
+		header = b2MakeExportHeader( slotCapacity );
+	}
+
+	B2_ASSERT( header.byteCount <= byteCount );
+	if ( header.byteCount > byteCount )
+	{
+		return;
+	}
+
+	uint8_t* bytes = buffer;
+	memcpy( buffer, &header, sizeof( b2ExportHeader ) );
+	world->exportHeader = buffer;
+	world->exportPositions = (b2Vec2*)( bytes + header.positionOffset );
+	world->exportRotations = (b2Rot*)( bytes + header.rotationOffset );
+	world->exportLinearVelocities = (b2Vec2*)( bytes + header.linearVelocityOffset );
+	world->exportAngularVelocities = (float*)( bytes + header.angularVelocityOffset );
+	world->exportCapacity = slotCapacity;
+
+	// Fill the slots right away so a consumer does not have to wait for a step
+	b2BeginExport( world );
+	for ( int i = 0; i < world->bodies.count; ++i )
+	{
+		b2Body* body = world->bodies.data + i;
+		if ( body->id != B2_NULL_INDEX && body->exportSlot != B2_NULL_INDEX )
+		{
+			b2ExportBody( world, body );
+		}
+	}
+	b2EndExport( world );
+}
+
+int b2World_GetExportCapacity( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->exportCapacity;
+}
+
+bool b2ReadExportBuffer( const void* buffer, const int* slots, int count, const b2BodyStateArrays* arrays,
+						 uint64_t* stepIndex )
+{
+	const b2ExportHeader* header = buffer;
+	b2AtomicU32* sequence = (b2AtomicU32*)&header->sequence;
+
+	uint32_t begin = b2AtomicLoadU32( sequence );
+	if ( ( begin & 1 ) == 1 || header->version != B2_EXPORT_VERSION )
+	{
+		return false;
+	}
+
+	const uint8_t* bytes = buffer;
+	const b2Vec2* positions = (const b2Vec2*)( bytes + header->positionOffset );
+	const b2Rot* rotations = (const b2Rot*)( bytes + header->rotationOffset );
+	const b2Vec2* linearVelocities = (const b2Vec2*)( bytes + header->linearVelocityOffset );
+	const float* angularVelocities = (const float*)( bytes + header->angularVelocityOffset );
+	int slotCapacity = header->slotCapacity;
+
+	for ( int i = 0; i < count; ++i )
+	{
+		int slot = slots[i];
+		B2_ASSERT( 0 <= slot && slot < slotCapacity );
+		if ( slot < 0 || slotCapacity <= slot )
+		{
+			return false;
+		}
+
+		if ( arrays->positions != NULL )
+		{
+			arrays->positions[i] = positions[slot];
+		}
+
+		if ( arrays->rotations != NULL )
+		{
+			arrays->rotations[i] = rotations[slot];
+		}
+
+		if ( arrays->linearVelocities != NULL )
+		{
+			arrays->linearVelocities[i] = linearVelocities[slot];
+		}
+
+		if ( arrays->angularVelocities != NULL )
+		{
+			arrays->angularVelocities[i] = angularVelocities[slot];
+		}
+	}
+
+	if ( stepIndex != NULL )
+	{
+		*stepIndex = header->stepIndex;
+	}
+
+	// The copy is torn if the world started a write in the meantime
+	b2AtomicFence();
+	return b2AtomicLoadU32( sequence ) == begin;
+}
+
+void b2World_SetJointPrepareTolerance( b2WorldId worldId, float tolerance )
+{
+	B2_ASSERT( b2IsValidFloat( tolerance ) && tolerance >= 0.0f );
+
+	b2World* world = b3GetUnlockedWorldFromId( worldId );
+	if ( world == NULL )
+	{
+		return;
+	}
+
+	world->jointPrepareTolerance = b2MaxFloat( 0.0f, tolerance );
+}
+
+float b2World_GetJointPrepareTolerance( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->jointPrepareTolerance;
+}
+
+void b2World_SetIslandSolveBodyCount( b2WorldId worldId, int bodyCount )
+{
+	B2_ASSERT( bodyCount >= 0 );
+
+	b2World* world = b3GetUnlockedWorldFromId( worldId );
+	if ( world == NULL )
+	{
+		return;
+	}
+
+	world->islandSolveBodyCount = b2MaxInt( 0, bodyCount );
+}
+
+int b2World_GetIslandSolveBodyCount( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->islandSolveBodyCount;
+}
+
+b2Counters b2World_GetCounters( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	b2Counters s = { 0 };
+	s.bodyCount = b2GetIdCount( &world->bodyIdPool );
+	s.shapeCount = b2GetIdCount( &world->shapeIdPool );
+	s.contactCount = b2GetIdCount( &world->contactIdPool );
+	s.jointCount = b2GetIdCount( &world->jointIdPool );
+	s.islandCount = b2GetIdCount( &world->islandIdPool );
+
+	b2DynamicTree* staticTree = world->broadPhase.trees + b2_staticBody;
+	s.staticTreeHeight = b2DynamicTree_GetHeight( staticTree );
+
+	b2DynamicTree* dynamicTree = world->broadPhase.trees + b2_dynamicBody;
+	b2DynamicTree* kinematicTree = world->broadPhase.trees + b2_kinematicBody;
+	s.treeHeight = b2MaxInt( b2DynamicTree_GetHeight( dynamicTree ), b2DynamicTree_GetHeight( kinematicTree ) );
+
+	s.stackUsed = b2GetMaxStackAllocation( &world->stack );
+	s.byteCount = b2GetByteCount();
+	s.taskCount = world->taskCount;
+	s.solverWorkerCount = world->solverWorkerCount;
+	s.inlineColorCount = world->inlineColorCount;
+	s.stepAllocationCount = world->stepAllocationCount;
+	s.splitIslandCount = world->stepSplitIslandCount;
+	s.wokenSetCount = world->stepWokenSetCount;
+	s.detachedKinematicCount = world->solverSets.data[b2_kinematicSet].bodySims.count;
+	s.stackGrowth = world->stackGrowth;
+	s.rebuiltLeafCount = world->rebuiltLeafCount;
+	s.reorderedBodyCount = world->reorderedBodyCount;
+	s.sortedContactCount = world->sortedContactCount;
+	s.balancedContactCount = world->balancedContactCount;
+	s.particleCount = world->particles.positions.count;
+
+	s.recycledContactCount = 0;
+	s.cachedAxisContactCount = 0;
+	s.separatedContactCount = 0;
+	for ( int i = 0; i < world->workerCount; ++i )
+	{
+		s.recycledContactCount += world->taskContexts.data[i].recycledContactCount;
+		s.cachedAxisContactCount += world->taskContexts.data[i].cachedAxisContactCount;
+		s.separatedContactCount += world->taskContexts.data[i].separatedContactCount;
+	}
+
+	s.updatedSensorCount = world->sensorUpdateCount;
+
+	s.awakeContactCount = 0;
+	for ( int i = 0; i < B2_GRAPH_COLOR_COUNT; ++i )
+	{
+		b2GraphColor* color = world->constraintGraph.colors + i;
+		s.colorCounts[i] = color->contactSims.count + color->jointSims.count;
+		s.awakeContactCount += color->contactSims.count;
+	}
+	s.awakeContactCount += world->solverSets.data[b2_awakeSet].contactSims.count;
+
+	b2GraphColor* overflow = world->constraintGraph.colors + B2_OVERFLOW_INDEX;
+	s.overflowContactCount = overflow->contactSims.count;
+	s.overflowJointCount = overflow->jointSims.count;
+
+	if ( world->enableDetailedCounters )
+	{
+		_Static_assert( B2_COUNTER_BUCKET_COUNT == B2_ARRAY_COUNT( s.toiIterations ), "bucket count mismatch" );
+
+		for ( int i = 0; i < world->workerCount; ++i )
+		{
+			b2DetailedCounters* counters = &world->taskContexts.data[i].detailedCounters;
+			s.pairNodeVisits += counters->pairNodeVisits;
+			s.pairLeafVisits += counters->pairLeafVisits;
+			s.pairHeapBlockCount += counters->pairHeapBlockCount;
+			s.untouchedContactCount += counters->untouchedContactCount;
+			s.enlargedProxyCount += counters->enlargedProxyCount;
+			s.marginPairCount += counters->marginPairCount;
+
+			for ( int typeA = 0; typeA < b2_shapeTypeCount; ++typeA )
+			{
+				for ( int typeB = 0; typeB < b2_shapeTypeCount; ++typeB )
+				{
+					s.manifoldCalls[typeA][typeB] += counters->manifoldCalls[B2_SHAPE_PAIR_TYPE( typeA, typeB )];
+				}
+			}
+
+			for ( int j = 0; j < B2_COUNTER_BUCKET_COUNT; ++j )
+			{
+				s.toiIterations[j] += counters->toiIterations[j];
+				s.gjkIterations[j] += counters->gjkIterations[j];
+			}
+		}
+	}
+
+	return s;
+}
+
+void b2World_EnableDetailedCounters( b2WorldId worldId, bool flag )
+{
+	b2World* world = b3GetUnlockedWorldFromId( worldId );
+	if ( world == NULL )
+	{
+		return;
+	}
+
+	world->enableDetailedCounters = flag;
+	for ( int i = 0; i < world->workerCount; ++i )
+	{
+		world->taskContexts.data[i].detailedCounters = (b2DetailedCounters){ 0 };
+	}
+}
+
+b2Capacity b2World_GetMaxCapacity( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->maxCapacity;
+}
+
+void b2World_SetUserData( b2WorldId worldId, void* userData )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	world->userData = userData;
+}
+
+void* b2World_GetUserData( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->userData;
+}
+
+void b2World_SetFrictionCallback( b2WorldId worldId, b2FrictionCallback* callback )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	if ( callback != NULL )
+	{
+		world->frictionCallback = callback;
+	}
+	else
+	{
+		world->frictionCallback = b2DefaultFrictionCallback;
+	}
+}
+
+void b2World_SetRestitutionCallback( b2WorldId worldId, b2RestitutionCallback* callback )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	if ( world->locked )
+	{
+		return;
+	}
+
+	if ( callback != NULL )
+	{
+		world->restitutionCallback = callback;
+	}
+	else
+	{
+		world->restitutionCallback = b2DefaultRestitutionCallback;
+	}
+}
+
+void b2World_SetWorkerCount( b2WorldId worldId, int count )
+{
+	b2World* world = b3GetUnlockedWorldFromId( worldId );
+	if ( world == NULL )
+	{
+		return;
+	}
+
+	if ( count == world->workerCount )
+	{
+		return;
+	}
+
+	// Queued commands live in the worker contexts
+	b2ApplyBodyCommands( world );
+
+	b2DestroyWorkerContexts( world );
+	world->workerCount = b2ClampInt( count, 1, B2_MAX_WORKERS );
+	b2CreateWorkerContexts( world );
+
+	// Block sizes tuned for the old worker count
+	world->parallelForSiteCount = 0;
+}
+
+void b2World_EnableAutoWorkers( b2WorldId worldId, bool flag )
+{
+	b2World* world = b3GetUnlockedWorldFromId( worldId );
+	if ( world == NULL )
+	{
+		return;
+	}
+
+	world->enableAutoWorkers = flag;
+}
+
+bool b2World_IsAutoWorkersEnabled( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->enableAutoWorkers;
+}
+
+void b2World_SetWaitPolicy( b2WorldId worldId, b2WaitPolicy policy, int spinCount )
+{
+	b2World* world = b3GetUnlockedWorldFromId( worldId );
+	if ( world == NULL )
+	{
+		return;
+	}
+
+	B2_ASSERT( b2_waitYield <= policy && policy <= b2_waitPark );
+	world->waitPolicy = policy;
+	world->waitSpinCount = spinCount > 0 ? spinCount : B2_DEFAULT_WAIT_SPIN_COUNT;
+}
+
+b2WaitPolicy b2World_GetWaitPolicy( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->waitPolicy;
+}
+
+int b2World_GetWorkerCount( b2WorldId worldId )
+{
+	b2World* world = b3GetUnlockedWorldFromId( worldId );
+	if ( world == NULL )
+	{
+		return 0;
+	}
+
+	return world->workerCount;
+}
+
+void b2World_DumpMemoryStats( b2WorldId worldId )
+{
+	FILE* file = fopen( "box2d_memory.txt", "w" );
+	if ( file == NULL )
+	{
+		return;
+	}
+
+	b2World* world = b2GetWorldFromId( worldId );
+
+	// id pools
+	fprintf( file, "id pools\n" );
+	fprintf( file, "body ids: %d\n", b2GetIdBytes( &world->bodyIdPool ) );
+	fprintf( file, "solver set ids: %d\n", b2GetIdBytes( &world->solverSetIdPool ) );
+	fprintf( file, "joint ids: %d\n", b2GetIdBytes( &world->jointIdPool ) );
+	fprintf( file, "contact ids: %d\n", b2GetIdBytes( &world->contactIdPool ) );
+	fprintf( file, "island ids: %d\n", b2GetIdBytes( &world->islandIdPool ) );
+	fprintf( file, "shape ids: %d\n", b2GetIdBytes( &world->shapeIdPool ) );
+	fprintf( file, "chain ids: %d\n", b2GetIdBytes( &world->chainIdPool ) );
+	fprintf( file, "\n" );
+
+	// world arrays
+	fprintf( file, "world arrays\n" );
+	fprintf( file, "bodies: %d\n", b2Array_ByteCount( world->bodies ) );
+	fprintf( file, "solver sets: %d\n", b2Array_ByteCount( world->solverSets ) );
+	fprintf( file, "joints: %d\n", b2Array_ByteCount( world->joints ) );
+	fprintf( file, "contacts: %d\n", b2Array_ByteCount( world->contacts ) );
+	// todo account for body/contact/joint arrays in island
+	fprintf( file, "islands: %d\n", world->islands.capacity * (int)sizeof( b2Island ) );
+	fprintf( file, "shapes: %d\n", b2Array_ByteCount( world->shapes ) );
+	fprintf( file, "chains: %d\n", b2Array_ByteCount( world->chainShapes ) );
+	fprintf( file, "\n" );
+
+	// broad-phase
+	fprintf( file, "broad-phase\n" );
+	fprintf( file, "static tree: %d\n", b2DynamicTree_GetByteCount( world->broadPhase.trees + b2_staticBody ) );
+	fprintf( file, "kinematic tree: %d\n", b2DynamicTree_GetByteCount( world->broadPhase.trees + b2_kinematicBody ) );
+	fprintf( file, "dynamic tree: %d\n", b2DynamicTree_GetByteCount( world->broadPhase.trees + b2_dynamicBody ) );
+	b2HashSet32* moveSet = &world->broadPhase.moveSet;
+	fprintf( file, "moveSet: %d (%u, %u)\n", b2GetHashSet32Bytes( moveSet ), moveSet->count, moveSet->capacity );
+	fprintf( file, "moveArray: %d\n", b2Array_ByteCount( world->broadPhase.moveArray ) );
+	b2HashSet* pairSet = &world->broadPhase.pairSet;
+	fprintf( file, "pairSet: %d (%u, %u)\n", b2GetHashSetBytes( pairSet ), pairSet->count, pairSet->capacity );
+	fprintf( file, "\n" );
+
+	// solver sets
+	int bodySimCapacity = 0;
+	int bodyStateCapacity = 0;
+	int jointSimCapacity = 0;
+	int contactSimCapacity = 0;
+	int islandSimCapacity = 0;
+	int solverSetCapacity = world->solverSets.count;
+	for ( int i = 0; i < solverSetCapacity; ++i )
+	{
+		b2SolverSet* set = world->solverSets.data + i;
+		if ( set->setIndex == B2_NULL_INDEX )
+		{
+			continue;
+		}
+
+		bodySimCapacity += set->bodySims.capacity;
+		bodyStateCapacity += set->bodyStates.capacity;
+		jointSimCapacity += set->jointSims.capacity;
+		contactSimCapacity += set->contactSims.capacity + set->compactContactSims.capacity;
+		islandSimCapacity += set->islandSims.capacity;
+	}
+
+	fprintf( file, "solver sets\n" );
+	fprintf( file, "body sim: %d\n", bodySimCapacity * (int)sizeof( b2BodySim ) );
+	fprintf( file, "body state: %d\n", bodyStateCapacity * (int)sizeof( b2BodyState ) );
+	fprintf( file, "joint sim: %d\n", jointSimCapacity * (int)sizeof( b2JointSim ) );
+	fprintf( file, "contact sim: %d\n", contactSimCapacity * (int)sizeof( b2ContactSim ) );
+	fprintf( file, "island sim: %d\n", islandSimCapacity * (int)sizeof( islandSimCapacity ) );
+	fprintf( file, "\n" );
+
+	// constraint graph
+	int bodyBitSetBytes = 0;
+	contactSimCapacity = 0;
+	jointSimCapacity = 0;
+	for ( int i = 0; i < B2_GRAPH_COLOR_COUNT; ++i )
+	{
+		b2GraphColor* c = world->constraintGraph.colors + i;
+		bodyBitSetBytes += b2GetBitSetBytes( &c->bodySet );
+		contactSimCapacity += c->contactSims.capacity;
+		jointSimCapacity += c->jointSims.capacity;
+	}
+
+	fprintf( file, "constraint graph\n" );
+	fprintf( file, "body bit sets: %d\n", bodyBitSetBytes );
+	fprintf( file, "joint sim: %d\n", jointSimCapacity * (int)sizeof( b2JointSim ) );
+	fprintf( file, "contact sim: %d\n", contactSimCapacity * (int)sizeof( b2ContactSim ) );
+	fprintf( file, "\n" );
+
+	// stack allocator
+	fprintf( file, "stack allocator: %d\n\n", world->stack.capacity );
+
+	// chain shapes
+	// todo
+
+	fclose( file );
+}
+
+b2MemoryStats b2World_GetMemoryStats( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	b2MemoryStats s = { 0 };
+
+	s.idPools = b2GetIdBytes( &world->bodyIdPool ) + b2GetIdBytes( &world->solverSetIdPool ) +
+				b2GetIdBytes( &world->jointIdPool ) + b2GetIdBytes( &world->contactIdPool ) +
+				b2GetIdBytes( &world->islandIdPool ) + b2GetIdBytes( &world->shapeIdPool ) +
+				b2GetIdBytes( &world->chainIdPool );
+
+	s.objectArrays = b2Array_ByteCount( world->bodies ) + b2Array_ByteCount( world->shapes ) +
+					 b2Array_ByteCount( world->joints ) + b2Array_ByteCount( world->contacts ) +
+					 b2Array_ByteCount( world->solverSets ) + b2Array_ByteCount( world->previousTransforms );
+
+	s.islands = b2Array_ByteCount( world->islands );
+	for ( int i = 0; i < world->islands.count; ++i )
+	{
+		b2Island* island = world->islands.data + i;
+		s.islands += b2Array_ByteCount( island->bodies ) + b2Array_ByteCount( island->contacts ) +
+					 b2Array_ByteCount( island->joints ) + b2Array_ByteCount( island->removedLinks );
+	}
+	s.islands += b2Array_ByteCount( world->lodBodies ) + b2Array_ByteCount( world->activeRegions );
+
+	s.chains = b2Array_ByteCount( world->chainShapes );
+	for ( int i = 0; i < world->chainShapes.count; ++i )
+	{
+		b2ChainShape* chain = world->chainShapes.data + i;
+		if ( chain->id != B2_NULL_INDEX )
+		{
+			s.chains += chain->count * (int)sizeof( int ) + chain->materialCount * (int)sizeof( b2SurfaceMaterial );
+		}
+	}
+
+	b2BroadPhase* broadPhase = &world->broadPhase;
+	for ( int i = 0; i < b2_bodyTypeCount; ++i )
+	{
+		s.trees[i] = b2DynamicTree_GetByteCount( broadPhase->trees + i );
+	}
+
+	s.moveSet = b2GetHashSet32Bytes( &broadPhase->moveSet ) + b2Array_ByteCount( broadPhase->moveArray ) +
+				b2Array_ByteCount( broadPhase->enlargedShapes );
+	s.pairSet = b2GetHashSetBytes( &broadPhase->pairSet );
+
+	for ( int i = 0; i < world->solverSets.count; ++i )
+	{
+		b2SolverSet* set = world->solverSets.data + i;
+		s.bodySims += b2Array_ByteCount( set->bodySims );
+		s.bodyStates += b2Array_ByteCount( set->bodyStates );
+		s.jointSims += b2Array_ByteCount( set->jointSims );
+		s.contactSims += b2Array_ByteCount( set->contactSims ) + b2Array_ByteCount( set->compactContactSims );
+		s.islandSims += b2Array_ByteCount( set->islandSims );
+	}
+
+	_Static_assert( B2_GRAPH_COLOR_COUNT == B2_ARRAY_COUNT( s.colors ), "color count mismatch" );
+	for ( int i = 0; i < B2_GRAPH_COLOR_COUNT; ++i )
+	{
+		b2GraphColor* color = world->constraintGraph.colors + i;
+		s.colors[i] = b2GetBitSetBytes( &color->bodySet ) + b2Array_ByteCount( color->contactSims ) +
+					  b2Array_ByteCount( color->jointSims );
+	}
+
+	s.sensors = b2Array_ByteCount( world->sensors ) + b2DynamicTree_GetByteCount( &world->sensorTree ) +
+				b2Array_ByteCount( world->pendingSensorIds );
+	for ( int i = 0; i < world->sensors.count; ++i )
+	{
+		b2Sensor* sensor = world->sensors.data + i;
+		s.sensors += b2Array_ByteCount( sensor->hits ) + b2Array_ByteCount( sensor->overlaps1 ) +
+					 b2Array_ByteCount( sensor->overlaps2 );
+	}
+
+	s.sensors += b2Array_ByteCount( world->sensorTaskContexts );
+	for ( int i = 0; i < world->sensorTaskContexts.count; ++i )
+	{
+		b2SensorTaskContext* context = world->sensorTaskContexts.data + i;
+		s.sensors += b2GetBitSetBytes( &context->eventBits ) + b2GetBitSetBytes( &context->dirtyBits ) +
+					 b2Array_ByteCount( context->hitSensorIds ) + b2Array_ByteCount( context->visitors ) +
+					 b2Array_ByteCount( context->sortBuffer ) + b2Array_ByteCount( context->beginEvents ) +
+					 b2Array_ByteCount( context->endEvents );
+	}
+
+	s.events = b2Array_ByteCount( world->bodyMoveEvents ) + b2Array_ByteCount( world->reportedMoveEvents ) +
+			   b2Array_ByteCount( world->moveDeltas ) + b2Array_ByteCount( world->sensorBeginEvents ) +
+			   b2Array_ByteCount( world->contactBeginEvents ) + b2Array_ByteCount( world->contactHitEvents ) +
+			   b2Array_ByteCount( world->jointEvents );
+	for ( int i = 0; i < 2; ++i )
+	{
+		s.events += b2Array_ByteCount( world->sensorEndEvents[i] ) + b2Array_ByteCount( world->contactEndEvents[i] );
+	}
+
+	s.workers = b2Array_ByteCount( world->taskContexts );
+	for ( int i = 0; i < world->taskContexts.count; ++i )
+	{
+		b2TaskContext* context = world->taskContexts.data + i;
+		s.workers += b2Array_ByteCount( context->sensorHits ) + b2Array_ByteCount( context->overlapHits ) +
+					 b2Array_ByteCount( context->continuousPairs ) + b2Array_ByteCount( context->bodyCommands ) +
+					 b2Array_ByteCount( context->jointEventIds ) + b2GetBitSetBytes( &context->contactStateBitSet ) +
+					 b2Array_ByteCount( context->hitEvents ) + b2GetBitSetBytes( &context->enlargedSimBitSet ) +
+					 b2GetBitSetBytes( &context->awakeIslandBitSet ) + b2Array_ByteCount( context->kinematicBodyIds ) +
+					 b2Array_ByteCount( context->contactBeginEvents ) + b2Array_ByteCount( context->contactEndEvents );
+		for ( int j = 0; j < b2_shapeTypeCount; ++j )
+		{
+			s.workers += b2Array_ByteCount( context->aabbUpdates[j] );
+		}
+
+		s.arenaCapacity += b2GetArenaCapacity( &context->arena );
+		s.arenaMaxAllocation += b2GetMaxArenaAllocation( &context->arena );
+		s.arenaHeapCount += b2GetArenaHeapCount( &context->arena );
+	}
+
+	s.bitSets = b2GetBitSetBytes( &world->debugBodySet ) + b2GetBitSetBytes( &world->debugJointSet ) +
+				b2GetBitSetBytes( &world->debugContactSet ) + b2GetBitSetBytes( &world->debugIslandSet );
+	s.bitSets += b2Array_ByteCount( world->debugDrawItems ) + b2Array_ByteCount( world->debugPrimitives ) +
+				 b2Array_ByteCount( world->debugVertices );
+	for ( int i = 0; i < b2_dirtyTypeCount; ++i )
+	{
+		s.bitSets += b2GetBitSetBytes( world->dirtyBitSets + i );
+	}
+
+	s.stackCapacity = b2GetStackCapacity( &world->stack );
+	s.stackMaxAllocation = b2GetMaxStackAllocation( &world->stack );
+	s.stackHeapCount = b2GetStackHeapCount( &world->stack );
+
+	s.particles = b2GetParticleSystemBytes( &world->particles );
+
+	s.totalBytes = s.idPools + s.objectArrays + s.islands + s.chains + s.moveSet + s.pairSet + s.bodySims +
+				   s.bodyStates + s.jointSims + s.contactSims + s.islandSims + s.sensors + s.particles + s.events +
+				   s.workers + s.bitSets + s.stackCapacity + s.arenaCapacity;
+	for ( int i = 0; i < b2_bodyTypeCount; ++i )
+	{
+		s.totalBytes += s.trees[i];
+	}
+
+	for ( int i = 0; i < B2_GRAPH_COLOR_COUNT; ++i )
+	{
+		s.totalBytes += s.colors[i];
+	}
+
+	return s;
+}
+
+b2ObjectSizes b2GetObjectSizes( void )
+{
+	b2ObjectSizes s;
+	s.body = (int)sizeof( b2Body );
+	s.bodySim = (int)sizeof( b2BodySim );
+	s.bodyState = (int)sizeof( b2BodyState );
+	s.shape = (int)sizeof( b2Shape );
+	s.chain = (int)sizeof( b2ChainShape );
+	s.contact = (int)sizeof( b2Contact );
+	s.contactSim = (int)sizeof( b2ContactSim );
+	s.compactContactSim = (int)sizeof( b2CompactContactSim );
+	s.joint = (int)sizeof( b2Joint );
+	s.jointSim = (int)sizeof( b2JointSim );
+	s.island = (int)sizeof( b2Island );
+	s.islandSim = (int)sizeof( b2IslandSim );
+	s.sensor = (int)sizeof( b2Sensor );
+	s.treeNode = b2GetTreeNodeSize();
+	return s;
+}
+
+// World queries are allowed during an asynchronous step but only see the static tree. The static
+// tree and static bodies are not modified by the step.
+static int b2GetQueryTreeCount( b2World* world )
+{
+	if ( world->isStepAsync )
+	{
+		return 1;
+	}
+
+	B2_ASSERT( world->locked == false );
+	return world->locked ? 0 : b2_bodyTypeCount;
+}
+
+static b2Transform b2GetQueryTransform( b2World* world, b2Body* body )
+{
+	if ( world->isStepAsync )
+	{
+		B2_ASSERT( body->setIndex == b2_staticSet );
+		return world->asyncStaticSims[body->localIndex].transform;
+	}
+
+	return b2GetBodyTransformQuick( world, body );
+}
+
+typedef struct WorldQueryContext
+{
+	b2World* world;
+	b2OverlapResultFcn* fcn;
+	b2QueryFilter filter;
+	void* userContext;
+} WorldQueryContext;
+
+static bool TreeQueryCallback( int proxyId, uint64_t userData, void* context )
+{
+	B2_UNUSED( proxyId );
+
+	int shapeId = (int)userData;
+
+	WorldQueryContext* worldContext = context;
+	b2World* world = worldContext->world;
 
-					contactKey = contact->edges[edgeIndex].nextKey;
-				}
-			}
+	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
 
-			if ( draw->drawIslands )
-			{
-				int islandId = body->islandId;
-				if ( islandId != B2_NULL_INDEX && b2GetBit( &world->debugIslandSet, islandId ) == false )
-				{
-					b2Island* island = world->islands.data + islandId;
-					if ( island->setIndex == B2_NULL_INDEX )
-					{
-						continue;
-					}
+	if ( b2ShouldQueryCollide( shape->filter, worldContext->filter ) == false )
+	{
+		return true;
+	}
 
-					int shapeCount = 0;
-					b2AABB aabb = {
-						.lowerBound = { FLT_MAX, FLT_MAX },
-						.upperBound = { -FLT_MAX, -FLT_MAX },
-					};
+	b2ShapeId id = { shapeId + 1, world->worldId, shape->generation };
+	bool result = worldContext->fcn( id, worldContext->userContext );
+	return result;
+}
 
-					for ( int bodyIndex = 0; bodyIndex < island->bodies.count; ++bodyIndex )
-					{
-						int islandBodyId = island->bodies.data[bodyIndex];
-						b2Body* islandBody = b2Array_Get( world->bodies, islandBodyId );
-						int shapeId = islandBody->headShapeId;
-						while ( shapeId != B2_NULL_INDEX )
-						{
-							b2Shape* shape = b2Array_Get( world->shapes, shapeId );
-							aabb = b2AABB_Union( aabb, shape->fatAABB );
-							shapeCount += 1;
-							shapeId = shape->nextShapeId;
-						}
-					}
+b2TreeStats b2World_OverlapAABB( b2WorldId worldId, b2AABB aabb, b2QueryFilter filter, b2OverlapResultFcn* fcn, void* context )
+{
+	b2TreeStats treeStats = { 0 };
 
-					if ( shapeCount > 0 )
-					{
-						b2Vec2 vs[4] = { { aabb.lowerBound.x, aabb.lowerBound.y },
-										 { aabb.upperBound.x, aabb.lowerBound.y },
-										 { aabb.upperBound.x, aabb.upperBound.y },
-										 { aabb.lowerBound.x, aabb.upperBound.y } };
+	b2World* world = b2GetWorldFromId( worldId );
+	int treeCount = b2GetQueryTreeCount( world );
+	if ( treeCount == 0 )
+	{
+		return treeStats;
+	}
 
-						draw->DrawPolygonFcn( vs, 4, b2_colorOrangeRed, draw->context );
-					}
+	B2_ASSERT( b2IsValidAABB( aabb ) );
 
-					b2SetBit( &world->debugIslandSet, islandId );
-				}
-			}
+	WorldQueryContext worldContext = { world, fcn, filter, context };
 
-			// Clear the smallest set bit
-			word = word & ( word - 1 );
-		}
+	for ( int i = 0; i < treeCount; ++i )
+	{
+		b2TreeStats treeResult =
+			b2DynamicTree_Query( world->broadPhase.trees + i, aabb, filter.maskBits, TreeQueryCallback, &worldContext );
+
+		treeStats.nodeVisits += treeResult.nodeVisits;
+		treeStats.leafVisits += treeResult.leafVisits;
 	}
+
+	return treeStats;
 }
 
-b2BodyEvents b2World_GetBodyEvents( b2WorldId worldId )
+static bool b2ShapeOverlapsProxy( b2World* world, b2Shape* shape, const b2ShapeProxy* proxy )
 {
-	b2World* world = b2GetWorldFromId( worldId );
-	B2_ASSERT( world->locked == false );
-	if ( world->locked )
+	b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
+	b2Transform transform = b2GetQueryTransform( world, body );
+
+	b2DistanceOutput output = b2ComputeShapeProxyDistance( shape, transform, proxy, b2Transform_identity );
+
+	float tolerance = 0.1f * B2_LINEAR_SLOP;
+	return output.distance <= tolerance;
+}
+
+typedef struct WorldOverlapContext
+{
+	b2World* world;
+	b2OverlapResultFcn* fcn;
+	b2QueryFilter filter;
+	const b2ShapeProxy* proxy;
+	void* userContext;
+} WorldOverlapContext;
+
+static bool TreeOverlapCallback( int proxyId, uint64_t userData, void* context )
+{
+	B2_UNUSED( proxyId );
+
+	int shapeId = (int)userData;
+
+	WorldOverlapContext* worldContext = context;
+	b2World* world = worldContext->world;
+
+	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+
+	if ( b2ShouldQueryCollide( shape->filter, worldContext->filter ) == false )
 	{
-		return (b2BodyEvents){ 0 };
+		return true;
 	}
 
-	int count = world->bodyMoveEvents.count;
-	b2BodyEvents events = { world->bodyMoveEvents.data, count };
-	return events;
+	if ( b2ShapeOverlapsProxy( world, shape, worldContext->proxy ) == false )
+	{
+		return true;
+	}
+
+	b2ShapeId id = { shape->id + 1, world->worldId, shape->generation };
+	bool result = worldContext->fcn( id, worldContext->userContext );
+	return result;
 }
 
-b2SensorEvents b2World_GetSensorEvents( b2WorldId worldId )
+b2TreeStats b2World_OverlapShape( b2WorldId worldId, const b2ShapeProxy* proxy, b2QueryFilter filter, b2OverlapResultFcn* fcn,
+								  void* context )
 {
+	b2TreeStats treeStats = { 0 };
+
 	b2World* world = b2GetWorldFromId( worldId );
-	B2_ASSERT( world->locked == false );
-	if ( world->locked )
+	int treeCount = b2GetQueryTreeCount( world );
+	if ( treeCount == 0 )
 	{
-		return (b2SensorEvents){ 0 };
+		return treeStats;
 	}
 
-	// Careful to use previous buffer
-	int endEventArrayIndex = 1 - world->endEventArrayIndex;
+	b2AABB aabb = b2MakeAABB( proxy->points, proxy->count, proxy->radius );
+	WorldOverlapContext worldContext = {
+		world, fcn, filter, proxy, context,
+	};
 
-	int beginCount = world->sensorBeginEvents.count;
-	int endCount = world->sensorEndEvents[endEventArrayIndex].count;
+	for ( int i = 0; i < treeCount; ++i )
+	{
+		b2TreeStats treeResult =
+			b2DynamicTree_Query( world->broadPhase.trees + i, aabb, filter.maskBits, TreeOverlapCallback, &worldContext );
 
-	b2SensorEvents events = {
-		.beginEvents = world->sensorBeginEvents.data,
-		.endEvents = world->sensorEndEvents[endEventArrayIndex].data,
-		.beginCount = beginCount,
-		.endCount = endCount,
-	};
-	return events;
+		treeStats.nodeVisits += treeResult.nodeVisits;
+		treeStats.leafVisits += treeResult.leafVisits;
+	}
+
+	return treeStats;
 }
 
-b2ContactEvents b2World_GetContactEvents( b2WorldId worldId )
+typedef struct b2OverlapRange
+{
+	int workerIndex;
+	int start;
+	int count;
+} b2OverlapRange;
+
+typedef struct b2OverlapBatchContext
+{
+	b2World* world;
+	const b2AABB* aabbs;
+	const b2ShapeProxy* proxies;
+	const b2QueryFilter* filters;
+	b2OverlapRange* ranges;
+	int treeCount;
+} b2OverlapBatchContext;
+
+typedef struct b2OverlapBatchQuery
+{
+	b2World* world;
+	b2QueryFilter filter;
+	const b2ShapeProxy* proxy;
+	b2TaskContext* taskContext;
+	int queryIndex;
+} b2OverlapBatchQuery;
+
+static bool b2OverlapBatchCallback( int proxyId, uint64_t userData, void* context )
+{
+	B2_UNUSED( proxyId );
+
+	int shapeId = (int)userData;
+
+	b2OverlapBatchQuery* query = context;
+	b2World* world = query->world;
+
+	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+
+	if ( b2ShouldQueryCollide( shape->filter, query->filter ) == false )
+	{
+		return true;
+	}
+
+	if ( query->proxy != NULL && b2ShapeOverlapsProxy( world, shape, query->proxy ) == false )
+	{
+		return true;
+	}
+
+	b2OverlapHit hit = { query->queryIndex, { shapeId + 1, world->worldId, shape->generation } };
+	b2Array_Push( query->taskContext->overlapHits, hit );
+	return true;
+}
+
+static void b2OverlapBatchTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	b2TracyCZoneNC( overlap_task, "Overlap Batch", b2_colorDodgerBlue, true );
+
+	b2OverlapBatchContext* batchContext = context;
+	b2World* world = batchContext->world;
+	b2TaskContext* taskContext = world->taskContexts.data + workerIndex;
+
+	for ( int queryIndex = startIndex; queryIndex < endIndex; ++queryIndex )
+	{
+		b2OverlapBatchQuery query = { world, batchContext->filters[queryIndex], NULL, taskContext, queryIndex };
+
+		b2AABB aabb;
+		if ( batchContext->proxies != NULL )
+		{
+			query.proxy = batchContext->proxies + queryIndex;
+			aabb = b2MakeAABB( query.proxy->points, query.proxy->count, query.proxy->radius );
+		}
+		else
+		{
+			aabb = batchContext->aabbs[queryIndex];
+			B2_ASSERT( b2IsValidAABB( aabb ) );
+		}
+
+		b2OverlapRange* range = batchContext->ranges + queryIndex;
+		range->workerIndex = workerIndex;
+		range->start = taskContext->overlapHits.count;
+
+		for ( int i = 0; i < batchContext->treeCount; ++i )
+		{
+			b2DynamicTree_Query( world->broadPhase.trees + i, aabb, query.filter.maskBits, b2OverlapBatchCallback, &query );
+		}
+
+		range->count = taskContext->overlapHits.count - range->start;
+	}
+
+	b2TracyCZoneEnd( overlap_task );
+}
+
+// Run the batch queries in parallel and gather the per worker results in query order
+static int b2OverlapBatch( b2World* world, const b2AABB* aabbs, const b2ShapeProxy* proxies, const b2QueryFilter* filters,
+						   int queryCount, b2OverlapHit* results, int resultCapacity )
 {
-	b2World* world = b2GetWorldFromId( worldId );
 	B2_ASSERT( world->locked == false );
-	if ( world->locked )
+	if ( world->locked || queryCount <= 0 )
 	{
-		return (b2ContactEvents){ 0 };
+		return 0;
 	}
 
-	// Careful to use previous buffer
-	int endEventArrayIndex = 1 - world->endEventArrayIndex;
+	int treeCount = b2GetQueryTreeCount( world );
+	if ( treeCount == 0 )
+	{
+		return 0;
+	}
 
-	int beginCount = world->contactBeginEvents.count;
-	int endCount = world->contactEndEvents[endEventArrayIndex].count;
-	int hitCount = world->contactHitEvents.count;
+	b2TracyCZoneNC( overlap_batch, "Overlap Batch", b2_colorDodgerBlue, true );
 
-	b2ContactEvents events = {
-		.beginEvents = world->contactBeginEvents.data,
-		.endEvents = world->contactEndEvents[endEventArrayIndex].data,
-		.hitEvents = world->contactHitEvents.data,
-		.beginCount = beginCount,
-		.endCount = endCount,
-		.hitCount = hitCount,
-	};
+	// All tasks from the last step are finished so the task slots can be reused
+	world->taskCount = 0;
+	if ( world->scheduler != NULL )
+	{
+		b2ResetScheduler( world->scheduler );
+	}
 
-	return events;
+	for ( int i = 0; i < world->workerCount; ++i )
+	{
+		b2Array_Clear( world->taskContexts.data[i].overlapHits );
+	}
+
+	b2OverlapRange* ranges = b2StackAlloc( &world->stack, queryCount * sizeof( b2OverlapRange ), "overlap ranges" );
+
+	b2OverlapBatchContext context = { world, aabbs, proxies, filters, ranges, treeCount };
+	b2ParallelFor( world, b2OverlapBatchTask, queryCount, 16, &context );
+
+	int hitCount = 0;
+	for ( int i = 0; i < queryCount; ++i )
+	{
+		b2OverlapRange range = ranges[i];
+		int copyCount = b2MinInt( range.count, resultCapacity - hitCount );
+		if ( copyCount > 0 )
+		{
+			const b2OverlapHit* hits = world->taskContexts.data[range.workerIndex].overlapHits.data + range.start;
+			memcpy( results + hitCount, hits, copyCount * sizeof( b2OverlapHit ) );
+		}
+
+		hitCount += range.count;
+	}
+
+	b2StackFree( &world->stack, ranges );
+
+	b2TracyCZoneEnd( overlap_batch );
+
+	return hitCount;
+}
+
+int b2World_OverlapAABBs( b2WorldId worldId, const b2AABB* aabbs, const b2QueryFilter* filters, int queryCount,
+						  b2OverlapHit* results, int resultCapacity )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return b2OverlapBatch( world, aabbs, NULL, filters, queryCount, results, resultCapacity );
+}
+
+int b2World_OverlapShapes( b2WorldId worldId, const b2ShapeProxy* proxies, const b2QueryFilter* filters, int queryCount,
+						   b2OverlapHit* results, int resultCapacity )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return b2OverlapBatch( world, NULL, proxies, filters, queryCount, results, resultCapacity );
 }
 
-b2JointEvents b2World_GetJointEvents( b2WorldId worldId )
+typedef struct WorldRayCastContext
+{
+	b2World* world;
+	b2CastResultFcn* fcn;
+	b2QueryFilter filter;
+	float fraction;
+	void* userContext;
+} WorldRayCastContext;
+
+static float RayCastCallback( const b2RayCastInput* input, int proxyId, uint64_t userData, void* context )
 {
-	b2World* world = b2GetWorldFromId( worldId );
-	B2_ASSERT( world->locked == false );
-	if ( world->locked )
-	{
-		return (b2JointEvents){ 0 };
-	}
+	B2_UNUSED( proxyId );
 
-	int count = world->jointEvents.count;
-	b2JointEvents events = { world->jointEvents.data, count };
-	return events;
-}
+	int shapeId = (int)userData;
 
-bool b2World_IsValid( b2WorldId id )
-{
-	if ( id.index1 < 1 || B2_MAX_WORLDS < id.index1 )
+	WorldRayCastContext* worldContext = context;
+	b2World* world = worldContext->world;
+
+	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+
+	if ( b2ShouldQueryCollide( shape->filter, worldContext->filter ) == false )
 	{
-		return false;
+		return input->maxFraction;
 	}
 
-	b2World* world = b2_worlds + ( id.index1 - 1 );
+	b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
+	b2Transform transform = b2GetQueryTransform( world, body );
+	b2CastOutput output = b2RayCastShape( input, shape, transform );
 
-	if ( world->worldId != id.index1 - 1 )
+	if ( output.hit )
 	{
-		// world is not allocated
-		return false;
+		b2ShapeId id = { shapeId + 1, world->worldId, shape->generation };
+		float fraction = worldContext->fcn( id, output.point, output.normal, output.fraction, worldContext->userContext );
+
+		// The user may return -1 to skip this shape
+		if ( 0.0f <= fraction && fraction <= 1.0f )
+		{
+			worldContext->fraction = fraction;
+		}
+
+		return fraction;
 	}
 
-	return id.generation == world->generation;
+	return input->maxFraction;
 }
 
-bool b2Body_IsValid( b2BodyId id )
+b2TreeStats b2World_CastRay( b2WorldId worldId, b2Vec2 origin, b2Vec2 translation, b2QueryFilter filter, b2CastResultFcn* fcn,
+							 void* context )
 {
-	if ( B2_MAX_WORLDS <= id.world0 )
-	{
-		// invalid world
-		return false;
-	}
+	b2TreeStats treeStats = { 0 };
 
-	b2World* world = b2_worlds + id.world0;
-	if ( world->worldId != id.world0 )
+	b2World* world = b2GetWorldFromId( worldId );
+	int treeCount = b2GetQueryTreeCount( world );
+	if ( treeCount == 0 )
 	{
-		// world is free
-		return false;
+		return treeStats;
 	}
 
-	if ( id.index1 < 1 || world->bodies.count < id.index1 )
-	{
-		// invalid index
-		return false;
-	}
+	B2_ASSERT( b2IsValidVec2( origin ) );
+	B2_ASSERT( b2IsValidVec2( translation ) );
 
-	b2Body* body = world->bodies.data + ( id.index1 - 1 );
-	if ( body->setIndex == B2_NULL_INDEX )
-	{
-		// this was freed
-		return false;
-	}
+	b2RayCastInput input = { origin, translation, 1.0f };
 
-	B2_ASSERT( body->localIndex != B2_NULL_INDEX );
+	WorldRayCastContext worldContext = { world, fcn, filter, 1.0f, context };
 
-	if ( body->generation != id.generation )
+	for ( int i = 0; i < treeCount; ++i )
 	{
-		// this id is orphaned
-		return false;
+		b2TreeStats treeResult =
+			b2DynamicTree_RayCast( world->broadPhase.trees + i, &input, filter.maskBits, RayCastCallback, &worldContext );
+		treeStats.nodeVisits += treeResult.nodeVisits;
+		treeStats.leafVisits += treeResult.leafVisits;
+
+		if ( worldContext.fraction == 0.0f )
+		{
+			return treeStats;
+		}
+
+		input.maxFraction = worldContext.fraction;
 	}
 
-	return true;
+	return treeStats;
 }
 
-bool b2Shape_IsValid( b2ShapeId id )
+// This callback finds the closest hit. This is the most common callback used in games.
+static float b2RayCastClosestFcn( b2ShapeId shapeId, b2Vec2 point, b2Vec2 normal, float fraction, void* context )
 {
-	if ( B2_MAX_WORLDS <= id.world0 )
+	// Ignore initial overlap
+	if ( fraction == 0.0f )
 	{
-		return false;
+		return -1.0f;
 	}
 
-	b2World* world = b2_worlds + id.world0;
-	if ( world->worldId != id.world0 )
-	{
-		// world is free
-		return false;
-	}
+	b2RayResult* rayResult = (b2RayResult*)context;
+	rayResult->shapeId = shapeId;
+	rayResult->point = point;
+	rayResult->normal = normal;
+	rayResult->fraction = fraction;
+	rayResult->hit = true;
+	return fraction;
+}
 
-	int shapeId = id.index1 - 1;
-	if ( shapeId < 0 || world->shapes.count <= shapeId )
+// Grid spacing used to match the end points of cached rays
+#define B2_RAY_CACHE_CELL ( 0.5f * b2GetLengthUnitsPerMeter() )
+
+// Find the closest static hit using the ray cache and store it in the cache
+static void b2CastRayStaticCached( b2World* world, b2RayCastInput* input, WorldRayCastContext* worldContext,
+											   b2RayResult* result )
+{
+	b2Vec2 origin = input->origin;
+	b2Vec2 end = b2Add( origin, input->translation );
+	float inverseCell = 1.0f / B2_RAY_CACHE_CELL;
+	int key[4] = {
+		(int)floorf( inverseCell * origin.x ),
+		(int)floorf( inverseCell * origin.y ),
+		(int)floorf( inverseCell * end.x ),
+		(int)floorf( inverseCell * end.y ),
+	};
+
+	uint32_t hash = b2Hash( B2_HASH_INIT, (const uint8_t*)key, sizeof( key ) );
+	b2RayCacheEntry* entry = world->rayCache + ( hash & ( world->rayCacheCapacity - 1 ) );
+
+	b2QueryFilter filter = worldContext->filter;
+	bool match = entry->valid && entry->staticRevision == world->broadPhase.staticRevision &&
+				 memcmp( entry->key, key, sizeof( key ) ) == 0 && entry->filter.categoryBits == filter.categoryBits &&
+				 entry->filter.maskBits == filter.maskBits;
+
+	bool sameRay = entry->origin.x == origin.x && entry->origin.y == origin.y && entry->translation.x == input->translation.x &&
+				   entry->translation.y == input->translation.y;
+
+	if ( match && sameRay )
 	{
-		return false;
+		// Same ray against unchanged static shapes
+		if ( B2_IS_NON_NULL( entry->shapeId ) )
+		{
+			result->shapeId = entry->shapeId;
+			result->point = entry->point;
+			result->normal = entry->normal;
+			result->fraction = entry->fraction;
+			result->hit = true;
+			worldContext->fraction = entry->fraction;
+			input->maxFraction = entry->fraction;
+		}
+
+		return;
 	}
 
-	b2Shape* shape = world->shapes.data + shapeId;
-	if ( shape->id == B2_NULL_INDEX )
+	if ( match && B2_IS_NON_NULL( entry->shapeId ) )
 	{
-		// shape is free
-		return false;
+		// The previous hit is likely hit again. Casting against it first shortens the ray before the
+		// tree traversal.
+		b2Shape* shape = b2Array_Get( world->shapes, entry->shapeId.index1 - 1 );
+		b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
+		b2CastOutput output = b2RayCastShape( input, shape, b2GetQueryTransform( world, body ) );
+		if ( output.hit && output.fraction > 0.0f )
+		{
+			b2RayCastClosestFcn( entry->shapeId, output.point, output.normal, output.fraction, result );
+			worldContext->fraction = output.fraction;
+			input->maxFraction = output.fraction;
+		}
 	}
 
-	B2_ASSERT( shape->id == shapeId );
-
-	return id.generation == shape->generation;
+	b2TreeStats treeResult =
+		b2DynamicTree_RayCast( world->broadPhase.trees + b2_staticBody, input, filter.maskBits, RayCastCallback, worldContext );
+	result->nodeVisits += treeResult.nodeVisits;
+	result->leafVisits += treeResult.leafVisits;
+
+	memcpy( entry->key, key, sizeof( key ) );
+	entry->filter = filter;
+	entry->staticRevision = world->broadPhase.staticRevision;
+	entry->valid = true;
+	entry->origin = input->origin;
+	entry->translation = input->translation;
+	entry->shapeId = result->hit ? result->shapeId : b2_nullShapeId;
+	entry->point = result->point;
+	entry->normal = result->normal;
+	entry->fraction = result->fraction;
 }
 
-bool b2Chain_IsValid( b2ChainId id )
+b2RayResult b2World_CastRayClosest( b2WorldId worldId, b2Vec2 origin, b2Vec2 translation, b2QueryFilter filter )
 {
-	if ( B2_MAX_WORLDS <= id.world0 )
-	{
-		return false;
-	}
+	b2RayResult result = { 0 };
 
-	b2World* world = b2_worlds + id.world0;
-	if ( world->worldId != id.world0 )
+	b2World* world = b2GetWorldFromId( worldId );
+	int treeCount = b2GetQueryTreeCount( world );
+	if ( treeCount == 0 )
 	{
-		// world is free
-		return false;
+		return result;
 	}
 
-	int chainId = id.index1 - 1;
-	if ( chainId < 0 || world->chainShapes.count <= chainId )
+	B2_ASSERT( b2IsValidVec2( origin ) );
+	B2_ASSERT( b2IsValidVec2( translation ) );
+
+	b2RayCastInput input = { origin, translation, 1.0f };
+	WorldRayCastContext worldContext = { world, b2RayCastClosestFcn, filter, 1.0f, &result };
+
+	int firstTree = 0;
+	if ( world->rayCache != NULL )
 	{
-		return false;
+		b2CastRayStaticCached( world, &input, &worldContext, &result );
+		firstTree = 1;
+
+		if ( worldContext.fraction == 0.0f )
+		{
+			return result;
+		}
 	}
 
-	b2ChainShape* chain = world->chainShapes.data + chainId;
-	if ( chain->id == B2_NULL_INDEX )
+	for ( int i = firstTree; i < treeCount; ++i )
 	{
-		// chain is free
-		return false;
-	}
+		b2TreeStats treeResult =
+			b2DynamicTree_RayCast( world->broadPhase.trees + i, &input, filter.maskBits, RayCastCallback, &worldContext );
+		result.nodeVisits += treeResult.nodeVisits;
+		result.leafVisits += treeResult.leafVisits;
 
-	B2_ASSERT( chain->id == chainId );
+		if ( worldContext.fraction == 0.0f )
+		{
+			return result;
+		}
 
-	return id.generation == chain->generation;
+		input.maxFraction = worldContext.fraction;
+	}
+
+	return result;
 }
 
-bool b2Joint_IsValid( b2JointId id )
+typedef struct b2CastRaysContext
 {
-	if ( B2_MAX_WORLDS <= id.world0 )
-	{
-		return false;
-	}
+	b2World* world;
+	const b2Vec2* origins;
+	const b2Vec2* translations;
+	int rayCount;
+	int treeCount;
+	b2QueryFilter filter;
+	b2RayResult* results;
+} b2CastRaysContext;
 
-	b2World* world = b2_worlds + id.world0;
-	if ( world->worldId != id.world0 )
-	{
-		// world is free
-		return false;
-	}
+typedef struct b2RayPacketContext
+{
+	b2World* world;
+	b2QueryFilter filter;
+	b2RayResult* results;
+} b2RayPacketContext;
 
-	int jointId = id.index1 - 1;
-	if ( jointId < 0 || world->joints.count <= jointId )
+// Same as RayCastCallback with b2RayCastClosestFcn
+static float b2RayPacketClosestCallback( const b2RayCastInput* input, int rayIndex, int proxyId, uint64_t userData,
+										 void* context )
+{
+	B2_UNUSED( proxyId );
+
+	int shapeId = (int)userData;
+
+	b2RayPacketContext* packetContext = context;
+	b2World* world = packetContext->world;
+	b2RayResult* result = packetContext->results + rayIndex;
+	result->leafVisits += 1;
+
+	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+
+	if ( b2ShouldQueryCollide( shape->filter, packetContext->filter ) == false )
 	{
-		return false;
+		return input->maxFraction;
 	}
 
-	b2Joint* joint = world->joints.data + jointId;
-	if ( joint->jointId == B2_NULL_INDEX )
+	b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
+	b2Transform transform = b2GetQueryTransform( world, body );
+	b2CastOutput output = b2RayCastShape( input, shape, transform );
+
+	// Ignore initial overlap
+	if ( output.hit == false || output.fraction == 0.0f )
 	{
-		// joint is free
-		return false;
+		return output.hit ? -1.0f : input->maxFraction;
 	}
 
-	B2_ASSERT( joint->jointId == jointId );
-
-	return id.generation == joint->generation;
+	result->shapeId = ( b2ShapeId ){ shapeId + 1, world->worldId, shape->generation };
+	result->point = output.point;
+	result->normal = output.normal;
+	result->fraction = output.fraction;
+	result->hit = true;
+	return output.fraction;
 }
 
-bool b2Contact_IsValid( b2ContactId id )
+static void b2CastRaysTask( int startIndex, int endIndex, int workerIndex, void* context )
 {
-	if ( B2_MAX_WORLDS <= id.world0 )
-	{
-		return false;
-	}
+	b2TracyCZoneNC( cast_rays, "Cast Rays", b2_colorDodgerBlue, true );
 
-	b2World* world = b2_worlds + id.world0;
-	if ( world->worldId != id.world0 )
-	{
-		// world is free
-		return false;
-	}
+	B2_UNUSED( workerIndex );
 
-	int contactId = id.index1 - 1;
-	if ( contactId < 0 || world->contacts.count <= contactId )
-	{
-		return false;
-	}
+	b2CastRaysContext* castContext = context;
+	b2World* world = castContext->world;
 
-	b2Contact* contact = world->contacts.data + contactId;
-	if ( contact->contactId == B2_NULL_INDEX )
+	for ( int packetIndex = startIndex; packetIndex < endIndex; ++packetIndex )
 	{
-		// contact is free
-		return false;
+		int baseIndex = B2_RAY_PACKET_SIZE * packetIndex;
+		int rayCount = b2MinInt( B2_RAY_PACKET_SIZE, castContext->rayCount - baseIndex );
+
+		b2RayCastInput inputs[B2_RAY_PACKET_SIZE];
+		b2RayResult* results = castContext->results + baseIndex;
+		for ( int i = 0; i < rayCount; ++i )
+		{
+			B2_ASSERT( b2IsValidVec2( castContext->origins[baseIndex + i] ) );
+			B2_ASSERT( b2IsValidVec2( castContext->translations[baseIndex + i] ) );
+
+			inputs[i] = ( b2RayCastInput ){ castContext->origins[baseIndex + i], castContext->translations[baseIndex + i], 1.0f };
+			results[i] = ( b2RayResult ){ 0 };
+		}
+
+		b2RayPacketContext packetContext = { world, castContext->filter, results };
+
+		for ( int treeIndex = 0; treeIndex < castContext->treeCount; ++treeIndex )
+		{
+			b2TreeStats treeResult = b2DynamicTree_RayCastPacket( world->broadPhase.trees + treeIndex, inputs, rayCount,
+																  castContext->filter.maskBits,
+																  b2RayPacketClosestCallback, &packetContext );
+
+			for ( int i = 0; i < rayCount; ++i )
+			{
+				results[i].nodeVisits += treeResult.nodeVisits;
+				if ( results[i].hit )
+				{
+					inputs[i].maxFraction = results[i].fraction;
+				}
+			}
+		}
 	}
 
-	B2_ASSERT( contact->contactId == contactId );
-
-	return id.generation == contact->generation;
+	b2TracyCZoneEnd( cast_rays );
 }
 
-void b2World_EnableSleeping( b2WorldId worldId, bool flag )
+void b2World_CastRaysClosest( b2WorldId worldId, const b2Vec2* origins, const b2Vec2* translations, int count,
+							  b2QueryFilter filter, b2RayResult* results )
 {
 	b2World* world = b2GetWorldFromId( worldId );
 	B2_ASSERT( world->locked == false );
-	if ( world->locked )
+	if ( world->locked || count <= 0 )
 	{
 		return;
 	}
 
-	if ( flag == world->enableSleep )
+	int treeCount = b2GetQueryTreeCount( world );
+	if ( treeCount == 0 )
 	{
+		memset( results, 0, count * sizeof( b2RayResult ) );
 		return;
 	}
 
-	world->enableSleep = flag;
+	b2TracyCZoneNC( cast_rays_closest, "Cast Rays Closest", b2_colorDodgerBlue, true );
 
-	if ( flag == false )
+	// All tasks from the last step are finished so the task slots can be reused
+	world->taskCount = 0;
+	if ( world->scheduler != NULL )
 	{
-		int setCount = world->solverSets.count;
-		for ( int i = b2_firstSleepingSet; i < setCount; ++i )
-		{
-			b2SolverSet* set = b2Array_Get( world->solverSets, i );
-			if ( set->bodySims.count > 0 )
-			{
-				b2WakeSolverSet( world, i );
-			}
-		}
+		b2ResetScheduler( world->scheduler );
 	}
-}
 
-bool b2World_IsSleepingEnabled( b2WorldId worldId )
-{
-	b2World* world = b2GetWorldFromId( worldId );
-	return world->enableSleep;
+	b2CastRaysContext context = { world, origins, translations, count, treeCount, filter, results };
+	int packetCount = ( count + B2_RAY_PACKET_SIZE - 1 ) / B2_RAY_PACKET_SIZE;
+	b2ParallelFor( world, b2CastRaysTask, packetCount, 16, &context );
+
+	b2TracyCZoneEnd( cast_rays_closest );
 }
 
-void b2World_EnableWarmStarting( b2WorldId worldId, bool flag )
+static float ShapeCastCallback( const b2ShapeCastInput* input, int proxyId, uint64_t userData, void* context )
 {
-	b2World* world = b2GetWorldFromId( worldId );
-	B2_ASSERT( world->locked == false );
-	if ( world->locked )
-	{
-		return;
-	}
+	B2_UNUSED( proxyId );
 
-	world->enableWarmStarting = flag;
-}
+	int shapeId = (int)userData;
 
-bool b2World_IsWarmStartingEnabled( b2WorldId worldId )
-{
-	b2World* world = b2GetWorldFromId( worldId );
-	return world->enableWarmStarting;
-}
+	WorldRayCastContext* worldContext = context;
+	b2World* world = worldContext->world;
 
-int b2World_GetAwakeBodyCount( b2WorldId worldId )
-{
-	b2World* world = b2GetWorldFromId( worldId );
-	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
-	return awakeSet->bodySims.count;
-}
+	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
 
-void b2World_EnableContinuous( b2WorldId worldId, bool flag )
-{
-	b2World* world = b2GetWorldFromId( worldId );
-	B2_ASSERT( world->locked == false );
-	if ( world->locked )
+	if ( b2ShouldQueryCollide( shape->filter, worldContext->filter ) == false )
 	{
-		return;
+		return input->maxFraction;
 	}
 
-	world->enableContinuous = flag;
-}
+	b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
+	b2Transform transform = b2GetQueryTransform( world, body );
 
-bool b2World_IsContinuousEnabled( b2WorldId worldId )
-{
-	b2World* world = b2GetWorldFromId( worldId );
-	return world->enableContinuous;
-}
+	b2CastOutput output = b2ShapeCastShape( input, shape, transform );
 
-void b2World_SetRestitutionThreshold( b2WorldId worldId, float value )
-{
-	b2World* world = b2GetWorldFromId( worldId );
-	B2_ASSERT( world->locked == false );
-	if ( world->locked )
+	if ( output.hit )
 	{
-		return;
+		b2ShapeId id = { shapeId + 1, world->worldId, shape->generation };
+		float fraction = worldContext->fcn( id, output.point, output.normal, output.fraction, worldContext->userContext );
+
+		// The user may return -1 to skip this shape
+		if ( 0.0f <= fraction && fraction <= 1.0f )
+		{
+			worldContext->fraction = fraction;
+		}
+
+		return fraction;
 	}
 
-	world->restitutionThreshold = b2ClampFloat( value, 0.0f, FLT_MAX );
+	return input->maxFraction;
 }
 
-float b2World_GetRestitutionThreshold( b2WorldId worldId )
+b2TreeStats b2World_CastShape( b2WorldId worldId, const b2ShapeProxy* proxy, b2Vec2 translation, b2QueryFilter filter,
+							   b2CastResultFcn* fcn, void* context )
 {
-	b2World* world = b2GetWorldFromId( worldId );
-	return world->restitutionThreshold;
-}
+	b2TreeStats treeStats = { 0 };
 
-void b2World_SetHitEventThreshold( b2WorldId worldId, float value )
-{
 	b2World* world = b2GetWorldFromId( worldId );
-	B2_ASSERT( world->locked == false );
-	if ( world->locked )
+	int treeCount = b2GetQueryTreeCount( world );
+	if ( treeCount == 0 )
 	{
-		return;
+		return treeStats;
 	}
 
-	world->hitEventThreshold = b2ClampFloat( value, 0.0f, FLT_MAX );
-}
+	B2_ASSERT( b2IsValidVec2( translation ) );
 
-float b2World_GetHitEventThreshold( b2WorldId worldId )
-{
-	b2World* world = b2GetWorldFromId( worldId );
-	return world->hitEventThreshold;
-}
+	b2ShapeCastInput input = { 0 };
+	input.proxy = *proxy;
+	input.translation = translation;
+	input.maxFraction = 1.0f;
 
-void b2World_SetContactTuning( b2WorldId worldId, float hertz, float dampingRatio, float pushSpeed )
-{
-	b2World* world = b2GetWorldFromId( worldId );
-	B2_ASSERT( world->locked == false );
-	if ( world->locked )
+	WorldRayCastContext worldContext = { world, fcn, filter, 1.0f, context };
+
+	for ( int i = 0; i < treeCount; ++i )
 	{
-		return;
-	}
+		b2TreeStats treeResult =
+			b2DynamicTree_ShapeCast( world->broadPhase.trees + i, &input, filter.maskBits, ShapeCastCallback, &worldContext );
+		treeStats.nodeVisits += treeResult.nodeVisits;
+		treeStats.leafVisits += treeResult.leafVisits;
 
-	world->contactHertz = b2ClampFloat( hertz, 0.0f, FLT_MAX );
-	world->contactDampingRatio = b2ClampFloat( dampingRatio, 0.0f, FLT_MAX );
-	world->contactSpeed = b2ClampFloat( pushSpeed, 0.0f, FLT_MAX );
-}
+		if ( worldContext.fraction == 0.0f )
+		{
+			return treeStats;
+		}
 
-void b2World_SetContactRecycleDistance( b2WorldId worldId, float recycleDistance )
-{
-	b2World* world = b2GetWorldFromId( worldId );
-	B2_ASSERT( world->locked == false );
-	if ( world->locked )
-	{
-		return;
+		input.maxFraction = worldContext.fraction;
 	}
 
-	world->contactRecycleDistance = b2ClampFloat( recycleDistance, 0.0f, FLT_MAX );
+	return treeStats;
 }
 
-float b2World_GetContactRecycleDistance( b2WorldId worldId )
+typedef struct b2CastShapesContext
 {
-	b2World* world = b2GetWorldFromId( worldId );
-	return world->contactRecycleDistance;
-}
+	b2World* world;
+	const b2ShapeProxy* proxies;
+	const b2Vec2* translations;
+	const int* order;
+	int treeCount;
+	b2QueryFilter filter;
+	b2RayResult* results;
+} b2CastShapesContext;
 
-void b2World_SetMaximumLinearSpeed( b2WorldId worldId, float maximumLinearSpeed )
+typedef struct b2SweepKey
 {
-	B2_ASSERT( b2IsValidFloat( maximumLinearSpeed ) && maximumLinearSpeed > 0.0f );
+	uint32_t key;
+	int index;
+} b2SweepKey;
 
-	b2World* world = b2GetWorldFromId( worldId );
-	B2_ASSERT( world->locked == false );
-	if ( world->locked )
+static int b2CompareSweepKeys( const void* a, const void* b )
+{
+	const b2SweepKey* keyA = a;
+	const b2SweepKey* keyB = b;
+	if ( keyA->key != keyB->key )
 	{
-		return;
+		return keyA->key < keyB->key ? -1 : 1;
 	}
 
-	world->maxLinearSpeed = maximumLinearSpeed;
+	return keyA->index < keyB->index ? -1 : ( keyA->index > keyB->index ? 1 : 0 );
 }
 
-float b2World_GetMaximumLinearSpeed( b2WorldId worldId )
+static b2Vec2 b2GetSweepCenter( const b2ShapeProxy* proxy, b2Vec2 translation )
 {
-	b2World* world = b2GetWorldFromId( worldId );
-	return world->maxLinearSpeed;
-}
+	b2Vec2 center = proxy->points[0];
+	for ( int i = 1; i < proxy->count; ++i )
+	{
+		center = b2Add( center, proxy->points[i] );
+	}
 
-b2Profile b2World_GetProfile( b2WorldId worldId )
-{
-	b2World* world = b2GetWorldFromId( worldId );
-	return world->profile;
+	center = b2MulSV( 1.0f / proxy->count, center );
+	return b2MulAdd( center, 0.5f, translation );
 }
 
-b2Counters b2World_GetCounters( b2WorldId worldId )
+// Same as b2World_CastShape with b2RayCastClosestFcn
+static void b2CastShapesTask( int startIndex, int endIndex, int workerIndex, void* context )
 {
-	b2World* world = b2GetWorldFromId( worldId );
-	b2Counters s = { 0 };
-	s.bodyCount = b2GetIdCount( &world->bodyIdPool );
-	s.shapeCount = b2GetIdCount( &world->shapeIdPool );
-	s.contactCount = b2GetIdCount( &world->contactIdPool );
-	s.jointCount = b2GetIdCount( &world->jointIdPool );
-	s.islandCount = b2GetIdCount( &world->islandIdPool );
-
-	b2DynamicTree* staticTree = world->broadPhase.trees + b2_staticBody;
-	s.staticTreeHeight = b2DynamicTree_GetHeight( staticTree );
+	b2TracyCZoneNC( cast_shapes, "Cast Shapes", b2_colorDodgerBlue, true );
 
-	b2DynamicTree* dynamicTree = world->broadPhase.trees + b2_dynamicBody;
-	b2DynamicTree* kinematicTree = world->broadPhase.trees + b2_kinematicBody;
-	s.treeHeight = b2MaxInt( b2DynamicTree_GetHeight( dynamicTree ), b2DynamicTree_GetHeight( kinematicTree ) );
+	B2_UNUSED( workerIndex );
 
-	s.stackUsed = b2GetMaxStackAllocation( &world->stack );
-	s.byteCount = b2GetByteCount();
-	s.taskCount = world->taskCount;
+	b2CastShapesContext* castContext = context;
+	b2World* world = castContext->world;
 
-	s.recycledContactCount = 0;
-	for ( int i = 0; i < world->workerCount; ++i )
+	for ( int i = startIndex; i < endIndex; ++i )
 	{
-		s.recycledContactCount += world->taskContexts.data[i].recycledContactCount;
-	}
+		int index = castContext->order != NULL ? castContext->order[i] : i;
+		B2_ASSERT( b2IsValidVec2( castContext->translations[index] ) );
 
-	s.awakeContactCount = 0;
-	for ( int i = 0; i < B2_GRAPH_COLOR_COUNT; ++i )
-	{
-		b2GraphColor* color = world->constraintGraph.colors + i;
-		s.colorCounts[i] = color->contactSims.count + color->jointSims.count;
-		s.awakeContactCount += color->contactSims.count;
-	}
-	s.awakeContactCount += world->solverSets.data[b2_awakeSet].contactSims.count;
+		b2ShapeCastInput input = { 0 };
+		input.proxy = castContext->proxies[index];
+		input.translation = castContext->translations[index];
+		input.maxFraction = 1.0f;
 
-	return s;
-}
+		b2RayResult* result = castContext->results + index;
+		*result = ( b2RayResult ){ 0 };
 
-b2Capacity b2World_GetMaxCapacity( b2WorldId worldId )
-{
-	b2World* world = b2GetWorldFromId( worldId );
-	return world->maxCapacity;
-}
+		WorldRayCastContext worldContext = { world, b2RayCastClosestFcn, castContext->filter, 1.0f, result };
 
-void b2World_SetUserData( b2WorldId worldId, void* userData )
-{
-	b2World* world = b2GetWorldFromId( worldId );
-	world->userData = userData;
-}
+		for ( int treeIndex = 0; treeIndex < castContext->treeCount; ++treeIndex )
+		{
+			b2TreeStats treeResult = b2DynamicTree_ShapeCast( world->broadPhase.trees + treeIndex, &input,
+															  castContext->filter.maskBits, ShapeCastCallback, &worldContext );
+			result->nodeVisits += treeResult.nodeVisits;
+			result->leafVisits += treeResult.leafVisits;
 
-void* b2World_GetUserData( b2WorldId worldId )
-{
-	b2World* world = b2GetWorldFromId( worldId );
-	return world->userData;
-}
+			if ( worldContext.fraction == 0.0f )
+			{
+				break;
+			}
 
-void b2World_SetFrictionCallback( b2WorldId worldId, b2FrictionCallback* callback )
-{
-	b2World* world = b2GetWorldFromId( worldId );
-	if ( world->locked )
-	{
-		return;
+			input.maxFraction = worldContext.fraction;
+		}
 	}
 
-	if ( callback != NULL )
-	{
-		world->frictionCallback = callback;
-	}
-	else
-	{
-		world->frictionCallback = b2DefaultFrictionCallback;
-	}
+	b2TracyCZoneEnd( cast_shapes );
 }
 
-void b2World_SetRestitutionCallback( b2WorldId worldId, b2RestitutionCallback* callback )
+// Below this many sweeps the sort costs more than the traversal coherence saves
+#define B2_SORT_SWEEP_COUNT 64
+
+void b2World_CastShapesClosest( b2WorldId worldId, const b2ShapeProxy* proxies, const b2Vec2* translations, int count,
+								b2QueryFilter filter, b2RayResult* results )
 {
 	b2World* world = b2GetWorldFromId( worldId );
-	if ( world->locked )
+	B2_ASSERT( world->locked == false );
+	if ( world->locked || count <= 0 )
 	{
 		return;
 	}
 
-	if ( callback != NULL )
-	{
-		world->restitutionCallback = callback;
-	}
-	else
+	int treeCount = b2GetQueryTreeCount( world );
+	if ( treeCount == 0 )
 	{
-		world->restitutionCallback = b2DefaultRestitutionCallback;
+		memset( results, 0, count * sizeof( b2RayResult ) );
+		return;
 	}
-}
 
-void b2World_SetWorkerCount( b2WorldId worldId, int count )
-{
-	b2World* world = b3GetUnlockedWorldFromId( worldId );
-	if ( world == NULL )
+	b2TracyCZoneNC( cast_shapes_closest, "Cast Shapes Closest", b2_colorDodgerBlue, true );
+
+	// Sort the sweeps along a Morton curve so neighboring sweeps on a worker visit the same tree nodes
+	int* order = NULL;
+	if ( count >= B2_SORT_SWEEP_COUNT )
 	{
-		return;
+		b2SweepKey* keys = b2StackAlloc( &world->stack, count * sizeof( b2SweepKey ), "sweep keys" );
+		b2AABB bounds = { { FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX } };
+		for ( int i = 0; i < count; ++i )
+		{
+			b2Vec2 center = b2GetSweepCenter( proxies + i, translations[i] );
+			bounds.lowerBound = b2Min( bounds.lowerBound, center );
+			bounds.upperBound = b2Max( bounds.upperBound, center );
+		}
+
+		b2Vec2 extent = b2Sub( bounds.upperBound, bounds.lowerBound );
+		float scaleX = extent.x > 0.0f ? 65535.0f / extent.x : 0.0f;
+		float scaleY = extent.y > 0.0f ? 65535.0f / extent.y : 0.0f;
+		for ( int i = 0; i < count; ++i )
+		{
+			b2Vec2 center = b2Sub( b2GetSweepCenter( proxies + i, translations[i] ), bounds.lowerBound );
+			uint32_t x = (uint32_t)( scaleX * center.x );
+			uint32_t y = (uint32_t)( scaleY * center.y );
+			keys[i] = ( b2SweepKey ){ b2SpreadBits( x ) | ( b2SpreadBits( y ) << 1 ), i };
+		}
+
+		qsort( keys, count, sizeof( b2SweepKey ), b2CompareSweepKeys );
+
+		// Each index is read before its slot is overwritten so the order is written in place
+		order = (int*)keys;
+		for ( int i = 0; i < count; ++i )
+		{
+			order[i] = keys[i].index;
+		}
 	}
 
-	if ( count == world->workerCount )
+	// All tasks from the last step are finished so the task slots can be reused
+	world->taskCount = 0;
+	if ( world->scheduler != NULL )
 	{
-		return;
+		b2ResetScheduler( world->scheduler );
 	}
 
-	b2DestroyWorkerContexts( world );
-	world->workerCount = b2ClampInt( count, 1, B2_MAX_WORKERS );
-	b2CreateWorkerContexts( world );
-}
+	b2CastShapesContext context = { world, proxies, translations, order, treeCount, filter, results };
+	b2ParallelFor( world, b2CastShapesTask, count, 16, &context );
 
-int b2World_GetWorkerCount( b2WorldId worldId )
-{
-	b2World* world = b3GetUnlockedWorldFromId( worldId );
-	if ( world == NULL )
+	if ( order != NULL )
 	{
-		return 0;
+		b2StackFree( &world->stack, order );
 	}
 
-	return world->workerCount;
+	b2TracyCZoneEnd( cast_shapes_closest );
 }
 
-void b2World_DumpMemoryStats( b2WorldId worldId )
+typedef struct b2MoverContext
 {
-	FILE* file = fopen( "box2d_memory.txt", "w" );
-	if ( file == NULL )
+	b2World* world;
+	b2QueryFilter filter;
+	b2ShapeProxy proxy;
+	b2Transform transform;
+	void* userContext;
+} b2CharacterCallbackContext;
+
+typedef struct WorldMoverCastContext
+{
+	b2World* world;
+	b2QueryFilter filter;
+	float fraction;
+} WorldMoverCastContext;
+
+static float MoverCastCallback( const b2ShapeCastInput* input, int proxyId, uint64_t userData, void* context )
+{
+	B2_UNUSED( proxyId );
+
+	int shapeId = (int)userData;
+	WorldMoverCastContext* worldContext = context;
+	b2World* world = worldContext->world;
+
+	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+
+	if ( b2ShouldQueryCollide( shape->filter, worldContext->filter ) == false )
 	{
-		return;
+		return worldContext->fraction;
 	}
 
-	b2World* world = b2GetWorldFromId( worldId );
+	b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
+	b2Transform transform = b2GetQueryTransform( world, body );
 
-	// id pools
-	fprintf( file, "id pools\n" );
-	fprintf( file, "body ids: %d\n", b2GetIdBytes( &world->bodyIdPool ) );
-	fprintf( file, "solver set ids: %d\n", b2GetIdBytes( &world->solverSetIdPool ) );
-	fprintf( file, "joint ids: %d\n", b2GetIdBytes( &world->jointIdPool ) );
-	fprintf( file, "contact ids: %d\n", b2GetIdBytes( &world->contactIdPool ) );
-	fprintf( file, "island ids: %d\n", b2GetIdBytes( &world->islandIdPool ) );
-	fprintf( file, "shape ids: %d\n", b2GetIdBytes( &world->shapeIdPool ) );
-	fprintf( file, "chain ids: %d\n", b2GetIdBytes( &world->chainIdPool ) );
-	fprintf( file, "\n" );
+	b2CastOutput output = b2ShapeCastShape( input, shape, transform );
+	if ( output.fraction == 0.0f )
+	{
+		// Ignore overlapping shapes
+		return worldContext->fraction;
+	}
 
-	// world arrays
-	fprintf( file, "world arrays\n" );
-	fprintf( file, "bodies: %d\n", b2Array_ByteCount( world->bodies ) );
-	fprintf( file, "solver sets: %d\n", b2Array_ByteCount( world->solverSets ) );
-	fprintf( file, "joints: %d\n", b2Array_ByteCount( world->joints ) );
-	fprintf( file, "contacts: %d\n", b2Array_ByteCount( world->contacts ) );
-	// todo account for body/contact/joint arrays in island
-	fprintf( file, "islands: %d\n", world->islands.capacity * (int)sizeof( b2Island ) );
-	fprintf( file, "shapes: %d\n", b2Array_ByteCount( world->shapes ) );
-	fprintf( file, "chains: %d\n", b2Array_ByteCount( world->chainShapes ) );
-	fprintf( file, "\n" );
+	worldContext->fraction = output.fraction;
+	return output.fraction;
+}
 
-	// broad-phase
-	fprintf( file, "broad-phase\n" );
-	fprintf( file, "static tree: %d\n", b2DynamicTree_GetByteCount( world->broadPhase.trees + b2_staticBody ) );
-	fprintf( file, "kinematic tree: %d\n", b2DynamicTree_GetByteCount( world->broadPhase.trees + b2_kinematicBody ) );
-	fprintf( file, "dynamic tree: %d\n", b2DynamicTree_GetByteCount( world->broadPhase.trees + b2_dynamicBody ) );
-	b2HashSet* moveSet = &world->broadPhase.moveSet;
-	fprintf( file, "moveSet: %d (%u, %u)\n", b2GetHashSetBytes( moveSet ), moveSet->count, moveSet->capacity );
-	fprintf( file, "moveArray: %d\n", b2Array_ByteCount( world->broadPhase.moveArray ) );
-	b2HashSet* pairSet = &world->broadPhase.pairSet;
-	fprintf( file, "pairSet: %d (%u, %u)\n", b2GetHashSetBytes( pairSet ), pairSet->count, pairSet->capacity );
-	fprintf( file, "\n" );
+static float b2CastMoverInternal( b2World* world, int treeCount, const b2Capsule* mover, b2Vec2 translation,
+								  b2QueryFilter filter )
+{
+	b2ShapeCastInput input = { 0 };
+	input.proxy.points[0] = mover->center1;
+	input.proxy.points[1] = mover->center2;
+	input.proxy.count = 2;
+	input.proxy.radius = mover->radius;
+	input.translation = translation;
+	input.maxFraction = 1.0f;
+	input.canEncroach = true;
 
-	// solver sets
-	int bodySimCapacity = 0;
-	int bodyStateCapacity = 0;
-	int jointSimCapacity = 0;
-	int contactSimCapacity = 0;
-	int islandSimCapacity = 0;
-	int solverSetCapacity = world->solverSets.count;
-	for ( int i = 0; i < solverSetCapacity; ++i )
+	WorldMoverCastContext worldContext = { world, filter, 1.0f };
+
+	for ( int i = 0; i < treeCount; ++i )
 	{
-		b2SolverSet* set = world->solverSets.data + i;
-		if ( set->setIndex == B2_NULL_INDEX )
+		b2DynamicTree_ShapeCast( world->broadPhase.trees + i, &input, filter.maskBits, MoverCastCallback, &worldContext );
+
+		if ( worldContext.fraction == 0.0f )
 		{
-			continue;
+			return 0.0f;
 		}
 
-		bodySimCapacity += set->bodySims.capacity;
-		bodyStateCapacity += set->bodyStates.capacity;
-		jointSimCapacity += set->jointSims.capacity;
-		contactSimCapacity += set->contactSims.capacity;
-		islandSimCapacity += set->islandSims.capacity;
+		input.maxFraction = worldContext.fraction;
 	}
 
-	fprintf( file, "solver sets\n" );
-	fprintf( file, "body sim: %d\n", bodySimCapacity * (int)sizeof( b2BodySim ) );
-	fprintf( file, "body state: %d\n", bodyStateCapacity * (int)sizeof( b2BodyState ) );
-	fprintf( file, "joint sim: %d\n", jointSimCapacity * (int)sizeof( b2JointSim ) );
-	fprintf( file, "contact sim: %d\n", contactSimCapacity * (int)sizeof( b2ContactSim ) );
-	fprintf( file, "island sim: %d\n", islandSimCapacity * (int)sizeof( islandSimCapacity ) );
-	fprintf( file, "\n" );
+	return worldContext.fraction;
+}
 
-	// constraint graph
-	int bodyBitSetBytes = 0;
-	contactSimCapacity = 0;
-	jointSimCapacity = 0;
-	for ( int i = 0; i < B2_GRAPH_COLOR_COUNT; ++i )
+float b2World_CastMover( b2WorldId worldId, const b2Capsule* mover, b2Vec2 translation, b2QueryFilter filter )
+{
+	B2_ASSERT( b2IsValidVec2( translation ) );
+	B2_ASSERT( mover->radius > 2.0f * B2_LINEAR_SLOP );
+
+	b2World* world = b2GetWorldFromId( worldId );
+	int treeCount = b2GetQueryTreeCount( world );
+	if ( treeCount == 0 )
 	{
-		b2GraphColor* c = world->constraintGraph.colors + i;
-		bodyBitSetBytes += b2GetBitSetBytes( &c->bodySet );
-		contactSimCapacity += c->contactSims.capacity;
-		jointSimCapacity += c->jointSims.capacity;
+		return 1.0f;
 	}
 
-	fprintf( file, "constraint graph\n" );
-	fprintf( file, "body bit sets: %d\n", bodyBitSetBytes );
-	fprintf( file, "joint sim: %d\n", jointSimCapacity * (int)sizeof( b2JointSim ) );
-	fprintf( file, "contact sim: %d\n", contactSimCapacity * (int)sizeof( b2ContactSim ) );
-	fprintf( file, "\n" );
-
-	// stack allocator
-	fprintf( file, "stack allocator: %d\n\n", world->stack.capacity );
-
-	// chain shapes
-	// todo
-
-	fclose( file );
+	return b2CastMoverInternal( world, treeCount, mover, translation, filter );
 }
 
-typedef struct WorldQueryContext
+typedef struct WorldMoverContext
 {
 	b2World* world;
-	b2OverlapResultFcn* fcn;
+	b2PlaneResultFcn* fcn;
 	b2QueryFilter filter;
+	b2Capsule mover;
 	void* userContext;
-} WorldQueryContext;
+} WorldMoverContext;
 
-static bool TreeQueryCallback( int proxyId, uint64_t userData, void* context )
+typedef struct CompoundMoverContext
+{
+	WorldMoverContext* worldContext;
+	b2Shape* shape;
+	b2Transform transform;
+	bool keepGoing;
+} CompoundMoverContext;
+
+// Reports a plane for each polygon of a compound near the mover
+static bool CompoundMoverCallback( int polygonIndex, void* context )
+{
+	CompoundMoverContext* compoundContext = context;
+	WorldMoverContext* worldContext = compoundContext->worldContext;
+	b2Shape* shape = compoundContext->shape;
+
+	b2PlaneResult result = b2CollideMover( &worldContext->mover, shape, polygonIndex, compoundContext->transform );
+	if ( result.hit && b2IsNormalized( result.plane.normal ) )
+	{
+		b2ShapeId id = { shape->id + 1, worldContext->world->worldId, shape->generation };
+		compoundContext->keepGoing = worldContext->fcn( id, &result, worldContext->userContext );
+	}
+
+	return compoundContext->keepGoing;
+}
+
+static bool TreeCollideCallback( int proxyId, uint64_t userData, void* context )
 {
 	B2_UNUSED( proxyId );
 
 	int shapeId = (int)userData;
-
-	WorldQueryContext* worldContext = context;
+	WorldMoverContext* worldContext = (WorldMoverContext*)context;
 	b2World* world = worldContext->world;
 
 	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
@@ -2031,690 +6224,1087 @@ static bool TreeQueryCallback( int proxyId, uint64_t userData, void* context )
 		return true;
 	}
 
-	b2ShapeId id = { shapeId + 1, world->worldId, shape->generation };
-	bool result = worldContext->fcn( id, worldContext->userContext );
-	return result;
-}
+	b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
+	b2Transform transform = b2GetQueryTransform( world, body );
 
-b2TreeStats b2World_OverlapAABB( b2WorldId worldId, b2AABB aabb, b2QueryFilter filter, b2OverlapResultFcn* fcn, void* context )
-{
-	b2TreeStats treeStats = { 0 };
+	if ( shape->type == b2_compoundShape )
+	{
+		const b2Capsule* mover = &worldContext->mover;
+		b2Capsule localMover = {
+			b2InvTransformPoint( transform, mover->center1 ),
+			b2InvTransformPoint( transform, mover->center2 ),
+			mover->radius,
+		};
+		b2AABB box = b2ComputeCapsuleAABB( &localMover, b2Transform_identity );
 
-	b2World* world = b2GetWorldFromId( worldId );
-	B2_ASSERT( world->locked == false );
-	if ( world->locked )
+		CompoundMoverContext compoundContext = { worldContext, shape, transform, true };
+		b2QueryCompound( shape->compound, box, CompoundMoverCallback, &compoundContext );
+		return compoundContext.keepGoing;
+	}
+
+	b2PlaneResult result = b2CollideMover( &worldContext->mover, shape, 0, transform );
+
+	// todo handle deep overlap
+	if ( result.hit && b2IsNormalized( result.plane.normal ) )
 	{
-		return treeStats;
+		b2ShapeId id = { shape->id + 1, world->worldId, shape->generation };
+		return worldContext->fcn( id, &result, worldContext->userContext );
 	}
 
-	B2_ASSERT( b2IsValidAABB( aabb ) );
+	return true;
+}
 
-	WorldQueryContext worldContext = { world, fcn, filter, context };
+// It is tempting to use a shape proxy for the mover, but this makes handling deep overlap difficult and the generality may
+// not be worth it.
+static void b2CollideMoverInternal( b2World* world, int treeCount, const b2Capsule* mover, b2QueryFilter filter,
+									b2PlaneResultFcn* fcn, void* context )
+{
+	b2Vec2 r = { mover->radius, mover->radius };
 
-	for ( int i = 0; i < b2_bodyTypeCount; ++i )
+	b2AABB aabb;
+	aabb.lowerBound = b2Sub( b2Min( mover->center1, mover->center2 ), r );
+	aabb.upperBound = b2Add( b2Max( mover->center1, mover->center2 ), r );
+
+	WorldMoverContext worldContext = {
+		world, fcn, filter, *mover, context,
+	};
+
+	for ( int i = 0; i < treeCount; ++i )
 	{
-		b2TreeStats treeResult =
-			b2DynamicTree_Query( world->broadPhase.trees + i, aabb, filter.maskBits, TreeQueryCallback, &worldContext );
+		b2DynamicTree_Query( world->broadPhase.trees + i, aabb, filter.maskBits, TreeCollideCallback, &worldContext );
+	}
+}
 
-		treeStats.nodeVisits += treeResult.nodeVisits;
-		treeStats.leafVisits += treeResult.leafVisits;
+void b2World_CollideMover( b2WorldId worldId, const b2Capsule* mover, b2QueryFilter filter, b2PlaneResultFcn* fcn, void* context )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	int treeCount = b2GetQueryTreeCount( world );
+	if ( treeCount == 0 )
+	{
+		return;
 	}
 
-	return treeStats;
+	b2CollideMoverInternal( world, treeCount, mover, filter, fcn, context );
 }
 
-typedef struct WorldOverlapContext
+typedef struct b2MoverPlanes
 {
-	b2World* world;
-	b2OverlapResultFcn* fcn;
-	b2QueryFilter filter;
-	const b2ShapeProxy* proxy;
-	void* userContext;
-} WorldOverlapContext;
+	b2CollisionPlane planes[B2_MAX_MOVER_PLANES];
+	int count;
+} b2MoverPlanes;
 
-static bool TreeOverlapCallback( int proxyId, uint64_t userData, void* context )
+static bool b2CollectMoverPlane( b2ShapeId shapeId, const b2PlaneResult* result, void* context )
 {
-	B2_UNUSED( proxyId );
+	B2_UNUSED( shapeId );
+
+	b2MoverPlanes* moverPlanes = context;
+	moverPlanes->planes[moverPlanes->count] = (b2CollisionPlane){
+		.plane = result->plane,
+		.pushLimit = FLT_MAX,
+		.push = 0.0f,
+		.clipVelocity = true,
+	};
+	moverPlanes->count += 1;
+
+	// Stop when full
+	return moverPlanes->count < B2_MAX_MOVER_PLANES;
+}
+
+typedef struct b2SolveMoversContext
+{
+	b2World* world;
+	b2Capsule* movers;
+	const b2Vec2* translations;
+	b2Vec2* velocities;
+	int moverCount;
+	int treeCount;
+	b2QueryFilter collideFilter;
+	b2QueryFilter castFilter;
+} b2SolveMoversContext;
+
+// Each task moves whole packets of movers. Plane collection and the mover casts are scalar
+// tree queries, the plane solver runs one mover per SIMD lane.
+static void b2SolveMoversTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	B2_UNUSED( workerIndex );
+
+	b2TracyCZoneNC( solve_movers_task, "Solve Movers", b2_colorDarkSeaGreen, true );
+
+	b2SolveMoversContext* moverContext = context;
+	b2World* world = moverContext->world;
+	int treeCount = moverContext->treeCount;
+	float tolerance = 2.0f * B2_LINEAR_SLOP;
+
+	for ( int packetIndex = startIndex; packetIndex < endIndex; ++packetIndex )
+	{
+		int baseIndex = B2_MOVER_PACKET_SIZE * packetIndex;
+		int laneCount = b2MinInt( B2_MOVER_PACKET_SIZE, moverContext->moverCount - baseIndex );
+		b2Capsule* movers = moverContext->movers + baseIndex;
+
+		b2MoverPlanes moverPlanes[B2_MOVER_PACKET_SIZE];
+		b2CollisionPlane* planes[B2_MOVER_PACKET_SIZE];
+		b2Vec2 targets[B2_MOVER_PACKET_SIZE];
+		b2Vec2 targetDeltas[B2_MOVER_PACKET_SIZE];
+		int counts[B2_MOVER_PACKET_SIZE];
+		b2PlaneSolverResult results[B2_MOVER_PACKET_SIZE];
+
+		for ( int lane = 0; lane < laneCount; ++lane )
+		{
+			B2_ASSERT( b2IsValidVec2( moverContext->translations[baseIndex + lane] ) );
+			B2_ASSERT( movers[lane].radius > 2.0f * B2_LINEAR_SLOP );
+
+			moverPlanes[lane].count = 0;
+			planes[lane] = moverPlanes[lane].planes;
+			targets[lane] = b2Add( movers[lane].center1, moverContext->translations[baseIndex + lane] );
+		}
 
-	int shapeId = (int)userData;
+		int activeMask = ( 1 << laneCount ) - 1;
+		for ( int iteration = 0; iteration < 5 && activeMask != 0; ++iteration )
+		{
+			for ( int lane = 0; lane < laneCount; ++lane )
+			{
+				if ( ( activeMask & ( 1 << lane ) ) == 0 )
+				{
+					// Keep the final planes of a finished mover for velocity clipping
+					counts[lane] = 0;
+					targetDeltas[lane] = b2Vec2_zero;
+					continue;
+				}
 
-	WorldOverlapContext* worldContext = context;
-	b2World* world = worldContext->world;
+				moverPlanes[lane].count = 0;
+				b2CollideMoverInternal( world, treeCount, movers + lane, moverContext->collideFilter, b2CollectMoverPlane,
+										moverPlanes + lane );
+				counts[lane] = moverPlanes[lane].count;
+				targetDeltas[lane] = b2Sub( targets[lane], movers[lane].center1 );
+			}
 
-	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+			b2SolvePlanesWide( targetDeltas, planes, counts, laneCount, results );
 
-	if ( b2ShouldQueryCollide( shape->filter, worldContext->filter ) == false )
-	{
-		return true;
-	}
+			for ( int lane = 0; lane < laneCount; ++lane )
+			{
+				if ( ( activeMask & ( 1 << lane ) ) == 0 )
+				{
+					continue;
+				}
 
-	b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
-	b2Transform transform = b2GetBodyTransformQuick( world, body );
+				b2Capsule* mover = movers + lane;
+				b2Vec2 translation = results[lane].translation;
+				float fraction = b2CastMoverInternal( world, treeCount, mover, translation, moverContext->castFilter );
 
-	b2DistanceInput input;
-	input.proxyA = *worldContext->proxy;
-	input.proxyB = b2MakeShapeDistanceProxy( shape );
-	input.transformA = b2Transform_identity;
-	input.transformB = transform;
-	input.useRadii = true;
+				b2Vec2 delta = b2MulSV( fraction, translation );
+				mover->center1 = b2Add( mover->center1, delta );
+				mover->center2 = b2Add( mover->center2, delta );
 
-	b2SimplexCache cache = { 0 };
-	b2DistanceOutput output = b2ShapeDistance( &input, &cache, NULL, 0 );
+				if ( b2LengthSquared( delta ) < tolerance * tolerance )
+				{
+					activeMask &= ~( 1 << lane );
+				}
+			}
+		}
 
-	float tolerance = 0.1f * B2_LINEAR_SLOP;
-	if ( output.distance > tolerance )
-	{
-		return true;
+		if ( moverContext->velocities != NULL )
+		{
+			b2Vec2* velocities = moverContext->velocities + baseIndex;
+			for ( int lane = 0; lane < laneCount; ++lane )
+			{
+				velocities[lane] = b2ClipVector( velocities[lane], moverPlanes[lane].planes, moverPlanes[lane].count );
+			}
+		}
 	}
 
-	b2ShapeId id = { shape->id + 1, world->worldId, shape->generation };
-	bool result = worldContext->fcn( id, worldContext->userContext );
-	return result;
+	b2TracyCZoneEnd( solve_movers_task );
 }
 
-b2TreeStats b2World_OverlapShape( b2WorldId worldId, const b2ShapeProxy* proxy, b2QueryFilter filter, b2OverlapResultFcn* fcn,
-								  void* context )
+void b2World_SolveMovers( b2WorldId worldId, b2Capsule* movers, const b2Vec2* translations, b2Vec2* velocities, int count,
+						  b2QueryFilter collideFilter, b2QueryFilter castFilter )
 {
-	b2TreeStats treeStats = { 0 };
-
 	b2World* world = b2GetWorldFromId( worldId );
 	B2_ASSERT( world->locked == false );
-	if ( world->locked )
+	if ( world->locked || count <= 0 )
 	{
-		return treeStats;
+		return;
 	}
 
-	b2AABB aabb = b2MakeAABB( proxy->points, proxy->count, proxy->radius );
-	WorldOverlapContext worldContext = {
-		world, fcn, filter, proxy, context,
-	};
-
-	for ( int i = 0; i < b2_bodyTypeCount; ++i )
+	int treeCount = b2GetQueryTreeCount( world );
+	if ( treeCount == 0 )
 	{
-		b2TreeStats treeResult =
-			b2DynamicTree_Query( world->broadPhase.trees + i, aabb, filter.maskBits, TreeOverlapCallback, &worldContext );
+		for ( int i = 0; i < count; ++i )
+		{
+			movers[i].center1 = b2Add( movers[i].center1, translations[i] );
+			movers[i].center2 = b2Add( movers[i].center2, translations[i] );
+		}
+		return;
+	}
 
-		treeStats.nodeVisits += treeResult.nodeVisits;
-		treeStats.leafVisits += treeResult.leafVisits;
+	b2TracyCZoneNC( solve_movers, "Solve Movers", b2_colorDarkSeaGreen, true );
+
+	// All tasks from the last step are finished so the task slots can be reused
+	world->taskCount = 0;
+	if ( world->scheduler != NULL )
+	{
+		b2ResetScheduler( world->scheduler );
 	}
 
-	return treeStats;
+	b2SolveMoversContext context = {
+		world, movers, translations, velocities, count, treeCount, collideFilter, castFilter,
+	};
+	int packetCount = ( count + B2_MOVER_PACKET_SIZE - 1 ) / B2_MOVER_PACKET_SIZE;
+	b2ParallelFor( world, b2SolveMoversTask, packetCount, 4, &context );
+
+	b2TracyCZoneEnd( solve_movers );
 }
 
-typedef struct WorldRayCastContext
-{
-	b2World* world;
-	b2CastResultFcn* fcn;
-	b2QueryFilter filter;
-	float fraction;
-	void* userContext;
-} WorldRayCastContext;
+#if 0
 
-static float RayCastCallback( const b2RayCastInput* input, int proxyId, uint64_t userData, void* context )
+void b2World_Dump()
 {
-	B2_UNUSED( proxyId );
+	if (m_locked)
+	{
+		return;
+	}
 
-	int shapeId = (int)userData;
+	b2OpenDump("box2d_dump.inl");
 
-	WorldRayCastContext* worldContext = context;
-	b2World* world = worldContext->world;
+	b2Dump("b2Vec2 g(%.9g, %.9g);\n", m_gravity.x, m_gravity.y);
+	b2Dump("m_world->SetGravity(g);\n");
 
-	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+	b2Dump("b2Body** sims = (b2Body**)b2Alloc(%d * sizeof(b2Body*));\n", m_bodyCount);
+	b2Dump("b2Joint** joints = (b2Joint**)b2Alloc(%d * sizeof(b2Joint*));\n", m_jointCount);
 
-	if ( b2ShouldQueryCollide( shape->filter, worldContext->filter ) == false )
+	int32 i = 0;
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
 	{
-		return input->maxFraction;
+		b->m_islandIndex = i;
+		b->Dump();
+		++i;
 	}
 
-	b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
-	b2Transform transform = b2GetBodyTransformQuick( world, body );
-	b2CastOutput output = b2RayCastShape( input, shape, transform );
+	i = 0;
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		j->m_index = i;
+		++i;
+	}
 
-	if ( output.hit )
+	// First pass on joints, skip gear joints.
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
 	{
-		b2ShapeId id = { shapeId + 1, world->worldId, shape->generation };
-		float fraction = worldContext->fcn( id, output.point, output.normal, output.fraction, worldContext->userContext );
+		if (j->m_type == e_gearJoint)
+		{
+			continue;
+		}
 
-		// The user may return -1 to skip this shape
-		if ( 0.0f <= fraction && fraction <= 1.0f )
+		b2Dump("{\n");
+		j->Dump();
+		b2Dump("}\n");
+	}
+
+	// Second pass on joints, only gear joints.
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		if (j->m_type != e_gearJoint)
 		{
-			worldContext->fraction = fraction;
+			continue;
 		}
 
-		return fraction;
+		b2Dump("{\n");
+		j->Dump();
+		b2Dump("}\n");
 	}
 
-	return input->maxFraction;
+	b2Dump("b2Free(joints);\n");
+	b2Dump("b2Free(sims);\n");
+	b2Dump("joints = nullptr;\n");
+	b2Dump("sims = nullptr;\n");
+
+	b2CloseDump();
 }
+#endif
 
-b2TreeStats b2World_CastRay( b2WorldId worldId, b2Vec2 origin, b2Vec2 translation, b2QueryFilter filter, b2CastResultFcn* fcn,
-							 void* context )
+void b2World_SetCustomFilterCallback( b2WorldId worldId, b2CustomFilterFcn* fcn, void* context )
 {
-	b2TreeStats treeStats = { 0 };
-
 	b2World* world = b2GetWorldFromId( worldId );
-	B2_ASSERT( world->locked == false );
-	if ( world->locked )
-	{
-		return treeStats;
-	}
-
-	B2_ASSERT( b2IsValidVec2( origin ) );
-	B2_ASSERT( b2IsValidVec2( translation ) );
-
-	b2RayCastInput input = { origin, translation, 1.0f };
+	world->customFilterFcn = fcn;
+	world->customFilterContext = context;
 
-	WorldRayCastContext worldContext = { world, fcn, filter, 1.0f, context };
+	// The filter decides sensor overlaps too
+	world->sensorFullUpdate = true;
+}
 
-	for ( int i = 0; i < b2_bodyTypeCount; ++i )
-	{
-		b2TreeStats treeResult =
-			b2DynamicTree_RayCast( world->broadPhase.trees + i, &input, filter.maskBits, RayCastCallback, &worldContext );
-		treeStats.nodeVisits += treeResult.nodeVisits;
-		treeStats.leafVisits += treeResult.leafVisits;
+void b2World_SetPreSolveCallback( b2WorldId worldId, b2PreSolveFcn* fcn, void* context )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	world->preSolveFcn = fcn;
+	world->preSolveContext = context;
+}
 
-		if ( worldContext.fraction == 0.0f )
-		{
-			return treeStats;
-		}
+void b2World_SetCustomFilterBatchCallback( b2WorldId worldId, b2CustomFilterBatchFcn* fcn, void* context )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	world->customFilterBatchFcn = fcn;
+	world->customFilterBatchContext = context;
 
-		input.maxFraction = worldContext.fraction;
-	}
+	// The filter decides sensor overlaps too
+	world->sensorFullUpdate = true;
+}
 
-	return treeStats;
+void b2World_SetPreSolveBatchCallback( b2WorldId worldId, b2PreSolveBatchFcn* fcn, void* context )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	world->preSolveBatchFcn = fcn;
+	world->preSolveBatchContext = context;
 }
 
-// This callback finds the closest hit. This is the most common callback used in games.
-static float b2RayCastClosestFcn( b2ShapeId shapeId, b2Vec2 point, b2Vec2 normal, float fraction, void* context )
+void b2World_SetGravity( b2WorldId worldId, b2Vec2 gravity )
 {
-	// Ignore initial overlap
-	if ( fraction == 0.0f )
+	b2World* world = b2GetWorldFromId( worldId );
+	world->gravity = gravity;
+
+	if ( world->recorder != NULL )
 	{
-		return -1.0f;
+		b2RecordCall( world->recorder, b2_recordSetGravity );
+		b2RecordValue( world->recorder, gravity );
 	}
+}
 
-	b2RayResult* rayResult = (b2RayResult*)context;
-	rayResult->shapeId = shapeId;
-	rayResult->point = point;
-	rayResult->normal = normal;
-	rayResult->fraction = fraction;
-	rayResult->hit = true;
-	return fraction;
+b2Vec2 b2World_GetGravity( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->gravity;
 }
 
-b2RayResult b2World_CastRayClosest( b2WorldId worldId, b2Vec2 origin, b2Vec2 translation, b2QueryFilter filter )
+struct ExplosionContext
 {
-	b2RayResult result = { 0 };
+	b2World* world;
+	b2Vec2 position;
+	float radius;
+	float falloff;
+	float impulsePerLength;
+};
 
-	b2World* world = b2GetWorldFromId( worldId );
-	B2_ASSERT( world->locked == false );
-	if ( world->locked )
+// Returns false if the shape is out of range. Only reads the shape so it is safe on workers.
+static bool b2ComputeExplosionImpulse( const b2Shape* shape, b2Transform transform, b2Vec2 position, float radius,
+									   float falloff, float impulsePerLength, b2Vec2* impulseOut, b2Vec2* pointOut )
+{
+	b2ShapeProxy proxy = b2MakeProxy( &position, 1, 0.0f );
+	b2DistanceOutput output = b2ComputeShapeProxyDistance( shape, transform, &proxy, b2Transform_identity );
+
+	if ( output.distance > radius + falloff )
 	{
-		return result;
+		return false;
 	}
 
-	B2_ASSERT( b2IsValidVec2( origin ) );
-	B2_ASSERT( b2IsValidVec2( translation ) );
-
-	b2RayCastInput input = { origin, translation, 1.0f };
-	WorldRayCastContext worldContext = { world, b2RayCastClosestFcn, filter, 1.0f, &result };
-
-	for ( int i = 0; i < b2_bodyTypeCount; ++i )
+	b2Vec2 closestPoint = output.pointA;
+	if ( output.distance == 0.0f )
 	{
-		b2TreeStats treeResult =
-			b2DynamicTree_RayCast( world->broadPhase.trees + i, &input, filter.maskBits, RayCastCallback, &worldContext );
-		result.nodeVisits += treeResult.nodeVisits;
-		result.leafVisits += treeResult.leafVisits;
+		b2Vec2 localCentroid = b2GetShapeCentroid( shape );
+		closestPoint = b2TransformPoint( transform, localCentroid );
+	}
 
-		if ( worldContext.fraction == 0.0f )
-		{
-			return result;
-		}
+	b2Vec2 direction = b2Sub( closestPoint, position );
+	if ( b2LengthSquared( direction ) > 100.0f * FLT_EPSILON * FLT_EPSILON )
+	{
+		direction = b2Normalize( direction );
+	}
+	else
+	{
+		direction = (b2Vec2){ 1.0f, 0.0f };
+	}
 
-		input.maxFraction = worldContext.fraction;
+	b2Vec2 localLine = b2InvRotateVector( transform.q, b2LeftPerp( direction ) );
+	float perimeter = b2GetShapeProjectedPerimeter( shape, localLine );
+	float scale = 1.0f;
+	if ( output.distance > radius && falloff > 0.0f )
+	{
+		scale = b2ClampFloat( ( radius + falloff - output.distance ) / falloff, 0.0f, 1.0f );
 	}
 
-	return result;
+	float magnitude = impulsePerLength * perimeter * scale;
+	*impulseOut = b2MulSV( magnitude, direction );
+	*pointOut = closestPoint;
+	return true;
 }
 
-static float ShapeCastCallback( const b2ShapeCastInput* input, int proxyId, uint64_t userData, void* context )
+static bool ExplosionCallback( int proxyId, uint64_t userData, void* context )
 {
 	B2_UNUSED( proxyId );
 
 	int shapeId = (int)userData;
 
-	WorldRayCastContext* worldContext = context;
-	b2World* world = worldContext->world;
+	struct ExplosionContext* explosionContext = context;
+	b2World* world = explosionContext->world;
 
 	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
 
-	if ( b2ShouldQueryCollide( shape->filter, worldContext->filter ) == false )
-	{
-		return input->maxFraction;
-	}
-
 	b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
-	b2Transform transform = b2GetBodyTransformQuick( world, body );
+	B2_ASSERT( body->type == b2_dynamicBody );
 
-	b2CastOutput output = b2ShapeCastShape( input, shape, transform );
+	b2Transform transform = b2GetBodyTransformQuick( world, body );
 
-	if ( output.hit )
+	b2Vec2 impulse, closestPoint;
+	if ( b2ComputeExplosionImpulse( shape, transform, explosionContext->position, explosionContext->radius,
+									explosionContext->falloff, explosionContext->impulsePerLength, &impulse,
+									&closestPoint ) == false )
 	{
-		b2ShapeId id = { shapeId + 1, world->worldId, shape->generation };
-		float fraction = worldContext->fcn( id, output.point, output.normal, output.fraction, worldContext->userContext );
+		return true;
+	}
 
-		// The user may return -1 to skip this shape
-		if ( 0.0f <= fraction && fraction <= 1.0f )
-		{
-			worldContext->fraction = fraction;
-		}
+	b2WakeBody( world, body );
 
-		return fraction;
+	if ( body->setIndex != b2_awakeSet )
+	{
+		return true;
 	}
 
-	return input->maxFraction;
+	int localIndex = body->localIndex;
+	b2SolverSet* set = b2Array_Get( world->solverSets, b2_awakeSet );
+	b2BodyState* state = b2Array_Get( set->bodyStates, localIndex );
+	b2BodySim* bodySim = b2Array_Get( set->bodySims, localIndex );
+	state->linearVelocity = b2MulAdd( state->linearVelocity, bodySim->invMass, impulse );
+	state->angularVelocity += bodySim->invInertia * b2Cross( b2Sub( closestPoint, bodySim->center ), impulse );
+
+	return true;
 }
 
-b2TreeStats b2World_CastShape( b2WorldId worldId, const b2ShapeProxy* proxy, b2Vec2 translation, b2QueryFilter filter,
-							   b2CastResultFcn* fcn, void* context )
+void b2World_Explode( b2WorldId worldId, const b2ExplosionDef* explosionDef )
 {
-	b2TreeStats treeStats = { 0 };
+	uint64_t maskBits = explosionDef->maskBits;
+	b2Vec2 position = explosionDef->position;
+	float radius = explosionDef->radius;
+	float falloff = explosionDef->falloff;
+	float impulsePerLength = explosionDef->impulsePerLength;
+
+	B2_ASSERT( b2IsValidVec2( position ) );
+	B2_ASSERT( b2IsValidFloat( radius ) && radius >= 0.0f );
+	B2_ASSERT( b2IsValidFloat( falloff ) && falloff >= 0.0f );
+	B2_ASSERT( b2IsValidFloat( impulsePerLength ) );
 
 	b2World* world = b2GetWorldFromId( worldId );
 	B2_ASSERT( world->locked == false );
 	if ( world->locked )
 	{
-		return treeStats;
+		return;
 	}
 
-	B2_ASSERT( b2IsValidVec2( translation ) );
-
-	b2ShapeCastInput input = { 0 };
-	input.proxy = *proxy;
-	input.translation = translation;
-	input.maxFraction = 1.0f;
-
-	WorldRayCastContext worldContext = { world, fcn, filter, 1.0f, context };
+	struct ExplosionContext explosionContext = { world, position, radius, falloff, impulsePerLength };
 
-	for ( int i = 0; i < b2_bodyTypeCount; ++i )
-	{
-		b2TreeStats treeResult =
-			b2DynamicTree_ShapeCast( world->broadPhase.trees + i, &input, filter.maskBits, ShapeCastCallback, &worldContext );
-		treeStats.nodeVisits += treeResult.nodeVisits;
-		treeStats.leafVisits += treeResult.leafVisits;
+	b2AABB aabb;
+	aabb.lowerBound.x = position.x - ( radius + falloff );
+	aabb.lowerBound.y = position.y - ( radius + falloff );
+	aabb.upperBound.x = position.x + ( radius + falloff );
+	aabb.upperBound.y = position.y + ( radius + falloff );
 
-		if ( worldContext.fraction == 0.0f )
-		{
-			return treeStats;
-		}
+	b2DynamicTree_Query( world->broadPhase.trees + b2_dynamicBody, aabb, maskBits, ExplosionCallback, &explosionContext );
+}
 
-		input.maxFraction = worldContext.fraction;
-	}
+typedef struct b2AreaCandidate
+{
+	int areaIndex;
+	int shapeId;
+} b2AreaCandidate;
 
-	return treeStats;
-}
+// The command type is B2_NULL_INDEX if the shape is not affected
+typedef struct b2AreaResult
+{
+	int type;
+	b2Vec2 value;
+	b2Vec2 point;
+	float torque;
+} b2AreaResult;
 
-typedef struct b2MoverContext
+typedef struct b2AreaGatherContext
 {
 	b2World* world;
-	b2QueryFilter filter;
-	b2ShapeProxy proxy;
-	b2Transform transform;
-	void* userContext;
-} b2CharacterCallbackContext;
+	const b2AreaForceDef* def;
+	b2AreaCandidate* candidates;
+	int areaIndex;
+	int count;
+} b2AreaGatherContext;
 
-typedef struct WorldMoverCastContext
+typedef struct b2AreaForceContext
 {
 	b2World* world;
-	b2QueryFilter filter;
-	float fraction;
-} WorldMoverCastContext;
+	const b2AreaForceDef* defs;
+	const b2AreaCandidate* candidates;
+	b2AreaResult* results;
+} b2AreaForceContext;
 
-static float MoverCastCallback( const b2ShapeCastInput* input, int proxyId, uint64_t userData, void* context )
+static b2AABB b2GetAreaBounds( const b2AreaForceDef* def )
+{
+	if ( def->type == b2_explosionArea )
+	{
+		b2Vec2 position = def->explosion.position;
+		float extent = def->explosion.radius + def->explosion.falloff;
+		return (b2AABB){ { position.x - extent, position.y - extent }, { position.x + extent, position.y + extent } };
+	}
+
+	return def->region;
+}
+
+// Counts the candidates on the first pass and stores them on the second
+static bool b2AreaGatherCallback( int proxyId, uint64_t userData, void* context )
 {
 	B2_UNUSED( proxyId );
 
 	int shapeId = (int)userData;
-	WorldMoverCastContext* worldContext = context;
-	b2World* world = worldContext->world;
+	b2AreaGatherContext* gatherContext = context;
+	b2World* world = gatherContext->world;
+	const b2AreaForceDef* def = gatherContext->def;
 
 	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+	if ( shape->sensorIndex != B2_NULL_INDEX )
+	{
+		return true;
+	}
 
-	if ( b2ShouldQueryCollide( shape->filter, worldContext->filter ) == false )
+	if ( def->type != b2_explosionArea && shape->type != b2_circleShape && shape->type != b2_capsuleShape &&
+		 b2GetShapePolygon( shape ) == NULL )
 	{
-		return worldContext->fraction;
+		return true;
 	}
 
 	b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
-	b2Transform transform = b2GetBodyTransformQuick( world, body );
+	if ( body->type != b2_dynamicBody || ( def->wake == false && body->setIndex != b2_awakeSet ) )
+	{
+		return true;
+	}
 
-	b2CastOutput output = b2ShapeCastShape( input, shape, transform );
-	if ( output.fraction == 0.0f )
+	if ( gatherContext->candidates != NULL )
 	{
-		// Ignore overlapping shapes
-		return worldContext->fraction;
+		gatherContext->candidates[gatherContext->count] = (b2AreaCandidate){ gatherContext->areaIndex, shapeId };
 	}
 
-	worldContext->fraction = output.fraction;
-	return output.fraction;
+	gatherContext->count += 1;
+	return true;
 }
 
-float b2World_CastMover( b2WorldId worldId, const b2Capsule* mover, b2Vec2 translation, b2QueryFilter filter )
-{
-	B2_ASSERT( b2IsValidVec2( translation ) );
-	B2_ASSERT( mover->radius > 2.0f * B2_LINEAR_SLOP );
+#define B2_AREA_MAX_VERTICES 32
+#define B2_AREA_ARC_SEGMENTS 8
 
-	b2World* world = b2GetWorldFromId( worldId );
-	B2_ASSERT( world->locked == false );
-	if ( world->locked )
+// Conservative world polygon used for the submerged area. The rounding of polygons is ignored.
+static int b2MakeAreaPolygon( const b2Shape* shape, b2Transform transform, b2Vec2* vertices )
+{
+	switch ( shape->type )
 	{
-		return 1.0f;
-	}
+		case b2_circleShape:
+		{
+			b2Vec2 center = b2TransformPoint( transform, shape->circle.center );
+			float radius = shape->circle.radius;
+			int count = 2 * B2_AREA_ARC_SEGMENTS;
+			for ( int i = 0; i < count; ++i )
+			{
+				b2CosSin cs = b2ComputeCosSin( 2.0f * B2_PI * i / count );
+				vertices[i] = b2MulAdd( center, radius, (b2Vec2){ cs.cosine, cs.sine } );
+			}
+			return count;
+		}
 
-	b2ShapeCastInput input = { 0 };
-	input.proxy.points[0] = mover->center1;
-	input.proxy.points[1] = mover->center2;
-	input.proxy.count = 2;
-	input.proxy.radius = mover->radius;
-	input.translation = translation;
-	input.maxFraction = 1.0f;
-	input.canEncroach = true;
+		case b2_capsuleShape:
+		{
+			b2Vec2 p1 = b2TransformPoint( transform, shape->capsule.center1 );
+			b2Vec2 p2 = b2TransformPoint( transform, shape->capsule.center2 );
+			float radius = shape->capsule.radius;
+			b2Vec2 axis = b2Normalize( b2Sub( p2, p1 ) );
+			b2Vec2 normal = b2RightPerp( axis );
+			int count = 0;
+			for ( int i = 0; i <= B2_AREA_ARC_SEGMENTS; ++i )
+			{
+				b2CosSin cs = b2ComputeCosSin( B2_PI * i / B2_AREA_ARC_SEGMENTS );
+				b2Vec2 d = b2Add( b2MulSV( cs.cosine, normal ), b2MulSV( cs.sine, axis ) );
+				vertices[count++] = b2MulAdd( p2, radius, d );
+			}
+			for ( int i = 0; i <= B2_AREA_ARC_SEGMENTS; ++i )
+			{
+				b2CosSin cs = b2ComputeCosSin( B2_PI * i / B2_AREA_ARC_SEGMENTS );
+				b2Vec2 d = b2Sub( b2MulSV( -cs.cosine, normal ), b2MulSV( cs.sine, axis ) );
+				vertices[count++] = b2MulAdd( p1, radius, d );
+			}
+			return count;
+		}
 
-	WorldMoverCastContext worldContext = { world, filter, 1.0f };
+		case b2_polygonShape:
+		case b2_compoundShape:
+		{
+			const b2Polygon* polygon = b2GetShapePolygon( shape );
+			B2_ASSERT( polygon != NULL );
+			int count = polygon->count;
+			for ( int i = 0; i < count; ++i )
+			{
+				vertices[i] = b2TransformPoint( transform, polygon->vertices[i] );
+			}
+			return count;
+		}
 
-	for ( int i = 0; i < b2_bodyTypeCount; ++i )
+		default:
+			B2_ASSERT( false );
+			return 0;
+	}
+}
+
+// Clips a convex polygon against the half plane dot(normal, p) <= offset
+static int b2ClipAreaPolygon( const b2Vec2* input, int count, b2Vec2 normal, float offset, b2Vec2* output )
+{
+	int outputCount = 0;
+	for ( int i = 0; i < count; ++i )
 	{
-		b2DynamicTree_ShapeCast( world->broadPhase.trees + i, &input, filter.maskBits, MoverCastCallback, &worldContext );
+		b2Vec2 a = input[i];
+		b2Vec2 b = input[i + 1 < count ? i + 1 : 0];
+		float da = b2Dot( normal, a ) - offset;
+		float db = b2Dot( normal, b ) - offset;
 
-		if ( worldContext.fraction == 0.0f )
+		if ( da <= 0.0f )
 		{
-			return 0.0f;
+			output[outputCount++] = a;
 		}
 
-		input.maxFraction = worldContext.fraction;
+		if ( ( da < 0.0f && db > 0.0f ) || ( da > 0.0f && db < 0.0f ) )
+		{
+			output[outputCount++] = b2Lerp( a, b, da / ( da - db ) );
+		}
 	}
 
-	return worldContext.fraction;
+	B2_ASSERT( outputCount <= B2_AREA_MAX_VERTICES );
+	return outputCount;
 }
 
-typedef struct WorldMoverContext
-{
-	b2World* world;
-	b2PlaneResultFcn* fcn;
-	b2QueryFilter filter;
-	b2Capsule mover;
-	void* userContext;
-} WorldMoverContext;
-
-static bool TreeCollideCallback( int proxyId, uint64_t userData, void* context )
+static void b2ComputeBuoyancy( const b2AreaForceDef* def, const b2Shape* shape, b2Transform transform, b2Vec2 center,
+							   b2Vec2 linearVelocity, float angularVelocity, b2Vec2 gravity, b2AreaResult* result )
 {
-	B2_UNUSED( proxyId );
+	b2Vec2 bufferA[B2_AREA_MAX_VERTICES], bufferB[B2_AREA_MAX_VERTICES];
+	int count = b2MakeAreaPolygon( shape, transform, bufferA );
 
-	int shapeId = (int)userData;
-	WorldMoverContext* worldContext = (WorldMoverContext*)context;
-	b2World* world = worldContext->world;
+	b2AABB region = def->region;
+	count = b2ClipAreaPolygon( bufferA, count, (b2Vec2){ -1.0f, 0.0f }, -region.lowerBound.x, bufferB );
+	count = b2ClipAreaPolygon( bufferB, count, (b2Vec2){ 1.0f, 0.0f }, region.upperBound.x, bufferA );
+	count = b2ClipAreaPolygon( bufferA, count, (b2Vec2){ 0.0f, -1.0f }, -region.lowerBound.y, bufferB );
+	count = b2ClipAreaPolygon( bufferB, count, (b2Vec2){ 0.0f, 1.0f }, region.upperBound.y, bufferA );
+	if ( count < 3 )
+	{
+		return;
+	}
 
-	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+	// Area and centroid relative to the first vertex for precision
+	b2Vec2 origin = bufferA[0];
+	float area = 0.0f;
+	b2Vec2 centroid = b2Vec2_zero;
+	for ( int i = 1; i < count - 1; ++i )
+	{
+		b2Vec2 e1 = b2Sub( bufferA[i], origin );
+		b2Vec2 e2 = b2Sub( bufferA[i + 1], origin );
+		float triangleArea = 0.5f * b2Cross( e1, e2 );
+		area += triangleArea;
+		centroid = b2MulAdd( centroid, triangleArea / 3.0f, b2Add( e1, e2 ) );
+	}
 
-	if ( b2ShouldQueryCollide( shape->filter, worldContext->filter ) == false )
+	if ( area <= FLT_EPSILON )
 	{
-		return true;
+		return;
 	}
 
-	b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
-	b2Transform transform = b2GetBodyTransformQuick( world, body );
+	centroid = b2Add( origin, b2MulSV( 1.0f / area, centroid ) );
 
-	b2PlaneResult result = b2CollideMover( &worldContext->mover, shape, transform );
+	b2Vec2 lever = b2Sub( centroid, center );
+	b2Vec2 pointVelocity = b2Add( linearVelocity, b2CrossSV( angularVelocity, lever ) );
+	b2Vec2 relativeVelocity = b2Sub( pointVelocity, def->flowVelocity );
 
-	// todo handle deep overlap
-	if ( result.hit && b2IsNormalized( result.plane.normal ) )
+	b2Vec2 force = b2MulSV( -def->fluidDensity * area, gravity );
+	force = b2MulSub( force, def->linearDrag * area, relativeVelocity );
+
+	result->type = b2_bodyForce;
+	result->value = force;
+	result->point = centroid;
+	result->torque = -def->angularDrag * area * angularVelocity;
+}
+
+static void b2AreaForceTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	b2TracyCZoneNC( area_force, "Area Force", b2_colorDodgerBlue, true );
+
+	B2_UNUSED( workerIndex );
+
+	b2AreaForceContext* areaContext = context;
+	b2World* world = areaContext->world;
+
+	for ( int i = startIndex; i < endIndex; ++i )
 	{
-		b2ShapeId id = { shape->id + 1, world->worldId, shape->generation };
-		return worldContext->fcn( id, &result, worldContext->userContext );
+		b2AreaCandidate candidate = areaContext->candidates[i];
+		const b2AreaForceDef* def = areaContext->defs + candidate.areaIndex;
+		b2AreaResult* result = areaContext->results + i;
+		*result = (b2AreaResult){ B2_NULL_INDEX, b2Vec2_zero, b2Vec2_zero, 0.0f };
+
+		b2Shape* shape = b2Array_Get( world->shapes, candidate.shapeId );
+		b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
+		b2BodySim* bodySim = b2GetBodySim( world, body );
+		b2Transform transform = bodySim->transform;
+
+		// Sleeping bodies are at rest
+		b2Vec2 linearVelocity = b2Vec2_zero;
+		float angularVelocity = 0.0f;
+		if ( body->setIndex == b2_awakeSet )
+		{
+			b2BodyState* state = b2GetBodyState( world, body );
+			linearVelocity = state->linearVelocity;
+			angularVelocity = state->angularVelocity;
+		}
+
+		switch ( def->type )
+		{
+			case b2_explosionArea:
+			{
+				b2ExplosionDef explosion = def->explosion;
+				if ( b2ComputeExplosionImpulse( shape, transform, explosion.position, explosion.radius, explosion.falloff,
+												explosion.impulsePerLength, &result->value, &result->point ) )
+				{
+					result->type = b2_bodyLinearImpulse;
+				}
+			}
+			break;
+
+			case b2_windArea:
+			{
+				b2ComputeShapeWind( shape, transform, bodySim->localCenter, linearVelocity, angularVelocity, def->wind,
+									def->drag, def->lift, &result->value, &result->torque );
+				result->type = b2_bodyForce;
+				result->point = bodySim->center;
+			}
+			break;
+
+			case b2_buoyancyArea:
+				b2ComputeBuoyancy( def, shape, transform, bodySim->center, linearVelocity, angularVelocity, world->gravity,
+								   result );
+				break;
+
+			default:
+				B2_ASSERT( false );
+				break;
+		}
 	}
 
-	return true;
+	b2TracyCZoneEnd( area_force );
 }
 
-// It is tempting to use a shape proxy for the mover, but this makes handling deep overlap difficult and the generality may
-// not be worth it.
-void b2World_CollideMover( b2WorldId worldId, const b2Capsule* mover, b2QueryFilter filter, b2PlaneResultFcn* fcn, void* context )
+void b2World_ApplyAreaForces( b2WorldId worldId, const b2AreaForceDef* defs, int count )
 {
 	b2World* world = b2GetWorldFromId( worldId );
 	B2_ASSERT( world->locked == false );
-	if ( world->locked )
+	if ( world->locked || count <= 0 )
 	{
 		return;
 	}
 
-	b2Vec2 r = { mover->radius, mover->radius };
+	B2_ASSERT( defs != NULL );
 
-	b2AABB aabb;
-	aabb.lowerBound = b2Sub( b2Min( mover->center1, mover->center2 ), r );
-	aabb.upperBound = b2Add( b2Max( mover->center1, mover->center2 ), r );
+	b2TracyCZoneNC( area_forces, "Area Forces", b2_colorDodgerBlue, true );
 
-	WorldMoverContext worldContext = {
-		world, fcn, filter, *mover, context,
-	};
+	b2DynamicTree* tree = world->broadPhase.trees + b2_dynamicBody;
 
-	for ( int i = 0; i < b2_bodyTypeCount; ++i )
+	b2AreaGatherContext gatherContext = { world, NULL, NULL, 0, 0 };
+	for ( int i = 0; i < count; ++i )
 	{
-		b2DynamicTree_Query( world->broadPhase.trees + i, aabb, filter.maskBits, TreeCollideCallback, &worldContext );
+		const b2AreaForceDef* def = defs + i;
+		B2_ASSERT( def->internalValue == B2_SECRET_COOKIE );
+		B2_ASSERT( b2IsValidAABB( b2GetAreaBounds( def ) ) );
+		gatherContext.def = def;
+		b2DynamicTree_Query( tree, b2GetAreaBounds( def ), def->maskBits, b2AreaGatherCallback, &gatherContext );
 	}
-}
 
-#if 0
-
-void b2World_Dump()
-{
-	if (m_locked)
+	int candidateCount = gatherContext.count;
+	if ( candidateCount == 0 )
 	{
-		return;
-	}
-
-	b2OpenDump("box2d_dump.inl");
-
-	b2Dump("b2Vec2 g(%.9g, %.9g);\n", m_gravity.x, m_gravity.y);
-	b2Dump("m_world->SetGravity(g);\n");
+		b2TracyCZoneEnd( area_forces );
+		return;
+	}
 
-	b2Dump("b2Body** sims = (b2Body**)b2Alloc(%d * sizeof(b2Body*));\n", m_bodyCount);
-	b2Dump("b2Joint** joints = (b2Joint**)b2Alloc(%d * sizeof(b2Joint*));\n", m_jointCount);
+	b2AreaCandidate* candidates =
+		b2StackAlloc( &world->stack, candidateCount * sizeof( b2AreaCandidate ), "area candidates" );
+	b2AreaResult* results = b2StackAlloc( &world->stack, candidateCount * sizeof( b2AreaResult ), "area results" );
 
-	int32 i = 0;
-	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	gatherContext.candidates = candidates;
+	gatherContext.count = 0;
+	for ( int i = 0; i < count; ++i )
 	{
-		b->m_islandIndex = i;
-		b->Dump();
-		++i;
+		gatherContext.def = defs + i;
+		gatherContext.areaIndex = i;
+		b2DynamicTree_Query( tree, b2GetAreaBounds( defs + i ), defs[i].maskBits, b2AreaGatherCallback, &gatherContext );
 	}
 
-	i = 0;
-	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	B2_ASSERT( gatherContext.count == candidateCount );
+
+	// All tasks from the last step are finished so the task slots can be reused
+	world->taskCount = 0;
+	if ( world->scheduler != NULL )
 	{
-		j->m_index = i;
-		++i;
+		b2ResetScheduler( world->scheduler );
 	}
 
-	// First pass on joints, skip gear joints.
-	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	b2AreaForceContext context = { world, defs, candidates, results };
+	b2ParallelFor( world, b2AreaForceTask, candidateCount, 32, &context );
+
+	// Queue in candidate order so the result does not depend on the worker count
+	b2Array( b2BodyCommand )* queue = &world->taskContexts.data[0].bodyCommands;
+	for ( int i = 0; i < candidateCount; ++i )
 	{
-		if (j->m_type == e_gearJoint)
+		b2AreaResult result = results[i];
+		if ( result.type == B2_NULL_INDEX )
 		{
 			continue;
 		}
 
-		b2Dump("{\n");
-		j->Dump();
-		b2Dump("}\n");
-	}
+		b2Shape* shape = b2Array_Get( world->shapes, candidates[i].shapeId );
+		b2BodyId bodyId = b2MakeBodyId( world, shape->bodyId );
+		bool wake = defs[candidates[i].areaIndex].wake;
 
-	// Second pass on joints, only gear joints.
-	for (b2Joint* j = m_jointList; j; j = j->m_next)
-	{
-		if (j->m_type != e_gearJoint)
+		b2BodyCommand command = { bodyId, result.value, result.point, (b2BodyCommandType)result.type, wake };
+		b2Array_Push( *queue, command );
+
+		if ( result.torque != 0.0f )
 		{
-			continue;
+			command.type = b2_bodyTorque;
+			command.value = (b2Vec2){ result.torque, 0.0f };
+			b2Array_Push( *queue, command );
 		}
-
-		b2Dump("{\n");
-		j->Dump();
-		b2Dump("}\n");
 	}
 
-	b2Dump("b2Free(joints);\n");
-	b2Dump("b2Free(sims);\n");
-	b2Dump("joints = nullptr;\n");
-	b2Dump("sims = nullptr;\n");
+	b2StackFree( &world->stack, results );
+	b2StackFree( &world->stack, candidates );
 
-	b2CloseDump();
+	b2TracyCZoneEnd( area_forces );
 }
-#endif
 
-void b2World_SetCustomFilterCallback( b2WorldId worldId, b2CustomFilterFcn* fcn, void* context )
+void b2World_RebuildStaticTree( b2WorldId worldId )
 {
 	b2World* world = b2GetWorldFromId( worldId );
-	world->customFilterFcn = fcn;
-	world->customFilterContext = context;
-}
+	B2_ASSERT( world->locked == false );
+	if ( world->locked )
+	{
+		return;
+	}
 
-void b2World_SetPreSolveCallback( b2WorldId worldId, b2PreSolveFcn* fcn, void* context )
-{
-	b2World* world = b2GetWorldFromId( worldId );
-	world->preSolveFcn = fcn;
-	world->preSolveContext = context;
+	// All tasks from the last step are finished so the task slots can be reused
+	world->taskCount = 0;
+	if ( world->scheduler != NULL )
+	{
+		b2ResetScheduler( world->scheduler );
+	}
+
+	// A pending asynchronous rebuild is superseded
+	b2FinishStaticRebuild( world );
+
+	b2DynamicTree* staticTree = world->broadPhase.trees + b2_staticBody;
+	world->broadPhase.dirtyTrees |= 1u << b2_staticBody;
+	b2RebuildTreeParallel( world, staticTree, true );
+	b2DynamicTree_BuildQuantizedNodes( staticTree );
 }
 
-void b2World_SetGravity( b2WorldId worldId, b2Vec2 gravity )
+void b2World_RebuildStaticTreeAsync( b2WorldId worldId )
 {
 	b2World* world = b2GetWorldFromId( worldId );
-	world->gravity = gravity;
+	B2_ASSERT( world->locked == false );
+	if ( world->locked || world->staticRebuildThread != NULL )
+	{
+		return;
+	}
+
+	// The thread only touches the copy. The live tree keeps serving pair finding and queries.
+	world->staticRebuildTree = b2CloneTreeNodes( world->broadPhase.trees + b2_staticBody );
+	b2AtomicStoreInt( &world->staticRebuildDone, 0 );
+	world->staticRebuildThread = b2CreateThread( b2StaticRebuildTask, world, "Static Rebuild" );
 }
 
-b2Vec2 b2World_GetGravity( b2WorldId worldId )
+bool b2World_IsStaticTreeRebuilding( b2WorldId worldId )
 {
 	b2World* world = b2GetWorldFromId( worldId );
-	return world->gravity;
+	return world->staticRebuildThread != NULL;
 }
 
-struct ExplosionContext
+// Bodies or contacts hashed together. Chunks are fixed so the hash does not depend on the worker count.
+#define B2_STATE_HASH_CHUNK_SIZE 256
+
+typedef struct b2StateHashChunk
+{
+	// A solver set for bodies or a graph color for contacts
+	int setIndex;
+	int colorIndex;
+	int start;
+	int count;
+	uint32_t hash;
+} b2StateHashChunk;
+
+typedef struct b2StateHashContext
 {
 	b2World* world;
-	b2Vec2 position;
-	float radius;
-	float falloff;
-	float impulsePerLength;
-};
+	b2StateHashChunk* chunks;
+} b2StateHashContext;
 
-static bool ExplosionCallback( int proxyId, uint64_t userData, void* context )
+// Four FNV-1a lanes over 32-bit words. The lanes are independent so this is vectorized.
+static uint32_t b2HashWords( const uint32_t* words, int count )
 {
-	B2_UNUSED( proxyId );
+	uint32_t lanes[4] = { 2166136261u, 2166136261u, 2166136261u, 2166136261u };
+	int i = 0;
+	for ( ; i + 4 <= count; i += 4 )
+	{
+		for ( int k = 0; k < 4; ++k )
+		{
+			lanes[k] = ( lanes[k] ^ words[i + k] ) * 16777619u;
+		}
+	}
 
-	int shapeId = (int)userData;
+	for ( ; i < count; ++i )
+	{
+		lanes[0] = ( lanes[0] ^ words[i] ) * 16777619u;
+	}
 
-	struct ExplosionContext* explosionContext = context;
-	b2World* world = explosionContext->world;
+	return b2Hash( B2_HASH_INIT, (const uint8_t*)lanes, sizeof( lanes ) );
+}
 
-	b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+static void b2StateHashTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	B2_UNUSED( workerIndex );
 
-	b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
-	B2_ASSERT( body->type == b2_dynamicBody );
+	b2StateHashContext* hashContext = context;
+	b2World* world = hashContext->world;
 
-	b2Transform transform = b2GetBodyTransformQuick( world, body );
+	// Up to seven words per body and five per contact
+	uint32_t words[7 * B2_STATE_HASH_CHUNK_SIZE];
 
-	b2DistanceInput input;
-	input.proxyA = b2MakeShapeDistanceProxy( shape );
-	input.proxyB = b2MakeProxy( &explosionContext->position, 1, 0.0f );
-	input.transformA = transform;
-	input.transformB = b2Transform_identity;
-	input.useRadii = true;
+	for ( int chunkIndex = startIndex; chunkIndex < endIndex; ++chunkIndex )
+	{
+		b2StateHashChunk* chunk = hashContext->chunks + chunkIndex;
+		int wordCount = 0;
 
-	b2SimplexCache cache = { 0 };
-	b2DistanceOutput output = b2ShapeDistance( &input, &cache, NULL, 0 );
+		if ( chunk->colorIndex != B2_NULL_INDEX )
+		{
+			b2ContactSim* contactSims = world->constraintGraph.colors[chunk->colorIndex].contactSims.data + chunk->start;
+			for ( int i = 0; i < chunk->count; ++i )
+			{
+				const b2Manifold* manifold = &contactSims[i].manifold;
+				words[wordCount++] = (uint32_t)manifold->pointCount;
+				for ( int j = 0; j < manifold->pointCount; ++j )
+				{
+					memcpy( words + wordCount, &manifold->points[j].normalImpulse, sizeof( float ) );
+					memcpy( words + wordCount + 1, &manifold->points[j].tangentImpulse, sizeof( float ) );
+					wordCount += 2;
+				}
+			}
+		}
+		else
+		{
+			b2SolverSet* set = world->solverSets.data + chunk->setIndex;
+			b2BodySim* bodySims = set->bodySims.data + chunk->start;
+			for ( int i = 0; i < chunk->count; ++i )
+			{
+				memcpy( words + wordCount, &bodySims[i].transform, sizeof( b2Transform ) );
+				wordCount += 4;
+			}
 
-	float radius = explosionContext->radius;
-	float falloff = explosionContext->falloff;
-	if ( output.distance > radius + falloff )
+			// Only awake and kinematic set bodies have velocity
+			if ( b2IsMovingSet( chunk->setIndex ) )
+			{
+				b2BodyState* states = set->bodyStates.data + chunk->start;
+				for ( int i = 0; i < chunk->count; ++i )
+				{
+					memcpy( words + wordCount, &states[i].linearVelocity, sizeof( b2Vec2 ) );
+					memcpy( words + wordCount + 2, &states[i].angularVelocity, sizeof( float ) );
+					wordCount += 3;
+				}
+			}
+		}
+
+		chunk->hash = b2HashWords( words, wordCount );
+	}
+}
+
+static int b2AddStateHashChunks( b2StateHashChunk* chunks, int chunkCount, int setIndex, int colorIndex, int itemCount )
+{
+	for ( int start = 0; start < itemCount; start += B2_STATE_HASH_CHUNK_SIZE )
 	{
-		return true;
+		chunks[chunkCount++] = ( b2StateHashChunk ){
+			.setIndex = setIndex,
+			.colorIndex = colorIndex,
+			.start = start,
+			.count = b2MinInt( B2_STATE_HASH_CHUNK_SIZE, itemCount - start ),
+		};
 	}
 
-	b2WakeBody( world, body );
+	return chunkCount;
+}
 
-	if ( body->setIndex != b2_awakeSet )
+static int b2GetStateHashChunkCount( int itemCount )
+{
+	return ( itemCount + B2_STATE_HASH_CHUNK_SIZE - 1 ) / B2_STATE_HASH_CHUNK_SIZE;
+}
+
+uint32_t b2World_ComputeStateHash( b2WorldId worldId, bool includeContacts )
+{
+	b2World* world = b3GetUnlockedWorldFromId( worldId );
+	if ( world == NULL || world->isStepAsync )
 	{
-		return true;
+		return 0;
 	}
 
-	b2Vec2 closestPoint = output.pointA;
-	if ( output.distance == 0.0f )
+	b2TracyCZoneNC( state_hash, "State Hash", b2_colorDarkSeaGreen, true );
+
+	// Awake and kinematic set bodies, then sleeping bodies by solver set. Static and disabled bodies do not move.
+	int chunkCapacity = 0;
+	for ( int setIndex = b2_awakeSet; setIndex < world->solverSets.count; ++setIndex )
 	{
-		b2Vec2 localCentroid = b2GetShapeCentroid( shape );
-		closestPoint = b2TransformPoint( transform, localCentroid );
+		chunkCapacity += b2GetStateHashChunkCount( world->solverSets.data[setIndex].bodySims.count );
 	}
 
-	b2Vec2 direction = b2Sub( closestPoint, explosionContext->position );
-	if ( b2LengthSquared( direction ) > 100.0f * FLT_EPSILON * FLT_EPSILON )
+	b2ConstraintGraph* graph = &world->constraintGraph;
+	if ( includeContacts )
 	{
-		direction = b2Normalize( direction );
+		for ( int colorIndex = 0; colorIndex < B2_GRAPH_COLOR_COUNT; ++colorIndex )
+		{
+			chunkCapacity += b2GetStateHashChunkCount( graph->colors[colorIndex].contactSims.count );
+		}
 	}
-	else
+
+	b2StateHashChunk* chunks =
+		b2StackAlloc( &world->stack, b2MaxInt( 1, chunkCapacity ) * (int)sizeof( b2StateHashChunk ), "state hash" );
+
+	int chunkCount = 0;
+	for ( int setIndex = b2_awakeSet; setIndex < world->solverSets.count; ++setIndex )
 	{
-		direction = (b2Vec2){ 1.0f, 0.0f };
+		int bodyCount = world->solverSets.data[setIndex].bodySims.count;
+		chunkCount = b2AddStateHashChunks( chunks, chunkCount, setIndex, B2_NULL_INDEX, bodyCount );
 	}
 
-	b2Vec2 localLine = b2InvRotateVector( transform.q, b2LeftPerp( direction ) );
-	float perimeter = b2GetShapeProjectedPerimeter( shape, localLine );
-	float scale = 1.0f;
-	if ( output.distance > radius && falloff > 0.0f )
+	if ( includeContacts )
 	{
-		scale = b2ClampFloat( ( radius + falloff - output.distance ) / falloff, 0.0f, 1.0f );
+		for ( int colorIndex = 0; colorIndex < B2_GRAPH_COLOR_COUNT; ++colorIndex )
+		{
+			int contactCount = graph->colors[colorIndex].contactSims.count;
+			chunkCount = b2AddStateHashChunks( chunks, chunkCount, B2_NULL_INDEX, colorIndex, contactCount );
+		}
 	}
 
-	float magnitude = explosionContext->impulsePerLength * perimeter * scale;
-	b2Vec2 impulse = b2MulSV( magnitude, direction );
-
-	int localIndex = body->localIndex;
-	b2SolverSet* set = b2Array_Get( world->solverSets, b2_awakeSet );
-	b2BodyState* state = b2Array_Get( set->bodyStates, localIndex );
-	b2BodySim* bodySim = b2Array_Get( set->bodySims, localIndex );
-	state->linearVelocity = b2MulAdd( state->linearVelocity, bodySim->invMass, impulse );
-	state->angularVelocity += bodySim->invInertia * b2Cross( b2Sub( closestPoint, bodySim->center ), impulse );
-
-	return true;
-}
+	B2_ASSERT( chunkCount == chunkCapacity );
 
-void b2World_Explode( b2WorldId worldId, const b2ExplosionDef* explosionDef )
-{
-	uint64_t maskBits = explosionDef->maskBits;
-	b2Vec2 position = explosionDef->position;
-	float radius = explosionDef->radius;
-	float falloff = explosionDef->falloff;
-	float impulsePerLength = explosionDef->impulsePerLength;
+	// All tasks from the last step are finished so the task slots can be reused
+	world->taskCount = 0;
+	if ( world->scheduler != NULL )
+	{
+		b2ResetScheduler( world->scheduler );
+	}
 
-	B2_ASSERT( b2IsValidVec2( position ) );
-	B2_ASSERT( b2IsValidFloat( radius ) && radius >= 0.0f );
-	B2_ASSERT( b2IsValidFloat( falloff ) && falloff >= 0.0f );
-	B2_ASSERT( b2IsValidFloat( impulsePerLength ) );
+	b2StateHashContext context = { world, chunks };
+	b2ParallelFor( world, b2StateHashTask, chunkCount, 4, &context );
 
-	b2World* world = b2GetWorldFromId( worldId );
-	B2_ASSERT( world->locked == false );
-	if ( world->locked )
+	uint32_t hash = B2_HASH_INIT;
+	for ( int i = 0; i < chunkCount; ++i )
 	{
-		return;
+		hash = b2Hash( hash, (const uint8_t*)&chunks[i].hash, sizeof( uint32_t ) );
 	}
 
-	struct ExplosionContext explosionContext = { world, position, radius, falloff, impulsePerLength };
+	b2StackFree( &world->stack, chunks );
 
-	b2AABB aabb;
-	aabb.lowerBound.x = position.x - ( radius + falloff );
-	aabb.lowerBound.y = position.y - ( radius + falloff );
-	aabb.upperBound.x = position.x + ( radius + falloff );
-	aabb.upperBound.y = position.y + ( radius + falloff );
+	b2TracyCZoneEnd( state_hash );
 
-	b2DynamicTree_Query( world->broadPhase.trees + b2_dynamicBody, aabb, maskBits, ExplosionCallback, &explosionContext );
+	return hash;
 }
 
-void b2World_RebuildStaticTree( b2WorldId worldId )
+void b2World_Compact( b2WorldId worldId )
 {
 	b2World* world = b2GetWorldFromId( worldId );
 	B2_ASSERT( world->locked == false );
@@ -2723,8 +7313,101 @@ void b2World_RebuildStaticTree( b2WorldId worldId )
 		return;
 	}
 
-	b2DynamicTree* staticTree = world->broadPhase.trees + b2_staticBody;
-	b2DynamicTree_Rebuild( staticTree, true );
+	b2TracyCZoneNC( compact, "Compact", b2_colorDarkSeaGreen, true );
+
+	world->bodyRefEpoch += 1;
+
+	// Release trailing free slots of the sparse arrays. Live ids are never renumbered.
+	{
+		int count = b2TrimIdPool( &world->bodyIdPool );
+		for ( int i = count; i < world->bodies.count; ++i )
+		{
+			world->bodyGenerationFloor = (uint16_t)b2MaxInt( world->bodyGenerationFloor, world->bodies.data[i].generation );
+		}
+		world->bodies.count = count;
+		b2Array_ShrinkToFit( world->bodies, 0 );
+	}
+
+	{
+		int count = b2TrimIdPool( &world->shapeIdPool );
+		for ( int i = count; i < world->shapes.count; ++i )
+		{
+			world->shapeGenerationFloor = (uint16_t)b2MaxInt( world->shapeGenerationFloor, world->shapes.data[i].generation );
+		}
+		world->shapes.count = count;
+		b2Array_ShrinkToFit( world->shapes, 0 );
+	}
+
+	{
+		int count = b2TrimIdPool( &world->chainIdPool );
+		for ( int i = count; i < world->chainShapes.count; ++i )
+		{
+			world->chainGenerationFloor = (uint16_t)b2MaxInt( world->chainGenerationFloor, world->chainShapes.data[i].generation );
+		}
+		world->chainShapes.count = count;
+		b2Array_ShrinkToFit( world->chainShapes, 0 );
+	}
+
+	{
+		int count = b2TrimIdPool( &world->jointIdPool );
+		for ( int i = count; i < world->joints.count; ++i )
+		{
+			world->jointGenerationFloor = (uint16_t)b2MaxInt( world->jointGenerationFloor, world->joints.data[i].generation );
+		}
+		world->joints.count = count;
+		b2Array_ShrinkToFit( world->joints, 0 );
+	}
+
+	{
+		int count = b2TrimIdPool( &world->contactIdPool );
+		for ( int i = count; i < world->contacts.count; ++i )
+		{
+			uint32_t generation = world->contacts.data[i].generation;
+			world->contactGenerationFloor = generation > world->contactGenerationFloor ? generation : world->contactGenerationFloor;
+		}
+		world->contacts.count = count;
+		b2Array_ShrinkToFit( world->contacts, 0 );
+	}
+
+	world->islands.count = b2TrimIdPool( &world->islandIdPool );
+	b2Array_ShrinkToFit( world->islands, 0 );
+
+	world->solverSets.count = b2TrimIdPool( &world->solverSetIdPool );
+	b2Array_ShrinkToFit( world->solverSets, 0 );
+
+	// Release the unused capacity of the dense arrays
+	for ( int setIndex = 0; setIndex < world->solverSets.count; ++setIndex )
+	{
+		b2SolverSet* set = world->solverSets.data + setIndex;
+		if ( set->setIndex == B2_NULL_INDEX )
+		{
+			continue;
+		}
+
+		b2Array_ShrinkToFit( set->bodySims, 0 );
+		b2Array_ShrinkToFit( set->bodyStates, 0 );
+		b2Array_ShrinkToFit( set->jointSims, 0 );
+		b2Array_ShrinkToFit( set->contactSims, 0 );
+		b2Array_ShrinkToFit( set->compactContactSims, 0 );
+		b2Array_ShrinkToFit( set->islandSims, 0 );
+	}
+
+	for ( int colorIndex = 0; colorIndex < B2_GRAPH_COLOR_COUNT; ++colorIndex )
+	{
+		b2GraphColor* color = world->constraintGraph.colors + colorIndex;
+		b2Array_ShrinkToFit( color->contactSims, 0 );
+		b2Array_ShrinkToFit( color->jointSims, 0 );
+	}
+
+	b2Array_ShrinkToFit( world->sensors, 0 );
+
+	b2CompactBroadPhase( world );
+	b2MarkAllDirty( world );
+
+	b2ValidateSolverSets( world );
+	b2ValidateContacts( world );
+
+	b2TracyCZoneEnd( compact );
 }
 
 void b2World_EnableSpeculative( b2WorldId worldId, bool flag )
@@ -2861,6 +7544,13 @@ void b2ValidateSolverSets( b2World* world )
 				B2_ASSERT( set->bodySims.count == set->bodyStates.count );
 				B2_ASSERT( set->jointSims.count == 0 );
 			}
+			else if ( setIndex == b2_kinematicSet )
+			{
+				B2_ASSERT( set->bodySims.count == set->bodyStates.count );
+				B2_ASSERT( set->bodySims.count == set->islandSims.count );
+				B2_ASSERT( set->contactSims.count == 0 );
+				B2_ASSERT( set->jointSims.count == 0 );
+			}
 			else
 			{
 				B2_ASSERT( set->bodyStates.count == 0 );
@@ -2890,6 +7580,11 @@ void b2ValidateSolverSets( b2World* world )
 					{
 						B2_ASSERT( body->headContactKey == B2_NULL_INDEX );
 					}
+					else if ( setIndex == b2_kinematicSet )
+					{
+						B2_ASSERT( body->type == b2_kinematicBody );
+						B2_ASSERT( body->headJointKey == B2_NULL_INDEX );
+					}
 
 					// Validate body shapes
 					int prevShapeId = B2_NULL_INDEX;
@@ -2994,6 +7689,18 @@ void b2ValidateSolverSets( b2World* world )
 					B2_ASSERT( contact->colorIndex == B2_NULL_INDEX );
 					B2_ASSERT( contact->localIndex == i );
 				}
+
+				B2_ASSERT( set->compactContactSims.count == 0 || b2IsCompactContactSet( world, setIndex ) );
+				B2_ASSERT( set->contactSims.count == 0 || b2IsCompactContactSet( world, setIndex ) == false );
+				totalContactCount += set->compactContactSims.count;
+				for ( int i = 0; i < set->compactContactSims.count; ++i )
+				{
+					b2CompactContactSim* contactSim = set->compactContactSims.data + i;
+					b2Contact* contact = b2Array_Get( world->contacts, contactSim->contactId );
+					B2_ASSERT( contact->setIndex == setIndex );
+					B2_ASSERT( contact->colorIndex == B2_NULL_INDEX );
+					B2_ASSERT( contact->localIndex == i );
+				}
 			}
 
 			// Validate joints
@@ -3197,6 +7904,18 @@ void b2ValidateContacts( b2World* world )
 			B2_ASSERT( touching == false && setId == b2_disabledSet );
 		}
 
+		if ( b2IsCompactContactSet( world, setId ) )
+		{
+			b2SolverSet* set = b2Array_Get( world->solverSets, setId );
+			b2CompactContactSim* compactSim = b2Array_Get( set->compactContactSims, contact->localIndex );
+			B2_ASSERT( compactSim->contactId == contactIndex );
+			B2_ASSERT( compactSim->bodyIdA == contact->edges[0].bodyId );
+			B2_ASSERT( compactSim->bodyIdB == contact->edges[1].bodyId );
+			B2_ASSERT( ( compactSim->simFlags & b2_simTouchingFlag ) != 0 );
+			B2_ASSERT( 0 < compactSim->pointCount && compactSim->pointCount <= 2 );
+			continue;
+		}
+
 		b2ContactSim* contactSim = b2GetContactSim( world, contact );
 		B2_ASSERT( contactSim->contactId == contactIndex );
 		B2_ASSERT( contactSim->bodyIdA == contact->edges[0].bodyId );
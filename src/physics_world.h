@@ -8,39 +8,101 @@
 #include "broad_phase.h"
 #include "constraint_graph.h"
 #include "container.h"
+#include "core.h"
 #include "id_pool.h"
+#include "island.h"
+#include "parallel_for.h"
+#include "particle.h"
+#include "recorder.h"
 #include "sensor.h"
 #include "shape.h"
+#include "solver.h"
+#include "snapshot.h"
 #include "solver_set.h"
 
 #include "box2d/types.h"
 
+b2DeclareArray( b2AABB );
+b2DeclareArray( b2BodyCommand );
 b2DeclareArray( b2BodyMoveEvent );
+b2DeclareArray( b2BodyMoveDelta );
 b2DeclareArray( b2ContactBeginTouchEvent );
 b2DeclareArray( b2ContactEndTouchEvent );
 b2DeclareArray( b2ContactHitEvent );
 b2DeclareArray( b2JointEvent );
-b2DeclareArray( b2SensorBeginTouchEvent );
-b2DeclareArray( b2SensorEndTouchEvent );
+b2DeclareArray( b2OverlapHit );
+b2DeclareArray( b2Transform );
 b2DeclareArray( b2TaskContext );
+b2DeclareArray( b2DrawPrimitive );
+
+// A shape found by a batched debug draw and the output range of its primitives
+typedef struct b2DrawItem
+{
+	int shapeId;
+	int primitiveIndex;
+	int vertexIndex;
+} b2DrawItem;
+
+b2DeclareArray( b2DrawItem );
+
+#define B2_COUNTER_BUCKET_COUNT 8
+
+// Detailed counters of one worker for the last step, see b2World_EnableDetailedCounters
+typedef struct b2DetailedCounters
+{
+	int pairNodeVisits;
+	int pairLeafVisits;
+	int pairHeapBlockCount;
+	int manifoldCalls[B2_SHAPE_PAIR_TYPE_COUNT];
+	int toiIterations[B2_COUNTER_BUCKET_COUNT];
+	int gjkIterations[B2_COUNTER_BUCKET_COUNT];
+	int untouchedContactCount;
+	int enlargedProxyCount;
+	int marginPairCount;
+} b2DetailedCounters;
+
+// Histogram bucket of a positive count, see b2Counters::toiIterations
+static inline int b2GetCounterBucket( int count )
+{
+	int bucket = 0;
+	while ( count > 1 && bucket < B2_COUNTER_BUCKET_COUNT - 1 )
+	{
+		count >>= 1;
+		bucket += 1;
+	}
+
+	return bucket;
+}
 
 // Per thread task storage
 typedef struct b2TaskContext
 {
+	// Scratch memory for tasks running on this worker. Reset at the end of the step.
+	b2Arena arena;
+
 	// Collect per thread sensor continuous hit events.
 	b2Array(b2SensorHit) sensorHits;
 
+	// Per thread results of batched overlap queries
+	b2Array( b2OverlapHit ) overlapHits;
+
+	// Per thread candidate pairs gathered for continuous collision
+	b2Array( b2ContinuousPair ) continuousPairs;
+
+	// Forces, impulses and velocities queued by the user for the next step. Applied in worker order.
+	b2Array( b2BodyCommand ) bodyCommands;
+
 	// These bits align with the contact id capacity and signal a change in contact status
 	b2BitSet contactStateBitSet;
 
-	// These bits align with the contact id capacity and signal a hit event.
-	b2BitSet hitEventBitSet;
+	// Hit events of the contacts whose impulses this worker stored, in solver order
+	b2Array( b2ContactHitEvent ) hitEvents;
 
-	// Fast-path flag: true when this worker set at least one bit in hitEventBitSet this step.
-	bool hasHitEvents;
+	// Ids of joints that crossed their force or torque threshold this step
+	b2Array( int ) jointEventIds;
 
-	// These bits align with the joint id capacity and signal a change in contact status
-	b2BitSet jointStateBitSet;
+	// Shapes of the bodies finalized by this worker, per shape type. Their AABBs are updated in a second pass.
+	b2Array( b2ShapeAABBUpdate ) aabbUpdates[b2_shapeTypeCount];
 
 	// Used to track bodies with shapes that have enlarged AABBs. This avoids having a bit array
 	// that is very large when there are many static shapes.
@@ -49,15 +111,51 @@ typedef struct b2TaskContext
 	// Used to put islands to sleep
 	b2BitSet awakeIslandBitSet;
 
-	// Per worker split island candidate
-	float splitSleepTime;
-	int splitIslandId;
+	// Kinematic bodies finalized by this worker that may leave the awake set for the kinematic set
+	b2Array( int ) kinematicBodyIds;
+
+	// Contact events gathered by this worker with relaxed determinism
+	b2Array( b2ContactBeginTouchEvent ) contactBeginEvents;
+	b2Array( b2ContactEndTouchEvent ) contactEndEvents;
+
+	// Per worker split island candidates, sorted by decreasing sleep time
+	b2SplitCandidate splitCandidates[B2_MAX_ISLAND_SPLITS];
+	int splitCandidateCount;
 
 	// Number of contacts recycled this step (collide pass).
 	int recycledContactCount;
 
+	// Number of contacts separated by their cached separating axis this step (collide pass).
+	int cachedAxisContactCount;
+
+	// Number of non-touching contacts kept apart by their separation bound this step (collide pass).
+	int separatedContactCount;
+
+	// Solver profile of this worker for the last step, see b2World_GetWorkerProfile
+	b2WorkerProfile workerProfile;
+
+	b2DetailedCounters detailedCounters;
+
 } b2TaskContext;
 
+// The static hit of a b2World_CastRayClosest call. The key holds the ray end points snapped to a grid.
+typedef struct b2RayCacheEntry
+{
+	int key[4];
+	b2QueryFilter filter;
+	uint32_t staticRevision;
+	bool valid;
+
+	b2Vec2 origin;
+	b2Vec2 translation;
+
+	// The closest static hit, with shapeId null for a miss
+	b2ShapeId shapeId;
+	b2Vec2 point;
+	b2Vec2 normal;
+	float fraction;
+} b2RayCacheEntry;
+
 // The world struct manages all physics entities, dynamic simulation,  and asynchronous queries.
 // The world also contains efficient memory management facilities.
 typedef struct b2World
@@ -114,11 +212,52 @@ typedef struct b2World
 	// This is a dense array of sensor data.
 	b2Array( b2Sensor ) sensors;
 
+	// Sensor bounds for incremental sensor updates. The user data is the sensor shape id and the
+	// category bits are the sensor mask bits, so a query with the category bits of a visitor finds
+	// the sensors that may detect it. Only maintained while incremental sensors are enabled.
+	b2DynamicTree sensorTree;
+
+	// Broad-phase revision seen by the last sensor update. A changed revision or the full update flag
+	// means proxies were created, destroyed or moved outside the step and all sensors are updated.
+	uint32_t sensorRevision;
+	bool sensorFullUpdate;
+	int sensorUpdateCount;
+
+	// Shape ids of sensors that were marked dirty by incremental mode before they were due
+	b2Array( int ) pendingSensorIds;
+
+	// Objects changed since the key frame, which is the last full snapshot taken or restored. Delta
+	// snapshots hold only these. Changes inside solver sets mark the set, and the objects of dirty sets
+	// are added when a delta is written. The key is zero until the first snapshot and nothing is
+	// tracked before that.
+	b2BitSet dirtyBitSets[b2_dirtyTypeCount];
+	uint32_t snapshotKey;
+
+	// Slots released by b2World_Compact may be pushed again later. New slots start from these
+	// generations so stale ids that referenced a released slot remain invalid.
+	uint16_t bodyGenerationFloor;
+	uint16_t shapeGenerationFloor;
+	uint16_t chainGenerationFloor;
+	uint16_t jointGenerationFloor;
+	uint32_t contactGenerationFloor;
+
 	// Per thread storage
 	b2Array( b2TaskContext ) taskContexts;
 	b2Array( b2SensorTaskContext ) sensorTaskContexts;
 
 	b2Array( b2BodyMoveEvent ) bodyMoveEvents;
+
+	// Move events that passed the move event thresholds, and their compact deltas. Only used when
+	// filterMoveEvents is set. bodyMoveEvents always holds every awake body for internal use.
+	b2Array( b2BodyMoveEvent ) reportedMoveEvents;
+	b2Array( b2BodyMoveDelta ) moveDeltas;
+	float moveEventLinearThreshold;
+	float moveEventAngularThreshold;
+	float moveEventQuantum;
+	bool filterMoveEvents;
+	float jointPrepareTolerance;
+	int islandSolveBodyCount;
+	float bodyOrderThreshold;
 	b2Array( b2SensorBeginTouchEvent ) sensorBeginEvents;
 	b2Array( b2ContactBeginTouchEvent ) contactBeginEvents;
 
@@ -130,14 +269,9 @@ typedef struct b2World
 	b2Array( b2ContactHitEvent ) contactHitEvents;
 	b2Array( b2JointEvent ) jointEvents;
 
-	// todo consider deferred waking and impulses to make it possible
-	// to apply forces and impulses from multiple threads
-	// impulses must be deferred because sleeping bodies have no velocity state
-	// Problems:
-	// - multiple forces applied to the same body from multiple threads
-	// Deferred wake
-	// b2BitSet bodyWakeSet;
-	// b2ImpulseArray deferredImpulses;
+	// Forces and impulses from multiple threads are queued in b2TaskContext::bodyCommands. They are
+	// deferred to the next step because sleeping bodies have no velocity state, and so several threads
+	// may target the same body without a race.
 
 	// Used to track debug draw
 	b2BitSet debugBodySet;
@@ -145,9 +279,50 @@ typedef struct b2World
 	b2BitSet debugContactSet;
 	b2BitSet debugIslandSet;
 
+	// Batched debug draw output, see b2DebugDraw::DrawBatchFcn
+	b2Array( b2DrawItem ) debugDrawItems;
+	b2Array( b2DrawPrimitive ) debugPrimitives;
+	b2Array( b2Vec2 ) debugVertices;
+
 	// Id that is incremented every time step
 	uint64_t stepIndex;
 
+	// Island level of detail is skipped while there are no bodies with a simulation interval above one
+	// and no parked sets. See b2BodyDef::simulationInterval.
+	int lodBodyCount;
+	int parkedSetCount;
+
+	// Bodies woken from parked sets that are simulated with a time scale in the next step
+	b2Array( b2LodBody ) lodBodies;
+
+	// Body transforms at the start of the last step, indexed by body id. Written by the finalize of
+	// awake and kinematic bodies. See b2WorldDef::enableInterpolation.
+	b2Array( b2Transform ) previousTransforms;
+
+	// User buffer for the state export and its arrays, see b2World_SetExportBuffer. The capacity is
+	// kept here rather than read back from the header because the buffer may be shared with another process.
+	b2ExportHeader* exportHeader;
+	b2Vec2* exportPositions;
+	b2Rot* exportRotations;
+	b2Vec2* exportLinearVelocities;
+	float* exportAngularVelocities;
+	int exportCapacity;
+	uint32_t exportSequence;
+
+#ifdef BOX2D_PROFILE
+	// Solver waits shown as Tracy lock contention. The main thread waits on the stage lock for the
+	// blocks of a stage to finish and the workers wait on the sync lock for the next stage.
+	b2TracyCLockCtx( stageLock );
+	b2TracyCLockCtx( syncLock );
+#endif
+
+	// Regions of interest, see b2World_SetActiveRegions
+	b2Array( b2AABB ) activeRegions;
+	int frozenSetCount;
+
+	// See b2World_CreateParticles
+	b2ParticleSystem particles;
+
 	// Identify islands for splitting as follows:
 	// - I want to split islands so smaller islands can sleep
 	// - when a body comes to rest and its sleep timer trips, I can look at the island and flag it for splitting
@@ -155,12 +330,21 @@ typedef struct b2World
 	// - islands that have removed constraints must be put split first because I don't want to wake bodies incorrectly
 	// - otherwise I can use the awake islands that have bodies wanting to sleep as the splitting candidates
 	// - if no bodies want to sleep then there is no reason to perform island splitting
-	int splitIslandId;
+	// Several islands may be split per step. These are sorted by decreasing priority.
+	int splitIslandIds[B2_MAX_ISLAND_SPLITS];
+	int splitIslandCount;
+	int maxIslandSplits;
+	int contactPrefetchDistance;
+
+	// Advanced for each incremental island split search. See b2Body::islandStamp.
+	uint64_t islandStamp;
 
 	b2Vec2 gravity;
 	float hitEventThreshold;
+	b2ContactEventFilter contactEventFilter;
 	float restitutionThreshold;
 	float maxLinearSpeed;
+	int treeOptimizationBudget;
 	float contactSpeed;
 	float contactHertz;
 	float contactDampingRatio;
@@ -171,8 +355,14 @@ typedef struct b2World
 
 	uint16_t generation;
 
+	// Expires the b2BodyRef handed out so far. Bumped by each step and by any change that moves or
+	// reallocates body sims and states.
+	uint32_t bodyRefEpoch;
+
 	b2Profile profile;
 
+	// Capacity from the world definition and peak capacity used
+	b2Capacity capacity;
 	b2Capacity maxCapacity;
 
 	b2PreSolveFcn* preSolveFcn;
@@ -181,14 +371,50 @@ typedef struct b2World
 	b2CustomFilterFcn* customFilterFcn;
 	void* customFilterContext;
 
+	b2PreSolveBatchFcn* preSolveBatchFcn;
+	void* preSolveBatchContext;
+
+	b2CustomFilterBatchFcn* customFilterBatchFcn;
+	void* customFilterBatchContext;
+
 	int workerCount;
 	b2EnqueueTaskCallback* enqueueTaskFcn;
+	b2EnqueueTaskExCallback* enqueueTaskExFcn;
 	b2FinishTaskCallback* finishTaskFcn;
 	void* userTaskContext;
 	void* userTreeTask;
 
+	// Asynchronous step in flight, see b2World_StepAsync
+	void* userStepTask;
+	float asyncTimeStep;
+	int asyncSubStepCount;
+
+	// Static hits of recent b2World_CastRayClosest calls, see b2WorldDef::rayCacheCapacity
+	b2RayCacheEntry* rayCache;
+	int rayCacheCapacity;
+
+	// Milliseconds allowed for the step in progress, zero for no budget. See b2World_StepWithBudget.
+	float stepBudget;
+
+	// Static body sims captured before an asynchronous step. The solver set array may grow during
+	// the step so queries cannot go through it.
+	b2BodySim* asyncStaticSims;
+
+	// Static tree being rebuilt on a thread from a copy of the live static tree, see
+	// b2World_RebuildStaticTreeAsync. Swapped in at the start of the first step after it is done.
+	b2DynamicTree staticRebuildTree;
+	b2Thread* staticRebuildThread;
+	b2AtomicInt staticRebuildDone;
+
 	struct b2Scheduler* scheduler;
 
+	b2WaitPolicy waitPolicy;
+	int waitSpinCount;
+
+	// Call sites of b2ParallelFor with adaptive block sizing
+	b2ParallelForSite parallelForSites[B2_MAX_PARALLEL_FOR_SITES];
+	int parallelForSiteCount;
+
 	void* userData;
 
 	// Remember type step used for reporting forces and torques
@@ -201,14 +427,71 @@ typedef struct b2World
 	int activeTaskCount;
 	int taskCount;
 
+	// Workers used by the constraint solver in the most recent step
+	int solverWorkerCount;
+
+	// Graph colors solved by the main thread alone in the most recent step
+	int inlineColorCount;
+
+	// Heap allocations made by the most recent step
+	int stepAllocationCount;
+
+	// Step events reported by b2World_GetCounters. Solver sets woken between steps are counted
+	// with the following step.
+	int stepSplitIslandCount;
+	int wokenSetCount;
+	int stepWokenSetCount;
+	int stackGrowth;
+	int rebuiltLeafCount;
+	int reorderedBodyCount;
+	int sortedContactCount;
+	int balancedContactCount;
+
+	// Recording of the API calls, see b2WorldDef::enableRecording
+	b2Recorder* recorder;
+
+	// Recording replayed by b2World_ReplayStep, owned by the caller
+	const uint8_t* replayData;
+	int replaySize;
+	int replayOffset;
+
+	// Compounds rebuilt for the recorded compound shapes, owned by the world
+	b2Compound** replayCompounds;
+	int replayCompoundCount;
+	int replayCompoundCapacity;
+
 	uint16_t worldId;
 
 	bool enableSleep;
 	bool locked;
+	bool isStepAsync;
 	bool enableWarmStarting;
 	bool enableContactSoftening;
 	bool enableContinuous;
+	bool enableContinuousCache;
+	bool enableParallelOverflow;
+	bool enableAdaptiveColoring;
+	bool enableAdaptiveRelax;
+	bool enableAllocationCheck;
+	bool enableParallelContacts;
+	bool enableRelaxedDeterminism;
+	bool enableSortedCollide;
+	bool enablePipelinedCollide;
+	bool enableFusedPrepare;
+	bool enableIncrementalIslands;
+	bool enableIncrementalSensors;
+	bool enableIncrementalPairs;
+	bool enableCompactContacts;
+	int compactSleepSteps;
+	bool enableVelocityMargins;
+	bool enableAdaptiveBlocks;
+	bool enableContactOrdering;
+	bool enableColorBalancing;
+	bool enableInterpolation;
+	bool enableAutoWorkers;
 	bool enableSpeculative;
+	bool enableWorkerProfile;
+	bool enableDetailedCounters;
 	bool inUse;
 } b2World;
 
@@ -216,6 +499,57 @@ b2World* b2GetWorldFromId( b2WorldId id );
 b2World* b2GetWorld( int index );
 b2World* b2GetWorldLocked( int index );
 
+// Record a change for delta snapshots, see b2World::dirtyBitSets
+static inline void b2MarkDirty( b2World* world, b2DirtyType type, int id )
+{
+	if ( world->snapshotKey != 0 )
+	{
+		B2_ASSERT( id >= 0 );
+		b2SetBitGrow( world->dirtyBitSets + type, id );
+	}
+}
+
+// Enqueue a task with the user task system, passing the scheduling hints if it takes them
+static inline void* b2EnqueueTask( b2World* world, b2TaskCallback* task, void* taskContext, const b2TaskInfo* info )
+{
+	if ( world->enqueueTaskExFcn != NULL )
+	{
+		return world->enqueueTaskExFcn( task, taskContext, info, world->userTaskContext );
+	}
+
+	return world->enqueueTaskFcn( task, taskContext, world->userTaskContext );
+}
+
+// Union the bit set at this offset in b2TaskContext of all workers into the bit set of worker 0.
+// Large bit sets are split into word ranges across the workers.
+void b2UnionWorkerBitSets( b2World* world, size_t bitSetOffset );
+
+// Restart interpolation from the current body transforms
+void b2ResetInterpolation( b2World* world );
+
+// Write the state of a body to its export slot. Only valid between b2BeginExport and b2EndExport.
+// Slots are disjoint so workers may write concurrently.
+static inline void b2WriteExportSlot( b2World* world, int slot, b2Transform transform, b2Vec2 linearVelocity,
+									  float angularVelocity )
+{
+	if ( slot < 0 || world->exportCapacity <= slot )
+	{
+		return;
+	}
+
+	world->exportPositions[slot] = transform.p;
+	world->exportRotations[slot] = transform.q;
+	world->exportLinearVelocities[slot] = linearVelocity;
+	world->exportAngularVelocities[slot] = angularVelocity;
+}
+
+// Open and close a write of the export buffer. Does nothing without an export buffer.
+void b2BeginExport( b2World* world );
+void b2EndExport( b2World* world );
+
+// Write the current state of a body outside of the step, between b2BeginExport and b2EndExport
+void b2ExportBody( b2World* world, b2Body* body );
+
 void b2ValidateConnectivity( b2World* world );
 void b2ValidateSolverSets( b2World* world );
 void b2ValidateContacts( b2World* world );
@@ -15,7 +15,7 @@
 
 void b2PrismaticJoint_EnableSpring( b2JointId jointId, bool enableSpring )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_prismaticJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_prismaticJoint );
 	if ( enableSpring != joint->prismaticJoint.enableSpring )
 	{
 		joint->prismaticJoint.enableSpring = enableSpring;
@@ -31,7 +31,7 @@ bool b2PrismaticJoint_IsSpringEnabled( b2JointId jointId )
 
 void b2PrismaticJoint_SetSpringHertz( b2JointId jointId, float hertz )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_prismaticJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_prismaticJoint );
 	joint->prismaticJoint.hertz = hertz;
 }
 
@@ -43,7 +43,7 @@ float b2PrismaticJoint_GetSpringHertz( b2JointId jointId )
 
 void b2PrismaticJoint_SetSpringDampingRatio( b2JointId jointId, float dampingRatio )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_prismaticJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_prismaticJoint );
 	joint->prismaticJoint.dampingRatio = dampingRatio;
 }
 
@@ -55,7 +55,7 @@ float b2PrismaticJoint_GetSpringDampingRatio( b2JointId jointId )
 
 void b2PrismaticJoint_SetTargetTranslation( b2JointId jointId, float translation )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_prismaticJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_prismaticJoint );
 	joint->prismaticJoint.targetTranslation = translation;
 }
 
@@ -67,7 +67,7 @@ float b2PrismaticJoint_GetTargetTranslation( b2JointId jointId )
 
 void b2PrismaticJoint_EnableLimit( b2JointId jointId, bool enableLimit )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_prismaticJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_prismaticJoint );
 	if ( enableLimit != joint->prismaticJoint.enableLimit )
 	{
 		joint->prismaticJoint.enableLimit = enableLimit;
@@ -98,7 +98,7 @@ void b2PrismaticJoint_SetLimits( b2JointId jointId, float lower, float upper )
 {
 	B2_ASSERT( lower <= upper );
 
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_prismaticJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_prismaticJoint );
 	if ( lower != joint->prismaticJoint.lowerTranslation || upper != joint->prismaticJoint.upperTranslation )
 	{
 		joint->prismaticJoint.lowerTranslation = b2MinFloat( lower, upper );
@@ -110,7 +110,7 @@ void b2PrismaticJoint_SetLimits( b2JointId jointId, float lower, float upper )
 
 void b2PrismaticJoint_EnableMotor( b2JointId jointId, bool enableMotor )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_prismaticJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_prismaticJoint );
 	if ( enableMotor != joint->prismaticJoint.enableMotor )
 	{
 		joint->prismaticJoint.enableMotor = enableMotor;
@@ -126,7 +126,7 @@ bool b2PrismaticJoint_IsMotorEnabled( b2JointId jointId )
 
 void b2PrismaticJoint_SetMotorSpeed( b2JointId jointId, float motorSpeed )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_prismaticJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_prismaticJoint );
 	joint->prismaticJoint.motorSpeed = motorSpeed;
 }
 
@@ -145,7 +145,7 @@ float b2PrismaticJoint_GetMotorForce( b2JointId jointId )
 
 void b2PrismaticJoint_SetMaxMotorForce( b2JointId jointId, float force )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_prismaticJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_prismaticJoint );
 	joint->prismaticJoint.maxMotorForce = force;
 }
 
@@ -0,0 +1,997 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#include "recorder.h"
+
+#include "core.h"
+#include "physics_world.h"
+
+#include "box2d/box2d.h"
+
+#include <stddef.h>
+#include <string.h>
+
+// A recording holds the world definition and the calls that changed the world, so a capture of a game
+// can be replayed without the game. Like snapshots, recordings are only valid for the build that
+// wrote them because definitions are stored as raw structs.
+#define B2_RECORDING_MAGIC 0x43523242
+#define B2_RECORDING_VERSION 2
+
+typedef struct b2RecordingHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	int layoutSize;
+} b2RecordingHeader;
+
+// Catches recordings written by a build with different definitions
+static int b2GetRecordingLayoutSize( void )
+{
+	return (int)( sizeof( b2WorldDef ) + sizeof( b2BodyDef ) + sizeof( b2ShapeDef ) + sizeof( b2ChainDef ) +
+				  sizeof( b2Polygon ) + sizeof( b2BodyCommand ) + sizeof( b2DistanceJointDef ) + sizeof( b2FilterJointDef ) +
+				  sizeof( b2MotorJointDef ) + sizeof( b2PrismaticJointDef ) + sizeof( b2RevoluteJointDef ) +
+				  sizeof( b2WeldJointDef ) + sizeof( b2WheelJointDef ) );
+}
+
+// Storage for any joint definition. They all begin with b2JointDef.
+typedef union b2AnyJointDef
+{
+	b2JointDef base;
+	b2DistanceJointDef distanceJoint;
+	b2FilterJointDef filterJoint;
+	b2MotorJointDef motorJoint;
+	b2PrismaticJointDef prismaticJoint;
+	b2RevoluteJointDef revoluteJoint;
+	b2WeldJointDef weldJoint;
+	b2WheelJointDef wheelJoint;
+} b2AnyJointDef;
+
+static int b2GetJointDefSize( b2JointType type )
+{
+	switch ( type )
+	{
+		case b2_distanceJoint:
+			return sizeof( b2DistanceJointDef );
+		case b2_filterJoint:
+			return sizeof( b2FilterJointDef );
+		case b2_motorJoint:
+			return sizeof( b2MotorJointDef );
+		case b2_prismaticJoint:
+			return sizeof( b2PrismaticJointDef );
+		case b2_revoluteJoint:
+			return sizeof( b2RevoluteJointDef );
+		case b2_weldJoint:
+			return sizeof( b2WeldJointDef );
+		case b2_wheelJoint:
+			return sizeof( b2WheelJointDef );
+		default:
+			return 0;
+	}
+}
+
+static int b2GetGeometrySize( b2ShapeType type )
+{
+	switch ( type )
+	{
+		case b2_capsuleShape:
+			return sizeof( b2Capsule );
+		case b2_circleShape:
+			return sizeof( b2Circle );
+		case b2_polygonShape:
+			return sizeof( b2Polygon );
+		case b2_segmentShape:
+			return sizeof( b2Segment );
+		default:
+			// Compounds are recorded as their polygons
+			return 0;
+	}
+}
+
+b2Recorder* b2CreateRecorder( const b2WorldDef* def )
+{
+	b2Recorder* recorder = b2Alloc( sizeof( b2Recorder ) );
+	*recorder = ( b2Recorder ){ 0 };
+
+	b2RecordingHeader header = { B2_RECORDING_MAGIC, B2_RECORDING_VERSION, b2GetRecordingLayoutSize() };
+	b2RecordValue( recorder, header );
+
+	// Callbacks and the task system belong to the application
+	b2WorldDef worldDef = *def;
+	worldDef.frictionCallback = NULL;
+	worldDef.restitutionCallback = NULL;
+	worldDef.enqueueTask = NULL;
+	worldDef.enqueueTaskEx = NULL;
+	worldDef.finishTask = NULL;
+	worldDef.userTaskContext = NULL;
+	worldDef.userData = NULL;
+	worldDef.enableRecording = false;
+	b2RecordValue( recorder, worldDef );
+
+	return recorder;
+}
+
+void b2DestroyRecorder( b2Recorder* recorder )
+{
+	b2Free( recorder->data, recorder->capacity );
+	b2Free( recorder, sizeof( b2Recorder ) );
+}
+
+void b2RecordBytes( b2Recorder* recorder, const void* data, int byteCount )
+{
+	B2_ASSERT( byteCount >= 0 );
+	if ( recorder->size + byteCount > recorder->capacity )
+	{
+		int newCapacity = b2MaxInt( 2 * recorder->capacity, recorder->size + byteCount );
+		newCapacity = b2MaxInt( newCapacity, 4096 );
+		recorder->data = b2GrowAlloc( recorder->data, recorder->capacity, newCapacity );
+		recorder->capacity = newCapacity;
+	}
+
+	if ( byteCount > 0 )
+	{
+		memcpy( recorder->data + recorder->size, data, byteCount );
+	}
+
+	recorder->size += byteCount;
+}
+
+void b2RecordCall( b2Recorder* recorder, b2RecordType type )
+{
+	uint8_t value = (uint8_t)type;
+	b2RecordValue( recorder, value );
+}
+
+void b2RecordCreateBody( b2Recorder* recorder, const b2BodyDef* def, b2BodyId bodyId )
+{
+	b2BodyDef bodyDef = *def;
+	bodyDef.name = NULL;
+	bodyDef.userData = NULL;
+
+	b2RecordCall( recorder, b2_recordCreateBody );
+	b2RecordValue( recorder, bodyDef );
+	b2RecordValue( recorder, bodyId );
+}
+
+void b2RecordCreateBodies( b2Recorder* recorder, const b2BodyDef* bodyDefs, const b2ShapeDef* shapeDefs,
+						   const b2Polygon* polygons, int count )
+{
+	b2RecordCall( recorder, b2_recordCreateBodies );
+	b2RecordValue( recorder, count );
+
+	for ( int i = 0; i < count; ++i )
+	{
+		b2BodyDef bodyDef = bodyDefs[i];
+		bodyDef.name = NULL;
+		bodyDef.userData = NULL;
+		b2RecordValue( recorder, bodyDef );
+
+		b2ShapeDef shapeDef = shapeDefs[i];
+		shapeDef.userData = NULL;
+		b2RecordValue( recorder, shapeDef );
+	}
+
+	b2RecordBytes( recorder, polygons, count * (int)sizeof( b2Polygon ) );
+}
+
+// The tile tree is rebuilt by the replay
+void b2RecordCreateTileBody( b2Recorder* recorder, const b2StaticTile* tile, b2BodyId bodyId )
+{
+	b2BodyDef bodyDef = tile->bodyDef;
+	bodyDef.name = NULL;
+	bodyDef.userData = NULL;
+
+	b2ShapeDef shapeDef = tile->shapeDef;
+	shapeDef.userData = NULL;
+
+	b2RecordCall( recorder, b2_recordCreateTileBody );
+	b2RecordValue( recorder, bodyDef );
+	b2RecordValue( recorder, shapeDef );
+	b2RecordValue( recorder, tile->count );
+	b2RecordBytes( recorder, tile->polygons, tile->count * (int)sizeof( b2Polygon ) );
+	b2RecordValue( recorder, bodyId );
+}
+
+void b2RecordCreateShape( b2Recorder* recorder, b2BodyId bodyId, const b2ShapeDef* def, const void* geometry,
+						  b2ShapeType shapeType, b2ShapeId shapeId )
+{
+	b2ShapeDef shapeDef = *def;
+	shapeDef.userData = NULL;
+
+	b2RecordCall( recorder, b2_recordCreateShape );
+	b2RecordValue( recorder, shapeType );
+	b2RecordValue( recorder, bodyId );
+	b2RecordValue( recorder, shapeDef );
+
+	if ( shapeType == b2_compoundShape )
+	{
+		int count = b2Compound_GetPolygonCount( geometry );
+		b2RecordValue( recorder, count );
+		b2RecordBytes( recorder, b2Compound_GetPolygons( geometry ), count * (int)sizeof( b2Polygon ) );
+	}
+	else
+	{
+		b2RecordBytes( recorder, geometry, b2GetGeometrySize( shapeType ) );
+	}
+
+	b2RecordValue( recorder, shapeId );
+}
+
+void b2RecordCreateChain( b2Recorder* recorder, b2BodyId bodyId, const b2ChainDef* def, b2ChainId chainId )
+{
+	b2ChainDef chainDef = *def;
+	chainDef.userData = NULL;
+	chainDef.points = NULL;
+	chainDef.materials = NULL;
+
+	b2RecordCall( recorder, b2_recordCreateChain );
+	b2RecordValue( recorder, bodyId );
+	b2RecordValue( recorder, chainDef );
+	b2RecordBytes( recorder, def->points, def->count * (int)sizeof( b2Vec2 ) );
+	b2RecordBytes( recorder, def->materials, def->materialCount * (int)sizeof( b2SurfaceMaterial ) );
+	b2RecordValue( recorder, chainId );
+}
+
+void b2RecordCreateJoint( b2Recorder* recorder, const void* def, b2JointType jointType, b2JointId jointId )
+{
+	b2AnyJointDef jointDef;
+	int size = b2GetJointDefSize( jointType );
+	memcpy( &jointDef, def, size );
+	jointDef.base.userData = NULL;
+
+	b2RecordCall( recorder, b2_recordCreateJoint );
+	b2RecordValue( recorder, jointType );
+	b2RecordBytes( recorder, &jointDef, size );
+	b2RecordValue( recorder, jointId );
+}
+
+void b2RecordStep( b2World* world, float timeStep, int subStepCount )
+{
+	b2Recorder* recorder = world->recorder;
+
+	int commandCount = 0;
+	for ( int i = 0; i < world->workerCount; ++i )
+	{
+		commandCount += world->taskContexts.data[i].bodyCommands.count;
+	}
+
+	// The step applies the buffers in order, so they are replayed as one buffer
+	if ( commandCount > 0 )
+	{
+		b2RecordCall( recorder, b2_recordBodyCommands );
+		b2RecordValue( recorder, commandCount );
+		for ( int i = 0; i < world->workerCount; ++i )
+		{
+			b2Array( b2BodyCommand )* commands = &world->taskContexts.data[i].bodyCommands;
+			b2RecordBytes( recorder, commands->data, commands->count * (int)sizeof( b2BodyCommand ) );
+		}
+	}
+
+	b2RecordCall( recorder, b2_recordStep );
+	b2RecordValue( recorder, timeStep );
+	b2RecordValue( recorder, subStepCount );
+}
+
+int b2World_GetRecordingSize( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	return world->recorder != NULL ? world->recorder->size : 0;
+}
+
+int b2World_GetRecording( b2WorldId worldId, void* buffer, int capacity )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	b2Recorder* recorder = world->recorder;
+	if ( recorder == NULL || buffer == NULL || capacity < recorder->size )
+	{
+		return 0;
+	}
+
+	memcpy( buffer, recorder->data, recorder->size );
+	return recorder->size;
+}
+
+// Reads a recording that may be truncated or corrupt. Reading past the end marks the reader
+// invalid and returns zeros.
+typedef struct b2ReplayReader
+{
+	const uint8_t* data;
+	int size;
+	int offset;
+	bool valid;
+} b2ReplayReader;
+
+static void b2ReadReplayBytes( b2ReplayReader* reader, void* data, int byteCount )
+{
+	if ( reader->valid == false || byteCount < 0 || reader->size - reader->offset < byteCount )
+	{
+		reader->valid = false;
+		memset( data, 0, byteCount > 0 ? byteCount : 0 );
+		return;
+	}
+
+	memcpy( data, reader->data + reader->offset, byteCount );
+	reader->offset += byteCount;
+}
+
+#define b2ReadReplayValue( reader, value ) b2ReadReplayBytes( reader, &( value ), (int)sizeof( value ) )
+
+// Allocates an array of count elements read from the recording
+static void* b2ReadReplayArray( b2ReplayReader* reader, int count, int elementSize )
+{
+	if ( reader->valid == false || count < 0 || ( reader->size - reader->offset ) / elementSize < count )
+	{
+		reader->valid = false;
+		return NULL;
+	}
+
+	if ( count == 0 )
+	{
+		return NULL;
+	}
+
+	void* data = b2Alloc( count * elementSize );
+	b2ReadReplayBytes( reader, data, count * elementSize );
+	return data;
+}
+
+// Ids are recorded with the index of the recording world
+static b2BodyId b2ReadBodyId( b2ReplayReader* reader, uint16_t worldIndex )
+{
+	b2BodyId id;
+	b2ReadReplayValue( reader, id );
+	id.world0 = worldIndex;
+	return id;
+}
+
+static b2ShapeId b2ReadShapeId( b2ReplayReader* reader, uint16_t worldIndex )
+{
+	b2ShapeId id;
+	b2ReadReplayValue( reader, id );
+	id.world0 = worldIndex;
+	return id;
+}
+
+static b2ChainId b2ReadChainId( b2ReplayReader* reader, uint16_t worldIndex )
+{
+	b2ChainId id;
+	b2ReadReplayValue( reader, id );
+	id.world0 = worldIndex;
+	return id;
+}
+
+static b2JointId b2ReadJointId( b2ReplayReader* reader, uint16_t worldIndex )
+{
+	b2JointId id;
+	b2ReadReplayValue( reader, id );
+	id.world0 = worldIndex;
+	return id;
+}
+
+// Reads the body of a body call and checks it exists, so a corrupt recording fails instead of asserting
+static b2BodyId b2ReadValidBodyId( b2ReplayReader* reader, uint16_t worldIndex )
+{
+	b2BodyId id = b2ReadBodyId( reader, worldIndex );
+	if ( reader->valid && b2Body_IsValid( id ) == false )
+	{
+		reader->valid = false;
+	}
+	return id;
+}
+
+b2WorldId b2CreateReplayWorld( const void* recording, int size, const b2WorldDef* def )
+{
+	b2ReplayReader reader = { recording, size, 0, recording != NULL };
+
+	b2RecordingHeader header;
+	b2ReadReplayValue( &reader, header );
+	if ( reader.valid == false || header.magic != B2_RECORDING_MAGIC || header.version != B2_RECORDING_VERSION ||
+		 header.layoutSize != b2GetRecordingLayoutSize() )
+	{
+		return b2_nullWorldId;
+	}
+
+	b2WorldDef worldDef;
+	b2ReadReplayValue( &reader, worldDef );
+	if ( reader.valid == false )
+	{
+		return b2_nullWorldId;
+	}
+
+	// The machine running the replay decides how the work is spread
+	worldDef.workerCount = def->workerCount;
+	worldDef.workerAffinityMask = def->workerAffinityMask;
+	worldDef.enableCacheAffinity = def->enableCacheAffinity;
+	worldDef.enqueueTask = def->enqueueTask;
+	worldDef.enqueueTaskEx = def->enqueueTaskEx;
+	worldDef.finishTask = def->finishTask;
+	worldDef.userTaskContext = def->userTaskContext;
+	worldDef.userData = def->userData;
+	worldDef.enableRecording = def->enableRecording;
+	worldDef.internalValue = B2_SECRET_COOKIE;
+
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+	if ( B2_IS_NULL( worldId ) )
+	{
+		return worldId;
+	}
+
+	b2World* world = b2GetWorldFromId( worldId );
+	world->replayData = recording;
+	world->replaySize = size;
+	world->replayOffset = reader.offset;
+	return worldId;
+}
+
+// Gets a compound of the recorded polygons for a replayed compound shape. Instanced shapes are usually
+// created in a run, so the last compound is shared when it holds the same polygons.
+static b2Compound* b2GetReplayCompound( b2World* world, const b2Polygon* polygons, int count )
+{
+	if ( world->replayCompoundCount > 0 )
+	{
+		b2Compound* last = world->replayCompounds[world->replayCompoundCount - 1];
+		if ( b2Compound_GetPolygonCount( last ) == count &&
+			 memcmp( b2Compound_GetPolygons( last ), polygons, count * sizeof( b2Polygon ) ) == 0 )
+		{
+			return last;
+		}
+	}
+
+	b2Compound* compound = b2CreateCompound( polygons, count );
+
+	if ( world->replayCompoundCount == world->replayCompoundCapacity )
+	{
+		int newCapacity = b2MaxInt( 16, 2 * world->replayCompoundCapacity );
+		world->replayCompounds = b2GrowAlloc( world->replayCompounds, world->replayCompoundCapacity * sizeof( b2Compound* ),
+											  newCapacity * sizeof( b2Compound* ) );
+		world->replayCompoundCapacity = newCapacity;
+	}
+
+	world->replayCompounds[world->replayCompoundCount++] = compound;
+	return compound;
+}
+
+// Applies one recorded call. Returns false when the call does not match the world.
+static bool b2ReplayCall( b2World* world, b2WorldId worldId, b2ReplayReader* reader, b2RecordType type )
+{
+	uint16_t worldIndex = world->worldId;
+
+	switch ( type )
+	{
+		case b2_recordStep:
+		{
+			float timeStep;
+			int subStepCount;
+			b2ReadReplayValue( reader, timeStep );
+			b2ReadReplayValue( reader, subStepCount );
+			if ( reader->valid && subStepCount > 0 )
+			{
+				b2World_Step( worldId, timeStep, subStepCount );
+			}
+		}
+		break;
+
+		case b2_recordSetGravity:
+		{
+			b2Vec2 gravity;
+			b2ReadReplayValue( reader, gravity );
+			b2World_SetGravity( worldId, gravity );
+		}
+		break;
+
+		case b2_recordBodyCommands:
+		{
+			int count;
+			b2ReadReplayValue( reader, count );
+			b2BodyCommand* commands = b2ReadReplayArray( reader, count, sizeof( b2BodyCommand ) );
+			if ( commands != NULL )
+			{
+				for ( int i = 0; i < count; ++i )
+				{
+					commands[i].bodyId.world0 = worldIndex;
+				}
+
+				b2World_QueueBodyCommands( worldId, 0, commands, count );
+				b2Free( commands, count * sizeof( b2BodyCommand ) );
+			}
+		}
+		break;
+
+		case b2_recordCreateBody:
+		{
+			b2BodyDef def;
+			b2ReadReplayValue( reader, def );
+			b2BodyId recordedId = b2ReadBodyId( reader, worldIndex );
+			if ( reader->valid )
+			{
+				def.internalValue = B2_SECRET_COOKIE;
+				b2BodyId bodyId = b2CreateBody( worldId, &def );
+				return B2_ID_EQUALS( bodyId, recordedId );
+			}
+		}
+		break;
+
+		case b2_recordCreateBodies:
+		{
+			int count;
+			b2ReadReplayValue( reader, count );
+			if ( reader->valid == false || count <= 0 ||
+				 ( reader->size - reader->offset ) / (int)( sizeof( b2BodyDef ) + sizeof( b2ShapeDef ) ) < count )
+			{
+				return false;
+			}
+
+			b2BodyDef* bodyDefs = b2Alloc( count * sizeof( b2BodyDef ) );
+			b2ShapeDef* shapeDefs = b2Alloc( count * sizeof( b2ShapeDef ) );
+			for ( int i = 0; i < count; ++i )
+			{
+				b2ReadReplayValue( reader, bodyDefs[i] );
+				b2ReadReplayValue( reader, shapeDefs[i] );
+				bodyDefs[i].internalValue = B2_SECRET_COOKIE;
+				shapeDefs[i].internalValue = B2_SECRET_COOKIE;
+			}
+
+			b2Polygon* polygons = b2ReadReplayArray( reader, count, sizeof( b2Polygon ) );
+			if ( polygons != NULL )
+			{
+				b2CreateBodies( worldId, bodyDefs, shapeDefs, polygons, count, NULL );
+				b2Free( polygons, count * sizeof( b2Polygon ) );
+			}
+
+			b2Free( shapeDefs, count * sizeof( b2ShapeDef ) );
+			b2Free( bodyDefs, count * sizeof( b2BodyDef ) );
+		}
+		break;
+
+		case b2_recordCreateTileBody:
+		{
+			b2BodyDef bodyDef;
+			b2ShapeDef shapeDef;
+			int count;
+			b2ReadReplayValue( reader, bodyDef );
+			b2ReadReplayValue( reader, shapeDef );
+			b2ReadReplayValue( reader, count );
+			b2Polygon* polygons = b2ReadReplayArray( reader, count, sizeof( b2Polygon ) );
+			b2BodyId recordedId = b2ReadBodyId( reader, worldIndex );
+
+			bool match = false;
+			if ( reader->valid && polygons != NULL )
+			{
+				bodyDef.internalValue = B2_SECRET_COOKIE;
+				shapeDef.internalValue = B2_SECRET_COOKIE;
+				b2StaticTile tile = b2MakeStaticTile( &bodyDef, &shapeDef, polygons, count );
+				b2BodyId bodyId = b2CreateTileBody( worldId, &tile );
+				b2DestroyStaticTile( &tile );
+				match = B2_ID_EQUALS( bodyId, recordedId );
+			}
+
+			b2Free( polygons, count * sizeof( b2Polygon ) );
+			return match;
+		}
+
+		case b2_recordDestroyBody:
+		{
+			b2BodyId bodyId = b2ReadValidBodyId( reader, worldIndex );
+			if ( reader->valid )
+			{
+				b2DestroyBody( bodyId );
+			}
+		}
+		break;
+
+		case b2_recordDestroyBodies:
+		{
+			int count;
+			b2ReadReplayValue( reader, count );
+			b2BodyId* bodyIds = b2ReadReplayArray( reader, count, sizeof( b2BodyId ) );
+			if ( bodyIds == NULL )
+			{
+				break;
+			}
+
+			for ( int i = 0; i < count; ++i )
+			{
+				bodyIds[i].world0 = worldIndex;
+				reader->valid = reader->valid && b2Body_IsValid( bodyIds[i] );
+			}
+
+			if ( reader->valid )
+			{
+				b2DestroyBodies( bodyIds, count );
+			}
+
+			b2Free( bodyIds, count * sizeof( b2BodyId ) );
+		}
+		break;
+
+		case b2_recordSetBodyType:
+		{
+			b2BodyId bodyId = b2ReadValidBodyId( reader, worldIndex );
+			b2BodyType bodyType;
+			b2ReadReplayValue( reader, bodyType );
+			if ( reader->valid && 0 <= (int)bodyType && bodyType < b2_bodyTypeCount )
+			{
+				b2Body_SetType( bodyId, bodyType );
+			}
+		}
+		break;
+
+		case b2_recordSetTransform:
+		{
+			b2BodyId bodyId = b2ReadValidBodyId( reader, worldIndex );
+			b2Vec2 position;
+			b2Rot rotation;
+			b2ReadReplayValue( reader, position );
+			b2ReadReplayValue( reader, rotation );
+			if ( reader->valid )
+			{
+				b2Body_SetTransform( bodyId, position, rotation );
+			}
+		}
+		break;
+
+		case b2_recordSetTargetTransform:
+		{
+			b2BodyId bodyId = b2ReadValidBodyId( reader, worldIndex );
+			b2Transform target;
+			float timeStep;
+			bool wake;
+			b2ReadReplayValue( reader, target );
+			b2ReadReplayValue( reader, timeStep );
+			b2ReadReplayValue( reader, wake );
+			if ( reader->valid )
+			{
+				b2Body_SetTargetTransform( bodyId, target, timeStep, wake );
+			}
+		}
+		break;
+
+		case b2_recordSetLinearVelocity:
+		{
+			b2BodyId bodyId = b2ReadValidBodyId( reader, worldIndex );
+			b2Vec2 linearVelocity;
+			b2ReadReplayValue( reader, linearVelocity );
+			if ( reader->valid )
+			{
+				b2Body_SetLinearVelocity( bodyId, linearVelocity );
+			}
+		}
+		break;
+
+		case b2_recordSetAngularVelocity:
+		{
+			b2BodyId bodyId = b2ReadValidBodyId( reader, worldIndex );
+			float angularVelocity;
+			b2ReadReplayValue( reader, angularVelocity );
+			if ( reader->valid )
+			{
+				b2Body_SetAngularVelocity( bodyId, angularVelocity );
+			}
+		}
+		break;
+
+		case b2_recordApplyForce:
+		case b2_recordApplyLinearImpulse:
+		{
+			b2BodyId bodyId = b2ReadValidBodyId( reader, worldIndex );
+			b2Vec2 value, point;
+			bool wake;
+			b2ReadReplayValue( reader, value );
+			b2ReadReplayValue( reader, point );
+			b2ReadReplayValue( reader, wake );
+			if ( reader->valid && type == b2_recordApplyForce )
+			{
+				b2Body_ApplyForce( bodyId, value, point, wake );
+			}
+			else if ( reader->valid )
+			{
+				b2Body_ApplyLinearImpulse( bodyId, value, point, wake );
+			}
+		}
+		break;
+
+		case b2_recordApplyForceToCenter:
+		case b2_recordApplyLinearImpulseToCenter:
+		{
+			b2BodyId bodyId = b2ReadValidBodyId( reader, worldIndex );
+			b2Vec2 value;
+			bool wake;
+			b2ReadReplayValue( reader, value );
+			b2ReadReplayValue( reader, wake );
+			if ( reader->valid && type == b2_recordApplyForceToCenter )
+			{
+				b2Body_ApplyForceToCenter( bodyId, value, wake );
+			}
+			else if ( reader->valid )
+			{
+				b2Body_ApplyLinearImpulseToCenter( bodyId, value, wake );
+			}
+		}
+		break;
+
+		case b2_recordApplyTorque:
+		case b2_recordApplyAngularImpulse:
+		{
+			b2BodyId bodyId = b2ReadValidBodyId( reader, worldIndex );
+			float value;
+			bool wake;
+			b2ReadReplayValue( reader, value );
+			b2ReadReplayValue( reader, wake );
+			if ( reader->valid && type == b2_recordApplyTorque )
+			{
+				b2Body_ApplyTorque( bodyId, value, wake );
+			}
+			else if ( reader->valid )
+			{
+				b2Body_ApplyAngularImpulse( bodyId, value, wake );
+			}
+		}
+		break;
+
+		case b2_recordSetAwake:
+		{
+			b2BodyId bodyId = b2ReadValidBodyId( reader, worldIndex );
+			bool awake;
+			b2ReadReplayValue( reader, awake );
+			if ( reader->valid )
+			{
+				b2Body_SetAwake( bodyId, awake );
+			}
+		}
+		break;
+
+		case b2_recordEnableBody:
+		case b2_recordDisableBody:
+		{
+			b2BodyId bodyId = b2ReadValidBodyId( reader, worldIndex );
+			if ( reader->valid && type == b2_recordEnableBody )
+			{
+				b2Body_Enable( bodyId );
+			}
+			else if ( reader->valid )
+			{
+				b2Body_Disable( bodyId );
+			}
+		}
+		break;
+
+		case b2_recordCreateShape:
+		{
+			b2ShapeType shapeType;
+			b2ReadReplayValue( reader, shapeType );
+			b2BodyId bodyId = b2ReadValidBodyId( reader, worldIndex );
+			b2ShapeDef def;
+			b2ReadReplayValue( reader, def );
+
+			if ( shapeType == b2_compoundShape )
+			{
+				int count;
+				b2ReadReplayValue( reader, count );
+				b2Polygon* polygons = b2ReadReplayArray( reader, count, sizeof( b2Polygon ) );
+				b2ShapeId recordedId = b2ReadShapeId( reader, worldIndex );
+
+				bool match = false;
+				if ( reader->valid && polygons != NULL )
+				{
+					def.internalValue = B2_SECRET_COOKIE;
+					b2Compound* compound = b2GetReplayCompound( world, polygons, count );
+					b2ShapeId shapeId = b2CreateCompoundShape( bodyId, &def, compound );
+					match = B2_ID_EQUALS( shapeId, recordedId );
+				}
+
+				b2Free( polygons, count * sizeof( b2Polygon ) );
+				return match;
+			}
+
+			union
+			{
+				b2Capsule capsule;
+				b2Circle circle;
+				b2Polygon polygon;
+				b2Segment segment;
+			} geometry;
+
+			int geometrySize = b2GetGeometrySize( shapeType );
+			if ( geometrySize == 0 )
+			{
+				return false;
+			}
+
+			b2ReadReplayBytes( reader, &geometry, geometrySize );
+			b2ShapeId recordedId = b2ReadShapeId( reader, worldIndex );
+			if ( reader->valid == false )
+			{
+				return false;
+			}
+
+			def.internalValue = B2_SECRET_COOKIE;
+
+			b2ShapeId shapeId = b2_nullShapeId;
+			switch ( shapeType )
+			{
+				case b2_capsuleShape:
+					shapeId = b2CreateCapsuleShape( bodyId, &def, &geometry.capsule );
+					break;
+				case b2_circleShape:
+					shapeId = b2CreateCircleShape( bodyId, &def, &geometry.circle );
+					break;
+				case b2_polygonShape:
+					shapeId = b2CreatePolygonShape( bodyId, &def, &geometry.polygon );
+					break;
+				case b2_segmentShape:
+					shapeId = b2CreateSegmentShape( bodyId, &def, &geometry.segment );
+					break;
+				default:
+					break;
+			}
+
+			return B2_ID_EQUALS( shapeId, recordedId );
+		}
+
+		case b2_recordDestroyShape:
+		{
+			b2ShapeId shapeId = b2ReadShapeId( reader, worldIndex );
+			bool updateBodyMass;
+			b2ReadReplayValue( reader, updateBodyMass );
+			if ( reader->valid && b2Shape_IsValid( shapeId ) )
+			{
+				b2DestroyShape( shapeId, updateBodyMass );
+			}
+			else
+			{
+				return false;
+			}
+		}
+		break;
+
+		case b2_recordCreateChain:
+		{
+			b2BodyId bodyId = b2ReadValidBodyId( reader, worldIndex );
+			b2ChainDef def;
+			b2ReadReplayValue( reader, def );
+			b2Vec2* points = b2ReadReplayArray( reader, def.count, sizeof( b2Vec2 ) );
+			b2SurfaceMaterial* materials = b2ReadReplayArray( reader, def.materialCount, sizeof( b2SurfaceMaterial ) );
+			b2ChainId recordedId = b2ReadChainId( reader, worldIndex );
+
+			bool match = false;
+			if ( reader->valid && def.count >= 4 && ( def.materialCount == 1 || def.materialCount == def.count ) )
+			{
+				def.points = points;
+				def.materials = materials;
+				def.internalValue = B2_SECRET_COOKIE;
+				b2ChainId chainId = b2CreateChain( bodyId, &def );
+				match = B2_ID_EQUALS( chainId, recordedId );
+			}
+
+			b2Free( materials, def.materialCount * sizeof( b2SurfaceMaterial ) );
+			b2Free( points, def.count * sizeof( b2Vec2 ) );
+			return match;
+		}
+
+		case b2_recordDestroyChain:
+		{
+			b2ChainId chainId = b2ReadChainId( reader, worldIndex );
+			if ( reader->valid && b2Chain_IsValid( chainId ) )
+			{
+				b2DestroyChain( chainId );
+			}
+			else
+			{
+				return false;
+			}
+		}
+		break;
+
+		case b2_recordCreateJoint:
+		{
+			b2JointType jointType;
+			b2ReadReplayValue( reader, jointType );
+			int defSize = b2GetJointDefSize( jointType );
+			if ( defSize == 0 )
+			{
+				return false;
+			}
+
+			b2AnyJointDef def;
+			b2ReadReplayBytes( reader, &def, defSize );
+			b2JointId recordedId = b2ReadJointId( reader, worldIndex );
+
+			def.base.bodyIdA.world0 = worldIndex;
+			def.base.bodyIdB.world0 = worldIndex;
+			if ( reader->valid == false || b2Body_IsValid( def.base.bodyIdA ) == false ||
+				 b2Body_IsValid( def.base.bodyIdB ) == false )
+			{
+				return false;
+			}
+
+			b2JointId jointId = b2_nullJointId;
+			switch ( jointType )
+			{
+				case b2_distanceJoint:
+					def.distanceJoint.internalValue = B2_SECRET_COOKIE;
+					jointId = b2CreateDistanceJoint( worldId, &def.distanceJoint );
+					break;
+				case b2_filterJoint:
+					def.filterJoint.internalValue = B2_SECRET_COOKIE;
+					jointId = b2CreateFilterJoint( worldId, &def.filterJoint );
+					break;
+				case b2_motorJoint:
+					def.motorJoint.internalValue = B2_SECRET_COOKIE;
+					jointId = b2CreateMotorJoint( worldId, &def.motorJoint );
+					break;
+				case b2_prismaticJoint:
+					def.prismaticJoint.internalValue = B2_SECRET_COOKIE;
+					jointId = b2CreatePrismaticJoint( worldId, &def.prismaticJoint );
+					break;
+				case b2_revoluteJoint:
+					def.revoluteJoint.internalValue = B2_SECRET_COOKIE;
+					jointId = b2CreateRevoluteJoint( worldId, &def.revoluteJoint );
+					break;
+				case b2_weldJoint:
+					def.weldJoint.internalValue = B2_SECRET_COOKIE;
+					jointId = b2CreateWeldJoint( worldId, &def.weldJoint );
+					break;
+				case b2_wheelJoint:
+					def.wheelJoint.internalValue = B2_SECRET_COOKIE;
+					jointId = b2CreateWheelJoint( worldId, &def.wheelJoint );
+					break;
+				default:
+					break;
+			}
+
+			return B2_ID_EQUALS( jointId, recordedId );
+		}
+
+		case b2_recordDestroyJoint:
+		{
+			b2JointId jointId = b2ReadJointId( reader, worldIndex );
+			bool wakeAttached;
+			b2ReadReplayValue( reader, wakeAttached );
+			if ( reader->valid && b2Joint_IsValid( jointId ) )
+			{
+				b2DestroyJoint( jointId, wakeAttached );
+			}
+			else
+			{
+				return false;
+			}
+		}
+		break;
+
+		default:
+			return false;
+	}
+
+	return reader->valid;
+}
+
+bool b2World_ReplayStep( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false );
+	if ( world->locked || world->replayData == NULL )
+	{
+		return false;
+	}
+
+	b2ReplayReader reader = { world->replayData, world->replaySize, world->replayOffset, true };
+	bool stepped = false;
+
+	while ( stepped == false && reader.offset < reader.size )
+	{
+		uint8_t value;
+		b2ReadReplayValue( &reader, value );
+		b2RecordType type = (b2RecordType)value;
+
+		if ( b2ReplayCall( world, worldId, &reader, type ) == false )
+		{
+			// Stop the replay so the world is not stepped with missing objects
+			world->replayOffset = world->replaySize;
+			return false;
+		}
+
+		world->replayOffset = reader.offset;
+		stepped = type == b2_recordStep;
+	}
+
+	return stepped;
+}
@@ -0,0 +1,76 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "box2d/types.h"
+
+#include <stdint.h>
+
+// Calls recorded by a world created with b2WorldDef::enableRecording. A record is the type followed
+// by the arguments of the call. Created ids are recorded so the replay can check that it creates
+// the same objects.
+typedef enum b2RecordType
+{
+	b2_recordStep,
+	b2_recordSetGravity,
+	b2_recordBodyCommands,
+	b2_recordCreateBody,
+	b2_recordCreateBodies,
+	b2_recordCreateTileBody,
+	b2_recordDestroyBody,
+	b2_recordDestroyBodies,
+	b2_recordSetBodyType,
+	b2_recordSetTransform,
+	b2_recordSetTargetTransform,
+	b2_recordSetLinearVelocity,
+	b2_recordSetAngularVelocity,
+	b2_recordApplyForce,
+	b2_recordApplyForceToCenter,
+	b2_recordApplyTorque,
+	b2_recordApplyLinearImpulse,
+	b2_recordApplyLinearImpulseToCenter,
+	b2_recordApplyAngularImpulse,
+	b2_recordSetAwake,
+	b2_recordEnableBody,
+	b2_recordDisableBody,
+	b2_recordCreateShape,
+	b2_recordDestroyShape,
+	b2_recordCreateChain,
+	b2_recordDestroyChain,
+	b2_recordCreateJoint,
+	b2_recordDestroyJoint,
+	b2_recordTypeCount
+} b2RecordType;
+
+// Growable buffer holding the recording of one world
+typedef struct b2Recorder
+{
+	uint8_t* data;
+	int size;
+	int capacity;
+} b2Recorder;
+
+typedef struct b2World b2World;
+
+// Starts the recording with the world definition
+b2Recorder* b2CreateRecorder( const b2WorldDef* def );
+void b2DestroyRecorder( b2Recorder* recorder );
+
+void b2RecordBytes( b2Recorder* recorder, const void* data, int byteCount );
+void b2RecordCall( b2Recorder* recorder, b2RecordType type );
+
+#define b2RecordValue( recorder, value ) b2RecordBytes( recorder, &( value ), (int)sizeof( value ) )
+
+// Definitions are recorded without pointers such as user data and names
+void b2RecordCreateBody( b2Recorder* recorder, const b2BodyDef* def, b2BodyId bodyId );
+void b2RecordCreateBodies( b2Recorder* recorder, const b2BodyDef* bodyDefs, const b2ShapeDef* shapeDefs,
+						   const b2Polygon* polygons, int count );
+void b2RecordCreateTileBody( b2Recorder* recorder, const b2StaticTile* tile, b2BodyId bodyId );
+void b2RecordCreateShape( b2Recorder* recorder, b2BodyId bodyId, const b2ShapeDef* def, const void* geometry,
+						  b2ShapeType shapeType, b2ShapeId shapeId );
+void b2RecordCreateChain( b2Recorder* recorder, b2BodyId bodyId, const b2ChainDef* def, b2ChainId chainId );
+void b2RecordCreateJoint( b2Recorder* recorder, const void* def, b2JointType jointType, b2JointId jointId );
+
+// Records the queued body commands in the order the step applies them, followed by the step
+void b2RecordStep( b2World* world, float timeStep, int subStepCount );
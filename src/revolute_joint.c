@@ -33,7 +33,7 @@
 
 void b2RevoluteJoint_EnableSpring( b2JointId jointId, bool enableSpring )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_revoluteJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_revoluteJoint );
 	if ( enableSpring != joint->revoluteJoint.enableSpring )
 	{
 		joint->revoluteJoint.enableSpring = enableSpring;
@@ -49,7 +49,7 @@ bool b2RevoluteJoint_IsSpringEnabled( b2JointId jointId )
 
 void b2RevoluteJoint_SetSpringHertz( b2JointId jointId, float hertz )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_revoluteJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_revoluteJoint );
 	joint->revoluteJoint.hertz = hertz;
 }
 
@@ -61,7 +61,7 @@ float b2RevoluteJoint_GetSpringHertz( b2JointId jointId )
 
 void b2RevoluteJoint_SetSpringDampingRatio( b2JointId jointId, float dampingRatio )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_revoluteJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_revoluteJoint );
 	joint->revoluteJoint.dampingRatio = dampingRatio;
 }
 
@@ -73,7 +73,7 @@ float b2RevoluteJoint_GetSpringDampingRatio( b2JointId jointId )
 
 void b2RevoluteJoint_SetTargetAngle( b2JointId jointId, float angle )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_revoluteJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_revoluteJoint );
 	joint->revoluteJoint.targetAngle = angle;
 }
 
@@ -98,7 +98,7 @@ float b2RevoluteJoint_GetAngle( b2JointId jointId )
 
 void b2RevoluteJoint_EnableLimit( b2JointId jointId, bool enableLimit )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_revoluteJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_revoluteJoint );
 	if ( enableLimit != joint->revoluteJoint.enableLimit )
 	{
 		joint->revoluteJoint.enableLimit = enableLimit;
@@ -131,7 +131,7 @@ void b2RevoluteJoint_SetLimits( b2JointId jointId, float lower, float upper )
 	B2_ASSERT( lower >= -0.99f * B2_PI );
 	B2_ASSERT( upper <= 0.99f * B2_PI );
 
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_revoluteJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_revoluteJoint );
 	if ( lower != joint->revoluteJoint.lowerAngle || upper != joint->revoluteJoint.upperAngle )
 	{
 		joint->revoluteJoint.lowerAngle = b2MinFloat( lower, upper );
@@ -143,7 +143,7 @@ void b2RevoluteJoint_SetLimits( b2JointId jointId, float lower, float upper )
 
 void b2RevoluteJoint_EnableMotor( b2JointId jointId, bool enableMotor )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_revoluteJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_revoluteJoint );
 	if ( enableMotor != joint->revoluteJoint.enableMotor )
 	{
 		joint->revoluteJoint.enableMotor = enableMotor;
@@ -159,7 +159,7 @@ bool b2RevoluteJoint_IsMotorEnabled( b2JointId jointId )
 
 void b2RevoluteJoint_SetMotorSpeed( b2JointId jointId, float motorSpeed )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_revoluteJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_revoluteJoint );
 	joint->revoluteJoint.motorSpeed = motorSpeed;
 }
 
@@ -178,7 +178,7 @@ float b2RevoluteJoint_GetMotorTorque( b2JointId jointId )
 
 void b2RevoluteJoint_SetMaxMotorTorque( b2JointId jointId, float torque )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_revoluteJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_revoluteJoint );
 	joint->revoluteJoint.maxMotorTorque = torque;
 }
 
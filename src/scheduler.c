@@ -11,12 +11,37 @@
 #include <stdio.h>
 #include <string.h>
 
+// Work stealing scheduler. Each worker has a bounded Chase-Lev style queue. Box2D only enqueues tasks
+// from the thread that is stepping the world, so that thread owns the push end of every queue and deals
+// tasks round-robin. With b2World_StepAsync the calling thread pushes the step task and then a worker
+// takes over the push end until the step is done. All workers take tasks from the steal end with a single CAS: first from their own
+// queue and then from random victims. This keeps workers from contending on a single queue and from
+// scanning the whole task array.
+//
+// Queue counters grow monotonically and are compared with wrapping arithmetic, so there is no ABA
+// problem when the task slots are reset each step.
+
+_Static_assert( ( B2_MAX_TASKS & ( B2_MAX_TASKS - 1 ) ) == 0, "B2_MAX_TASKS must be a power of two" );
+
+#define B2_QUEUE_MASK ( B2_MAX_TASKS - 1 )
+
+// Number of failed attempts to find work before a worker parks on the semaphore. Enough to bridge
+// the gap between the task phases of a world step, short enough to not burn a core between steps.
+#define B2_SCHEDULER_SPIN_COUNT 256
+
+// Spinning workers yield their time slice every 16 attempts
+#define B2_SCHEDULER_YIELD_MASK 15
+
+// The main thread yields after this many failed attempts while it waits for a task
+#define B2_SCHEDULER_WAIT_SPIN_COUNT 64
+
+#define B2_CACHE_LINE_SIZE 64
+
 enum b2SchedulerTaskStatus
 {
 	b2_schedulerFree = 0,
 	b2_schedulerPending = 1,
-	b2_schedulerClaimed = 2,
-	b2_schedulerComplete = 3,
+	b2_schedulerComplete = 2,
 };
 
 typedef struct b2SchedulerTask
@@ -26,14 +51,33 @@ typedef struct b2SchedulerTask
 	b2AtomicInt status;
 } b2SchedulerTask;
 
+// The top and bottom counters live on separate cache lines because thieves hammer top
+// while the producer writes bottom.
+typedef struct b2TaskQueue
+{
+	b2AtomicInt top;
+	char padding1[B2_CACHE_LINE_SIZE - sizeof( b2AtomicInt )];
+
+	b2AtomicInt bottom;
+	char padding2[B2_CACHE_LINE_SIZE - sizeof( b2AtomicInt )];
+
+	// task slot indices
+	b2AtomicInt items[B2_MAX_TASKS];
+} b2TaskQueue;
+
 typedef struct b2SchedulerWorkerContext
 {
 	struct b2Scheduler* scheduler;
 	int threadIndex;
+
+	// Logical processor to pin to or -1 for none
+	int processorIndex;
 } b2SchedulerWorkerContext;
 
 typedef struct b2Scheduler
 {
+	b2TaskQueue queues[B2_MAX_WORKERS];
+
 	b2Thread* threads[B2_MAX_WORKERS];
 	b2SchedulerWorkerContext workerContexts[B2_MAX_WORKERS];
 
@@ -44,34 +88,127 @@ typedef struct b2Scheduler
 	int threadCount;
 
 	b2SchedulerTask tasks[B2_MAX_TASKS];
-	b2AtomicInt nextSlot;
+
+	// Only touched by the enqueuing thread
+	int nextSlot;
+
+	// Number of workers parked or about to park on the semaphore
+	b2AtomicInt sleeperCount;
 
 	b2Semaphore* taskSemaphore;
 	b2AtomicInt shutdown;
+
+#ifdef BOX2D_PROFILE
+	// Shows the main thread waiting in b2SchedulerFinishTask as Tracy lock contention
+	b2TracyCLockCtx( finishLock );
+#endif
 } b2Scheduler;
 
-// Try to claim and execute one pending task.
-// Returns true if work was performed, false otherwise.
-static bool b2SchedulerExecuteOne( b2Scheduler* scheduler )
+static void b2PushTask( b2TaskQueue* queue, int slot )
+{
+	uint32_t bottom = (uint32_t)b2AtomicLoadInt( &queue->bottom );
+	B2_ASSERT( (int)( bottom - (uint32_t)b2AtomicLoadInt( &queue->top ) ) < B2_MAX_TASKS );
+
+	b2AtomicStoreInt( queue->items + ( bottom & B2_QUEUE_MASK ), slot );
+
+	// publishes the item
+	b2AtomicStoreInt( &queue->bottom, (int)( bottom + 1 ) );
+}
+
+// Returns a task slot or B2_NULL_INDEX if the queue is empty or another worker won the race.
+static int b2StealTask( b2TaskQueue* queue )
 {
-	int taskCount = b2AtomicLoadInt( &scheduler->nextSlot );
-	for ( int t = 0; t < taskCount; ++t )
+	uint32_t top = (uint32_t)b2AtomicLoadInt( &queue->top );
+	uint32_t bottom = (uint32_t)b2AtomicLoadInt( &queue->bottom );
+
+	if ( (int)( bottom - top ) <= 0 )
+	{
+		return B2_NULL_INDEX;
+	}
+
+	int slot = b2AtomicLoadInt( queue->items + ( top & B2_QUEUE_MASK ) );
+	if ( b2AtomicCompareExchangeInt( &queue->top, (int)top, (int)( top + 1 ) ) == false )
 	{
-		b2SchedulerTask* task = scheduler->tasks + t;
-		if ( b2AtomicLoadInt( &task->status ) != b2_schedulerPending )
+		return B2_NULL_INDEX;
+	}
+
+	return slot;
+}
+
+static bool b2HasQueuedTask( b2Scheduler* scheduler )
+{
+	for ( int i = 0; i < scheduler->workerCount; ++i )
+	{
+		b2TaskQueue* queue = scheduler->queues + i;
+		uint32_t top = (uint32_t)b2AtomicLoadInt( &queue->top );
+		uint32_t bottom = (uint32_t)b2AtomicLoadInt( &queue->bottom );
+		if ( (int)( bottom - top ) > 0 )
 		{
-			continue;
+			return true;
 		}
+	}
+
+	return false;
+}
+
+// xorshift32
+static uint32_t b2NextRandom( uint32_t* state )
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
 
-		if ( b2AtomicCompareExchangeInt( &task->status, b2_schedulerPending, b2_schedulerClaimed ) == false )
+// Try to take and execute one task, first from the worker's own queue and then from the other
+// queues starting at a random victim. Returns true if work was performed, false otherwise.
+static bool b2SchedulerExecuteOne( b2Scheduler* scheduler, int workerIndex, uint32_t* randomState )
+{
+	int workerCount = scheduler->workerCount;
+
+	int slot = b2StealTask( scheduler->queues + workerIndex );
+	if ( slot == B2_NULL_INDEX && workerCount > 1 )
+	{
+		int victim = (int)( b2NextRandom( randomState ) % (uint32_t)workerCount );
+		for ( int i = 0; i < workerCount && slot == B2_NULL_INDEX; ++i )
 		{
-			continue;
+			if ( victim != workerIndex )
+			{
+				slot = b2StealTask( scheduler->queues + victim );
+			}
+
+			victim = victim + 1 < workerCount ? victim + 1 : 0;
 		}
+	}
+
+	if ( slot == B2_NULL_INDEX )
+	{
+		return false;
+	}
 
-		task->callback( task->taskContext );
+	b2SchedulerTask* task = scheduler->tasks + slot;
+	B2_ASSERT( b2AtomicLoadInt( &task->status ) == b2_schedulerPending );
 
-		b2AtomicStoreInt( &task->status, b2_schedulerComplete );
-		return true;
+	task->callback( task->taskContext );
+
+	b2AtomicStoreInt( &task->status, b2_schedulerComplete );
+	return true;
+}
+
+// Take one sleeper ticket if there is one. A successful call owes the semaphore a signal.
+static bool b2TakeSleeper( b2Scheduler* scheduler )
+{
+	int sleeperCount = b2AtomicLoadInt( &scheduler->sleeperCount );
+	while ( sleeperCount > 0 )
+	{
+		if ( b2AtomicCompareExchangeInt( &scheduler->sleeperCount, sleeperCount, sleeperCount - 1 ) )
+		{
+			return true;
+		}
+
+		sleeperCount = b2AtomicLoadInt( &scheduler->sleeperCount );
 	}
 
 	return false;
@@ -82,24 +219,59 @@ static void b2SchedulerWorkerMain( void* context )
 {
 	b2SchedulerWorkerContext* workerContext = context;
 	b2Scheduler* scheduler = workerContext->scheduler;
+	int workerIndex = workerContext->threadIndex;
 
-	while ( true )
+	if ( workerContext->processorIndex >= 0 )
 	{
-		b2WaitSemaphore( scheduler->taskSemaphore );
+		b2SetCurrentThreadAffinity( workerContext->processorIndex );
+	}
 
-		if ( b2AtomicLoadInt( &scheduler->shutdown ) != 0 )
+	uint32_t randomState = 0x9E3779B9u * (uint32_t)( workerIndex + 1 );
+
+	int spinCount = 0;
+	while ( b2AtomicLoadInt( &scheduler->shutdown ) == 0 )
+	{
+		if ( b2SchedulerExecuteOne( scheduler, workerIndex, &randomState ) )
 		{
-			break;
+			spinCount = 0;
+			continue;
 		}
 
-		// Claim and execute all available work
-		while ( b2SchedulerExecuteOne( scheduler ) )
+		if ( spinCount < B2_SCHEDULER_SPIN_COUNT )
 		{
+			// Yield now and then so spinning workers don't starve the main thread when there are
+			// more workers than cores
+			spinCount += 1;
+			if ( ( spinCount & B2_SCHEDULER_YIELD_MASK ) == 0 )
+			{
+				b2Yield();
+			}
+			else
+			{
+				b2Pause();
+			}
+			continue;
 		}
+
+		// Announce the intent to sleep before the final check. An enqueue either sees the sleeper
+		// and signals, or happened before the check below and is found by it.
+		b2AtomicFetchAddInt( &scheduler->sleeperCount, 1 );
+
+		if ( b2HasQueuedTask( scheduler ) || b2AtomicLoadInt( &scheduler->shutdown ) != 0 )
+		{
+			// If an enqueue already took the ticket then the semaphore has a spare signal which
+			// only causes one early wake up later.
+			b2TakeSleeper( scheduler );
+			spinCount = 0;
+			continue;
+		}
+
+		b2WaitSemaphore( scheduler->taskSemaphore );
+		spinCount = 0;
 	}
 }
 
-b2Scheduler* b2CreateScheduler( int workerCount )
+b2Scheduler* b2CreateScheduler( int workerCount, uint64_t affinityMask )
 {
 	B2_ASSERT( 0 < workerCount && workerCount <= B2_MAX_WORKERS );
 
@@ -110,15 +282,29 @@ b2Scheduler* b2CreateScheduler( int workerCount )
 	int threadCount = workerCount - 1;
 	scheduler->threadCount = threadCount;
 	scheduler->taskSemaphore = b2CreateSemaphore( 0 );
+	scheduler->nextSlot = 0;
 	b2AtomicStoreInt( &scheduler->shutdown, 0 );
-	b2AtomicStoreInt( &scheduler->nextSlot, 0 );
+	b2AtomicStoreInt( &scheduler->sleeperCount, 0 );
+	b2TracyCLockAnnounce( scheduler->finishLock, "Scheduler Finish" );
+
+	// Processors of the affinity mask in ascending order
+	int processors[64];
+	int processorCount = 0;
+	for ( int i = 0; i < 64; ++i )
+	{
+		if ( affinityMask & ( (uint64_t)1 << i ) )
+		{
+			processors[processorCount++] = i;
+		}
+	}
 
 	// Background threads use indices 1..workerCount-1.
-	// Main thread uses index 0.
+	// Main thread uses index 0. It is not pinned but the first processor is left for it.
 	for ( int i = 0; i < threadCount; ++i )
 	{
 		scheduler->workerContexts[i].scheduler = scheduler;
 		scheduler->workerContexts[i].threadIndex = i + 1;
+		scheduler->workerContexts[i].processorIndex = processorCount > 0 ? processors[( i + 1 ) % processorCount] : -1;
 
 		char name[16];
 		snprintf( name, sizeof( name ), "box2d_worker_%02d", i + 1 );
@@ -145,30 +331,38 @@ void b2DestroyScheduler( b2Scheduler* scheduler )
 	}
 
 	b2DestroySemaphore( scheduler->taskSemaphore );
+	b2TracyCLockTerminate( scheduler->finishLock );
 	b2Free( scheduler, sizeof( b2Scheduler ) );
 }
 
 void b2ResetScheduler( b2Scheduler* scheduler )
 {
-	b2AtomicStoreInt( &scheduler->nextSlot, 0 );
+	// All tasks of the previous step are complete so the slots can be reused. The queues
+	// are empty and keep their counters.
+	scheduler->nextSlot = 0;
 }
 
 void* b2SchedulerEnqueueTask( b2TaskCallback* task, void* taskContext, void* userContext )
 {
 	b2Scheduler* scheduler = userContext;
 
-	int slot = b2AtomicFetchAddInt( &scheduler->nextSlot, 1 );
+	int slot = scheduler->nextSlot;
 	B2_ASSERT( slot < B2_MAX_TASKS );
+	scheduler->nextSlot += 1;
 
 	b2SchedulerTask* schedulerTask = scheduler->tasks + slot;
 	schedulerTask->callback = task;
 	schedulerTask->taskContext = taskContext;
-
-	// Memory fence: status must be published after callback and context are written
 	b2AtomicStoreInt( &schedulerTask->status, b2_schedulerPending );
 
-	// One wake per enqueue is enough: at most one worker picks up each task.
-	b2SignalSemaphore( scheduler->taskSemaphore );
+	// Deal tasks round-robin so each worker finds work in its own queue
+	b2PushTask( scheduler->queues + slot % scheduler->workerCount, slot );
+
+	// Only pay for a semaphore signal when a worker is parked
+	if ( b2TakeSleeper( scheduler ) )
+	{
+		b2SignalSemaphore( scheduler->taskSemaphore );
+	}
 
 	return schedulerTask;
 }
@@ -182,15 +376,29 @@ void b2SchedulerFinishTask( void* userTask, void* userContext )
 
 	b2Scheduler* scheduler = userContext;
 	b2SchedulerTask* waitTask = userTask;
+	uint32_t randomState = 0x9E3779B9u;
 
 	// Main thread helps execute any available work while waiting for the
 	// target task to complete. This keeps the main thread from idling when
 	// background threads are busy on other tasks from the same phase.
+	int spinCount = 0;
+	b2TracyCWaitBegin( scheduler->finishLock );
 	while ( b2AtomicLoadInt( &waitTask->status ) != b2_schedulerComplete )
 	{
-		if ( b2SchedulerExecuteOne( scheduler ) == false )
+		if ( b2SchedulerExecuteOne( scheduler, 0, &randomState ) )
+		{
+			spinCount = 0;
+		}
+		else if ( spinCount < B2_SCHEDULER_WAIT_SPIN_COUNT )
+		{
+			spinCount += 1;
+			b2Pause();
+		}
+		else
 		{
+			spinCount = 0;
 			b2Yield();
 		}
 	}
+	b2TracyCWaitEnd( scheduler->finishLock );
 }
@@ -3,10 +3,14 @@
 
 #pragma once
 
+#include <stdint.h>
+
 typedef void b2TaskCallback( void* taskContext );
 typedef struct b2Scheduler b2Scheduler;
 
-b2Scheduler* b2CreateScheduler( int workerCount );
+// Background worker i is pinned to the i-th processor of the affinity mask, wrapping around. The first
+// processor belongs to the main thread. A zero mask leaves placement to the operating system.
+b2Scheduler* b2CreateScheduler( int workerCount, uint64_t affinityMask );
 void b2DestroyScheduler( b2Scheduler* scheduler );
 void b2ResetScheduler( b2Scheduler* scheduler );
 
@@ -14,7 +14,7 @@
 #include "box2d/collision.h"
 
 #include <stddef.h>
-#include <stdlib.h>
+#include <string.h>
 
 struct b2SensorQueryContext
 {
@@ -27,7 +27,7 @@ struct b2SensorQueryContext
 
 // Sensor shapes need to
 // - detect begin and end overlap events
-// - events must be reported in deterministic order
+// - events must be reported in deterministic order, unless relaxed determinism is enabled
 // - maintain an active list of overlaps for query
 
 // Assumption
@@ -80,29 +80,15 @@ static bool b2SensorQueryCallback( int proxyId, uint64_t userData, void* context
 	// Custom user filter
 	if ( sensorShape->enableCustomFiltering || otherShape->enableCustomFiltering )
 	{
-		b2CustomFilterFcn* customFilterFcn = queryContext->world->customFilterFcn;
-		if ( customFilterFcn != NULL )
+		if ( b2CustomFilterShapes( world, sensorShape, otherShape ) == false )
 		{
-			b2ShapeId idA = { sensorShapeId + 1, world->worldId, sensorShape->generation };
-			b2ShapeId idB = { shapeId + 1, world->worldId, otherShape->generation };
-			bool shouldCollide = customFilterFcn( idA, idB, queryContext->world->customFilterContext );
-			if ( shouldCollide == false )
-			{
-				return true;
-			}
+			return true;
 		}
 	}
 
 	b2Transform otherTransform = b2GetBodyTransform( world, otherShape->bodyId );
 
-	b2DistanceInput input;
-	input.proxyA = b2MakeShapeDistanceProxy( sensorShape );
-	input.proxyB = b2MakeShapeDistanceProxy( otherShape );
-	input.transformA = queryContext->transform;
-	input.transformB = otherTransform;
-	input.useRadii = true;
-	b2SimplexCache cache = { 0 };
-	b2DistanceOutput output = b2ShapeDistance( &input, &cache, NULL, 0 );
+	b2DistanceOutput output = b2ComputeShapeDistance( sensorShape, queryContext->transform, otherShape, otherTransform );
 
 	bool overlaps = output.distance < 10.0f * FLT_EPSILON;
 	if ( overlaps == false )
@@ -111,25 +97,278 @@ static bool b2SensorQueryCallback( int proxyId, uint64_t userData, void* context
 	}
 
 	// Record the overlap
-	b2Sensor* sensor = queryContext->sensor;
-	b2Visitor* shapeRef = b2Array_Emplace( sensor->overlaps2 );
+	b2Visitor* shapeRef = b2Array_Emplace( queryContext->taskContext->visitors );
 	shapeRef->shapeId = shapeId;
 	shapeRef->generation = otherShape->generation;
 
 	return true;
 }
 
-static int b2CompareVisitors( const void* a, const void* b )
+// Below this count an insertion sort beats the radix passes
+#define B2_VISITOR_INSERTION_SORT_COUNT 32
+
+// Stable sort of visitors by shape id. Uses an LSD radix sort with one pass per significant byte of the
+// largest shape id. Returns the buffer that holds the result, either visitors or scratch.
+static b2Visitor* b2SortVisitors( b2Visitor* visitors, b2Visitor* scratch, int count )
 {
-	const b2Visitor* sa = a;
-	const b2Visitor* sb = b;
+	if ( count <= B2_VISITOR_INSERTION_SORT_COUNT )
+	{
+		for ( int i = 1; i < count; ++i )
+		{
+			b2Visitor visitor = visitors[i];
+			int j = i - 1;
+			while ( j >= 0 && visitors[j].shapeId > visitor.shapeId )
+			{
+				visitors[j + 1] = visitors[j];
+				j -= 1;
+			}
+			visitors[j + 1] = visitor;
+		}
+
+		return visitors;
+	}
 
-	if ( sa->shapeId < sb->shapeId )
+	int maxShapeId = 0;
+	for ( int i = 0; i < count; ++i )
 	{
-		return -1;
+		maxShapeId = b2MaxInt( maxShapeId, visitors[i].shapeId );
+	}
+
+	b2Visitor* source = visitors;
+	b2Visitor* target = scratch;
+	for ( uint32_t shift = 0; shift < 32 && ( (uint32_t)maxShapeId >> shift ) != 0; shift += 8 )
+	{
+		int offsets[256] = { 0 };
+		for ( int i = 0; i < count; ++i )
+		{
+			offsets[( (uint32_t)source[i].shapeId >> shift ) & 0xFF] += 1;
+		}
+
+		int sum = 0;
+		for ( int i = 0; i < 256; ++i )
+		{
+			int digitCount = offsets[i];
+			offsets[i] = sum;
+			sum += digitCount;
+		}
+
+		for ( int i = 0; i < count; ++i )
+		{
+			int digit = ( (uint32_t)source[i].shapeId >> shift ) & 0xFF;
+			target[offsets[digit]] = source[i];
+			offsets[digit] += 1;
+		}
+
+		b2Visitor* temp = source;
+		source = target;
+		target = temp;
 	}
 
-	return 1;
+	return source;
+}
+
+// Publish the begin and end events from the difference of the sorted overlap arrays
+static void b2DiffSensorOverlaps( const b2World* world, const b2Sensor* sensor, b2Array( b2SensorBeginTouchEvent ) * beginEvents,
+								  b2Array( b2SensorEndTouchEvent ) * endEvents )
+{
+	const b2Shape* sensorShape = b2Array_Get( world->shapes, sensor->shapeId );
+	b2ShapeId sensorId = { sensor->shapeId + 1, world->worldId, sensorShape->generation };
+
+	int count1 = sensor->overlaps1.count;
+	int count2 = sensor->overlaps2.count;
+	const b2Visitor* refs1 = sensor->overlaps1.data;
+	const b2Visitor* refs2 = sensor->overlaps2.data;
+
+	// overlaps1 can have overlaps that end
+	// overlaps2 can have overlaps that begin
+	int index1 = 0, index2 = 0;
+	while ( index1 < count1 && index2 < count2 )
+	{
+		const b2Visitor* r1 = refs1 + index1;
+		const b2Visitor* r2 = refs2 + index2;
+		if ( r1->shapeId == r2->shapeId )
+		{
+			if ( r1->generation < r2->generation )
+			{
+				// end
+				b2ShapeId visitorId = { r1->shapeId + 1, world->worldId, r1->generation };
+				b2SensorEndTouchEvent event = {
+					.sensorShapeId = sensorId,
+					.visitorShapeId = visitorId,
+				};
+				b2Array_Push( *endEvents, event );
+				index1 += 1;
+			}
+			else if ( r1->generation > r2->generation )
+			{
+				// begin
+				b2ShapeId visitorId = { r2->shapeId + 1, world->worldId, r2->generation };
+				b2SensorBeginTouchEvent event = { sensorId, visitorId };
+				b2Array_Push( *beginEvents, event );
+				index2 += 1;
+			}
+			else
+			{
+				// persisted
+				index1 += 1;
+				index2 += 1;
+			}
+		}
+		else if ( r1->shapeId < r2->shapeId )
+		{
+			// end
+			b2ShapeId visitorId = { r1->shapeId + 1, world->worldId, r1->generation };
+			b2SensorEndTouchEvent event = { sensorId, visitorId };
+			b2Array_Push( *endEvents, event );
+			index1 += 1;
+		}
+		else
+		{
+			// begin
+			b2ShapeId visitorId = { r2->shapeId + 1, world->worldId, r2->generation };
+			b2SensorBeginTouchEvent event = { sensorId, visitorId };
+			b2Array_Push( *beginEvents, event );
+			index2 += 1;
+		}
+	}
+
+	while ( index1 < count1 )
+	{
+		// end
+		const b2Visitor* r1 = refs1 + index1;
+		b2ShapeId visitorId = { r1->shapeId + 1, world->worldId, r1->generation };
+		b2SensorEndTouchEvent event = { sensorId, visitorId };
+		b2Array_Push( *endEvents, event );
+		index1 += 1;
+	}
+
+	while ( index2 < count2 )
+	{
+		// begin
+		const b2Visitor* r2 = refs2 + index2;
+		b2ShapeId visitorId = { r2->shapeId + 1, world->worldId, r2->generation };
+		b2SensorBeginTouchEvent event = { sensorId, visitorId };
+		b2Array_Push( *beginEvents, event );
+		index2 += 1;
+	}
+}
+
+// With relaxed determinism the events are found right away on the worker. Otherwise the sensor is
+// flagged and the events are published in sensor order after the overlap tasks finish.
+static void b2SensorChanged( const b2World* world, b2SensorTaskContext* taskContext, const b2Sensor* sensor, int sensorIndex )
+{
+	if ( world->enableRelaxedDeterminism )
+	{
+		b2DiffSensorOverlaps( world, sensor, &taskContext->beginEvents, &taskContext->endEvents );
+	}
+	else
+	{
+		b2SetBit( &taskContext->eventBits, sensorIndex );
+	}
+}
+
+static void b2UpdateSensor( b2World* world, b2SensorTaskContext* taskContext, int sensorIndex )
+{
+	b2DynamicTree* trees = world->broadPhase.trees;
+	b2Sensor* sensor = b2Array_Get( world->sensors,sensorIndex );
+	b2Shape* sensorShape = b2Array_Get( world->shapes,sensor->shapeId );
+
+	// Swap overlap arrays
+	b2Array( b2Visitor ) temp = sensor->overlaps1;
+	sensor->overlaps1 = sensor->overlaps2;
+	sensor->overlaps2 = temp;
+	b2Array_Clear( sensor->overlaps2 );
+
+	// Visitors are gathered in the worker buffer and copied to the sensor once sorted and unique
+	b2Array_Clear( taskContext->visitors );
+
+	// Append sensor hits
+	int hitCount = sensor->hits.count;
+	if ( hitCount > 0 )
+	{
+		b2Array_ReserveGrow( taskContext->visitors, hitCount );
+		memcpy( taskContext->visitors.data, sensor->hits.data, hitCount * sizeof( b2Visitor ) );
+		taskContext->visitors.count = hitCount;
+	}
+
+	if ( hitCount > 0 )
+	{
+		b2Array_Push( taskContext->hitSensorIds, sensor->shapeId );
+	}
+
+	// Clear the hits
+	b2Array_Clear( sensor->hits );
+
+	b2Body* body = b2Array_Get( world->bodies,sensorShape->bodyId );
+	if ( body->setIndex == b2_disabledSet || sensorShape->enableSensorEvents == false )
+	{
+		if ( sensor->overlaps1.count != 0 )
+		{
+			// This sensor is dropping all overlaps because it has been disabled.
+			b2SensorChanged( world, taskContext, sensor, sensorIndex );
+		}
+		return;
+	}
+
+	b2Transform transform = b2GetBodyTransformQuick( world, body );
+
+	struct b2SensorQueryContext queryContext = {
+		.world = world,
+		.taskContext = taskContext,
+		.sensor = sensor,
+		.sensorShape = sensorShape,
+		.transform = transform,
+	};
+
+	B2_ASSERT( sensorShape->sensorIndex == sensorIndex );
+	b2AABB queryBounds = sensorShape->aabb;
+
+	// Query all trees
+	b2DynamicTree_Query( trees + 0, queryBounds, sensorShape->filter.maskBits, b2SensorQueryCallback, &queryContext );
+	b2DynamicTree_Query( trees + 1, queryBounds, sensorShape->filter.maskBits, b2SensorQueryCallback, &queryContext );
+	b2DynamicTree_Query( trees + 2, queryBounds, sensorShape->filter.maskBits, b2SensorQueryCallback, &queryContext );
+
+	// Sort the overlaps to enable finding begin and end events.
+	int overlapCount = taskContext->visitors.count;
+	b2Array_ReserveGrow( taskContext->sortBuffer, overlapCount );
+	b2Visitor* overlapData = b2SortVisitors( taskContext->visitors.data, taskContext->sortBuffer.data, overlapCount );
+
+	// Remove duplicates (sorted) while copying to overlaps2. Duplicates are possible due to the hit events appended earlier.
+	b2Array_ReserveGrow( sensor->overlaps2, overlapCount );
+	b2Visitor* uniqueData = sensor->overlaps2.data;
+	int uniqueCount = 0;
+	for ( int i = 0; i < overlapCount; ++i )
+	{
+		if ( uniqueCount == 0 || overlapData[i].shapeId != uniqueData[uniqueCount - 1].shapeId )
+		{
+			uniqueData[uniqueCount] = overlapData[i];
+			uniqueCount += 1;
+		}
+	}
+	sensor->overlaps2.count = uniqueCount;
+
+	int count1 = sensor->overlaps1.count;
+	int count2 = sensor->overlaps2.count;
+	if ( count1 != count2 )
+	{
+		// something changed
+		b2SensorChanged( world, taskContext, sensor, sensorIndex );
+	}
+	else
+	{
+		for ( int i = 0; i < count1; ++i )
+		{
+			b2Visitor* s1 = sensor->overlaps1.data + i;
+			b2Visitor* s2 = sensor->overlaps2.data + i;
+
+			if ( s1->shapeId != s2->shapeId || s1->generation != s2->generation )
+			{
+				// something changed
+				b2SensorChanged( world, taskContext, sensor, sensorIndex );
+				break;
+			}
+		}
+	}
 }
 
 static void b2SensorTask( int startIndex, int endIndex, int threadIndex, void* context )
@@ -141,99 +380,274 @@ static void b2SensorTask( int startIndex, int endIndex, int threadIndex, void* c
 
 	B2_ASSERT( startIndex < endIndex );
 
-	b2DynamicTree* trees = world->broadPhase.trees;
 	for ( int sensorIndex = startIndex; sensorIndex < endIndex; ++sensorIndex )
 	{
-		b2Sensor* sensor = b2Array_Get( world->sensors,sensorIndex );
-		b2Shape* sensorShape = b2Array_Get( world->shapes,sensor->shapeId );
+		b2UpdateSensor( world, taskContext, sensorIndex );
+	}
 
-		// Swap overlap arrays
-		b2Array( b2Visitor ) temp = sensor->overlaps1;
-		sensor->overlaps1 = sensor->overlaps2;
-		sensor->overlaps2 = temp;
-		b2Array_Clear( sensor->overlaps2 );
+	b2TracyCZoneEnd( sensor_task );
+}
 
-		// Append sensor hits
-		int hitCount = sensor->hits.count;
-		for ( int i = 0; i < hitCount; ++i )
-		{
-			b2Array_Push( sensor->overlaps2,sensor->hits.data[i] );
-		}
+typedef struct b2SensorListContext
+{
+	b2World* world;
+	const int* sensorIndices;
+} b2SensorListContext;
+
+static void b2SensorListTask( int startIndex, int endIndex, int threadIndex, void* context )
+{
+	b2TracyCZoneNC( sensor_task, "Overlap", b2_colorBrown, true );
+
+	b2SensorListContext* listContext = context;
+	b2World* world = listContext->world;
+	b2SensorTaskContext* taskContext = world->sensorTaskContexts.data + threadIndex;
+
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		b2UpdateSensor( world, taskContext, listContext->sensorIndices[i] );
+	}
+
+	b2TracyCZoneEnd( sensor_task );
+}
 
-		// Clear the hits
-		b2Array_Clear( sensor->hits );
+// Sensors with an update interval are staggered by shape id so they don't all update on the same step
+static bool b2IsSensorDue( const b2World* world, const b2Sensor* sensor )
+{
+	if ( sensor->updateInterval <= 1 )
+	{
+		return true;
+	}
 
-		b2Body* body = b2Array_Get( world->bodies,sensorShape->bodyId );
-		if ( body->setIndex == b2_disabledSet || sensorShape->enableSensorEvents == false )
+	return ( world->stepIndex + (uint64_t)sensor->shapeId ) % (uint64_t)sensor->updateInterval == 0;
+}
+
+// Incremental sensor update
+// A sensor overlap can only change if the sensor moved, if a shape moved into or out of the sensor, or if
+// shapes were created, destroyed or modified by the user. Moving shapes are the shapes of the bodies in
+// the move event array, which includes bodies that fell asleep this step. Each moving shape queries the
+// sensor tree with the union of its current bounds and the bounds the sensors last saw, which finds the
+// sensors it may have entered or left. Changes made by the user bump the broad-phase revision or set
+// the full update flag and all sensors are updated. A dirty sensor that is not due is kept pending until
+// its next update step.
+
+struct b2SensorMarkContext
+{
+	b2World* world;
+	b2BitSet* dirtyBits;
+};
+
+static bool b2MarkSensorCallback( int proxyId, uint64_t userData, void* context )
+{
+	B2_UNUSED( proxyId );
+
+	struct b2SensorMarkContext* markContext = context;
+	b2Shape* sensorShape = markContext->world->shapes.data + (int)userData;
+	B2_ASSERT( sensorShape->sensorIndex != B2_NULL_INDEX );
+	b2SetBit( markContext->dirtyBits, sensorShape->sensorIndex );
+	return true;
+}
+
+static void b2MarkSensorsTask( int startIndex, int endIndex, int threadIndex, void* context )
+{
+	b2TracyCZoneNC( mark_sensors, "Mark Sensors", b2_colorBrown, true );
+
+	b2World* world = context;
+	b2SensorTaskContext* taskContext = world->sensorTaskContexts.data + threadIndex;
+	const b2BodyMoveEvent* moveEvents = world->bodyMoveEvents.data;
+
+	struct b2SensorMarkContext markContext = {
+		.world = world,
+		.dirtyBits = &taskContext->dirtyBits,
+	};
+
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		b2Body* body = b2Array_Get( world->bodies, moveEvents[i].bodyId.index1 - 1 );
+
+		int shapeId = body->headShapeId;
+		while ( shapeId != B2_NULL_INDEX )
 		{
-			if ( sensor->overlaps1.count != 0 )
+			b2Shape* shape = world->shapes.data + shapeId;
+			shapeId = shape->nextShapeId;
+
+			if ( shape->sensorIndex != B2_NULL_INDEX )
 			{
-				// This sensor is dropping all overlaps because it has been disabled.
-				b2SetBit( &taskContext->eventBits, sensorIndex );
+				// The sensor moved
+				b2SetBit( &taskContext->dirtyBits, shape->sensorIndex );
 			}
-			continue;
+
+			if ( shape->enableSensorEvents )
+			{
+				b2AABB bounds = b2AABB_Union( shape->sensorAABB, shape->aabb );
+				b2DynamicTree_Query( &world->sensorTree, bounds, shape->filter.categoryBits, b2MarkSensorCallback,
+									 &markContext );
+			}
+
+			// Each shape belongs to one body, so this write is not shared with other workers
+			shape->sensorAABB = shape->aabb;
 		}
+	}
 
-		b2Transform transform = b2GetBodyTransformQuick( world, body );
+	b2TracyCZoneEnd( mark_sensors );
+}
 
-		struct b2SensorQueryContext queryContext = {
-			.world = world,
-			.taskContext = taskContext,
-			.sensor = sensor,
-			.sensorShape = sensorShape,
-			.transform = transform,
-		};
+// Keep the sensor tree proxy in sync with the sensor shape bounds and mask
+static void b2UpdateSensorProxy( b2World* world, b2Sensor* sensor )
+{
+	b2Shape* sensorShape = b2Array_Get( world->shapes, sensor->shapeId );
+	b2DynamicTree* tree = &world->sensorTree;
+
+	if ( sensor->proxyId == B2_NULL_INDEX )
+	{
+		sensor->proxyId =
+			b2DynamicTree_CreateProxy( tree, sensorShape->aabb, sensorShape->filter.maskBits, (uint64_t)sensor->shapeId );
+		return;
+	}
+
+	b2AABB aabb = b2DynamicTree_GetAABB( tree, sensor->proxyId );
+	if ( memcmp( &aabb, &sensorShape->aabb, sizeof( b2AABB ) ) != 0 )
+	{
+		b2DynamicTree_MoveProxy( tree, sensor->proxyId, sensorShape->aabb );
+	}
+
+	if ( b2DynamicTree_GetCategoryBits( tree, sensor->proxyId ) != sensorShape->filter.maskBits )
+	{
+		b2DynamicTree_SetCategoryBits( tree, sensor->proxyId, sensorShape->filter.maskBits );
+	}
+}
 
-		B2_ASSERT( sensorShape->sensorIndex == sensorIndex );
-		b2AABB queryBounds = sensorShape->aabb;
+// Returns the number of sensors that need an update, written to sensorIndices in ascending order
+static int b2FindDirtySensors( b2World* world, int* sensorIndices, bool fullUpdate )
+{
+	int sensorCount = world->sensors.count;
+	for ( int i = 0; i < world->workerCount; ++i )
+	{
+		b2SetBitCountAndClear( &world->sensorTaskContexts.data[i].dirtyBits, sensorCount );
+	}
+
+	int moveCount = world->bodyMoveEvents.count;
+	if ( moveCount > 0 )
+	{
+		int minRange = 32;
+		b2ParallelFor( world, &b2MarkSensorsTask, moveCount, minRange, world );
+	}
 
-		// Query all trees
-		b2DynamicTree_Query( trees + 0, queryBounds, sensorShape->filter.maskBits, b2SensorQueryCallback, &queryContext );
-		b2DynamicTree_Query( trees + 1, queryBounds, sensorShape->filter.maskBits, b2SensorQueryCallback, &queryContext );
-		b2DynamicTree_Query( trees + 2, queryBounds, sensorShape->filter.maskBits, b2SensorQueryCallback, &queryContext );
+	b2BitSet* dirtyBits = &world->sensorTaskContexts.data[0].dirtyBits;
+	for ( int i = 1; i < world->workerCount; ++i )
+	{
+		b2InPlaceUnion( dirtyBits, &world->sensorTaskContexts.data[i].dirtyBits );
+	}
 
-		// Sort the overlaps to enable finding begin and end events.
-		qsort( sensor->overlaps2.data, sensor->overlaps2.count, sizeof( b2Visitor ), b2CompareVisitors );
+	// Sensors hit by continuous collision this step, and sensors that kept a hit last step and
+	// need to drop it if the visitor is no longer overlapping
+	for ( int i = 0; i < world->workerCount; ++i )
+	{
+		b2TaskContext* taskContext = world->taskContexts.data + i;
+		int hitCount = taskContext->sensorHits.count;
+		for ( int j = 0; j < hitCount; ++j )
+		{
+			b2Shape* sensorShape = b2Array_Get( world->shapes, taskContext->sensorHits.data[j].sensorId );
+			b2SetBit( dirtyBits, sensorShape->sensorIndex );
+		}
 
-		// Remove duplicates from overlaps2 (sorted). Duplicates are possible due to the hit events appended earlier.
-		int uniqueCount = 0;
-		int overlapCount = sensor->overlaps2.count;
-		b2Visitor* overlapData = sensor->overlaps2.data;
-		for ( int i = 0; i < overlapCount; ++i )
+		b2SensorTaskContext* sensorContext = world->sensorTaskContexts.data + i;
+		int sensorIdCount = sensorContext->hitSensorIds.count;
+		for ( int j = 0; j < sensorIdCount; ++j )
 		{
-			if ( uniqueCount == 0 || overlapData[i].shapeId != overlapData[uniqueCount - 1].shapeId )
+			// A destroyed sensor bumps the broad-phase revision and all sensors are updated anyway
+			int shapeId = sensorContext->hitSensorIds.data[j];
+			if ( shapeId >= world->shapes.count )
 			{
-				overlapData[uniqueCount] = overlapData[i];
-				uniqueCount += 1;
+				continue;
+			}
+
+			b2Shape* sensorShape = world->shapes.data + shapeId;
+			if ( sensorShape->id != B2_NULL_INDEX && sensorShape->sensorIndex != B2_NULL_INDEX )
+			{
+				b2SetBit( dirtyBits, sensorShape->sensorIndex );
 			}
 		}
-		sensor->overlaps2.count = uniqueCount;
 
-		int count1 = sensor->overlaps1.count;
-		int count2 = sensor->overlaps2.count;
-		if ( count1 != count2 )
+		b2Array_Clear( sensorContext->hitSensorIds );
+	}
+
+	if ( fullUpdate )
+	{
+		for ( int i = 0; i < sensorCount; ++i )
 		{
-			// something changed
-			b2SetBit( &taskContext->eventBits, sensorIndex );
+			b2SetBit( dirtyBits, i );
 		}
-		else
+	}
+
+	// Pending sensors that are due this step
+	int pendingCount = world->pendingSensorIds.count;
+	int keepCount = 0;
+	for ( int i = 0; i < pendingCount; ++i )
+	{
+		int shapeId = world->pendingSensorIds.data[i];
+		if ( shapeId >= world->shapes.count )
 		{
-			for ( int i = 0; i < count1; ++i )
-			{
-				b2Visitor* s1 = sensor->overlaps1.data + i;
-				b2Visitor* s2 = sensor->overlaps2.data + i;
+			continue;
+		}
 
-				if ( s1->shapeId != s2->shapeId || s1->generation != s2->generation )
-				{
-					// something changed
-					b2SetBit( &taskContext->eventBits, sensorIndex );
-					break;
-				}
+		// The slot may have been reused by another sensor since it was pushed
+		b2Shape* sensorShape = world->shapes.data + shapeId;
+		if ( sensorShape->id == B2_NULL_INDEX || sensorShape->sensorIndex == B2_NULL_INDEX )
+		{
+			continue;
+		}
+
+		b2Sensor* sensor = world->sensors.data + sensorShape->sensorIndex;
+		if ( sensor->pending == false )
+		{
+			continue;
+		}
+
+		if ( b2IsSensorDue( world, sensor ) )
+		{
+			sensor->pending = false;
+			b2SetBit( dirtyBits, sensorShape->sensorIndex );
+			continue;
+		}
+
+		world->pendingSensorIds.data[keepCount] = shapeId;
+		keepCount += 1;
+	}
+
+	world->pendingSensorIds.count = keepCount;
+
+	int dirtyCount = 0;
+	uint64_t* bits = dirtyBits->bits;
+	uint32_t blockCount = dirtyBits->blockCount;
+	for ( uint32_t k = 0; k < blockCount; ++k )
+	{
+		uint64_t word = bits[k];
+		while ( word != 0 )
+		{
+			uint32_t ctz = b2CTZ64( word );
+			int sensorIndex = (int)( 64 * k + ctz );
+
+			// Moving sensors are always dirty, so this keeps the tree current
+			b2Sensor* sensor = world->sensors.data + sensorIndex;
+			b2UpdateSensorProxy( world, sensor );
+
+			if ( b2IsSensorDue( world, sensor ) )
+			{
+				sensor->pending = false;
+				sensorIndices[dirtyCount] = sensorIndex;
+				dirtyCount += 1;
+			}
+			else if ( sensor->pending == false )
+			{
+				sensor->pending = true;
+				b2Array_Push( world->pendingSensorIds, sensor->shapeId );
 			}
+
+			word = word & ( word - 1 );
 		}
 	}
 
-	b2TracyCZoneEnd( sensor_task );
+	return dirtyCount;
 }
 
 void b2OverlapSensors( b2World* world )
@@ -241,6 +655,7 @@ void b2OverlapSensors( b2World* world )
 	int sensorCount = world->sensors.count;
 	if ( sensorCount == 0 )
 	{
+		world->sensorUpdateCount = 0;
 		return;
 	}
 
@@ -251,13 +666,100 @@ void b2OverlapSensors( b2World* world )
 	for ( int i = 0; i < world->workerCount; ++i )
 	{
 		b2SetBitCountAndClear( &world->sensorTaskContexts.data[i].eventBits, sensorCount );
+		b2Array_Clear( world->sensorTaskContexts.data[i].beginEvents );
+		b2Array_Clear( world->sensorTaskContexts.data[i].endEvents );
 	}
 
+	// A step without time leaves no move events, so moved shapes cannot be found
+	bool incremental = world->enableIncrementalSensors;
+	bool fullUpdate = incremental == false || world->sensorFullUpdate || world->broadPhase.revision != world->sensorRevision ||
+					  world->inv_dt == 0.0f;
+
 	// Parallel-for sensors overlaps
 	int minRange = 16;
-	b2ParallelFor( world, &b2SensorTask, sensorCount, minRange, world );
+	if ( incremental )
+	{
+		int* sensorIndices = b2StackAlloc( &world->stack, sensorCount * sizeof( int ), "sensor indices" );
+		int dirtyCount = b2FindDirtySensors( world, sensorIndices, fullUpdate );
+
+		if ( dirtyCount > 0 )
+		{
+			b2SensorListContext context = { world, sensorIndices };
+			b2ParallelFor( world, &b2SensorListTask, dirtyCount, minRange, &context );
+		}
+
+		world->sensorUpdateCount = dirtyCount;
+
+		b2StackFree( &world->stack, sensorIndices );
+
+		world->sensorRevision = world->broadPhase.revision;
+		world->sensorFullUpdate = false;
+	}
+	else
+	{
+		for ( int i = 0; i < world->workerCount; ++i )
+		{
+			b2Array_Clear( world->sensorTaskContexts.data[i].hitSensorIds );
+		}
+
+		// Incremental mode starts with a full update, which rebuilds the pending list
+		for ( int i = 0; i < world->pendingSensorIds.count; ++i )
+		{
+			int shapeId = world->pendingSensorIds.data[i];
+			if ( shapeId < world->shapes.count && world->shapes.data[shapeId].sensorIndex != B2_NULL_INDEX )
+			{
+				world->sensors.data[world->shapes.data[shapeId].sensorIndex].pending = false;
+			}
+		}
+
+		b2Array_Clear( world->pendingSensorIds );
+
+		int* sensorIndices = b2StackAlloc( &world->stack, sensorCount * sizeof( int ), "sensor indices" );
+		int dueCount = 0;
+		for ( int i = 0; i < sensorCount; ++i )
+		{
+			if ( b2IsSensorDue( world, world->sensors.data + i ) )
+			{
+				sensorIndices[dueCount] = i;
+				dueCount += 1;
+			}
+		}
+
+		if ( dueCount == sensorCount )
+		{
+			b2ParallelFor( world, &b2SensorTask, sensorCount, minRange, world );
+		}
+		else if ( dueCount > 0 )
+		{
+			b2SensorListContext context = { world, sensorIndices };
+			b2ParallelFor( world, &b2SensorListTask, dueCount, minRange, &context );
+		}
+
+		world->sensorUpdateCount = dueCount;
+
+		b2StackFree( &world->stack, sensorIndices );
+	}
 
 	b2TracyCZoneNC( sensor_state, "Events", b2_colorLightSlateGray, true );
+	b2AllocInfo previousAllocInfo = b2PushAllocTag( b2_allocTagEvents, b2_allocLifetimeLong );
+
+	b2Array( b2SensorEndTouchEvent )* endEvents = world->sensorEndEvents + world->endEventArrayIndex;
+
+	if ( world->enableRelaxedDeterminism )
+	{
+		// The workers already found the events. The order depends on how the sensors were split among workers.
+		for ( int i = 0; i < world->workerCount; ++i )
+		{
+			b2SensorTaskContext* taskContext = world->sensorTaskContexts.data + i;
+			b2Array_Append( world->sensorBeginEvents, taskContext->beginEvents );
+			b2Array_Append( *endEvents, taskContext->endEvents );
+		}
+
+		b2PopAllocInfo( previousAllocInfo );
+		b2TracyCZoneEnd( sensor_state );
+		b2TracyCZoneEnd( overlap_sensors );
+		return;
+	}
 
 	b2BitSet* bitSet = &world->sensorTaskContexts.data[0].eventBits;
 	for ( int i = 1; i < world->workerCount; ++i )
@@ -278,93 +780,15 @@ void b2OverlapSensors( b2World* world )
 			uint32_t ctz = b2CTZ64( word );
 			int sensorIndex = (int)( 64 * k + ctz );
 
-			b2Sensor* sensor = b2Array_Get( world->sensors,sensorIndex );
-			b2Shape* sensorShape = b2Array_Get( world->shapes,sensor->shapeId );
-			b2ShapeId sensorId = { sensor->shapeId + 1, world->worldId, sensorShape->generation };
-
-			int count1 = sensor->overlaps1.count;
-			int count2 = sensor->overlaps2.count;
-			const b2Visitor* refs1 = sensor->overlaps1.data;
-			const b2Visitor* refs2 = sensor->overlaps2.data;
-
-			// overlaps1 can have overlaps that end
-			// overlaps2 can have overlaps that begin
-			int index1 = 0, index2 = 0;
-			while ( index1 < count1 && index2 < count2 )
-			{
-				const b2Visitor* r1 = refs1 + index1;
-				const b2Visitor* r2 = refs2 + index2;
-				if ( r1->shapeId == r2->shapeId )
-				{
-					if ( r1->generation < r2->generation )
-					{
-						// end
-						b2ShapeId visitorId = { r1->shapeId + 1, world->worldId, r1->generation };
-						b2SensorEndTouchEvent event = {
-							.sensorShapeId = sensorId,
-							.visitorShapeId = visitorId,
-						};
-						b2Array_Push( world->sensorEndEvents[world->endEventArrayIndex],event );
-						index1 += 1;
-					}
-					else if ( r1->generation > r2->generation )
-					{
-						// begin
-						b2ShapeId visitorId = { r2->shapeId + 1, world->worldId, r2->generation };
-						b2SensorBeginTouchEvent event = { sensorId, visitorId };
-						b2Array_Push( world->sensorBeginEvents,event );
-						index2 += 1;
-					}
-					else
-					{
-						// persisted
-						index1 += 1;
-						index2 += 1;
-					}
-				}
-				else if ( r1->shapeId < r2->shapeId )
-				{
-					// end
-					b2ShapeId visitorId = { r1->shapeId + 1, world->worldId, r1->generation };
-					b2SensorEndTouchEvent event = { sensorId, visitorId };
-					b2Array_Push( world->sensorEndEvents[world->endEventArrayIndex],event );
-					index1 += 1;
-				}
-				else
-				{
-					// begin
-					b2ShapeId visitorId = { r2->shapeId + 1, world->worldId, r2->generation };
-					b2SensorBeginTouchEvent event = { sensorId, visitorId };
-					b2Array_Push( world->sensorBeginEvents,event );
-					index2 += 1;
-				}
-			}
-
-			while ( index1 < count1 )
-			{
-				// end
-				const b2Visitor* r1 = refs1 + index1;
-				b2ShapeId visitorId = { r1->shapeId + 1, world->worldId, r1->generation };
-				b2SensorEndTouchEvent event = { sensorId, visitorId };
-				b2Array_Push( world->sensorEndEvents[world->endEventArrayIndex],event );
-				index1 += 1;
-			}
-
-			while ( index2 < count2 )
-			{
-				// begin
-				const b2Visitor* r2 = refs2 + index2;
-				b2ShapeId visitorId = { r2->shapeId + 1, world->worldId, r2->generation };
-				b2SensorBeginTouchEvent event = { sensorId, visitorId };
-				b2Array_Push( world->sensorBeginEvents,event );
-				index2 += 1;
-			}
+			b2Sensor* sensor = b2Array_Get( world->sensors, sensorIndex );
+			b2DiffSensorOverlaps( world, sensor, &world->sensorBeginEvents, endEvents );
 
 			// Clear the smallest set bit
 			word = word & ( word - 1 );
 		}
 	}
 
+	b2PopAllocInfo( previousAllocInfo );
 	b2TracyCZoneEnd( sensor_state );
 	b2TracyCZoneEnd( overlap_sensors );
 }
@@ -393,6 +817,11 @@ void b2DestroySensor( b2World* world, b2Shape* sensorShape )
 		b2Array_Push( world->sensorEndEvents[world->endEventArrayIndex], event );
 	}
 
+	if ( sensor->proxyId != B2_NULL_INDEX )
+	{
+		b2DynamicTree_DestroyProxy( &world->sensorTree, sensor->proxyId );
+	}
+
 	// Destroy sensor
 	b2Array_Destroy( sensor->hits );
 	b2Array_Destroy( sensor->overlaps1 );
@@ -405,5 +834,6 @@ void b2DestroySensor( b2World* world, b2Shape* sensorShape )
 		b2Sensor* movedSensor = b2Array_Get( world->sensors,sensorShape->sensorIndex );
 		b2Shape* otherSensorShape = b2Array_Get( world->shapes,movedSensor->shapeId );
 		otherSensorShape->sensorIndex = sensorShape->sensorIndex;
+		b2MarkDirty( world, b2_dirtyShape, movedSensor->shapeId );
 	}
 }
@@ -6,6 +6,8 @@
 #include "bitset.h"
 #include "container.h"
 
+#include "box2d/types.h"
+
 typedef struct b2Shape b2Shape;
 typedef struct b2World b2World;
 
@@ -33,13 +35,39 @@ typedef struct b2Sensor
 	b2Array( b2Visitor ) overlaps1;
 	b2Array( b2Visitor ) overlaps2;
 	int shapeId;
+
+	// Proxy in the world sensor tree, created by the first incremental update
+	int proxyId;
+
+	// Steps between overlap updates, see b2ShapeDef::sensorUpdateInterval
+	int updateInterval;
+
+	// Marked dirty by incremental mode on a step it was not due. Kept in the world pending list.
+	bool pending;
 } b2Sensor;
 
 b2DeclareArray( b2Sensor );
+b2DeclareArray( b2SensorBeginTouchEvent );
+b2DeclareArray( b2SensorEndTouchEvent );
 
 typedef struct b2SensorTaskContext
 {
 	b2BitSet eventBits;
+
+	// Sensors that need an update in incremental mode
+	b2BitSet dirtyBits;
+
+	// Shape ids of sensors updated with continuous hits. A hit is not a geometric overlap, so these
+	// sensors are updated again in the next step of incremental mode.
+	b2Array( int ) hitSensorIds;
+
+	// Scratch space for gathering and sorting the visitors of one sensor
+	b2Array( b2Visitor ) visitors;
+	b2Array( b2Visitor ) sortBuffer;
+
+	// Events found by this worker with relaxed determinism
+	b2Array( b2SensorBeginTouchEvent ) beginEvents;
+	b2Array( b2SensorEndTouchEvent ) endEvents;
 } b2SensorTaskContext;
 
 b2DeclareArray( b2SensorTaskContext );
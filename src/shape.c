@@ -3,17 +3,23 @@
 
 #include "shape.h"
 
+#include "arena_allocator.h"
 #include "body.h"
 #include "broad_phase.h"
+#include "compound.h"
 #include "contact.h"
+#include "core.h"
 #include "physics_world.h"
+#include "recorder.h"
 #include "sensor.h"
 
 // needed for dll export
 #include "solver_set.h"
 #include "box2d/box2d.h"
 
+#include <float.h>
 #include <stddef.h>
+#include <string.h>
 
 static b2Shape* b2GetShape( b2World* world, b2ShapeId shapeId )
 {
@@ -33,6 +39,11 @@ static b2ChainShape* b2GetChainShape( b2World* world, b2ChainId chainId )
 
 static float b2ComputeShapeMargin( b2Shape* shape )
 {
+	if ( shape->customMargin > 0.0f )
+	{
+		return shape->customMargin;
+	}
+
 	float margin = 0.0f;
 
 	switch ( shape->type )
@@ -76,6 +87,13 @@ static float b2ComputeShapeMargin( b2Shape* shape )
 		}
 		break;
 
+		case b2_compoundShape:
+		{
+			const b2Compound* compound = shape->compound;
+			margin = 0.5f * b2Length( b2Sub( compound->bounds.upperBound, compound->bounds.lowerBound ) );
+		}
+		break;
+
 		default:
 			B2_VALIDATE( false );
 			return B2_MAX_AABB_MARGIN;
@@ -84,10 +102,20 @@ static float b2ComputeShapeMargin( b2Shape* shape )
 	return b2MinFloat( B2_MAX_AABB_MARGIN, B2_AABB_MARGIN_FRACTION * margin );
 }
 
+float b2GetShapeDefSpeculativeDistance( const b2ShapeDef* def )
+{
+	if ( def->speculativeDistance == 0.0f )
+	{
+		return B2_SPECULATIVE_DISTANCE;
+	}
+
+	return b2ClampFloat( def->speculativeDistance, B2_LINEAR_SLOP, B2_SPECULATIVE_DISTANCE );
+}
+
 static void b2UpdateShapeAABBs( b2Shape* shape, b2Transform transform, b2BodyType proxyType )
 	{
 	// Compute a bounding box with a speculative margin
-	const float speculativeDistance = B2_SPECULATIVE_DISTANCE;
+	const float speculativeDistance = shape->speculativeDistance;
 	const float aabbMargin = shape->aabbMargin;
 
 	b2AABB aabb = b2ComputeShapeAABB( shape, transform );
@@ -97,6 +125,9 @@ static void b2UpdateShapeAABBs( b2Shape* shape, b2Transform transform, b2BodyTyp
 	aabb.upperBound.y += speculativeDistance;
 	shape->aabb = aabb;
 
+	// Keep the bounds sensors last saw until the next incremental sensor update
+	shape->sensorAABB = b2AABB_Union( shape->sensorAABB, aabb );
+
 	// Smaller margin for static bodies. Cannot be zero due to TOI tolerance.
 	float margin = proxyType == b2_staticBody ? speculativeDistance : aabbMargin;
 	b2AABB fatAABB;
@@ -105,16 +136,20 @@ static void b2UpdateShapeAABBs( b2Shape* shape, b2Transform transform, b2BodyTyp
 	fatAABB.upperBound.x = aabb.upperBound.x + margin;
 	fatAABB.upperBound.y = aabb.upperBound.y + margin;
 	shape->fatAABB = fatAABB;
+
+	// This is only used for new proxies and proxies that lost their contacts
+	b2ResetPairAABB( shape );
 }
 
-static b2Shape* b2CreateShapeInternal( b2World* world, b2Body* body, b2Transform transform, const b2ShapeDef* def,
-									   const void* geometry, b2ShapeType shapeType )
+// Create a shape without its broad-phase proxy
+b2Shape* b2CreateShapeWithoutProxy( b2World* world, b2Body* body, const b2ShapeDef* def, const void* geometry,
+									b2ShapeType shapeType )
 {
 	int shapeId = b2AllocId( &world->shapeIdPool );
 
 	if ( shapeId == world->shapes.count )
 	{
-		b2Array_Push( world->shapes,(b2Shape){ 0 } );
+		b2Array_Push( world->shapes, (b2Shape){ .generation = world->shapeGenerationFloor } );
 	}
 	else
 	{
@@ -145,6 +180,10 @@ static b2Shape* b2CreateShapeInternal( b2World* world, b2Body* body, b2Transform
 			shape->chainSegment = *(const b2ChainSegment*)geometry;
 			break;
 
+		case b2_compoundShape:
+			shape->compound = geometry;
+			break;
+
 		default:
 			B2_ASSERT( false );
 			break;
@@ -165,24 +204,28 @@ static b2Shape* b2CreateShapeInternal( b2World* world, b2Body* body, b2Transform
 	shape->enablePreSolveEvents = def->enablePreSolveEvents;
 	shape->proxyKey = B2_NULL_INDEX;
 	shape->localCentroid = b2GetShapeCentroid( shape );
+	shape->customMargin = def->aabbMargin;
 	shape->aabbMargin = b2ComputeShapeMargin( shape );
+	shape->speculativeDistance = b2GetShapeDefSpeculativeDistance( def );
 	shape->aabb = (b2AABB){ b2Vec2_zero, b2Vec2_zero };
 	shape->fatAABB = (b2AABB){ b2Vec2_zero, b2Vec2_zero };
-	shape->generation += 1;
+	b2ResetPairAABB( shape );
 
-	if ( body->setIndex != b2_disabledSet )
-	{
-		b2BodyType proxyType = body->type;
-		b2CreateShapeProxy( shape, &world->broadPhase, proxyType, transform, def->invokeContactCreation || def->isSensor );
-	}
+	// Empty so the first computed bounds replace it
+	shape->sensorAABB = (b2AABB){ { FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX } };
+	shape->generation += 1;
 
 	// Add to shape doubly linked list
 	if ( body->headShapeId != B2_NULL_INDEX )
 	{
 		b2Shape* headShape = b2Array_Get( world->shapes,body->headShapeId );
 		headShape->prevShapeId = shapeId;
+		b2MarkDirty( world, b2_dirtyShape, body->headShapeId );
 	}
 
+	b2MarkDirty( world, b2_dirtyShape, shapeId );
+	b2MarkBodyDirty( world, body );
+
 	shape->prevShapeId = B2_NULL_INDEX;
 	shape->nextShapeId = body->headShapeId;
 	body->headShapeId = shapeId;
@@ -193,6 +236,8 @@ static b2Shape* b2CreateShapeInternal( b2World* world, b2Body* body, b2Transform
 		shape->sensorIndex = world->sensors.count;
 		b2Sensor sensor = { 0 };
 		sensor.shapeId = shapeId;
+		sensor.proxyId = B2_NULL_INDEX;
+		sensor.updateInterval = b2MaxInt( 1, def->sensorUpdateInterval );
 		b2Array_CreateN( sensor.hits, 4 );
 		b2Array_CreateN( sensor.overlaps1, 16 );
 		b2Array_CreateN( sensor.overlaps2, 16 );
@@ -203,6 +248,20 @@ static b2Shape* b2CreateShapeInternal( b2World* world, b2Body* body, b2Transform
 		shape->sensorIndex = B2_NULL_INDEX;
 	}
 
+	return shape;
+}
+
+static b2Shape* b2CreateShapeInternal( b2World* world, b2Body* body, b2Transform transform, const b2ShapeDef* def,
+									   const void* geometry, b2ShapeType shapeType )
+{
+	b2Shape* shape = b2CreateShapeWithoutProxy( world, body, def, geometry, shapeType );
+
+	if ( body->setIndex != b2_disabledSet )
+	{
+		b2BodyType proxyType = body->type;
+		b2CreateShapeProxy( shape, &world->broadPhase, proxyType, transform, def->invokeContactCreation || def->isSensor );
+	}
+
 	b2ValidateSolverSets( world );
 
 	return shape;
@@ -212,6 +271,8 @@ static b2ShapeId b2CreateShape( b2BodyId bodyId, const b2ShapeDef* def, const vo
 {
 	B2_CHECK_DEF( def );
 	B2_ASSERT( b2IsValidFloat( def->density ) && def->density >= 0.0f );
+	B2_ASSERT( b2IsValidFloat( def->speculativeDistance ) && def->speculativeDistance >= 0.0f );
+	B2_ASSERT( b2IsValidFloat( def->aabbMargin ) && def->aabbMargin >= 0.0f );
 	B2_ASSERT( b2IsValidFloat( def->material.friction ) && def->material.friction >= 0.0f );
 	B2_ASSERT( b2IsValidFloat( def->material.restitution ) && def->material.restitution >= 0.0f );
 	B2_ASSERT( b2IsValidFloat( def->material.rollingResistance ) && def->material.rollingResistance >= 0.0f );
@@ -240,6 +301,12 @@ static b2ShapeId b2CreateShape( b2BodyId bodyId, const b2ShapeDef* def, const vo
 	b2ValidateSolverSets( world );
 
 	b2ShapeId id = { shape->id + 1, bodyId.world0, shape->generation };
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCreateShape( world->recorder, bodyId, def, geometry, shapeType, id );
+	}
+
 	return id;
 }
 
@@ -265,6 +332,12 @@ b2ShapeId b2CreatePolygonShape( b2BodyId bodyId, const b2ShapeDef* def, const b2
 	return b2CreateShape( bodyId, def, polygon, b2_polygonShape );
 }
 
+b2ShapeId b2CreateCompoundShape( b2BodyId bodyId, const b2ShapeDef* def, const b2Compound* compound )
+{
+	B2_ASSERT( compound != NULL && compound->count > 0 );
+	return b2CreateShape( bodyId, def, compound, b2_compoundShape );
+}
+
 b2ShapeId b2CreateSegmentShape( b2BodyId bodyId, const b2ShapeDef* def, const b2Segment* segment )
 {
 	float lengthSqr = b2DistanceSquared( segment->point1, segment->point2 );
@@ -277,30 +350,40 @@ b2ShapeId b2CreateSegmentShape( b2BodyId bodyId, const b2ShapeDef* def, const b2
 	return b2CreateShape( bodyId, def, segment, b2_segmentShape );
 }
 
-// Destroy a shape on a body. This doesn't need to be called when destroying a body.
-static void b2DestroyShapeInternal( b2World* world, b2Shape* shape, b2Body* body, bool wakeBodies )
+// Remove the shape from the body's doubly linked list.
+static void b2UnlinkShape( b2World* world, b2Shape* shape, b2Body* body )
 {
-	int shapeId = shape->id;
+	b2MarkDirty( world, b2_dirtyShape, shape->id );
+	b2MarkBodyDirty( world, body );
 
-	// Remove the shape from the body's doubly linked list.
 	if ( shape->prevShapeId != B2_NULL_INDEX )
 	{
 		b2Shape* prevShape = b2Array_Get( world->shapes,shape->prevShapeId );
 		prevShape->nextShapeId = shape->nextShapeId;
+		b2MarkDirty( world, b2_dirtyShape, shape->prevShapeId );
 	}
 
 	if ( shape->nextShapeId != B2_NULL_INDEX )
 	{
 		b2Shape* nextShape = b2Array_Get( world->shapes,shape->nextShapeId );
 		nextShape->prevShapeId = shape->prevShapeId;
+		b2MarkDirty( world, b2_dirtyShape, shape->nextShapeId );
 	}
 
-	if ( shapeId == body->headShapeId )
+	if ( shape->id == body->headShapeId )
 	{
 		body->headShapeId = shape->nextShapeId;
 	}
 
 	body->shapeCount -= 1;
+}
+
+// Destroy a shape on a body. This doesn't need to be called when destroying a body.
+static void b2DestroyShapeInternal( b2World* world, b2Shape* shape, b2Body* body, bool wakeBodies )
+{
+	int shapeId = shape->id;
+
+	b2UnlinkShape( world, shape, body );
 
 	// Remove from broad-phase.
 	b2DestroyShapeProxy( shape, &world->broadPhase );
@@ -323,41 +406,7 @@ static void b2DestroyShapeInternal( b2World* world, b2Shape* shape, b2Body* body
 
 	if ( shape->sensorIndex != B2_NULL_INDEX )
 	{
-		b2Sensor* sensor = b2Array_Get( world->sensors,shape->sensorIndex );
-		for ( int i = 0; i < sensor->overlaps2.count; ++i )
-		{
-			b2Visitor* ref = sensor->overlaps2.data + i;
-			b2SensorEndTouchEvent event = {
-				.sensorShapeId =
-					{
-						.index1 = shapeId + 1,
-						.world0 = world->worldId,
-						.generation = shape->generation,
-					},
-				.visitorShapeId =
-					{
-						.index1 = ref->shapeId + 1,
-						.world0 = world->worldId,
-						.generation = ref->generation,
-					},
-			};
-
-			b2Array_Push( world->sensorEndEvents[world->endEventArrayIndex],event );
-		}
-
-		// Destroy sensor
-		b2Array_Destroy( sensor->hits );
-		b2Array_Destroy( sensor->overlaps1 );
-		b2Array_Destroy( sensor->overlaps2 );
-
-		int movedIndex = b2Array_RemoveSwap( world->sensors,shape->sensorIndex );
-		if ( movedIndex != B2_NULL_INDEX )
-		{
-			// Fixup moved sensor
-			b2Sensor* movedSensor = b2Array_Get( world->sensors,shape->sensorIndex );
-			b2Shape* otherSensorShape = b2Array_Get( world->shapes,movedSensor->shapeId );
-			otherSensorShape->sensorIndex = shape->sensorIndex;
-		}
+		b2DestroySensor( world, shape );
 	}
 
 	// Return shape to free list.
@@ -377,6 +426,13 @@ void b2DestroyShape( b2ShapeId shapeId, bool updateBodyMass )
 
 	b2Shape* shape = b2GetShape( world, shapeId );
 
+	if ( world->recorder != NULL )
+	{
+		b2RecordCall( world->recorder, b2_recordDestroyShape );
+		b2RecordValue( world->recorder, shapeId );
+		b2RecordValue( world->recorder, updateBodyMass );
+	}
+
 	// need to wake bodies because this might be a static body
 	bool wakeBodies = true;
 	b2Body* body = b2Array_Get( world->bodies,shape->bodyId );
@@ -401,13 +457,12 @@ b2ChainId b2CreateChain( b2BodyId bodyId, const b2ChainDef* def )
 	}
 
 	b2Body* body = b2GetBodyFullId( world, bodyId );
-	b2Transform transform = b2GetBodyTransformQuick( world, body );
 
 	int chainId = b2AllocId( &world->chainIdPool );
 
 	if ( chainId == world->chainShapes.count )
 	{
-		b2Array_Push( world->chainShapes,(b2ChainShape){ 0 } );
+		b2Array_Push( world->chainShapes, (b2ChainShape){ .generation = world->chainGenerationFloor } );
 	}
 	else
 	{
@@ -420,6 +475,8 @@ b2ChainId b2CreateChain( b2BodyId bodyId, const b2ChainDef* def )
 	chainShape->bodyId = body->id;
 	chainShape->nextChainId = body->headChainId;
 	chainShape->generation += 1;
+	b2MarkDirty( world, b2_dirtyChain, chainId );
+	b2MarkBodyDirty( world, body );
 
 	int materialCount = def->materialCount;
 	chainShape->materialCount = materialCount;
@@ -468,7 +525,7 @@ b2ChainId b2CreateChain( b2BodyId bodyId, const b2ChainDef* def )
 			int materialIndex = materialCount == 1 ? 0 : i;
 			shapeDef.material = def->materials[materialIndex];
 
-			b2Shape* shape = b2CreateShapeInternal( world, body, transform, &shapeDef, &chainSegment, b2_chainSegmentShape );
+			b2Shape* shape = b2CreateShapeWithoutProxy( world, body, &shapeDef, &chainSegment, b2_chainSegmentShape );
 			chainShape->shapeIndices[i] = shape->id;
 		}
 
@@ -482,7 +539,7 @@ b2ChainId b2CreateChain( b2BodyId bodyId, const b2ChainDef* def )
 			int materialIndex = materialCount == 1 ? 0 : n - 2;
 			shapeDef.material = def->materials[materialIndex];
 
-			b2Shape* shape = b2CreateShapeInternal( world, body, transform, &shapeDef, &chainSegment, b2_chainSegmentShape );
+			b2Shape* shape = b2CreateShapeWithoutProxy( world, body, &shapeDef, &chainSegment, b2_chainSegmentShape );
 			chainShape->shapeIndices[n - 2] = shape->id;
 		}
 
@@ -496,7 +553,7 @@ b2ChainId b2CreateChain( b2BodyId bodyId, const b2ChainDef* def )
 			int materialIndex = materialCount == 1 ? 0 : n - 1;
 			shapeDef.material = def->materials[materialIndex];
 
-			b2Shape* shape = b2CreateShapeInternal( world, body, transform, &shapeDef, &chainSegment, b2_chainSegmentShape );
+			b2Shape* shape = b2CreateShapeWithoutProxy( world, body, &shapeDef, &chainSegment, b2_chainSegmentShape );
 			chainShape->shapeIndices[n - 1] = shape->id;
 		}
 	}
@@ -519,12 +576,31 @@ b2ChainId b2CreateChain( b2BodyId bodyId, const b2ChainDef* def )
 			int materialIndex = materialCount == 1 ? 0 : i + 1;
 			shapeDef.material = def->materials[materialIndex];
 
-			b2Shape* shape = b2CreateShapeInternal( world, body, transform, &shapeDef, &chainSegment, b2_chainSegmentShape );
+			b2Shape* shape = b2CreateShapeWithoutProxy( world, body, &shapeDef, &chainSegment, b2_chainSegmentShape );
 			chainShape->shapeIndices[i] = shape->id;
 		}
 	}
 
+	// Insert the segment proxies as one batch. This builds a balanced subtree for the chain instead of
+	// inserting large terrains one segment at a time.
+	if ( body->setIndex != b2_disabledSet )
+	{
+		int count = chainShape->count;
+		bool* forcePairCreation = b2StackAlloc( &world->stack, count * sizeof( bool ), "force pairs" );
+		memset( forcePairCreation, 0, count * sizeof( bool ) );
+		b2CreateShapeProxies( world, chainShape->shapeIndices, forcePairCreation, count );
+		b2StackFree( &world->stack, forcePairCreation );
+	}
+
+	b2ValidateSolverSets( world );
+
 	b2ChainId id = { chainId + 1, world->worldId, chainShape->generation };
+
+	if ( world->recorder != NULL )
+	{
+		b2RecordCreateChain( world->recorder, bodyId, def, id );
+	}
+
 	return id;
 }
 
@@ -547,6 +623,12 @@ void b2DestroyChain( b2ChainId chainId )
 
 	b2ChainShape* chain = b2GetChainShape( world, chainId );
 
+	if ( world->recorder != NULL )
+	{
+		b2RecordCall( world->recorder, b2_recordDestroyChain );
+		b2RecordValue( world->recorder, chainId );
+	}
+
 	b2Body* body = b2Array_Get( world->bodies,chain->bodyId );
 
 	// Remove the chain from the body's singly linked list.
@@ -561,6 +643,7 @@ void b2DestroyChain( b2ChainId chainId )
 			break;
 		}
 
+		b2MarkDirty( world, b2_dirtyChain, *chainIdPtr );
 		chainIdPtr = &( world->chainShapes.data[*chainIdPtr].nextChainId );
 	}
 
@@ -570,19 +653,49 @@ void b2DestroyChain( b2ChainId chainId )
 		return;
 	}
 
+	// Destroy the segment contacts in one pass over the body contacts instead of one pass per segment
+	int contactKey = body->headContactKey;
+	while ( contactKey != B2_NULL_INDEX )
+	{
+		int contactId = contactKey >> 1;
+		int edgeIndex = contactKey & 1;
+
+		b2Contact* contact = b2Array_Get( world->contacts, contactId );
+		contactKey = contact->edges[edgeIndex].nextKey;
+
+		b2Shape* shapeA = b2Array_Get( world->shapes, contact->shapeIdA );
+		b2Shape* shapeB = b2Array_Get( world->shapes, contact->shapeIdB );
+		bool onChainA = shapeA->type == b2_chainSegmentShape && shapeA->chainSegment.chainId == chain->id;
+		bool onChainB = shapeB->type == b2_chainSegmentShape && shapeB->chainSegment.chainId == chain->id;
+		if ( onChainA || onChainB )
+		{
+			bool wakeBodies = true;
+			b2DestroyContact( world, contact, wakeBodies );
+		}
+	}
+
 	int count = chain->count;
+	b2DestroyShapeProxies( world, chain->shapeIndices, count );
+
+	// Chain segments are never sensors and their contacts are gone, so only the shapes are left
 	for ( int i = 0; i < count; ++i )
 	{
 		int shapeId = chain->shapeIndices[i];
-		b2Shape* shape = b2Array_Get( world->shapes,shapeId );
-		bool wakeBodies = true;
-		b2DestroyShapeInternal( world, shape, body, wakeBodies );
+		b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+		B2_ASSERT( shape->sensorIndex == B2_NULL_INDEX );
+		b2UnlinkShape( world, shape, body );
+
+		// Return shape to free list.
+		b2FreeId( &world->shapeIdPool, shapeId );
+		shape->id = B2_NULL_INDEX;
 	}
 
 	b2FreeChainData( chain );
 
 	// Return chain to free list.
 	b2FreeId( &world->chainIdPool, chain->id );
+	b2MarkDirty( world, b2_dirtyChain, chain->id );
+	b2MarkBodyDirty( world, body );
 	chain->id = B2_NULL_INDEX;
 
 	b2ValidateSolverSets( world );
@@ -641,6 +754,8 @@ b2AABB b2ComputeShapeAABB( const b2Shape* shape, b2Transform xf )
 			return b2ComputeSegmentAABB( &shape->segment, xf );
 		case b2_chainSegmentShape:
 			return b2ComputeSegmentAABB( &shape->chainSegment.segment, xf );
+		case b2_compoundShape:
+			return b2ComputeCompoundAABB( shape->compound, xf );
 		default:
 		{
 			B2_ASSERT( false );
@@ -664,6 +779,8 @@ b2Vec2 b2GetShapeCentroid( const b2Shape* shape )
 			return b2Lerp( shape->segment.point1, shape->segment.point2, 0.5f );
 		case b2_chainSegmentShape:
 			return b2Lerp( shape->chainSegment.segment.point1, shape->chainSegment.segment.point2, 0.5f );
+		case b2_compoundShape:
+			return shape->compound->unitMass.center;
 		default:
 			return b2Vec2_zero;
 	}
@@ -699,6 +816,26 @@ float b2GetShapePerimeter( const b2Shape* shape )
 			return 2.0f * b2Length( b2Sub( shape->segment.point1, shape->segment.point2 ) );
 		case b2_chainSegmentShape:
 			return 2.0f * b2Length( b2Sub( shape->chainSegment.segment.point1, shape->chainSegment.segment.point2 ) );
+		case b2_compoundShape:
+		{
+			// Includes the edges shared by neighboring polygons
+			const b2Compound* compound = shape->compound;
+			float perimeter = 0.0f;
+			for ( int i = 0; i < compound->count; ++i )
+			{
+				const b2Polygon* polygon = compound->polygons + i;
+				float polygonPerimeter = 2.0f * B2_PI * polygon->radius;
+				b2Vec2 prev = polygon->vertices[polygon->count - 1];
+				for ( int j = 0; j < polygon->count; ++j )
+				{
+					b2Vec2 next = polygon->vertices[j];
+					polygonPerimeter += b2Length( b2Sub( next, prev ) );
+					prev = next;
+				}
+				perimeter += polygonPerimeter;
+			}
+			return perimeter;
+		}
 		default:
 			return 0.0f;
 	}
@@ -751,6 +888,25 @@ float b2GetShapeProjectedPerimeter( const b2Shape* shape, b2Vec2 line )
 			return b2AbsFloat( value2 - value1 );
 		}
 
+		case b2_compoundShape:
+		{
+			const b2Compound* compound = shape->compound;
+			float lower = FLT_MAX;
+			float upper = -FLT_MAX;
+			for ( int i = 0; i < compound->count; ++i )
+			{
+				const b2Polygon* polygon = compound->polygons + i;
+				for ( int j = 0; j < polygon->count; ++j )
+				{
+					float value = b2Dot( polygon->vertices[j], line );
+					lower = b2MinFloat( lower, value - polygon->radius );
+					upper = b2MaxFloat( upper, value + polygon->radius );
+				}
+			}
+
+			return upper - lower;
+		}
+
 		default:
 			return 0.0f;
 	}
@@ -766,6 +922,8 @@ b2MassData b2ComputeShapeMass( const b2Shape* shape )
 			return b2ComputeCircleMass( &shape->circle, shape->density );
 		case b2_polygonShape:
 			return b2ComputePolygonMass( &shape->polygon, shape->density );
+		case b2_compoundShape:
+			return b2ComputeCompoundMass( shape->compound, shape->density );
 		default:
 			return (b2MassData){ 0 };
 	}
@@ -834,6 +992,36 @@ b2ShapeExtent b2ComputeShapeExtent( const b2Shape* shape, b2Vec2 localCenter )
 		}
 		break;
 
+		case b2_compoundShape:
+		{
+			// The thinnest polygon limits the extent used by continuous collision
+			const b2Compound* compound = shape->compound;
+			float minExtent = B2_HUGE;
+			float maxExtentSqr = 0.0f;
+			float maxRadius = 0.0f;
+			for ( int i = 0; i < compound->count; ++i )
+			{
+				const b2Polygon* poly = compound->polygons + i;
+				float polygonExtent = B2_HUGE;
+				for ( int j = 0; j < poly->count; ++j )
+				{
+					b2Vec2 v = poly->vertices[j];
+					float planeOffset = b2Dot( poly->normals[j], b2Sub( v, poly->centroid ) );
+					polygonExtent = b2MinFloat( polygonExtent, planeOffset );
+
+					float distanceSqr = b2LengthSquared( b2Sub( v, localCenter ) );
+					maxExtentSqr = b2MaxFloat( maxExtentSqr, distanceSqr );
+				}
+
+				minExtent = b2MinFloat( minExtent, polygonExtent + poly->radius );
+				maxRadius = b2MaxFloat( maxRadius, poly->radius );
+			}
+
+			extent.minExtent = minExtent;
+			extent.maxExtent = sqrtf( maxExtentSqr ) + maxRadius;
+		}
+		break;
+
 		default:
 			break;
 	}
@@ -841,6 +1029,40 @@ b2ShapeExtent b2ComputeShapeExtent( const b2Shape* shape, b2Vec2 localCenter )
 	return extent;
 }
 
+b2ShapePair b2MakeShapePair( const b2World* world, const b2Shape* shapeA, const b2Shape* shapeB )
+{
+	return (b2ShapePair){
+		.shapeIdA = { shapeA->id + 1, world->worldId, shapeA->generation },
+		.shapeIdB = { shapeB->id + 1, world->worldId, shapeB->generation },
+		.userDataA = shapeA->userData,
+		.userDataB = shapeB->userData,
+		.filterA = shapeA->filter,
+		.filterB = shapeB->filter,
+		.userMaterialIdA = shapeA->material.userMaterialId,
+		.userMaterialIdB = shapeB->material.userMaterialId,
+	};
+}
+
+bool b2CustomFilterShapes( b2World* world, const b2Shape* shapeA, const b2Shape* shapeB )
+{
+	if ( world->customFilterBatchFcn != NULL )
+	{
+		b2ShapePair pair = b2MakeShapePair( world, shapeA, shapeB );
+		bool result = true;
+		world->customFilterBatchFcn( &pair, &result, 1, world->customFilterBatchContext );
+		return result;
+	}
+
+	if ( world->customFilterFcn != NULL )
+	{
+		b2ShapeId idA = { shapeA->id + 1, world->worldId, shapeA->generation };
+		b2ShapeId idB = { shapeB->id + 1, world->worldId, shapeB->generation };
+		return world->customFilterFcn( idA, idB, world->customFilterContext );
+	}
+
+	return true;
+}
+
 b2CastOutput b2RayCastShape( const b2RayCastInput* input, const b2Shape* shape, b2Transform transform )
 {
 	b2RayCastInput localInput = *input;
@@ -865,6 +1087,9 @@ b2CastOutput b2RayCastShape( const b2RayCastInput* input, const b2Shape* shape,
 		case b2_chainSegmentShape:
 			output = b2RayCastSegment( &shape->chainSegment.segment, &localInput, true );
 			break;
+		case b2_compoundShape:
+			output = b2RayCastCompound( shape->compound, &localInput );
+			break;
 		default:
 			return output;
 	}
@@ -929,6 +1154,9 @@ b2CastOutput b2ShapeCastShape( const b2ShapeCastInput* input, const b2Shape* sha
 			output = b2ShapeCastSegment( &shape->chainSegment.segment, &localInput );
 		}
 		break;
+		case b2_compoundShape:
+			output = b2ShapeCastCompound( shape->compound, &localInput );
+			break;
 		default:
 			return output;
 	}
@@ -938,7 +1166,7 @@ b2CastOutput b2ShapeCastShape( const b2ShapeCastInput* input, const b2Shape* sha
 	return output;
 }
 
-b2PlaneResult b2CollideMover( const b2Capsule* mover, const b2Shape* shape, b2Transform transform )
+b2PlaneResult b2CollideMover( const b2Capsule* mover, const b2Shape* shape, int childIndex, b2Transform transform )
 {
 	b2Capsule localMover;
 	localMover.center1 = b2InvTransformPoint( transform, mover->center1 );
@@ -963,6 +1191,10 @@ b2PlaneResult b2CollideMover( const b2Capsule* mover, const b2Shape* shape, b2Tr
 		case b2_chainSegmentShape:
 			result = b2CollideMoverAndSegment( &localMover, &shape->chainSegment.segment );
 			break;
+		case b2_compoundShape:
+			B2_ASSERT( 0 <= childIndex && childIndex < shape->compound->count );
+			result = b2CollideMoverAndPolygon( &localMover, shape->compound->polygons + childIndex );
+			break;
 		default:
 			return result;
 	}
@@ -988,6 +1220,69 @@ void b2CreateShapeProxy( b2Shape* shape, b2BroadPhase* bp, b2BodyType type, b2Tr
 	B2_ASSERT( B2_PROXY_TYPE( shape->proxyKey ) < b2_bodyTypeCount );
 }
 
+void b2CreateShapeProxies( b2World* world, const int* shapeIds, const bool* forcePairCreation, int count )
+{
+	b2TracyCZoneNC( create_proxies, "Create Proxies", b2_colorDarkOrange, true );
+
+	b2Stack* alloc = &world->stack;
+	b2AABB* aabbs = b2StackAlloc( alloc, count * sizeof( b2AABB ), "proxy aabbs" );
+	uint64_t* categoryBits = b2StackAlloc( alloc, count * sizeof( uint64_t ), "proxy categories" );
+	uint64_t* userData = b2StackAlloc( alloc, count * sizeof( uint64_t ), "proxy user data" );
+	bool* typeForcePairs = b2StackAlloc( alloc, count * sizeof( bool ), "proxy pairs" );
+	int* proxyKeys = b2StackAlloc( alloc, count * sizeof( int ), "proxy keys" );
+
+	// One bulk insert per tree
+	for ( int proxyType = 0; proxyType < b2_bodyTypeCount; ++proxyType )
+	{
+		int proxyCount = 0;
+		for ( int i = 0; i < count; ++i )
+		{
+			b2Shape* shape = b2Array_Get( world->shapes, shapeIds[i] );
+			b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
+			B2_ASSERT( body->setIndex != b2_disabledSet );
+
+			if ( (int)body->type != proxyType )
+			{
+				continue;
+			}
+
+			B2_ASSERT( shape->proxyKey == B2_NULL_INDEX );
+
+			b2Transform transform = b2GetBodyTransformQuick( world, body );
+			b2UpdateShapeAABBs( shape, transform, body->type );
+
+			aabbs[proxyCount] = shape->fatAABB;
+			categoryBits[proxyCount] = shape->filter.categoryBits;
+			userData[proxyCount] = (uint64_t)shape->id;
+			typeForcePairs[proxyCount] = forcePairCreation[i];
+			proxyCount += 1;
+		}
+
+		if ( proxyCount == 0 )
+		{
+			continue;
+		}
+
+		b2BroadPhase_CreateProxies( &world->broadPhase, (b2BodyType)proxyType, aabbs, categoryBits, userData, typeForcePairs,
+									proxyCount, proxyKeys );
+
+		for ( int i = 0; i < proxyCount; ++i )
+		{
+			b2Shape* shape = b2Array_Get( world->shapes, (int)userData[i] );
+			shape->proxyKey = proxyKeys[i];
+			B2_ASSERT( B2_PROXY_TYPE( shape->proxyKey ) < b2_bodyTypeCount );
+		}
+	}
+
+	b2StackFree( alloc, proxyKeys );
+	b2StackFree( alloc, typeForcePairs );
+	b2StackFree( alloc, userData );
+	b2StackFree( alloc, categoryBits );
+	b2StackFree( alloc, aabbs );
+
+	b2TracyCZoneEnd( create_proxies );
+}
+
 void b2DestroyShapeProxy( b2Shape* shape, b2BroadPhase* bp )
 {
 	if ( shape->proxyKey != B2_NULL_INDEX )
@@ -997,6 +1292,82 @@ void b2DestroyShapeProxy( b2Shape* shape, b2BroadPhase* bp )
 	}
 }
 
+void b2GraftShapeProxies( b2World* world, const int* shapeIds, const bool* forcePairCreation, int count,
+						  const b2DynamicTree* source )
+{
+	b2TracyCZoneNC( graft_proxies, "Graft Proxies", b2_colorDarkOrange, true );
+
+	B2_ASSERT( b2DynamicTree_GetProxyCount( source ) == count );
+
+	b2Stack* alloc = &world->stack;
+	uint64_t* userData = b2StackAlloc( alloc, count * sizeof( uint64_t ), "proxy user data" );
+	int* proxyKeys = b2StackAlloc( alloc, count * sizeof( int ), "proxy keys" );
+
+	b2Body* body = b2Array_Get( world->bodies, b2Array_Get( world->shapes, shapeIds[0] )->bodyId );
+	B2_ASSERT( body->setIndex != b2_disabledSet );
+	b2Transform transform = b2GetBodyTransformQuick( world, body );
+
+	for ( int i = 0; i < count; ++i )
+	{
+		b2Shape* shape = b2Array_Get( world->shapes, shapeIds[i] );
+		B2_ASSERT( shape->bodyId == body->id && shape->proxyKey == B2_NULL_INDEX );
+		b2UpdateShapeAABBs( shape, transform, body->type );
+		userData[i] = (uint64_t)shape->id;
+	}
+
+	b2BroadPhase_GraftProxies( &world->broadPhase, body->type, source, userData, forcePairCreation, proxyKeys );
+
+	for ( int i = 0; i < count; ++i )
+	{
+		b2Shape* shape = b2Array_Get( world->shapes, shapeIds[i] );
+		shape->proxyKey = proxyKeys[i];
+
+		// The source tree must have been built from the same bounds
+		b2AABB treeBox = b2DynamicTree_GetAABB( world->broadPhase.trees + body->type, B2_PROXY_ID( shape->proxyKey ) );
+		B2_ASSERT( memcmp( &treeBox, &shape->fatAABB, sizeof( b2AABB ) ) == 0 );
+		B2_UNUSED( treeBox );
+	}
+
+	b2StackFree( alloc, proxyKeys );
+	b2StackFree( alloc, userData );
+
+	b2TracyCZoneEnd( graft_proxies );
+}
+
+void b2DestroyShapeProxies( b2World* world, const int* shapeIds, int count )
+{
+	b2TracyCZoneNC( destroy_proxies, "Destroy Proxies", b2_colorDarkOrange, true );
+
+	b2Stack* alloc = &world->stack;
+	int* proxyKeys = b2StackAlloc( alloc, count * sizeof( int ), "proxy keys" );
+
+	for ( int proxyType = 0; proxyType < b2_bodyTypeCount; ++proxyType )
+	{
+		int proxyCount = 0;
+		for ( int i = 0; i < count; ++i )
+		{
+			b2Shape* shape = b2Array_Get( world->shapes, shapeIds[i] );
+			if ( shape->proxyKey == B2_NULL_INDEX || (int)B2_PROXY_TYPE( shape->proxyKey ) != proxyType )
+			{
+				continue;
+			}
+
+			proxyKeys[proxyCount] = shape->proxyKey;
+			proxyCount += 1;
+			shape->proxyKey = B2_NULL_INDEX;
+		}
+
+		if ( proxyCount > 0 )
+		{
+			b2BroadPhase_DestroyProxies( &world->broadPhase, (b2BodyType)proxyType, proxyKeys, proxyCount );
+		}
+	}
+
+	b2StackFree( alloc, proxyKeys );
+
+	b2TracyCZoneEnd( destroy_proxies );
+}
+
 b2ShapeProxy b2MakeShapeDistanceProxy( const b2Shape* shape )
 {
 	switch ( shape->type )
@@ -1020,6 +1391,87 @@ b2ShapeProxy b2MakeShapeDistanceProxy( const b2Shape* shape )
 	}
 }
 
+int b2GetShapeChildCount( const b2Shape* shape )
+{
+	return shape->type == b2_compoundShape ? shape->compound->count : 1;
+}
+
+const b2Polygon* b2GetShapePolygon( const b2Shape* shape )
+{
+	if ( shape->type == b2_polygonShape )
+	{
+		return &shape->polygon;
+	}
+
+	if ( shape->type == b2_compoundShape && shape->compound->count == 1 )
+	{
+		return shape->compound->polygons;
+	}
+
+	return NULL;
+}
+
+b2ShapeProxy b2MakeShapeChildProxy( const b2Shape* shape, int childIndex )
+{
+	if ( shape->type == b2_compoundShape )
+	{
+		B2_ASSERT( 0 <= childIndex && childIndex < shape->compound->count );
+		const b2Polygon* polygon = shape->compound->polygons + childIndex;
+		return b2MakeProxy( polygon->vertices, polygon->count, polygon->radius );
+	}
+
+	B2_ASSERT( childIndex == 0 );
+	return b2MakeShapeDistanceProxy( shape );
+}
+
+b2DistanceOutput b2ComputeShapeProxyDistance( const b2Shape* shape, b2Transform transform, const b2ShapeProxy* proxy,
+											  b2Transform proxyTransform )
+{
+	b2DistanceInput input;
+	input.proxyB = *proxy;
+	input.transformA = transform;
+	input.transformB = proxyTransform;
+	input.useRadii = true;
+
+	b2DistanceOutput result = { 0 };
+	result.distance = FLT_MAX;
+
+	int childCount = b2GetShapeChildCount( shape );
+	for ( int i = 0; i < childCount; ++i )
+	{
+		input.proxyA = b2MakeShapeChildProxy( shape, i );
+
+		b2SimplexCache cache = { 0 };
+		b2DistanceOutput output = b2ShapeDistance( &input, &cache, NULL, 0 );
+		if ( output.distance < result.distance )
+		{
+			result = output;
+		}
+	}
+
+	return result;
+}
+
+b2DistanceOutput b2ComputeShapeDistance( const b2Shape* shapeA, b2Transform transformA, const b2Shape* shapeB,
+										 b2Transform transformB )
+{
+	b2DistanceOutput result = { 0 };
+	result.distance = FLT_MAX;
+
+	int childCount = b2GetShapeChildCount( shapeB );
+	for ( int i = 0; i < childCount; ++i )
+	{
+		b2ShapeProxy proxyB = b2MakeShapeChildProxy( shapeB, i );
+		b2DistanceOutput output = b2ComputeShapeProxyDistance( shapeA, transformA, &proxyB, transformB );
+		if ( output.distance < result.distance )
+		{
+			result = output;
+		}
+	}
+
+	return result;
+}
+
 b2BodyId b2Shape_GetBody( b2ShapeId shapeId )
 {
 	b2World* world = b2GetWorld( shapeId.world0 );
@@ -1037,6 +1489,7 @@ void b2Shape_SetUserData( b2ShapeId shapeId, void* userData )
 {
 	b2World* world = b2GetWorld( shapeId.world0 );
 	b2Shape* shape = b2GetShape( world, shapeId );
+	b2MarkDirty( world, b2_dirtyShape, shape->id );
 	shape->userData = userData;
 }
 
@@ -1073,6 +1526,9 @@ bool b2Shape_TestPoint( b2ShapeId shapeId, b2Vec2 point )
 		case b2_polygonShape:
 			return b2PointInPolygon( &shape->polygon, localPoint );
 
+		case b2_compoundShape:
+			return b2PointInCompound( shape->compound, localPoint );
+
 		default:
 			return false;
 	}
@@ -1115,6 +1571,10 @@ b2CastOutput b2Shape_RayCast( b2ShapeId shapeId, const b2RayCastInput* input )
 			output = b2RayCastSegment( &shape->chainSegment.segment, &localInput, true );
 			break;
 
+		case b2_compoundShape:
+			output = b2RayCastCompound( shape->compound, &localInput );
+			break;
+
 		default:
 			B2_ASSERT( false );
 			return output;
@@ -1141,6 +1601,7 @@ void b2Shape_SetDensity( b2ShapeId shapeId, float density, bool updateBodyMass )
 	}
 
 	b2Shape* shape = b2GetShape( world, shapeId );
+	b2MarkDirty( world, b2_dirtyShape, shape->id );
 	if ( density == shape->density )
 	{
 		// early return to avoid expensive function
@@ -1175,6 +1636,7 @@ void b2Shape_SetFriction( b2ShapeId shapeId, float friction )
 	}
 
 	b2Shape* shape = b2GetShape( world, shapeId );
+	b2MarkDirty( world, b2_dirtyShape, shape->id );
 	shape->material.friction = friction;
 }
 
@@ -1197,6 +1659,7 @@ void b2Shape_SetRestitution( b2ShapeId shapeId, float restitution )
 	}
 
 	b2Shape* shape = b2GetShape( world, shapeId );
+	b2MarkDirty( world, b2_dirtyShape, shape->id );
 	shape->material.restitution = restitution;
 }
 
@@ -1217,6 +1680,7 @@ void b2Shape_SetUserMaterial( b2ShapeId shapeId, uint64_t material )
 	}
 
 	b2Shape* shape = b2GetShape( world, shapeId );
+	b2MarkDirty( world, b2_dirtyShape, shape->id );
 	shape->material.userMaterialId = material;
 }
 
@@ -1238,6 +1702,7 @@ void b2Shape_SetSurfaceMaterial( b2ShapeId shapeId, const b2SurfaceMaterial* sur
 {
 	b2World* world = b2GetWorld( shapeId.world0 );
 	b2Shape* shape = b2GetShape( world, shapeId );
+	b2MarkDirty( world, b2_dirtyShape, shape->id );
 	shape->material = *surfaceMaterial;
 }
 
@@ -1307,6 +1772,7 @@ void b2Shape_SetFilter( b2ShapeId shapeId, b2Filter filter )
 	}
 
 	b2Shape* shape = b2GetShape( world, shapeId );
+	b2MarkDirty( world, b2_dirtyShape, shape->id );
 	if ( filter.maskBits == shape->filter.maskBits && filter.categoryBits == shape->filter.categoryBits &&
 		 filter.groupIndex == shape->filter.groupIndex )
 	{
@@ -1335,7 +1801,12 @@ void b2Shape_EnableSensorEvents( b2ShapeId shapeId, bool flag )
 	}
 
 	b2Shape* shape = b2GetShape( world, shapeId );
-	shape->enableSensorEvents = flag;
+	b2MarkDirty( world, b2_dirtyShape, shape->id );
+	if ( shape->enableSensorEvents != flag )
+	{
+		shape->enableSensorEvents = flag;
+		world->sensorFullUpdate = true;
+	}
 }
 
 bool b2Shape_AreSensorEventsEnabled( b2ShapeId shapeId )
@@ -1354,6 +1825,7 @@ void b2Shape_EnableContactEvents( b2ShapeId shapeId, bool flag )
 	}
 
 	b2Shape* shape = b2GetShape( world, shapeId );
+	b2MarkDirty( world, b2_dirtyShape, shape->id );
 	shape->enableContactEvents = flag;
 }
 
@@ -1373,6 +1845,7 @@ void b2Shape_EnablePreSolveEvents( b2ShapeId shapeId, bool flag )
 	}
 
 	b2Shape* shape = b2GetShape( world, shapeId );
+	b2MarkDirty( world, b2_dirtyShape, shape->id );
 	shape->enablePreSolveEvents = flag;
 }
 
@@ -1392,6 +1865,7 @@ void b2Shape_EnableHitEvents( b2ShapeId shapeId, bool flag )
 	}
 
 	b2Shape* shape = b2GetShape( world, shapeId );
+	b2MarkDirty( world, b2_dirtyShape, shape->id );
 	shape->enableHitEvents = flag;
 }
 
@@ -1449,6 +1923,14 @@ b2Polygon b2Shape_GetPolygon( b2ShapeId shapeId )
 	return shape->polygon;
 }
 
+const b2Compound* b2Shape_GetCompound( b2ShapeId shapeId )
+{
+	b2World* world = b2GetWorld( shapeId.world0 );
+	b2Shape* shape = b2GetShape( world, shapeId );
+	B2_ASSERT( shape->type == b2_compoundShape );
+	return shape->compound;
+}
+
 void b2Shape_SetCircle( b2ShapeId shapeId, const b2Circle* circle )
 {
 	b2World* world = b2GetWorldLocked( shapeId.world0 );
@@ -1458,6 +1940,7 @@ void b2Shape_SetCircle( b2ShapeId shapeId, const b2Circle* circle )
 	}
 
 	b2Shape* shape = b2GetShape( world, shapeId );
+	b2MarkDirty( world, b2_dirtyShape, shape->id );
 	shape->circle = *circle;
 	shape->type = b2_circleShape;
 	shape->aabbMargin = b2ComputeShapeMargin( shape );
@@ -1483,6 +1966,7 @@ void b2Shape_SetCapsule( b2ShapeId shapeId, const b2Capsule* capsule )
 	}
 
 	b2Shape* shape = b2GetShape( world, shapeId );
+	b2MarkDirty( world, b2_dirtyShape, shape->id );
 	shape->capsule = *capsule;
 	shape->type = b2_capsuleShape;
 	shape->aabbMargin = b2ComputeShapeMargin( shape );
@@ -1502,6 +1986,7 @@ void b2Shape_SetSegment( b2ShapeId shapeId, const b2Segment* segment )
 	}
 
 	b2Shape* shape = b2GetShape( world, shapeId );
+	b2MarkDirty( world, b2_dirtyShape, shape->id );
 	shape->segment = *segment;
 	shape->type = b2_segmentShape;
 	shape->aabbMargin = b2ComputeShapeMargin( shape );
@@ -1521,6 +2006,7 @@ void b2Shape_SetPolygon( b2ShapeId shapeId, const b2Polygon* polygon )
 	}
 
 	b2Shape* shape = b2GetShape( world, shapeId );
+	b2MarkDirty( world, b2_dirtyShape, shape->id );
 	shape->polygon = *polygon;
 	shape->type = b2_polygonShape;
 	shape->aabbMargin = b2ComputeShapeMargin( shape );
@@ -1567,6 +2053,7 @@ void b2Chain_SetSurfaceMaterial( b2ChainId chainId, const b2SurfaceMaterial* mat
 	b2ChainShape* chainShape = b2GetChainShape( world, chainId );
 	B2_ASSERT( 0 <= materialIndex && materialIndex < chainShape->materialCount );
 	chainShape->materials[materialIndex] = *material;
+	b2MarkDirty( world, b2_dirtyChain, chainShape->id );
 
 	B2_ASSERT( chainShape->materialCount == 1 || chainShape->materialCount == chainShape->count );
 	int count = chainShape->count;
@@ -1578,6 +2065,7 @@ void b2Chain_SetSurfaceMaterial( b2ChainId chainId, const b2SurfaceMaterial* mat
 			int shapeId = chainShape->shapeIndices[i];
 			b2Shape* shape = b2Array_Get( world->shapes,shapeId );
 			shape->material = *material;
+			b2MarkDirty( world, b2_dirtyShape, shapeId );
 		}
 	}
 	else
@@ -1585,6 +2073,7 @@ void b2Chain_SetSurfaceMaterial( b2ChainId chainId, const b2SurfaceMaterial* mat
 		int shapeId = chainShape->shapeIndices[materialIndex];
 		b2Shape* shape = b2Array_Get( world->shapes,shapeId );
 		shape->material = *material;
+		b2MarkDirty( world, b2_dirtyShape, shapeId );
 	}
 }
 
@@ -1651,8 +2140,7 @@ int b2Shape_GetContactData( b2ShapeId shapeId, b2ContactData* contactData, int c
 			contactData[index].shapeIdA = (b2ShapeId){ shapeA->id + 1, shapeId.world0, shapeA->generation };
 			contactData[index].shapeIdB = (b2ShapeId){ shapeB->id + 1, shapeId.world0, shapeB->generation };
 
-			b2ContactSim* contactSim = b2GetContactSim( world, contact );
-			contactData[index].manifold = contactSim->manifold;
+			contactData[index].manifold = b2GetContactManifold( world, contact );
 			index += 1;
 		}
 
@@ -1682,6 +2170,43 @@ int b2Shape_GetSensorCapacity( b2ShapeId shapeId )
 	return sensor->overlaps2.count;
 }
 
+void b2Shape_SetSensorUpdateInterval( b2ShapeId shapeId, int interval )
+{
+	b2World* world = b2GetWorldLocked( shapeId.world0 );
+	if ( world == NULL )
+	{
+		return;
+	}
+
+	b2Shape* shape = b2GetShape( world, shapeId );
+	b2MarkDirty( world, b2_dirtyShape, shape->id );
+	if ( shape->sensorIndex == B2_NULL_INDEX )
+	{
+		return;
+	}
+
+	b2Sensor* sensor = b2Array_Get( world->sensors, shape->sensorIndex );
+	sensor->updateInterval = b2MaxInt( 1, interval );
+}
+
+int b2Shape_GetSensorUpdateInterval( b2ShapeId shapeId )
+{
+	b2World* world = b2GetWorld( shapeId.world0 );
+	if ( world == NULL )
+	{
+		return 0;
+	}
+
+	b2Shape* shape = b2GetShape( world, shapeId );
+	if ( shape->sensorIndex == B2_NULL_INDEX )
+	{
+		return 0;
+	}
+
+	b2Sensor* sensor = b2Array_Get( world->sensors, shape->sensorIndex );
+	return sensor->updateInterval;
+}
+
 int b2Shape_GetSensorData( b2ShapeId shapeId, b2ShapeId* visitorIds, int capacity )
 {
 	b2World* world = b2GetWorldLocked( shapeId.world0 );
@@ -1750,64 +2275,16 @@ b2Vec2 b2Shape_GetClosestPoint( b2ShapeId shapeId, b2Vec2 target )
 	b2Body* body = b2Array_Get( world->bodies,shape->bodyId );
 	b2Transform transform = b2GetBodyTransformQuick( world, body );
 
-	b2DistanceInput input;
-	input.proxyA = b2MakeShapeDistanceProxy( shape );
-	input.proxyB = b2MakeProxy( &target, 1, 0.0f );
-	input.transformA = transform;
-	input.transformB = b2Transform_identity;
-	input.useRadii = true;
-
-	b2SimplexCache cache = { 0 };
-	b2DistanceOutput output = b2ShapeDistance( &input, &cache, NULL, 0 );
+	b2ShapeProxy proxy = b2MakeProxy( &target, 1, 0.0f );
+	b2DistanceOutput output = b2ComputeShapeProxyDistance( shape, transform, &proxy, b2Transform_identity );
 
 	return output.pointA;
 }
 
-// https://en.wikipedia.org/wiki/Density_of_air
-// https://www.engineeringtoolbox.com/wind-load-d_1775.html
-// force = 0.5 * air_density * velocity^2 * area
-// https://en.wikipedia.org/wiki/Lift_(force)
-void b2Shape_ApplyWind( b2ShapeId shapeId, b2Vec2 wind, float drag, float lift, bool wake )
+// Wind force and torque about the center of mass for a shape moving with the given body velocity
+void b2ComputeShapeWind( const b2Shape* shape, b2Transform transform, b2Vec2 localCenter, b2Vec2 linearVelocity,
+						 float angularVelocity, b2Vec2 wind, float drag, float lift, b2Vec2* forceOut, float* torqueOut )
 {
-	b2World* world = b2GetWorld( shapeId.world0 );
-	if ( world == NULL )
-	{
-		return;
-	}
-
-	b2Shape* shape = b2GetShape( world, shapeId );
-
-	b2ShapeType shapeType = shape->type;
-	if ( shapeType != b2_circleShape && shapeType != b2_capsuleShape && shapeType != b2_polygonShape )
-	{
-		return;
-	}
-
-	b2Body* body = b2Array_Get( world->bodies,shape->bodyId );
-
-	if ( body->type != b2_dynamicBody )
-	{
-		return;
-	}
-
-	if ( body->setIndex >= b2_firstSleepingSet && wake == false )
-	{
-		return;
-	}
-
-	b2BodySim* sim = b2GetBodySim( world, body );
-
-	if ( body->setIndex != b2_awakeSet )
-	{
-		// Must wake for state to exist
-		b2WakeBody( world, body );
-	}
-
-	B2_ASSERT( body->setIndex == b2_awakeSet );
-
-	b2BodyState* state = b2GetBodyState( world, body );
-	b2Transform transform = sim->transform;
-
 	float lengthUnits = b2GetLengthUnitsPerMeter();
 	float volumeUnits = lengthUnits * lengthUnits * lengthUnits;
 
@@ -1823,8 +2300,8 @@ void b2Shape_ApplyWind( b2ShapeId shapeId, b2Vec2 wind, float drag, float lift,
 		{
 			float radius = shape->circle.radius;
 			b2Vec2 centroid = shape->localCentroid;
-			b2Vec2 lever = b2RotateVector( transform.q, b2Sub( centroid, sim->localCenter ) );
-			b2Vec2 shapeVelocity = b2Add( state->linearVelocity, b2CrossSV( state->angularVelocity, lever ) );
+			b2Vec2 lever = b2RotateVector( transform.q, b2Sub( centroid, localCenter ) );
+			b2Vec2 shapeVelocity = b2Add( linearVelocity, b2CrossSV( angularVelocity, lever ) );
 			b2Vec2 relativeVelocity = b2MulSub( wind, drag, shapeVelocity );
 			float speed;
 			b2Vec2 direction = b2GetLengthAndNormalize( &speed, relativeVelocity );
@@ -1837,8 +2314,8 @@ void b2Shape_ApplyWind( b2ShapeId shapeId, b2Vec2 wind, float drag, float lift,
 		case b2_capsuleShape:
 		{
 			b2Vec2 centroid = shape->localCentroid;
-			b2Vec2 lever = b2RotateVector( transform.q, b2Sub( centroid, sim->localCenter ) );
-			b2Vec2 shapeVelocity = b2Add( state->linearVelocity, b2CrossSV( state->angularVelocity, lever ) );
+			b2Vec2 lever = b2RotateVector( transform.q, b2Sub( centroid, localCenter ) );
+			b2Vec2 shapeVelocity = b2Add( linearVelocity, b2CrossSV( angularVelocity, lever ) );
 			b2Vec2 relativeVelocity = b2MulSub( wind, drag, shapeVelocity );
 			float speed;
 			b2Vec2 direction = b2GetLengthAndNormalize( &speed, relativeVelocity );
@@ -1865,17 +2342,24 @@ void b2Shape_ApplyWind( b2ShapeId shapeId, b2Vec2 wind, float drag, float lift,
 		break;
 
 		case b2_polygonShape:
+		case b2_compoundShape:
 		{
+			const b2Polygon* polygon = b2GetShapePolygon( shape );
+			if ( polygon == NULL )
+			{
+				break;
+			}
+
 			b2Vec2 centroid = shape->localCentroid;
-			b2Vec2 lever = b2RotateVector( transform.q, b2Sub( centroid, sim->localCenter ) );
-			b2Vec2 shapeVelocity = b2Add( state->linearVelocity, b2CrossSV( state->angularVelocity, lever ) );
+			b2Vec2 lever = b2RotateVector( transform.q, b2Sub( centroid, localCenter ) );
+			b2Vec2 shapeVelocity = b2Add( linearVelocity, b2CrossSV( angularVelocity, lever ) );
 			b2Vec2 relativeVelocity = b2MulSub( wind, drag, shapeVelocity );
 			float speed;
 			b2Vec2 direction = b2GetLengthAndNormalize( &speed, relativeVelocity );
 
 			// polygon radius is ignored for simplicity
-			int count = shape->polygon.count;
-			b2Vec2* vertices = shape->polygon.vertices;
+			int count = polygon->count;
+			const b2Vec2* vertices = polygon->vertices;
 
 			b2Vec2 v1 = vertices[count - 1];
 			for ( int i = 0; i < count; ++i )
@@ -1902,7 +2386,7 @@ void b2Shape_ApplyWind( b2ShapeId shapeId, b2Vec2 wind, float drag, float lift,
 				float forceMagnitude = 0.5f * airDensity * projectedArea * speed * speed;
 				b2Vec2 f = b2MulSV( forceMagnitude, b2MulAdd( direction, lift, liftDirection ) );
 
-				b2Vec2 edgeLever = b2RotateVector( transform.q, b2Sub( edgeCenter, sim->localCenter ) );
+				b2Vec2 edgeLever = b2RotateVector( transform.q, b2Sub( edgeCenter, localCenter ) );
 
 				force = b2Add( force, f );
 				torque += b2Cross( edgeLever, f );
@@ -1914,6 +2398,60 @@ void b2Shape_ApplyWind( b2ShapeId shapeId, b2Vec2 wind, float drag, float lift,
 			break;
 	}
 
+	*forceOut = force;
+	*torqueOut = torque;
+}
+
+// https://en.wikipedia.org/wiki/Density_of_air
+// https://www.engineeringtoolbox.com/wind-load-d_1775.html
+// force = 0.5 * air_density * velocity^2 * area
+// https://en.wikipedia.org/wiki/Lift_(force)
+void b2Shape_ApplyWind( b2ShapeId shapeId, b2Vec2 wind, float drag, float lift, bool wake )
+{
+	b2World* world = b2GetWorld( shapeId.world0 );
+	if ( world == NULL )
+	{
+		return;
+	}
+
+	b2Shape* shape = b2GetShape( world, shapeId );
+	b2MarkDirty( world, b2_dirtyShape, shape->id );
+
+	b2ShapeType shapeType = shape->type;
+	if ( shapeType != b2_circleShape && shapeType != b2_capsuleShape && b2GetShapePolygon( shape ) == NULL )
+	{
+		return;
+	}
+
+	b2Body* body = b2Array_Get( world->bodies,shape->bodyId );
+
+	if ( body->type != b2_dynamicBody )
+	{
+		return;
+	}
+
+	if ( body->setIndex >= b2_firstSleepingSet && wake == false )
+	{
+		return;
+	}
+
+	if ( body->setIndex != b2_awakeSet )
+	{
+		// Must wake for state to exist
+		b2WakeBody( world, body );
+	}
+
+	B2_ASSERT( body->setIndex == b2_awakeSet );
+
+	// Waking moves the body sim
+	b2BodySim* sim = b2GetBodySim( world, body );
+	b2BodyState* state = b2GetBodyState( world, body );
+
+	b2Vec2 force;
+	float torque;
+	b2ComputeShapeWind( shape, sim->transform, sim->localCenter, state->linearVelocity, state->angularVelocity, wind, drag,
+						lift, &force, &torque );
+
 	sim->force = b2Add( sim->force, force );
 	sim->torque += torque;
 }
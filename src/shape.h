@@ -7,27 +7,28 @@
 
 #include "box2d/types.h"
 
+#include <float.h>
+
+typedef struct b2Body b2Body;
 typedef struct b2BroadPhase b2BroadPhase;
 typedef struct b2World b2World;
 
 typedef struct b2Shape
 {
-	int id;
+	// The narrow phase and sensor queries read these for every pair, so they are kept together at the
+	// front. A recycled contact only reads the fat AABB and the body id.
+	b2AABB fatAABB;
 	int bodyId;
-	int prevShapeId;
-	int nextShapeId;
-	int sensorIndex;
 	b2ShapeType type;
-	b2SurfaceMaterial material;
-	float density;
-	float aabbMargin;
-	b2AABB aabb;
-	b2AABB fatAABB;
-	b2Vec2 localCentroid;
-	int proxyKey;
-
+	uint16_t generation;
+	bool enableSensorEvents;
+	bool enableContactEvents;
+	bool enableCustomFiltering;
+	bool enableHitEvents;
+	bool enablePreSolveEvents;
+	bool enlargedAABB;
 	b2Filter filter;
-	void* userData;
+	b2SurfaceMaterial material;
 
 	union
 	{
@@ -36,15 +37,34 @@ typedef struct b2Shape
 		b2Polygon polygon;
 		b2Segment segment;
 		b2ChainSegment chainSegment;
+		const b2Compound* compound;
 	};
 
-	uint16_t generation;
-	bool enableSensorEvents;
-	bool enableContactEvents;
-	bool enableCustomFiltering;
-	bool enableHitEvents;
-	bool enablePreSolveEvents;
-	bool enlargedAABB;
+	// Only used when shapes are created, moved, destroyed or queried by the user
+	int id;
+	int prevShapeId;
+	int nextShapeId;
+	int sensorIndex;
+	int proxyKey;
+	float density;
+	float aabbMargin;
+
+	// From b2ShapeDef, zero for the size based margin
+	float customMargin;
+
+	// Clamped b2ShapeDef::speculativeDistance
+	float speculativeDistance;
+	b2AABB aabb;
+
+	// Covers the bounds this shape had when sensors last saw it. Used by incremental sensor updates
+	// to find the sensors a moving shape may have entered or left.
+	b2AABB sensorAABB;
+
+	// The fat AABB of the proxy at its last pair query. An incremental pair query only covers the part
+	// of the fat AABB outside of this. See b2WorldDef::enableIncrementalPairs.
+	b2AABB pairAABB;
+	b2Vec2 localCentroid;
+	void* userData;
 } b2Shape;
 
 typedef struct b2ChainShape
@@ -77,20 +97,56 @@ typedef struct
 	b2Array( int ) overlaps;
 } b2SensorOverlaps;
 
+b2Shape* b2CreateShapeWithoutProxy( b2World* world, b2Body* body, const b2ShapeDef* def, const void* geometry,
+									b2ShapeType shapeType );
 void b2CreateShapeProxy( b2Shape* shape, b2BroadPhase* bp, b2BodyType type, b2Transform transform, bool forcePairCreation );
+
+// Create the proxies of shapes made with b2CreateShapeWithoutProxy on enabled bodies
+void b2CreateShapeProxies( b2World* world, const int* shapeIds, const bool* forcePairCreation, int count );
 void b2DestroyShapeProxy( b2Shape* shape, b2BroadPhase* bp );
 
+// Destroy the proxies of many shapes with one bulk removal per tree
+void b2DestroyShapeProxies( b2World* world, const int* shapeIds, int count );
+
+// Create the proxies of shapes on one enabled body by grafting a tree built from their fat AABBs.
+// The source proxy user data is the index into shapeIds.
+void b2GraftShapeProxies( b2World* world, const int* shapeIds, const bool* forcePairCreation, int count,
+						  const b2DynamicTree* source );
+
 void b2FreeChainData( b2ChainShape* chain );
 
 b2MassData b2ComputeShapeMass( const b2Shape* shape );
 b2ShapeExtent b2ComputeShapeExtent( const b2Shape* shape, b2Vec2 localCenter );
 b2AABB b2ComputeShapeAABB( const b2Shape* shape, b2Transform transform );
+float b2GetShapeDefSpeculativeDistance( const b2ShapeDef* def );
 b2Vec2 b2GetShapeCentroid( const b2Shape* shape );
 float b2GetShapePerimeter( const b2Shape* shape );
 float b2GetShapeProjectedPerimeter( const b2Shape* shape, b2Vec2 line );
 
 b2ShapeProxy b2MakeShapeDistanceProxy( const b2Shape* shape );
 
+// Compound shapes have one convex child per polygon. Other shapes are a single child.
+int b2GetShapeChildCount( const b2Shape* shape );
+b2ShapeProxy b2MakeShapeChildProxy( const b2Shape* shape, int childIndex );
+
+// The polygon of a polygon shape or of a compound shape with a single polygon, otherwise NULL. Lets
+// features written for polygons treat instanced single polygon compounds the same way.
+const b2Polygon* b2GetShapePolygon( const b2Shape* shape );
+
+// Distance queries that also work for compound shapes by using the closest child
+b2DistanceOutput b2ComputeShapeProxyDistance( const b2Shape* shape, b2Transform transform, const b2ShapeProxy* proxy,
+											  b2Transform proxyTransform );
+b2DistanceOutput b2ComputeShapeDistance( const b2Shape* shapeA, b2Transform transformA, const b2Shape* shapeB,
+										 b2Transform transformB );
+
+void b2ComputeShapeWind( const b2Shape* shape, b2Transform transform, b2Vec2 localCenter, b2Vec2 linearVelocity,
+						 float angularVelocity, b2Vec2 wind, float drag, float lift, b2Vec2* force, float* torque );
+
+b2ShapePair b2MakeShapePair( const b2World* world, const b2Shape* shapeA, const b2Shape* shapeB );
+
+// Runs the user custom filter on one pair. Used where pairs are not batched.
+bool b2CustomFilterShapes( b2World* world, const b2Shape* shapeA, const b2Shape* shapeB );
+
 b2CastOutput b2RayCastShape( const b2RayCastInput* input, const b2Shape* shape, b2Transform transform );
 b2CastOutput b2ShapeCastShape( const b2ShapeCastInput* input, const b2Shape* shape, b2Transform transform );
 
@@ -98,7 +154,7 @@ b2PlaneResult b2CollideMoverAndCircle( const b2Capsule* mover, const b2Circle* s
 b2PlaneResult b2CollideMoverAndCapsule( const b2Capsule* mover, const b2Capsule* shape );
 b2PlaneResult b2CollideMoverAndPolygon( const b2Capsule* mover, const b2Polygon* shape );
 b2PlaneResult b2CollideMoverAndSegment( const b2Capsule* mover, const b2Segment* shape );
-b2PlaneResult b2CollideMover( const b2Capsule* mover, const b2Shape* shape, b2Transform transform );
+b2PlaneResult b2CollideMover( const b2Capsule* mover, const b2Shape* shape, int childIndex, b2Transform transform );
 
 static inline float b2GetShapeRadius( const b2Shape* shape )
 {
@@ -125,6 +181,21 @@ static inline bool b2ShouldShapesCollide( b2Filter filterA, b2Filter filterB )
 	return ( filterA.maskBits & filterB.categoryBits ) != 0 && ( filterA.categoryBits & filterB.maskBits ) != 0;
 }
 
+// Mask bits for a tree query that looks for the shapes that may collide with this filter. The tree
+// skips subtrees whose combined category bits miss the mask. A positive group index collides with its
+// group regardless of the mask bits, so it has to visit every category.
+static inline uint64_t b2GetFilterQueryMask( b2Filter filter )
+{
+	return filter.groupIndex > 0 ? B2_DEFAULT_MASK_BITS : filter.maskBits;
+}
+
+// Make the next pair query of this shape cover its whole fat AABB. Needed when pairs inside the current
+// fat AABB may be missing, such as after contacts were removed while the proxies still overlap.
+static inline void b2ResetPairAABB( b2Shape* shape )
+{
+	shape->pairAABB = (b2AABB){ { FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX } };
+}
+
 static inline bool b2ShouldQueryCollide( b2Filter shapeFilter, b2QueryFilter queryFilter )
 {
 	return ( shapeFilter.categoryBits & queryFilter.maskBits ) != 0 && ( shapeFilter.maskBits & queryFilter.categoryBits ) != 0;
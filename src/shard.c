@@ -0,0 +1,780 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#include "container.h"
+#include "core.h"
+#include "snapshot.h"
+
+#include "box2d/box2d.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Shards
+// Each shard owns the bodies whose origin lies in its cell. Owned bodies near a neighboring cell are
+// mirrored in the neighbor as kinematic ghost bodies, so bodies on both sides of a border collide.
+// The coupling is one-way: a ghost pushes the bodies of the neighbor but is only moved by its owner.
+// Once the origin of a body is past the border by more than the handoff margin, the body is destroyed
+// in its shard and created again in the neighbor.
+//
+// Shards only talk through border state messages. A message from one shard to a neighbor holds the
+// bodies handed off to the neighbor and the full list of ghosts the neighbor should have. Ghosts that are
+// missing from the list are destroyed, so a message that was lost is repaired by the next one. The
+// message is written with the snapshot writer and, like a snapshot, is only valid for the build that
+// wrote it. The in-process step uses the same messages, so shards on other processes behave the same.
+
+#define B2_SHARD_MAGIC 0x48533242
+#define B2_SHARD_VERSION 1
+
+// Keys are unique across shards and processes. The high bits hold the shard that created the key.
+#define B2_SHARD_KEY( shardIndex, count ) ( ( (uint64_t)( shardIndex ) + 1 ) << 32 | (uint64_t)( count ) )
+
+typedef struct b2ShardBody
+{
+	uint64_t key;
+	b2BodyId bodyId;
+
+	// Ghosts only. The shard that owns the body and the read that last listed the ghost.
+	int ownerIndex;
+	uint32_t stamp;
+} b2ShardBody;
+
+b2DeclareArray( b2ShardBody );
+b2DeclareArray( b2ShapeId );
+
+typedef struct b2Shard
+{
+	// Both sorted by key
+	b2Array( b2ShardBody ) owned;
+	b2Array( b2ShardBody ) ghosts;
+
+	uint32_t keyCount;
+} b2Shard;
+
+struct b2ShardGrid
+{
+	b2Shard* shards;
+	b2WorldId* worldIds;
+	int shardCount;
+
+	b2Vec2 origin;
+	b2Vec2 shardSize;
+	int columnCount;
+	int rowCount;
+	float ghostMargin;
+	float handoffMargin;
+
+	uint32_t stamp;
+
+	// Scratch space
+	b2Array( b2ShapeId ) shapeIds;
+	uint8_t* buffer;
+	int bufferCapacity;
+};
+
+typedef struct b2BorderStateHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	int size;
+	int sourceIndex;
+	int targetIndex;
+	int recordCount;
+} b2BorderStateHeader;
+
+// A record is followed by shapeCount shape records
+typedef struct b2BorderBodyRecord
+{
+	uint64_t key;
+
+	// Only meaningful within one process
+	uint64_t userData;
+
+	b2Transform transform;
+	b2Vec2 linearVelocity;
+	float angularVelocity;
+	float linearDamping;
+	float angularDamping;
+	float gravityScale;
+	float sleepThreshold;
+	b2BodyType type;
+	int shapeCount;
+	b2MotionLocks motionLocks;
+	bool isHandoff;
+	bool isAwake;
+	bool enableSleep;
+	bool isBullet;
+} b2BorderBodyRecord;
+
+typedef struct b2BorderShapeRecord
+{
+	b2ShapeType type;
+	union
+	{
+		b2Capsule capsule;
+		b2Circle circle;
+		b2Polygon polygon;
+		b2Segment segment;
+	};
+
+	uint64_t userData;
+	b2SurfaceMaterial material;
+	b2Filter filter;
+	float density;
+	bool isSensor;
+	bool enableSensorEvents;
+	bool enableContactEvents;
+	bool enableHitEvents;
+	bool enablePreSolveEvents;
+} b2BorderShapeRecord;
+
+b2ShardGrid* b2CreateShardGrid( const b2ShardGridDef* def )
+{
+	B2_CHECK_DEF( def );
+	B2_ASSERT( def->columnCount > 0 && def->rowCount > 0 );
+	B2_ASSERT( def->shardSize.x > 0.0f && def->shardSize.y > 0.0f );
+	B2_ASSERT( def->ghostMargin >= 0.0f && def->handoffMargin >= 0.0f );
+
+	b2ShardGrid* grid = b2Alloc( sizeof( b2ShardGrid ) );
+	*grid = (b2ShardGrid){ 0 };
+	grid->shardCount = def->columnCount * def->rowCount;
+	grid->shards = b2Alloc( grid->shardCount * sizeof( b2Shard ) );
+	grid->worldIds = b2Alloc( grid->shardCount * sizeof( b2WorldId ) );
+	grid->origin = def->origin;
+	grid->shardSize = def->shardSize;
+	grid->columnCount = def->columnCount;
+	grid->rowCount = def->rowCount;
+	grid->ghostMargin = def->ghostMargin;
+	grid->handoffMargin = def->handoffMargin;
+
+	for ( int i = 0; i < grid->shardCount; ++i )
+	{
+		grid->shards[i] = (b2Shard){ 0 };
+		grid->worldIds[i] = b2CreateWorld( &def->worldDef );
+	}
+
+	return grid;
+}
+
+void b2DestroyShardGrid( b2ShardGrid* grid )
+{
+	for ( int i = 0; i < grid->shardCount; ++i )
+	{
+		b2Array_Destroy( grid->shards[i].owned );
+		b2Array_Destroy( grid->shards[i].ghosts );
+		b2DestroyWorld( grid->worldIds[i] );
+	}
+
+	b2Array_Destroy( grid->shapeIds );
+	b2Free( grid->buffer, grid->bufferCapacity );
+	b2Free( grid->worldIds, grid->shardCount * sizeof( b2WorldId ) );
+	b2Free( grid->shards, grid->shardCount * sizeof( b2Shard ) );
+	b2Free( grid, sizeof( b2ShardGrid ) );
+}
+
+int b2ShardGrid_GetShardCount( const b2ShardGrid* grid )
+{
+	return grid->shardCount;
+}
+
+b2WorldId b2ShardGrid_GetWorld( const b2ShardGrid* grid, int shardIndex )
+{
+	B2_ASSERT( 0 <= shardIndex && shardIndex < grid->shardCount );
+	return grid->worldIds[shardIndex];
+}
+
+int b2ShardGrid_FindShard( const b2ShardGrid* grid, b2Vec2 point )
+{
+	float x = b2ClampFloat( floorf( ( point.x - grid->origin.x ) / grid->shardSize.x ), -1.0f, (float)grid->columnCount );
+	float y = b2ClampFloat( floorf( ( point.y - grid->origin.y ) / grid->shardSize.y ), -1.0f, (float)grid->rowCount );
+	int column = b2ClampInt( (int)x, 0, grid->columnCount - 1 );
+	int row = b2ClampInt( (int)y, 0, grid->rowCount - 1 );
+	return row * grid->columnCount + column;
+}
+
+// Shards on the edge of the grid extend to infinity
+static b2AABB b2GetShardBounds( const b2ShardGrid* grid, int shardIndex, float margin )
+{
+	int column = shardIndex % grid->columnCount;
+	int row = shardIndex / grid->columnCount;
+
+	b2AABB bounds;
+	bounds.lowerBound.x = column == 0 ? -FLT_MAX : grid->origin.x + column * grid->shardSize.x - margin;
+	bounds.lowerBound.y = row == 0 ? -FLT_MAX : grid->origin.y + row * grid->shardSize.y - margin;
+	bounds.upperBound.x = column == grid->columnCount - 1 ? FLT_MAX : grid->origin.x + ( column + 1 ) * grid->shardSize.x + margin;
+	bounds.upperBound.y = row == grid->rowCount - 1 ? FLT_MAX : grid->origin.y + ( row + 1 ) * grid->shardSize.y + margin;
+	return bounds;
+}
+
+static bool b2ContainsPoint( b2AABB a, b2Vec2 p )
+{
+	return a.lowerBound.x <= p.x && p.x <= a.upperBound.x && a.lowerBound.y <= p.y && p.y <= a.upperBound.y;
+}
+
+static int b2CompareShardBodies( const void* a, const void* b )
+{
+	uint64_t keyA = ( (const b2ShardBody*)a )->key;
+	uint64_t keyB = ( (const b2ShardBody*)b )->key;
+	return ( keyA > keyB ) - ( keyA < keyB );
+}
+
+// Binary search in the first count entries
+static int b2FindShardBody( const b2ShardBody* bodies, int count, uint64_t key )
+{
+	int low = 0;
+	int high = count - 1;
+	while ( low <= high )
+	{
+		int mid = ( low + high ) >> 1;
+		if ( bodies[mid].key < key )
+		{
+			low = mid + 1;
+		}
+		else if ( bodies[mid].key > key )
+		{
+			high = mid - 1;
+		}
+		else
+		{
+			return mid;
+		}
+	}
+
+	return B2_NULL_INDEX;
+}
+
+// Removes the entries without a valid body, keeping the order. Bodies may be destroyed by the user.
+static void b2PruneShardBodies( b2Array( b2ShardBody ) * bodies )
+{
+	int count = 0;
+	for ( int i = 0; i < bodies->count; ++i )
+	{
+		if ( b2Body_IsValid( bodies->data[i].bodyId ) )
+		{
+			bodies->data[count] = bodies->data[i];
+			count += 1;
+		}
+	}
+
+	bodies->count = count;
+}
+
+static void b2InsertShardBody( b2Array( b2ShardBody ) * bodies, b2ShardBody body )
+{
+	b2Array_Push( *bodies, body );
+
+	int index = bodies->count - 1;
+	while ( index > 0 && bodies->data[index - 1].key > body.key )
+	{
+		bodies->data[index] = bodies->data[index - 1];
+		index -= 1;
+	}
+
+	bodies->data[index] = body;
+}
+
+static int b2FindShardOfWorld( const b2ShardGrid* grid, b2WorldId worldId )
+{
+	for ( int i = 0; i < grid->shardCount; ++i )
+	{
+		if ( grid->worldIds[i].index1 == worldId.index1 && grid->worldIds[i].generation == worldId.generation )
+		{
+			return i;
+		}
+	}
+
+	return B2_NULL_INDEX;
+}
+
+uint64_t b2ShardGrid_AddBody( b2ShardGrid* grid, b2BodyId bodyId )
+{
+	B2_ASSERT( b2Body_IsValid( bodyId ) );
+
+	int shardIndex = b2FindShardOfWorld( grid, b2Body_GetWorld( bodyId ) );
+	B2_ASSERT( shardIndex != B2_NULL_INDEX );
+	if ( shardIndex == B2_NULL_INDEX )
+	{
+		return 0;
+	}
+
+	b2Shard* shard = grid->shards + shardIndex;
+	shard->keyCount += 1;
+
+	b2ShardBody body = { B2_SHARD_KEY( shardIndex, shard->keyCount ), bodyId, shardIndex, 0 };
+	b2InsertShardBody( &shard->owned, body );
+	return body.key;
+}
+
+b2BodyId b2ShardGrid_GetBody( const b2ShardGrid* grid, uint64_t key )
+{
+	for ( int i = 0; i < grid->shardCount; ++i )
+	{
+		const b2Shard* shard = grid->shards + i;
+		int index = b2FindShardBody( shard->owned.data, shard->owned.count, key );
+		if ( index != B2_NULL_INDEX && b2Body_IsValid( shard->owned.data[index].bodyId ) )
+		{
+			return shard->owned.data[index].bodyId;
+		}
+	}
+
+	return b2_nullBodyId;
+}
+
+static void b2RemoveShardBodyAt( b2Array( b2ShardBody ) * bodies, int index )
+{
+	memmove( bodies->data + index, bodies->data + index + 1, ( bodies->count - index - 1 ) * sizeof( b2ShardBody ) );
+	bodies->count -= 1;
+}
+
+void b2ShardGrid_RemoveBody( b2ShardGrid* grid, uint64_t key )
+{
+	for ( int i = 0; i < grid->shardCount; ++i )
+	{
+		b2Shard* shard = grid->shards + i;
+
+		int index = b2FindShardBody( shard->owned.data, shard->owned.count, key );
+		if ( index != B2_NULL_INDEX )
+		{
+			if ( b2Body_IsValid( shard->owned.data[index].bodyId ) )
+			{
+				b2DestroyBody( shard->owned.data[index].bodyId );
+			}
+
+			b2RemoveShardBodyAt( &shard->owned, index );
+		}
+
+		index = b2FindShardBody( shard->ghosts.data, shard->ghosts.count, key );
+		if ( index != B2_NULL_INDEX )
+		{
+			if ( b2Body_IsValid( shard->ghosts.data[index].bodyId ) )
+			{
+				b2DestroyBody( shard->ghosts.data[index].bodyId );
+			}
+
+			b2RemoveShardBodyAt( &shard->ghosts, index );
+		}
+	}
+}
+
+int b2ShardGrid_GetOwnedCount( const b2ShardGrid* grid, int shardIndex )
+{
+	B2_ASSERT( 0 <= shardIndex && shardIndex < grid->shardCount );
+	return grid->shards[shardIndex].owned.count;
+}
+
+int b2ShardGrid_GetGhostCount( const b2ShardGrid* grid, int shardIndex )
+{
+	B2_ASSERT( 0 <= shardIndex && shardIndex < grid->shardCount );
+	return grid->shards[shardIndex].ghosts.count;
+}
+
+// Returns the shard a body is handed off to or B2_NULL_INDEX if it stays
+static int b2GetHandoffShard( const b2ShardGrid* grid, int shardIndex, b2BodyId bodyId )
+{
+	b2Vec2 position = b2Body_GetPosition( bodyId );
+	b2AABB bounds = b2GetShardBounds( grid, shardIndex, grid->handoffMargin );
+	if ( b2ContainsPoint( bounds, position ) )
+	{
+		return B2_NULL_INDEX;
+	}
+
+	return b2ShardGrid_FindShard( grid, position );
+}
+
+static void b2WriteBodyRecord( b2ShardGrid* grid, b2SnapshotWriter* writer, uint64_t key, b2BodyId bodyId, bool isHandoff )
+{
+	int shapeCount = b2Body_GetShapeCount( bodyId );
+	b2Array_Resize( grid->shapeIds, shapeCount );
+	b2Body_GetShapes( bodyId, grid->shapeIds.data, shapeCount );
+
+	// Chain segments belong to their chain and compounds are shared, so these stay behind
+	int recordCount = 0;
+	for ( int i = 0; i < shapeCount; ++i )
+	{
+		b2ShapeType type = b2Shape_GetType( grid->shapeIds.data[i] );
+		if ( type != b2_chainSegmentShape && type != b2_compoundShape )
+		{
+			grid->shapeIds.data[recordCount] = grid->shapeIds.data[i];
+			recordCount += 1;
+		}
+	}
+
+	// Zeroed so the padding bytes of the message are deterministic
+	b2BorderBodyRecord record;
+	memset( &record, 0, sizeof( record ) );
+	record.key = key;
+	record.userData = (uint64_t)(uintptr_t)b2Body_GetUserData( bodyId );
+	record.transform = b2Body_GetTransform( bodyId );
+	record.linearVelocity = b2Body_GetLinearVelocity( bodyId );
+	record.angularVelocity = b2Body_GetAngularVelocity( bodyId );
+	record.linearDamping = b2Body_GetLinearDamping( bodyId );
+	record.angularDamping = b2Body_GetAngularDamping( bodyId );
+	record.gravityScale = b2Body_GetGravityScale( bodyId );
+	record.sleepThreshold = b2Body_GetSleepThreshold( bodyId );
+	record.type = b2Body_GetType( bodyId );
+	record.shapeCount = recordCount;
+	record.motionLocks = b2Body_GetMotionLocks( bodyId );
+	record.isHandoff = isHandoff;
+	record.isAwake = b2Body_IsAwake( bodyId );
+	record.enableSleep = b2Body_IsSleepEnabled( bodyId );
+	record.isBullet = b2Body_IsBullet( bodyId );
+	b2WriteValue( writer, record );
+
+	for ( int i = 0; i < recordCount; ++i )
+	{
+		b2ShapeId shapeId = grid->shapeIds.data[i];
+
+		b2BorderShapeRecord shapeRecord;
+		memset( &shapeRecord, 0, sizeof( shapeRecord ) );
+		shapeRecord.type = b2Shape_GetType( shapeId );
+		switch ( shapeRecord.type )
+		{
+			case b2_capsuleShape:
+				shapeRecord.capsule = b2Shape_GetCapsule( shapeId );
+				break;
+			case b2_circleShape:
+				shapeRecord.circle = b2Shape_GetCircle( shapeId );
+				break;
+			case b2_polygonShape:
+				shapeRecord.polygon = b2Shape_GetPolygon( shapeId );
+				break;
+			case b2_segmentShape:
+				shapeRecord.segment = b2Shape_GetSegment( shapeId );
+				break;
+			default:
+				B2_ASSERT( false );
+				break;
+		}
+
+		shapeRecord.userData = (uint64_t)(uintptr_t)b2Shape_GetUserData( shapeId );
+		shapeRecord.material = b2Shape_GetSurfaceMaterial( shapeId );
+		shapeRecord.filter = b2Shape_GetFilter( shapeId );
+		shapeRecord.density = b2Shape_GetDensity( shapeId );
+		shapeRecord.isSensor = b2Shape_IsSensor( shapeId );
+		shapeRecord.enableSensorEvents = b2Shape_AreSensorEventsEnabled( shapeId );
+		shapeRecord.enableContactEvents = b2Shape_AreContactEventsEnabled( shapeId );
+		shapeRecord.enableHitEvents = b2Shape_AreHitEventsEnabled( shapeId );
+		shapeRecord.enablePreSolveEvents = b2Shape_ArePreSolveEventsEnabled( shapeId );
+		b2WriteValue( writer, shapeRecord );
+	}
+}
+
+// Writes the records of the border state and returns the record count
+static int b2WriteBorderRecords( b2ShardGrid* grid, int shardIndex, int targetIndex, b2SnapshotWriter* writer )
+{
+	b2Shard* shard = grid->shards + shardIndex;
+	b2AABB ghostBounds = b2GetShardBounds( grid, targetIndex, grid->ghostMargin );
+
+	int recordCount = 0;
+	for ( int i = 0; i < shard->owned.count; ++i )
+	{
+		b2ShardBody* body = shard->owned.data + i;
+		int handoffIndex = b2GetHandoffShard( grid, shardIndex, body->bodyId );
+		if ( handoffIndex == targetIndex )
+		{
+			b2WriteBodyRecord( grid, writer, body->key, body->bodyId, true );
+			recordCount += 1;
+		}
+		else if ( handoffIndex == B2_NULL_INDEX && b2AABB_Overlaps( b2Body_ComputeAABB( body->bodyId ), ghostBounds ) )
+		{
+			b2WriteBodyRecord( grid, writer, body->key, body->bodyId, false );
+			recordCount += 1;
+		}
+	}
+
+	return recordCount;
+}
+
+int b2ShardGrid_GetBorderStateSize( b2ShardGrid* grid, int shardIndex, int targetIndex )
+{
+	B2_ASSERT( 0 <= shardIndex && shardIndex < grid->shardCount );
+	B2_ASSERT( 0 <= targetIndex && targetIndex < grid->shardCount && targetIndex != shardIndex );
+
+	b2PruneShardBodies( &grid->shards[shardIndex].owned );
+
+	b2SnapshotWriter writer = { NULL, 0, 0 };
+	b2WriteBorderRecords( grid, shardIndex, targetIndex, &writer );
+	return (int)sizeof( b2BorderStateHeader ) + writer.size;
+}
+
+int b2ShardGrid_WriteBorderState( b2ShardGrid* grid, int shardIndex, int targetIndex, void* buffer, int capacity )
+{
+	int size = b2ShardGrid_GetBorderStateSize( grid, shardIndex, targetIndex );
+	if ( buffer == NULL || size > capacity )
+	{
+		return 0;
+	}
+
+	b2SnapshotWriter writer = { buffer, capacity, (int)sizeof( b2BorderStateHeader ) };
+	int recordCount = b2WriteBorderRecords( grid, shardIndex, targetIndex, &writer );
+	B2_ASSERT( writer.size == size );
+
+	b2BorderStateHeader header = {
+		.magic = B2_SHARD_MAGIC,
+		.version = B2_SHARD_VERSION,
+		.size = size,
+		.sourceIndex = shardIndex,
+		.targetIndex = targetIndex,
+		.recordCount = recordCount,
+	};
+	memcpy( buffer, &header, sizeof( header ) );
+
+	// The bodies handed off now belong to the target
+	b2Shard* shard = grid->shards + shardIndex;
+	int count = 0;
+	for ( int i = 0; i < shard->owned.count; ++i )
+	{
+		b2ShardBody* body = shard->owned.data + i;
+		if ( b2GetHandoffShard( grid, shardIndex, body->bodyId ) == targetIndex )
+		{
+			b2DestroyBody( body->bodyId );
+			continue;
+		}
+
+		shard->owned.data[count] = *body;
+		count += 1;
+	}
+
+	shard->owned.count = count;
+
+	return size;
+}
+
+// The shape records follow the body record in the message and may not be aligned
+static b2BodyId b2CreateBorderBody( b2WorldId worldId, const b2BorderBodyRecord* record, const uint8_t* shapeData )
+{
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = record->isHandoff ? record->type : b2_kinematicBody;
+	bodyDef.position = record->transform.p;
+	bodyDef.rotation = record->transform.q;
+	bodyDef.linearVelocity = record->linearVelocity;
+	bodyDef.angularVelocity = record->angularVelocity;
+	bodyDef.linearDamping = record->linearDamping;
+	bodyDef.angularDamping = record->angularDamping;
+	bodyDef.gravityScale = record->gravityScale;
+	bodyDef.sleepThreshold = record->sleepThreshold;
+	bodyDef.userData = (void*)(uintptr_t)record->userData;
+	bodyDef.motionLocks = record->motionLocks;
+	bodyDef.isAwake = record->isAwake;
+	bodyDef.enableSleep = record->enableSleep;
+	bodyDef.isBullet = record->isHandoff && record->isBullet;
+	b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+
+	for ( int i = 0; i < record->shapeCount; ++i )
+	{
+		b2BorderShapeRecord shapeRecordValue;
+		memcpy( &shapeRecordValue, shapeData + i * sizeof( b2BorderShapeRecord ), sizeof( b2BorderShapeRecord ) );
+		const b2BorderShapeRecord* shapeRecord = &shapeRecordValue;
+
+		b2ShapeDef shapeDef = b2DefaultShapeDef();
+		shapeDef.userData = (void*)(uintptr_t)shapeRecord->userData;
+		shapeDef.material = shapeRecord->material;
+		shapeDef.filter = shapeRecord->filter;
+		shapeDef.density = shapeRecord->density;
+		shapeDef.isSensor = shapeRecord->isSensor;
+		shapeDef.enableSensorEvents = shapeRecord->enableSensorEvents;
+		shapeDef.enableContactEvents = shapeRecord->enableContactEvents;
+		shapeDef.enableHitEvents = shapeRecord->enableHitEvents;
+		shapeDef.enablePreSolveEvents = shapeRecord->enablePreSolveEvents;
+		shapeDef.updateBodyMass = i == record->shapeCount - 1;
+
+		switch ( shapeRecord->type )
+		{
+			case b2_capsuleShape:
+				b2CreateCapsuleShape( bodyId, &shapeDef, &shapeRecord->capsule );
+				break;
+			case b2_circleShape:
+				b2CreateCircleShape( bodyId, &shapeDef, &shapeRecord->circle );
+				break;
+			case b2_polygonShape:
+				b2CreatePolygonShape( bodyId, &shapeDef, &shapeRecord->polygon );
+				break;
+			case b2_segmentShape:
+				b2CreateSegmentShape( bodyId, &shapeDef, &shapeRecord->segment );
+				break;
+			default:
+				B2_ASSERT( false );
+				break;
+		}
+	}
+
+	return bodyId;
+}
+
+// Moves an existing ghost to the state of its owner. Unchanged ghosts of sleeping bodies are left alone
+// so they do not wake what rests on them.
+static void b2UpdateGhostBody( b2BodyId bodyId, const b2BorderBodyRecord* record )
+{
+	b2Transform transform = b2Body_GetTransform( bodyId );
+	if ( transform.p.x != record->transform.p.x || transform.p.y != record->transform.p.y ||
+		 transform.q.c != record->transform.q.c || transform.q.s != record->transform.q.s )
+	{
+		b2Body_SetTransform( bodyId, record->transform.p, record->transform.q );
+	}
+
+	b2Vec2 linearVelocity = b2Body_GetLinearVelocity( bodyId );
+	if ( linearVelocity.x != record->linearVelocity.x || linearVelocity.y != record->linearVelocity.y ||
+		 b2Body_GetAngularVelocity( bodyId ) != record->angularVelocity )
+	{
+		b2Body_SetLinearVelocity( bodyId, record->linearVelocity );
+		b2Body_SetAngularVelocity( bodyId, record->angularVelocity );
+	}
+}
+
+// Checks that the records fit the message before anything is changed
+static bool b2ValidateBorderRecords( const uint8_t* data, int size, int recordCount )
+{
+	int offset = (int)sizeof( b2BorderStateHeader );
+	for ( int i = 0; i < recordCount; ++i )
+	{
+		if ( size - offset < (int)sizeof( b2BorderBodyRecord ) )
+		{
+			return false;
+		}
+
+		b2BorderBodyRecord record;
+		memcpy( &record, data + offset, sizeof( record ) );
+		offset += (int)sizeof( record );
+
+		if ( record.shapeCount < 0 || ( size - offset ) / (int)sizeof( b2BorderShapeRecord ) < record.shapeCount )
+		{
+			return false;
+		}
+
+		offset += record.shapeCount * (int)sizeof( b2BorderShapeRecord );
+	}
+
+	return offset == size;
+}
+
+bool b2ShardGrid_ReadBorderState( b2ShardGrid* grid, const void* buffer, int size )
+{
+	if ( buffer == NULL || size < (int)sizeof( b2BorderStateHeader ) )
+	{
+		return false;
+	}
+
+	b2BorderStateHeader header;
+	memcpy( &header, buffer, sizeof( header ) );
+	if ( header.magic != B2_SHARD_MAGIC || header.version != B2_SHARD_VERSION || header.size != size ||
+		 header.sourceIndex < 0 || header.sourceIndex >= grid->shardCount || header.targetIndex < 0 ||
+		 header.targetIndex >= grid->shardCount || header.sourceIndex == header.targetIndex || header.recordCount < 0 )
+	{
+		return false;
+	}
+
+	if ( b2ValidateBorderRecords( buffer, size, header.recordCount ) == false )
+	{
+		return false;
+	}
+
+	int sourceIndex = header.sourceIndex;
+	b2Shard* shard = grid->shards + header.targetIndex;
+	b2WorldId worldId = grid->worldIds[header.targetIndex];
+	b2PruneShardBodies( &shard->ghosts );
+
+	grid->stamp += 1;
+	uint32_t stamp = grid->stamp;
+
+	// New ghosts are appended, so lookups only search the sorted part
+	int sortedCount = shard->ghosts.count;
+
+	b2SnapshotReader reader = { buffer, size, (int)sizeof( b2BorderStateHeader ) };
+	for ( int i = 0; i < header.recordCount; ++i )
+	{
+		b2BorderBodyRecord record;
+		b2ReadValue( &reader, record );
+
+		const uint8_t* shapeData = reader.data + reader.offset;
+		reader.offset += record.shapeCount * (int)sizeof( b2BorderShapeRecord );
+
+		int ghostIndex = b2FindShardBody( shard->ghosts.data, sortedCount, record.key );
+
+		if ( record.isHandoff )
+		{
+			if ( ghostIndex != B2_NULL_INDEX && b2Body_IsValid( shard->ghosts.data[ghostIndex].bodyId ) )
+			{
+				b2DestroyBody( shard->ghosts.data[ghostIndex].bodyId );
+				shard->ghosts.data[ghostIndex].bodyId = b2_nullBodyId;
+			}
+
+			b2BodyId bodyId = b2CreateBorderBody( worldId, &record, shapeData );
+			b2ShardBody body = { record.key, bodyId, header.targetIndex, 0 };
+			b2InsertShardBody( &shard->owned, body );
+			continue;
+		}
+
+		if ( ghostIndex != B2_NULL_INDEX && b2Body_IsValid( shard->ghosts.data[ghostIndex].bodyId ) )
+		{
+			b2ShardBody* ghost = shard->ghosts.data + ghostIndex;
+			b2UpdateGhostBody( ghost->bodyId, &record );
+			ghost->ownerIndex = sourceIndex;
+			ghost->stamp = stamp;
+			continue;
+		}
+
+		b2BodyId bodyId = b2CreateBorderBody( worldId, &record, shapeData );
+		b2ShardBody ghost = { record.key, bodyId, sourceIndex, stamp };
+		b2Array_Push( shard->ghosts, ghost );
+	}
+
+	// The source lists all of its ghosts, so the ghosts it left out are gone
+	for ( int i = 0; i < shard->ghosts.count; ++i )
+	{
+		b2ShardBody* ghost = shard->ghosts.data + i;
+		if ( ghost->ownerIndex == sourceIndex && ghost->stamp != stamp && b2Body_IsValid( ghost->bodyId ) )
+		{
+			b2DestroyBody( ghost->bodyId );
+			ghost->bodyId = b2_nullBodyId;
+		}
+	}
+
+	b2PruneShardBodies( &shard->ghosts );
+	if ( shard->ghosts.count > 1 )
+	{
+		qsort( shard->ghosts.data, shard->ghosts.count, sizeof( b2ShardBody ), b2CompareShardBodies );
+	}
+
+	return true;
+}
+
+void b2ShardGrid_Step( b2ShardGrid* grid, float timeStep, int subStepCount )
+{
+	b2StepWorlds( grid->worldIds, grid->shardCount, timeStep, subStepCount );
+
+	// Exchange border state with the eight neighbors in shard order
+	for ( int shardIndex = 0; shardIndex < grid->shardCount; ++shardIndex )
+	{
+		int column = shardIndex % grid->columnCount;
+		int row = shardIndex / grid->columnCount;
+
+		for ( int j = row - 1; j <= row + 1; ++j )
+		{
+			for ( int i = column - 1; i <= column + 1; ++i )
+			{
+				if ( i < 0 || i >= grid->columnCount || j < 0 || j >= grid->rowCount || ( i == column && j == row ) )
+				{
+					continue;
+				}
+
+				int targetIndex = j * grid->columnCount + i;
+				int size = b2ShardGrid_GetBorderStateSize( grid, shardIndex, targetIndex );
+				if ( size > grid->bufferCapacity )
+				{
+					int capacity = b2MaxInt( size, 2 * grid->bufferCapacity );
+					grid->buffer = b2GrowAlloc( grid->buffer, grid->bufferCapacity, capacity );
+					grid->bufferCapacity = capacity;
+				}
+
+				int written = b2ShardGrid_WriteBorderState( grid, shardIndex, targetIndex, grid->buffer, grid->bufferCapacity );
+				B2_ASSERT( written == size );
+
+				bool valid = b2ShardGrid_ReadBorderState( grid, grid->buffer, written );
+				B2_ASSERT( valid );
+				B2_UNUSED( valid );
+			}
+		}
+	}
+}
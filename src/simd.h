@@ -0,0 +1,1938 @@
+// SPDX-FileCopyrightText: 2023 Erin Catto
+// SPDX-License-Identifier: MIT
+
+// Wide float math and body state gather/scatter shared by the graph coloring solvers.
+// Only include this from solver and batched narrow phase source files so the intrinsics
+// headers stay out of the rest of the library.
+
+#pragma once
+
+#include "body.h"
+#include "core.h"
+
+#if defined( B2_SIMD_AVX512 )
+
+#include <immintrin.h>
+
+// wide float holds 16 numbers
+typedef __m512 b2FloatW;
+
+#elif defined( B2_SIMD_AVX2 )
+
+#include <immintrin.h>
+
+// wide float holds 8 numbers
+typedef __m256 b2FloatW;
+
+#elif defined( B2_SIMD_NEON )
+
+#include <arm_neon.h>
+
+// wide float holds 4 numbers
+typedef float32x4_t b2FloatW;
+
+#elif defined( B2_SIMD_SSE2 )
+
+#include <emmintrin.h>
+
+// wide float holds 4 numbers
+typedef __m128 b2FloatW;
+
+#elif defined( B2_SIMD_WASM )
+
+#include <wasm_simd128.h>
+
+// wide float holds 4 numbers
+typedef v128_t b2FloatW;
+
+#else
+
+// scalar math
+typedef struct b2FloatW
+{
+	float x, y, z, w;
+} b2FloatW;
+
+#endif
+
+// Wide vec2
+typedef struct b2Vec2W
+{
+	b2FloatW X, Y;
+} b2Vec2W;
+
+// Wide rotation
+typedef struct b2RotW
+{
+	b2FloatW C, S;
+} b2RotW;
+
+#if defined( B2_SIMD_AVX512 )
+
+// AVX-512F comparisons produce a k-mask. Masks are widened back to full lanes so the solver
+// code can keep treating masks as b2FloatW, matching the other SIMD paths. Float bitwise
+// operations need AVX-512DQ, so the integer forms are used to only require AVX-512F.
+
+static inline b2FloatW b2ZeroW( void )
+{
+	return _mm512_setzero_ps();
+}
+
+static inline b2FloatW b2SplatW( float scalar )
+{
+	return _mm512_set1_ps( scalar );
+}
+
+static inline b2FloatW b2AddW( b2FloatW a, b2FloatW b )
+{
+	return _mm512_add_ps( a, b );
+}
+
+static inline b2FloatW b2SubW( b2FloatW a, b2FloatW b )
+{
+	return _mm512_sub_ps( a, b );
+}
+
+static inline b2FloatW b2MulW( b2FloatW a, b2FloatW b )
+{
+	return _mm512_mul_ps( a, b );
+}
+
+static inline b2FloatW b2MulAddW( b2FloatW a, b2FloatW b, b2FloatW c )
+{
+	// No FMA for determinism across SIMD paths
+	return _mm512_add_ps( _mm512_mul_ps( b, c ), a );
+}
+
+static inline b2FloatW b2MulSubW( b2FloatW a, b2FloatW b, b2FloatW c )
+{
+	return _mm512_sub_ps( a, _mm512_mul_ps( b, c ) );
+}
+
+static inline b2FloatW b2MinW( b2FloatW a, b2FloatW b )
+{
+	return _mm512_min_ps( a, b );
+}
+
+static inline b2FloatW b2MaxW( b2FloatW a, b2FloatW b )
+{
+	return _mm512_max_ps( a, b );
+}
+
+// a = clamp(a, -b, b)
+static inline b2FloatW b2SymClampW( b2FloatW a, b2FloatW b )
+{
+	b2FloatW nb = _mm512_sub_ps( _mm512_setzero_ps(), b );
+	return _mm512_max_ps( nb, _mm512_min_ps( a, b ) );
+}
+
+static inline b2FloatW b2OrW( b2FloatW a, b2FloatW b )
+{
+	return _mm512_castsi512_ps( _mm512_or_si512( _mm512_castps_si512( a ), _mm512_castps_si512( b ) ) );
+}
+
+static inline b2FloatW b2MaskToW( __mmask16 mask )
+{
+	return _mm512_castsi512_ps( _mm512_maskz_set1_epi32( mask, -1 ) );
+}
+
+static inline __mmask16 b2WToMask( b2FloatW a )
+{
+	__m512i ai = _mm512_castps_si512( a );
+	return _mm512_test_epi32_mask( ai, ai );
+}
+
+static inline b2FloatW b2GreaterThanW( b2FloatW a, b2FloatW b )
+{
+	return b2MaskToW( _mm512_cmp_ps_mask( a, b, _CMP_GT_OQ ) );
+}
+
+static inline b2FloatW b2EqualsW( b2FloatW a, b2FloatW b )
+{
+	return b2MaskToW( _mm512_cmp_ps_mask( a, b, _CMP_EQ_OQ ) );
+}
+
+static inline bool b2AllZeroW( b2FloatW a )
+{
+	__mmask16 mask = _mm512_cmp_ps_mask( a, _mm512_setzero_ps(), _CMP_EQ_OQ );
+	return mask == 0xFFFF;
+}
+
+// component-wise returns mask ? b : a
+static inline b2FloatW b2BlendW( b2FloatW a, b2FloatW b, b2FloatW mask )
+{
+	return _mm512_mask_blend_ps( b2WToMask( mask ), a, b );
+}
+
+static inline b2FloatW b2DivW( b2FloatW a, b2FloatW b )
+{
+	return _mm512_div_ps( a, b );
+}
+
+static inline b2FloatW b2SqrtW( b2FloatW a )
+{
+	return _mm512_sqrt_ps( a );
+}
+
+// flips the sign bit, so -0 is produced from 0 just like scalar negation
+static inline b2FloatW b2NegW( b2FloatW a )
+{
+	return _mm512_castsi512_ps( _mm512_xor_si512( _mm512_castps_si512( a ), _mm512_set1_epi32( (int)0x80000000 ) ) );
+}
+
+#elif defined( B2_SIMD_AVX2 )
+
+static inline b2FloatW b2ZeroW( void )
+{
+	return _mm256_setzero_ps();
+}
+
+static inline b2FloatW b2SplatW( float scalar )
+{
+	return _mm256_set1_ps( scalar );
+}
+
+static inline b2FloatW b2AddW( b2FloatW a, b2FloatW b )
+{
+	return _mm256_add_ps( a, b );
+}
+
+static inline b2FloatW b2SubW( b2FloatW a, b2FloatW b )
+{
+	return _mm256_sub_ps( a, b );
+}
+
+static inline b2FloatW b2MulW( b2FloatW a, b2FloatW b )
+{
+	return _mm256_mul_ps( a, b );
+}
+
+static inline b2FloatW b2MulAddW( b2FloatW a, b2FloatW b, b2FloatW c )
+{
+	// FMA can be emulated: https://github.com/lattera/glibc/blob/master/sysdeps/ieee754/dbl-64/s_fmaf.c#L34
+	// return _mm256_fmadd_ps( b, c, a );
+	return _mm256_add_ps( _mm256_mul_ps( b, c ), a );
+}
+
+static inline b2FloatW b2MulSubW( b2FloatW a, b2FloatW b, b2FloatW c )
+{
+	// return _mm256_fnmadd_ps(b, c, a);
+	return _mm256_sub_ps( a, _mm256_mul_ps( b, c ) );
+}
+
+static inline b2FloatW b2MinW( b2FloatW a, b2FloatW b )
+{
+	return _mm256_min_ps( a, b );
+}
+
+static inline b2FloatW b2MaxW( b2FloatW a, b2FloatW b )
+{
+	return _mm256_max_ps( a, b );
+}
+
+// a = clamp(a, -b, b)
+static inline b2FloatW b2SymClampW( b2FloatW a, b2FloatW b )
+{
+	b2FloatW nb = _mm256_sub_ps( _mm256_setzero_ps(), b );
+	return _mm256_max_ps( nb, _mm256_min_ps( a, b ) );
+}
+
+static inline b2FloatW b2OrW( b2FloatW a, b2FloatW b )
+{
+	return _mm256_or_ps( a, b );
+}
+
+static inline b2FloatW b2GreaterThanW( b2FloatW a, b2FloatW b )
+{
+	return _mm256_cmp_ps( a, b, _CMP_GT_OQ );
+}
+
+static inline b2FloatW b2EqualsW( b2FloatW a, b2FloatW b )
+{
+	return _mm256_cmp_ps( a, b, _CMP_EQ_OQ );
+}
+
+static inline bool b2AllZeroW( b2FloatW a )
+{
+	// Compare each element with zero
+	b2FloatW zero = _mm256_setzero_ps();
+	b2FloatW cmp = _mm256_cmp_ps( a, zero, _CMP_EQ_OQ );
+
+	// Create a mask from the comparison results
+	int mask = _mm256_movemask_ps( cmp );
+
+	// If all elements are zero, the mask will be 0xFF (11111111 in binary)
+	return mask == 0xFF;
+}
+
+// component-wise returns mask ? b : a
+static inline b2FloatW b2BlendW( b2FloatW a, b2FloatW b, b2FloatW mask )
+{
+	return _mm256_blendv_ps( a, b, mask );
+}
+
+static inline b2FloatW b2DivW( b2FloatW a, b2FloatW b )
+{
+	return _mm256_div_ps( a, b );
+}
+
+static inline b2FloatW b2SqrtW( b2FloatW a )
+{
+	return _mm256_sqrt_ps( a );
+}
+
+// flips the sign bit, so -0 is produced from 0 just like scalar negation
+static inline b2FloatW b2NegW( b2FloatW a )
+{
+	return _mm256_xor_ps( a, _mm256_set1_ps( -0.0f ) );
+}
+
+#elif defined( B2_SIMD_NEON )
+
+static inline b2FloatW b2ZeroW( void )
+{
+	return vdupq_n_f32( 0.0f );
+}
+
+static inline b2FloatW b2SplatW( float scalar )
+{
+	return vdupq_n_f32( scalar );
+}
+
+static inline b2FloatW b2SetW( float a, float b, float c, float d )
+{
+	float32_t array[4] = { a, b, c, d };
+	return vld1q_f32( array );
+}
+
+static inline b2FloatW b2AddW( b2FloatW a, b2FloatW b )
+{
+	return vaddq_f32( a, b );
+}
+
+static inline b2FloatW b2SubW( b2FloatW a, b2FloatW b )
+{
+	return vsubq_f32( a, b );
+}
+
+static inline b2FloatW b2MulW( b2FloatW a, b2FloatW b )
+{
+	return vmulq_f32( a, b );
+}
+
+static inline b2FloatW b2MulAddW( b2FloatW a, b2FloatW b, b2FloatW c )
+{
+	return vaddq_f32( a, vmulq_f32( b, c ) );
+}
+
+static inline b2FloatW b2MulSubW( b2FloatW a, b2FloatW b, b2FloatW c )
+{
+	return vsubq_f32( a, vmulq_f32( b, c ) );
+}
+
+static inline b2FloatW b2MinW( b2FloatW a, b2FloatW b )
+{
+	return vminq_f32( a, b );
+}
+
+static inline b2FloatW b2MaxW( b2FloatW a, b2FloatW b )
+{
+	return vmaxq_f32( a, b );
+}
+
+// a = clamp(a, -b, b)
+static inline b2FloatW b2SymClampW( b2FloatW a, b2FloatW b )
+{
+	b2FloatW nb = vnegq_f32( b );
+	return vmaxq_f32( nb, vminq_f32( a, b ) );
+}
+
+static inline b2FloatW b2OrW( b2FloatW a, b2FloatW b )
+{
+	return vreinterpretq_f32_u32( vorrq_u32( vreinterpretq_u32_f32( a ), vreinterpretq_u32_f32( b ) ) );
+}
+
+static inline b2FloatW b2GreaterThanW( b2FloatW a, b2FloatW b )
+{
+	return vreinterpretq_f32_u32( vcgtq_f32( a, b ) );
+}
+
+static inline b2FloatW b2EqualsW( b2FloatW a, b2FloatW b )
+{
+	return vreinterpretq_f32_u32( vceqq_f32( a, b ) );
+}
+
+static inline bool b2AllZeroW( b2FloatW a )
+{
+	// Create a zero vector for comparison
+	b2FloatW zero = vdupq_n_f32( 0.0f );
+
+	// Compare the input vector with zero
+	uint32x4_t cmp_result = vceqq_f32( a, zero );
+
+// Check if all comparison results are non-zero using vminvq
+#ifdef __ARM_FEATURE_SVE
+	// ARM v8.2+ has horizontal minimum instruction
+	return vminvq_u32( cmp_result ) != 0;
+#else
+	// For older ARM architectures, we need to manually check all lanes
+	return vgetq_lane_u32( cmp_result, 0 ) != 0 && vgetq_lane_u32( cmp_result, 1 ) != 0 && vgetq_lane_u32( cmp_result, 2 ) != 0 &&
+		   vgetq_lane_u32( cmp_result, 3 ) != 0;
+#endif
+}
+
+// component-wise returns mask ? b : a
+static inline b2FloatW b2BlendW( b2FloatW a, b2FloatW b, b2FloatW mask )
+{
+	uint32x4_t mask32 = vreinterpretq_u32_f32( mask );
+	return vbslq_f32( mask32, b, a );
+}
+
+static inline b2FloatW b2DivW( b2FloatW a, b2FloatW b )
+{
+#if defined( _M_ARM64 ) || defined( __aarch64__ )
+	return vdivq_f32( a, b );
+#else
+	// ARMv7 NEON only has a reciprocal estimate, which is not exact
+	float32_t x[4], y[4];
+	vst1q_f32( x, a );
+	vst1q_f32( y, b );
+	x[0] /= y[0];
+	x[1] /= y[1];
+	x[2] /= y[2];
+	x[3] /= y[3];
+	return vld1q_f32( x );
+#endif
+}
+
+static inline b2FloatW b2SqrtW( b2FloatW a )
+{
+#if defined( _M_ARM64 ) || defined( __aarch64__ )
+	return vsqrtq_f32( a );
+#else
+	// ARMv7 NEON only has a reciprocal square root estimate
+	float32_t x[4];
+	vst1q_f32( x, a );
+	x[0] = sqrtf( x[0] );
+	x[1] = sqrtf( x[1] );
+	x[2] = sqrtf( x[2] );
+	x[3] = sqrtf( x[3] );
+	return vld1q_f32( x );
+#endif
+}
+
+static inline b2FloatW b2NegW( b2FloatW a )
+{
+	return vnegq_f32( a );
+}
+
+static inline b2FloatW b2LoadW( const float32_t* data )
+{
+	return vld1q_f32( data );
+}
+
+static inline void b2StoreW( float32_t* data, b2FloatW a )
+{
+	vst1q_f32( data, a );
+}
+
+static inline b2FloatW b2UnpackLoW( b2FloatW a, b2FloatW b )
+{
+#if defined( _M_ARM64 ) || defined( __aarch64__ )
+	return vzip1q_f32( a, b );
+#else
+	float32x2_t a1 = vget_low_f32( a );
+	float32x2_t b1 = vget_low_f32( b );
+	float32x2x2_t result = vzip_f32( a1, b1 );
+	return vcombine_f32( result.val[0], result.val[1] );
+#endif
+}
+
+static inline b2FloatW b2UnpackHiW( b2FloatW a, b2FloatW b )
+{
+#if defined( _M_ARM64 ) || defined( __aarch64__ )
+	return vzip2q_f32( a, b );
+#else
+	float32x2_t a1 = vget_high_f32( a );
+	float32x2_t b1 = vget_high_f32( b );
+	float32x2x2_t result = vzip_f32( a1, b1 );
+	return vcombine_f32( result.val[0], result.val[1] );
+#endif
+}
+
+#elif defined( B2_SIMD_SSE2 )
+
+static inline b2FloatW b2ZeroW( void )
+{
+	return _mm_setzero_ps();
+}
+
+static inline b2FloatW b2SplatW( float scalar )
+{
+	return _mm_set1_ps( scalar );
+}
+
+static inline b2FloatW b2SetW( float a, float b, float c, float d )
+{
+	return _mm_setr_ps( a, b, c, d );
+}
+
+static inline b2FloatW b2AddW( b2FloatW a, b2FloatW b )
+{
+	return _mm_add_ps( a, b );
+}
+
+static inline b2FloatW b2SubW( b2FloatW a, b2FloatW b )
+{
+	return _mm_sub_ps( a, b );
+}
+
+static inline b2FloatW b2MulW( b2FloatW a, b2FloatW b )
+{
+	return _mm_mul_ps( a, b );
+}
+
+static inline b2FloatW b2MulAddW( b2FloatW a, b2FloatW b, b2FloatW c )
+{
+	return _mm_add_ps( a, _mm_mul_ps( b, c ) );
+}
+
+static inline b2FloatW b2MulSubW( b2FloatW a, b2FloatW b, b2FloatW c )
+{
+	return _mm_sub_ps( a, _mm_mul_ps( b, c ) );
+}
+
+static inline b2FloatW b2MinW( b2FloatW a, b2FloatW b )
+{
+	return _mm_min_ps( a, b );
+}
+
+static inline b2FloatW b2MaxW( b2FloatW a, b2FloatW b )
+{
+	return _mm_max_ps( a, b );
+}
+
+// a = clamp(a, -b, b)
+static inline b2FloatW b2SymClampW( b2FloatW a, b2FloatW b )
+{
+	// Create a mask with the sign bit set for each element
+	__m128 mask = _mm_set1_ps( -0.0f );
+
+	// XOR the input with the mask to negate each element
+	__m128 nb = _mm_xor_ps( b, mask );
+
+	return _mm_max_ps( nb, _mm_min_ps( a, b ) );
+}
+
+static inline b2FloatW b2OrW( b2FloatW a, b2FloatW b )
+{
+	return _mm_or_ps( a, b );
+}
+
+static inline b2FloatW b2GreaterThanW( b2FloatW a, b2FloatW b )
+{
+	return _mm_cmpgt_ps( a, b );
+}
+
+static inline b2FloatW b2EqualsW( b2FloatW a, b2FloatW b )
+{
+	return _mm_cmpeq_ps( a, b );
+}
+
+static inline bool b2AllZeroW( b2FloatW a )
+{
+	// Compare each element with zero
+	b2FloatW zero = _mm_setzero_ps();
+	b2FloatW cmp = _mm_cmpeq_ps( a, zero );
+
+	// Create a mask from the comparison results
+	int mask = _mm_movemask_ps( cmp );
+
+	// If all elements are zero, the mask will be 0xF (1111 in binary)
+	return mask == 0xF;
+}
+
+// component-wise returns mask ? b : a
+static inline b2FloatW b2BlendW( b2FloatW a, b2FloatW b, b2FloatW mask )
+{
+	return _mm_or_ps( _mm_and_ps( mask, b ), _mm_andnot_ps( mask, a ) );
+}
+
+static inline b2FloatW b2DivW( b2FloatW a, b2FloatW b )
+{
+	return _mm_div_ps( a, b );
+}
+
+static inline b2FloatW b2SqrtW( b2FloatW a )
+{
+	return _mm_sqrt_ps( a );
+}
+
+// flips the sign bit, so -0 is produced from 0 just like scalar negation
+static inline b2FloatW b2NegW( b2FloatW a )
+{
+	return _mm_xor_ps( a, _mm_set1_ps( -0.0f ) );
+}
+
+static inline b2FloatW b2LoadW( const float* data )
+{
+	return _mm_load_ps( data );
+}
+
+static inline void b2StoreW( float* data, b2FloatW a )
+{
+	_mm_store_ps( data, a );
+}
+
+static inline b2FloatW b2UnpackLoW( b2FloatW a, b2FloatW b )
+{
+	return _mm_unpacklo_ps( a, b );
+}
+
+static inline b2FloatW b2UnpackHiW( b2FloatW a, b2FloatW b )
+{
+	return _mm_unpackhi_ps( a, b );
+}
+
+#elif defined( B2_SIMD_WASM )
+
+static inline b2FloatW b2ZeroW( void )
+{
+	return wasm_f32x4_splat( 0.0f );
+}
+
+static inline b2FloatW b2SplatW( float scalar )
+{
+	return wasm_f32x4_splat( scalar );
+}
+
+static inline b2FloatW b2SetW( float a, float b, float c, float d )
+{
+	return wasm_f32x4_make( a, b, c, d );
+}
+
+static inline b2FloatW b2AddW( b2FloatW a, b2FloatW b )
+{
+	return wasm_f32x4_add( a, b );
+}
+
+static inline b2FloatW b2SubW( b2FloatW a, b2FloatW b )
+{
+	return wasm_f32x4_sub( a, b );
+}
+
+static inline b2FloatW b2MulW( b2FloatW a, b2FloatW b )
+{
+	return wasm_f32x4_mul( a, b );
+}
+
+// No fused multiply-add, which keeps the results identical to the other paths
+static inline b2FloatW b2MulAddW( b2FloatW a, b2FloatW b, b2FloatW c )
+{
+	return wasm_f32x4_add( a, wasm_f32x4_mul( b, c ) );
+}
+
+static inline b2FloatW b2MulSubW( b2FloatW a, b2FloatW b, b2FloatW c )
+{
+	return wasm_f32x4_sub( a, wasm_f32x4_mul( b, c ) );
+}
+
+// The pseudo-min and pseudo-max with swapped operands match the SSE2 handling of NaN and signed zero.
+// The IEEE wasm_f32x4_min would return -0 for min(0, -0) and lower to a longer sequence on x64.
+static inline b2FloatW b2MinW( b2FloatW a, b2FloatW b )
+{
+	return wasm_f32x4_pmin( b, a );
+}
+
+static inline b2FloatW b2MaxW( b2FloatW a, b2FloatW b )
+{
+	return wasm_f32x4_pmax( b, a );
+}
+
+// a = clamp(a, -b, b)
+static inline b2FloatW b2SymClampW( b2FloatW a, b2FloatW b )
+{
+	return b2MaxW( wasm_f32x4_neg( b ), b2MinW( a, b ) );
+}
+
+static inline b2FloatW b2OrW( b2FloatW a, b2FloatW b )
+{
+	return wasm_v128_or( a, b );
+}
+
+static inline b2FloatW b2GreaterThanW( b2FloatW a, b2FloatW b )
+{
+	return wasm_f32x4_gt( a, b );
+}
+
+static inline b2FloatW b2EqualsW( b2FloatW a, b2FloatW b )
+{
+	return wasm_f32x4_eq( a, b );
+}
+
+static inline bool b2AllZeroW( b2FloatW a )
+{
+	return wasm_i32x4_all_true( wasm_f32x4_eq( a, wasm_f32x4_splat( 0.0f ) ) );
+}
+
+// component-wise returns mask ? b : a
+static inline b2FloatW b2BlendW( b2FloatW a, b2FloatW b, b2FloatW mask )
+{
+	return wasm_v128_bitselect( b, a, mask );
+}
+
+static inline b2FloatW b2DivW( b2FloatW a, b2FloatW b )
+{
+	return wasm_f32x4_div( a, b );
+}
+
+static inline b2FloatW b2SqrtW( b2FloatW a )
+{
+	return wasm_f32x4_sqrt( a );
+}
+
+// flips the sign bit, so -0 is produced from 0 just like scalar negation
+static inline b2FloatW b2NegW( b2FloatW a )
+{
+	return wasm_f32x4_neg( a );
+}
+
+static inline b2FloatW b2LoadW( const float* data )
+{
+	return wasm_v128_load( data );
+}
+
+static inline void b2StoreW( float* data, b2FloatW a )
+{
+	wasm_v128_store( data, a );
+}
+
+static inline b2FloatW b2UnpackLoW( b2FloatW a, b2FloatW b )
+{
+	return wasm_i32x4_shuffle( a, b, 0, 4, 1, 5 );
+}
+
+static inline b2FloatW b2UnpackHiW( b2FloatW a, b2FloatW b )
+{
+	return wasm_i32x4_shuffle( a, b, 2, 6, 3, 7 );
+}
+
+#else
+
+static inline b2FloatW b2ZeroW( void )
+{
+	return (b2FloatW){ 0.0f, 0.0f, 0.0f, 0.0f };
+}
+
+static inline b2FloatW b2SplatW( float scalar )
+{
+	return (b2FloatW){ scalar, scalar, scalar, scalar };
+}
+
+static inline b2FloatW b2AddW( b2FloatW a, b2FloatW b )
+{
+	return (b2FloatW){ a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w };
+}
+
+static inline b2FloatW b2SubW( b2FloatW a, b2FloatW b )
+{
+	return (b2FloatW){ a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w };
+}
+
+static inline b2FloatW b2MulW( b2FloatW a, b2FloatW b )
+{
+	return (b2FloatW){ a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w };
+}
+
+static inline b2FloatW b2MulAddW( b2FloatW a, b2FloatW b, b2FloatW c )
+{
+	return (b2FloatW){ a.x + b.x * c.x, a.y + b.y * c.y, a.z + b.z * c.z, a.w + b.w * c.w };
+}
+
+static inline b2FloatW b2MulSubW( b2FloatW a, b2FloatW b, b2FloatW c )
+{
+	return (b2FloatW){ a.x - b.x * c.x, a.y - b.y * c.y, a.z - b.z * c.z, a.w - b.w * c.w };
+}
+
+static inline b2FloatW b2MinW( b2FloatW a, b2FloatW b )
+{
+	b2FloatW r;
+	r.x = a.x <= b.x ? a.x : b.x;
+	r.y = a.y <= b.y ? a.y : b.y;
+	r.z = a.z <= b.z ? a.z : b.z;
+	r.w = a.w <= b.w ? a.w : b.w;
+	return r;
+}
+
+static inline b2FloatW b2MaxW( b2FloatW a, b2FloatW b )
+{
+	b2FloatW r;
+	r.x = a.x >= b.x ? a.x : b.x;
+	r.y = a.y >= b.y ? a.y : b.y;
+	r.z = a.z >= b.z ? a.z : b.z;
+	r.w = a.w >= b.w ? a.w : b.w;
+	return r;
+}
+
+// a = clamp(a, -b, b)
+static inline b2FloatW b2SymClampW( b2FloatW a, b2FloatW b )
+{
+	b2FloatW r;
+	r.x = b2ClampFloat( a.x, -b.x, b.x );
+	r.y = b2ClampFloat( a.y, -b.y, b.y );
+	r.z = b2ClampFloat( a.z, -b.z, b.z );
+	r.w = b2ClampFloat( a.w, -b.w, b.w );
+	return r;
+}
+
+static inline b2FloatW b2OrW( b2FloatW a, b2FloatW b )
+{
+	b2FloatW r;
+	r.x = a.x != 0.0f || b.x != 0.0f ? 1.0f : 0.0f;
+	r.y = a.y != 0.0f || b.y != 0.0f ? 1.0f : 0.0f;
+	r.z = a.z != 0.0f || b.z != 0.0f ? 1.0f : 0.0f;
+	r.w = a.w != 0.0f || b.w != 0.0f ? 1.0f : 0.0f;
+	return r;
+}
+
+static inline b2FloatW b2GreaterThanW( b2FloatW a, b2FloatW b )
+{
+	b2FloatW r;
+	r.x = a.x > b.x ? 1.0f : 0.0f;
+	r.y = a.y > b.y ? 1.0f : 0.0f;
+	r.z = a.z > b.z ? 1.0f : 0.0f;
+	r.w = a.w > b.w ? 1.0f : 0.0f;
+	return r;
+}
+
+static inline b2FloatW b2EqualsW( b2FloatW a, b2FloatW b )
+{
+	b2FloatW r;
+	r.x = a.x == b.x ? 1.0f : 0.0f;
+	r.y = a.y == b.y ? 1.0f : 0.0f;
+	r.z = a.z == b.z ? 1.0f : 0.0f;
+	r.w = a.w == b.w ? 1.0f : 0.0f;
+	return r;
+}
+
+static inline bool b2AllZeroW( b2FloatW a )
+{
+	return a.x == 0.0f && a.y == 0.0f && a.z == 0.0f && a.w == 0.0f;
+}
+
+// component-wise returns mask ? b : a
+static inline b2FloatW b2BlendW( b2FloatW a, b2FloatW b, b2FloatW mask )
+{
+	b2FloatW r;
+	r.x = mask.x != 0.0f ? b.x : a.x;
+	r.y = mask.y != 0.0f ? b.y : a.y;
+	r.z = mask.z != 0.0f ? b.z : a.z;
+	r.w = mask.w != 0.0f ? b.w : a.w;
+	return r;
+}
+
+static inline b2FloatW b2DivW( b2FloatW a, b2FloatW b )
+{
+	return (b2FloatW){ a.x / b.x, a.y / b.y, a.z / b.z, a.w / b.w };
+}
+
+static inline b2FloatW b2SqrtW( b2FloatW a )
+{
+	return (b2FloatW){ sqrtf( a.x ), sqrtf( a.y ), sqrtf( a.z ), sqrtf( a.w ) };
+}
+
+static inline b2FloatW b2NegW( b2FloatW a )
+{
+	return (b2FloatW){ -a.x, -a.y, -a.z, -a.w };
+}
+
+#endif
+
+static inline b2FloatW b2DotW( b2Vec2W a, b2Vec2W b )
+{
+	return b2AddW( b2MulW( a.X, b.X ), b2MulW( a.Y, b.Y ) );
+}
+
+static inline b2FloatW b2CrossW( b2Vec2W a, b2Vec2W b )
+{
+	return b2SubW( b2MulW( a.X, b.Y ), b2MulW( a.Y, b.X ) );
+}
+
+static inline b2Vec2W b2RotateVectorW( b2RotW q, b2Vec2W v )
+{
+	return (b2Vec2W){ b2SubW( b2MulW( q.C, v.X ), b2MulW( q.S, v.Y ) ), b2AddW( b2MulW( q.S, v.X ), b2MulW( q.C, v.Y ) ) };
+}
+
+// wide version of b2BodyState
+typedef struct b2BodyStateW
+{
+	b2Vec2W v;
+	b2FloatW w;
+	b2FloatW flags;
+	b2Vec2W dp;
+	b2RotW dq;
+} b2BodyStateW;
+
+// Prefetch the body states of a wide constraint so a later gather does not wait on memory. Each
+// 32 byte body state sits within one cache line.
+static inline void b2PrefetchBodies( const b2BodyState* states, const int* indices )
+{
+	for ( int i = 0; i < B2_SIMD_WIDTH; ++i )
+	{
+		// zero means null
+		if ( indices[i] != 0 )
+		{
+			B2_PREFETCH( states + indices[i] - 1 );
+		}
+	}
+}
+
+// Custom gather/scatter for each SIMD type
+#if defined( B2_SIMD_AVX512 )
+
+// A 16x8 transpose through registers costs more than hardware gathers on Zen 4 and
+// Sapphire Rapids, so this uses masked gathers with one lane per body. Null lanes
+// are masked off and keep the identity body state.
+static inline b2BodyStateW b2GatherBodies( const b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices )
+{
+	_Static_assert( sizeof( b2BodyState ) == 32, "b2BodyState not 32 bytes" );
+	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
+
+	// zero means null
+	__m512i index = _mm512_loadu_si512( indices );
+	__mmask16 valid = _mm512_test_epi32_mask( index, index );
+
+	// float offset of each body state, 8 floats per body
+	__m512i offset = _mm512_slli_epi32( _mm512_sub_epi32( index, _mm512_set1_epi32( 1 ) ), 3 );
+	const float* base = (const float*)states;
+
+	b2FloatW zero = _mm512_setzero_ps();
+	b2FloatW one = _mm512_set1_ps( 1.0f );
+
+	b2BodyStateW simdBody;
+	simdBody.v.X = _mm512_mask_i32gather_ps( zero, valid, offset, base + 0, 4 );
+	simdBody.v.Y = _mm512_mask_i32gather_ps( zero, valid, offset, base + 1, 4 );
+	simdBody.w = _mm512_mask_i32gather_ps( zero, valid, offset, base + 2, 4 );
+	simdBody.flags = _mm512_mask_i32gather_ps( zero, valid, offset, base + 3, 4 );
+	simdBody.dp.X = _mm512_mask_i32gather_ps( zero, valid, offset, base + 4, 4 );
+	simdBody.dp.Y = _mm512_mask_i32gather_ps( zero, valid, offset, base + 5, 4 );
+	simdBody.dq.C = _mm512_mask_i32gather_ps( one, valid, offset, base + 6, 4 );
+	simdBody.dq.S = _mm512_mask_i32gather_ps( zero, valid, offset, base + 7, 4 );
+	return simdBody;
+}
+
+// Only the velocity half of the body state. Warm starting and restitution do not use the
+// delta position and rotation, so this skips half of the loads and shuffles.
+static inline b2BodyStateW b2GatherVelocities( const b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices )
+{
+	_Static_assert( sizeof( b2BodyState ) == 32, "b2BodyState not 32 bytes" );
+	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
+
+	// zero means null
+	__m512i index = _mm512_loadu_si512( indices );
+	__mmask16 valid = _mm512_test_epi32_mask( index, index );
+	__m512i offset = _mm512_slli_epi32( _mm512_sub_epi32( index, _mm512_set1_epi32( 1 ) ), 3 );
+	const float* base = (const float*)states;
+
+	b2FloatW zero = _mm512_setzero_ps();
+
+	b2BodyStateW simdBody;
+	simdBody.v.X = _mm512_mask_i32gather_ps( zero, valid, offset, base + 0, 4 );
+	simdBody.v.Y = _mm512_mask_i32gather_ps( zero, valid, offset, base + 1, 4 );
+	simdBody.w = _mm512_mask_i32gather_ps( zero, valid, offset, base + 2, 4 );
+	simdBody.flags = _mm512_mask_i32gather_ps( zero, valid, offset, base + 3, 4 );
+	simdBody.dp = (b2Vec2W){ zero, zero };
+	simdBody.dq = (b2RotW){ _mm512_set1_ps( 1.0f ), zero };
+	return simdBody;
+}
+
+// This writes only the velocities back to the solver bodies. Masked scatter skips null
+// and non-dynamic lanes. A dynamic body appears at most once per graph color so the
+// scatter has no conflicting lanes.
+static inline void b2ScatterBodies( b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices, const b2BodyStateW* B2_RESTRICT simdBody )
+{
+	_Static_assert( sizeof( b2BodyState ) == 32, "b2BodyState not 32 bytes" );
+	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
+
+	// zero means null
+	__m512i index = _mm512_loadu_si512( indices );
+	__mmask16 valid = _mm512_test_epi32_mask( index, index );
+	__m512i offset = _mm512_slli_epi32( _mm512_sub_epi32( index, _mm512_set1_epi32( 1 ) ), 3 );
+	float* base = (float*)states;
+
+	// I don't use any dummy body in the body array because this will lead to multithreaded sharing and the
+	// associated cache flushing.
+	__m512i flags = _mm512_mask_i32gather_epi32( _mm512_setzero_si512(), valid, offset, base + 3, 4 );
+	__mmask16 dynamic = _mm512_mask_test_epi32_mask( valid, flags, _mm512_set1_epi32( b2_dynamicFlag ) );
+
+	_mm512_mask_i32scatter_ps( base + 0, dynamic, offset, simdBody->v.X, 4 );
+	_mm512_mask_i32scatter_ps( base + 1, dynamic, offset, simdBody->v.Y, 4 );
+	_mm512_mask_i32scatter_ps( base + 2, dynamic, offset, simdBody->w, 4 );
+}
+
+#elif defined( B2_SIMD_AVX2 )
+
+// This is a load and 8x8 transpose
+static inline b2BodyStateW b2GatherBodies( const b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices )
+{
+	_Static_assert( sizeof( b2BodyState ) == 32, "b2BodyState not 32 bytes" );
+	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
+
+	// zero means null
+	int i1 = indices[0] - 1;
+	int i2 = indices[1] - 1;
+	int i3 = indices[2] - 1;
+	int i4 = indices[3] - 1;
+	int i5 = indices[4] - 1;
+	int i6 = indices[5] - 1;
+	int i7 = indices[6] - 1;
+	int i8 = indices[7] - 1;
+
+	// b2BodyState b2_identityBodyState = {{0.0f, 0.0f}, 0.0f, 0, {0.0f, 0.0f}, {1.0f, 0.0f}};
+	b2FloatW identity = _mm256_setr_ps( 0.0f, 0.0f, 0.0f, 0, 0.0f, 0.0f, 1.0f, 0.0f );
+	b2FloatW b0 = i1 == B2_NULL_INDEX ? identity : _mm256_load_ps( (float*)( states + i1 ) );
+	b2FloatW b1 = i2 == B2_NULL_INDEX ? identity : _mm256_load_ps( (float*)( states + i2 ) );
+	b2FloatW b2 = i3 == B2_NULL_INDEX ? identity : _mm256_load_ps( (float*)( states + i3 ) );
+	b2FloatW b3 = i4 == B2_NULL_INDEX ? identity : _mm256_load_ps( (float*)( states + i4 ) );
+	b2FloatW b4 = i5 == B2_NULL_INDEX ? identity : _mm256_load_ps( (float*)( states + i5 ) );
+	b2FloatW b5 = i6 == B2_NULL_INDEX ? identity : _mm256_load_ps( (float*)( states + i6 ) );
+	b2FloatW b6 = i7 == B2_NULL_INDEX ? identity : _mm256_load_ps( (float*)( states + i7 ) );
+	b2FloatW b7 = i8 == B2_NULL_INDEX ? identity : _mm256_load_ps( (float*)( states + i8 ) );
+
+	b2FloatW t0 = _mm256_unpacklo_ps( b0, b1 );
+	b2FloatW t1 = _mm256_unpackhi_ps( b0, b1 );
+	b2FloatW t2 = _mm256_unpacklo_ps( b2, b3 );
+	b2FloatW t3 = _mm256_unpackhi_ps( b2, b3 );
+	b2FloatW t4 = _mm256_unpacklo_ps( b4, b5 );
+	b2FloatW t5 = _mm256_unpackhi_ps( b4, b5 );
+	b2FloatW t6 = _mm256_unpacklo_ps( b6, b7 );
+	b2FloatW t7 = _mm256_unpackhi_ps( b6, b7 );
+	b2FloatW tt0 = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+	b2FloatW tt1 = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+	b2FloatW tt2 = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+	b2FloatW tt3 = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+	b2FloatW tt4 = _mm256_shuffle_ps( t4, t6, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+	b2FloatW tt5 = _mm256_shuffle_ps( t4, t6, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+	b2FloatW tt6 = _mm256_shuffle_ps( t5, t7, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+	b2FloatW tt7 = _mm256_shuffle_ps( t5, t7, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+
+	b2BodyStateW simdBody;
+	simdBody.v.X = _mm256_permute2f128_ps( tt0, tt4, 0x20 );
+	simdBody.v.Y = _mm256_permute2f128_ps( tt1, tt5, 0x20 );
+	simdBody.w = _mm256_permute2f128_ps( tt2, tt6, 0x20 );
+	simdBody.flags = _mm256_permute2f128_ps( tt3, tt7, 0x20 );
+	simdBody.dp.X = _mm256_permute2f128_ps( tt0, tt4, 0x31 );
+	simdBody.dp.Y = _mm256_permute2f128_ps( tt1, tt5, 0x31 );
+	simdBody.dq.C = _mm256_permute2f128_ps( tt2, tt6, 0x31 );
+	simdBody.dq.S = _mm256_permute2f128_ps( tt3, tt7, 0x31 );
+	return simdBody;
+}
+
+// Only the velocity half of the body state. Warm starting and restitution do not use the
+// delta position and rotation. Two bodies share each 256-bit register, so this is a 4x4 transpose
+// in each 128-bit lane.
+static inline b2BodyStateW b2GatherVelocities( const b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices )
+{
+	_Static_assert( sizeof( b2BodyState ) == 32, "b2BodyState not 32 bytes" );
+	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
+
+	// zero means null
+	int i1 = indices[0] - 1;
+	int i2 = indices[1] - 1;
+	int i3 = indices[2] - 1;
+	int i4 = indices[3] - 1;
+	int i5 = indices[4] - 1;
+	int i6 = indices[5] - 1;
+	int i7 = indices[6] - 1;
+	int i8 = indices[7] - 1;
+
+	// [vx vy w flags]
+	__m128 identity = _mm_setzero_ps();
+	__m128 b0 = i1 == B2_NULL_INDEX ? identity : _mm_load_ps( (float*)( states + i1 ) );
+	__m128 b1 = i2 == B2_NULL_INDEX ? identity : _mm_load_ps( (float*)( states + i2 ) );
+	__m128 b2 = i3 == B2_NULL_INDEX ? identity : _mm_load_ps( (float*)( states + i3 ) );
+	__m128 b3 = i4 == B2_NULL_INDEX ? identity : _mm_load_ps( (float*)( states + i4 ) );
+	__m128 b4 = i5 == B2_NULL_INDEX ? identity : _mm_load_ps( (float*)( states + i5 ) );
+	__m128 b5 = i6 == B2_NULL_INDEX ? identity : _mm_load_ps( (float*)( states + i6 ) );
+	__m128 b6 = i7 == B2_NULL_INDEX ? identity : _mm_load_ps( (float*)( states + i7 ) );
+	__m128 b7 = i8 == B2_NULL_INDEX ? identity : _mm_load_ps( (float*)( states + i8 ) );
+
+	b2FloatW b04 = _mm256_insertf128_ps( _mm256_castps128_ps256( b0 ), b4, 1 );
+	b2FloatW b15 = _mm256_insertf128_ps( _mm256_castps128_ps256( b1 ), b5, 1 );
+	b2FloatW b26 = _mm256_insertf128_ps( _mm256_castps128_ps256( b2 ), b6, 1 );
+	b2FloatW b37 = _mm256_insertf128_ps( _mm256_castps128_ps256( b3 ), b7, 1 );
+
+	b2FloatW t0 = _mm256_unpacklo_ps( b04, b15 );
+	b2FloatW t1 = _mm256_unpackhi_ps( b04, b15 );
+	b2FloatW t2 = _mm256_unpacklo_ps( b26, b37 );
+	b2FloatW t3 = _mm256_unpackhi_ps( b26, b37 );
+
+	b2FloatW zero = _mm256_setzero_ps();
+
+	b2BodyStateW simdBody;
+	simdBody.v.X = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+	simdBody.v.Y = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+	simdBody.w = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+	simdBody.flags = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+	simdBody.dp = (b2Vec2W){ zero, zero };
+	simdBody.dq = (b2RotW){ _mm256_set1_ps( 1.0f ), zero };
+	return simdBody;
+}
+
+// This writes only the velocities back to the solver bodies. The delta position and rotation never
+// change in the solver, so this stores the 16 byte velocity half of each body.
+static inline void b2ScatterBodies( b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices, const b2BodyStateW* B2_RESTRICT simdBody )
+{
+	_Static_assert( sizeof( b2BodyState ) == 32, "b2BodyState not 32 bytes" );
+	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
+
+	// [vx0 vy0 vx1 vy1 | vx4 vy4 vx5 vy5]
+	b2FloatW t0 = _mm256_unpacklo_ps( simdBody->v.X, simdBody->v.Y );
+	// [vx2 vy2 vx3 vy3 | vx6 vy6 vx7 vy7]
+	b2FloatW t1 = _mm256_unpackhi_ps( simdBody->v.X, simdBody->v.Y );
+	// [w0 f0 w1 f1 | w4 f4 w5 f5]
+	b2FloatW t2 = _mm256_unpacklo_ps( simdBody->w, simdBody->flags );
+	// [w2 f2 w3 f3 | w6 f6 w7 f7]
+	b2FloatW t3 = _mm256_unpackhi_ps( simdBody->w, simdBody->flags );
+
+	// [body0 | body4], [body1 | body5], [body2 | body6], [body3 | body7]
+	b2FloatW r0 = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+	b2FloatW r1 = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+	b2FloatW r2 = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+	b2FloatW r3 = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+
+	// I don't use any dummy body in the body array because this will lead to multithreaded sharing and the
+	// associated cache flushing.
+
+	// zero means null
+	int i1 = indices[0] - 1;
+	int i2 = indices[1] - 1;
+	int i3 = indices[2] - 1;
+	int i4 = indices[3] - 1;
+	int i5 = indices[4] - 1;
+	int i6 = indices[5] - 1;
+	int i7 = indices[6] - 1;
+	int i8 = indices[7] - 1;
+
+	if ( i1 != B2_NULL_INDEX && ( states[i1].flags & b2_dynamicFlag ) != 0 )
+		_mm_store_ps( (float*)( states + i1 ), _mm256_castps256_ps128( r0 ) );
+	if ( i2 != B2_NULL_INDEX && ( states[i2].flags & b2_dynamicFlag ) != 0 )
+		_mm_store_ps( (float*)( states + i2 ), _mm256_castps256_ps128( r1 ) );
+	if ( i3 != B2_NULL_INDEX && ( states[i3].flags & b2_dynamicFlag ) != 0 )
+		_mm_store_ps( (float*)( states + i3 ), _mm256_castps256_ps128( r2 ) );
+	if ( i4 != B2_NULL_INDEX && ( states[i4].flags & b2_dynamicFlag ) != 0 )
+		_mm_store_ps( (float*)( states + i4 ), _mm256_castps256_ps128( r3 ) );
+	if ( i5 != B2_NULL_INDEX && ( states[i5].flags & b2_dynamicFlag ) != 0 )
+		_mm_store_ps( (float*)( states + i5 ), _mm256_extractf128_ps( r0, 1 ) );
+	if ( i6 != B2_NULL_INDEX && ( states[i6].flags & b2_dynamicFlag ) != 0 )
+		_mm_store_ps( (float*)( states + i6 ), _mm256_extractf128_ps( r1, 1 ) );
+	if ( i7 != B2_NULL_INDEX && ( states[i7].flags & b2_dynamicFlag ) != 0 )
+		_mm_store_ps( (float*)( states + i7 ), _mm256_extractf128_ps( r2, 1 ) );
+	if ( i8 != B2_NULL_INDEX && ( states[i8].flags & b2_dynamicFlag ) != 0 )
+		_mm_store_ps( (float*)( states + i8 ), _mm256_extractf128_ps( r3, 1 ) );
+}
+
+#elif defined( B2_SIMD_NEON )
+
+// This is a load and transpose
+static inline b2BodyStateW b2GatherBodies( const b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices )
+{
+	_Static_assert( sizeof( b2BodyState ) == 32, "b2BodyState not 32 bytes" );
+	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
+
+	// [vx vy w flags]
+	b2FloatW identityA = b2ZeroW();
+
+	// [dpx dpy dqc dqs]
+
+	b2FloatW identityB = b2SetW( 0.0f, 0.0f, 1.0f, 0.0f );
+
+	// zero means null
+	int i1 = indices[0] - 1;
+	int i2 = indices[1] - 1;
+	int i3 = indices[2] - 1;
+	int i4 = indices[3] - 1;
+
+	b2FloatW b1a = i1 == B2_NULL_INDEX ? identityA : b2LoadW( (float*)( states + i1 ) + 0 );
+	b2FloatW b1b = i1 == B2_NULL_INDEX ? identityB : b2LoadW( (float*)( states + i1 ) + 4 );
+	b2FloatW b2a = i2 == B2_NULL_INDEX ? identityA : b2LoadW( (float*)( states + i2 ) + 0 );
+	b2FloatW b2b = i2 == B2_NULL_INDEX ? identityB : b2LoadW( (float*)( states + i2 ) + 4 );
+	b2FloatW b3a = i3 == B2_NULL_INDEX ? identityA : b2LoadW( (float*)( states + i3 ) + 0 );
+	b2FloatW b3b = i3 == B2_NULL_INDEX ? identityB : b2LoadW( (float*)( states + i3 ) + 4 );
+	b2FloatW b4a = i4 == B2_NULL_INDEX ? identityA : b2LoadW( (float*)( states + i4 ) + 0 );
+	b2FloatW b4b = i4 == B2_NULL_INDEX ? identityB : b2LoadW( (float*)( states + i4 ) + 4 );
+
+	// [vx1 vx3 vy1 vy3]
+	b2FloatW t1a = b2UnpackLoW( b1a, b3a );
+
+	// [vx2 vx4 vy2 vy4]
+	b2FloatW t2a = b2UnpackLoW( b2a, b4a );
+
+	// [w1 w3 f1 f3]
+	b2FloatW t3a = b2UnpackHiW( b1a, b3a );
+
+	// [w2 w4 f2 f4]
+	b2FloatW t4a = b2UnpackHiW( b2a, b4a );
+
+	b2BodyStateW simdBody;
+	simdBody.v.X = b2UnpackLoW( t1a, t2a );
+	simdBody.v.Y = b2UnpackHiW( t1a, t2a );
+	simdBody.w = b2UnpackLoW( t3a, t4a );
+	simdBody.flags = b2UnpackHiW( t3a, t4a );
+
+	b2FloatW t1b = b2UnpackLoW( b1b, b3b );
+	b2FloatW t2b = b2UnpackLoW( b2b, b4b );
+	b2FloatW t3b = b2UnpackHiW( b1b, b3b );
+	b2FloatW t4b = b2UnpackHiW( b2b, b4b );
+
+	simdBody.dp.X = b2UnpackLoW( t1b, t2b );
+	simdBody.dp.Y = b2UnpackHiW( t1b, t2b );
+	simdBody.dq.C = b2UnpackLoW( t3b, t4b );
+	simdBody.dq.S = b2UnpackHiW( t3b, t4b );
+
+	return simdBody;
+}
+
+// Only the velocity half of the body state. Warm starting and restitution do not use the
+// delta position and rotation, so this skips half of the loads and shuffles.
+static inline b2BodyStateW b2GatherVelocities( const b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices )
+{
+	_Static_assert( sizeof( b2BodyState ) == 32, "b2BodyState not 32 bytes" );
+	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
+
+	// [vx vy w flags]
+	b2FloatW identity = b2ZeroW();
+
+	// zero means null
+	int i1 = indices[0] - 1;
+	int i2 = indices[1] - 1;
+	int i3 = indices[2] - 1;
+	int i4 = indices[3] - 1;
+
+	b2FloatW b1 = i1 == B2_NULL_INDEX ? identity : b2LoadW( (float*)( states + i1 ) );
+	b2FloatW b2 = i2 == B2_NULL_INDEX ? identity : b2LoadW( (float*)( states + i2 ) );
+	b2FloatW b3 = i3 == B2_NULL_INDEX ? identity : b2LoadW( (float*)( states + i3 ) );
+	b2FloatW b4 = i4 == B2_NULL_INDEX ? identity : b2LoadW( (float*)( states + i4 ) );
+
+	// [vx1 vx3 vy1 vy3]
+	b2FloatW t1 = b2UnpackLoW( b1, b3 );
+
+	// [vx2 vx4 vy2 vy4]
+	b2FloatW t2 = b2UnpackLoW( b2, b4 );
+
+	// [w1 w3 f1 f3]
+	b2FloatW t3 = b2UnpackHiW( b1, b3 );
+
+	// [w2 w4 f2 f4]
+	b2FloatW t4 = b2UnpackHiW( b2, b4 );
+
+	b2BodyStateW simdBody;
+	simdBody.v.X = b2UnpackLoW( t1, t2 );
+	simdBody.v.Y = b2UnpackHiW( t1, t2 );
+	simdBody.w = b2UnpackLoW( t3, t4 );
+	simdBody.flags = b2UnpackHiW( t3, t4 );
+	simdBody.dp = (b2Vec2W){ identity, identity };
+	simdBody.dq = (b2RotW){ b2SplatW( 1.0f ), identity };
+	return simdBody;
+}
+
+// This writes only the velocities back to the solver bodies
+// https://developer.arm.com/documentation/102107a/0100/Floating-point-4x4-matrix-transposition
+static inline void b2ScatterBodies( b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices, const b2BodyStateW* B2_RESTRICT simdBody )
+{
+	_Static_assert( sizeof( b2BodyState ) == 32, "b2BodyState not 32 bytes" );
+	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
+
+	//	b2FloatW x = b2SetW(0.0f, 1.0f, 2.0f, 3.0f);
+	//	b2FloatW y = b2SetW(4.0f, 5.0f, 6.0f, 7.0f);
+	//	b2FloatW z = b2SetW(8.0f, 9.0f, 10.0f, 11.0f);
+	//	b2FloatW w = b2SetW(12.0f, 13.0f, 14.0f, 15.0f);
+	//
+	//	float32x4x2_t rr1 = vtrnq_f32( x, y );
+	//	float32x4x2_t rr2 = vtrnq_f32( z, w );
+	//
+	//	float32x4_t b1 = vcombine_f32(vget_low_f32(rr1.val[0]), vget_low_f32(rr2.val[0]));
+	//	float32x4_t b2 = vcombine_f32(vget_low_f32(rr1.val[1]), vget_low_f32(rr2.val[1]));
+	//	float32x4_t b3 = vcombine_f32(vget_high_f32(rr1.val[0]), vget_high_f32(rr2.val[0]));
+	//	float32x4_t b4 = vcombine_f32(vget_high_f32(rr1.val[1]), vget_high_f32(rr2.val[1]));
+
+	// transpose
+	float32x4x2_t r1 = vtrnq_f32( simdBody->v.X, simdBody->v.Y );
+	float32x4x2_t r2 = vtrnq_f32( simdBody->w, simdBody->flags );
+
+	// zero means null
+	int i1 = indices[0] - 1;
+	int i2 = indices[1] - 1;
+	int i3 = indices[2] - 1;
+	int i4 = indices[3] - 1;
+
+	// I don't use any dummy body in the body array because this will lead to multithreaded sharing and the
+	// associated cache flushing.
+	if ( i1 != B2_NULL_INDEX && ( states[i1].flags & b2_dynamicFlag ) != 0 )
+	{
+		float32x4_t body1 = vcombine_f32( vget_low_f32( r1.val[0] ), vget_low_f32( r2.val[0] ) );
+		b2StoreW( (float*)( states + i1 ), body1 );
+	}
+
+	if ( i2 != B2_NULL_INDEX && ( states[i2].flags & b2_dynamicFlag ) != 0 )
+	{
+		float32x4_t body2 = vcombine_f32( vget_low_f32( r1.val[1] ), vget_low_f32( r2.val[1] ) );
+		b2StoreW( (float*)( states + i2 ), body2 );
+	}
+
+	if ( i3 != B2_NULL_INDEX && ( states[i3].flags & b2_dynamicFlag ) != 0 )
+	{
+		float32x4_t body3 = vcombine_f32( vget_high_f32( r1.val[0] ), vget_high_f32( r2.val[0] ) );
+		b2StoreW( (float*)( states + i3 ), body3 );
+	}
+
+	if ( i4 != B2_NULL_INDEX && ( states[i4].flags & b2_dynamicFlag ) != 0 )
+	{
+		float32x4_t body4 = vcombine_f32( vget_high_f32( r1.val[1] ), vget_high_f32( r2.val[1] ) );
+		b2StoreW( (float*)( states + i4 ), body4 );
+	}
+}
+
+#elif defined( B2_SIMD_SSE2 )
+
+// This is a load and transpose
+static inline b2BodyStateW b2GatherBodies( const b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices )
+{
+	_Static_assert( sizeof( b2BodyState ) == 32, "b2BodyState not 32 bytes" );
+	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
+	B2_VALIDATE( indices[0] >= 0 && indices[1] >= 0 && indices[2] >= 0 && indices[3] >= 0 );
+
+	// [vx vy w flags]
+	b2FloatW identityA = b2ZeroW();
+
+	// [dpx dpy dqc dqs]
+	b2FloatW identityB = b2SetW( 0.0f, 0.0f, 1.0f, 0.0f );
+
+	// zero means null
+	int i1 = indices[0] - 1;
+	int i2 = indices[1] - 1;
+	int i3 = indices[2] - 1;
+	int i4 = indices[3] - 1;
+
+	b2FloatW b1a = i1 == B2_NULL_INDEX ? identityA : b2LoadW( (float*)( states + i1 ) + 0 );
+	b2FloatW b1b = i1 == B2_NULL_INDEX ? identityB : b2LoadW( (float*)( states + i1 ) + 4 );
+	b2FloatW b2a = i2 == B2_NULL_INDEX ? identityA : b2LoadW( (float*)( states + i2 ) + 0 );
+	b2FloatW b2b = i2 == B2_NULL_INDEX ? identityB : b2LoadW( (float*)( states + i2 ) + 4 );
+	b2FloatW b3a = i3 == B2_NULL_INDEX ? identityA : b2LoadW( (float*)( states + i3 ) + 0 );
+	b2FloatW b3b = i3 == B2_NULL_INDEX ? identityB : b2LoadW( (float*)( states + i3 ) + 4 );
+	b2FloatW b4a = i4 == B2_NULL_INDEX ? identityA : b2LoadW( (float*)( states + i4 ) + 0 );
+	b2FloatW b4b = i4 == B2_NULL_INDEX ? identityB : b2LoadW( (float*)( states + i4 ) + 4 );
+
+	// [vx1 vx3 vy1 vy3]
+	b2FloatW t1a = b2UnpackLoW( b1a, b3a );
+
+	// [vx2 vx4 vy2 vy4]
+	b2FloatW t2a = b2UnpackLoW( b2a, b4a );
+
+	// [w1 w3 f1 f3]
+	b2FloatW t3a = b2UnpackHiW( b1a, b3a );
+
+	// [w2 w4 f2 f4]
+	b2FloatW t4a = b2UnpackHiW( b2a, b4a );
+
+	b2BodyStateW simdBody;
+	simdBody.v.X = b2UnpackLoW( t1a, t2a );
+	simdBody.v.Y = b2UnpackHiW( t1a, t2a );
+	simdBody.w = b2UnpackLoW( t3a, t4a );
+	simdBody.flags = b2UnpackHiW( t3a, t4a );
+
+	b2FloatW t1b = b2UnpackLoW( b1b, b3b );
+	b2FloatW t2b = b2UnpackLoW( b2b, b4b );
+	b2FloatW t3b = b2UnpackHiW( b1b, b3b );
+	b2FloatW t4b = b2UnpackHiW( b2b, b4b );
+
+	simdBody.dp.X = b2UnpackLoW( t1b, t2b );
+	simdBody.dp.Y = b2UnpackHiW( t1b, t2b );
+	simdBody.dq.C = b2UnpackLoW( t3b, t4b );
+	simdBody.dq.S = b2UnpackHiW( t3b, t4b );
+
+	return simdBody;
+}
+
+// Only the velocity half of the body state. Warm starting and restitution do not use the
+// delta position and rotation, so this skips half of the loads and shuffles.
+static inline b2BodyStateW b2GatherVelocities( const b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices )
+{
+	_Static_assert( sizeof( b2BodyState ) == 32, "b2BodyState not 32 bytes" );
+	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
+	B2_VALIDATE( indices[0] >= 0 && indices[1] >= 0 && indices[2] >= 0 && indices[3] >= 0 );
+
+	// [vx vy w flags]
+	b2FloatW identity = b2ZeroW();
+
+	// zero means null
+	int i1 = indices[0] - 1;
+	int i2 = indices[1] - 1;
+	int i3 = indices[2] - 1;
+	int i4 = indices[3] - 1;
+
+	b2FloatW b1 = i1 == B2_NULL_INDEX ? identity : b2LoadW( (float*)( states + i1 ) );
+	b2FloatW b2 = i2 == B2_NULL_INDEX ? identity : b2LoadW( (float*)( states + i2 ) );
+	b2FloatW b3 = i3 == B2_NULL_INDEX ? identity : b2LoadW( (float*)( states + i3 ) );
+	b2FloatW b4 = i4 == B2_NULL_INDEX ? identity : b2LoadW( (float*)( states + i4 ) );
+
+	// [vx1 vx3 vy1 vy3]
+	b2FloatW t1 = b2UnpackLoW( b1, b3 );
+
+	// [vx2 vx4 vy2 vy4]
+	b2FloatW t2 = b2UnpackLoW( b2, b4 );
+
+	// [w1 w3 f1 f3]
+	b2FloatW t3 = b2UnpackHiW( b1, b3 );
+
+	// [w2 w4 f2 f4]
+	b2FloatW t4 = b2UnpackHiW( b2, b4 );
+
+	b2BodyStateW simdBody;
+	simdBody.v.X = b2UnpackLoW( t1, t2 );
+	simdBody.v.Y = b2UnpackHiW( t1, t2 );
+	simdBody.w = b2UnpackLoW( t3, t4 );
+	simdBody.flags = b2UnpackHiW( t3, t4 );
+	simdBody.dp = (b2Vec2W){ identity, identity };
+	simdBody.dq = (b2RotW){ b2SplatW( 1.0f ), identity };
+	return simdBody;
+}
+
+// This writes only the velocities back to the solver bodies
+static inline void b2ScatterBodies( b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices, const b2BodyStateW* B2_RESTRICT simdBody )
+{
+	_Static_assert( sizeof( b2BodyState ) == 32, "b2BodyState not 32 bytes" );
+	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
+	B2_VALIDATE( indices[0] >= 0 && indices[1] >= 0 && indices[2] >= 0 && indices[3] >= 0 );
+
+	// [vx1 vy1 vx2 vy2]
+	b2FloatW t1 = b2UnpackLoW( simdBody->v.X, simdBody->v.Y );
+	// [vx3 vy3 vx4 vy4]
+	b2FloatW t2 = b2UnpackHiW( simdBody->v.X, simdBody->v.Y );
+	// [w1 f1 w2 f2]
+	b2FloatW t3 = b2UnpackLoW( simdBody->w, simdBody->flags );
+	// [w3 f3 w4 f4]
+	b2FloatW t4 = b2UnpackHiW( simdBody->w, simdBody->flags );
+
+	// zero means null
+	int i1 = indices[0] - 1;
+	int i2 = indices[1] - 1;
+	int i3 = indices[2] - 1;
+	int i4 = indices[3] - 1;
+
+#if 1
+	// I don't use any dummy body in the body array because this will lead to multithreaded cache coherence problems.
+	if ( i1 != B2_NULL_INDEX && ( states[i1].flags & b2_dynamicFlag ) != 0 )
+	{
+		// [t1.x t1.y t3.x t3.y]
+		b2StoreW( (float*)( states + i1 ), _mm_shuffle_ps( t1, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) ) );
+	}
+
+	if ( i2 != B2_NULL_INDEX && ( states[i2].flags & b2_dynamicFlag ) != 0 )
+	{
+		// [t1.z t1.w t3.z t3.w]
+		b2StoreW( (float*)( states + i2 ), _mm_shuffle_ps( t1, t3, _MM_SHUFFLE( 3, 2, 3, 2 ) ) );
+	}
+
+	if ( i3 != B2_NULL_INDEX && ( states[i3].flags & b2_dynamicFlag ) != 0 )
+	{
+		// [t2.x t2.y t4.x t4.y]
+		b2StoreW( (float*)( states + i3 ), _mm_shuffle_ps( t2, t4, _MM_SHUFFLE( 1, 0, 1, 0 ) ) );
+	}
+
+	if ( i4 != B2_NULL_INDEX && ( states[i4].flags & b2_dynamicFlag ) != 0 )
+	{
+		// [t2.z t2.w t4.z t4.w]
+		b2StoreW( (float*)( states + i4 ), _mm_shuffle_ps( t2, t4, _MM_SHUFFLE( 3, 2, 3, 2 ) ) );
+	}
+
+#else
+
+	// todo_testing this is here to test the impact of unsafe writes
+
+	if ( i1 != B2_NULL_INDEX )
+	{
+		// [t1.x t1.y t3.x t3.y]
+		b2StoreW( (float*)( states + i1 ), _mm_shuffle_ps( t1, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) ) );
+	}
+
+	if ( i2 != B2_NULL_INDEX )
+	{
+		// [t1.z t1.w t3.z t3.w]
+		b2StoreW( (float*)( states + i2 ), _mm_shuffle_ps( t1, t3, _MM_SHUFFLE( 3, 2, 3, 2 ) ) );
+	}
+
+	if ( i3 != B2_NULL_INDEX )
+	{
+		// [t2.x t2.y t4.x t4.y]
+		b2StoreW( (float*)( states + i3 ), _mm_shuffle_ps( t2, t4, _MM_SHUFFLE( 1, 0, 1, 0 ) ) );
+	}
+
+	if ( i4 != B2_NULL_INDEX )
+	{
+		// [t2.z t2.w t4.z t4.w]
+		b2StoreW( (float*)( states + i4 ), _mm_shuffle_ps( t2, t4, _MM_SHUFFLE( 3, 2, 3, 2 ) ) );
+	}
+
+#endif
+}
+
+#elif defined( B2_SIMD_WASM )
+
+// The same load and transpose as SSE2, written with the wasm shuffles
+static inline b2BodyStateW b2GatherBodies( const b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices )
+{
+	_Static_assert( sizeof( b2BodyState ) == 32, "b2BodyState not 32 bytes" );
+	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
+	B2_VALIDATE( indices[0] >= 0 && indices[1] >= 0 && indices[2] >= 0 && indices[3] >= 0 );
+
+	// [vx vy w flags]
+	b2FloatW identityA = b2ZeroW();
+
+	// [dpx dpy dqc dqs]
+	b2FloatW identityB = b2SetW( 0.0f, 0.0f, 1.0f, 0.0f );
+
+	// zero means null
+	int i1 = indices[0] - 1;
+	int i2 = indices[1] - 1;
+	int i3 = indices[2] - 1;
+	int i4 = indices[3] - 1;
+
+	b2FloatW b1a = i1 == B2_NULL_INDEX ? identityA : b2LoadW( (float*)( states + i1 ) + 0 );
+	b2FloatW b1b = i1 == B2_NULL_INDEX ? identityB : b2LoadW( (float*)( states + i1 ) + 4 );
+	b2FloatW b2a = i2 == B2_NULL_INDEX ? identityA : b2LoadW( (float*)( states + i2 ) + 0 );
+	b2FloatW b2b = i2 == B2_NULL_INDEX ? identityB : b2LoadW( (float*)( states + i2 ) + 4 );
+	b2FloatW b3a = i3 == B2_NULL_INDEX ? identityA : b2LoadW( (float*)( states + i3 ) + 0 );
+	b2FloatW b3b = i3 == B2_NULL_INDEX ? identityB : b2LoadW( (float*)( states + i3 ) + 4 );
+	b2FloatW b4a = i4 == B2_NULL_INDEX ? identityA : b2LoadW( (float*)( states + i4 ) + 0 );
+	b2FloatW b4b = i4 == B2_NULL_INDEX ? identityB : b2LoadW( (float*)( states + i4 ) + 4 );
+
+	// [vx1 vx3 vy1 vy3] [vx2 vx4 vy2 vy4] [w1 w3 f1 f3] [w2 w4 f2 f4]
+	b2FloatW t1a = b2UnpackLoW( b1a, b3a );
+	b2FloatW t2a = b2UnpackLoW( b2a, b4a );
+	b2FloatW t3a = b2UnpackHiW( b1a, b3a );
+	b2FloatW t4a = b2UnpackHiW( b2a, b4a );
+
+	b2BodyStateW simdBody;
+	simdBody.v.X = b2UnpackLoW( t1a, t2a );
+	simdBody.v.Y = b2UnpackHiW( t1a, t2a );
+	simdBody.w = b2UnpackLoW( t3a, t4a );
+	simdBody.flags = b2UnpackHiW( t3a, t4a );
+
+	b2FloatW t1b = b2UnpackLoW( b1b, b3b );
+	b2FloatW t2b = b2UnpackLoW( b2b, b4b );
+	b2FloatW t3b = b2UnpackHiW( b1b, b3b );
+	b2FloatW t4b = b2UnpackHiW( b2b, b4b );
+
+	simdBody.dp.X = b2UnpackLoW( t1b, t2b );
+	simdBody.dp.Y = b2UnpackHiW( t1b, t2b );
+	simdBody.dq.C = b2UnpackLoW( t3b, t4b );
+	simdBody.dq.S = b2UnpackHiW( t3b, t4b );
+
+	return simdBody;
+}
+
+// Only the velocity half of the body state
+static inline b2BodyStateW b2GatherVelocities( const b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices )
+{
+	_Static_assert( sizeof( b2BodyState ) == 32, "b2BodyState not 32 bytes" );
+	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
+	B2_VALIDATE( indices[0] >= 0 && indices[1] >= 0 && indices[2] >= 0 && indices[3] >= 0 );
+
+	// [vx vy w flags]
+	b2FloatW identity = b2ZeroW();
+
+	// zero means null
+	int i1 = indices[0] - 1;
+	int i2 = indices[1] - 1;
+	int i3 = indices[2] - 1;
+	int i4 = indices[3] - 1;
+
+	b2FloatW b1 = i1 == B2_NULL_INDEX ? identity : b2LoadW( (float*)( states + i1 ) );
+	b2FloatW b2 = i2 == B2_NULL_INDEX ? identity : b2LoadW( (float*)( states + i2 ) );
+	b2FloatW b3 = i3 == B2_NULL_INDEX ? identity : b2LoadW( (float*)( states + i3 ) );
+	b2FloatW b4 = i4 == B2_NULL_INDEX ? identity : b2LoadW( (float*)( states + i4 ) );
+
+	b2FloatW t1 = b2UnpackLoW( b1, b3 );
+	b2FloatW t2 = b2UnpackLoW( b2, b4 );
+	b2FloatW t3 = b2UnpackHiW( b1, b3 );
+	b2FloatW t4 = b2UnpackHiW( b2, b4 );
+
+	b2BodyStateW simdBody;
+	simdBody.v.X = b2UnpackLoW( t1, t2 );
+	simdBody.v.Y = b2UnpackHiW( t1, t2 );
+	simdBody.w = b2UnpackLoW( t3, t4 );
+	simdBody.flags = b2UnpackHiW( t3, t4 );
+	simdBody.dp = (b2Vec2W){ identity, identity };
+	simdBody.dq = (b2RotW){ b2SplatW( 1.0f ), identity };
+	return simdBody;
+}
+
+// This writes only the velocities back to the solver bodies
+static inline void b2ScatterBodies( b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices, const b2BodyStateW* B2_RESTRICT simdBody )
+{
+	_Static_assert( sizeof( b2BodyState ) == 32, "b2BodyState not 32 bytes" );
+	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
+	B2_VALIDATE( indices[0] >= 0 && indices[1] >= 0 && indices[2] >= 0 && indices[3] >= 0 );
+
+	// [vx1 vy1 vx2 vy2]
+	b2FloatW t1 = b2UnpackLoW( simdBody->v.X, simdBody->v.Y );
+	// [vx3 vy3 vx4 vy4]
+	b2FloatW t2 = b2UnpackHiW( simdBody->v.X, simdBody->v.Y );
+	// [w1 f1 w2 f2]
+	b2FloatW t3 = b2UnpackLoW( simdBody->w, simdBody->flags );
+	// [w3 f3 w4 f4]
+	b2FloatW t4 = b2UnpackHiW( simdBody->w, simdBody->flags );
+
+	// zero means null
+	int i1 = indices[0] - 1;
+	int i2 = indices[1] - 1;
+	int i3 = indices[2] - 1;
+	int i4 = indices[3] - 1;
+
+	if ( i1 != B2_NULL_INDEX && ( states[i1].flags & b2_dynamicFlag ) != 0 )
+	{
+		// [t1.x t1.y t3.x t3.y]
+		b2StoreW( (float*)( states + i1 ), wasm_i64x2_shuffle( t1, t3, 0, 2 ) );
+	}
+
+	if ( i2 != B2_NULL_INDEX && ( states[i2].flags & b2_dynamicFlag ) != 0 )
+	{
+		// [t1.z t1.w t3.z t3.w]
+		b2StoreW( (float*)( states + i2 ), wasm_i64x2_shuffle( t1, t3, 1, 3 ) );
+	}
+
+	if ( i3 != B2_NULL_INDEX && ( states[i3].flags & b2_dynamicFlag ) != 0 )
+	{
+		// [t2.x t2.y t4.x t4.y]
+		b2StoreW( (float*)( states + i3 ), wasm_i64x2_shuffle( t2, t4, 0, 2 ) );
+	}
+
+	if ( i4 != B2_NULL_INDEX && ( states[i4].flags & b2_dynamicFlag ) != 0 )
+	{
+		// [t2.z t2.w t4.z t4.w]
+		b2StoreW( (float*)( states + i4 ), wasm_i64x2_shuffle( t2, t4, 1, 3 ) );
+	}
+}
+
+#else
+
+// This is a load and transpose
+static inline b2BodyStateW b2GatherBodies( const b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices )
+{
+	B2_VALIDATE( indices[0] >= 0 && indices[1] >= 0 && indices[2] >= 0 && indices[3] >= 0 );
+
+	b2BodyState identity = b2_identityBodyState;
+
+	// zero means null
+	int i1 = indices[0] - 1;
+	int i2 = indices[1] - 1;
+	int i3 = indices[2] - 1;
+	int i4 = indices[3] - 1;
+
+	b2BodyState s1 = i1 == B2_NULL_INDEX ? identity : states[i1];
+	b2BodyState s2 = i2 == B2_NULL_INDEX ? identity : states[i2];
+	b2BodyState s3 = i3 == B2_NULL_INDEX ? identity : states[i3];
+	b2BodyState s4 = i4 == B2_NULL_INDEX ? identity : states[i4];
+
+	b2BodyStateW simdBody;
+	simdBody.v.X = (b2FloatW){ s1.linearVelocity.x, s2.linearVelocity.x, s3.linearVelocity.x, s4.linearVelocity.x };
+	simdBody.v.Y = (b2FloatW){ s1.linearVelocity.y, s2.linearVelocity.y, s3.linearVelocity.y, s4.linearVelocity.y };
+	simdBody.w = (b2FloatW){ s1.angularVelocity, s2.angularVelocity, s3.angularVelocity, s4.angularVelocity };
+	simdBody.flags = (b2FloatW){ (float)s1.flags, (float)s2.flags, (float)s3.flags, (float)s4.flags };
+	simdBody.dp.X = (b2FloatW){ s1.deltaPosition.x, s2.deltaPosition.x, s3.deltaPosition.x, s4.deltaPosition.x };
+	simdBody.dp.Y = (b2FloatW){ s1.deltaPosition.y, s2.deltaPosition.y, s3.deltaPosition.y, s4.deltaPosition.y };
+	simdBody.dq.C = (b2FloatW){ s1.deltaRotation.c, s2.deltaRotation.c, s3.deltaRotation.c, s4.deltaRotation.c };
+	simdBody.dq.S = (b2FloatW){ s1.deltaRotation.s, s2.deltaRotation.s, s3.deltaRotation.s, s4.deltaRotation.s };
+
+	return simdBody;
+}
+
+// Only the velocity half of the body state. Warm starting and restitution do not use the
+// delta position and rotation.
+static inline b2BodyStateW b2GatherVelocities( const b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices )
+{
+	B2_VALIDATE( indices[0] >= 0 && indices[1] >= 0 && indices[2] >= 0 && indices[3] >= 0 );
+
+	b2BodyState identity = b2_identityBodyState;
+
+	// zero means null
+	int i1 = indices[0] - 1;
+	int i2 = indices[1] - 1;
+	int i3 = indices[2] - 1;
+	int i4 = indices[3] - 1;
+
+	const b2BodyState* s1 = i1 == B2_NULL_INDEX ? &identity : states + i1;
+	const b2BodyState* s2 = i2 == B2_NULL_INDEX ? &identity : states + i2;
+	const b2BodyState* s3 = i3 == B2_NULL_INDEX ? &identity : states + i3;
+	const b2BodyState* s4 = i4 == B2_NULL_INDEX ? &identity : states + i4;
+
+	b2BodyStateW simdBody;
+	simdBody.v.X = (b2FloatW){ s1->linearVelocity.x, s2->linearVelocity.x, s3->linearVelocity.x, s4->linearVelocity.x };
+	simdBody.v.Y = (b2FloatW){ s1->linearVelocity.y, s2->linearVelocity.y, s3->linearVelocity.y, s4->linearVelocity.y };
+	simdBody.w = (b2FloatW){ s1->angularVelocity, s2->angularVelocity, s3->angularVelocity, s4->angularVelocity };
+	simdBody.flags = (b2FloatW){ (float)s1->flags, (float)s2->flags, (float)s3->flags, (float)s4->flags };
+	simdBody.dp = (b2Vec2W){ b2ZeroW(), b2ZeroW() };
+	simdBody.dq = (b2RotW){ b2SplatW( 1.0f ), b2ZeroW() };
+	return simdBody;
+}
+
+// This writes only the velocities back to the solver bodies
+static inline void b2ScatterBodies( b2BodyState* B2_RESTRICT states, int* B2_RESTRICT indices, const b2BodyStateW* B2_RESTRICT simdBody )
+{
+	B2_VALIDATE( indices[0] >= 0 && indices[1] >= 0 && indices[2] >= 0 && indices[3] >= 0 );
+
+	// zero means null
+	int i1 = indices[0] - 1;
+	int i2 = indices[1] - 1;
+	int i3 = indices[2] - 1;
+	int i4 = indices[3] - 1;
+
+	if ( i1 != B2_NULL_INDEX && ( states[i1].flags & b2_dynamicFlag ) != 0 )
+	{
+		b2BodyState* state = states + i1;
+		state->linearVelocity.x = simdBody->v.X.x;
+		state->linearVelocity.y = simdBody->v.Y.x;
+		state->angularVelocity = simdBody->w.x;
+	}
+
+	if ( i2 != B2_NULL_INDEX && ( states[i2].flags & b2_dynamicFlag ) != 0 )
+	{
+		b2BodyState* state = states + i2;
+		state->linearVelocity.x = simdBody->v.X.y;
+		state->linearVelocity.y = simdBody->v.Y.y;
+		state->angularVelocity = simdBody->w.y;
+	}
+
+	if ( i3 != B2_NULL_INDEX && ( states[i3].flags & b2_dynamicFlag ) != 0 )
+	{
+		b2BodyState* state = states + i3;
+		state->linearVelocity.x = simdBody->v.X.z;
+		state->linearVelocity.y = simdBody->v.Y.z;
+		state->angularVelocity = simdBody->w.z;
+	}
+
+	if ( i4 != B2_NULL_INDEX && ( states[i4].flags & b2_dynamicFlag ) != 0 )
+	{
+		b2BodyState* state = states + i4;
+		state->linearVelocity.x = simdBody->v.X.w;
+		state->linearVelocity.y = simdBody->v.Y.w;
+		state->angularVelocity = simdBody->w.w;
+	}
+}
+
+#endif
+
+// Load and store of B2_SIMD_WIDTH consecutive body states for the body integration stages. The
+// store writes the whole state. The flags lanes must hold the gathered bits, so on the 4 and 8 wide
+// paths they are written back unchanged and the other paths skip them.
+static inline b2BodyStateW b2LoadBodyStates( const b2BodyState* B2_RESTRICT states )
+{
+	// zero means null
+	int indices[B2_SIMD_WIDTH];
+	for ( int i = 0; i < B2_SIMD_WIDTH; ++i )
+	{
+		indices[i] = i + 1;
+	}
+
+	return b2GatherBodies( states, indices );
+}
+
+#if defined( B2_SIMD_AVX512 )
+
+static inline void b2StoreBodyStates( b2BodyState* B2_RESTRICT states, const b2BodyStateW* B2_RESTRICT simdBody )
+{
+	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
+
+	// float offset of each body state, 8 floats per body
+	__m512i offset = _mm512_slli_epi32( _mm512_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 ), 3 );
+	float* base = (float*)states;
+
+	_mm512_i32scatter_ps( base + 0, offset, simdBody->v.X, 4 );
+	_mm512_i32scatter_ps( base + 1, offset, simdBody->v.Y, 4 );
+	_mm512_i32scatter_ps( base + 2, offset, simdBody->w, 4 );
+	_mm512_i32scatter_ps( base + 4, offset, simdBody->dp.X, 4 );
+	_mm512_i32scatter_ps( base + 5, offset, simdBody->dp.Y, 4 );
+	_mm512_i32scatter_ps( base + 6, offset, simdBody->dq.C, 4 );
+	_mm512_i32scatter_ps( base + 7, offset, simdBody->dq.S, 4 );
+}
+
+#elif defined( B2_SIMD_AVX2 )
+
+// The 8x8 transpose in b2GatherBodies is its own inverse
+static inline void b2StoreBodyStates( b2BodyState* B2_RESTRICT states, const b2BodyStateW* B2_RESTRICT simdBody )
+{
+	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
+
+	b2FloatW t0 = _mm256_unpacklo_ps( simdBody->v.X, simdBody->v.Y );
+	b2FloatW t1 = _mm256_unpackhi_ps( simdBody->v.X, simdBody->v.Y );
+	b2FloatW t2 = _mm256_unpacklo_ps( simdBody->w, simdBody->flags );
+	b2FloatW t3 = _mm256_unpackhi_ps( simdBody->w, simdBody->flags );
+	b2FloatW t4 = _mm256_unpacklo_ps( simdBody->dp.X, simdBody->dp.Y );
+	b2FloatW t5 = _mm256_unpackhi_ps( simdBody->dp.X, simdBody->dp.Y );
+	b2FloatW t6 = _mm256_unpacklo_ps( simdBody->dq.C, simdBody->dq.S );
+	b2FloatW t7 = _mm256_unpackhi_ps( simdBody->dq.C, simdBody->dq.S );
+	b2FloatW tt0 = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+	b2FloatW tt1 = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+	b2FloatW tt2 = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+	b2FloatW tt3 = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+	b2FloatW tt4 = _mm256_shuffle_ps( t4, t6, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+	b2FloatW tt5 = _mm256_shuffle_ps( t4, t6, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+	b2FloatW tt6 = _mm256_shuffle_ps( t5, t7, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+	b2FloatW tt7 = _mm256_shuffle_ps( t5, t7, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+
+	float* base = (float*)states;
+	_mm256_store_ps( base + 0, _mm256_permute2f128_ps( tt0, tt4, 0x20 ) );
+	_mm256_store_ps( base + 8, _mm256_permute2f128_ps( tt1, tt5, 0x20 ) );
+	_mm256_store_ps( base + 16, _mm256_permute2f128_ps( tt2, tt6, 0x20 ) );
+	_mm256_store_ps( base + 24, _mm256_permute2f128_ps( tt3, tt7, 0x20 ) );
+	_mm256_store_ps( base + 32, _mm256_permute2f128_ps( tt0, tt4, 0x31 ) );
+	_mm256_store_ps( base + 40, _mm256_permute2f128_ps( tt1, tt5, 0x31 ) );
+	_mm256_store_ps( base + 48, _mm256_permute2f128_ps( tt2, tt6, 0x31 ) );
+	_mm256_store_ps( base + 56, _mm256_permute2f128_ps( tt3, tt7, 0x31 ) );
+}
+
+#elif defined( B2_SIMD_NEON ) || defined( B2_SIMD_SSE2 ) || defined( B2_SIMD_WASM )
+
+// Two 4x4 transposes, the inverse of the ones in b2GatherBodies
+static inline void b2StoreBodyStates( b2BodyState* B2_RESTRICT states, const b2BodyStateW* B2_RESTRICT simdBody )
+{
+	B2_ASSERT( ( (uintptr_t)states & 0x1F ) == 0 );
+
+	float* base = (float*)states;
+
+	// [vx1 w1 vx2 w2]
+	b2FloatW t1a = b2UnpackLoW( simdBody->v.X, simdBody->w );
+
+	// [vy1 f1 vy2 f2]
+	b2FloatW t2a = b2UnpackLoW( simdBody->v.Y, simdBody->flags );
+
+	// [vx3 w3 vx4 w4]
+	b2FloatW t3a = b2UnpackHiW( simdBody->v.X, simdBody->w );
+
+	// [vy3 f3 vy4 f4]
+	b2FloatW t4a = b2UnpackHiW( simdBody->v.Y, simdBody->flags );
+
+	b2StoreW( base + 0, b2UnpackLoW( t1a, t2a ) );
+	b2StoreW( base + 8, b2UnpackHiW( t1a, t2a ) );
+	b2StoreW( base + 16, b2UnpackLoW( t3a, t4a ) );
+	b2StoreW( base + 24, b2UnpackHiW( t3a, t4a ) );
+
+	b2FloatW t1b = b2UnpackLoW( simdBody->dp.X, simdBody->dq.C );
+	b2FloatW t2b = b2UnpackLoW( simdBody->dp.Y, simdBody->dq.S );
+	b2FloatW t3b = b2UnpackHiW( simdBody->dp.X, simdBody->dq.C );
+	b2FloatW t4b = b2UnpackHiW( simdBody->dp.Y, simdBody->dq.S );
+
+	b2StoreW( base + 4, b2UnpackLoW( t1b, t2b ) );
+	b2StoreW( base + 12, b2UnpackHiW( t1b, t2b ) );
+	b2StoreW( base + 20, b2UnpackLoW( t3b, t4b ) );
+	b2StoreW( base + 28, b2UnpackHiW( t3b, t4b ) );
+}
+
+#else
+
+static inline void b2StoreBodyStates( b2BodyState* B2_RESTRICT states, const b2BodyStateW* B2_RESTRICT simdBody )
+{
+	const b2BodyStateW* b = simdBody;
+	states[0].linearVelocity = (b2Vec2){ b->v.X.x, b->v.Y.x };
+	states[1].linearVelocity = (b2Vec2){ b->v.X.y, b->v.Y.y };
+	states[2].linearVelocity = (b2Vec2){ b->v.X.z, b->v.Y.z };
+	states[3].linearVelocity = (b2Vec2){ b->v.X.w, b->v.Y.w };
+	states[0].angularVelocity = b->w.x;
+	states[1].angularVelocity = b->w.y;
+	states[2].angularVelocity = b->w.z;
+	states[3].angularVelocity = b->w.w;
+	states[0].deltaPosition = (b2Vec2){ b->dp.X.x, b->dp.Y.x };
+	states[1].deltaPosition = (b2Vec2){ b->dp.X.y, b->dp.Y.y };
+	states[2].deltaPosition = (b2Vec2){ b->dp.X.z, b->dp.Y.z };
+	states[3].deltaPosition = (b2Vec2){ b->dp.X.w, b->dp.Y.w };
+	states[0].deltaRotation = (b2Rot){ b->dq.C.x, b->dq.S.x };
+	states[1].deltaRotation = (b2Rot){ b->dq.C.y, b->dq.S.y };
+	states[2].deltaRotation = (b2Rot){ b->dq.C.z, b->dq.S.z };
+	states[3].deltaRotation = (b2Rot){ b->dq.C.w, b->dq.S.w };
+}
+
+#endif
+
+// Rotation integration and normalization for the body loops. BOX2D_FAST_MATH builds replace
+// the square root and divide with the reciprocal square root estimate refined by Newton steps.
+// The estimate differs between CPUs, so these builds are only deterministic on one platform.
+static inline float b2InvSqrtFast( float x )
+{
+	B2_ASSERT( x > 0.0f );
+
+#if defined( BOX2D_FAST_MATH ) && ( defined( B2_SIMD_AVX512 ) || defined( B2_SIMD_AVX2 ) || defined( B2_SIMD_SSE2 ) )
+	// 12 bit estimate, one step gives about 22 bits
+	float y = _mm_cvtss_f32( _mm_rsqrt_ss( _mm_set_ss( x ) ) );
+	return y * ( 1.5f - 0.5f * x * y * y );
+#elif defined( BOX2D_FAST_MATH ) && defined( B2_SIMD_NEON )
+	// 8 bit estimate, vrsqrts computes ( 3 - a * b ) / 2 for each step
+	float32x2_t v = vdup_n_f32( x );
+	float32x2_t y = vrsqrte_f32( v );
+	y = vmul_f32( y, vrsqrts_f32( vmul_f32( v, y ), y ) );
+	y = vmul_f32( y, vrsqrts_f32( vmul_f32( v, y ), y ) );
+	return vget_lane_f32( y, 0 );
+#else
+	return 1.0f / sqrtf( x );
+#endif
+}
+
+static inline b2Rot b2FastIntegrateRotation( b2Rot q1, float deltaAngle )
+{
+#if defined( BOX2D_FAST_MATH )
+	// The magnitude is at least one, so the estimate never sees zero
+	b2Rot q2 = { q1.c - deltaAngle * q1.s, q1.s + deltaAngle * q1.c };
+	float invMag = b2InvSqrtFast( q2.s * q2.s + q2.c * q2.c );
+	return (b2Rot){ q2.c * invMag, q2.s * invMag };
+#else
+	return b2IntegrateRotation( q1, deltaAngle );
+#endif
+}
+
+static inline b2Rot b2FastNormalizeRot( b2Rot q )
+{
+#if defined( BOX2D_FAST_MATH )
+	// Only used on products of unit rotations
+	float invMag = b2InvSqrtFast( q.s * q.s + q.c * q.c );
+	return (b2Rot){ q.c * invMag, q.s * invMag };
+#else
+	return b2NormalizeRot( q );
+#endif
+}
+
+// Wide b2FastIntegrateRotation. The lanes give the same results as the scalar version so the
+// body stages are deterministic however the bodies are split into blocks.
+static inline b2RotW b2FastIntegrateRotationW( b2RotW q1, b2FloatW deltaAngle )
+{
+	b2RotW q2 = { b2SubW( q1.C, b2MulW( deltaAngle, q1.S ) ), b2AddW( q1.S, b2MulW( deltaAngle, q1.C ) ) };
+	b2FloatW magSquared = b2AddW( b2MulW( q2.S, q2.S ), b2MulW( q2.C, q2.C ) );
+
+#if defined( BOX2D_FAST_MATH ) && !defined( B2_SIMD_NONE ) && !defined( B2_SIMD_WASM )
+	#if defined( B2_SIMD_AVX512 )
+	// Two 8 wide estimates because the 14 bit AVX-512 estimate would not match the other x64 paths
+	__m256 lo = _mm256_rsqrt_ps( _mm512_castps512_ps256( magSquared ) );
+	__m256 hi = _mm256_rsqrt_ps( _mm256_castpd_ps( _mm512_extractf64x4_pd( _mm512_castps_pd( magSquared ), 1 ) ) );
+	b2FloatW y = _mm512_castpd_ps(
+		_mm512_insertf64x4( _mm512_castps_pd( _mm512_castps256_ps512( lo ) ), _mm256_castps_pd( hi ), 1 ) );
+	#elif defined( B2_SIMD_AVX2 )
+	b2FloatW y = _mm256_rsqrt_ps( magSquared );
+	#elif defined( B2_SIMD_NEON )
+	b2FloatW y = vrsqrteq_f32( magSquared );
+	y = vmulq_f32( y, vrsqrtsq_f32( vmulq_f32( magSquared, y ), y ) );
+	y = vmulq_f32( y, vrsqrtsq_f32( vmulq_f32( magSquared, y ), y ) );
+	#else
+	b2FloatW y = _mm_rsqrt_ps( magSquared );
+	#endif
+
+	#if !defined( B2_SIMD_NEON )
+	b2FloatW halfX = b2MulW( b2SplatW( 0.5f ), magSquared );
+	y = b2MulW( y, b2SubW( b2SplatW( 1.5f ), b2MulW( b2MulW( halfX, y ), y ) ) );
+	#endif
+
+	b2FloatW invMag = y;
+#else
+	b2FloatW invMag = b2DivW( b2SplatW( 1.0f ), b2SqrtW( magSquared ) );
+#endif
+
+	return (b2RotW){ b2MulW( q2.C, invMag ), b2MulW( q2.S, invMag ) };
+}
@@ -0,0 +1,1300 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#include "snapshot.h"
+
+#include "bitset.h"
+#include "body.h"
+#include "broad_phase.h"
+#include "constraint_graph.h"
+#include "contact.h"
+#include "core.h"
+#include "dynamic_tree.h"
+#include "id_pool.h"
+#include "island.h"
+#include "joint.h"
+#include "physics_world.h"
+#include "sensor.h"
+#include "shape.h"
+#include "solver_set.h"
+#include "table.h"
+
+#include "box2d/box2d.h"
+
+#include <stddef.h>
+#include <string.h>
+
+// A snapshot is a flat copy of the simulation state. Restoring copies the state back into the
+// existing storage, so contacts, islands and broad-phase proxies are not rebuilt. Snapshots are
+// only valid for the world and the build that wrote them.
+#define B2_SNAPSHOT_MAGIC 0x4E533242
+#define B2_SNAPSHOT_VERSION 3
+
+// A full snapshot is keyed by a hash of its content and becomes the key frame of the world. A delta
+// holds the objects changed since the key frame and records the key it was written against.
+typedef struct b2SnapshotHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	int size;
+	int layoutSize;
+	int workerCount;
+	uint16_t worldId;
+	uint16_t generation;
+	uint32_t key;
+	uint32_t baseKey;
+} b2SnapshotHeader;
+
+// Catches snapshots written by a build with different struct layouts
+static int b2GetSnapshotLayoutSize( void )
+{
+	return (int)( sizeof( b2Body ) + sizeof( b2BodySim ) + sizeof( b2BodyState ) + sizeof( b2Shape ) +
+				  sizeof( b2ChainShape ) + sizeof( b2Contact ) + sizeof( b2ContactSim ) + sizeof( b2CompactContactSim ) +
+				  sizeof( b2Joint ) + sizeof( b2JointSim ) + sizeof( b2Island ) + sizeof( b2IslandSim ) + sizeof( b2SolverSet ) +
+				  sizeof( b2Sensor ) + sizeof( b2Visitor ) + sizeof( b2BodyCommand ) + sizeof( b2DynamicTree ) +
+				  sizeof( b2ParticleDef ) );
+}
+
+void b2WriteBytes( b2SnapshotWriter* writer, const void* data, int byteCount )
+{
+	B2_ASSERT( byteCount >= 0 );
+	if ( writer->data != NULL && byteCount > 0 && writer->size + byteCount <= writer->capacity )
+	{
+		memcpy( writer->data + writer->size, data, byteCount );
+	}
+
+	writer->size += byteCount;
+}
+
+void b2ReadBytes( b2SnapshotReader* reader, void* data, int byteCount )
+{
+	B2_ASSERT( byteCount >= 0 && reader->offset + byteCount <= reader->size );
+	if ( byteCount > 0 )
+	{
+		memcpy( data, reader->data + reader->offset, byteCount );
+	}
+
+	reader->offset += byteCount;
+}
+
+// Arrays are written as the count followed by the elements. Arrays without storage are written
+// with a negative count so they are freed on restore, as they are for destroyed islands and sets.
+static void b2WriteArrayBytes( b2SnapshotWriter* writer, const void* data, int count, int elementSize )
+{
+	int writeCount = data != NULL ? count : -1;
+	b2WriteValue( writer, writeCount );
+	b2WriteBytes( writer, data, data != NULL ? count * elementSize : 0 );
+}
+
+static int b2ReadArrayCount( b2SnapshotReader* reader )
+{
+	int count;
+	b2ReadValue( reader, count );
+	return count;
+}
+
+#define b2WriteArray( writer, a ) b2WriteArrayBytes( writer, ( a ).data, ( a ).count, (int)sizeof( *( a ).data ) )
+
+#define b2ReadArray( reader, a )                                                                                                 \
+	do                                                                                                                           \
+	{                                                                                                                            \
+		int count_ = b2ReadArrayCount( reader );                                                                                 \
+		if ( count_ < 0 )                                                                                                        \
+		{                                                                                                                        \
+			b2Array_Destroy( a );                                                                                                \
+		}                                                                                                                        \
+		else                                                                                                                     \
+		{                                                                                                                        \
+			b2Array_Resize( a, count_ );                                                                                         \
+			b2ReadBytes( reader, ( a ).data, count_ * (int)sizeof( *( a ).data ) );                                              \
+		}                                                                                                                        \
+	}                                                                                                                            \
+	while ( 0 )
+
+static void b2WriteIdPool( b2SnapshotWriter* writer, const b2IdPool* pool )
+{
+	b2WriteArray( writer, pool->freeArray );
+	b2WriteValue( writer, pool->nextIndex );
+}
+
+static void b2ReadIdPool( b2SnapshotReader* reader, b2IdPool* pool )
+{
+	b2ReadArray( reader, pool->freeArray );
+	b2ReadValue( reader, pool->nextIndex );
+}
+
+static void b2WriteBitSet( b2SnapshotWriter* writer, const b2BitSet* bitSet )
+{
+	b2WriteValue( writer, bitSet->blockCount );
+	b2WriteBytes( writer, bitSet->bits, bitSet->blockCount * (int)sizeof( uint64_t ) );
+}
+
+static void b2ReadBitSet( b2SnapshotReader* reader, b2BitSet* bitSet )
+{
+	uint32_t blockCount;
+	b2ReadValue( reader, blockCount );
+	b2SetBitCountAndClear( bitSet, blockCount * 64 );
+	b2ReadBytes( reader, bitSet->bits, blockCount * (int)sizeof( uint64_t ) );
+}
+
+// The control bytes and keys of a 32-bit set share one allocation, see b2CreateSet32
+static void b2WriteSet32( b2SnapshotWriter* writer, const b2HashSet32* set )
+{
+	b2WriteValue( writer, set->capacity );
+	b2WriteValue( writer, set->count );
+	b2WriteValue( writer, set->deletedCount );
+	b2WriteBytes( writer, set->controls, set->capacity * (int)( sizeof( uint8_t ) + sizeof( uint32_t ) ) );
+}
+
+static void b2ReadSet32( b2SnapshotReader* reader, b2HashSet32* set )
+{
+	uint32_t capacity;
+	b2ReadValue( reader, capacity );
+	if ( capacity != set->capacity )
+	{
+		b2DestroySet32( set );
+		set->controls = b2Alloc( capacity * ( sizeof( uint8_t ) + sizeof( uint32_t ) ) );
+		set->keys = (uint32_t*)( set->controls + capacity );
+		set->capacity = capacity;
+	}
+
+	b2ReadValue( reader, set->count );
+	b2ReadValue( reader, set->deletedCount );
+	b2ReadBytes( reader, set->controls, capacity * (int)( sizeof( uint8_t ) + sizeof( uint32_t ) ) );
+}
+
+static void b2WriteSet( b2SnapshotWriter* writer, const b2HashSet* set )
+{
+	b2WriteValue( writer, set->capacity );
+	b2WriteValue( writer, set->count );
+	b2WriteBytes( writer, set->items, set->capacity * (int)sizeof( b2SetItem ) );
+}
+
+static void b2ReadSet( b2SnapshotReader* reader, b2HashSet* set )
+{
+	uint32_t capacity;
+	b2ReadValue( reader, capacity );
+	if ( capacity != set->capacity )
+	{
+		b2DestroySet( set );
+		set->items = b2Alloc( capacity * sizeof( b2SetItem ) );
+		set->capacity = capacity;
+	}
+
+	b2ReadValue( reader, set->count );
+	b2ReadBytes( reader, set->items, capacity * (int)sizeof( b2SetItem ) );
+}
+
+// Elements that own arrays are copied whole and then their arrays are put back and restored.
+// The array headers are cleared when writing so a snapshot does not depend on heap addresses.
+static void b2WriteIsland( b2SnapshotWriter* writer, const void* element )
+{
+	const b2Island* island = element;
+	b2Island copy = *island;
+	memset( &copy.bodies, 0, sizeof( copy.bodies ) );
+	memset( &copy.contacts, 0, sizeof( copy.contacts ) );
+	memset( &copy.joints, 0, sizeof( copy.joints ) );
+	memset( &copy.removedLinks, 0, sizeof( copy.removedLinks ) );
+	b2WriteValue( writer, copy );
+	b2WriteArray( writer, island->bodies );
+	b2WriteArray( writer, island->contacts );
+	b2WriteArray( writer, island->joints );
+	b2WriteArray( writer, island->removedLinks );
+}
+
+static void b2ReadIsland( b2SnapshotReader* reader, void* element )
+{
+	b2Island* island = element;
+	b2Island old = *island;
+	b2ReadValue( reader, *island );
+	island->bodies = old.bodies;
+	island->contacts = old.contacts;
+	island->joints = old.joints;
+	island->removedLinks = old.removedLinks;
+	b2ReadArray( reader, island->bodies );
+	b2ReadArray( reader, island->contacts );
+	b2ReadArray( reader, island->joints );
+	b2ReadArray( reader, island->removedLinks );
+}
+
+static void b2FreeIsland( b2Island* island )
+{
+	b2Array_Destroy( island->bodies );
+	b2Array_Destroy( island->contacts );
+	b2Array_Destroy( island->joints );
+	b2Array_Destroy( island->removedLinks );
+}
+
+static void b2WriteSolverSet( b2SnapshotWriter* writer, const void* element )
+{
+	const b2SolverSet* set = element;
+	b2SolverSet copy = *set;
+	memset( &copy.bodySims, 0, sizeof( copy.bodySims ) );
+	memset( &copy.bodyStates, 0, sizeof( copy.bodyStates ) );
+	memset( &copy.jointSims, 0, sizeof( copy.jointSims ) );
+	memset( &copy.contactSims, 0, sizeof( copy.contactSims ) );
+	memset( &copy.compactContactSims, 0, sizeof( copy.compactContactSims ) );
+	memset( &copy.islandSims, 0, sizeof( copy.islandSims ) );
+	b2WriteValue( writer, copy );
+	b2WriteArray( writer, set->bodySims );
+	b2WriteArray( writer, set->bodyStates );
+	b2WriteArray( writer, set->jointSims );
+	b2WriteArray( writer, set->contactSims );
+	b2WriteArray( writer, set->compactContactSims );
+	b2WriteArray( writer, set->islandSims );
+}
+
+static void b2ReadSolverSet( b2SnapshotReader* reader, void* element )
+{
+	b2SolverSet* set = element;
+	b2SolverSet old = *set;
+	b2ReadValue( reader, *set );
+	set->bodySims = old.bodySims;
+	set->bodyStates = old.bodyStates;
+	set->jointSims = old.jointSims;
+	set->contactSims = old.contactSims;
+	set->compactContactSims = old.compactContactSims;
+	set->islandSims = old.islandSims;
+	b2ReadArray( reader, set->bodySims );
+	b2ReadArray( reader, set->bodyStates );
+	b2ReadArray( reader, set->jointSims );
+	b2ReadArray( reader, set->contactSims );
+	b2ReadArray( reader, set->compactContactSims );
+	b2ReadArray( reader, set->islandSims );
+}
+
+static void b2FreeSolverSet( b2SolverSet* set )
+{
+	b2Array_Destroy( set->bodySims );
+	b2Array_Destroy( set->bodyStates );
+	b2Array_Destroy( set->jointSims );
+	b2Array_Destroy( set->contactSims );
+	b2Array_Destroy( set->compactContactSims );
+	b2Array_Destroy( set->islandSims );
+}
+
+static void b2WriteSensor( b2SnapshotWriter* writer, const void* element )
+{
+	const b2Sensor* sensor = element;
+	b2Sensor copy = *sensor;
+	memset( &copy.hits, 0, sizeof( copy.hits ) );
+	memset( &copy.overlaps1, 0, sizeof( copy.overlaps1 ) );
+	memset( &copy.overlaps2, 0, sizeof( copy.overlaps2 ) );
+	b2WriteValue( writer, copy );
+	b2WriteArray( writer, sensor->hits );
+	b2WriteArray( writer, sensor->overlaps1 );
+	b2WriteArray( writer, sensor->overlaps2 );
+}
+
+static void b2ReadSensor( b2SnapshotReader* reader, void* element )
+{
+	b2Sensor* sensor = element;
+	b2Sensor old = *sensor;
+	b2ReadValue( reader, *sensor );
+	sensor->hits = old.hits;
+	sensor->overlaps1 = old.overlaps1;
+	sensor->overlaps2 = old.overlaps2;
+	b2ReadArray( reader, sensor->hits );
+	b2ReadArray( reader, sensor->overlaps1 );
+	b2ReadArray( reader, sensor->overlaps2 );
+}
+
+static void b2FreeSensor( b2Sensor* sensor )
+{
+	b2Array_Destroy( sensor->hits );
+	b2Array_Destroy( sensor->overlaps1 );
+	b2Array_Destroy( sensor->overlaps2 );
+}
+
+static void b2WriteChain( b2SnapshotWriter* writer, const void* element )
+{
+	const b2ChainShape* chain = element;
+	b2ChainShape copy = *chain;
+	copy.shapeIndices = NULL;
+	copy.materials = NULL;
+	b2WriteValue( writer, copy );
+
+	bool hasData = chain->shapeIndices != NULL;
+	b2WriteValue( writer, hasData );
+	if ( hasData )
+	{
+		b2WriteBytes( writer, chain->shapeIndices, chain->count * (int)sizeof( int ) );
+		b2WriteBytes( writer, chain->materials, chain->materialCount * (int)sizeof( b2SurfaceMaterial ) );
+	}
+}
+
+static void b2ReadChain( b2SnapshotReader* reader, void* element )
+{
+	b2ChainShape* chain = element;
+	b2ChainShape old = *chain;
+	b2ReadValue( reader, *chain );
+
+	bool hasData;
+	b2ReadValue( reader, hasData );
+
+	// Chains are immutable so the data is kept when the sizes match
+	if ( hasData && old.shapeIndices != NULL && old.count == chain->count && old.materialCount == chain->materialCount )
+	{
+		chain->shapeIndices = old.shapeIndices;
+		chain->materials = old.materials;
+	}
+	else
+	{
+		b2FreeChainData( &old );
+		chain->shapeIndices = hasData ? b2Alloc( chain->count * sizeof( int ) ) : NULL;
+		chain->materials = hasData ? b2Alloc( chain->materialCount * sizeof( b2SurfaceMaterial ) ) : NULL;
+	}
+
+	if ( hasData )
+	{
+		b2ReadBytes( reader, chain->shapeIndices, chain->count * (int)sizeof( int ) );
+		b2ReadBytes( reader, chain->materials, chain->materialCount * (int)sizeof( b2SurfaceMaterial ) );
+	}
+}
+
+// Reserve room for the byte size of the block that follows, so a reader can skip it
+static int b2BeginBlock( b2SnapshotWriter* writer )
+{
+	int offset = writer->size;
+	int size = 0;
+	b2WriteValue( writer, size );
+	return offset;
+}
+
+static void b2EndBlock( b2SnapshotWriter* writer, int offset )
+{
+	int size = writer->size - offset - (int)sizeof( int );
+	if ( writer->data != NULL && writer->size <= writer->capacity )
+	{
+		memcpy( writer->data + offset, &size, sizeof( int ) );
+	}
+}
+
+// The objects a read copies into the world. A full restore applies everything. Restoring a delta
+// first applies the objects of the key frame that changed since then, those marked in the bit sets
+// or past the current array count, and then applies the whole delta and marks what it holds.
+typedef struct b2ReadFilter
+{
+	const b2BitSet* bitSet;
+	int oldCount;
+	b2BitSet* markSet;
+} b2ReadFilter;
+
+static bool b2ShouldApply( const b2ReadFilter* filter, int index )
+{
+	return filter->bitSet == NULL || index >= filter->oldCount || b2GetBit( filter->bitSet, index );
+}
+
+// Plain arrays indexed by id are written as runs of consecutive elements. A full snapshot is one run.
+static void b2WriteRuns( b2SnapshotWriter* writer, const void* data, int count, int elementSize, const b2BitSet* dirty )
+{
+	b2WriteValue( writer, count );
+
+	int index = 0;
+	while ( index < count )
+	{
+		if ( dirty != NULL && b2GetBit( dirty, index ) == false )
+		{
+			index += 1;
+			continue;
+		}
+
+		int start = index;
+		while ( index < count && ( dirty == NULL || b2GetBit( dirty, index ) ) )
+		{
+			index += 1;
+		}
+
+		int runCount = index - start;
+		b2WriteValue( writer, start );
+		b2WriteValue( writer, runCount );
+		b2WriteBytes( writer, (const uint8_t*)data + start * elementSize, runCount * elementSize );
+	}
+
+	int end = B2_NULL_INDEX;
+	b2WriteValue( writer, end );
+}
+
+static void b2ReadRuns( b2SnapshotReader* reader, void* data, int elementSize, const b2ReadFilter* filter )
+{
+	int start;
+	b2ReadValue( reader, start );
+	while ( start != B2_NULL_INDEX )
+	{
+		int runCount;
+		b2ReadValue( reader, runCount );
+		for ( int index = start; index < start + runCount; ++index )
+		{
+			if ( b2ShouldApply( filter, index ) )
+			{
+				b2ReadBytes( reader, (uint8_t*)data + index * elementSize, elementSize );
+				if ( filter->markSet != NULL )
+				{
+					b2SetBitGrow( filter->markSet, index );
+				}
+			}
+			else
+			{
+				reader->offset += elementSize;
+			}
+		}
+
+		b2ReadValue( reader, start );
+	}
+}
+
+#define b2WriteSparseArray( writer, a, dirty ) b2WriteRuns( writer, ( a ).data, ( a ).count, (int)sizeof( *( a ).data ), dirty )
+
+#define b2ReadSparseArray( reader, a, filter )                                                                                   \
+	do                                                                                                                           \
+	{                                                                                                                            \
+		int count_ = b2ReadArrayCount( reader );                                                                                 \
+		b2Array_Resize( a, count_ );                                                                                             \
+		b2ReadRuns( reader, ( a ).data, (int)sizeof( *( a ).data ), filter );                                                    \
+	}                                                                                                                            \
+	while ( 0 )
+
+typedef void b2WriteElementFcn( b2SnapshotWriter* writer, const void* element );
+typedef void b2ReadElementFcn( b2SnapshotReader* reader, void* element );
+
+// Elements that own arrays are written one at a time with their index and byte size
+static void b2WriteElements( b2SnapshotWriter* writer, const void* data, int count, int elementSize, const b2BitSet* dirty,
+							 b2WriteElementFcn* writeFcn )
+{
+	b2WriteValue( writer, count );
+	for ( int index = 0; index < count; ++index )
+	{
+		if ( dirty != NULL && b2GetBit( dirty, index ) == false )
+		{
+			continue;
+		}
+
+		b2WriteValue( writer, index );
+		int offset = b2BeginBlock( writer );
+		writeFcn( writer, (const uint8_t*)data + index * elementSize );
+		b2EndBlock( writer, offset );
+	}
+
+	int end = B2_NULL_INDEX;
+	b2WriteValue( writer, end );
+}
+
+static void b2ReadElements( b2SnapshotReader* reader, void* data, int elementSize, const b2ReadFilter* filter,
+							b2ReadElementFcn* readFcn )
+{
+	int index;
+	b2ReadValue( reader, index );
+	while ( index != B2_NULL_INDEX )
+	{
+		int size;
+		b2ReadValue( reader, size );
+		if ( b2ShouldApply( filter, index ) )
+		{
+			int offset = reader->offset;
+			readFcn( reader, (uint8_t*)data + index * elementSize );
+			B2_ASSERT( reader->offset == offset + size );
+			B2_UNUSED( offset );
+
+			if ( filter->markSet != NULL )
+			{
+				b2SetBitGrow( filter->markSet, index );
+			}
+		}
+		else
+		{
+			reader->offset += size;
+		}
+
+		b2ReadValue( reader, index );
+	}
+}
+
+// Removed elements free their arrays and added elements start out empty
+#define b2ReadElementArray( reader, a, filter, readFcn, freeFcn )                                                                \
+	do                                                                                                                           \
+	{                                                                                                                            \
+		int count_ = b2ReadArrayCount( reader );                                                                                 \
+		int oldCount_ = ( a ).count;                                                                                             \
+		for ( int i_ = count_; i_ < oldCount_; ++i_ )                                                                            \
+		{                                                                                                                        \
+			freeFcn( ( a ).data + i_ );                                                                                          \
+		}                                                                                                                        \
+		b2Array_Resize( a, count_ );                                                                                             \
+		if ( count_ > oldCount_ )                                                                                                \
+		{                                                                                                                        \
+			memset( ( a ).data + oldCount_, 0, ( count_ - oldCount_ ) * sizeof( *( a ).data ) );                                 \
+		}                                                                                                                        \
+		b2ReadElements( reader, ( a ).data, (int)sizeof( *( a ).data ), filter, readFcn );                                       \
+	}                                                                                                                            \
+	while ( 0 )
+
+static void b2WriteTrees( b2SnapshotWriter* writer, b2BroadPhase* bp, uint32_t treeBits )
+{
+	b2WriteValue( writer, treeBits );
+	for ( int i = 0; i < b2_bodyTypeCount; ++i )
+	{
+		if ( treeBits & ( 1u << i ) )
+		{
+			int offset = b2BeginBlock( writer );
+			b2WriteTreeSnapshot( writer, bp->trees + i );
+			b2EndBlock( writer, offset );
+		}
+	}
+}
+
+static void b2ReadTrees( b2SnapshotReader* reader, b2BroadPhase* bp, uint32_t applyBits, bool mark )
+{
+	uint32_t treeBits;
+	b2ReadValue( reader, treeBits );
+	for ( int i = 0; i < b2_bodyTypeCount; ++i )
+	{
+		if ( ( treeBits & ( 1u << i ) ) == 0 )
+		{
+			continue;
+		}
+
+		int size;
+		b2ReadValue( reader, size );
+		if ( applyBits & ( 1u << i ) )
+		{
+			b2ReadTreeSnapshot( reader, bp->trees + i );
+			bp->staticRevision += i == b2_staticBody ? 1 : 0;
+			bp->dirtyTrees |= mark ? 1u << i : 0u;
+		}
+		else
+		{
+			reader->offset += size;
+		}
+	}
+}
+
+static uint32_t b2AllTrees( void )
+{
+	return ( 1u << b2_bodyTypeCount ) - 1;
+}
+
+static void b2ClearDirty( b2World* world )
+{
+	for ( int i = 0; i < b2_dirtyTypeCount; ++i )
+	{
+		b2BitSet* bitSet = world->dirtyBitSets + i;
+		memset( bitSet->bits, 0, bitSet->blockCapacity * sizeof( uint64_t ) );
+		bitSet->blockCount = 0;
+	}
+
+	world->broadPhase.dirtyTrees = 0;
+}
+
+static void b2MarkRange( b2BitSet* bitSet, int count )
+{
+	uint32_t blockCount = ( (uint32_t)count + 63 ) / 64;
+	if ( blockCount > bitSet->blockCount )
+	{
+		b2GrowBitSet( bitSet, blockCount );
+	}
+
+	memset( bitSet->bits, 0xFF, blockCount * sizeof( uint64_t ) );
+}
+
+void b2MarkAllDirty( b2World* world )
+{
+	if ( world->snapshotKey == 0 )
+	{
+		return;
+	}
+
+	b2MarkRange( world->dirtyBitSets + b2_dirtyBody, world->bodies.count );
+	b2MarkRange( world->dirtyBitSets + b2_dirtyShape, world->shapes.count );
+	b2MarkRange( world->dirtyBitSets + b2_dirtyChain, world->chainShapes.count );
+	b2MarkRange( world->dirtyBitSets + b2_dirtyJoint, world->joints.count );
+	b2MarkRange( world->dirtyBitSets + b2_dirtyContact, world->contacts.count );
+	b2MarkRange( world->dirtyBitSets + b2_dirtyIsland, world->islands.count );
+	b2MarkRange( world->dirtyBitSets + b2_dirtySolverSet, world->solverSets.count );
+	world->broadPhase.dirtyTrees = b2AllTrees();
+}
+
+static void b2MarkSetObjectsDirty( b2World* world, b2SolverSet* set )
+{
+	for ( int i = 0; i < set->bodySims.count; ++i )
+	{
+		int bodyId = set->bodySims.data[i].bodyId;
+		b2MarkDirty( world, b2_dirtyBody, bodyId );
+
+		int shapeId = world->bodies.data[bodyId].headShapeId;
+		while ( shapeId != B2_NULL_INDEX )
+		{
+			b2MarkDirty( world, b2_dirtyShape, shapeId );
+			shapeId = world->shapes.data[shapeId].nextShapeId;
+		}
+	}
+
+	for ( int i = 0; i < set->contactSims.count; ++i )
+	{
+		b2MarkDirty( world, b2_dirtyContact, set->contactSims.data[i].contactId );
+	}
+
+	for ( int i = 0; i < set->compactContactSims.count; ++i )
+	{
+		b2MarkDirty( world, b2_dirtyContact, set->compactContactSims.data[i].contactId );
+	}
+
+	for ( int i = 0; i < set->jointSims.count; ++i )
+	{
+		b2MarkDirty( world, b2_dirtyJoint, set->jointSims.data[i].jointId );
+	}
+
+	for ( int i = 0; i < set->islandSims.count; ++i )
+	{
+		b2MarkDirty( world, b2_dirtyIsland, set->islandSims.data[i].islandId );
+	}
+}
+
+// Changes inside solver sets only mark the set. The awake and kinematic sets change every step. Here
+// the objects of the dirty sets are marked so a delta holds every object that may differ from the key frame.
+static void b2ExpandDirty( b2World* world )
+{
+	b2MarkDirty( world, b2_dirtySolverSet, b2_awakeSet );
+	b2MarkDirty( world, b2_dirtySolverSet, b2_kinematicSet );
+
+	b2ConstraintGraph* graph = &world->constraintGraph;
+	for ( int i = 0; i < B2_GRAPH_COLOR_COUNT; ++i )
+	{
+		b2GraphColor* color = graph->colors + i;
+		for ( int j = 0; j < color->contactSims.count; ++j )
+		{
+			b2MarkDirty( world, b2_dirtyContact, color->contactSims.data[j].contactId );
+		}
+
+		for ( int j = 0; j < color->jointSims.count; ++j )
+		{
+			b2MarkDirty( world, b2_dirtyJoint, color->jointSims.data[j].jointId );
+		}
+	}
+
+	b2BitSet* setBits = world->dirtyBitSets + b2_dirtySolverSet;
+	for ( int setIndex = 0; setIndex < world->solverSets.count; ++setIndex )
+	{
+		b2SolverSet* set = world->solverSets.data + setIndex;
+		if ( set->setIndex != B2_NULL_INDEX && b2GetBit( setBits, setIndex ) )
+		{
+			b2MarkSetObjectsDirty( world, set );
+		}
+	}
+}
+
+// Objects indexed by id and the broad-phase trees. Deltas hold only the dirty ones.
+static void b2WriteTrackedState( b2SnapshotWriter* writer, b2World* world, bool delta )
+{
+	const b2BitSet* dirty = world->dirtyBitSets;
+
+	b2WriteSparseArray( writer, world->bodies, delta ? dirty + b2_dirtyBody : NULL );
+	b2WriteSparseArray( writer, world->joints, delta ? dirty + b2_dirtyJoint : NULL );
+	b2WriteSparseArray( writer, world->contacts, delta ? dirty + b2_dirtyContact : NULL );
+	b2WriteSparseArray( writer, world->shapes, delta ? dirty + b2_dirtyShape : NULL );
+
+	b2WriteElements( writer, world->chainShapes.data, world->chainShapes.count, (int)sizeof( b2ChainShape ),
+					 delta ? dirty + b2_dirtyChain : NULL, b2WriteChain );
+	b2WriteElements( writer, world->solverSets.data, world->solverSets.count, (int)sizeof( b2SolverSet ),
+					 delta ? dirty + b2_dirtySolverSet : NULL, b2WriteSolverSet );
+	b2WriteElements( writer, world->islands.data, world->islands.count, (int)sizeof( b2Island ),
+					 delta ? dirty + b2_dirtyIsland : NULL, b2WriteIsland );
+
+	b2WriteTrees( writer, &world->broadPhase, delta ? world->broadPhase.dirtyTrees : b2AllTrees() );
+}
+
+// A null bit set array applies everything
+static void b2ReadTrackedState( b2SnapshotReader* reader, b2World* world, const b2BitSet* applySets, uint32_t applyTrees,
+								bool mark )
+{
+	b2BitSet* markSets = mark ? world->dirtyBitSets : NULL;
+	world->bodyRefEpoch += 1;
+
+#define b2MakeFilter( type, a )                                                                                                  \
+	( b2ReadFilter )                                                                                                             \
+	{                                                                                                                            \
+		applySets != NULL ? applySets + type : NULL, ( a ).count, markSets != NULL ? markSets + type : NULL                     \
+	}
+
+	b2ReadFilter filter = b2MakeFilter( b2_dirtyBody, world->bodies );
+	b2ReadSparseArray( reader, world->bodies, &filter );
+	filter = b2MakeFilter( b2_dirtyJoint, world->joints );
+	b2ReadSparseArray( reader, world->joints, &filter );
+	filter = b2MakeFilter( b2_dirtyContact, world->contacts );
+	b2ReadSparseArray( reader, world->contacts, &filter );
+	filter = b2MakeFilter( b2_dirtyShape, world->shapes );
+	b2ReadSparseArray( reader, world->shapes, &filter );
+
+	filter = b2MakeFilter( b2_dirtyChain, world->chainShapes );
+	b2ReadElementArray( reader, world->chainShapes, &filter, b2ReadChain, b2FreeChainData );
+	filter = b2MakeFilter( b2_dirtySolverSet, world->solverSets );
+	b2ReadElementArray( reader, world->solverSets, &filter, b2ReadSolverSet, b2FreeSolverSet );
+	filter = b2MakeFilter( b2_dirtyIsland, world->islands );
+	b2ReadElementArray( reader, world->islands, &filter, b2ReadIsland, b2FreeIsland );
+
+#undef b2MakeFilter
+
+	b2ReadTrees( reader, &world->broadPhase, applyTrees, mark );
+}
+
+// State that is small or changes every step, written whole in every snapshot
+static void b2WriteSharedState( b2SnapshotWriter* writer, b2World* world )
+{
+	b2WriteIdPool( writer, &world->bodyIdPool );
+	b2WriteIdPool( writer, &world->solverSetIdPool );
+	b2WriteIdPool( writer, &world->jointIdPool );
+	b2WriteIdPool( writer, &world->contactIdPool );
+	b2WriteIdPool( writer, &world->islandIdPool );
+	b2WriteIdPool( writer, &world->shapeIdPool );
+	b2WriteIdPool( writer, &world->chainIdPool );
+
+	b2WriteElements( writer, world->sensors.data, world->sensors.count, (int)sizeof( b2Sensor ), NULL, b2WriteSensor );
+	b2WriteArray( writer, world->pendingSensorIds );
+
+	b2ConstraintGraph* graph = &world->constraintGraph;
+	for ( int i = 0; i < B2_GRAPH_COLOR_COUNT; ++i )
+	{
+		b2GraphColor* color = graph->colors + i;
+		b2WriteBitSet( writer, &color->bodySet );
+		b2WriteArray( writer, color->contactSims );
+		b2WriteArray( writer, color->jointSims );
+	}
+	b2WriteValue( writer, graph->colorCount );
+	b2WriteValue( writer, graph->dynamicColorCount );
+	b2WriteValue( writer, graph->hubColorLimit );
+
+	b2BroadPhase* bp = &world->broadPhase;
+	b2WriteSet32( writer, &bp->moveSet );
+	b2WriteArray( writer, bp->moveArray );
+	b2WriteSet( writer, &bp->pairSet );
+	b2WriteArray( writer, bp->enlargedShapes );
+	b2WriteValue( writer, bp->revision );
+
+	b2WriteTreeSnapshot( writer, &world->sensorTree );
+	b2WriteValue( writer, world->sensorRevision );
+	b2WriteValue( writer, world->sensorFullUpdate );
+
+	// Forces and impulses queued since the last step
+	for ( int i = 0; i < world->workerCount; ++i )
+	{
+		b2WriteArray( writer, world->taskContexts.data[i].bodyCommands );
+	}
+
+	b2WriteValue( writer, world->bodyGenerationFloor );
+	b2WriteValue( writer, world->shapeGenerationFloor );
+	b2WriteValue( writer, world->chainGenerationFloor );
+	b2WriteValue( writer, world->jointGenerationFloor );
+	b2WriteValue( writer, world->contactGenerationFloor );
+	b2WriteValue( writer, world->stepIndex );
+	b2WriteValue( writer, world->lodBodyCount );
+	b2WriteValue( writer, world->parkedSetCount );
+	b2WriteArray( writer, world->lodBodies );
+	b2WriteArray( writer, world->activeRegions );
+	b2WriteValue( writer, world->frozenSetCount );
+	b2WriteValue( writer, world->splitIslandIds );
+	b2WriteValue( writer, world->splitIslandCount );
+	b2WriteValue( writer, world->islandStamp );
+	b2WriteValue( writer, world->inv_h );
+	b2WriteValue( writer, world->inv_dt );
+
+	b2ParticleSystem* particles = &world->particles;
+	b2WriteArray( writer, particles->positions );
+	b2WriteArray( writer, particles->velocities );
+	b2WriteArray( writer, particles->lifetimes );
+	b2WriteArray( writer, particles->groupIndices );
+	b2WriteArray( writer, particles->groups );
+	b2WriteValue( writer, particles->maxRadius );
+}
+
+static void b2ReadSharedState( b2SnapshotReader* reader, b2World* world )
+{
+	b2ReadIdPool( reader, &world->bodyIdPool );
+	b2ReadIdPool( reader, &world->solverSetIdPool );
+	b2ReadIdPool( reader, &world->jointIdPool );
+	b2ReadIdPool( reader, &world->contactIdPool );
+	b2ReadIdPool( reader, &world->islandIdPool );
+	b2ReadIdPool( reader, &world->shapeIdPool );
+	b2ReadIdPool( reader, &world->chainIdPool );
+
+	b2ReadFilter filter = { 0 };
+	b2ReadElementArray( reader, world->sensors, &filter, b2ReadSensor, b2FreeSensor );
+	b2ReadArray( reader, world->pendingSensorIds );
+
+	b2ConstraintGraph* graph = &world->constraintGraph;
+	for ( int i = 0; i < B2_GRAPH_COLOR_COUNT; ++i )
+	{
+		b2GraphColor* color = graph->colors + i;
+		b2ReadBitSet( reader, &color->bodySet );
+		b2ReadArray( reader, color->contactSims );
+		b2ReadArray( reader, color->jointSims );
+	}
+	b2ReadValue( reader, graph->colorCount );
+	b2ReadValue( reader, graph->dynamicColorCount );
+	b2ReadValue( reader, graph->hubColorLimit );
+
+	b2BroadPhase* bp = &world->broadPhase;
+	b2ReadSet32( reader, &bp->moveSet );
+	b2ReadArray( reader, bp->moveArray );
+	b2ReadSet( reader, &bp->pairSet );
+	b2ReadArray( reader, bp->enlargedShapes );
+	b2ReadValue( reader, bp->revision );
+
+	b2ReadTreeSnapshot( reader, &world->sensorTree );
+	b2ReadValue( reader, world->sensorRevision );
+	b2ReadValue( reader, world->sensorFullUpdate );
+
+	for ( int i = 0; i < world->workerCount; ++i )
+	{
+		b2ReadArray( reader, world->taskContexts.data[i].bodyCommands );
+	}
+
+	b2ReadValue( reader, world->bodyGenerationFloor );
+	b2ReadValue( reader, world->shapeGenerationFloor );
+	b2ReadValue( reader, world->chainGenerationFloor );
+	b2ReadValue( reader, world->jointGenerationFloor );
+	b2ReadValue( reader, world->contactGenerationFloor );
+	b2ReadValue( reader, world->stepIndex );
+	b2ReadValue( reader, world->lodBodyCount );
+	b2ReadValue( reader, world->parkedSetCount );
+	b2ReadArray( reader, world->lodBodies );
+	b2ReadArray( reader, world->activeRegions );
+	b2ReadValue( reader, world->frozenSetCount );
+	b2ReadValue( reader, world->splitIslandIds );
+	b2ReadValue( reader, world->splitIslandCount );
+	b2ReadValue( reader, world->islandStamp );
+	b2ReadValue( reader, world->inv_h );
+	b2ReadValue( reader, world->inv_dt );
+
+	b2ParticleSystem* particles = &world->particles;
+	b2ReadArray( reader, particles->positions );
+	b2ReadArray( reader, particles->velocities );
+	b2ReadArray( reader, particles->lifetimes );
+	b2ReadArray( reader, particles->groupIndices );
+	b2ReadArray( reader, particles->groups );
+	b2ReadValue( reader, particles->maxRadius );
+}
+
+static int b2WriteSnapshot( b2World* world, void* buffer, int capacity, bool delta, uint32_t* key )
+{
+	b2SnapshotWriter writer = { buffer, capacity, 0 };
+
+	b2SnapshotHeader header = {
+		.magic = B2_SNAPSHOT_MAGIC,
+		.version = B2_SNAPSHOT_VERSION,
+		.size = 0,
+		.layoutSize = b2GetSnapshotLayoutSize(),
+		.workerCount = world->workerCount,
+		.worldId = world->worldId,
+		.generation = world->generation,
+		.key = 0,
+		.baseKey = delta ? world->snapshotKey : 0,
+	};
+
+	b2WriteValue( &writer, header );
+	b2WriteTrackedState( &writer, world, delta );
+	b2WriteSharedState( &writer, world );
+
+	*key = 0;
+	if ( buffer != NULL && writer.size <= capacity )
+	{
+		header.size = writer.size;
+
+		if ( delta == false )
+		{
+			// Equal states give equal keys, so taking the same snapshot twice gives the same bytes
+			const uint8_t* content = (const uint8_t*)buffer + sizeof( header );
+			uint32_t hash = b2Hash( B2_HASH_INIT, content, writer.size - (int)sizeof( header ) );
+			header.key = hash != 0 ? hash : 1;
+			*key = header.key;
+		}
+
+		memcpy( buffer, &header, sizeof( header ) );
+	}
+
+	return writer.size;
+}
+
+static bool b2ReadHeader( b2World* world, const void* buffer, int size, b2SnapshotHeader* header )
+{
+	if ( buffer == NULL || size < (int)sizeof( *header ) )
+	{
+		return false;
+	}
+
+	memcpy( header, buffer, sizeof( *header ) );
+
+	return header->magic == B2_SNAPSHOT_MAGIC && header->version == B2_SNAPSHOT_VERSION && header->size == size &&
+		   header->layoutSize == b2GetSnapshotLayoutSize() && header->workerCount == world->workerCount &&
+		   header->worldId == world->worldId && header->generation == world->generation;
+}
+
+// Events belong to the step that produced them
+static void b2ClearEvents( b2World* world )
+{
+	b2Array_Clear( world->bodyMoveEvents );
+	b2Array_Clear( world->reportedMoveEvents );
+	b2Array_Clear( world->moveDeltas );
+	b2Array_Clear( world->sensorBeginEvents );
+	b2Array_Clear( world->contactBeginEvents );
+	b2Array_Clear( world->sensorEndEvents[0] );
+	b2Array_Clear( world->sensorEndEvents[1] );
+	b2Array_Clear( world->contactEndEvents[0] );
+	b2Array_Clear( world->contactEndEvents[1] );
+	b2Array_Clear( world->contactHitEvents );
+	b2Array_Clear( world->jointEvents );
+}
+
+int b2World_GetSnapshotSize( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false && world->isStepAsync == false );
+	if ( world->locked || world->isStepAsync )
+	{
+		return 0;
+	}
+
+	uint32_t key;
+	return b2WriteSnapshot( world, NULL, 0, false, &key );
+}
+
+int b2World_Snapshot( b2WorldId worldId, void* buffer, int capacity )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false && world->isStepAsync == false );
+	if ( world->locked || world->isStepAsync )
+	{
+		return 0;
+	}
+
+	b2TracyCZoneNC( snapshot, "Snapshot", b2_colorDarkSeaGreen, true );
+
+	uint32_t key;
+	int size = b2WriteSnapshot( world, buffer, capacity, false, &key );
+	if ( size <= capacity )
+	{
+		world->snapshotKey = key;
+		b2ClearDirty( world );
+	}
+
+	b2TracyCZoneEnd( snapshot );
+
+	return size <= capacity ? size : 0;
+}
+
+int b2World_GetSnapshotDeltaSize( b2WorldId worldId )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false && world->isStepAsync == false );
+	if ( world->locked || world->isStepAsync || world->snapshotKey == 0 )
+	{
+		return 0;
+	}
+
+	b2ExpandDirty( world );
+
+	uint32_t key;
+	return b2WriteSnapshot( world, NULL, 0, true, &key );
+}
+
+int b2World_SnapshotDelta( b2WorldId worldId, void* buffer, int capacity )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false && world->isStepAsync == false );
+	if ( world->locked || world->isStepAsync || world->snapshotKey == 0 )
+	{
+		return 0;
+	}
+
+	b2TracyCZoneNC( snapshot_delta, "Snapshot Delta", b2_colorDarkSeaGreen, true );
+
+	b2ExpandDirty( world );
+
+	uint32_t key;
+	int size = b2WriteSnapshot( world, buffer, capacity, true, &key );
+
+	b2TracyCZoneEnd( snapshot_delta );
+
+	return size <= capacity ? size : 0;
+}
+
+bool b2World_Restore( b2WorldId worldId, const void* buffer, int size )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false && world->isStepAsync == false );
+	if ( world->locked || world->isStepAsync )
+	{
+		return false;
+	}
+
+	b2SnapshotHeader header;
+	if ( b2ReadHeader( world, buffer, size, &header ) == false || header.baseKey != 0 )
+	{
+		return false;
+	}
+
+	b2TracyCZoneNC( restore, "Restore", b2_colorDarkSeaGreen, true );
+
+	b2SnapshotReader reader = { buffer, size, (int)sizeof( header ) };
+	b2ReadTrackedState( &reader, world, NULL, b2AllTrees(), false );
+	b2ReadSharedState( &reader, world );
+	B2_ASSERT( reader.offset == size );
+
+	world->snapshotKey = header.key;
+	b2ClearDirty( world );
+	b2ClearEvents( world );
+	b2ResetInterpolation( world );
+
+	b2ValidateSolverSets( world );
+	b2ValidateContacts( world );
+
+	b2TracyCZoneEnd( restore );
+
+	return true;
+}
+
+bool b2World_RestoreDelta( b2WorldId worldId, const void* base, int baseSize, const void* delta, int deltaSize )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false && world->isStepAsync == false );
+	if ( world->locked || world->isStepAsync )
+	{
+		return false;
+	}
+
+	b2SnapshotHeader baseHeader, deltaHeader;
+	if ( b2ReadHeader( world, base, baseSize, &baseHeader ) == false ||
+		 b2ReadHeader( world, delta, deltaSize, &deltaHeader ) == false )
+	{
+		return false;
+	}
+
+	// The world must still be tracking changes against the base and the delta must be written against it
+	if ( baseHeader.baseKey != 0 || baseHeader.key != world->snapshotKey || deltaHeader.baseKey != baseHeader.key )
+	{
+		return false;
+	}
+
+	b2TracyCZoneNC( restore_delta, "Restore Delta", b2_colorDarkSeaGreen, true );
+
+	// Roll the objects changed since the key frame back to the key frame
+	b2ExpandDirty( world );
+
+	b2SnapshotReader reader = { base, baseSize, (int)sizeof( baseHeader ) };
+	b2ReadTrackedState( &reader, world, world->dirtyBitSets, world->broadPhase.dirtyTrees, false );
+
+	// Then apply the delta, which leaves its objects marked as changed since the key frame
+	b2ClearDirty( world );
+
+	reader = ( b2SnapshotReader ){ delta, deltaSize, (int)sizeof( deltaHeader ) };
+	b2ReadTrackedState( &reader, world, NULL, b2AllTrees(), true );
+	b2ReadSharedState( &reader, world );
+	B2_ASSERT( reader.offset == deltaSize );
+
+	b2ClearEvents( world );
+	b2ResetInterpolation( world );
+
+	b2ValidateSolverSets( world );
+	b2ValidateContacts( world );
+
+	b2TracyCZoneEnd( restore_delta );
+
+	return true;
+}
+
+// A baked static world holds the bodies, shapes and chains of a world that only has static bodies,
+// along with the built static tree. It has no pointers, so it can be written to a file and mapped.
+#define B2_BAKE_MAGIC 0x42533242
+#define B2_BAKE_VERSION 1
+
+typedef struct b2BakeHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	int size;
+	int layoutSize;
+} b2BakeHeader;
+
+static void b2WriteBakedSensor( b2SnapshotWriter* writer, const void* element )
+{
+	const b2Sensor* sensor = element;
+	b2WriteValue( writer, sensor->shapeId );
+	b2WriteValue( writer, sensor->updateInterval );
+}
+
+// Sensors start out without overlaps, as they do when created
+static void b2ReadBakedSensor( b2SnapshotReader* reader, void* element )
+{
+	b2Sensor* sensor = element;
+	b2ReadValue( reader, sensor->shapeId );
+	b2ReadValue( reader, sensor->updateInterval );
+	sensor->proxyId = B2_NULL_INDEX;
+	b2Array_CreateN( sensor->hits, 4 );
+	b2Array_CreateN( sensor->overlaps1, 16 );
+	b2Array_CreateN( sensor->overlaps2, 16 );
+}
+
+static int b2WriteBake( b2World* world, void* buffer, int capacity )
+{
+	b2SnapshotWriter writer = { buffer, capacity, 0 };
+
+	b2BakeHeader header = {
+		.magic = B2_BAKE_MAGIC,
+		.version = B2_BAKE_VERSION,
+		.size = 0,
+		.layoutSize = b2GetSnapshotLayoutSize(),
+	};
+
+	b2WriteValue( &writer, header );
+
+	b2WriteIdPool( &writer, &world->bodyIdPool );
+	b2WriteIdPool( &writer, &world->shapeIdPool );
+	b2WriteIdPool( &writer, &world->chainIdPool );
+
+	// User data pointers are not meaningful in another process
+	b2WriteValue( &writer, world->bodies.count );
+	for ( int i = 0; i < world->bodies.count; ++i )
+	{
+		b2Body body = world->bodies.data[i];
+		body.userData = NULL;
+		b2WriteValue( &writer, body );
+	}
+
+	b2WriteValue( &writer, world->shapes.count );
+	for ( int i = 0; i < world->shapes.count; ++i )
+	{
+		b2Shape shape = world->shapes.data[i];
+		shape.userData = NULL;
+		b2WriteValue( &writer, shape );
+	}
+
+	b2WriteElements( &writer, world->chainShapes.data, world->chainShapes.count, (int)sizeof( b2ChainShape ), NULL,
+					 b2WriteChain );
+	b2WriteElements( &writer, world->sensors.data, world->sensors.count, (int)sizeof( b2Sensor ), NULL,
+					 b2WriteBakedSensor );
+
+	b2WriteArray( &writer, world->solverSets.data[b2_staticSet].bodySims );
+	b2WriteTreeSnapshot( &writer, world->broadPhase.trees + b2_staticBody );
+
+	if ( buffer != NULL && writer.size <= capacity )
+	{
+		memcpy( (uint8_t*)buffer + offsetof( b2BakeHeader, size ), &writer.size, sizeof( int ) );
+	}
+
+	return writer.size;
+}
+
+int b2World_BakeStatic( b2WorldId worldId, void* buffer, int capacity )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false && world->isStepAsync == false );
+	if ( world->locked || world->isStepAsync )
+	{
+		return 0;
+	}
+
+	// Only enabled static bodies without joints can be baked
+	int staticCount = world->solverSets.data[b2_staticSet].bodySims.count;
+	if ( staticCount != b2GetIdCount( &world->bodyIdPool ) || b2GetIdCount( &world->jointIdPool ) > 0 )
+	{
+		return 0;
+	}
+
+	// Compound shapes reference their geometry by pointer, which is not valid in another process
+	for ( int i = 0; i < world->shapes.count; ++i )
+	{
+		const b2Shape* shape = world->shapes.data + i;
+		if ( shape->id != B2_NULL_INDEX && shape->type == b2_compoundShape )
+		{
+			return 0;
+		}
+	}
+
+	// The baked tree is fully built so loading does not rebuild it
+	b2World_RebuildStaticTree( worldId );
+
+	int size = b2WriteBake( world, buffer, capacity );
+	return buffer == NULL || size <= capacity ? size : 0;
+}
+
+bool b2World_LoadStatic( b2WorldId worldId, const void* data, int size )
+{
+	b2World* world = b2GetWorldFromId( worldId );
+	B2_ASSERT( world->locked == false && world->isStepAsync == false );
+	if ( world->locked || world->isStepAsync )
+	{
+		return false;
+	}
+
+	// Baked ids are kept, so the world must not have created any bodies, shapes or chains
+	if ( world->bodies.count > 0 || world->shapes.count > 0 || world->chainShapes.count > 0 || world->sensors.count > 0 )
+	{
+		return false;
+	}
+
+	b2BakeHeader header;
+	if ( data == NULL || size < (int)sizeof( header ) )
+	{
+		return false;
+	}
+
+	memcpy( &header, data, sizeof( header ) );
+	if ( header.magic != B2_BAKE_MAGIC || header.version != B2_BAKE_VERSION || header.size != size ||
+		 header.layoutSize != b2GetSnapshotLayoutSize() )
+	{
+		return false;
+	}
+
+	b2TracyCZoneNC( load_static, "Load Static", b2_colorDarkSeaGreen, true );
+
+	b2SnapshotReader reader = { data, size, (int)sizeof( header ) };
+
+	b2ReadIdPool( &reader, &world->bodyIdPool );
+	b2ReadIdPool( &reader, &world->shapeIdPool );
+	b2ReadIdPool( &reader, &world->chainIdPool );
+
+	b2ReadArray( &reader, world->bodies );
+	b2ReadArray( &reader, world->shapes );
+
+	b2ReadFilter filter = { 0 };
+	b2ReadElementArray( &reader, world->chainShapes, &filter, b2ReadChain, b2FreeChainData );
+	b2ReadElementArray( &reader, world->sensors, &filter, b2ReadBakedSensor, b2FreeSensor );
+
+	b2ReadArray( &reader, world->solverSets.data[b2_staticSet].bodySims );
+	b2ReadTreeSnapshot( &reader, world->broadPhase.trees + b2_staticBody );
+	B2_ASSERT( reader.offset == size );
+
+	world->broadPhase.revision += 1;
+	world->broadPhase.staticRevision += 1;
+	world->broadPhase.dirtyTrees |= 1u << b2_staticBody;
+	b2MarkAllDirty( world );
+
+	b2ValidateSolverSets( world );
+
+	b2TracyCZoneEnd( load_static );
+
+	return true;
+}
+
+void b2CopyWorldState( b2World* target, b2World* source )
+{
+	B2_ASSERT( target->workerCount == source->workerCount );
+
+	b2SnapshotWriter writer = { NULL, 0, 0 };
+	b2WriteTrackedState( &writer, source, false );
+	b2WriteSharedState( &writer, source );
+
+	int size = writer.size;
+	uint8_t* buffer = b2Alloc( size );
+	writer = ( b2SnapshotWriter ){ buffer, size, 0 };
+	b2WriteTrackedState( &writer, source, false );
+	b2WriteSharedState( &writer, source );
+
+	b2SnapshotReader reader = { buffer, size, 0 };
+	b2ReadTrackedState( &reader, target, NULL, b2AllTrees(), false );
+	b2ReadSharedState( &reader, target );
+	B2_ASSERT( reader.offset == size );
+
+	b2Free( buffer, size );
+
+	b2ValidateSolverSets( target );
+	b2ValidateContacts( target );
+}
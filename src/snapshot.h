@@ -0,0 +1,50 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stdint.h>
+
+// Writes world state into a caller buffer. Once the buffer is full, or when there is no buffer,
+// the writer only counts bytes so the snapshot size is computed by the same code that writes it.
+typedef struct b2SnapshotWriter
+{
+	uint8_t* data;
+	int capacity;
+	int size;
+} b2SnapshotWriter;
+
+typedef struct b2SnapshotReader
+{
+	const uint8_t* data;
+	int size;
+	int offset;
+} b2SnapshotReader;
+
+void b2WriteBytes( b2SnapshotWriter* writer, const void* data, int byteCount );
+void b2ReadBytes( b2SnapshotReader* reader, void* data, int byteCount );
+
+#define b2WriteValue( writer, value ) b2WriteBytes( writer, &( value ), (int)sizeof( value ) )
+#define b2ReadValue( reader, value ) b2ReadBytes( reader, &( value ), (int)sizeof( value ) )
+
+// Kinds of objects tracked for delta snapshots. Each has a bit set in b2World indexed by id.
+typedef enum b2DirtyType
+{
+	b2_dirtyBody,
+	b2_dirtyShape,
+	b2_dirtyChain,
+	b2_dirtyJoint,
+	b2_dirtyContact,
+	b2_dirtyIsland,
+	b2_dirtySolverSet,
+	b2_dirtyTypeCount
+} b2DirtyType;
+
+typedef struct b2World b2World;
+
+// Treat everything as changed since the key frame, for changes that touch the whole world
+void b2MarkAllDirty( b2World* world );
+
+// Copy the simulation state of the source world into a new world with the same worker count.
+// This is the state written by a full snapshot, see b2World_Clone.
+void b2CopyWorldState( b2World* target, b2World* source );
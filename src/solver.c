@@ -7,53 +7,31 @@
 #include "atomic.h"
 #include "bitset.h"
 #include "body.h"
+#include "compound.h"
 #include "contact.h"
 #include "contact_solver.h"
 #include "core.h"
-#include "ctz.h"
 #include "island.h"
 #include "joint.h"
+#include "joint_solver.h"
 #include "parallel_for.h"
 #include "physics_world.h"
 #include "sensor.h"
 #include "shape.h"
+#include "simd.h"
 #include "solver_set.h"
 
+#include <float.h>
 #include <limits.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 
 // these are useful for solver testing
 #define ITERATIONS 1
 #define RELAX_ITERATIONS 1
 
-#if ( defined( __GNUC__ ) || defined( __clang__ ) ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
-static inline void b2Pause( void )
-{
-	__asm__ __volatile__( "pause\n" );
-}
-#elif ( defined( __arm__ ) && defined( __ARM_ARCH ) && __ARM_ARCH >= 7 ) || defined( __aarch64__ )
-static inline void b2Pause( void )
-{
-	__asm__ __volatile__( "yield" ::: "memory" );
-}
-#elif defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
-static inline void b2Pause( void )
-{
-	_mm_pause();
-}
-#elif defined( _MSC_VER ) && ( defined( _M_ARM ) || defined( _M_ARM64 ) )
-static inline void b2Pause( void )
-{
-	__yield();
-}
-#else
-static inline void b2Pause( void )
-{
-}
-#endif
-
 typedef struct b2WorkerContext
 {
 	b2StepContext* context;
@@ -61,6 +39,36 @@ typedef struct b2WorkerContext
 	void* userTask;
 } b2WorkerContext;
 
+static void b2IntegrateVelocity( const b2BodySim* sim, b2BodyState* state, b2Vec2 gravity, float h )
+{
+	b2Vec2 v = state->linearVelocity;
+	float w = state->angularVelocity;
+
+	// Apply forces, torque, gravity, and damping
+	// Apply damping.
+	// Differential equation: dv/dt + c * v = 0
+	// Solution: v(t) = v0 * exp(-c * t)
+	// Time step: v(t + dt) = v0 * exp(-c * (t + dt)) = v0 * exp(-c * t) * exp(-c * dt) = v(t) * exp(-c * dt)
+	// v2 = exp(-c * dt) * v1
+	// Pade approximation:
+	// v2 = v1 * 1 / (1 + c * dt)
+	float linearDamping = 1.0f / ( 1.0f + h * sim->linearDamping );
+	float angularDamping = 1.0f / ( 1.0f + h * sim->angularDamping );
+
+	// Gravity scale will be zero for kinematic bodies
+	float gravityScale = sim->invMass > 0.0f ? sim->gravityScale : 0.0f;
+
+	// lvd = h * im * f + h * g
+	b2Vec2 linearVelocityDelta = b2Add( b2MulSV( h * sim->invMass, sim->force ), b2MulSV( h * gravityScale, gravity ) );
+	float angularVelocityDelta = h * sim->invInertia * sim->torque;
+
+	v = b2MulAdd( linearVelocityDelta, linearDamping, v );
+	w = angularVelocityDelta + angularDamping * w;
+
+	state->linearVelocity = v;
+	state->angularVelocity = w;
+}
+
 // Integrate velocities and apply damping
 static void b2IntegrateVelocitiesTask( b2SolverBlock block, b2StepContext* context )
 {
@@ -74,42 +82,120 @@ static void b2IntegrateVelocitiesTask( b2SolverBlock block, b2StepContext* conte
 	b2Vec2 gravity = context->world->gravity;
 	float h = context->h;
 
-	for ( int i = block.startIndex; i < block.startIndex + block.count; ++i )
+	int startIndex = block.startIndex;
+	int endIndex = block.startIndex + block.count;
+	int wideEndIndex = startIndex + ( block.count / B2_SIMD_WIDTH ) * B2_SIMD_WIDTH;
+
+	// B2_SIMD_WIDTH bodies at a time with the same operations as the scalar loop below
+	b2FloatW hW = b2SplatW( h );
+	b2FloatW oneW = b2SplatW( 1.0f );
+	b2FloatW zeroW = b2ZeroW();
+	b2FloatW gravityX = b2SplatW( gravity.x );
+	b2FloatW gravityY = b2SplatW( gravity.y );
+
+	// Bodies of islands solved by their own task are skipped
+	bool skipIslands = context->islandSolveCount > 0;
+
+	for ( int i = startIndex; i < wideEndIndex; i += B2_SIMD_WIDTH )
 	{
-		b2BodySim* sim = sims + i;
-		b2BodyState* state = states + i;
+		if ( skipIslands )
+		{
+			uint32_t flags = 0;
+			for ( int lane = 0; lane < B2_SIMD_WIDTH; ++lane )
+			{
+				flags |= states[i + lane].flags;
+			}
 
-		b2Vec2 v = state->linearVelocity;
-		float w = state->angularVelocity;
+			if ( flags & b2_isIslandSolved )
+			{
+				for ( int j = i; j < i + B2_SIMD_WIDTH; ++j )
+				{
+					if ( ( states[j].flags & b2_isIslandSolved ) == 0 )
+					{
+						b2IntegrateVelocity( sims + j, states + j, gravity, h );
+					}
+				}
+				continue;
+			}
+		}
 
-		// Apply forces, torque, gravity, and damping
-		// Apply damping.
-		// Differential equation: dv/dt + c * v = 0
-		// Solution: v(t) = v0 * exp(-c * t)
-		// Time step: v(t + dt) = v0 * exp(-c * (t + dt)) = v0 * exp(-c * t) * exp(-c * dt) = v(t) * exp(-c * dt)
-		// v2 = exp(-c * dt) * v1
-		// Pade approximation:
-		// v2 = v1 * 1 / (1 + c * dt)
-		float linearDamping = 1.0f / ( 1.0f + h * sim->linearDamping );
-		float angularDamping = 1.0f / ( 1.0f + h * sim->angularDamping );
+		b2FloatW linearDamping, angularDamping, invMass, gravityScale, forceX, forceY, invInertia, torque;
+		for ( int lane = 0; lane < B2_SIMD_WIDTH; ++lane )
+		{
+			const b2BodySim* sim = sims + i + lane;
+			( (float*)&linearDamping )[lane] = sim->linearDamping;
+			( (float*)&angularDamping )[lane] = sim->angularDamping;
+			( (float*)&invMass )[lane] = sim->invMass;
+			( (float*)&gravityScale )[lane] = sim->gravityScale;
+			( (float*)&forceX )[lane] = sim->force.x;
+			( (float*)&forceY )[lane] = sim->force.y;
+			( (float*)&invInertia )[lane] = sim->invInertia;
+			( (float*)&torque )[lane] = sim->torque;
+		}
+
+		b2BodyStateW body = b2LoadBodyStates( states + i );
 
-		// Gravity scale will be zero for kinematic bodies
-		float gravityScale = sim->invMass > 0.0f ? sim->gravityScale : 0.0f;
+		b2FloatW linearDampingFactor = b2DivW( oneW, b2AddW( oneW, b2MulW( hW, linearDamping ) ) );
+		b2FloatW angularDampingFactor = b2DivW( oneW, b2AddW( oneW, b2MulW( hW, angularDamping ) ) );
+		gravityScale = b2BlendW( zeroW, gravityScale, b2GreaterThanW( invMass, zeroW ) );
 
-		// lvd = h * im * f + h * g
-		b2Vec2 linearVelocityDelta = b2Add( b2MulSV( h * sim->invMass, sim->force ), b2MulSV( h * gravityScale, gravity ) );
-		float angularVelocityDelta = h * sim->invInertia * sim->torque;
+		b2FloatW hm = b2MulW( hW, invMass );
+		b2FloatW hg = b2MulW( hW, gravityScale );
+		b2FloatW dvX = b2AddW( b2MulW( hm, forceX ), b2MulW( hg, gravityX ) );
+		b2FloatW dvY = b2AddW( b2MulW( hm, forceY ), b2MulW( hg, gravityY ) );
+		b2FloatW dw = b2MulW( b2MulW( hW, invInertia ), torque );
 
-		v = b2MulAdd( linearVelocityDelta, linearDamping, v );
-		w = angularVelocityDelta + angularDamping * w;
+		body.v.X = b2MulAddW( dvX, linearDampingFactor, body.v.X );
+		body.v.Y = b2MulAddW( dvY, linearDampingFactor, body.v.Y );
+		body.w = b2MulAddW( dw, angularDampingFactor, body.w );
 
-		state->linearVelocity = v;
-		state->angularVelocity = w;
+		b2StoreBodyStates( states + i, &body );
+	}
+
+	for ( int i = wideEndIndex; i < endIndex; ++i )
+	{
+		if ( ( states[i].flags & b2_isIslandSolved ) == 0 )
+		{
+			b2IntegrateVelocity( sims + i, states + i, gravity, h );
+		}
 	}
 
 	b2TracyCZoneEnd( integrate_velocity );
 }
 
+static void b2IntegratePosition( b2BodyState* state, float h, float maxLinearSpeed, float maxAngularSpeed,
+								 float maxLinearSpeedSquared, float maxAngularSpeedSquared )
+{
+	b2Vec2 v = state->linearVelocity;
+	float w = state->angularVelocity;
+
+	// Motion locks - these can be viewed as a constraint that comes last
+	v.x = ( state->flags & b2_lockLinearX ) ? 0.0f : v.x;
+	v.y = ( state->flags & b2_lockLinearY ) ? 0.0f : v.y;
+	w = ( state->flags & b2_lockAngularZ ) ? 0.0f : w;
+
+	// Clamp to max linear speed
+	if ( b2Dot( v, v ) > maxLinearSpeedSquared )
+	{
+		float ratio = maxLinearSpeed / b2Length( v );
+		v = b2MulSV( ratio, v );
+		state->flags |= b2_isSpeedCapped;
+	}
+
+	// Clamp to max angular speed
+	if ( w * w > maxAngularSpeedSquared && ( state->flags & b2_allowFastRotation ) == 0 )
+	{
+		float ratio = maxAngularSpeed / b2AbsFloat( w );
+		w *= ratio;
+		state->flags |= b2_isSpeedCapped;
+	}
+
+	state->linearVelocity = v;
+	state->angularVelocity = w;
+	state->deltaPosition = b2MulAdd( state->deltaPosition, h, state->linearVelocity );
+	state->deltaRotation = b2FastIntegrateRotation( state->deltaRotation, h * state->angularVelocity );
+}
+
 static void b2IntegratePositionsTask( b2SolverBlock block, b2StepContext* context )
 {
 	b2TracyCZoneNC( integrate_positions, "IntPos", b2_colorDarkSeaGreen, true );
@@ -123,38 +209,58 @@ static void b2IntegratePositionsTask( b2SolverBlock block, b2StepContext* contex
 	float maxLinearSpeedSquared = maxLinearSpeed * maxLinearSpeed;
 	float maxAngularSpeedSquared = maxAngularSpeed * maxAngularSpeed;
 
-	for ( int i = block.startIndex; i < block.startIndex + block.count; ++i )
-	{
-		b2BodyState* state = states + i;
-
-		b2Vec2 v = state->linearVelocity;
-		float w = state->angularVelocity;
+	int startIndex = block.startIndex;
+	int endIndex = block.startIndex + block.count;
+	int wideEndIndex = startIndex + ( block.count / B2_SIMD_WIDTH ) * B2_SIMD_WIDTH;
 
-		// Motion locks - these can be viewed as a constraint that comes last
-		v.x = ( state->flags & b2_lockLinearX ) ? 0.0f : v.x;
-		v.y = ( state->flags & b2_lockLinearY ) ? 0.0f : v.y;
-		w = ( state->flags & b2_lockAngularZ ) ? 0.0f : w;
+	b2FloatW hW = b2SplatW( h );
+	b2FloatW maxLinearSpeedSquaredW = b2SplatW( maxLinearSpeedSquared );
+	b2FloatW maxAngularSpeedSquaredW = b2SplatW( maxAngularSpeedSquared );
+	// Bodies of islands solved by their own task take the scalar path, which skips them
+	const uint32_t lockFlags = b2_lockLinearX | b2_lockLinearY | b2_lockAngularZ | b2_isIslandSolved;
 
-		// Clamp to max linear speed
-		if ( b2Dot( v, v ) > maxLinearSpeedSquared )
+	int i = startIndex;
+	while ( i < endIndex )
+	{
+		// B2_SIMD_WIDTH bodies at a time unless one of them is locked or needs its speed clamped
+		if ( i < wideEndIndex )
 		{
-			float ratio = maxLinearSpeed / b2Length( v );
-			v = b2MulSV( ratio, v );
-			state->flags |= b2_isSpeedCapped;
+			uint32_t flags = 0;
+			for ( int lane = 0; lane < B2_SIMD_WIDTH; ++lane )
+			{
+				flags |= states[i + lane].flags;
+			}
+
+			if ( ( flags & lockFlags ) == 0 )
+			{
+				b2BodyStateW body = b2LoadBodyStates( states + i );
+				b2FloatW linearSpeedSquared = b2AddW( b2MulW( body.v.X, body.v.X ), b2MulW( body.v.Y, body.v.Y ) );
+				b2FloatW angularSpeedSquared = b2MulW( body.w, body.w );
+				b2FloatW fast = b2OrW( b2GreaterThanW( linearSpeedSquared, maxLinearSpeedSquaredW ),
+									   b2GreaterThanW( angularSpeedSquared, maxAngularSpeedSquaredW ) );
+
+				if ( b2AllZeroW( fast ) )
+				{
+					body.dp.X = b2MulAddW( body.dp.X, hW, body.v.X );
+					body.dp.Y = b2MulAddW( body.dp.Y, hW, body.v.Y );
+					body.dq = b2FastIntegrateRotationW( body.dq, b2MulW( hW, body.w ) );
+					b2StoreBodyStates( states + i, &body );
+					i += B2_SIMD_WIDTH;
+					continue;
+				}
+			}
 		}
 
-		// Clamp to max angular speed
-		if ( w * w > maxAngularSpeedSquared && ( state->flags & b2_allowFastRotation ) == 0 )
+		int groupEndIndex = i < wideEndIndex ? i + B2_SIMD_WIDTH : endIndex;
+		for ( ; i < groupEndIndex; ++i )
 		{
-			float ratio = maxAngularSpeed / b2AbsFloat( w );
-			w *= ratio;
-			state->flags |= b2_isSpeedCapped;
-		}
+			if ( states[i].flags & b2_isIslandSolved )
+			{
+				continue;
+			}
 
-		state->linearVelocity = v;
-		state->angularVelocity = w;
-		state->deltaPosition = b2MulAdd( state->deltaPosition, h, state->linearVelocity );
-		state->deltaRotation = b2IntegrateRotation( state->deltaRotation, h * state->angularVelocity );
+			b2IntegratePosition( states + i, h, maxLinearSpeed, maxAngularSpeed, maxLinearSpeedSquared, maxAngularSpeedSquared );
+		}
 	}
 
 	b2TracyCZoneEnd( integrate_positions );
@@ -162,22 +268,42 @@ static void b2IntegratePositionsTask( b2SolverBlock block, b2StepContext* contex
 
 #define B2_MAX_CONTINUOUS_SENSOR_HITS 8
 
+// A fast body in a continuous collision batch
+typedef struct b2ContinuousBody
+{
+	b2Sweep sweep;
+	int simIndex;
+
+	// Candidate pair range. Indexes the pair array of the gathering worker and then the flattened pair array.
+	int workerIndex;
+	int pairStart;
+	int pairCount;
+} b2ContinuousBody;
+
+typedef struct b2ContinuousBatch
+{
+	b2World* world;
+	b2BodySim* sims;
+	b2BodyState* states;
+	b2ContinuousBody* bodies;
+	b2ContinuousPair* pairs;
+	float marginTime;
+} b2ContinuousBatch;
+
 struct b2ContinuousContext
 {
 	b2World* world;
 	b2BodySim* fastBodySim;
 	b2Shape* fastShape;
 	b2Vec2 centroid1, centroid2;
-	b2Sweep sweep;
-	float fraction;
-	b2SensorHit sensorHits[B2_MAX_CONTINUOUS_SENSOR_HITS];
-	float sensorFractions[B2_MAX_CONTINUOUS_SENSOR_HITS];
-	int sensorCount;
+	b2TaskContext* taskContext;
+	int bodyIndex;
 };
 
 #define B2_CORE_FRACTION 0.25f
 
-// This is called from b2DynamicTree_Query for continuous collision
+// This is called from b2DynamicTree_Query for continuous collision. It gathers the candidate pairs
+// and leaves the time of impact to b2ContinuousTimeOfImpactTask.
 static bool b2ContinuousQueryCallback( int proxyId, uint64_t userData, void* context )
 {
 	B2_UNUSED( proxyId );
@@ -240,16 +366,10 @@ static bool b2ContinuousQueryCallback( int proxyId, uint64_t userData, void* con
 	// Custom user filtering
 	if ( shape->enableCustomFiltering || fastShape->enableCustomFiltering )
 	{
-		b2CustomFilterFcn* customFilterFcn = world->customFilterFcn;
-		if ( customFilterFcn != NULL )
+		canCollide = b2CustomFilterShapes( world, shape, fastShape );
+		if ( canCollide == false )
 		{
-			b2ShapeId idA = { shape->id + 1, world->worldId, shape->generation };
-			b2ShapeId idB = { fastShape->id + 1, world->worldId, fastShape->generation };
-			canCollide = customFilterFcn( idA, idB, world->customFilterContext );
-			if ( canCollide == false )
-			{
-				return true;
-			}
+			return true;
 		}
 	}
 
@@ -306,297 +426,621 @@ static bool b2ContinuousQueryCallback( int proxyId, uint64_t userData, void* con
 	}
 #endif
 
-	b2TOIInput input;
-	input.proxyA = b2MakeShapeDistanceProxy( shape );
-	input.proxyB = b2MakeShapeDistanceProxy( fastShape );
-	input.sweepA = b2MakeSweep( bodySim );
-	input.sweepB = continuousContext->sweep;
-	input.maxFraction = continuousContext->fraction;
-
-	b2TOIOutput output = b2TimeOfImpact( &input );
-	if ( isSensor )
-	{
-		// Only accept a sensor hit that is sooner than the current solid hit.
-		if ( output.fraction <= continuousContext->fraction && continuousContext->sensorCount < B2_MAX_CONTINUOUS_SENSOR_HITS )
-		{
-			int index = continuousContext->sensorCount;
-
-			// The hit shape is a sensor
-			b2SensorHit sensorHit = {
-				.sensorId = shape->id,
-				.visitorId = fastShape->id,
-			};
-
-			continuousContext->sensorHits[index] = sensorHit;
-			continuousContext->sensorFractions[index] = output.fraction;
-			continuousContext->sensorCount += 1;
-		}
-	}
-	else
-	{
-		float hitFraction = continuousContext->fraction;
-		bool didHit = false;
-
-		if ( 0.0f < output.fraction && output.fraction < continuousContext->fraction )
-		{
-			hitFraction = output.fraction;
-			didHit = true;
-		}
-		else if ( 0.0f == output.fraction )
-		{
-			// fallback to TOI of a small circle around the fast shape centroid
-			b2Vec2 centroid = b2GetShapeCentroid( fastShape );
-			b2ShapeExtent extent = b2ComputeShapeExtent( fastShape, centroid );
-			float radius = B2_CORE_FRACTION * extent.minExtent;
-			input.proxyB = b2MakeProxy( &centroid, 1, radius );
-			output = b2TimeOfImpact( &input );
-			if ( 0.0f < output.fraction && output.fraction < continuousContext->fraction )
-			{
-				hitFraction = output.fraction;
-				didHit = true;
-			}
-		}
-
-		if ( didHit && ( shape->enablePreSolveEvents || fastShape->enablePreSolveEvents ) && world->preSolveFcn != NULL )
-		{
-			b2ShapeId shapeIdA = { shape->id + 1, world->worldId, shape->generation };
-			b2ShapeId shapeIdB = { fastShape->id + 1, world->worldId, fastShape->generation };
-			didHit = world->preSolveFcn( shapeIdA, shapeIdB, output.point, output.normal, world->preSolveContext );
-		}
+	b2ContinuousPair pair = {
+		.bodyIndex = continuousContext->bodyIndex,
+		.fastShapeId = fastShape->id,
+		.shapeId = shapeId,
+		.fraction = 1.0f,
+		.cache = b2_emptySimplexCache,
+	};
 
-		if ( didHit )
-		{
-			fastBodySim->flags |= b2_hadTimeOfImpact;
-			continuousContext->fraction = hitFraction;
-		}
-	}
+	b2Array_Push( continuousContext->taskContext->continuousPairs, pair );
 
 	// Continue query
 	return true;
 }
 
-// Continuous collision of dynamic versus static
-static void b2SolveContinuous( b2World* world, int bodySimIndex, b2TaskContext* taskContext )
+// Sweeps the shapes of the fast bodies and gathers the candidate pairs per body
+static void b2ContinuousGatherTask( int startIndex, int endIndex, int workerIndex, void* context )
 {
-	b2TracyCZoneNC( ccd, "CCD", b2_colorDarkGoldenRod, true );
-
-	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
-	b2BodySim* fastBodySim = b2Array_Get( awakeSet->bodySims, bodySimIndex );
-	B2_ASSERT( fastBodySim->flags & b2_isFast );
-
-	b2Sweep sweep = b2MakeSweep( fastBodySim );
+	b2TracyCZoneNC( ccd_gather, "CCD Gather", b2_colorDarkGoldenRod, true );
 
-	b2Transform xf1;
-	xf1.q = sweep.q1;
-	xf1.p = b2Sub( sweep.c1, b2RotateVector( sweep.q1, sweep.localCenter ) );
-
-	b2Transform xf2;
-	xf2.q = sweep.q2;
-	xf2.p = b2Sub( sweep.c2, b2RotateVector( sweep.q2, sweep.localCenter ) );
+	b2ContinuousBatch* batch = context;
+	b2World* world = batch->world;
+	b2TaskContext* taskContext = world->taskContexts.data + workerIndex;
 
 	b2DynamicTree* staticTree = world->broadPhase.trees + b2_staticBody;
 	b2DynamicTree* kinematicTree = world->broadPhase.trees + b2_kinematicBody;
 	b2DynamicTree* dynamicTree = world->broadPhase.trees + b2_dynamicBody;
-	b2Body* fastBody = b2Array_Get( world->bodies, fastBodySim->bodyId );
 
-	struct b2ContinuousContext context = { 0 };
-	context.world = world;
-	context.sweep = sweep;
-	context.fastBodySim = fastBodySim;
-	context.fraction = 1.0f;
+	for ( int bodyIndex = startIndex; bodyIndex < endIndex; ++bodyIndex )
+	{
+		b2ContinuousBody* continuousBody = batch->bodies + bodyIndex;
+		b2BodySim* fastBodySim = batch->sims + continuousBody->simIndex;
+		B2_ASSERT( fastBodySim->flags & b2_isFast );
+
+		b2Sweep sweep = b2MakeSweep( fastBodySim );
+		continuousBody->sweep = sweep;
+		continuousBody->workerIndex = workerIndex;
+		continuousBody->pairStart = taskContext->continuousPairs.count;
 
-	bool isBullet = ( fastBodySim->flags & b2_isBullet ) != 0;
+		b2Transform xf1;
+		xf1.q = sweep.q1;
+		xf1.p = b2Sub( sweep.c1, b2RotateVector( sweep.q1, sweep.localCenter ) );
 
-	int shapeId = fastBody->headShapeId;
-	while ( shapeId != B2_NULL_INDEX )
-	{
-		b2Shape* fastShape = b2Array_Get( world->shapes, shapeId );
-		shapeId = fastShape->nextShapeId;
+		b2Transform xf2;
+		xf2.q = sweep.q2;
+		xf2.p = b2Sub( sweep.c2, b2RotateVector( sweep.q2, sweep.localCenter ) );
 
-		context.fastShape = fastShape;
-		context.centroid1 = b2TransformPoint( xf1, fastShape->localCentroid );
-		context.centroid2 = b2TransformPoint( xf2, fastShape->localCentroid );
+		b2Body* fastBody = b2Array_Get( world->bodies, fastBodySim->bodyId );
 
-		b2AABB box1 = fastShape->aabb;
-		b2AABB box2 = b2ComputeShapeAABB( fastShape, xf2 );
+		struct b2ContinuousContext queryContext = { 0 };
+		queryContext.world = world;
+		queryContext.fastBodySim = fastBodySim;
+		queryContext.taskContext = taskContext;
+		queryContext.bodyIndex = bodyIndex;
 
-		// Store this to avoid double computation in the case there is no impact event
-		fastShape->aabb = box2;
+		bool isBullet = ( fastBodySim->flags & b2_isBullet ) != 0;
 
-		// No continuous collision for sensors (but still need the updated bounds)
-		if ( fastShape->sensorIndex != B2_NULL_INDEX )
+		int shapeId = fastBody->headShapeId;
+		while ( shapeId != B2_NULL_INDEX )
 		{
-			continue;
-		}
+			b2Shape* fastShape = b2Array_Get( world->shapes, shapeId );
+			shapeId = fastShape->nextShapeId;
 
-		b2AABB sweptBox = b2AABB_Union( box1, box2 );
+			queryContext.fastShape = fastShape;
+			queryContext.centroid1 = b2TransformPoint( xf1, fastShape->localCentroid );
+			queryContext.centroid2 = b2TransformPoint( xf2, fastShape->localCentroid );
 
-		b2DynamicTree_Query( staticTree, sweptBox, B2_DEFAULT_MASK_BITS, b2ContinuousQueryCallback, &context );
+			b2AABB box1 = fastShape->aabb;
+			b2AABB box2 = b2ComputeShapeAABB( fastShape, xf2 );
 
-		if ( isBullet )
-		{
-			b2DynamicTree_Query( kinematicTree, sweptBox, B2_DEFAULT_MASK_BITS, b2ContinuousQueryCallback, &context );
-			b2DynamicTree_Query( dynamicTree, sweptBox, B2_DEFAULT_MASK_BITS, b2ContinuousQueryCallback, &context );
+			// Store this to avoid double computation in the case there is no impact event
+			fastShape->aabb = box2;
+
+			// No continuous collision for sensors (but still need the updated bounds)
+			if ( fastShape->sensorIndex != B2_NULL_INDEX )
+			{
+				continue;
+			}
+
+			b2AABB sweptBox = b2AABB_Union( box1, box2 );
+			uint64_t maskBits = b2GetFilterQueryMask( fastShape->filter );
+
+			b2DynamicTree_Query( staticTree, sweptBox, maskBits, b2ContinuousQueryCallback, &queryContext );
+
+			if ( isBullet )
+			{
+				b2DynamicTree_Query( kinematicTree, sweptBox, maskBits, b2ContinuousQueryCallback, &queryContext );
+				b2DynamicTree_Query( dynamicTree, sweptBox, maskBits, b2ContinuousQueryCallback, &queryContext );
+			}
 		}
+
+		continuousBody->pairCount = taskContext->continuousPairs.count - continuousBody->pairStart;
 	}
 
-	const float speculativeDistance = B2_SPECULATIVE_DISTANCE;
+	b2TracyCZoneEnd( ccd_gather );
+}
+
+static void b2CountTimeOfImpact( b2DetailedCounters* counters, const b2TOIOutput* output )
+{
+	counters->toiIterations[b2GetCounterBucket( output->distanceIterations )] += 1;
+	counters->gjkIterations[b2GetCounterBucket( output->gjkIterations )] += 1;
+}
 
-	if ( context.fraction < 1.0f )
+// Small circle around the centroid of a fast shape child, used when the shapes start out overlapped
+static b2ShapeProxy b2MakeCoreProxy( const b2Shape* shape, int childIndex )
+{
+	if ( shape->type == b2_compoundShape )
 	{
-		// Handle time of impact event
-		b2Rot q = b2NLerp( sweep.q1, sweep.q2, context.fraction );
-		b2Vec2 c = b2Lerp( sweep.c1, sweep.c2, context.fraction );
-		b2Vec2 origin = b2Sub( c, b2RotateVector( q, sweep.localCenter ) );
+		const b2Polygon* polygon = shape->compound->polygons + childIndex;
+		float minExtent = B2_HUGE;
+		for ( int i = 0; i < polygon->count; ++i )
+		{
+			float planeOffset = b2Dot( polygon->normals[i], b2Sub( polygon->vertices[i], polygon->centroid ) );
+			minExtent = b2MinFloat( minExtent, planeOffset );
+		}
 
-		// Advance body
-		b2Transform transform = { origin, q };
-		fastBodySim->transform = transform;
-		fastBodySim->center = c;
-		fastBodySim->rotation0 = q;
-		fastBodySim->center0 = c;
+		return b2MakeProxy( &polygon->centroid, 1, B2_CORE_FRACTION * ( minExtent + polygon->radius ) );
+	}
 
-		// Update body move event
-		b2BodyMoveEvent* event = b2Array_Get( world->bodyMoveEvents, bodySimIndex );
-		event->transform = transform;
+	b2Vec2 centroid = b2GetShapeCentroid( shape );
+	b2ShapeExtent extent = b2ComputeShapeExtent( shape, centroid );
+	return b2MakeProxy( &centroid, 1, B2_CORE_FRACTION * extent.minExtent );
+}
 
-		// Prepare AABBs for broad-phase.
-		// Even though a body is fast, it may not move much. So the AABB may not need enlargement.
+// Earliest time of impact over the child pairs of two shapes where one is a compound. This doesn't
+// use the separating axis cache because the closest children change over the sweep.
+static b2TOIOutput b2CompoundTimeOfImpact( b2TOIInput* input, const b2Shape* shape, const b2Shape* fastShape, bool useCore,
+										   b2DetailedCounters* counters )
+{
+	b2TOIOutput result = { 0 };
+	result.state = b2_toiStateSeparated;
+	result.fraction = input->maxFraction;
 
-		shapeId = fastBody->headShapeId;
-		while ( shapeId != B2_NULL_INDEX )
+	int childCount = b2GetShapeChildCount( shape );
+	int fastChildCount = b2GetShapeChildCount( fastShape );
+	for ( int i = 0; i < childCount; ++i )
+	{
+		input->proxyA = b2MakeShapeChildProxy( shape, i );
+		for ( int j = 0; j < fastChildCount; ++j )
 		{
-			b2Shape* shape = b2Array_Get( world->shapes, shapeId );
-
-			// Must recompute aabb at the interpolated transform
-			b2AABB aabb = b2ComputeShapeAABB( shape, transform );
-			aabb.lowerBound.x -= speculativeDistance;
-			aabb.lowerBound.y -= speculativeDistance;
-			aabb.upperBound.x += speculativeDistance;
-			aabb.upperBound.y += speculativeDistance;
-			shape->aabb = aabb;
+			input->proxyB = useCore ? b2MakeCoreProxy( fastShape, j ) : b2MakeShapeChildProxy( fastShape, j );
 
-			if ( b2AABB_Contains( shape->fatAABB, aabb ) == false )
+			b2TOIOutput output = b2TimeOfImpact( input );
+			if ( counters != NULL )
 			{
-				float margin = shape->aabbMargin;
-				b2AABB fatAABB;
-				fatAABB.lowerBound.x = aabb.lowerBound.x - margin;
-				fatAABB.lowerBound.y = aabb.lowerBound.y - margin;
-				fatAABB.upperBound.x = aabb.upperBound.x + margin;
-				fatAABB.upperBound.y = aabb.upperBound.y + margin;
-				shape->fatAABB = fatAABB;
-
-				shape->enlargedAABB = true;
-				fastBodySim->flags |= b2_enlargeBounds;
+				b2CountTimeOfImpact( counters, &output );
 			}
 
-			shapeId = shape->nextShapeId;
+			if ( output.fraction < result.fraction )
+			{
+				result = output;
+			}
 		}
 	}
-	else
-	{
-		// No time of impact event
 
-		// Advance body
-		fastBodySim->rotation0 = fastBodySim->transform.q;
-		fastBodySim->center0 = fastBodySim->center;
+	return result;
+}
 
-		// Prepare AABBs for broad-phase
-		shapeId = fastBody->headShapeId;
-		while ( shapeId != B2_NULL_INDEX )
-		{
-			b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+// Computes the time of impact of each candidate pair over the full sweep
+static void b2ContinuousTimeOfImpactTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	b2TracyCZoneNC( ccd_toi, "CCD TOI", b2_colorDarkGoldenRod, true );
 
-			// shape->aabb is still valid from above
+	b2ContinuousBatch* batch = context;
+	b2World* world = batch->world;
+	bool enableCache = world->enableContinuousCache;
+	b2DetailedCounters* counters =
+		world->enableDetailedCounters ? &world->taskContexts.data[workerIndex].detailedCounters : NULL;
 
-			if ( b2AABB_Contains( shape->fatAABB, shape->aabb ) == false )
+	for ( int pairIndex = startIndex; pairIndex < endIndex; ++pairIndex )
+	{
+		b2ContinuousPair* pair = batch->pairs + pairIndex;
+		b2Shape* shape = b2Array_Get( world->shapes, pair->shapeId );
+		b2Shape* fastShape = b2Array_Get( world->shapes, pair->fastShapeId );
+		b2Body* body = b2Array_Get( world->bodies, shape->bodyId );
+		b2BodySim* bodySim = b2GetBodySim( world, body );
+
+		// The fast body is only written in b2ContinuousFinishTask
+		if ( enableCache )
+		{
+			b2Body* fastBody = b2Array_Get( world->bodies, fastShape->bodyId );
+			if ( fastBody->toiShapeId == pair->shapeId && fastBody->toiFastShapeId == pair->fastShapeId )
 			{
-				float margin = shape->aabbMargin;
-				b2AABB fatAABB;
-				fatAABB.lowerBound.x = shape->aabb.lowerBound.x - margin;
-				fatAABB.lowerBound.y = shape->aabb.lowerBound.y - margin;
-				fatAABB.upperBound.x = shape->aabb.upperBound.x + margin;
-				fatAABB.upperBound.y = shape->aabb.upperBound.y + margin;
-				shape->fatAABB = fatAABB;
+				pair->cache = fastBody->toiCache;
+			}
+		}
+
+		bool isCompound = shape->type == b2_compoundShape || fastShape->type == b2_compoundShape;
 
-				shape->enlargedAABB = true;
-				fastBodySim->flags |= b2_enlargeBounds;
+		b2TOIInput input;
+		input.sweepA = b2MakeSweep( bodySim );
+		input.sweepB = batch->bodies[pair->bodyIndex].sweep;
+		input.maxFraction = 1.0f;
+
+		b2TOIOutput output;
+		if ( isCompound )
+		{
+			output = b2CompoundTimeOfImpact( &input, shape, fastShape, false, counters );
+		}
+		else
+		{
+			input.proxyA = b2MakeShapeDistanceProxy( shape );
+			input.proxyB = b2MakeShapeDistanceProxy( fastShape );
+			output = b2TimeOfImpactCached( &input, &pair->cache );
+			if ( counters != NULL )
+			{
+				b2CountTimeOfImpact( counters, &output );
 			}
+		}
 
-			shapeId = shape->nextShapeId;
+		if ( shape->sensorIndex != B2_NULL_INDEX )
+		{
+			// The hit is only reported if it is sooner than the solid hit of the fast body
+			pair->fraction = output.fraction;
+			continue;
 		}
-	}
 
-	// Push sensor hits on the the task context for serial processing.
-	for ( int i = 0; i < context.sensorCount; ++i )
-	{
-		// Skip any sensor hits that occurred after a solid hit
-		if ( context.sensorFractions[i] < context.fraction )
+		float hitFraction = 1.0f;
+		bool didHit = false;
+
+		if ( 0.0f < output.fraction && output.fraction < 1.0f )
+		{
+			hitFraction = output.fraction;
+			didHit = true;
+		}
+		else if ( 0.0f == output.fraction )
+		{
+			// fallback to TOI of a small circle around the fast shape centroid
+			if ( isCompound )
+			{
+				output = b2CompoundTimeOfImpact( &input, shape, fastShape, true, counters );
+			}
+			else
+			{
+				input.proxyB = b2MakeCoreProxy( fastShape, 0 );
+				output = b2TimeOfImpact( &input );
+				if ( counters != NULL )
+				{
+					b2CountTimeOfImpact( counters, &output );
+				}
+			}
+			if ( 0.0f < output.fraction && output.fraction < 1.0f )
+			{
+				hitFraction = output.fraction;
+				didHit = true;
+			}
+		}
+
+		if ( didHit && ( shape->enablePreSolveEvents || fastShape->enablePreSolveEvents ) )
 		{
-			b2Array_Push( taskContext->sensorHits, context.sensorHits[i] );
+			didHit = b2PreSolveShapes( world, shape, fastShape, output.point, output.normal );
 		}
+
+		pair->fraction = didHit ? hitFraction : 1.0f;
 	}
 
-	b2TracyCZoneEnd( ccd );
+	b2TracyCZoneEnd( ccd_toi );
 }
 
-// Implements b2ParallelForCallback
-static void b2FinalizeBodiesTask( int startIndex, int endIndex, int workerIndex, void* context )
+// Time the fat AABBs are swept ahead with velocity margins, zero for size based margins
+static float b2GetMarginTime( const b2StepContext* stepContext )
 {
-	b2TracyCZoneNC( finalize_transforms, "Finalize", b2_colorMediumSeaGreen, true );
+	return stepContext->world->enableVelocityMargins ? B2_MARGIN_LOOKAHEAD_STEPS * stepContext->dt : 0.0f;
+}
 
-	b2StepContext* stepContext = context;
-	b2World* world = stepContext->world;
-	b2Body* bodies = world->bodies.data;
-	b2BodyState* states = stepContext->states;
-	b2BodySim* sims = stepContext->sims;
+// Computes a new fat AABB for shape bounds that left the old one. With velocity margins the margin shrinks
+// with the speed of the body, down to the speculative distance for a resting body, and the box is extended
+// along the displacement predicted for the margin time. Otherwise the margin only depends on the shape size.
+static b2AABB b2ComputeFatAABB( const b2Shape* shape, b2AABB aabb, b2Vec2 velocity, float marginTime )
+{
+	float margin = shape->aabbMargin;
+	b2Vec2 sweep = b2Vec2_zero;
 
-	B2_ASSERT( endIndex <= world->bodyMoveEvents.count );
+	if ( marginTime > 0.0f )
+	{
+		sweep = b2MulSV( marginTime, velocity );
+		float length = b2Length( sweep );
+		if ( length > B2_MAX_MARGIN_SWEEP )
+		{
+			sweep = b2MulSV( B2_MAX_MARGIN_SWEEP / length, sweep );
+			length = B2_MAX_MARGIN_SWEEP;
+		}
 
-	bool enableSleep = world->enableSleep;
-	bool enableContinuous = world->enableContinuous;
-	float timeStep = stepContext->dt;
-	float invTimeStep = stepContext->inv_dt;
-	uint16_t worldId = world->worldId;
+		// Cannot be zero due to TOI tolerance
+		margin = b2MinFloat( margin, b2MaxFloat( length, shape->speculativeDistance ) );
+	}
 
-	// The body move event array should already have the correct size
-	b2BodyMoveEvent* moveEvents = world->bodyMoveEvents.data;
+	b2AABB fatAABB;
+	fatAABB.lowerBound.x = aabb.lowerBound.x - margin + b2MinFloat( sweep.x, 0.0f );
+	fatAABB.lowerBound.y = aabb.lowerBound.y - margin + b2MinFloat( sweep.y, 0.0f );
+	fatAABB.upperBound.x = aabb.upperBound.x + margin + b2MaxFloat( sweep.x, 0.0f );
+	fatAABB.upperBound.y = aabb.upperBound.y + margin + b2MaxFloat( sweep.y, 0.0f );
+	return fatAABB;
+}
 
-	b2TaskContext* taskContext = world->taskContexts.data + workerIndex;
-	b2BitSet* enlargedSimBitSet = &taskContext->enlargedSimBitSet;
-	b2BitSet* awakeIslandBitSet = &taskContext->awakeIslandBitSet;
+// Advances each fast body to its earliest time of impact and prepares the shape bounds for the broad-phase
+static void b2ContinuousFinishTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	b2TracyCZoneNC( ccd_finish, "CCD Finish", b2_colorDarkGoldenRod, true );
 
-	const float speculativeDistance = B2_SPECULATIVE_DISTANCE;
+	b2ContinuousBatch* batch = context;
+	b2World* world = batch->world;
+	b2TaskContext* taskContext = world->taskContexts.data + workerIndex;
 
-	for ( int simIndex = startIndex; simIndex < endIndex; ++simIndex )
+	for ( int bodyIndex = startIndex; bodyIndex < endIndex; ++bodyIndex )
 	{
-		b2BodyState* state = states + simIndex;
-		b2BodySim* sim = sims + simIndex;
-
-		b2Vec2 v = state->linearVelocity;
-		float w = state->angularVelocity;
+		b2ContinuousBody* continuousBody = batch->bodies + bodyIndex;
+		int bodySimIndex = continuousBody->simIndex;
+		b2BodySim* fastBodySim = batch->sims + bodySimIndex;
+		b2Vec2 velocity = batch->states[bodySimIndex].linearVelocity;
+		b2Body* fastBody = b2Array_Get( world->bodies, fastBodySim->bodyId );
+		b2Sweep sweep = continuousBody->sweep;
+
+		const b2ContinuousPair* pairs = batch->pairs + continuousBody->pairStart;
+		int pairCount = continuousBody->pairCount;
+
+		// The earliest solid hit wins. The minimum does not depend on the pair order.
+		float fraction = 1.0f;
+		int hitIndex = B2_NULL_INDEX;
+		for ( int i = 0; i < pairCount; ++i )
+		{
+			b2Shape* shape = b2Array_Get( world->shapes, pairs[i].shapeId );
+			if ( shape->sensorIndex == B2_NULL_INDEX && pairs[i].fraction < fraction )
+			{
+				fraction = pairs[i].fraction;
+				hitIndex = i;
+			}
+		}
 
-		if ( b2IsValidVec2( v ) == false || b2IsValidFloat( w ) == false )
+		// Keep the simplex of the earliest hit for the next sweep
+		if ( hitIndex != B2_NULL_INDEX )
 		{
-			b2Body* debugBody = bodies + sim->bodyId;
-			b2Log( "unstable: %s\n", debugBody->name );
+			fastBody->toiShapeId = pairs[hitIndex].shapeId;
+			fastBody->toiFastShapeId = pairs[hitIndex].fastShapeId;
+			fastBody->toiCache = pairs[hitIndex].cache;
+		}
+		else
+		{
+			fastBody->toiShapeId = B2_NULL_INDEX;
 		}
 
-		B2_ASSERT( b2IsValidVec2( v ) );
-		B2_ASSERT( b2IsValidFloat( w ) );
+		if ( fraction < 1.0f )
+		{
+			fastBodySim->flags |= b2_hadTimeOfImpact;
 
-		sim->center = b2Add( sim->center, state->deltaPosition );
-		sim->transform.q = b2NormalizeRot( b2MulRot( state->deltaRotation, sim->transform.q ) );
+			// Handle time of impact event
+			b2Rot q = b2NLerp( sweep.q1, sweep.q2, fraction );
+			b2Vec2 c = b2Lerp( sweep.c1, sweep.c2, fraction );
+			b2Vec2 origin = b2Sub( c, b2RotateVector( q, sweep.localCenter ) );
 
-		// Use the velocity of the farthest point on the body to account for rotation.
-		float maxVelocity = b2Length( v ) + b2AbsFloat( w ) * sim->maxExtent;
+			// Advance body
+			b2Transform transform = { origin, q };
+			fastBodySim->transform = transform;
+			fastBodySim->center = c;
+			fastBodySim->rotation0 = q;
+			fastBodySim->center0 = c;
 
-		// Sleep needs to observe position correction as well as true velocity.
-		float maxDeltaPosition = b2Length( state->deltaPosition ) + b2AbsFloat( state->deltaRotation.s ) * sim->maxExtent;
+			// Update body move event
+			b2BodyMoveEvent* event = b2Array_Get( world->bodyMoveEvents, bodySimIndex );
+			event->transform = transform;
 
-		// Position correction is not as important for sleep as true velocity.
-		float positionSleepFactor = 0.5f;
-		float sleepVelocity = b2MaxFloat( maxVelocity, positionSleepFactor * invTimeStep * maxDeltaPosition );
+			b2WriteExportSlot( world, fastBody->exportSlot, transform, velocity, batch->states[bodySimIndex].angularVelocity );
+
+			// Prepare AABBs for broad-phase.
+			// Even though a body is fast, it may not move much. So the AABB may not need enlargement.
+
+			int shapeId = fastBody->headShapeId;
+			while ( shapeId != B2_NULL_INDEX )
+			{
+				b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+
+				// Must recompute aabb at the interpolated transform
+				const float speculativeDistance = shape->speculativeDistance;
+				b2AABB aabb = b2ComputeShapeAABB( shape, transform );
+				aabb.lowerBound.x -= speculativeDistance;
+				aabb.lowerBound.y -= speculativeDistance;
+				aabb.upperBound.x += speculativeDistance;
+				aabb.upperBound.y += speculativeDistance;
+				shape->aabb = aabb;
+
+				if ( b2AABB_Contains( shape->fatAABB, aabb ) == false )
+				{
+					shape->fatAABB = b2ComputeFatAABB( shape, aabb, velocity, batch->marginTime );
+
+					shape->enlargedAABB = true;
+					fastBodySim->flags |= b2_enlargeBounds;
+				}
+
+				shapeId = shape->nextShapeId;
+			}
+		}
+		else
+		{
+			// No time of impact event
+
+			// Advance body
+			fastBodySim->rotation0 = fastBodySim->transform.q;
+			fastBodySim->center0 = fastBodySim->center;
+
+			// Prepare AABBs for broad-phase
+			int shapeId = fastBody->headShapeId;
+			while ( shapeId != B2_NULL_INDEX )
+			{
+				b2Shape* shape = b2Array_Get( world->shapes, shapeId );
+
+				// shape->aabb is still valid from the gather
+
+				if ( b2AABB_Contains( shape->fatAABB, shape->aabb ) == false )
+				{
+					shape->fatAABB = b2ComputeFatAABB( shape, shape->aabb, velocity, batch->marginTime );
+
+					shape->enlargedAABB = true;
+					fastBodySim->flags |= b2_enlargeBounds;
+				}
+
+				shapeId = shape->nextShapeId;
+			}
+		}
+
+		// Push sensor hits on the the task context for serial processing.
+		int sensorCount = 0;
+		for ( int i = 0; i < pairCount && sensorCount < B2_MAX_CONTINUOUS_SENSOR_HITS; ++i )
+		{
+			b2Shape* shape = b2Array_Get( world->shapes, pairs[i].shapeId );
+
+			// Skip any sensor hits that occurred after a solid hit
+			if ( shape->sensorIndex != B2_NULL_INDEX && pairs[i].fraction < fraction )
+			{
+				b2SensorHit sensorHit = {
+					.sensorId = pairs[i].shapeId,
+					.visitorId = pairs[i].fastShapeId,
+				};
+
+				b2Array_Push( taskContext->sensorHits, sensorHit );
+				sensorCount += 1;
+			}
+		}
+	}
+
+	b2TracyCZoneEnd( ccd_finish );
+}
+
+// Continuous collision of fast bodies versus static bodies, and of bullets versus all non-bullet bodies.
+// The candidate pairs of all bodies are gathered first and the time of impact work is split by pair,
+// so a single body sweeping through dense geometry is spread across the workers.
+static void b2SolveContinuous( b2World* world, b2StepContext* stepContext, const int* bodySimIndices, int bodyCount )
+{
+	b2TracyCZoneNC( ccd, "CCD", b2_colorDarkGoldenRod, true );
+
+	int workerCount = world->workerCount;
+	for ( int i = 0; i < workerCount; ++i )
+	{
+		b2Array_Clear( world->taskContexts.data[i].continuousPairs );
+	}
+
+	b2ContinuousBody* bodies = b2StackAlloc( &world->stack, bodyCount * sizeof( b2ContinuousBody ), "continuous bodies" );
+	for ( int i = 0; i < bodyCount; ++i )
+	{
+		bodies[i].simIndex = bodySimIndices[i];
+	}
+
+	b2ContinuousBatch batch = { world, stepContext->sims, stepContext->states, bodies, NULL, b2GetMarginTime( stepContext ) };
+	b2ParallelFor( world, b2ContinuousGatherTask, bodyCount, 8, &batch );
+
+	int pairCount = 0;
+	for ( int i = 0; i < bodyCount; ++i )
+	{
+		pairCount += bodies[i].pairCount;
+	}
+
+	// Flatten the pairs in body order
+	b2ContinuousPair* pairs = b2StackAlloc( &world->stack, pairCount * sizeof( b2ContinuousPair ), "continuous pairs" );
+	int pairStart = 0;
+	for ( int i = 0; i < bodyCount; ++i )
+	{
+		b2ContinuousBody* continuousBody = bodies + i;
+		const b2ContinuousPair* workerPairs =
+			world->taskContexts.data[continuousBody->workerIndex].continuousPairs.data + continuousBody->pairStart;
+		if ( continuousBody->pairCount > 0 )
+		{
+			memcpy( pairs + pairStart, workerPairs, continuousBody->pairCount * sizeof( b2ContinuousPair ) );
+		}
+
+		continuousBody->pairStart = pairStart;
+		pairStart += continuousBody->pairCount;
+	}
+
+	batch.pairs = pairs;
+
+	if ( pairCount > 0 )
+	{
+		b2ParallelFor( world, b2ContinuousTimeOfImpactTask, pairCount, 4, &batch );
+	}
+
+	b2ParallelFor( world, b2ContinuousFinishTask, bodyCount, 8, &batch );
+
+	b2StackFree( &world->stack, pairs );
+	b2StackFree( &world->stack, bodies );
+
+	b2TracyCZoneEnd( ccd );
+}
+
+// Sleep velocities of B2_SIMD_WIDTH consecutive bodies
+typedef struct b2SleepVelocitiesW
+{
+	// Velocity of the farthest point on the body
+	b2FloatW maxVelocity;
+
+	// Position correction of the farthest point on the body
+	b2FloatW maxDeltaPosition;
+
+	// Velocity compared against the sleep threshold
+	b2FloatW sleepVelocity;
+} b2SleepVelocitiesW;
+
+// Computes the sleep velocities of up to B2_SIMD_WIDTH bodies. Same operation order as the scalar math so
+// the result does not depend on the SIMD width. Unused lanes are zero.
+static b2SleepVelocitiesW b2ComputeSleepVelocitiesW( const b2BodyState* states, const b2BodySim* sims, int count,
+													 float invTimeStep )
+{
+	b2FloatW vx = b2ZeroW(), vy = b2ZeroW(), w = b2ZeroW(), dx = b2ZeroW(), dy = b2ZeroW(), ds = b2ZeroW();
+	b2FloatW extent = b2ZeroW();
+	for ( int lane = 0; lane < count; ++lane )
+	{
+		const b2BodyState* state = states + lane;
+		( (float*)&vx )[lane] = state->linearVelocity.x;
+		( (float*)&vy )[lane] = state->linearVelocity.y;
+		( (float*)&w )[lane] = state->angularVelocity;
+		( (float*)&dx )[lane] = state->deltaPosition.x;
+		( (float*)&dy )[lane] = state->deltaPosition.y;
+		( (float*)&ds )[lane] = state->deltaRotation.s;
+		( (float*)&extent )[lane] = sims[lane].maxExtent;
+	}
+
+	b2FloatW absW = b2MaxW( w, b2NegW( w ) );
+	b2FloatW absS = b2MaxW( ds, b2NegW( ds ) );
+
+	b2SleepVelocitiesW result;
+	result.maxVelocity = b2AddW( b2SqrtW( b2AddW( b2MulW( vx, vx ), b2MulW( vy, vy ) ) ), b2MulW( absW, extent ) );
+	result.maxDeltaPosition = b2AddW( b2SqrtW( b2AddW( b2MulW( dx, dx ), b2MulW( dy, dy ) ) ), b2MulW( absS, extent ) );
+
+	// Position correction is not as important for sleep as true velocity.
+	const float positionSleepFactor = 0.5f;
+	b2FloatW positionScale = b2SplatW( positionSleepFactor * invTimeStep );
+	result.sleepVelocity = b2MaxW( result.maxVelocity, b2MulW( positionScale, result.maxDeltaPosition ) );
+	return result;
+}
+
+// Implements b2ParallelForCallback
+static void b2FinalizeBodiesTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	b2TracyCZoneNC( finalize_transforms, "Finalize", b2_colorMediumSeaGreen, true );
+
+	b2StepContext* stepContext = context;
+	b2World* world = stepContext->world;
+	b2Body* bodies = world->bodies.data;
+	b2BodyState* states = stepContext->states;
+	b2BodySim* sims = stepContext->sims;
+
+	B2_ASSERT( endIndex <= world->bodyMoveEvents.count );
+
+	bool enableSleep = world->enableSleep;
+	bool enableContinuous = world->enableContinuous;
+	bool deferContinuous = stepContext->deferContinuous;
+	bool enableAdaptiveRelax = world->enableAdaptiveRelax;
+	float timeStep = stepContext->dt;
+	float invTimeStep = stepContext->inv_dt;
+	uint16_t worldId = world->worldId;
+
+	// The body move event array should already have the correct size
+	b2BodyMoveEvent* moveEvents = world->bodyMoveEvents.data;
+	b2Transform* previousTransforms = world->enableInterpolation ? world->previousTransforms.data : NULL;
+
+	b2TaskContext* taskContext = world->taskContexts.data + workerIndex;
+	b2BitSet* enlargedSimBitSet = &taskContext->enlargedSimBitSet;
+	b2BitSet* awakeIslandBitSet = &taskContext->awakeIslandBitSet;
+
+	b2SleepVelocitiesW sleepVelocities = { 0 };
+	for ( int simIndex = startIndex; simIndex < endIndex; ++simIndex )
+	{
+		b2BodyState* state = states + simIndex;
+		b2BodySim* sim = sims + simIndex;
+
+		// The sleep velocities are computed a block ahead, before the deltas are reset below
+		int lane = ( simIndex - startIndex ) % B2_SIMD_WIDTH;
+		if ( lane == 0 )
+		{
+			int blockCount = b2MinInt( B2_SIMD_WIDTH, endIndex - simIndex );
+			sleepVelocities = b2ComputeSleepVelocitiesW( state, sim, blockCount, invTimeStep );
+		}
+
+		b2Vec2 v = state->linearVelocity;
+		float w = state->angularVelocity;
+
+		if ( b2IsValidVec2( v ) == false || b2IsValidFloat( w ) == false )
+		{
+			b2Body* debugBody = bodies + sim->bodyId;
+			b2Log( "unstable: %s\n", debugBody->name );
+		}
+
+		B2_ASSERT( b2IsValidVec2( v ) );
+		B2_ASSERT( b2IsValidFloat( w ) );
+
+		if ( previousTransforms != NULL )
+		{
+			previousTransforms[sim->bodyId] = sim->transform;
+		}
+
+		sim->center = b2Add( sim->center, state->deltaPosition );
+		sim->transform.q = b2FastNormalizeRot( b2MulRot( state->deltaRotation, sim->transform.q ) );
+
+		// Use the velocity of the farthest point on the body to account for rotation. Sleep needs to observe
+		// position correction as well as true velocity.
+		float maxVelocity = ( (float*)&sleepVelocities.maxVelocity )[lane];
+		float maxDeltaPosition = ( (float*)&sleepVelocities.maxDeltaPosition )[lane];
+		float sleepVelocity = ( (float*)&sleepVelocities.sleepVelocity )[lane];
 
 		// reset state deltas
 		state->deltaPosition = b2Vec2_zero;
@@ -612,6 +1056,9 @@ static void b2FinalizeBodiesTask( int startIndex, int endIndex, int workerIndex,
 		moveEvents[simIndex].userData = body->userData;
 		moveEvents[simIndex].fellAsleep = false;
 
+		// A fast body is written again if continuous collision moves it back
+		b2WriteExportSlot( world, body->exportSlot, sim->transform, v, w );
+
 		// reset applied force and torque
 		sim->force = b2Vec2_zero;
 		sim->torque = 0.0f;
@@ -623,7 +1070,12 @@ static void b2FinalizeBodiesTask( int startIndex, int endIndex, int workerIndex,
 		body->flags |= ( sim->flags & ( b2_isSpeedCapped | b2_hadTimeOfImpact ) );
 		body->flags |= ( state->flags & ( b2_isSpeedCapped | b2_hadTimeOfImpact ) );
 		sim->flags &= ~( b2_isFast | b2_isSpeedCapped | b2_hadTimeOfImpact );
-		state->flags &= ~( b2_isFast | b2_isSpeedCapped | b2_hadTimeOfImpact );
+		state->flags &= ~( b2_isFast | b2_isSpeedCapped | b2_hadTimeOfImpact | b2_isResting | b2_isIslandSolved );
+
+		if ( enableAdaptiveRelax && sleepVelocity <= body->sleepThreshold )
+		{
+			state->flags |= b2_isResting;
+		}
 
 		if ( enableSleep == false || body->enableSleep == false || sleepVelocity > body->sleepThreshold )
 		{
@@ -632,7 +1084,8 @@ static void b2FinalizeBodiesTask( int startIndex, int endIndex, int workerIndex,
 
 			const float safetyFactor = 0.5f;
 			float maxMotion = b2MaxFloat( maxDeltaPosition, maxVelocity * timeStep );
-			if ( body->type == b2_dynamicBody && enableContinuous && maxMotion > safetyFactor * sim->minExtent )
+			bool continuous = enableContinuous && ( deferContinuous == false || ( sim->flags & b2_isBullet ) );
+			if ( body->type == b2_dynamicBody && continuous && maxMotion > safetyFactor * sim->minExtent )
 			{
 				// This flag is only retained for debug draw
 				sim->flags |= b2_isFast;
@@ -646,7 +1099,8 @@ static void b2FinalizeBodiesTask( int startIndex, int endIndex, int workerIndex,
 				}
 				else
 				{
-					b2SolveContinuous( world, simIndex, taskContext );
+					int fastIndex = b2AtomicFetchAddInt( &stepContext->fastBodyCount, 1 );
+					stepContext->fastBodies[fastIndex] = simIndex;
 				}
 			}
 			else
@@ -671,20 +1125,22 @@ static void b2FinalizeBodiesTask( int startIndex, int endIndex, int workerIndex,
 			// keep island awake
 			int islandIndex = island->localIndex;
 			b2SetBit( awakeIslandBitSet, islandIndex );
+
+			// A moving kinematic body alone in its island can leave the constraint solver
+			if ( body->type == b2_kinematicBody && body->headJointKey == B2_NULL_INDEX && island->bodies.count == 1 &&
+				 island->contacts.count == 0 && body->simulationInterval == 1 )
+			{
+				b2Array_Push( taskContext->kinematicBodyIds, sim->bodyId );
+			}
 		}
 		else if ( island->constraintRemoveCount > 0 )
 		{
-			// body wants to sleep but its island needs splitting first
-			if ( body->sleepTime > taskContext->splitSleepTime )
-			{
-				// pick the sleepiest candidate
-				taskContext->splitIslandId = body->islandId;
-				taskContext->splitSleepTime = body->sleepTime;
-			}
+			// body wants to sleep but its island needs splitting first, keep the sleepiest candidates
+			b2AddSplitCandidate( taskContext->splitCandidates, &taskContext->splitCandidateCount, world->maxIslandSplits,
+								 body->islandId, body->sleepTime );
 		}
 
-		// Update shapes AABBs
-		b2Transform transform = sim->transform;
+		// Queue shape AABB updates for b2UpdateShapeAABBsTask
 		bool isFast = ( sim->flags & b2_isFast ) != 0;
 		int shapeId = body->headShapeId;
 		while ( shapeId != B2_NULL_INDEX )
@@ -693,8 +1149,8 @@ static void b2FinalizeBodiesTask( int startIndex, int endIndex, int workerIndex,
 
 			if ( isFast )
 			{
-				// For fast non-bullet bodies the AABB has already been updated in b2SolveContinuous
-				// For fast bullet bodies the AABB will be updated at a later stage
+				// For fast bodies the AABB will be updated in b2SolveContinuous. Fast non-bullet bodies are
+				// handled right after finalization and fast bullet bodies after the broad-phase update.
 
 				// Add to enlarged shapes regardless of AABB changes.
 				// Bit-set to keep the move array sorted
@@ -702,30 +1158,8 @@ static void b2FinalizeBodiesTask( int startIndex, int endIndex, int workerIndex,
 			}
 			else
 			{
-				b2AABB aabb = b2ComputeShapeAABB( shape, transform );
-				aabb.lowerBound.x -= speculativeDistance;
-				aabb.lowerBound.y -= speculativeDistance;
-				aabb.upperBound.x += speculativeDistance;
-				aabb.upperBound.y += speculativeDistance;
-				shape->aabb = aabb;
-
-				B2_ASSERT( shape->enlargedAABB == false );
-
-				if ( b2AABB_Contains( shape->fatAABB, aabb ) == false )
-				{
-					float margin = shape->aabbMargin;
-					b2AABB fatAABB;
-					fatAABB.lowerBound.x = aabb.lowerBound.x - margin;
-					fatAABB.lowerBound.y = aabb.lowerBound.y - margin;
-					fatAABB.upperBound.x = aabb.upperBound.x + margin;
-					fatAABB.upperBound.y = aabb.upperBound.y + margin;
-					shape->fatAABB = fatAABB;
-
-					shape->enlargedAABB = true;
-
-					// Bit-set to keep the move array sorted
-					b2SetBit( enlargedSimBitSet, simIndex );
-				}
+				b2ShapeAABBUpdate update = { shapeId, simIndex };
+				b2Array_Push( taskContext->aabbUpdates[shape->type], update );
 			}
 
 			shapeId = shape->nextShapeId;
@@ -735,108 +1169,424 @@ static void b2FinalizeBodiesTask( int startIndex, int endIndex, int workerIndex,
 	b2TracyCZoneEnd( finalize_transforms );
 }
 
-typedef struct b2BlockDim
+typedef struct b2ShapeAABBContext
 {
-	// number of items per block (except last block)
-	int size;
+	b2World* world;
+	b2BodySim* sims;
+	b2BodyState* states;
+	const b2ShapeAABBUpdate* updates;
+	float marginTime;
 
-	// total number of blocks
-	int count;
-} b2BlockDim;
+	// Updates are sorted by shape type, the updates of type i are in [typeStarts[i], typeStarts[i + 1])
+	int typeStarts[b2_shapeTypeCount + 1];
+} b2ShapeAABBContext;
 
-// A block is a range of tasks, a start index and count as a sub-array. Each worker receives at
-// most M blocks of work. The workers may receive less blocks if there is not sufficient work.
-// Each block of work has a minimum number of elements (block size). This in turn may limit the
-// number of blocks. If there are many elements then the block size is increased so there are
-// still at most M blocks of work per worker. M is a tunable number that has two goals:
-// 1. keep M small to reduce overhead
-// 2. keep M large enough for other workers to be able to steal work
-// The block size is a power of two to make math efficient.
-static inline b2BlockDim b2ComputeBlockCount( int itemCount, int minSize, int maxBlockCount )
+// Adds the speculative distance and enlarges the fat AABB if needed. Returns true if the fat AABB was enlarged.
+static bool b2EnlargeShapeAABB( b2Shape* shape, b2AABB aabb, b2Vec2 velocity, float marginTime )
 {
-	b2BlockDim dim = { 0 };
-	if ( itemCount == 0 )
-	{
-		return dim;
-	}
+	const float speculativeDistance = shape->speculativeDistance;
 
-	if ( itemCount <= minSize * maxBlockCount )
-	{
-		dim.size = minSize;
-	}
-	else
-	{
-		dim.size = ( itemCount + maxBlockCount - 1 ) / maxBlockCount;
-	}
+	aabb.lowerBound.x -= speculativeDistance;
+	aabb.lowerBound.y -= speculativeDistance;
+	aabb.upperBound.x += speculativeDistance;
+	aabb.upperBound.y += speculativeDistance;
+	shape->aabb = aabb;
 
-	dim.count = ( itemCount + dim.size - 1 ) / dim.size;
+	B2_ASSERT( shape->enlargedAABB == false );
 
-	B2_ASSERT( dim.count >= 1 );
-	B2_ASSERT( dim.size * dim.count >= itemCount );
+	if ( b2AABB_Contains( shape->fatAABB, aabb ) == false )
+	{
+		shape->fatAABB = b2ComputeFatAABB( shape, aabb, velocity, marginTime );
+		shape->enlargedAABB = true;
+		return true;
+	}
 
-	return dim;
+	return false;
 }
 
-// Initialize solver blocks for a contiguous range of items. Computes block size internally
-// from the same parameters used by b2ComputeBlockCount. The atomic claim counter is zeroed
-// so workers can CAS (0, 1) on the first stage that owns these blocks.
-static void b2InitBlocks( b2SyncBlock* blocks, b2BlockDim dim, int itemCount, uint8_t blockType, uint8_t colorIndex )
+static void b2StoreShapeAABB( b2Shape* shape, b2AABB aabb, int simIndex, const b2ShapeAABBContext* context,
+							  b2BitSet* enlargedSimBitSet )
 {
-	if ( dim.count == 0 )
+	if ( b2EnlargeShapeAABB( shape, aabb, context->states[simIndex].linearVelocity, context->marginTime ) )
 	{
-		return;
+		// Bit-set to keep the move array sorted
+		b2SetBit( enlargedSimBitSet, simIndex );
 	}
+}
 
-	B2_ASSERT( itemCount >= dim.count );
-
-	// Compute the number of elements per block
-	int blockSize = dim.size;
-
-	// Simulation too big
-	B2_ASSERT( blockSize <= UINT16_MAX );
+// Same operation order as b2TransformPoint
+static inline b2Vec2W b2TransformPointW( b2FloatW px, b2FloatW py, b2FloatW c, b2FloatW s, b2FloatW x, b2FloatW y )
+{
+	b2Vec2W v;
+	v.X = b2AddW( b2SubW( b2MulW( c, x ), b2MulW( s, y ) ), px );
+	v.Y = b2AddW( b2AddW( b2MulW( s, x ), b2MulW( c, y ) ), py );
+	return v;
+}
 
-	for ( int i = 0; i < dim.count; ++i )
+// Stores the wide AABBs of B2_SIMD_WIDTH shapes
+static void b2StoreShapeAABBsW( b2Shape* shapes, const b2ShapeAABBContext* context, const b2ShapeAABBUpdate* updates,
+								b2Vec2W lower, b2Vec2W upper, b2BitSet* enlargedSimBitSet )
+{
+	for ( int lane = 0; lane < B2_SIMD_WIDTH; ++lane )
 	{
-		blocks[i].block.startIndex = i * blockSize;
-		blocks[i].block.count = (uint16_t)blockSize;
-		blocks[i].block.blockType = blockType;
-		blocks[i].block.colorIndex = colorIndex;
-		b2AtomicStoreInt( &blocks[i].syncIndex, 0 );
+		b2AABB aabb;
+		aabb.lowerBound.x = ( (float*)&lower.X )[lane];
+		aabb.lowerBound.y = ( (float*)&lower.Y )[lane];
+		aabb.upperBound.x = ( (float*)&upper.X )[lane];
+		aabb.upperBound.y = ( (float*)&upper.Y )[lane];
+		b2StoreShapeAABB( shapes + updates[lane].shapeId, aabb, updates[lane].simIndex, context, enlargedSimBitSet );
 	}
-
-	// The last block may not be full
-	blocks[dim.count - 1].block.count = (uint16_t)( itemCount - ( dim.count - 1 ) * blockSize );
-
-	B2_VALIDATE( blocks[dim.count - 1].block.count <= blockSize );
-	B2_VALIDATE( ( dim.count - 1 ) * dim.size + blocks[dim.count - 1].block.count == itemCount );
 }
 
-static inline b2SolverStage* b2InitStage( b2SolverStage* stage, b2SolverStageType type, b2SyncBlock* blocks, int blockCount,
-										  uint8_t colorIndex )
+static void b2UpdateCircleAABBs( b2Shape* shapes, const b2ShapeAABBContext* context, const b2ShapeAABBUpdate* updates,
+								 int count, b2BitSet* enlargedSimBitSet )
 {
-	stage->type = type;
-	stage->blocks = blocks;
-	stage->blockCount = blockCount;
-	stage->colorIndex = colorIndex;
-	b2AtomicStoreInt( &stage->completionCount, 0 );
-	return stage + 1;
+	b2BodySim* sims = context->sims;
+	int wideCount = count - count % B2_SIMD_WIDTH;
+	for ( int i = 0; i < wideCount; i += B2_SIMD_WIDTH )
+	{
+		b2FloatW px, py, c, s, cx, cy, r;
+		for ( int lane = 0; lane < B2_SIMD_WIDTH; ++lane )
+		{
+			const b2Shape* shape = shapes + updates[i + lane].shapeId;
+			b2Transform xf = sims[updates[i + lane].simIndex].transform;
+			( (float*)&px )[lane] = xf.p.x;
+			( (float*)&py )[lane] = xf.p.y;
+			( (float*)&c )[lane] = xf.q.c;
+			( (float*)&s )[lane] = xf.q.s;
+			( (float*)&cx )[lane] = shape->circle.center.x;
+			( (float*)&cy )[lane] = shape->circle.center.y;
+			( (float*)&r )[lane] = shape->circle.radius;
+		}
+
+		b2Vec2W p = b2TransformPointW( px, py, c, s, cx, cy );
+		b2Vec2W lower = { b2SubW( p.X, r ), b2SubW( p.Y, r ) };
+		b2Vec2W upper = { b2AddW( p.X, r ), b2AddW( p.Y, r ) };
+		b2StoreShapeAABBsW( shapes, context, updates + i, lower, upper, enlargedSimBitSet );
+	}
+
+	for ( int i = wideCount; i < count; ++i )
+	{
+		b2Shape* shape = shapes + updates[i].shapeId;
+		b2AABB aabb = b2ComputeCircleAABB( &shape->circle, sims[updates[i].simIndex].transform );
+		b2StoreShapeAABB( shape, aabb, updates[i].simIndex, context, enlargedSimBitSet );
+	}
 }
 
-// Initialize one stage per color for each iteration. Used for warm start, solve, relax, and restitution.
-// All iterations of a given color share the same b2SyncBlock array so the per-block syncIndex
-// grows monotonically across stages within that color.
-static b2SolverStage* b2InitColorStages( b2SolverStage* stage, b2SolverStageType type, int iterations, int activeColorCount,
-										 b2SyncBlock** colorBlocks, int* colorBlockCounts, int* activeColorIndices )
+static void b2UpdateCapsuleAABBs( b2Shape* shapes, const b2ShapeAABBContext* context, const b2ShapeAABBUpdate* updates,
+								  int count, b2BitSet* enlargedSimBitSet )
 {
-	for ( int j = 0; j < iterations; ++j )
+	b2BodySim* sims = context->sims;
+	int wideCount = count - count % B2_SIMD_WIDTH;
+	for ( int i = 0; i < wideCount; i += B2_SIMD_WIDTH )
 	{
-		for ( int i = 0; i < activeColorCount; ++i )
+		b2FloatW px, py, c, s, x1, y1, x2, y2, r;
+		for ( int lane = 0; lane < B2_SIMD_WIDTH; ++lane )
 		{
-			stage = b2InitStage( stage, type, colorBlocks[i], colorBlockCounts[i], (uint8_t)activeColorIndices[i] );
+			const b2Shape* shape = shapes + updates[i + lane].shapeId;
+			b2Transform xf = sims[updates[i + lane].simIndex].transform;
+			( (float*)&px )[lane] = xf.p.x;
+			( (float*)&py )[lane] = xf.p.y;
+			( (float*)&c )[lane] = xf.q.c;
+			( (float*)&s )[lane] = xf.q.s;
+			( (float*)&x1 )[lane] = shape->capsule.center1.x;
+			( (float*)&y1 )[lane] = shape->capsule.center1.y;
+			( (float*)&x2 )[lane] = shape->capsule.center2.x;
+			( (float*)&y2 )[lane] = shape->capsule.center2.y;
+			( (float*)&r )[lane] = shape->capsule.radius;
 		}
+
+		b2Vec2W v1 = b2TransformPointW( px, py, c, s, x1, y1 );
+		b2Vec2W v2 = b2TransformPointW( px, py, c, s, x2, y2 );
+		b2Vec2W lower = { b2SubW( b2MinW( v1.X, v2.X ), r ), b2SubW( b2MinW( v1.Y, v2.Y ), r ) };
+		b2Vec2W upper = { b2AddW( b2MaxW( v1.X, v2.X ), r ), b2AddW( b2MaxW( v1.Y, v2.Y ), r ) };
+		b2StoreShapeAABBsW( shapes, context, updates + i, lower, upper, enlargedSimBitSet );
 	}
-	return stage;
-}
+
+	for ( int i = wideCount; i < count; ++i )
+	{
+		b2Shape* shape = shapes + updates[i].shapeId;
+		b2AABB aabb = b2ComputeCapsuleAABB( &shape->capsule, sims[updates[i].simIndex].transform );
+		b2StoreShapeAABB( shape, aabb, updates[i].simIndex, context, enlargedSimBitSet );
+	}
+}
+
+static void b2UpdatePolygonAABBs( b2Shape* shapes, const b2ShapeAABBContext* context, const b2ShapeAABBUpdate* updates,
+								  int count, b2BitSet* enlargedSimBitSet )
+{
+	b2BodySim* sims = context->sims;
+	int wideCount = count - count % B2_SIMD_WIDTH;
+	for ( int i = 0; i < wideCount; i += B2_SIMD_WIDTH )
+	{
+		const b2Polygon* polygons[B2_SIMD_WIDTH];
+		b2FloatW px, py, c, s, r;
+		int maxCount = 0;
+		for ( int lane = 0; lane < B2_SIMD_WIDTH; ++lane )
+		{
+			polygons[lane] = &shapes[updates[i + lane].shapeId].polygon;
+			b2Transform xf = sims[updates[i + lane].simIndex].transform;
+			( (float*)&px )[lane] = xf.p.x;
+			( (float*)&py )[lane] = xf.p.y;
+			( (float*)&c )[lane] = xf.q.c;
+			( (float*)&s )[lane] = xf.q.s;
+			( (float*)&r )[lane] = polygons[lane]->radius;
+			maxCount = b2MaxInt( maxCount, polygons[lane]->count );
+		}
+
+		// Lanes with fewer vertices repeat their first vertex, which doesn't change the bounds
+		b2Vec2W lower, upper;
+		for ( int j = 0; j < maxCount; ++j )
+		{
+			b2FloatW x, y;
+			for ( int lane = 0; lane < B2_SIMD_WIDTH; ++lane )
+			{
+				const b2Polygon* polygon = polygons[lane];
+				b2Vec2 vertex = polygon->vertices[j < polygon->count ? j : 0];
+				( (float*)&x )[lane] = vertex.x;
+				( (float*)&y )[lane] = vertex.y;
+			}
+
+			b2Vec2W v = b2TransformPointW( px, py, c, s, x, y );
+			if ( j == 0 )
+			{
+				lower = v;
+				upper = v;
+			}
+			else
+			{
+				lower.X = b2MinW( lower.X, v.X );
+				lower.Y = b2MinW( lower.Y, v.Y );
+				upper.X = b2MaxW( upper.X, v.X );
+				upper.Y = b2MaxW( upper.Y, v.Y );
+			}
+		}
+
+		lower.X = b2SubW( lower.X, r );
+		lower.Y = b2SubW( lower.Y, r );
+		upper.X = b2AddW( upper.X, r );
+		upper.Y = b2AddW( upper.Y, r );
+		b2StoreShapeAABBsW( shapes, context, updates + i, lower, upper, enlargedSimBitSet );
+	}
+
+	for ( int i = wideCount; i < count; ++i )
+	{
+		b2Shape* shape = shapes + updates[i].shapeId;
+		b2AABB aabb = b2ComputePolygonAABB( &shape->polygon, sims[updates[i].simIndex].transform );
+		b2StoreShapeAABB( shape, aabb, updates[i].simIndex, context, enlargedSimBitSet );
+	}
+}
+
+// Implements b2ParallelForCallback. Updates the shape AABBs queued by b2FinalizeBodiesTask.
+static void b2UpdateShapeAABBsTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	b2TracyCZoneNC( update_aabbs, "Shape AABBs", b2_colorMediumSeaGreen, true );
+
+	b2ShapeAABBContext* aabbContext = context;
+	b2World* world = aabbContext->world;
+	b2Shape* shapes = world->shapes.data;
+	b2BodySim* sims = aabbContext->sims;
+	b2BitSet* enlargedSimBitSet = &world->taskContexts.data[workerIndex].enlargedSimBitSet;
+
+	for ( int type = 0; type < b2_shapeTypeCount; ++type )
+	{
+		int typeStart = b2MaxInt( startIndex, aabbContext->typeStarts[type] );
+		int typeEnd = b2MinInt( endIndex, aabbContext->typeStarts[type + 1] );
+		if ( typeStart >= typeEnd )
+		{
+			continue;
+		}
+
+		const b2ShapeAABBUpdate* updates = aabbContext->updates + typeStart;
+		int count = typeEnd - typeStart;
+
+		switch ( type )
+		{
+			case b2_circleShape:
+				b2UpdateCircleAABBs( shapes, aabbContext, updates, count, enlargedSimBitSet );
+				break;
+
+			case b2_capsuleShape:
+				b2UpdateCapsuleAABBs( shapes, aabbContext, updates, count, enlargedSimBitSet );
+				break;
+
+			case b2_polygonShape:
+				b2UpdatePolygonAABBs( shapes, aabbContext, updates, count, enlargedSimBitSet );
+				break;
+
+			default:
+				for ( int i = 0; i < count; ++i )
+				{
+					b2Shape* shape = shapes + updates[i].shapeId;
+					b2AABB aabb = b2ComputeShapeAABB( shape, sims[updates[i].simIndex].transform );
+					b2StoreShapeAABB( shape, aabb, updates[i].simIndex, aabbContext, enlargedSimBitSet );
+				}
+				break;
+		}
+	}
+
+	b2TracyCZoneEnd( update_aabbs );
+}
+
+// Gathers the per worker AABB updates into one array sorted by shape type and updates them in parallel
+static void b2UpdateShapeAABBs( b2World* world, b2StepContext* stepContext )
+{
+	b2ShapeAABBContext aabbContext;
+	aabbContext.world = world;
+	aabbContext.sims = stepContext->sims;
+	aabbContext.states = stepContext->states;
+	aabbContext.marginTime = b2GetMarginTime( stepContext );
+
+	int updateCount = 0;
+	for ( int type = 0; type < b2_shapeTypeCount; ++type )
+	{
+		aabbContext.typeStarts[type] = updateCount;
+		for ( int i = 0; i < world->workerCount; ++i )
+		{
+			updateCount += world->taskContexts.data[i].aabbUpdates[type].count;
+		}
+	}
+	aabbContext.typeStarts[b2_shapeTypeCount] = updateCount;
+
+	if ( updateCount == 0 )
+	{
+		return;
+	}
+
+	b2ShapeAABBUpdate* updates =
+		b2StackAlloc( &world->stack, updateCount * sizeof( b2ShapeAABBUpdate ), "shape aabb updates" );
+
+	// The order may vary with task scheduling. This is fine because each update only touches its own
+	// shape and the enlarged bit of its body, and the enlarged bit sets are merged afterwards.
+	int updateIndex = 0;
+	for ( int type = 0; type < b2_shapeTypeCount; ++type )
+	{
+		for ( int i = 0; i < world->workerCount; ++i )
+		{
+			b2Array( b2ShapeAABBUpdate )* workerUpdates = &world->taskContexts.data[i].aabbUpdates[type];
+			if ( workerUpdates->count > 0 )
+			{
+				memcpy( updates + updateIndex, workerUpdates->data, workerUpdates->count * sizeof( b2ShapeAABBUpdate ) );
+				updateIndex += workerUpdates->count;
+			}
+
+			b2Array_Clear( *workerUpdates );
+		}
+	}
+
+	aabbContext.updates = updates;
+
+	b2ParallelFor( world, &b2UpdateShapeAABBsTask, updateCount, 64, &aabbContext );
+
+	b2StackFree( &world->stack, updates );
+}
+
+typedef struct b2BlockDim
+{
+	// number of items per block (except last block)
+	int size;
+
+	// total number of blocks
+	int count;
+} b2BlockDim;
+
+// A block is a range of tasks, a start index and count as a sub-array. Each worker receives at
+// most M blocks of work. The workers may receive less blocks if there is not sufficient work.
+// Each block of work has a minimum number of elements (block size). This in turn may limit the
+// number of blocks. If there are many elements then the block size is increased so there are
+// still at most M blocks of work per worker. M is a tunable number that has two goals:
+// 1. keep M small to reduce overhead
+// 2. keep M large enough for other workers to be able to steal work
+// The block size is a power of two to make math efficient.
+static inline b2BlockDim b2ComputeBlockCount( int itemCount, int minSize, int maxBlockCount )
+{
+	b2BlockDim dim = { 0 };
+	if ( itemCount == 0 )
+	{
+		return dim;
+	}
+
+	if ( itemCount <= minSize * maxBlockCount )
+	{
+		dim.size = minSize;
+	}
+	else
+	{
+		dim.size = ( itemCount + maxBlockCount - 1 ) / maxBlockCount;
+	}
+
+	dim.count = ( itemCount + dim.size - 1 ) / dim.size;
+
+	B2_ASSERT( dim.count >= 1 );
+	B2_ASSERT( dim.size * dim.count >= itemCount );
+
+	return dim;
+}
+
+// Initialize solver blocks for a contiguous range of items. Computes block size internally
+// from the same parameters used by b2ComputeBlockCount. The atomic claim counter is zeroed
+// so workers can CAS (0, 1) on the first stage that owns these blocks.
+static void b2InitBlocks( b2SyncBlock* blocks, b2BlockDim dim, int itemCount, uint8_t blockType, uint8_t colorIndex )
+{
+	if ( dim.count == 0 )
+	{
+		return;
+	}
+
+	B2_ASSERT( itemCount >= dim.count );
+
+	// Compute the number of elements per block
+	int blockSize = dim.size;
+
+	// Simulation too big
+	B2_ASSERT( blockSize <= UINT16_MAX );
+
+	for ( int i = 0; i < dim.count; ++i )
+	{
+		blocks[i].block.startIndex = i * blockSize;
+		blocks[i].block.count = (uint16_t)blockSize;
+		blocks[i].block.blockType = blockType;
+		blocks[i].block.colorIndex = colorIndex;
+		b2AtomicStoreInt( &blocks[i].syncIndex, 0 );
+	}
+
+	// The last block may not be full
+	blocks[dim.count - 1].block.count = (uint16_t)( itemCount - ( dim.count - 1 ) * blockSize );
+
+	B2_VALIDATE( blocks[dim.count - 1].block.count <= blockSize );
+	B2_VALIDATE( ( dim.count - 1 ) * dim.size + blocks[dim.count - 1].block.count == itemCount );
+}
+
+static inline b2SolverStage* b2InitStage( b2SolverStage* stage, b2SolverStageType type, b2SyncBlock* blocks, int blockCount,
+										  uint8_t colorIndex )
+{
+	stage->type = type;
+	stage->blocks = blocks;
+	stage->blockCount = blockCount;
+	stage->colorIndex = colorIndex;
+	stage->runInline = false;
+	b2AtomicStoreInt( &stage->completionCount, 0 );
+	return stage + 1;
+}
+
+// Initialize one stage per color for each iteration. Used for warm start, solve, relax, and restitution.
+// All iterations of a given color share the same b2SyncBlock array so the per-block syncIndex
+// grows monotonically across stages within that color. A color runs inline in all of its stages
+// or in none, so the sync indices of its blocks stay consistent.
+static b2SolverStage* b2InitColorStages( b2SolverStage* stage, b2SolverStageType type, int iterations, int activeColorCount,
+										 b2SyncBlock** colorBlocks, int* colorBlockCounts, int* activeColorIndices,
+										 bool* inlineColors )
+{
+	for ( int j = 0; j < iterations; ++j )
+	{
+		for ( int i = 0; i < activeColorCount; ++i )
+		{
+			b2SolverStage* colorStage = stage;
+			stage = b2InitStage( stage, type, colorBlocks[i], colorBlockCounts[i], (uint8_t)activeColorIndices[i] );
+			colorStage->runInline = inlineColors[i];
+		}
+	}
+	return stage;
+}
 
 static void b2ExecuteBlock( b2SolverStage* stage, b2StepContext* context, b2SolverBlock block, int workerIndex )
 {
@@ -846,7 +1596,14 @@ static void b2ExecuteBlock( b2SolverStage* stage, b2StepContext* context, b2Solv
 	switch ( stageType )
 	{
 		case b2_stagePrepareJoints:
-			b2PrepareJointsTask( block, context );
+			if ( blockType == b2_wideJointBlock )
+			{
+				b2PrepareWideJointsTask( block, context );
+			}
+			else
+			{
+				b2PrepareJointsTask( block, context );
+			}
 			break;
 
 		case b2_stagePrepareContacts:
@@ -866,6 +1623,10 @@ static void b2ExecuteBlock( b2SolverStage* stage, b2StepContext* context, b2Solv
 			{
 				b2WarmStartJointsTask( block, context );
 			}
+			else if ( blockType == b2_graphWideJointBlock )
+			{
+				b2WarmStartWideJointsTask( block, context );
+			}
 			break;
 
 		case b2_stageSolve:
@@ -879,6 +1640,11 @@ static void b2ExecuteBlock( b2SolverStage* stage, b2StepContext* context, b2Solv
 				bool useBias = true;
 				b2SolveJointsTask( block, context, useBias, workerIndex );
 			}
+			else if ( blockType == b2_graphWideJointBlock )
+			{
+				bool useBias = true;
+				b2SolveWideJointsTask( block, context, useBias );
+			}
 			break;
 
 		case b2_stageIntegratePositions:
@@ -896,6 +1662,11 @@ static void b2ExecuteBlock( b2SolverStage* stage, b2StepContext* context, b2Solv
 				bool useBias = false;
 				b2SolveJointsTask( block, context, useBias, workerIndex );
 			}
+			else if ( blockType == b2_graphWideJointBlock )
+			{
+				bool useBias = false;
+				b2SolveWideJointsTask( block, context, useBias );
+			}
 			break;
 
 		case b2_stageRestitution:
@@ -905,9 +1676,21 @@ static void b2ExecuteBlock( b2SolverStage* stage, b2StepContext* context, b2Solv
 			}
 			break;
 
+		case b2_stageStoreJoints:
+			b2StoreWideJointsTask( block, context );
+			break;
+
 		case b2_stageStoreImpulses:
 			b2StoreImpulsesTask( block, context, workerIndex );
 			break;
+
+		case b2_stageOverflowContacts:
+			b2SolveOverflowContactsTask( block, context );
+			break;
+
+		case b2_stageOverflowBodies:
+			b2ApplyOverflowDeltasTask( block, context );
+			break;
 	}
 }
 
@@ -924,8 +1707,61 @@ static inline int GetWorkerStartIndex( int workerIndex, int blockCount, int work
 	return blocksPerWorker * workerIndex + b2MinInt( remainder, workerIndex );
 }
 
+_Static_assert( b2_stageOverflowBodies + 1 == b2_profileStageCount, "profile stages must match solver stages" );
+
+// Per worker stage profile, or null if the worker profile is disabled
+static inline b2WorkerStageProfile* b2GetStageProfile( b2StepContext* context, int workerIndex, b2SolverStageType type )
+{
+	if ( context->enableWorkerProfile == false )
+	{
+		return NULL;
+	}
+
+	return context->world->taskContexts.data[workerIndex].workerProfile.stages + type;
+}
+
 // Execute a stage, which is an array of solver blocks, each controlled with an atomic sync index.
 // Each worker starts at its home index and sweeps the ring, CAS-claiming any unclaimed blocks.
+// One iteration of a solver wait loop on a 32-bit value that is still equal to the expected value.
+// Spins for the spin budget, then yields or parks depending on the wait policy. A parked thread is
+// counted so the thread that changes the value knows to wake it.
+static void b2WaitIteration( b2StepContext* context, void* address, uint32_t expected, b2AtomicInt* parkedCount,
+							 int* spinCount )
+{
+	if ( context->waitPolicy == b2_waitSpin || *spinCount < context->waitSpinCount )
+	{
+		b2Pause();
+		b2Pause();
+		*spinCount += 1;
+		return;
+	}
+
+	*spinCount = 0;
+
+	if ( context->waitPolicy == b2_waitYield )
+	{
+		b2Yield();
+		return;
+	}
+
+	// The parked count is raised before the value is checked again in the wait. Either the signaling
+	// thread sees the count and wakes this thread, or this thread sees the new value and returns.
+	b2AtomicFetchAddInt( parkedCount, 1 );
+	b2WaitAddress( address, expected );
+	b2AtomicFetchAddInt( parkedCount, -1 );
+}
+
+// Publishes the sync bits of the next stage to the workers
+static void b2SignalWorkers( b2StepContext* context, uint32_t syncBits )
+{
+	b2AtomicStoreU32( &context->atomicSyncBits, syncBits );
+
+	if ( context->waitPolicy == b2_waitPark && b2AtomicLoadInt( &context->parkedWorkerCount ) > 0 )
+	{
+		b2WakeAddress( &context->atomicSyncBits.value );
+	}
+}
+
 static void b2ExecuteStage( b2SolverStage* stage, b2StepContext* context, int previousSyncIndex, int syncIndex, int workerIndex )
 {
 	int completedCount = 0;
@@ -940,6 +1776,10 @@ static void b2ExecuteStage( b2SolverStage* stage, b2StepContext* context, int pr
 
 	B2_ASSERT( 0 <= startIndex && startIndex < blockCount );
 
+	b2WorkerStageProfile* stageProfile = b2GetStageProfile( context, workerIndex, stage->type );
+	uint64_t ticks = stageProfile != NULL ? b2GetTicks() : 0;
+	int stolenCount = 0;
+
 	int blockIndex = startIndex;
 	for ( int i = 0; i < blockCount; ++i )
 	{
@@ -953,6 +1793,10 @@ static void b2ExecuteStage( b2SolverStage* stage, b2StepContext* context, int pr
 			b2ExecuteBlock( stage, context, blocks[blockIndex].block, workerIndex );
 			completedCount += 1;
 		}
+		else
+		{
+			stolenCount += 1;
+		}
 
 		blockIndex += 1;
 		if ( blockIndex >= blockCount )
@@ -961,7 +1805,21 @@ static void b2ExecuteStage( b2SolverStage* stage, b2StepContext* context, int pr
 		}
 	}
 
-	(void)b2AtomicFetchAddInt( &stage->completionCount, completedCount );
+	if ( stageProfile != NULL )
+	{
+		stageProfile->workTime += b2GetMilliseconds( ticks );
+		stageProfile->blockCount += completedCount;
+		stageProfile->stolenCount += stolenCount;
+	}
+
+	int previousCount = b2AtomicFetchAddInt( &stage->completionCount, completedCount );
+
+	// The main thread may be parked waiting for the last block
+	if ( context->waitPolicy == b2_waitPark && previousCount + completedCount == stage->blockCount &&
+		 b2AtomicLoadInt( &context->mainParked ) > 0 )
+	{
+		b2WakeAddress( &stage->completionCount.value );
+	}
 }
 
 // Execute a stage on worker 0 (main thread).
@@ -975,13 +1833,25 @@ static void b2ExecuteMainStage( b2SolverStage* stage, b2StepContext* context, ui
 
 	int workerIndex = 0;
 
-	if ( blockCount == 1 )
+	if ( blockCount == 1 || stage->runInline )
 	{
-		b2ExecuteBlock( stage, context, stage->blocks[0].block, workerIndex );
+		b2WorkerStageProfile* stageProfile = b2GetStageProfile( context, workerIndex, stage->type );
+		uint64_t ticks = stageProfile != NULL ? b2GetTicks() : 0;
+
+		for ( int i = 0; i < blockCount; ++i )
+		{
+			b2ExecuteBlock( stage, context, stage->blocks[i].block, workerIndex );
+		}
+
+		if ( stageProfile != NULL )
+		{
+			stageProfile->workTime += b2GetMilliseconds( ticks );
+			stageProfile->blockCount += blockCount;
+		}
 	}
 	else
 	{
-		b2AtomicStoreU32( &context->atomicSyncBits, syncBits );
+		b2SignalWorkers( context, syncBits );
 
 		int syncIndex = ( syncBits >> 16 ) & 0xFFFF;
 		B2_ASSERT( syncIndex > 0 );
@@ -989,10 +1859,23 @@ static void b2ExecuteMainStage( b2SolverStage* stage, b2StepContext* context, ui
 
 		b2ExecuteStage( stage, context, previousSyncIndex, syncIndex, workerIndex );
 
-		// Spin waiting for thieves to finish
-		while ( b2AtomicLoadInt( &stage->completionCount ) != blockCount )
+		b2WorkerStageProfile* stageProfile = b2GetStageProfile( context, workerIndex, stage->type );
+		uint64_t ticks = stageProfile != NULL ? b2GetTicks() : 0;
+
+		// Wait for thieves to finish
+		int completionCount;
+		int spinCount = 0;
+		b2TracyCWaitBegin( context->world->stageLock );
+		while ( ( completionCount = b2AtomicLoadInt( &stage->completionCount ) ) != blockCount )
+		{
+			b2WaitIteration( context, &stage->completionCount.value, (uint32_t)completionCount, &context->mainParked,
+							 &spinCount );
+		}
+		b2TracyCWaitEnd( context->world->stageLock );
+
+		if ( stageProfile != NULL )
 		{
-			b2Pause();
+			stageProfile->waitTime += b2GetMilliseconds( ticks );
 		}
 
 		b2AtomicStoreInt( &stage->completionCount, 0 );
@@ -1000,22 +1883,71 @@ static void b2ExecuteMainStage( b2SolverStage* stage, b2StepContext* context, ui
 }
 
 // Parallel solver task
-static void b2SolverTask( void* taskContext )
+// Overflow contacts are solved serially unless the parallel overflow mode is enabled. The parallel
+// mode runs the two overflow stages which are re-used by every pass, so they come last in the stage array.
+static void b2SolveOverflowContacts( b2StepContext* context, b2SolverStageType stageType, int* overflowSyncIndex )
 {
-	b2WorkerContext* workerContext = taskContext;
-	int workerIndex = workerContext->workerIndex;
-	b2StepContext* context = workerContext->context;
-	int activeColorCount = context->activeColorCount;
-	b2SolverStage* stages = context->stages;
-	b2Profile* profile = &context->world->profile;
-
-	if ( workerIndex == 0 )
+	if ( context->enableParallelOverflow == false )
 	{
-		// The orchestrator slot is a race. The calling thread of b2World_Step also enters here
-		// as worker 0, so progress is guaranteed even if the user's task system schedules tasks
-		// out of order, has fewer threads than workerCount, or runs the task synchronously
-		// inside enqueueTaskFcn. Whoever wins the CAS becomes the orchestrator; the loser
-		// returns and lets the spinner-only path handle workers >0.
+		switch ( stageType )
+		{
+			case b2_stageWarmStart:
+				b2WarmStartContacts_Overflow( context );
+				break;
+
+			case b2_stageSolve:
+				b2SolveContacts_Overflow( context, true );
+				break;
+
+			case b2_stageRelax:
+				b2SolveContacts_Overflow( context, false );
+				break;
+
+			case b2_stageRestitution:
+				b2ApplyRestitution_Overflow( context );
+				break;
+
+			default:
+				B2_ASSERT( false );
+				break;
+		}
+
+		return;
+	}
+
+	// Workers read the pass type after they see the new sync bits
+	context->overflowStage = stageType;
+
+	int stageIndex = context->stageCount - 2;
+	b2SolverStage* stages = context->stages;
+
+	uint32_t syncBits = ( *overflowSyncIndex << 16 ) | stageIndex;
+	B2_ASSERT( stages[stageIndex].type == b2_stageOverflowContacts );
+	b2ExecuteMainStage( stages + stageIndex, context, syncBits );
+
+	syncBits = ( *overflowSyncIndex << 16 ) | ( stageIndex + 1 );
+	B2_ASSERT( stages[stageIndex + 1].type == b2_stageOverflowBodies );
+	b2ExecuteMainStage( stages + stageIndex + 1, context, syncBits );
+
+	*overflowSyncIndex += 1;
+}
+
+static void b2SolverTask( void* taskContext )
+{
+	b2WorkerContext* workerContext = taskContext;
+	int workerIndex = workerContext->workerIndex;
+	b2StepContext* context = workerContext->context;
+	int activeColorCount = context->activeColorCount;
+	b2SolverStage* stages = context->stages;
+	b2Profile* profile = &context->world->profile;
+
+	if ( workerIndex == 0 )
+	{
+		// The orchestrator slot is a race. The calling thread of b2World_Step also enters here
+		// as worker 0, so progress is guaranteed even if the user's task system schedules tasks
+		// out of order, has fewer threads than workerCount, or runs the task synchronously
+		// inside enqueueTaskFcn. Whoever wins the CAS becomes the orchestrator; the loser
+		// returns and lets the spinner-only path handle workers >0.
 		if ( b2AtomicCompareExchangeInt( &context->mainClaimed, 0, 1 ) == false )
 		{
 			return;
@@ -1042,7 +1974,9 @@ static void b2SolverTask( void* taskContext )
 		b2_stageIntegratePositions,
 		b2_stageRelax,
 		b2_stageRestitution,
-		b2_stageStoreImpulses
+		b2_stageStoreJoints,
+		b2_stageStoreImpulses,
+		b2_stageOverflowContacts, b2_stageOverflowBodies (re-used by each overflow pass)
 		*/
 
 		uint64_t ticks = b2GetTicks();
@@ -1073,6 +2007,7 @@ static void b2SolverTask( void* taskContext )
 		profile->prepareConstraints += b2GetMillisecondsAndReset( &ticks );
 
 		int graphSyncIndex = 1;
+		int overflowSyncIndex = 1;
 		int subStepCount = context->subStepCount;
 		for ( int subStepIndex = 0; subStepIndex < subStepCount; ++subStepIndex )
 		{
@@ -1091,7 +2026,7 @@ static void b2SolverTask( void* taskContext )
 
 			// Warm start constraints
 			b2WarmStartJoints_Overflow( context );
-			b2WarmStartContacts_Overflow( context );
+			b2SolveOverflowContacts( context, b2_stageWarmStart, &overflowSyncIndex );
 
 			for ( int colorIndex = 0; colorIndex < activeColorCount; ++colorIndex )
 			{
@@ -1110,7 +2045,7 @@ static void b2SolverTask( void* taskContext )
 			{
 				// Overflow constraints have lower priority. Typically these are dynamic-vs-dynamic.
 				b2SolveJoints_Overflow( context, useBias );
-				b2SolveContacts_Overflow( context, useBias );
+				b2SolveOverflowContacts( context, b2_stageSolve, &overflowSyncIndex );
 
 				for ( int colorIndex = 0; colorIndex < activeColorCount; ++colorIndex )
 				{
@@ -1133,12 +2068,15 @@ static void b2SolverTask( void* taskContext )
 
 			profile->integratePositions += b2GetMillisecondsAndReset( &ticks );
 
-			// Relax constraints
+			// Relax constraints. A reduced relax skips every other sub-step, ending with the last one. A skipped
+			// stage leaves the sync indices of its blocks alone.
 			useBias = false;
-			for ( int j = 0; j < RELAX_ITERATIONS; ++j )
+			int relaxIterations = context->reduceRelax && ( subStepCount - subStepIndex ) % 2 == 0 ? 0 : RELAX_ITERATIONS;
+			iterationStageIndex += ( RELAX_ITERATIONS - relaxIterations ) * activeColorCount;
+			for ( int j = 0; j < relaxIterations; ++j )
 			{
 				b2SolveJoints_Overflow( context, useBias );
-				b2SolveContacts_Overflow( context, useBias );
+				b2SolveOverflowContacts( context, b2_stageRelax, &overflowSyncIndex );
 				for ( int colorIndex = 0; colorIndex < activeColorCount; ++colorIndex )
 				{
 					syncBits = ( graphSyncIndex << 16 ) | iterationStageIndex;
@@ -1158,7 +2096,7 @@ static void b2SolverTask( void* taskContext )
 
 		// Restitution
 		{
-			b2ApplyRestitution_Overflow( context );
+			b2SolveOverflowContacts( context, b2_stageRestitution, &overflowSyncIndex );
 
 			int iterStageIndex = stageIndex;
 			for ( int colorIndex = 0; colorIndex < activeColorCount; ++colorIndex )
@@ -1174,8 +2112,14 @@ static void b2SolverTask( void* taskContext )
 
 		profile->applyRestitution += b2GetMillisecondsAndReset( &ticks );
 
+		// Store wide joint impulses
+		syncBits = ( jointSyncIndex << 16 ) | stageIndex;
+		B2_ASSERT( stages[stageIndex].type == b2_stageStoreJoints );
+		b2ExecuteMainStage( stages + stageIndex, context, syncBits );
+		stageIndex += 1;
+
 		// Store impulses
-		b2StoreImpulses_Overflow( context );
+		b2StoreImpulses_Overflow( context, workerIndex );
 
 		syncBits = ( contactSyncIndex << 16 ) | stageIndex;
 		B2_ASSERT( stages[stageIndex].type == b2_stageStoreImpulses );
@@ -1184,84 +2128,780 @@ static void b2SolverTask( void* taskContext )
 		profile->storeImpulses += b2GetMillisecondsAndReset( &ticks );
 
 		// Signal workers to finish
-		b2AtomicStoreU32( &context->atomicSyncBits, UINT_MAX );
+		b2SignalWorkers( context, UINT_MAX );
 
-		B2_ASSERT( stageIndex + 1 == context->stageCount );
+		// The overflow stages come after the store impulses stage
+		B2_ASSERT( stageIndex + 3 == context->stageCount );
 		return;
 	}
 
-	// Worker spins and waits for work
+	// Worker waits for work
 	uint32_t lastSyncBits = 0;
-	// uint64_t maxSpinTime = 10;
 	while ( true )
 	{
-		// Spin until main thread bumps changes the sync bits. This can waste significant time overall, but it is necessary for
-		// parallel simulation with graph coloring.
-		// todo improve this spinner
+		// Wait until main thread bumps changes the sync bits. Spinning can waste significant time overall, but
+		// it is necessary for parallel simulation with graph coloring. See b2WaitPolicy.
 		uint32_t syncBits;
 		int spinCount = 0;
+		uint64_t waitTicks = context->enableWorkerProfile ? b2GetTicks() : 0;
+		b2TracyCWaitBegin( context->world->syncLock );
 		while ( ( syncBits = b2AtomicLoadU32( &context->atomicSyncBits ) ) == lastSyncBits )
 		{
-			if ( spinCount > 5 )
+			b2WaitIteration( context, &context->atomicSyncBits.value, lastSyncBits, &context->parkedWorkerCount,
+							 &spinCount );
+		}
+		b2TracyCWaitEnd( context->world->syncLock );
+
+		if ( syncBits == UINT_MAX )
+		{
+			// sentinel hit
+			break;
+		}
+
+		int stageIndex = syncBits & 0xFFFF;
+		B2_ASSERT( stageIndex < context->stageCount );
+
+		int syncIndex = ( syncBits >> 16 ) & 0xFFFF;
+		B2_ASSERT( syncIndex > 0 );
+
+		int previousSyncIndex = syncIndex - 1;
+
+		b2SolverStage* stage = stages + stageIndex;
+
+		// The wait is charged to the stage that ended it
+		b2WorkerStageProfile* stageProfile = b2GetStageProfile( context, workerIndex, stage->type );
+		if ( stageProfile != NULL )
+		{
+			stageProfile->waitTime += b2GetMilliseconds( waitTicks );
+		}
+
+		b2ExecuteStage( stage, context, previousSyncIndex, syncIndex, workerIndex );
+
+		lastSyncBits = syncBits;
+	}
+}
+
+static int b2CompareIds( const void* a, const void* b )
+{
+	int idA = *(const int*)a;
+	int idB = *(const int*)b;
+	return idA < idB ? -1 : ( idA > idB ? 1 : 0 );
+}
+
+// Orders the hit events by contact id so they do not depend on which worker stored which contact
+static int b2CompareHitEvents( const void* a, const void* b )
+{
+	int idA = ( (const b2ContactHitEvent*)a )->contactId.index1;
+	int idB = ( (const b2ContactHitEvent*)b )->contactId.index1;
+	return idA < idB ? -1 : ( idA > idB ? 1 : 0 );
+}
+
+// Bodies woken from a parked set are simulated in scaled time to cover the skipped steps. Velocities
+// are scaled by the time scale k and accelerations by k squared. Forces are impulses over one step
+// and so only scale by k.
+static void b2ScaleLodBodies( b2World* world )
+{
+	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
+	for ( int i = 0; i < world->lodBodies.count; ++i )
+	{
+		b2LodBody* lodBody = world->lodBodies.data + i;
+		b2Body* body = b2Array_Get( world->bodies, lodBody->bodyId );
+		if ( body->setIndex != b2_awakeSet || body->generation != lodBody->generation )
+		{
+			// destroyed, disabled, or put to sleep after it was woken
+			lodBody->bodyId = B2_NULL_INDEX;
+			continue;
+		}
+
+		float k = lodBody->timeScale;
+		b2BodySim* sim = awakeSet->bodySims.data + body->localIndex;
+		b2BodyState* state = awakeSet->bodyStates.data + body->localIndex;
+
+		lodBody->gravityScale = sim->gravityScale;
+		lodBody->linearDamping = sim->linearDamping;
+		lodBody->angularDamping = sim->angularDamping;
+		lodBody->sleepThreshold = body->sleepThreshold;
+
+		state->linearVelocity = b2MulSV( k, state->linearVelocity );
+		state->angularVelocity *= k;
+		sim->force = b2MulSV( k, sim->force );
+		sim->torque *= k;
+		sim->gravityScale *= k * k;
+		sim->linearDamping *= k;
+		sim->angularDamping *= k;
+		body->sleepThreshold *= k;
+	}
+}
+
+// Restores the bodies scaled by b2ScaleLodBodies. Must happen before islands go to sleep.
+static void b2RestoreLodBodies( b2World* world, float timeStep )
+{
+	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
+	for ( int i = 0; i < world->lodBodies.count; ++i )
+	{
+		b2LodBody* lodBody = world->lodBodies.data + i;
+		if ( lodBody->bodyId == B2_NULL_INDEX )
+		{
+			continue;
+		}
+
+		b2Body* body = b2Array_Get( world->bodies, lodBody->bodyId );
+		B2_ASSERT( body->setIndex == b2_awakeSet );
+
+		float k = lodBody->timeScale;
+		float invScale = 1.0f / k;
+		b2BodySim* sim = awakeSet->bodySims.data + body->localIndex;
+		b2BodyState* state = awakeSet->bodyStates.data + body->localIndex;
+
+		state->linearVelocity = b2MulSV( invScale, state->linearVelocity );
+		state->angularVelocity *= invScale;
+		sim->gravityScale = lodBody->gravityScale;
+		sim->linearDamping = lodBody->linearDamping;
+		sim->angularDamping = lodBody->angularDamping;
+		body->sleepThreshold = lodBody->sleepThreshold;
+
+		// Finalize only advanced the sleep timer by one step
+		if ( body->sleepTime > 0.0f )
+		{
+			body->sleepTime += ( k - 1.0f ) * timeStep;
+		}
+	}
+
+	b2Array_Clear( world->lodBodies );
+}
+
+// Moves awake islands with a simulation interval to parked sets until their next update step
+static void b2ParkIslands( b2World* world )
+{
+	uint64_t nextStepIndex = world->stepIndex + 1;
+
+	// Need to process in reverse because this moves islands to parked solver sets. The awake set
+	// is fetched every time because parking may grow the solver set array.
+	int count = world->solverSets.data[b2_awakeSet].islandSims.count;
+	for ( int islandIndex = count - 1; islandIndex >= 0; islandIndex -= 1 )
+	{
+		b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
+		int islandId = awakeSet->islandSims.data[islandIndex].islandId;
+		b2Island* island = b2Array_Get( world->islands, islandId );
+
+		// The island uses the smallest interval of its bodies
+		int interval = INT_MAX;
+		for ( int i = 0; i < island->bodies.count && interval > 1; ++i )
+		{
+			b2Body* body = b2Array_Get( world->bodies, island->bodies.data[i] );
+			interval = b2MinInt( interval, body->simulationInterval );
+		}
+
+		// Islands due in the next step stay awake
+		if ( interval <= 1 || ( nextStepIndex + (uint64_t)islandId ) % (uint64_t)interval == 0 )
+		{
+			continue;
+		}
+
+		b2ParkIsland( world, islandId, interval );
+	}
+}
+
+// Freezes the awake islands with all bodies outside of the active regions. Body bounds use the
+// maximum extent so the shapes don't need to be visited.
+static void b2FreezeIslands( b2World* world )
+{
+	const b2AABB* regions = world->activeRegions.data;
+	int regionCount = world->activeRegions.count;
+
+	// Need to process in reverse because this moves islands to frozen solver sets. The awake set
+	// is fetched every time because freezing may grow the solver set array.
+	int count = world->solverSets.data[b2_awakeSet].islandSims.count;
+	for ( int islandIndex = count - 1; islandIndex >= 0; islandIndex -= 1 )
+	{
+		b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
+		int islandId = awakeSet->islandSims.data[islandIndex].islandId;
+		b2Island* island = b2Array_Get( world->islands, islandId );
+
+		// Island sleep takes care of pending splits
+		if ( island->constraintRemoveCount > 0 && island->bodies.count > 1 )
+		{
+			continue;
+		}
+
+		b2AABB bounds = { { B2_HUGE, B2_HUGE }, { -B2_HUGE, -B2_HUGE } };
+		bool isActive = false;
+		for ( int i = 0; i < island->bodies.count && isActive == false; ++i )
+		{
+			b2Body* body = b2Array_Get( world->bodies, island->bodies.data[i] );
+			b2BodySim* sim = b2Array_Get( awakeSet->bodySims, body->localIndex );
+			b2Vec2 extent = { sim->maxExtent, sim->maxExtent };
+			b2AABB bodyBounds = { b2Sub( sim->center, extent ), b2Add( sim->center, extent ) };
+
+			for ( int j = 0; j < regionCount && isActive == false; ++j )
 			{
-				b2Yield();
-				spinCount = 0;
+				isActive = b2AABB_Overlaps( bodyBounds, regions[j] );
 			}
-			else
+
+			bounds = b2AABB_Union( bounds, bodyBounds );
+		}
+
+		if ( isActive == false )
+		{
+			b2FreezeIsland( world, islandId, bounds );
+		}
+	}
+}
+
+// Moves the bodies of the kinematic set. This uses the sub-step integration of the solver, where
+// damping is the only velocity change of a kinematic body, so a kinematic body follows the same
+// path in the awake set and in the kinematic set.
+static void b2IntegrateKinematicBodiesTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	B2_UNUSED( workerIndex );
+
+	b2TracyCZoneNC( integrate_kinematic, "Kinematic", b2_colorMediumSeaGreen, true );
+
+	b2StepContext* stepContext = context;
+	b2World* world = stepContext->world;
+	b2SolverSet* kinematicSet = b2Array_Get( world->solverSets, b2_kinematicSet );
+	b2BodySim* sims = kinematicSet->bodySims.data;
+	b2BodyState* states = kinematicSet->bodyStates.data;
+	b2Body* bodies = world->bodies.data;
+	b2Shape* shapes = world->shapes.data;
+
+	B2_ASSERT( endIndex <= kinematicSet->bodySims.count );
+
+	bool enableSleep = world->enableSleep;
+	float marginTime = b2GetMarginTime( stepContext );
+	b2Transform* previousTransforms = world->enableInterpolation ? world->previousTransforms.data : NULL;
+	int subStepCount = stepContext->subStepCount;
+	float h = stepContext->h;
+	float timeStep = stepContext->dt;
+	float invTimeStep = stepContext->inv_dt;
+	float maxLinearSpeed = stepContext->maxLinearVelocity;
+	float maxAngularSpeed = B2_MAX_ROTATION * stepContext->inv_dt;
+	float maxLinearSpeedSquared = maxLinearSpeed * maxLinearSpeed;
+	float maxAngularSpeedSquared = maxAngularSpeed * maxAngularSpeed;
+
+	for ( int simIndex = startIndex; simIndex < endIndex; ++simIndex )
+	{
+		b2BodySim* sim = sims + simIndex;
+		b2BodyState* state = states + simIndex;
+		b2Body* body = bodies + sim->bodyId;
+
+		float linearDamping = 1.0f / ( 1.0f + h * sim->linearDamping );
+		float angularDamping = 1.0f / ( 1.0f + h * sim->angularDamping );
+
+		for ( int i = 0; i < subStepCount; ++i )
+		{
+			state->linearVelocity = b2MulSV( linearDamping, state->linearVelocity );
+			state->angularVelocity = angularDamping * state->angularVelocity;
+			b2IntegratePosition( state, h, maxLinearSpeed, maxAngularSpeed, maxLinearSpeedSquared, maxAngularSpeedSquared );
+		}
+
+		b2Vec2 v = state->linearVelocity;
+		float w = state->angularVelocity;
+
+		if ( previousTransforms != NULL )
+		{
+			previousTransforms[sim->bodyId] = sim->transform;
+		}
+
+		sim->center = b2Add( sim->center, state->deltaPosition );
+		sim->transform.q = b2FastNormalizeRot( b2MulRot( state->deltaRotation, sim->transform.q ) );
+		sim->transform.p = b2Sub( sim->center, b2RotateVector( sim->transform.q, sim->localCenter ) );
+
+		// Kinematic bodies are never fast, so they are always safe to advance
+		sim->center0 = sim->center;
+		sim->rotation0 = sim->transform.q;
+
+		// Same sleep velocity as b2FinalizeBodiesTask
+		float maxVelocity = b2Length( v ) + b2AbsFloat( w ) * sim->maxExtent;
+		float maxDeltaPosition = b2Length( state->deltaPosition ) + b2AbsFloat( state->deltaRotation.s ) * sim->maxExtent;
+		float positionSleepFactor = 0.5f;
+		float sleepVelocity = b2MaxFloat( maxVelocity, positionSleepFactor * invTimeStep * maxDeltaPosition );
+
+		state->deltaPosition = b2Vec2_zero;
+		state->deltaRotation = b2Rot_identity;
+
+		body->flags &= ~( b2_isFast | b2_isSpeedCapped | b2_hadTimeOfImpact );
+		body->flags |= ( state->flags & b2_isSpeedCapped );
+		state->flags &= ~( b2_isSpeedCapped | b2_isResting );
+
+		if ( enableSleep == false || body->enableSleep == false || sleepVelocity > body->sleepThreshold )
+		{
+			body->sleepTime = 0.0f;
+		}
+		else
+		{
+			body->sleepTime += timeStep;
+		}
+
+		int shapeId = body->headShapeId;
+		while ( shapeId != B2_NULL_INDEX )
+		{
+			b2Shape* shape = shapes + shapeId;
+			b2AABB aabb = b2ComputeShapeAABB( shape, sim->transform );
+			if ( b2EnlargeShapeAABB( shape, aabb, v, marginTime ) )
 			{
-				// Using the cycle counter helps to account for variation in mm_pause timing across different
-				// CPUs. However, this is X64 only.
-				// uint64_t prev = __rdtsc();
-				// do
-				//{
-				//	_mm_pause();
-				//}
-				// while ((__rdtsc() - prev) < maxSpinTime);
-				// maxSpinTime += 10;
+				sim->flags |= b2_enlargeBounds;
+			}
+
+			shapeId = shape->nextShapeId;
+		}
+	}
+
+	b2TracyCZoneEnd( integrate_kinematic );
+}
+
+// Appends the move events of the kinematic set bodies and buffers the moves of their enlarged
+// proxies. The kinematic set is visited in order to keep the move buffer deterministic.
+static void b2FinishKinematicBodies( b2World* world )
+{
+	b2SolverSet* kinematicSet = b2Array_Get( world->solverSets, b2_kinematicSet );
+	int count = kinematicSet->bodySims.count;
+	if ( count == 0 )
+	{
+		return;
+	}
+
+	b2BroadPhase* broadPhase = &world->broadPhase;
+	b2Body* bodies = world->bodies.data;
+	b2Shape* shapes = world->shapes.data;
+	uint16_t worldId = world->worldId;
+
+	int base = world->bodyMoveEvents.count;
+	b2Array_Resize( world->bodyMoveEvents, base + count );
+	b2BodyMoveEvent* moveEvents = world->bodyMoveEvents.data + base;
+
+	for ( int i = 0; i < count; ++i )
+	{
+		b2BodySim* sim = kinematicSet->bodySims.data + i;
+		b2Body* body = bodies + sim->bodyId;
+
+		body->bodyMoveIndex = base + i;
+		moveEvents[i].transform = sim->transform;
+		moveEvents[i].bodyId = (b2BodyId){ sim->bodyId + 1, worldId, body->generation };
+		moveEvents[i].userData = body->userData;
+		moveEvents[i].fellAsleep = false;
+
+		const b2BodyState* state = kinematicSet->bodyStates.data + i;
+		b2WriteExportSlot( world, body->exportSlot, sim->transform, state->linearVelocity, state->angularVelocity );
 
-				b2Pause();
-				b2Pause();
-				spinCount += 1;
+		if ( ( sim->flags & b2_enlargeBounds ) == 0 )
+		{
+			continue;
+		}
+
+		sim->flags &= ~b2_enlargeBounds;
+
+		int shapeId = body->headShapeId;
+		while ( shapeId != B2_NULL_INDEX )
+		{
+			b2Shape* shape = shapes + shapeId;
+			if ( shape->enlargedAABB )
+			{
+				b2BufferMove( broadPhase, shape->proxyKey );
+				b2Array_Push( broadPhase->enlargedShapes, shapeId );
+				shape->enlargedAABB = false;
 			}
+
+			shapeId = shape->nextShapeId;
 		}
+	}
+}
 
-		if ( syncBits == UINT_MAX )
+// Moves kinematic bodies between the awake and kinematic sets at the end of the step. Sleepy
+// kinematic set bodies return to the awake set and fall asleep like any awake island. Kinematic
+// bodies that were finalized alone in their island leave the awake set.
+static void b2UpdateKinematicSet( b2World* world )
+{
+	b2Body* bodies = world->bodies.data;
+
+	if ( world->enableSleep )
+	{
+		// Reverse order because this removes bodies from the kinematic set
+		b2SolverSet* kinematicSet = b2Array_Get( world->solverSets, b2_kinematicSet );
+		for ( int i = kinematicSet->bodySims.count - 1; i >= 0; --i )
 		{
-			// sentinel hit
-			break;
+			b2Body* body = bodies + kinematicSet->bodySims.data[i].bodyId;
+			if ( body->sleepTime >= B2_TIME_TO_SLEEP )
+			{
+				b2AttachKinematicBody( world, body );
+				b2TrySleepIsland( world, body->islandId );
+			}
+		}
+	}
+
+	int candidateCount = 0;
+	for ( int i = 0; i < world->workerCount; ++i )
+	{
+		candidateCount += world->taskContexts.data[i].kinematicBodyIds.count;
+	}
+
+	if ( candidateCount == 0 )
+	{
+		return;
+	}
+
+	int* bodyIds = b2StackAlloc( &world->stack, candidateCount * sizeof( int ), "kinematic body ids" );
+	int count = 0;
+	for ( int i = 0; i < world->workerCount; ++i )
+	{
+		b2TaskContext* taskContext = world->taskContexts.data + i;
+		if ( taskContext->kinematicBodyIds.count == 0 )
+		{
+			continue;
+		}
+
+		memcpy( bodyIds + count, taskContext->kinematicBodyIds.data, taskContext->kinematicBodyIds.count * sizeof( int ) );
+		count += taskContext->kinematicBodyIds.count;
+		b2Array_Clear( taskContext->kinematicBodyIds );
+	}
+
+	// Sort by body id so the set order does not depend on the worker that finalized the body
+	qsort( bodyIds, candidateCount, sizeof( int ), b2CompareIds );
+
+	for ( int i = 0; i < candidateCount; ++i )
+	{
+		// Freezing may have moved the island out of the awake set since finalization
+		b2Body* body = bodies + bodyIds[i];
+		if ( body->setIndex == b2_awakeSet )
+		{
+			b2DetachKinematicBody( world, body );
+		}
+	}
+
+	b2StackFree( &world->stack, bodyIds );
+
+	b2ValidateSolverSets( world );
+}
+
+// A small awake island solved by one worker. The bodies are awake set indices.
+typedef struct b2IslandSolve
+{
+	int islandId;
+	int bodyStart, bodyCount;
+	int contactStart, contactCount;
+	int jointStart, jointCount;
+} b2IslandSolve;
+
+typedef struct b2IslandSolveContext
+{
+	b2StepContext* stepContext;
+	b2IslandSolve* islands;
+	int* bodies;
+	b2ContactSim** contactSims;
+	b2ContactConstraint* constraints;
+	b2JointSim** joints;
+} b2IslandSolveContext;
+
+// A constraint of an island body is solved with the island unless it is a graph overflow constraint or it
+// touches an awake body of another island, such as a kinematic body. The other body of a constraint inside
+// the island gets it from edge 0 so every constraint is listed once.
+static bool b2AcceptIslandConstraint( b2World* world, int islandId, int colorIndex, int otherBodyId, int edgeIndex,
+									  bool* valid )
+{
+	if ( colorIndex == B2_OVERFLOW_INDEX )
+	{
+		*valid = false;
+		return false;
+	}
+
+	b2Body* other = world->bodies.data + otherBodyId;
+	if ( other->setIndex == b2_awakeSet )
+	{
+		if ( other->islandId != islandId )
+		{
+			*valid = false;
+			return false;
+		}
+
+		return edgeIndex == 0;
+	}
+
+	return true;
+}
+
+// Walks the bodies of an island and lists its touching contacts and its joints. The lists are only
+// written when the pointers are not null. Returns false if the island must use the graph coloring.
+static bool b2GatherIslandConstraints( b2World* world, b2IslandSolve* solve, int* bodies, b2ContactSim** contactSims,
+									   b2JointSim** joints )
+{
+	b2Island* island = world->islands.data + solve->islandId;
+	b2GraphColor* colors = world->constraintGraph.colors;
+	int islandId = solve->islandId;
+	int contactCount = 0;
+	int jointCount = 0;
+	bool valid = true;
+
+	for ( int i = 0; i < island->bodies.count && valid; ++i )
+	{
+		b2Body* body = world->bodies.data + island->bodies.data[i];
+		B2_ASSERT( body->setIndex == b2_awakeSet );
+
+		if ( bodies != NULL )
+		{
+			bodies[i] = body->localIndex;
+		}
+
+		int contactKey = body->headContactKey;
+		while ( contactKey != B2_NULL_INDEX && valid )
+		{
+			int contactId = contactKey >> 1;
+			int edgeIndex = contactKey & 1;
+
+			b2Contact* contact = world->contacts.data + contactId;
+			contactKey = contact->edges[edgeIndex].nextKey;
+
+			// Only touching contacts are in the constraint graph
+			if ( contact->colorIndex == B2_NULL_INDEX )
+			{
+				continue;
+			}
+
+			int otherBodyId = contact->edges[edgeIndex ^ 1].bodyId;
+			if ( b2AcceptIslandConstraint( world, islandId, contact->colorIndex, otherBodyId, edgeIndex, &valid ) )
+			{
+				if ( contactSims != NULL )
+				{
+					contactSims[contactCount] = colors[contact->colorIndex].contactSims.data + contact->localIndex;
+				}
+				contactCount += 1;
+			}
+		}
+
+		int jointKey = body->headJointKey;
+		while ( jointKey != B2_NULL_INDEX && valid )
+		{
+			int jointId = jointKey >> 1;
+			int edgeIndex = jointKey & 1;
+
+			b2Joint* joint = world->joints.data + jointId;
+			jointKey = joint->edges[edgeIndex].nextKey;
+
+			if ( joint->setIndex != b2_awakeSet || joint->colorIndex == B2_NULL_INDEX )
+			{
+				continue;
+			}
+
+			int otherBodyId = joint->edges[edgeIndex ^ 1].bodyId;
+			if ( b2AcceptIslandConstraint( world, islandId, joint->colorIndex, otherBodyId, edgeIndex, &valid ) )
+			{
+				if ( joints != NULL )
+				{
+					joints[jointCount] = colors[joint->colorIndex].jointSims.data + joint->localIndex;
+				}
+				jointCount += 1;
+			}
+		}
+	}
+
+	solve->bodyCount = island->bodies.count;
+	solve->contactCount = contactCount;
+	solve->jointCount = jointCount;
+	return valid;
+}
+
+// Implements b2ParallelForCallback. Counts the constraints of the small islands and flags the bodies of the
+// islands that can be solved on their own.
+static void b2CountSmallIslandsTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	b2TracyCZoneNC( count_islands, "Count Islands", b2_colorDarkOrange, true );
+	B2_UNUSED( workerIndex );
+
+	b2IslandSolveContext* solveContext = context;
+	b2World* world = solveContext->stepContext->world;
+	b2BodyState* states = solveContext->stepContext->states;
+	b2IslandSim* islandSims = world->solverSets.data[b2_awakeSet].islandSims.data;
+	int maxBodyCount = world->islandSolveBodyCount;
+
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		b2IslandSolve* solve = solveContext->islands + i;
+		*solve = (b2IslandSolve){ .islandId = islandSims[i].islandId };
+
+		b2Island* island = world->islands.data + solve->islandId;
+		if ( island->bodies.count > maxBodyCount ||
+			 b2GatherIslandConstraints( world, solve, NULL, NULL, NULL ) == false )
+		{
+			solve->bodyCount = 0;
+			continue;
+		}
+
+		for ( int j = 0; j < island->bodies.count; ++j )
+		{
+			b2Body* body = world->bodies.data + island->bodies.data[j];
+			states[body->localIndex].flags |= b2_isIslandSolved;
+		}
+	}
+
+	b2TracyCZoneEnd( count_islands );
+}
+
+// All sub-steps of one island in the order of the graph coloring stages
+static void b2SolveIsland( b2StepContext* context, const int* bodies, int bodyCount, b2ContactSim** contactSims,
+						   b2ContactConstraint* constraints, int contactCount, b2JointSim** joints, int jointCount,
+						   int workerIndex )
+{
+	b2BodyState* states = context->states;
+	b2BodySim* sims = context->sims;
+	b2Vec2 gravity = context->world->gravity;
+	float h = context->h;
+	float maxLinearSpeed = context->maxLinearVelocity;
+	float maxAngularSpeed = B2_MAX_ROTATION * context->inv_dt;
+	float maxLinearSpeedSquared = maxLinearSpeed * maxLinearSpeed;
+	float maxAngularSpeedSquared = maxAngularSpeed * maxAngularSpeed;
+
+	for ( int i = 0; i < jointCount; ++i )
+	{
+		b2PrepareJoint( joints[i], context );
+	}
+
+	b2PrepareIslandContacts( context, contactSims, constraints, contactCount );
+
+	int subStepCount = context->subStepCount;
+	for ( int subStepIndex = 0; subStepIndex < subStepCount; ++subStepIndex )
+	{
+		for ( int i = 0; i < bodyCount; ++i )
+		{
+			int index = bodies[i];
+			b2IntegrateVelocity( sims + index, states + index, gravity, h );
+		}
+
+		for ( int i = 0; i < jointCount; ++i )
+		{
+			b2WarmStartJoint( joints[i], context );
 		}
 
-		int stageIndex = syncBits & 0xFFFF;
-		B2_ASSERT( stageIndex < context->stageCount );
+		b2WarmStartContactConstraints( context, constraints, contactCount );
+
+		for ( int j = 0; j < ITERATIONS; ++j )
+		{
+			b2SolveJoints( context, joints, jointCount, true, workerIndex );
+			b2SolveContactConstraints( context, constraints, contactCount, true );
+		}
+
+		for ( int i = 0; i < bodyCount; ++i )
+		{
+			b2IntegratePosition( states + bodies[i], h, maxLinearSpeed, maxAngularSpeed, maxLinearSpeedSquared,
+								 maxAngularSpeedSquared );
+		}
+
+		int relaxIterations = context->reduceRelax && ( subStepCount - subStepIndex ) % 2 == 0 ? 0 : RELAX_ITERATIONS;
+		for ( int j = 0; j < relaxIterations; ++j )
+		{
+			b2SolveJoints( context, joints, jointCount, false, workerIndex );
+			b2SolveContactConstraints( context, constraints, contactCount, false );
+		}
+	}
+
+	b2ApplyContactRestitution( context, constraints, contactCount );
+	b2StoreIslandImpulses( context, contactSims, constraints, contactCount, workerIndex );
+}
+
+// Implements b2ParallelForCallback
+static void b2SolveSmallIslandsTask( int startIndex, int endIndex, int workerIndex, void* context )
+{
+	b2TracyCZoneNC( solve_islands, "Solve Islands", b2_colorIndigo, true );
+
+	b2IslandSolveContext* solveContext = context;
+	b2StepContext* stepContext = solveContext->stepContext;
+	b2World* world = stepContext->world;
+
+	for ( int i = startIndex; i < endIndex; ++i )
+	{
+		b2IslandSolve* solve = solveContext->islands + i;
+		int* bodies = solveContext->bodies + solve->bodyStart;
+		b2ContactSim** contactSims = solveContext->contactSims + solve->contactStart;
+		b2ContactConstraint* constraints = solveContext->constraints + solve->contactStart;
+		b2JointSim** joints = solveContext->joints + solve->jointStart;
+
+		bool valid = b2GatherIslandConstraints( world, solve, bodies, contactSims, joints );
+		B2_ASSERT( valid );
+		B2_UNUSED( valid );
+
+		b2SolveIsland( stepContext, bodies, solve->bodyCount, contactSims, constraints, solve->contactCount, joints,
+					   solve->jointCount, workerIndex );
+	}
+
+	b2TracyCZoneEnd( solve_islands );
+}
+
+// Solves the awake islands with at most b2World::islandSolveBodyCount bodies before the graph coloring
+// solver. Each island is a single task that runs all sub-steps, so these islands have no stage barriers
+// and keep their bodies in cache. The bodies are flagged so the graph coloring stages skip them and
+// their constraints. This runs before the islands are split because the split tasks change the island
+// body lists.
+static void b2SolveSmallIslands( b2World* world, b2StepContext* stepContext )
+{
+	b2SolverSet* awakeSet = world->solverSets.data + b2_awakeSet;
+	int islandCount = awakeSet->islandSims.count;
+	if ( islandCount == 0 )
+	{
+		return;
+	}
+
+	b2IslandSolveContext solveContext = { 0 };
+	solveContext.stepContext = stepContext;
+	solveContext.islands = b2StackAlloc( &world->stack, islandCount * sizeof( b2IslandSolve ), "island solves" );
 
-		int syncIndex = ( syncBits >> 16 ) & 0xFFFF;
-		B2_ASSERT( syncIndex > 0 );
+	b2ParallelFor( world, b2CountSmallIslandsTask, islandCount, 16, &solveContext );
 
-		int previousSyncIndex = syncIndex - 1;
+	// Keep the islands solved on their own in island order and lay out their lists
+	int solveCount = 0;
+	int bodyCount = 0, contactCount = 0, jointCount = 0;
+	for ( int i = 0; i < islandCount; ++i )
+	{
+		b2IslandSolve solve = solveContext.islands[i];
+		if ( solve.bodyCount == 0 )
+		{
+			continue;
+		}
 
-		b2SolverStage* stage = stages + stageIndex;
-		b2ExecuteStage( stage, context, previousSyncIndex, syncIndex, workerIndex );
+		solve.bodyStart = bodyCount;
+		solve.contactStart = contactCount;
+		solve.jointStart = jointCount;
+		bodyCount += solve.bodyCount;
+		contactCount += solve.contactCount;
+		jointCount += solve.jointCount;
+		solveContext.islands[solveCount] = solve;
+		solveCount += 1;
+	}
 
-		lastSyncBits = syncBits;
+	stepContext->islandSolveCount = solveCount;
+
+	if ( solveCount > 0 )
+	{
+		solveContext.bodies = b2StackAlloc( &world->stack, bodyCount * sizeof( int ), "island bodies" );
+		solveContext.contactSims = b2StackAlloc( &world->stack, contactCount * sizeof( b2ContactSim* ), "island contacts" );
+		solveContext.constraints =
+			b2StackAlloc( &world->stack, contactCount * sizeof( b2ContactConstraint ), "island contact constraints" );
+		solveContext.joints = b2StackAlloc( &world->stack, jointCount * sizeof( b2JointSim* ), "island joints" );
+
+		b2ParallelFor( world, b2SolveSmallIslandsTask, solveCount, 1, &solveContext );
+
+		b2StackFree( &world->stack, solveContext.joints );
+		b2StackFree( &world->stack, solveContext.constraints );
+		b2StackFree( &world->stack, solveContext.contactSims );
+		b2StackFree( &world->stack, solveContext.bodies );
 	}
+
+	b2StackFree( &world->stack, solveContext.islands );
 }
 
-static void b2BulletBodyTask( int startIndex, int endIndex, int workerIndex, void* context )
+// A joint of an island solved by b2SolveSmallIslands. The bodies of these islands are all flagged.
+static bool b2IsIslandJoint( b2World* world, const b2BodyState* states, const b2JointSim* joint )
 {
-	b2TracyCZoneNC( bullet_body_task, "Bullet", b2_colorLightSkyBlue, true );
-
-	b2StepContext* stepContext = context;
-	b2TaskContext* taskContext = stepContext->world->taskContexts.data + workerIndex;
-
-	B2_ASSERT( startIndex <= endIndex );
+	const b2Body* bodyA = world->bodies.data + joint->bodyIdA;
+	if ( bodyA->setIndex == b2_awakeSet )
+	{
+		return ( states[bodyA->localIndex].flags & b2_isIslandSolved ) != 0;
+	}
 
-	for ( int i = startIndex; i < endIndex; ++i )
+	const b2Body* bodyB = world->bodies.data + joint->bodyIdB;
+	if ( bodyB->setIndex == b2_awakeSet )
 	{
-		int simIndex = stepContext->bulletBodies[i];
-		b2SolveContinuous( stepContext->world, simIndex, taskContext );
+		return ( states[bodyB->localIndex].flags & b2_isIslandSolved ) != 0;
 	}
 
-	b2TracyCZoneEnd( bullet_body_task );
+	return false;
 }
 
 // Solve with graph coloring
@@ -1270,12 +2910,48 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 	// Only count steps that advance the simulation
 	world->stepIndex += 1;
 
+	// Contact constraints prepared by the narrow phase. Scaling the parked islands below changes body velocities
+	// the preparation has read.
+	b2FusedPrepare* fused = stepContext->fusedPrepare.constraints != NULL && world->lodBodies.count == 0
+								? &stepContext->fusedPrepare
+								: NULL;
+
+	// Islands woken from parked sets catch up on the steps they skipped
+	if ( world->lodBodies.count > 0 )
+	{
+		b2ScaleLodBodies( world );
+	}
+
+	// Kinematic set bodies move outside of the constraint solver
+	int kinematicBodyCount = world->solverSets.data[b2_kinematicSet].bodySims.count;
+	if ( kinematicBodyCount > 0 )
+	{
+		b2ParallelFor( world, b2IntegrateKinematicBodiesTask, kinematicBodyCount, 64, stepContext );
+	}
+
 	// Are there any awake bodies? This scenario should not be important for profiling.
 	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
 	int awakeBodyCount = awakeSet->bodySims.count;
 	if ( awakeBodyCount == 0 )
 	{
+		b2Array_Clear( world->lodBodies );
 		b2ValidateNoEnlarged( &world->broadPhase );
+
+		if ( kinematicBodyCount > 0 )
+		{
+			// The broad-phase is touched below
+			if ( world->userTreeTask != NULL )
+			{
+				world->finishTaskFcn( world->userTreeTask, world->userTaskContext );
+				world->userTreeTask = NULL;
+				world->activeTaskCount -= 1;
+			}
+
+			b2FinishKinematicBodies( world );
+			b2EnlargeBroadPhaseProxies( world );
+			b2UpdateKinematicSet( world );
+		}
+
 		return;
 	}
 
@@ -1284,9 +2960,11 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		b2TracyCZoneNC( solver_setup, "Solver Setup", b2_colorDarkOrange, true );
 		uint64_t setupTicks = b2GetTicks();
 
-		// Prepare buffers for bullets
+		// Prepare buffers for continuous collision
 		b2AtomicStoreInt( &stepContext->bulletBodyCount, 0 );
 		stepContext->bulletBodies = b2StackAlloc( &world->stack, awakeBodyCount * sizeof( int ), "bullet bodies" );
+		b2AtomicStoreInt( &stepContext->fastBodyCount, 0 );
+		stepContext->fastBodies = b2StackAlloc( &world->stack, awakeBodyCount * sizeof( int ), "fast bodies" );
 
 		b2ConstraintGraph* graph = &world->constraintGraph;
 		b2GraphColor* colors = graph->colors;
@@ -1294,6 +2972,37 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		stepContext->sims = awakeSet->bodySims.data;
 		stepContext->states = awakeSet->bodyStates.data;
 
+		// Before anything holds on to the color contacts
+		if ( world->enableColorBalancing && world->stepIndex % B2_COLOR_BALANCE_INTERVAL == 0 )
+		{
+			b2BalanceGraphColors( world );
+		}
+
+		if ( world->enableContactOrdering )
+		{
+			b2SortGraphContacts( world );
+		}
+
+		// Event results of all workers are gathered below, including workers left out of the solve
+		for ( int i = 0; i < world->workerCount; ++i )
+		{
+			b2TaskContext* taskContext = b2Array_Get( world->taskContexts, i );
+			b2Array_Clear( taskContext->jointEventIds );
+			b2Array_Clear( taskContext->hitEvents );
+		}
+
+		if ( world->islandSolveBodyCount > 0 )
+		{
+			b2SolveSmallIslands( world, stepContext );
+
+			// The narrow phase prepared the contacts of the small islands too
+			fused = stepContext->islandSolveCount > 0 ? NULL : fused;
+		}
+
+		// Joints of the small islands are left out of the graph colors
+		bool skipIslandJoints = stepContext->islandSolveCount > 0;
+		b2BodyState* states = stepContext->states;
+
 		// count contacts, joints, and colors
 		int activeColorCount = 0;
 		for ( int i = 0; i < B2_GRAPH_COLOR_COUNT - 1; ++i )
@@ -1305,9 +3014,25 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		}
 
 		// prepare for move events
+		b2AllocInfo previousAllocInfo = b2PushAllocTag( b2_allocTagEvents, b2_allocLifetimeLong );
 		b2Array_Resize( world->bodyMoveEvents, awakeBodyCount );
+		b2PopAllocInfo( previousAllocInfo );
+
+		int constraintCount = colors[B2_OVERFLOW_INDEX].contactSims.count + colors[B2_OVERFLOW_INDEX].jointSims.count;
+		for ( int i = 0; i < B2_GRAPH_COLOR_COUNT - 1; ++i )
+		{
+			constraintCount += colors[i].contactSims.count + colors[i].jointSims.count;
+		}
 
+		int itemCount = awakeBodyCount + constraintCount;
 		int workerCount = world->workerCount;
+		if ( world->enableAutoWorkers )
+		{
+			// Every solver stage forks and joins all solver workers, so small steps use fewer of them
+			int neededCount = ( itemCount + B2_AUTO_WORKER_ITEM_COUNT - 1 ) / B2_AUTO_WORKER_ITEM_COUNT;
+			workerCount = b2ClampInt( neededCount, 1, workerCount );
+		}
+		world->solverWorkerCount = workerCount;
 
 		// Target 4 blocks per worker to allow work stealing
 		const int maxBlockCount = 4 * workerCount;
@@ -1318,19 +3043,25 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 
 		const int minContactsPerBlock = 4;
 		const int minJointsPerBlock = 4;
+		const int minOverflowPerBlock = 16;
 
 		// Configure blocks for tasks parallel-for each active graph color
 		// The blocks are a mix of wide contact blocks and joint blocks
 		int activeColorIndices[B2_GRAPH_COLOR_COUNT];
 		int colorContactCounts[B2_GRAPH_COLOR_COUNT];
 		int colorJointCounts[B2_GRAPH_COLOR_COUNT];
+		int colorWideJointCounts[B2_GRAPH_COLOR_COUNT];
 		b2BlockDim graphContactDims[B2_GRAPH_COLOR_COUNT];
 		b2BlockDim graphJointDims[B2_GRAPH_COLOR_COUNT];
+		b2BlockDim graphWideJointDims[B2_GRAPH_COLOR_COUNT];
+		bool inlineColors[B2_GRAPH_COLOR_COUNT];
+		int inlineColorCount = 0;
 		int graphBlockCount = 0;
 
 		// c is the active color index
 		int wideContactCount = 0;
-		int jointCount = 0;
+		int scalarJointCount = 0;
+		int wideJointCount = 0;
 		int c = 0;
 		for ( int i = 0; i < B2_GRAPH_COLOR_COUNT - 1; ++i )
 		{
@@ -1349,27 +3080,99 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 			wideContactCount += colorContactCountW;
 			colorContactCounts[c] = colorContactCountW;
 
-			colorJointCounts[c] = colorJointCount;
-			jointCount += colorJointCount;
+			// Partition joints into scalar joints and wide joints, one joint type per wide constraint
+			int colorScalarJointCount = 0;
+			int revoluteCount = 0, weldCount = 0, prismaticCount = 0;
+			b2JointSim* jointSims = colors[i].jointSims.data;
+			for ( int k = 0; k < colorJointCount; ++k )
+			{
+				b2JointSim* joint = jointSims + k;
+				if ( skipIslandJoints && b2IsIslandJoint( world, states, joint ) )
+				{
+					continue;
+				}
+
+				if ( b2IsWideJoint( joint ) == false )
+				{
+					colorScalarJointCount += 1;
+					continue;
+				}
+
+				revoluteCount += joint->type == b2_revoluteJoint ? 1 : 0;
+				weldCount += joint->type == b2_weldJoint ? 1 : 0;
+				prismaticCount += joint->type == b2_prismaticJoint ? 1 : 0;
+			}
+
+			int colorJointCountW = ( ( revoluteCount + B2_SIMD_WIDTH - 1 ) >> B2_SIMD_SHIFT ) +
+								   ( ( weldCount + B2_SIMD_WIDTH - 1 ) >> B2_SIMD_SHIFT ) +
+								   ( ( prismaticCount + B2_SIMD_WIDTH - 1 ) >> B2_SIMD_SHIFT );
+
+			colorJointCounts[c] = colorScalarJointCount;
+			scalarJointCount += colorScalarJointCount;
+			colorWideJointCounts[c] = colorJointCountW;
+			wideJointCount += colorJointCountW;
 
 			// Graph solver block dimensions
 			graphContactDims[c] = b2ComputeBlockCount( colorContactCountW, minContactsPerBlock, maxBlockCount );
-			graphJointDims[c] = b2ComputeBlockCount( colorJointCount, minJointsPerBlock, maxBlockCount );
-			graphBlockCount += graphContactDims[c].count + graphJointDims[c].count;
+			graphJointDims[c] = b2ComputeBlockCount( colorScalarJointCount, minJointsPerBlock, maxBlockCount );
+			graphWideJointDims[c] = b2ComputeBlockCount( colorJointCountW, minJointsPerBlock, maxBlockCount );
+			graphBlockCount += graphContactDims[c].count + graphJointDims[c].count + graphWideJointDims[c].count;
+
+			int colorItemCount = colorContactCountW + colorScalarJointCount + colorJointCountW;
+			inlineColors[c] = colorItemCount <= B2_INLINE_COLOR_ITEM_COUNT;
+			inlineColorCount += inlineColors[c] ? 1 : 0;
 
 			c += 1;
 		}
 		activeColorCount = c;
+		world->inlineColorCount = inlineColorCount;
+
+		// Colors prepared by the narrow phase that no contact joined or left keep their constraints. If no
+		// color changed size the layout is the same and the narrow phase buffer is used as is.
+		bool fusedColors[B2_GRAPH_COLOR_COUNT] = { 0 };
+		bool reuseFused = false;
+		if ( fused != NULL )
+		{
+			reuseFused = true;
+			uint64_t changedColors = world->constraintGraph.changedContactColors;
+			for ( int i = 0; i < B2_OVERFLOW_INDEX; ++i )
+			{
+				bool sameCount = colors[i].contactSims.count == fused->colorCounts[i];
+				reuseFused = reuseFused && sameCount;
+				fusedColors[i] = sameCount && fused->colorCounts[i] > 0 && ( changedColors & ( 1ull << i ) ) == 0;
+			}
+
+			B2_ASSERT( reuseFused == false || fused->wideCount == wideContactCount );
+		}
 
 		// Prepare and store run as one flat parallel-for over the entire wide constraint range,
 		// partitioned into uniformly sized blocks. Color info is consulted inside the task via
 		// a small span array, so blocks do not need to honor color boundaries here.
 		b2BlockDim contactPrepareDim = b2ComputeBlockCount( wideContactCount, minContactsPerBlock, maxBlockCount );
-		b2BlockDim jointPrepareDim = b2ComputeBlockCount( jointCount, minJointsPerBlock, maxBlockCount );
+		b2BlockDim jointPrepareDim = b2ComputeBlockCount( scalarJointCount, minJointsPerBlock, maxBlockCount );
+		b2BlockDim wideJointPrepareDim = b2ComputeBlockCount( wideJointCount, minJointsPerBlock, maxBlockCount );
 
 		int wideContactConstraintByteCount = b2GetWideContactConstraintByteCount();
-		struct b2ContactConstraintWide* wideContactConstraints =
-			b2StackAlloc( &world->stack, wideContactCount * wideContactConstraintByteCount, "contact constraint" );
+		int wideContactColdByteCount = b2GetWideContactColdByteCount();
+		struct b2ContactConstraintWide* wideContactConstraints;
+		struct b2ContactConstraintWideCold* wideContactColdConstraints;
+		if ( reuseFused )
+		{
+			wideContactConstraints = fused->constraints;
+			wideContactColdConstraints = fused->colds;
+		}
+		else
+		{
+			wideContactConstraints =
+				b2StackAlloc( &world->stack, wideContactCount * wideContactConstraintByteCount, "contact constraint" );
+			wideContactColdConstraints =
+				b2StackAlloc( &world->stack, wideContactCount * wideContactColdByteCount, "contact constraint cold" );
+		}
+
+		int wideJointConstraintByteCount = b2GetWideJointConstraintByteCount();
+		struct b2JointConstraintWide* wideJointConstraints =
+			b2StackAlloc( &world->stack, wideJointCount * wideJointConstraintByteCount, "joint constraint" );
+		b2JointSim** scalarJoints = b2StackAlloc( &world->stack, scalarJointCount * sizeof( b2JointSim* ), "scalar joints" );
 
 		b2GraphColor* overflow = colors + B2_OVERFLOW_INDEX;
 		int overflowCount = overflow->contactSims.count;
@@ -1377,16 +3180,94 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 			b2StackAlloc( &world->stack, overflowCount * sizeof( b2ContactConstraint ), "overflow contact constraint" );
 		overflow->overflowConstraints = overflowContacts;
 
+		// Parallel overflow buffers. Each overflow contact touches at most two bodies.
+		bool parallelOverflow = stepContext->enableParallelOverflow && overflowCount > 0;
+		int overflowCapacity = parallelOverflow ? overflowCount : 0;
+		b2ContactVelocities* overflowDeltas =
+			b2StackAlloc( &world->stack, overflowCapacity * sizeof( b2ContactVelocities ), "overflow deltas" );
+		int* overflowSplitCounts = b2StackAlloc( &world->stack, 2 * overflowCapacity * sizeof( int ), "overflow splits" );
+		b2OverflowBody* overflowBodies =
+			b2StackAlloc( &world->stack, 2 * overflowCapacity * sizeof( b2OverflowBody ), "overflow bodies" );
+		int* overflowEntries = b2StackAlloc( &world->stack, 2 * overflowCapacity * sizeof( int ), "overflow entries" );
+		int* overflowBodyMap =
+			b2StackAlloc( &world->stack, ( parallelOverflow ? awakeBodyCount : 0 ) * sizeof( int ), "overflow body map" );
+		int overflowBodyCount = 0;
+
+		if ( parallelOverflow )
+		{
+			// Gather the bodies touched by overflow contacts and list their contacts in contact order
+			memset( overflowBodyMap, 0xFF, awakeBodyCount * sizeof( int ) );
+
+			b2ContactSim* overflowSims = overflow->contactSims.data;
+			for ( int i = 0; i < overflowCount; ++i )
+			{
+				int indices[2] = { overflowSims[i].bodySimIndexA, overflowSims[i].bodySimIndexB };
+				for ( int side = 0; side < 2; ++side )
+				{
+					int index = indices[side];
+					if ( index == B2_NULL_INDEX )
+					{
+						continue;
+					}
+
+					if ( overflowBodyMap[index] == B2_NULL_INDEX )
+					{
+						overflowBodyMap[index] = overflowBodyCount;
+						overflowBodies[overflowBodyCount] = (b2OverflowBody){ index, 0, 0 };
+						overflowBodyCount += 1;
+					}
+
+					overflowBodies[overflowBodyMap[index]].entryCount += 1;
+				}
+			}
+
+			int entryStart = 0;
+			for ( int i = 0; i < overflowBodyCount; ++i )
+			{
+				overflowBodies[i].entryStart = entryStart;
+				entryStart += overflowBodies[i].entryCount;
+				overflowBodies[i].entryCount = 0;
+			}
+
+			for ( int i = 0; i < overflowCount; ++i )
+			{
+				int indices[2] = { overflowSims[i].bodySimIndexA, overflowSims[i].bodySimIndexB };
+				for ( int side = 0; side < 2; ++side )
+				{
+					int index = indices[side];
+					if ( index == B2_NULL_INDEX )
+					{
+						continue;
+					}
+
+					b2OverflowBody* body = overflowBodies + overflowBodyMap[index];
+					overflowEntries[body->entryStart + body->entryCount] = 2 * i + side;
+					body->entryCount += 1;
+				}
+			}
+
+			for ( int i = 0; i < overflowCount; ++i )
+			{
+				int indexA = overflowSims[i].bodySimIndexA;
+				int indexB = overflowSims[i].bodySimIndexB;
+				overflowSplitCounts[2 * i + 0] = indexA == B2_NULL_INDEX ? 1 : overflowBodies[overflowBodyMap[indexA]].entryCount;
+				overflowSplitCounts[2 * i + 1] = indexB == B2_NULL_INDEX ? 1 : overflowBodies[overflowBodyMap[indexB]].entryCount;
+			}
+		}
+
+		b2BlockDim overflowContactDim = b2ComputeBlockCount( overflowCapacity, minOverflowPerBlock, maxBlockCount );
+		b2BlockDim overflowBodyDim = b2ComputeBlockCount( overflowBodyCount, minOverflowPerBlock, maxBlockCount );
+
 		// Build the span table for the flat prepare/store parallel-for while I slice the
 		// wide constraint buffer across colors. One entry per active color plus a sentinel
 		// at wideContactCount.
 		b2ContactPrepareSpan contactPrepareSpans[B2_GRAPH_COLOR_COUNT + 1];
-		b2JointPrepareSpan jointPrepareSpans[B2_GRAPH_COLOR_COUNT + 1];
 
 		// Distribute transient constraints to each graph color and prepare spans
 		{
 			int wideBase = 0;
 			int jointBase = 0;
+			int wideJointBase = 0;
 			for ( int i = 0; i < activeColorCount; ++i )
 			{
 				int j = activeColorIndices[i];
@@ -1396,6 +3277,7 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 				contactPrepareSpans[i].start = wideBase;
 				contactPrepareSpans[i].count = colorContactCount;
 				contactPrepareSpans[i].contacts = color->contactSims.data;
+				contactPrepareSpans[i].prepared = fusedColors[j];
 
 				if ( colorContactCount == 0 )
 				{
@@ -1410,21 +3292,107 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 					int colorContactCountW = ( ( colorContactCount - 1 ) >> B2_SIMD_SHIFT ) + 1;
 					color->wideConstraintCount = colorContactCountW;
 
-					// Zero remainder lanes in the tail wide slot so prepare workers don't need to
-					// initialize them.
-					if ( ( colorContactCount & ( B2_SIMD_WIDTH - 1 ) ) != 0 )
+					if ( fusedColors[j] )
+					{
+						// The narrow phase prepared this color, including the remainder lanes
+						if ( reuseFused == false )
+						{
+							int fusedStart = fused->colorStarts[j];
+							memcpy( color->wideConstraints,
+									(uint8_t*)fused->constraints + fusedStart * wideContactConstraintByteCount,
+									colorContactCountW * wideContactConstraintByteCount );
+							memcpy( (uint8_t*)wideContactColdConstraints + wideBase * wideContactColdByteCount,
+									(uint8_t*)fused->colds + fusedStart * wideContactColdByteCount,
+									colorContactCountW * wideContactColdByteCount );
+						}
+					}
+					else if ( ( colorContactCount & ( B2_SIMD_WIDTH - 1 ) ) != 0 )
 					{
+						// Zero remainder lanes in the tail wide slot so prepare workers don't need to
+						// initialize them.
 						memset( (uint8_t*)color->wideConstraints + ( colorContactCountW - 1 ) * wideContactConstraintByteCount, 0,
 								wideContactConstraintByteCount );
+						memset( (uint8_t*)wideContactColdConstraints +
+									( wideBase + colorContactCountW - 1 ) * wideContactColdByteCount,
+								0, wideContactColdByteCount );
 					}
 
 					wideBase += colorContactCountW;
 				}
 
-				jointPrepareSpans[i].start = jointBase;
-				jointPrepareSpans[i].count = color->jointSims.count;
-				jointPrepareSpans[i].joints = color->jointSims.data;
-				jointBase += color->jointSims.count;
+				color->scalarJoints = scalarJoints + jointBase;
+				color->scalarJointCount = colorJointCounts[i];
+				color->wideJoints = (struct b2JointConstraintWide*)( (uint8_t*)wideJointConstraints +
+																	 wideJointBase * wideJointConstraintByteCount );
+				color->wideJointCount = colorWideJointCounts[i];
+
+				// Lay out the wide joints grouped by type. Each group fills whole wide constraints
+				// and only the tail of each group has unused lanes.
+				{
+					int colorJointCount = color->jointSims.count;
+					b2JointSim* jointSims = color->jointSims.data;
+					int scalarIndex = 0;
+					int typeCounts[b2_wheelJoint + 1] = { 0 };
+
+					for ( int k = 0; k < colorJointCount; ++k )
+					{
+						b2JointSim* joint = jointSims + k;
+						if ( skipIslandJoints && b2IsIslandJoint( world, states, joint ) )
+						{
+							continue;
+						}
+
+						if ( b2IsWideJoint( joint ) == false )
+						{
+							color->scalarJoints[scalarIndex] = joint;
+							scalarIndex += 1;
+							continue;
+						}
+
+						typeCounts[joint->type] += 1;
+					}
+
+					B2_ASSERT( scalarIndex == color->scalarJointCount );
+
+					// Slot of the next lane for each type
+					int typeSlots[b2_wheelJoint + 1] = { 0 };
+					int wideIndex = 0;
+					b2JointType wideTypes[3] = { b2_revoluteJoint, b2_weldJoint, b2_prismaticJoint };
+					for ( int t = 0; t < 3; ++t )
+					{
+						int count = typeCounts[wideTypes[t]];
+						int countW = ( ( count + B2_SIMD_WIDTH - 1 ) >> B2_SIMD_SHIFT );
+						typeSlots[wideTypes[t]] = wideIndex * B2_SIMD_WIDTH;
+						wideIndex += countW;
+
+						// Zero remainder lanes in the tail wide slot so prepare workers don't need to
+						// initialize them.
+						if ( ( count & ( B2_SIMD_WIDTH - 1 ) ) != 0 )
+						{
+							memset( (uint8_t*)color->wideJoints + ( wideIndex - 1 ) * wideJointConstraintByteCount, 0,
+									wideJointConstraintByteCount );
+						}
+					}
+
+					B2_ASSERT( wideIndex == color->wideJointCount );
+
+					for ( int k = 0; k < colorJointCount; ++k )
+					{
+						b2JointSim* joint = jointSims + k;
+						if ( b2IsWideJoint( joint ) == false ||
+							 ( skipIslandJoints && b2IsIslandJoint( world, states, joint ) ) )
+						{
+							continue;
+						}
+
+						int slot = typeSlots[joint->type];
+						b2SetWideJointLane( color->wideJoints, slot >> B2_SIMD_SHIFT, slot & ( B2_SIMD_WIDTH - 1 ), joint );
+						typeSlots[joint->type] = slot + 1;
+					}
+				}
+
+				jointBase += colorJointCounts[i];
+				wideJointBase += colorWideJointCounts[i];
 			}
 
 			// Sentinel
@@ -1433,10 +3401,8 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 			contactPrepareSpans[activeColorCount].contacts = NULL;
 			B2_ASSERT( wideBase == wideContactCount );
 
-			jointPrepareSpans[activeColorCount].start = jointCount;
-			jointPrepareSpans[activeColorCount].count = 0;
-			jointPrepareSpans[activeColorCount].joints = NULL;
-			B2_ASSERT( jointBase == jointCount );
+			B2_ASSERT( jointBase == scalarJointCount );
+			B2_ASSERT( wideJointBase == wideJointCount );
 		}
 
 		int stageCount = 0;
@@ -1457,34 +3423,49 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		stageCount += RELAX_ITERATIONS * activeColorCount;
 		// b2_stageRestitution
 		stageCount += activeColorCount;
+		// b2_stageStoreJoints
+		stageCount += 1;
 		// b2_stageStoreImpulses
 		stageCount += 1;
+		// b2_stageOverflowContacts, b2_stageOverflowBodies
+		stageCount += 2;
 
 		b2SolverStage* stages = b2StackAlloc( &world->stack, stageCount * sizeof( b2SolverStage ), "stages" );
 		b2SyncBlock* bodyBlocks = b2StackAlloc( &world->stack, bodyDim.count * sizeof( b2SyncBlock ), "body blocks" );
 		b2SyncBlock* contactBlocks =
 			b2StackAlloc( &world->stack, contactPrepareDim.count * sizeof( b2SyncBlock ), "contact blocks" );
-		b2SyncBlock* jointBlocks = b2StackAlloc( &world->stack, jointPrepareDim.count * sizeof( b2SyncBlock ), "joint blocks" );
+		b2SyncBlock* jointBlocks = b2StackAlloc(
+			&world->stack, ( jointPrepareDim.count + wideJointPrepareDim.count ) * sizeof( b2SyncBlock ), "joint blocks" );
 		b2SyncBlock* graphBlocks = b2StackAlloc( &world->stack, graphBlockCount * sizeof( b2SyncBlock ), "graph blocks" );
+		b2SyncBlock* overflowBlocks = b2StackAlloc(
+			&world->stack, ( overflowContactDim.count + overflowBodyDim.count ) * sizeof( b2SyncBlock ), "overflow blocks" );
 
-		// Split an awake island. This modifies:
+		// Split awake islands. The union-find of each split runs in its own task with its own scratch.
+		// Creating the new islands modifies:
 		// - stack allocator
 		// - world island array and solver set
 		// - island indices on bodies, contacts, and joints
-		// I'm squeezing this task in here because it may be expensive and this is a safe place to put it.
+		// I'm squeezing these tasks in here because they may be expensive and this is a safe place to put them.
 		// Note: cannot split islands in parallel with FinalizeBodies
-		void* splitIslandTask = NULL;
-		if ( world->splitIslandId != B2_NULL_INDEX )
+		int splitCount = 0;
+		b2IslandSplit* splits = b2BeginIslandSplits( world, &splitCount );
+		void* splitIslandTasks[B2_MAX_ISLAND_SPLITS] = { 0 };
+		for ( int i = 0; i < splitCount; ++i )
 		{
 			if ( world->taskCount < B2_MAX_TASKS )
 			{
-				splitIslandTask = world->enqueueTaskFcn( &b2SplitIslandTask, world, world->userTaskContext );
+				b2TaskInfo info = {
+					.name = "Split Island",
+					.priority = b2_taskPriorityBackground,
+					.expectedCost = splits[i].bodyCount,
+				};
+				splitIslandTasks[i] = b2EnqueueTask( world, &b2SplitIslandTask, splits + i, &info );
 				world->taskCount += 1;
-				world->activeTaskCount += splitIslandTask == NULL ? 0 : 1;
+				world->activeTaskCount += splitIslandTasks[i] == NULL ? 0 : 1;
 			}
 			else
 			{
-				b2SplitIslandTask( world );
+				b2SplitIslandTask( splits + i );
 			}
 		}
 
@@ -1494,9 +3475,12 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		// Prepare blocks as a single flat parallel-for over the whole constraint range.
 		// The task walks spans to decode flat slot indices back to per-color arrays.
 		b2InitBlocks( contactBlocks, contactPrepareDim, wideContactCount, b2_contactBlock, UINT8_MAX );
-		b2InitBlocks( jointBlocks, jointPrepareDim, jointCount, b2_jointBlock, UINT8_MAX );
+		// Scalar joint blocks are followed by wide joint blocks. Only the wide joint blocks are used to store impulses.
+		b2SyncBlock* wideJointBlocks = jointBlocks + jointPrepareDim.count;
+		b2InitBlocks( jointBlocks, jointPrepareDim, scalarJointCount, b2_jointBlock, UINT8_MAX );
+		b2InitBlocks( wideJointBlocks, wideJointPrepareDim, wideJointCount, b2_wideJointBlock, UINT8_MAX );
 
-		// Prepare graph work blocks. Each color gets joint blocks followed by contact blocks.
+		// Prepare graph work blocks. Each color gets scalar joint blocks, then wide joint blocks, then contact blocks.
 		b2SyncBlock* graphColorBlocks[B2_GRAPH_COLOR_COUNT] = { 0 };
 		b2SyncBlock* baseGraphBlock = graphBlocks;
 		int graphBlockCounts[B2_GRAPH_COLOR_COUNT] = { 0 };
@@ -1508,28 +3492,39 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 			b2InitBlocks( baseGraphBlock, graphJointDims[i], colorJointCounts[i], b2_graphJointBlock, colorIndex );
 			baseGraphBlock += graphJointDims[i].count;
 
+			b2InitBlocks( baseGraphBlock, graphWideJointDims[i], colorWideJointCounts[i], b2_graphWideJointBlock, colorIndex );
+			baseGraphBlock += graphWideJointDims[i].count;
+
 			b2InitBlocks( baseGraphBlock, graphContactDims[i], colorContactCounts[i], b2_graphContactBlock, colorIndex );
 			baseGraphBlock += graphContactDims[i].count;
 
-			graphBlockCounts[i] = graphJointDims[i].count + graphContactDims[i].count;
+			graphBlockCounts[i] = graphJointDims[i].count + graphWideJointDims[i].count + graphContactDims[i].count;
 		}
 
 		B2_ASSERT( (ptrdiff_t)( baseGraphBlock - graphBlocks ) == graphBlockCount );
 
+		b2SyncBlock* overflowBodyBlocks = overflowBlocks + overflowContactDim.count;
+		b2InitBlocks( overflowBlocks, overflowContactDim, overflowCapacity, b2_contactBlock, B2_OVERFLOW_INDEX );
+		b2InitBlocks( overflowBodyBlocks, overflowBodyDim, overflowBodyCount, b2_bodyBlock, UINT8_MAX );
+
 		b2SolverStage* stage = stages;
-		stage = b2InitStage( stage, b2_stagePrepareJoints, jointBlocks, jointPrepareDim.count, UINT8_MAX );
+		stage = b2InitStage( stage, b2_stagePrepareJoints, jointBlocks, jointPrepareDim.count + wideJointPrepareDim.count,
+							 UINT8_MAX );
 		stage = b2InitStage( stage, b2_stagePrepareContacts, contactBlocks, contactPrepareDim.count, UINT8_MAX );
 		stage = b2InitStage( stage, b2_stageIntegrateVelocities, bodyBlocks, bodyDim.count, UINT8_MAX );
 		stage = b2InitColorStages( stage, b2_stageWarmStart, 1, activeColorCount, graphColorBlocks, graphBlockCounts,
-								   activeColorIndices );
+								   activeColorIndices, inlineColors );
 		stage = b2InitColorStages( stage, b2_stageSolve, ITERATIONS, activeColorCount, graphColorBlocks, graphBlockCounts,
-								   activeColorIndices );
+								   activeColorIndices, inlineColors );
 		stage = b2InitStage( stage, b2_stageIntegratePositions, bodyBlocks, bodyDim.count, UINT8_MAX );
 		stage = b2InitColorStages( stage, b2_stageRelax, RELAX_ITERATIONS, activeColorCount, graphColorBlocks, graphBlockCounts,
-								   activeColorIndices );
+								   activeColorIndices, inlineColors );
 		stage = b2InitColorStages( stage, b2_stageRestitution, 1, activeColorCount, graphColorBlocks, graphBlockCounts,
-								   activeColorIndices );
+								   activeColorIndices, inlineColors );
+		stage = b2InitStage( stage, b2_stageStoreJoints, wideJointBlocks, wideJointPrepareDim.count, UINT8_MAX );
 		stage = b2InitStage( stage, b2_stageStoreImpulses, contactBlocks, contactPrepareDim.count, UINT8_MAX );
+		stage = b2InitStage( stage, b2_stageOverflowContacts, overflowBlocks, overflowContactDim.count, B2_OVERFLOW_INDEX );
+		stage = b2InitStage( stage, b2_stageOverflowBodies, overflowBodyBlocks, overflowBodyDim.count, UINT8_MAX );
 
 		B2_ASSERT( (int)( stage - stages ) == stageCount );
 
@@ -1542,10 +3537,22 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		stepContext->stageCount = stageCount;
 		stepContext->stages = stages;
 		stepContext->wideContactConstraints = wideContactConstraints;
+		stepContext->wideContactColdConstraints = wideContactColdConstraints;
 		stepContext->contactPrepareSpans = contactPrepareSpans;
 		stepContext->wideContactCount = wideContactCount;
-		stepContext->jointPrepareSpans = jointPrepareSpans;
+		stepContext->scalarJoints = scalarJoints;
+		stepContext->scalarJointCount = scalarJointCount;
+		stepContext->wideJointConstraints = wideJointConstraints;
+		stepContext->wideJointCount = wideJointCount;
+		stepContext->overflowDeltas = overflowDeltas;
+		stepContext->overflowSplitCounts = overflowSplitCounts;
+		stepContext->overflowBodies = overflowBodies;
+		stepContext->overflowEntries = overflowEntries;
+		stepContext->overflowBodyCount = overflowBodyCount;
+		stepContext->overflowStage = b2_stageWarmStart;
 		b2AtomicStoreU32( &stepContext->atomicSyncBits, 0 );
+		b2AtomicStoreInt( &stepContext->parkedWorkerCount, 0 );
+		b2AtomicStoreInt( &stepContext->mainParked, 0 );
 		b2AtomicStoreInt( &stepContext->mainClaimed, 0 );
 
 		world->profile.solverSetup = b2GetMillisecondsAndReset( &setupTicks );
@@ -1554,21 +3561,22 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		b2TracyCZoneNC( solve_constraints, "Solve Constraints", b2_colorIndigo, true );
 		uint64_t constraintTicks = b2GetTicks();
 
-		int jointIdCapacity = b2GetIdCapacity( &world->jointIdPool );
-		int contactIdCapacity = b2GetIdCapacity( &world->contactIdPool );
 		for ( int i = 0; i < workerCount; ++i )
 		{
-			b2TaskContext* taskContext = b2Array_Get( world->taskContexts, i );
-			b2SetBitCountAndClear( &taskContext->jointStateBitSet, jointIdCapacity );
-			b2SetBitCountAndClear( &taskContext->hitEventBitSet, contactIdCapacity );
-			taskContext->hasHitEvents = false;
-
 			workerContext[i].context = stepContext;
 			workerContext[i].workerIndex = i;
 
 			if ( world->taskCount < B2_MAX_TASKS )
 			{
-				workerContext[i].userTask = world->enqueueTaskFcn( &b2SolverTask, workerContext + i, world->userTaskContext );
+				// Solver workers wait on each other at every stage, so they are a gang
+				b2TaskInfo info = {
+					.name = "Solver",
+					.priority = b2_taskPriorityHigh,
+					.gangSize = workerCount,
+					.gangIndex = i,
+					.expectedCost = itemCount / workerCount,
+				};
+				workerContext[i].userTask = b2EnqueueTask( world, &b2SolverTask, workerContext + i, &info );
 				world->taskCount += 1;
 				world->activeTaskCount += workerContext[i].userTask == NULL ? 0 : 1;
 			}
@@ -1598,13 +3606,17 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 			}
 		}
 
-		// Finish island split
-		if ( splitIslandTask != NULL )
+		// Finish island splits
+		for ( int i = 0; i < splitCount; ++i )
 		{
-			world->finishTaskFcn( splitIslandTask, world->userTaskContext );
-			world->activeTaskCount -= 1;
+			if ( splitIslandTasks[i] != NULL )
+			{
+				world->finishTaskFcn( splitIslandTasks[i], world->userTaskContext );
+				world->activeTaskCount -= 1;
+			}
 		}
-		world->splitIslandId = B2_NULL_INDEX;
+		b2FinishIslandSplits( world, splits, splitCount );
+		B2_ASSERT( world->splitIslandCount == 0 );
 
 		world->profile.constraints = b2GetMillisecondsAndReset( &constraintTicks );
 		b2TracyCZoneEnd( solve_constraints );
@@ -1620,74 +3632,108 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 			taskContext->sensorHits.count = 0;
 			b2SetBitCountAndClear( &taskContext->enlargedSimBitSet, awakeBodyCount );
 			b2SetBitCountAndClear( &taskContext->awakeIslandBitSet, awakeIslandCount );
-			taskContext->splitIslandId = B2_NULL_INDEX;
-			taskContext->splitSleepTime = 0.0f;
+			taskContext->splitCandidateCount = 0;
+			b2Array_Clear( taskContext->kinematicBodyIds );
 		}
 
 		// Finalize bodies. Must happen after the constraint solver and after island splitting.
 		b2ParallelFor( world, &b2FinalizeBodiesTask, awakeBodyCount, 64, stepContext );
 
+		// Shape AABBs of the bodies that are not fast, in a flat pass per shape type
+		b2UpdateShapeAABBs( world, stepContext );
+
+		b2StackFree( &world->stack, overflowBlocks );
 		b2StackFree( &world->stack, graphBlocks );
 		b2StackFree( &world->stack, jointBlocks );
 		b2StackFree( &world->stack, contactBlocks );
 		b2StackFree( &world->stack, bodyBlocks );
 		b2StackFree( &world->stack, stages );
+		b2StackFree( &world->stack, overflowBodyMap );
+		b2StackFree( &world->stack, overflowEntries );
+		b2StackFree( &world->stack, overflowBodies );
+		b2StackFree( &world->stack, overflowSplitCounts );
+		b2StackFree( &world->stack, overflowDeltas );
 		b2StackFree( &world->stack, overflowContacts );
-		b2StackFree( &world->stack, wideContactConstraints );
+		b2StackFree( &world->stack, scalarJoints );
+		b2StackFree( &world->stack, wideJointConstraints );
+		if ( reuseFused == false )
+		{
+			b2StackFree( &world->stack, wideContactColdConstraints );
+			b2StackFree( &world->stack, wideContactConstraints );
+		}
+
+		// Fast non-bullet bodies versus static geometry. This only reads the static tree, so it
+		// can run while the user tree task rebuilds the other trees.
+		int fastBodyCount = b2AtomicLoadInt( &stepContext->fastBodyCount );
+		if ( fastBodyCount > 0 )
+		{
+			b2SolveContinuous( world, stepContext, stepContext->fastBodies, fastBodyCount );
+		}
+
+		b2StackFree( &world->stack, stepContext->fastBodies );
+		stepContext->fastBodies = NULL;
+		b2AtomicStoreInt( &stepContext->fastBodyCount, 0 );
 
 		world->profile.transforms = b2GetMilliseconds( transformTicks );
 		b2TracyCZoneEnd( update_transforms );
 	}
 
+	// The event arrays below keep their capacity from step to step
+	b2AllocInfo previousAllocInfo = b2PushAllocTag( b2_allocTagEvents, b2_allocLifetimeLong );
+
 	// Report joint events
 	{
 		b2TracyCZoneNC( joint_events, "Joint Events", b2_colorPeru, true );
 		uint64_t jointEventTicks = b2GetTicks();
 
-		// Gather bits for all joints that have force/torque events
-		b2BitSet* jointStateBitSet = &world->taskContexts.data[0].jointStateBitSet;
-		for ( int i = 1; i < world->workerCount; ++i )
+		// Gather the joints that crossed a force or torque threshold. Only those joints are visited.
+		int eventCount = 0;
+		for ( int i = 0; i < world->workerCount; ++i )
 		{
-			b2InPlaceUnion( jointStateBitSet, &world->taskContexts.data[i].jointStateBitSet );
+			eventCount += world->taskContexts.data[i].jointEventIds.count;
 		}
 
+		if ( eventCount > 0 )
 		{
-			uint32_t wordCount = jointStateBitSet->blockCount;
-			uint64_t* bits = jointStateBitSet->bits;
+			int* jointIds = b2StackAlloc( &world->stack, eventCount * sizeof( int ), "joint event ids" );
+			int count = 0;
+			for ( int i = 0; i < world->workerCount; ++i )
+			{
+				b2TaskContext* taskContext = world->taskContexts.data + i;
+				memcpy( jointIds + count, taskContext->jointEventIds.data, taskContext->jointEventIds.count * sizeof( int ) );
+				count += taskContext->jointEventIds.count;
+			}
+
+			// Sort by joint id so the event order does not depend on the worker that found the event
+			qsort( jointIds, eventCount, sizeof( int ), b2CompareIds );
 
 			b2Joint* jointArray = world->joints.data;
 			uint16_t worldIndex0 = world->worldId;
 
-			for ( uint32_t k = 0; k < wordCount; ++k )
+			for ( int i = 0; i < eventCount; ++i )
 			{
-				uint64_t word = bits[k];
-				while ( word != 0 )
-				{
-					uint32_t ctz = b2CTZ64( word );
-					int jointId = (int)( 64 * k + ctz );
-
-					B2_ASSERT( jointId < world->joints.capacity );
+				int jointId = jointIds[i];
+				B2_ASSERT( jointId < world->joints.capacity );
+				B2_ASSERT( i == 0 || jointIds[i - 1] < jointId );
 
-					b2Joint* joint = jointArray + jointId;
+				b2Joint* joint = jointArray + jointId;
 
-					B2_ASSERT( joint->setIndex == b2_awakeSet );
+				B2_ASSERT( joint->setIndex == b2_awakeSet );
 
-					b2JointEvent event = {
-						.jointId =
-							{
-								.index1 = jointId + 1,
-								.world0 = worldIndex0,
-								.generation = joint->generation,
-							},
-						.userData = joint->userData,
-					};
-
-					b2Array_Push( world->jointEvents, event );
+				b2JointEvent event = {
+					.jointId =
+						{
+							.index1 = jointId + 1,
+							.world0 = worldIndex0,
+							.generation = joint->generation,
+						},
+					.userData = joint->userData,
+				};
 
-					// Clear the smallest set bit
-					word = word & ( word - 1 );
-				}
+				b2Array_Push( world->jointEvents, event );
 			}
+
+			b2StackFree( &world->stack, jointIds );
 		}
 
 		world->profile.jointEvents = b2GetMilliseconds( jointEventTicks );
@@ -1701,103 +3747,25 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 
 		B2_ASSERT( world->contactHitEvents.count == 0 );
 
-		// Fast path: if no worker flagged any hit-event candidates during b2StoreImpulsesTask, skip entirely.
-		bool anyHitEvents = false;
+		// The hit events were built while storing the impulses
 		for ( int i = 0; i < world->workerCount; ++i )
 		{
-			if ( world->taskContexts.data[i].hasHitEvents )
-			{
-				anyHitEvents = true;
-				break;
-			}
+			b2TaskContext* taskContext = world->taskContexts.data + i;
+			b2Array_Append( world->contactHitEvents, taskContext->hitEvents );
 		}
 
-		if ( anyHitEvents )
+		if ( world->contactHitEvents.count > 1 )
 		{
-			// Union per-worker bits into worker 0's bit set.
-			b2BitSet* hitEventBitSet = &world->taskContexts.data[0].hitEventBitSet;
-			for ( int i = 1; i < world->workerCount; ++i )
-			{
-				if ( world->taskContexts.data[i].hasHitEvents )
-				{
-					b2InPlaceUnion( hitEventBitSet, &world->taskContexts.data[i].hitEventBitSet );
-				}
-			}
-
-			float threshold = world->hitEventThreshold;
-			b2GraphColor* colors = world->constraintGraph.colors;
-			b2Contact* contactArray = world->contacts.data;
-			b2Shape* shapeArray = world->shapes.data;
-			uint16_t worldId = world->worldId;
-
-			uint32_t wordCount = hitEventBitSet->blockCount;
-			uint64_t* bits = hitEventBitSet->bits;
-			for ( uint32_t k = 0; k < wordCount; ++k )
-			{
-				uint64_t word = bits[k];
-				while ( word != 0 )
-				{
-					uint32_t ctz = b2CTZ64( word );
-					int contactId = (int)( 64 * k + ctz );
-
-					b2Contact* contact = contactArray + contactId;
-					B2_ASSERT( contact->setIndex == b2_awakeSet && contact->colorIndex != B2_NULL_INDEX );
-
-					b2GraphColor* color = colors + contact->colorIndex;
-					b2ContactSim* contactSim = color->contactSims.data + contact->localIndex;
-
-					b2ContactHitEvent event = { 0 };
-					event.approachSpeed = threshold;
-
-					bool found = false;
-					int pointCount = contactSim->manifold.pointCount;
-					for ( int p = 0; p < pointCount; ++p )
-					{
-						b2ManifoldPoint* mp = contactSim->manifold.points + p;
-						float approachSpeed = -mp->normalVelocity;
-
-						// Need to check total impulse because the point may be speculative and not colliding
-						if ( approachSpeed > event.approachSpeed && mp->totalNormalImpulse > 0.0f )
-						{
-							event.approachSpeed = approachSpeed;
-							// Using the clip point here is somewhat questionable
-							event.point = mp->clipPoint;
-							found = true;
-						}
-					}
-
-					B2_VALIDATE( found );
-
-					if ( found == true )
-					{
-						event.normal = contactSim->manifold.normal;
-
-						b2Shape* shapeA = shapeArray + contactSim->shapeIdA;
-						b2Shape* shapeB = shapeArray + contactSim->shapeIdB;
-
-						event.shapeIdA = (b2ShapeId){ shapeA->id + 1, worldId, shapeA->generation };
-						event.shapeIdB = (b2ShapeId){ shapeB->id + 1, worldId, shapeB->generation };
-
-						event.contactId = (b2ContactId){
-							.index1 = contact->contactId + 1,
-							.world0 = worldId,
-							.padding = 0,
-							.generation = contact->generation,
-						};
-
-						b2Array_Push( world->contactHitEvents, event );
-					}
-
-					// Clear the smallest set bit
-					word = word & ( word - 1 );
-				}
-			}
+			qsort( world->contactHitEvents.data, world->contactHitEvents.count, sizeof( b2ContactHitEvent ),
+				   b2CompareHitEvents );
 		}
 
 		world->profile.hitEvents = b2GetMilliseconds( hitTicks );
 		b2TracyCZoneEnd( hit_events );
 	}
 
+	b2PopAllocInfo( previousAllocInfo );
+
 	{
 		b2TracyCZoneNC( refit_bvh, "Refit BVH", b2_colorFireBrick, true );
 		uint64_t refitTicks = b2GetTicks();
@@ -1814,11 +3782,8 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		b2ValidateNoEnlarged( &world->broadPhase );
 
 		// Gather bits for all sim bodies that have enlarged AABBs
+		b2UnionWorkerBitSets( world, offsetof( b2TaskContext, enlargedSimBitSet ) );
 		b2BitSet* enlargedBodyBitSet = &world->taskContexts.data[0].enlargedSimBitSet;
-		for ( int i = 1; i < world->workerCount; ++i )
-		{
-			b2InPlaceUnion( enlargedBodyBitSet, &world->taskContexts.data[i].enlargedSimBitSet );
-		}
 
 		// Enlarge broad-phase proxies and build move array
 		// Apply shape AABB changes to broad-phase. This also create the move array which must be
@@ -1827,64 +3792,63 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		{
 			b2BroadPhase* broadPhase = &world->broadPhase;
 			uint32_t wordCount = enlargedBodyBitSet->blockCount;
-			uint64_t* bits = enlargedBodyBitSet->bits;
 
 			// Fast array access is important here
 			b2Body* bodyArray = world->bodies.data;
 			b2BodySim* bodySimArray = awakeSet->bodySims.data;
 			b2Shape* shapeArray = world->shapes.data;
 
-			for ( uint32_t k = 0; k < wordCount; ++k )
+			b2BitIterator it = b2IterateBits( enlargedBodyBitSet, 0, 64 * wordCount );
+			uint32_t bitIndex;
+			while ( b2NextSetBit( &it, &bitIndex ) )
 			{
-				uint64_t word = bits[k];
-				while ( word != 0 )
-				{
-					uint32_t ctz = b2CTZ64( word );
-					uint32_t bodySimIndex = 64 * k + ctz;
+				uint32_t bodySimIndex = bitIndex;
 
-					b2BodySim* bodySim = bodySimArray + bodySimIndex;
+				b2BodySim* bodySim = bodySimArray + bodySimIndex;
 
-					b2Body* body = bodyArray + bodySim->bodyId;
+				b2Body* body = bodyArray + bodySim->bodyId;
 
-					int shapeId = body->headShapeId;
-					if ( ( bodySim->flags & ( b2_isBullet | b2_isFast ) ) == ( b2_isBullet | b2_isFast ) )
+				int shapeId = body->headShapeId;
+				if ( ( bodySim->flags & ( b2_isBullet | b2_isFast ) ) == ( b2_isBullet | b2_isFast ) )
+				{
+					// Fast bullet bodies don't have their final AABB yet
+					while ( shapeId != B2_NULL_INDEX )
 					{
-						// Fast bullet bodies don't have their final AABB yet
-						while ( shapeId != B2_NULL_INDEX )
-						{
-							b2Shape* shape = shapeArray + shapeId;
+						b2Shape* shape = shapeArray + shapeId;
 
-							// Shape is fast. It's aabb will be enlarged in continuous collision.
-							// Update the move array here for determinism because bullets are processed
-							// below in non-deterministic order.
-							b2BufferMove( broadPhase, shape->proxyKey );
+						// Shape is fast. It's aabb will be enlarged in continuous collision.
+						// Update the move array here for determinism because bullets are processed
+						// below in non-deterministic order.
+						b2BufferMove( broadPhase, shape->proxyKey );
 
-							shapeId = shape->nextShapeId;
-						}
+						shapeId = shape->nextShapeId;
 					}
-					else
+				}
+				else
+				{
+					while ( shapeId != B2_NULL_INDEX )
 					{
-						while ( shapeId != B2_NULL_INDEX )
+						b2Shape* shape = shapeArray + shapeId;
+
+						// The AABB may not have been enlarged, despite the body being flagged as enlarged.
+						// For example, a body with multiple shapes may have not have all shapes enlarged.
+						// A fast body may have been flagged as enlarged despite having no shapes enlarged.
+						if ( shape->enlargedAABB )
 						{
-							b2Shape* shape = shapeArray + shapeId;
-
-							// The AABB may not have been enlarged, despite the body being flagged as enlarged.
-							// For example, a body with multiple shapes may have not have all shapes enlarged.
-							// A fast body may have been flagged as enlarged despite having no shapes enlarged.
-							if ( shape->enlargedAABB )
-							{
-								b2BroadPhase_EnlargeProxy( broadPhase, shape->proxyKey, shape->fatAABB );
-								shape->enlargedAABB = false;
-							}
-
-							shapeId = shape->nextShapeId;
+							b2BufferMove( broadPhase, shape->proxyKey );
+							b2Array_Push( broadPhase->enlargedShapes, shapeId );
+							shape->enlargedAABB = false;
 						}
-					}
 
-					// Clear the smallest set bit
-					word = word & ( word - 1 );
+						shapeId = shape->nextShapeId;
+					}
 				}
 			}
+
+			// Kinematic set proxies follow the awake proxies in the move array
+			b2FinishKinematicBodies( world );
+
+			b2EnlargeBroadPhaseProxies( world );
 		}
 
 		b2ValidateBroadphase( &world->broadPhase );
@@ -1901,12 +3865,12 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 
 		// Fast bullet bodies
 		// Note: a bullet body may be moving slow
-		int minRange = 8;
-		b2ParallelFor( world, &b2BulletBodyTask, bulletBodyCount, minRange, stepContext );
+		b2SolveContinuous( world, stepContext, stepContext->bulletBodies, bulletBodyCount );
 
 		// Serially enlarge broad-phase proxies for bullet shapes
 		b2BroadPhase* broadPhase = &world->broadPhase;
 		b2DynamicTree* dynamicTree = broadPhase->trees + b2_dynamicBody;
+		broadPhase->dirtyTrees |= 1u << b2_dynamicBody;
 
 		// Fast array access is important here
 		b2Body* bodyArray = world->bodies.data;
@@ -1950,7 +3914,7 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 				B2_ASSERT( B2_PROXY_TYPE( proxyKey ) == b2_dynamicBody );
 
 				// all fast bullet shapes should already be in the move buffer
-				B2_ASSERT( b2ContainsKey( &broadPhase->moveSet, proxyKey + 1 ) );
+				B2_ASSERT( b2ContainsKey32( &broadPhase->moveSet, proxyKey ) );
 
 				b2DynamicTree_EnlargeProxy( dynamicTree, proxyId, shape->fatAABB );
 
@@ -2000,6 +3964,11 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		b2TracyCZoneEnd( sensor_hits );
 	}
 
+	if ( world->lodBodies.count > 0 )
+	{
+		b2RestoreLodBodies( world, stepContext->dt );
+	}
+
 	// Island sleeping
 	// This must be done last because putting islands to sleep invalidates the enlarged body bits.
 	// todo_erin figure out how to do this in parallel with tree refit
@@ -2008,36 +3977,54 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		b2TracyCZoneNC( sleep_islands, "Island Sleep", b2_colorLightSlateGray, true );
 		uint64_t sleepTicks = b2GetTicks();
 
-		// Collect split island candidate for the next time step. No need to split if sleeping is disabled.
-		B2_ASSERT( world->splitIslandId == B2_NULL_INDEX );
-		float splitSleepTimer = 0.0f;
-		for ( int i = 0; i < world->workerCount; ++i )
+		b2UnionWorkerBitSets( world, offsetof( b2TaskContext, awakeIslandBitSet ) );
+		b2BitSet* awakeIslandBitSet = &world->taskContexts.data[0].awakeIslandBitSet;
+
+		// Collect split island candidates for the next time step. No need to split if sleeping is disabled.
+		// Islands that are sleepy as a whole and only wait for a split come first, all of them are found in
+		// this one pass over the awake islands. The remaining room goes to the sleepiest bodies of islands
+		// that are still partly awake. The candidates are ordered by sleep time and island id, so the result
+		// does not depend on which worker finalized which body.
+		B2_ASSERT( world->splitIslandCount == 0 );
+		b2SplitCandidate candidates[B2_MAX_ISLAND_SPLITS];
+		int candidateCount = 0;
+
+		b2IslandSim* islands = awakeSet->islandSims.data;
+		int count = awakeSet->islandSims.count;
+		for ( int islandIndex = 0; islandIndex < count; ++islandIndex )
 		{
-			b2TaskContext* taskContext = world->taskContexts.data + i;
-			if ( taskContext->splitIslandId != B2_NULL_INDEX && taskContext->splitSleepTime >= splitSleepTimer )
+			if ( b2GetBit( awakeIslandBitSet, islandIndex ) == true )
 			{
-				B2_ASSERT( taskContext->splitSleepTime > 0.0f );
+				continue;
+			}
 
-				// Tie breaking for determinism. Largest island id wins. Needed due to work stealing.
-				if ( taskContext->splitSleepTime == splitSleepTimer && taskContext->splitIslandId < world->splitIslandId )
-				{
-					continue;
-				}
+			int islandId = islands[islandIndex].islandId;
+			b2Island* island = b2Array_Get( world->islands, islandId );
+			if ( island->constraintRemoveCount > 0 && island->bodies.count > 1 )
+			{
+				b2AddSplitCandidate( candidates, &candidateCount, world->maxIslandSplits, islandId, FLT_MAX );
+			}
+		}
 
-				world->splitIslandId = taskContext->splitIslandId;
-				splitSleepTimer = taskContext->splitSleepTime;
+		for ( int i = 0; i < world->workerCount; ++i )
+		{
+			b2TaskContext* taskContext = world->taskContexts.data + i;
+			for ( int j = 0; j < taskContext->splitCandidateCount; ++j )
+			{
+				b2SplitCandidate* candidate = taskContext->splitCandidates + j;
+				B2_ASSERT( candidate->sleepTime > 0.0f );
+				b2AddSplitCandidate( candidates, &candidateCount, world->maxIslandSplits, candidate->islandId,
+									 candidate->sleepTime );
 			}
 		}
 
-		b2BitSet* awakeIslandBitSet = &world->taskContexts.data[0].awakeIslandBitSet;
-		for ( int i = 1; i < world->workerCount; ++i )
+		for ( int i = 0; i < candidateCount; ++i )
 		{
-			b2InPlaceUnion( awakeIslandBitSet, &world->taskContexts.data[i].awakeIslandBitSet );
+			world->splitIslandIds[i] = candidates[i].islandId;
 		}
+		world->splitIslandCount = candidateCount;
 
 		// Need to process in reverse because this moves islands to sleeping solver sets.
-		b2IslandSim* islands = awakeSet->islandSims.data;
-		int count = awakeSet->islandSims.count;
 		for ( int islandIndex = count - 1; islandIndex >= 0; islandIndex -= 1 )
 		{
 			if ( b2GetBit( awakeIslandBitSet, islandIndex ) == true )
@@ -2057,4 +4044,18 @@ void b2Solve( b2World* world, b2StepContext* stepContext )
 		world->profile.sleepIslands = b2GetMilliseconds( sleepTicks );
 		b2TracyCZoneEnd( sleep_islands );
 	}
+
+	// Freeze islands outside of the active regions, also invalidates the enlarged body bits
+	if ( world->activeRegions.count > 0 )
+	{
+		b2FreezeIslands( world );
+	}
+
+	// Island level of detail, also invalidates the enlarged body bits
+	if ( world->lodBodyCount > 0 )
+	{
+		b2ParkIslands( world );
+	}
+
+	b2UpdateKinematicSet( world );
 }
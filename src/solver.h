@@ -31,31 +31,38 @@
 //    already claimed the block, so the stealing worker stops -- preserving
 //    locality under mild imbalance while still draining the queue.
 //
-// A graph color stage lays out joint blocks first, then contact blocks:
+// A graph color stage lays out scalar joint blocks first, then wide joint blocks,
+// then contact blocks:
 //
 //      stage->blocks ->
 //        +------+------+------+------+------+------+------+
-//        |  J0  |  J1  |  J2  |  C0  |  C1  |  C2  |  C3  |
+//        |  J0  |  J1  |  W0  |  C0  |  C1  |  C2  |  C3  |
 //        +------+------+------+------+------+------+------+
-//        <-- graphJointBlocks --><---- graphContactBlocks ---->
+//        <--- joint blocks ----><---- graphContactBlocks ---->
 //
-// Each block carries its type so the dispatcher routes J-blocks to the joint
-// solver and C-blocks to the SIMD contact solver; both kinds run concurrently
-// within the stage -- no barrier between them. The type tag lives on the
+// Each block carries its type so the dispatcher routes J-blocks to the scalar joint
+// solver, W-blocks to the SIMD joint solver, and C-blocks to the SIMD contact solver;
+// all kinds run concurrently within the stage -- no barrier between them. The type tag lives on the
 // block (not the stage) so that mixed-type stages can keep the concurrency.
 //
 // The solver threading model is inspired by https://github.com/bepu/bepuphysics2
 
 #pragma once
 
+#include "container.h"
 #include "core.h"
 
+#include "box2d/collision.h"
+#include "box2d/constants.h"
 #include "box2d/math_functions.h"
+#include "box2d/types.h"
 
 #include <stdbool.h>
 #include <stdint.h>
 
-#if B2_SIMD_WIDTH == 8
+#if B2_SIMD_WIDTH == 16
+#define B2_SIMD_SHIFT 4
+#elif B2_SIMD_WIDTH == 8
 #define B2_SIMD_SHIFT 3
 #elif B2_SIMD_WIDTH == 4
 #define B2_SIMD_SHIFT 2
@@ -67,11 +74,40 @@ typedef struct b2BodySim b2BodySim;
 typedef struct b2BodyState b2BodyState;
 typedef struct b2ContactSim b2ContactSim;
 typedef struct b2ContactConstraintWide b2ContactConstraintWide;
+typedef struct b2ContactConstraintWideCold b2ContactConstraintWideCold;
+typedef struct b2JointConstraintWide b2JointConstraintWide;
 typedef struct b2JointSim b2JointSim;
 typedef struct b2World b2World;
 
+// Candidate pair for continuous collision, a shape of a fast body versus a shape in its swept bounds
+typedef struct b2ContinuousPair
+{
+	// Index of the fast body in the continuous collision batch
+	int bodyIndex;
+	int fastShapeId;
+	int shapeId;
+
+	// Time of impact fraction, one if there is no hit
+	float fraction;
+
+	// Simplex of the final separating axis, kept for the persistent time of impact cache
+	b2SimplexCache cache;
+} b2ContinuousPair;
+
+b2DeclareArray( b2ContinuousPair );
+
+// Shape of a finalized body waiting for its AABB update, grouped by shape type for the wide kernels
+typedef struct b2ShapeAABBUpdate
+{
+	int shapeId;
+	int simIndex;
+} b2ShapeAABBUpdate;
+
+b2DeclareArray( b2ShapeAABBUpdate );
+
 // Solver stages. Prepare joints and prepare contacts are split up
-// because there is no need to store joint impulses.
+// because only wide joints need to store impulses. The overflow stages are only used
+// by the parallel overflow mode and are re-used for every overflow pass.
 typedef enum b2SolverStageType
 {
 	b2_stagePrepareJoints,
@@ -82,7 +118,10 @@ typedef enum b2SolverStageType
 	b2_stageIntegratePositions,
 	b2_stageRelax,
 	b2_stageRestitution,
-	b2_stageStoreImpulses
+	b2_stageStoreJoints,
+	b2_stageStoreImpulses,
+	b2_stageOverflowContacts,
+	b2_stageOverflowBodies
 } b2SolverStageType;
 
 typedef enum b2SolverBlockType
@@ -90,7 +129,9 @@ typedef enum b2SolverBlockType
 	b2_bodyBlock,
 	b2_jointBlock,
 	b2_contactBlock,
+	b2_wideJointBlock,
 	b2_graphJointBlock,
+	b2_graphWideJointBlock,
 	b2_graphContactBlock
 } b2SolverBlockType;
 
@@ -120,6 +161,9 @@ typedef struct b2SolverStage
 	b2SolverStageType type;
 	int blockCount;
 	uint8_t colorIndex;
+
+	// Executed by the main thread alone, see B2_INLINE_COLOR_ITEM_COUNT
+	bool runInline;
 	b2AtomicInt completionCount;
 } b2SolverStage;
 
@@ -141,15 +185,37 @@ typedef struct b2ContactPrepareSpan
 	int start;
 	int count;
 	b2ContactSim* contacts;
+
+	// The narrow phase already prepared this color, see b2FusedPrepare
+	bool prepared;
 } b2ContactPrepareSpan;
 
-// Similar for joints
-typedef struct b2JointPrepareSpan
+// Wide contact constraints of the graph colors prepared by the narrow phase, see b2WorldDef::enableFusedPrepare.
+// The layout matches the one b2Solve uses if no contact joins or leaves a color before the solve. Colors
+// that change are prepared again by the solver.
+typedef struct b2FusedPrepare
 {
-	int start;
-	int count;
-	b2JointSim* joints;
-} b2JointPrepareSpan;
+	b2ContactConstraintWide* constraints;
+	b2ContactConstraintWideCold* colds;
+	int wideCount;
+
+	// Wide start and contact count of each color when the contacts were gathered. The overflow color
+	// has no wide constraints and its start is a sentinel at wideCount.
+	int colorStarts[B2_GRAPH_COLOR_COUNT];
+	int colorCounts[B2_GRAPH_COLOR_COUNT];
+} b2FusedPrepare;
+
+// Spin iterations of a waiting solver thread before it yields or parks, see b2WorldDef::waitSpinCount
+#define B2_DEFAULT_WAIT_SPIN_COUNT 6
+
+// With automatic worker counts the constraint solver uses one worker per this many awake bodies and
+// constraints, see b2WorldDef::enableAutoWorkers
+#define B2_AUTO_WORKER_ITEM_COUNT 512
+
+// A graph color with at most this many wide contacts and joints is solved by the main thread without
+// waking the workers. The next color cannot start before it finishes either way, so this only drops a
+// fork and join that costs more than the work it would share.
+#define B2_INLINE_COLOR_ITEM_COUNT 8
 
 // Context for a time step. Recreated each time step.
 typedef struct b2StepContext
@@ -189,6 +255,13 @@ typedef struct b2StepContext
 	int* bulletBodies;
 	b2AtomicInt bulletBodyCount;
 
+	// Array of fast non-bullet bodies that need continuous collision handling
+	int* fastBodies;
+	b2AtomicInt fastBodyCount;
+
+	// Number of small islands solved by their own task in this step, see b2SolveSmallIslands
+	int islandSolveCount;
+
 	// contact pointers for simplified parallel-for access.
 	// - parallel-for collide with no gaps, includes touching and non-touching
 	b2ContactSim** contactSims;
@@ -196,13 +269,36 @@ typedef struct b2StepContext
 	// Flat view of the wide contact constraint array used by prepare and store.
 	// prepareSpans has activeColorCount + 1 entries, the last being a sentinel
 	// at wideContactCount. wideContactConstraints is the contiguous base
-	// pointer; per-color slices live at colors[i].wideConstraints.
+	// pointer; per-color slices live at colors[i].wideConstraints. The cold data is a parallel
+	// array with the same indices.
 	b2ContactConstraintWide* wideContactConstraints;
+	b2ContactConstraintWideCold* wideContactColdConstraints;
 	b2ContactPrepareSpan* contactPrepareSpans;
 	int wideContactCount;
+
+	// Union of the b2ContactFeatures of the prepared wide contacts, selects the solver kernels
+	b2AtomicInt contactFeatures;
+
+	// Stack allocated by the narrow phase and freed after the solve
+	b2FusedPrepare fusedPrepare;
 	
-	b2JointPrepareSpan* jointPrepareSpans;
-	int jointCount;
+	// Graph joints are split into scalar joints and wide joint constraints. Both arrays are
+	// contiguous across colors so prepare and store run as flat parallel-for loops. Per-color
+	// slices live at colors[i].scalarJoints and colors[i].wideJoints.
+	b2JointSim** scalarJoints;
+	int scalarJointCount;
+	struct b2JointConstraintWide* wideJointConstraints;
+	int wideJointCount;
+
+	// Parallel overflow contact solver, see b2SolveOverflowContactsTask. The split counts hold
+	// the number of overflow contacts on body A and body B of each overflow contact.
+	struct b2ContactVelocities* overflowDeltas;
+	int* overflowSplitCounts;
+	struct b2OverflowBody* overflowBodies;
+	int* overflowEntries;
+	int overflowBodyCount;
+	b2SolverStageType overflowStage;
+	bool enableParallelOverflow;
 
 	int activeColorCount;
 	int workerCount;
@@ -210,6 +306,14 @@ typedef struct b2StepContext
 	b2SolverStage* stages;
 	int stageCount;
 	bool enableWarmStarting;
+	bool enableWorkerProfile;
+
+	// Degraded work of a step over its budget, see b2DegradeStep
+	bool reduceRelax;
+	bool deferContinuous;
+
+	b2WaitPolicy waitPolicy;
+	int waitSpinCount;
 
 	// padding to prevent false sharing
 	char padding1[64];
@@ -221,6 +325,11 @@ typedef struct b2StepContext
 	// sync index (16-bits) | stage type (16-bits)
 	b2AtomicU32 atomicSyncBits;
 
+	// Workers parked on atomicSyncBits and whether the main thread is parked on a stage completion
+	// count. Only used by b2_waitPark, so the signaling side can skip the wake call when nobody sleeps.
+	b2AtomicInt parkedWorkerCount;
+	b2AtomicInt mainParked;
+
 	// padding to prevent false sharing
 	char padding2[64];
 
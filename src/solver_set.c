@@ -7,21 +7,35 @@
 #include "constraint_graph.h"
 #include "contact.h"
 #include "core.h"
+#include "ctz.h"
 #include "island.h"
 #include "joint.h"
 #include "physics_world.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 void b2DestroySolverSet( b2World* world, int setIndex )
 {
 	b2SolverSet* set = b2Array_Get( world->solverSets, setIndex );
+	if ( set->simulationInterval > 0 )
+	{
+		world->parkedSetCount -= 1;
+	}
+
+	if ( set->isFrozen )
+	{
+		world->frozenSetCount -= 1;
+	}
+
 	b2Array_Destroy( set->bodySims );
 	b2Array_Destroy( set->bodyStates );
 	b2Array_Destroy( set->contactSims );
+	b2Array_Destroy( set->compactContactSims );
 	b2Array_Destroy( set->jointSims );
 	b2Array_Destroy( set->islandSims );
 	b2FreeId( &world->solverSetIdPool, setIndex );
+	b2MarkDirty( world, b2_dirtySolverSet, setIndex );
 	*set = ( b2SolverSet ){ 0 };
 	set->setIndex = B2_NULL_INDEX;
 }
@@ -32,16 +46,44 @@ void b2DestroySolverSet( b2World* world, int setIndex )
 // 2. non-touching contacts already in the awake set
 // 3. touching contacts in the sleeping set
 // This handles contact types 1 and 3. Type 2 doesn't need any action.
+// Parked and frozen sets keep their velocities and sleep timers. The bodies of a parked set are
+// simulated with the time of the skipped steps in the next step.
 void b2WakeSolverSet( b2World* world, int setIndex )
 {
 	B2_ASSERT( setIndex >= b2_firstSleepingSet );
+	world->bodyRefEpoch += 1;
 	b2SolverSet* set = b2Array_Get( world->solverSets, setIndex );
 	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
 	b2SolverSet* disabledSet = b2Array_Get( world->solverSets, b2_disabledSet );
 
+	b2MarkDirty( world, b2_dirtySolverSet, setIndex );
+	b2MarkDirty( world, b2_dirtySolverSet, b2_disabledSet );
+
+	bool keepVelocity = set->simulationInterval > 0 || set->isFrozen;
+	float timeScale = 1.0f;
+	if ( set->simulationInterval > 0 )
+	{
+		// The next step is the first step not covered by the last simulation of the island
+		B2_ASSERT( world->stepIndex >= set->parkStepIndex );
+		timeScale = (float)( world->stepIndex + 1 - set->parkStepIndex );
+	}
+
+	if ( keepVelocity == false )
+	{
+		world->wokenSetCount += 1;
+	}
+
 	b2Body* bodies = world->bodies.data;
 
+	// Bodies are appended to the awake set in sleeping order, so the sims are copied as one block
 	int bodyCount = set->bodySims.count;
+	int awakeBodyBase = awakeSet->bodySims.count;
+	b2Array_ReserveGrow( awakeSet->bodySims, awakeBodyBase + bodyCount );
+	b2Array_ReserveGrow( awakeSet->bodyStates, awakeBodyBase + bodyCount );
+	awakeSet->bodySims.count = awakeBodyBase + bodyCount;
+	awakeSet->bodyStates.count = awakeBodyBase + bodyCount;
+	memcpy( awakeSet->bodySims.data + awakeBodyBase, set->bodySims.data, bodyCount * sizeof( b2BodySim ) );
+
 	for ( int i = 0; i < bodyCount; ++i )
 	{
 		b2BodySim* simSrc = set->bodySims.data + i;
@@ -49,18 +91,32 @@ void b2WakeSolverSet( b2World* world, int setIndex )
 		b2Body* body = bodies + simSrc->bodyId;
 		B2_ASSERT( body->setIndex == setIndex );
 		body->setIndex = b2_awakeSet;
-		body->localIndex = awakeSet->bodySims.count;
-
-		// Reset sleep timer
-		body->sleepTime = 0.0f;
+		body->localIndex = awakeBodyBase + i;
 
-		b2BodySim* simDst = b2Array_Emplace( awakeSet->bodySims );
-		memcpy( simDst, simSrc, sizeof( b2BodySim ) );
-
-		b2BodyState* state = b2Array_Emplace( awakeSet->bodyStates );
+		b2BodyState* state = awakeSet->bodyStates.data + awakeBodyBase + i;
 		*state = b2_identityBodyState;
 		state->flags = body->flags;
 
+		if ( keepVelocity )
+		{
+			state->linearVelocity = body->parkedLinearVelocity;
+			state->angularVelocity = body->parkedAngularVelocity;
+
+			if ( timeScale > 1.0f )
+			{
+				b2LodBody lodBody = { 0 };
+				lodBody.bodyId = simSrc->bodyId;
+				lodBody.generation = body->generation;
+				lodBody.timeScale = timeScale;
+				b2Array_Push( world->lodBodies, lodBody );
+			}
+		}
+		else
+		{
+			// Reset sleep timer
+			body->sleepTime = 0.0f;
+		}
+
 		// move non-touching contacts from disabled set to awake set
 		int contactKey = body->headContactKey;
 		while ( contactKey != B2_NULL_INDEX )
@@ -107,13 +163,29 @@ void b2WakeSolverSet( b2World* world, int setIndex )
 		{
 			b2ContactSim* contactSim = set->contactSims.data + i;
 			b2Contact* contact = b2Array_Get( world->contacts, contactSim->contactId );
-			B2_ASSERT( contact->flags & b2_contactTouchingFlag );
-			B2_ASSERT( contactSim->simFlags & b2_simTouchingFlag );
-			B2_ASSERT( contactSim->manifold.pointCount > 0 );
 			B2_ASSERT( contact->setIndex == setIndex );
-			b2AddContactToGraph( world, contactSim, contact );
 			contact->setIndex = b2_awakeSet;
 		}
+
+		b2AddContactsToGraph( world, set->contactSims.data, contactCount );
+	}
+
+	// compact contacts are expanded against the woken body transforms
+	if ( set->compactContactSims.count > 0 )
+	{
+		int contactCount = set->compactContactSims.count;
+		b2ContactSim* contactSims = b2StackAlloc( &world->stack, contactCount * sizeof( b2ContactSim ), "wake contacts" );
+		for ( int i = 0; i < contactCount; ++i )
+		{
+			b2CompactContactSim* compactSim = set->compactContactSims.data + i;
+			b2Contact* contact = b2Array_Get( world->contacts, compactSim->contactId );
+			B2_ASSERT( contact->setIndex == setIndex );
+			contact->setIndex = b2_awakeSet;
+			b2ExpandContactSim( world, contactSims + i, compactSim );
+		}
+
+		b2AddContactsToGraph( world, contactSims, contactCount );
+		b2StackFree( &world->stack, contactSims );
 	}
 
 	// transfer joints from sleeping set to awake set
@@ -124,9 +196,10 @@ void b2WakeSolverSet( b2World* world, int setIndex )
 			b2JointSim* jointSim = set->jointSims.data + i;
 			b2Joint* joint = b2Array_Get( world->joints, jointSim->jointId );
 			B2_ASSERT( joint->setIndex == setIndex );
-			b2AddJointToGraph( world, jointSim, joint );
 			joint->setIndex = b2_awakeSet;
 		}
+
+		b2AddJointsToGraph( world, set->jointSims.data, jointCount );
 	}
 
 	// transfer island from sleeping set to awake set
@@ -135,14 +208,17 @@ void b2WakeSolverSet( b2World* world, int setIndex )
 	// are moved to the same sleeping set.
 	{
 		int islandCount = set->islandSims.count;
+		int awakeIslandBase = awakeSet->islandSims.count;
+		b2Array_ReserveGrow( awakeSet->islandSims, awakeIslandBase + islandCount );
+		awakeSet->islandSims.count = awakeIslandBase + islandCount;
+		memcpy( awakeSet->islandSims.data + awakeIslandBase, set->islandSims.data, islandCount * sizeof( b2IslandSim ) );
+
 		for ( int i = 0; i < islandCount; ++i )
 		{
 			b2IslandSim* islandSrc = set->islandSims.data + i;
 			b2Island* island = b2Array_Get( world->islands, islandSrc->islandId );
 			island->setIndex = b2_awakeSet;
-			island->localIndex = awakeSet->islandSims.count;
-			b2IslandSim* islandDst = b2Array_Emplace( awakeSet->islandSims );
-			memcpy( islandDst, islandSrc, sizeof( b2IslandSim ) );
+			island->localIndex = awakeIslandBase + i;
 		}
 	}
 
@@ -150,12 +226,88 @@ void b2WakeSolverSet( b2World* world, int setIndex )
 	b2DestroySolverSet( world, setIndex );
 }
 
+// Moves the sim, state, and island of a body between the awake and kinematic sets
+static void b2MoveKinematicBody( b2World* world, b2Body* body, int targetSetIndex )
+{
+	world->bodyRefEpoch += 1;
+	int sourceSetIndex = body->setIndex;
+	b2SolverSet* sourceSet = b2Array_Get( world->solverSets, sourceSetIndex );
+	b2SolverSet* targetSet = b2Array_Get( world->solverSets, targetSetIndex );
+
+	b2MarkDirty( world, b2_dirtyBody, body->id );
+	b2MarkDirty( world, b2_dirtySolverSet, sourceSetIndex );
+	b2MarkDirty( world, b2_dirtySolverSet, targetSetIndex );
+
+	int sourceIndex = body->localIndex;
+	int targetIndex = targetSet->bodySims.count;
+	b2Array_Push( targetSet->bodySims, sourceSet->bodySims.data[sourceIndex] );
+	b2Array_Push( targetSet->bodyStates, sourceSet->bodyStates.data[sourceIndex] );
+
+	b2RemoveBodySim( &sourceSet->bodySims, &world->bodies, sourceIndex );
+	(void)b2Array_RemoveSwap( sourceSet->bodyStates, sourceIndex );
+
+	body->setIndex = targetSetIndex;
+	body->localIndex = targetIndex;
+
+	// The island only holds this body
+	int islandId = body->islandId;
+	b2Island* island = b2Array_Get( world->islands, islandId );
+	B2_ASSERT( island->setIndex == sourceSetIndex && island->bodies.count == 1 );
+	b2MarkDirty( world, b2_dirtyIsland, islandId );
+
+	int islandIndex = island->localIndex;
+	int movedIslandIndex = b2Array_RemoveSwap( sourceSet->islandSims, islandIndex );
+	if ( movedIslandIndex != B2_NULL_INDEX )
+	{
+		// fix index on moved element
+		b2IslandSim* movedIslandSim = sourceSet->islandSims.data + islandIndex;
+		b2Island* movedIsland = b2Array_Get( world->islands, movedIslandSim->islandId );
+		B2_ASSERT( movedIsland->localIndex == movedIslandIndex );
+		movedIsland->localIndex = islandIndex;
+	}
+
+	island->setIndex = targetSetIndex;
+	island->localIndex = targetSet->islandSims.count;
+	b2IslandSim* islandSim = b2Array_Emplace( targetSet->islandSims );
+	islandSim->islandId = islandId;
+}
+
+// Called at the end of the step for kinematic bodies that have no joints and no touching contacts.
+// Non-touching contacts stay in the awake set.
+void b2DetachKinematicBody( b2World* world, b2Body* body )
+{
+	B2_ASSERT( body->type == b2_kinematicBody && body->setIndex == b2_awakeSet );
+	B2_ASSERT( body->headJointKey == B2_NULL_INDEX );
+
+	b2Island* island = b2Array_Get( world->islands, body->islandId );
+	B2_ASSERT( island->contacts.count == 0 && island->joints.count == 0 );
+
+	// A lone body needs no split
+	b2RemoveSplitIsland( world, body->islandId );
+	island->constraintRemoveCount = 0;
+	b2Array_Clear( island->removedLinks );
+	island->untrackedRemovals = false;
+
+	b2MoveKinematicBody( world, body, b2_kinematicSet );
+}
+
+// Called before a kinematic body joins the constraint graph or falls asleep
+void b2AttachKinematicBody( b2World* world, b2Body* body )
+{
+	if ( body->setIndex == b2_kinematicSet )
+	{
+		b2MoveKinematicBody( world, body, b2_awakeSet );
+	}
+}
+
 // Islands need to have a deterministic order because data is moved to a sleeping set according
-// to island order.
-void b2TrySleepIsland( b2World* world, int islandId )
+// to island order. A non-zero simulation interval parks the island instead of putting it to sleep.
+// Parked and frozen islands keep their velocities.
+static void b2MoveIslandToSet( b2World* world, int islandId, int simulationInterval, bool freeze, b2AABB bounds )
 {
 	b2Island* island = b2Array_Get( world->islands, islandId );
 	B2_ASSERT( island->setIndex == b2_awakeSet );
+	world->bodyRefEpoch += 1;
 
 	// Cannot put an island to sleep while it has a pending split and more than one body.
 	if ( island->constraintRemoveCount > 0 && island->bodies.count > 1 )
@@ -179,6 +331,18 @@ void b2TrySleepIsland( b2World* world, int islandId )
 
 	b2SolverSet* sleepSet = b2Array_Get( world->solverSets, sleepSetId );
 	*sleepSet = ( b2SolverSet ){ 0 };
+	sleepSet->simulationInterval = simulationInterval;
+	sleepSet->parkStepIndex = world->stepIndex;
+	sleepSet->frozenBounds = bounds;
+
+	// Parked sets are woken too often to be worth compacting
+	sleepSet->isCompact = world->enableCompactContacts && world->compactSleepSteps == 0 && simulationInterval == 0;
+	sleepSet->isFrozen = freeze;
+	world->parkedSetCount += simulationInterval > 0 ? 1 : 0;
+	world->frozenSetCount += freeze ? 1 : 0;
+
+	b2MarkDirty( world, b2_dirtySolverSet, sleepSetId );
+	b2MarkDirty( world, b2_dirtySolverSet, b2_disabledSet );
 
 	// grab awake set after creating the sleep set because the solver set array may have been resized
 	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
@@ -186,7 +350,14 @@ void b2TrySleepIsland( b2World* world, int islandId )
 
 	sleepSet->setIndex = sleepSetId;
 	b2Array_CreateN( sleepSet->bodySims, island->bodies.count );
-	b2Array_CreateN( sleepSet->contactSims, island->contacts.count );
+	if ( b2IsCompactContactSet( world, sleepSetId ) )
+	{
+		b2Array_CreateN( sleepSet->compactContactSims, island->contacts.count );
+	}
+	else
+	{
+		b2Array_CreateN( sleepSet->contactSims, island->contacts.count );
+	}
 	b2Array_CreateN( sleepSet->jointSims, island->joints.count );
 
 	// move awake bodies to sleeping set
@@ -208,13 +379,21 @@ void b2TrySleepIsland( b2World* world, int islandId )
 				b2BodyMoveEvent* moveEvent = b2Array_Get( world->bodyMoveEvents, body->bodyMoveIndex );
 				B2_ASSERT( moveEvent->bodyId.index1 - 1 == bodyId );
 				B2_ASSERT( moveEvent->bodyId.generation == body->generation );
-				moveEvent->fellAsleep = true;
+				moveEvent->fellAsleep = simulationInterval == 0;
 				body->bodyMoveIndex = B2_NULL_INDEX;
 			}
 
 			int awakeBodyIndex = body->localIndex;
 			b2BodySim* awakeSim = b2Array_Get( awakeSet->bodySims, awakeBodyIndex );
 
+			if ( simulationInterval > 0 || freeze )
+			{
+				// parked and frozen bodies keep moving when woken
+				b2BodyState* awakeState = b2Array_Get( awakeSet->bodyStates, awakeBodyIndex );
+				body->parkedLinearVelocity = awakeState->linearVelocity;
+				body->parkedAngularVelocity = awakeState->angularVelocity;
+			}
+
 			// move body sim to sleep set
 			int sleepBodyIndex = sleepSet->bodySims.count;
 			b2BodySim* sleepBodySim = b2Array_Emplace( sleepSet->bodySims );
@@ -259,7 +438,7 @@ void b2TrySleepIsland( b2World* world, int islandId )
 				int otherEdgeIndex = edgeIndex ^ 1;
 				int otherBodyId = contact->edges[otherEdgeIndex].bodyId;
 				b2Body* otherBody = b2Array_Get( world->bodies, otherBodyId );
-				if ( otherBody->setIndex == b2_awakeSet )
+				if ( b2IsMovingSet( otherBody->setIndex ) )
 				{
 					continue;
 				}
@@ -314,9 +493,18 @@ void b2TrySleepIsland( b2World* world, int islandId )
 			int localIndex = contact->localIndex;
 			b2ContactSim* awakeContactSim = b2Array_Get( color->contactSims, localIndex );
 
-			int sleepContactIndex = sleepSet->contactSims.count;
-			b2ContactSim* sleepContactSim = b2Array_Emplace( sleepSet->contactSims );
-			memcpy( sleepContactSim, awakeContactSim, sizeof( b2ContactSim ) );
+			int sleepContactIndex;
+			if ( b2IsCompactContactSet( world, sleepSetId ) )
+			{
+				sleepContactIndex = sleepSet->compactContactSims.count;
+				b2CompressContactSim( b2Array_Emplace( sleepSet->compactContactSims ), awakeContactSim );
+			}
+			else
+			{
+				sleepContactIndex = sleepSet->contactSims.count;
+				b2ContactSim* sleepContactSim = b2Array_Emplace( sleepSet->contactSims );
+				memcpy( sleepContactSim, awakeContactSim, sizeof( b2ContactSim ) );
+			}
 
 			int movedLocalIndex = b2Array_RemoveSwap( color->contactSims, localIndex );
 			if ( movedLocalIndex != B2_NULL_INDEX )
@@ -403,12 +591,152 @@ void b2TrySleepIsland( b2World* world, int islandId )
 		island->localIndex = 0;
 	}
 
-	if (world->splitIslandId == islandId)
+	b2RemoveSplitIsland( world, islandId );
+
+	b2ValidateSolverSets( world );
+}
+
+void b2TrySleepIsland( b2World* world, int islandId )
+{
+	b2MoveIslandToSet( world, islandId, 0, false, ( b2AABB ){ 0 } );
+}
+
+bool b2IsParkedSet( const b2World* world, int setIndex )
+{
+	return setIndex >= b2_firstSleepingSet && world->solverSets.data[setIndex].simulationInterval > 0;
+}
+
+// Moves an awake island out of the awake solver arrays until its next update step
+void b2ParkIsland( b2World* world, int islandId, int simulationInterval )
+{
+	B2_ASSERT( simulationInterval > 1 );
+	b2MoveIslandToSet( world, islandId, simulationInterval, false, ( b2AABB ){ 0 } );
+}
+
+bool b2KeepsVelocity( const b2World* world, int setIndex )
+{
+	if ( setIndex < b2_firstSleepingSet )
+	{
+		return false;
+	}
+
+	const b2SolverSet* set = world->solverSets.data + setIndex;
+	return set->simulationInterval > 0 || set->isFrozen;
+}
+
+// Moves an island outside of the active regions to a frozen set. The bounds are kept to test the set
+// against the active regions without visiting its bodies.
+void b2FreezeIsland( b2World* world, int islandId, b2AABB bounds )
+{
+	b2MoveIslandToSet( world, islandId, 0, true, bounds );
+}
+
+// Wakes the frozen sets that overlap an active region, or all of them if there are no active regions
+void b2ThawFrozenSets( b2World* world )
+{
+	const b2AABB* regions = world->activeRegions.data;
+	int regionCount = world->activeRegions.count;
+
+	// Waking only destroys the woken set, so the other set indices remain valid
+	int setCount = world->solverSets.count;
+	for ( int setIndex = b2_firstSleepingSet; setIndex < setCount && world->frozenSetCount > 0; ++setIndex )
 	{
-		world->splitIslandId = B2_NULL_INDEX;
+		b2SolverSet* set = world->solverSets.data + setIndex;
+		if ( set->setIndex == B2_NULL_INDEX || set->isFrozen == false )
+		{
+			continue;
+		}
+
+		bool thaw = regionCount == 0;
+		for ( int i = 0; i < regionCount && thaw == false; ++i )
+		{
+			thaw = b2AABB_Overlaps( set->frozenBounds, regions[i] );
+		}
+
+		if ( thaw )
+		{
+			b2WakeSolverSet( world, setIndex );
+		}
 	}
+}
 
-	b2ValidateSolverSets( world );
+void b2CompactSolverSet( b2World* world, int setIndex )
+{
+	B2_ASSERT( setIndex >= b2_firstSleepingSet );
+	b2SolverSet* set = b2Array_Get( world->solverSets, setIndex );
+	B2_ASSERT( set->isCompact == false && set->simulationInterval == 0 );
+
+	// The order is kept so the contact local indices stay valid
+	int contactCount = set->contactSims.count;
+	b2Array_Reserve( set->compactContactSims, contactCount );
+	for ( int i = 0; i < contactCount; ++i )
+	{
+		b2CompressContactSim( b2Array_Emplace( set->compactContactSims ), set->contactSims.data + i );
+	}
+
+	b2Array_Destroy( set->contactSims );
+	set->isCompact = true;
+
+	// Sleeping sets only grow by merging, so the slack left from building them is released
+	b2Array_ShrinkToFit( set->bodySims, 0 );
+	b2Array_ShrinkToFit( set->jointSims, 0 );
+	b2Array_ShrinkToFit( set->compactContactSims, 0 );
+	b2Array_ShrinkToFit( set->islandSims, 0 );
+
+	b2MarkDirty( world, b2_dirtySolverSet, setIndex );
+}
+
+void b2CompactSleepingSets( b2World* world )
+{
+	b2TracyCZoneNC( compact_sets, "Compact Sets", b2_colorDarkSeaGreen, true );
+
+	uint64_t sleepSteps = (uint64_t)world->compactSleepSteps;
+	int setCount = world->solverSets.count;
+	for ( int setIndex = b2_firstSleepingSet; setIndex < setCount; ++setIndex )
+	{
+		b2SolverSet* set = world->solverSets.data + setIndex;
+		if ( set->setIndex == B2_NULL_INDEX || set->isCompact || set->simulationInterval > 0 )
+		{
+			continue;
+		}
+
+		if ( world->stepIndex - set->parkStepIndex >= sleepSteps )
+		{
+			b2CompactSolverSet( world, setIndex );
+		}
+	}
+
+	b2TracyCZoneEnd( compact_sets );
+}
+
+// Islands with the same interval are staggered by island id, like sensor updates
+static bool b2IsParkedSetDue( const b2SolverSet* set, uint64_t stepIndex )
+{
+	B2_ASSERT( set->islandSims.count > 0 );
+	uint64_t islandId = (uint64_t)set->islandSims.data[0].islandId;
+	return ( stepIndex + islandId ) % (uint64_t)set->simulationInterval == 0;
+}
+
+// Wakes the parked sets that are updated in the next step
+void b2WakeParkedSets( b2World* world )
+{
+	uint64_t nextStepIndex = world->stepIndex + 1;
+
+	// Waking only destroys the woken set, so the other set indices remain valid
+	int setCount = world->solverSets.count;
+	for ( int setIndex = b2_firstSleepingSet; setIndex < setCount; ++setIndex )
+	{
+		b2SolverSet* set = world->solverSets.data + setIndex;
+		if ( set->setIndex == B2_NULL_INDEX || set->simulationInterval == 0 )
+		{
+			continue;
+		}
+
+		if ( b2IsParkedSetDue( set, nextStepIndex ) )
+		{
+			b2WakeSolverSet( world, setIndex );
+		}
+	}
 }
 
 // This is called when joints are created between sets. I want to allow the sets
@@ -418,9 +746,14 @@ void b2MergeSolverSets( b2World* world, int setId1, int setId2 )
 {
 	B2_ASSERT( setId1 >= b2_firstSleepingSet );
 	B2_ASSERT( setId2 >= b2_firstSleepingSet );
+	B2_ASSERT( b2KeepsVelocity( world, setId1 ) == false && b2KeepsVelocity( world, setId2 ) == false );
+	world->bodyRefEpoch += 1;
 	b2SolverSet* set1 = b2Array_Get( world->solverSets, setId1 );
 	b2SolverSet* set2 = b2Array_Get( world->solverSets, setId2 );
 
+	b2MarkDirty( world, b2_dirtySolverSet, setId1 );
+	b2MarkDirty( world, b2_dirtySolverSet, setId2 );
+
 	// Move the fewest number of bodies
 	if ( set1->bodySims.count < set2->bodySims.count )
 	{
@@ -433,6 +766,14 @@ void b2MergeSolverSets( b2World* world, int setId1, int setId2 )
 		setId2 = tempId;
 	}
 
+	// Both sets need the same contact storage. The merged set sleeps since the later of the two.
+	if ( set1->isCompact != set2->isCompact )
+	{
+		b2CompactSolverSet( world, set1->isCompact ? setId2 : setId1 );
+	}
+
+	set1->parkStepIndex = set1->parkStepIndex > set2->parkStepIndex ? set1->parkStepIndex : set2->parkStepIndex;
+
 	// transfer bodies
 	{
 		b2Body* bodies = world->bodies.data;
@@ -466,6 +807,19 @@ void b2MergeSolverSets( b2World* world, int setId1, int setId2 )
 			b2ContactSim* contactDst = b2Array_Emplace( set1->contactSims );
 			memcpy( contactDst, contactSrc, sizeof( b2ContactSim ) );
 		}
+
+		contactCount = set2->compactContactSims.count;
+		for ( int i = 0; i < contactCount; ++i )
+		{
+			b2CompactContactSim* contactSrc = set2->compactContactSims.data + i;
+
+			b2Contact* contact = b2Array_Get( world->contacts, contactSrc->contactId );
+			B2_ASSERT( contact->setIndex == setId2 );
+			contact->setIndex = setId1;
+			contact->localIndex = set1->compactContactSims.count;
+
+			b2Array_Push( set1->compactContactSims, *contactSrc );
+		}
 	}
 
 	// transfer joints
@@ -515,6 +869,11 @@ void b2TransferBody( b2World* world, b2SolverSet* targetSet, b2SolverSet* source
 		return;
 	}
 
+	b2MarkDirty( world, b2_dirtyBody, body->id );
+	b2MarkDirty( world, b2_dirtySolverSet, sourceSet->setIndex );
+	b2MarkDirty( world, b2_dirtySolverSet, targetSet->setIndex );
+	world->bodyRefEpoch += 1;
+
 	int sourceIndex = body->localIndex;
 	b2BodySim* sourceSim = b2Array_Get( sourceSet->bodySims, sourceIndex );
 
@@ -528,11 +887,12 @@ void b2TransferBody( b2World* world, b2SolverSet* targetSet, b2SolverSet* source
 	// Remove body sim from solver set that owns it
 	b2RemoveBodySim( &sourceSet->bodySims, &world->bodies, sourceIndex );
 
-	if ( sourceSet->setIndex == b2_awakeSet )
+	if ( b2IsMovingSet( sourceSet->setIndex ) )
 	{
 		(void)b2Array_RemoveSwap( sourceSet->bodyStates, sourceIndex );
 	}
-	else if ( targetSet->setIndex == b2_awakeSet )
+
+	if ( targetSet->setIndex == b2_awakeSet )
 	{
 		b2BodyState* state = b2Array_Emplace( targetSet->bodyStates );
 		*state = b2_identityBodyState;
@@ -550,6 +910,10 @@ void b2TransferJoint( b2World* world, b2SolverSet* targetSet, b2SolverSet* sourc
 		return;
 	}
 
+	b2MarkDirty( world, b2_dirtyJoint, joint->jointId );
+	b2MarkDirty( world, b2_dirtySolverSet, sourceSet->setIndex );
+	b2MarkDirty( world, b2_dirtySolverSet, targetSet->setIndex );
+
 	int localIndex = joint->localIndex;
 	int colorIndex = joint->colorIndex;
 
@@ -602,3 +966,145 @@ void b2TransferJoint( b2World* world, b2SolverSet* targetSet, b2SolverSet* sourc
 		}
 	}
 }
+
+// Contact bodies further apart than this in the awake body arrays are unlikely to share cache lines
+#define B2_BODY_ORDER_WINDOW 64
+
+typedef struct b2BodyOrderKey
+{
+	uint32_t key;
+	int index;
+} b2BodyOrderKey;
+
+static int b2CompareBodyOrderKeys( const void* a, const void* b )
+{
+	const b2BodyOrderKey* keyA = a;
+	const b2BodyOrderKey* keyB = b;
+	if ( keyA->key != keyB->key )
+	{
+		return keyA->key < keyB->key ? -1 : 1;
+	}
+
+	return keyA->index - keyB->index;
+}
+
+// Fraction of the touching contacts between two awake bodies that are far apart in the awake body arrays
+static float b2GetBodyOrderFragmentation( b2World* world )
+{
+	int contactCount = 0;
+	int farCount = 0;
+	for ( int i = 0; i < B2_GRAPH_COLOR_COUNT; ++i )
+	{
+		b2GraphColor* color = world->constraintGraph.colors + i;
+		for ( int j = 0; j < color->contactSims.count; ++j )
+		{
+			const b2ContactSim* contactSim = color->contactSims.data + j;
+			int indexA = contactSim->bodySimIndexA;
+			int indexB = contactSim->bodySimIndexB;
+			if ( indexA == B2_NULL_INDEX || indexB == B2_NULL_INDEX )
+			{
+				continue;
+			}
+
+			contactCount += 1;
+			farCount += b2AbsInt( indexA - indexB ) > B2_BODY_ORDER_WINDOW ? 1 : 0;
+		}
+	}
+
+	return contactCount > 0 ? (float)farCount / (float)contactCount : 0.0f;
+}
+
+static void b2UpdateContactBodyIndices( b2World* world, b2ContactSim* contactSims, int count )
+{
+	b2Body* bodies = world->bodies.data;
+	for ( int i = 0; i < count; ++i )
+	{
+		b2ContactSim* contactSim = contactSims + i;
+		b2Contact* contact = b2Array_Get( world->contacts, contactSim->contactId );
+		b2Body* bodyA = bodies + contact->edges[0].bodyId;
+		b2Body* bodyB = bodies + contact->edges[1].bodyId;
+		contactSim->bodySimIndexA = bodyA->setIndex == b2_awakeSet ? bodyA->localIndex : B2_NULL_INDEX;
+		contactSim->bodySimIndexB = bodyB->setIndex == b2_awakeSet ? bodyB->localIndex : B2_NULL_INDEX;
+	}
+}
+
+// Bodies are appended to the awake set as they are created and woken, so a pile built or woken over
+// time has the bodies of a contact scattered through the awake arrays. Sorting by the Morton code of
+// the body centers puts neighbors close together. Joints find their bodies in prepare, so only the
+// contact body indices need updating.
+void b2ReorderAwakeBodies( b2World* world )
+{
+	b2SolverSet* awakeSet = b2Array_Get( world->solverSets, b2_awakeSet );
+	int bodyCount = awakeSet->bodySims.count;
+
+	// Small sets stay in cache anyway
+	if ( bodyCount <= 2 * B2_BODY_ORDER_WINDOW )
+	{
+		return;
+	}
+
+	if ( b2GetBodyOrderFragmentation( world ) <= world->bodyOrderThreshold )
+	{
+		return;
+	}
+
+	b2TracyCZoneNC( reorder_bodies, "Reorder Bodies", b2_colorDarkOrange, true );
+
+	b2BodySim* sims = awakeSet->bodySims.data;
+	b2BodyState* states = awakeSet->bodyStates.data;
+
+	b2AABB bounds = { sims[0].center, sims[0].center };
+	for ( int i = 1; i < bodyCount; ++i )
+	{
+		bounds.lowerBound = b2Min( bounds.lowerBound, sims[i].center );
+		bounds.upperBound = b2Max( bounds.upperBound, sims[i].center );
+	}
+
+	b2Vec2 extent = b2Sub( bounds.upperBound, bounds.lowerBound );
+	float scaleX = extent.x > 0.0f ? 65535.0f / extent.x : 0.0f;
+	float scaleY = extent.y > 0.0f ? 65535.0f / extent.y : 0.0f;
+
+	b2BodyOrderKey* keys = b2StackAlloc( &world->stack, bodyCount * sizeof( b2BodyOrderKey ), "body order keys" );
+	for ( int i = 0; i < bodyCount; ++i )
+	{
+		b2Vec2 p = b2Sub( sims[i].center, bounds.lowerBound );
+		uint32_t x = (uint32_t)( scaleX * p.x );
+		uint32_t y = (uint32_t)( scaleY * p.y );
+		keys[i] = (b2BodyOrderKey){ b2SpreadBits( x ) | ( b2SpreadBits( y ) << 1 ), i };
+	}
+
+	qsort( keys, bodyCount, sizeof( b2BodyOrderKey ), b2CompareBodyOrderKeys );
+
+	b2BodySim* oldSims = b2StackAlloc( &world->stack, bodyCount * sizeof( b2BodySim ), "old body sims" );
+	b2BodyState* oldStates = b2StackAlloc( &world->stack, bodyCount * sizeof( b2BodyState ), "old body states" );
+	memcpy( oldSims, sims, bodyCount * sizeof( b2BodySim ) );
+	memcpy( oldStates, states, bodyCount * sizeof( b2BodyState ) );
+
+	b2Body* bodies = world->bodies.data;
+	for ( int i = 0; i < bodyCount; ++i )
+	{
+		int oldIndex = keys[i].index;
+		sims[i] = oldSims[oldIndex];
+		states[i] = oldStates[oldIndex];
+
+		b2Body* body = bodies + sims[i].bodyId;
+		B2_ASSERT( body->setIndex == b2_awakeSet && body->localIndex == oldIndex );
+		body->localIndex = i;
+	}
+
+	b2StackFree( &world->stack, oldStates );
+	b2StackFree( &world->stack, oldSims );
+	b2StackFree( &world->stack, keys );
+
+	for ( int i = 0; i < B2_GRAPH_COLOR_COUNT; ++i )
+	{
+		b2GraphColor* color = world->constraintGraph.colors + i;
+		b2UpdateContactBodyIndices( world, color->contactSims.data, color->contactSims.count );
+	}
+
+	b2UpdateContactBodyIndices( world, awakeSet->contactSims.data, awakeSet->contactSims.count );
+
+	world->reorderedBodyCount = bodyCount;
+
+	b2TracyCZoneEnd( reorder_bodies );
+}
@@ -23,16 +23,28 @@ enum b2SolverSetType
 	// and awake joints live in the constraint graph
 	b2_awakeSet = 2,
 
+	// Kinematic set for awake kinematic bodies that have no joints and touch nothing. These bodies have
+	// body states and are moved in bulk outside of the constraint solver. They return to the awake set
+	// when they start touching a body, get a joint, or fall asleep.
+	b2_kinematicSet = 3,
+
 	// The index of the first sleeping set. Each island that goes to sleep is put into
 	// a sleeping set. This holds all bodies, contacts, and joints from the sleeping island.
 	// A separate set for each sleeping island makes it very efficient to wake a single island.
-	b2_firstSleepingSet = 3,
+	b2_firstSleepingSet = 4,
 };
 
+// Bodies in the awake and kinematic sets have body states and move every step
+static inline bool b2IsMovingSet( int setIndex )
+{
+	return setIndex == b2_awakeSet || setIndex == b2_kinematicSet;
+}
+
 // This holds solver set data. The following sets are used:
 // - static set for all static bodies and joints between static bodies
 // - active set for all active bodies with body states (no contacts or joints)
 // - disabled set for disabled bodies and their joints
+// - kinematic set for awake kinematic bodies outside of the constraint graph
 // - all further sets are sleeping island sets along with their contacts and joints
 // The purpose of solver sets is to achieve high memory locality.
 // https://www.youtube.com/watch?v=nZNd5FjSquk
@@ -41,7 +53,7 @@ typedef struct b2SolverSet
 	// Body array. Empty for unused set.
 	b2Array( b2BodySim ) bodySims;
 
-	// Body state only exists for active set
+	// Body state only exists for the active and kinematic sets
 	b2Array( b2BodyState ) bodyStates;
 
 	// This holds sleeping/disabled joints. Empty for static/active set.
@@ -51,6 +63,9 @@ typedef struct b2SolverSet
 	// This holds non-touching contacts for the awake set.
 	b2Array( b2ContactSim ) contactSims;
 
+	// Replaces contactSims for sleeping sets when the world uses compact contacts
+	b2Array( b2CompactContactSim ) compactContactSims;
+
 	// The awake set has an array of islands. Sleeping sets normally have a single islands. However, joints
 	// created between sleeping sets causes the sets to merge, leaving them with multiple islands. These sleeping
 	// islands will be naturally merged with the set is woken.
@@ -60,13 +75,76 @@ typedef struct b2SolverSet
 
 	// Aligns with b2World::solverSetIdPool. Used to create a stable id for body/contact/joint/islands.
 	int setIndex;
+
+	// Simulation interval of a parked set, zero for other sets. A parked set holds an awake island
+	// between its update steps, see b2BodyDef::simulationInterval.
+	int simulationInterval;
+
+	// The step that last simulated the parked island, or the step that put a sleeping island to sleep
+	uint64_t parkStepIndex;
+
+	// Bounds of a frozen set, see b2World_SetActiveRegions. Frozen sets are sleeping sets that keep their
+	// velocities and are woken by the active regions.
+	b2AABB frozenBounds;
+	bool isFrozen;
+
+	// Contacts are stored in compactContactSims, see b2WorldDef::enableCompactContacts
+	bool isCompact;
 } b2SolverSet;
 
+// A body woken from a parked set that catches up on the skipped steps in the next step. The island
+// is simulated with time scaled by timeScale, so velocities, gravity, and damping are scaled for the
+// duration of the step. The original values are restored afterwards.
+typedef struct b2LodBody
+{
+	int bodyId;
+	uint16_t generation;
+	float timeScale;
+	float gravityScale;
+	float linearDamping;
+	float angularDamping;
+	float sleepThreshold;
+} b2LodBody;
+
+b2DeclareArray( b2LodBody );
+
 void b2DestroySolverSet( b2World* world, int setIndex );
 
+// Parked sets hold islands with a simulation interval between their update steps
+bool b2IsParkedSet( const b2World* world, int setIndex );
+void b2ParkIsland( b2World* world, int islandId, int simulationInterval );
+void b2WakeParkedSets( b2World* world );
+
+// Frozen sets hold islands outside of the active regions
+void b2FreezeIsland( b2World* world, int islandId, b2AABB bounds );
+void b2ThawFrozenSets( b2World* world );
+
+// Steps between checks for sleeping sets to compact, see b2WorldDef::compactSleepSteps
+#define B2_COMPACT_SET_INTERVAL 16
+
+// Stores the contacts of a sleeping set in compact form and releases the unused capacity of the set
+void b2CompactSolverSet( b2World* world, int setIndex );
+
+// Compacts the sets that have been asleep for b2WorldDef::compactSleepSteps
+void b2CompactSleepingSets( b2World* world );
+
+// Parked and frozen sets keep the velocities of their bodies
+bool b2KeepsVelocity( const b2World* world, int setIndex );
+
 void b2WakeSolverSet( b2World* world, int setIndex );
+
+// Move a kinematic body that is alone in its island between the awake set and the kinematic set.
+// The body keeps its state and its island. Attaching does nothing for bodies outside the kinematic set.
+void b2DetachKinematicBody( b2World* world, b2Body* body );
+void b2AttachKinematicBody( b2World* world, b2Body* body );
 void b2TrySleepIsland( b2World* world, int islandId );
 
+// Steps between checks of the awake body order, see b2WorldDef::bodyOrderThreshold
+#define B2_BODY_ORDER_INTERVAL 32
+
+// Sorts the awake bodies along a Morton curve if the contacts are fragmented
+void b2ReorderAwakeBodies( b2World* world );
+
 // Merge set 2 into set 1 then destroy set 2.
 // Warning: any pointers into these sets will be orphaned.
 void b2MergeSolverSets( b2World* world, int setIndex1, int setIndex2 );
@@ -4,13 +4,20 @@
 #include "table.h"
 
 #include "atomic.h"
-#include "bitset.h"
 #include "core.h"
 #include "ctz.h"
 
 #include <stdbool.h>
 #include <string.h>
 
+#if defined( B2_SIMD_AVX512 ) || defined( B2_SIMD_AVX2 ) || defined( B2_SIMD_SSE2 )
+#include <emmintrin.h>
+#elif defined( B2_SIMD_NEON )
+#include <arm_neon.h>
+#elif defined( B2_SIMD_WASM )
+#include <wasm_simd128.h>
+#endif
+
 #if B2_SNOOP_TABLE_COUNTERS
 b2AtomicInt b2_findCount;
 b2AtomicInt b2_probeCount;
@@ -118,7 +125,7 @@ static void b2AddKeyHaveCapacity( b2HashSet* set, uint64_t key, uint64_t hash )
 	set->count += 1;
 }
 
-static void b2GrowTable( b2HashSet* set )
+static void b2ResizeTable( b2HashSet* set, uint32_t newCapacity )
 {
 	uint32_t oldCount = set->count;
 	B2_UNUSED( oldCount );
@@ -126,9 +133,12 @@ static void b2GrowTable( b2HashSet* set )
 	uint32_t oldCapacity = set->capacity;
 	b2SetItem* oldItems = set->items;
 
+	// Capacity must be a power of 2 and keep the load factor below one half
+	B2_ASSERT( ( newCapacity & ( newCapacity - 1 ) ) == 0 );
+	B2_ASSERT( 2 * oldCount < newCapacity );
+
 	set->count = 0;
-	// Capacity must be a power of 2
-	set->capacity = 2 * oldCapacity;
+	set->capacity = newCapacity;
 	set->items = b2Alloc( set->capacity * sizeof( b2SetItem ) );
 	memset( set->items, 0, set->capacity * sizeof( b2SetItem ) );
 
@@ -151,6 +161,26 @@ static void b2GrowTable( b2HashSet* set )
 	b2Free( oldItems, oldCapacity * sizeof( b2SetItem ) );
 }
 
+static void b2GrowTable( b2HashSet* set )
+{
+	b2ResizeTable( set, 2 * set->capacity );
+}
+
+void b2ShrinkSet( b2HashSet* set )
+{
+	// Smallest power of 2 that keeps the load factor below one half
+	uint32_t newCapacity = 16;
+	while ( newCapacity <= 2 * set->count )
+	{
+		newCapacity *= 2;
+	}
+
+	if ( newCapacity < set->capacity )
+	{
+		b2ResizeTable( set, newCapacity );
+	}
+}
+
 bool b2ContainsKey( const b2HashSet* set, uint64_t key )
 {
 	// key of zero is a sentinel
@@ -190,6 +220,54 @@ bool b2AddKey( b2HashSet* set, uint64_t key )
 	return false;
 }
 
+void b2ReserveSet( b2HashSet* set, int keyCount )
+{
+	uint32_t newCapacity = set->capacity;
+	while ( newCapacity <= 2 * ( set->count + (uint32_t)keyCount ) )
+	{
+		newCapacity *= 2;
+	}
+
+	if ( newCapacity > set->capacity )
+	{
+		b2ResizeTable( set, newCapacity );
+	}
+}
+
+bool b2AddKeyConcurrent( b2HashSet* set, uint64_t key )
+{
+	// key of zero is a sentinel
+	B2_ASSERT( key != 0 );
+
+	uint64_t hash = b2KeyHash( key );
+	uint32_t capacity = set->capacity;
+	uint32_t index = (uint32_t)hash & ( capacity - 1 );
+	b2SetItem* items = set->items;
+
+	// Same linear probe as b2FindSlot. A slot only goes from empty to a key, so a lost race
+	// still lets this thread compare against the winning key.
+	for ( ;; )
+	{
+		uint64_t slotKey = b2AtomicLoadU64( &items[index].key );
+		if ( slotKey == 0 )
+		{
+			if ( b2AtomicCompareExchangeU64( &items[index].key, 0, key ) )
+			{
+				return false;
+			}
+
+			slotKey = b2AtomicLoadU64( &items[index].key );
+		}
+
+		if ( slotKey == key )
+		{
+			return true;
+		}
+
+		index = ( index + 1 ) & ( capacity - 1 );
+	}
+}
+
 // See https://en.wikipedia.org/wiki/Open_addressing
 bool b2RemoveKey( b2HashSet* set, uint64_t key )
 {
@@ -253,16 +331,291 @@ bool b2RemoveKey( b2HashSet* set, uint64_t key )
 	return true;
 }
 
-// This function is here because ctz.h is included by
-// this file but not in bitset.c
-int b2CountSetBits( b2BitSet* bitSet )
+#define B2_GROUP_SIZE 16
+#define B2_CONTROL_EMPTY 0x80
+#define B2_CONTROL_DELETED 0xFE
+
+// Bit mask of the slots in a group that match a control byte test. Iterate using b2NextGroupSlot.
+typedef uint64_t b2GroupMask;
+
+#if defined( B2_SIMD_NEON )
+// NEON has no movemask so the mask has 4 bits per slot and only the lowest is kept
+#define B2_GROUP_MASK_SHIFT 2
+#define B2_GROUP_MASK_BITS 0x1111111111111111ull
+#else
+#define B2_GROUP_MASK_SHIFT 0
+#endif
+
+// Mask of slots with a control byte equal to value
+static inline b2GroupMask b2MatchGroup( const uint8_t* controls, uint8_t value )
+{
+#if defined( B2_SIMD_AVX512 ) || defined( B2_SIMD_AVX2 ) || defined( B2_SIMD_SSE2 )
+	__m128i group = _mm_loadu_si128( (const __m128i*)controls );
+	__m128i match = _mm_cmpeq_epi8( group, _mm_set1_epi8( (char)value ) );
+	return (uint32_t)_mm_movemask_epi8( match );
+#elif defined( B2_SIMD_NEON )
+	uint8x16_t match = vceqq_u8( vld1q_u8( controls ), vdupq_n_u8( value ) );
+	uint8x8_t nibbles = vshrn_n_u16( vreinterpretq_u16_u8( match ), 4 );
+	return vget_lane_u64( vreinterpret_u64_u8( nibbles ), 0 ) & B2_GROUP_MASK_BITS;
+#elif defined( B2_SIMD_WASM )
+	v128_t match = wasm_i8x16_eq( wasm_v128_load( controls ), wasm_i8x16_splat( (int8_t)value ) );
+	return (uint32_t)wasm_i8x16_bitmask( match );
+#else
+	b2GroupMask mask = 0;
+	for ( int i = 0; i < B2_GROUP_SIZE; ++i )
+	{
+		mask |= (b2GroupMask)( controls[i] == value ) << i;
+	}
+	return mask;
+#endif
+}
+
+// Mask of slots that are empty or deleted. These are the control bytes with the high bit set.
+static inline b2GroupMask b2MatchGroupAvailable( const uint8_t* controls )
+{
+#if defined( B2_SIMD_AVX512 ) || defined( B2_SIMD_AVX2 ) || defined( B2_SIMD_SSE2 )
+	__m128i group = _mm_loadu_si128( (const __m128i*)controls );
+	return (uint32_t)_mm_movemask_epi8( group );
+#elif defined( B2_SIMD_NEON )
+	uint8x16_t match = vreinterpretq_u8_s8( vshrq_n_s8( vreinterpretq_s8_u8( vld1q_u8( controls ) ), 7 ) );
+	uint8x8_t nibbles = vshrn_n_u16( vreinterpretq_u16_u8( match ), 4 );
+	return vget_lane_u64( vreinterpret_u64_u8( nibbles ), 0 ) & B2_GROUP_MASK_BITS;
+#elif defined( B2_SIMD_WASM )
+	return (uint32_t)wasm_i8x16_bitmask( wasm_v128_load( controls ) );
+#else
+	b2GroupMask mask = 0;
+	for ( int i = 0; i < B2_GROUP_SIZE; ++i )
+	{
+		mask |= (b2GroupMask)( controls[i] >> 7 ) << i;
+	}
+	return mask;
+#endif
+}
+
+static inline int b2NextGroupSlot( b2GroupMask* mask )
+{
+	int slot = (int)( b2CTZ64( *mask ) >> B2_GROUP_MASK_SHIFT );
+	*mask &= *mask - 1;
+	return slot;
+}
+
+static uint32_t b2KeyHash32( uint32_t key )
 {
-	int popCount = 0;
-	uint32_t blockCount = bitSet->blockCount;
-	for ( uint32_t i = 0; i < blockCount; ++i )
+	// Murmur3 finalizer
+	uint32_t h = key;
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+// The low 7 bits of the hash go in the control byte and the rest select the first group
+#define B2_HASH_CONTROL( H ) ( (uint8_t)( ( H ) & 0x7F ) )
+#define B2_HASH_GROUP( H ) ( ( H ) >> 7 )
+
+// The table is kept at most 7/8 full, counting deleted slots, so every probe finds an empty slot
+static uint32_t b2GetSet32SlotCapacity( uint32_t keyCapacity )
+{
+	uint32_t capacity = B2_GROUP_SIZE;
+	while ( 7 * ( capacity / 8 ) < keyCapacity )
 	{
-		popCount += b2PopCount64( bitSet->bits[i] );
+		capacity *= 2;
 	}
+	return capacity;
+}
+
+static void b2AllocateSet32( b2HashSet32* set, uint32_t capacity )
+{
+	B2_ASSERT( capacity >= B2_GROUP_SIZE && ( capacity & ( capacity - 1 ) ) == 0 );
+
+	// Single allocation with the control bytes first so the groups stay aligned
+	set->capacity = capacity;
+	set->count = 0;
+	set->deletedCount = 0;
+	set->controls = b2Alloc( capacity * ( sizeof( uint8_t ) + sizeof( uint32_t ) ) );
+	set->keys = (uint32_t*)( set->controls + capacity );
+	memset( set->controls, B2_CONTROL_EMPTY, capacity );
+}
+
+b2HashSet32 b2CreateSet32( int capacity )
+{
+	b2HashSet32 set = { 0 };
+	b2AllocateSet32( &set, b2GetSet32SlotCapacity( capacity > 0 ? (uint32_t)capacity : 0 ) );
+	return set;
+}
 
-	return popCount;
+void b2DestroySet32( b2HashSet32* set )
+{
+	b2Free( set->controls, set->capacity * ( sizeof( uint8_t ) + sizeof( uint32_t ) ) );
+	*set = ( b2HashSet32 ){ 0 };
+}
+
+void b2ClearSet32( b2HashSet32* set )
+{
+	set->count = 0;
+	set->deletedCount = 0;
+	memset( set->controls, B2_CONTROL_EMPTY, set->capacity );
+}
+
+// Groups are probed using triangular numbers, which visits every group for a power of 2 group count.
+// Returns the slot holding the key or B2_NULL_INDEX.
+static int b2FindSlot32( const b2HashSet32* set, uint32_t key, uint32_t hash )
+{
+#if B2_SNOOP_TABLE_COUNTERS
+	b2AtomicFetchAddInt( &b2_findCount, 1 );
+#endif
+
+	uint32_t groupMask = set->capacity / B2_GROUP_SIZE - 1;
+	uint32_t groupIndex = B2_HASH_GROUP( hash ) & groupMask;
+	uint8_t control = B2_HASH_CONTROL( hash );
+
+	for ( uint32_t step = 1;; ++step )
+	{
+		uint32_t base = groupIndex * B2_GROUP_SIZE;
+		const uint8_t* controls = set->controls + base;
+
+		b2GroupMask mask = b2MatchGroup( controls, control );
+		while ( mask != 0 )
+		{
+			int slot = base + b2NextGroupSlot( &mask );
+			if ( set->keys[slot] == key )
+			{
+				return slot;
+			}
+		}
+
+		if ( b2MatchGroup( controls, B2_CONTROL_EMPTY ) != 0 )
+		{
+			return B2_NULL_INDEX;
+		}
+
+#if B2_SNOOP_TABLE_COUNTERS
+		b2AtomicFetchAddInt( &b2_probeCount, 1 );
+#endif
+		groupIndex = ( groupIndex + step ) & groupMask;
+	}
+}
+
+// Find the first empty or deleted slot along the probe sequence
+static int b2FindAvailableSlot32( const b2HashSet32* set, uint32_t hash )
+{
+	uint32_t groupMask = set->capacity / B2_GROUP_SIZE - 1;
+	uint32_t groupIndex = B2_HASH_GROUP( hash ) & groupMask;
+
+	for ( uint32_t step = 1;; ++step )
+	{
+		uint32_t base = groupIndex * B2_GROUP_SIZE;
+		b2GroupMask mask = b2MatchGroupAvailable( set->controls + base );
+		if ( mask != 0 )
+		{
+			return base + b2NextGroupSlot( &mask );
+		}
+
+		groupIndex = ( groupIndex + step ) & groupMask;
+	}
+}
+
+static void b2ResizeSet32( b2HashSet32* set, uint32_t newCapacity )
+{
+	b2HashSet32 oldSet = *set;
+	B2_ASSERT( oldSet.count <= 7 * ( newCapacity / 8 ) );
+
+	b2AllocateSet32( set, newCapacity );
+
+	for ( uint32_t i = 0; i < oldSet.capacity; ++i )
+	{
+		if ( oldSet.controls[i] & B2_CONTROL_EMPTY )
+		{
+			// empty or deleted
+			continue;
+		}
+
+		uint32_t key = oldSet.keys[i];
+		uint32_t hash = b2KeyHash32( key );
+		int slot = b2FindAvailableSlot32( set, hash );
+		set->controls[slot] = B2_HASH_CONTROL( hash );
+		set->keys[slot] = key;
+		set->count += 1;
+	}
+
+	B2_ASSERT( set->count == oldSet.count );
+
+	b2DestroySet32( &oldSet );
+}
+
+void b2ShrinkSet32( b2HashSet32* set )
+{
+	uint32_t newCapacity = b2GetSet32SlotCapacity( set->count );
+	if ( newCapacity < set->capacity )
+	{
+		b2ResizeSet32( set, newCapacity );
+	}
+}
+
+bool b2ContainsKey32( const b2HashSet32* set, uint32_t key )
+{
+	uint32_t hash = b2KeyHash32( key );
+	return b2FindSlot32( set, key, hash ) != B2_NULL_INDEX;
+}
+
+int b2GetHashSet32Bytes( b2HashSet32* set )
+{
+	return set->capacity * (int)( sizeof( uint8_t ) + sizeof( uint32_t ) );
+}
+
+bool b2AddKey32( b2HashSet32* set, uint32_t key )
+{
+	uint32_t hash = b2KeyHash32( key );
+	if ( b2FindSlot32( set, key, hash ) != B2_NULL_INDEX )
+	{
+		// Already in set
+		return true;
+	}
+
+	if ( set->count + set->deletedCount + 1 > 7 * ( set->capacity / 8 ) )
+	{
+		// Grow unless most of the used slots are deleted, in which case rehashing in place is enough
+		uint32_t newCapacity = set->count + 1 > 7 * ( set->capacity / 16 ) ? 2 * set->capacity : set->capacity;
+		b2ResizeSet32( set, newCapacity );
+	}
+
+	int slot = b2FindAvailableSlot32( set, hash );
+	if ( set->controls[slot] == B2_CONTROL_DELETED )
+	{
+		set->deletedCount -= 1;
+	}
+
+	set->controls[slot] = B2_HASH_CONTROL( hash );
+	set->keys[slot] = key;
+	set->count += 1;
+	return false;
+}
+
+bool b2RemoveKey32( b2HashSet32* set, uint32_t key )
+{
+	uint32_t hash = b2KeyHash32( key );
+	int slot = b2FindSlot32( set, key, hash );
+	if ( slot == B2_NULL_INDEX )
+	{
+		return false;
+	}
+
+	// A probe never continues past a group that has an empty slot, so if this group already has one
+	// the slot can be marked empty. Otherwise a later key may have probed through this group.
+	const uint8_t* controls = set->controls + ( slot & ~( B2_GROUP_SIZE - 1 ) );
+	if ( b2MatchGroup( controls, B2_CONTROL_EMPTY ) != 0 )
+	{
+		set->controls[slot] = B2_CONTROL_EMPTY;
+	}
+	else
+	{
+		set->controls[slot] = B2_CONTROL_DELETED;
+		set->deletedCount += 1;
+	}
+
+	B2_ASSERT( set->count > 0 );
+	set->count -= 1;
+	return true;
 }
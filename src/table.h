@@ -32,9 +32,21 @@ void b2DestroySet( b2HashSet* set );
 
 void b2ClearSet( b2HashSet* set );
 
+// Rehash into the smallest table that holds the current keys
+void b2ShrinkSet( b2HashSet* set );
+
 // Returns true if key was already in set
 bool b2AddKey( b2HashSet* set, uint64_t key );
 
+// Grow the table so that keyCount more keys can be added without growing
+void b2ReserveSet( b2HashSet* set, int keyCount );
+
+// Add a key while other threads add keys to the same set. The table must have room reserved
+// using b2ReserveSet and no other operation may run concurrently. The count is not updated,
+// the caller adds the number of new keys once all threads are done.
+// Returns true if key was already in set
+bool b2AddKeyConcurrent( b2HashSet* set, uint64_t key );
+
 // Returns true if the key was found
 bool b2RemoveKey( b2HashSet* set, uint64_t key );
 
@@ -51,3 +63,40 @@ static inline int b2GetSetCapacity( b2HashSet* set )
 {
 	return set->capacity;
 }
+
+// A set of 32-bit keys using Swiss table style open addressing. Slots are organized in groups of
+// 16 and each slot has a control byte holding 7 bits of the key hash. This lets a single SIMD
+// compare test a whole group, so most lookups touch one control line and one key line.
+// All key values are allowed.
+typedef struct b2HashSet32
+{
+	uint8_t* controls;
+	uint32_t* keys;
+	uint32_t capacity;
+	uint32_t count;
+	uint32_t deletedCount;
+} b2HashSet32;
+
+// The capacity is the number of keys the set can hold before growing
+b2HashSet32 b2CreateSet32( int capacity );
+void b2DestroySet32( b2HashSet32* set );
+
+void b2ClearSet32( b2HashSet32* set );
+
+// Rehash into the smallest table that holds the current keys
+void b2ShrinkSet32( b2HashSet32* set );
+
+// Returns true if key was already in set
+bool b2AddKey32( b2HashSet32* set, uint32_t key );
+
+// Returns true if the key was found
+bool b2RemoveKey32( b2HashSet32* set, uint32_t key );
+
+bool b2ContainsKey32( const b2HashSet32* set, uint32_t key );
+
+int b2GetHashSet32Bytes( b2HashSet32* set );
+
+static inline int b2GetSet32Count( b2HashSet32* set )
+{
+	return set->count;
+}
@@ -11,8 +11,10 @@
 
 #include "box2d/base.h"
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #if defined( _WIN32 )
 
@@ -50,6 +52,23 @@ float b2GetMilliseconds( uint64_t ticks )
 	return (float)( s_invFrequency * ( ticksNow - ticks ) );
 }
 
+double b2GetMillisecondsPerTick( void )
+{
+	if ( s_invFrequency == 0.0 )
+	{
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency( &frequency );
+
+		s_invFrequency = (double)frequency.QuadPart;
+		if ( s_invFrequency > 0.0 )
+		{
+			s_invFrequency = 1000.0 / s_invFrequency;
+		}
+	}
+
+	return s_invFrequency;
+}
+
 float b2GetMillisecondsAndReset( uint64_t* ticks )
 {
 	if ( s_invFrequency == 0.0 )
@@ -75,6 +94,16 @@ void b2Yield( void )
 	SwitchToThread();
 }
 
+void b2WaitAddress( void* address, uint32_t expected )
+{
+	WaitOnAddress( address, &expected, sizeof( uint32_t ), INFINITE );
+}
+
+void b2WakeAddress( void* address )
+{
+	WakeByAddressAll( address );
+}
+
 typedef struct b2Mutex
 {
 	CRITICAL_SECTION cs;
@@ -232,6 +261,83 @@ void b2JoinThread( b2Thread* t )
 	b2Free( t, sizeof( b2Thread ) );
 }
 
+uint64_t b2GetCacheDomainAffinityMask( void )
+{
+	PROCESSOR_NUMBER current;
+	GetCurrentProcessorNumberEx( &current );
+
+	DWORD_PTR processMask = 0, systemMask = 0;
+	if ( GetProcessAffinityMask( GetCurrentProcess(), &processMask, &systemMask ) == FALSE )
+	{
+		return 0;
+	}
+
+	DWORD length = 0;
+	GetLogicalProcessorInformationEx( RelationAll, NULL, &length );
+	if ( GetLastError() != ERROR_INSUFFICIENT_BUFFER || length == 0 )
+	{
+		return 0;
+	}
+
+	char* buffer = b2Alloc( (int)length );
+	if ( GetLogicalProcessorInformationEx( RelationAll, (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)buffer, &length ) == FALSE )
+	{
+		b2Free( buffer, (int)length );
+		return 0;
+	}
+
+	// Find the L3 cache shared with the current processor
+	KAFFINITY currentBit = (KAFFINITY)1 << current.Number;
+	KAFFINITY domainMask = 0;
+	for ( DWORD offset = 0; offset < length; )
+	{
+		PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX info = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)( buffer + offset );
+		if ( info->Relationship == RelationCache && info->Cache.Level == 3 && info->Cache.GroupMask.Group == current.Group &&
+			 ( info->Cache.GroupMask.Mask & currentBit ) != 0 )
+		{
+			domainMask = info->Cache.GroupMask.Mask;
+		}
+		offset += info->Size;
+	}
+
+	// Take the first logical processor of each core in the domain. Only keep the cores with the
+	// highest efficiency class, which are the performance cores on hybrid processors.
+	KAFFINITY mask = 0;
+	BYTE bestEfficiency = 0;
+	for ( DWORD offset = 0; offset < length && domainMask != 0; )
+	{
+		PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX info = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)( buffer + offset );
+		if ( info->Relationship == RelationProcessorCore && info->Processor.GroupMask[0].Group == current.Group )
+		{
+			KAFFINITY core = info->Processor.GroupMask[0].Mask & domainMask & (KAFFINITY)processMask;
+			BYTE efficiency = info->Processor.EfficiencyClass;
+			if ( core != 0 && efficiency >= bestEfficiency )
+			{
+				if ( efficiency > bestEfficiency )
+				{
+					bestEfficiency = efficiency;
+					mask = 0;
+				}
+
+				mask |= core & ( ~core + 1 );
+			}
+		}
+		offset += info->Size;
+	}
+
+	b2Free( buffer, (int)length );
+	return (uint64_t)mask;
+}
+
+void b2SetCurrentThreadAffinity( int processorIndex )
+{
+	// Windows affinity masks are limited to the processor group of the thread
+	if ( 0 <= processorIndex && processorIndex < (int)( 8 * sizeof( DWORD_PTR ) ) )
+	{
+		SetThreadAffinityMask( GetCurrentThread(), (DWORD_PTR)1 << processorIndex );
+	}
+}
+
 #elif defined( __linux__ ) || defined( __EMSCRIPTEN__ )
 
 #include <sched.h>
@@ -250,6 +356,11 @@ float b2GetMilliseconds( uint64_t ticks )
 	return (float)( ( ticksNow - ticks ) / 1000000.0 );
 }
 
+double b2GetMillisecondsPerTick( void )
+{
+	return 1.0 / 1000000.0;
+}
+
 float b2GetMillisecondsAndReset( uint64_t* ticks )
 {
 	uint64_t ticksNow = b2GetTicks();
@@ -263,6 +374,57 @@ void b2Yield( void )
 	sched_yield();
 }
 
+#if defined( __linux__ )
+
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+void b2WaitAddress( void* address, uint32_t expected )
+{
+	syscall( SYS_futex, address, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0 );
+}
+
+void b2WakeAddress( void* address )
+{
+	syscall( SYS_futex, address, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0 );
+}
+
+#elif defined( __EMSCRIPTEN_PTHREADS__ )
+
+#include <emscripten/threading.h>
+#include <limits.h>
+#include <math.h>
+
+// Atomics.wait on the shared memory. The browser main thread may not block, so Emscripten spins there.
+void b2WaitAddress( void* address, uint32_t expected )
+{
+	emscripten_futex_wait( address, expected, INFINITY );
+}
+
+void b2WakeAddress( void* address )
+{
+	emscripten_futex_wake( address, INT_MAX );
+}
+
+#else
+
+// No address wait, so parked threads poll
+void b2WaitAddress( void* address, uint32_t expected )
+{
+	( (void)( address ) );
+	( (void)( expected ) );
+	sched_yield();
+}
+
+void b2WakeAddress( void* address )
+{
+	( (void)( address ) );
+}
+
+#endif
+
 #include <pthread.h>
 typedef struct b2Mutex
 {
@@ -382,10 +544,172 @@ void b2JoinThread( b2Thread* t )
 	b2Free( t, sizeof( b2Thread ) );
 }
 
+#if defined( __linux__ )
+
+// Parses a sysfs cpu list such as "0-7,16-23". Only the first 64 processors are kept.
+static bool b2ReadCpuList( const char* path, uint64_t* mask )
+{
+	FILE* file = fopen( path, "r" );
+	if ( file == NULL )
+	{
+		return false;
+	}
+
+	char buffer[256];
+	bool success = fgets( buffer, sizeof( buffer ), file ) != NULL;
+	fclose( file );
+	if ( success == false )
+	{
+		return false;
+	}
+
+	uint64_t result = 0;
+	const char* c = buffer;
+	while ( *c != 0 )
+	{
+		char* end;
+		long first = strtol( c, &end, 10 );
+		if ( end == c )
+		{
+			break;
+		}
+
+		long last = first;
+		c = end;
+		if ( *c == '-' )
+		{
+			last = strtol( c + 1, &end, 10 );
+			c = end;
+		}
+
+		for ( long i = first; i <= last && i < 64; ++i )
+		{
+			result |= (uint64_t)1 << i;
+		}
+
+		if ( *c != ',' )
+		{
+			break;
+		}
+		c += 1;
+	}
+
+	*mask = result;
+	return result != 0;
+}
+
+uint64_t b2GetCacheDomainAffinityMask( void )
+{
+	int cpu = sched_getcpu();
+	if ( cpu < 0 || cpu >= 64 )
+	{
+		return 0;
+	}
+
+	// The cache index is not the cache level, so search for the L3
+	char path[128];
+	uint64_t domainMask = 0;
+	for ( int index = 0; index < 8; ++index )
+	{
+		snprintf( path, sizeof( path ), "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu, index );
+		FILE* file = fopen( path, "r" );
+		if ( file == NULL )
+		{
+			break;
+		}
+
+		int level = 0;
+		int count = fscanf( file, "%d", &level );
+		fclose( file );
+
+		if ( count == 1 && level == 3 )
+		{
+			snprintf( path, sizeof( path ), "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list", cpu, index );
+			b2ReadCpuList( path, &domainMask );
+			break;
+		}
+	}
+
+	cpu_set_t allowed;
+	CPU_ZERO( &allowed );
+	if ( domainMask == 0 || sched_getaffinity( 0, sizeof( allowed ), &allowed ) != 0 )
+	{
+		return 0;
+	}
+
+	uint64_t allowedMask = 0;
+	for ( int i = 0; i < 64; ++i )
+	{
+		if ( CPU_ISSET( i, &allowed ) )
+		{
+			allowedMask |= (uint64_t)1 << i;
+		}
+	}
+
+	domainMask &= allowedMask;
+
+	// Drop efficiency cores on hybrid processors when there are performance cores left
+	uint64_t efficiencyMask = 0;
+	if ( b2ReadCpuList( "/sys/devices/cpu_atom/cpus", &efficiencyMask ) && ( domainMask & ~efficiencyMask ) != 0 )
+	{
+		domainMask &= ~efficiencyMask;
+	}
+
+	// Keep one logical processor per physical core
+	uint64_t mask = 0;
+	for ( int i = 0; i < 64; ++i )
+	{
+		uint64_t bit = (uint64_t)1 << i;
+		if ( ( domainMask & bit ) == 0 )
+		{
+			continue;
+		}
+
+		uint64_t siblings = 0;
+		snprintf( path, sizeof( path ), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", i );
+		if ( b2ReadCpuList( path, &siblings ) && ( siblings & domainMask & ( bit - 1 ) ) != 0 )
+		{
+			continue;
+		}
+
+		mask |= bit;
+	}
+
+	return mask;
+}
+
+void b2SetCurrentThreadAffinity( int processorIndex )
+{
+	if ( 0 <= processorIndex && processorIndex < CPU_SETSIZE )
+	{
+		cpu_set_t set;
+		CPU_ZERO( &set );
+		CPU_SET( processorIndex, &set );
+		pthread_setaffinity_np( pthread_self(), sizeof( set ), &set );
+	}
+}
+
+#else
+
+uint64_t b2GetCacheDomainAffinityMask( void )
+{
+	return 0;
+}
+
+void b2SetCurrentThreadAffinity( int processorIndex )
+{
+	(void)processorIndex;
+}
+
+#endif
+
 #elif defined( __APPLE__ )
 
+#include <mach/mach.h>
 #include <mach/mach_time.h>
+#include <mach/thread_policy.h>
 #include <sched.h>
+#include <sys/sysctl.h>
 #include <sys/time.h>
 
 static double s_invFrequency = 0.0;
@@ -410,6 +734,20 @@ float b2GetMilliseconds( uint64_t ticks )
 	return (float)( s_invFrequency * ( ticksNow - ticks ) );
 }
 
+double b2GetMillisecondsPerTick( void )
+{
+	if ( s_invFrequency == 0 )
+	{
+		mach_timebase_info_data_t timebase;
+		mach_timebase_info( &timebase );
+
+		// convert to ns then to ms
+		s_invFrequency = 1e-6 * (double)timebase.numer / (double)timebase.denom;
+	}
+
+	return s_invFrequency;
+}
+
 float b2GetMillisecondsAndReset( uint64_t* ticks )
 {
 	if ( s_invFrequency == 0 )
@@ -432,6 +770,19 @@ void b2Yield( void )
 	sched_yield();
 }
 
+// The address wait of macOS is not public API before macOS 14.4, so parked threads poll
+void b2WaitAddress( void* address, uint32_t expected )
+{
+	( (void)( address ) );
+	( (void)( expected ) );
+	sched_yield();
+}
+
+void b2WakeAddress( void* address )
+{
+	( (void)( address ) );
+}
+
 #include <pthread.h>
 typedef struct b2Mutex
 {
@@ -552,6 +903,42 @@ void b2JoinThread( b2Thread* t )
 	b2Free( t, sizeof( b2Thread ) );
 }
 
+// macOS has no hard affinity and does not expose processor indices. The performance core count is
+// used to size the mask and pinning becomes a scheduling hint.
+uint64_t b2GetCacheDomainAffinityMask( void )
+{
+	int count = 0;
+	size_t size = sizeof( count );
+	if ( sysctlbyname( "hw.perflevel0.physicalcpu", &count, &size, NULL, 0 ) != 0 )
+	{
+		size = sizeof( count );
+		if ( sysctlbyname( "hw.physicalcpu", &count, &size, NULL, 0 ) != 0 )
+		{
+			return 0;
+		}
+	}
+
+	if ( count <= 0 )
+	{
+		return 0;
+	}
+
+	return count >= 64 ? ~(uint64_t)0 : ( (uint64_t)1 << count ) - 1;
+}
+
+void b2SetCurrentThreadAffinity( int processorIndex )
+{
+	(void)processorIndex;
+
+	// Favor the performance cores
+	pthread_set_qos_class_self_np( QOS_CLASS_USER_INTERACTIVE, 0 );
+
+	// Threads with the same affinity tag are placed to share a cache where this is supported
+	thread_affinity_policy_data_t policy = { 1 };
+	thread_policy_set( pthread_mach_thread_np( pthread_self() ), THREAD_AFFINITY_POLICY, (thread_policy_t)&policy,
+					   THREAD_AFFINITY_POLICY_COUNT );
+}
+
 #else
 
 // Fallbacks for unknown platforms
@@ -567,6 +954,11 @@ float b2GetMilliseconds( uint64_t ticks )
 	return 0.0f;
 }
 
+double b2GetMillisecondsPerTick( void )
+{
+	return 0.0;
+}
+
 float b2GetMillisecondsAndReset( uint64_t* ticks )
 {
 	( (void)( ticks ) );
@@ -577,6 +969,17 @@ void b2Yield( void )
 {
 }
 
+void b2WaitAddress( void* address, uint32_t expected )
+{
+	( (void)( address ) );
+	( (void)( expected ) );
+}
+
+void b2WakeAddress( void* address )
+{
+	( (void)( address ) );
+}
+
 typedef struct b2Mutex
 {
 	int dummy;
@@ -654,6 +1057,16 @@ void b2JoinThread( b2Thread* t )
 	b2Free( t, sizeof( b2Thread ) );
 }
 
+uint64_t b2GetCacheDomainAffinityMask( void )
+{
+	return 0;
+}
+
+void b2SetCurrentThreadAffinity( int processorIndex )
+{
+	(void)processorIndex;
+}
+
 #endif
 
 // djb2 hash
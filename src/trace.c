@@ -0,0 +1,254 @@
+// SPDX-FileCopyrightText: 2025 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#include "atomic.h"
+#include "core.h"
+
+#include "box2d/base.h"
+#include "box2d/constants.h"
+#include "box2d/math_functions.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+// Room for the workers of a few schedulers plus the user threads that step worlds
+#define B2_TRACE_MAX_THREADS ( 2 * B2_MAX_WORKERS )
+#define B2_TRACE_MAX_FRAMES 1024
+#define B2_TRACE_NAME_LENGTH 32
+
+typedef struct b2TraceEvent
+{
+	const char* name;
+	uint64_t beginTicks;
+	uint64_t endTicks;
+} b2TraceEvent;
+
+// Ring buffer of a single thread. Only the owning thread writes to it.
+typedef struct b2TraceThread
+{
+	b2TraceEvent* events;
+	uint32_t eventCount;
+	char name[B2_TRACE_NAME_LENGTH];
+} b2TraceThread;
+
+bool b2_traceEnabled = false;
+
+static b2TraceThread b2_traceThreads[B2_TRACE_MAX_THREADS];
+static b2AtomicInt b2_traceThreadCount;
+static int b2_traceCapacity;
+
+// Threads claim a slot again after the recorder is enabled again
+static int b2_traceGeneration;
+
+// Ticks at the end of each step
+static uint64_t b2_traceFrames[B2_TRACE_MAX_FRAMES];
+static b2AtomicInt b2_traceFrameCount;
+
+static B2_THREAD_LOCAL int b2_threadGeneration;
+static B2_THREAD_LOCAL int b2_threadSlot;
+static B2_THREAD_LOCAL const char* b2_threadName;
+
+void b2EnableTrace( int eventCapacity )
+{
+	B2_ASSERT( eventCapacity >= 0 );
+
+	if ( b2_traceCapacity > 0 )
+	{
+		for ( int i = 0; i < B2_TRACE_MAX_THREADS; ++i )
+		{
+			B2_FREE_ARRAY( b2_traceThreads[i].events, b2_traceCapacity, b2TraceEvent );
+			b2_traceThreads[i] = ( b2TraceThread ){ 0 };
+		}
+	}
+
+	b2_traceEnabled = eventCapacity > 0;
+	b2_traceCapacity = b2MaxInt( eventCapacity, 0 );
+	b2_traceGeneration += 1;
+	b2AtomicStoreInt( &b2_traceThreadCount, 0 );
+	b2AtomicStoreInt( &b2_traceFrameCount, 0 );
+
+	// Allocate up front so recording never allocates during a step
+	for ( int i = 0; i < B2_TRACE_MAX_THREADS && b2_traceEnabled; ++i )
+	{
+		b2_traceThreads[i].events = B2_ALLOC_ARRAY( b2_traceCapacity, b2TraceEvent );
+	}
+}
+
+void b2SetTraceThreadName( const char* name )
+{
+	b2_threadName = name;
+}
+
+static b2TraceThread* b2GetTraceThread( void )
+{
+	if ( b2_threadGeneration != b2_traceGeneration )
+	{
+		b2_threadGeneration = b2_traceGeneration;
+		b2_threadSlot = b2AtomicFetchAddInt( &b2_traceThreadCount, 1 );
+
+		if ( b2_threadSlot < B2_TRACE_MAX_THREADS )
+		{
+			// Quotes and backslashes would need escaping in JSON
+			char* name = b2_traceThreads[b2_threadSlot].name;
+			if ( b2_threadName != NULL && b2_threadName[0] != 0 )
+			{
+				snprintf( name, B2_TRACE_NAME_LENGTH, "%s", b2_threadName );
+			}
+			else
+			{
+				snprintf( name, B2_TRACE_NAME_LENGTH, "Thread %d", b2_threadSlot );
+			}
+
+			for ( int i = 0; name[i] != 0; ++i )
+			{
+				if ( name[i] == '"' || name[i] == '\\' || name[i] < ' ' )
+				{
+					name[i] = '_';
+				}
+			}
+		}
+	}
+
+	// Threads beyond the limit are not recorded
+	if ( b2_threadSlot >= B2_TRACE_MAX_THREADS )
+	{
+		return NULL;
+	}
+
+	return b2_traceThreads + b2_threadSlot;
+}
+
+void b2RecordTraceZone( const char* name, uint64_t beginTicks )
+{
+	if ( b2_traceEnabled == false )
+	{
+		return;
+	}
+
+	b2TraceThread* thread = b2GetTraceThread();
+	if ( thread == NULL )
+	{
+		return;
+	}
+
+	int index = (int)( thread->eventCount % (uint32_t)b2_traceCapacity );
+	thread->events[index] = ( b2TraceEvent ){ name, beginTicks, b2GetTicks() };
+	thread->eventCount += 1;
+}
+
+void b2TraceFrame( void )
+{
+	if ( b2_traceEnabled == false )
+	{
+		return;
+	}
+
+	int frameIndex = b2AtomicFetchAddInt( &b2_traceFrameCount, 1 );
+	b2_traceFrames[frameIndex % B2_TRACE_MAX_FRAMES] = b2GetTicks();
+}
+
+// Counts the output when the buffer is NULL or full
+typedef struct b2TraceWriter
+{
+	char* buffer;
+	int capacity;
+	int size;
+} b2TraceWriter;
+
+static void b2WriteTraceText( b2TraceWriter* writer, const char* format, ... )
+{
+	va_list args;
+	va_start( args, format );
+
+	char* destination = NULL;
+	size_t available = 0;
+	if ( writer->buffer != NULL && writer->size < writer->capacity )
+	{
+		destination = writer->buffer + writer->size;
+		available = (size_t)( writer->capacity - writer->size );
+	}
+
+	int count = vsnprintf( destination, available, format, args );
+	va_end( args );
+
+	B2_ASSERT( count >= 0 );
+	writer->size += count;
+}
+
+int b2WriteTrace( char* buffer, int capacity, int stepCount )
+{
+	if ( b2_traceEnabled == false )
+	{
+		return 0;
+	}
+
+	// The window starts at the end of the step before the first requested step
+	uint64_t startTicks = 0;
+	int frameCount = b2AtomicLoadInt( &b2_traceFrameCount );
+	int startFrame = frameCount - stepCount - 1;
+	if ( stepCount > 0 && startFrame >= 0 && startFrame >= frameCount - B2_TRACE_MAX_FRAMES )
+	{
+		startTicks = b2_traceFrames[startFrame % B2_TRACE_MAX_FRAMES];
+	}
+
+	int threadCount = b2MinInt( b2AtomicLoadInt( &b2_traceThreadCount ), B2_TRACE_MAX_THREADS );
+
+	// Timestamps are relative to the first zone in the window
+	uint64_t originTicks = UINT64_MAX;
+	for ( int i = 0; i < threadCount; ++i )
+	{
+		b2TraceThread* thread = b2_traceThreads + i;
+		int count = thread->eventCount < (uint32_t)b2_traceCapacity ? (int)thread->eventCount : b2_traceCapacity;
+		for ( int j = 0; j < count; ++j )
+		{
+			uint64_t beginTicks = thread->events[j].beginTicks;
+			if ( beginTicks >= startTicks && beginTicks < originTicks )
+			{
+				originTicks = beginTicks;
+			}
+		}
+	}
+
+	double microsecondsPerTick = 1000.0 * b2GetMillisecondsPerTick();
+
+	b2TraceWriter writer = { buffer, capacity, 0 };
+	b2WriteTraceText( &writer, "{\"traceEvents\":[\n" );
+
+	const char* separator = "";
+	for ( int i = 0; i < threadCount; ++i )
+	{
+		b2TraceThread* thread = b2_traceThreads + i;
+		b2WriteTraceText( &writer, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+						  separator, i, thread->name );
+		separator = ",\n";
+
+		// Oldest first
+		uint32_t ringCapacity = (uint32_t)b2_traceCapacity;
+		uint32_t count = thread->eventCount < ringCapacity ? thread->eventCount : ringCapacity;
+		uint32_t first = thread->eventCount - count;
+		for ( uint32_t j = 0; j < count; ++j )
+		{
+			b2TraceEvent* event = thread->events + ( first + j ) % ringCapacity;
+			if ( event->beginTicks < startTicks )
+			{
+				continue;
+			}
+
+			double timestamp = microsecondsPerTick * (double)( event->beginTicks - originTicks );
+			double duration = microsecondsPerTick * (double)( event->endTicks - event->beginTicks );
+			b2WriteTraceText( &writer, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+							  event->name, i, timestamp, duration );
+		}
+	}
+
+	b2WriteTraceText( &writer, "\n]}\n" );
+
+	// Include the null terminator
+	int size = writer.size + 1;
+	if ( buffer == NULL )
+	{
+		return size;
+	}
+
+	return size <= capacity ? size : 0;
+}
@@ -21,8 +21,51 @@ b2WorldDef b2DefaultWorldDef( void )
 
 	// 400 meters per second, faster than the speed of sound
 	def.maximumLinearSpeed = 400.0f * lengthUnits;
+	def.contactEventFilter.categoryBits = B2_DEFAULT_MASK_BITS;
+	def.broadPhaseType = b2_treeBroadPhase;
+	def.gridCellSize = 2.0f * lengthUnits;
 	def.enableSleep = true;
 	def.enableContinuous = true;
+	def.maxIslandSplits = 4;
+	def.contactPrefetchDistance = 2;
+	def.internalValue = B2_SECRET_COOKIE;
+	return def;
+}
+
+b2AreaForceDef b2DefaultAreaForceDef( void )
+{
+	b2AreaForceDef def = { 0 };
+	def.maskBits = B2_DEFAULT_MASK_BITS;
+	def.explosion = b2DefaultExplosionDef();
+	def.wake = true;
+	def.internalValue = B2_SECRET_COOKIE;
+	return def;
+}
+
+b2ParticleDef b2DefaultParticleDef( void )
+{
+	float lengthUnits = b2GetLengthUnitsPerMeter();
+	b2ParticleDef def = { 0 };
+	def.radius = 0.05f * lengthUnits;
+	def.density = 1.0f;
+	def.friction = 0.6f;
+	def.gravityScale = 1.0f;
+	def.filter = b2DefaultFilter();
+	def.enableParticleCollision = true;
+	def.internalValue = B2_SECRET_COOKIE;
+	return def;
+}
+
+b2ShardGridDef b2DefaultShardGridDef( void )
+{
+	float lengthUnits = b2GetLengthUnitsPerMeter();
+	b2ShardGridDef def = { 0 };
+	def.worldDef = b2DefaultWorldDef();
+	def.shardSize = (b2Vec2){ 100.0f * lengthUnits, 100.0f * lengthUnits };
+	def.columnCount = 2;
+	def.rowCount = 1;
+	def.ghostMargin = 1.0f * lengthUnits;
+	def.handoffMargin = 0.5f * lengthUnits;
 	def.internalValue = B2_SECRET_COOKIE;
 	return def;
 }
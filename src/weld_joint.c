@@ -54,7 +54,7 @@ static inline b2Vec3 b2Solve33(const b2Mat33* m, b2Vec3 b )
 void b2WeldJoint_SetLinearHertz( b2JointId jointId, float hertz )
 {
 	B2_ASSERT( b2IsValidFloat( hertz ) && hertz >= 0.0f );
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_weldJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_weldJoint );
 	joint->weldJoint.linearHertz = hertz;
 }
 
@@ -67,7 +67,7 @@ float b2WeldJoint_GetLinearHertz( b2JointId jointId )
 void b2WeldJoint_SetLinearDampingRatio( b2JointId jointId, float dampingRatio )
 {
 	B2_ASSERT( b2IsValidFloat( dampingRatio ) && dampingRatio >= 0.0f );
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_weldJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_weldJoint );
 	joint->weldJoint.linearDampingRatio = dampingRatio;
 }
 
@@ -80,7 +80,7 @@ float b2WeldJoint_GetLinearDampingRatio( b2JointId jointId )
 void b2WeldJoint_SetAngularHertz( b2JointId jointId, float hertz )
 {
 	B2_ASSERT( b2IsValidFloat( hertz ) && hertz >= 0.0f );
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_weldJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_weldJoint );
 	joint->weldJoint.angularHertz = hertz;
 }
 
@@ -93,7 +93,7 @@ float b2WeldJoint_GetAngularHertz( b2JointId jointId )
 void b2WeldJoint_SetAngularDampingRatio( b2JointId jointId, float dampingRatio )
 {
 	B2_ASSERT( b2IsValidFloat( dampingRatio ) && dampingRatio >= 0.0f );
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_weldJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_weldJoint );
 	joint->weldJoint.angularDampingRatio = dampingRatio;
 }
 
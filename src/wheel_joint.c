@@ -15,7 +15,7 @@
 
 void b2WheelJoint_EnableSpring( b2JointId jointId, bool enableSpring )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_wheelJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_wheelJoint );
 
 	if ( enableSpring != joint->wheelJoint.enableSpring )
 	{
@@ -32,7 +32,7 @@ bool b2WheelJoint_IsSpringEnabled( b2JointId jointId )
 
 void b2WheelJoint_SetSpringHertz( b2JointId jointId, float hertz )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_wheelJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_wheelJoint );
 	joint->wheelJoint.hertz = hertz;
 }
 
@@ -44,7 +44,7 @@ float b2WheelJoint_GetSpringHertz( b2JointId jointId )
 
 void b2WheelJoint_SetSpringDampingRatio( b2JointId jointId, float dampingRatio )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_wheelJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_wheelJoint );
 	joint->wheelJoint.dampingRatio = dampingRatio;
 }
 
@@ -56,7 +56,7 @@ float b2WheelJoint_GetSpringDampingRatio( b2JointId jointId )
 
 void b2WheelJoint_EnableLimit( b2JointId jointId, bool enableLimit )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_wheelJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_wheelJoint );
 	if ( joint->wheelJoint.enableLimit != enableLimit )
 	{
 		joint->wheelJoint.lowerImpulse = 0.0f;
@@ -87,7 +87,7 @@ void b2WheelJoint_SetLimits( b2JointId jointId, float lower, float upper )
 {
 	B2_ASSERT( lower <= upper );
 
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_wheelJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_wheelJoint );
 	if ( lower != joint->wheelJoint.lowerTranslation || upper != joint->wheelJoint.upperTranslation )
 	{
 		joint->wheelJoint.lowerTranslation = b2MinFloat( lower, upper );
@@ -99,7 +99,7 @@ void b2WheelJoint_SetLimits( b2JointId jointId, float lower, float upper )
 
 void b2WheelJoint_EnableMotor( b2JointId jointId, bool enableMotor )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_wheelJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_wheelJoint );
 	if ( joint->wheelJoint.enableMotor != enableMotor )
 	{
 		joint->wheelJoint.motorImpulse = 0.0f;
@@ -115,7 +115,7 @@ bool b2WheelJoint_IsMotorEnabled( b2JointId jointId )
 
 void b2WheelJoint_SetMotorSpeed( b2JointId jointId, float motorSpeed )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_wheelJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_wheelJoint );
 	joint->wheelJoint.motorSpeed = motorSpeed;
 }
 
@@ -134,7 +134,7 @@ float b2WheelJoint_GetMotorTorque( b2JointId jointId )
 
 void b2WheelJoint_SetMaxMotorTorque( b2JointId jointId, float torque )
 {
-	b2JointSim* joint = b2GetJointSimCheckType( jointId, b2_wheelJoint );
+	b2JointSim* joint = b2GetMutableJointSim( jointId, b2_wheelJoint );
 	joint->wheelJoint.maxMotorTorque = torque;
 }
 
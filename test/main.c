@@ -27,6 +27,7 @@
 
 extern int BitSetTest( void );
 extern int CollisionTest( void );
+extern int CppTest( void );
 extern int ContainerTest( void );
 extern int DeterminismTest( void );
 extern int DistanceTest( void );
@@ -93,6 +94,7 @@ int main( int argc, char** argv )
 	MAYBE_RUN_TEST( ShapeTest );
 	MAYBE_RUN_TEST( ThreadTest );
 	MAYBE_RUN_TEST( WorldTest );
+	MAYBE_RUN_TEST( CppTest );
 
 	printf( "======================================\n" );
 	printf( "All Box2D tests passed!\n" );
@@ -32,6 +32,57 @@ int BitSetTest( void )
 		ENSURE( value == values[i] );
 	}
 
+	int valueCount = 0;
+	for ( int32_t i = 0; i < COUNT; ++i )
+	{
+		valueCount += values[i] ? 1 : 0;
+	}
+
+	ENSURE( b2CountSetBits( &bitSet ) == valueCount );
+
+	// Iterate sub-ranges that start and end inside blocks and span empty blocks
+	int ranges[][2] = { { 0, COUNT }, { 3, 100 }, { 14, 15 }, { 65, 144 }, { 90, 89 } };
+	for ( int r = 0; r < (int)( sizeof( ranges ) / sizeof( ranges[0] ) ); ++r )
+	{
+		uint32_t beginBit = (uint32_t)ranges[r][0];
+		uint32_t endBit = (uint32_t)ranges[r][1];
+
+		b2BitIterator it = b2IterateBits( &bitSet, beginBit, endBit );
+		uint32_t bitIndex;
+		uint32_t expected = beginBit;
+		while ( b2NextSetBit( &it, &bitIndex ) )
+		{
+			while ( values[expected] == false )
+			{
+				expected += 1;
+			}
+
+			ENSURE( bitIndex == expected );
+			expected += 1;
+		}
+
+		while ( expected < endBit )
+		{
+			ENSURE( values[expected] == false );
+			expected += 1;
+		}
+	}
+
+	b2BitSet other = b2CreateBitSet( COUNT );
+	b2SetBitCountAndClear( &other, COUNT );
+	for ( int32_t i = 0; i < COUNT; i += 7 )
+	{
+		b2SetBit( &other, i );
+	}
+
+	b2InPlaceUnion( &bitSet, &other );
+	for ( int32_t i = 0; i < COUNT; ++i )
+	{
+		bool expected = values[i] || ( i % 7 ) == 0;
+		ENSURE( b2GetBit( &bitSet, i ) == expected );
+	}
+
+	b2DestroyBitSet( &other );
 	b2DestroyBitSet( &bitSet );
 
 	return 0;
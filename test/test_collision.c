@@ -2,10 +2,15 @@
 // SPDX-License-Identifier: MIT
 
 #include "aabb.h"
+#include "manifold.h"
+#include "manifold_wide.h"
 #include "test_macros.h"
 
+#include "box2d/collision.h"
 #include "box2d/math_functions.h"
 
+#include <string.h>
+
 static int AABBTest( void )
 {
 	b2AABB a;
@@ -194,10 +199,190 @@ static int AABBRayCastTest( void )
 	return 0;
 }
 
+static bool SameBits( float a, float b )
+{
+	return memcmp( &a, &b, sizeof( float ) ) == 0;
+}
+
+static bool SameManifold( const b2Manifold* a, const b2Manifold* b )
+{
+	if ( a->pointCount != b->pointCount || SameBits( a->normal.x, b->normal.x ) == false ||
+		 SameBits( a->normal.y, b->normal.y ) == false )
+	{
+		return false;
+	}
+
+	for ( int i = 0; i < a->pointCount; ++i )
+	{
+		const b2ManifoldPoint* pa = a->points + i;
+		const b2ManifoldPoint* pb = b->points + i;
+		if ( SameBits( pa->anchorA.x, pb->anchorA.x ) == false || SameBits( pa->anchorA.y, pb->anchorA.y ) == false ||
+			 SameBits( pa->anchorB.x, pb->anchorB.x ) == false || SameBits( pa->anchorB.y, pb->anchorB.y ) == false ||
+			 SameBits( pa->clipPoint.x, pb->clipPoint.x ) == false || SameBits( pa->clipPoint.y, pb->clipPoint.y ) == false ||
+			 SameBits( pa->separation, pb->separation ) == false || pa->id != pb->id )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static float RandomRange( uint32_t* seed, float lo, float hi )
+{
+	*seed = 1664525u * *seed + 1013904223u;
+	return lo + ( hi - lo ) * (float)( *seed >> 8 ) / 16777216.0f;
+}
+
+#define WIDE_PAIR_COUNT 4
+
+// The batched manifold functions must reproduce the scalar functions bit for bit
+static int WideManifoldTest( void )
+{
+	uint32_t seed = 12345;
+	int hitCount = 0;
+	int twoPointCount = 0;
+
+	for ( int iteration = 0; iteration < 2000; ++iteration )
+	{
+		b2Circle circlesA[WIDE_PAIR_COUNT], circlesB[WIDE_PAIR_COUNT];
+		b2Capsule capsulesA[WIDE_PAIR_COUNT], capsulesB[WIDE_PAIR_COUNT];
+		b2Transform xfsA[WIDE_PAIR_COUNT], xfsB[WIDE_PAIR_COUNT];
+		const b2Circle* circlePtrsA[WIDE_PAIR_COUNT];
+		const b2Circle* circlePtrsB[WIDE_PAIR_COUNT];
+		const b2Capsule* capsulePtrsA[WIDE_PAIR_COUNT];
+		const b2Capsule* capsulePtrsB[WIDE_PAIR_COUNT];
+
+		// Some iterations use partial batches
+		int count = 1 + iteration % WIDE_PAIR_COUNT;
+
+		for ( int i = 0; i < count; ++i )
+		{
+			float angleA = RandomRange( &seed, -B2_PI, B2_PI );
+			float angleB = ( iteration % 5 ) == 0 ? angleA : RandomRange( &seed, -B2_PI, B2_PI );
+			xfsA[i] = ( b2Transform ){ { RandomRange( &seed, -1.0f, 1.0f ), RandomRange( &seed, -1.0f, 1.0f ) },
+									   b2MakeRot( angleA ) };
+			xfsB[i] = ( b2Transform ){ { RandomRange( &seed, -1.0f, 1.0f ), RandomRange( &seed, -1.0f, 1.0f ) },
+									   b2MakeRot( angleB ) };
+
+			// Coincident centers exercise the degenerate normal
+			if ( ( iteration % 7 ) == 0 )
+			{
+				xfsB[i] = xfsA[i];
+			}
+
+			circlesA[i] = ( b2Circle ){ { RandomRange( &seed, -0.2f, 0.2f ), 0.0f }, RandomRange( &seed, 0.1f, 0.5f ) };
+			circlesB[i] = ( b2Circle ){ { 0.0f, RandomRange( &seed, -0.2f, 0.2f ) }, RandomRange( &seed, 0.1f, 0.5f ) };
+
+			float lengthA = RandomRange( &seed, 0.1f, 1.0f );
+			float lengthB = RandomRange( &seed, 0.1f, 1.0f );
+			capsulesA[i] = ( b2Capsule ){ { -lengthA, 0.0f }, { lengthA, 0.1f }, RandomRange( &seed, 0.0f, 0.4f ) };
+			capsulesB[i] = ( b2Capsule ){ { -lengthB, 0.0f }, { lengthB, 0.0f }, RandomRange( &seed, 0.05f, 0.4f ) };
+
+			circlePtrsA[i] = circlesA + i;
+			circlePtrsB[i] = circlesB + i;
+			capsulePtrsA[i] = capsulesA + i;
+			capsulePtrsB[i] = capsulesB + i;
+		}
+
+		b2Manifold manifolds[WIDE_PAIR_COUNT];
+
+		b2CollideCirclesWide( circlePtrsA, xfsA, circlePtrsB, xfsB, count, manifolds );
+		for ( int i = 0; i < count; ++i )
+		{
+			b2Manifold m = b2CollideCircles( circlesA + i, xfsA[i], circlesB + i, xfsB[i] );
+			ENSURE( SameManifold( &m, manifolds + i ) );
+			hitCount += m.pointCount > 0 ? 1 : 0;
+		}
+
+		b2CollideCapsuleAndCircleWide( capsulePtrsA, xfsA, circlePtrsB, xfsB, count, manifolds );
+		for ( int i = 0; i < count; ++i )
+		{
+			b2Manifold m = b2CollideCapsuleAndCircle( capsulesA + i, xfsA[i], circlesB + i, xfsB[i] );
+			ENSURE( SameManifold( &m, manifolds + i ) );
+		}
+
+		b2CollideCapsulesWide( capsulePtrsA, xfsA, capsulePtrsB, xfsB, count, manifolds );
+		for ( int i = 0; i < count; ++i )
+		{
+			b2Manifold m = b2CollideCapsules( capsulesA + i, xfsA[i], capsulesB + i, xfsB[i] );
+			ENSURE( SameManifold( &m, manifolds + i ) );
+			twoPointCount += m.pointCount == 2 ? 1 : 0;
+		}
+	}
+
+	// Make sure the interesting paths were covered
+	ENSURE( hitCount > 100 );
+	ENSURE( twoPointCount > 100 );
+
+	return 0;
+}
+
+// The cached separating axis must not change the polygon manifolds. Each pair moves along a path with
+// one cache so the axis from the previous update gets reused.
+static int CachedAxisManifoldTest( void )
+{
+	uint32_t seed = 54321;
+	int earlyOutCount = 0;
+	int hitCount = 0;
+
+	for ( int pair = 0; pair < 200; ++pair )
+	{
+		b2Vec2 points[B2_MAX_POLYGON_VERTICES];
+		int count = 3 + pair % ( B2_MAX_POLYGON_VERTICES - 2 );
+		for ( int i = 0; i < count; ++i )
+		{
+			b2CosSin cs = b2ComputeCosSin( 2.0f * B2_PI * i / count );
+			float scale = RandomRange( &seed, 0.3f, 0.6f );
+			points[i] = ( b2Vec2 ){ scale * cs.cosine, scale * cs.sine };
+		}
+
+		b2Hull hull = b2ComputeHull( points, count );
+		ENSURE( hull.count > 0 );
+		b2Polygon polygonA = b2MakePolygon( &hull, RandomRange( &seed, 0.0f, 0.1f ) );
+		b2Polygon polygonB = b2MakeBox( RandomRange( &seed, 0.1f, 0.5f ), RandomRange( &seed, 0.1f, 0.5f ) );
+		b2Segment segment = { { -0.5f, 0.0f }, { 0.5f, RandomRange( &seed, -0.2f, 0.2f ) } };
+
+		b2Transform xfA = { { RandomRange( &seed, -1.0f, 1.0f ), RandomRange( &seed, -1.0f, 1.0f ) },
+							b2MakeRot( RandomRange( &seed, -B2_PI, B2_PI ) ) };
+		b2Vec2 start = { RandomRange( &seed, -2.0f, 2.0f ), RandomRange( &seed, -2.0f, 2.0f ) };
+		float angle = RandomRange( &seed, -B2_PI, B2_PI );
+
+		b2SimplexCache polygonCache = b2_emptySimplexCache;
+		b2SimplexCache segmentCache = b2_emptySimplexCache;
+
+		for ( int step = 0; step < 40; ++step )
+		{
+			// Move polygon B through polygon A in small steps
+			float t = step / 39.0f;
+			b2Vec2 p = b2Lerp( start, b2Neg( start ), t );
+			b2Transform xfB = { b2Add( xfA.p, p ), b2MakeRot( angle + 0.5f * t ) };
+
+			b2Manifold m1 = b2CollidePolygons( &polygonA, xfA, &polygonB, xfB );
+			b2Manifold m2 = b2CollidePolygonsCached( &polygonA, xfA, &polygonB, xfB, &polygonCache );
+			ENSURE( SameManifold( &m1, &m2 ) );
+			earlyOutCount += polygonCache.count == 2 ? 1 : 0;
+			hitCount += m1.pointCount > 0 ? 1 : 0;
+
+			m1 = b2CollideSegmentAndPolygon( &segment, xfA, &polygonB, xfB );
+			m2 = b2CollideSegmentAndPolygonCached( &segment, xfA, &polygonB, xfB, &segmentCache );
+			ENSURE( SameManifold( &m1, &m2 ) );
+			earlyOutCount += segmentCache.count == 2 ? 1 : 0;
+		}
+	}
+
+	ENSURE( earlyOutCount > 1000 );
+	ENSURE( hitCount > 100 );
+
+	return 0;
+}
+
 int CollisionTest( void )
 {
 	RUN_SUBTEST( AABBTest );
 	RUN_SUBTEST( AABBRayCastTest );
+	RUN_SUBTEST( WideManifoldTest );
+	RUN_SUBTEST( CachedAxisManifoldTest );
 
 	return 0;
 }
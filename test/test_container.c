@@ -1,6 +1,7 @@
 // SPDX-FileCopyrightText: 2026 Erin Catto
 // SPDX-License-Identifier: MIT
 
+#include "arena_allocator.h"
 #include "container.h"
 #include "core.h"
 #include "test_macros.h"
@@ -496,6 +497,43 @@ static int TestArrayCreateN( void )
 	return 0;
 }
 
+// Allocations beyond the capacity spill to heap blocks, stay valid until reset, and the
+// arena grows to fit on reset.
+static int TestArenaOverflow( void )
+{
+	b2Arena arena = b2CreateArena( 256 );
+
+	int* values[100];
+	for ( int i = 0; i < 100; ++i )
+	{
+		values[i] = b2ArenaAlloc( &arena, 3 * sizeof( int ) );
+		ENSURE( ( (uintptr_t)values[i] & 15 ) == 0 );
+		values[i][0] = i;
+		values[i][2] = -i;
+	}
+
+	for ( int i = 0; i < 100; ++i )
+	{
+		ENSURE( values[i][0] == i && values[i][2] == -i );
+	}
+
+	ENSURE( b2GetArenaAllocation( &arena ) == 100 * 16 );
+	ENSURE( arena.blocks.count > 0 );
+
+	b2ResetArena( &arena );
+	ENSURE( b2GetArenaAllocation( &arena ) == 0 );
+	ENSURE( b2GetArenaCapacity( &arena ) >= 100 * 16 );
+	ENSURE( arena.blocks.count == 0 );
+
+	// a large allocation gets its own block
+	void* large = b2ArenaAlloc( &arena, 4 * b2GetArenaCapacity( &arena ) );
+	ENSURE( large != NULL );
+	ENSURE( arena.blocks.count == 1 );
+
+	b2DestroyArena( &arena );
+	return 0;
+}
+
 int ContainerTest( void )
 {
 	RUN_SUBTEST( TestCreateDestroy );
@@ -519,6 +557,7 @@ int ContainerTest( void )
 	RUN_SUBTEST( TestArrayPushAfterReserve );
 	RUN_SUBTEST( TestArraySingleElement );
 	RUN_SUBTEST( TestArrayCreateN );
+	RUN_SUBTEST( TestArenaOverflow );
 
 	return 0;
 }
@@ -0,0 +1,130 @@
+// SPDX-FileCopyrightText: 2026 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#include "test_macros.h"
+
+#include "box2d/box2d.hpp"
+
+#include <array>
+#include <vector>
+
+static int TestCppBulk()
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	constexpr int count = 16;
+	std::vector<b2BodyDef> bodyDefs( count, b2DefaultBodyDef() );
+	std::vector<b2ShapeDef> shapeDefs( count, b2DefaultShapeDef() );
+	std::vector<b2Polygon> polygons( count, b2MakeSquare( 0.25f ) );
+	for ( int i = 0; i < count; ++i )
+	{
+		bodyDefs[i].type = b2_dynamicBody;
+		bodyDefs[i].position = { float( i ), 10.0f };
+	}
+
+	std::vector<b2BodyId> bodyIds( count );
+	b2::CreateBodies( worldId, bodyDefs, shapeDefs, polygons, bodyIds );
+	ENSURE( b2Body_IsValid( bodyIds[count - 1] ) );
+
+	// Push every body sideways
+	std::vector<b2BodyCommand> commands( count );
+	for ( int i = 0; i < count; ++i )
+	{
+		commands[i] = { bodyIds[i], { 1.0f, 0.0f }, b2Body_GetWorldCenterOfMass( bodyIds[i] ), b2_bodyLinearVelocity, true };
+	}
+
+	b2::QueueBodyCommands( worldId, 0, commands );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+	std::vector<b2Vec2> positions( count );
+	std::vector<b2Vec2> velocities( count );
+	b2::GetBodyStates( worldId, bodyIds, { .positions = positions, .linearVelocities = velocities } );
+	for ( int i = 0; i < count; ++i )
+	{
+		b2Vec2 p = b2Body_GetPosition( bodyIds[i] );
+		ENSURE( positions[i].x == p.x && positions[i].y == p.y );
+		ENSURE_SMALL( velocities[i].x - 1.0f, 0.001f );
+	}
+
+	std::array<b2BodyId, count> awakeIds;
+	ENSURE( b2::GetAwakeBodyStates( worldId, awakeIds, {} ) == count );
+
+	// Batched queries
+	std::array<b2AABB, 2> boxes = { b2AABB{ { -0.5f, 9.0f }, { 0.5f, 11.0f } }, b2AABB{ { 100.0f, 0.0f }, { 101.0f, 1.0f } } };
+	std::array<b2QueryFilter, 2> filters = { b2DefaultQueryFilter(), b2DefaultQueryFilter() };
+	std::array<b2OverlapHit, 8> hits;
+	int hitCount = b2::OverlapAABBs( worldId, boxes, filters, hits );
+	ENSURE( hitCount == 1 && hits[0].queryIndex == 0 );
+
+	std::array<b2Vec2, 1> origins = { b2Vec2{ -5.0f, 10.0f } };
+	std::array<b2Vec2, 1> translations = { b2Vec2{ 30.0f, 0.0f } };
+	std::array<b2RayResult, 1> rayResults;
+	b2::CastRaysClosest( worldId, origins, translations, b2DefaultQueryFilter(), rayResults );
+	ENSURE( rayResults[0].hit && B2_ID_EQUALS( b2Shape_GetBody( rayResults[0].shapeId ), bodyIds[0] ) );
+
+	b2::DestroyBodies( bodyIds );
+	ENSURE( b2World_GetAwakeBodyCount( worldId ) == 0 );
+
+	b2DestroyWorld( worldId );
+	return 0;
+}
+
+static int TestCppVisitors()
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Polygon box = b2MakeSquare( 0.5f );
+	for ( int i = 0; i < 4; ++i )
+	{
+		bodyDef.position = { 2.0f * float( i ), 0.0f };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyId, &shapeDef, &box );
+	}
+
+	// Capturing lambdas, stopping early
+	int overlapCount = 0;
+	b2::OverlapAABB( worldId, { { -1.0f, -1.0f }, { 10.0f, 1.0f } }, b2DefaultQueryFilter(), [&]( b2ShapeId ) {
+		overlapCount += 1;
+		return overlapCount < 3;
+	} );
+	ENSURE( overlapCount == 3 );
+
+	b2ShapeProxy proxy = b2MakeProxy( &box.vertices[0], box.count, 0.0f );
+	overlapCount = 0;
+	b2::OverlapShape( worldId, proxy, b2DefaultQueryFilter(), [&]( b2ShapeId ) {
+		overlapCount += 1;
+		return true;
+	} );
+	ENSURE( overlapCount == 1 );
+
+	// Closest hit by clipping the ray
+	float closest = 1.0f;
+	auto closestHit = [&closest]( b2ShapeId, b2Vec2, b2Vec2, float fraction ) {
+		closest = fraction;
+		return fraction;
+	};
+	b2::CastRay( worldId, { 10.0f, 0.0f }, { -20.0f, 0.0f }, b2DefaultQueryFilter(), closestHit );
+	ENSURE_SMALL( closest - 0.175f, 0.001f );
+
+	// A circle swept into the first box
+	b2Vec2 center = { -5.0f, 0.0f };
+	b2ShapeProxy circle = b2MakeProxy( &center, 1, 0.5f );
+	closest = 1.0f;
+	b2::CastShape( worldId, circle, { 10.0f, 0.0f }, b2DefaultQueryFilter(), closestHit );
+	ENSURE_SMALL( closest - 0.4f, 0.01f );
+
+	b2DestroyWorld( worldId );
+	return 0;
+}
+
+extern "C" int CppTest( void )
+{
+	RUN_SUBTEST( TestCppBulk );
+	RUN_SUBTEST( TestCppVisitors );
+
+	return 0;
+}
@@ -7,7 +7,10 @@
 #include "box2d/box2d.h"
 #include "box2d/types.h"
 
+#include <float.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #ifdef BOX2D_PROFILE
 #include <tracy/TracyC.h>
@@ -15,8 +18,14 @@
 #define TracyCFrameMark
 #endif
 
+#if defined( BOX2D_FAST_MATH )
+// Fast math uses the reciprocal square root estimate of the CPU, these are the x64 results
+#define EXPECTED_SLEEP_STEP 286
+#define EXPECTED_HASH 0x6A25F1D2
+#else
 #define EXPECTED_SLEEP_STEP 262
 #define EXPECTED_HASH 0x3841BB81
+#endif
 
 static int SingleMultithreadingTest( int workerCount )
 {
@@ -120,6 +129,279 @@ static int BuiltInSchedulerTest( void )
 	return 0;
 }
 
+#define CONTACT_GRID_COUNT 20
+#define CONTACT_BODY_COUNT ( CONTACT_GRID_COUNT * CONTACT_GRID_COUNT + CONTACT_GRID_COUNT )
+
+static void SimulateContactGrid( b2Transform* transforms, b2ContactId* contactIds, bool parallel )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+	worldDef.enableParallelContacts = parallel;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Segment segment = { { -40.0f, 0.0f }, { 40.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	// Boxes placed side by side so the first step creates many pairs at once
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	b2BodyId bodyIds[CONTACT_BODY_COUNT];
+	for ( int i = 0; i < CONTACT_GRID_COUNT * CONTACT_GRID_COUNT; ++i )
+	{
+		bodyDef.position = ( b2Vec2 ){ -10.0f + 1.0f * ( i % CONTACT_GRID_COUNT ), 0.5f + 1.0f * ( i / CONTACT_GRID_COUNT ) };
+		bodyIds[i] = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyIds[i], &shapeDef, &box );
+	}
+
+	// A sleeping row resting on the ground. Its new contacts go to the disabled set in the same batch.
+	bodyDef.isAwake = false;
+	for ( int i = CONTACT_GRID_COUNT * CONTACT_GRID_COUNT; i < CONTACT_BODY_COUNT; ++i )
+	{
+		bodyDef.position = ( b2Vec2 ){ 15.0f + 1.0f * ( i % CONTACT_GRID_COUNT ), 0.45f };
+		bodyIds[i] = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyIds[i], &shapeDef, &box );
+	}
+
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	for ( int i = 0; i < CONTACT_BODY_COUNT; ++i )
+	{
+		transforms[i] = b2Body_GetTransform( bodyIds[i] );
+
+		b2ContactData contactData;
+		int count = b2Body_GetContactData( bodyIds[i], &contactData, 1 );
+		contactIds[i] = count > 0 ? contactData.contactId : b2_nullContactId;
+	}
+
+	b2DestroyWorld( worldId );
+}
+
+// Parallel contact creation gives the same contact ids and order as serial creation.
+static int ParallelContactsTest( void )
+{
+	b2Transform serialTransforms[CONTACT_BODY_COUNT];
+	b2Transform parallelTransforms[CONTACT_BODY_COUNT];
+	b2ContactId serialContactIds[CONTACT_BODY_COUNT];
+	b2ContactId parallelContactIds[CONTACT_BODY_COUNT];
+
+	SimulateContactGrid( serialTransforms, serialContactIds, false );
+	SimulateContactGrid( parallelTransforms, parallelContactIds, true );
+
+	for ( int i = 0; i < CONTACT_BODY_COUNT; ++i )
+	{
+		ENSURE( b2IsValidVec2( parallelTransforms[i].p ) );
+		ENSURE( memcmp( serialTransforms + i, parallelTransforms + i, sizeof( b2Transform ) ) == 0 );
+		ENSURE( serialContactIds[i].index1 == parallelContactIds[i].index1 );
+		ENSURE( serialContactIds[i].generation == parallelContactIds[i].generation );
+	}
+
+	return 0;
+}
+
+static int CountFirstStepContacts( b2BroadPhaseType broadPhaseType )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.broadPhaseType = broadPhaseType;
+	worldDef.gridCellSize = 1.5f;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Segment segment = { { -40.0f, 0.0f }, { 40.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	// Mixed sizes so some proxies span several cells and the long planks use the oversize list
+	bodyDef.type = b2_dynamicBody;
+	for ( int i = 0; i < CONTACT_GRID_COUNT * CONTACT_GRID_COUNT; ++i )
+	{
+		float halfWidth = i % 37 == 0 ? 6.0f : ( i % 3 == 0 ? 0.75f : 0.4f );
+		b2Polygon box = b2MakeBox( halfWidth, 0.4f );
+		bodyDef.position = ( b2Vec2 ){ -10.0f + 1.0f * ( i % CONTACT_GRID_COUNT ), 0.5f + 1.0f * ( i / CONTACT_GRID_COUNT ) };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyId, &shapeDef, &box );
+	}
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	int contactCount = b2World_GetCounters( worldId ).contactCount;
+
+	b2DestroyWorld( worldId );
+	return contactCount;
+}
+
+// The grid broad-phase finds the same pairs as the tree and is deterministic across worker counts.
+static int GridBroadPhaseTest( void )
+{
+	int treeContactCount = CountFirstStepContacts( b2_treeBroadPhase );
+	int gridContactCount = CountFirstStepContacts( b2_gridBroadPhase );
+	ENSURE( treeContactCount > 0 );
+	ENSURE( gridContactCount == treeContactCount );
+
+	int sleepStep = 0;
+	uint32_t hash = 0;
+	for ( int workerCount = 1; workerCount <= 4; workerCount += 3 )
+	{
+		b2WorldDef worldDef = b2DefaultWorldDef();
+		worldDef.workerCount = workerCount;
+		worldDef.broadPhaseType = b2_gridBroadPhase;
+
+		b2WorldId worldId = b2CreateWorld( &worldDef );
+
+		FallingHingeData data = CreateFallingHinges( worldId );
+
+		float timeStep = 1.0f / 60.0f;
+		int stepLimit = 1000;
+		for ( int i = 0; i < stepLimit; ++i )
+		{
+			int subStepCount = 4;
+			b2World_Step( worldId, timeStep, subStepCount );
+
+			bool done = UpdateFallingHinges( worldId, &data );
+			if ( done )
+			{
+				break;
+			}
+		}
+
+		b2DestroyWorld( worldId );
+
+		ENSURE( data.sleepStep > 0 );
+		if ( workerCount == 1 )
+		{
+			sleepStep = data.sleepStep;
+			hash = data.hash;
+		}
+		else
+		{
+			ENSURE( data.sleepStep == sleepStep );
+			ENSURE( data.hash == hash );
+		}
+
+		DestroyFallingHinges( &data );
+	}
+
+	return 0;
+}
+
+// The asynchronous step produces the same result as b2World_Step. Ray casts while the step is in flight
+// only see the static ground, even through the falling bodies.
+static int AsyncStepTest( void )
+{
+	for ( int workerCount = 1; workerCount <= 4; workerCount += 3 )
+	{
+		b2WorldDef worldDef = b2DefaultWorldDef();
+		worldDef.workerCount = workerCount;
+
+		b2WorldId worldId = b2CreateWorld( &worldDef );
+
+		FallingHingeData data = CreateFallingHinges( worldId );
+
+		float timeStep = 1.0f / 60.0f;
+		int stepLimit = 1000;
+		for ( int i = 0; i < stepLimit; ++i )
+		{
+			int subStepCount = 4;
+			b2World_StepAsync( worldId, timeStep, subStepCount );
+
+			b2Vec2 origin = { 0.0f, 20.0f };
+			b2Vec2 translation = { 0.0f, -40.0f };
+			b2RayResult result = b2World_CastRayClosest( worldId, origin, translation, b2DefaultQueryFilter() );
+			ENSURE( result.hit );
+			ENSURE_SMALL( result.point.y, 0.01f );
+
+			b2World_WaitStep( worldId );
+			ENSURE( b2World_IsStepping( worldId ) == false );
+
+			bool done = UpdateFallingHinges( worldId, &data );
+			if ( done )
+			{
+				break;
+			}
+		}
+
+		b2DestroyWorld( worldId );
+
+		if ( data.sleepStep != EXPECTED_SLEEP_STEP || data.hash != EXPECTED_HASH )
+		{
+			printf( "  async step workers=%d sleepStep=%d hash=0x%08X\n", workerCount, data.sleepStep, data.hash );
+		}
+
+		ENSURE( data.sleepStep == EXPECTED_SLEEP_STEP );
+		ENSURE( data.hash == EXPECTED_HASH );
+
+		DestroyFallingHinges( &data );
+	}
+
+	return 0;
+}
+
+// Worlds stepped together in one batch match worlds stepped alone
+static int StepWorldsTest( void )
+{
+	enum
+	{
+		e_worldCount = 4
+	};
+
+	b2WorldId worldIds[e_worldCount];
+	FallingHingeData data[e_worldCount];
+	bool done[e_worldCount] = { 0 };
+
+	for ( int i = 0; i < e_worldCount; ++i )
+	{
+		b2WorldDef worldDef = b2DefaultWorldDef();
+		worldDef.workerCount = i + 1;
+		worldIds[i] = b2CreateWorld( &worldDef );
+		data[i] = CreateFallingHinges( worldIds[i] );
+	}
+
+	float timeStep = 1.0f / 60.0f;
+	int stepLimit = 1000;
+	for ( int step = 0; step < stepLimit; ++step )
+	{
+		b2StepWorlds( worldIds, e_worldCount, timeStep, 4 );
+
+		bool allDone = true;
+		for ( int i = 0; i < e_worldCount; ++i )
+		{
+			if ( done[i] == false )
+			{
+				done[i] = UpdateFallingHinges( worldIds[i], data + i );
+			}
+
+			allDone = allDone && done[i];
+		}
+
+		if ( allDone )
+		{
+			break;
+		}
+	}
+
+	for ( int i = 0; i < e_worldCount; ++i )
+	{
+		b2DestroyWorld( worldIds[i] );
+
+		if ( data[i].sleepStep != EXPECTED_SLEEP_STEP || data[i].hash != EXPECTED_HASH )
+		{
+			printf( "  step worlds index=%d sleepStep=%d hash=0x%08X\n", i, data[i].sleepStep, data[i].hash );
+		}
+
+		ENSURE( data[i].sleepStep == EXPECTED_SLEEP_STEP );
+		ENSURE( data[i].hash == EXPECTED_HASH );
+
+		DestroyFallingHinges( data + i );
+	}
+
+	return 0;
+}
+
 // Test cross-platform determinism.
 static int CrossPlatformTest( void )
 {
@@ -155,11 +437,1077 @@ static int CrossPlatformTest( void )
 	return 0;
 }
 
+#define WIDE_JOINT_CHAIN_LENGTH 40
+#define WIDE_JOINT_BODY_COUNT ( 4 * WIDE_JOINT_CHAIN_LENGTH )
+
+// Joints with a force threshold stay on the scalar solver path
+static void SimulateJointChains( b2Transform* transforms, bool forceScalar )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+
+	float threshold = forceScalar ? 0.5f * FLT_MAX : FLT_MAX;
+
+	b2BodyId bodyIds[WIDE_JOINT_BODY_COUNT];
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Polygon box = b2MakeBox( 0.5f, 0.125f );
+
+	int bodyIndex = 0;
+	for ( int chain = 0; chain < 4; ++chain )
+	{
+		float y = 20.0f + 2.0f * chain;
+		float x0 = -20.0f;
+		b2BodyId prevId = groundId;
+
+		for ( int i = 0; i < WIDE_JOINT_CHAIN_LENGTH; ++i )
+		{
+			bodyDef = b2DefaultBodyDef();
+			bodyDef.type = b2_dynamicBody;
+			bodyDef.position = (b2Vec2){ x0 + 0.5f + i, y };
+			bodyDef.rotation = b2MakeRot( 0.1f * chain );
+			b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+			b2CreatePolygonShape( bodyId, &shapeDef, &box );
+
+			b2Vec2 pivot = { x0 + i, y };
+			b2JointDef base = b2DefaultWeldJointDef().base;
+			base.bodyIdA = prevId;
+			base.bodyIdB = bodyId;
+			base.localFrameA.p = b2Body_GetLocalPoint( prevId, pivot );
+			base.localFrameB.p = b2Body_GetLocalPoint( bodyId, pivot );
+			base.forceThreshold = threshold;
+			base.torqueThreshold = threshold;
+
+			int kind = ( chain + i ) % 4;
+			if ( kind == 0 )
+			{
+				b2RevoluteJointDef jointDef = b2DefaultRevoluteJointDef();
+				jointDef.base = base;
+				jointDef.enableLimit = i % 3 == 0;
+				jointDef.lowerAngle = -0.25f * B2_PI;
+				jointDef.upperAngle = 0.125f * B2_PI;
+				jointDef.enableMotor = i % 5 == 0;
+				jointDef.maxMotorTorque = 20.0f;
+				jointDef.motorSpeed = 0.5f;
+				b2CreateRevoluteJoint( worldId, &jointDef );
+			}
+			else if ( kind == 1 )
+			{
+				b2WeldJointDef jointDef = b2DefaultWeldJointDef();
+				jointDef.base = base;
+				jointDef.linearHertz = i % 2 == 0 ? 5.0f : 0.0f;
+				jointDef.angularHertz = i % 3 == 0 ? 2.0f : 0.0f;
+				jointDef.linearDampingRatio = 0.7f;
+				jointDef.angularDampingRatio = 0.5f;
+				b2CreateWeldJoint( worldId, &jointDef );
+			}
+			else if ( kind == 2 )
+			{
+				b2PrismaticJointDef jointDef = b2DefaultPrismaticJointDef();
+				jointDef.base = base;
+				jointDef.base.localFrameA.q = b2MakeRot( 0.5f * B2_PI );
+				jointDef.base.localFrameB.q = b2MakeRot( 0.5f * B2_PI );
+				jointDef.enableLimit = i % 2 == 0;
+				jointDef.lowerTranslation = -0.5f;
+				jointDef.upperTranslation = 0.25f;
+				jointDef.enableMotor = i % 3 == 0;
+				jointDef.maxMotorForce = 50.0f;
+				jointDef.motorSpeed = -1.0f;
+				jointDef.enableSpring = i % 4 == 0;
+				jointDef.hertz = 3.0f;
+				jointDef.dampingRatio = 0.5f;
+				b2CreatePrismaticJoint( worldId, &jointDef );
+			}
+			else
+			{
+				// The revolute spring is always solved by the scalar path
+				b2RevoluteJointDef jointDef = b2DefaultRevoluteJointDef();
+				jointDef.base = base;
+				jointDef.enableSpring = true;
+				jointDef.hertz = 2.0f;
+				jointDef.dampingRatio = 0.5f;
+				b2CreateRevoluteJoint( worldId, &jointDef );
+			}
+
+			bodyIds[bodyIndex] = bodyId;
+			bodyIndex += 1;
+			prevId = bodyId;
+		}
+	}
+
+	float timeStep = 1.0f / 60.0f;
+	for ( int i = 0; i < 120; ++i )
+	{
+		int subStepCount = 4;
+		b2World_Step( worldId, timeStep, subStepCount );
+	}
+
+	for ( int i = 0; i < WIDE_JOINT_BODY_COUNT; ++i )
+	{
+		transforms[i] = b2Body_GetTransform( bodyIds[i] );
+	}
+
+	b2DestroyWorld( worldId );
+}
+
+// The wide joint solver must match the scalar joint solver bit for bit.
+static int WideJointTest( void )
+{
+	b2Transform scalarTransforms[WIDE_JOINT_BODY_COUNT];
+	b2Transform wideTransforms[WIDE_JOINT_BODY_COUNT];
+
+	SimulateJointChains( scalarTransforms, true );
+	SimulateJointChains( wideTransforms, false );
+
+	for ( int i = 0; i < WIDE_JOINT_BODY_COUNT; ++i )
+	{
+		ENSURE( b2IsValidVec2( wideTransforms[i].p ) );
+		ENSURE( memcmp( scalarTransforms + i, wideTransforms + i, sizeof( b2Transform ) ) == 0 );
+	}
+
+	return 0;
+}
+
+#define OVERFLOW_BOX_COUNT 60
+
+// A wide dynamic platform carrying many boxes pushes contacts into the overflow color.
+static int SimulateOverflowPile( b2Transform* transforms, const b2WorldDef* worldDef )
+{
+	b2WorldId worldId = b2CreateWorld( worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Polygon groundBox = b2MakeOffsetBox( 40.0f, 1.0f, ( b2Vec2 ){ 0.0f, -1.0f }, b2Rot_identity );
+	b2CreatePolygonShape( groundId, &shapeDef, &groundBox );
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position = ( b2Vec2 ){ 0.0f, 0.5f };
+	b2BodyId platformId = b2CreateBody( worldId, &bodyDef );
+	b2Polygon platformBox = b2MakeBox( 32.0f, 0.5f );
+	b2CreatePolygonShape( platformId, &shapeDef, &platformBox );
+
+	b2BodyId boxIds[OVERFLOW_BOX_COUNT];
+	b2Polygon box = b2MakeBox( 0.2f, 0.2f );
+	for ( int i = 0; i < OVERFLOW_BOX_COUNT; ++i )
+	{
+		bodyDef.position = ( b2Vec2 ){ -30.0f + 1.0f * i, 1.25f };
+		boxIds[i] = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( boxIds[i], &shapeDef, &box );
+	}
+
+	int maxOverflowCount = 0;
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		b2Counters counters = b2World_GetCounters( worldId );
+		maxOverflowCount = counters.overflowContactCount > maxOverflowCount ? counters.overflowContactCount : maxOverflowCount;
+	}
+
+	for ( int i = 0; i < OVERFLOW_BOX_COUNT; ++i )
+	{
+		transforms[i] = b2Body_GetTransform( boxIds[i] );
+	}
+
+	b2DestroyWorld( worldId );
+
+	return maxOverflowCount;
+}
+
+// The parallel overflow solver must not depend on the worker count and must keep the pile resting.
+static int OverflowTest( void )
+{
+	b2Transform serialTransforms[OVERFLOW_BOX_COUNT];
+	b2Transform singleTransforms[OVERFLOW_BOX_COUNT];
+	b2Transform multiTransforms[OVERFLOW_BOX_COUNT];
+
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 1;
+	int serialOverflowCount = SimulateOverflowPile( serialTransforms, &worldDef );
+
+	worldDef.enableParallelOverflow = true;
+	int singleOverflowCount = SimulateOverflowPile( singleTransforms, &worldDef );
+
+	worldDef.workerCount = 4;
+	int multiOverflowCount = SimulateOverflowPile( multiTransforms, &worldDef );
+
+	ENSURE( serialOverflowCount > 0 );
+	ENSURE( singleOverflowCount > 0 );
+	ENSURE( multiOverflowCount == singleOverflowCount );
+
+	for ( int i = 0; i < OVERFLOW_BOX_COUNT; ++i )
+	{
+		ENSURE( b2IsValidVec2( multiTransforms[i].p ) );
+		ENSURE( memcmp( singleTransforms + i, multiTransforms + i, sizeof( b2Transform ) ) == 0 );
+
+		// parallel results differ from serial results but both keep the boxes on the platform
+		ENSURE( b2AbsFloat( serialTransforms[i].p.y - 1.2f ) < 0.05f );
+		ENSURE( b2AbsFloat( multiTransforms[i].p.y - 1.2f ) < 0.05f );
+	}
+
+	return 0;
+}
+
+#define CONTINUOUS_BODY_COUNT 24
+#define CONTINUOUS_BLOCK_COUNT 400
+
+// Fast bodies and bullets are fired into a dense block of thin static plates backed by a wall.
+static void SimulateContinuousVolley( b2Transform* transforms, int workerCount, bool enableCache )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.gravity = b2Vec2_zero;
+	worldDef.workerCount = workerCount;
+	worldDef.enableContinuousCache = enableCache;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+
+	for ( int i = 0; i < CONTINUOUS_BLOCK_COUNT; ++i )
+	{
+		float x = 10.0f + 0.25f * ( i % 20 );
+		float y = -10.0f + 1.0f * ( i / 20 );
+		b2Polygon plate = b2MakeOffsetBox( 0.02f, 0.5f, ( b2Vec2 ){ x, y + 0.5f }, b2Rot_identity );
+		b2CreatePolygonShape( groundId, &shapeDef, &plate );
+	}
+
+	b2Polygon wall = b2MakeOffsetBox( 0.1f, 20.0f, ( b2Vec2 ){ 20.0f, 0.0f }, b2Rot_identity );
+	b2CreatePolygonShape( groundId, &shapeDef, &wall );
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.linearVelocity = ( b2Vec2 ){ 400.0f, 0.0f };
+
+	b2BodyId bodyIds[CONTINUOUS_BODY_COUNT];
+	b2Circle circle = { { 0.0f, 0.0f }, 0.1f };
+	for ( int i = 0; i < CONTINUOUS_BODY_COUNT; ++i )
+	{
+		bodyDef.position = ( b2Vec2 ){ 0.0f, -9.5f + 0.8f * i };
+		bodyDef.isBullet = ( i & 1 ) == 1;
+		bodyIds[i] = b2CreateBody( worldId, &bodyDef );
+		b2CreateCircleShape( bodyIds[i], &shapeDef, &circle );
+	}
+
+	for ( int i = 0; i < 30; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	for ( int i = 0; i < CONTINUOUS_BODY_COUNT; ++i )
+	{
+		transforms[i] = b2Body_GetTransform( bodyIds[i] );
+	}
+
+	b2DestroyWorld( worldId );
+}
+
+// Continuous collision is split by candidate pair across workers and must not depend on the worker count.
+static int ContinuousTest( void )
+{
+	for ( int pass = 0; pass < 2; ++pass )
+	{
+		bool enableCache = pass == 1;
+		b2Transform singleTransforms[CONTINUOUS_BODY_COUNT];
+		b2Transform multiTransforms[CONTINUOUS_BODY_COUNT];
+
+		SimulateContinuousVolley( singleTransforms, 1, enableCache );
+		SimulateContinuousVolley( multiTransforms, 4, enableCache );
+
+		for ( int i = 0; i < CONTINUOUS_BODY_COUNT; ++i )
+		{
+			ENSURE( memcmp( singleTransforms + i, multiTransforms + i, sizeof( b2Transform ) ) == 0 );
+
+			// No body tunnels through the plates
+			ENSURE( singleTransforms[i].p.x < 10.0f );
+		}
+	}
+
+	return 0;
+}
+
+// Adaptive coloring with a reduced color count moves the platform contacts to overflow early.
+static int AdaptiveColoringTest( void )
+{
+	b2Transform singleTransforms[OVERFLOW_BOX_COUNT];
+	b2Transform multiTransforms[OVERFLOW_BOX_COUNT];
+
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.enableAdaptiveColoring = true;
+	worldDef.graphColorCount = 8;
+	worldDef.workerCount = 1;
+	int singleOverflowCount = SimulateOverflowPile( singleTransforms, &worldDef );
+
+	worldDef.workerCount = 3;
+	int multiOverflowCount = SimulateOverflowPile( multiTransforms, &worldDef );
+
+	// the platform keeps 3 of its 7 colors and the rest of its contacts go to overflow
+	ENSURE( singleOverflowCount >= OVERFLOW_BOX_COUNT - 3 );
+	ENSURE( multiOverflowCount == singleOverflowCount );
+
+	for ( int i = 0; i < OVERFLOW_BOX_COUNT; ++i )
+	{
+		ENSURE( memcmp( singleTransforms + i, multiTransforms + i, sizeof( b2Transform ) ) == 0 );
+		ENSURE( b2AbsFloat( multiTransforms[i].p.y - 1.2f ) < 0.05f );
+	}
+
+	return 0;
+}
+
+#define MIXED_BODY_COUNT 240
+
+// A pile of every convex shape type on a chain and segment ground so all manifold functions are used.
+static void SimulateMixedPile( b2Transform* transforms, const b2WorldDef* worldDef )
+{
+	b2WorldId worldId = b2CreateWorld( worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Segment segment = { { -20.0f, 0.0f }, { 0.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	b2Vec2 points[4] = { { 20.0f, 0.0f }, { 20.0f, 30.0f }, { 0.0f, 30.0f }, { 0.0f, 0.0f } };
+	b2ChainDef chainDef = b2DefaultChainDef();
+	chainDef.points = points;
+	chainDef.count = 4;
+	chainDef.isLoop = true;
+	b2CreateChain( groundId, &chainDef );
+
+	b2Circle circle = { { 0.0f, 0.0f }, 0.3f };
+	b2Capsule capsule = { { -0.3f, 0.0f }, { 0.3f, 0.0f }, 0.2f };
+	b2Polygon box = b2MakeBox( 0.3f, 0.3f );
+	b2Polygon roundedBox = b2MakeRoundedBox( 0.2f, 0.2f, 0.1f );
+
+	bodyDef.type = b2_dynamicBody;
+	b2BodyId bodyIds[MIXED_BODY_COUNT];
+	for ( int i = 0; i < MIXED_BODY_COUNT; ++i )
+	{
+		bodyDef.position = ( b2Vec2 ){ -18.0f + 1.5f * ( i % 24 ), 1.0f + 1.0f * ( i / 24 ) };
+		bodyDef.rotation = b2MakeRot( 0.3f * i );
+		bodyIds[i] = b2CreateBody( worldId, &bodyDef );
+
+		switch ( i % 4 )
+		{
+			case 0:
+				b2CreateCircleShape( bodyIds[i], &shapeDef, &circle );
+				break;
+			case 1:
+				b2CreateCapsuleShape( bodyIds[i], &shapeDef, &capsule );
+				break;
+			case 2:
+				b2CreatePolygonShape( bodyIds[i], &shapeDef, &box );
+				break;
+			default:
+				b2CreatePolygonShape( bodyIds[i], &shapeDef, &roundedBox );
+				break;
+		}
+	}
+
+	for ( int i = 0; i < 90; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	for ( int i = 0; i < MIXED_BODY_COUNT; ++i )
+	{
+		transforms[i] = b2Body_GetTransform( bodyIds[i] );
+	}
+
+	b2DestroyWorld( worldId );
+}
+
+// Bucketing the narrow phase by shape pair type must not change the results.
+static int SortedCollideTest( void )
+{
+	b2Transform referenceTransforms[MIXED_BODY_COUNT];
+	b2Transform sortedTransforms[MIXED_BODY_COUNT];
+
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+	SimulateMixedPile( referenceTransforms, &worldDef );
+
+	worldDef.enableSortedCollide = true;
+	SimulateMixedPile( sortedTransforms, &worldDef );
+
+	for ( int i = 0; i < MIXED_BODY_COUNT; ++i )
+	{
+		ENSURE( b2IsValidVec2( sortedTransforms[i].p ) );
+		ENSURE( memcmp( referenceTransforms + i, sortedTransforms + i, sizeof( b2Transform ) ) == 0 );
+	}
+
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+	ENSURE( b2World_IsSortedCollideEnabled( worldId ) );
+
+	FallingHingeData data = CreateFallingHinges( worldId );
+	for ( int i = 0; i < 500; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		if ( UpdateFallingHinges( worldId, &data ) )
+		{
+			break;
+		}
+	}
+
+	b2DestroyWorld( worldId );
+
+	ENSURE( data.sleepStep == EXPECTED_SLEEP_STEP );
+	ENSURE( data.hash == EXPECTED_HASH );
+
+	DestroyFallingHinges( &data );
+
+	return 0;
+}
+
+// Colliding the existing contacts while the pairs are found must not change the results.
+static int PipelinedCollideTest( void )
+{
+	b2Transform referenceTransforms[MIXED_BODY_COUNT];
+	b2Transform pipelinedTransforms[MIXED_BODY_COUNT];
+
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+	SimulateMixedPile( referenceTransforms, &worldDef );
+
+	worldDef.enablePipelinedCollide = true;
+	SimulateMixedPile( pipelinedTransforms, &worldDef );
+
+	for ( int i = 0; i < MIXED_BODY_COUNT; ++i )
+	{
+		ENSURE( b2IsValidVec2( pipelinedTransforms[i].p ) );
+		ENSURE( memcmp( referenceTransforms + i, pipelinedTransforms + i, sizeof( b2Transform ) ) == 0 );
+	}
+
+	worldDef.broadPhaseType = b2_gridBroadPhase;
+	SimulateMixedPile( pipelinedTransforms, &worldDef );
+	worldDef.broadPhaseType = b2_treeBroadPhase;
+
+	for ( int i = 0; i < MIXED_BODY_COUNT; ++i )
+	{
+		ENSURE( memcmp( referenceTransforms + i, pipelinedTransforms + i, sizeof( b2Transform ) ) == 0 );
+	}
+
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+	ENSURE( b2World_IsPipelinedCollideEnabled( worldId ) );
+
+	FallingHingeData data = CreateFallingHinges( worldId );
+	for ( int i = 0; i < 500; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		if ( UpdateFallingHinges( worldId, &data ) )
+		{
+			break;
+		}
+	}
+
+	b2DestroyWorld( worldId );
+
+	ENSURE( data.sleepStep == EXPECTED_SLEEP_STEP );
+	ENSURE( data.hash == EXPECTED_HASH );
+
+	DestroyFallingHinges( &data );
+
+	return 0;
+}
+
+// Preparing the contact constraints in the narrow phase must not change the results.
+static int FusedPrepareTest( void )
+{
+	b2Transform referenceTransforms[MIXED_BODY_COUNT];
+	b2Transform fusedTransforms[MIXED_BODY_COUNT];
+
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+	SimulateMixedPile( referenceTransforms, &worldDef );
+
+	worldDef.enableFusedPrepare = true;
+	SimulateMixedPile( fusedTransforms, &worldDef );
+
+	for ( int i = 0; i < MIXED_BODY_COUNT; ++i )
+	{
+		ENSURE( b2IsValidVec2( fusedTransforms[i].p ) );
+		ENSURE( memcmp( referenceTransforms + i, fusedTransforms + i, sizeof( b2Transform ) ) == 0 );
+	}
+
+	// Also with the other narrow phase options
+	worldDef.enablePipelinedCollide = true;
+	worldDef.enableSortedCollide = true;
+	SimulateMixedPile( fusedTransforms, &worldDef );
+
+	for ( int i = 0; i < MIXED_BODY_COUNT; ++i )
+	{
+		ENSURE( memcmp( referenceTransforms + i, fusedTransforms + i, sizeof( b2Transform ) ) == 0 );
+	}
+
+	worldDef.enablePipelinedCollide = false;
+	worldDef.enableSortedCollide = false;
+
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+	ENSURE( b2World_IsFusedPrepareEnabled( worldId ) );
+
+	FallingHingeData data = CreateFallingHinges( worldId );
+	for ( int i = 0; i < 500; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		if ( UpdateFallingHinges( worldId, &data ) )
+		{
+			break;
+		}
+	}
+
+	b2DestroyWorld( worldId );
+
+	ENSURE( data.sleepStep == EXPECTED_SLEEP_STEP );
+	ENSURE( data.hash == EXPECTED_HASH );
+
+	DestroyFallingHinges( &data );
+
+	return 0;
+}
+
+#define HIT_BODY_COUNT 1600
+#define HIT_EVENT_CAPACITY 4096
+
+// A long row of balls lands on the ground in the same step, enough hit events to gather them in parallel
+static int SimulateHitRow( b2ContactHitEvent* events, int* maxStepCount, int workerCount )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = workerCount;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	shapeDef.enableHitEvents = true;
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2Segment segment = { { -10.0f, 0.0f }, { HIT_BODY_COUNT + 10.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	bodyDef.type = b2_dynamicBody;
+	b2Circle circle = { { 0.0f, 0.0f }, 0.25f };
+	for ( int i = 0; i < HIT_BODY_COUNT; ++i )
+	{
+		bodyDef.position = ( b2Vec2 ){ 1.0f * i, 2.0f };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2CreateCircleShape( bodyId, &shapeDef, &circle );
+	}
+
+	int eventCount = 0;
+	*maxStepCount = 0;
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+		b2ContactEvents contactEvents = b2World_GetContactEvents( worldId );
+		*maxStepCount = contactEvents.hitCount > *maxStepCount ? contactEvents.hitCount : *maxStepCount;
+		for ( int j = 0; j < contactEvents.hitCount && eventCount < HIT_EVENT_CAPACITY; ++j )
+		{
+			events[eventCount] = contactEvents.hitEvents[j];
+			eventCount += 1;
+		}
+	}
+
+	b2DestroyWorld( worldId );
+
+	return eventCount;
+}
+
+// Hit events are gathered in parallel when there are many, in the same order as the serial gather
+static int HitEventTest( void )
+{
+	static b2ContactHitEvent serialEvents[HIT_EVENT_CAPACITY];
+	static b2ContactHitEvent parallelEvents[HIT_EVENT_CAPACITY];
+
+	int serialMaxCount, parallelMaxCount;
+	int serialCount = SimulateHitRow( serialEvents, &serialMaxCount, 1 );
+	int parallelCount = SimulateHitRow( parallelEvents, &parallelMaxCount, 4 );
+
+	ENSURE( serialMaxCount >= 1024 );
+	ENSURE( serialCount == parallelCount );
+	ENSURE( serialMaxCount == parallelMaxCount );
+
+	for ( int i = 0; i < serialCount; ++i )
+	{
+		b2ContactHitEvent* a = serialEvents + i;
+		b2ContactHitEvent* b = parallelEvents + i;
+		ENSURE( a->shapeIdA.index1 == b->shapeIdA.index1 && a->shapeIdB.index1 == b->shapeIdB.index1 );
+		ENSURE( a->contactId.index1 == b->contactId.index1 && a->contactId.generation == b->contactId.generation );
+		ENSURE( a->approachSpeed == b->approachSpeed );
+		ENSURE( a->point.x == b->point.x && a->point.y == b->point.y );
+	}
+
+	return 0;
+}
+
+// Restoring a snapshot and stepping again gives the same result as the run that took it
+static int SnapshotTest( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	FallingHingeData data = CreateFallingHinges( worldId );
+
+	float timeStep = 1.0f / 60.0f;
+	int subStepCount = 4;
+	for ( int i = 0; i < 100; ++i )
+	{
+		b2World_Step( worldId, timeStep, subStepCount );
+		UpdateFallingHinges( worldId, &data );
+	}
+
+	int size = b2World_GetSnapshotSize( worldId );
+	ENSURE( size > 0 );
+
+	void* snapshot = malloc( size );
+	void* snapshot2 = malloc( size );
+	ENSURE( b2World_Snapshot( worldId, snapshot, size - 1 ) == 0 );
+	ENSURE( b2World_Snapshot( worldId, snapshot, size ) == size );
+
+	FallingHingeData savedData = data;
+
+	// Diverge from the snapshot, including structural changes
+	for ( int i = 0; i < 50; ++i )
+	{
+		b2World_Step( worldId, timeStep, subStepCount );
+		UpdateFallingHinges( worldId, &data );
+	}
+
+	b2BodyId destroyedId = data.bodyIds[data.bodyCount / 2];
+	b2DestroyBody( destroyedId );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+	b2BodyId extraId = b2CreateBody( worldId, &bodyDef );
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2CreatePolygonShape( extraId, &shapeDef, &box );
+	b2World_Step( worldId, timeStep, subStepCount );
+
+	ENSURE( b2World_Restore( worldId, snapshot, size - 1 ) == false );
+	ENSURE( b2World_Restore( worldId, snapshot, size ) );
+	ENSURE( b2Body_IsValid( destroyedId ) );
+
+	// The restored world writes the same snapshot
+	ENSURE( b2World_GetSnapshotSize( worldId ) == size );
+	ENSURE( b2World_Snapshot( worldId, snapshot2, size ) == size );
+	ENSURE( memcmp( snapshot, snapshot2, size ) == 0 );
+
+	data = savedData;
+	for ( int i = 100; i < 1000; ++i )
+	{
+		b2World_Step( worldId, timeStep, subStepCount );
+		if ( UpdateFallingHinges( worldId, &data ) )
+		{
+			break;
+		}
+	}
+
+	b2DestroyWorld( worldId );
+
+	// Restoring into a different world is rejected
+	b2WorldId otherWorldId = b2CreateWorld( &worldDef );
+	ENSURE( b2World_Restore( otherWorldId, snapshot, size ) == false );
+	b2DestroyWorld( otherWorldId );
+
+	free( snapshot );
+	free( snapshot2 );
+
+	ENSURE( data.sleepStep == EXPECTED_SLEEP_STEP );
+	ENSURE( data.hash == EXPECTED_HASH );
+
+	DestroyFallingHinges( &data );
+
+	return 0;
+}
+
+static int SnapshotDeltaTest( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	FallingHingeData data = CreateFallingHinges( worldId );
+
+	float timeStep = 1.0f / 60.0f;
+	int subStepCount = 4;
+	for ( int i = 0; i < 100; ++i )
+	{
+		b2World_Step( worldId, timeStep, subStepCount );
+		UpdateFallingHinges( worldId, &data );
+	}
+
+	// No key frame yet
+	ENSURE( b2World_GetSnapshotDeltaSize( worldId ) == 0 );
+
+	int baseSize = b2World_GetSnapshotSize( worldId );
+	void* base = malloc( baseSize );
+	ENSURE( b2World_Snapshot( worldId, base, baseSize ) == baseSize );
+
+	// A static body far away changes the static tree without touching the hinges
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.position = (b2Vec2){ 1000.0f, 0.0f };
+	b2BodyId staticId = b2CreateBody( worldId, &bodyDef );
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2CreatePolygonShape( staticId, &shapeDef, &box );
+
+	for ( int i = 0; i < 20; ++i )
+	{
+		b2World_Step( worldId, timeStep, subStepCount );
+		UpdateFallingHinges( worldId, &data );
+	}
+
+	int deltaSize = b2World_GetSnapshotDeltaSize( worldId );
+	ENSURE( deltaSize > 0 );
+	void* delta = malloc( deltaSize );
+	ENSURE( b2World_SnapshotDelta( worldId, delta, deltaSize - 1 ) == 0 );
+	ENSURE( b2World_SnapshotDelta( worldId, delta, deltaSize ) == deltaSize );
+	ENSURE( b2World_Restore( worldId, delta, deltaSize ) == false );
+
+	int size = b2World_GetSnapshotSize( worldId );
+	ENSURE( deltaSize < size );
+	void* snapshot = malloc( size );
+	void* snapshot2 = malloc( size );
+	ENSURE( b2World_Snapshot( worldId, snapshot, size ) == size );
+
+	FallingHingeData savedData = data;
+
+	// The full snapshot became the key frame, so the delta no longer applies
+	ENSURE( b2World_RestoreDelta( worldId, base, baseSize, delta, deltaSize ) == false );
+
+	ENSURE( b2World_Restore( worldId, base, baseSize ) );
+	ENSURE( b2Body_IsValid( staticId ) == false );
+
+	// Diverge from the delta, including structural changes
+	for ( int i = 0; i < 30; ++i )
+	{
+		b2World_Step( worldId, timeStep, subStepCount );
+	}
+
+	b2BodyId destroyedId = data.bodyIds[data.bodyCount / 2];
+	b2DestroyBody( destroyedId );
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position = b2Vec2_zero;
+	b2BodyId extraId = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( extraId, &shapeDef, &box );
+	b2World_Step( worldId, timeStep, subStepCount );
+
+	ENSURE( b2World_RestoreDelta( worldId, base, baseSize, base, baseSize ) == false );
+	ENSURE( b2World_RestoreDelta( worldId, base, baseSize, delta, deltaSize - 1 ) == false );
+	ENSURE( b2World_RestoreDelta( worldId, base, baseSize, delta, deltaSize ) );
+	ENSURE( b2Body_IsValid( destroyedId ) );
+	ENSURE( b2Body_IsValid( staticId ) );
+
+	// The world matches the state the delta was taken from
+	ENSURE( b2World_GetSnapshotSize( worldId ) == size );
+	ENSURE( b2World_Snapshot( worldId, snapshot2, size ) == size );
+	ENSURE( memcmp( snapshot, snapshot2, size ) == 0 );
+
+	data = savedData;
+	for ( int i = 120; i < 1000; ++i )
+	{
+		b2World_Step( worldId, timeStep, subStepCount );
+		if ( UpdateFallingHinges( worldId, &data ) )
+		{
+			break;
+		}
+	}
+
+	b2DestroyWorld( worldId );
+
+	free( base );
+	free( delta );
+	free( snapshot );
+	free( snapshot2 );
+
+	ENSURE( data.sleepStep == EXPECTED_SLEEP_STEP );
+	ENSURE( data.hash == EXPECTED_HASH );
+
+	DestroyFallingHinges( &data );
+
+	return 0;
+}
+
+// A clone simulates the same as the world it was copied from
+static int CloneTest( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	FallingHingeData data = CreateFallingHinges( worldId );
+
+	float timeStep = 1.0f / 60.0f;
+	int subStepCount = 4;
+	for ( int i = 0; i < 100; ++i )
+	{
+		b2World_Step( worldId, timeStep, subStepCount );
+		UpdateFallingHinges( worldId, &data );
+	}
+
+	b2WorldId cloneId = b2World_Clone( worldId );
+	ENSURE( B2_IS_NON_NULL( cloneId ) );
+	ENSURE( b2World_GetWorkerCount( cloneId ) == 4 );
+
+	// The clone uses the same ids in its own world
+	FallingHingeData cloneData = data;
+	cloneData.bodyIds = malloc( data.bodyCount * sizeof( b2BodyId ) );
+	for ( int i = 0; i < data.bodyCount; ++i )
+	{
+		cloneData.bodyIds[i] = data.bodyIds[i];
+		cloneData.bodyIds[i].world0 = (uint16_t)( cloneId.index1 - 1 );
+	}
+
+	// Destroying part of the original leaves the clone alone
+	b2DestroyBody( data.bodyIds[0] );
+	ENSURE( b2Body_IsValid( cloneData.bodyIds[0] ) );
+
+	b2Counters counters = b2World_GetCounters( cloneId );
+	ENSURE( counters.bodyCount == data.bodyCount + 1 );
+
+	for ( int i = 100; i < 1000; ++i )
+	{
+		b2World_Step( cloneId, timeStep, subStepCount );
+		if ( UpdateFallingHinges( cloneId, &cloneData ) )
+		{
+			break;
+		}
+	}
+
+	b2DestroyWorld( cloneId );
+	b2DestroyWorld( worldId );
+
+	ENSURE( cloneData.sleepStep == EXPECTED_SLEEP_STEP );
+	ENSURE( cloneData.hash == EXPECTED_HASH );
+
+	DestroyFallingHinges( &data );
+	DestroyFallingHinges( &cloneData );
+
+	return 0;
+}
+
+// The state hash is the same for any worker count and changes as the world moves
+static int StateHashTest( void )
+{
+	uint32_t expectedHashes[2] = { 0 };
+	uint32_t expectedContactHashes[2] = { 0 };
+
+	for ( int workerCount = 1; workerCount <= 7; workerCount += 3 )
+	{
+		b2WorldDef worldDef = b2DefaultWorldDef();
+		worldDef.workerCount = workerCount;
+
+		b2WorldId worldId = b2CreateWorld( &worldDef );
+
+		FallingHingeData data = CreateFallingHinges( worldId );
+
+		uint32_t hashes[2], contactHashes[2];
+		for ( int i = 0; i < 150; ++i )
+		{
+			b2World_Step( worldId, 1.0f / 60.0f, 4 );
+			UpdateFallingHinges( worldId, &data );
+
+			if ( i == 148 || i == 149 )
+			{
+				hashes[i - 148] = b2World_ComputeStateHash( worldId, false );
+				contactHashes[i - 148] = b2World_ComputeStateHash( worldId, true );
+			}
+		}
+
+		b2DestroyWorld( worldId );
+		DestroyFallingHinges( &data );
+
+		ENSURE( hashes[0] != hashes[1] );
+		ENSURE( hashes[1] != contactHashes[1] );
+
+		if ( workerCount == 1 )
+		{
+			memcpy( expectedHashes, hashes, sizeof( hashes ) );
+			memcpy( expectedContactHashes, contactHashes, sizeof( contactHashes ) );
+		}
+		else
+		{
+			ENSURE( memcmp( expectedHashes, hashes, sizeof( hashes ) ) == 0 );
+			ENSURE( memcmp( expectedContactHashes, contactHashes, sizeof( contactHashes ) ) == 0 );
+		}
+	}
+
+	return 0;
+}
+
+// Drives a scene through the recorded calls while it steps
+static void UpdateRecordedScene( b2WorldId worldId, b2BodyId* bodyIds, int bodyCount, int stepIndex )
+{
+	b2BodyId bodyId = bodyIds[stepIndex % bodyCount];
+
+	switch ( stepIndex % 8 )
+	{
+		case 0:
+			b2Body_ApplyForceToCenter( bodyId, (b2Vec2){ 50.0f, 200.0f }, true );
+			break;
+		case 1:
+			b2Body_ApplyLinearImpulse( bodyId, (b2Vec2){ -1.0f, 2.0f }, b2Body_GetPosition( bodyId ), true );
+			break;
+		case 2:
+			b2Body_SetAngularVelocity( bodyId, 3.0f );
+			break;
+		case 3:
+		{
+			b2BodyCommand command = { bodyId, { 0.0f, 5.0f }, b2Vec2_zero, b2_bodyLinearVelocity, true };
+			b2World_QueueBodyCommands( worldId, 0, &command, 1 );
+		}
+		break;
+		case 4:
+			b2Body_SetTransform( bodyId, (b2Vec2){ 0.0f, 10.0f }, b2MakeRot( 0.5f ) );
+			break;
+		case 5:
+			b2Body_ApplyTorque( bodyId, 20.0f, true );
+			break;
+		case 6:
+			b2World_SetGravity( worldId, (b2Vec2){ 0.0f, stepIndex % 16 < 8 ? -10.0f : -5.0f } );
+			break;
+		default:
+			break;
+	}
+}
+
+// A replay of a recording creates the same objects and reaches the same state on every step
+static int RecordingTest( void )
+{
+	enum
+	{
+		e_bodyCount = 8,
+		e_stepCount = 120,
+	};
+
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 2;
+	worldDef.enableRecording = true;
+
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Polygon box = b2MakeBox( 20.0f, 1.0f );
+	b2Polygon tilePolygons[2] = { b2MakeOffsetBox( 5.0f, 1.0f, (b2Vec2){ -30.0f, 0.0f }, b2Rot_identity ),
+								  b2MakeOffsetBox( 5.0f, 1.0f, (b2Vec2){ 30.0f, 0.0f }, b2Rot_identity ) };
+	b2StaticTile tile = b2MakeStaticTile( &bodyDef, &shapeDef, tilePolygons, 2 );
+	b2CreateTileBody( worldId, &tile );
+	b2DestroyStaticTile( &tile );
+
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( groundId, &shapeDef, &box );
+
+	b2BodyId bodyIds[e_bodyCount];
+	bodyDef.type = b2_dynamicBody;
+	box = b2MakeBox( 0.5f, 0.5f );
+	for ( int i = 0; i < e_bodyCount; ++i )
+	{
+		bodyDef.position = (b2Vec2){ -7.0f + 2.0f * i, 2.0f + i };
+		bodyIds[i] = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyIds[i], &shapeDef, &box );
+	}
+
+	b2RevoluteJointDef jointDef = b2DefaultRevoluteJointDef();
+	jointDef.base.bodyIdA = bodyIds[0];
+	jointDef.base.bodyIdB = bodyIds[1];
+	jointDef.base.localFrameA.p = (b2Vec2){ 1.0f, 0.0f };
+	jointDef.base.localFrameB.p = (b2Vec2){ -1.0f, 0.0f };
+	b2JointId jointId = b2CreateRevoluteJoint( worldId, &jointDef );
+
+	// Instanced crates sharing one compound are recorded with its polygon
+	b2Polygon crate = b2MakeBox( 0.4f, 0.4f );
+	b2Compound* sharedCrate = b2CreateCompound( &crate, 1 );
+	for ( int i = 0; i < 2; ++i )
+	{
+		bodyDef.position = (b2Vec2){ 10.0f + 1.0f * i, 4.0f };
+		b2BodyId crateId = b2CreateBody( worldId, &bodyDef );
+		b2CreateCompoundShape( crateId, &shapeDef, sharedCrate );
+	}
+
+	uint32_t hashes[e_stepCount];
+	for ( int i = 0; i < e_stepCount; ++i )
+	{
+		UpdateRecordedScene( worldId, bodyIds, e_bodyCount, i );
+
+		if ( i == 40 )
+		{
+			b2DestroyJoint( jointId, true );
+		}
+		else if ( i == 60 )
+		{
+			b2DestroyBody( bodyIds[e_bodyCount - 1] );
+			bodyDef.position = (b2Vec2){ 0.0f, 15.0f };
+			bodyIds[e_bodyCount - 1] = b2CreateBody( worldId, &bodyDef );
+			b2Circle circle = { b2Vec2_zero, 0.5f };
+			b2CreateCircleShape( bodyIds[e_bodyCount - 1], &shapeDef, &circle );
+		}
+
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		hashes[i] = b2World_ComputeStateHash( worldId, true );
+	}
+
+	int size = b2World_GetRecordingSize( worldId );
+	ENSURE( size > 0 );
+
+	void* recording = malloc( size );
+	ENSURE( b2World_GetRecording( worldId, recording, size - 1 ) == 0 );
+	ENSURE( b2World_GetRecording( worldId, recording, size ) == size );
+	b2DestroyWorld( worldId );
+	b2DestroyCompound( sharedCrate );
+
+	// The worker count comes from the replay definition
+	worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 3;
+	b2WorldId replayId = b2CreateReplayWorld( recording, size, &worldDef );
+	ENSURE( B2_IS_NON_NULL( replayId ) );
+	ENSURE( b2World_GetWorkerCount( replayId ) == 3 );
+
+	for ( int i = 0; i < e_stepCount; ++i )
+	{
+		ENSURE( b2World_ReplayStep( replayId ) );
+		ENSURE( b2World_ComputeStateHash( replayId, true ) == hashes[i] );
+	}
+
+	ENSURE( b2World_ReplayStep( replayId ) == false );
+	b2DestroyWorld( replayId );
+
+	// A damaged header is rejected
+	( (uint8_t*)recording )[0] ^= 0xFF;
+	ENSURE( B2_IS_NULL( b2CreateReplayWorld( recording, size, &worldDef ) ) );
+	ENSURE( B2_IS_NULL( b2CreateReplayWorld( recording, 8, &worldDef ) ) );
+
+	free( recording );
+	return 0;
+}
+
 int DeterminismTest( void )
 {
 	RUN_SUBTEST( MultithreadingTest );
 	RUN_SUBTEST( BuiltInSchedulerTest );
+	RUN_SUBTEST( ParallelContactsTest );
+	RUN_SUBTEST( GridBroadPhaseTest );
+	RUN_SUBTEST( AsyncStepTest );
+	RUN_SUBTEST( StepWorldsTest );
 	RUN_SUBTEST( CrossPlatformTest );
+	RUN_SUBTEST( WideJointTest );
+	RUN_SUBTEST( OverflowTest );
+	RUN_SUBTEST( ContinuousTest );
+	RUN_SUBTEST( AdaptiveColoringTest );
+	RUN_SUBTEST( SortedCollideTest );
+	RUN_SUBTEST( PipelinedCollideTest );
+	RUN_SUBTEST( FusedPrepareTest );
+	RUN_SUBTEST( HitEventTest );
+	RUN_SUBTEST( SnapshotTest );
+	RUN_SUBTEST( SnapshotDeltaTest );
+	RUN_SUBTEST( CloneTest );
+	RUN_SUBTEST( StateHashTest );
+	RUN_SUBTEST( RecordingTest );
 
 	return 0;
 }
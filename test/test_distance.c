@@ -7,6 +7,8 @@
 #include "box2d/math_functions.h"
 
 #include <float.h>
+#include <math.h>
+#include <string.h>
 
 static int SegmentDistanceTest( void )
 {
@@ -101,12 +103,141 @@ static int TimeOfImpactTest( void )
 	return 0;
 }
 
+static int TimeOfImpactCachedTest( void )
+{
+	b2Vec2 vas[] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+
+	b2Vec2 vbs[] = {
+		{ 2.0f, -1.0f },
+		{ 2.0f, 1.0f },
+	};
+
+	b2TOIInput input;
+	input.proxyA = b2MakeProxy( vas, ARRAY_COUNT( vas ), 0.0f );
+	input.proxyB = b2MakeProxy( vbs, ARRAY_COUNT( vbs ), 0.0f );
+	input.sweepA = ( b2Sweep ){ b2Vec2_zero, b2Vec2_zero, b2Vec2_zero, b2Rot_identity, b2Rot_identity };
+	input.sweepB = ( b2Sweep ){ b2Vec2_zero, b2Vec2_zero, ( b2Vec2 ){ -2.0f, 0.0f }, b2Rot_identity, b2Rot_identity };
+	input.maxFraction = 1.0f;
+
+	// An empty cache gives the uncached result and receives the simplex of the hit
+	b2SimplexCache cache = { 0 };
+	b2TOIOutput output = b2TimeOfImpactCached( &input, &cache );
+	b2TOIOutput reference = b2TimeOfImpact( &input );
+
+	ENSURE( output.state == b2_toiStateHit );
+	ENSURE( output.fraction == reference.fraction );
+	ENSURE( cache.count > 0 );
+
+	// The next sweep starts from the cached features
+	input.sweepB.c1 = ( b2Vec2 ){ 0.1f, 0.0f };
+	b2SimplexCache warmCache = cache;
+	output = b2TimeOfImpactCached( &input, &warmCache );
+	ENSURE( output.state == b2_toiStateHit );
+	ENSURE_SMALL( output.fraction - 1.1f / 2.1f, 0.005f );
+
+	// A cache of a different pair of shapes is ignored
+	b2SimplexCache invalidCache = { 3, { 7, 7, 7 }, { 7, 7, 7 } };
+	reference = b2TimeOfImpact( &input );
+	output = b2TimeOfImpactCached( &input, &invalidCache );
+	ENSURE( output.fraction == reference.fraction );
+
+	// Far apart shapes take the conservative advancement early out
+	input.sweepB.c1 = ( b2Vec2 ){ 10.0f, 0.0f };
+	input.sweepB.c2 = ( b2Vec2 ){ 9.0f, 0.0f };
+	output = b2TimeOfImpact( &input );
+	ENSURE( output.state == b2_toiStateSeparated );
+	ENSURE( output.fraction == 1.0f );
+
+	return 0;
+}
+
+static int DistanceBatchTest( void )
+{
+	// Shapes of a range of vertex counts
+	b2Polygon polygons[] = {
+		b2MakeBox( 0.5f, 0.5f ),
+		b2MakeOffsetRoundedBox( 1.0f, 0.25f, ( b2Vec2 ){ 0.5f, 0.0f }, b2MakeRot( 0.3f ), 0.1f ),
+		b2MakeSquare( 0.25f ),
+	};
+
+	b2Vec2 triangle[] = { { -0.5f, 0.0f }, { 0.5f, 0.0f }, { 0.0f, 0.75f } };
+	b2Hull hull = b2ComputeHull( triangle, 3 );
+	b2Polygon wedge = b2MakePolygon( &hull, 0.05f );
+
+	b2Vec2 segment[] = { { -1.0f, 0.0f }, { 1.0f, 0.0f } };
+	b2Vec2 point[] = { { 0.0f, 0.25f } };
+
+	b2ShapeProxy proxies[6];
+	for ( int i = 0; i < 3; ++i )
+	{
+		proxies[i] = b2MakeProxy( polygons[i].vertices, polygons[i].count, polygons[i].radius );
+	}
+	proxies[3] = b2MakeProxy( wedge.vertices, wedge.count, wedge.radius );
+	proxies[4] = b2MakeProxy( segment, 2, 0.0f );
+	proxies[5] = b2MakeProxy( point, 1, 0.5f );
+
+	// An odd count exercises the partial group. Some pairs overlap.
+	enum
+	{
+		e_count = 67
+	};
+
+	b2DistanceInput inputs[e_count];
+	b2SimplexCache caches[e_count];
+	b2SimplexCache referenceCaches[e_count];
+	b2DistanceOutput outputs[e_count];
+
+	for ( int i = 0; i < e_count; ++i )
+	{
+		b2DistanceInput* input = inputs + i;
+		input->proxyA = proxies[i % 6];
+		input->proxyB = proxies[( i / 6 ) % 6];
+
+		float angle = 0.37f * i;
+		float radius = 0.1f + 0.05f * ( i % 50 );
+		input->transformA = ( b2Transform ){ { 0.1f * i, -0.2f }, b2MakeRot( -0.19f * i ) };
+		input->transformB = ( b2Transform ){ { 0.1f * i + radius * cosf( angle ), radius * sinf( angle ) }, b2MakeRot( angle ) };
+		input->useRadii = ( i % 3 ) != 0;
+		caches[i] = ( b2SimplexCache ){ 0 };
+	}
+
+	// Cold start, then warm start from the caches of the previous pass with slightly moved shapes
+	for ( int pass = 0; pass < 2; ++pass )
+	{
+		for ( int i = 0; i < e_count; ++i )
+		{
+			referenceCaches[i] = caches[i];
+		}
+
+		b2ShapeDistanceBatch( inputs, caches, outputs, e_count );
+
+		for ( int i = 0; i < e_count; ++i )
+		{
+			b2DistanceOutput reference = b2ShapeDistance( inputs + i, referenceCaches + i, NULL, 0 );
+			reference.simplexCount = 0;
+
+			ENSURE( memcmp( &reference, outputs + i, sizeof( b2DistanceOutput ) ) == 0 );
+			ENSURE( memcmp( referenceCaches + i, caches + i, sizeof( b2SimplexCache ) ) == 0 );
+		}
+
+		for ( int i = 0; i < e_count; ++i )
+		{
+			inputs[i].transformB.p = b2MulAdd( inputs[i].transformB.p, 0.01f, ( b2Vec2 ){ 1.0f, 0.5f } );
+			inputs[i].transformB.q = b2IntegrateRotation( inputs[i].transformB.q, 0.02f );
+		}
+	}
+
+	return 0;
+}
+
 int DistanceTest( void )
 {
 	RUN_SUBTEST( SegmentDistanceTest );
 	RUN_SUBTEST( ShapeDistanceTest );
 	RUN_SUBTEST( ShapeCastTest );
 	RUN_SUBTEST( TimeOfImpactTest );
+	RUN_SUBTEST( TimeOfImpactCachedTest );
+	RUN_SUBTEST( DistanceBatchTest );
 
 	return 0;
 }
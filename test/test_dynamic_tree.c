@@ -1,10 +1,13 @@
 // SPDX-FileCopyrightText: 2025 Erin Catto
 // SPDX-License-Identifier: MIT
 
+#include "aabb.h"
 #include "test_macros.h"
 
 #include "box2d/collision.h"
 
+#include <string.h>
+
 static int TreeCreateDestroy( void )
 {
 	b2AABB a = {
@@ -446,6 +449,495 @@ static int TreeGridMovementTest( void )
 	return 0;
 }
 
+// Incremental optimization must improve a degraded tree without changing query results
+static int TreeOptimizeTest( void )
+{
+	b2DynamicTree tree = b2DynamicTree_Create( 16 );
+
+	int proxyIds[GRID_COUNT * GRID_COUNT];
+	b2AABB boxes[GRID_COUNT * GRID_COUNT];
+	for ( int i = 0; i < GRID_COUNT * GRID_COUNT; ++i )
+	{
+		float x = 1.0f * ( i % GRID_COUNT );
+		float y = 1.0f * ( i / GRID_COUNT );
+		boxes[i] = ( b2AABB ){ { x, y }, { x + 0.8f, y + 0.8f } };
+		proxyIds[i] = b2DynamicTree_CreateProxy( &tree, boxes[i], 1, (uint64_t)i );
+	}
+
+	b2DynamicTree_Rebuild( &tree, true );
+
+	// Scramble the proxies around the grid. Reinsertion makes a poor tree.
+	for ( int i = 0; i < GRID_COUNT * GRID_COUNT; ++i )
+	{
+		int j = ( 37 * i + 11 ) % ( GRID_COUNT * GRID_COUNT );
+		float x = 1.0f * ( j % GRID_COUNT ) + 0.1f;
+		float y = 1.0f * ( j / GRID_COUNT ) + 0.1f;
+		boxes[i] = ( b2AABB ){ { x, y }, { x + 0.8f, y + 0.8f } };
+		b2DynamicTree_MoveProxy( &tree, proxyIds[i], boxes[i] );
+	}
+
+	float ratio1 = b2DynamicTree_GetAreaRatio( &tree );
+
+	int leafBudget = 64;
+	for ( int i = 0; i < 100; ++i )
+	{
+		int leafCount = b2DynamicTree_Optimize( &tree, leafBudget );
+		ENSURE( leafCount <= leafBudget );
+		b2DynamicTree_Validate( &tree );
+	}
+
+	float ratio2 = b2DynamicTree_GetAreaRatio( &tree );
+	ENSURE( ratio2 < ratio1 );
+
+	b2AABB queryBox = { { 3.5f, 4.5f }, { 12.5f, 9.5f } };
+	int queryList[GRID_COUNT * GRID_COUNT + 1] = { 0 };
+	b2DynamicTree_Query( &tree, queryBox, 1, QueryCollectListCallback, queryList );
+
+	int expectedCount = 0;
+	for ( int i = 0; i < GRID_COUNT * GRID_COUNT; ++i )
+	{
+		expectedCount += b2AABB_Overlaps( boxes[i], queryBox ) ? 1 : 0;
+	}
+
+	ENSURE( expectedCount > 0 );
+	ENSURE( queryList[0] == expectedCount );
+
+	b2DynamicTree_Destroy( &tree );
+	return 0;
+}
+
+// Bulk creation both as an inserted subtree and as a full rebuild
+static int TreeCreateProxiesTest( void )
+{
+	b2DynamicTree tree = b2DynamicTree_Create( 16 );
+
+	int proxyCount = GRID_COUNT * GRID_COUNT;
+	int proxyIds[GRID_COUNT * GRID_COUNT];
+	b2AABB boxes[GRID_COUNT * GRID_COUNT];
+	uint64_t categoryBits[GRID_COUNT * GRID_COUNT];
+	uint64_t userData[GRID_COUNT * GRID_COUNT];
+	for ( int i = 0; i < proxyCount; ++i )
+	{
+		float x = 1.0f * ( i % GRID_COUNT );
+		float y = 1.0f * ( i / GRID_COUNT );
+		boxes[i] = ( b2AABB ){ { x, y }, { x + 0.8f, y + 0.8f } };
+		categoryBits[i] = ( i % 3 ) == 0 ? 2 : 1;
+		userData[i] = (uint64_t)i;
+	}
+
+	// A few single proxies, then a large batch that rebuilds, then a small batch that is inserted
+	int firstCount = 10;
+	for ( int i = 0; i < firstCount; ++i )
+	{
+		proxyIds[i] = b2DynamicTree_CreateProxy( &tree, boxes[i], categoryBits[i], userData[i] );
+	}
+
+	int secondCount = 300;
+	b2DynamicTree_CreateProxies( &tree, boxes + firstCount, categoryBits + firstCount, userData + firstCount, secondCount,
+								 proxyIds + firstCount );
+	b2DynamicTree_Validate( &tree );
+	ENSURE( b2DynamicTree_GetProxyCount( &tree ) == firstCount + secondCount );
+
+	int thirdStart = firstCount + secondCount;
+	b2DynamicTree_CreateProxies( &tree, boxes + thirdStart, categoryBits + thirdStart, userData + thirdStart,
+								 proxyCount - thirdStart, proxyIds + thirdStart );
+	b2DynamicTree_Validate( &tree );
+	ENSURE( b2DynamicTree_GetProxyCount( &tree ) == proxyCount );
+
+	for ( int i = 0; i < proxyCount; ++i )
+	{
+		ENSURE( b2DynamicTree_GetUserData( &tree, proxyIds[i] ) == userData[i] );
+		b2AABB fatBox = b2DynamicTree_GetAABB( &tree, proxyIds[i] );
+		ENSURE( fatBox.lowerBound.x == boxes[i].lowerBound.x && fatBox.upperBound.y == boxes[i].upperBound.y );
+	}
+
+	b2AABB queryBox = { { 3.5f, 4.5f }, { 12.5f, 19.5f } };
+	int queryList[GRID_COUNT * GRID_COUNT + 1] = { 0 };
+	b2DynamicTree_Query( &tree, queryBox, 2, QueryCollectListCallback, queryList );
+
+	int expectedCount = 0;
+	for ( int i = 0; i < proxyCount; ++i )
+	{
+		expectedCount += b2AABB_Overlaps( boxes[i], queryBox ) && categoryBits[i] == 2 ? 1 : 0;
+	}
+
+	ENSURE( expectedCount > 0 );
+	ENSURE( queryList[0] == expectedCount );
+
+	// The bulk build is close to a full rebuild
+	b2DynamicTree referenceTree = b2DynamicTree_Create( 16 );
+	for ( int i = 0; i < proxyCount; ++i )
+	{
+		b2DynamicTree_CreateProxy( &referenceTree, boxes[i], categoryBits[i], userData[i] );
+	}
+
+	b2DynamicTree_Rebuild( &referenceTree, true );
+	float ratio = b2DynamicTree_GetAreaRatio( &tree );
+	float referenceRatio = b2DynamicTree_GetAreaRatio( &referenceTree );
+	ENSURE( ratio < 1.25f * referenceRatio );
+
+	b2DynamicTree_Destroy( &referenceTree );
+	b2DynamicTree_Destroy( &tree );
+	return 0;
+}
+
+// Bulk destruction both by removal and by rebuild
+static int TreeDestroyProxiesTest( void )
+{
+	b2DynamicTree tree = b2DynamicTree_Create( 16 );
+
+	int proxyCount = GRID_COUNT * GRID_COUNT;
+	int proxyIds[GRID_COUNT * GRID_COUNT];
+	b2AABB boxes[GRID_COUNT * GRID_COUNT];
+	for ( int i = 0; i < proxyCount; ++i )
+	{
+		float x = 1.0f * ( i % GRID_COUNT );
+		float y = 1.0f * ( i / GRID_COUNT );
+		boxes[i] = ( b2AABB ){ { x, y }, { x + 0.8f, y + 0.8f } };
+		proxyIds[i] = b2DynamicTree_CreateProxy( &tree, boxes[i], 1, (uint64_t)i );
+	}
+
+	// A small batch is removed, a large batch rebuilds
+	int doomedIds[GRID_COUNT * GRID_COUNT];
+	bool alive[GRID_COUNT * GRID_COUNT];
+	for ( int i = 0; i < proxyCount; ++i )
+	{
+		alive[i] = true;
+	}
+
+	for ( int pass = 0; pass < 2; ++pass )
+	{
+		int doomedCount = 0;
+		for ( int i = 0; i < proxyCount; ++i )
+		{
+			bool doomed = pass == 0 ? ( i % 17 ) == 0 : ( i % 3 ) != 0;
+			if ( doomed && alive[i] )
+			{
+				doomedIds[doomedCount++] = proxyIds[i];
+				alive[i] = false;
+			}
+		}
+
+		int expectedProxyCount = b2DynamicTree_GetProxyCount( &tree ) - doomedCount;
+		b2DynamicTree_DestroyProxies( &tree, doomedIds, doomedCount );
+		b2DynamicTree_Validate( &tree );
+		ENSURE( b2DynamicTree_GetProxyCount( &tree ) == expectedProxyCount );
+
+		b2AABB queryBox = { { 3.5f, 4.5f }, { 12.5f, 19.5f } };
+		int queryList[GRID_COUNT * GRID_COUNT + 1] = { 0 };
+		b2DynamicTree_Query( &tree, queryBox, 1, QueryCollectListCallback, queryList );
+
+		int expectedCount = 0;
+		for ( int i = 0; i < proxyCount; ++i )
+		{
+			expectedCount += alive[i] && b2AABB_Overlaps( boxes[i], queryBox ) ? 1 : 0;
+		}
+
+		ENSURE( expectedCount > 0 );
+		ENSURE( queryList[0] == expectedCount );
+	}
+
+	// Destroy the rest
+	int doomedCount = 0;
+	for ( int i = 0; i < proxyCount; ++i )
+	{
+		if ( alive[i] )
+		{
+			doomedIds[doomedCount++] = proxyIds[i];
+		}
+	}
+
+	b2DynamicTree_DestroyProxies( &tree, doomedIds, doomedCount );
+	ENSURE( b2DynamicTree_GetProxyCount( &tree ) == 0 );
+	ENSURE( b2DynamicTree_GetHeight( &tree ) == 0 );
+
+	b2DynamicTree_Destroy( &tree );
+	return 0;
+}
+
+#define GRAFT_COUNT 40
+
+// A grafted tree keeps its structure and comes out again as one subtree
+static int TreeGraftTest( void )
+{
+	b2DynamicTree tree = b2DynamicTree_Create( 16 );
+	int proxyCount = GRID_COUNT * GRID_COUNT;
+	for ( int i = 0; i < proxyCount; ++i )
+	{
+		float x = 1.0f * ( i % GRID_COUNT );
+		float y = 1.0f * ( i / GRID_COUNT );
+		b2AABB box = { { x, y }, { x + 0.8f, y + 0.8f } };
+		b2DynamicTree_CreateProxy( &tree, box, 1, (uint64_t)i );
+	}
+
+	int baseNodeCount = tree.nodeCount;
+
+	// The source user data is the proxy index
+	b2DynamicTree source = b2DynamicTree_Create( 16 );
+	for ( int i = 0; i < GRAFT_COUNT; ++i )
+	{
+		float x = 100.0f + 1.0f * i;
+		b2AABB box = { { x, 0.0f }, { x + 0.8f, 0.8f } };
+		b2DynamicTree_CreateProxy( &source, box, 1, (uint64_t)i );
+	}
+
+	uint64_t userData[GRAFT_COUNT];
+	int proxyIds[GRAFT_COUNT];
+	for ( int i = 0; i < GRAFT_COUNT; ++i )
+	{
+		userData[i] = 1000 + i;
+	}
+
+	for ( int pass = 0; pass < 2; ++pass )
+	{
+		b2DynamicTree_Graft( &tree, &source, userData, proxyIds );
+		b2DynamicTree_Validate( &tree );
+		ENSURE( b2DynamicTree_GetProxyCount( &tree ) == proxyCount + GRAFT_COUNT );
+		ENSURE( tree.nodeCount == baseNodeCount + source.nodeCount + 1 );
+
+		for ( int i = 0; i < GRAFT_COUNT; ++i )
+		{
+			ENSURE( b2DynamicTree_GetUserData( &tree, proxyIds[i] ) == userData[i] );
+		}
+
+		b2AABB queryBox = { { 99.0f, -1.0f }, { 200.0f, 1.0f } };
+		int queryList[GRID_COUNT * GRID_COUNT + GRAFT_COUNT + 1] = { 0 };
+		b2DynamicTree_Query( &tree, queryBox, 1, QueryCollectListCallback, queryList );
+		ENSURE( queryList[0] == GRAFT_COUNT );
+
+		// The grafted subtree is detached whole, so no other internal nodes change
+		b2DynamicTree_DestroyProxies( &tree, proxyIds, GRAFT_COUNT );
+		b2DynamicTree_Validate( &tree );
+		ENSURE( b2DynamicTree_GetProxyCount( &tree ) == proxyCount );
+		ENSURE( tree.nodeCount == baseNodeCount );
+	}
+
+	b2DynamicTree_Destroy( &source );
+	b2DynamicTree_Destroy( &tree );
+	return 0;
+}
+
+#define LAYOUT_PROXY_COUNT 300
+
+typedef struct LayoutQueryList
+{
+	const b2DynamicTree* tree;
+	int count;
+	int ids[LAYOUT_PROXY_COUNT];
+} LayoutQueryList;
+
+static bool LayoutQueryCallback( int proxyId, uint64_t userData, void* context )
+{
+	LayoutQueryList* list = context;
+	if ( b2DynamicTree_GetUserData( list->tree, proxyId ) != userData || list->count == LAYOUT_PROXY_COUNT )
+	{
+		return false;
+	}
+
+	list->ids[list->count++] = proxyId;
+	return true;
+}
+
+typedef struct LayoutRayResult
+{
+	const b2DynamicTree* tree;
+	int proxyId;
+	float fraction;
+} LayoutRayResult;
+
+static float LayoutRayCastCallback( const b2RayCastInput* input, int proxyId, uint64_t userData, void* context )
+{
+	(void)userData;
+	LayoutRayResult* result = context;
+	b2AABB box = b2DynamicTree_GetAABB( result->tree, proxyId );
+	b2Vec2 p2 = b2MulAdd( input->origin, input->maxFraction, input->translation );
+	b2CastOutput output = b2AABB_RayCast( box, input->origin, p2 );
+	if ( output.hit == false )
+	{
+		return -1.0f;
+	}
+
+	float fraction = output.fraction * input->maxFraction;
+	if ( fraction < result->fraction )
+	{
+		result->fraction = fraction;
+		result->proxyId = proxyId;
+	}
+
+	return fraction;
+}
+
+// The wide and quantized layouts must report the same proxies in the same order as the binary tree
+static int CheckQueryLayout( b2Vec2 origin, bool quantized )
+{
+	b2DynamicTree tree = b2DynamicTree_Create( 16 );
+
+	uint32_t seed = 12345;
+	for ( int i = 0; i < LAYOUT_PROXY_COUNT; ++i )
+	{
+		seed = 1664525u * seed + 1013904223u;
+		float x = (float)( seed >> 8 & 0xFFF ) / 40.0f;
+		seed = 1664525u * seed + 1013904223u;
+		float y = (float)( seed >> 8 & 0xFFF ) / 40.0f;
+		float w = 0.2f + (float)( seed & 0xF ) / 8.0f;
+		b2AABB a = { .lowerBound = { origin.x + x, origin.y + y }, .upperBound = { origin.x + x + w, origin.y + y + 0.5f * w } };
+		b2DynamicTree_CreateProxy( &tree, a, 1ull << ( i % 3 ), 1000 + i );
+	}
+
+	ENSURE( tree.wideNodeCount == 0 );
+
+	b2AABB queries[3] = {
+		{ { 10.0f, 10.0f }, { 40.0f, 30.0f } },
+		{ { -10.0f, -10.0f }, { 200.0f, 200.0f } },
+		{ { 50.0f, 50.0f }, { 50.5f, 50.5f } },
+	};
+	uint64_t masks[2] = { 0x3ull, UINT64_MAX };
+
+	for ( int i = 0; i < 3; ++i )
+	{
+		queries[i].lowerBound = b2Add( queries[i].lowerBound, origin );
+		queries[i].upperBound = b2Add( queries[i].upperBound, origin );
+	}
+
+	LayoutQueryList binaryLists[6] = { 0 };
+	LayoutQueryList binaryAllLists[3] = { 0 };
+	for ( int i = 0; i < 3; ++i )
+	{
+		binaryAllLists[i].tree = &tree;
+		binaryLists[2 * i].tree = &tree;
+		binaryLists[2 * i + 1].tree = &tree;
+		b2DynamicTree_QueryAll( &tree, queries[i], LayoutQueryCallback, binaryAllLists + i );
+		for ( int j = 0; j < 2; ++j )
+		{
+			b2DynamicTree_Query( &tree, queries[i], masks[j], LayoutQueryCallback, binaryLists + 2 * i + j );
+		}
+	}
+
+	ENSURE( binaryAllLists[1].count == LAYOUT_PROXY_COUNT );
+	ENSURE( binaryLists[0].count > 0 && binaryLists[0].count < binaryLists[1].count );
+
+	b2RayCastInput rays[2] = {
+		{ .origin = { -5.0f, 1.0f }, .translation = { 120.0f, 90.0f }, .maxFraction = 1.0f },
+		{ .origin = { 100.0f, 3.0f }, .translation = { -80.0f, 60.0f }, .maxFraction = 1.0f },
+	};
+	LayoutRayResult binaryRays[2];
+	for ( int i = 0; i < 2; ++i )
+	{
+		rays[i].origin = b2Add( rays[i].origin, origin );
+		binaryRays[i] = (LayoutRayResult){ &tree, -1, 2.0f };
+		b2DynamicTree_RayCast( &tree, rays + i, UINT64_MAX, LayoutRayCastCallback, binaryRays + i );
+		ENSURE( binaryRays[i].proxyId != -1 );
+	}
+
+	if ( quantized )
+	{
+		b2DynamicTree_BuildQuantizedNodes( &tree );
+		ENSURE( tree.quantizedNodeCount == 2 * tree.proxyCount - 1 );
+		ENSURE( tree.wideNodeCount == 0 );
+	}
+	else
+	{
+		b2DynamicTree_BuildWideNodes( &tree );
+		ENSURE( tree.wideNodeCount > 0 );
+		ENSURE( tree.wideNodeCount < tree.proxyCount / 2 );
+	}
+
+	for ( int i = 0; i < 3; ++i )
+	{
+		LayoutQueryList allList = { .tree = &tree };
+		b2DynamicTree_QueryAll( &tree, queries[i], LayoutQueryCallback, &allList );
+		ENSURE( allList.count == binaryAllLists[i].count );
+		ENSURE( memcmp( allList.ids, binaryAllLists[i].ids, allList.count * sizeof( int ) ) == 0 );
+
+		for ( int j = 0; j < 2; ++j )
+		{
+			LayoutQueryList list = { .tree = &tree };
+			LayoutQueryList* binaryList = binaryLists + 2 * i + j;
+			b2DynamicTree_Query( &tree, queries[i], masks[j], LayoutQueryCallback, &list );
+			ENSURE( list.count == binaryList->count );
+			ENSURE( memcmp( list.ids, binaryList->ids, list.count * sizeof( int ) ) == 0 );
+		}
+	}
+
+	for ( int i = 0; i < 2; ++i )
+	{
+		LayoutRayResult result = { &tree, -1, 2.0f };
+		b2DynamicTree_RayCast( &tree, rays + i, UINT64_MAX, LayoutRayCastCallback, &result );
+		ENSURE( result.proxyId == binaryRays[i].proxyId );
+		ENSURE( result.fraction == binaryRays[i].fraction );
+	}
+
+	// Any modification invalidates the query nodes
+	b2AABB box = b2DynamicTree_GetAABB( &tree, 0 );
+	box.upperBound.x += 1.0f;
+	b2DynamicTree_EnlargeProxy( &tree, 0, box );
+	ENSURE( tree.wideNodeCount == 0 );
+	ENSURE( tree.quantizedNodeCount == 0 );
+
+	b2DynamicTree_Rebuild( &tree, true );
+	ENSURE( tree.wideNodeCount > 0 );
+
+	b2DynamicTree_Destroy( &tree );
+	return 0;
+}
+
+static int TreeWideNodesTest( void )
+{
+	ENSURE( CheckQueryLayout( b2Vec2_zero, false ) == 0 );
+	return 0;
+}
+
+static int TreeQuantizedNodesTest( void )
+{
+	ENSURE( CheckQueryLayout( b2Vec2_zero, true ) == 0 );
+
+	// Far from the origin the float spacing exceeds the quantization step
+	ENSURE( CheckQueryLayout( (b2Vec2){ 20000.0f, -15000.0f }, true ) == 0 );
+	return 0;
+}
+
+// Empty lanes of wide nodes must not overlap a query box that covers every float
+static int TreeWideNodesHugeQueryTest( void )
+{
+	b2AABB everything = { { -FLT_MAX, -FLT_MAX }, { FLT_MAX, FLT_MAX } };
+
+	// These proxy counts leave empty lanes in some wide nodes
+	for ( int proxyCount = 1; proxyCount <= 9; ++proxyCount )
+	{
+		b2DynamicTree tree = b2DynamicTree_Create( 16 );
+		for ( int i = 0; i < proxyCount; ++i )
+		{
+			b2AABB a = { { 2.0f * i, 0.0f }, { 2.0f * i + 1.0f, 1.0f } };
+			b2DynamicTree_CreateProxy( &tree, a, 1, 1000 + i );
+		}
+
+		b2DynamicTree_BuildWideNodes( &tree );
+		ENSURE( tree.wideNodeCount > 0 );
+
+		LayoutQueryList allList = { .tree = &tree };
+		b2DynamicTree_QueryAll( &tree, everything, LayoutQueryCallback, &allList );
+		ENSURE( allList.count == proxyCount );
+
+		LayoutQueryList list = { .tree = &tree };
+		b2DynamicTree_Query( &tree, everything, UINT64_MAX, LayoutQueryCallback, &list );
+		ENSURE( list.count == proxyCount );
+
+		// Each proxy is reported once
+		for ( int i = 0; i < proxyCount; ++i )
+		{
+			for ( int j = i + 1; j < proxyCount; ++j )
+			{
+				ENSURE( list.ids[i] != list.ids[j] );
+				ENSURE( allList.ids[i] != allList.ids[j] );
+			}
+		}
+
+		b2DynamicTree_Destroy( &tree );
+	}
+
+	return 0;
+}
+
 int DynamicTreeTest( void )
 {
 	RUN_SUBTEST( TreeCreateDestroy );
@@ -457,6 +949,13 @@ int DynamicTreeTest( void )
 	RUN_SUBTEST( TreeRowHeightTest );
 	RUN_SUBTEST( TreeGridHeightTest );
 	RUN_SUBTEST( TreeGridMovementTest );
+	RUN_SUBTEST( TreeOptimizeTest );
+	RUN_SUBTEST( TreeCreateProxiesTest );
+	RUN_SUBTEST( TreeDestroyProxiesTest );
+	RUN_SUBTEST( TreeGraftTest );
+	RUN_SUBTEST( TreeWideNodesTest );
+	RUN_SUBTEST( TreeWideNodesHugeQueryTest );
+	RUN_SUBTEST( TreeQuantizedNodesTest );
 
 	// todo test queries versus brute force
 
@@ -170,6 +170,90 @@ static int RayCastShapeTest( void )
 	return 0;
 }
 
+// U shaped outline with a cavity from x = -2 to 2 above y = 1
+static b2Vec2 outline[8] = { { -3.0f, 0.0f }, { 3.0f, 0.0f },  { 3.0f, 3.0f },	 { 2.0f, 3.0f },
+							 { 2.0f, 1.0f },  { -2.0f, 1.0f }, { -2.0f, 3.0f }, { -3.0f, 3.0f } };
+
+static int CompoundShapeTest( void )
+{
+	b2Polygon polygons[8];
+	int count = b2DecomposePolygon( outline, 8, 0.0f, polygons, 8 );
+	ENSURE( 2 <= count && count <= 8 );
+
+	// Clockwise input gives the same pieces
+	b2Vec2 reversed[8];
+	for ( int i = 0; i < 8; ++i )
+	{
+		reversed[i] = outline[7 - i];
+	}
+	ENSURE( b2DecomposePolygon( reversed, 8, 0.0f, NULL, 0 ) == count );
+
+	b2Compound* compound = b2CreateCompound( polygons, count );
+	ENSURE( b2Compound_GetPolygonCount( compound ) == count );
+
+	{
+		b2MassData md = b2ComputeCompoundMass( compound, 2.0f );
+		ENSURE_SMALL( md.mass - 20.0f, 1000.0f * FLT_EPSILON );
+		ENSURE_SMALL( md.center.x, 1000.0f * FLT_EPSILON );
+	}
+
+	{
+		b2AABB aabb = b2ComputeCompoundAABB( compound, b2Transform_identity );
+		ENSURE_SMALL( aabb.lowerBound.x + 3.0f, FLT_EPSILON );
+		ENSURE_SMALL( aabb.upperBound.y - 3.0f, FLT_EPSILON );
+	}
+
+	ENSURE( b2PointInCompound( compound, ( b2Vec2 ){ 0.0f, 0.5f } ) == true );
+	ENSURE( b2PointInCompound( compound, ( b2Vec2 ){ 2.5f, 2.5f } ) == true );
+	ENSURE( b2PointInCompound( compound, ( b2Vec2 ){ 0.0f, 2.0f } ) == false );
+
+	{
+		// Falls into the cavity and hits its floor
+		b2RayCastInput input = { { 0.0f, 5.0f }, { 0.0f, -10.0f }, 1.0f };
+		b2CastOutput output = b2RayCastCompound( compound, &input );
+		ENSURE( output.hit );
+		ENSURE_SMALL( output.normal.y - 1.0f, FLT_EPSILON );
+		ENSURE_SMALL( output.fraction - 0.4f, FLT_EPSILON );
+	}
+
+	{
+		// A box resting on the cavity floor gets one manifold with two points
+		b2Polygon small = b2MakeBox( 0.5f, 0.5f );
+		b2Transform xfB = { { 0.0f, 1.5f }, b2Rot_identity };
+		b2Manifold manifold = b2CollideCompoundAndPolygon( compound, b2Transform_identity, &small, xfB );
+		ENSURE( manifold.pointCount == 2 );
+		ENSURE_SMALL( manifold.normal.y - 1.0f, FLT_EPSILON );
+		ENSURE( manifold.points[0].id != manifold.points[1].id );
+	}
+
+	b2DestroyCompound( compound );
+
+	{
+		// A single polygon compound collides exactly like the polygon
+		b2Polygon crate = b2MakeBox( 0.5f, 0.5f );
+		b2Compound* shared = b2CreateCompound( &crate, 1 );
+		b2Transform xfA = { { 0.1f, 0.0f }, b2MakeRot( 0.1f ) };
+		b2Transform xfB = { { 0.0f, 0.95f }, b2Rot_identity };
+
+		b2Manifold expected = b2CollidePolygons( &crate, xfA, &crate, xfB );
+		b2Manifold manifold = b2CollideCompoundAndPolygon( shared, xfA, &crate, xfB );
+		ENSURE( expected.pointCount == 2 && manifold.pointCount == 2 );
+		ENSURE( manifold.normal.x == expected.normal.x && manifold.normal.y == expected.normal.y );
+		ENSURE( manifold.points[0].id == expected.points[0].id && manifold.points[1].id == expected.points[1].id );
+
+		manifold = b2CollideCompounds( shared, xfA, shared, xfB );
+		ENSURE( manifold.pointCount == 2 );
+		ENSURE( manifold.points[0].separation == expected.points[0].separation );
+
+		b2MassData md = b2ComputeCompoundMass( shared, 2.0f );
+		ENSURE_SMALL( md.mass - 2.0f, FLT_EPSILON );
+
+		b2DestroyCompound( shared );
+	}
+
+	return 0;
+}
+
 int ShapeTest( void )
 {
 	box = b2MakeBox( 1.0f, 1.0f );
@@ -178,6 +262,7 @@ int ShapeTest( void )
 	RUN_SUBTEST( ShapeAABBTest );
 	RUN_SUBTEST( PointInShapeTest );
 	RUN_SUBTEST( RayCastShapeTest );
+	RUN_SUBTEST( CompoundShapeTest );
 
 	return 0;
 }
@@ -421,6 +421,79 @@ static int HashSetTest( void )
 	return 0;
 }
 
+#define SET32_KEY_RANGE 4096
+
+static int HashSet32Test( void )
+{
+	b2HashSet32 set = b2CreateSet32( 0 );
+	ENSURE( b2GetSet32Count( &set ) == 0 );
+
+	// All key values are allowed
+	ENSURE( b2AddKey32( &set, 0 ) == false );
+	ENSURE( b2AddKey32( &set, UINT32_MAX ) == false );
+	ENSURE( b2AddKey32( &set, 0 ) == true );
+	ENSURE( b2ContainsKey32( &set, 0 ) );
+	ENSURE( b2ContainsKey32( &set, UINT32_MAX ) );
+	ENSURE( b2RemoveKey32( &set, 0 ) );
+	ENSURE( b2RemoveKey32( &set, 0 ) == false );
+	ENSURE( b2ContainsKey32( &set, UINT32_MAX ) );
+	b2ClearSet32( &set );
+	ENSURE( b2GetSet32Count( &set ) == 0 );
+	ENSURE( b2ContainsKey32( &set, UINT32_MAX ) == false );
+
+	// Random churn checked against a reference. This exercises deleted slot reuse and rehashing.
+	bool present[SET32_KEY_RANGE] = { 0 };
+	int count = 0;
+	uint32_t seed = 12345;
+	for ( int i = 0; i < 100000; ++i )
+	{
+		seed = 1664525u * seed + 1013904223u;
+		uint32_t key = ( seed >> 8 ) % SET32_KEY_RANGE;
+
+		// Bias towards adds early on so the table grows, then balance
+		bool add = ( seed & 0xFF ) < ( i < 20000 ? 192u : 128u );
+		if ( add )
+		{
+			ENSURE( b2AddKey32( &set, key ) == present[key] );
+			count += present[key] ? 0 : 1;
+			present[key] = true;
+		}
+		else
+		{
+			ENSURE( b2RemoveKey32( &set, key ) == present[key] );
+			count -= present[key] ? 1 : 0;
+			present[key] = false;
+		}
+
+		ENSURE( b2GetSet32Count( &set ) == count );
+	}
+
+	for ( uint32_t key = 0; key < SET32_KEY_RANGE; ++key )
+	{
+		ENSURE( b2ContainsKey32( &set, key ) == present[key] );
+	}
+
+	// Shrinking keeps the keys
+	for ( uint32_t key = 64; key < SET32_KEY_RANGE; ++key )
+	{
+		b2RemoveKey32( &set, key );
+	}
+
+	int bytes = b2GetHashSet32Bytes( &set );
+	b2ShrinkSet32( &set );
+	ENSURE( b2GetHashSet32Bytes( &set ) < bytes );
+
+	for ( uint32_t key = 0; key < SET32_KEY_RANGE; ++key )
+	{
+		ENSURE( b2ContainsKey32( &set, key ) == ( key < 64 && present[key] ) );
+	}
+
+	b2DestroySet32( &set );
+	ENSURE( set.controls == NULL );
+
+	return 0;
+}
+
 int TableTest( void )
 {
 	// Test helper functions first
@@ -442,6 +515,7 @@ int TableTest( void )
 	RUN_SUBTEST( HashSetShapePairKeyTest );
 	RUN_SUBTEST( HashSetBytesTest );
 	RUN_SUBTEST( HashSetTest );
+	RUN_SUBTEST( HashSet32Test );
 
 	return 0;
 }
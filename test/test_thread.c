@@ -1,9 +1,16 @@
 // SPDX-FileCopyrightText: 2026 Erin Catto
 // SPDX-License-Identifier: MIT
 
+#include "atomic.h"
 #include "core.h"
+#include "scheduler.h"
 #include "test_macros.h"
 
+#include "box2d/box2d.h"
+#include "box2d/constants.h"
+
+#include <string.h>
+
 // b2Semaphore tests
 
 static int SemaphoreCreateDestroyTest( void )
@@ -121,6 +128,256 @@ static int ThreadMultipleTest( void )
 	return 0;
 }
 
+// b2Scheduler tests
+
+typedef struct SchedulerData
+{
+	b2AtomicInt count;
+	int values[B2_MAX_TASKS];
+} SchedulerData;
+
+typedef struct SchedulerItem
+{
+	SchedulerData* data;
+	int index;
+} SchedulerItem;
+
+static void SchedulerWorker( void* context )
+{
+	SchedulerItem* item = context;
+	item->data->values[item->index] += item->index;
+	b2AtomicFetchAddInt( &item->data->count, 1 );
+}
+
+// Many rounds wrap the queue counters and every task must run exactly once per round.
+static int SchedulerRoundsTest( void )
+{
+	enum
+	{
+		e_roundCount = 40
+	};
+
+	for ( int workerCount = 1; workerCount <= 8; workerCount += 3 )
+	{
+		b2Scheduler* scheduler = b2CreateScheduler( workerCount, 0 );
+
+		SchedulerData data = { 0 };
+		SchedulerItem items[B2_MAX_TASKS];
+		void* handles[B2_MAX_TASKS];
+
+		for ( int round = 0; round < e_roundCount; ++round )
+		{
+			b2ResetScheduler( scheduler );
+			b2AtomicStoreInt( &data.count, 0 );
+
+			int taskCount = round % 2 == 0 ? B2_MAX_TASKS : 7 + round;
+			for ( int i = 0; i < taskCount; ++i )
+			{
+				items[i] = (SchedulerItem){ &data, i };
+				handles[i] = b2SchedulerEnqueueTask( SchedulerWorker, items + i, scheduler );
+			}
+
+			// finish in reverse order so the main thread has to help
+			for ( int i = taskCount - 1; i >= 0; --i )
+			{
+				b2SchedulerFinishTask( handles[i], scheduler );
+			}
+
+			ENSURE( b2AtomicLoadInt( &data.count ) == taskCount );
+		}
+
+		// even rounds run all slots, odd rounds run 7 + round slots
+		for ( int i = 0; i < B2_MAX_TASKS; ++i )
+		{
+			int runCount = 0;
+			for ( int round = 0; round < e_roundCount; ++round )
+			{
+				int taskCount = round % 2 == 0 ? B2_MAX_TASKS : 7 + round;
+				runCount += i < taskCount ? 1 : 0;
+			}
+
+			ENSURE( data.values[i] == runCount * i );
+		}
+
+		b2DestroyScheduler( scheduler );
+	}
+
+	return 0;
+}
+
+// Pinned workers still run every task. The auto cache domain may be empty in a sandbox so fall back
+// to the first processor, which pins all the workers together.
+static int AffinityTest( void )
+{
+	uint64_t domainMask = b2GetCacheDomainAffinityMask();
+	uint64_t masks[2] = { domainMask != 0 ? domainMask : 1, 1 };
+
+	for ( int maskIndex = 0; maskIndex < 2; ++maskIndex )
+	{
+		b2Scheduler* scheduler = b2CreateScheduler( 4, masks[maskIndex] );
+
+		SchedulerData data = { 0 };
+		SchedulerItem items[64];
+		void* handles[64];
+
+		for ( int i = 0; i < 64; ++i )
+		{
+			items[i] = (SchedulerItem){ &data, i };
+			handles[i] = b2SchedulerEnqueueTask( SchedulerWorker, items + i, scheduler );
+		}
+
+		for ( int i = 0; i < 64; ++i )
+		{
+			b2SchedulerFinishTask( handles[i], scheduler );
+		}
+
+		ENSURE( b2AtomicLoadInt( &data.count ) == 64 );
+		for ( int i = 0; i < 64; ++i )
+		{
+			ENSURE( data.values[i] == i );
+		}
+
+		b2DestroyScheduler( scheduler );
+	}
+
+	return 0;
+}
+
+// Concurrent world queries
+
+#define QUERY_AGENT_COUNT 256
+#define QUERY_THREAD_COUNT 4
+
+typedef struct AgentResults
+{
+	float castFractions[QUERY_AGENT_COUNT];
+	int planeCounts[QUERY_AGENT_COUNT];
+	int overlapCounts[QUERY_AGENT_COUNT];
+	b2RayResult rays[QUERY_AGENT_COUNT];
+} AgentResults;
+
+typedef struct AgentQueryData
+{
+	b2WorldId worldId;
+	AgentResults results;
+} AgentQueryData;
+
+static bool CountPlaneCallback( b2ShapeId shapeId, const b2PlaneResult* plane, void* context )
+{
+	(void)shapeId;
+	(void)plane;
+	int* count = context;
+	*count += 1;
+	return true;
+}
+
+static bool CountOverlapCallback( b2ShapeId shapeId, void* context )
+{
+	(void)shapeId;
+	int* count = context;
+	*count += 1;
+	return true;
+}
+
+static b2Vec2 AgentPosition( int index )
+{
+	return (b2Vec2){ -30.0f + 0.23f * index, 0.8f + 0.05f * ( index % 17 ) };
+}
+
+static void RunAgentQueries( void* context )
+{
+	AgentQueryData* data = context;
+	b2WorldId worldId = data->worldId;
+	b2QueryFilter filter = b2DefaultQueryFilter();
+
+	for ( int i = 0; i < QUERY_AGENT_COUNT; ++i )
+	{
+		b2Vec2 p = AgentPosition( i );
+		b2Capsule mover = { { p.x, p.y }, { p.x, p.y + 1.0f }, 0.3f };
+		b2Vec2 translation = { 2.0f * ( ( i % 3 ) - 1 ), -1.0f };
+
+		data->results.castFractions[i] = b2World_CastMover( worldId, &mover, translation, filter );
+
+		data->results.planeCounts[i] = 0;
+		b2World_CollideMover( worldId, &mover, filter, CountPlaneCallback, data->results.planeCounts + i );
+
+		b2ShapeProxy proxy = b2MakeProxy( &p, 1, 1.0f );
+		data->results.overlapCounts[i] = 0;
+		b2World_OverlapShape( worldId, &proxy, filter, CountOverlapCallback, data->results.overlapCounts + i );
+
+		data->results.rays[i] = b2World_CastRayClosest( worldId, p, translation, filter );
+	}
+}
+
+// The world query functions only read the world, so game threads can run them at the same time
+// between steps. Run with the thread sanitizer to catch shared scratch state.
+static int ConcurrentQueryTest( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Segment segment = { { -40.0f, 0.0f }, { 40.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.4f, 0.4f );
+	for ( int i = 0; i < 100; ++i )
+	{
+		bodyDef.position = (b2Vec2){ -30.0f + 0.6f * i, 0.5f + 1.0f * ( i % 3 ) };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyId, &shapeDef, &box );
+	}
+
+	for ( int i = 0; i < 30; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	static AgentQueryData reference;
+	reference.worldId = worldId;
+	RunAgentQueries( &reference );
+
+	static AgentQueryData threadData[QUERY_THREAD_COUNT];
+	b2Thread* threads[QUERY_THREAD_COUNT];
+	for ( int i = 0; i < QUERY_THREAD_COUNT; ++i )
+	{
+		threadData[i].worldId = worldId;
+		threads[i] = b2CreateThread( RunAgentQueries, threadData + i, "query test" );
+		ENSURE( threads[i] != NULL );
+	}
+
+	for ( int i = 0; i < QUERY_THREAD_COUNT; ++i )
+	{
+		b2JoinThread( threads[i] );
+
+		const AgentResults* a = &threadData[i].results;
+		const AgentResults* b = &reference.results;
+		ENSURE( memcmp( a->castFractions, b->castFractions, sizeof( a->castFractions ) ) == 0 );
+		ENSURE( memcmp( a->planeCounts, b->planeCounts, sizeof( a->planeCounts ) ) == 0 );
+		ENSURE( memcmp( a->overlapCounts, b->overlapCounts, sizeof( a->overlapCounts ) ) == 0 );
+
+		for ( int j = 0; j < QUERY_AGENT_COUNT; ++j )
+		{
+			ENSURE( a->rays[j].hit == b->rays[j].hit );
+			ENSURE( a->rays[j].fraction == b->rays[j].fraction );
+			ENSURE( B2_ID_EQUALS( a->rays[j].shapeId, b->rays[j].shapeId ) );
+		}
+	}
+
+	int hitCount = 0;
+	for ( int i = 0; i < QUERY_AGENT_COUNT; ++i )
+	{
+		hitCount += reference.results.rays[i].hit ? 1 : 0;
+	}
+	ENSURE( hitCount > 0 );
+
+	b2DestroyWorld( worldId );
+	return 0;
+}
+
 int ThreadTest( void )
 {
 	RUN_SUBTEST( SemaphoreCreateDestroyTest );
@@ -128,5 +385,8 @@ int ThreadTest( void )
 	RUN_SUBTEST( SemaphoreInitialCountTest );
 	RUN_SUBTEST( ThreadCreateJoinTest );
 	RUN_SUBTEST( ThreadMultipleTest );
+	RUN_SUBTEST( SchedulerRoundsTest );
+	RUN_SUBTEST( AffinityTest );
+	RUN_SUBTEST( ConcurrentQueryTest );
 	return 0;
 }
@@ -9,7 +9,10 @@
 #include "box2d/constants.h"
 #include "box2d/math_functions.h"
 
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 // This is a simple example of building and running a simulation
 // using Box2D. Here we create a large ground box and a small dynamic
@@ -435,6 +438,5985 @@ static int TestSetWorkerCount( void )
 	return 0;
 }
 
+// Kinematic bodies are colored like static bodies, so a kinematic platform carrying many boxes
+// does not push contacts into the overflow color.
+static int TestKinematicColoring( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_kinematicBody;
+	bodyDef.linearVelocity = ( b2Vec2 ){ 0.0f, 0.5f };
+	b2BodyId platformId = b2CreateBody( worldId, &bodyDef );
+
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Polygon platformBox = b2MakeBox( 32.0f, 0.5f );
+	b2CreatePolygonShape( platformId, &shapeDef, &platformBox );
+
+	enum
+	{
+		e_count = 60
+	};
+
+	b2BodyId boxIds[e_count];
+	b2Polygon box = b2MakeBox( 0.2f, 0.2f );
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.linearVelocity = b2Vec2_zero;
+	for ( int i = 0; i < e_count; ++i )
+	{
+		bodyDef.position = ( b2Vec2 ){ -30.0f + 1.0f * i, 0.7f };
+		boxIds[i] = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( boxIds[i], &shapeDef, &box );
+	}
+
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+		b2Counters counters = b2World_GetCounters( worldId );
+		ENSURE( counters.overflowContactCount == 0 );
+	}
+
+	// the platform is never written by the solver and the boxes ride on it
+	b2Vec2 platformVelocity = b2Body_GetLinearVelocity( platformId );
+	ENSURE( platformVelocity.x == 0.0f && platformVelocity.y == 0.5f );
+
+	b2Vec2 platformPosition = b2Body_GetPosition( platformId );
+	for ( int i = 0; i < e_count; ++i )
+	{
+		b2Vec2 p = b2Body_GetPosition( boxIds[i] );
+		ENSURE( b2AbsFloat( p.y - platformPosition.y - 0.7f ) < 0.05f );
+	}
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+#define RELAX_PYRAMID_ROWS 10
+#define RELAX_PYRAMID_COUNT ( RELAX_PYRAMID_ROWS * ( RELAX_PYRAMID_ROWS + 1 ) / 2 )
+
+static void SimulatePyramid( b2Vec2* positions, bool adaptiveRelax )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.enableSleep = false;
+	worldDef.enableAdaptiveRelax = adaptiveRelax;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Segment segment = { { -20.0f, 0.0f }, { 20.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	b2BodyId bodyIds[RELAX_PYRAMID_COUNT];
+	int index = 0;
+	for ( int row = 0; row < RELAX_PYRAMID_ROWS; ++row )
+	{
+		for ( int i = 0; i < RELAX_PYRAMID_ROWS - row; ++i )
+		{
+			bodyDef.position = ( b2Vec2 ){ 1.0f * i + 0.5f * row, 0.5f + 1.0f * row };
+			bodyIds[index] = b2CreateBody( worldId, &bodyDef );
+			b2CreatePolygonShape( bodyIds[index], &shapeDef, &box );
+			index += 1;
+		}
+	}
+
+	for ( int i = 0; i < 300; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	for ( int i = 0; i < RELAX_PYRAMID_COUNT; ++i )
+	{
+		positions[i] = b2Body_GetPosition( bodyIds[i] );
+	}
+
+	b2DestroyWorld( worldId );
+}
+
+// Resting contacts skip relax iterations but the pyramid must keep standing.
+static int TestAdaptiveRelax( void )
+{
+	b2Vec2 fullPositions[RELAX_PYRAMID_COUNT];
+	b2Vec2 adaptivePositions[RELAX_PYRAMID_COUNT];
+
+	SimulatePyramid( fullPositions, false );
+	SimulatePyramid( adaptivePositions, true );
+
+	bool skipped = false;
+	for ( int i = 0; i < RELAX_PYRAMID_COUNT; ++i )
+	{
+		ENSURE( b2IsValidVec2( adaptivePositions[i] ) );
+		ENSURE( b2Distance( fullPositions[i], adaptivePositions[i] ) < 0.05f );
+		skipped = skipped || fullPositions[i].x != adaptivePositions[i].x || fullPositions[i].y != adaptivePositions[i].y;
+	}
+
+	// the adaptive path must have been taken
+	ENSURE( skipped );
+
+	return 0;
+}
+
+static b2Capacity SimulateAllocationPyramid( b2Capacity capacity, int* allocationCount )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.enableSleep = false;
+	worldDef.capacity = capacity;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Segment segment = { { -20.0f, 0.0f }, { 20.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	for ( int row = 0; row < RELAX_PYRAMID_ROWS; ++row )
+	{
+		for ( int i = 0; i < RELAX_PYRAMID_ROWS - row; ++i )
+		{
+			bodyDef.position = ( b2Vec2 ){ 1.0f * i + 0.5f * row, 0.5f + 1.0f * row };
+			b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+			b2CreatePolygonShape( bodyId, &shapeDef, &box );
+		}
+	}
+
+	// The first step creates the contacts
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	b2World_EnableAllocationCheck( worldId, capacity.contactCount > 0 );
+
+	*allocationCount = 0;
+	for ( int i = 0; i < 120; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		*allocationCount += b2World_GetCounters( worldId ).stepAllocationCount;
+	}
+
+	b2Capacity maxCapacity = b2World_GetMaxCapacity( worldId );
+	b2DestroyWorld( worldId );
+	return maxCapacity;
+}
+
+// Sizing the world with its own peak capacity removes all heap allocations from the step.
+static int TestCapacity( void )
+{
+	int allocationCount;
+	b2Capacity capacity = SimulateAllocationPyramid( ( b2Capacity ){ 0 }, &allocationCount );
+	ENSURE( capacity.dynamicBodyCount == RELAX_PYRAMID_COUNT );
+	ENSURE( capacity.contactCount > 0 );
+	ENSURE( capacity.stackByteCount > 0 );
+	ENSURE( capacity.arenaByteCount > 0 );
+
+	SimulateAllocationPyramid( capacity, &allocationCount );
+	ENSURE( allocationCount == 0 );
+
+	return 0;
+}
+
+#define COMPACT_BODY_COUNT 200
+
+// Compaction releases memory without invalidating live ids or reviving stale ids.
+static int TestCompact( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Segment segment = { { -40.0f, 0.0f }, { 40.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	b2BodyId bodyIds[COMPACT_BODY_COUNT];
+	for ( int i = 0; i < COMPACT_BODY_COUNT; ++i )
+	{
+		bodyDef.position = ( b2Vec2 ){ -20.0f + 1.0f * ( i % 40 ), 0.5f + 1.0f * ( i / 40 ) };
+		bodyIds[i] = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyIds[i], &shapeDef, &box );
+	}
+
+	for ( int i = 0; i < 30; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	// Keep every fourth body of the first rows so there are holes below the trimmed range
+	int keepCount = COMPACT_BODY_COUNT / 4;
+	for ( int i = 0; i < COMPACT_BODY_COUNT; ++i )
+	{
+		if ( i >= keepCount || i % 4 != 0 )
+		{
+			b2DestroyBody( bodyIds[i] );
+		}
+	}
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+	int byteCount = b2GetByteCount();
+	b2World_Compact( worldId );
+	ENSURE( b2GetByteCount() < byteCount );
+
+	for ( int i = 0; i < COMPACT_BODY_COUNT; ++i )
+	{
+		bool alive = i < keepCount && i % 4 == 0;
+		ENSURE( b2Body_IsValid( bodyIds[i] ) == alive );
+	}
+
+	// New bodies reuse released slots with a new generation
+	for ( int i = 0; i < COMPACT_BODY_COUNT; ++i )
+	{
+		if ( i < keepCount && i % 4 == 0 )
+		{
+			continue;
+		}
+
+		bodyDef.position = ( b2Vec2 ){ -20.0f + 1.0f * ( i % 40 ), 10.5f + 1.0f * ( i / 40 ) };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyId, &shapeDef, &box );
+		ENSURE( b2Body_IsValid( bodyIds[i] ) == false );
+		bodyIds[i] = bodyId;
+	}
+
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	for ( int i = 0; i < COMPACT_BODY_COUNT; ++i )
+	{
+		ENSURE( b2Body_IsValid( bodyIds[i] ) );
+		b2Vec2 position = b2Body_GetPosition( bodyIds[i] );
+		ENSURE( b2IsValidVec2( position ) );
+		ENSURE( position.y > 0.0f );
+	}
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+#define STATIC_REBUILD_COLUMNS 60
+#define STATIC_REBUILD_ROWS 50
+
+typedef struct StaticQueryList
+{
+	int count;
+	int shapeIndices[STATIC_REBUILD_COLUMNS * STATIC_REBUILD_ROWS];
+} StaticQueryList;
+
+static bool StaticQueryCallback( b2ShapeId shapeId, void* context )
+{
+	StaticQueryList* list = context;
+	list->shapeIndices[list->count++] = shapeId.index1;
+	return true;
+}
+
+// The parallel static tree rebuild must produce the same tree as the serial rebuild
+static int TestParallelStaticRebuild( void )
+{
+	StaticQueryList lists[2] = { 0 };
+	b2RayResult rays[2];
+	int workerCounts[2] = { 1, 4 };
+
+	for ( int i = 0; i < 2; ++i )
+	{
+		b2WorldDef worldDef = b2DefaultWorldDef();
+		worldDef.workerCount = workerCounts[i];
+		b2WorldId worldId = b2CreateWorld( &worldDef );
+
+		b2BodyDef bodyDef = b2DefaultBodyDef();
+		b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+		b2ShapeDef shapeDef = b2DefaultShapeDef();
+
+		for ( int j = 0; j < STATIC_REBUILD_COLUMNS * STATIC_REBUILD_ROWS; ++j )
+		{
+			float x = 2.0f * ( j % STATIC_REBUILD_COLUMNS ) + 0.1f * ( j % 7 );
+			float y = 2.0f * ( j / STATIC_REBUILD_COLUMNS ) + 0.1f * ( j % 5 );
+			b2Polygon box = b2MakeOffsetBox( 0.5f, 0.25f + 0.05f * ( j % 3 ), ( b2Vec2 ){ x, y }, b2Rot_identity );
+			b2CreatePolygonShape( groundId, &shapeDef, &box );
+		}
+
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		b2World_RebuildStaticTree( worldId );
+
+		b2AABB aabb = { { 10.0f, 10.0f }, { 60.0f, 45.0f } };
+		b2World_OverlapAABB( worldId, aabb, b2DefaultQueryFilter(), StaticQueryCallback, lists + i );
+		rays[i] = b2World_CastRayClosest( worldId, ( b2Vec2 ){ -5.0f, 3.3f }, ( b2Vec2 ){ 150.0f, 80.0f },
+										  b2DefaultQueryFilter() );
+
+		b2DestroyWorld( worldId );
+	}
+
+	ENSURE( lists[0].count > 100 );
+	ENSURE( lists[0].count == lists[1].count );
+	ENSURE( memcmp( lists[0].shapeIndices, lists[1].shapeIndices, lists[0].count * sizeof( int ) ) == 0 );
+	ENSURE( rays[0].hit && rays[1].hit );
+	ENSURE( rays[0].shapeId.index1 == rays[1].shapeId.index1 );
+	ENSURE( rays[0].fraction == rays[1].fraction );
+
+	return 0;
+}
+
+#define CAST_RAYS_COUNT 1001
+
+// Batched ray casts must find the same closest hits as single ray casts
+static int TestCastRaysClosest( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+
+	for ( int i = 0; i < STATIC_REBUILD_COLUMNS * STATIC_REBUILD_ROWS; i += 3 )
+	{
+		float x = 2.0f * ( i % STATIC_REBUILD_COLUMNS ) + 0.1f * ( i % 7 );
+		float y = 2.0f * ( i / STATIC_REBUILD_COLUMNS ) + 0.1f * ( i % 5 );
+		b2Polygon box = b2MakeOffsetBox( 0.5f, 0.25f + 0.05f * ( i % 3 ), ( b2Vec2 ){ x, y }, b2Rot_identity );
+		b2CreatePolygonShape( groundId, &shapeDef, &box );
+	}
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.gravityScale = 0.0f;
+	b2Circle circle = { { 0.0f, 0.0f }, 0.4f };
+	for ( int i = 0; i < 200; ++i )
+	{
+		bodyDef.position = ( b2Vec2 ){ 1.0f + 2.0f * ( i % 50 ), 1.0f + 2.0f * ( i / 50 ) };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2CreateCircleShape( bodyId, &shapeDef, &circle );
+	}
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+	b2Vec2 origins[CAST_RAYS_COUNT];
+	b2Vec2 translations[CAST_RAYS_COUNT];
+	b2RayResult results[CAST_RAYS_COUNT];
+
+	uint32_t seed = 12345;
+	for ( int i = 0; i < CAST_RAYS_COUNT; ++i )
+	{
+		seed = 1664525u * seed + 1013904223u;
+		float u = (float)( seed >> 8 ) / 16777216.0f;
+		seed = 1664525u * seed + 1013904223u;
+		float w = (float)( seed >> 8 ) / 16777216.0f;
+
+		// Coherent packets of rays fanning out from a few origins
+		origins[i] = ( b2Vec2 ){ -5.0f + 130.0f * u, -5.0f + 3.0f * ( i / 40 ) };
+		float angle = 6.2831853f * w;
+		translations[i] = ( b2Vec2 ){ 40.0f * cosf( angle ), 40.0f * sinf( angle ) };
+	}
+
+	b2World_CastRaysClosest( worldId, origins, translations, CAST_RAYS_COUNT, b2DefaultQueryFilter(), results );
+
+	int hitCount = 0;
+	for ( int i = 0; i < CAST_RAYS_COUNT; ++i )
+	{
+		b2RayResult expected = b2World_CastRayClosest( worldId, origins[i], translations[i], b2DefaultQueryFilter() );
+		ENSURE( results[i].hit == expected.hit );
+		if ( expected.hit )
+		{
+			ENSURE( B2_ID_EQUALS( results[i].shapeId, expected.shapeId ) );
+			ENSURE( results[i].fraction == expected.fraction );
+			ENSURE( results[i].point.x == expected.point.x && results[i].point.y == expected.point.y );
+			hitCount += 1;
+		}
+	}
+
+	ENSURE( hitCount > CAST_RAYS_COUNT / 2 );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+static float CastShapeClosest( b2ShapeId shapeId, b2Vec2 point, b2Vec2 normal, float fraction, void* context )
+{
+	if ( fraction == 0.0f )
+	{
+		return -1.0f;
+	}
+
+	b2RayResult* result = context;
+	result->shapeId = shapeId;
+	result->point = point;
+	result->normal = normal;
+	result->fraction = fraction;
+	result->hit = true;
+	return fraction;
+}
+
+// Batched shape casts are sorted internally but must match single shape casts in input order
+static int TestCastShapesClosest( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+
+	for ( int i = 0; i < STATIC_REBUILD_COLUMNS * STATIC_REBUILD_ROWS; i += 3 )
+	{
+		float x = 2.0f * ( i % STATIC_REBUILD_COLUMNS ) + 0.1f * ( i % 7 );
+		float y = 2.0f * ( i / STATIC_REBUILD_COLUMNS ) + 0.1f * ( i % 5 );
+		b2Polygon box = b2MakeOffsetBox( 0.5f, 0.25f + 0.05f * ( i % 3 ), ( b2Vec2 ){ x, y }, b2Rot_identity );
+		b2CreatePolygonShape( groundId, &shapeDef, &box );
+	}
+
+	b2ShapeProxy proxies[CAST_RAYS_COUNT];
+	b2Vec2 translations[CAST_RAYS_COUNT];
+	b2RayResult results[CAST_RAYS_COUNT];
+
+	uint32_t seed = 54321;
+	for ( int i = 0; i < CAST_RAYS_COUNT; ++i )
+	{
+		seed = 1664525u * seed + 1013904223u;
+		float u = (float)( seed >> 8 ) / 16777216.0f;
+		seed = 1664525u * seed + 1013904223u;
+		float w = (float)( seed >> 8 ) / 16777216.0f;
+
+		// Thick bullets in random order
+		b2Vec2 origin = { -5.0f + 130.0f * u, -5.0f + 60.0f * w };
+		b2Vec2 points[2] = { origin, b2Add( origin, ( b2Vec2 ){ 0.2f, 0.0f } ) };
+		proxies[i] = b2MakeProxy( points, 2, 0.1f );
+		float angle = 6.2831853f * u * w;
+		translations[i] = ( b2Vec2 ){ 20.0f * cosf( angle ), 20.0f * sinf( angle ) };
+	}
+
+	b2World_CastShapesClosest( worldId, proxies, translations, CAST_RAYS_COUNT, b2DefaultQueryFilter(), results );
+
+	int hitCount = 0;
+	for ( int i = 0; i < CAST_RAYS_COUNT; ++i )
+	{
+		b2RayResult expected = { 0 };
+		b2World_CastShape( worldId, proxies + i, translations[i], b2DefaultQueryFilter(), CastShapeClosest, &expected );
+		ENSURE( results[i].hit == expected.hit );
+		if ( expected.hit )
+		{
+			ENSURE( B2_ID_EQUALS( results[i].shapeId, expected.shapeId ) );
+			ENSURE( results[i].fraction == expected.fraction );
+			ENSURE( results[i].point.x == expected.point.x && results[i].point.y == expected.point.y );
+			hitCount += 1;
+		}
+	}
+
+	ENSURE( hitCount > CAST_RAYS_COUNT / 2 );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+#define OVERLAP_BATCH_COUNT 300
+
+typedef struct OverlapBatchList
+{
+	int count;
+	b2ShapeId shapeIds[1024];
+} OverlapBatchList;
+
+static bool OverlapBatchCallback( b2ShapeId shapeId, void* context )
+{
+	OverlapBatchList* list = context;
+	if ( list->count < 1024 )
+	{
+		list->shapeIds[list->count] = shapeId;
+	}
+	list->count += 1;
+	return true;
+}
+
+// Batched overlap queries must report the same shapes in the same order as the single queries
+static int TestOverlapBatch( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+
+	for ( int i = 0; i < 40 * 20; ++i )
+	{
+		b2Vec2 center = { 2.0f * ( i % 40 ), 2.0f * ( i / 40 ) };
+		b2Polygon box = b2MakeOffsetBox( 0.6f, 0.4f, center, b2Rot_identity );
+		shapeDef.filter.categoryBits = ( i % 3 ) == 0 ? 0x2 : 0x1;
+		b2CreatePolygonShape( groundId, &shapeDef, &box );
+	}
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.gravityScale = 0.0f;
+	shapeDef.filter.categoryBits = 0x1;
+	b2Circle circle = { { 0.0f, 0.0f }, 0.5f };
+	for ( int i = 0; i < 100; ++i )
+	{
+		bodyDef.position = ( b2Vec2 ){ 1.0f + 4.0f * ( i % 20 ), 1.0f + 4.0f * ( i / 20 ) };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2CreateCircleShape( bodyId, &shapeDef, &circle );
+	}
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+	b2AABB aabbs[OVERLAP_BATCH_COUNT];
+	b2ShapeProxy proxies[OVERLAP_BATCH_COUNT];
+	b2QueryFilter filters[OVERLAP_BATCH_COUNT];
+	for ( int i = 0; i < OVERLAP_BATCH_COUNT; ++i )
+	{
+		b2Vec2 center = { 0.27f * i, 0.13f * i };
+		b2Vec2 extent = { 1.0f + 0.1f * ( i % 11 ), 0.5f + 0.1f * ( i % 7 ) };
+		aabbs[i] = ( b2AABB ){ b2Sub( center, extent ), b2Add( center, extent ) };
+		proxies[i] = b2MakeOffsetProxy( &center, 1, 0.5f + 0.1f * ( i % 5 ), b2Vec2_zero, b2Rot_identity );
+		filters[i] = b2DefaultQueryFilter();
+		filters[i].maskBits = ( i % 4 ) == 0 ? 0x2 : B2_DEFAULT_MASK_BITS;
+	}
+
+	static b2OverlapHit hits[8 * 1024];
+	for ( int pass = 0; pass < 2; ++pass )
+	{
+		int hitCount;
+		if ( pass == 0 )
+		{
+			hitCount = b2World_OverlapAABBs( worldId, aabbs, filters, OVERLAP_BATCH_COUNT, hits, 8 * 1024 );
+		}
+		else
+		{
+			hitCount = b2World_OverlapShapes( worldId, proxies, filters, OVERLAP_BATCH_COUNT, hits, 8 * 1024 );
+		}
+
+		ENSURE( hitCount > OVERLAP_BATCH_COUNT );
+		ENSURE( hitCount <= 8 * 1024 );
+
+		int hitIndex = 0;
+		for ( int i = 0; i < OVERLAP_BATCH_COUNT; ++i )
+		{
+			OverlapBatchList list = { 0 };
+			if ( pass == 0 )
+			{
+				b2World_OverlapAABB( worldId, aabbs[i], filters[i], OverlapBatchCallback, &list );
+			}
+			else
+			{
+				b2World_OverlapShape( worldId, proxies + i, filters[i], OverlapBatchCallback, &list );
+			}
+
+			for ( int j = 0; j < list.count; ++j )
+			{
+				ENSURE( hitIndex < hitCount );
+				ENSURE( hits[hitIndex].queryIndex == i );
+				ENSURE( B2_ID_EQUALS( hits[hitIndex].shapeId, list.shapeIds[j] ) );
+				hitIndex += 1;
+			}
+		}
+
+		ENSURE( hitIndex == hitCount );
+
+		// A short results array is filled with the first results and the total is still returned
+		b2OverlapHit firstHits[10];
+		int shortCount = pass == 0 ? b2World_OverlapAABBs( worldId, aabbs, filters, OVERLAP_BATCH_COUNT, firstHits, 10 )
+								   : b2World_OverlapShapes( worldId, proxies, filters, OVERLAP_BATCH_COUNT, firstHits, 10 );
+		ENSURE( shortCount == hitCount );
+		ENSURE( memcmp( firstHits, hits, sizeof( firstHits ) ) == 0 );
+	}
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+#define CREATE_BODIES_COUNT 1000
+
+static int CreateDebris( b2WorldId worldId, b2BodyDef* bodyDefs, b2ShapeDef* shapeDefs, b2Polygon* polygons, bool bulk )
+{
+	b2BodyDef groundDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &groundDef );
+	b2ShapeDef groundShapeDef = b2DefaultShapeDef();
+	b2Segment segment = { { -100.0f, 0.0f }, { 100.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &groundShapeDef, &segment );
+
+	if ( bulk )
+	{
+		b2BodyId bodyIds[CREATE_BODIES_COUNT];
+		b2CreateBodies( worldId, bodyDefs, shapeDefs, polygons, CREATE_BODIES_COUNT, bodyIds );
+
+		for ( int i = 0; i < CREATE_BODIES_COUNT; ++i )
+		{
+			ENSURE( b2Body_IsValid( bodyIds[i] ) );
+			ENSURE( b2Body_GetType( bodyIds[i] ) == bodyDefs[i].type );
+			ENSURE( b2Body_GetShapeCount( bodyIds[i] ) == 1 );
+		}
+	}
+	else
+	{
+		for ( int i = 0; i < CREATE_BODIES_COUNT; ++i )
+		{
+			b2BodyId bodyId = b2CreateBody( worldId, bodyDefs + i );
+			b2CreatePolygonShape( bodyId, shapeDefs + i, polygons + i );
+		}
+	}
+
+	return 0;
+}
+
+// Bulk creation must produce the same bodies, shapes and contact pairs as one at a time creation
+static int TestCreateBodies( void )
+{
+	static b2BodyDef bodyDefs[CREATE_BODIES_COUNT];
+	static b2ShapeDef shapeDefs[CREATE_BODIES_COUNT];
+	static b2Polygon polygons[CREATE_BODIES_COUNT];
+
+	for ( int i = 0; i < CREATE_BODIES_COUNT; ++i )
+	{
+		b2BodyDef* bodyDef = bodyDefs + i;
+		*bodyDef = b2DefaultBodyDef();
+		bodyDef->type = ( i % 10 ) == 0 ? b2_staticBody : ( i % 10 ) == 1 ? b2_kinematicBody : b2_dynamicBody;
+		bodyDef->position = ( b2Vec2 ){ -40.0f + 0.45f * ( i % 180 ), 0.5f + 0.45f * ( i / 180 ) };
+		bodyDef->isAwake = ( i % 7 ) != 0;
+		bodyDef->isEnabled = ( i % 31 ) != 0;
+
+		shapeDefs[i] = b2DefaultShapeDef();
+		shapeDefs[i].isSensor = ( i % 53 ) == 0;
+		shapeDefs[i].enableSensorEvents = true;
+		polygons[i] = b2MakeBox( 0.25f, 0.25f );
+	}
+
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId bulkWorldId = b2CreateWorld( &worldDef );
+	b2WorldId loopWorldId = b2CreateWorld( &worldDef );
+
+	ENSURE( CreateDebris( bulkWorldId, bodyDefs, shapeDefs, polygons, true ) == 0 );
+	ENSURE( CreateDebris( loopWorldId, bodyDefs, shapeDefs, polygons, false ) == 0 );
+
+	b2Counters bulkCounters = b2World_GetCounters( bulkWorldId );
+	b2Counters loopCounters = b2World_GetCounters( loopWorldId );
+	ENSURE( bulkCounters.bodyCount == loopCounters.bodyCount );
+	ENSURE( bulkCounters.shapeCount == loopCounters.shapeCount );
+	ENSURE( bulkCounters.islandCount == loopCounters.islandCount );
+
+	b2World_Step( bulkWorldId, 1.0f / 60.0f, 4 );
+	b2World_Step( loopWorldId, 1.0f / 60.0f, 4 );
+
+	bulkCounters = b2World_GetCounters( bulkWorldId );
+	loopCounters = b2World_GetCounters( loopWorldId );
+	ENSURE( bulkCounters.contactCount > 0 );
+	ENSURE( bulkCounters.contactCount == loopCounters.contactCount );
+	ENSURE( b2World_GetContactEvents( bulkWorldId ).beginCount == b2World_GetContactEvents( loopWorldId ).beginCount );
+
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2World_Step( bulkWorldId, 1.0f / 60.0f, 4 );
+	}
+
+	b2DestroyWorld( loopWorldId );
+	b2DestroyWorld( bulkWorldId );
+
+	return 0;
+}
+
+#define DESTROY_BODIES_COLUMNS 30
+#define DESTROY_BODIES_ROWS 12
+
+static void CreateDestroyScene( b2WorldId worldId, b2BodyId* bodyIds )
+{
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Segment segment = { { -100.0f, 0.0f }, { 100.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	// Columns of boxes. Every third column is a chain of jointed boxes.
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	for ( int i = 0; i < DESTROY_BODIES_COLUMNS; ++i )
+	{
+		for ( int j = 0; j < DESTROY_BODIES_ROWS; ++j )
+		{
+			int index = i * DESTROY_BODIES_ROWS + j;
+			bodyDef.position = ( b2Vec2 ){ -30.0f + 2.0f * i, 0.5f + 1.0f * j };
+			bodyIds[index] = b2CreateBody( worldId, &bodyDef );
+			b2CreatePolygonShape( bodyIds[index], &shapeDef, &box );
+
+			if ( ( i % 3 ) == 0 && j > 0 )
+			{
+				b2RevoluteJointDef jointDef = b2DefaultRevoluteJointDef();
+				jointDef.base.bodyIdA = bodyIds[index - 1];
+				jointDef.base.bodyIdB = bodyIds[index];
+				jointDef.base.localFrameA.p = ( b2Vec2 ){ 0.0f, 0.5f };
+				jointDef.base.localFrameB.p = ( b2Vec2 ){ 0.0f, -0.5f };
+				b2CreateRevoluteJoint( worldId, &jointDef );
+			}
+		}
+	}
+}
+
+// Bulk destruction must leave the world in the same state as destroying bodies one at a time
+static int TestDestroyBodies( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId bulkWorldId = b2CreateWorld( &worldDef );
+	b2WorldId loopWorldId = b2CreateWorld( &worldDef );
+
+	static b2BodyId bulkIds[DESTROY_BODIES_COLUMNS * DESTROY_BODIES_ROWS];
+	static b2BodyId loopIds[DESTROY_BODIES_COLUMNS * DESTROY_BODIES_ROWS];
+	CreateDestroyScene( bulkWorldId, bulkIds );
+	CreateDestroyScene( loopWorldId, loopIds );
+
+	// Let the stacks settle and fall asleep
+	for ( int i = 0; i < 240; ++i )
+	{
+		b2World_Step( bulkWorldId, 1.0f / 60.0f, 4 );
+		b2World_Step( loopWorldId, 1.0f / 60.0f, 4 );
+	}
+
+	// Destroy whole columns, which drops their islands, and the top half of other columns, which
+	// splits islands and wakes them
+	static b2BodyId doomedIds[DESTROY_BODIES_COLUMNS * DESTROY_BODIES_ROWS];
+	int doomedCount = 0;
+	for ( int i = 0; i < DESTROY_BODIES_COLUMNS; ++i )
+	{
+		for ( int j = 0; j < DESTROY_BODIES_ROWS; ++j )
+		{
+			int index = i * DESTROY_BODIES_ROWS + j;
+			bool doomed = i < DESTROY_BODIES_COLUMNS / 2 || ( ( i % 2 ) == 0 && j >= DESTROY_BODIES_ROWS / 2 );
+			if ( doomed )
+			{
+				doomedIds[doomedCount] = bulkIds[index];
+				doomedCount += 1;
+				b2DestroyBody( loopIds[index] );
+			}
+		}
+	}
+
+	b2DestroyBodies( doomedIds, doomedCount );
+
+	for ( int i = 0; i < doomedCount; ++i )
+	{
+		ENSURE( b2Body_IsValid( doomedIds[i] ) == false );
+	}
+
+	for ( int pass = 0; pass < 2; ++pass )
+	{
+		b2Counters bulkCounters = b2World_GetCounters( bulkWorldId );
+		b2Counters loopCounters = b2World_GetCounters( loopWorldId );
+		ENSURE( bulkCounters.bodyCount == loopCounters.bodyCount );
+		ENSURE( bulkCounters.shapeCount == loopCounters.shapeCount );
+		ENSURE( bulkCounters.jointCount == loopCounters.jointCount );
+		ENSURE( b2World_GetAwakeBodyCount( bulkWorldId ) == b2World_GetAwakeBodyCount( loopWorldId ) );
+
+		b2World_Step( bulkWorldId, 1.0f / 60.0f, 4 );
+		b2World_Step( loopWorldId, 1.0f / 60.0f, 4 );
+	}
+
+	ENSURE( b2World_GetCounters( bulkWorldId ).contactCount == b2World_GetCounters( loopWorldId ).contactCount );
+
+	// Destroy everything that is left
+	doomedCount = 0;
+	for ( int i = 0; i < DESTROY_BODIES_COLUMNS * DESTROY_BODIES_ROWS; ++i )
+	{
+		if ( b2Body_IsValid( bulkIds[i] ) )
+		{
+			doomedIds[doomedCount] = bulkIds[i];
+			doomedCount += 1;
+		}
+	}
+
+	b2DestroyBodies( doomedIds, doomedCount );
+	b2World_Step( bulkWorldId, 1.0f / 60.0f, 4 );
+
+	b2Counters counters = b2World_GetCounters( bulkWorldId );
+	ENSURE( counters.bodyCount == 1 );
+	ENSURE( counters.jointCount == 0 );
+	ENSURE( counters.contactCount == 0 );
+
+	b2DestroyWorld( loopWorldId );
+	b2DestroyWorld( bulkWorldId );
+
+	return 0;
+}
+
+#define BODY_STATES_COUNT 3000
+
+// The bulk readback must match the single body getters
+static int TestBodyStates( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	static b2BodyId bodyIds[BODY_STATES_COUNT];
+	b2Polygon box = b2MakeBox( 0.25f, 0.25f );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	for ( int i = 0; i < BODY_STATES_COUNT; ++i )
+	{
+		b2BodyDef bodyDef = b2DefaultBodyDef();
+		bodyDef.type = ( i % 9 ) == 0 ? b2_staticBody : b2_dynamicBody;
+		bodyDef.isAwake = ( i % 5 ) != 0;
+		bodyDef.position = ( b2Vec2 ){ 0.6f * ( i % 100 ), 0.6f * ( i / 100 ) };
+		bodyDef.rotation = b2MakeRot( 0.01f * i );
+		bodyDef.linearVelocity = ( b2Vec2 ){ 0.1f * ( i % 7 ), -0.2f * ( i % 3 ) };
+		bodyDef.angularVelocity = 0.05f * ( i % 11 );
+		bodyDef.gravityScale = 0.0f;
+		bodyIds[i] = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyIds[i], &shapeDef, &box );
+	}
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+	static b2Vec2 positions[BODY_STATES_COUNT];
+	static b2Rot rotations[BODY_STATES_COUNT];
+	static b2Vec2 linearVelocities[BODY_STATES_COUNT];
+	static float angularVelocities[BODY_STATES_COUNT];
+	b2BodyStateArrays arrays = { positions, rotations, linearVelocities, angularVelocities };
+
+	b2World_GetBodyStates( worldId, bodyIds, BODY_STATES_COUNT, &arrays );
+
+	int awakeCount = 0;
+	for ( int i = 0; i < BODY_STATES_COUNT; ++i )
+	{
+		b2Transform transform = b2Body_GetTransform( bodyIds[i] );
+		b2Vec2 linearVelocity = b2Body_GetLinearVelocity( bodyIds[i] );
+		ENSURE( positions[i].x == transform.p.x && positions[i].y == transform.p.y );
+		ENSURE( rotations[i].c == transform.q.c && rotations[i].s == transform.q.s );
+		ENSURE( linearVelocities[i].x == linearVelocity.x && linearVelocities[i].y == linearVelocity.y );
+		ENSURE( angularVelocities[i] == b2Body_GetAngularVelocity( bodyIds[i] ) );
+		awakeCount += b2Body_IsAwake( bodyIds[i] ) ? 1 : 0;
+	}
+
+	ENSURE( awakeCount == b2World_GetAwakeBodyCount( worldId ) );
+	ENSURE( 0 < awakeCount && awakeCount < BODY_STATES_COUNT );
+
+	// Skipped arrays are not written
+	b2BodyStateArrays positionsOnly = { positions, NULL, NULL, NULL };
+	b2World_GetBodyStates( worldId, bodyIds, BODY_STATES_COUNT, &positionsOnly );
+
+	static b2BodyId awakeIds[BODY_STATES_COUNT];
+	int count = b2World_GetAwakeBodyStates( worldId, awakeIds, BODY_STATES_COUNT, &arrays );
+	ENSURE( count == awakeCount );
+
+	for ( int i = 0; i < count; ++i )
+	{
+		ENSURE( b2Body_IsAwake( awakeIds[i] ) );
+		b2Transform transform = b2Body_GetTransform( awakeIds[i] );
+		b2Vec2 linearVelocity = b2Body_GetLinearVelocity( awakeIds[i] );
+		ENSURE( positions[i].x == transform.p.x && positions[i].y == transform.p.y );
+		ENSURE( rotations[i].c == transform.q.c && rotations[i].s == transform.q.s );
+		ENSURE( linearVelocities[i].x == linearVelocity.x && linearVelocities[i].y == linearVelocity.y );
+		ENSURE( angularVelocities[i] == b2Body_GetAngularVelocity( awakeIds[i] ) );
+	}
+
+	// A short capacity still reports the awake count
+	ENSURE( b2World_GetAwakeBodyStates( worldId, awakeIds, 10, &positionsOnly ) == awakeCount );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+#define BODY_COMMAND_COUNT 64
+
+static void CreateCommandScene( b2WorldId worldId, b2BodyId* bodyIds )
+{
+	b2Circle circle = { { 0.0f, 0.0f }, 0.25f };
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	for ( int i = 0; i < BODY_COMMAND_COUNT; ++i )
+	{
+		b2BodyDef bodyDef = b2DefaultBodyDef();
+		bodyDef.type = ( i % 8 ) == 7 ? b2_kinematicBody : b2_dynamicBody;
+		bodyDef.isAwake = ( i % 3 ) != 0;
+		bodyDef.position = ( b2Vec2 ){ 2.0f * i, 0.0f };
+		bodyDef.gravityScale = 0.0f;
+		bodyIds[i] = b2CreateBody( worldId, &bodyDef );
+		b2CreateCircleShape( bodyIds[i], &shapeDef, &circle );
+	}
+}
+
+// Queued commands must match the immediate body functions
+static int TestBodyCommands( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+	b2WorldId referenceId = b2CreateWorld( &worldDef );
+	b2WorldId queuedId = b2CreateWorld( &worldDef );
+
+	b2BodyId referenceIds[BODY_COMMAND_COUNT];
+	b2BodyId queuedIds[BODY_COMMAND_COUNT];
+	CreateCommandScene( referenceId, referenceIds );
+	CreateCommandScene( queuedId, queuedIds );
+
+	b2BodyCommand commands[3 * BODY_COMMAND_COUNT];
+	int commandCount = 0;
+	for ( int i = 0; i < BODY_COMMAND_COUNT; ++i )
+	{
+		// Some sleeping bodies are not woken so their commands are dropped
+		bool wake = ( i % 6 ) != 0;
+		b2Vec2 force = { 10.0f + i, -5.0f };
+		b2Vec2 impulse = { -0.5f, 0.25f * i };
+		b2Vec2 point = { 2.0f * i + 0.1f, 0.2f };
+		b2Vec2 velocity = { 0.0f, 1.0f };
+
+		b2Body_ApplyForce( referenceIds[i], force, point, wake );
+		commands[commandCount++] = ( b2BodyCommand ){ queuedIds[i], force, point, b2_bodyForce, wake };
+
+		b2Body_ApplyLinearImpulse( referenceIds[i], impulse, point, wake );
+		commands[commandCount++] = ( b2BodyCommand ){ queuedIds[i], impulse, point, b2_bodyLinearImpulse, wake };
+
+		if ( ( i % 4 ) == 0 && b2Body_IsAwake( referenceIds[i] ) )
+		{
+			b2Body_SetLinearVelocity( referenceIds[i], velocity );
+			commands[commandCount++] = ( b2BodyCommand ){ queuedIds[i], velocity, b2Vec2_zero, b2_bodyLinearVelocity, true };
+		}
+	}
+
+	// Commands on the same body are split across buffers and applied in buffer order
+	int half = commandCount / 2;
+	b2World_QueueBodyCommands( queuedId, 0, commands, half );
+	b2World_QueueBodyCommands( queuedId, 3, commands + half, commandCount - half );
+
+	// Nothing is applied before the step
+	ENSURE( b2World_GetAwakeBodyCount( queuedId ) < b2World_GetAwakeBodyCount( referenceId ) );
+
+	b2World_Step( referenceId, 1.0f / 60.0f, 4 );
+	b2World_Step( queuedId, 1.0f / 60.0f, 4 );
+
+	ENSURE( b2World_GetAwakeBodyCount( queuedId ) == b2World_GetAwakeBodyCount( referenceId ) );
+
+	for ( int i = 0; i < BODY_COMMAND_COUNT; ++i )
+	{
+		b2Transform xf1 = b2Body_GetTransform( referenceIds[i] );
+		b2Transform xf2 = b2Body_GetTransform( queuedIds[i] );
+		b2Vec2 v1 = b2Body_GetLinearVelocity( referenceIds[i] );
+		b2Vec2 v2 = b2Body_GetLinearVelocity( queuedIds[i] );
+		ENSURE( xf1.p.x == xf2.p.x && xf1.p.y == xf2.p.y );
+		ENSURE( xf1.q.c == xf2.q.c && xf1.q.s == xf2.q.s );
+		ENSURE( v1.x == v2.x && v1.y == v2.y );
+		ENSURE( b2Body_GetAngularVelocity( referenceIds[i] ) == b2Body_GetAngularVelocity( queuedIds[i] ) );
+	}
+
+	// Commands on destroyed bodies are skipped
+	b2BodyCommand stale = { queuedIds[1], { 0.0f, 1.0f }, b2Vec2_zero, b2_bodyLinearVelocity, true };
+	b2World_QueueBodyCommands( queuedId, 1, &stale, 1 );
+	b2DestroyBody( queuedIds[1] );
+	b2World_Step( queuedId, 1.0f / 60.0f, 4 );
+
+	// Pending commands survive a worker count change
+	b2BodyCommand push = { queuedIds[2], { 0.0f, 3.0f }, b2Vec2_zero, b2_bodyLinearVelocity, true };
+	b2World_QueueBodyCommands( queuedId, 2, &push, 1 );
+	b2World_SetWorkerCount( queuedId, 2 );
+	b2Vec2 v = b2Body_GetLinearVelocity( queuedIds[2] );
+	ENSURE( v.x == 0.0f && v.y == 3.0f );
+
+	b2DestroyWorld( referenceId );
+	b2DestroyWorld( queuedId );
+
+	return 0;
+}
+
+#define SOLVE_MOVER_COUNT 103
+
+typedef struct MoverPlanes
+{
+	b2CollisionPlane planes[8];
+	int count;
+} MoverPlanes;
+
+static bool MoverPlaneCallback( b2ShapeId shapeId, const b2PlaneResult* result, void* context )
+{
+	(void)shapeId;
+	MoverPlanes* moverPlanes = context;
+	moverPlanes->planes[moverPlanes->count] = ( b2CollisionPlane ){ result->plane, FLT_MAX, 0.0f, true };
+	moverPlanes->count += 1;
+	return moverPlanes->count < 8;
+}
+
+// The batched movers must land exactly where the single mover functions put them
+static int TestSolveMovers( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+
+	b2Segment floor = { { -50.0f, 0.0f }, { 50.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &floor );
+
+	for ( int i = 0; i < 20; ++i )
+	{
+		b2Vec2 center = { -45.0f + 5.0f * i, 0.5f * ( i % 3 ) };
+		b2Polygon box = b2MakeOffsetBox( 1.0f, 1.0f + 0.25f * ( i % 4 ), center, b2MakeRot( 0.2f * ( i % 5 ) ) );
+		b2CreatePolygonShape( groundId, &shapeDef, &box );
+	}
+
+	b2Capsule movers[SOLVE_MOVER_COUNT];
+	b2Capsule expectedMovers[SOLVE_MOVER_COUNT];
+	b2Vec2 translations[SOLVE_MOVER_COUNT];
+	b2Vec2 velocities[SOLVE_MOVER_COUNT];
+	b2Vec2 expectedVelocities[SOLVE_MOVER_COUNT];
+	for ( int i = 0; i < SOLVE_MOVER_COUNT; ++i )
+	{
+		float x = -48.0f + 0.93f * i;
+		float y = 0.3f + 0.4f * ( i % 6 );
+		movers[i] = ( b2Capsule ){ { x, y }, { x, y + 1.0f }, 0.3f };
+		translations[i] = ( b2Vec2 ){ 1.5f * ( ( i % 2 ) == 0 ? 1.0f : -1.0f ), -0.8f - 0.1f * ( i % 4 ) };
+		velocities[i] = b2MulSV( 60.0f, translations[i] );
+		expectedMovers[i] = movers[i];
+		expectedVelocities[i] = velocities[i];
+	}
+
+	b2QueryFilter filter = b2DefaultQueryFilter();
+
+	for ( int i = 0; i < SOLVE_MOVER_COUNT; ++i )
+	{
+		b2Capsule* mover = expectedMovers + i;
+		b2Vec2 target = b2Add( mover->center1, translations[i] );
+		MoverPlanes moverPlanes = { 0 };
+
+		for ( int iteration = 0; iteration < 5; ++iteration )
+		{
+			moverPlanes.count = 0;
+			b2World_CollideMover( worldId, mover, filter, MoverPlaneCallback, &moverPlanes );
+			b2PlaneSolverResult result =
+				b2SolvePlanes( b2Sub( target, mover->center1 ), moverPlanes.planes, moverPlanes.count );
+			float fraction = b2World_CastMover( worldId, mover, result.translation, filter );
+
+			b2Vec2 delta = b2MulSV( fraction, result.translation );
+			mover->center1 = b2Add( mover->center1, delta );
+			mover->center2 = b2Add( mover->center2, delta );
+
+			if ( b2LengthSquared( delta ) < 0.01f * 0.01f )
+			{
+				break;
+			}
+		}
+
+		expectedVelocities[i] = b2ClipVector( expectedVelocities[i], moverPlanes.planes, moverPlanes.count );
+	}
+
+	b2World_SolveMovers( worldId, movers, translations, velocities, SOLVE_MOVER_COUNT, filter, filter );
+
+	int blockedCount = 0;
+	for ( int i = 0; i < SOLVE_MOVER_COUNT; ++i )
+	{
+		ENSURE( movers[i].center1.x == expectedMovers[i].center1.x );
+		ENSURE( movers[i].center1.y == expectedMovers[i].center1.y );
+		ENSURE( movers[i].center2.x == expectedMovers[i].center2.x );
+		ENSURE( movers[i].center2.y == expectedMovers[i].center2.y );
+		ENSURE( velocities[i].x == expectedVelocities[i].x );
+		ENSURE( velocities[i].y == expectedVelocities[i].y );
+
+		// Movers stay above the floor
+		ENSURE( movers[i].center1.y > 0.25f );
+
+		if ( b2Distance( velocities[i], b2MulSV( 60.0f, translations[i] ) ) > 1.0f )
+		{
+			blockedCount += 1;
+		}
+	}
+
+	// The scene must actually push movers around
+	ENSURE( blockedCount > SOLVE_MOVER_COUNT / 4 );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+#define PARALLEL_REFIT_BODY_COUNT 600
+
+// Falling bodies enlarge hundreds of proxies each step, which uses the parallel refit with
+// multiple workers. The simulation and the dynamic tree must match the serial refit.
+static int TestParallelRefit( void )
+{
+	b2Vec2 positions[2][PARALLEL_REFIT_BODY_COUNT];
+	StaticQueryList lists[2] = { 0 };
+	int workerCounts[2] = { 1, 4 };
+
+	for ( int i = 0; i < 2; ++i )
+	{
+		b2WorldDef worldDef = b2DefaultWorldDef();
+		worldDef.workerCount = workerCounts[i];
+		b2WorldId worldId = b2CreateWorld( &worldDef );
+
+		b2BodyDef bodyDef = b2DefaultBodyDef();
+		b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+		b2Segment segment = { { -100.0f, 0.0f }, { 100.0f, 0.0f } };
+		b2ShapeDef shapeDef = b2DefaultShapeDef();
+		b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+		bodyDef.type = b2_dynamicBody;
+		b2Polygon box = b2MakeBox( 0.4f, 0.4f );
+		b2BodyId bodyIds[PARALLEL_REFIT_BODY_COUNT];
+		for ( int j = 0; j < PARALLEL_REFIT_BODY_COUNT; ++j )
+		{
+			bodyDef.position = ( b2Vec2 ){ -60.0f + 1.0f * ( j % 120 ) + 0.1f * ( j % 3 ), 2.0f + 1.0f * ( j / 120 ) };
+			bodyIds[j] = b2CreateBody( worldId, &bodyDef );
+			b2CreatePolygonShape( bodyIds[j], &shapeDef, &box );
+		}
+
+		for ( int j = 0; j < 60; ++j )
+		{
+			b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		}
+
+		for ( int j = 0; j < PARALLEL_REFIT_BODY_COUNT; ++j )
+		{
+			positions[i][j] = b2Body_GetPosition( bodyIds[j] );
+		}
+
+		b2AABB aabb = { { -30.0f, 0.0f }, { 30.0f, 10.0f } };
+		b2World_OverlapAABB( worldId, aabb, b2DefaultQueryFilter(), StaticQueryCallback, lists + i );
+
+		b2DestroyWorld( worldId );
+	}
+
+	ENSURE( memcmp( positions[0], positions[1], sizeof( positions[0] ) ) == 0 );
+	ENSURE( lists[0].count > 100 );
+	ENSURE( lists[0].count == lists[1].count );
+	ENSURE( memcmp( lists[0].shapeIndices, lists[1].shapeIndices, lists[0].count * sizeof( int ) ) == 0 );
+
+	return 0;
+}
+
+#define CHAIN_TERRAIN_POINT_COUNT 4000
+#define CHAIN_TERRAIN_BOX_COUNT 20
+
+// Large chains insert their segments into the broad-phase as one batch
+static int TestChainTerrain( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	static b2Vec2 points[CHAIN_TERRAIN_POINT_COUNT];
+	for ( int i = 0; i < CHAIN_TERRAIN_POINT_COUNT; ++i )
+	{
+		// Right to left so the one-sided segments face up
+		float x = 0.25f * CHAIN_TERRAIN_POINT_COUNT - 0.5f * i;
+		points[i] = (b2Vec2){ x, 0.25f * sinf( 0.3f * x ) };
+	}
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+
+	b2ChainDef chainDef = b2DefaultChainDef();
+	chainDef.points = points;
+	chainDef.count = CHAIN_TERRAIN_POINT_COUNT;
+	b2ChainId chainId = b2CreateChain( groundId, &chainDef );
+	ENSURE( b2Chain_GetSegmentCount( chainId ) == CHAIN_TERRAIN_POINT_COUNT - 3 );
+
+	b2Counters counters = b2World_GetCounters( worldId );
+	ENSURE( counters.shapeCount == CHAIN_TERRAIN_POINT_COUNT - 3 );
+
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2BodyId bodyIds[CHAIN_TERRAIN_BOX_COUNT];
+	for ( int i = 0; i < CHAIN_TERRAIN_BOX_COUNT; ++i )
+	{
+		bodyDef.position = (b2Vec2){ -200.0f + 20.0f * i, 2.0f };
+		bodyIds[i] = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyIds[i], &shapeDef, &box );
+	}
+
+	for ( int i = 0; i < 120; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	// Every box lands on the terrain
+	for ( int i = 0; i < CHAIN_TERRAIN_BOX_COUNT; ++i )
+	{
+		b2Vec2 p = b2Body_GetPosition( bodyIds[i] );
+		ENSURE( -0.5f < p.y && p.y < 1.0f );
+	}
+
+	ENSURE( b2World_GetCounters( worldId ).contactCount >= CHAIN_TERRAIN_BOX_COUNT );
+
+	// Destroying the chain removes the segment contacts and wakes the boxes
+	b2DestroyChain( chainId );
+	counters = b2World_GetCounters( worldId );
+	ENSURE( counters.shapeCount == CHAIN_TERRAIN_BOX_COUNT );
+	ENSURE( counters.contactCount == 0 );
+
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	for ( int i = 0; i < CHAIN_TERRAIN_BOX_COUNT; ++i )
+	{
+		ENSURE( b2Body_GetPosition( bodyIds[i] ).y < -1.0f );
+	}
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+#define TILE_COUNT 4
+#define TILE_BLOCK_COUNT 100
+
+static bool CountTileOverlaps( b2ShapeId shapeId, void* context )
+{
+	(void)shapeId;
+	int* count = context;
+	*count += 1;
+	return true;
+}
+
+// Static tiles are loaded and unloaded as a unit and collide like regular static shapes
+static int TestStaticTiles( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	// Prepare the tiles without a world
+	b2StaticTile tiles[TILE_COUNT];
+	for ( int i = 0; i < TILE_COUNT; ++i )
+	{
+		b2BodyDef bodyDef = b2DefaultBodyDef();
+		bodyDef.position = (b2Vec2){ 50.0f * i, 0.0f };
+
+		b2Polygon blocks[TILE_BLOCK_COUNT];
+		for ( int j = 0; j < TILE_BLOCK_COUNT; ++j )
+		{
+			blocks[j] = b2MakeOffsetBox( 0.25f, 0.5f, (b2Vec2){ -25.0f + 0.5f * j, -0.5f }, b2Rot_identity );
+		}
+
+		b2ShapeDef shapeDef = b2DefaultShapeDef();
+		tiles[i] = b2MakeStaticTile( &bodyDef, &shapeDef, blocks, TILE_BLOCK_COUNT );
+	}
+
+	b2BodyId tileIds[TILE_COUNT];
+	for ( int i = 0; i < TILE_COUNT; ++i )
+	{
+		tileIds[i] = b2CreateTileBody( worldId, tiles + i );
+		ENSURE( b2Body_GetShapeCount( tileIds[i] ) == TILE_BLOCK_COUNT );
+	}
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2BodyId bodyIds[TILE_COUNT];
+	for ( int i = 0; i < TILE_COUNT; ++i )
+	{
+		bodyDef.position = (b2Vec2){ 50.0f * i + 3.0f, 2.0f };
+		bodyIds[i] = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyIds[i], &shapeDef, &box );
+	}
+
+	for ( int i = 0; i < 90; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	for ( int i = 0; i < TILE_COUNT; ++i )
+	{
+		b2Vec2 p = b2Body_GetPosition( bodyIds[i] );
+		ENSURE( 0.4f < p.y && p.y < 0.6f );
+	}
+
+	// Unload a tile, the box on it falls and the other boxes stay
+	b2DestroyBody( tileIds[1] );
+	b2Counters counters = b2World_GetCounters( worldId );
+	ENSURE( counters.shapeCount == ( TILE_COUNT - 1 ) * TILE_BLOCK_COUNT + TILE_COUNT );
+
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	ENSURE( b2Body_GetPosition( bodyIds[1] ).y < -1.0f );
+	ENSURE( b2Body_GetPosition( bodyIds[2] ).y > 0.4f );
+
+	// Reload the tile, it can be queried again
+	tileIds[1] = b2CreateTileBody( worldId, tiles + 1 );
+	b2AABB aabb = { { 45.0f, -0.5f }, { 55.0f, -0.4f } };
+	int overlapCount = 0;
+	b2World_OverlapAABB( worldId, aabb, b2DefaultQueryFilter(), CountTileOverlaps, &overlapCount );
+	ENSURE( overlapCount == 21 );
+
+	for ( int i = 0; i < TILE_COUNT; ++i )
+	{
+		b2DestroyBody( tileIds[i] );
+		b2DestroyStaticTile( tiles + i );
+	}
+
+	counters = b2World_GetCounters( worldId );
+	ENSURE( counters.shapeCount == TILE_COUNT );
+	ENSURE( counters.staticTreeHeight == 0 );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+static b2ChainId CreateBakeLevel( b2WorldId worldId )
+{
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+
+	b2Vec2 points[] = { { 40.0f, 0.0f }, { -40.0f, 0.0f }, { -40.0f, 20.0f }, { 40.0f, 20.0f } };
+	b2ChainDef chainDef = b2DefaultChainDef();
+	chainDef.points = points;
+	chainDef.count = 4;
+	chainDef.isLoop = true;
+	b2ChainId chainId = b2CreateChain( groundId, &chainDef );
+
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	for ( int i = 0; i < 50; ++i )
+	{
+		bodyDef.position = (b2Vec2){ -30.0f + 1.2f * i, 0.25f * ( i % 3 ) };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2Polygon box = b2MakeBox( 0.5f, 0.25f );
+		b2CreatePolygonShape( bodyId, &shapeDef, &box );
+	}
+
+	shapeDef.isSensor = true;
+	b2Circle circle = { { 0.0f, 5.0f }, 1.0f };
+	b2CreateCircleShape( groundId, &shapeDef, &circle );
+
+	return chainId;
+}
+
+static b2BodyId DropBakeBox( b2WorldId worldId )
+{
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position = (b2Vec2){ 0.3f, 4.0f };
+	b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	shapeDef.enableSensorEvents = true;
+	b2CreatePolygonShape( bodyId, &shapeDef, &box );
+
+	for ( int i = 0; i < 90; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	return bodyId;
+}
+
+// A baked level loads with the same ids and simulates the same as the level it was baked from
+static int TestBakeStatic( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId sourceId = b2CreateWorld( &worldDef );
+	b2ChainId chainId = CreateBakeLevel( sourceId );
+
+	int size = b2World_BakeStatic( sourceId, NULL, 0 );
+	ENSURE( size > 0 );
+	void* data = malloc( size );
+	ENSURE( b2World_BakeStatic( sourceId, data, size - 1 ) == 0 );
+	ENSURE( b2World_BakeStatic( sourceId, data, size ) == size );
+
+	b2WorldId loadedId = b2CreateWorld( &worldDef );
+	ENSURE( b2World_LoadStatic( loadedId, data, size - 1 ) == false );
+	ENSURE( b2World_LoadStatic( loadedId, data, size ) );
+	ENSURE( b2World_LoadStatic( loadedId, data, size ) == false );
+
+	b2ChainId loadedChainId = chainId;
+	loadedChainId.world0 = (uint16_t)( loadedId.index1 - 1 );
+	ENSURE( b2Chain_IsValid( loadedChainId ) );
+	ENSURE( b2Chain_GetSegmentCount( loadedChainId ) == 4 );
+
+	b2Counters sourceCounters = b2World_GetCounters( sourceId );
+	b2Counters loadedCounters = b2World_GetCounters( loadedId );
+	ENSURE( loadedCounters.bodyCount == sourceCounters.bodyCount );
+	ENSURE( loadedCounters.shapeCount == sourceCounters.shapeCount );
+	ENSURE( loadedCounters.staticTreeHeight == sourceCounters.staticTreeHeight );
+
+	b2BodyId sourceBoxId = DropBakeBox( sourceId );
+	b2BodyId loadedBoxId = DropBakeBox( loadedId );
+	b2Transform sourceTransform = b2Body_GetTransform( sourceBoxId );
+	b2Transform loadedTransform = b2Body_GetTransform( loadedBoxId );
+	ENSURE( memcmp( &sourceTransform, &loadedTransform, sizeof( b2Transform ) ) == 0 );
+	ENSURE( b2World_GetSensorEvents( loadedId ).beginCount == b2World_GetSensorEvents( sourceId ).beginCount );
+
+	// Only static worlds can be baked
+	ENSURE( b2World_BakeStatic( sourceId, NULL, 0 ) == 0 );
+
+	free( data );
+	b2DestroyWorld( sourceId );
+	b2DestroyWorld( loadedId );
+
+	// Nor can compounds, their geometry is a pointer
+	b2WorldId compoundWorldId = b2CreateWorld( &worldDef );
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId bodyId = b2CreateBody( compoundWorldId, &bodyDef );
+	b2Polygon box = b2MakeBox( 1.0f, 1.0f );
+	b2Compound* compound = b2CreateCompound( &box, 1 );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2ShapeId compoundShapeId = b2CreateCompoundShape( bodyId, &shapeDef, compound );
+	ENSURE( b2World_BakeStatic( compoundWorldId, NULL, 0 ) == 0 );
+
+	b2DestroyShape( compoundShapeId, false );
+	ENSURE( b2World_BakeStatic( compoundWorldId, NULL, 0 ) > 0 );
+
+	b2DestroyWorld( compoundWorldId );
+	b2DestroyCompound( compound );
+
+	return 0;
+}
+
+#define SPLIT_PAIR_COUNT 8
+
+// Number of steps for all bodies to sleep after the joints holding pairs of bodies together are destroyed.
+// Each pair is left in an island that must be split before its bodies can sleep.
+static int StepsToSleepAfterSplits( int maxIslandSplits )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.gravity = b2Vec2_zero;
+	worldDef.maxIslandSplits = maxIslandSplits;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.25f, 0.25f );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+
+	b2JointId jointIds[SPLIT_PAIR_COUNT];
+	for ( int i = 0; i < SPLIT_PAIR_COUNT; ++i )
+	{
+		bodyDef.position = (b2Vec2){ 3.0f * i, 0.0f };
+		b2BodyId bodyIdA = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyIdA, &shapeDef, &box );
+
+		bodyDef.position = (b2Vec2){ 3.0f * i + 1.0f, 0.0f };
+		b2BodyId bodyIdB = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyIdB, &shapeDef, &box );
+
+		b2DistanceJointDef jointDef = b2DefaultDistanceJointDef();
+		jointDef.base.bodyIdA = bodyIdA;
+		jointDef.base.bodyIdB = bodyIdB;
+		jointDef.length = 1.0f;
+		jointIds[i] = b2CreateDistanceJoint( worldId, &jointDef );
+	}
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+	for ( int i = 0; i < SPLIT_PAIR_COUNT; ++i )
+	{
+		b2DestroyJoint( jointIds[i], false );
+	}
+
+	int stepCount = 0;
+	while ( b2World_GetAwakeBodyCount( worldId ) > 0 && stepCount < 200 )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		stepCount += 1;
+	}
+
+	b2DestroyWorld( worldId );
+	return stepCount;
+}
+
+static int TestIslandSplits( void )
+{
+	int serialSteps = StepsToSleepAfterSplits( 1 );
+	int parallelSteps = StepsToSleepAfterSplits( SPLIT_PAIR_COUNT );
+	ENSURE( serialSteps < 200 );
+
+	// One split per step delays sleep by a step for each extra island
+	ENSURE( parallelSteps + SPLIT_PAIR_COUNT - 1 <= serialSteps );
+
+	return 0;
+}
+
+#define SLEEPY_PAIR_COUNT 16
+
+// A restless island keeps losing a joint and holds the sleepiest body, a resting body tied to a spinning one.
+// Islands that are ready to sleep as a whole get their splits first.
+static int TestSleepyIslandSplits( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.gravity = b2Vec2_zero;
+	worldDef.maxIslandSplits = 1;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.25f, 0.25f );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+
+	bodyDef.position = (b2Vec2){ 0.0f, 10.0f };
+	b2BodyId restingId = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( restingId, &shapeDef, &box );
+
+	bodyDef.position = (b2Vec2){ 1.0f, 10.0f };
+	bodyDef.angularVelocity = 5.0f;
+	b2BodyId spinningId = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( spinningId, &shapeDef, &box );
+	bodyDef.angularVelocity = 0.0f;
+
+	b2DistanceJointDef jointDef = b2DefaultDistanceJointDef();
+	jointDef.base.bodyIdA = restingId;
+	jointDef.base.bodyIdB = spinningId;
+	jointDef.length = 1.0f;
+	b2CreateDistanceJoint( worldId, &jointDef );
+
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2DestroyJoint( b2CreateDistanceJoint( worldId, &jointDef ), false );
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	b2BodyId pairIds[2 * SLEEPY_PAIR_COUNT];
+	b2JointId jointIds[SLEEPY_PAIR_COUNT];
+	for ( int i = 0; i < SLEEPY_PAIR_COUNT; ++i )
+	{
+		bodyDef.position = (b2Vec2){ 3.0f * i, 0.0f };
+		pairIds[2 * i] = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( pairIds[2 * i], &shapeDef, &box );
+
+		bodyDef.position = (b2Vec2){ 3.0f * i + 1.0f, 0.0f };
+		pairIds[2 * i + 1] = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( pairIds[2 * i + 1], &shapeDef, &box );
+
+		b2DistanceJointDef pairDef = b2DefaultDistanceJointDef();
+		pairDef.base.bodyIdA = pairIds[2 * i];
+		pairDef.base.bodyIdB = pairIds[2 * i + 1];
+		pairDef.length = 1.0f;
+		jointIds[i] = b2CreateDistanceJoint( worldId, &pairDef );
+	}
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+	for ( int i = 0; i < SLEEPY_PAIR_COUNT; ++i )
+	{
+		b2DestroyJoint( jointIds[i], false );
+	}
+
+	// The pairs rest for half a second before they are ready to sleep, then take one split per step. The
+	// restless island takes every other split if it competes with them.
+	for ( int i = 0; i < 30 + SLEEPY_PAIR_COUNT + 4; ++i )
+	{
+		b2DestroyJoint( b2CreateDistanceJoint( worldId, &jointDef ), false );
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	ENSURE( b2Body_IsAwake( spinningId ) );
+	for ( int i = 0; i < 2 * SLEEPY_PAIR_COUNT; ++i )
+	{
+		ENSURE( b2Body_IsAwake( pairIds[i] ) == false );
+	}
+
+	b2DestroyWorld( worldId );
+	return 0;
+}
+
+#define ISLAND_CHAIN_COUNT 24
+
+// Island count once everything sleeps after cutting joints of a chain of bodies. The ends of the chain
+// are joined when loop is true. Returns -1 if the bodies don't fall asleep.
+static int IslandCountAfterCuts( bool incremental, bool loop, const int* cuts, int cutCount )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.gravity = b2Vec2_zero;
+	worldDef.enableIncrementalIslands = incremental;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.25f, 0.25f );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+
+	b2BodyId bodyIds[ISLAND_CHAIN_COUNT];
+	for ( int i = 0; i < ISLAND_CHAIN_COUNT; ++i )
+	{
+		bodyDef.position = (b2Vec2){ 1.0f * i, 0.0f };
+		bodyIds[i] = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyIds[i], &shapeDef, &box );
+	}
+
+	b2JointId jointIds[ISLAND_CHAIN_COUNT];
+	int jointCount = loop ? ISLAND_CHAIN_COUNT : ISLAND_CHAIN_COUNT - 1;
+	for ( int i = 0; i < jointCount; ++i )
+	{
+		b2DistanceJointDef jointDef = b2DefaultDistanceJointDef();
+		jointDef.base.bodyIdA = bodyIds[i];
+		jointDef.base.bodyIdB = bodyIds[( i + 1 ) % ISLAND_CHAIN_COUNT];
+		jointDef.length = i + 1 < ISLAND_CHAIN_COUNT ? 1.0f : ISLAND_CHAIN_COUNT - 1.0f;
+		jointIds[i] = b2CreateDistanceJoint( worldId, &jointDef );
+	}
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+	for ( int i = 0; i < cutCount; ++i )
+	{
+		b2DestroyJoint( jointIds[cuts[i]], false );
+	}
+
+	int stepCount = 0;
+	while ( b2World_GetAwakeBodyCount( worldId ) > 0 && stepCount < 300 )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		stepCount += 1;
+	}
+
+	int islandCount = b2World_GetAwakeBodyCount( worldId ) == 0 ? b2World_GetCounters( worldId ).islandCount : -1;
+	b2DestroyWorld( worldId );
+	return islandCount;
+}
+
+static int TestIncrementalIslands( void )
+{
+	int chainCuts[] = { 12, 5 };
+	int loopCut[] = { 7 };
+	int loopCuts[] = { 3, 15 };
+	int allCuts[ISLAND_CHAIN_COUNT - 1];
+	for ( int i = 0; i < ISLAND_CHAIN_COUNT - 1; ++i )
+	{
+		allCuts[i] = ( 7 * i ) % ( ISLAND_CHAIN_COUNT - 1 );
+	}
+
+	for ( int i = 0; i < 2; ++i )
+	{
+		bool incremental = i == 1;
+		ENSURE( IslandCountAfterCuts( incremental, false, chainCuts, ARRAY_COUNT( chainCuts ) ) == 3 );
+		ENSURE( IslandCountAfterCuts( incremental, true, loopCut, ARRAY_COUNT( loopCut ) ) == 1 );
+		ENSURE( IslandCountAfterCuts( incremental, true, loopCuts, ARRAY_COUNT( loopCuts ) ) == 2 );
+		ENSURE( IslandCountAfterCuts( incremental, false, allCuts, ARRAY_COUNT( allCuts ) ) == ISLAND_CHAIN_COUNT );
+	}
+
+	return 0;
+}
+
+#define WAKE_STACK_COUNT 10
+
+// A stack and a jointed pair go to sleep and are woken by an explosion several times. Waking moves
+// whole solver sets back into the awake set and the constraint graph in bulk.
+static int TestSleepWakeCycles( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2Segment segment = { { -20.0f, 0.0f }, { 20.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	b2BodyId stackIds[WAKE_STACK_COUNT];
+	for ( int i = 0; i < WAKE_STACK_COUNT; ++i )
+	{
+		bodyDef.position = (b2Vec2){ 0.0f, 0.5f + 1.0f * i };
+		stackIds[i] = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( stackIds[i], &shapeDef, &box );
+	}
+
+	bodyDef.position = (b2Vec2){ 8.0f, 0.5f };
+	b2BodyId bodyIdA = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( bodyIdA, &shapeDef, &box );
+	bodyDef.position = (b2Vec2){ 10.0f, 0.5f };
+	b2BodyId bodyIdB = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( bodyIdB, &shapeDef, &box );
+
+	b2DistanceJointDef jointDef = b2DefaultDistanceJointDef();
+	jointDef.base.bodyIdA = bodyIdA;
+	jointDef.base.bodyIdB = bodyIdB;
+	jointDef.length = 2.0f;
+	b2CreateDistanceJoint( worldId, &jointDef );
+
+	int bodyCount = WAKE_STACK_COUNT + 2;
+
+	for ( int cycle = 0; cycle < 3; ++cycle )
+	{
+		int stepCount = 0;
+		while ( b2World_GetAwakeBodyCount( worldId ) > 0 && stepCount < 1000 )
+		{
+			b2World_Step( worldId, 1.0f / 60.0f, 4 );
+			stepCount += 1;
+		}
+
+		ENSURE( b2World_GetAwakeBodyCount( worldId ) == 0 );
+		ENSURE( b2Body_IsAwake( stackIds[0] ) == false );
+
+		b2Counters sleepCounters = b2World_GetCounters( worldId );
+
+		// A weak explosion wakes both islands without toppling the stack
+		b2ExplosionDef explosionDef = b2DefaultExplosionDef();
+		explosionDef.position = (b2Vec2){ 4.0f, 0.5f };
+		explosionDef.radius = 10.0f;
+		explosionDef.falloff = 0.0f;
+		explosionDef.impulsePerLength = 0.01f;
+		b2World_Explode( worldId, &explosionDef );
+
+		ENSURE( b2World_GetAwakeBodyCount( worldId ) == bodyCount );
+
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+		b2Counters awakeCounters = b2World_GetCounters( worldId );
+		ENSURE( awakeCounters.contactCount == sleepCounters.contactCount );
+		ENSURE( awakeCounters.jointCount == 1 );
+		ENSURE( awakeCounters.islandCount == sleepCounters.islandCount );
+	}
+
+	b2Vec2 top = b2Body_GetPosition( stackIds[WAKE_STACK_COUNT - 1] );
+	ENSURE( b2AbsFloat( top.x ) < 0.1f );
+	ENSURE( b2AbsFloat( top.y - ( WAKE_STACK_COUNT - 0.5f ) ) < 0.1f );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+#define SENSOR_ROW_COUNT 16
+#define SENSOR_BALL_COUNT 24
+
+typedef struct SensorScene
+{
+	b2WorldId worldId;
+	b2BodyId ballIds[SENSOR_BALL_COUNT];
+	b2ShapeId sensorIds[SENSOR_ROW_COUNT + 1];
+	b2BodyId blockId;
+	b2ShapeId blockShapeId;
+} SensorScene;
+
+// Balls fall through a row of static trigger volumes and come to rest on the ground. A kinematic sensor
+// sweeps through the sleeping balls and a static block is teleported in and out of a trigger.
+static SensorScene CreateSensorScene( bool incremental, int sensorUpdateInterval )
+{
+	SensorScene scene = { 0 };
+
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.enableIncrementalSensors = incremental;
+	scene.worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2BodyId groundId = b2CreateBody( scene.worldId, &bodyDef );
+	b2Segment segment = { { -40.0f, 0.0f }, { 40.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	b2ShapeDef sensorDef = b2DefaultShapeDef();
+	sensorDef.isSensor = true;
+	sensorDef.enableSensorEvents = true;
+	sensorDef.sensorUpdateInterval = sensorUpdateInterval;
+	b2Polygon sensorBox = b2MakeBox( 0.8f, 0.5f );
+	for ( int i = 0; i < SENSOR_ROW_COUNT; ++i )
+	{
+		bodyDef.position = (b2Vec2){ -16.0f + 2.0f * i, 1.5f };
+		b2BodyId sensorBodyId = b2CreateBody( scene.worldId, &bodyDef );
+		scene.sensorIds[i] = b2CreatePolygonShape( sensorBodyId, &sensorDef, &sensorBox );
+	}
+
+	shapeDef.enableSensorEvents = true;
+	bodyDef.position = (b2Vec2){ 40.0f, 10.0f };
+	scene.blockId = b2CreateBody( scene.worldId, &bodyDef );
+	b2Polygon block = b2MakeBox( 0.25f, 0.25f );
+	scene.blockShapeId = b2CreatePolygonShape( scene.blockId, &shapeDef, &block );
+
+	bodyDef.type = b2_kinematicBody;
+	bodyDef.position = (b2Vec2){ -18.0f, 0.5f };
+	bodyDef.linearVelocity = (b2Vec2){ 4.0f, 0.0f };
+	b2BodyId sweeperId = b2CreateBody( scene.worldId, &bodyDef );
+	b2Polygon sweeperBox = b2MakeBox( 0.5f, 0.5f );
+	scene.sensorIds[SENSOR_ROW_COUNT] = b2CreatePolygonShape( sweeperId, &sensorDef, &sweeperBox );
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.linearVelocity = b2Vec2_zero;
+	b2Circle circle = { { 0.0f, 0.0f }, 0.25f };
+	for ( int i = 0; i < SENSOR_BALL_COUNT; ++i )
+	{
+		bodyDef.position = (b2Vec2){ -15.0f + 1.3f * i, 4.0f + 0.3f * ( i % 5 ) };
+		scene.ballIds[i] = b2CreateBody( scene.worldId, &bodyDef );
+		b2CreateCircleShape( scene.ballIds[i], &shapeDef, &circle );
+	}
+
+	return scene;
+}
+
+static void StepSensorScene( SensorScene* scene, int step )
+{
+	if ( step == 200 )
+	{
+		// Static block moves into a trigger
+		b2Body_SetTransform( scene->blockId, (b2Vec2){ -10.0f, 1.5f }, b2Rot_identity );
+	}
+	else if ( step == 230 )
+	{
+		b2DestroyBody( scene->ballIds[3] );
+	}
+	else if ( step == 260 )
+	{
+		b2Shape_EnableSensorEvents( scene->blockShapeId, false );
+	}
+	else if ( step == 290 )
+	{
+		b2Shape_EnableSensorEvents( scene->blockShapeId, true );
+	}
+	else if ( step == 320 )
+	{
+		b2Body_SetTransform( scene->blockId, (b2Vec2){ 40.0f, 10.0f }, b2Rot_identity );
+	}
+
+	b2World_Step( scene->worldId, 1.0f / 60.0f, 4 );
+}
+
+static bool SameShapeId( b2ShapeId a, b2ShapeId b )
+{
+	return a.index1 == b.index1 && a.generation == b.generation;
+}
+
+static bool SameSensorEvents( b2SensorEvents events1, b2SensorEvents events2 )
+{
+	if ( events1.beginCount != events2.beginCount || events1.endCount != events2.endCount )
+	{
+		return false;
+	}
+
+	for ( int i = 0; i < events1.beginCount; ++i )
+	{
+		if ( SameShapeId( events1.beginEvents[i].sensorShapeId, events2.beginEvents[i].sensorShapeId ) == false ||
+			 SameShapeId( events1.beginEvents[i].visitorShapeId, events2.beginEvents[i].visitorShapeId ) == false )
+		{
+			return false;
+		}
+	}
+
+	for ( int i = 0; i < events1.endCount; ++i )
+	{
+		if ( SameShapeId( events1.endEvents[i].sensorShapeId, events2.endEvents[i].sensorShapeId ) == false ||
+			 SameShapeId( events1.endEvents[i].visitorShapeId, events2.endEvents[i].visitorShapeId ) == false )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Incremental sensor updates must match the full update event for event
+static int TestIncrementalSensors( void )
+{
+	SensorScene scenes[2] = { CreateSensorScene( false, 0 ), CreateSensorScene( true, 0 ) };
+
+	int beginCount = 0;
+	int endCount = 0;
+	int quietUpdateCount = SENSOR_ROW_COUNT + 1;
+
+	for ( int step = 0; step < 360; ++step )
+	{
+		StepSensorScene( scenes + 0, step );
+		StepSensorScene( scenes + 1, step );
+
+		b2SensorEvents events1 = b2World_GetSensorEvents( scenes[0].worldId );
+		b2SensorEvents events2 = b2World_GetSensorEvents( scenes[1].worldId );
+		ENSURE( SameSensorEvents( events1, events2 ) );
+
+		beginCount += events1.beginCount;
+		endCount += events1.endCount;
+
+		b2Counters counters = b2World_GetCounters( scenes[1].worldId );
+		if ( 150 <= step && step < 200 && b2World_GetAwakeBodyCount( scenes[1].worldId ) <= 1 )
+		{
+			quietUpdateCount = b2MinInt( quietUpdateCount, counters.updatedSensorCount );
+		}
+
+		// The full update always updates every sensor
+		ENSURE( b2World_GetCounters( scenes[0].worldId ).updatedSensorCount == SENSOR_ROW_COUNT + 1 );
+	}
+
+	// Balls falling through the triggers, the sweeper, and the block
+	ENSURE( beginCount > SENSOR_BALL_COUNT + 4 );
+	ENSURE( endCount > SENSOR_BALL_COUNT );
+
+	// Only the kinematic sweeper moves once the balls sleep, the static triggers are left alone
+	ENSURE( quietUpdateCount <= 3 );
+
+	b2DestroyWorld( scenes[0].worldId );
+	b2DestroyWorld( scenes[1].worldId );
+
+	return 0;
+}
+
+// Sensors updated every few steps report the same events in full and incremental mode and every begin
+// event is eventually matched by an end event or a current overlap
+static int TestSensorUpdateInterval( void )
+{
+	int interval = 3;
+	SensorScene scenes[2] = { CreateSensorScene( false, interval ), CreateSensorScene( true, interval ) };
+
+	int beginCount = 0;
+	int endCount = 0;
+	int maxUpdateCount = 0;
+
+	for ( int step = 0; step < 360; ++step )
+	{
+		StepSensorScene( scenes + 0, step );
+		StepSensorScene( scenes + 1, step );
+
+		b2SensorEvents events1 = b2World_GetSensorEvents( scenes[0].worldId );
+		b2SensorEvents events2 = b2World_GetSensorEvents( scenes[1].worldId );
+		ENSURE( SameSensorEvents( events1, events2 ) );
+
+		beginCount += events1.beginCount;
+		endCount += events1.endCount;
+
+		maxUpdateCount = b2MaxInt( maxUpdateCount, b2World_GetCounters( scenes[0].worldId ).updatedSensorCount );
+	}
+
+	// The updates are staggered across the interval
+	ENSURE( maxUpdateCount <= ( SENSOR_ROW_COUNT + 1 ) / interval + 1 );
+	ENSURE( beginCount > SENSOR_BALL_COUNT + 4 );
+
+	int overlapCount = 0;
+	for ( int i = 0; i < SENSOR_ROW_COUNT + 1; ++i )
+	{
+		ENSURE( b2Shape_GetSensorUpdateInterval( scenes[1].sensorIds[i] ) == interval );
+		overlapCount += b2Shape_GetSensorCapacity( scenes[0].sensorIds[i] );
+	}
+
+	ENSURE( beginCount == endCount + overlapCount );
+
+	b2DestroyWorld( scenes[0].worldId );
+	b2DestroyWorld( scenes[1].worldId );
+
+	return 0;
+}
+
+// A sensor with enough visitors to use the radix sort across several digits of the shape id
+static int TestSensorManyVisitors( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.gravity = b2Vec2_zero;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	shapeDef.enableSensorEvents = true;
+	b2Circle circle = { { 0.0f, 0.0f }, 0.1f };
+
+	// Shapes outside the sensor push the visitor shape ids past one byte
+	int gridCount = 24;
+	int insideCount = 0;
+	for ( int i = 0; i < gridCount; ++i )
+	{
+		for ( int j = 0; j < gridCount; ++j )
+		{
+			bodyDef.position = (b2Vec2){ (float)i, (float)j };
+			b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+			b2CreateCircleShape( bodyId, &shapeDef, &circle );
+			insideCount += ( i >= 12 && j >= 12 ) ? 1 : 0;
+		}
+	}
+
+	shapeDef.isSensor = true;
+	bodyDef.position = (b2Vec2){ 17.5f, 17.5f };
+	b2BodyId sensorBodyId = b2CreateBody( worldId, &bodyDef );
+	b2Polygon box = b2MakeBox( 5.95f, 5.95f );
+	b2ShapeId sensorId = b2CreatePolygonShape( sensorBodyId, &shapeDef, &box );
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+	b2SensorEvents events = b2World_GetSensorEvents( worldId );
+	ENSURE( events.beginCount == insideCount );
+	ENSURE( b2Shape_GetSensorCapacity( sensorId ) == insideCount );
+
+	b2ShapeId visitorIds[144];
+	int count = b2Shape_GetSensorData( sensorId, visitorIds, 144 );
+	ENSURE( count == insideCount );
+	for ( int i = 1; i < count; ++i )
+	{
+		ENSURE( visitorIds[i - 1].index1 < visitorIds[i].index1 );
+	}
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	events = b2World_GetSensorEvents( worldId );
+	ENSURE( events.beginCount == 0 && events.endCount == 0 );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+static bool IsShapeInList( b2ShapeId shapeId, const b2ShapeId* shapeIds, int count )
+{
+	for ( int i = 0; i < count; ++i )
+	{
+		if ( SameShapeId( shapeId, shapeIds[i] ) )
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+#define HIT_BALL_COUNT 12
+
+// Balls land together on a plank that has more contacts than graph colors, so some of the contacts are
+// solved in the overflow color. Every ball reports its hit.
+static int TestOverflowHitEvents( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.graphColorCount = 6;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2Segment segment = { { -20.0f, 0.0f }, { 20.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position = (b2Vec2){ 0.0f, 0.25f };
+	b2BodyId plankId = b2CreateBody( worldId, &bodyDef );
+	b2Polygon plank = b2MakeBox( 0.5f * HIT_BALL_COUNT + 1.0f, 0.25f );
+	b2CreatePolygonShape( plankId, &shapeDef, &plank );
+
+	shapeDef.enableHitEvents = true;
+	b2ShapeId ballShapeIds[HIT_BALL_COUNT];
+	b2Circle circle = { { 0.0f, 0.0f }, 0.25f };
+	for ( int i = 0; i < HIT_BALL_COUNT; ++i )
+	{
+		bodyDef.position = (b2Vec2){ -0.5f * HIT_BALL_COUNT + 0.25f + 1.0f * i, 2.0f };
+		b2BodyId ballId = b2CreateBody( worldId, &bodyDef );
+		ballShapeIds[i] = b2CreateCircleShape( ballId, &shapeDef, &circle );
+	}
+
+	bool hits[HIT_BALL_COUNT] = { 0 };
+	for ( int step = 0; step < 60; ++step )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+		b2ContactEvents events = b2World_GetContactEvents( worldId );
+		for ( int i = 0; i < events.hitCount; ++i )
+		{
+			b2ContactHitEvent* event = events.hitEvents + i;
+			ENSURE( event->approachSpeed > b2World_GetHitEventThreshold( worldId ) );
+
+			// Sorted by contact id
+			ENSURE( i == 0 || events.hitEvents[i - 1].contactId.index1 < event->contactId.index1 );
+
+			for ( int j = 0; j < HIT_BALL_COUNT; ++j )
+			{
+				hits[j] = hits[j] || SameShapeId( event->shapeIdA, ballShapeIds[j] ) ||
+						  SameShapeId( event->shapeIdB, ballShapeIds[j] );
+			}
+		}
+	}
+
+	for ( int i = 0; i < HIT_BALL_COUNT; ++i )
+	{
+		ENSURE( hits[i] );
+	}
+
+	b2DestroyWorld( worldId );
+	return 0;
+}
+
+// Contact events are only reported for shapes that match the world contact event filter
+static int TestContactEventFilter( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.contactEventFilter = (b2ContactEventFilter){ 0x4, 9 };
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2ContactEventFilter filter = b2World_GetContactEventFilter( worldId );
+	ENSURE( filter.categoryBits == 0x4 && filter.userMaterialId == 9 );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	shapeDef.enableContactEvents = true;
+	shapeDef.enableHitEvents = true;
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2Segment segment = { { -20.0f, 0.0f }, { 20.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	// Only the second ball matches by category and only the third matches by material
+	uint64_t categories[3] = { 0x2, 0x4, 0x8 };
+	uint64_t materials[3] = { 0, 0, 9 };
+	b2BodyId ballIds[3];
+	b2ShapeId ballShapeIds[3];
+	bodyDef.type = b2_dynamicBody;
+	b2Circle circle = { { 0.0f, 0.0f }, 0.5f };
+	for ( int i = 0; i < 3; ++i )
+	{
+		bodyDef.position = (b2Vec2){ -4.0f + 4.0f * i, 2.0f };
+		shapeDef.filter.categoryBits = categories[i];
+		shapeDef.material.userMaterialId = materials[i];
+		ballIds[i] = b2CreateBody( worldId, &bodyDef );
+		ballShapeIds[i] = b2CreateCircleShape( ballIds[i], &shapeDef, &circle );
+	}
+
+	int beginCount = 0;
+	int hitCount = 0;
+	for ( int step = 0; step < 60; ++step )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+		b2ContactEvents events = b2World_GetContactEvents( worldId );
+		for ( int i = 0; i < events.beginCount; ++i )
+		{
+			b2ContactBeginTouchEvent* event = events.beginEvents + i;
+			ENSURE( IsShapeInList( event->shapeIdA, ballShapeIds + 1, 2 ) || IsShapeInList( event->shapeIdB, ballShapeIds + 1, 2 ) );
+		}
+
+		for ( int i = 0; i < events.hitCount; ++i )
+		{
+			b2ContactHitEvent* event = events.hitEvents + i;
+			ENSURE( IsShapeInList( event->shapeIdA, ballShapeIds + 1, 2 ) || IsShapeInList( event->shapeIdB, ballShapeIds + 1, 2 ) );
+		}
+
+		beginCount += events.beginCount;
+		hitCount += events.hitCount;
+	}
+
+	ENSURE( beginCount == 2 );
+	ENSURE( hitCount >= 2 );
+
+	// Filter out everything, then destroying a touching ball reports no end event
+	b2World_SetContactEventFilter( worldId, (b2ContactEventFilter){ 0, 0 } );
+	b2DestroyBody( ballIds[1] );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	ENSURE( b2World_GetContactEvents( worldId ).endCount == 0 );
+
+	// The default filter applies to existing contacts
+	b2World_SetContactEventFilter( worldId, (b2ContactEventFilter){ B2_DEFAULT_MASK_BITS, 0 } );
+	b2DestroyBody( ballIds[0] );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	ENSURE( b2World_GetContactEvents( worldId ).endCount == 1 );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+#define MOVE_BODY_COUNT 12
+
+static b2WorldId CreateMoveScene( const b2WorldDef* worldDef, b2BodyId* bodyIds )
+{
+	b2WorldId worldId = b2CreateWorld( worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2Segment segment = { { -20.0f, 0.0f }, { 20.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	for ( int i = 0; i < MOVE_BODY_COUNT; ++i )
+	{
+		bodyDef.position = (b2Vec2){ -6.0f + 1.1f * ( i % 6 ), 0.5f + 1.5f * ( i / 6 ) };
+		bodyDef.rotation = b2MakeRot( 0.1f * i );
+		bodyIds[i] = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyIds[i], &shapeDef, &box );
+	}
+
+	return worldId;
+}
+
+// Move events below the thresholds are skipped and the compact deltas reconstruct the transforms
+static int TestMoveEventFilter( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2BodyId fullIds[MOVE_BODY_COUNT];
+	b2WorldId fullWorldId = CreateMoveScene( &worldDef, fullIds );
+
+	float quantum = 0.001f;
+	worldDef.moveEventLinearThreshold = 0.01f;
+	worldDef.moveEventAngularThreshold = 0.01f;
+	worldDef.moveEventQuantum = quantum;
+	b2BodyId bodyIds[MOVE_BODY_COUNT];
+	b2WorldId worldId = CreateMoveScene( &worldDef, bodyIds );
+
+	// The receiver starts from the creation transforms
+	b2Vec2 positions[MOVE_BODY_COUNT];
+	float angles[MOVE_BODY_COUNT];
+	for ( int i = 0; i < MOVE_BODY_COUNT; ++i )
+	{
+		positions[i] = b2Body_GetPosition( bodyIds[i] );
+		angles[i] = b2Rot_GetAngle( b2Body_GetRotation( bodyIds[i] ) );
+	}
+
+	int fullCount = 0, filteredCount = 0;
+	int fullSleepCount = 0, filteredSleepCount = 0;
+	for ( int step = 0; step < 300; ++step )
+	{
+		b2World_Step( fullWorldId, 1.0f / 60.0f, 4 );
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+		b2BodyEvents fullEvents = b2World_GetBodyEvents( fullWorldId );
+		ENSURE( fullEvents.moveDeltas == NULL );
+		fullCount += fullEvents.moveCount;
+		for ( int i = 0; i < fullEvents.moveCount; ++i )
+		{
+			fullSleepCount += fullEvents.moveEvents[i].fellAsleep ? 1 : 0;
+		}
+
+		b2BodyEvents events = b2World_GetBodyEvents( worldId );
+		ENSURE( events.moveCount == 0 || events.moveDeltas != NULL );
+		filteredCount += events.moveCount;
+		for ( int i = 0; i < events.moveCount; ++i )
+		{
+			b2BodyMoveDelta* delta = events.moveDeltas + i;
+			ENSURE( delta->bodyId.index1 == events.moveEvents[i].bodyId.index1 );
+			ENSURE( delta->fellAsleep == events.moveEvents[i].fellAsleep );
+			filteredSleepCount += delta->fellAsleep ? 1 : 0;
+
+			int index = -1;
+			for ( int j = 0; j < MOVE_BODY_COUNT; ++j )
+			{
+				index = B2_ID_EQUALS( bodyIds[j], delta->bodyId ) ? j : index;
+			}
+
+			ENSURE( index >= 0 );
+			positions[index].x += quantum * delta->dx;
+			positions[index].y += quantum * delta->dy;
+			angles[index] = b2UnwindAngle( angles[index] + ( B2_PI / 32768.0f ) * delta->dAngle );
+		}
+	}
+
+	// Sleep is always reported
+	ENSURE( fullSleepCount == MOVE_BODY_COUNT );
+	ENSURE( filteredSleepCount == fullSleepCount );
+	ENSURE( filteredCount < fullCount / 2 );
+
+	for ( int i = 0; i < MOVE_BODY_COUNT; ++i )
+	{
+		ENSURE( b2Body_IsAwake( bodyIds[i] ) == false );
+		b2Vec2 p = b2Body_GetPosition( bodyIds[i] );
+		float angle = b2Rot_GetAngle( b2Body_GetRotation( bodyIds[i] ) );
+		ENSURE( b2Distance( p, positions[i] ) < quantum );
+		ENSURE( b2AbsFloat( b2UnwindAngle( angle - angles[i] ) ) < B2_PI / 32768.0f );
+	}
+
+	// Turning the filter off reports every move again
+	b2World_SetMoveEventFilter( worldId, 0.0f, 0.0f, 0.0f );
+	b2Body_SetAwake( bodyIds[0], true );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	b2BodyEvents events = b2World_GetBodyEvents( worldId );
+	ENSURE( events.moveCount > 0 && events.moveDeltas == NULL );
+
+	b2DestroyWorld( fullWorldId );
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+#define JOINT_EVENT_LINK_COUNT 60
+#define JOINT_EVENT_CAPACITY 4096
+
+// A hanging chain where every third joint always reports and the upper joints of another third carry
+// more than their force threshold
+static int SimulateJointEvents( b2JointId* eventIds, int workerCount )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = workerCount;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId prevId = b2CreateBody( worldId, &bodyDef );
+
+	bodyDef.type = b2_dynamicBody;
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Capsule capsule = { { 0.0f, -0.25f }, { 0.0f, 0.25f }, 0.1f };
+
+	b2RevoluteJointDef jointDef = b2DefaultRevoluteJointDef();
+	jointDef.base.localFrameA.p = (b2Vec2){ 0.0f, -0.25f };
+	jointDef.base.localFrameB.p = (b2Vec2){ 0.0f, 0.25f };
+
+	float linkWeight = 0.0f;
+	for ( int i = 0; i < JOINT_EVENT_LINK_COUNT; ++i )
+	{
+		bodyDef.position = (b2Vec2){ 0.0f, -0.5f * i };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2CreateCapsuleShape( bodyId, &shapeDef, &capsule );
+		linkWeight = 10.0f * b2Body_GetMass( bodyId );
+
+		if ( i == 0 )
+		{
+			jointDef.base.localFrameA.p = b2Vec2_zero;
+		}
+		else
+		{
+			jointDef.base.localFrameA.p = (b2Vec2){ 0.0f, -0.25f };
+		}
+
+		jointDef.base.bodyIdA = prevId;
+		jointDef.base.bodyIdB = bodyId;
+		jointDef.base.forceThreshold = ( i % 3 ) == 0 ? 0.0f : ( ( i % 3 ) == 1 ? FLT_MAX : 30.0f * linkWeight );
+		b2CreateRevoluteJoint( worldId, &jointDef );
+		prevId = bodyId;
+	}
+
+	int eventCount = 0;
+	for ( int step = 0; step < 60; ++step )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+		b2JointEvents events = b2World_GetJointEvents( worldId );
+		for ( int i = 0; i < events.count && eventCount < JOINT_EVENT_CAPACITY; ++i )
+		{
+			// Each joint is reported once per step, in id order
+			if ( i > 0 && events.jointEvents[i - 1].jointId.index1 >= events.jointEvents[i].jointId.index1 )
+			{
+				b2DestroyWorld( worldId );
+				return -1;
+			}
+
+			eventIds[eventCount] = events.jointEvents[i].jointId;
+			eventCount += 1;
+		}
+	}
+
+	b2DestroyWorld( worldId );
+
+	return eventCount;
+}
+
+// Joint threshold events are the same for any worker count
+static int TestJointEvents( void )
+{
+	static b2JointId serialIds[JOINT_EVENT_CAPACITY];
+	static b2JointId parallelIds[JOINT_EVENT_CAPACITY];
+
+	int serialCount = SimulateJointEvents( serialIds, 1 );
+	int parallelCount = SimulateJointEvents( parallelIds, 4 );
+
+	// The zero threshold joints report every step and some of the loaded joints report as well
+	int alwaysCount = ( JOINT_EVENT_LINK_COUNT + 2 ) / 3;
+	ENSURE( serialCount > 60 * alwaysCount );
+	ENSURE( serialCount < 60 * 2 * alwaysCount );
+	ENSURE( serialCount == parallelCount );
+
+	for ( int i = 0; i < serialCount; ++i )
+	{
+		ENSURE( B2_ID_EQUALS( serialIds[i], parallelIds[i] ) );
+	}
+
+	return 0;
+}
+
+// Worker profile counts the solver blocks claimed by each worker
+static int TestWorkerProfile( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Segment segment = { { -40.0f, 0.0f }, { 40.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeSquare( 0.5f );
+	for ( int i = 0; i < 20; ++i )
+	{
+		for ( int j = 0; j < 10; ++j )
+		{
+			bodyDef.position = ( b2Vec2 ){ -30.0f + 3.0f * i, 0.5f + 1.0f * j };
+			b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+			b2CreatePolygonShape( bodyId, &shapeDef, &box );
+		}
+	}
+
+	// Disabled by default
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	b2WorkerProfile profile = b2World_GetWorkerProfile( worldId, 0 );
+	ENSURE( profile.stages[b2_profileSolve].blockCount == 0 );
+
+	b2World_EnableWorkerProfile( worldId, true );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+	int blockCounts[b2_profileStageCount] = { 0 };
+	for ( int workerIndex = 0; workerIndex < 4; ++workerIndex )
+	{
+		profile = b2World_GetWorkerProfile( worldId, workerIndex );
+		for ( int i = 0; i < b2_profileStageCount; ++i )
+		{
+			b2WorkerStageProfile stage = profile.stages[i];
+			ENSURE( stage.workTime >= 0.0f && stage.waitTime >= 0.0f );
+			ENSURE( stage.blockCount >= 0 && stage.stolenCount >= 0 );
+			blockCounts[i] += stage.blockCount;
+		}
+	}
+
+	ENSURE( blockCounts[b2_profileIntegrateVelocities] > 0 );
+	ENSURE( blockCounts[b2_profileSolve] > 0 );
+	ENSURE( blockCounts[b2_profileIntegratePositions] > 0 );
+
+	// Out of range workers are empty
+	profile = b2World_GetWorkerProfile( worldId, 4 );
+	ENSURE( profile.stages[b2_profileSolve].blockCount == 0 );
+
+	b2World_EnableWorkerProfile( worldId, false );
+	profile = b2World_GetWorkerProfile( worldId, 0 );
+	ENSURE( profile.stages[b2_profileIntegrateVelocities].blockCount == 0 );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+// The trace recorder writes the zones of the requested steps
+static int TestTraceRecorder( void )
+{
+	b2EnableTrace( 1024 );
+
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Polygon box = b2MakeSquare( 0.5f );
+	for ( int i = 0; i < 10; ++i )
+	{
+		bodyDef.position = ( b2Vec2 ){ 0.0f, 1.0f * i };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyId, &shapeDef, &box );
+	}
+
+	for ( int i = 0; i < 5; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	int size = b2WriteTrace( NULL, 0, 2 );
+	ENSURE( size > 0 );
+	ENSURE( b2WriteTrace( NULL, 0, 0 ) > size );
+
+	char* json = malloc( size );
+	ENSURE( b2WriteTrace( json, size - 1, 2 ) == 0 );
+	ENSURE( b2WriteTrace( json, size, 2 ) == size );
+	ENSURE( json[size - 1] == 0 );
+	ENSURE( strncmp( json, "{\"traceEvents\":[", 16 ) == 0 );
+	ENSURE( strstr( json, "\"thread_name\"" ) != NULL );
+
+	int stepCount = 0;
+	for ( const char* step = strstr( json, "\"name\":\"Step\"" ); step != NULL; step = strstr( step + 1, "\"name\":\"Step\"" ) )
+	{
+		stepCount += 1;
+	}
+
+	ENSURE( stepCount == 2 );
+
+	free( json );
+	b2DestroyWorld( worldId );
+
+	b2EnableTrace( 0 );
+	ENSURE( b2WriteTrace( NULL, 0, 0 ) == 0 );
+
+	return 0;
+}
+
+// Memory stats account for the world allocations
+static int TestMemoryStats( void )
+{
+	int baseByteCount = b2GetByteCount();
+
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 2;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Segment segment = { { -20.0f, 0.0f }, { 20.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeSquare( 0.5f );
+	for ( int i = 0; i < 20; ++i )
+	{
+		bodyDef.position = ( b2Vec2 ){ 0.0f, 0.5f + 1.0f * i };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyId, &shapeDef, &box );
+	}
+
+	for ( int i = 0; i < 10; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	b2MemoryStats stats = b2World_GetMemoryStats( worldId );
+	ENSURE( stats.objectArrays > 0 );
+	ENSURE( stats.trees[b2_staticBody] > 0 && stats.trees[b2_dynamicBody] > 0 );
+	ENSURE( stats.pairSet > 0 );
+	ENSURE( stats.bodySims > 0 && stats.bodyStates > 0 && stats.contactSims > 0 );
+	ENSURE( stats.colors[0] > 0 );
+	ENSURE( stats.stackCapacity > 0 && stats.stackMaxAllocation > 0 );
+	ENSURE( stats.arenaCapacity > 0 );
+
+	// The solver sets hold at least one sim per body
+	b2ObjectSizes sizes = b2GetObjectSizes();
+	ENSURE( sizes.body > 0 && sizes.shape > 0 && sizes.contact > 0 && sizes.treeNode > 0 );
+	ENSURE( stats.bodySims >= 21 * sizes.bodySim );
+	ENSURE( stats.bodyStates >= 20 * sizes.bodyState );
+
+	// Everything counted is held by this world
+	ENSURE( stats.totalBytes > 0 );
+	ENSURE( stats.totalBytes <= b2GetByteCount() - baseByteCount );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+// Sleeping contacts stored compactly restore their manifold and warm starting on wake
+static int CompactContactStack( bool enableCompactContacts, b2BodyId* topId, b2BodyId* bottomId, b2WorldId* worldId )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.enableCompactContacts = enableCompactContacts;
+	*worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2BodyId groundId = b2CreateBody( *worldId, &bodyDef );
+	b2Segment segment = { { -20.0f, 0.0f }, { 20.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeSquare( 0.5f );
+	for ( int i = 0; i < 10; ++i )
+	{
+		bodyDef.position = ( b2Vec2 ){ 0.0f, 0.5f + 1.0f * i };
+		b2BodyId bodyId = b2CreateBody( *worldId, &bodyDef );
+		b2CreatePolygonShape( bodyId, &shapeDef, &box );
+
+		if ( i == 0 )
+		{
+			*bottomId = bodyId;
+		}
+		*topId = bodyId;
+	}
+
+	int stepCount = 0;
+	while ( b2World_GetAwakeBodyCount( *worldId ) > 0 && stepCount < 1000 )
+	{
+		b2World_Step( *worldId, 1.0f / 60.0f, 4 );
+		stepCount += 1;
+	}
+
+	ENSURE( b2World_GetAwakeBodyCount( *worldId ) == 0 );
+	return 0;
+}
+
+static int TestCompactContacts( void )
+{
+	b2WorldId worldId, referenceId;
+	b2BodyId topId, bottomId, referenceTopId, referenceBottomId;
+	ENSURE( CompactContactStack( true, &topId, &bottomId, &worldId ) == 0 );
+	ENSURE( CompactContactStack( false, &referenceTopId, &referenceBottomId, &referenceId ) == 0 );
+
+	// Sleeping contacts take less memory
+	b2MemoryStats stats = b2World_GetMemoryStats( worldId );
+	b2MemoryStats referenceStats = b2World_GetMemoryStats( referenceId );
+	ENSURE( stats.contactSims < referenceStats.contactSims );
+
+	b2ObjectSizes sizes = b2GetObjectSizes();
+	ENSURE( 0 < sizes.compactContactSim && sizes.compactContactSim < sizes.contactSim / 2 );
+
+	// The manifold of a sleeping contact is rebuilt with the stored impulses
+	b2ContactData data[4], referenceData[4];
+	int count = b2Body_GetContactData( bottomId, data, 4 );
+	int referenceCount = b2Body_GetContactData( referenceBottomId, referenceData, 4 );
+	ENSURE( count == 2 && referenceCount == 2 );
+	for ( int i = 0; i < count; ++i )
+	{
+		b2Manifold* manifold = &data[i].manifold;
+		b2Manifold* referenceManifold = &referenceData[i].manifold;
+		ENSURE( manifold->pointCount == referenceManifold->pointCount );
+		ENSURE_SMALL( b2Distance( manifold->normal, referenceManifold->normal ), 0.001f );
+
+		for ( int j = 0; j < manifold->pointCount; ++j )
+		{
+			b2ManifoldPoint* mp = manifold->points + j;
+			b2ManifoldPoint* referencePoint = referenceManifold->points + j;
+			ENSURE( mp->id == referencePoint->id );
+			ENSURE_SMALL( b2Distance( mp->anchorA, referencePoint->anchorA ), 0.01f );
+			ENSURE_SMALL( mp->normalImpulse - referencePoint->normalImpulse, 0.001f * referencePoint->normalImpulse + 0.0001f );
+		}
+	}
+
+	// Snapshots and clones carry the compact contacts
+	b2WorldId cloneId = b2World_Clone( worldId );
+	ENSURE( b2World_GetAwakeBodyCount( cloneId ) == 0 );
+	b2DestroyWorld( cloneId );
+
+	// Wake the stack and let it settle again
+	b2Vec2 topPosition = b2Body_GetPosition( topId );
+	b2Body_SetAwake( topId, true );
+	for ( int i = 0; i < 30; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	b2Vec2 position = b2Body_GetPosition( topId );
+	ENSURE_SMALL( b2Distance( position, topPosition ), 0.01f );
+	ENSURE( b2World_GetCounters( worldId ).contactCount == b2World_GetCounters( referenceId ).contactCount );
+
+	// Destroying a body removes its compact contacts
+	b2Body_SetAwake( topId, true );
+	int stepCount = 0;
+	while ( b2World_GetAwakeBodyCount( worldId ) > 0 && stepCount < 1000 )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		stepCount += 1;
+	}
+
+	b2DestroyBody( bottomId );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+	b2DestroyWorld( worldId );
+	b2DestroyWorld( referenceId );
+
+	return 0;
+}
+
+static b2BodyId CreateBoxStack( b2WorldId worldId, float x, int count )
+{
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Polygon box = b2MakeSquare( 0.5f );
+
+	b2BodyId topId = b2_nullBodyId;
+	for ( int i = 0; i < count; ++i )
+	{
+		bodyDef.position = (b2Vec2){ x, 0.5f + i };
+		topId = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( topId, &shapeDef, &box );
+	}
+
+	return topId;
+}
+
+static int StepUntilAsleep( b2WorldId worldId )
+{
+	int stepCount = 0;
+	while ( b2World_GetAwakeBodyCount( worldId ) > 0 && stepCount < 1000 )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		stepCount += 1;
+	}
+
+	return stepCount;
+}
+
+// Contacts are compacted only after the island has slept for a while
+static int TestCompactSleepSteps( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.enableCompactContacts = true;
+	worldDef.compactSleepSteps = 60;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2Segment segment = { { -20.0f, 0.0f }, { 20.0f, 0.0f } };
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	b2BodyId topIdA = CreateBoxStack( worldId, -2.0f, 8 );
+	ENSURE( StepUntilAsleep( worldId ) < 1000 );
+
+	// A short nap keeps the full contacts
+	b2MemoryStats asleepStats = b2World_GetMemoryStats( worldId );
+	for ( int i = 0; i < 100; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	b2MemoryStats compactStats = b2World_GetMemoryStats( worldId );
+	ENSURE( compactStats.contactSims < asleepStats.contactSims );
+
+	// A second stack falls asleep with full contacts. A joint merges the two sleeping sets.
+	b2BodyId topIdB = CreateBoxStack( worldId, 2.0f, 8 );
+	ENSURE( StepUntilAsleep( worldId ) < 1000 );
+
+	b2Vec2 positionA = b2Body_GetPosition( topIdA );
+	b2Vec2 positionB = b2Body_GetPosition( topIdB );
+
+	b2DistanceJointDef jointDef = b2DefaultDistanceJointDef();
+	jointDef.base.bodyIdA = topIdA;
+	jointDef.base.bodyIdB = topIdB;
+	jointDef.length = b2Distance( positionA, positionB );
+	b2CreateDistanceJoint( worldId, &jointDef );
+	ENSURE( b2World_GetAwakeBodyCount( worldId ) == 0 );
+
+	// Both stacks wake from the merged set and stay standing
+	b2Body_SetAwake( topIdA, true );
+	for ( int i = 0; i < 30; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	ENSURE_SMALL( b2Distance( b2Body_GetPosition( topIdA ), positionA ), 0.01f );
+	ENSURE_SMALL( b2Distance( b2Body_GetPosition( topIdB ), positionB ), 0.01f );
+
+	b2DestroyWorld( worldId );
+	return 0;
+}
+
+// Detailed counters explain the broad-phase, narrow phase and continuous work
+static int TestDetailedCounters( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.gravity = b2Vec2_zero;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Polygon box = b2MakeSquare( 0.5f );
+
+	// A ball skims over a static box without touching it
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( groundId, &shapeDef, &box );
+
+	// A wall for a fast ball
+	bodyDef.position = ( b2Vec2 ){ 2.0f, -4.0f };
+	b2BodyId wallId = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( wallId, &shapeDef, &box );
+
+	bodyDef.type = b2_dynamicBody;
+	b2Circle circle = { b2Vec2_zero, 0.25f };
+	bodyDef.position = ( b2Vec2 ){ -3.0f, 0.8f };
+	bodyDef.linearVelocity = ( b2Vec2 ){ 10.0f, 0.0f };
+	b2BodyId skimId = b2CreateBody( worldId, &bodyDef );
+	b2CreateCircleShape( skimId, &shapeDef, &circle );
+
+	circle.radius = 0.1f;
+	bodyDef.position = ( b2Vec2 ){ -4.0f, -4.0f };
+	bodyDef.linearVelocity = ( b2Vec2 ){ 200.0f, 0.0f };
+	b2BodyId fastId = b2CreateBody( worldId, &bodyDef );
+	b2CreateCircleShape( fastId, &shapeDef, &circle );
+
+	// Two overlapping boxes
+	bodyDef.linearVelocity = b2Vec2_zero;
+	bodyDef.position = ( b2Vec2 ){ 0.0f, -8.0f };
+	b2BodyId boxId1 = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( boxId1, &shapeDef, &box );
+	bodyDef.position = ( b2Vec2 ){ 0.9f, -8.0f };
+	b2BodyId boxId2 = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( boxId2, &shapeDef, &box );
+
+	// Disabled by default
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	b2Counters counters = b2World_GetCounters( worldId );
+	ENSURE( counters.pairLeafVisits == 0 );
+	ENSURE( counters.manifoldCalls[b2_polygonShape][b2_polygonShape] == 0 );
+
+	b2World_EnableDetailedCounters( worldId, true );
+
+	int leafVisits = 0;
+	int polygonCalls = 0;
+	int circleCalls = 0;
+	int toiCount = 0;
+	int gjkCount = 0;
+	int untouchedCount = 0;
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		counters = b2World_GetCounters( worldId );
+		leafVisits += counters.pairLeafVisits;
+		polygonCalls += counters.manifoldCalls[b2_polygonShape][b2_polygonShape];
+		circleCalls += counters.manifoldCalls[b2_circleShape][b2_polygonShape] +
+					   counters.manifoldCalls[b2_polygonShape][b2_circleShape];
+		untouchedCount += counters.untouchedContactCount;
+
+		for ( int j = 0; j < 8; ++j )
+		{
+			toiCount += counters.toiIterations[j];
+			gjkCount += counters.gjkIterations[j];
+		}
+	}
+
+	ENSURE( leafVisits > 0 );
+	ENSURE( polygonCalls > 0 );
+	ENSURE( circleCalls > 0 );
+	ENSURE( toiCount > 0 );
+	ENSURE( gjkCount == toiCount );
+	ENSURE( untouchedCount == 1 );
+
+	b2World_EnableDetailedCounters( worldId, false );
+	counters = b2World_GetCounters( worldId );
+	ENSURE( counters.manifoldCalls[b2_polygonShape][b2_polygonShape] == 0 );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+// Step event counters used to trace slow steps
+static int TestStepEventCounters( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Polygon groundBox = b2MakeBox( 20.0f, 1.0f );
+	b2CreatePolygonShape( groundId, &shapeDef, &groundBox );
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position = ( b2Vec2 ){ 0.0f, 1.5f };
+	b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+	b2Polygon box = b2MakeSquare( 0.5f );
+	b2CreatePolygonShape( bodyId, &shapeDef, &box );
+
+	// The new proxy is sorted by the first rebuild
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	b2Counters counters = b2World_GetCounters( worldId );
+	ENSURE( counters.rebuiltLeafCount > 0 );
+
+	int stepCount = 0;
+	while ( b2Body_IsAwake( bodyId ) && stepCount < 1000 )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		stepCount += 1;
+	}
+
+	ENSURE( b2Body_IsAwake( bodyId ) == false );
+	counters = b2World_GetCounters( worldId );
+	ENSURE( counters.stackGrowth == 0 );
+	ENSURE( counters.wokenSetCount == 0 );
+
+	// A wake between steps is counted with the next step only
+	b2Body_SetAwake( bodyId, true );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	counters = b2World_GetCounters( worldId );
+	ENSURE( counters.wokenSetCount == 1 );
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	counters = b2World_GetCounters( worldId );
+	ENSURE( counters.wokenSetCount == 0 );
+	ENSURE( counters.splitIslandCount == 0 );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+// Islands with a simulation interval are parked between updates and catch up with the accumulated time
+static int TestSimulationInterval( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+	b2WorldId referenceId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position = ( b2Vec2 ){ 0.0f, 20.0f };
+	bodyDef.simulationInterval = 4;
+	b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+	bodyDef.simulationInterval = 0;
+	b2BodyId referenceBodyId = b2CreateBody( referenceId, &bodyDef );
+
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Circle circle = { { 0.0f, 0.0f }, 0.5f };
+	b2CreateCircleShape( bodyId, &shapeDef, &circle );
+	b2CreateCircleShape( referenceBodyId, &shapeDef, &circle );
+
+	ENSURE( b2Body_GetSimulationInterval( bodyId ) == 4 );
+	ENSURE( b2Body_GetSimulationInterval( referenceBodyId ) == 1 );
+
+	int updateCount = 0;
+	int parkedCount = 0;
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2Vec2 position = b2Body_GetPosition( bodyId );
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		b2World_Step( referenceId, 1.0f / 60.0f, 4 );
+
+		updateCount += b2Body_GetPosition( bodyId ).y != position.y ? 1 : 0;
+		parkedCount += b2World_GetAwakeBodyCount( worldId ) == 0 ? 1 : 0;
+		ENSURE( b2Body_IsAwake( bodyId ) );
+	}
+
+	// The parked body is simulated every fourth step and stays out of the awake set in between
+	ENSURE( 15 <= updateCount && updateCount <= 16 );
+	ENSURE( parkedCount >= 44 );
+
+	// The skipped time is not lost
+	b2Vec2 position = b2Body_GetPosition( bodyId );
+	b2Vec2 referencePosition = b2Body_GetPosition( referenceBodyId );
+	ENSURE_SMALL( position.y - referencePosition.y, 0.5f );
+	ENSURE( position.y < 16.0f );
+
+	b2Vec2 velocity = b2Body_GetLinearVelocity( bodyId );
+	b2Vec2 referenceVelocity = b2Body_GetLinearVelocity( referenceBodyId );
+	ENSURE_SMALL( velocity.y - referenceVelocity.y, 1.0f );
+
+	// Back to full rate
+	b2Body_SetSimulationInterval( bodyId, 1 );
+	ENSURE( b2World_GetAwakeBodyCount( worldId ) == 1 );
+	position = b2Body_GetPosition( bodyId );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	ENSURE( b2Body_GetPosition( bodyId ).y < position.y );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	ENSURE( b2World_GetAwakeBodyCount( worldId ) == 1 );
+
+	b2DestroyWorld( worldId );
+	b2DestroyWorld( referenceId );
+
+	// A parked pile settles on the ground and goes to sleep
+	worldId = b2CreateWorld( &worldDef );
+
+	bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2Polygon groundBox = b2MakeBox( 20.0f, 1.0f );
+	b2CreatePolygonShape( groundId, &shapeDef, &groundBox );
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.simulationInterval = 3;
+	b2Polygon box = b2MakeSquare( 0.5f );
+	b2BodyId boxIds[5];
+	for ( int i = 0; i < 5; ++i )
+	{
+		bodyDef.position = ( b2Vec2 ){ 0.0f, 1.5f + 1.0f * i };
+		boxIds[i] = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( boxIds[i], &shapeDef, &box );
+	}
+
+	int stepCount = 0;
+	while ( b2Body_IsAwake( boxIds[4] ) && stepCount < 1000 )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		stepCount += 1;
+	}
+
+	ENSURE( stepCount < 1000 );
+	for ( int i = 0; i < 5; ++i )
+	{
+		ENSURE( b2Body_IsAwake( boxIds[i] ) == false );
+		b2Vec2 boxPosition = b2Body_GetPosition( boxIds[i] );
+		ENSURE_SMALL( boxPosition.x, 0.05f );
+		ENSURE_SMALL( boxPosition.y - ( 1.5f + 1.0f * i ), 0.1f );
+	}
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+// Islands outside of the active regions are frozen and keep their velocity
+static int TestActiveRegions( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.gravity = b2Vec2_zero;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.linearVelocity = ( b2Vec2 ){ 5.0f, 0.0f };
+	bodyDef.position = ( b2Vec2 ){ -10.0f, 0.0f };
+	b2BodyId leftId = b2CreateBody( worldId, &bodyDef );
+	bodyDef.position = ( b2Vec2 ){ 10.0f, 0.0f };
+	b2BodyId rightId = b2CreateBody( worldId, &bodyDef );
+
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Circle circle = { { 0.0f, 0.0f }, 0.5f };
+	b2CreateCircleShape( leftId, &shapeDef, &circle );
+	b2CreateCircleShape( rightId, &shapeDef, &circle );
+
+	b2AABB leftRegion = { { -20.0f, -5.0f }, { 0.0f, 5.0f } };
+	b2World_SetActiveRegions( worldId, &leftRegion, 1 );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+	ENSURE( b2Body_IsAwake( leftId ) );
+	ENSURE( b2Body_IsAwake( rightId ) == false );
+	ENSURE( b2World_GetAwakeBodyCount( worldId ) == 1 );
+
+	// Frozen bodies stay in place and keep their velocity
+	b2Vec2 rightPosition = b2Body_GetPosition( rightId );
+	for ( int i = 0; i < 10; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	ENSURE( b2Body_GetPosition( rightId ).x == rightPosition.x );
+	ENSURE_SMALL( b2Body_GetLinearVelocity( rightId ).x - 5.0f, FLT_EPSILON );
+
+	// Thawed when a region reaches them
+	b2AABB rightRegion = { { 0.0f, -5.0f }, { 20.0f, 5.0f } };
+	b2World_SetActiveRegions( worldId, &rightRegion, 1 );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+	ENSURE( b2Body_IsAwake( leftId ) == false );
+	ENSURE( b2Body_IsAwake( rightId ) );
+	ENSURE( b2Body_GetPosition( rightId ).x > rightPosition.x );
+
+	// No regions thaws everything
+	b2World_SetActiveRegions( worldId, NULL, 0 );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	ENSURE( b2World_GetAwakeBodyCount( worldId ) == 2 );
+	ENSURE_SMALL( b2Body_GetLinearVelocity( leftId ).x - 5.0f, FLT_EPSILON );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+static int TestSeparatedContacts( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.gravity = b2Vec2_zero;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Polygon ground = b2MakeBox( 5.0f, 0.5f );
+	b2CreatePolygonShape( groundId, &shapeDef, &ground );
+
+	// The fat AABBs overlap but the box starts 0.08 above the ground and drifts down slowly
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position = ( b2Vec2 ){ 0.0f, 1.08f };
+	bodyDef.linearVelocity = ( b2Vec2 ){ 0.0f, -0.3f };
+	b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+	shapeDef.enableContactEvents = true;
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	b2CreatePolygonShape( bodyId, &shapeDef, &box );
+
+	int separatedCount = 0;
+	int beginCount = 0;
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		separatedCount += b2World_GetCounters( worldId ).separatedContactCount;
+		beginCount += b2World_GetContactEvents( worldId ).beginCount;
+	}
+
+	// The contact skipped the narrow phase while far apart and still caught the landing
+	ENSURE( separatedCount > 0 );
+	ENSURE( beginCount == 1 );
+	ENSURE( b2Body_GetPosition( bodyId ).y > 0.99f );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+// Kinematic bodies that touch nothing and have no joints move outside of the constraint solver
+static int TestDetachedKinematics( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.gravity = b2Vec2_zero;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	shapeDef.enableContactEvents = true;
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_kinematicBody;
+	bodyDef.position = ( b2Vec2 ){ -4.0f, 0.0f };
+	bodyDef.linearVelocity = ( b2Vec2 ){ 2.0f, 0.0f };
+	b2BodyId platformId = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( platformId, &shapeDef, &box );
+
+	bodyDef.position = ( b2Vec2 ){ 0.0f, 5.0f };
+	bodyDef.linearVelocity = b2Vec2_zero;
+	bodyDef.angularVelocity = 1.0f;
+	b2BodyId spinnerId = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( spinnerId, &shapeDef, &box );
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position = ( b2Vec2 ){ 2.0f, 0.0f };
+	bodyDef.angularVelocity = 0.0f;
+	b2BodyId boxId = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( boxId, &shapeDef, &box );
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	ENSURE( b2World_GetCounters( worldId ).detachedKinematicCount == 2 );
+	ENSURE( b2World_GetAwakeBodyCount( worldId ) == 3 );
+
+	for ( int i = 1; i < 60; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	// Detached bodies keep moving at their velocity
+	ENSURE( b2World_GetCounters( worldId ).detachedKinematicCount == 2 );
+	ENSURE( b2AbsFloat( b2Body_GetPosition( platformId ).x + 2.0f ) < 0.001f );
+	ENSURE( b2Body_GetLinearVelocity( platformId ).x == 2.0f );
+	ENSURE( b2AbsFloat( b2Rot_GetAngle( b2Body_GetRotation( spinnerId ) ) - 1.0f ) < 0.001f );
+	ENSURE( b2Body_IsAwake( platformId ) && b2Body_IsAwake( spinnerId ) );
+
+	// A joint brings the spinner back to the awake set
+	bodyDef.position = ( b2Vec2 ){ 0.0f, 7.0f };
+	b2BodyId bobId = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( bobId, &shapeDef, &box );
+
+	b2RevoluteJointDef jointDef = b2DefaultRevoluteJointDef();
+	jointDef.base.bodyIdA = spinnerId;
+	jointDef.base.bodyIdB = bobId;
+	jointDef.base.localFrameA.p = ( b2Vec2 ){ 0.0f, 1.0f };
+	jointDef.base.localFrameB.p = ( b2Vec2 ){ 0.0f, -1.0f };
+	b2JointId jointId = b2CreateRevoluteJoint( worldId, &jointDef );
+	ENSURE( b2World_GetCounters( worldId ).detachedKinematicCount == 1 );
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	ENSURE( b2World_GetCounters( worldId ).detachedKinematicCount == 1 );
+	b2DestroyJoint( jointId, false );
+	b2DestroyBody( bobId );
+
+	// The platform pushes the box once they touch, four seconds after the start
+	int beginCount = 0;
+	for ( int i = 0; i < 179; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		beginCount += b2World_GetContactEvents( worldId ).beginCount;
+	}
+
+	ENSURE( beginCount == 1 );
+	ENSURE( b2Body_GetPosition( boxId ).x > 2.5f );
+	ENSURE( b2AbsFloat( b2Body_GetPosition( platformId ).x - 4.0f ) < 0.01f );
+
+	// A stopped platform falls asleep and wakes up when it moves again
+	b2Body_SetLinearVelocity( platformId, b2Vec2_zero );
+	for ( int i = 0; i < 120; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	ENSURE( b2Body_IsAwake( platformId ) == false );
+
+	b2Body_SetLinearVelocity( platformId, ( b2Vec2 ){ 0.0f, 1.0f } );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	ENSURE( b2Body_IsAwake( platformId ) );
+	ENSURE( b2Body_GetPosition( platformId ).y > 0.0f );
+
+	// Changing the type, disabling, and destroying detached bodies
+	b2Body_Disable( spinnerId );
+	b2Body_Enable( spinnerId );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	b2Body_SetType( spinnerId, b2_dynamicBody );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	b2Body_SetType( spinnerId, b2_kinematicBody );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	b2DestroyBody( spinnerId );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+// Circles cross an empty area and hit a wall of static boxes. Returns the proxy moves and margin pairs.
+static int VelocityMarginRun( bool enableVelocityMargins, int* enlargedCount, int* marginPairCount )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.gravity = b2Vec2_zero;
+	worldDef.enableVelocityMargins = enableVelocityMargins;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+	b2World_EnableDetailedCounters( worldId, true );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	shapeDef.enableContactEvents = true;
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	b2Circle circle = { b2Vec2_zero, 0.25f };
+
+	for ( int i = 0; i < 10; ++i )
+	{
+		bodyDef.type = b2_staticBody;
+		bodyDef.position = ( b2Vec2 ){ 6.0f, 2.0f * i };
+		bodyDef.linearVelocity = b2Vec2_zero;
+		b2BodyId wallId = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( wallId, &shapeDef, &box );
+
+		bodyDef.type = b2_dynamicBody;
+		bodyDef.position = ( b2Vec2 ){ 0.0f, 2.0f * i };
+		bodyDef.linearVelocity = ( b2Vec2 ){ 10.0f, 0.0f };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2CreateCircleShape( bodyId, &shapeDef, &circle );
+	}
+
+	*enlargedCount = 0;
+	*marginPairCount = 0;
+	int beginCount = 0;
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		b2Counters counters = b2World_GetCounters( worldId );
+		*enlargedCount += counters.enlargedProxyCount;
+		*marginPairCount += counters.marginPairCount;
+		beginCount += b2World_GetContactEvents( worldId ).beginCount;
+	}
+
+	b2DestroyWorld( worldId );
+
+	return beginCount;
+}
+
+static int TestVelocityMargins( void )
+{
+	int fixedEnlarged, fixedPairs;
+	int fixedBeginCount = VelocityMarginRun( false, &fixedEnlarged, &fixedPairs );
+
+	int sweptEnlarged, sweptPairs;
+	int sweptBeginCount = VelocityMarginRun( true, &sweptEnlarged, &sweptPairs );
+
+	// Every circle hits the wall either way
+	ENSURE( fixedBeginCount == 10 );
+	ENSURE( sweptBeginCount == 10 );
+
+	// The swept boxes cover several steps of motion
+	ENSURE( 2 * sweptEnlarged < fixedEnlarged );
+
+	// The swept boxes reach the wall before the circles do
+	ENSURE( sweptPairs > 0 );
+	ENSURE( fixedPairs <= sweptPairs );
+
+	return 0;
+}
+
+static b2WorldId CreateAdaptiveBlockWorld( bool enableAdaptiveBlocks, b2BodyId* lastBodyId )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+	worldDef.enableAdaptiveBlocks = enableAdaptiveBlocks;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Segment segment = { { -40.0f, 0.0f }, { 40.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeSquare( 0.5f );
+	for ( int i = 0; i < 20; ++i )
+	{
+		for ( int j = 0; j < 10; ++j )
+		{
+			bodyDef.position = ( b2Vec2 ){ -30.0f + 3.0f * i + 0.1f * j, 0.5f + 1.0f * j };
+			*lastBodyId = b2CreateBody( worldId, &bodyDef );
+			b2CreatePolygonShape( *lastBodyId, &shapeDef, &box );
+		}
+	}
+
+	return worldId;
+}
+
+static int TestAdaptiveBlocks( void )
+{
+	b2BodyId fixedBodyId, adaptiveBodyId;
+	b2WorldId fixedWorldId = CreateAdaptiveBlockWorld( false, &fixedBodyId );
+	b2WorldId adaptiveWorldId = CreateAdaptiveBlockWorld( true, &adaptiveBodyId );
+
+	for ( int i = 0; i < 90; ++i )
+	{
+		b2World_Step( fixedWorldId, 1.0f / 60.0f, 4 );
+		b2World_Step( adaptiveWorldId, 1.0f / 60.0f, 4 );
+	}
+
+	// Block sizes don't change the results
+	b2Transform fixedTransform = b2Body_GetTransform( fixedBodyId );
+	b2Transform adaptiveTransform = b2Body_GetTransform( adaptiveBodyId );
+	ENSURE( memcmp( &fixedTransform, &adaptiveTransform, sizeof( b2Transform ) ) == 0 );
+
+	b2ParallelForProfile profiles[32];
+	ENSURE( b2World_GetParallelForProfile( fixedWorldId, profiles, 32 ) == 0 );
+
+	int siteCount = b2World_GetParallelForProfile( adaptiveWorldId, profiles, 32 );
+	ENSURE( 0 < siteCount && siteCount <= 32 );
+
+	bool foundFinalize = false;
+	for ( int i = 0; i < siteCount; ++i )
+	{
+		b2ParallelForProfile profile = profiles[i];
+		ENSURE( profile.name != NULL && profile.name[0] == 'b' );
+		ENSURE( profile.blockCount >= profile.callCount );
+		ENSURE( profile.workTime >= 0.0f && profile.claimTime >= 0.0f && profile.waitTime >= 0.0f );
+
+		if ( strcmp( profile.name, "b2FinalizeBodiesTask" ) == 0 )
+		{
+			foundFinalize = true;
+			ENSURE( profile.callCount == 1 );
+			ENSURE( profile.itemCount == b2World_GetAwakeBodyCount( adaptiveWorldId ) );
+			ENSURE( profile.blockSize > 0 );
+		}
+	}
+
+	ENSURE( foundFinalize );
+
+	b2DestroyWorld( fixedWorldId );
+	b2DestroyWorld( adaptiveWorldId );
+
+	return 0;
+}
+
+// The solver threads wait differently but solve the same blocks
+static int TestWaitPolicies( void )
+{
+	b2WaitPolicy policies[] = { b2_waitYield, b2_waitSpin, b2_waitPark };
+	b2Transform transforms[3];
+
+	for ( int i = 0; i < 3; ++i )
+	{
+		b2WorldDef worldDef = b2DefaultWorldDef();
+		worldDef.workerCount = 4;
+		worldDef.waitPolicy = policies[i];
+		worldDef.waitSpinCount = 2;
+		b2WorldId worldId = b2CreateWorld( &worldDef );
+		ENSURE( b2World_GetWaitPolicy( worldId ) == policies[i] );
+
+		b2BodyDef bodyDef = b2DefaultBodyDef();
+		b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+		b2ShapeDef shapeDef = b2DefaultShapeDef();
+		b2Segment segment = { { -20.0f, 0.0f }, { 20.0f, 0.0f } };
+		b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+		bodyDef.type = b2_dynamicBody;
+		b2Polygon box = b2MakeSquare( 0.5f );
+		b2BodyId bodyId = b2_nullBodyId;
+		for ( int j = 0; j < 100; ++j )
+		{
+			bodyDef.position = ( b2Vec2 ){ -10.0f + 2.0f * ( j % 10 ) + 0.1f * ( j / 10 ), 0.5f + 1.0f * ( j / 10 ) };
+			bodyId = b2CreateBody( worldId, &bodyDef );
+			b2CreatePolygonShape( bodyId, &shapeDef, &box );
+		}
+
+		for ( int j = 0; j < 20; ++j )
+		{
+			// Switching the policy between steps is allowed
+			if ( j == 10 )
+			{
+				b2World_SetWaitPolicy( worldId, policies[( i + 1 ) % 3], 0 );
+			}
+
+			b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		}
+
+		transforms[i] = b2Body_GetTransform( bodyId );
+		b2DestroyWorld( worldId );
+	}
+
+	ENSURE( memcmp( transforms + 0, transforms + 1, sizeof( b2Transform ) ) == 0 );
+	ENSURE( memcmp( transforms + 0, transforms + 2, sizeof( b2Transform ) ) == 0 );
+
+	return 0;
+}
+
+static int TestAutoWorkers( void )
+{
+	b2BodyId fixedBodyId, autoBodyId;
+	b2WorldId fixedWorldId = CreateAdaptiveBlockWorld( false, &fixedBodyId );
+	b2WorldId autoWorldId = CreateAdaptiveBlockWorld( false, &autoBodyId );
+	b2World_EnableAutoWorkers( autoWorldId, true );
+	ENSURE( b2World_IsAutoWorkersEnabled( autoWorldId ) );
+
+	b2World_Step( fixedWorldId, 1.0f / 60.0f, 4 );
+	b2World_Step( autoWorldId, 1.0f / 60.0f, 4 );
+
+	// Two hundred boxes and their ground contacts don't need four solver workers
+	ENSURE( b2World_GetCounters( fixedWorldId ).solverWorkerCount == 4 );
+	ENSURE( b2World_GetCounters( autoWorldId ).solverWorkerCount == 1 );
+	ENSURE( b2World_GetCounters( autoWorldId ).taskCount < b2World_GetCounters( fixedWorldId ).taskCount );
+
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2World_Step( fixedWorldId, 1.0f / 60.0f, 4 );
+		b2World_Step( autoWorldId, 1.0f / 60.0f, 4 );
+	}
+
+	b2Transform fixedTransform = b2Body_GetTransform( fixedBodyId );
+	b2Transform autoTransform = b2Body_GetTransform( autoBodyId );
+	ENSURE( memcmp( &fixedTransform, &autoTransform, sizeof( b2Transform ) ) == 0 );
+
+	b2DestroyWorld( fixedWorldId );
+	b2DestroyWorld( autoWorldId );
+
+	// A large pile uses the full pool
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+	worldDef.enableAutoWorkers = true;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Polygon box = b2MakeSquare( 0.5f );
+	for ( int i = 0; i < 2000; ++i )
+	{
+		bodyDef.position = ( b2Vec2 ){ 1.5f * ( i % 50 ), 1.5f * ( i / 50 ) };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyId, &shapeDef, &box );
+	}
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	ENSURE( b2World_GetCounters( worldId ).solverWorkerCount == 4 );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+
+typedef struct TaskInfoLog
+{
+	int solverCount;
+	int gangMask;
+	int backgroundCount;
+	int normalCount;
+	int plainCount;
+	int errorCount;
+} TaskInfoLog;
+
+// Runs each task inline, the solver supports this even for its worker gang
+static void* EnqueueTaskWithInfo( b2TaskCallback* task, void* taskContext, const b2TaskInfo* info, void* userContext )
+{
+	TaskInfoLog* log = userContext;
+	if ( info->gangSize > 0 )
+	{
+		bool valid = info->priority == b2_taskPriorityHigh && 0 <= info->gangIndex && info->gangIndex < info->gangSize;
+		log->errorCount += valid ? 0 : 1;
+		log->solverCount += 1;
+		log->gangMask |= 1 << info->gangIndex;
+	}
+	else if ( info->priority == b2_taskPriorityBackground )
+	{
+		log->backgroundCount += 1;
+	}
+	else if ( info->priority == b2_taskPriorityNormal )
+	{
+		log->errorCount += info->name != NULL && info->name[0] != '&' ? 0 : 1;
+		log->normalCount += 1;
+	}
+
+	task( taskContext );
+	return NULL;
+}
+
+static void* EnqueueTaskPlain( b2TaskCallback* task, void* taskContext, void* userContext )
+{
+	TaskInfoLog* log = userContext;
+	log->plainCount += 1;
+	task( taskContext );
+	return NULL;
+}
+
+static void FinishTaskInline( void* userTask, void* userContext )
+{
+	(void)userTask;
+	(void)userContext;
+}
+
+static int TestTaskInfo( void )
+{
+	TaskInfoLog log = { 0 };
+
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+	worldDef.enqueueTask = EnqueueTaskPlain;
+	worldDef.enqueueTaskEx = EnqueueTaskWithInfo;
+	worldDef.finishTask = FinishTaskInline;
+	worldDef.userTaskContext = &log;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Polygon box = b2MakeSquare( 0.5f );
+	for ( int i = 0; i < 20; ++i )
+	{
+		bodyDef.position = ( b2Vec2 ){ 0.0f, 1.0f * i };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyId, &shapeDef, &box );
+	}
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+	// The extended callback takes over and tags the solver workers as one gang
+	ENSURE( log.plainCount == 0 );
+	ENSURE( log.errorCount == 0 );
+	ENSURE( log.solverCount == 4 );
+	ENSURE( log.gangMask == 0xF );
+	ENSURE( log.backgroundCount >= 1 );
+	ENSURE( log.normalCount >= 1 );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+#define DRAW_LOG_CAPACITY 4096
+
+typedef struct DrawEntry
+{
+	b2DrawPrimitiveType type;
+	b2HexColor color;
+	b2Vec2 point;
+} DrawEntry;
+
+typedef struct DrawLog
+{
+	DrawEntry entries[DRAW_LOG_CAPACITY];
+	int count;
+	int batchCount;
+} DrawLog;
+
+static DrawLog s_drawLogs[2];
+
+static void LogDrawEntry( DrawLog* log, b2DrawPrimitiveType type, b2HexColor color, b2Vec2 point )
+{
+	if ( log->count < DRAW_LOG_CAPACITY )
+	{
+		log->entries[log->count] = (DrawEntry){ type, color, point };
+	}
+	log->count += 1;
+}
+
+static void LogPolygon( const b2Vec2* vertices, int vertexCount, b2HexColor color, void* context )
+{
+	(void)vertexCount;
+	LogDrawEntry( context, b2_drawPolygon, color, vertices[0] );
+}
+
+static void LogSolidPolygon( b2Transform transform, const b2Vec2* vertices, int vertexCount, float radius, b2HexColor color,
+							 void* context )
+{
+	(void)vertexCount;
+	(void)radius;
+	LogDrawEntry( context, b2_drawSolidPolygon, color, b2TransformPoint( transform, vertices[0] ) );
+}
+
+static void LogSolidCircle( b2Transform transform, float radius, b2HexColor color, void* context )
+{
+	(void)radius;
+	LogDrawEntry( context, b2_drawSolidCircle, color, transform.p );
+}
+
+static void LogSolidCapsule( b2Vec2 p1, b2Vec2 p2, float radius, b2HexColor color, void* context )
+{
+	(void)p2;
+	(void)radius;
+	LogDrawEntry( context, b2_drawSolidCapsule, color, p1 );
+}
+
+static void LogLine( b2Vec2 p1, b2Vec2 p2, b2HexColor color, void* context )
+{
+	(void)p2;
+	LogDrawEntry( context, b2_drawLine, color, p1 );
+}
+
+static void LogPoint( b2Vec2 p, float size, b2HexColor color, void* context )
+{
+	(void)size;
+	LogDrawEntry( context, b2_drawPoint, color, p );
+}
+
+static void LogBatch( const b2DrawBatch* batch, void* context )
+{
+	DrawLog* log = context;
+	log->batchCount += 1;
+	for ( int i = 0; i < batch->primitiveCount; ++i )
+	{
+		const b2DrawPrimitive* primitive = batch->primitives + i;
+		LogDrawEntry( log, primitive->type, primitive->color, batch->vertices[primitive->vertexIndex] );
+	}
+}
+
+// Draws with one call per primitive and with a batch, which must give the same primitives in the same order
+static int DrawBothWays( b2WorldId worldId, b2AABB bounds )
+{
+	for ( int i = 0; i < 2; ++i )
+	{
+		DrawLog* log = s_drawLogs + i;
+		log->count = 0;
+		log->batchCount = 0;
+
+		b2DebugDraw draw = b2DefaultDebugDraw();
+		draw.DrawPolygonFcn = LogPolygon;
+		draw.DrawSolidPolygonFcn = LogSolidPolygon;
+		draw.DrawSolidCircleFcn = LogSolidCircle;
+		draw.DrawSolidCapsuleFcn = LogSolidCapsule;
+		draw.DrawLineFcn = LogLine;
+		draw.DrawPointFcn = LogPoint;
+		draw.DrawBatchFcn = i == 1 ? LogBatch : NULL;
+		draw.drawBounds = true;
+		draw.drawingBounds = bounds;
+		draw.context = log;
+		b2World_Draw( worldId, &draw );
+	}
+
+	DrawLog* plain = s_drawLogs + 0;
+	DrawLog* batched = s_drawLogs + 1;
+	ENSURE( plain->batchCount == 0 );
+	ENSURE( batched->batchCount == 1 );
+	ENSURE( plain->count <= DRAW_LOG_CAPACITY );
+	ENSURE( plain->count == batched->count );
+
+	for ( int i = 0; i < plain->count; ++i )
+	{
+		DrawEntry a = plain->entries[i];
+		DrawEntry b = batched->entries[i];
+		ENSURE( a.type == b.type );
+		ENSURE( a.color == b.color );
+		ENSURE( a.point.x == b.point.x && a.point.y == b.point.y );
+	}
+
+	return 0;
+}
+
+static int TestDrawBatch( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Segment segment = { { -40.0f, 0.0f }, { 40.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	b2Vec2 points[4] = { { -40.0f, -2.0f }, { 40.0f, -2.0f }, { 40.0f, 60.0f }, { -40.0f, 60.0f } };
+	b2ChainDef chainDef = b2DefaultChainDef();
+	chainDef.points = points;
+	chainDef.count = 4;
+	chainDef.isLoop = true;
+	b2CreateChain( groundId, &chainDef );
+
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.4f, 0.4f );
+	b2Circle circle = { { 0.1f, 0.0f }, 0.4f };
+	b2Capsule capsule = { { -0.2f, 0.0f }, { 0.2f, 0.0f }, 0.25f };
+	for ( int i = 0; i < 600; ++i )
+	{
+		bodyDef.position = (b2Vec2){ -30.0f + 1.0f * ( i % 60 ), 1.0f + 1.0f * ( i / 60 ) };
+		bodyDef.rotation = b2MakeRot( 0.1f * i );
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		if ( i % 3 == 0 )
+		{
+			b2CreatePolygonShape( bodyId, &shapeDef, &box );
+		}
+		else if ( i % 3 == 1 )
+		{
+			b2CreateCircleShape( bodyId, &shapeDef, &circle );
+		}
+		else
+		{
+			b2CreateCapsuleShape( bodyId, &shapeDef, &capsule );
+		}
+	}
+
+	for ( int i = 0; i < 10; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	b2AABB everything = { { -FLT_MAX, -FLT_MAX }, { FLT_MAX, FLT_MAX } };
+	int result = DrawBothWays( worldId, everything );
+	ENSURE( result == 0 );
+
+	// shape and bounds of each body, the ground segment and bounds, and three primitives plus bounds per chain segment
+	ENSURE( s_drawLogs[1].count == 2 * 600 + 2 + 4 * 4 );
+
+	int fullCount = s_drawLogs[1].count;
+	b2AABB culled = { { -40.0f, -5.0f }, { 0.0f, 5.0f } };
+	result = DrawBothWays( worldId, culled );
+	ENSURE( result == 0 );
+	ENSURE( 0 < s_drawLogs[1].count && s_drawLogs[1].count < fullCount );
+
+	b2DestroyWorld( worldId );
+	return 0;
+}
+
+static int TestBodyRefs( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Polygon groundBox = b2MakeBox( 20.0f, 1.0f );
+	b2CreatePolygonShape( groundId, &shapeDef, &groundBox );
+
+	enum
+	{
+		e_count = 8
+	};
+
+	b2BodyId bodyIds[e_count + 1];
+	bodyIds[0] = groundId;
+
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	for ( int i = 1; i <= e_count; ++i )
+	{
+		bodyDef.position = (b2Vec2){ -8.0f + 2.0f * i, 2.0f + 0.5f * i };
+		bodyDef.angularVelocity = 0.5f * i;
+		bodyIds[i] = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyIds[i], &shapeDef, &box );
+	}
+
+	for ( int i = 0; i < 10; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	b2BodyRef refs[e_count + 1];
+	b2World_GetBodyRefs( worldId, bodyIds, e_count + 1, refs );
+
+	for ( int i = 0; i <= e_count; ++i )
+	{
+		ENSURE( b2BodyRef_IsValid( refs[i] ) );
+
+		b2BodyRef ref = b2Body_GetRef( bodyIds[i] );
+		ENSURE( ref.sim == refs[i].sim && ref.state == refs[i].state );
+
+		b2Transform a = b2BodyRef_GetTransform( ref );
+		b2Transform b = b2Body_GetTransform( bodyIds[i] );
+		ENSURE( a.p.x == b.p.x && a.p.y == b.p.y && a.q.c == b.q.c && a.q.s == b.q.s );
+
+		b2Vec2 v1 = b2BodyRef_GetLinearVelocity( ref );
+		b2Vec2 v2 = b2Body_GetLinearVelocity( bodyIds[i] );
+		ENSURE( v1.x == v2.x && v1.y == v2.y );
+		ENSURE( b2BodyRef_GetAngularVelocity( ref ) == b2Body_GetAngularVelocity( bodyIds[i] ) );
+
+		b2Vec2 c1 = b2BodyRef_GetWorldCenterOfMass( ref );
+		b2Vec2 c2 = b2Body_GetWorldCenterOfMass( bodyIds[i] );
+		ENSURE( c1.x == c2.x && c1.y == c2.y );
+	}
+
+	b2Vec2 positions[e_count + 1];
+	float angularVelocities[e_count + 1];
+	b2BodyStateArrays arrays = { 0 };
+	arrays.positions = positions;
+	arrays.angularVelocities = angularVelocities;
+	b2BodyRef_GetStates( refs, e_count + 1, &arrays );
+
+	for ( int i = 0; i <= e_count; ++i )
+	{
+		b2Vec2 p = b2Body_GetPosition( bodyIds[i] );
+		ENSURE( positions[i].x == p.x && positions[i].y == p.y );
+		ENSURE( angularVelocities[i] == b2Body_GetAngularVelocity( bodyIds[i] ) );
+	}
+
+	// Changes that move body data expire the references
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	ENSURE( b2BodyRef_IsValid( refs[1] ) == false );
+
+	b2BodyRef ref = b2Body_GetRef( bodyIds[1] );
+	ENSURE( b2BodyRef_IsValid( ref ) );
+	b2DestroyBody( bodyIds[e_count] );
+	ENSURE( b2BodyRef_IsValid( ref ) == false );
+
+	ref = b2Body_GetRef( bodyIds[1] );
+	b2Body_SetType( bodyIds[1], b2_staticBody );
+	ENSURE( b2BodyRef_IsValid( ref ) == false );
+
+	ref = b2Body_GetRef( bodyIds[2] );
+	b2DestroyWorld( worldId );
+	ENSURE( b2BodyRef_IsValid( ref ) == false );
+
+	return 0;
+}
+
+static bool TagFilter( b2ShapeId shapeIdA, b2ShapeId shapeIdB, void* context )
+{
+	(void)context;
+	intptr_t tagA = (intptr_t)b2Shape_GetUserData( shapeIdA );
+	intptr_t tagB = (intptr_t)b2Shape_GetUserData( shapeIdB );
+	return ( tagA + tagB ) % 3 != 0;
+}
+
+static bool MaterialPreSolve( b2ShapeId shapeIdA, b2ShapeId shapeIdB, b2Vec2 point, b2Vec2 normal, void* context )
+{
+	(void)point;
+	(void)normal;
+	(void)context;
+	return b2Shape_GetUserMaterial( shapeIdA ) != 7 && b2Shape_GetUserMaterial( shapeIdB ) != 7;
+}
+
+typedef struct BatchLog
+{
+	int callCount;
+	int maxCount;
+} BatchLog;
+
+static void TagFilterBatch( const b2ShapePair* pairs, bool* results, int count, void* context )
+{
+	BatchLog* log = context;
+	log->callCount += 1;
+	log->maxCount = count > log->maxCount ? count : log->maxCount;
+
+	for ( int i = 0; i < count; ++i )
+	{
+		intptr_t tagA = (intptr_t)pairs[i].userDataA;
+		intptr_t tagB = (intptr_t)pairs[i].userDataB;
+		results[i] = ( tagA + tagB ) % 3 != 0;
+	}
+}
+
+static void MaterialPreSolveBatch( const b2PreSolveContact* contacts, bool* results, int count, void* context )
+{
+	BatchLog* log = context;
+	log->callCount += 1;
+	log->maxCount = count > log->maxCount ? count : log->maxCount;
+
+	for ( int i = 0; i < count; ++i )
+	{
+		results[i] = contacts[i].pair.userMaterialIdA != 7 && contacts[i].pair.userMaterialIdB != 7;
+	}
+}
+
+static b2WorldId CreateFilterWorld( int config, b2BodyId* bodyIds, int bodyCount )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.enableSortedCollide = config == 1;
+	worldDef.enableFusedPrepare = config == 2;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	shapeDef.enableCustomFiltering = true;
+	shapeDef.enablePreSolveEvents = true;
+	shapeDef.userData = (void*)(intptr_t)1;
+	b2Polygon groundBox = b2MakeBox( 40.0f, 1.0f );
+	b2CreatePolygonShape( groundId, &shapeDef, &groundBox );
+
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	for ( int i = 0; i < bodyCount; ++i )
+	{
+		bodyDef.position = (b2Vec2){ -10.0f + 1.1f * ( i % 20 ), 1.5f + 1.1f * ( i / 20 ) };
+		bodyIds[i] = b2CreateBody( worldId, &bodyDef );
+		shapeDef.userData = (void*)(intptr_t)( i + 2 );
+		shapeDef.material.userMaterialId = i % 5 == 0 ? 7 : 0;
+		b2CreatePolygonShape( bodyIds[i], &shapeDef, &box );
+	}
+
+	return worldId;
+}
+
+// The batch callbacks give the same simulation as the per pair callbacks
+static int TestBatchCallbacks( void )
+{
+	enum
+	{
+		e_count = 200
+	};
+
+	for ( int config = 0; config < 3; ++config )
+	{
+		b2BodyId bodyIdsA[e_count], bodyIdsB[e_count];
+		b2WorldId worldA = CreateFilterWorld( config, bodyIdsA, e_count );
+		b2WorldId worldB = CreateFilterWorld( config, bodyIdsB, e_count );
+
+		b2World_SetCustomFilterCallback( worldA, TagFilter, NULL );
+		b2World_SetPreSolveCallback( worldA, MaterialPreSolve, NULL );
+
+		BatchLog filterLog = { 0 }, preSolveLog = { 0 };
+		b2World_SetCustomFilterBatchCallback( worldB, TagFilterBatch, &filterLog );
+		b2World_SetPreSolveBatchCallback( worldB, MaterialPreSolveBatch, &preSolveLog );
+
+		for ( int i = 0; i < 90; ++i )
+		{
+			b2World_Step( worldA, 1.0f / 60.0f, 4 );
+			b2World_Step( worldB, 1.0f / 60.0f, 4 );
+		}
+
+		ENSURE( filterLog.callCount > 0 && filterLog.maxCount > 1 );
+		ENSURE( preSolveLog.callCount > 0 && preSolveLog.maxCount > 1 );
+
+		int fallenCount = 0;
+		for ( int i = 0; i < e_count; ++i )
+		{
+			b2Transform a = b2Body_GetTransform( bodyIdsA[i] );
+			b2Transform b = b2Body_GetTransform( bodyIdsB[i] );
+			ENSURE( a.p.x == b.p.x && a.p.y == b.p.y && a.q.c == b.q.c && a.q.s == b.q.s );
+			fallenCount += a.p.y < 0.0f ? 1 : 0;
+		}
+
+		// The pre-solve drops the boxes with material 7 through the ground
+		ENSURE( fallenCount >= e_count / 5 );
+
+		b2DestroyWorld( worldA );
+		b2DestroyWorld( worldB );
+	}
+
+	return 0;
+}
+
+// Pair finding prunes the tree with the mask bits of the query shape, except for positive groups
+static int TestFilterPruning( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+	b2World_EnableDetailedCounters( worldId, true );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	shapeDef.filter.categoryBits = 1;
+	b2Polygon groundBox = b2MakeBox( 20.0f, 1.0f );
+	b2CreatePolygonShape( groundId, &shapeDef, &groundBox );
+
+	enum
+	{
+		e_count = 64
+	};
+
+	// Overlapping boxes that only collide with the ground
+	bodyDef.type = b2_dynamicBody;
+	shapeDef.filter.categoryBits = 2;
+	shapeDef.filter.maskBits = 1;
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	for ( int i = 0; i < e_count; ++i )
+	{
+		bodyDef.position = (b2Vec2){ 0.1f * i, 1.5f };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyId, &shapeDef, &box );
+	}
+
+	// A positive group collides regardless of the mask bits
+	shapeDef.filter.categoryBits = 4;
+	shapeDef.filter.maskBits = 0;
+	shapeDef.filter.groupIndex = 3;
+	bodyDef.position = (b2Vec2){ 10.0f, 5.0f };
+	b2BodyId groupIdA = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( groupIdA, &shapeDef, &box );
+	bodyDef.position = (b2Vec2){ 10.0f, 5.5f };
+	b2BodyId groupIdB = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( groupIdB, &shapeDef, &box );
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+	b2Counters counters = b2World_GetCounters( worldId );
+	ENSURE( counters.contactCount == e_count + 1 );
+
+	// Without pruning every box would reach the leaves of all the others
+	ENSURE( counters.pairLeafVisits < e_count * e_count / 2 );
+
+	b2ContactData contactData[2];
+	ENSURE( b2Body_GetContactData( groupIdA, contactData, 2 ) == 1 );
+
+	b2DestroyWorld( worldId );
+	return 0;
+}
+
+static int TestAreaForces( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+
+	bodyDef.position = (b2Vec2){ -10.0f, 0.0f };
+	b2BodyId explodedId = b2CreateBody( worldId, &bodyDef );
+	b2Circle circle = { { 0.0f, 0.0f }, 0.5f };
+	b2CreateCircleShape( explodedId, &shapeDef, &circle );
+
+	bodyDef.position = (b2Vec2){ 10.0f, 0.0f };
+	b2BodyId windId = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( windId, &shapeDef, &box );
+
+	// Half submerged with a fluid four times as dense as the box
+	bodyDef.position = (b2Vec2){ 0.0f, -10.0f };
+	b2BodyId floatId = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( floatId, &shapeDef, &box );
+
+	b2AreaForceDef defs[3];
+	defs[0] = b2DefaultAreaForceDef();
+	defs[0].type = b2_explosionArea;
+	defs[0].explosion.position = (b2Vec2){ -12.0f, 0.0f };
+	defs[0].explosion.radius = 3.0f;
+	defs[0].explosion.impulsePerLength = 10.0f;
+
+	defs[1] = b2DefaultAreaForceDef();
+	defs[1].type = b2_windArea;
+	defs[1].region = (b2AABB){ { 8.0f, -2.0f }, { 12.0f, 2.0f } };
+	defs[1].wind = (b2Vec2){ 20.0f, 0.0f };
+	defs[1].drag = 1.0f;
+
+	defs[2] = b2DefaultAreaForceDef();
+	defs[2].type = b2_buoyancyArea;
+	defs[2].region = (b2AABB){ { -5.0f, -15.0f }, { 5.0f, -10.0f } };
+	defs[2].fluidDensity = 4.0f;
+	defs[2].linearDrag = 1.0f;
+
+	b2World_ApplyAreaForces( worldId, defs, 3 );
+
+	// Nothing moves until the commands are applied by the step
+	ENSURE( b2Body_GetLinearVelocity( explodedId ).x == 0.0f );
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+	ENSURE( b2Body_GetLinearVelocity( explodedId ).x > 1.0f );
+	ENSURE( b2Body_GetLinearVelocity( windId ).x > 0.0f );
+	ENSURE( b2Body_GetLinearVelocity( floatId ).y > 0.0f );
+
+	// The commands are consumed by the step
+	b2Vec2 windVelocity = b2Body_GetLinearVelocity( windId );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	ENSURE( b2Body_GetLinearVelocity( windId ).x == windVelocity.x );
+
+	// Sleeping bodies are skipped unless the area wakes them
+	b2Body_SetAwake( explodedId, false );
+	defs[0].wake = false;
+	b2World_ApplyAreaForces( worldId, defs, 1 );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	ENSURE( b2Body_IsAwake( explodedId ) == false );
+
+	defs[0].wake = true;
+	b2World_ApplyAreaForces( worldId, defs, 1 );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	ENSURE( b2Body_IsAwake( explodedId ) );
+
+	b2DestroyWorld( worldId );
+	return 0;
+}
+
+enum CrateForce
+{
+	e_crateWind,
+	e_crateWindArea,
+	e_crateBuoyancyArea,
+};
+
+// Velocity of a crate after one step with a force, made of a polygon or of a single polygon compound
+static b2Vec2 PushCrate( bool useCompound, enum CrateForce force )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.rotation = b2MakeRot( 0.3f );
+	b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Polygon crate = b2MakeOffsetBox( 0.5f, 0.25f, (b2Vec2){ 0.1f, 0.0f }, b2Rot_identity );
+	b2Compound* compound = NULL;
+	b2ShapeId shapeId;
+	if ( useCompound )
+	{
+		compound = b2CreateCompound( &crate, 1 );
+		shapeId = b2CreateCompoundShape( bodyId, &shapeDef, compound );
+	}
+	else
+	{
+		shapeId = b2CreatePolygonShape( bodyId, &shapeDef, &crate );
+	}
+
+	b2AreaForceDef def = b2DefaultAreaForceDef();
+	def.region = (b2AABB){ { -2.0f, -2.0f }, { 2.0f, 0.0f } };
+	def.wind = (b2Vec2){ 20.0f, 5.0f };
+	def.drag = 1.0f;
+	def.lift = 0.5f;
+	def.fluidDensity = 4.0f;
+
+	switch ( force )
+	{
+		case e_crateWind:
+			b2Shape_ApplyWind( shapeId, def.wind, def.drag, def.lift, true );
+			break;
+		case e_crateWindArea:
+			def.type = b2_windArea;
+			b2World_ApplyAreaForces( worldId, &def, 1 );
+			break;
+		case e_crateBuoyancyArea:
+			def.type = b2_buoyancyArea;
+			b2World_ApplyAreaForces( worldId, &def, 1 );
+			break;
+	}
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	b2Vec2 velocity = b2Body_GetLinearVelocity( bodyId );
+
+	b2DestroyWorld( worldId );
+	b2DestroyCompound( compound );
+	return velocity;
+}
+
+// Instanced crates made of a single polygon compound get the same wind and area forces as polygons
+static int TestCompoundCrateForces( void )
+{
+	// One step of the default gravity
+	b2Vec2 gravityOnly = { 0.0f, -10.0f / 60.0f };
+
+	for ( int force = e_crateWind; force <= e_crateBuoyancyArea; ++force )
+	{
+		b2Vec2 polygonVelocity = PushCrate( false, force );
+		b2Vec2 compoundVelocity = PushCrate( true, force );
+		ENSURE( b2Distance( polygonVelocity, gravityOnly ) > 0.01f );
+		ENSURE_SMALL( compoundVelocity.x - polygonVelocity.x, 1e-5f );
+		ENSURE_SMALL( compoundVelocity.y - polygonVelocity.y, 1e-5f );
+	}
+
+	return 0;
+}
+
+#define JOINT_GRID_SIZE 8
+
+static b2WorldId CreateJointGridWorld( float tolerance, b2BodyId* bodyIds )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.jointPrepareTolerance = tolerance;
+
+	// A side wind so the grid swings slowly
+	worldDef.gravity = (b2Vec2){ 1.0f, -10.0f };
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	shapeDef.filter.groupIndex = -1;
+	b2Circle circle = { { 0.0f, 0.0f }, 0.4f };
+
+	b2RevoluteJointDef revoluteDef = b2DefaultRevoluteJointDef();
+	b2WeldJointDef weldDef = b2DefaultWeldJointDef();
+
+	bodyDef.type = b2_dynamicBody;
+	for ( int i = 0; i < JOINT_GRID_SIZE; ++i )
+	{
+		for ( int j = 0; j < JOINT_GRID_SIZE; ++j )
+		{
+			int index = JOINT_GRID_SIZE * i + j;
+			bodyDef.position = (b2Vec2){ (float)i, -(float)j };
+			bodyIds[index] = b2CreateBody( worldId, &bodyDef );
+			b2CreateCircleShape( bodyIds[index], &shapeDef, &circle );
+
+			// Hang the top row from the ground, weld the columns together and pin the rows
+			b2BodyId parentId = j == 0 ? groundId : bodyIds[index - 1];
+			b2JointDef* base = i % 2 == 0 ? &revoluteDef.base : &weldDef.base;
+			base->bodyIdA = parentId;
+			base->bodyIdB = bodyIds[index];
+			base->localFrameA.p = b2Body_GetLocalPoint( parentId, bodyDef.position );
+			base->localFrameB.p = b2Vec2_zero;
+			if ( i % 2 == 0 )
+			{
+				b2CreateRevoluteJoint( worldId, &revoluteDef );
+			}
+			else
+			{
+				b2CreateWeldJoint( worldId, &weldDef );
+			}
+
+			if ( i > 0 )
+			{
+				revoluteDef.base.bodyIdA = bodyIds[index - JOINT_GRID_SIZE];
+				revoluteDef.base.bodyIdB = bodyIds[index];
+				revoluteDef.base.localFrameA.p = (b2Vec2){ 1.0f, 0.0f };
+				b2CreateRevoluteJoint( worldId, &revoluteDef );
+			}
+		}
+	}
+
+	return worldId;
+}
+
+// Reusing the joint prepare on a joint grid that barely moves stays close to the full prepare
+static int TestJointPrepareReuse( void )
+{
+	b2BodyId bodyIdsA[JOINT_GRID_SIZE * JOINT_GRID_SIZE];
+	b2BodyId bodyIdsB[JOINT_GRID_SIZE * JOINT_GRID_SIZE];
+	b2WorldId worldIdA = CreateJointGridWorld( 0.0f, bodyIdsA );
+	b2WorldId worldIdB = CreateJointGridWorld( 0.01f, bodyIdsB );
+	ENSURE( b2World_GetJointPrepareTolerance( worldIdB ) == 0.01f );
+
+	for ( int i = 0; i < 120; ++i )
+	{
+		b2World_Step( worldIdA, 1.0f / 60.0f, 4 );
+		b2World_Step( worldIdB, 1.0f / 60.0f, 4 );
+	}
+
+	bool identical = true;
+	for ( int i = 0; i < JOINT_GRID_SIZE * JOINT_GRID_SIZE; ++i )
+	{
+		b2Vec2 pA = b2Body_GetPosition( bodyIdsA[i] );
+		b2Vec2 pB = b2Body_GetPosition( bodyIdsB[i] );
+		ENSURE( b2Distance( pA, pB ) < 0.05f );
+		identical = identical && pA.x == pB.x && pA.y == pB.y;
+	}
+
+	// The grid settles so most steps reuse the prepared joints
+	ENSURE( identical == false );
+
+	// Changing the mass forces a full prepare of the attached joints
+	b2MassData massData = b2Body_GetMassData( bodyIdsB[0] );
+	massData.mass *= 2.0f;
+	b2Body_SetMassData( bodyIdsB[0], massData );
+	b2World_Step( worldIdB, 1.0f / 60.0f, 4 );
+
+	b2DestroyWorld( worldIdA );
+	b2DestroyWorld( worldIdB );
+	return 0;
+}
+
+#define SMALL_ISLAND_COUNT 12
+#define PILE_SIZE 8
+#define ISLAND_BODY_COUNT ( 4 * SMALL_ISLAND_COUNT + PILE_SIZE )
+
+// Small islands of two stacked boxes and of two linked pendulum bodies next to one pile of boxes
+static b2WorldId CreateSmallIslandWorld( int islandSolveBodyCount, b2BodyId* bodyIds )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.islandSolveBodyCount = islandSolveBodyCount;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2Segment segment = { { -100.0f, 0.0f }, { 100.0f, 0.0f } };
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	b2Circle circle = { { 0.0f, 0.0f }, 0.25f };
+	shapeDef.enableHitEvents = true;
+
+	b2RevoluteJointDef jointDef = b2DefaultRevoluteJointDef();
+
+	bodyDef.type = b2_dynamicBody;
+	int index = 0;
+	for ( int i = 0; i < SMALL_ISLAND_COUNT; ++i )
+	{
+		float x = -60.0f + 4.0f * i;
+
+		// The top box drops onto the bottom box
+		for ( int j = 0; j < 2; ++j )
+		{
+			bodyDef.position = (b2Vec2){ x, 0.5f + 2.0f * j };
+			bodyIds[index] = b2CreateBody( worldId, &bodyDef );
+			b2CreatePolygonShape( bodyIds[index], &shapeDef, &box );
+			index += 1;
+		}
+
+		// A double pendulum hanging from the ground
+		for ( int j = 0; j < 2; ++j )
+		{
+			bodyDef.position = (b2Vec2){ x + 1.0f + j, 10.0f };
+			bodyIds[index] = b2CreateBody( worldId, &bodyDef );
+			b2CreateCircleShape( bodyIds[index], &shapeDef, &circle );
+
+			b2BodyId parentId = j == 0 ? groundId : bodyIds[index - 1];
+			jointDef.base.bodyIdA = parentId;
+			jointDef.base.bodyIdB = bodyIds[index];
+			jointDef.base.localFrameA.p = b2Body_GetLocalPoint( parentId, (b2Vec2){ x + j, 10.0f } );
+			jointDef.base.localFrameB.p = (b2Vec2){ -1.0f, 0.0f };
+			b2CreateRevoluteJoint( worldId, &jointDef );
+			index += 1;
+		}
+	}
+
+	for ( int i = 0; i < PILE_SIZE; ++i )
+	{
+		bodyDef.position = (b2Vec2){ 20.0f, 0.5f + 1.0f * i };
+		bodyIds[index] = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyIds[index], &shapeDef, &box );
+		index += 1;
+	}
+
+	return worldId;
+}
+
+// Small islands solved by their own task behave like the graph coloring solver next to a pile that still
+// uses the graph coloring
+static int TestSmallIslandSolve( void )
+{
+	b2BodyId bodyIdsA[ISLAND_BODY_COUNT];
+	b2BodyId bodyIdsB[ISLAND_BODY_COUNT];
+	b2WorldId worldIdA = CreateSmallIslandWorld( 0, bodyIdsA );
+	b2WorldId worldIdB = CreateSmallIslandWorld( 4, bodyIdsB );
+	ENSURE( b2World_GetIslandSolveBodyCount( worldIdB ) == 4 );
+
+	int hitCountA = 0, hitCountB = 0;
+	for ( int i = 0; i < 90; ++i )
+	{
+		b2World_Step( worldIdA, 1.0f / 60.0f, 4 );
+		b2World_Step( worldIdB, 1.0f / 60.0f, 4 );
+		hitCountA += b2World_GetContactEvents( worldIdA ).hitCount;
+		hitCountB += b2World_GetContactEvents( worldIdB ).hitCount;
+	}
+
+	// The dropped boxes report hits from both solvers
+	ENSURE( hitCountB > 0 );
+	ENSURE( hitCountB == hitCountA );
+
+	for ( int i = 0; i < ISLAND_BODY_COUNT; ++i )
+	{
+		b2Vec2 pA = b2Body_GetPosition( bodyIdsA[i] );
+		b2Vec2 pB = b2Body_GetPosition( bodyIdsB[i] );
+		ENSURE( b2Distance( pA, pB ) < 0.05f );
+	}
+
+	// Stacks and the pile settle at the same heights
+	for ( int i = 0; i < SMALL_ISLAND_COUNT; ++i )
+	{
+		b2Vec2 p = b2Body_GetPosition( bodyIdsB[4 * i + 1] );
+		ENSURE_SMALL( p.y - 1.5f, 0.05f );
+	}
+
+	b2Vec2 topB = b2Body_GetPosition( bodyIdsB[ISLAND_BODY_COUNT - 1] );
+	ENSURE_SMALL( topB.y - ( PILE_SIZE - 0.5f ), 0.05f );
+
+	// The pendulum links stay attached
+	for ( int i = 0; i < SMALL_ISLAND_COUNT; ++i )
+	{
+		b2Vec2 p1 = b2Body_GetPosition( bodyIdsB[4 * i + 2] );
+		b2Vec2 p2 = b2Body_GetPosition( bodyIdsB[4 * i + 3] );
+		ENSURE_SMALL( b2Distance( p1, p2 ) - 1.0f, 0.02f );
+	}
+
+	// Turning it off mid-run hands the islands back to the graph coloring
+	b2World_SetIslandSolveBodyCount( worldIdB, 0 );
+	b2World_Step( worldIdB, 1.0f / 60.0f, 4 );
+
+	b2DestroyWorld( worldIdA );
+	b2DestroyWorld( worldIdB );
+	return 0;
+}
+
+#define ORDER_COLUMN_COUNT 40
+#define ORDER_ROW_COUNT 8
+#define ORDER_BODY_COUNT ( ORDER_COLUMN_COUNT * ORDER_ROW_COUNT )
+
+// Columns of boxes created in a scattered order so neighbors are far apart in the awake arrays
+static b2WorldId CreateScatteredPileWorld( float bodyOrderThreshold, b2BodyId* bodyIds )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.bodyOrderThreshold = bodyOrderThreshold;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Segment segment = { { -100.0f, 0.0f }, { 100.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+
+	// 7 is coprime with the body count so this visits every box once
+	for ( int i = 0; i < ORDER_BODY_COUNT; ++i )
+	{
+		int index = ( 7 * i ) % ORDER_BODY_COUNT;
+		int column = index / ORDER_ROW_COUNT;
+		int row = index % ORDER_ROW_COUNT;
+		bodyDef.position = (b2Vec2){ 2.0f * column - ORDER_COLUMN_COUNT, 0.5f + row };
+		bodyIds[index] = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyIds[index], &shapeDef, &box );
+	}
+
+	return worldId;
+}
+
+static int TestBodyReorder( void )
+{
+	b2BodyId bodyIdsA[ORDER_BODY_COUNT];
+	b2BodyId bodyIdsB[ORDER_BODY_COUNT];
+	b2WorldId worldIdA = CreateScatteredPileWorld( 0.0f, bodyIdsA );
+	b2WorldId worldIdB = CreateScatteredPileWorld( 0.1f, bodyIdsB );
+
+	int reorderCount = 0;
+	// The order is checked every 32 steps
+	for ( int i = 0; i < 64; ++i )
+	{
+		b2World_Step( worldIdA, 1.0f / 60.0f, 4 );
+		b2World_Step( worldIdB, 1.0f / 60.0f, 4 );
+		ENSURE( b2World_GetCounters( worldIdA ).reorderedBodyCount == 0 );
+		if ( b2World_GetCounters( worldIdB ).reorderedBodyCount > 0 )
+		{
+			ENSURE( b2World_GetCounters( worldIdB ).reorderedBodyCount == ORDER_BODY_COUNT );
+			reorderCount += 1;
+		}
+	}
+
+	// Once sorted the pile stays sorted
+	ENSURE( reorderCount == 1 );
+
+	// The order of the bodies does not change the result
+	for ( int i = 0; i < ORDER_BODY_COUNT; ++i )
+	{
+		b2Vec2 pA = b2Body_GetPosition( bodyIdsA[i] );
+		b2Vec2 pB = b2Body_GetPosition( bodyIdsB[i] );
+		ENSURE( b2Distance( pA, pB ) < 0.01f );
+	}
+
+	b2DestroyWorld( worldIdA );
+	b2DestroyWorld( worldIdB );
+	return 0;
+}
+
+static int TestContactOrdering( void )
+{
+	b2BodyId bodyIdsA[ORDER_BODY_COUNT];
+	b2BodyId bodyIdsB[ORDER_BODY_COUNT];
+	b2WorldId worldIdA = CreateScatteredPileWorld( 0.0f, bodyIdsA );
+	b2WorldId worldIdB = CreateScatteredPileWorld( 0.0f, bodyIdsB );
+	b2World_EnableContactOrdering( worldIdB, true );
+	ENSURE( b2World_IsContactOrderingEnabled( worldIdB ) );
+
+	int sortedCount = 0;
+	for ( int i = 0; i < 60; ++i )
+	{
+		// The narrow phase prepares colors in the old order half of the time
+		b2World_EnableFusedPrepare( worldIdA, i >= 30 );
+		b2World_EnableFusedPrepare( worldIdB, i >= 30 );
+
+		// Contacts are created in body order. Removing boxes swaps contacts out of order.
+		if ( i == 10 )
+		{
+			for ( int j = 0; j < ORDER_BODY_COUNT; j += 5 )
+			{
+				b2DestroyBody( bodyIdsA[j] );
+				b2DestroyBody( bodyIdsB[j] );
+			}
+		}
+
+		b2World_Step( worldIdA, 1.0f / 60.0f, 4 );
+		b2World_Step( worldIdB, 1.0f / 60.0f, 4 );
+		ENSURE( b2World_GetCounters( worldIdA ).sortedContactCount == 0 );
+		sortedCount += b2World_GetCounters( worldIdB ).sortedContactCount;
+	}
+
+	ENSURE( sortedCount > 0 );
+
+	// The contacts of a color share no body, so their order does not matter
+	for ( int i = 0; i < ORDER_BODY_COUNT; ++i )
+	{
+		if ( i % 5 == 0 )
+		{
+			continue;
+		}
+
+		b2Vec2 pA = b2Body_GetPosition( bodyIdsA[i] );
+		b2Vec2 pB = b2Body_GetPosition( bodyIdsB[i] );
+		ENSURE( pA.x == pB.x && pA.y == pB.y );
+	}
+
+	b2DestroyWorld( worldIdA );
+	b2DestroyWorld( worldIdB );
+	return 0;
+}
+
+// A concave U body on the ground with a box in its cavity and a ball on one arm
+static int TestCompoundShape( void )
+{
+	b2Vec2 outline[8] = { { -3.0f, 0.0f }, { 3.0f, 0.0f },	{ 3.0f, 3.0f },	  { 2.0f, 3.0f },
+						  { 2.0f, 1.0f },  { -2.0f, 1.0f }, { -2.0f, 3.0f }, { -3.0f, 3.0f } };
+	b2Polygon polygons[8];
+	int polygonCount = b2DecomposePolygon( outline, 8, 0.0f, polygons, 8 );
+	b2Compound* compound = b2CreateCompound( polygons, polygonCount );
+
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Segment segment = { { -20.0f, 0.0f }, { 20.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position = (b2Vec2){ 0.0f, 0.05f };
+	b2BodyId compoundBodyId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeId compoundShapeId = b2CreateCompoundShape( compoundBodyId, &shapeDef, compound );
+	ENSURE( b2Shape_GetType( compoundShapeId ) == b2_compoundShape );
+	ENSURE( b2Shape_GetCompound( compoundShapeId ) == compound );
+	ENSURE( b2AbsFloat( b2Body_GetMass( compoundBodyId ) - 10.0f ) < 0.001f );
+
+	bodyDef.position = (b2Vec2){ 0.0f, 2.0f };
+	b2BodyId boxId = b2CreateBody( worldId, &bodyDef );
+	b2Polygon box = b2MakeBox( 0.4f, 0.4f );
+	b2CreatePolygonShape( boxId, &shapeDef, &box );
+
+	bodyDef.position = (b2Vec2){ 2.5f, 4.0f };
+	b2BodyId ballId = b2CreateBody( worldId, &bodyDef );
+	b2Circle circle = { { 0.0f, 0.0f }, 0.25f };
+	b2CreateCircleShape( ballId, &shapeDef, &circle );
+
+	for ( int i = 0; i < 120; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	// The box rests on the cavity floor and the ball on the arm
+	ENSURE( b2AbsFloat( b2Body_GetPosition( compoundBodyId ).y ) < 0.02f );
+	ENSURE( b2AbsFloat( b2Body_GetPosition( boxId ).y - 1.4f ) < 0.02f );
+	ENSURE( b2AbsFloat( b2Body_GetPosition( ballId ).y - 3.25f ) < 0.02f );
+
+	// One contact per shape pair
+	b2ContactData contactData[8];
+	int contactCount = b2Body_GetContactData( compoundBodyId, contactData, 8 );
+	ENSURE( contactCount == 3 );
+	for ( int i = 0; i < contactCount; ++i )
+	{
+		ENSURE( contactData[i].manifold.pointCount > 0 );
+	}
+
+	// Rays see the cavity
+	b2RayResult result = b2World_CastRayClosest( worldId, (b2Vec2){ -1.0f, 5.0f }, (b2Vec2){ 0.0f, -10.0f },
+												 b2DefaultQueryFilter() );
+	ENSURE( result.hit && B2_ID_EQUALS( result.shapeId, compoundShapeId ) );
+	ENSURE( b2AbsFloat( result.point.y - 1.0f ) < 0.02f );
+
+	b2DestroyWorld( worldId );
+	b2DestroyCompound( compound );
+
+	return 0;
+}
+
+static int TestParticles( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Segment segment = { { -20.0f, 0.0f }, { 20.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	b2ParticleDef particleDef = b2DefaultParticleDef();
+	particleDef.radius = 0.05f;
+
+	b2Vec2 positions[100];
+	for ( int i = 0; i < 100; ++i )
+	{
+		positions[i] = (b2Vec2){ -0.5f + 0.1f * ( i % 10 ), 1.0f + 0.1f * ( i / 10 ) };
+	}
+
+	b2World_CreateParticles( worldId, &particleDef, positions, NULL, 100 );
+	ENSURE( b2World_GetParticleCount( worldId ) == 100 );
+
+	// Short lived particles share the world but not the group
+	particleDef.lifetime = 0.5f;
+	b2Vec2 sparks[10];
+	for ( int i = 0; i < 10; ++i )
+	{
+		sparks[i] = (b2Vec2){ 10.0f + 0.2f * i, 1.0f };
+	}
+	b2World_CreateParticles( worldId, &particleDef, sparks, NULL, 10 );
+	ENSURE( b2World_GetParticleCount( worldId ) == 110 );
+
+	for ( int i = 0; i < 20; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	ENSURE( b2World_GetParticleCount( worldId ) == 110 );
+	ENSURE( b2World_GetCounters( worldId ).particleCount == 110 );
+	ENSURE( b2World_GetMemoryStats( worldId ).particles > 0 );
+
+	for ( int i = 0; i < 160; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	// The sparks expired and the others settled on the ground without passing through it or each other
+	int count = b2World_GetParticleCount( worldId );
+	ENSURE( count == 100 );
+
+	const b2Vec2* p = b2World_GetParticlePositions( worldId );
+	const b2Vec2* v = b2World_GetParticleVelocities( worldId );
+	float minY = FLT_MAX;
+	for ( int i = 0; i < count; ++i )
+	{
+		ENSURE( p[i].y > 0.04f );
+		ENSURE( b2Length( v[i] ) < 1.0f );
+		minY = b2MinFloat( minY, p[i].y );
+
+		for ( int j = i + 1; j < count; ++j )
+		{
+			ENSURE( b2Distance( p[i], p[j] ) > 0.02f );
+		}
+	}
+
+	ENSURE( minY < 0.06f );
+
+	b2World_DestroyParticles( worldId );
+	ENSURE( b2World_GetParticleCount( worldId ) == 0 );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	ENSURE( b2World_GetCounters( worldId ).particleCount == 0 );
+
+	b2DestroyWorld( worldId );
+
+	// Particles hitting a floating box hand over their momentum
+	worldDef.gravity = b2Vec2_zero;
+	worldId = b2CreateWorld( &worldDef );
+
+	bodyDef.type = b2_dynamicBody;
+	b2BodyId boxId = b2CreateBody( worldId, &bodyDef );
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	b2CreatePolygonShape( boxId, &shapeDef, &box );
+
+	particleDef = b2DefaultParticleDef();
+	particleDef.radius = 0.05f;
+	particleDef.density = 10.0f;
+	particleDef.friction = 0.0f;
+
+	b2Vec2 velocities[10];
+	for ( int i = 0; i < 10; ++i )
+	{
+		positions[i] = (b2Vec2){ 2.0f, -0.45f + 0.1f * i };
+		velocities[i] = (b2Vec2){ -10.0f, 0.0f };
+	}
+	b2World_CreateParticles( worldId, &particleDef, positions, velocities, 10 );
+
+	for ( int i = 0; i < 30; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	// The particles and the box share the momentum of the particles
+	float particleMass = 10.0f * B2_PI * 0.05f * 0.05f;
+	b2Vec2 boxVelocity = b2Body_GetLinearVelocity( boxId );
+	float momentum = b2Body_GetMass( boxId ) * boxVelocity.x;
+	ENSURE( momentum < -1.0f );
+	ENSURE( b2AbsFloat( b2Body_GetAngularVelocity( boxId ) ) < 0.1f );
+
+	v = b2World_GetParticleVelocities( worldId );
+	for ( int i = 0; i < 10; ++i )
+	{
+		ENSURE( v[i].x > boxVelocity.x - 0.5f );
+		momentum += particleMass * v[i].x;
+	}
+
+	ENSURE( b2AbsFloat( momentum + 10.0f * 10.0f * particleMass ) < 0.01f );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+typedef struct RelaxedEventTotals
+{
+	int contactBeginCount;
+	int contactEndCount;
+	int sensorBeginCount;
+	int sensorEndCount;
+	b2Vec2 position;
+} RelaxedEventTotals;
+
+// A rain of boxes through a sensor onto the ground, with contact and sensor events
+static RelaxedEventTotals RunRelaxedWorld( bool relaxed, int workerCount )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.enableRelaxedDeterminism = relaxed;
+	worldDef.workerCount = workerCount;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	shapeDef.enableContactEvents = true;
+	shapeDef.enableSensorEvents = true;
+	b2Segment segment = { { -40.0f, 0.0f }, { 40.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	b2ShapeDef sensorDef = b2DefaultShapeDef();
+	sensorDef.isSensor = true;
+	sensorDef.enableSensorEvents = true;
+	b2Polygon sensorBox = b2MakeOffsetBox( 32.0f, 1.0f, (b2Vec2){ 0.0f, 9.0f }, b2Rot_identity );
+	b2CreatePolygonShape( groundId, &sensorDef, &sensorBox );
+
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.4f, 0.4f );
+	b2BodyId lastId = b2_nullBodyId;
+	for ( int i = 0; i < 40; ++i )
+	{
+		for ( int j = 0; j < 8; ++j )
+		{
+			bodyDef.position = (b2Vec2){ -30.0f + 1.5f * i, 12.0f + 1.0f * j };
+			lastId = b2CreateBody( worldId, &bodyDef );
+			b2CreatePolygonShape( lastId, &shapeDef, &box );
+		}
+	}
+
+	RelaxedEventTotals totals = { 0 };
+	for ( int i = 0; i < 120; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+		b2ContactEvents contactEvents = b2World_GetContactEvents( worldId );
+		totals.contactBeginCount += contactEvents.beginCount;
+		totals.contactEndCount += contactEvents.endCount;
+
+		b2SensorEvents sensorEvents = b2World_GetSensorEvents( worldId );
+		totals.sensorBeginCount += sensorEvents.beginCount;
+		totals.sensorEndCount += sensorEvents.endCount;
+	}
+
+	totals.position = b2Body_GetPosition( lastId );
+
+	b2DestroyWorld( worldId );
+	return totals;
+}
+
+// Relaxed determinism only changes the order of the events, not the events or the simulation
+static int TestRelaxedDeterminism( void )
+{
+	RelaxedEventTotals reference = RunRelaxedWorld( false, 1 );
+	ENSURE( reference.contactBeginCount >= 320 );
+	ENSURE( reference.sensorBeginCount == 320 );
+	ENSURE( reference.sensorEndCount == 320 );
+
+	RelaxedEventTotals relaxed = RunRelaxedWorld( true, 4 );
+	ENSURE( relaxed.contactBeginCount == reference.contactBeginCount );
+	ENSURE( relaxed.contactEndCount == reference.contactEndCount );
+	ENSURE( relaxed.sensorBeginCount == reference.sensorBeginCount );
+	ENSURE( relaxed.sensorEndCount == reference.sensorEndCount );
+	ENSURE( relaxed.position.x == reference.position.x && relaxed.position.y == reference.position.y );
+
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+	ENSURE( b2World_IsRelaxedDeterminismEnabled( worldId ) == false );
+	b2World_EnableRelaxedDeterminism( worldId, true );
+	ENSURE( b2World_IsRelaxedDeterminismEnabled( worldId ) );
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+// A box slides from the left shard into the right shard. Its ghost pushes a box in the right shard before
+// the handoff.
+static int TestExportBuffer( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2Polygon groundBox = b2MakeBox( 20.0f, 1.0f );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2CreatePolygonShape( groundId, &shapeDef, &groundBox );
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position = (b2Vec2){ 0.0f, 4.0f };
+	bodyDef.angularVelocity = 1.0f;
+	b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+	b2Polygon box = b2MakeSquare( 0.5f );
+	b2CreatePolygonShape( bodyId, &shapeDef, &box );
+
+	// A bullet that hits the ground in the first step, so continuous collision moves it back
+	bodyDef.position = (b2Vec2){ 5.0f, 3.0f };
+	bodyDef.linearVelocity = (b2Vec2){ 0.0f, -300.0f };
+	bodyDef.angularVelocity = 0.0f;
+	bodyDef.isBullet = true;
+	b2BodyId bulletId = b2CreateBody( worldId, &bodyDef );
+	b2Polygon smallBox = b2MakeSquare( 0.1f );
+	b2CreatePolygonShape( bulletId, &shapeDef, &smallBox );
+
+	bodyDef.type = b2_kinematicBody;
+	bodyDef.position = (b2Vec2){ -5.0f, 5.0f };
+	bodyDef.linearVelocity = (b2Vec2){ 3.0f, 0.0f };
+	bodyDef.angularVelocity = 0.5f;
+	bodyDef.isBullet = false;
+	b2BodyId kinematicId = b2CreateBody( worldId, &bodyDef );
+
+	uint64_t buffer[128];
+	int byteCount = b2GetExportBufferSize( 4 );
+	ENSURE( byteCount <= (int)sizeof( buffer ) );
+
+	b2World_SetExportBuffer( worldId, buffer, byteCount );
+	ENSURE( b2World_GetExportCapacity( worldId ) >= 4 );
+
+	const b2ExportHeader* header = (const b2ExportHeader*)buffer;
+	ENSURE( header->version == B2_EXPORT_VERSION && header->byteCount == byteCount );
+
+	// Slots are written when they are assigned
+	b2BodyId bodyIds[3] = { bodyId, bulletId, kinematicId };
+	int slots[3] = { 3, 0, 1 };
+	for ( int i = 0; i < 3; ++i )
+	{
+		ENSURE( b2Body_GetExportSlot( bodyIds[i] ) == -1 );
+		b2Body_SetExportSlot( bodyIds[i], slots[i] );
+		ENSURE( b2Body_GetExportSlot( bodyIds[i] ) == slots[i] );
+	}
+
+	b2Vec2 positions[3];
+	b2Rot rotations[3];
+	b2Vec2 linearVelocities[3];
+	float angularVelocities[3];
+	b2BodyStateArrays arrays = { positions, rotations, linearVelocities, angularVelocities };
+	uint64_t stepIndex = 1;
+	ENSURE( b2ReadExportBuffer( buffer, slots, 3, &arrays, &stepIndex ) );
+	ENSURE( stepIndex == 0 );
+	ENSURE( b2IsValidVec2( positions[1] ) && positions[1].y == 3.0f && linearVelocities[1].y == -300.0f );
+
+	for ( int step = 0; step < 20; ++step )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+		ENSURE( b2ReadExportBuffer( buffer, slots, 3, &arrays, &stepIndex ) );
+		ENSURE( stepIndex == (uint64_t)( step + 1 ) );
+		for ( int i = 0; i < 3; ++i )
+		{
+			b2Transform transform = b2Body_GetTransform( bodyIds[i] );
+			b2Vec2 v = b2Body_GetLinearVelocity( bodyIds[i] );
+			ENSURE( positions[i].x == transform.p.x && positions[i].y == transform.p.y );
+			ENSURE( rotations[i].c == transform.q.c && rotations[i].s == transform.q.s );
+			ENSURE( linearVelocities[i].x == v.x && linearVelocities[i].y == v.y );
+			ENSURE( angularVelocities[i] == b2Body_GetAngularVelocity( bodyIds[i] ) );
+		}
+	}
+
+	// The bullet stopped on the ground rather than passing through
+	ENSURE( positions[1].y > 0.0f );
+
+	// A consumer that sees a write in progress retries
+	uint32_t sequence = header->sequence;
+	ENSURE( ( sequence & 1 ) == 0 );
+	( (b2ExportHeader*)buffer )->sequence = sequence + 1;
+	ENSURE( b2ReadExportBuffer( buffer, slots, 3, &arrays, NULL ) == false );
+	( (b2ExportHeader*)buffer )->sequence = sequence;
+
+	// Detached buffers are left alone
+	b2World_SetExportBuffer( worldId, NULL, 0 );
+	ENSURE( b2World_GetExportCapacity( worldId ) == 0 );
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	ENSURE( b2ReadExportBuffer( buffer, slots, 3, &arrays, &stepIndex ) );
+	ENSURE( stepIndex == 20 );
+	ENSURE( positions[2].x < b2Body_GetPosition( kinematicId ).x );
+
+	b2DestroyWorld( worldId );
+	return 0;
+}
+
+static bool DisableContactsPreSolve( b2ShapeId shapeIdA, b2ShapeId shapeIdB, b2Vec2 point, b2Vec2 normal, void* context )
+{
+	( void )shapeIdA;
+	( void )shapeIdB;
+	( void )point;
+	( void )normal;
+	( void )context;
+	return false;
+}
+
+#define PAIR_STEP_COUNT 120
+#define PAIR_BODY_COUNT 48
+
+typedef struct PairRun
+{
+	int contactCounts[PAIR_STEP_COUNT][PAIR_BODY_COUNT];
+} PairRun;
+
+// Contacts are disabled so the bodies follow their initial velocities and both runs move the same way
+static void RunPairsWorld( b2BroadPhaseType broadPhaseType, bool incremental, PairRun* run )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.gravity = b2Vec2_zero;
+	worldDef.broadPhaseType = broadPhaseType;
+	worldDef.gridCellSize = 2.0f;
+	worldDef.enableSleep = false;
+	worldDef.enableIncrementalPairs = incremental;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+	b2World_SetPreSolveCallback( worldId, DisableContactsPreSolve, NULL );
+	b2World_EnableDetailedCounters( worldId, true );
+
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	shapeDef.enablePreSolveEvents = true;
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+
+	// A field of static boxes
+	for ( int i = 0; i < 20; ++i )
+	{
+		for ( int j = 0; j < 6; ++j )
+		{
+			bodyDef.position = (b2Vec2){ 1.5f * i, 1.5f * j };
+			b2BodyId staticId = b2CreateBody( worldId, &bodyDef );
+			b2Polygon box = b2MakeSquare( 0.3f );
+			b2CreatePolygonShape( staticId, &shapeDef, &box );
+		}
+	}
+
+	b2BodyId bodyIds[PAIR_BODY_COUNT];
+	bodyDef.type = b2_dynamicBody;
+	for ( int i = 0; i < PAIR_BODY_COUNT; ++i )
+	{
+		// Large bodies drift slowly and small bodies cross them quickly in both directions
+		bool large = i % 4 == 0;
+		float sign = i % 2 == 0 ? 1.0f : -1.0f;
+		bodyDef.position = (b2Vec2){ 0.6f * i, 0.25f * ( i % 24 ) };
+		bodyDef.linearVelocity = large ? (b2Vec2){ 0.3f, 0.05f } : (b2Vec2){ 4.0f * sign, 0.7f * sign };
+		bodyDef.angularVelocity = large ? 0.1f : 1.0f;
+		bodyDef.type = i == PAIR_BODY_COUNT - 1 ? b2_kinematicBody : b2_dynamicBody;
+		bodyIds[i] = b2CreateBody( worldId, &bodyDef );
+
+		b2Polygon box = b2MakeBox( large ? 3.0f : 0.4f, large ? 1.5f : 0.2f );
+		b2CreatePolygonShape( bodyIds[i], &shapeDef, &box );
+	}
+
+	// Two overlapping bodies moving together that are joined without collision until the joint is destroyed
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.linearVelocity = (b2Vec2){ 0.5f, 0.0f };
+	bodyDef.angularVelocity = 0.0f;
+	bodyDef.position = (b2Vec2){ 5.0f, 12.0f };
+	b2BodyId jointBodyA = b2CreateBody( worldId, &bodyDef );
+	bodyDef.position = (b2Vec2){ 5.5f, 12.0f };
+	b2BodyId jointBodyB = b2CreateBody( worldId, &bodyDef );
+	b2Polygon jointBox = b2MakeSquare( 0.5f );
+	b2ShapeId groupShapeId = b2CreatePolygonShape( jointBodyA, &shapeDef, &jointBox );
+	b2ShapeId filteredShapeId = b2CreatePolygonShape( jointBodyB, &shapeDef, &jointBox );
+
+	b2WeldJointDef jointDef = b2DefaultWeldJointDef();
+	jointDef.base.bodyIdA = jointBodyA;
+	jointDef.base.bodyIdB = jointBodyB;
+	jointDef.base.localFrameA.p = (b2Vec2){ 0.5f, 0.0f };
+	b2JointId jointId = b2CreateWeldJoint( worldId, &jointDef );
+
+	for ( int step = 0; step < PAIR_STEP_COUNT; ++step )
+	{
+		if ( step == 30 )
+		{
+			b2DestroyJoint( jointId, false );
+		}
+		else if ( step == 50 )
+		{
+			b2Filter filter = b2DefaultFilter();
+			filter.groupIndex = -1;
+			b2Shape_SetFilter( groupShapeId, filter );
+			b2Shape_SetFilter( filteredShapeId, filter );
+		}
+		else if ( step == 60 )
+		{
+			b2Shape_SetFilter( filteredShapeId, b2DefaultFilter() );
+		}
+
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+		for ( int i = 0; i < PAIR_BODY_COUNT; ++i )
+		{
+			run->contactCounts[step][i] = b2Body_GetContactCapacity( bodyIds[i] );
+		}
+
+		run->contactCounts[step][0] += 1000 * b2Body_GetContactCapacity( jointBodyB );
+	}
+
+	b2DestroyWorld( worldId );
+}
+
+// Returns the pair leaf visits of a few large bodies drifting over many small static boxes
+static int RunDriftWorld( b2BroadPhaseType broadPhaseType, bool incremental )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.gravity = b2Vec2_zero;
+	worldDef.broadPhaseType = broadPhaseType;
+	worldDef.gridCellSize = 1.0f;
+	worldDef.enableSleep = false;
+	worldDef.enableIncrementalPairs = incremental;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+	b2World_SetPreSolveCallback( worldId, DisableContactsPreSolve, NULL );
+	b2World_EnableDetailedCounters( worldId, true );
+
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	shapeDef.enablePreSolveEvents = true;
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2Polygon smallBox = b2MakeSquare( 0.1f );
+	for ( int i = 0; i < 40; ++i )
+	{
+		for ( int j = 0; j < 40; ++j )
+		{
+			bodyDef.position = (b2Vec2){ 0.5f * i, 0.5f * j };
+			b2BodyId staticId = b2CreateBody( worldId, &bodyDef );
+			b2CreatePolygonShape( staticId, &shapeDef, &smallBox );
+		}
+	}
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.linearVelocity = (b2Vec2){ 0.5f, 0.2f };
+	b2Polygon largeBox = b2MakeSquare( 3.0f );
+	for ( int i = 0; i < 4; ++i )
+	{
+		bodyDef.position = (b2Vec2){ 4.0f + 4.0f * i, 3.0f + 3.0f * i };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyId, &shapeDef, &largeBox );
+	}
+
+	int leafVisits = 0;
+	for ( int step = 0; step < 60; ++step )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		leafVisits += b2World_GetCounters( worldId ).pairLeafVisits;
+	}
+
+	b2DestroyWorld( worldId );
+	return leafVisits;
+}
+
+static int TestIncrementalPairs( void )
+{
+	static PairRun fullRun;
+	static PairRun incrementalRun;
+
+	for ( int type = 0; type < 2; ++type )
+	{
+		b2BroadPhaseType broadPhaseType = type == 0 ? b2_treeBroadPhase : b2_gridBroadPhase;
+		RunPairsWorld( broadPhaseType, false, &fullRun );
+		RunPairsWorld( broadPhaseType, true, &incrementalRun );
+
+		for ( int step = 0; step < PAIR_STEP_COUNT; ++step )
+		{
+			for ( int i = 0; i < PAIR_BODY_COUNT; ++i )
+			{
+				ENSURE( incrementalRun.contactCounts[step][i] == fullRun.contactCounts[step][i] );
+			}
+		}
+
+		// The joined bodies collide after the joint is gone, except while they share a negative group
+		ENSURE( fullRun.contactCounts[20][0] < 1000 );
+		ENSURE( fullRun.contactCounts[40][0] >= 1000 );
+		ENSURE( fullRun.contactCounts[55][0] < 1000 );
+		ENSURE( fullRun.contactCounts[70][0] >= 1000 );
+
+		// Large slowly drifting bodies only query thin strips of the dense static field
+		ENSURE( RunDriftWorld( broadPhaseType, true ) < RunDriftWorld( broadPhaseType, false ) / 2 );
+	}
+
+	return 0;
+}
+
+static int TestStepBudget( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2Segment segment = { { -10.0f, 0.0f }, { 10.0f, 0.0f } };
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	// A sensor around the top of the stack
+	shapeDef.isSensor = true;
+	shapeDef.enableSensorEvents = true;
+	b2Polygon sensorBox = b2MakeOffsetBox( 1.0f, 0.5f, (b2Vec2){ 0.0f, 9.5f }, b2Rot_identity );
+	b2CreatePolygonShape( groundId, &shapeDef, &sensorBox );
+
+	shapeDef = b2DefaultShapeDef();
+	shapeDef.enableSensorEvents = true;
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeSquare( 0.5f );
+	b2BodyId topId = b2_nullBodyId;
+	for ( int i = 0; i < 10; ++i )
+	{
+		bodyDef.position = (b2Vec2){ 0.0f, 0.5f + i };
+		topId = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( topId, &shapeDef, &box );
+	}
+
+	// Any step runs over a tiny budget, so every level is skipped, including the sensor update
+	b2World_StepWithBudget( worldId, 1.0f / 60.0f, 4, 1.0e-6f );
+	uint32_t allDegradations = b2_degradeRelax | b2_degradeSensors | b2_degradeIslandSplit | b2_degradeContinuous;
+	ENSURE( b2World_GetProfile( worldId ).degradations == allDegradations );
+	ENSURE( b2World_GetSensorEvents( worldId ).beginCount == 0 );
+
+	b2World_StepWithBudget( worldId, 1.0f / 60.0f, 4, 1.0e6f );
+	ENSURE( b2World_GetProfile( worldId ).degradations == 0 );
+	ENSURE( b2World_GetSensorEvents( worldId ).beginCount == 1 );
+
+	// The stack stays up with the degraded steps
+	for ( int i = 0; i < 120; ++i )
+	{
+		b2World_StepWithBudget( worldId, 1.0f / 60.0f, 4, 1.0e-6f );
+	}
+
+	ENSURE( b2World_GetProfile( worldId ).degradations == allDegradations );
+	ENSURE_SMALL( b2Body_GetPosition( topId ).x, 0.01f );
+	ENSURE( b2Body_GetPosition( topId ).y > 9.0f );
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	ENSURE( b2World_GetProfile( worldId ).degradations == 0 );
+
+	b2DestroyWorld( worldId );
+	return 0;
+}
+
+// Static edits made while the static tree is rebuilt in the background carry over to the new tree
+static int TestStaticTreeAsync( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Polygon box = b2MakeSquare( 0.5f );
+	b2BodyId staticIds[400];
+	for ( int i = 0; i < 400; ++i )
+	{
+		bodyDef.position = (b2Vec2){ 2.0f * ( i % 20 ), 2.0f * ( i / 20 ) };
+		staticIds[i] = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( staticIds[i], &shapeDef, &box );
+	}
+
+	b2World_RebuildStaticTreeAsync( worldId );
+	ENSURE( b2World_IsStaticTreeRebuilding( worldId ) );
+
+	// Remove, move and add static shapes while the rebuild is pending
+	b2DestroyBody( staticIds[0] );
+	b2Body_SetTransform( staticIds[1], (b2Vec2){ 100.0f, 100.0f }, b2Rot_identity );
+	bodyDef.position = (b2Vec2){ -50.0f, 0.0f };
+	b2BodyId addedId = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( addedId, &shapeDef, &box );
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position = (b2Vec2){ -50.0f, 2.0f };
+	b2BodyId fallingId = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( fallingId, &shapeDef, &box );
+
+	// Steps before the rebuild is done keep using the old tree
+	uint64_t ticks = b2GetTicks();
+	while ( b2World_IsStaticTreeRebuilding( worldId ) && b2GetMilliseconds( ticks ) < 10000.0f )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		b2Yield();
+	}
+
+	ENSURE( b2World_IsStaticTreeRebuilding( worldId ) == false );
+
+	b2QueryFilter filter = b2DefaultQueryFilter();
+	b2AABB field = { { -1.0f, -1.0f }, { 39.0f, 39.0f } };
+	b2AABB removed = { { -0.1f, -0.1f }, { 0.1f, 0.1f } };
+	b2AABB moved = { { 99.9f, 99.9f }, { 100.1f, 100.1f } };
+	b2AABB added = { { -50.1f, -0.1f }, { -49.9f, 0.1f } };
+
+	int count = 0;
+	b2World_OverlapAABB( worldId, field, filter, CountTileOverlaps, &count );
+	ENSURE( count == 398 );
+	count = 0;
+	b2World_OverlapAABB( worldId, removed, filter, CountTileOverlaps, &count );
+	ENSURE( count == 0 );
+	count = 0;
+	b2World_OverlapAABB( worldId, moved, filter, CountTileOverlaps, &count );
+	ENSURE( count == 1 );
+	count = 0;
+	b2World_OverlapAABB( worldId, added, filter, CountTileOverlaps, &count );
+	ENSURE( count == 1 );
+
+	// The box lands on the static box added during the rebuild
+	for ( int i = 0; i < 120; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	ENSURE( b2Body_GetPosition( fallingId ).y > 0.9f );
+
+	// A synchronous rebuild supersedes a pending one and the world can go away with one pending
+	b2World_RebuildStaticTreeAsync( worldId );
+	b2World_RebuildStaticTree( worldId );
+	ENSURE( b2World_IsStaticTreeRebuilding( worldId ) == false );
+	b2World_RebuildStaticTreeAsync( worldId );
+
+	b2DestroyWorld( worldId );
+	return 0;
+}
+
+// The rebuilt static tree is swapped in on the calling thread, so static queries during an asynchronous
+// step never see the old tree freed
+static int TestStaticTreeAsyncStep( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.workerCount = 4;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Polygon box = b2MakeSquare( 0.5f );
+	for ( int i = 0; i < 400; ++i )
+	{
+		bodyDef.position = (b2Vec2){ 2.0f * ( i % 20 ), 2.0f * ( i / 20 ) };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyId, &shapeDef, &box );
+	}
+
+	// Give the step some work
+	bodyDef.type = b2_dynamicBody;
+	for ( int i = 0; i < 200; ++i )
+	{
+		bodyDef.position = (b2Vec2){ 1.0f + 2.0f * ( i % 20 ), 45.0f + 1.5f * ( i / 20 ) };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyId, &shapeDef, &box );
+	}
+
+	b2QueryFilter filter = b2DefaultQueryFilter();
+	b2AABB field = { { -1.0f, -1.0f }, { 39.0f, 39.0f } };
+
+	for ( int rebuild = 0; rebuild < 4; ++rebuild )
+	{
+		b2World_RebuildStaticTreeAsync( worldId );
+
+		// Keep stepping until a step has started with the new tree
+		bool swapped = false;
+		uint64_t ticks = b2GetTicks();
+		while ( swapped == false && b2GetMilliseconds( ticks ) < 10000.0f )
+		{
+			swapped = b2World_IsStaticTreeRebuilding( worldId ) == false;
+			b2World_StepAsync( worldId, 1.0f / 60.0f, 4 );
+
+			for ( int i = 0; i < 20; ++i )
+			{
+				int count = 0;
+				b2World_OverlapAABB( worldId, field, filter, CountTileOverlaps, &count );
+				ENSURE( count == 400 );
+			}
+
+			b2World_WaitStep( worldId );
+		}
+
+		ENSURE( swapped );
+	}
+
+	b2DestroyWorld( worldId );
+	return 0;
+}
+
+static void CreateRayCacheWorld( b2WorldId worldId, b2BodyId* wallIds )
+{
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Polygon box = b2MakeSquare( 0.5f );
+	for ( int i = 0; i < 21; ++i )
+	{
+		bodyDef.position = (b2Vec2){ 20.0f, i - 10.0f };
+		wallIds[i] = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( wallIds[i], &shapeDef, &box );
+	}
+
+	// Clutter behind the wall
+	b2Circle circle = { b2Vec2_zero, 0.1f };
+	for ( int i = 0; i < 400; ++i )
+	{
+		bodyDef.position = (b2Vec2){ 21.5f + i % 20, 0.5f * ( i / 20 ) - 5.0f };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2CreateCircleShape( bodyId, &shapeDef, &circle );
+	}
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.gravityScale = 0.0f;
+	bodyDef.position = (b2Vec2){ 10.0f, 5.0f };
+	b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+	b2CreatePolygonShape( bodyId, &shapeDef, &box );
+}
+
+// The static ray cache gives the same results as a plain cast with less traversal
+static int TestRayCache( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId plainId = b2CreateWorld( &worldDef );
+	worldDef.rayCacheCapacity = 60;
+	b2WorldId cachedId = b2CreateWorld( &worldDef );
+
+	b2BodyId plainWalls[21], cachedWalls[21];
+	CreateRayCacheWorld( plainId, plainWalls );
+	CreateRayCacheWorld( cachedId, cachedWalls );
+
+	b2QueryFilter filter = b2DefaultQueryFilter();
+	int plainVisits = 0, cachedVisits = 0;
+
+	for ( int step = 0; step < 40; ++step )
+	{
+		// A slowly moving agent looking at the wall, then one looking past the dynamic box
+		for ( int k = 0; k < 2; ++k )
+		{
+			b2Vec2 origin = { 0.01f * step, 5.0f * k + 0.01f * step };
+			b2Vec2 translation = { 40.0f, 0.3f };
+
+			b2RayResult plain = b2World_CastRayClosest( plainId, origin, translation, filter );
+			b2RayResult cached = b2World_CastRayClosest( cachedId, origin, translation, filter );
+			ENSURE( plain.hit && cached.hit );
+			ENSURE( plain.shapeId.index1 == cached.shapeId.index1 );
+			ENSURE( plain.fraction == cached.fraction );
+			ENSURE( plain.point.x == cached.point.x && plain.point.y == cached.point.y );
+
+			plainVisits += plain.nodeVisits;
+			cachedVisits += cached.nodeVisits;
+
+			// Repeating the ray skips the static tree, leaving the dynamic box
+			b2RayResult repeat = b2World_CastRayClosest( cachedId, origin, translation, filter );
+			ENSURE( repeat.shapeId.index1 == cached.shapeId.index1 && repeat.fraction == cached.fraction );
+			ENSURE( repeat.leafVisits == k );
+		}
+	}
+
+	// Nearby rays start from the previous hit, which never adds traversal
+	ENSURE( cachedVisits <= plainVisits );
+
+	// A static edit invalidates the cache
+	b2Vec2 origin = { 0.0f, 0.0f };
+	b2Vec2 translation = { 40.0f, 0.0f };
+	b2RayResult before = b2World_CastRayClosest( cachedId, origin, translation, filter );
+	b2DestroyBody( plainWalls[10] );
+	b2DestroyBody( cachedWalls[10] );
+
+	b2RayResult plain = b2World_CastRayClosest( plainId, origin, translation, filter );
+	b2RayResult cached = b2World_CastRayClosest( cachedId, origin, translation, filter );
+	ENSURE( plain.hit && cached.hit && cached.shapeId.index1 != before.shapeId.index1 );
+	ENSURE( plain.shapeId.index1 == cached.shapeId.index1 && plain.fraction == cached.fraction );
+
+	b2DestroyWorld( plainId );
+	b2DestroyWorld( cachedId );
+	return 0;
+}
+
+static b2Vec2 RunPrefetchPyramid( int prefetchDistance )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.contactPrefetchDistance = prefetchDistance;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2Segment segment = { { -40.0f, 0.0f }, { 40.0f, 0.0f } };
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeSquare( 0.5f );
+	b2BodyId topId = b2_nullBodyId;
+	for ( int row = 0; row < 20; ++row )
+	{
+		for ( int i = 0; i < 20 - row; ++i )
+		{
+			bodyDef.position = (b2Vec2){ i + 0.5f * row - 10.0f, 0.5f + row };
+			topId = b2CreateBody( worldId, &bodyDef );
+			b2CreatePolygonShape( topId, &shapeDef, &box );
+		}
+	}
+
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	b2Vec2 position = b2Body_GetPosition( topId );
+	b2DestroyWorld( worldId );
+	return position;
+}
+
+// Prefetching is only a hint, so the solver results do not change
+static int TestContactPrefetch( void )
+{
+	b2Vec2 p0 = RunPrefetchPyramid( 0 );
+	b2Vec2 p1 = RunPrefetchPyramid( 2 );
+	b2Vec2 p2 = RunPrefetchPyramid( 1000 );
+	ENSURE( p0.x == p1.x && p0.y == p1.y );
+	ENSURE( p0.x == p2.x && p0.y == p2.y );
+
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+	ENSURE( b2World_GetContactPrefetchDistance( worldId ) == 2 );
+	b2World_SetContactPrefetchDistance( worldId, 4 );
+	ENSURE( b2World_GetContactPrefetchDistance( worldId ) == 4 );
+	b2DestroyWorld( worldId );
+	return 0;
+}
+
+// Drops a ball on ground with the given material. Reports the final horizontal speed of the ball and its
+// largest upward speed, which only a bounce produces.
+static void SimulateMaterialBall( b2SurfaceMaterial material, float angularVelocity, float* speed, float* maxUpSpeed )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	shapeDef.material = material;
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2Segment segment = { { -100.0f, 0.0f }, { 100.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position = (b2Vec2){ 0.0f, 1.0f };
+	bodyDef.angularVelocity = angularVelocity;
+	bodyDef.enableSleep = false;
+	b2BodyId ballId = b2CreateBody( worldId, &bodyDef );
+	shapeDef = b2DefaultShapeDef();
+	b2Circle circle = { { 0.0f, 0.0f }, 0.5f };
+	b2CreateCircleShape( ballId, &shapeDef, &circle );
+
+	*maxUpSpeed = 0.0f;
+	for ( int i = 0; i < 120; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		*maxUpSpeed = b2MaxFloat( *maxUpSpeed, b2Body_GetLinearVelocity( ballId ).y );
+	}
+
+	*speed = b2AbsFloat( b2Body_GetLinearVelocity( ballId ).x );
+	b2DestroyWorld( worldId );
+}
+
+// Each material feature selects its own solver kernel variant
+static int TestContactFeatures( void )
+{
+	b2SurfaceMaterial plain = b2DefaultSurfaceMaterial();
+	float plainSpeed, plainUpSpeed;
+	SimulateMaterialBall( plain, 0.0f, &plainSpeed, &plainUpSpeed );
+	ENSURE( plainSpeed < 0.01f );
+	ENSURE( plainUpSpeed < 0.1f );
+
+	float rollingSpeed, upSpeed;
+	SimulateMaterialBall( plain, -10.0f, &rollingSpeed, &upSpeed );
+	ENSURE( rollingSpeed > 1.0f );
+
+	b2SurfaceMaterial resistant = plain;
+	resistant.rollingResistance = 0.2f;
+	float resistedSpeed;
+	SimulateMaterialBall( resistant, -10.0f, &resistedSpeed, &upSpeed );
+	ENSURE( resistedSpeed < 0.5f * rollingSpeed );
+
+	b2SurfaceMaterial conveyor = plain;
+	conveyor.tangentSpeed = 2.0f;
+	float conveyorSpeed;
+	SimulateMaterialBall( conveyor, 0.0f, &conveyorSpeed, &upSpeed );
+	ENSURE( conveyorSpeed > 0.5f );
+
+	b2SurfaceMaterial bouncy = plain;
+	bouncy.restitution = 0.8f;
+	float bouncySpeed;
+	SimulateMaterialBall( bouncy, 0.0f, &bouncySpeed, &upSpeed );
+	ENSURE( upSpeed > 1.0f );
+
+	return 0;
+}
+
+typedef struct SkimResult
+{
+	b2AABB aabb;
+	int touchingSteps;
+	int untouchedCount;
+	int enlargedCount;
+} SkimResult;
+
+// A ball slides over a box a little above it, inside the default speculative distance
+static SkimResult SimulateSkimmingBall( float speculativeDistance, float aabbMargin )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.gravity = b2Vec2_zero;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+	b2World_EnableDetailedCounters( worldId, true );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2Polygon box = b2MakeBox( 1.0f, 0.5f );
+	b2CreatePolygonShape( groundId, &shapeDef, &box );
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position = (b2Vec2){ 0.0f, 0.5f + 0.25f + 3.0f * B2_LINEAR_SLOP };
+	bodyDef.linearVelocity = (b2Vec2){ 2.0f, 0.0f };
+	b2BodyId ballId = b2CreateBody( worldId, &bodyDef );
+	shapeDef.speculativeDistance = speculativeDistance;
+	shapeDef.aabbMargin = aabbMargin;
+	b2Circle circle = { { 0.0f, 0.0f }, 0.25f };
+	b2ShapeId ballShapeId = b2CreateCircleShape( ballId, &shapeDef, &circle );
+
+	SkimResult result = { 0 };
+	for ( int i = 0; i < 90; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+		if ( i == 0 )
+		{
+			result.aabb = b2Shape_GetAABB( ballShapeId );
+		}
+
+		b2ContactData contactData;
+		result.touchingSteps += b2Body_GetContactData( ballId, &contactData, 1 );
+
+		b2Counters counters = b2World_GetCounters( worldId );
+		result.untouchedCount += counters.untouchedContactCount;
+		result.enlargedCount += counters.enlargedProxyCount;
+	}
+
+	b2DestroyWorld( worldId );
+	return result;
+}
+
+// Shape overrides of the speculative distance and the broad-phase margin
+static int TestShapeSpeculativeDistance( void )
+{
+	SkimResult standard = SimulateSkimmingBall( 0.0f, 0.0f );
+	ENSURE( standard.touchingSteps > 0 );
+	ENSURE( standard.untouchedCount == 0 );
+	ENSURE_SMALL( standard.aabb.upperBound.y - standard.aabb.lowerBound.y - 0.5f - 2.0f * B2_SPECULATIVE_DISTANCE,
+				  FLT_EPSILON );
+
+	// The ball never gets close enough for a speculative point, so the contact goes away untouched
+	SkimResult debris = SimulateSkimmingBall( B2_LINEAR_SLOP, 0.0f );
+	ENSURE( debris.touchingSteps == 0 );
+	ENSURE( debris.untouchedCount == 1 );
+	ENSURE_SMALL( debris.aabb.upperBound.y - debris.aabb.lowerBound.y - 0.5f - 2.0f * B2_LINEAR_SLOP, FLT_EPSILON );
+
+	// Clamped to the default
+	SkimResult clamped = SimulateSkimmingBall( 1.0f, 0.0f );
+	ENSURE( clamped.touchingSteps == standard.touchingSteps );
+
+	// A wide margin keeps the proxy in place while the ball moves
+	SkimResult wide = SimulateSkimmingBall( 0.0f, 4.0f );
+	ENSURE( wide.enlargedCount < standard.enlargedCount );
+
+	return 0;
+}
+
+static int TestShardGrid( void )
+{
+	b2ShardGridDef gridDef = b2DefaultShardGridDef();
+	gridDef.worldDef.gravity = b2Vec2_zero;
+	gridDef.origin = (b2Vec2){ -10.0f, -10.0f };
+	gridDef.shardSize = (b2Vec2){ 10.0f, 20.0f };
+	gridDef.columnCount = 2;
+	gridDef.rowCount = 1;
+	b2ShardGrid* grid = b2CreateShardGrid( &gridDef );
+	ENSURE( b2ShardGrid_GetShardCount( grid ) == 2 );
+	ENSURE( b2ShardGrid_FindShard( grid, (b2Vec2){ -100.0f, 0.0f } ) == 0 );
+	ENSURE( b2ShardGrid_FindShard( grid, (b2Vec2){ 0.1f, 0.0f } ) == 1 );
+
+	b2WorldId leftId = b2ShardGrid_GetWorld( grid, 0 );
+	b2WorldId rightId = b2ShardGrid_GetWorld( grid, 1 );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position = (b2Vec2){ -3.0f, 0.0f };
+	bodyDef.linearVelocity = (b2Vec2){ 5.0f, 0.0f };
+	b2BodyId movingId = b2CreateBody( leftId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Polygon box = b2MakeSquare( 0.5f );
+	b2CreatePolygonShape( movingId, &shapeDef, &box );
+	uint64_t key = b2ShardGrid_AddBody( grid, movingId );
+	ENSURE( key != 0 );
+
+	// Not added to the grid, so it stays in the right shard
+	bodyDef.position = (b2Vec2){ 1.0f, 0.0f };
+	bodyDef.linearVelocity = b2Vec2_zero;
+	b2BodyId restingId = b2CreateBody( rightId, &bodyDef );
+	b2CreatePolygonShape( restingId, &shapeDef, &box );
+
+	bool sawGhost = false;
+	int stepCount = 0;
+	while ( b2ShardGrid_GetOwnedCount( grid, 1 ) == 0 && stepCount < 60 )
+	{
+		b2ShardGrid_Step( grid, 1.0f / 60.0f, 4 );
+		sawGhost = sawGhost || b2ShardGrid_GetGhostCount( grid, 1 ) == 1;
+		stepCount += 1;
+	}
+
+	// Pushed by the ghost before the handoff
+	ENSURE( sawGhost );
+	ENSURE( b2ShardGrid_GetOwnedCount( grid, 0 ) == 0 );
+	ENSURE( b2Body_GetPosition( restingId ).x > 1.0f );
+
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2ShardGrid_Step( grid, 1.0f / 60.0f, 4 );
+	}
+
+	// Handed off with its state and far enough from the border to have no ghost
+	b2BodyId bodyId = b2ShardGrid_GetBody( grid, key );
+	ENSURE( b2Body_IsValid( bodyId ) );
+	ENSURE( b2Body_IsValid( movingId ) == false );
+	ENSURE( b2Body_GetWorld( bodyId ).index1 == rightId.index1 );
+	ENSURE( b2Body_GetType( bodyId ) == b2_dynamicBody );
+	ENSURE( b2Body_GetShapeCount( bodyId ) == 1 );
+	ENSURE( b2Body_GetPosition( bodyId ).x > 2.0f );
+	ENSURE( b2ShardGrid_GetOwnedCount( grid, 0 ) == 0 );
+	ENSURE( b2ShardGrid_GetOwnedCount( grid, 1 ) == 1 );
+	ENSURE( b2ShardGrid_GetGhostCount( grid, 0 ) == 0 );
+	ENSURE( b2ShardGrid_GetGhostCount( grid, 1 ) == 0 );
+
+	// Messages are checked before they are applied
+	uint8_t buffer[8] = { 0 };
+	ENSURE( b2ShardGrid_WriteBorderState( grid, 1, 0, buffer, sizeof( buffer ) ) == 0 );
+	ENSURE( b2ShardGrid_ReadBorderState( grid, buffer, sizeof( buffer ) ) == false );
+
+	b2ShardGrid_RemoveBody( grid, key );
+	ENSURE( b2Body_IsValid( bodyId ) == false );
+	ENSURE( b2ShardGrid_GetOwnedCount( grid, 1 ) == 0 );
+
+	b2DestroyShardGrid( grid );
+
+	return 0;
+}
+
+// Many contacts start touching in the first step, so they are linked in bulk
+static int TestBulkTouchingContacts( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Segment segment = { { -10.0f, 0.0f }, { 70.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	// Columns of boxes resting on each other
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	b2BodyId topIds[20];
+	for ( int i = 0; i < 20; ++i )
+	{
+		for ( int j = 0; j < 10; ++j )
+		{
+			bodyDef.position = (b2Vec2){ 3.0f * i, 0.5f + 1.0f * j };
+			topIds[i] = b2CreateBody( worldId, &bodyDef );
+			b2CreatePolygonShape( topIds[i], &shapeDef, &box );
+		}
+	}
+
+	// A plank joins the first five columns into one island
+	bodyDef.position = (b2Vec2){ 6.0f, 10.25f };
+	b2BodyId plankId = b2CreateBody( worldId, &bodyDef );
+	b2Polygon plank = b2MakeBox( 6.5f, 0.25f );
+	b2CreatePolygonShape( plankId, &shapeDef, &plank );
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+
+	b2Counters counters = b2World_GetCounters( worldId );
+	ENSURE( counters.contactCount >= 205 );
+	ENSURE( counters.islandCount == 16 );
+
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	// The stacks are solved as well as with one at a time linking
+	for ( int i = 5; i < 20; ++i )
+	{
+		b2Vec2 p = b2Body_GetPosition( topIds[i] );
+		ENSURE( b2AbsFloat( p.x - 3.0f * i ) < 0.01f );
+		ENSURE( b2AbsFloat( p.y - 9.5f ) < 0.05f );
+	}
+
+	ENSURE( b2AbsFloat( b2Body_GetPosition( plankId ).y - 10.25f ) < 0.05f );
+
+	b2DestroyWorld( worldId );
+
+	return 0;
+}
+
+static b2WorldId CreatePyramidWorld( bool enableColorBalancing, int workerCount, b2BodyId* topId )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.enableColorBalancing = enableColorBalancing;
+	worldDef.workerCount = workerCount;
+	worldDef.enableSleep = false;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2Segment segment = { { -40.0f, 0.0f }, { 40.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.5f, 0.5f );
+	int baseCount = 30;
+	for ( int i = 0; i < baseCount; ++i )
+	{
+		for ( int j = i; j < baseCount; ++j )
+		{
+			bodyDef.position = (b2Vec2){ 1.0f * j - 0.5f * i - 0.5f * baseCount, 0.5f + 1.0f * i };
+			*topId = b2CreateBody( worldId, &bodyDef );
+			b2CreatePolygonShape( *topId, &shapeDef, &box );
+		}
+	}
+
+	return worldId;
+}
+
+// Largest contact count of a graph color over the mean of the colors in use
+static float GetColorImbalance( b2WorldId worldId )
+{
+	b2Counters counters = b2World_GetCounters( worldId );
+	int total = 0, activeCount = 0, maxCount = 0;
+	for ( int i = 0; i < 23; ++i )
+	{
+		int count = counters.colorCounts[i];
+		total += count;
+		activeCount += count > 0 ? 1 : 0;
+		maxCount = b2MaxInt( maxCount, count );
+	}
+
+	return activeCount > 0 ? maxCount * activeCount / (float)total : 0.0f;
+}
+
+static int TestColorBalancing( void )
+{
+	b2BodyId topIdA, topIdB;
+	b2WorldId worldIdA = CreatePyramidWorld( false, 1, &topIdA );
+	b2WorldId worldIdB = CreatePyramidWorld( true, 1, &topIdB );
+	ENSURE( b2World_IsColorBalancingEnabled( worldIdA ) == false );
+	ENSURE( b2World_IsColorBalancingEnabled( worldIdB ) );
+
+	int balancedCount = 0;
+	for ( int i = 0; i < 90; ++i )
+	{
+		b2World_Step( worldIdA, 1.0f / 60.0f, 4 );
+		b2World_Step( worldIdB, 1.0f / 60.0f, 4 );
+		ENSURE( b2World_GetCounters( worldIdA ).balancedContactCount == 0 );
+		balancedCount += b2World_GetCounters( worldIdB ).balancedContactCount;
+	}
+
+	ENSURE( balancedCount > 0 );
+
+	float imbalanceA = GetColorImbalance( worldIdA );
+	float imbalanceB = GetColorImbalance( worldIdB );
+	ENSURE( imbalanceB < imbalanceA );
+
+	// On demand
+	b2World_BalanceColors( worldIdA );
+	ENSURE( GetColorImbalance( worldIdA ) < imbalanceA );
+
+	for ( int i = 0; i < 30; ++i )
+	{
+		b2World_Step( worldIdA, 1.0f / 60.0f, 4 );
+		b2World_Step( worldIdB, 1.0f / 60.0f, 4 );
+	}
+
+	// Both pyramids stand
+	b2Vec2 pA = b2Body_GetPosition( topIdA );
+	b2Vec2 pB = b2Body_GetPosition( topIdB );
+	ENSURE( b2AbsFloat( pA.x + 0.5f ) < 0.1f && b2AbsFloat( pA.y - 29.5f ) < 0.2f );
+	ENSURE( b2AbsFloat( pB.x + 0.5f ) < 0.1f && b2AbsFloat( pB.y - 29.5f ) < 0.2f );
+
+	b2DestroyWorld( worldIdA );
+	b2DestroyWorld( worldIdB );
+	return 0;
+}
+
+// The tail colors of a pyramid hold a few contacts that the main thread solves alone
+static int TestInlineColors( void )
+{
+	b2BodyId topIdA, topIdB;
+	b2WorldId worldIdA = CreatePyramidWorld( false, 1, &topIdA );
+	b2WorldId worldIdB = CreatePyramidWorld( false, 4, &topIdB );
+
+	for ( int i = 0; i < 60; ++i )
+	{
+		b2World_Step( worldIdA, 1.0f / 60.0f, 4 );
+		b2World_Step( worldIdB, 1.0f / 60.0f, 4 );
+
+		b2Counters counters = b2World_GetCounters( worldIdB );
+		int activeCount = 0;
+		for ( int j = 0; j < 23; ++j )
+		{
+			activeCount += counters.colorCounts[j] > 0 ? 1 : 0;
+		}
+
+		ENSURE( 0 < counters.inlineColorCount && counters.inlineColorCount < activeCount );
+	}
+
+	// Colors solve the same on any thread
+	b2Vec2 pA = b2Body_GetPosition( topIdA );
+	b2Vec2 pB = b2Body_GetPosition( topIdB );
+	ENSURE( pA.x == pB.x && pA.y == pB.y );
+
+	b2DestroyWorld( worldIdA );
+	b2DestroyWorld( worldIdB );
+	return 0;
+}
+
+static int s_tagBytes[b2_allocTagCount];
+static int s_tagWorldIndex = -2;
+static bool s_tagWorldMismatch;
+
+static void* TaggedAlloc( unsigned int size, int alignment, b2AllocInfo info )
+{
+	s_tagBytes[info.tag] += size;
+
+	if ( info.tag == b2_allocTagWorld && info.worldIndex != s_tagWorldIndex )
+	{
+		s_tagWorldMismatch = true;
+	}
+
+#if defined( _MSC_VER )
+	return _aligned_malloc( size, alignment );
+#else
+	return aligned_alloc( alignment, size );
+#endif
+}
+
+static void TaggedFree( void* mem, unsigned int size )
+{
+	(void)size;
+
+#if defined( _MSC_VER )
+	_aligned_free( mem );
+#else
+	free( mem );
+#endif
+}
+
+static int TestTaggedAllocator( void )
+{
+	b2SetTaggedAllocator( TaggedAlloc, TaggedFree );
+
+	// The next world takes the first free slot, which is reported as the world index
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	b2WorldId probeId = b2CreateWorld( &worldDef );
+	s_tagWorldIndex = probeId.index1 - 1;
+	b2DestroyWorld( probeId );
+
+	memset( s_tagBytes, 0, sizeof( s_tagBytes ) );
+	s_tagWorldMismatch = false;
+
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+	ENSURE( worldId.index1 - 1 == s_tagWorldIndex );
+
+	int createdWorldBytes = s_tagBytes[b2_allocTagWorld];
+	ENSURE( createdWorldBytes > 0 );
+	ENSURE( s_tagBytes[b2_allocTagTree] > 0 );
+	ENSURE( s_tagBytes[b2_allocTagBroadPhase] > 0 );
+	ENSURE( s_tagBytes[b2_allocTagStack] > 0 );
+	ENSURE( s_tagBytes[b2_allocTagEvents] > 0 );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	shapeDef.enableContactEvents = true;
+	b2Segment segment = { { -40.0f, 0.0f }, { 40.0f, 0.0f } };
+	b2CreateSegmentShape( groundId, &shapeDef, &segment );
+
+	bodyDef.type = b2_dynamicBody;
+	b2Polygon box = b2MakeBox( 0.25f, 0.25f );
+	for ( int i = 0; i < 200; ++i )
+	{
+		bodyDef.position = (b2Vec2){ -20.0f + 0.6f * ( i % 60 ), 0.25f + 0.6f * ( i / 60 ) };
+		b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+		b2CreatePolygonShape( bodyId, &shapeDef, &box );
+	}
+
+	int treeBytes = s_tagBytes[b2_allocTagTree];
+	int eventBytes = s_tagBytes[b2_allocTagEvents];
+	int broadPhaseBytes = s_tagBytes[b2_allocTagBroadPhase];
+
+	b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	ENSURE( b2World_GetContactEvents( worldId ).beginCount >= 60 );
+
+	for ( int i = 0; i < 10; ++i )
+	{
+		b2World_Step( worldId, 1.0f / 60.0f, 4 );
+	}
+
+	// Growth during the step is attributed to its subsystem and world
+	ENSURE( s_tagBytes[b2_allocTagEvents] > eventBytes );
+	ENSURE( s_tagBytes[b2_allocTagBroadPhase] > broadPhaseBytes );
+	ENSURE( s_tagBytes[b2_allocTagWorld] > createdWorldBytes );
+	ENSURE( s_tagBytes[b2_allocTagTree] >= treeBytes );
+	ENSURE( s_tagWorldMismatch == false );
+
+	b2DestroyWorld( worldId );
+	b2SetAllocator( NULL, NULL );
+	return 0;
+}
+
+static bool NearTransforms( b2Transform a, b2Transform b )
+{
+	float tolerance = 1e-5f;
+	return b2Distance( a.p, b.p ) < tolerance && b2AbsFloat( b2RelativeAngle( a.q, b.q ) ) < tolerance;
+}
+
+static int TestInterpolation( void )
+{
+	b2WorldDef worldDef = b2DefaultWorldDef();
+	worldDef.enableInterpolation = true;
+	b2WorldId worldId = b2CreateWorld( &worldDef );
+
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	b2BodyId groundId = b2CreateBody( worldId, &bodyDef );
+	b2Polygon groundBox = b2MakeBox( 20.0f, 1.0f );
+	b2ShapeDef shapeDef = b2DefaultShapeDef();
+	b2CreatePolygonShape( groundId, &shapeDef, &groundBox );
+
+	// The center of mass is away from the origin so a spin moves the origin on an arc
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position = (b2Vec2){ 0.0f, 10.0f };
+	bodyDef.angularVelocity = 4.0f;
+	b2BodyId bodyId = b2CreateBody( worldId, &bodyDef );
+	b2Polygon box = b2MakeOffsetBox( 0.5f, 0.5f, (b2Vec2){ 2.0f, 0.0f }, b2Rot_identity );
+	b2CreatePolygonShape( bodyId, &shapeDef, &box );
+
+	bodyDef.type = b2_kinematicBody;
+	bodyDef.position = (b2Vec2){ 5.0f, 5.0f };
+	bodyDef.linearVelocity = (b2Vec2){ 3.0f, 0.0f };
+	bodyDef.angularVelocity = 0.0f;
+	b2BodyId kinematicId = b2CreateBody( worldId, &bodyDef );
+
+	b2BodyId bodyIds[3] = { bodyId, kinematicId, groundId };
+	b2Transform transforms[3];
+
+	// Nothing has moved yet
+	b2World_GetInterpolatedTransforms( worldId, 0.0f, bodyIds, 3, transforms );
+	ENSURE( NearTransforms( transforms[0], b2Body_GetTransform( bodyId ) ) );
+
+	for ( int i = 0; i < 10; ++i )
+	{
+		b2Transform before[3];
+		for ( int j = 0; j < 3; ++j )
+		{
+			before[j] = b2Body_GetTransform( bodyIds[j] );
+		}
+
+		b2World_Step( worldId, 1.0f / 30.0f, 4 );
+
+		b2World_GetInterpolatedTransforms( worldId, 0.0f, bodyIds, 3, transforms );
+		for ( int j = 0; j < 3; ++j )
+		{
+			ENSURE( NearTransforms( transforms[j], before[j] ) );
+		}
+
+		b2World_GetInterpolatedTransforms( worldId, 1.0f, bodyIds, 3, transforms );
+		for ( int j = 0; j < 3; ++j )
+		{
+			ENSURE( NearTransforms( transforms[j], b2Body_GetTransform( bodyIds[j] ) ) );
+		}
+
+		// Half way the center of mass is half way
+		b2World_GetInterpolatedTransforms( worldId, 0.5f, bodyIds, 3, transforms );
+		b2Vec2 center0 = b2TransformPoint( before[0], b2Body_GetLocalCenterOfMass( bodyId ) );
+		b2Vec2 center = b2TransformPoint( transforms[0], b2Body_GetLocalCenterOfMass( bodyId ) );
+		ENSURE( b2Distance( center, b2Lerp( center0, b2Body_GetWorldCenterOfMass( bodyId ), 0.5f ) ) < 1e-5f );
+		ENSURE( NearTransforms( transforms[2], b2Body_GetTransform( groundId ) ) );
+	}
+
+	// Teleports do not blend
+	b2Body_SetTransform( bodyId, (b2Vec2){ -5.0f, 8.0f }, b2Rot_identity );
+	b2World_GetInterpolatedTransforms( worldId, 0.0f, bodyIds, 1, transforms );
+	ENSURE( NearTransforms( transforms[0], b2Body_GetTransform( bodyId ) ) );
+
+	b2World_Step( worldId, 1.0f / 30.0f, 4 );
+
+	// Disabled interpolation gives the current transforms
+	b2World_EnableInterpolation( worldId, false );
+	ENSURE( b2World_IsInterpolationEnabled( worldId ) == false );
+	b2World_GetInterpolatedTransforms( worldId, 0.0f, bodyIds, 3, transforms );
+	for ( int j = 0; j < 3; ++j )
+	{
+		ENSURE( NearTransforms( transforms[j], b2Body_GetTransform( bodyIds[j] ) ) );
+	}
+
+	b2DestroyWorld( worldId );
+	return 0;
+}
+
 int WorldTest( void )
 {
 	RUN_SUBTEST( HelloWorld );
@@ -445,6 +6427,78 @@ int WorldTest( void )
 	RUN_SUBTEST( TestWorldCoverage );
 	RUN_SUBTEST( TestSensor );
 	RUN_SUBTEST( TestSetWorkerCount );
+	RUN_SUBTEST( TestKinematicColoring );
+	RUN_SUBTEST( TestAdaptiveRelax );
+	RUN_SUBTEST( TestCapacity );
+	RUN_SUBTEST( TestCompact );
+	RUN_SUBTEST( TestParallelStaticRebuild );
+	RUN_SUBTEST( TestParallelRefit );
+	RUN_SUBTEST( TestCastRaysClosest );
+	RUN_SUBTEST( TestCastShapesClosest );
+	RUN_SUBTEST( TestOverlapBatch );
+	RUN_SUBTEST( TestSolveMovers );
+	RUN_SUBTEST( TestCreateBodies );
+	RUN_SUBTEST( TestDestroyBodies );
+	RUN_SUBTEST( TestBodyStates );
+	RUN_SUBTEST( TestBodyCommands );
+	RUN_SUBTEST( TestChainTerrain );
+	RUN_SUBTEST( TestStaticTiles );
+	RUN_SUBTEST( TestBakeStatic );
+	RUN_SUBTEST( TestIslandSplits );
+	RUN_SUBTEST( TestSleepyIslandSplits );
+	RUN_SUBTEST( TestIncrementalIslands );
+	RUN_SUBTEST( TestSleepWakeCycles );
+	RUN_SUBTEST( TestIncrementalSensors );
+	RUN_SUBTEST( TestSensorUpdateInterval );
+	RUN_SUBTEST( TestSensorManyVisitors );
+	RUN_SUBTEST( TestContactEventFilter );
+	RUN_SUBTEST( TestOverflowHitEvents );
+	RUN_SUBTEST( TestMoveEventFilter );
+	RUN_SUBTEST( TestJointEvents );
+	RUN_SUBTEST( TestWorkerProfile );
+	RUN_SUBTEST( TestTraceRecorder );
+	RUN_SUBTEST( TestMemoryStats );
+	RUN_SUBTEST( TestCompactContacts );
+	RUN_SUBTEST( TestCompactSleepSteps );
+	RUN_SUBTEST( TestDetailedCounters );
+	RUN_SUBTEST( TestStepEventCounters );
+	RUN_SUBTEST( TestSimulationInterval );
+	RUN_SUBTEST( TestActiveRegions );
+	RUN_SUBTEST( TestSeparatedContacts );
+	RUN_SUBTEST( TestDetachedKinematics );
+	RUN_SUBTEST( TestVelocityMargins );
+	RUN_SUBTEST( TestAdaptiveBlocks );
+	RUN_SUBTEST( TestWaitPolicies );
+	RUN_SUBTEST( TestAutoWorkers );
+	RUN_SUBTEST( TestTaskInfo );
+	RUN_SUBTEST( TestDrawBatch );
+	RUN_SUBTEST( TestBodyRefs );
+	RUN_SUBTEST( TestBatchCallbacks );
+	RUN_SUBTEST( TestFilterPruning );
+	RUN_SUBTEST( TestAreaForces );
+	RUN_SUBTEST( TestCompoundCrateForces );
+	RUN_SUBTEST( TestJointPrepareReuse );
+	RUN_SUBTEST( TestSmallIslandSolve );
+	RUN_SUBTEST( TestBodyReorder );
+	RUN_SUBTEST( TestContactOrdering );
+	RUN_SUBTEST( TestCompoundShape );
+	RUN_SUBTEST( TestParticles );
+	RUN_SUBTEST( TestBulkTouchingContacts );
+	RUN_SUBTEST( TestColorBalancing );
+	RUN_SUBTEST( TestInlineColors );
+	RUN_SUBTEST( TestTaggedAllocator );
+	RUN_SUBTEST( TestInterpolation );
+	RUN_SUBTEST( TestRelaxedDeterminism );
+	RUN_SUBTEST( TestShardGrid );
+	RUN_SUBTEST( TestExportBuffer );
+	RUN_SUBTEST( TestIncrementalPairs );
+	RUN_SUBTEST( TestStepBudget );
+	RUN_SUBTEST( TestStaticTreeAsync );
+	RUN_SUBTEST( TestStaticTreeAsyncStep );
+	RUN_SUBTEST( TestRayCache );
+	RUN_SUBTEST( TestContactPrefetch );
+	RUN_SUBTEST( TestContactFeatures );
+	RUN_SUBTEST( TestShapeSpeculativeDistance );
 
 	return 0;
 }